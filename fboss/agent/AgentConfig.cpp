@@ -11,12 +11,25 @@
 
 #include "fboss/agent/FbossError.h"
 
+#include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/io/IOBuf.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <sys/stat.h>
+
+#include <cstring>
 #include <iostream>
 
 DEFINE_string(config, "", "The path to the local JSON configuration file");
+DEFINE_bool(use_config_cache, true,
+            "Keep the parsed config in a binary cache, to skip parsing the "
+            "JSON when the config file hasn't changed");
+DEFINE_string(config_cache, "",
+              "Where to cache the parsed config, next to the config file "
+              "with a .cache suffix if empty");
 
 // NOTE: we use std::cerr because logging libs are likely not
 // initialized yet...
@@ -24,6 +37,77 @@ DEFINE_string(config, "", "The path to the local JSON configuration file");
 namespace facebook {
 namespace fboss {
 
+namespace {
+
+/*
+ * The cache is the key of the config it was parsed from followed by the
+ * parsed cfg::AgentConfig, compact serialized.
+ *
+ * The key covers the agent binary as well as the config contents: a
+ * binary with a different config schema would otherwise quietly drop the
+ * fields the one that wrote the cache didn't know about.
+ */
+uint64_t getCacheKey(const std::string& configStr) {
+  uint64_t binary = 0;
+  struct stat st;
+  if (stat("/proc/self/exe", &st) == 0) {
+    binary = folly::hash::hash_combine(st.st_ino, st.st_size, st.st_mtime);
+  }
+  return folly::hash::SpookyHashV2::Hash64(
+      configStr.data(), configStr.size(), binary);
+}
+
+std::string getCachePath(folly::StringPiece path) {
+  if (!FLAGS_config_cache.empty()) {
+    return FLAGS_config_cache;
+  }
+  return folly::to<std::string>(path, ".cache");
+}
+
+bool readCache(
+    const std::string& cachePath,
+    uint64_t key,
+    cfg::AgentConfig* agentConfig) {
+  std::string cache;
+  if (!folly::readFile(cachePath.c_str(), cache)) {
+    return false;
+  }
+  if (cache.size() < sizeof(key) ||
+      memcmp(cache.data(), &key, sizeof(key)) != 0) {
+    std::cerr << "Config cache " << cachePath << " is stale" << std::endl;
+    return false;
+  }
+  try {
+    // Straight out of the file contents, without copying them
+    auto buf = folly::IOBuf::wrapBufferAsValue(
+        cache.data() + sizeof(key), cache.size() - sizeof(key));
+    apache::thrift::CompactSerializer::deserialize(&buf, *agentConfig);
+  } catch (const std::exception& ex) {
+    std::cerr << "Unable to read config cache " << cachePath << ": "
+              << ex.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void writeCache(
+    const std::string& cachePath,
+    uint64_t key,
+    const cfg::AgentConfig& agentConfig) {
+  std::string cache(reinterpret_cast<const char*>(&key), sizeof(key));
+  cache.append(apache::thrift::CompactSerializer::serialize<std::string>(
+      agentConfig));
+  try {
+    folly::writeFileAtomic(cachePath, cache);
+  } catch (const std::exception& ex) {
+    // Only the next start is slower
+    std::cerr << "Unable to write config cache " << cachePath << ": "
+              << ex.what() << std::endl;
+  }
+}
+
+} // unnamed namespace
+
 std::unique_ptr<AgentConfig> AgentConfig::fromDefaultFile() {
   CHECK(!FLAGS_config.empty()) << "Must set --config";
   return fromFile(FLAGS_config);
@@ -35,7 +119,21 @@ std::unique_ptr<AgentConfig> AgentConfig::fromFile(folly::StringPiece path) {
   if (!folly::readFile(path.data(), configStr)) {
     throw FbossError("unable to read ", path);
   }
-  return fromRawConfig(std::move(configStr));
+  if (!FLAGS_use_config_cache) {
+    return fromRawConfig(std::move(configStr));
+  }
+
+  auto cachePath = getCachePath(path);
+  auto key = getCacheKey(configStr);
+  cfg::AgentConfig agentConfig;
+  if (readCache(cachePath, key, &agentConfig)) {
+    std::cerr << "Read parsed config from " << cachePath << std::endl;
+    return std::make_unique<AgentConfig>(
+        std::move(agentConfig), std::move(configStr));
+  }
+  auto config = fromRawConfig(std::move(configStr));
+  writeCache(cachePath, key, config->thrift);
+  return config;
 }
 
 std::unique_ptr<AgentConfig> AgentConfig::fromRawConfig(
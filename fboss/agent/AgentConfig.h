@@ -22,6 +22,8 @@ struct AgentConfig {
 
   // creators
   static std::unique_ptr<AgentConfig> fromDefaultFile();
+  // Reuses the config parsed from the same contents the last time, unless
+  // --use_config_cache is off
   static std::unique_ptr<AgentConfig> fromFile(folly::StringPiece path);
   static std::unique_ptr<AgentConfig> fromRawConfig(
       const std::string& contents);
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/*
+ * Replacements for the global operator new and delete that report every
+ * allocation, and the size of every block allocated and freed, to
+ * AllocationProfiler.  Link this into a binary to enable
+ * --allocation_profile_sample_rate and getThreadLiveBytes() there; it is
+ * deliberately not part of the fboss_agent library.
+ */
+#include "fboss/agent/AllocationProfiler.h"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+using facebook::fboss::AllocationProfiler;
+
+namespace {
+void* allocateNoThrow(size_t size) noexcept {
+  AllocationProfiler::recordAllocation(size);
+  // malloc(0) may return nullptr, operator new must not
+  void* p = std::malloc(size ? size : 1);
+  if (p) {
+    AllocationProfiler::recordLiveBytes(malloc_usable_size(p));
+  }
+  return p;
+}
+
+void* allocate(size_t size) {
+  if (void* p = allocateNoThrow(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void deallocate(void* p) noexcept {
+  if (p) {
+    AllocationProfiler::recordLiveBytes(
+        -static_cast<int64_t>(malloc_usable_size(p)));
+  }
+  std::free(p);
+}
+} // unnamed namespace
+
+void* operator new(size_t size) {
+  return allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size);
+}
+
+void operator delete(void* p) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void* p, size_t /*size*/) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p, size_t /*size*/) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  deallocate(p);
+}
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/AllocationProfiler.h"
+
+#include <gflags/gflags.h>
+
+#include "fboss/agent/SwitchStats.h"
+
+DEFINE_int32(
+    allocation_profile_sample_rate,
+    0,
+    "Count the allocations made by 1 in this many state updates, hardware "
+    "updates and handled packets on each thread, 0 to disable. Only takes "
+    "effect in binaries linking AllocationHooks.cpp");
+
+namespace facebook { namespace fboss {
+
+std::array<AllocationProfiler::PathCounts, kNumAllocationPaths>
+    AllocationProfiler::pathCounts_;
+
+AllocationCounts AllocationProfiler::getPathCounts(AllocationPath path) {
+  const auto& pathCounts = pathCounts_[static_cast<size_t>(path)];
+  AllocationCounts counts;
+  counts.allocations = pathCounts.allocations.load(std::memory_order_relaxed);
+  counts.bytes = pathCounts.bytes.load(std::memory_order_relaxed);
+  return counts;
+}
+
+uint64_t AllocationProfiler::getPathSamples(AllocationPath path) {
+  return pathCounts_[static_cast<size_t>(path)].samples.load(
+      std::memory_order_relaxed);
+}
+
+void AllocationProfiler::resetPathCounts() {
+  for (auto& pathCounts : pathCounts_) {
+    pathCounts.allocations.store(0, std::memory_order_relaxed);
+    pathCounts.bytes.store(0, std::memory_order_relaxed);
+    pathCounts.samples.store(0, std::memory_order_relaxed);
+  }
+}
+
+const char* AllocationProfiler::pathName(AllocationPath path) {
+  switch (path) {
+    case AllocationPath::STATE_UPDATE_FN:
+      return "state_update_fn";
+    case AllocationPath::HW_STATE_CHANGED:
+      return "hw_state_changed";
+    case AllocationPath::RX_PACKET_HANDLER:
+      return "rx_packet_handler";
+  }
+  return "unknown";
+}
+
+bool AllocationProfiler::sampleScope() {
+  auto rate = FLAGS_allocation_profile_sample_rate;
+  if (rate <= 0) {
+    return false;
+  }
+  auto& counts = threadCounts();
+  if (++counts.scopesSinceSample < static_cast<uint32_t>(rate)) {
+    return false;
+  }
+  counts.scopesSinceSample = 0;
+  return true;
+}
+
+void AllocationProfiler::addSample(
+    AllocationPath path,
+    const AllocationCounts& counts) {
+  auto& pathCounts = pathCounts_[static_cast<size_t>(path)];
+  pathCounts.allocations.fetch_add(
+      counts.allocations, std::memory_order_relaxed);
+  pathCounts.bytes.fetch_add(counts.bytes, std::memory_order_relaxed);
+  pathCounts.samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationScope::finish() {
+  auto& threadCounts = AllocationProfiler::threadCounts();
+  --threadCounts.activeScopes;
+  AllocationCounts counts;
+  counts.allocations = threadCounts.allocations - startAllocations_;
+  counts.bytes = threadCounts.bytes - startBytes_;
+  AllocationProfiler::addSample(path_, counts);
+  if (stats_) {
+    stats_->allocations(path_, counts);
+  }
+}
+
+}} // facebook::fboss
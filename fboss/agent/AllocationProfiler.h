@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook { namespace fboss {
+
+class SwitchStats;
+
+/*
+ * The code paths whose heap allocations AllocationScope can count.
+ */
+enum class AllocationPath : uint8_t {
+  // Running a StateUpdateFn on the desired state
+  STATE_UPDATE_FN,
+  // HwSwitch::stateChanged()
+  HW_STATE_CHANGED,
+  // Handing a trapped packet to its protocol handler
+  RX_PACKET_HANDLER,
+};
+constexpr size_t kNumAllocationPaths = 3;
+
+struct AllocationCounts {
+  uint64_t allocations{0};
+  uint64_t bytes{0};
+};
+
+/*
+ * Per-path allocation counters, for finding allocation hot spots.
+ *
+ * Counting needs an operator new that calls recordAllocation(), and the
+ * replacement in AllocationHooks.cpp is only linked into the binaries that
+ * want it (currently the benchmarks), so the agent pays nothing by default.
+ * Even then, only the allocations made inside a sampled AllocationScope are
+ * counted: --allocation_profile_sample_rate=N samples one scope in N on
+ * each thread, and 0 (the default) turns profiling off.
+ */
+class AllocationProfiler {
+ public:
+  // Called by operator new for every allocation
+  static void recordAllocation(size_t bytes) {
+    auto& counts = threadCounts();
+    if (counts.activeScopes) {
+      ++counts.allocations;
+      counts.bytes += bytes;
+    }
+  }
+
+  // Called by operator new and delete with the size of every block
+  static void recordLiveBytes(int64_t delta) {
+    threadCounts().liveBytes += delta;
+  }
+
+  /*
+   * The size of the blocks the current thread allocated, minus those it
+   * freed. Every allocation counts, sampled or not, so the memory held by
+   * something built on this thread is how much this grew while building
+   * it.
+   */
+  static int64_t getThreadLiveBytes() {
+    return threadCounts().liveBytes;
+  }
+
+  /*
+   * Allocations made by all sampled scopes on path so far, across threads,
+   * and the number of scopes sampled.
+   */
+  static AllocationCounts getPathCounts(AllocationPath path);
+  static uint64_t getPathSamples(AllocationPath path);
+  static void resetPathCounts();
+
+  static const char* pathName(AllocationPath path);
+
+ private:
+  friend class AllocationScope;
+
+  struct ThreadCounts {
+    uint64_t allocations;
+    uint64_t bytes;
+    int64_t liveBytes;
+    uint32_t activeScopes;
+    uint32_t scopesSinceSample;
+  };
+
+  // Trivially constructible, so that operator new can use it on any thread
+  // without allocating
+  static ThreadCounts& threadCounts() {
+    static thread_local ThreadCounts counts;
+    return counts;
+  }
+
+  // Whether the scope being entered on this thread should be sampled
+  static bool sampleScope();
+  static void addSample(AllocationPath path, const AllocationCounts& counts);
+
+  struct PathCounts {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> samples{0};
+  };
+  static std::array<PathCounts, kNumAllocationPaths> pathCounts_;
+};
+
+/*
+ * Counts the allocations made by the current thread during its lifetime,
+ * if sampled, adding them to the path's totals and to the given
+ * SwitchStats (if any).
+ */
+class AllocationScope {
+ public:
+  AllocationScope(AllocationPath path, SwitchStats* stats);
+  ~AllocationScope();
+
+ private:
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+
+  void finish();
+
+  AllocationPath path_;
+  SwitchStats* stats_;
+  bool sampled_{false};
+  uint64_t startAllocations_{0};
+  uint64_t startBytes_{0};
+};
+
+inline AllocationScope::AllocationScope(
+    AllocationPath path,
+    SwitchStats* stats)
+    : path_(path), stats_(stats) {
+  if (!AllocationProfiler::sampleScope()) {
+    return;
+  }
+  auto& counts = AllocationProfiler::threadCounts();
+  sampled_ = true;
+  startAllocations_ = counts.allocations;
+  startBytes_ = counts.bytes;
+  ++counts.activeScopes;
+}
+
+inline AllocationScope::~AllocationScope() {
+  if (sampled_) {
+    finish();
+  }
+}
+
+}} // facebook::fboss
@@ -9,10 +9,15 @@
  */
 #include "fboss/agent/ApplyThriftConfig.h"
 
+#include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/Optional.h>
 #include <folly/gen/Base.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/LacpTypes.h"
 #include "fboss/agent/LoadBalancerConfigApplier.h"
@@ -42,13 +47,21 @@
 #include "fboss/agent/state/VlanMap.h"
 
 #include <algorithm>
+#include <map>
 #include <boost/container/flat_set.hpp>
 #include <boost/container/flat_map.hpp>
+#include <chrono>
 #include <cmath>
 #include <folly/Range.h>
 #include <utility>
 #include <vector>
 
+DEFINE_bool(
+    incremental_config_apply,
+    true,
+    "Don't rebuild the switch state of the config sections which did not "
+    "change since the last config was applied");
+
 using boost::container::flat_map;
 using boost::container::flat_set;
 using folly::IPAddress;
@@ -60,12 +73,116 @@ using folly::StringPiece;
 using folly::CIDRNetwork;
 using std::make_shared;
 using std::shared_ptr;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
 
 namespace {
 
 const uint8_t kV6LinkLocalAddrMask{64};
 // Needed until CoPP is removed from code and put into config
 const int kAclStartPriority = 100000;
+// Room left between the priorities of consecutive acls, so that an acl can
+// be added between two others without moving either of them
+const int kAclPriorityGap = 16;
+
+/*
+ * Pick the priority of each acl, given in the order they should match in,
+ * from the priorities of those we already have.
+ *
+ * The hardware entries are keyed by priority, so an acl whose priority
+ * changes has to be reprogrammed. The longest run of existing acls that are
+ * still in order keep their priorities, and the rest are spread over the
+ * gaps between them. Adding, removing or moving one acl then only changes
+ * the priority of that one. Only when a gap runs out do all the acls get
+ * fresh, evenly spaced priorities.
+ */
+std::vector<int> allocateAclPriorities(
+    const std::vector<folly::Optional<int>>& oldPriorities) {
+  const auto numAcls = oldPriorities.size();
+  auto renumber = [&]() {
+    std::vector<int> priorities(numAcls);
+    for (size_t i = 0; i < numAcls; ++i) {
+      priorities[i] = kAclStartPriority + static_cast<int>(i) * kAclPriorityGap;
+    }
+    return priorities;
+  };
+
+  // Longest strictly increasing subsequence of the existing priorities.
+  // tails[k] is the acl ending the best such run of length k + 1 found so
+  // far, and prev links each acl to the one before it in its run.
+  std::vector<size_t> tails;
+  std::vector<ssize_t> prev(numAcls, -1);
+  for (size_t i = 0; i < numAcls; ++i) {
+    if (!oldPriorities[i]) {
+      continue;
+    }
+    auto it = std::lower_bound(
+        tails.begin(),
+        tails.end(),
+        *oldPriorities[i],
+        [&](size_t tail, int priority) {
+          return *oldPriorities[tail] < priority;
+        });
+    if (it != tails.begin()) {
+      prev[i] = *(it - 1);
+    }
+    if (it == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *it = i;
+    }
+  }
+  if (tails.empty()) {
+    return renumber();
+  }
+  std::vector<bool> keep(numAcls, false);
+  for (ssize_t i = tails.back(); i >= 0; i = prev[i]) {
+    keep[i] = true;
+  }
+
+  std::vector<int> priorities(numAcls);
+  size_t start = 0;
+  while (start < numAcls) {
+    auto end = start;
+    while (end < numAcls && !keep[end]) {
+      ++end;
+    }
+    // Place [start, end) between the kept acls either side of them
+    auto count = end - start;
+    if (count > 0 && start == 0) {
+      // Before the first kept acl, with as much room as we like
+      auto hi = *oldPriorities[end];
+      if (hi - static_cast<int64_t>(count) * kAclPriorityGap < 0) {
+        return renumber();
+      }
+      for (size_t i = 0; i < count; ++i) {
+        priorities[i] = hi - static_cast<int>(count - i) * kAclPriorityGap;
+      }
+    } else if (count > 0 && end == numAcls) {
+      // After the last kept acl
+      auto lo = priorities[start - 1];
+      for (size_t i = 0; i < count; ++i) {
+        priorities[start + i] = lo + static_cast<int>(i + 1) * kAclPriorityGap;
+      }
+    } else if (count > 0) {
+      auto lo = priorities[start - 1];
+      auto hi = *oldPriorities[end];
+      auto step = (hi - lo) / static_cast<int>(count + 1);
+      if (step == 0) {
+        return renumber();
+      }
+      for (size_t i = 0; i < count; ++i) {
+        priorities[start + i] = lo + static_cast<int>(i + 1) * step;
+      }
+    }
+    if (end < numAcls) {
+      priorities[end] = *oldPriorities[end];
+    }
+    start = end + 1;
+  }
+  return priorities;
+}
 
 } // anonymous namespace
 
@@ -83,11 +200,13 @@ class ThriftConfigApplier {
   ThriftConfigApplier(const std::shared_ptr<SwitchState>& orig,
                       const cfg::SwitchConfig* config,
                       const Platform* platform,
-                      const cfg::SwitchConfig* prevCfg)
+                      const cfg::SwitchConfig* prevCfg,
+                      const AppliedConfigCache* cache)
     : orig_(orig),
       cfg_(config),
       platform_(platform),
-      prevCfg_(prevCfg) {}
+      prevCfg_(prevCfg),
+      cache_(cache) {}
 
   std::shared_ptr<SwitchState> run();
 
@@ -96,6 +215,37 @@ class ThriftConfigApplier {
   ThriftConfigApplier(ThriftConfigApplier const &) = delete;
   ThriftConfigApplier& operator=(ThriftConfigApplier const &) = delete;
 
+  /*
+   * Run fn to apply one section of the config, and record how long it took.
+   * Unless rebuild is false, in which case the section is known not to have
+   * changed, and is skipped.
+   */
+  template <typename Fn>
+  void applySection(const char* name, bool rebuild, Fn fn) {
+    auto start = steady_clock::now();
+    if (rebuild) {
+      fn();
+    }
+    sectionTimes_.push_back(
+        {name, duration_cast<microseconds>(steady_clock::now() - start),
+         !rebuild});
+  }
+
+  /*
+   * Whether the node built from some config sections must be rebuilt. It
+   * need not be if the sections are the same as in the cached config, and
+   * the state still has the node we built from them.
+   */
+  template <typename Node>
+  bool mustRebuild(
+      const std::shared_ptr<Node>& cached,
+      const std::shared_ptr<Node>& current,
+      bool sameConfig) const {
+    return !cache_ || !FLAGS_incremental_config_apply || !cached ||
+        cached != current || !sameConfig;
+  }
+  void logSectionTimes() const;
+
   template<typename Node, typename NodeMap>
   bool updateMap(NodeMap* map,
                  std::shared_ptr<Node> origNode,
@@ -227,6 +377,14 @@ class ThriftConfigApplier {
   const cfg::SwitchConfig* cfg_{nullptr};
   const Platform* platform_{nullptr};
   const cfg::SwitchConfig* prevCfg_{nullptr};
+  const AppliedConfigCache* cache_{nullptr};
+
+  struct SectionTime {
+    const char* name;
+    microseconds time;
+    bool skipped;
+  };
+  std::vector<SectionTime> sectionTimes_;
 
   struct VlanIpInfo {
     VlanIpInfo(uint8_t mask, MacAddress mac, InterfaceID intf)
@@ -252,68 +410,102 @@ class ThriftConfigApplier {
 shared_ptr<SwitchState> ThriftConfigApplier::run() {
   new_ = orig_->clone();
   bool changed = false;
-
-  {
-    auto newControlPlane = updateControlPlane();
-    if (newControlPlane) {
-      new_->resetControlPlane(std::move(newControlPlane));
-      changed = true;
-    }
-  }
+  // What the cached nodes were built from
+  const auto& prev = cache_ ? cache_->config : *cfg_;
+
+  applySection(
+      "control_plane",
+      mustRebuild(
+          cache_ ? cache_->controlPlane : nullptr,
+          orig_->getControlPlane(),
+          cfg_->cpuQueues == prev.cpuQueues),
+      [&] {
+        auto newControlPlane = updateControlPlane();
+        if (newControlPlane) {
+          new_->resetControlPlane(std::move(newControlPlane));
+          changed = true;
+        }
+      });
 
   processVlanPorts();
 
-  {
+  applySection("ports", true, [&] {
     auto newPorts = updatePorts();
     if (newPorts) {
       new_->resetPorts(std::move(newPorts));
       changed = true;
     }
-  }
-
-  {
-    auto newAggPorts = updateAggregatePorts();
-    if (newAggPorts) {
-      new_->resetAggregatePorts(std::move(newAggPorts));
-      changed = true;
-    }
-  }
+  });
+
+  applySection(
+      "aggregate_ports",
+      mustRebuild(
+          cache_ ? cache_->aggregatePorts : nullptr,
+          orig_->getAggregatePorts(),
+          cfg_->aggregatePorts == prev.aggregatePorts &&
+              cfg_->__isset.lacp == prev.__isset.lacp &&
+              cfg_->lacp == prev.lacp),
+      [&] {
+        auto newAggPorts = updateAggregatePorts();
+        if (newAggPorts) {
+          new_->resetAggregatePorts(std::move(newAggPorts));
+          changed = true;
+        }
+      });
 
   // updateMirrors must be called after updatePorts, mirror needs ports!
-  {
-    auto newMirrors = updateMirrors();
-    if (newMirrors) {
-      new_->resetMirrors(std::move(newMirrors));
-      changed = true;
-    }
-  }
+  applySection(
+      "mirrors",
+      mustRebuild(
+          cache_ ? cache_->mirrors : nullptr,
+          orig_->getMirrors(),
+          cfg_->mirrors == prev.mirrors &&
+              new_->getPorts() == orig_->getPorts()),
+      [&] {
+        auto newMirrors = updateMirrors();
+        if (newMirrors) {
+          new_->resetMirrors(std::move(newMirrors));
+          changed = true;
+        }
+      });
 
   // updateAcls must be called after updateMirrors, acls may need mirror!
-  {
-    auto newAcls = updateAcls();
-    if (newAcls) {
-      new_->resetAcls(std::move(newAcls));
-      changed = true;
-    }
-  }
+  applySection(
+      "acls",
+      mustRebuild(
+          cache_ ? cache_->acls : nullptr,
+          orig_->getAcls(),
+          cfg_->acls == prev.acls &&
+              cfg_->trafficCounters == prev.trafficCounters &&
+              cfg_->__isset.dataPlaneTrafficPolicy ==
+                  prev.__isset.dataPlaneTrafficPolicy &&
+              cfg_->dataPlaneTrafficPolicy == prev.dataPlaneTrafficPolicy &&
+              new_->getMirrors() == orig_->getMirrors()),
+      [&] {
+        auto newAcls = updateAcls();
+        if (newAcls) {
+          new_->resetAcls(std::move(newAcls));
+          changed = true;
+        }
+      });
 
-  {
+  applySection("interfaces", true, [&] {
     auto newIntfs = updateInterfaces();
     if (newIntfs) {
       new_->resetIntfs(std::move(newIntfs));
       changed = true;
     }
-  }
+  });
 
   // Note: updateInterfaces() must be called before updateVlans(),
   // as updateInterfaces() populates the vlanInterfaces_ data structure.
-  {
+  applySection("vlans", true, [&] {
     auto newVlans = updateVlans();
     if (newVlans) {
       new_->resetVlans(std::move(newVlans));
       changed = true;
     }
-  }
+  });
 
   // Note: updateInterfaces() must be called before updateInterfaceRoutes(),
   // as updateInterfaces() populates the intfRouteTables_ data structure.
@@ -321,15 +513,15 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
   // RouteTable as this will take the RouteTable from orig_ and add Interface
   // routes. Calling this after other RouteTable updates will result in other
   // routes getting removed during updateInterfaceRoutes()
-  {
+  applySection("interface_routes", true, [&] {
     auto newTables = updateInterfaceRoutes();
     if (newTables) {
       new_->resetRouteTables(newTables);
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("static_routes", true, [&] {
     // Retrieve RouteTableMap from new_ as this will have
     // all the routes updated until now. Pass this to syncStaticRoutes
     // so that routes added until now would not be excluded.
@@ -339,7 +531,7 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
       new_->resetRouteTables(std::move(newerTables));
       changed = true;
     }
-  }
+  });
 
   auto newVlans = new_->getVlans();
   VlanID dfltVlan(cfg_->defaultVlan);
@@ -431,30 +623,65 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
   }
 
   // Add sFlow collectors
-  {
-    auto newCollectors = updateSflowCollectors();
-    if (newCollectors) {
-      new_->resetSflowCollectors(std::move(newCollectors));
-      changed = true;
-    }
-  }
-
-  {
-    LoadBalancerConfigApplier loadBalancerConfigApplier(
-        orig_->getLoadBalancers(), cfg_->get_loadBalancers(), platform_);
-    auto newLoadBalancers = loadBalancerConfigApplier.updateLoadBalancers();
-    if (newLoadBalancers) {
-      new_->resetLoadBalancers(std::move(newLoadBalancers));
-      changed = true;
-    }
-  }
+  applySection(
+      "sflow_collectors",
+      mustRebuild(
+          cache_ ? cache_->sflowCollectors : nullptr,
+          orig_->getSflowCollectors(),
+          cfg_->sFlowCollectors == prev.sFlowCollectors),
+      [&] {
+        auto newCollectors = updateSflowCollectors();
+        if (newCollectors) {
+          new_->resetSflowCollectors(std::move(newCollectors));
+          changed = true;
+        }
+      });
+
+  applySection(
+      "load_balancers",
+      mustRebuild(
+          cache_ ? cache_->loadBalancers : nullptr,
+          orig_->getLoadBalancers(),
+          cfg_->loadBalancers == prev.loadBalancers),
+      [&] {
+        LoadBalancerConfigApplier loadBalancerConfigApplier(
+            orig_->getLoadBalancers(), cfg_->get_loadBalancers(), platform_);
+        auto newLoadBalancers =
+            loadBalancerConfigApplier.updateLoadBalancers();
+        if (newLoadBalancers) {
+          new_->resetLoadBalancers(std::move(newLoadBalancers));
+          changed = true;
+        }
+      });
 
+  logSectionTimes();
   if (!changed) {
     return nullptr;
   }
   return new_;
 }
 
+void ThriftConfigApplier::logSectionTimes() const {
+  microseconds total(0);
+  std::string times;
+  for (const auto& section : sectionTimes_) {
+    total += section.time;
+    if (!times.empty()) {
+      times += ", ";
+    }
+    if (section.skipped) {
+      folly::toAppend(section.name, " unchanged", &times);
+      continue;
+    }
+    folly::toAppend(section.name, " ", section.time.count(), "us", &times);
+    tcData().addStatValue(
+        folly::to<std::string>("config_apply.", section.name, ".us"),
+        section.time.count(),
+        facebook::stats::AVG);
+  }
+  XLOG(INFO) << "Applied config in " << total.count() << "us: " << times;
+}
+
 void ThriftConfigApplier::processVlanPorts() {
   // Build the Port --> Vlan mappings
   //
@@ -993,19 +1220,17 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
   AclMap::NodeContainer newAcls;
   bool changed = false;
   int numExistingProcessed = 0;
-  int priority = kAclStartPriority;
 
-  // Start with the DROP acls, these should have highest priority
-  auto acls = folly::gen::from(cfg_->acls)
-    | folly::gen::filter([](const cfg::AclEntry& entry) {
-          return entry.actionType == cfg::AclActionType::DENY;
-      })
-    | folly::gen::map([&](const cfg::AclEntry& entry) {
-          auto acl = updateAcl(entry, priority++, &numExistingProcessed,
-            &changed);
-          return std::make_pair(acl->getID(), acl);
-      })
-    | folly::gen::appendTo(newAcls);
+  // The acls in the order they match in, along with the action their traffic
+  // policy gives them. Start with the DROP acls, these should have highest
+  // priority
+  std::vector<std::pair<const cfg::AclEntry*, folly::Optional<MatchAction>>>
+      orderedAcls;
+  for (const auto& entry : cfg_->acls) {
+    if (entry.actionType == cfg::AclActionType::DENY) {
+      orderedAcls.emplace_back(&entry, folly::none);
+    }
+  }
 
   // Let's get a map of acls to name so we don't have to search the acl list
   // for every new use
@@ -1025,9 +1250,7 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
 
   // Generates new acls from template
   auto addToAcls = [&] (const cfg::TrafficPolicyConfig& policy,
-                        bool isCoppAcl=false)
-      -> const std::vector<std::pair<std::string, std::shared_ptr<AclEntry>>> {
-    std::vector<std::pair<std::string, std::shared_ptr<AclEntry>>> entries;
+                        bool isCoppAcl=false) {
     for (const auto& mta : policy.matchToAction) {
       auto a = aclByName.find(mta.matcher);
       if (a == aclByName.end()) {
@@ -1035,10 +1258,10 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
             " found.");
       }
 
-      auto aclCfg = *(a->second);
+      auto aclCfg = a->second;
 
       // We've already added any DENY acls
-      if (aclCfg.actionType == cfg::AclActionType::DENY) {
+      if (aclCfg->actionType == cfg::AclActionType::DENY) {
         continue;
       }
 
@@ -1067,32 +1290,50 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
       if (mta.action.__isset.egressMirror) {
         matchAction.setEgressMirror(mta.action.egressMirror);
       }
-
-      auto acl = updateAcl(aclCfg, priority++, &numExistingProcessed,
-        &changed, &matchAction);
-
-      if (acl->getAclAction().hasValue()) {
-        const auto& inMirror = acl->getAclAction().value().getIngressMirror();
-        const auto& egMirror = acl->getAclAction().value().getIngressMirror();
-        if (inMirror.hasValue() &&
-            !new_->getMirrors()->getMirrorIf(inMirror.value())) {
-          throw FbossError("Mirror ", inMirror.value(), " is undefined");
-        }
-        if (egMirror.hasValue() &&
-            !new_->getMirrors()->getMirrorIf(egMirror.value())) {
-          throw FbossError("Mirror ", egMirror.value(), " is undefined");
-        }
-      }
-      entries.push_back(std::make_pair(acl->getID(), acl));
+      orderedAcls.emplace_back(aclCfg, std::move(matchAction));
     }
-    return entries;
   };
 
+  // Add controlPlane traffic acls, their queue actions go to the CPU
+  if (cfg_->__isset.cpuTrafficPolicy &&
+      cfg_->cpuTrafficPolicy.__isset.trafficPolicy) {
+    addToAcls(cfg_->cpuTrafficPolicy.trafficPolicy, true);
+  }
+
   // Add dataPlane traffic acls
   if (cfg_->__isset.dataPlaneTrafficPolicy) {
-    folly::gen::from(addToAcls(cfg_->dataPlaneTrafficPolicy)) |
-        folly::gen::appendTo(newAcls);
+    addToAcls(cfg_->dataPlaneTrafficPolicy);
+  }
+
+  std::vector<folly::Optional<int>> oldPriorities;
+  oldPriorities.reserve(orderedAcls.size());
+  for (const auto& entry : orderedAcls) {
+    auto origAcl = orig_->getAcls()->getEntryIf(entry.first->name);
+    oldPriorities.push_back(
+        origAcl ? folly::Optional<int>(origAcl->getPriority()) : folly::none);
   }
+  auto priorities = allocateAclPriorities(oldPriorities);
+
+  for (size_t i = 0; i < orderedAcls.size(); ++i) {
+    const auto& entry = orderedAcls[i];
+    auto acl = updateAcl(*entry.first, priorities[i], &numExistingProcessed,
+      &changed, entry.second.get_pointer());
+
+    if (acl->getAclAction().hasValue()) {
+      const auto& inMirror = acl->getAclAction().value().getIngressMirror();
+      const auto& egMirror = acl->getAclAction().value().getIngressMirror();
+      if (inMirror.hasValue() &&
+          !new_->getMirrors()->getMirrorIf(inMirror.value())) {
+        throw FbossError("Mirror ", inMirror.value(), " is undefined");
+      }
+      if (egMirror.hasValue() &&
+          !new_->getMirrors()->getMirrorIf(egMirror.value())) {
+        throw FbossError("Mirror ", egMirror.value(), " is undefined");
+      }
+    }
+    newAcls.emplace(acl->getID(), acl);
+  }
+
   if (numExistingProcessed != orig_->getAcls()->size()) {
     // Some existing ACLs were removed.
     changed = true;
@@ -1415,12 +1656,17 @@ shared_ptr<RouteTableMap> ThriftConfigApplier::updateInterfaceRoutes() {
  * existing static routes in SwitchState and "reconcile" with that in
  * config.  I.e., add, delete, modify, or leave unchanged, as necessary.
  *
- * The second approach, the one we adopt here, not very intuitive but a lot
- * cleaner to code, is to simply delete all static routes in current state,
- * and to add back static routes from config file.  This works because the
- * "delete" in this step does not take immediate effect.  It is only the
- * state delta, after all processing is done, that is sent to the hardware
- * switch.
+ * The second approach is to simply delete all static routes in current
+ * state, and to add back static routes from config file.  This works
+ * because the "delete" in this step does not take immediate effect.  It is
+ * only the state delta, after all processing is done, that is sent to the
+ * hardware switch.  But it touches every static route on every reload,
+ * which adds up on boxes with thousands of them.
+ *
+ * We used to do the second, and now do the first through
+ * RouteUpdater::syncRoutesForClient(), which has the same result but merges
+ * the configured routes with those in the state and only changes the ones
+ * that differ.  So a reload leaves the unchanged static routes alone.
  *
  * As a side note, there is a third (incorrect) approach that was tried, but
  * does not work.  The old approach was to compute the delta between old and
@@ -1438,28 +1684,33 @@ std::shared_ptr<RouteTableMap> ThriftConfigApplier::syncStaticRoutes(
   RouteUpdater updater(routes);
   auto staticClientId = StdClientIds2ClientID(StdClientIds::STATIC_ROUTE);
   auto staticAdminDistance = AdminDistance::STATIC_ROUTE;
-  updater.removeAllRoutesForClient(RouterID(0), staticClientId);
+  // The static routes of each router, starting with the default one so that
+  // its routes go away when there are none in the config
+  std::map<RouterID, std::vector<RouteUpdater::ClientRoute>> staticRoutes;
+  staticRoutes[RouterID(0)];
+  auto addStaticRoute = [&](int32_t routerID,
+                            const std::string& network,
+                            RouteNextHopEntry entry) {
+    auto prefix = folly::IPAddress::createNetwork(network);
+    staticRoutes[RouterID(routerID)].push_back(
+        {prefix.first, prefix.second, std::move(entry)});
+  };
   if (cfg_->__isset.staticRoutesToNull) {
     for (const auto& route : cfg_->staticRoutesToNull) {
-      auto prefix = folly::IPAddress::createNetwork(route.prefix);
-      updater.addRoute(RouterID(route.routerID), prefix.first, prefix.second,
-                       staticClientId,
-                       RouteNextHopEntry(RouteForwardAction::DROP,
-                                         staticAdminDistance));
+      addStaticRoute(route.routerID, route.prefix,
+                     RouteNextHopEntry(RouteForwardAction::DROP,
+                                       staticAdminDistance));
     }
   }
   if (cfg_->__isset.staticRoutesToCPU) {
     for (const auto& route : cfg_->staticRoutesToCPU) {
-      auto prefix = folly::IPAddress::createNetwork(route.prefix);
-      updater.addRoute(RouterID(route.routerID), prefix.first, prefix.second,
-                       staticClientId,
-                       RouteNextHopEntry(RouteForwardAction::TO_CPU,
-                                         staticAdminDistance));
+      addStaticRoute(route.routerID, route.prefix,
+                     RouteNextHopEntry(RouteForwardAction::TO_CPU,
+                                       staticAdminDistance));
     }
   }
   if (cfg_->__isset.staticRoutesWithNhops) {
     for (const auto& route : cfg_->staticRoutesWithNhops) {
-      auto prefix = folly::IPAddress::createNetwork(route.prefix);
       RouteNextHopSet nhops;
       // NOTE: Static routes use the default UCMP weight so that they can be
       // compatible with UCMP, i.e., so that we can do ucmp where the next
@@ -1471,11 +1722,15 @@ std::shared_ptr<RouteTableMap> ThriftConfigApplier::syncStaticRoutes(
         nhops.emplace(UnresolvedNextHop(folly::IPAddress(nhopStr),
                                         UCMP_DEFAULT_WEIGHT));
       }
-      updater.addRoute(RouterID(route.routerID), prefix.first, prefix.second,
-                       staticClientId, RouteNextHopEntry(std::move(nhops),
-                                                         staticAdminDistance));
+      addStaticRoute(route.routerID, route.prefix,
+                     RouteNextHopEntry(std::move(nhops),
+                                       staticAdminDistance));
     }
   }
+  for (auto& ridAndRoutes : staticRoutes) {
+    updater.syncRoutesForClient(
+        ridAndRoutes.first, staticClientId, std::move(ridAndRoutes.second));
+  }
   return updater.updateDone();
 }
 
@@ -1851,10 +2106,46 @@ shared_ptr<SwitchState> applyThriftConfig(
     const shared_ptr<SwitchState>& state,
     const cfg::SwitchConfig* config,
     const Platform* platform,
-    const cfg::SwitchConfig* prevConfig) {
+    const cfg::SwitchConfig* prevConfig,
+    AppliedConfigCache* cache) {
   cfg::SwitchConfig emptyConfig;
-  return ThriftConfigApplier(state, config, platform,
-      prevConfig ? prevConfig : &emptyConfig).run();
+  auto newState = ThriftConfigApplier(state, config, platform,
+      prevConfig ? prevConfig : &emptyConfig, cache).run();
+  if (cache) {
+    // The nodes we built, or kept, for each section
+    const auto& applied = newState ? newState : state;
+    cache->config = *config;
+    cache->controlPlane = applied->getControlPlane();
+    cache->aggregatePorts = applied->getAggregatePorts();
+    cache->mirrors = applied->getMirrors();
+    cache->acls = applied->getAcls();
+    cache->sflowCollectors = applied->getSflowCollectors();
+    cache->loadBalancers = applied->getLoadBalancers();
+  }
+  return newState;
+}
+
+cfg::SwitchConfig reachabilityConfig(const cfg::SwitchConfig& config) {
+  auto reduced = config;
+  reduced.acls.clear();
+  reduced.__isset.globalEgressTrafficPolicy_DEPRECATED = false;
+  reduced.globalEgressTrafficPolicy_DEPRECATED = cfg::TrafficPolicyConfig();
+  reduced.__isset.dataPlaneTrafficPolicy = false;
+  reduced.dataPlaneTrafficPolicy = cfg::TrafficPolicyConfig();
+  // Keep the CPU queue mapping, only the ACLs go
+  reduced.cpuTrafficPolicy.__isset.trafficPolicy = false;
+  reduced.cpuTrafficPolicy.trafficPolicy = cfg::TrafficPolicyConfig();
+  reduced.mirrors.clear();
+  reduced.sFlowCollectors.clear();
+  for (auto& port : reduced.ports) {
+    port.__isset.ingressMirror = false;
+    port.ingressMirror.clear();
+    port.__isset.egressMirror = false;
+    port.egressMirror.clear();
+    port.sFlowIngressRate = 0;
+    port.sFlowEgressRate = 0;
+  }
+  return reduced;
 }
 
 std::pair<std::shared_ptr<SwitchState>, std::string> applyThriftConfigFile(
@@ -9,28 +9,62 @@
  */
 #pragma once
 
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
+
 #include <folly/Range.h>
 #include <memory>
 
 namespace facebook { namespace fboss {
 
-namespace cfg {
-class SwitchConfig;
-}
-
+class AclMap;
+class AggregatePortMap;
+class ControlPlane;
+class LoadBalancerMap;
+class MirrorMap;
 class Platform;
+class SflowCollectorMap;
 class SwitchState;
 
+/*
+ * The last config applied by applyThriftConfig(), and the SwitchState nodes
+ * it built for the sections of the config which don't depend on others.
+ *
+ * When given the cache, applyThriftConfig() keeps such a node as it is if
+ * its config sections didn't change and the state still has that very
+ * node, i.e. nothing else modified it since. Otherwise, or for the other
+ * sections, the nodes are rebuilt from the config as usual.
+ */
+struct AppliedConfigCache {
+  cfg::SwitchConfig config;
+  std::shared_ptr<ControlPlane> controlPlane;
+  std::shared_ptr<AggregatePortMap> aggregatePorts;
+  std::shared_ptr<MirrorMap> mirrors;
+  std::shared_ptr<AclMap> acls;
+  std::shared_ptr<SflowCollectorMap> sflowCollectors;
+  std::shared_ptr<LoadBalancerMap> loadBalancers;
+};
+
 /*
  * Apply a thrift config structure to a SwitchState object.
  *
  * Returns a new SwitchState object with the resulting state, or null if
  * the config file results in no changes.
+ *
+ * If cache is set, sections unchanged since the config it holds are not
+ * rebuilt, and it is updated with this config.
  */
 std::shared_ptr<SwitchState> applyThriftConfig(
   const std::shared_ptr<SwitchState>& state,
   const cfg::SwitchConfig* config,
   const Platform* platform,
-  const cfg::SwitchConfig* prevConfig = nullptr);
+  const cfg::SwitchConfig* prevConfig = nullptr,
+  AppliedConfigCache* cache = nullptr);
+
+/*
+ * The part of config needed to forward and reach the control plane: config
+ * without the ACLs and traffic policies, mirrors and sFlow. Applied on cold
+ * boot ahead of the full config, so routing clients can connect sooner.
+ */
+cfg::SwitchConfig reachabilityConfig(const cfg::SwitchConfig& config);
 
 }} // facebook::fboss
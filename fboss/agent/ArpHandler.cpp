@@ -15,6 +15,7 @@
 #include <folly/logging/xlog.h>
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/HwSwitch.h"
+#include "fboss/agent/LocalAddressCache.h"
 #include "fboss/agent/NeighborUpdater.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/RxPacket.h"
@@ -115,7 +116,8 @@ void ArpHandler::handlePacket(
 
   auto updater = sw_->getNeighborUpdater();
   // Check to see if this IP address is in our ARP response table.
-  auto entry = vlan->getArpResponseTable()->getEntry(targetIP);
+  auto localAddrs = sw_->getLocalAddressCache()->get(state);
+  auto entry = localAddrs->getArpResponse(vlan->getID(), targetIP);
   if (!entry) {
     // The target IP does not refer to us.
     XLOG(DBG5) << "ignoring ARP message for " << targetIP.str() << " on vlan "
@@ -150,7 +152,7 @@ void ArpHandler::handlePacket(
   // Send a reply if this is an ARP request.
   if (op == ARP_OP_REQUEST) {
     sendArpReply(pkt->getSrcVlan(), pkt->getSrcPort(),
-                 entry.value().mac, targetIP,
+                 entry->mac, targetIP,
                  senderMac, senderIP);
   }
 
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/AsyncStateObserverThread.h"
+
+#include "fboss/agent/StateObserver.h"
+#include "fboss/agent/Utils.h"
+#include "fboss/agent/state/StateDelta.h"
+
+#include <folly/ExceptionString.h>
+#include <folly/logging/xlog.h>
+
+#include <chrono>
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace facebook { namespace fboss {
+
+AsyncStateObserverThread::AsyncStateObserverThread(
+    StateObserver* observer,
+    const std::string& name)
+    : observer_(observer),
+      name_(name),
+      backlogKey_("state_observer." + name + ".backlog"),
+      lagKey_("state_observer." + name + ".lag.ms") {
+  thread_ = std::make_unique<std::thread>([this]() {
+    initThread(name_);
+    lag_ = std::make_unique<stats::ThreadCachedServiceData::TLTimeseries>(
+        tcData().getThreadStats(), lagKey_, stats::AVG);
+    evb_.loopForever();
+    lag_.reset();
+  });
+}
+
+AsyncStateObserverThread::~AsyncStateObserverThread() {
+  // Terminate from the thread itself, so that the updates already queued
+  // still get delivered
+  evb_.runInEventBaseThread([this] { evb_.terminateLoopSoon(); });
+  thread_->join();
+  tcData().clearCounter(backlogKey_);
+}
+
+void AsyncStateObserverThread::notify(
+    std::shared_ptr<const StateDelta> delta) {
+  auto queued = steady_clock::now();
+  tcData().setCounter(backlogKey_, ++backlog_);
+  evb_.runInEventBaseThread([this, delta, queued]() {
+    auto lag = duration_cast<milliseconds>(steady_clock::now() - queued);
+    lag_->addValue(lag.count());
+    try {
+      observer_->stateUpdated(*delta);
+    } catch (const std::exception& ex) {
+      XLOG(FATAL) << "error notifying " << name_
+                  << " of update: " << folly::exceptionStr(ex);
+    }
+    tcData().setCounter(backlogKey_, --backlog_);
+  });
+}
+
+void AsyncStateObserverThread::waitForIdle() {
+  // Updates are delivered in order, so once this runs all the earlier ones
+  // have been
+  evb_.runImmediatelyOrRunInEventBaseThreadAndWait([] {});
+}
+
+}} // facebook::fboss
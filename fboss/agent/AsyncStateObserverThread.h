@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "common/stats/ThreadCachedServiceData.h"
+
+#include <folly/io/async/EventBase.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+class StateObserver;
+
+/*
+ * The thread a StateObserver registered to be notified off the update thread
+ * is notified from.
+ *
+ * The update thread hands every StateDelta to notify() and moves on, and the
+ * observer sees them in order from this thread, so a slow observer only
+ * delays itself rather than the next state update.
+ *
+ * How far behind the observer is gets exported as
+ * state_observer.<name>.backlog (updates queued) and
+ * state_observer.<name>.lag.ms (time updates spent queued).
+ */
+class AsyncStateObserverThread {
+ public:
+  AsyncStateObserverThread(StateObserver* observer, const std::string& name);
+  // Notifies the observer of whatever is still queued before returning
+  ~AsyncStateObserverThread();
+
+  /*
+   * Queue delta for the observer. Called from the update thread.
+   */
+  void notify(std::shared_ptr<const StateDelta> delta);
+
+  /*
+   * Wait until the observer has been notified of every delta queued so far.
+   */
+  void waitForIdle();
+
+  int getBacklog() const {
+    return backlog_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  AsyncStateObserverThread(AsyncStateObserverThread const &) = delete;
+  AsyncStateObserverThread& operator=(
+      AsyncStateObserverThread const &) = delete;
+
+  StateObserver* observer_;
+  const std::string name_;
+  const std::string backlogKey_;
+  const std::string lagKey_;
+  // Resolved once on the thread, rather than looking lagKey_ up per update
+  std::unique_ptr<stats::ThreadCachedServiceData::TLTimeseries> lag_;
+  std::atomic<int> backlog_{0};
+  folly::EventBase evb_;
+  std::unique_ptr<std::thread> thread_;
+};
+
+}} // facebook::fboss
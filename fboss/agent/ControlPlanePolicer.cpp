@@ -0,0 +1,217 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ControlPlanePolicer.h"
+
+#include "fboss/agent/ArpHandler.h"
+#include "fboss/agent/IPv6Handler.h"
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/packet/ICMPHdr.h"
+#include "fboss/agent/packet/IPProto.h"
+
+#include <folly/hash/Hash.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include <gflags/gflags.h>
+
+DEFINE_int32(cpu_policer_arp_pps, 0,
+             "ARP packets per second the agent handles from a single source "
+             "(port, MAC and IP), 0 to not police ARP");
+DEFINE_int32(cpu_policer_arp_burst, 100,
+             "ARP packets a single source may send at once");
+DEFINE_int32(cpu_policer_ndp_pps, 0,
+             "NDP packets per second the agent handles from a single source "
+             "(port, MAC and IP), 0 to not police NDP");
+DEFINE_int32(cpu_policer_ndp_burst, 100,
+             "NDP packets a single source may send at once");
+DEFINE_int32(cpu_policer_icmp_error_pps, 100,
+             "ICMP errors per second the agent generates for the packets of "
+             "a single source (port, MAC and IP), 0 to not limit them");
+DEFINE_int32(cpu_policer_icmp_error_burst, 100,
+             "ICMP errors the agent may generate at once for a single source");
+DEFINE_int32(cpu_policer_table_size, 4096,
+             "Number of sources the software control plane policer tracks");
+
+using folly::MacAddress;
+using folly::io::Cursor;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// Offset of the sender IP in an ARP packet
+constexpr size_t kArpSenderIpOffset = 14;
+// Offsets in an IPv6 packet
+constexpr size_t kIPv6NextHeaderOffset = 6;
+constexpr size_t kIPv6SrcOffset = 8;
+constexpr size_t kIPv6HeaderSize = 40;
+
+bool isNdp(uint8_t icmpType) {
+  return icmpType >= static_cast<uint8_t>(
+                         ICMPv6Type::ICMPV6_TYPE_NDP_ROUTER_SOLICITATION) &&
+      icmpType <= static_cast<uint8_t>(
+                      ICMPv6Type::ICMPV6_TYPE_NDP_REDIRECT_MESSAGE);
+}
+
+size_t roundUpToPowerOf2(size_t n) {
+  size_t rounded = 1;
+  while (rounded < n) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+} // unnamed namespace
+
+constexpr size_t ControlPlanePolicer::kNumClasses;
+constexpr size_t ControlPlanePolicer::kWays;
+
+ControlPlanePolicer::ControlPlanePolicer(
+    const std::array<Params, kNumClasses>& params,
+    size_t tableSize)
+    : params_(params),
+      numSets_(roundUpToPowerOf2(std::max<size_t>(tableSize / kWays, 1))),
+      sets_(std::make_unique<Set[]>(numSets_)) {
+  for (auto& classParams : params_) {
+    classParams.burst = std::max<uint32_t>(classParams.burst, 1);
+  }
+}
+
+std::unique_ptr<ControlPlanePolicer> ControlPlanePolicer::createFromFlags() {
+  std::array<Params, kNumClasses> params;
+  auto& arp = params[static_cast<size_t>(Class::ARP)];
+  arp.rate = std::max(FLAGS_cpu_policer_arp_pps, 0);
+  arp.burst = std::max(FLAGS_cpu_policer_arp_burst, 1);
+  auto& ndp = params[static_cast<size_t>(Class::NDP)];
+  ndp.rate = std::max(FLAGS_cpu_policer_ndp_pps, 0);
+  ndp.burst = std::max(FLAGS_cpu_policer_ndp_burst, 1);
+  auto& icmpError = params[static_cast<size_t>(Class::ICMP_ERROR)];
+  icmpError.rate = std::max(FLAGS_cpu_policer_icmp_error_pps, 0);
+  icmpError.burst = std::max(FLAGS_cpu_policer_icmp_error_burst, 1);
+  if (arp.rate == 0 && ndp.rate == 0 && icmpError.rate == 0) {
+    return nullptr;
+  }
+  return std::make_unique<ControlPlanePolicer>(
+      params, std::max(FLAGS_cpu_policer_table_size, 1));
+}
+
+const char* ControlPlanePolicer::className(Class cls) {
+  switch (cls) {
+    case Class::ARP:
+      return "arp";
+    case Class::NDP:
+      return "ndp";
+    case Class::ICMP_ERROR:
+      return "icmp_error";
+  }
+  return "unknown";
+}
+
+bool ControlPlanePolicer::admit(
+    const RxPacket& pkt,
+    uint16_t ethertype,
+    MacAddress srcMac,
+    Cursor c,
+    Class* droppedClass) {
+  Class cls;
+  uint64_t srcIpHash;
+  if (ethertype == ArpHandler::ETHERTYPE_ARP) {
+    if (!c.canAdvance(kArpSenderIpOffset + 4)) {
+      return true;
+    }
+    c.skip(kArpSenderIpOffset);
+    cls = Class::ARP;
+    srcIpHash = c.readBE<uint32_t>();
+  } else if (ethertype == IPv6Handler::ETHERTYPE_IPV6) {
+    if (!c.canAdvance(kIPv6HeaderSize + 1)) {
+      return true;
+    }
+    c.skip(kIPv6NextHeaderOffset);
+    auto nextHeader = c.read<uint8_t>();
+    if (nextHeader != static_cast<uint8_t>(IP_PROTO::IP_PROTO_IPV6_ICMP)) {
+      return true;
+    }
+    c.skip(kIPv6SrcOffset - kIPv6NextHeaderOffset - 1);
+    auto srcHigh = c.readBE<uint64_t>();
+    auto srcLow = c.readBE<uint64_t>();
+    c.skip(kIPv6HeaderSize - kIPv6SrcOffset - 16);
+    if (!isNdp(c.read<uint8_t>())) {
+      return true;
+    }
+    cls = Class::NDP;
+    srcIpHash = folly::hash::hash_128_to_64(srcHigh, srcLow);
+  } else {
+    return true;
+  }
+
+  if (admit(cls, pkt.getSrcPort(), srcMac, srcIpHash, Clock::now())) {
+    return true;
+  }
+  if (droppedClass) {
+    *droppedClass = cls;
+  }
+  return false;
+}
+
+bool ControlPlanePolicer::admit(
+    Class cls,
+    PortID port,
+    MacAddress srcMac,
+    uint64_t srcIpHash,
+    Clock::time_point now) {
+  const auto& params = params_[static_cast<size_t>(cls)];
+  if (params.rate == 0) {
+    return true;
+  }
+
+  auto source = (static_cast<uint64_t>(static_cast<uint16_t>(port)) << 8) |
+      static_cast<uint8_t>(cls);
+  auto key = folly::hash::hash_128_to_64(
+      folly::hash::hash_128_to_64(srcMac.u64HBO(), source), srcIpHash);
+  // 0 marks unused entries
+  key |= 1;
+  auto nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   now.time_since_epoch())
+                   .count();
+
+  auto& set = sets_[(key >> 1) & (numSets_ - 1)];
+  std::lock_guard<folly::SpinLock> g(set.lock);
+  Entry* entry = nullptr;
+  Entry* oldest = &set.entries[0];
+  for (auto& candidate : set.entries) {
+    if (candidate.key == key) {
+      entry = &candidate;
+      break;
+    }
+    if (candidate.key == 0 || candidate.lastSeenNs < oldest->lastSeenNs) {
+      oldest = &candidate;
+    }
+  }
+  if (entry) {
+    auto elapsedNs = std::max<int64_t>(nowNs - entry->lastSeenNs, 0);
+    entry->tokens = std::min<double>(
+        params.burst, entry->tokens + elapsedNs * 1e-9 * params.rate);
+  } else {
+    entry = oldest;
+    entry->key = key;
+    entry->tokens = params.burst;
+  }
+  entry->lastSeenNs = nowNs;
+
+  if (entry->tokens >= 1) {
+    entry->tokens -= 1;
+    return true;
+  }
+  drops_[static_cast<size_t>(cls)].fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+}} // facebook::fboss
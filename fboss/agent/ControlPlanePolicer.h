@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/MacAddress.h>
+#include <folly/Optional.h>
+#include <folly/SpinLock.h>
+#include <folly/io/Cursor.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace facebook { namespace fboss {
+
+class RxPacket;
+
+// The trapped packets ControlPlanePolicer rate limits
+enum class CpuPolicerClass : uint8_t {
+  ARP,
+  NDP,
+  // Not trapped packets, but the ICMP errors generated in response to them
+  ICMP_ERROR,
+};
+
+/*
+ * Software rate limiting of the trapped packets that cost the agent the
+ * most to handle, applied in SwSwitch::handlePacket() before the packets
+ * are dispatched to their handlers.
+ *
+ * The CPU queues programmed in hardware bound the total rate of trapped
+ * packets, but a single misbehaving host or a scan can still use all of it
+ * and keep the RX thread busy with ARP and NDP.  So each source, identified
+ * by ingress port, source MAC, source IP and packet class, gets its own
+ * token bucket: it may send up to burst packets at once, and rate packets
+ * per second after that.
+ *
+ * The buckets live in a fixed size, 4-way set associative hash table.  A
+ * source that doesn't fit evicts the least recently seen source of its set,
+ * which then starts over with a full bucket.  This bounds the memory used
+ * whatever the number of sources, at the cost of letting through a little
+ * more from the evicted sources when there are too many of them.
+ *
+ * Each set has its own spin lock, so the policer can be shared by all the
+ * threads receiving packets.
+ *
+ * The same buckets also bound the ICMP errors (TTL exceeded, packet too
+ * big) the agent generates for the packets of each source, so a traceroute
+ * flood or a routing loop doesn't keep the RX thread busy building them.
+ */
+class ControlPlanePolicer {
+ public:
+  using Class = CpuPolicerClass;
+  static constexpr size_t kNumClasses = 3;
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Params {
+    // Packets per second allowed for a single source, 0 to not police
+    uint32_t rate{0};
+    // Packets a source may send at once, at least 1
+    uint32_t burst{1};
+  };
+
+  /*
+   * tableSize is the number of sources tracked at once, rounded up to a
+   * power of 2.
+   */
+  ControlPlanePolicer(
+      const std::array<Params, kNumClasses>& params,
+      size_t tableSize);
+
+  /*
+   * The policer configured by the --cpu_policer_* flags, or null if they
+   * police nothing.
+   */
+  static std::unique_ptr<ControlPlanePolicer> createFromFlags();
+
+  static const char* className(Class cls);
+
+  /*
+   * Whether a trapped packet may be handled. c must be at the start of the
+   * payload following the ethernet header. Packets of other classes, and
+   * packets too short to tell, are always admitted.
+   */
+  bool admit(
+      const RxPacket& pkt,
+      uint16_t ethertype,
+      folly::MacAddress srcMac,
+      folly::io::Cursor c,
+      Class* droppedClass = nullptr);
+
+  /*
+   * Take a token from the bucket of one source, if there is one.
+   * srcIpHash is any hash of the source IP address.
+   */
+  bool admit(
+      Class cls,
+      PortID port,
+      folly::MacAddress srcMac,
+      uint64_t srcIpHash,
+      Clock::time_point now);
+
+  /*
+   * Whether an ICMP error may be sent in response to a packet from srcIp,
+   * received from srcMac on port.
+   */
+  bool admitIcmpError(
+      PortID port,
+      folly::MacAddress srcMac,
+      const folly::IPAddress& srcIp) {
+    return admit(Class::ICMP_ERROR, port, srcMac, srcIp.hash(), Clock::now());
+  }
+
+  uint64_t getDrops(Class cls) const {
+    return drops_[static_cast<size_t>(cls)].load(std::memory_order_relaxed);
+  }
+
+  size_t tableSize() const {
+    return numSets_ * kWays;
+  }
+
+ private:
+  static constexpr size_t kWays = 4;
+
+  struct Entry {
+    // 0 for unused entries
+    uint64_t key{0};
+    int64_t lastSeenNs{0};
+    double tokens{0};
+  };
+
+  struct Set {
+    folly::SpinLock lock;
+    std::array<Entry, kWays> entries;
+  };
+
+  std::array<Params, kNumClasses> params_;
+  size_t numSets_;
+  std::unique_ptr<Set[]> sets_;
+  std::array<std::atomic<uint64_t>, kNumClasses> drops_{};
+};
+
+}} // facebook::fboss
@@ -0,0 +1,407 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/CpuAclFilter.h"
+
+#include "common/stats/ThreadCachedServiceData.h"
+#include "fboss/agent/IPv4Handler.h"
+#include "fboss/agent/IPv6Handler.h"
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/packet/IPProto.h"
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+#include "fboss/agent/state/DeltaFunctions.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+
+using facebook::fboss::DeltaFunctions::isEmpty;
+using facebook::stats::tcData;
+using folly::io::Cursor;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+constexpr uint8_t kIPv6FragmentHeader = 44;
+constexpr uint16_t kIPv4MoreFragments = 0x2000;
+constexpr uint16_t kIPv4FragmentOffset = 0x1fff;
+constexpr uint32_t kIPv6FragmentOffset = 0xfff8;
+
+bool isProto(uint8_t proto, IP_PROTO expected) {
+  return proto == static_cast<uint8_t>(expected);
+}
+
+// Read what follows the IP header, for the protocols acls look into
+void parseL4(Cursor c, CpuAclClassifier::PacketFields* fields) {
+  if (fields->nonFirstFragment) {
+    // Only the first fragment has the L4 header
+    return;
+  }
+  if (isProto(fields->proto, IP_PROTO::IP_PROTO_TCP) ||
+      isProto(fields->proto, IP_PROTO::IP_PROTO_UDP)) {
+    fields->srcL4Port = c.readBE<uint16_t>();
+    fields->dstL4Port = c.readBE<uint16_t>();
+    fields->hasL4Ports = true;
+    if (isProto(fields->proto, IP_PROTO::IP_PROTO_TCP)) {
+      // Skip the sequence and ack numbers, and the data offset
+      c.skip(9);
+      fields->tcpFlags = c.read<uint8_t>();
+      fields->hasTcpFlags = true;
+    }
+  } else if (
+      isProto(fields->proto, IP_PROTO::IP_PROTO_ICMP) ||
+      isProto(fields->proto, IP_PROTO::IP_PROTO_IPV6_ICMP)) {
+    fields->icmpType = c.read<uint8_t>();
+    fields->icmpCode = c.read<uint8_t>();
+    fields->hasIcmp = true;
+  }
+}
+
+bool matchesFrag(cfg::IpFragMatch match, bool more, bool nonFirst) {
+  switch (match) {
+    case cfg::IpFragMatch::MATCH_NOT_FRAGMENTED:
+      return !more && !nonFirst;
+    case cfg::IpFragMatch::MATCH_FIRST_FRAGMENT:
+      return more && !nonFirst;
+    case cfg::IpFragMatch::MATCH_NOT_FRAGMENTED_OR_FIRST_FRAGMENT:
+      return !nonFirst;
+    case cfg::IpFragMatch::MATCH_NOT_FIRST_FRAGMENT:
+      return nonFirst;
+    case cfg::IpFragMatch::MATCH_ANY_FRAGMENT:
+      return more || nonFirst;
+  }
+  return false;
+}
+
+bool matchesIpType(cfg::IpType type, bool isV4, bool isV6) {
+  switch (type) {
+    case cfg::IpType::ANY:
+      return true;
+    case cfg::IpType::IP:
+      return isV4 || isV6;
+    case cfg::IpType::IP4:
+      return isV4;
+    case cfg::IpType::IP6:
+      return isV6;
+  }
+  return false;
+}
+
+bool matchesNetwork(
+    const folly::CIDRNetwork& network,
+    const folly::IPAddress& addr) {
+  return !addr.empty() && addr.family() == network.first.family() &&
+      addr.inSubnet(network.first, network.second);
+}
+
+} // unnamed namespace
+
+bool CpuAclClassifier::isControlPlaneAcl(const AclEntry& acl) {
+  if (acl.getActionType() == cfg::AclActionType::DENY) {
+    return true;
+  }
+  auto action = acl.getAclAction();
+  // SendToQueue's flag is set for the acls of the cpu traffic policy
+  return action && action->getSendToQueue() &&
+      action->getSendToQueue()->second;
+}
+
+CpuAclClassifier::CpuAclClassifier(
+    const std::shared_ptr<AclMap>& acls,
+    const CpuAclClassifier* previous) {
+  std::vector<std::shared_ptr<AclEntry>> sorted;
+  for (const auto& acl : *acls) {
+    if (!isControlPlaneAcl(*acl)) {
+      continue;
+    }
+    if (acl->getDstPort() || acl->getDstIpLocal()) {
+      // Trapped packets have no egress port, and we don't track which
+      // addresses the hardware considers local
+      XLOG(DBG2) << "Acl " << acl->getID()
+                 << " can't be checked for trapped packets";
+      continue;
+    }
+    sorted.push_back(acl);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a->getPriority() < b->getPriority();
+  });
+
+  rules_.reserve(sorted.size());
+  for (const auto& acl : sorted) {
+    Rule rule;
+    rule.name = acl->getID();
+    rule.hitsKey = acl->getID() + ".cpu_acl_hits";
+    rule.deny = acl->getActionType() == cfg::AclActionType::DENY;
+    if (!acl->getSrcIp().first.empty()) {
+      rule.fields |= kSrcIp;
+      rule.srcIp = acl->getSrcIp();
+    }
+    if (!acl->getDstIp().first.empty()) {
+      rule.fields |= kDstIp;
+      rule.dstIp = acl->getDstIp();
+    }
+    if (auto proto = acl->getProto()) {
+      rule.fields |= kProto;
+      rule.proto = *proto;
+    }
+    if (auto flags = acl->getTcpFlagsBitMap()) {
+      rule.fields |= kTcpFlags;
+      rule.tcpFlags = *flags;
+    }
+    if (auto port = acl->getSrcPort()) {
+      rule.fields |= kSrcPort;
+      rule.srcPort = PortID(*port);
+    }
+    auto toRange = [](const AclL4PortRange& range) {
+      Range r;
+      r.min = range.getMin();
+      r.max = range.getMax();
+      r.invert = range.getInvert();
+      return r;
+    };
+    if (auto range = acl->getSrcL4PortRange()) {
+      rule.fields |= kSrcL4PortRange;
+      rule.srcL4Ports = toRange(*range);
+    }
+    if (auto range = acl->getDstL4PortRange()) {
+      rule.fields |= kDstL4PortRange;
+      rule.dstL4Ports = toRange(*range);
+    }
+    if (auto range = acl->getPktLenRange()) {
+      rule.fields |= kPktLenRange;
+      rule.pktLen = toRange(*range);
+    }
+    if (auto frag = acl->getIpFrag()) {
+      rule.fields |= kIpFrag;
+      rule.ipFrag = *frag;
+    }
+    if (auto type = acl->getIcmpType()) {
+      rule.fields |= kIcmpType;
+      rule.icmpType = *type;
+    }
+    if (auto code = acl->getIcmpCode()) {
+      rule.fields |= kIcmpCode;
+      rule.icmpCode = *code;
+    }
+    if (auto dscp = acl->getDscp()) {
+      rule.fields |= kDscp;
+      rule.dscp = *dscp;
+    }
+    if (auto type = acl->getIpType()) {
+      rule.fields |= kIpType;
+      rule.ipType = *type;
+    }
+    if (auto ttl = acl->getTtl()) {
+      rule.fields |= kTtl;
+      rule.ttlValue = ttl->getValue();
+      rule.ttlMask = ttl->getMask();
+    }
+    if (auto mac = acl->getDstMac()) {
+      rule.fields |= kDstMac;
+      rule.dstMac = *mac;
+    }
+
+    uint32_t index = rules_.size();
+    if (rule.fields & kProto) {
+      buckets_[rule.proto].push_back(index);
+    } else {
+      for (auto& bucket : buckets_) {
+        bucket.push_back(index);
+      }
+    }
+    rules_.push_back(std::move(rule));
+  }
+
+  hits_ = std::make_unique<std::atomic<uint64_t>[]>(rules_.size());
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    hits_[i].store(
+        previous ? previous->getHits(rules_[i].name) : 0,
+        std::memory_order_relaxed);
+  }
+}
+
+CpuAclClassifier::PacketFields CpuAclClassifier::parse(
+    const RxPacket& pkt,
+    uint16_t ethertype,
+    folly::MacAddress dstMac,
+    Cursor c) {
+  PacketFields fields;
+  fields.srcPort = pkt.getSrcPort();
+  fields.dstMac = dstMac;
+  fields.length = pkt.getLength();
+
+  if (ethertype == IPv4Handler::ETHERTYPE_IPV4) {
+    auto start = c;
+    auto versionAndLength = c.read<uint8_t>();
+    fields.dscp = c.read<uint8_t>() >> 2;
+    c.skip(4);
+    auto frag = c.readBE<uint16_t>();
+    fields.ttl = c.read<uint8_t>();
+    fields.proto = c.read<uint8_t>();
+    c.skip(2);
+    std::array<uint8_t, 4> addr;
+    c.pull(addr.data(), addr.size());
+    fields.srcIp = folly::IPAddressV4::fromBinary(
+        folly::ByteRange(addr.data(), addr.size()));
+    c.pull(addr.data(), addr.size());
+    fields.dstIp = folly::IPAddressV4::fromBinary(
+        folly::ByteRange(addr.data(), addr.size()));
+    fields.isV4 = true;
+    fields.moreFragments = frag & kIPv4MoreFragments;
+    fields.nonFirstFragment = frag & kIPv4FragmentOffset;
+    start.skip((versionAndLength & 0xf) * 4);
+    parseL4(start, &fields);
+  } else if (ethertype == IPv6Handler::ETHERTYPE_IPV6) {
+    auto versionAndClass = c.readBE<uint32_t>();
+    fields.dscp = (versionAndClass >> 22) & 0x3f;
+    c.skip(2);
+    fields.proto = c.read<uint8_t>();
+    fields.ttl = c.read<uint8_t>();
+    std::array<uint8_t, 16> addr;
+    c.pull(addr.data(), addr.size());
+    fields.srcIp = folly::IPAddressV6::fromBinary(
+        folly::ByteRange(addr.data(), addr.size()));
+    c.pull(addr.data(), addr.size());
+    fields.dstIp = folly::IPAddressV6::fromBinary(
+        folly::ByteRange(addr.data(), addr.size()));
+    fields.isV6 = true;
+    if (fields.proto == kIPv6FragmentHeader) {
+      fields.proto = c.read<uint8_t>();
+      c.skip(1);
+      auto frag = c.readBE<uint16_t>();
+      c.skip(4);
+      fields.moreFragments = frag & 1;
+      fields.nonFirstFragment = frag & kIPv6FragmentOffset;
+    }
+    parseL4(c, &fields);
+  }
+  return fields;
+}
+
+bool CpuAclClassifier::Rule::matches(const PacketFields& pkt) const {
+  auto isIp = pkt.isV4 || pkt.isV6;
+  if ((fields & kSrcIp) && !matchesNetwork(srcIp, pkt.srcIp)) {
+    return false;
+  }
+  if ((fields & kDstIp) && !matchesNetwork(dstIp, pkt.dstIp)) {
+    return false;
+  }
+  if ((fields & kProto) && (!isIp || pkt.proto != proto)) {
+    return false;
+  }
+  // The acl matches packets with all of the given flags set
+  if ((fields & kTcpFlags) &&
+      (!pkt.hasTcpFlags || (pkt.tcpFlags & tcpFlags) != tcpFlags)) {
+    return false;
+  }
+  if ((fields & kSrcPort) && pkt.srcPort != srcPort) {
+    return false;
+  }
+  if ((fields & kSrcL4PortRange) &&
+      (!pkt.hasL4Ports || !srcL4Ports.matches(pkt.srcL4Port))) {
+    return false;
+  }
+  if ((fields & kDstL4PortRange) &&
+      (!pkt.hasL4Ports || !dstL4Ports.matches(pkt.dstL4Port))) {
+    return false;
+  }
+  if ((fields & kPktLenRange) && !pktLen.matches(pkt.length)) {
+    return false;
+  }
+  if ((fields & kIpFrag) &&
+      (!isIp ||
+       !matchesFrag(ipFrag, pkt.moreFragments, pkt.nonFirstFragment))) {
+    return false;
+  }
+  if ((fields & kIcmpType) && (!pkt.hasIcmp || pkt.icmpType != icmpType)) {
+    return false;
+  }
+  if ((fields & kIcmpCode) && (!pkt.hasIcmp || pkt.icmpCode != icmpCode)) {
+    return false;
+  }
+  if ((fields & kDscp) && (!isIp || pkt.dscp != dscp)) {
+    return false;
+  }
+  if ((fields & kIpType) && !matchesIpType(ipType, pkt.isV4, pkt.isV6)) {
+    return false;
+  }
+  if ((fields & kTtl) &&
+      (!isIp || (pkt.ttl & ttlMask) != (ttlValue & ttlMask))) {
+    return false;
+  }
+  if ((fields & kDstMac) && pkt.dstMac != dstMac) {
+    return false;
+  }
+  return true;
+}
+
+bool CpuAclClassifier::permits(const PacketFields& fields) const {
+  const auto& bucket =
+      buckets_[fields.isV4 || fields.isV6 ? fields.proto : kNonIpBucket];
+  for (auto index : bucket) {
+    const auto& rule = rules_[index];
+    if (rule.matches(fields)) {
+      hits_[index].fetch_add(1, std::memory_order_relaxed);
+      return !rule.deny;
+    }
+  }
+  return true;
+}
+
+uint64_t CpuAclClassifier::getHits(const std::string& aclName) const {
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    if (rules_[i].name == aclName) {
+      return hits_[i].load(std::memory_order_relaxed);
+    }
+  }
+  return 0;
+}
+
+void CpuAclClassifier::publishStats() const {
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    tcData().setCounter(
+        rules_[i].hitsKey, hits_[i].load(std::memory_order_relaxed));
+  }
+}
+
+CpuAclFilter::CpuAclFilter(SwSwitch* sw)
+    : AutoRegisterStateObserver(sw, "CpuAclFilter") {}
+
+void CpuAclFilter::stateUpdated(const StateDelta& delta) {
+  if (isEmpty(delta.getAclsDelta())) {
+    return;
+  }
+  auto previous = getClassifier();
+  auto classifier = std::make_shared<const CpuAclClassifier>(
+      delta.newState()->getAcls(), previous.get());
+  XLOG(DBG2) << "Checking trapped packets against " << classifier->size()
+             << " control plane acls";
+  *classifier_.wlock() = std::move(classifier);
+}
+
+bool CpuAclFilter::permits(
+    const RxPacket& pkt,
+    uint16_t ethertype,
+    folly::MacAddress dstMac,
+    Cursor c) const {
+  auto classifier = getClassifier();
+  if (!classifier || classifier->empty()) {
+    return true;
+  }
+  return classifier->permits(
+      CpuAclClassifier::parse(pkt, ethertype, dstMac, c));
+}
+
+}} // facebook::fboss
@@ -0,0 +1,209 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/StateObserver.h"
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/MacAddress.h>
+#include <folly/Synchronized.h>
+#include <folly/io/Cursor.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class AclEntry;
+class AclMap;
+class RxPacket;
+class StateDelta;
+class SwSwitch;
+
+/*
+ * Software copy of the control plane acls, checked against trapped packets
+ * before they are handed to the packet handlers.
+ *
+ * The control plane acls are the DENY acls, which apply to all traffic, and
+ * the acls of the cpu traffic policy. Packets are matched against them in
+ * priority order, and the first match decides: a DENY acl drops the packet,
+ * any other lets it through. Packets matching no acl are let through.
+ *
+ * The acls are flattened into plain structs when the classifier is built,
+ * and indexed by the IP protocol they match, so that a packet is only
+ * compared with the acls that can possibly match it.
+ *
+ * Immutable once built, apart from the hit counters, so it can be shared
+ * by all the threads receiving packets.
+ */
+class CpuAclClassifier {
+ public:
+  // What the acls can match on in a trapped packet
+  struct PacketFields {
+    PortID srcPort{0};
+    folly::MacAddress dstMac;
+    uint32_t length{0};
+    bool isV4{false};
+    bool isV6{false};
+    folly::IPAddress srcIp;
+    folly::IPAddress dstIp;
+    uint8_t proto{0};
+    uint8_t dscp{0};
+    uint8_t ttl{0};
+    bool moreFragments{false};
+    bool nonFirstFragment{false};
+    // Only set for TCP and UDP
+    bool hasL4Ports{false};
+    uint16_t srcL4Port{0};
+    uint16_t dstL4Port{0};
+    // Only set for TCP
+    bool hasTcpFlags{false};
+    uint8_t tcpFlags{0};
+    // Only set for ICMP and ICMPv6
+    bool hasIcmp{false};
+    uint8_t icmpType{0};
+    uint8_t icmpCode{0};
+  };
+
+  /*
+   * Build the classifier from the acls of a switch state. Hit counts of acls
+   * that were already in the previous classifier carry over.
+   */
+  explicit CpuAclClassifier(
+      const std::shared_ptr<AclMap>& acls,
+      const CpuAclClassifier* previous = nullptr);
+
+  static bool isControlPlaneAcl(const AclEntry& acl);
+
+  /*
+   * Parse what the acls match on from a packet. c must be at the start of
+   * the payload following the ethernet header. Throws if the packet is
+   * truncated.
+   */
+  static PacketFields parse(
+      const RxPacket& pkt,
+      uint16_t ethertype,
+      folly::MacAddress dstMac,
+      folly::io::Cursor c);
+
+  // Whether the packet may go on to the handlers
+  bool permits(const PacketFields& fields) const;
+
+  bool empty() const {
+    return rules_.empty();
+  }
+  size_t size() const {
+    return rules_.size();
+  }
+  // Packets matched by the acl, 0 if it isn't a control plane acl
+  uint64_t getHits(const std::string& aclName) const;
+
+  // Export the hit counts
+  void publishStats() const;
+
+ private:
+  // Which of the fields of a Rule have to match
+  enum RuleField : uint32_t {
+    kSrcIp = 1 << 0,
+    kDstIp = 1 << 1,
+    kProto = 1 << 2,
+    kTcpFlags = 1 << 3,
+    kSrcPort = 1 << 4,
+    kSrcL4PortRange = 1 << 5,
+    kDstL4PortRange = 1 << 6,
+    kPktLenRange = 1 << 7,
+    kIpFrag = 1 << 8,
+    kIcmpType = 1 << 9,
+    kIcmpCode = 1 << 10,
+    kDscp = 1 << 11,
+    kIpType = 1 << 12,
+    kTtl = 1 << 13,
+    kDstMac = 1 << 14,
+  };
+
+  struct Range {
+    uint16_t min{0};
+    uint16_t max{0};
+    bool invert{false};
+
+    bool matches(uint16_t value) const {
+      return (value >= min && value <= max) != invert;
+    }
+  };
+
+  struct Rule {
+    std::string name;
+    std::string hitsKey;
+    bool deny{false};
+    uint32_t fields{0};
+    folly::CIDRNetwork srcIp;
+    folly::CIDRNetwork dstIp;
+    uint8_t proto{0};
+    uint8_t tcpFlags{0};
+    PortID srcPort{0};
+    Range srcL4Ports;
+    Range dstL4Ports;
+    Range pktLen;
+    cfg::IpFragMatch ipFrag{cfg::IpFragMatch::MATCH_NOT_FRAGMENTED};
+    uint8_t icmpType{0};
+    uint8_t icmpCode{0};
+    uint8_t dscp{0};
+    cfg::IpType ipType{cfg::IpType::ANY};
+    uint8_t ttlValue{0};
+    uint8_t ttlMask{0};
+    folly::MacAddress dstMac;
+
+    bool matches(const PacketFields& pkt) const;
+  };
+
+  // Packets that aren't IP use the last bucket
+  static constexpr size_t kNonIpBucket = 256;
+
+  std::vector<Rule> rules_;
+  // Indices into rules_ of the rules that can match each IP protocol, in
+  // priority order
+  std::array<std::vector<uint32_t>, kNonIpBucket + 1> buckets_;
+  std::unique_ptr<std::atomic<uint64_t>[]> hits_;
+};
+
+/*
+ * Keeps a CpuAclClassifier built from the acls of the current switch state.
+ */
+class CpuAclFilter : public AutoRegisterStateObserver {
+ public:
+  explicit CpuAclFilter(SwSwitch* sw);
+
+  void stateUpdated(const StateDelta& delta) override;
+
+  /*
+   * Whether a trapped packet may be handled. c must be at the start of the
+   * payload following the ethernet header.
+   */
+  bool permits(
+      const RxPacket& pkt,
+      uint16_t ethertype,
+      folly::MacAddress dstMac,
+      folly::io::Cursor c) const;
+
+  std::shared_ptr<const CpuAclClassifier> getClassifier() const {
+    return *classifier_.rlock();
+  }
+
+ private:
+  folly::Synchronized<std::shared_ptr<const CpuAclClassifier>> classifier_;
+};
+
+}} // facebook::fboss
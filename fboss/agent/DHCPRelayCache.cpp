@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/DHCPRelayCache.h"
+
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/VlanMap.h"
+
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+
+namespace facebook { namespace fboss {
+
+DHCPRelayContext::DHCPRelayContext(
+    const SwitchState& state,
+    const Vlan& vlanNode)
+    : vlan(vlanNode.getID()),
+      v4Server(vlanNode.getDhcpV4Relay()),
+      v4Overrides(vlanNode.getDhcpV4RelayOverrides()),
+      v4RelaySrc(state.getDhcpV4RelaySrc()),
+      v6Server(vlanNode.getDhcpV6Relay()),
+      v6Overrides(vlanNode.getDhcpV6RelayOverrides()),
+      v6RelaySrc(state.getDhcpV6RelaySrc()) {
+  auto intf = state.getInterfaces()->getInterfaceInVlanIf(vlan);
+  if (!intf) {
+    return;
+  }
+  for (const auto& address : intf->getAddresses()) {
+    if (v4RelaySrc.isZero() && address.first.isV4()) {
+      v4RelaySrc = address.first.asV4();
+    } else if (v6RelaySrc.isZero() && address.first.isV6()) {
+      v6RelaySrc = address.first.asV6();
+    }
+  }
+}
+
+IPAddressV4 DHCPRelayContext::getV4Server(MacAddress client) const {
+  auto it = v4Overrides.find(client);
+  return it == v4Overrides.end() ? v4Server : it->second;
+}
+
+IPAddressV6 DHCPRelayContext::getV6Server(MacAddress client) const {
+  auto it = v6Overrides.find(client);
+  return it == v6Overrides.end() ? v6Server : it->second;
+}
+
+std::shared_ptr<const DHCPRelayContext> DHCPRelayCache::getContext(
+    const std::shared_ptr<SwitchState>& state,
+    VlanID vlan) {
+  std::lock_guard<std::mutex> g(lock_);
+  checkState(state);
+  auto it = contexts_.find(vlan);
+  if (it != contexts_.end()) {
+    return it->second;
+  }
+  auto vlanNode = state->getVlans()->getVlanIf(vlan);
+  if (!vlanNode) {
+    return nullptr;
+  }
+  auto context = std::make_shared<DHCPRelayContext>(*state, *vlanNode);
+  contexts_.emplace(vlan, context);
+  return context;
+}
+
+folly::Optional<VlanID> DHCPRelayCache::getReplyVlan(
+    const std::shared_ptr<SwitchState>& state,
+    const folly::IPAddress& ip) {
+  std::lock_guard<std::mutex> g(lock_);
+  checkState(state);
+  auto it = replyVlans_.find(ip);
+  if (it != replyVlans_.end()) {
+    return it->second;
+  }
+  // TODO we should add router id information to the packet
+  // to get the VRF of the interface that this packet came
+  // in on. Assuming 0 for now since we have only one VRF
+  auto intf = state->getInterfaces()->getInterfaceIf(RouterID(0), ip);
+  if (!intf) {
+    return folly::none;
+  }
+  replyVlans_.emplace(ip, intf->getVlanID());
+  return intf->getVlanID();
+}
+
+void DHCPRelayCache::checkState(const std::shared_ptr<SwitchState>& state) {
+  if (state->getGeneration() == generation_ &&
+      !state_.owner_before(state) && !state.owner_before(state_)) {
+    return;
+  }
+  contexts_.clear();
+  replyVlans_.clear();
+  generation_ = state->getGeneration();
+  state_ = state;
+}
+
+}} // facebook::fboss
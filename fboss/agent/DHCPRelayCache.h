@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/types.h"
+
+#include <boost/container/flat_map.hpp>
+#include <folly/IPAddress.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/MacAddress.h>
+#include <folly/Optional.h>
+
+#include <memory>
+#include <mutex>
+
+namespace facebook { namespace fboss {
+
+class SwitchState;
+
+/*
+ * What DHCPv4Handler and DHCPv6Handler need to know about a vlan to relay
+ * the DHCP requests received on it.
+ */
+struct DHCPRelayContext {
+  DHCPRelayContext(const SwitchState& state, const Vlan& vlanNode);
+
+  // The server to relay the requests of client to, zero if there is none
+  folly::IPAddressV4 getV4Server(folly::MacAddress client) const;
+  folly::IPAddressV6 getV6Server(folly::MacAddress client) const;
+
+  VlanID vlan;
+  folly::IPAddressV4 v4Server;
+  DhcpV4OverrideMap v4Overrides;
+  // The relay source, or else the first address of the vlan's interface.
+  // Zero if there is neither.
+  folly::IPAddressV4 v4RelaySrc;
+  folly::IPAddressV6 v6Server;
+  DhcpV6OverrideMap v6Overrides;
+  folly::IPAddressV6 v6RelaySrc;
+};
+
+/*
+ * Caches the DHCPRelayContext of each vlan, so relaying a request doesn't
+ * look up and copy the relay configuration from the SwitchState each time,
+ * and the vlan replies are relayed to, which otherwise takes a scan of all
+ * the interfaces.
+ *
+ * The contexts are computed for the state they were looked up with, and all
+ * of them are thrown away as soon as a different state is seen. The state
+ * generation alone doesn't tell states apart, as an update may publish a
+ * state that wasn't cloned from the previous one, so the state itself is
+ * compared too.
+ *
+ * Called from the packet receiving threads.
+ */
+class DHCPRelayCache {
+ public:
+  DHCPRelayCache() {}
+
+  /*
+   * Get the context of vlan in state, nullptr if state has no such vlan.
+   */
+  std::shared_ptr<const DHCPRelayContext> getContext(
+      const std::shared_ptr<SwitchState>& state,
+      VlanID vlan);
+
+  /*
+   * Get the vlan of the interface with address ip in state, which DHCP
+   * replies sent to ip are relayed to.
+   */
+  folly::Optional<VlanID> getReplyVlan(
+      const std::shared_ptr<SwitchState>& state,
+      const folly::IPAddress& ip);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  DHCPRelayCache(DHCPRelayCache const&) = delete;
+  DHCPRelayCache& operator=(DHCPRelayCache const&) = delete;
+
+  // Start over if state isn't the one cached. Must be called with lock_
+  // held.
+  void checkState(const std::shared_ptr<SwitchState>& state);
+
+  std::mutex lock_;
+  uint32_t generation_{0};
+  // Held weakly so the cache doesn't keep an old state around
+  std::weak_ptr<SwitchState> state_;
+  boost::container::flat_map<VlanID, std::shared_ptr<const DHCPRelayContext>>
+      contexts_;
+  boost::container::flat_map<folly::IPAddress, VlanID> replyVlans_;
+};
+
+}} // facebook::fboss
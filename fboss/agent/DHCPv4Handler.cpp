@@ -13,6 +13,8 @@
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include "FbossError.h"
 #include "Platform.h"
@@ -21,6 +23,7 @@
 #include "SwitchStats.h"
 #include "TxPacket.h"
 #include "UDPHeader.h"
+#include "fboss/agent/DHCPRelayCache.h"
 #include "fboss/agent/packet/DHCPv4Packet.h"
 #include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/Ethertype.h"
@@ -112,21 +115,20 @@ void sendDHCPPacket(SwSwitch* sw, const EthHdr& ethHdr, const IPv4Hdr& ipHdr,
   sw->sendPacketSwitchedAsync(std::move(txPacket));
 }
 
-int processOption(const DHCPv4Packet::Options& optionsIn, int optIndex,
-    DHCPv4Packet& dhcpPacketOut, bool toAppend) {
-
-  uint8_t op = optionsIn[optIndex];
-  uint8_t optLen = DHCPv4Packet::isOptionWithoutLength(op) ?
-      0 : optionsIn[optIndex + 1];
-  const uint8_t* optBytes = optLen == 0 ? nullptr :
-    &optionsIn[optIndex + 2];
-  if (toAppend) {
-    dhcpPacketOut.appendOption(op, optLen, optBytes);
+// Bytes taken by the option at optIndex
+size_t optionSize(const DHCPv4Packet::Options& options, size_t optIndex) {
+  uint8_t op = options[optIndex];
+  if (DHCPv4Packet::isOptionWithoutLength(op) ||
+      optIndex + 1 >= options.size()) {
+    return 1;         // option byte
   }
-  return optLen == 0 ?
-      1 :          // option byte
-      2 + optLen;  // Option byte + len + option data
+  return 2 + options[optIndex + 1]; // Option byte + len + option data
+}
 
+std::chrono::microseconds elapsedSince(
+    std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
 }
 
 }
@@ -152,6 +154,7 @@ void DHCPv4Handler::handlePacket(
     const IPv4Hdr& ipHdr,
     const UDPHeader& /*udpHdr*/,
     Cursor cursor) {
+  auto start = std::chrono::steady_clock::now();
   sw->portStats(pkt->getSrcPort())->dhcpV4Pkt();
   if (ipHdr.ttl <= 1) {
     sw->portStats(pkt->getSrcPort())->dhcpV4BadPkt();
@@ -171,11 +174,15 @@ void DHCPv4Handler::handlePacket(
     switch(dhcpPkt.op) {
       case BOOTREQUEST:
         XLOG(DBG4) << " Got boot request ";
-        processRequest(sw, std::move(pkt), srcMac, ipHdr, dhcpPkt);
+        if (processRequest(sw, std::move(pkt), srcMac, ipHdr, dhcpPkt)) {
+          sw->stats()->dhcpV4RelayFwd(elapsedSince(start));
+        }
         break;
       case BOOTREPLY:
         XLOG(DBG4) << " Got boot reply";
-        processReply(sw, std::move(pkt), ipHdr, dhcpPkt);
+        if (processReply(sw, std::move(pkt), ipHdr, dhcpPkt)) {
+          sw->stats()->dhcpV4RelayReply(elapsedSince(start));
+        }
         break;
       default:
         XLOG(DBG4) << " Unknown DHCP Packet type " << (uint)dhcpPkt.op;
@@ -192,99 +199,80 @@ void DHCPv4Handler::handlePacket(
 }
 
 
-void DHCPv4Handler::processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
+bool DHCPv4Handler::processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
     MacAddress srcMac, const IPv4Hdr& origIPHdr,
-    const DHCPv4Packet& dhcpPacket) {
-  auto dhcpPacketOut(dhcpPacket);
-  auto state = sw->getState();
-  auto vlan = state->getVlans()->getVlanIf(pkt->getSrcVlan());
-  if (!vlan) {
+    DHCPv4Packet& dhcpPacket) {
+  auto context = sw->getDhcpRelayCache()->getContext(
+      sw->getState(), pkt->getSrcVlan());
+  if (!context) {
     sw->stats()->dhcpV4DropPkt();
     XLOG(DBG4) << " VLAN  " << pkt->getSrcVlan() << " is no longer present "
                << " dropped dhcp packet received on a port in this VLAN";
-    return;
+    return false;
   }
-  auto dhcpServer = vlan->getDhcpV4Relay();
 
   XLOG(DBG4) << "srcMac: " << srcMac.toString();
   // look in the override map, and use relevant destination
-  auto dhcpOverrideMap = vlan->getDhcpV4RelayOverrides();
-  if (dhcpOverrideMap.find(srcMac) != dhcpOverrideMap.end()) {
-    dhcpServer = dhcpOverrideMap[srcMac];
-    XLOG(DBG4) << "dhcpServer: " << dhcpServer;
-  }
-
+  auto dhcpServer = context->getV4Server(srcMac);
   if (dhcpServer.isZero()) {
     sw->stats()->dhcpV4DropPkt();
-    XLOG(DBG4) << " No relay configured for VLAN : " << vlan->getID()
+    XLOG(DBG4) << " No relay configured for VLAN : " << context->vlan
                << " dropped dhcp packet ";
-    return;
-  }
-
-  auto switchIp = state->getDhcpV4RelaySrc();
-  if (switchIp.isZero()) {
-    auto vlanInterface = state->getInterfaces()->getInterfaceInVlanIf(
-        pkt->getSrcVlan());
-    auto& addresses = vlanInterface->getAddresses();
-    for (auto address: addresses) {
-      if (address.first.isV4()) {
-        switchIp = address.first.asV4();
-        break;
-      }
-    }
+    return false;
   }
+  XLOG(DBG4) << "dhcpServer: " << dhcpServer;
 
+  auto switchIp = context->v4RelaySrc;
   if (switchIp.isZero()) {
     sw->stats()->dhcpV4DropPkt();
     XLOG(ERR) << "Could not find a SVI interface on vlan : "
               << pkt->getSrcVlan() << "DHCP packet dropped ";
-    return;
+    return false;
   }
 
   XLOG(DBG4) << " Got switch ip : " << switchIp;
   // Prepare DHCP packet to relay
-  if (!addAgentOptions(sw, pkt->getSrcPort(), switchIp, dhcpPacket,
-        dhcpPacketOut)) {
+  if (!addAgentOptions(sw, pkt->getSrcPort(), switchIp, dhcpPacket)) {
     sw->portStats(pkt->getSrcPort())->dhcpV4BadPkt();
     XLOG(DBG4) << "Bad DHCP packet, error adding agent options."
                << " DHCP packet dropped";
-    return;
+    return false;
   }
   // Incrementing hops is optional for relay agent forwarding,
   // however it seems safer in case of loops. Also seen cases
   // where not incrementing this on the DHCP request causes
   // the server to drop our request.
   const int kMaxHops = 255;
-  if (dhcpPacketOut.hops < kMaxHops) {
-    dhcpPacketOut.hops++;
+  if (dhcpPacket.hops < kMaxHops) {
+    dhcpPacket.hops++;
   } else {
     XLOG(DBG4) << "Max hops exceeded for dhcp packet";
     sw->portStats(pkt->getSrcPort())->dhcpV4BadPkt();
-    return;
+    return false;
   }
-  dhcpPacketOut.giaddr = switchIp;
+  dhcpPacket.giaddr = switchIp;
   // Look up cpu mac from platform
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
 
   // Prepare the packet to be sent out
   EthHdr ethHdr = makeEthHdr(cpuMac, cpuMac, pkt->getSrcVlan());
   auto ipHdr = makeIpv4Header(switchIp, dhcpServer, origIPHdr.ttl - 1,
-      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacketOut.size());
+      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacket.size());
   UDPHeader udpHdr(kBootPSPort, kBootPSPort,
-      UDPHeader::size() + dhcpPacketOut.size());
+      UDPHeader::size() + dhcpPacket.size());
   // Send packet
-  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacketOut);
+  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacket);
+  return true;
 }
 
-void DHCPv4Handler::processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-      const IPv4Hdr& origIPHdr, const DHCPv4Packet& dhcpPacket) {
-  auto dhcpPacketOut(dhcpPacket);
+bool DHCPv4Handler::processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
+      const IPv4Hdr& origIPHdr, DHCPv4Packet& dhcpPacket) {
   auto state = sw->getState();
-  if (!stripAgentOptions(sw, pkt->getSrcPort(), dhcpPacket, dhcpPacketOut)) {
+  if (!stripAgentOptions(sw, pkt->getSrcPort(), dhcpPacket)) {
     sw->portStats(pkt->getSrcPort())->dhcpV4BadPkt();
     XLOG(DBG4) << "Bad DHCP packet, error stripping agent options."
                << " DHCP packet dropped";
-    return;
+    return false;
   }
   IPAddressV4 clientIP = IPAddressV4::fromLong(INADDR_BROADCAST);
   if (!(dhcpPacket.flags & DHCPv4Packet::kFlagBroadcast)) {
@@ -297,55 +285,49 @@ void DHCPv4Handler::processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
   // Extract client MAC address from dhcp reply
   uint8_t chaddr[MacAddress::SIZE];
-  memcpy(chaddr, dhcpPacketOut.chaddr.data(), MacAddress::SIZE);
+  memcpy(chaddr, dhcpPacket.chaddr.data(), MacAddress::SIZE);
   MacAddress dstMac = MacAddress::fromBinary(
     folly::ByteRange(chaddr, MacAddress::SIZE));
 
   // Clear out the relay address field
-  dhcpPacketOut.giaddr = IPAddressV4();
-
-  // TODO we should add router id information to the packet
-  // to get the VRF of the interface that this packet came
-  // in on. Assuming 0 for now since we have only one VRF
-  auto intf = state->getInterfaces()->getInterface(RouterID(0),
-      IPAddress(switchIp));
-  if (!intf) {
+  dhcpPacket.giaddr = IPAddressV4();
+
+  auto vlan = sw->getDhcpRelayCache()->getReplyVlan(
+      state, IPAddress(switchIp));
+  if (!vlan) {
     sw->portStats(pkt->getSrcPort())->dhcpV4DropPkt();
     LOG (INFO) << "Could not lookup interface for : " << switchIp
       << "DHCP packet dropped ";
-    return;
+    return false;
   }
 
   // Prepare the packet to be sent out
-  EthHdr ethHdr = makeEthHdr(cpuMac, dstMac, intf->getVlanID());
+  EthHdr ethHdr = makeEthHdr(cpuMac, dstMac, *vlan);
   auto ipHdr = makeIpv4Header(switchIp, clientIP, origIPHdr.ttl - 1,
-      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacketOut.size());
+      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacket.size());
   UDPHeader udpHdr(kBootPSPort, kBootPCPort,
-      UDPHeader::size() + dhcpPacketOut.size());
+      UDPHeader::size() + dhcpPacket.size());
 
-  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacketOut);
+  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacket);
+  return true;
 }
 
 bool DHCPv4Handler::addAgentOptions(
     SwSwitch* /*sw*/,
     PortID /*port*/,
     IPAddressV4 relayAddr,
-    const DHCPv4Packet& dhcpPacketIn,
-    DHCPv4Packet& dhcpPacketOut) {
-  dhcpPacketOut.clearOptions();
-  const auto& optionsIn = dhcpPacketIn.options;
-  auto optIndex = 0;
+    DHCPv4Packet& dhcpPacket) {
+  auto& options = dhcpPacket.options;
+  size_t optIndex = 0;
   bool isDHCP = false;
-  bool done = false;
   uint16_t maxMsgSize = 0;
-  while (optIndex < optionsIn.size() && !done) {
-    bool appendOption = true;
-    switch(optionsIn[optIndex]) {
+  while (optIndex < options.size() && options[optIndex] != END) {
+    switch(options[optIndex]) {
       case DHCP_MESSAGE_TYPE:
         isDHCP = true;
         break;
       case DHCP_MAX_MESSAGE_SIZE:
-        maxMsgSize = ntohs(optionsIn[optIndex + 2]);
+        maxMsgSize = ntohs(options[optIndex + 2]);
         break;
       case DHCP_AGENT_OPTIONS:
         if (isDHCP) {
@@ -355,62 +337,71 @@ bool DHCPv4Handler::addAgentOptions(
           return false; //Options already present discard packet
         }
         break;
-      case END:
-        done = true;
-        appendOption = false;
-        break;
     }
-    optIndex += processOption(optionsIn, optIndex, dhcpPacketOut,
-        appendOption);
+    optIndex += optionSize(options, optIndex);
   }
-  if (isDHCP) {
-    //Append agent option
-    uint8_t optlen = 2 + relayAddr.byteCount();
-    uint8_t subOptArray[optlen];
-    subOptArray[0] = AGENT_CIRCUIT_ID;
-    subOptArray[1] = relayAddr.byteCount();
-    memcpy(subOptArray + 2, relayAddr.bytes(), relayAddr.byteCount());
-    dhcpPacketOut.appendOption(DHCP_AGENT_OPTIONS, optlen, subOptArray);
+  if (!isDHCP) {
+    return false;
+  }
+  // The agent option goes where END was, followed by END
+  constexpr uint8_t kCircuitIdLen = 2 + IPAddressV4::byteCount();
+  constexpr size_t kAgentOptionsLen = 2 + kCircuitIdLen + 1;
+  uint8_t agentOptions[kAgentOptionsLen] = {
+    DHCP_AGENT_OPTIONS, kCircuitIdLen,
+    AGENT_CIRCUIT_ID, IPAddressV4::byteCount()};
+  memcpy(agentOptions + 4, relayAddr.bytes(), IPAddressV4::byteCount());
+  agentOptions[kAgentOptionsLen - 1] = END;
+  optIndex = std::min(optIndex, options.size());
+  if (optIndex + kAgentOptionsLen <= options.size()) {
+    // Clients usually pad their requests after END, which leaves room to
+    // rewrite the options in place without growing the packet
+    std::copy(agentOptions, agentOptions + kAgentOptionsLen,
+        options.begin() + optIndex);
+    std::fill(options.begin() + optIndex + kAgentOptionsLen, options.end(),
+        PAD);
+  } else {
+    options.resize(optIndex);
+    options.insert(options.end(), agentOptions,
+        agentOptions + kAgentOptionsLen);
+    dhcpPacket.padToMinLength();
   }
-  dhcpPacketOut.appendOption(END, 0, nullptr);
-  dhcpPacketOut.padToMinLength();
-  if (isDHCP && maxMsgSize && dhcpPacketOut.size() > maxMsgSize) {
+  if (maxMsgSize && dhcpPacket.size() > maxMsgSize) {
     return false;
   }
-
-  return isDHCP;
+  return true;
 }
 
 bool DHCPv4Handler::stripAgentOptions(
     SwSwitch* /*sw*/,
     PortID /*port*/,
-    const DHCPv4Packet& dhcpPacketIn,
-    DHCPv4Packet& dhcpPacketOut) {
-  dhcpPacketOut.clearOptions();
-  const auto& optionsIn = dhcpPacketIn.options;
-  auto optIndex = 0;
+    DHCPv4Packet& dhcpPacket) {
+  auto& options = dhcpPacket.options;
+  size_t optIndex = 0;
   bool isDHCP = false;
-  bool done = false;
-  while (optIndex < optionsIn.size() && !done) {
-    bool appendOption = true;
-    switch(optionsIn[optIndex]) {
-      case DHCP_MESSAGE_TYPE:
-        isDHCP = true;
-        break;
-      case DHCP_AGENT_OPTIONS:
-        if (isDHCP) {
-          appendOption = false;
-        }
-        break;
-      case END:
-        done = true;
-        appendOption = true;
+  while (optIndex < options.size()) {
+    auto op = options[optIndex];
+    auto optSize = std::min(optionSize(options, optIndex),
+        options.size() - optIndex);
+    if (op == DHCP_AGENT_OPTIONS && isDHCP) {
+      auto optEnd = options.begin() + optIndex + optSize;
+      if (optEnd != options.end() && *optEnd == END) {
+        // The server appends the agent option last, so it's usually enough
+        // to move END up and pad the rest, without shifting anything
+        std::fill(options.begin() + optIndex, optEnd + 1, PAD);
+        options[optIndex] = END;
         break;
+      }
+      options.erase(options.begin() + optIndex, optEnd);
+      continue;
+    }
+    if (op == DHCP_MESSAGE_TYPE) {
+      isDHCP = true;
+    } else if (op == END) {
+      break;
     }
-    optIndex += processOption(optionsIn, optIndex, dhcpPacketOut,
-        appendOption);
+    optIndex += optSize;
   }
-  dhcpPacketOut.padToMinLength();
+  dhcpPacket.padToMinLength();
   return isDHCP;
 }
 
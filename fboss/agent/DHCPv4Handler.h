@@ -43,15 +43,19 @@ class DHCPv4Handler {
       folly::MacAddress dstMac,
       const IPv4Hdr& ipHdr, const UDPHeader& udpHdr, folly::io::Cursor cursor);
  private:
-  static void processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
+  /*
+   * Relay a request from a client to the DHCP server, or a reply from the
+   * server to the client. dhcpPacket is rewritten in place into the packet
+   * to send. Return whether the packet was relayed.
+   */
+  static bool processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac, const IPv4Hdr& ipHdr,
-      const DHCPv4Packet& dhcpPacket);
-  static void processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-      const IPv4Hdr& ipHdr, const DHCPv4Packet& dhcpPacket);
+      DHCPv4Packet& dhcpPacket);
+  static bool processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
+      const IPv4Hdr& ipHdr, DHCPv4Packet& dhcpPacket);
   static bool addAgentOptions(SwSwitch* sw, PortID port,
-      folly::IPAddressV4 relayAddr,
-      const DHCPv4Packet& dhcpPacketIn, DHCPv4Packet& dhcpPacketOut);
+      folly::IPAddressV4 relayAddr, DHCPv4Packet& dhcpPacket);
   static bool stripAgentOptions(SwSwitch* sw, PortID port,
-      const DHCPv4Packet& dhcpPacketIn, DHCPv4Packet& dhcpPacketOut);
+      DHCPv4Packet& dhcpPacket);
 };
 }} // facebook::fboss
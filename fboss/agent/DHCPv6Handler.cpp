@@ -13,8 +13,10 @@
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <chrono>
 #include <string>
 #include "FbossError.h"
+#include "fboss/agent/DHCPRelayCache.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
@@ -106,6 +108,12 @@ void sendDHCPv6Packet(SwSwitch* sw, MacAddress dstMac, MacAddress srcMac,
   sw->sendPacketSwitchedAsync(std::move(txPacket));
 }
 
+std::chrono::microseconds elapsedSince(
+    std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
 }
 
 namespace facebook { namespace fboss {
@@ -124,6 +132,7 @@ void DHCPv6Handler::handlePacket(
     const IPv6Hdr& ipHdr,
     const UDPHeader& /*udpHdr*/,
     Cursor cursor) {
+  auto start = std::chrono::steady_clock::now();
   sw->portStats(pkt->getSrcPort())->dhcpV6Pkt();
   // Parse dhcp packet
   DHCPv6Packet dhcp6Pkt;
@@ -136,20 +145,27 @@ void DHCPv6Handler::handlePacket(
   if (dhcp6Pkt.type == static_cast<uint8_t>(DHCPv6Type::DHCPv6_RELAY_FORWARD)) {
     XLOG(DBG4) << "Received DHCPv6 relay forward packet: "
                << dhcp6Pkt.toString();
-    processDHCPv6RelayForward(sw, std::move(pkt), srcMac, dstMac,
-                             ipHdr, dhcp6Pkt);
+    if (processDHCPv6RelayForward(sw, std::move(pkt), srcMac, dstMac,
+                                  ipHdr, dhcp6Pkt)) {
+      sw->stats()->dhcpV6RelayFwd(elapsedSince(start));
+    }
   } else if (
       dhcp6Pkt.type == static_cast<uint8_t>(DHCPv6Type::DHCPv6_RELAY_REPLY)) {
     XLOG(DBG4) << "Received DHCPv6 relay reply packet: " << dhcp6Pkt.toString();
-    processDHCPv6RelayReply(sw, std::move(pkt), srcMac, dstMac,
-                             ipHdr, dhcp6Pkt);
+    if (processDHCPv6RelayReply(sw, std::move(pkt), srcMac, dstMac,
+                                ipHdr, dhcp6Pkt)) {
+      sw->stats()->dhcpV6RelayReply(elapsedSince(start));
+    }
   } else {
     XLOG(DBG4) << "Received DHCPv6 packet: " << dhcp6Pkt.toString();
-    processDHCPv6Packet(sw, std::move(pkt), srcMac, dstMac, ipHdr, dhcp6Pkt);
+    if (processDHCPv6Packet(
+            sw, std::move(pkt), srcMac, dstMac, ipHdr, dhcp6Pkt)) {
+      sw->stats()->dhcpV6RelayFwd(elapsedSince(start));
+    }
   }
 }
 
-void DHCPv6Handler::processDHCPv6Packet(
+bool DHCPv6Handler::processDHCPv6Packet(
     SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt,
     MacAddress srcMac,
@@ -158,36 +174,29 @@ void DHCPv6Handler::processDHCPv6Packet(
     const DHCPv6Packet& dhcpPacket) {
   auto vlanId = pkt->getSrcVlan();
   auto states = sw->getState();
-  auto vlan = states->getVlans()->getVlanIf(vlanId);
-  if (!vlan) {
+  auto context = sw->getDhcpRelayCache()->getContext(states, vlanId);
+  if (!context) {
     sw->stats()->dhcpV6DropPkt();
     XLOG(DBG2) << "VLAN " << vlanId << " is no longer present"
                << "DHCPv6Packet dropped.";
-    return;
+    return false;
   }
 
-  auto dhcp6ServerIp = vlan->getDhcpV6Relay();
-
   // look in the override map, and use relevant destination
   XLOG(DBG4) << "srcMac: " << srcMac.toString();
-  auto dhcpOverrideMap = vlan->getDhcpV6RelayOverrides();
-  for (auto o : dhcpOverrideMap) {
-    if (MacAddress(o.first) == srcMac) {
-      dhcp6ServerIp = o.second;
-      XLOG(DBG4) << "dhcp6ServerIp: " << dhcp6ServerIp;
-      break;
-    }
-  }
+  auto dhcp6ServerIp = context->getV6Server(srcMac);
+  XLOG(DBG4) << "dhcp6ServerIp: " << dhcp6ServerIp;
 
   if (dhcp6ServerIp.isZero()) {
-    XLOG(DBG4) << "No DHCPv6 relay configured for Vlan " << vlan->getID()
+    XLOG(DBG4) << "No DHCPv6 relay configured for Vlan " << context->vlan
                << " dropped DHCPv6 packet";
     sw->stats()->dhcpV6DropPkt();
-    return;
+    return false;
   }
 
-  auto switchIp = states->getDhcpV6RelaySrc();
+  auto switchIp = context->v6RelaySrc;
   if (switchIp.isZero()) {
+    // Throws, as there is no IPv6 address to relay from
     switchIp = getSwitchVlanIPv6(states, vlanId);
   }
 
@@ -200,14 +209,17 @@ void DHCPv6Handler::processDHCPv6Packet(
 
   // use the client src mac address as the interface id
   relayFwdPkt.addInterfaceIDOption(srcMac);
-  // add relay message option
-  relayFwdPkt.addRelayMessageOption(dhcpPacket);
+  // The relay message option holds the client's message as is. Rather than
+  // copying it into the option, it is written straight after the option
+  // header when the packet is sent.
+  auto relayMsgLength = dhcpPacket.computePacketLength();
+  auto relayFwdLength =
+      relayFwdPkt.computePacketLength() + 4 + relayMsgLength;
 
-  if (relayFwdPkt.computePacketLength() >
-      DHCPv6Packet::MAX_DHCPV6_MSG_LENGTH) {
+  if (relayFwdLength > DHCPv6Packet::MAX_DHCPV6_MSG_LENGTH) {
     XLOG(DBG2) << "DHCPv6 relay forward message exceeds max length, drop it.";
     sw->portStats(pkt->getSrcPort())->dhcpV6BadPkt();
-    return;
+    return false;
   }
 
   // create the dhcpv6 packet
@@ -215,15 +227,20 @@ void DHCPv6Handler::processDHCPv6Packet(
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
   auto serializeBody = [&](RWPrivateCursor* sendCursor) {
     relayFwdPkt.write(sendCursor);
+    sendCursor->writeBE<uint16_t>(
+        static_cast<uint16_t>(DHCPv6OptionType::DHCPv6_OPTION_RELAY_MSG));
+    sendCursor->writeBE<uint16_t>(relayMsgLength);
+    dhcpPacket.write(sendCursor);
   };
 
   sendDHCPv6Packet(sw, cpuMac, cpuMac, vlanId, dhcp6ServerIp, switchIp,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
-      relayFwdPkt.computePacketLength(), serializeBody);
+      relayFwdLength, serializeBody);
+  return true;
 }
 
-void DHCPv6Handler::processDHCPv6RelayForward(SwSwitch* sw,
+bool DHCPv6Handler::processDHCPv6RelayForward(SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt, MacAddress srcMac, MacAddress dstMac,
     const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket) {
   /**
@@ -234,7 +251,7 @@ void DHCPv6Handler::processDHCPv6RelayForward(SwSwitch* sw,
   if (dhcpPacket.hopCount >= MAX_RELAY_HOPCOUNT) {
     XLOG(DBG2) << "Received DHCPv6 relay foward packet with max relay hopcount";
     sw->portStats(pkt->getSrcPort())->dhcpV6BadPkt();
-    return;
+    return false;
   }
   // increment the hopcount and forward it
   dhcpPacket.hopCount ++;
@@ -246,9 +263,10 @@ void DHCPv6Handler::processDHCPv6RelayForward(SwSwitch* sw,
       ipHdr.srcAddr, DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       dhcpPacket.computePacketLength(), serializeBody);
+  return true;
 }
 
-void DHCPv6Handler::processDHCPv6RelayReply(
+bool DHCPv6Handler::processDHCPv6RelayReply(
     SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt,
     MacAddress /*srcMac*/,
@@ -261,13 +279,12 @@ void DHCPv6Handler::processDHCPv6RelayReply(
   if (switchIp.isZero()) {
      switchIp = ipHdr.dstAddr;
   }
-  auto intf = state->getInterfaces()->getInterface(RouterID(0),
-      switchIp);
-  if (!intf) {
+  auto vlan = sw->getDhcpRelayCache()->getReplyVlan(state, switchIp);
+  if (!vlan) {
     sw->portStats(pkt->getSrcPort())->dhcpV6DropPkt();
     XLOG(DBG2) << "Could not look up interface for " << switchIp
                << "DHCPv6 packet dropped";
-    return;
+    return false;
   }
 
   // relay reply from the server
@@ -294,7 +311,7 @@ void DHCPv6Handler::processDHCPv6RelayReply(
   if (destMac == MacAddress::ZERO || relayLen == 0) {
     sw->portStats(pkt->getSrcPort())->dhcpV6DropPkt();
     XLOG(DBG2) << "Bad dhcp relay reply message: malformed options";
-    return;
+    return false;
   }
   /**
    * srcMac -> cpu mac, intf id -> dst mac
@@ -306,10 +323,11 @@ void DHCPv6Handler::processDHCPv6RelayReply(
   auto serializeBody = [&](RWPrivateCursor* sendCursor) {
     sendCursor->push(relayData, relayLen);
   };
-  sendDHCPv6Packet(sw, destMac, cpuMac, intf->getVlanID(),
+  sendDHCPv6Packet(sw, destMac, cpuMac, *vlan,
       dhcpPacket.peerAddr, switchIp, DHCPv6Packet::DHCP6_CLIENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       relayLen, serializeBody);
+  return true;
 }
 
 }} //facebook::fboss
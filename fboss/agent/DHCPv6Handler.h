@@ -37,9 +37,10 @@ class DHCPv6Handler {
 
  private:
   /**
-   * process DHCPv6 packet from client and send relay forward
+   * process DHCPv6 packet from client and send relay forward.
+   * The process functions return whether the packet was relayed.
    */
-  static void processDHCPv6Packet(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
+  static bool processDHCPv6Packet(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
       const IPv6Hdr& ipHdr, const DHCPv6Packet& dhcpPacket);
@@ -47,13 +48,13 @@ class DHCPv6Handler {
   /**
    * process relay reply from server or relay forward message from other agents
    */
-  static void processDHCPv6RelayForward(SwSwitch* sw,
+  static bool processDHCPv6RelayForward(SwSwitch* sw,
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
       const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket);
 
-  static void processDHCPv6RelayReply(SwSwitch* sw,
+  static bool processDHCPv6RelayReply(SwSwitch* sw,
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
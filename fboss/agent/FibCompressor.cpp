@@ -0,0 +1,269 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/FibCompressor.h"
+
+#include <glog/logging.h>
+
+using std::shared_ptr;
+
+namespace facebook { namespace fboss {
+
+template <typename AddrT>
+constexpr uint8_t FibCompressor<AddrT>::kWidth;
+
+template <typename AddrT>
+bool FibCompressor<AddrT>::sameForwarding(
+    const shared_ptr<RouteT>& r1,
+    const shared_ptr<RouteT>& r2) {
+  if (!r1 || !r2) {
+    return r1 == r2;
+  }
+  const auto& fwd1 = r1->getForwardInfo();
+  const auto& fwd2 = r2->getForwardInfo();
+  return fwd1.getAction() == fwd2.getAction() &&
+      fwd1.getNextHopSet() == fwd2.getNextHopSet();
+}
+
+template <typename AddrT>
+typename FibCompressor<AddrT>::Key FibCompressor<AddrT>::parentKey(
+    const Key& key) {
+  CHECK_GT(key.second, 0);
+  uint8_t length = key.second - 1;
+  return Key(key.first.mask(length), length);
+}
+
+template <typename AddrT>
+typename FibCompressor<AddrT>::Key FibCompressor<AddrT>::childKey(
+    const Key& key,
+    bool upper) {
+  CHECK_LT(key.second, kWidth);
+  auto bytes = key.first.toByteArray();
+  if (upper) {
+    bytes[key.second / 8] |= 0x80 >> (key.second % 8);
+  }
+  return Key(AddrT(bytes), key.second + 1);
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::addRoute(const shared_ptr<RouteT>& route) {
+  CHECK(route->isResolved());
+  auto key = makeKey(route->prefix());
+  auto& node = nodes_[key];
+  if (!node.route) {
+    ++numRoutes_;
+  }
+  node.route = route;
+  dirty_.insert(key);
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::removeRoute(const Prefix& prefix) {
+  auto key = makeKey(prefix);
+  auto it = nodes_.find(key);
+  if (it == nodes_.end() || !it->second.route) {
+    return;
+  }
+  it->second.route.reset();
+  --numRoutes_;
+  dirty_.insert(key);
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::programFailed(
+    const Prefix& prefix,
+    const shared_ptr<RouteT>& programmed) {
+  auto key = makeKey(prefix);
+  auto& node = nodes_[key];
+  numProgrammed_ += static_cast<bool>(programmed);
+  numProgrammed_ -= static_cast<bool>(node.programmed);
+  node.programmed = programmed;
+  retry_.insert(key);
+}
+
+template <typename AddrT>
+shared_ptr<Route<AddrT>> FibCompressor<AddrT>::computeCandidate(
+    const Key& key,
+    const Node& node) {
+  // Host routes stay as they are, see the class comment
+  if (key.second + 1 >= kWidth) {
+    return node.route;
+  }
+  auto lower = nodes_.find(childKey(key, false));
+  auto upper = nodes_.find(childKey(key, true));
+  if (lower == nodes_.end() || upper == nodes_.end() ||
+      !lower->second.candidate ||
+      !sameForwarding(lower->second.candidate, upper->second.candidate)) {
+    return node.route;
+  }
+  // The halves decide where every address of the prefix goes, whatever the
+  // prefix's own route says
+  const auto& halves = lower->second.candidate;
+  if (sameForwarding(node.route, halves)) {
+    return node.route;
+  }
+  if (node.candidate && node.candidate != node.route &&
+      sameForwarding(node.candidate, halves)) {
+    return node.candidate;
+  }
+  const auto& fwd = halves->getForwardInfo();
+  auto aggregate = std::make_shared<RouteT>(
+      Prefix{key.first, key.second}, halves->getBestEntry().first, fwd);
+  aggregate->setResolved(fwd);
+  return aggregate;
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::setCandidate(
+    Node* node,
+    shared_ptr<RouteT> candidate) {
+  if (node->candidate) {
+    --candidateLengths_[node->candidate->prefix().mask];
+  }
+  if (candidate) {
+    ++candidateLengths_[candidate->prefix().mask];
+  }
+  node->candidate = std::move(candidate);
+}
+
+template <typename AddrT>
+typename FibCompressor<AddrT>::NodeMap::iterator
+FibCompressor<AddrT>::subtreeEnd(const Key& key) {
+  // The address right after the last one of the prefix
+  auto bytes = key.first.toByteArray();
+  for (size_t bit = key.second; bit < kWidth; ++bit) {
+    bytes[bit / 8] |= 0x80 >> (bit % 8);
+  }
+  for (auto b = bytes.size(); b-- > 0;) {
+    if (++bytes[b] != 0) {
+      return nodes_.lower_bound(Key(AddrT(bytes), 0));
+    }
+  }
+  // The prefix reaches the end of the address space
+  return nodes_.end();
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::addTopCandidatesWithin(
+    const Key& key,
+    std::set<Key>* keys) {
+  auto end = subtreeEnd(key);
+  auto it = nodes_.upper_bound(key);
+  while (it != end) {
+    if (!it->second.candidate) {
+      ++it;
+      continue;
+    }
+    keys->insert(it->first);
+    it = subtreeEnd(it->first);
+  }
+}
+
+template <typename AddrT>
+shared_ptr<Route<AddrT>> FibCompressor<AddrT>::coveringCandidate(
+    const Key& key) const {
+  for (auto length = key.second; length-- > 0;) {
+    if (!candidateLengths_[length]) {
+      continue;
+    }
+    auto it = nodes_.find(Key(key.first.mask(length), length));
+    if (it != nodes_.end() && it->second.candidate) {
+      return it->second.candidate;
+    }
+  }
+  return nullptr;
+}
+
+template <typename AddrT>
+typename FibCompressor<AddrT>::Changes FibCompressor<AddrT>::getChanges() {
+  Changes changes;
+  std::set<Key> toReconcile;
+  toReconcile.swap(retry_);
+
+  // Recompute the candidates bottom up from the changed routes. A prefix
+  // whose candidate forwards differently may change the candidate of the
+  // prefix above it, and which of the candidates below it are needed.
+  std::set<Key, LongerFirst> work(dirty_.begin(), dirty_.end());
+  dirty_.clear();
+  while (!work.empty()) {
+    auto key = *work.begin();
+    work.erase(work.begin());
+    auto it = nodes_.emplace(key, Node()).first;
+    auto& node = it->second;
+    auto candidate = computeCandidate(key, node);
+    if (candidate == node.candidate) {
+      eraseIfEmpty(it);
+      continue;
+    }
+    bool changed = !sameForwarding(candidate, node.candidate);
+    setCandidate(&node, std::move(candidate));
+    if (!changed) {
+      // Just a new route object, nothing to reprogram
+      if (node.programmed) {
+        node.programmed = node.candidate;
+      }
+      continue;
+    }
+    toReconcile.insert(key);
+    addTopCandidatesWithin(key, &toReconcile);
+    if (key.second > 0) {
+      work.insert(parentKey(key));
+    }
+  }
+
+  for (const auto& key : toReconcile) {
+    auto it = nodes_.find(key);
+    if (it != nodes_.end()) {
+      reconcile(it, &changes);
+    }
+  }
+  return changes;
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::reconcile(
+    typename NodeMap::iterator it,
+    Changes* changes) {
+  auto& node = it->second;
+  shared_ptr<RouteT> wanted;
+  if (node.candidate &&
+      !sameForwarding(node.candidate, coveringCandidate(it->first))) {
+    wanted = node.candidate;
+  }
+
+  if (!wanted) {
+    if (node.programmed) {
+      changes->removed.push_back(std::move(node.programmed));
+      node.programmed.reset();
+      --numProgrammed_;
+    }
+  } else if (!node.programmed) {
+    changes->addedChanged.emplace_back(nullptr, wanted);
+    node.programmed = std::move(wanted);
+    ++numProgrammed_;
+  } else {
+    if (!sameForwarding(node.programmed, wanted)) {
+      changes->addedChanged.emplace_back(node.programmed, wanted);
+    }
+    node.programmed = std::move(wanted);
+  }
+  eraseIfEmpty(it);
+}
+
+template <typename AddrT>
+void FibCompressor<AddrT>::eraseIfEmpty(typename NodeMap::iterator it) {
+  if (it->second.empty()) {
+    nodes_.erase(it);
+  }
+}
+
+template class FibCompressor<folly::IPAddressV4>;
+template class FibCompressor<folly::IPAddressV6>;
+
+}} // facebook::fboss
@@ -0,0 +1,170 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTypes.h"
+
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Works out a smaller set of routes that forwards every address the same
+ * way as the resolved routes of one vrf, so a HwSwitch can program that
+ * instead and use up fewer LPM entries:
+ *
+ * - Two halves of a prefix that forward the same way are replaced by one
+ *   route for the whole prefix, which may in turn merge with its sibling.
+ * - A route that forwards the same way as the routes covering it is left
+ *   out, since the covering route matches its addresses anyway.
+ *
+ * Two routes forward the same way if they have the same action and next
+ * hops; admin distances don't matter to the hardware. Host routes aren't
+ * merged into shorter prefixes, as the HwSwitch may keep them in a host
+ * table that is cheaper than the LPM table.
+ *
+ * The programmed set is kept up to date incrementally: addRoute() and
+ * removeRoute() only note the change, and getChanges() revisits the
+ * prefixes above the changed routes which they may merge into, and the
+ * routes right below them.
+ */
+template <typename AddrT>
+class FibCompressor {
+ public:
+  using RouteT = Route<AddrT>;
+  using Prefix = RoutePrefix<AddrT>;
+
+  struct Changes {
+    // Entries to delete from the hardware
+    std::vector<std::shared_ptr<RouteT>> removed;
+    // Entries to add or change, with what was programmed for the prefix
+    // before, nullptr if nothing was
+    std::vector<std::pair<std::shared_ptr<RouteT>, std::shared_ptr<RouteT>>>
+        addedChanged;
+
+    bool empty() const {
+      return removed.empty() && addedChanged.empty();
+    }
+  };
+
+  FibCompressor() {}
+
+  // A resolved route was added to the table, or replaced the one there
+  void addRoute(const std::shared_ptr<RouteT>& route);
+  // A route was removed from the table, or became unresolved
+  void removeRoute(const Prefix& prefix);
+
+  /*
+   * How the programmed entries change to account for the routes added and
+   * removed since the last call. The FibCompressor takes it that they are
+   * all programmed, except for the ones given to programFailed().
+   */
+  Changes getChanges();
+
+  /*
+   * An entry of the last changes couldn't be programmed and programmed is
+   * what the hardware still has for its prefix, nullptr if nothing. It is
+   * tried again on the next getChanges().
+   */
+  void programFailed(
+      const Prefix& prefix,
+      const std::shared_ptr<RouteT>& programmed);
+
+  // Resolved routes in the table
+  size_t numRoutes() const {
+    return numRoutes_;
+  }
+  // Entries the table is programmed as
+  size_t numProgrammed() const {
+    return numProgrammed_;
+  }
+
+  /*
+   * Whether the two routes forward the same way. nullptrs, for no route,
+   * are the same as each other only.
+   */
+  static bool sameForwarding(
+      const std::shared_ptr<RouteT>& r1,
+      const std::shared_ptr<RouteT>& r2);
+
+ private:
+  // A prefix as (network, length), ordered so that the prefixes within a
+  // prefix directly follow it
+  using Key = std::pair<AddrT, uint8_t>;
+  struct LongerFirst {
+    bool operator()(const Key& k1, const Key& k2) const {
+      return k1.second != k2.second ? k1.second > k2.second : k1 < k2;
+    }
+  };
+
+  struct Node {
+    // The route of this prefix in the table
+    std::shared_ptr<RouteT> route;
+    // What this prefix forwards as: an aggregate of the two halves if they
+    // forward the same way, else route
+    std::shared_ptr<RouteT> candidate;
+    // What is programmed for this prefix
+    std::shared_ptr<RouteT> programmed;
+
+    bool empty() const {
+      return !route && !candidate && !programmed;
+    }
+  };
+  using NodeMap = std::map<Key, Node>;
+
+  // Forbidden copy constructor and assignment operator
+  FibCompressor(FibCompressor const&) = delete;
+  FibCompressor& operator=(FibCompressor const&) = delete;
+
+  static constexpr uint8_t kWidth = AddrT::bitCount();
+
+  static Key makeKey(const Prefix& prefix) {
+    return Key(prefix.network.mask(prefix.mask), prefix.mask);
+  }
+  static Key parentKey(const Key& key);
+  static Key childKey(const Key& key, bool upper);
+
+  std::shared_ptr<RouteT> computeCandidate(const Key& key, const Node& node);
+  void setCandidate(Node* node, std::shared_ptr<RouteT> candidate);
+  // The first node past the prefixes within key
+  typename NodeMap::iterator subtreeEnd(const Key& key);
+  // Add the nodes with candidates within key that no other candidate within
+  // key covers
+  void addTopCandidatesWithin(const Key& key, std::set<Key>* keys);
+  // The candidate of the longest prefix strictly covering key
+  std::shared_ptr<RouteT> coveringCandidate(const Key& key) const;
+  void reconcile(typename NodeMap::iterator it, Changes* changes);
+  void eraseIfEmpty(typename NodeMap::iterator it);
+
+  NodeMap nodes_;
+  // The prefixes routes were added or removed at since getChanges()
+  std::set<Key> dirty_;
+  // The prefixes programFailed() was called for
+  std::set<Key> retry_;
+  // The number of candidates of each prefix length, to skip the lengths
+  // without any when looking for a covering one
+  std::vector<uint32_t> candidateLengths_ =
+      std::vector<uint32_t>(kWidth + 1, 0);
+  size_t numRoutes_{0};
+  size_t numProgrammed_{0};
+};
+
+using FibCompressorV4 = FibCompressor<folly::IPAddressV4>;
+using FibCompressorV6 = FibCompressor<folly::IPAddressV6>;
+
+}} // facebook::fboss
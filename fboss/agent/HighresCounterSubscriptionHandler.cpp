@@ -12,6 +12,8 @@
 #include <folly/MoveWrapper.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+
 #include "fboss/agent/Utils.h"
 
 using folly::EventBase;
@@ -25,10 +27,25 @@ using std::chrono::high_resolution_clock;
 using std::chrono::nanoseconds;
 using std::chrono::seconds;
 
+DEFINE_int32(highres_max_queued_batches,
+             16,
+             "Drop highres counter batches for a subscriber which has this "
+             "many batches waiting to be sent already.");
+
 namespace facebook { namespace fboss {
 
+bool SampleSender::tryQueue() {
+  if (numQueued_.fetch_add(1, std::memory_order_relaxed) >=
+      FLAGS_highres_max_queued_batches) {
+    numQueued_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
 // Wrapper for the actual Thrift call
 inline void SampleSender::publish(unique_ptr<CounterPublication> pub) {
+  numQueued_.fetch_sub(1, std::memory_order_relaxed);
   if (!killSwitch_->isSet()) {
     // Note that it's okay to give the callback a shared_ptr to the client
     // without the eventBase because the actual call and callback are run in
@@ -90,23 +107,32 @@ inline void SampleProducer::nanosleepHelper(const nanoseconds& timeLeft) {
   }
 }
 
+void SampleProducer::checkOverload(
+    const high_resolution_clock::time_point& now) {
+  if (now <= nextSampleTime_) {
+    return;
+  }
+  // If processing took longer than an interval, warn of a possible overload
+  if (++overloadWarningCounter_ % kOverloadWarningEveryN == 0) {
+    double percent = ((double)kOverloadWarningEveryN) /
+                     (numSamples_ - numSamplesAtLastOverloadWarning_) * 100;
+    XLOG(WARNING) << "Interval is too small for " << percent
+                  << "% of samples. Exceeded by "
+                  << duration_cast<nanoseconds>(now - nextSampleTime_).count()
+                  << " ns.";
+
+    numSamplesAtLastOverloadWarning_ = numSamples_;
+    overloadWarningCounter_ = 0;
+  }
+}
+
 inline void SampleProducer::sleepNs(high_resolution_clock::time_point* start) {
   auto endTime = *start + interval_;
   auto currentTime = high_resolution_clock::now();
   auto timeLeft = endTime - currentTime;
 
   if (timeLeft < nanoseconds(0)) {
-    // If processing took longer than an interval, warn of a possible overload
-    if (++overloadWarningCounter_ % kOverloadWarningEveryN == 0) {
-      double percent = ((double)kOverloadWarningEveryN) /
-                       (numSamples_ - numSamplesAtLastOverloadWarning_) * 100;
-      XLOG(WARNING) << "Interval is too small for " << percent
-                    << "% of samples. Exceeded by "
-                    << -duration_cast<nanoseconds>(timeLeft).count() << " ns.";
-
-      numSamplesAtLastOverloadWarning_ = numSamples_;
-      overloadWarningCounter_ = 0;
-    }
+    checkOverload(currentTime);
   } else {
     // Else, we need to sleep for a bit.  There are two ways to do it:
     if (sleepMethod_ == SleepMethod::NANOSLEEP) {
@@ -125,9 +151,10 @@ inline void SampleProducer::sleepNs(high_resolution_clock::time_point* start) {
   *start = currentTime;
 }
 
-inline void SampleProducer::buildPublication(
+void SampleProducer::buildPublication(
     CounterPublication* pub,
-    const high_resolution_clock::time_point& currentTime) {
+    const high_resolution_clock::time_point& currentTime,
+    const HighresSamplerList& samplers) {
   auto duration = duration_cast<nanoseconds>(currentTime.time_since_epoch());
 
   auto time_s = duration_cast<seconds>(duration).count();
@@ -137,12 +164,21 @@ inline void SampleProducer::buildPublication(
       apache::thrift::FragileConstructor::FRAGILE, time_s, time_ns);
 
   // Add a round of values
-  for (const auto& sampler : (*samplers_.get())) {
+  for (const auto& sampler : samplers) {
     sampler->sample(pub);
   }
 }
 
 void SampleProducer::publish(unique_ptr<CounterPublication> pub) {
+  if (!sender_->tryQueue()) {
+    // The client isn't keeping up. Rather than queueing up more and more
+    // samples for it, drop them.
+    if (numDroppedBatches_++ % kOverloadWarningEveryN == 0) {
+      XLOG(WARNING) << "Subscriber is not keeping up, dropped "
+                    << numDroppedBatches_ << " batches so far";
+    }
+    return;
+  }
   auto& sender = sender_;
   auto wrappedPub = folly::makeMoveWrapper(std::move(pub));
   // Schedule the send in a eb thread.  We include the a shared pointer to the
@@ -151,41 +187,193 @@ void SampleProducer::publish(unique_ptr<CounterPublication> pub) {
       [sender, wrappedPub]() mutable { sender->publish(wrappedPub.move()); });
 }
 
-void SampleProducer::produce() {
-  auto pub = make_unique<CounterPublication>();
+void SampleProducer::start() {
+  start(high_resolution_clock::now());
+}
 
-  pub->hostname = hostname_;
-  auto batchCounter = 0;
+void SampleProducer::start(
+    const high_resolution_clock::time_point& firstSample) {
+  pub_ = make_unique<CounterPublication>();
+  pub_->hostname = hostname_;
+  batchCounter_ = 0;
+  numSamples_ = 0;
 
   sender_->initialize();
   rateCalc_.initialize();
+  nextSampleTime_ = firstSample;
+  timeout_ = high_resolution_clock::now() + maxTime_;
+}
+
+bool SampleProducer::finished(const high_resolution_clock::time_point& now)
+    const {
+  return killSwitch_->isSet() || numSamples_ >= maxCount_ || now >= timeout_;
+}
+
+void SampleProducer::sampleOnce(const high_resolution_clock::time_point& now) {
+  buildPublication(pub_.get(), now, *samplers_);
+  sampleAdded(now);
+}
+
+void SampleProducer::addSample(
+    const CounterPublication& sample,
+    const high_resolution_clock::time_point& now) {
+  DCHECK_EQ(sample.times.size(), 1u);
+  pub_->times.push_back(sample.times.front());
+  for (const auto& counterAndValues : sample.counterValues) {
+    auto& values = pub_->counterValues[counterAndValues.first];
+    values.insert(
+        values.end(),
+        counterAndValues.second.begin(),
+        counterAndValues.second.end());
+  }
+  sampleAdded(now);
+}
+
+void SampleProducer::sampleAdded(const high_resolution_clock::time_point& now) {
+  nextSampleTime_ = now + interval_;
+
+  // Check if we have a full batch.  If so move it to the queue and make a new
+  // publication.
+  if (++batchCounter_ >= batchSize_) {
+    publish(std::move(pub_));
+    pub_ = make_unique<CounterPublication>();
+    pub_->hostname = hostname_;
+    batchCounter_ = 0;
+  }
+
+  // Print out the sampling rate every second
+  rateCalc_.finishedSamples(numCounters_);
+  ++numSamples_;
+}
+
+void SampleProducer::finish() {
+  if (batchCounter_ > 0) {
+    publish(std::move(pub_));
+    batchCounter_ = 0;
+  }
+}
+
+void SampleProducer::produce() {
+  start();
   auto currentTime = high_resolution_clock::now();
-  auto timeout = currentTime + maxTime_;
-
-  for (int i = 0;
-       !killSwitch_->isSet() && i < maxCount_ && currentTime < timeout;
-       ++i) {
-    buildPublication(pub.get(), currentTime);
-
-    // Check if we have a full batch.  If so move it to the queue and make a new
-    // publication.
-    if (++batchCounter >= batchSize_) {
-      publish(std::move(pub));
-      pub = make_unique<CounterPublication>();
-      pub->hostname = hostname_;
-      batchCounter = 0;
-    }
 
-    // Print out the sampling rate every second
-    rateCalc_.finishedSamples(numCounters_);
-    ++numSamples_;
+  while (!finished(currentTime)) {
+    sampleOnce(currentTime);
 
     // Sleep for the remaining portion of interval
     sleepNs(&currentTime);
   }
 
-  if (batchCounter > 0) {
-    publish(std::move(pub));
+  finish();
+}
+
+SampleLoop::SampleLoop() : thread_([this]() { run(); }) {}
+
+SampleLoop::~SampleLoop() {
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void SampleLoop::addProducer(
+    unique_ptr<SampleProducer> producer,
+    const std::set<CounterRequest>& counters) {
+  SampleGroupKey key(producer->interval().count(), counters);
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    added_.emplace_back(std::move(key), std::move(producer));
+  }
+  cv_.notify_one();
+}
+
+void SampleLoop::addToGroup(
+    SampleGroups* groups,
+    SampleGroupKey key,
+    unique_ptr<SampleProducer> producer) {
+  auto& group = (*groups)[std::move(key)];
+  if (!group.samplers) {
+    // A new group, we sample with the first producer's samplers
+    group.samplers = producer->releaseSamplers();
+    group.nextSampleTime = high_resolution_clock::now();
+  }
+  producer->start(group.nextSampleTime);
+  group.producers.push_back(std::move(producer));
+}
+
+void SampleLoop::sampleGroup(
+    SampleGroup* group,
+    const high_resolution_clock::time_point& now) {
+  CounterPublication sample;
+  SampleProducer::buildPublication(&sample, now, *group->samplers);
+  for (const auto& producer : group->producers) {
+    producer->addSample(sample, now);
+  }
+  group->nextSampleTime = group->producers.front()->nextSampleTime();
+}
+
+void SampleLoop::run() {
+  SampleGroups groups;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> g(lock_);
+      auto wakeUp = [this]() { return stop_ || !added_.empty(); };
+      if (groups.empty()) {
+        cv_.wait(g, wakeUp);
+      } else {
+        // Sampling the groups which were due may have made others late
+        auto now = high_resolution_clock::now();
+        auto nextSampleTime = groups.begin()->second.nextSampleTime;
+        for (const auto& keyAndGroup : groups) {
+          const auto& group = keyAndGroup.second;
+          for (const auto& producer : group.producers) {
+            producer->checkOverload(now);
+          }
+          nextSampleTime = std::min(nextSampleTime, group.nextSampleTime);
+        }
+        cv_.wait_until(g, nextSampleTime, wakeUp);
+      }
+      if (stop_) {
+        break;
+      }
+      for (auto& keyAndProducer : added_) {
+        addToGroup(
+            &groups,
+            std::move(keyAndProducer.first),
+            std::move(keyAndProducer.second));
+      }
+      added_.clear();
+    }
+
+    for (auto iter = groups.begin(); iter != groups.end();) {
+      auto now = high_resolution_clock::now();
+      auto& group = iter->second;
+      auto& producers = group.producers;
+      for (auto producer = producers.begin(); producer != producers.end();) {
+        if ((*producer)->finished(now)) {
+          (*producer)->finish();
+          producer = producers.erase(producer);
+        } else {
+          ++producer;
+        }
+      }
+      if (producers.empty()) {
+        iter = groups.erase(iter);
+        continue;
+      }
+      if (group.nextSampleTime <= now) {
+        sampleGroup(&group, now);
+      }
+      ++iter;
+    }
+  }
+
+  for (auto& keyAndGroup : groups) {
+    for (auto& producer : keyAndGroup.second.producers) {
+      producer->finish();
+    }
   }
 }
 }} // facebook::fboss
@@ -33,11 +33,34 @@
  *  destroyed when the Producer thread exits.  This happens if we pass maxTime,
  *  maxCount, the agent dies, or the killSwitch is activated (because we got an
  *  error on the channel or the collector stopped sending keepalives).
+ *
+ *  Alternatively, the SampleProducer can be handed to a SampleLoop instead of
+ *  getting a thread of its own. A SampleLoop runs any number of producers in
+ *  a single thread, waking up whenever the next one of them is due for a
+ *  sample, so many subscribers cost one thread rather than one each. The
+ *  SampleLoop only sleeps with nanosleep-like waits and can't lower the
+ *  priority of a single subscription, so producers which ask for PAUSE or
+ *  veryNice still get their own thread.
+ *
+ *  Subscriptions in a SampleLoop which ask for the same counters at the same
+ *  interval share their samples: the counters are read once per interval and
+ *  the values are copied into each subscriber's publications. Subscribers
+ *  that can't keep up (their publications are still queued in the event base
+ *  when the next batch is ready) have their batches dropped, rather than
+ *  queueing up more and more samples or holding back other subscribers.
  */
 #pragma once
 
 #include <folly/MoveWrapper.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "fboss/agent/HighresCounterUtil.h"
 #include "fboss/agent/if/gen-cpp2/FbossHighresClient.h"
 
@@ -110,6 +133,13 @@ class SampleSender {
    */
   void initialize() { rateCalc_.initialize(); }
 
+  /*
+   * Reserve a spot in the event base queue for a publication. Fails if too
+   * many of our publications are queued already, i.e. the client (or the
+   * event base) is not keeping up with the samples.
+   */
+  bool tryQueue();
+
   /*
    * Publish the counters back to the duplex client.  This should be called from
    * the event base thread where client_ came from.
@@ -129,6 +159,8 @@ class SampleSender {
   folly::EventBase* const eventBase_;
   SharedRateCalculator rateCalc_;
   const int numCounters_;
+  // Publications scheduled in the event base but not yet sent
+  std::atomic<int> numQueued_{0};
 };
 
 /*
@@ -170,6 +202,54 @@ class SampleProducer {
    */
   void produce();
 
+  /*
+   * The steps of produce(), for running the producer from a SampleLoop:
+   * start() once (optionally with the time its first sample is due), then sampleOnce() at (or after) each nextSampleTime()
+   * until finished(), and finally finish() to publish the last batch.
+   */
+  void start();
+  void start(const std::chrono::high_resolution_clock::time_point& firstSample);
+  bool finished(const std::chrono::high_resolution_clock::time_point& now)
+      const;
+  void sampleOnce(const std::chrono::high_resolution_clock::time_point& now);
+  void finish();
+
+  /*
+   * Add a round of samples taken by someone else, for producers sharing
+   * their samplers. sample holds a single time and one value per counter.
+   */
+  void addSample(
+      const CounterPublication& sample,
+      const std::chrono::high_resolution_clock::time_point& now);
+
+  /*
+   * Give up our samplers, for a SampleLoop to sample on our behalf.
+   */
+  std::unique_ptr<HighresSamplerList> releaseSamplers() {
+    return std::move(samplers_);
+  }
+
+  std::chrono::nanoseconds interval() const {
+    return interval_;
+  }
+
+  /*
+   * Iteratively build the publication by querying all the samplers once
+   */
+  static void buildPublication(
+      CounterPublication* pub,
+      const std::chrono::high_resolution_clock::time_point& time,
+      const HighresSamplerList& samplers);
+  std::chrono::high_resolution_clock::time_point nextSampleTime() const {
+    return nextSampleTime_;
+  }
+
+  /*
+   * Warn (every so often) if it is already past nextSampleTime(), i.e.
+   * taking samples takes longer than the interval.
+   */
+  void checkOverload(const std::chrono::high_resolution_clock::time_point& now);
+
  private:
   // Non-copyable
   SampleProducer(const SampleProducer&) = delete;
@@ -184,10 +264,8 @@ class SampleProducer {
   // executes, start >= start + interval.
   inline void sleepNs(std::chrono::high_resolution_clock::time_point* start);
 
-  // Iteratively build the publication by querying all the samplers once
-  inline void buildPublication(
-      CounterPublication* pub,
-      const std::chrono::high_resolution_clock::time_point& time);
+  // Bookkeeping after a sample was added to pub_
+  void sampleAdded(const std::chrono::high_resolution_clock::time_point& now);
 
   // Schedule the SampleSender in a tm thread
   inline void publish(std::unique_ptr<CounterPublication> pub);
@@ -200,6 +278,10 @@ class SampleProducer {
   std::shared_ptr<SampleSender> sender_;
   folly::EventBase* const eventBase_;
 
+  // The publication we are adding samples to, and how many it has
+  std::unique_ptr<CounterPublication> pub_;
+  int32_t batchCounter_{0};
+
   // For storing information about the subscription
   const std::string hostname_;
   const std::chrono::seconds maxTime_;
@@ -207,12 +289,70 @@ class SampleProducer {
   const std::chrono::nanoseconds interval_;
   const int32_t batchSize_;
   const SleepMethod sleepMethod_;
+  std::chrono::high_resolution_clock::time_point timeout_;
+  std::chrono::high_resolution_clock::time_point nextSampleTime_;
 
   // For keeping track of the rate at which we are processing updates
   SingleThreadRateCalculator rateCalc_;
   const int numCounters_;
-  int numSamples_;
+  int numSamples_{0};
   int overloadWarningCounter_;
   int numSamplesAtLastOverloadWarning_;
+  int numDroppedBatches_{0};
+};
+
+/*
+ * Runs many SampleProducers in one thread. Producers with the same counters
+ * and interval are sampled together, from the samplers of the first one of
+ * them, and each of them is removed (and destroyed) once it is finished.
+ */
+class SampleLoop {
+ public:
+  SampleLoop();
+
+  /*
+   * Stops the loop. Producers which are still running publish the samples
+   * they have so far and are destroyed.
+   */
+  ~SampleLoop();
+
+  /*
+   * Start running a producer. counters are the counters it was created for,
+   * producers asking for the same ones share their samples. It takes its
+   * first sample right away, or with the next sample of the producers it
+   * joins.
+   */
+  void addProducer(std::unique_ptr<SampleProducer> producer,
+                   const std::set<CounterRequest>& counters);
+
+ private:
+  // Non-copyable
+  SampleLoop(const SampleLoop&) = delete;
+  SampleLoop& operator=(const SampleLoop&) = delete;
+
+  // Producers sampling the same counters at the same interval
+  using SampleGroupKey = std::pair<int64_t, std::set<CounterRequest>>;
+  struct SampleGroup {
+    std::unique_ptr<HighresSamplerList> samplers;
+    std::vector<std::unique_ptr<SampleProducer>> producers;
+    std::chrono::high_resolution_clock::time_point nextSampleTime;
+  };
+  using SampleGroups = std::map<SampleGroupKey, SampleGroup>;
+
+  void run();
+  void addToGroup(SampleGroups* groups,
+                  SampleGroupKey key,
+                  std::unique_ptr<SampleProducer> producer);
+  void sampleGroup(SampleGroup* group,
+                   const std::chrono::high_resolution_clock::time_point& now);
+
+  // Producers added since the loop last woke up, and whether to stop
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::vector<std::pair<SampleGroupKey, std::unique_ptr<SampleProducer>>>
+      added_;
+  bool stop_{false};
+
+  std::thread thread_;
 };
 }} // facebook::fboss
@@ -9,6 +9,42 @@
  */
 #include "fboss/agent/HwSwitch.h"
 
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/hw/L2TablePageBuilder.h"
+
 namespace facebook { namespace fboss {
 
+bool HwSwitch::sendPacketsOutOfPortAsync(
+    std::vector<std::unique_ptr<TxPacket>> pkts,
+    PortID portID,
+    folly::Optional<uint8_t> cos) noexcept {
+  bool allSent = true;
+  for (auto& pkt : pkts) {
+    allSent &= sendPacketOutOfPortAsync(std::move(pkt), portID, cos);
+  }
+  return allSent;
+}
+
+void HwSwitch::fetchL2TablePage(
+    const L2TablePageRequest& request,
+    int32_t maxEntries,
+    L2TablePage* page) {
+  std::vector<L2EntryThrift> l2Table;
+  fetchL2Table(&l2Table);
+  L2TablePageBuilder builder(request, maxEntries, page);
+  for (auto& entry : l2Table) {
+    if (builder.onPage(entry.vlanID, entry.port)) {
+      builder.add(std::move(entry));
+    }
+  }
+  builder.finish();
+}
+
+void HwSwitch::traceFlowHashing(
+    const std::vector<FlowTuple>& /* flows */,
+    FlowHashingReport* /* report */) {
+  throw FbossError("packet tracing is not supported by this hardware");
+}
+
 }} // facebook::fboss
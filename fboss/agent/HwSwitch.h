@@ -17,8 +17,12 @@
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
 
+#include <chrono>
 #include <memory>
+#include <string>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace folly{
 struct dynamic;
@@ -38,6 +42,8 @@ struct HwInitResult {
   BootType bootType{BootType::UNINITIALIZED};
   float initializedTime{0.0};
   float bootTime{0.0};
+  // Time spent in named phases of init, published along with bootTime
+  std::vector<std::pair<std::string, float>> initPhaseTimes;
 };
 
 /*
@@ -160,6 +166,18 @@ class HwSwitch {
       PortID portID,
       folly::Optional<uint8_t> cos = folly::none) noexcept = 0;
 
+  /*
+   * Send several packets out the specified port, using VLAN and destination
+   * MAC from each packet. The default implementation sends them one by one,
+   * hardware that can queue a list of packets in one call should override it.
+   *
+   * @return If all the packets are successfully sent to HW.
+   */
+  virtual bool sendPacketsOutOfPortAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      PortID portID,
+      folly::Optional<uint8_t> cos = folly::none) noexcept;
+
   /*
    * Send a packet, use switching logic to send it out the correct port(s)
    * for the specified VLAN and destination MAC.
@@ -203,6 +221,16 @@ class HwSwitch {
 
   virtual void fetchL2Table(std::vector<L2EntryThrift> *l2Table) = 0;
 
+  /*
+   * One page of the L2 table, see L2TablePageBuilder. maxEntries is the
+   * request's, capped and checked. The default fetches the whole table and
+   * keeps the page out of it.
+   */
+  virtual void fetchL2TablePage(
+      const L2TablePageRequest& request,
+      int32_t maxEntries,
+      L2TablePage* page);
+
   /*
    * Allow hardware to perform any warm boot related cleanup
    * before we exit the application.
@@ -255,6 +283,42 @@ class HwSwitch {
   virtual bool getAndClearNeighborHit(RouterID vrf,
                                       folly::IPAddress& ip) = 0;
 
+  /*
+   * Returns all the arp/ndp entries in vrf which have been hit since the last
+   * call, and clears their hit bits, in a single pass over the hardware
+   * table. Returns folly::none if the hardware can't do this, in which case
+   * callers should fall back to getAndClearNeighborHit().
+   */
+  virtual folly::Optional<std::unordered_set<folly::IPAddress>>
+  getAndClearNeighborHits(RouterID /* vrf */) {
+    return folly::none;
+  }
+
+  /*
+   * Buffer occupancy and microbursts of the queues the hardware monitors,
+   * over the last window. Leaves stats empty if nothing is monitored.
+   */
+  virtual void getQueueBufferStats(
+      std::vector<QueueBufferStats>* /* stats */,
+      std::chrono::seconds /* window */) const {}
+
+  /*
+   * The ECMP groups whose traffic is spread the least evenly over their
+   * members, worst first, at most maxGroups of them. Leaves groups empty if
+   * the hardware doesn't measure this.
+   */
+  virtual void getEcmpBalance(
+      std::vector<EcmpGroupBalance>* /* groups */,
+      size_t /* maxGroups */) const {}
+
+  /*
+   * Trace how the hardware hashes each of the flows over the ports it could
+   * send them out of. Throws if the hardware can't trace packets.
+   */
+  virtual void traceFlowHashing(
+      const std::vector<FlowTuple>& flows,
+      FlowHashingReport* report);
+
   /*
    * Clear port stats for specified port
    */
@@ -19,10 +19,13 @@
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/HwSwitch.h"
 #include "fboss/agent/IPHeaderV4.h"
+#include "fboss/agent/LocalAddressCache.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/PendingNeighborQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/RxPacket.h"
+#include "fboss/agent/SlowPathRouteCache.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/TxPacket.h"
@@ -120,6 +123,7 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
 
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
   stats->port(port)->ipv4Rx();
+  const Cursor l3Start(cursor);
   IPv4Hdr v4Hdr(cursor);
   XLOG(DBG4) << "Rx IPv4 packet (" << l3Len << " bytes) " << v4Hdr.srcAddr.str()
              << " --> " << v4Hdr.dstAddr.str() << " proto: 0x" << std::hex
@@ -157,10 +161,10 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
   // Get the Interface to which this packet should be forwarded in host
   // TODO: assume vrf 0 now
   std::shared_ptr<Interface> intf{nullptr};
-  auto interfaceMap = state->getInterfaces();
+  auto localAddrs = sw_->getLocalAddressCache()->get(state);
   if (v4Hdr.dstAddr.isMulticast()) {
     // Forward multicast packet directly to corresponding host interface
-    intf = interfaceMap->getInterfaceInVlanIf(pkt->getSrcVlan());
+    intf = localAddrs->getInterfaceInVlan(pkt->getSrcVlan());
   } else if (v4Hdr.dstAddr.isLinkLocal()) {
     // XXX: Ideally we should scope the limit to Link only. However we are
     // using v4 link locals in a special way on Galaxy/6pack which needs because
@@ -172,10 +176,10 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
     // if (not intf->hasAddress(v4Hdr.dstAddr)) {
     //   intf = nullptr;
     // }
-    intf = interfaceMap->getInterfaceIf(RouterID(0), v4Hdr.dstAddr);
+    intf = localAddrs->getInterface(RouterID(0), v4Hdr.dstAddr);
   } else {
     // Else loopup host interface based on destAddr
-    intf = interfaceMap->getInterfaceIf(RouterID(0), v4Hdr.dstAddr);
+    intf = localAddrs->getInterface(RouterID(0), v4Hdr.dstAddr);
   }
 
   if (intf) {
@@ -200,6 +204,11 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
     XLOG(DBG4) << "Rx IPv4 Packet with TTL expired";
     stats->port(port)->pktDropped();
     stats->port(port)->ipv4TtlExceeded();
+    // Check the rate limit before building anything
+    if (!sw_->admitIcmpError(port, src, IPAddress(v4Hdr.srcAddr))) {
+      stats->ipv4IcmpErrorSuppressed();
+      return;
+    }
     // Look up cpu mac from platform
     MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
     sendICMPTimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, v4Hdr, cursor);
@@ -220,68 +229,60 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
   // We will need to manage the rate somehow. Either from HW
   // or a SW control here
   stats->port(port)->ipv4Nexthop();
-  if (!resolveMac(state.get(), port, v4Hdr.dstAddr)) {
+  if (!resolveMac(state, port, v4Hdr.dstAddr, &l3Start, v4Hdr.length)) {
     stats->port(port)->ipv4NoArp();
     XLOG(DBG4) << "Cannot find the interface to send out ARP request for "
                << v4Hdr.dstAddr.str();
   }
-  // TODO: ideally, we need to store this packet until the ARP is done and
-  // then send this pkt out. For now, just drop it.
+  // The PendingNeighborQueue may hold a copy of the packet until the next hop
+  // resolves, but the trapped packet itself goes no further.
   stats->port(port)->pktDropped();
 }
 
 // Return true if we successfully sent an ARP request, false otherwise
 bool IPv4Handler::resolveMac(
-    SwitchState* state,
+    const std::shared_ptr<SwitchState>& state,
     PortID ingressPort,
-    IPAddressV4 dest) {
+    IPAddressV4 dest,
+    const Cursor* l3Pkt,
+    uint32_t l3Len) {
   // need to find out our own IP and MAC addresses so that we can send the
   // ARP request out. Since the request will be broadcast, there is no need to
   // worry about which port to send the packet out.
-
-  // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
-    throw FbossError("No routing tables found");
-  }
-
-  auto route = routeTable->getRibV4()->longestMatch(dest);
-  if (!route || !route->isResolved()) {
+  auto nhs = sw_->getSlowPathRouteCache()->getNextHops(state, dest);
+  if (!nhs) {
     sw_->portStats(ingressPort)->ipv4DstLookupFailure();
     // No way to reach dest
     return false;
   }
 
-  auto intfs = state->getInterfaces();
-  auto nhs = route->getForwardInfo().getNextHopSet();
+  auto pending = sw_->getPendingNeighborQueue();
   auto sent = false;
-  for (auto nh : nhs) {
-    auto intf = intfs->getInterfaceIf(nh.intf());
-    if (intf) {
-      auto source = intf->getAddressToReach(nh.addr())->first.asV4();
-      auto target = route->isConnected() ? dest : nh.addr().asV4();
-      if (source == target) {
-        // This packet is for us.  Don't send ARP requess for our own IP.
-        continue;
-      }
-
-      auto vlanID = intf->getVlanID();
-      auto vlan = state->getVlans()->getVlanIf(vlanID);
-      if (vlan) {
-        auto entry = vlan->getArpTable()->getEntryIf(target);
-        if (entry == nullptr) {
-          // No entry in ARP table, send ARP request
-          auto mac = intf->getMac();
-          ArpHandler::sendArpRequest(sw_, vlanID, mac, source, target);
+  auto queued = false;
+  for (const auto& nh : *nhs) {
+    auto vlan = state->getVlans()->getVlanIf(nh.vlan);
+    if (vlan) {
+      auto entry = vlan->getArpTable()->getEntryIf(nh.target);
+      if (entry == nullptr) {
+        // No entry in ARP table, send ARP request unless we just did and
+        // the pending entry isn't in the state yet
+        if (pending->startSolicitation(nh.vlan, nh.target)) {
+          ArpHandler::sendArpRequest(
+              sw_, nh.vlan, nh.intfMac, nh.source, nh.target);
 
           // Notify the updater that we sent an arp request
-          sw_->getNeighborUpdater()->sentArpRequest(vlanID, target);
-          sent = true;
-        } else {
-          XLOG(DBG4) << "not sending arp for " << target.str() << ", "
-                     << ((entry->isPending()) ? "pending " : "")
-                     << "entry already exists";
+          sw_->getNeighborUpdater()->sentArpRequest(nh.vlan, nh.target);
         }
+        sent = true;
+      } else {
+        XLOG(DBG4) << "not sending arp for " << nh.target.str() << ", "
+                   << ((entry->isPending()) ? "pending " : "")
+                   << "entry already exists";
+      }
+      // Hold on to the packet until the first next hop left to resolve
+      // does
+      if (l3Pkt && !queued && (!entry || entry->isPending())) {
+        queued = pending->enqueue(nh.vlan, nh.target, *l3Pkt, l3Len);
       }
     }
   }
@@ -40,12 +40,21 @@ class IPv4Handler {
                     folly::io::Cursor cursor);
 
   /*
+   * Send ARP requests for the next hops towards dest that aren't resolved.
+   * Returns true if a request was sent, or one sent recently is still
+   * outstanding.
+   *
+   * If l3Pkt is set, a copy of the l3Len bytes of the IPv4 packet it points
+   * to is queued in the PendingNeighborQueue until the next hop resolves.
+   *
    * TODO(aeckert): t17949183 unify packet handling pipeline and then
    * make this private again.
    */
-  bool resolveMac(SwitchState* state,
+  bool resolveMac(const std::shared_ptr<SwitchState>& state,
                   PortID ingressPort,
-                  folly::IPAddressV4 dest);
+                  folly::IPAddressV4 dest,
+                  const folly::io::Cursor* l3Pkt = nullptr,
+                  uint32_t l3Len = 0);
 
  private:
   void sendICMPTimeExceeded(VlanID srcVlan,
@@ -14,9 +14,12 @@
 #include <folly/logging/xlog.h>
 #include "fboss/agent/DHCPv6Handler.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/LocalAddressCache.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/PendingNeighborQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/RxPacket.h"
+#include "fboss/agent/SlowPathRouteCache.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/TxPacket.h"
@@ -90,17 +93,22 @@ IPv6Handler::IPv6Handler(SwSwitch* sw)
       sw_(sw) {
 }
 
+IPv6Handler::~IPv6Handler() {
+  // The advertisers send their last RAs through the scheduler
+  routeAdvertisers_.clear();
+  if (raScheduler_) {
+    IPv6RAScheduler::destroy(raScheduler_);
+  }
+}
+
 void IPv6Handler::stateUpdated(const StateDelta& delta) {
   for (const auto& entry : delta.getIntfsDelta()) {
     if (!entry.getOld()) {
-      intfAdded(delta.newState().get(), entry.getNew().get());
+      intfAdded(entry.getNew());
     } else if (!entry.getNew()) {
       intfDeleted(entry.getOld().get());
     } else {
-      // TODO: We could add an intfChanged() method to re-use the existing
-      // IPv6RouteAdvertiser object.
-      intfDeleted(entry.getOld().get());
-      intfAdded(delta.newState().get(), entry.getNew().get());
+      intfChanged(entry.getOld().get(), entry.getNew());
     }
   }
 }
@@ -109,18 +117,42 @@ bool IPv6Handler::raEnabled(const Interface* intf) const {
   return intf->getNdpConfig().routerAdvertisementSeconds > 0;
 }
 
-void IPv6Handler::intfAdded(const SwitchState* state, const Interface* intf) {
-  // If IPv6 router advertisement isn't enabled on this interface, ignore it.
-  if (!raEnabled(intf)) {
+void IPv6Handler::intfAdded(const std::shared_ptr<Interface>& intf) {
+  auto ra = setRATemplate(intf);
+  // If IPv6 router advertisement isn't enabled on this interface, we only
+  // answer solicitations.
+  if (!raEnabled(intf.get())) {
     return;
   }
 
-  IPv6RouteAdvertiser adv(sw_, state, intf);
+  if (!raScheduler_) {
+    raScheduler_ = new IPv6RAScheduler(sw_);
+  }
+  IPv6RouteAdvertiser adv(raScheduler_, std::move(ra));
   auto ret = routeAdvertisers_.emplace(intf->getID(), std::move(adv));
   CHECK(ret.second);
 }
 
+void IPv6Handler::intfChanged(
+    const Interface* oldIntf,
+    const std::shared_ptr<Interface>& newIntf) {
+  if (!raEnabled(oldIntf) || !raEnabled(newIntf.get())) {
+    intfDeleted(oldIntf);
+    intfAdded(newIntf);
+    return;
+  }
+  // Keep advertising on the same schedule, with the RA of the new interface
+  auto ra = setRATemplate(newIntf);
+  auto it = routeAdvertisers_.find(newIntf->getID());
+  CHECK(it != routeAdvertisers_.end());
+  it->second.update(std::move(ra));
+}
+
 void IPv6Handler::intfDeleted(const Interface* intf) {
+  {
+    std::lock_guard<std::mutex> g(raTemplatesLock_);
+    raTemplates_.erase(intf->getID());
+  }
   if (!raEnabled(intf)) {
     return;
   }
@@ -128,11 +160,34 @@ void IPv6Handler::intfDeleted(const Interface* intf) {
   CHECK_EQ(numErased, 1);
 }
 
+std::shared_ptr<const RouteAdvertisementTemplate> IPv6Handler::setRATemplate(
+    const std::shared_ptr<Interface>& intf) {
+  auto ra = std::make_shared<const RouteAdvertisementTemplate>(intf);
+  std::lock_guard<std::mutex> g(raTemplatesLock_);
+  raTemplates_[intf->getID()] = ra;
+  return ra;
+}
+
+std::shared_ptr<const RouteAdvertisementTemplate> IPv6Handler::getRATemplate(
+    const std::shared_ptr<Interface>& intf) const {
+  {
+    std::lock_guard<std::mutex> g(raTemplatesLock_);
+    auto it = raTemplates_.find(intf->getID());
+    // The template is only good for the interface it was built from, and the
+    // update thread may not have caught up with our state yet
+    if (it != raTemplates_.end() && it->second->getInterface() == intf.get()) {
+      return it->second;
+    }
+  }
+  return std::make_shared<const RouteAdvertisementTemplate>(intf);
+}
+
 void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
                                MacAddress dst,
                                MacAddress src,
                                Cursor cursor) {
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
+  const Cursor l3Start(cursor);
   IPv6Hdr ipv6(cursor);  // note: advances our cursor object
   XLOG(DBG4) << "IPv6 (" << l3Len
              << " bytes)"
@@ -172,22 +227,22 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
   //    address that is supposed to be generated by default, we do not handle
   //    it now.
   std::shared_ptr<Interface> intf{nullptr};
-  auto interfaceMap = state->getInterfaces();
+  auto localAddrs = sw_->getLocalAddressCache()->get(state);
   if (ipv6.dstAddr.isMulticast()) {
     // Forward multicast packet directly to corresponding host interface
     // and let Linux handle it. In software we consume ICMPv6 Multicast
     // packets for function of NDP protocol, rest all are forwarded to host.
-    intf = interfaceMap->getInterfaceInVlanIf(pkt->getSrcVlan());
+    intf = localAddrs->getInterfaceInVlan(pkt->getSrcVlan());
   } else if (ipv6.dstAddr.isLinkLocal()) {
     // Forward link-local packet directly to corresponding host interface
     // provided desAddr is assigned to that interface.
-    intf = interfaceMap->getInterfaceInVlanIf(pkt->getSrcVlan());
-    if (not intf->hasAddress(ipv6.dstAddr)) {
+    intf = localAddrs->getInterfaceInVlan(pkt->getSrcVlan());
+    if (intf && not intf->hasAddress(ipv6.dstAddr)) {
       intf = nullptr;
     }
   } else {
     // Else loopup host interface based on destAddr
-    intf = interfaceMap->getInterfaceIf(RouterID(0), ipv6.dstAddr);
+    intf = localAddrs->getInterface(RouterID(0), ipv6.dstAddr);
   }
 
   // If the packet is destined to us, accept packets
@@ -198,6 +253,11 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
     XLOG(DBG4) << "Rx IPv6 Packet with hop limit exceeded";
     sw_->portStats(port)->pktDropped();
     sw_->portStats(port)->ipv6HopExceeded();
+    // Check the rate limit before building anything
+    if (!sw_->admitIcmpError(port, src, folly::IPAddress(ipv6.srcAddr))) {
+      sw_->stats()->ipv6IcmpErrorSuppressed();
+      return;
+    }
     // Look up cpu mac from platform
     MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
     sendICMPv6TimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, ipv6, cursor);
@@ -236,9 +296,10 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
   if (!ipv6.dstAddr.isMulticast() && !ipv6.dstAddr.isLinkLocalBroadcast()) {
     // If IP is not multicast or linklocal broadcast, we need to resolve the IP
     // for this packet.
-    // TODO: Add rate limiting so we don't generate too many requests for the
-    // same IP.  Following the rules in RFC 4861 should be sufficient.
-    resolveDestAndHandlePacket(ipv6, std::move(pkt), dst, src, cursor);
+    // PendingNeighborQueue keeps us from soliciting the same IP again until
+    // the previous solicitation times out.
+    resolveDestAndHandlePacket(
+        ipv6, std::move(pkt), dst, src, cursor, l3Start);
   }
 }
 
@@ -328,11 +389,7 @@ void IPv6Handler::handleRouterSolicitation(unique_ptr<RxPacket> pkt,
   XLOG(DBG4) << "sending router advertisement in response to solicitation from "
              << dstIP.str() << " (" << dstMac << ")";
 
-  uint32_t pktLen = IPv6RouteAdvertiser::getPacketSize(intf.get());
-  auto resp = sw_->allocatePacket(pktLen);
-  RWPrivateCursor respCursor(resp->buf());
-  IPv6RouteAdvertiser::createAdvertisementPacket(
-    intf.get(), &respCursor, dstMac, dstIP);
+  auto resp = getRATemplate(intf)->createPacket(sw_, dstMac, dstIP);
   sw_->sendPacketSwitchedAsync(std::move(resp));
 }
 
@@ -420,7 +477,8 @@ void IPv6Handler::handleNeighborSolicitation(unique_ptr<RxPacket> pkt,
     return;
   }
 
-  auto entry = vlan->getNdpResponseTable()->getEntry(targetIP);
+  auto localAddrs = sw_->getLocalAddressCache()->get(state);
+  auto entry = localAddrs->getNdpResponse(vlan->getID(), targetIP);
   if (ndpOptions.sourceLinkLayerAddress.hasValue()) {
     /* rfc 4861 - if the source address is not the unspecified address and,
     on link layers that have addresses, the solicitation includes a Source
@@ -453,7 +511,7 @@ void IPv6Handler::handleNeighborSolicitation(unique_ptr<RxPacket> pkt,
   // Send the response
   sendNeighborAdvertisement(
       pkt->getSrcVlan(),
-      entry.value().mac,
+      entry->mac,
       targetIP,
       hdr.src,
       hdr.ipv6->srcAddr);
@@ -505,7 +563,8 @@ void IPv6Handler::handleNeighborAdvertisement(unique_ptr<RxPacket> pkt,
   auto type = ICMPv6Type::ICMPV6_TYPE_NDP_NEIGHBOR_ADVERTISEMENT;
 
   // Check to see if this IP address is in our NDP response table.
-  auto entry = vlan->getNdpResponseTable()->getEntry(hdr.ipv6->dstAddr);
+  auto localAddrs = sw_->getLocalAddressCache()->get(state);
+  auto entry = localAddrs->getNdpResponse(vlan->getID(), hdr.ipv6->dstAddr);
   if (!entry) {
     updater->receivedNdpNotMine(vlan->getID(), targetIP, hdr.src,
                                 PortDescriptor::fromRxPacket(*pkt.get()),
@@ -569,6 +628,11 @@ void IPv6Handler::sendICMPv6PacketTooBig(
     IPv6Hdr& v6Hdr,
     int expectedMtu,
     folly::io::Cursor cursor) {
+  // dst is the MAC of the host that sent the packet
+  if (!sw_->admitIcmpError(srcPort, dst, folly::IPAddress(v6Hdr.srcAddr))) {
+    sw_->stats()->ipv6IcmpErrorSuppressed();
+    return;
+  }
   auto state = sw_->getState();
 
   // payload serialization function
@@ -702,76 +766,71 @@ void IPv6Handler::resolveDestAndHandlePacket(
     unique_ptr<RxPacket> pkt,
     MacAddress dst,
     MacAddress src,
-    Cursor cursor) {
+    Cursor cursor,
+    Cursor l3Start) {
   // Right now this either responds with PTB or generate neighbor soliciations
   auto ingressPort = pkt->getSrcPort();
   auto targetIP = hdr.dstAddr;
   auto state = sw_->getState();
 
   // resolve the destination.
-  // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
-    return;
-  }
-
-  auto route = routeTable->getRibV6()->longestMatch(targetIP);
-  if (!route || !route->isResolved()) {
+  auto nexthops = sw_->getSlowPathRouteCache()->getNextHops(state, targetIP);
+  if (!nexthops) {
     sw_->portStats(ingressPort)->ipv6DstLookupFailure();
     // No way to reach targetIP
     return;
   }
 
-  auto interfaces = state->getInterfaces();
-  auto nexthops = route->getForwardInfo().getNextHopSet();
+  auto pending = sw_->getPendingNeighborQueue();
+  auto queued = false;
 
-  for (auto nexthop : nexthops) {
-    // get interface needed to reach next hop
-    auto intf = interfaces->getInterfaceIf(nexthop.intf());
-    if (intf) {
-      // what should be source & destination of packet
-      auto source = intf->getAddressToReach(nexthop.addr())->first.asV6();
-      auto target = route->isConnected() ? targetIP : nexthop.addr().asV6();
-
-      if (source == target) {
-        // This packet is for us.  Don't generate PTB or NDP request.
-        continue;
-      }
-
-      if (hdr.payloadLength > intf->getMtu()) {
-        // Generate PTB as interface to next hop has MTU smaller than payload
-        sendICMPv6PacketTooBig(
-            ingressPort,
-            pkt->getSrcVlan(),
-            src,
-            dst,
-            hdr,
-            intf->getMtu(),
-            cursor);
-        sw_->portStats(ingressPort)->pktDropped();
-        return;
-      } else {
-        // Check if destination is unknown, in which case trigger NDP
-        auto vlanID = intf->getVlanID();
-        auto vlan = state->getVlans()->getVlanIf(vlanID);
-        if (vlan) {
-          auto entry = vlan->getNdpTable()->getEntryIf(target);
-          if (nullptr == entry) {
-            // No entry in NDP table, create a neighbor solicitation packet
-            sendMulticastNeighborSolicitation(
-                sw_, target, intf->getMac(), vlan->getID());
-            // Notify the updater that we sent a solicitation out
-            sw_->getNeighborUpdater()->sentNeighborSolicitation(vlanID, target);
-          } else {
-            XLOG(DBG5) << "not sending neighbor solicitation for "
-                       << target.str() << ", "
-                       << ((entry->isPending()) ? "pending" : "")
-                       << " entry already exists";
-          }
+  for (const auto& nexthop : *nexthops) {
+    if (hdr.payloadLength > nexthop.intfMtu) {
+      // Generate PTB as interface to next hop has MTU smaller than payload
+      sendICMPv6PacketTooBig(
+          ingressPort,
+          pkt->getSrcVlan(),
+          src,
+          dst,
+          hdr,
+          nexthop.intfMtu,
+          cursor);
+      sw_->portStats(ingressPort)->pktDropped();
+      return;
+    }
+    // Check if destination is unknown, in which case trigger NDP
+    auto vlan = state->getVlans()->getVlanIf(nexthop.vlan);
+    if (vlan) {
+      auto entry = vlan->getNdpTable()->getEntryIf(nexthop.target);
+      if (nullptr == entry) {
+        // No entry in NDP table, create a neighbor solicitation packet
+        // unless we just did and the pending entry isn't in the state yet
+        if (pending->startSolicitation(nexthop.vlan, nexthop.target)) {
+          sendMulticastNeighborSolicitation(
+              sw_, nexthop.target, nexthop.intfMac, nexthop.vlan);
+          // Notify the updater that we sent a solicitation out
+          sw_->getNeighborUpdater()->sentNeighborSolicitation(
+              nexthop.vlan, nexthop.target);
         }
+      } else {
+        XLOG(DBG5) << "not sending neighbor solicitation for "
+                   << nexthop.target.str() << ", "
+                   << ((entry->isPending()) ? "pending" : "")
+                   << " entry already exists";
+      }
+      // Hold on to the packet until the first next hop left to resolve
+      // does
+      if (!queued && (!entry || entry->isPending())) {
+        queued = pending->enqueue(
+            nexthop.vlan,
+            nexthop.target,
+            l3Start,
+            IPv6Hdr::SIZE + hdr.payloadLength);
       }
     }
   }
+  // The PendingNeighborQueue may hold a copy of the packet until the next hop
+  // resolves, but the trapped packet itself goes no further.
   sw_->portStats(pkt)->pktDropped();
 } // namespace fboss
 
@@ -784,48 +843,30 @@ void IPv6Handler::sendMulticastNeighborSolicitations(
   }
 
   auto state = sw_->getState();
-
-  // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
-    return;
-  }
-
-  auto route = routeTable->getRibV6()->longestMatch(targetIP);
-  if (!route || !route->isResolved()) {
+  auto nhs = sw_->getSlowPathRouteCache()->getNextHops(state, targetIP);
+  if (!nhs) {
     sw_->portStats(ingressPort)->ipv6DstLookupFailure();
     // No way to reach targetIP
     return;
   }
 
-  auto intfs = state->getInterfaces();
-  auto nhs = route->getForwardInfo().getNextHopSet();
-  for (auto nh : nhs) {
-    auto intf = intfs->getInterfaceIf(nh.intf());
-    if (intf) {
-      auto source = intf->getAddressToReach(nh.addr())->first.asV6();
-      auto target = route->isConnected() ? targetIP : nh.addr().asV6();
-      if (source == target) {
-        // This packet is for us.  Don't send NDP requests to ourself.
-        continue;
-      }
-
-      auto vlanID = intf->getVlanID();
-      auto vlan = state->getVlans()->getVlanIf(vlanID);
-      if (vlan) {
-        auto entry = vlan->getNdpTable()->getEntryIf(target);
-        if (entry == nullptr) {
-          // No entry in NDP table, create a neighbor solicitation packet
-          sendMulticastNeighborSolicitation(
-              sw_, target, intf->getMac(), vlan->getID());
+  for (const auto& nh : *nhs) {
+    auto vlan = state->getVlans()->getVlanIf(nh.vlan);
+    if (vlan) {
+      auto entry = vlan->getNdpTable()->getEntryIf(nh.target);
+      if (entry == nullptr) {
+        // No entry in NDP table, create a neighbor solicitation packet
+        sendMulticastNeighborSolicitation(
+            sw_, nh.target, nh.intfMac, nh.vlan);
 
-          // Notify the updater that we sent a solicitation out
-          sw_->getNeighborUpdater()->sentNeighborSolicitation(vlanID, target);
-        } else {
-          XLOG(DBG5) << "not sending neighbor solicitation for " << target.str()
-                     << ", " << ((entry->isPending()) ? "pending" : "")
-                     << " entry already exists";
-        }
+        // Notify the updater that we sent a solicitation out
+        sw_->getNeighborUpdater()->sentNeighborSolicitation(
+            nh.vlan, nh.target);
+      } else {
+        XLOG(DBG5) << "not sending neighbor solicitation for "
+                   << nh.target.str() << ", "
+                   << ((entry->isPending()) ? "pending" : "")
+                   << " entry already exists";
       }
     }
   }
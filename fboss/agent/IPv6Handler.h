@@ -16,6 +16,7 @@
 #include "fboss/agent/types.h"
 
 #include <memory>
+#include <mutex>
 #include <boost/container/flat_map.hpp>
 #include <folly/IPAddressV6.h>
 #include <folly/MacAddress.h>
@@ -38,6 +39,7 @@ class IPv6Handler : public AutoRegisterStateObserver {
   enum : uint32_t { IPV6_MIN_MTU = 1280 };
 
   explicit IPv6Handler(SwSwitch* sw);
+  ~IPv6Handler() override;
 
   void stateUpdated(const StateDelta& delta) override;
 
@@ -94,9 +96,19 @@ class IPv6Handler : public AutoRegisterStateObserver {
   IPv6Handler& operator=(IPv6Handler const &) = delete;
 
   bool raEnabled(const Interface* intf) const;
-  void intfAdded(const SwitchState* state, const Interface* intf);
+  void intfAdded(const std::shared_ptr<Interface>& intf);
+  void intfChanged(
+      const Interface* oldIntf,
+      const std::shared_ptr<Interface>& newIntf);
   void intfDeleted(const Interface* intf);
 
+  // Build and cache the RA of an interface
+  std::shared_ptr<const RouteAdvertisementTemplate> setRATemplate(
+      const std::shared_ptr<Interface>& intf);
+  // The cached RA of an interface, or a new one if it is out of date
+  std::shared_ptr<const RouteAdvertisementTemplate> getRATemplate(
+      const std::shared_ptr<Interface>& intf) const;
+
   void sendICMPv6TimeExceeded(VlanID srcVlan,
                               folly::MacAddress dst,
                               folly::MacAddress src,
@@ -155,7 +167,8 @@ class IPv6Handler : public AutoRegisterStateObserver {
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress dst,
       folly::MacAddress src,
-      folly::io::Cursor cursor);
+      folly::io::Cursor cursor,
+      folly::io::Cursor l3Start);
 
   static void sendNeighborSolicitation(
       SwSwitch* sw,
@@ -170,7 +183,16 @@ class IPv6Handler : public AutoRegisterStateObserver {
       const NDPOptions& options = NDPOptions());
 
   SwSwitch* sw_{nullptr};
+  // Created with the first advertiser, owned by the background thread
+  IPv6RAScheduler* raScheduler_{nullptr};
   RAMap routeAdvertisers_;
+  // The RAs of all the interfaces, used to answer solicitations from the
+  // packet threads
+  mutable std::mutex raTemplatesLock_;
+  boost::container::flat_map<
+      InterfaceID,
+      std::shared_ptr<const RouteAdvertisementTemplate>>
+      raTemplates_;
 };
 
 }} // facebook::fboss
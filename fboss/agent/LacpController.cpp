@@ -27,9 +27,9 @@ LacpController::LacpController(
     folly::EventBase* evb,
     LacpServicerIf* servicer)
     : portID_(portID),
-      tx_(*this, evb, servicer),
-      rx_(*this, evb),
-      periodicTx_(*this, evb),
+      tx_(*this, servicer),
+      rx_(*this),
+      periodicTx_(*this),
       mux_(*this, evb, servicer),
       selector_(*this),
       evb_(evb),
@@ -52,9 +52,9 @@ LacpController::LacpController(
       portID_(portID),
       portPriority_(portPriority),
       systemPriority_(systemPriority),
-      tx_(*this, evb, servicer),
-      rx_(*this, evb),
-      periodicTx_(*this, evb),
+      tx_(*this, servicer),
+      rx_(*this),
+      periodicTx_(*this),
       mux_(*this, evb, servicer),
       selector_(*this, minLinkCount),
       evb_(evb),
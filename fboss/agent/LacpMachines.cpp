@@ -141,10 +141,8 @@ std::ostream& operator<<(std::ostream& out, MuxMachine::MuxState s) {
 const std::chrono::seconds ReceiveMachine::FAST_EPOCH_DURATION(3);
 const std::chrono::seconds ReceiveMachine::SLOW_EPOCH_DURATION(90);
 
-ReceiveMachine::ReceiveMachine(
-    LacpController& controller,
-    folly::EventBase* evb)
-    : folly::AsyncTimeout(evb), controller_(controller) {}
+ReceiveMachine::ReceiveMachine(LacpController& controller)
+    : controller_(controller) {}
 
 ReceiveMachine::~ReceiveMachine() {}
 
@@ -315,7 +313,7 @@ void ReceiveMachine::recordPDU(LACPDU& lacpdu) {
 }
 
 void ReceiveMachine::startNextEpoch(std::chrono::seconds duration) {
-  scheduleTimeout(duration);
+  controller_.evb()->timer().scheduleTimeout(this, duration);
 }
 
 void ReceiveMachine::endThisEpoch() {
@@ -367,9 +365,8 @@ const std::chrono::seconds PeriodicTransmissionMachine::SHORT_PERIOD(1);
 const std::chrono::seconds PeriodicTransmissionMachine::LONG_PERIOD(30);
 
 PeriodicTransmissionMachine::PeriodicTransmissionMachine(
-    LacpController& controller,
-    folly::EventBase* evb)
-    : folly::AsyncTimeout(evb), controller_(controller) {}
+    LacpController& controller)
+    : controller_(controller) {}
 
 PeriodicTransmissionMachine::~PeriodicTransmissionMachine() {}
 
@@ -401,12 +398,12 @@ void PeriodicTransmissionMachine::beginNextPeriod() {
     case PeriodicState::SLOW:
       XLOG(DBG4) << "PeriodicTransmissionMachine[" << controller_.portID()
                  << "]: scheduling timeout for long period";
-      scheduleTimeout(LONG_PERIOD);
+      controller_.evb()->timer().scheduleTimeout(this, LONG_PERIOD);
       break;
     case PeriodicState::FAST:
       XLOG(DBG4) << "PeriodicTransmissionMachine[" << controller_.portID()
                  << "]: scheduling timeout for short period";
-      scheduleTimeout(SHORT_PERIOD);
+      controller_.evb()->timer().scheduleTimeout(this, SHORT_PERIOD);
       break;
     case PeriodicState::NONE:
       XLOG(DBG4) << "PeriodicTransmissionMachine[" << controller_.portID()
@@ -458,34 +455,37 @@ const int TransmitMachine::MAX_TRANSMISSIONS_IN_SHORT_PERIOD = 3;
 
 TransmitMachine::TransmitMachine(
     LacpController& controller,
-    folly::EventBase* evb,
     LacpServicerIf* servicer)
-    : folly::AsyncTimeout(evb), controller_(controller), servicer_(servicer) {}
+    : controller_(controller), servicer_(servicer) {}
 
 TransmitMachine::~TransmitMachine() {}
 
 void TransmitMachine::start() {
-  scheduleTimeout(TransmitMachine::TX_REPLENISH_RATE);
+  lastReplenished_ = std::chrono::steady_clock::now();
 }
 
-void TransmitMachine::stop() {
-  cancelTimeout();
-}
+void TransmitMachine::stop() {}
 
-void TransmitMachine::timeoutExpired() noexcept {
-  replenishTranmissionsLeft();
-}
-
-void TransmitMachine::replenishTranmissionsLeft() noexcept {
-  transmissionsLeft_ = std::min(
-      transmissionsLeft_ + 1,
-      TransmitMachine::MAX_TRANSMISSIONS_IN_SHORT_PERIOD);
-  scheduleTimeout(TransmitMachine::TX_REPLENISH_RATE);
+void TransmitMachine::replenishTranmissionsLeft(
+    std::chrono::steady_clock::time_point now) {
+  auto periods = (now - lastReplenished_) / TransmitMachine::TX_REPLENISH_RATE;
+  if (periods <= 0) {
+    return;
+  }
+  if (transmissionsLeft_ + periods >=
+      TransmitMachine::MAX_TRANSMISSIONS_IN_SHORT_PERIOD) {
+    transmissionsLeft_ = TransmitMachine::MAX_TRANSMISSIONS_IN_SHORT_PERIOD;
+    lastReplenished_ = now;
+  } else {
+    transmissionsLeft_ += periods;
+    lastReplenished_ += periods * TransmitMachine::TX_REPLENISH_RATE;
+  }
 }
 
 void TransmitMachine::ntt(LACPDU lacpdu) {
   CHECK(controller_.evb()->inRunningEventBaseThread());
 
+  replenishTranmissionsLeft(std::chrono::steady_clock::now());
   if (transmissionsLeft_ == 0) {
     // TODO(samank): figure out stale ntt details
     XLOG(DBG4) << "TransmitMachine[" << controller_.portID() << "]: "
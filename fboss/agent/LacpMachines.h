@@ -10,6 +10,7 @@
 #pragma once
 
 #include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/HHWheelTimer.h>
 #include <folly/Optional.h>
 
 #include <boost/container/flat_map.hpp>
@@ -29,11 +30,16 @@ class LacpServicerIf;
 
 /*
  * See IEEE 802.3AD-2000 43.4.3 for an overview of each state machine
+ *
+ * The receive and periodic transmission machines of every port are armed and
+ * re-armed continuously, so they share the LACP EventBase's timer wheel
+ * rather than each owning an AsyncTimeout. Ports due in the same tick are
+ * then all serviced in a single wakeup.
  */
 
-class ReceiveMachine : private folly::AsyncTimeout {
+class ReceiveMachine : private folly::HHWheelTimer::Callback {
  public:
-  explicit ReceiveMachine(LacpController& controller, folly::EventBase* evb);
+  explicit ReceiveMachine(LacpController& controller);
   ~ReceiveMachine() override;
 
   // thread-safe
@@ -70,6 +76,7 @@ class ReceiveMachine : private folly::AsyncTimeout {
 
   // Timer-related
   void timeoutExpired() noexcept override;
+  void callbackCanceled() noexcept override {}
   void startNextEpoch(std::chrono::seconds duration);
   void endThisEpoch();
 
@@ -94,11 +101,9 @@ class ReceiveMachine : private folly::AsyncTimeout {
 void toAppend(ReceiveMachine::ReceiveState state, std::string* result);
 std::ostream& operator<<(std::ostream& out, ReceiveMachine::ReceiveState s);
 
-class PeriodicTransmissionMachine : private folly::AsyncTimeout {
+class PeriodicTransmissionMachine : private folly::HHWheelTimer::Callback {
  public:
-  explicit PeriodicTransmissionMachine(
-      LacpController& controller,
-      folly::EventBase* evb);
+  explicit PeriodicTransmissionMachine(LacpController& controller);
   ~PeriodicTransmissionMachine() override;
 
   void portUp();
@@ -118,6 +123,7 @@ class PeriodicTransmissionMachine : private folly::AsyncTimeout {
       std::string* result);
 
   void timeoutExpired() noexcept override;
+  void callbackCanceled() noexcept override {}
   void beginNextPeriod();
   PeriodicState determineTransmissionRate();
 
@@ -128,13 +134,10 @@ void toAppend(
     PeriodicTransmissionMachine::PeriodicState state,
     std::string* result);
 
-class TransmitMachine : private folly::AsyncTimeout {
+class TransmitMachine {
  public:
-  TransmitMachine(
-      LacpController& controller,
-      folly::EventBase* evb,
-      LacpServicerIf* servicer);
-  ~TransmitMachine() override;
+  TransmitMachine(LacpController& controller, LacpServicerIf* servicer);
+  ~TransmitMachine();
 
   void ntt(LACPDU lacpdu);
 
@@ -144,13 +147,15 @@ class TransmitMachine : private folly::AsyncTimeout {
  private:
   enum class PeriodicState { NONE, SLOW, FAST, TX };
 
-  void timeoutExpired() noexcept override;
-  void replenishTranmissionsLeft() noexcept;
+  // Transmissions are replenished lazily from the time elapsed since the
+  // last replenishment, so rate limiting needs no timer of its own
+  void replenishTranmissionsLeft(std::chrono::steady_clock::time_point now);
 
   static const int MAX_TRANSMISSIONS_IN_SHORT_PERIOD;
   static const std::chrono::seconds TX_REPLENISH_RATE;
 
   int transmissionsLeft_{MAX_TRANSMISSIONS_IN_SHORT_PERIOD};
+  std::chrono::steady_clock::time_point lastReplenished_;
   LacpController& controller_;
   LacpServicerIf* servicer_{nullptr};
 };
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/LatencyQuantiles.h"
+
+#include "common/stats/ThreadCachedServiceData.h"
+
+#include <gflags/gflags.h>
+
+#include <cmath>
+#include <utility>
+
+DEFINE_int32(latency_quantiles_half_life_s, 60,
+    "How long it takes the weight of a latency sample to halve in the "
+    "exported latency quantiles, in seconds");
+
+namespace facebook { namespace fboss {
+
+LatencyQuantiles::LatencyQuantiles(std::string name)
+    : name_(std::move(name)), lastPublished_(Clock::now()) {}
+
+void LatencyQuantiles::publish(Clock::time_point now) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (FLAGS_latency_quantiles_half_life_s > 0) {
+    std::chrono::duration<double> elapsed = now - lastPublished_;
+    sketch_.decay(
+        std::exp2(-elapsed.count() / FLAGS_latency_quantiles_half_life_s));
+  }
+  lastPublished_ = now;
+
+  for (auto& thread : counts_.accessAllThreads()) {
+    for (size_t i = 0; i < QuantileSketch::kNumBuckets; ++i) {
+      // Cheap to check first, most buckets are always empty
+      if (thread.buckets[i].load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      auto count = thread.buckets[i].exchange(0, std::memory_order_relaxed);
+      sketch_.addToBucket(i, count);
+    }
+  }
+
+  if (sketch_.count() <= 0) {
+    return;
+  }
+  tcData().setCounter(name_ + ".p50", sketch_.quantile(0.5));
+  tcData().setCounter(name_ + ".p99", sketch_.quantile(0.99));
+  tcData().setCounter(name_ + ".p999", sketch_.quantile(0.999));
+}
+
+QuantileSketch LatencyQuantiles::getSketch() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return sketch_;
+}
+
+}} // facebook::fboss
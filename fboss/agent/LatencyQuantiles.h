@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/lib/QuantileSketch.h"
+
+#include <folly/ThreadLocal.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Exports the quantiles of a latency as the <name>.p50, <name>.p99 and
+ * <name>.p999 counters, which the fixed bucket histograms can't tell apart
+ * in the tail.
+ *
+ * Samples may be added from any thread. Each thread counts them in buckets
+ * of its own, laid out as in QuantileSketch, so adding a sample is a single
+ * uncontended atomic increment. publish() collects those counts into a
+ * QuantileSketch whose older samples decay with a half life of
+ * --latency_quantiles_half_life_s, so the quantiles follow the recent
+ * latency rather than that of the whole run. The samples a thread added
+ * since the last publish() are lost if it exits.
+ */
+class LatencyQuantiles {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit LatencyQuantiles(std::string name);
+
+  void addValue(std::chrono::microseconds latency) {
+    auto bucket = QuantileSketch::bucketOf(latency.count());
+    counts_->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /*
+   * Fold the samples added since the last call into the sketch, and export
+   * its quantiles. Called periodically from the stats thread.
+   */
+  void publish(Clock::time_point now = Clock::now());
+
+  // The sketch as of the last publish()
+  QuantileSketch getSketch() const;
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+ private:
+  struct ThreadCounts {
+    std::array<std::atomic<uint64_t>, QuantileSketch::kNumBuckets> buckets{};
+  };
+
+  // Forbidden copy constructor and assignment operator
+  LatencyQuantiles(LatencyQuantiles const&) = delete;
+  LatencyQuantiles& operator=(LatencyQuantiles const&) = delete;
+
+  const std::string name_;
+  folly::ThreadLocal<ThreadCounts, LatencyQuantiles> counts_;
+  mutable std::mutex lock_;
+  QuantileSketch sketch_;
+  Clock::time_point lastPublished_;
+};
+
+}} // facebook::fboss
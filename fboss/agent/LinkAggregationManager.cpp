@@ -32,50 +32,65 @@
 #include <tuple>
 #include <utility>
 
+DEFINE_int32(
+    lacp_forwarding_batch_ms,
+    10,
+    "How long LACP collects member forwarding state changes before applying "
+    "them to the switch state in one update");
+
 namespace facebook {
 namespace fboss {
 
 namespace {
 class ProgramForwardingState {
  public:
-  ProgramForwardingState(
-      PortID portID,
-      AggregatePortID aggPortID,
-      AggregatePort::Forwarding fwdState);
+  using ForwardingStates = boost::container::flat_map<
+      AggregatePortID,
+      boost::container::flat_map<PortID, AggregatePort::Forwarding>>;
+
+  explicit ProgramForwardingState(ForwardingStates fwdStates);
   std::shared_ptr<SwitchState> operator()(
       const std::shared_ptr<SwitchState>& state);
 
  private:
-  PortID portID_;
-  AggregatePortID aggegatePortID_;
-  AggregatePort::Forwarding forwardingState_;
+  ForwardingStates forwardingStates_;
 };
 
-ProgramForwardingState::ProgramForwardingState(
-    PortID portID,
-    AggregatePortID aggPortID,
-    AggregatePort::Forwarding fwdState)
-    : portID_(portID), aggegatePortID_(aggPortID), forwardingState_(fwdState) {}
+ProgramForwardingState::ProgramForwardingState(ForwardingStates fwdStates)
+    : forwardingStates_(std::move(fwdStates)) {}
 
 std::shared_ptr<SwitchState> ProgramForwardingState::operator()(
     const std::shared_ptr<SwitchState>& state) {
   std::shared_ptr<SwitchState> nextState(state);
-  auto* aggPort =
-      nextState->getAggregatePorts()->getAggregatePortIf(aggegatePortID_).get();
-  if (!aggPort) {
-    return nullptr;
-  }
-
-  XLOG(DBG4) << "Updating AggregatePort " << aggPort->getID()
-             << ": ForwardingState[" << portID_ << "] --> "
-             << (forwardingState_ == AggregatePort::Forwarding::ENABLED
-                     ? "ENABLED"
-                     : "DISABLED");
+  bool changed = false;
+  for (const auto& aggPortAndStates : forwardingStates_) {
+    auto* aggPort = nextState->getAggregatePorts()
+                        ->getAggregatePortIf(aggPortAndStates.first)
+                        .get();
+    if (!aggPort) {
+      continue;
+    }
 
-  aggPort = aggPort->modify(&nextState);
-  aggPort->setForwardingState(portID_, forwardingState_);
+    aggPort = aggPort->modify(&nextState);
+    for (const auto& portAndState : aggPortAndStates.second) {
+      XLOG(DBG4) << "Updating AggregatePort " << aggPort->getID()
+                 << ": ForwardingState[" << portAndState.first << "] --> "
+                 << (portAndState.second == AggregatePort::Forwarding::ENABLED
+                         ? "ENABLED"
+                         : "DISABLED");
+      try {
+        aggPort->setForwardingState(portAndState.first, portAndState.second);
+      } catch (const FbossError& ex) {
+        // The member left the aggregate since its state was queued, don't
+        // let it hold up the other members in the batch
+        XLOG(ERR) << "Skipping forwarding state for " << portAndState.first
+                  << ": " << ex.what();
+      }
+    }
+    changed = true;
+  }
 
-  return nextState;
+  return changed ? nextState : nullptr;
 }
 } // namespace
 
@@ -89,7 +104,10 @@ std::ostream& operator<<(
 LinkAggregationManager::LinkAggregationManager(SwSwitch* sw)
     : AutoRegisterStateObserver(sw, "LinkAggregationManager"),
       portToController_(),
-      sw_(sw) {}
+      sw_(sw),
+      forwardingFlushTimeout_(folly::AsyncTimeout::make(
+          *sw->getLacpEvb(),
+          [this]() noexcept { flushForwardingStates(); })) {}
 
 void LinkAggregationManager::handlePacket(
     std::unique_ptr<RxPacket> pkt,
@@ -296,11 +314,7 @@ void LinkAggregationManager::enableForwarding(
     AggregatePortID aggPortID) {
   CHECK(sw_->getLacpEvb()->inRunningEventBaseThread());
 
-  auto enableFwdStateFn = ProgramForwardingState(
-      portID, aggPortID, AggregatePort::Forwarding::ENABLED);
-
-  sw_->updateStateNoCoalescing(
-      "AggregatePort ForwardingState", std::move(enableFwdStateFn));
+  queueForwardingState(portID, aggPortID, AggregatePort::Forwarding::ENABLED);
 }
 
 void LinkAggregationManager::disableForwarding(
@@ -308,11 +322,33 @@ void LinkAggregationManager::disableForwarding(
     AggregatePortID aggPortID) {
   CHECK(sw_->getLacpEvb()->inRunningEventBaseThread());
 
-  auto disableFwdStateFn = ProgramForwardingState(
-      portID, aggPortID, AggregatePort::Forwarding::DISABLED);
+  queueForwardingState(portID, aggPortID, AggregatePort::Forwarding::DISABLED);
+}
+
+void LinkAggregationManager::queueForwardingState(
+    PortID portID,
+    AggregatePortID aggPortID,
+    AggregatePort::Forwarding fwdState) {
+  // Only the latest state of a member matters to the hardware
+  pendingForwardingStates_[aggPortID][portID] = fwdState;
+  if (!forwardingFlushTimeout_->isScheduled()) {
+    forwardingFlushTimeout_->scheduleTimeout(
+        std::max(FLAGS_lacp_forwarding_batch_ms, 0));
+  }
+}
+
+void LinkAggregationManager::flushForwardingStates() {
+  CHECK(sw_->getLacpEvb()->inRunningEventBaseThread());
+  if (pendingForwardingStates_.empty()) {
+    return;
+  }
 
+  PendingForwardingStates fwdStates;
+  fwdStates.swap(pendingForwardingStates_);
   sw_->updateStateNoCoalescing(
-      "AggregatePort ForwardingState", std::move(disableFwdStateFn));
+      "AggregatePort ForwardingState",
+      ProgramForwardingState(std::move(fwdStates)),
+      StateUpdate::Priority::LINK_STATE);
 }
 
 std::vector<std::shared_ptr<LacpController>>
@@ -12,11 +12,13 @@
 #include "fboss/agent/types.h"
 #include "fboss/agent/LacpTypes.h"
 #include "fboss/agent/StateObserver.h"
+#include "fboss/agent/state/AggregatePort.h"
 
 #include <boost/container/flat_map.hpp>
 
 #include <folly/SharedMutex.h>
 #include <folly/io/Cursor.h>
+#include <folly/io/async/AsyncTimeout.h>
 
 #include <memory>
 #include <vector>
@@ -71,6 +73,18 @@ class LinkAggregationManager : public AutoRegisterStateObserver,
       const std::shared_ptr<Port>& oldPort,
       const std::shared_ptr<Port>& newPort);
 
+  /*
+   * Forwarding state changes are not applied one SwitchState update at a
+   * time. When many members move at once, e.g. after a partner restarts,
+   * they are collected for --lacp_forwarding_batch_ms and then applied in a
+   * single update, so each trunk is reprogrammed once.
+   */
+  void queueForwardingState(
+      PortID portID,
+      AggregatePortID aggPortID,
+      AggregatePort::Forwarding fwdState);
+  void flushForwardingStates();
+
   // Forbidden copy constructor and assignment operator
   LinkAggregationManager(LinkAggregationManager const&) = delete;
   LinkAggregationManager& operator=(LinkAggregationManager const&) = delete;
@@ -84,6 +98,13 @@ class LinkAggregationManager : public AutoRegisterStateObserver,
   PortIDToController portToController_;
   mutable folly::SharedMutexWritePriority controllersLock_;
   SwSwitch* sw_{nullptr};
+
+  // Only accessed from the LACP EventBase
+  using PendingForwardingStates = boost::container::flat_map<
+      AggregatePortID,
+      boost::container::flat_map<PortID, AggregatePort::Forwarding>>;
+  PendingForwardingStates pendingForwardingStates_;
+  std::unique_ptr<folly::AsyncTimeout> forwardingFlushTimeout_;
 };
 } // namespace fboss
 } // namespace facebook
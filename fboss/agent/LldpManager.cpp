@@ -11,11 +11,14 @@
 #include "fboss/agent/LldpManager.h"
 
 #include <folly/MacAddress.h>
+#include <folly/io/IOBuf.h>
 #include <folly/Range.h>
 #include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/logging/xlog.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/TxPacket.h"
@@ -26,6 +29,24 @@ using folly::ByteRange;
 using folly::StringPiece;
 using std::shared_ptr;
 
+namespace {
+
+const char* const kSystemDescription = "FBOSS";
+
+std::string getHostname() {
+  const size_t kMaxLen = 64;
+  char hostname[kMaxLen];
+
+  if (0 == gethostname(hostname, kMaxLen)) {
+    // make sure it is null terminated
+    hostname[kMaxLen - 1] = '\0';
+  } else {
+    hostname[0] = '\0';
+  }
+  return hostname;
+}
+
+} // unnamed namespace
 
 namespace facebook { namespace fboss {
 
@@ -54,6 +75,15 @@ void LldpManager::handlePacket(
     folly::MacAddress /*dst*/,
     folly::MacAddress src,
     folly::io::Cursor cursor) {
+  // Neighbors keep sending the same PDU, which there is no need to parse
+  // again
+  if (db_.refresh(pkt->getSrcPort(), pkt->getSrcVlan(), src,
+                  cursor.peekBytes())) {
+    XLOG(DBG5) << "refreshed LLDP neighbor on port " << pkt->getSrcPort()
+               << " from " << src;
+    return;
+  }
+
   LinkNeighbor neighbor;
   bool ret = neighbor.parseLldpPdu(pkt->getSrcPort(), pkt->getSrcVlan(),
                                    src, ETHERTYPE_LLDP, &cursor);
@@ -83,14 +113,27 @@ void LldpManager::timeoutExpired() noexcept {
 void LldpManager::sendLldpOnAllPorts(bool checkPortStatusFlag) {
   // send lldp frames through all the ports here.
   std::shared_ptr<SwitchState> state = sw_->getState();
+  auto cpuMac = sw_->getPlatform()->getLocalMac();
+  auto hostname = getHostname();
   for (const auto& port : *state->getPorts()) {
     if (checkPortStatusFlag == false || port->isPortUp()) {
-      sendLldpInfo(sw_, state, port);
+      sendLldpInfo(*port, cpuMac, hostname);
     } else {
       XLOG(DBG5) << "Skipping LLDP send as this port is disabled "
                  << port->getID();
     }
   }
+
+  // Forget the frames of the ports that went away
+  if (frames_.size() > state->getPorts()->size()) {
+    for (auto it = frames_.begin(); it != frames_.end();) {
+      if (state->getPorts()->getPortIf(it->first)) {
+        ++it;
+      } else {
+        it = frames_.erase(it);
+      }
+    }
+  }
 }
 
 uint16_t tlvHeader(uint16_t type, uint16_t length) {
@@ -139,29 +182,31 @@ void writeTlv(LldpTlvType type, const ByteRange& value,
   cursor->push(value.data(), value.size());
 }
 
-void LldpManager::sendLldpInfo(
-    SwSwitch* sw,
-    const std::shared_ptr<SwitchState>& /*swState*/,
-    const std::shared_ptr<Port>& port) {
-  MacAddress cpuMac = sw->getPlatform()->getLocalMac();
-  const size_t kMaxLen = 64;
-  char hostname[kMaxLen];
-
-  if (0 == gethostname(hostname, kMaxLen)) {
-    // make sure it is null terminated
-    hostname[kMaxLen - 1] = '\0';
-  } else {
-    hostname[0] = '\0';
+const folly::IOBuf& LldpManager::getFrame(
+    const Port& port,
+    MacAddress cpuMac,
+    const std::string& hostname) {
+  auto& frame = frames_[port.getID()];
+  if (frame.buf && frame.portName == port.getName() &&
+      frame.vlan == port.getIngressVlan() && frame.cpuMac == cpuMac &&
+      frame.hostname == hostname) {
+    return *frame.buf;
   }
 
   // The minimum packet length is 64.We use 68 on the assumption that
   // the packet will go out untagged, which will remove 4 bytes.
-  uint32_t frameLen = 98;
-  auto pkt = sw->allocatePacket(frameLen);
-  PortID thisPortID = port->getID();
-  RWPrivateCursor cursor(pkt->buf());
-  pkt->writeEthHeader(&cursor, LLDP_DEST_MAC,
-                      cpuMac, port->getIngressVlan(), ETHERTYPE_LLDP);
+  const uint32_t kMinFrameLen = 98;
+  // Ethernet header with a vlan tag, the TLV headers and fixed size values
+  const uint32_t kFixedLen = 18 + 2 + 7 + 2 + 1 + 2 + 2 + 2 + 2 + 6 + 2;
+  uint32_t frameLen = std::max<uint32_t>(
+      kMinFrameLen,
+      kFixedLen + port.getName().size() + hostname.size() +
+          strlen(kSystemDescription));
+  frame.buf = folly::IOBuf::create(frameLen);
+  frame.buf->append(frameLen);
+  RWPrivateCursor cursor(frame.buf.get());
+  TxPacket::writeEthHeader(&cursor, LLDP_DEST_MAC,
+                           cpuMac, port.getIngressVlan(), ETHERTYPE_LLDP);
   // now write chassis ID TLV
   writeTlv(LldpTlvType::CHASSIS, LldpChassisIdType::MAC_ADDRESS,
            ByteRange(cpuMac.bytes(), 6), &cursor);
@@ -171,20 +216,21 @@ void LldpManager::sendLldpInfo(
    * ByteRange.
    */
   writeTlv(LldpTlvType::PORT, LldpPortIdType::INTERFACE_NAME,
-           StringPiece(port->getName()), &cursor);
+           StringPiece(port.getName()), &cursor);
 
   // now write TTL TLV
   writeTlv(LldpTlvType::TTL, (uint16_t) TTL_TLV_VALUE, &cursor);
 
   // now write optional TLVs
   // system name TLV
-  if (strlen(hostname) > 0) {
+  if (!hostname.empty()) {
     writeTlv(LldpTlvType::SYSTEM_NAME,
              StringPiece(hostname), &cursor);
   }
 
   // system description TLV
-  writeTlv(LldpTlvType::SYSTEM_DESCRIPTION, StringPiece("FBOSS"), &cursor);
+  writeTlv(LldpTlvType::SYSTEM_DESCRIPTION, StringPiece(kSystemDescription),
+           &cursor);
 
   // system capability TLV
   uint16_t capability = SYSTEM_CAPABILITY_ROUTER;
@@ -196,12 +242,27 @@ void LldpManager::sendLldpInfo(
 
   // Fill the padding with 0s
   memset(cursor.writableData(), 0, cursor.length());
+
+  frame.portName = port.getName();
+  frame.vlan = port.getIngressVlan();
+  frame.cpuMac = cpuMac;
+  frame.hostname = hostname;
+  return *frame.buf;
+}
+
+void LldpManager::sendLldpInfo(
+    const Port& port,
+    MacAddress cpuMac,
+    const std::string& hostname) {
+  const auto& frame = getFrame(port, cpuMac, hostname);
+  auto pkt = sw_->allocatePacket(frame.length());
+  memcpy(pkt->buf()->writableData(), frame.data(), frame.length());
   // this LLDP packet HAS to exit out of the port specified here.
-  sw->sendPacketOutOfPortAsync(std::move(pkt), thisPortID);
+  sw_->sendPacketOutOfPortAsync(std::move(pkt), port.getID());
   XLOG(DBG4) << "sent LLDP "
-             << " on port " << port->getID() << " with CPU MAC "
-             << cpuMac.toString() << " port id " << port->getName()
-             << " and vlan " << port->getIngressVlan();
+             << " on port " << port.getID() << " with CPU MAC "
+             << cpuMac.toString() << " port id " << port.getName()
+             << " and vlan " << port.getIngressVlan();
 }
 
 }} // facebook::fboss
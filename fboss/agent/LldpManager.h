@@ -12,13 +12,16 @@
 #include <folly/io/async/AsyncTimeout.h>
 #include <unordered_map>
 #include <memory>
+#include <string>
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/lldp/LinkNeighborDB.h"
 #include "fboss/agent/state/Port.h"
 #include "fboss/agent/state/PortMap.h"
 #include "fboss/agent/state/SwitchState.h"
 
-namespace folly { namespace io {
+namespace folly {
+class IOBuf;
+namespace io {
 class Cursor;
 }}
 
@@ -84,13 +87,31 @@ class LldpManager : private folly::AsyncTimeout {
   }
 
  private:
+  /*
+   * The LLDP frame of a port, only built again when something it is made
+   * of changes instead of on every send.
+   */
+  struct Frame {
+    std::string portName;
+    VlanID vlan{0};
+    folly::MacAddress cpuMac;
+    std::string hostname;
+    std::unique_ptr<folly::IOBuf> buf;
+  };
+
   void timeoutExpired() noexcept override;
-  void sendLldpInfo(SwSwitch* sw, const std::shared_ptr<SwitchState>& swState,
-                    const std::shared_ptr<Port>& port);
+  const folly::IOBuf& getFrame(const Port& port,
+                               folly::MacAddress cpuMac,
+                               const std::string& hostname);
+  void sendLldpInfo(const Port& port,
+                    folly::MacAddress cpuMac,
+                    const std::string& hostname);
 
   SwSwitch* sw_{nullptr};
   std::chrono::milliseconds interval_;
   LinkNeighborDB db_;
+  // Only used from the thread sending LLDP frames
+  std::unordered_map<PortID, Frame> frames_;
 };
 
 }} // facebook::fboss
@@ -52,13 +52,33 @@ std::shared_ptr<LoadBalancer> LoadBalancerConfigParser::parse(
       ? cfg.seed
       : LoadBalancer::generateDeterministicSeed(loadBalancerID, platform_);
 
-  return std::make_shared<LoadBalancer>(
+  auto loadBalancer = std::make_shared<LoadBalancer>(
       loadBalancerID,
       algorithm,
       seed,
       std::get<0>(fields),
       std::get<1>(fields),
       std::get<2>(fields));
+
+  if (cfg.mode == cfg::LoadBalancingMode::DYNAMIC_FLOWLET) {
+    if (loadBalancerID != LoadBalancerID::ECMP) {
+      throw FbossError(
+          "LoadBalancer ",
+          loadBalancerID,
+          ": dynamic load balancing is only supported for ECMP");
+    }
+    auto flowlet = cfg.__isset.flowlet ? cfg.flowlet : cfg::FlowletConfig();
+    if (flowlet.inactivityIntervalUsecs <= 0 || flowlet.flowletTableSize <= 0) {
+      throw FbossError(
+          "LoadBalancer ",
+          loadBalancerID,
+          ": flowlet inactivity interval and table size must be positive");
+    }
+    loadBalancer->setMode(cfg.mode);
+    loadBalancer->setFlowlet(
+        flowlet.inactivityIntervalUsecs, flowlet.flowletTableSize);
+  }
+  return loadBalancer;
 }
 
 LoadBalancerConfigApplier::LoadBalancerConfigApplier(
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/LocalAddressCache.h"
+
+#include "fboss/agent/state/ArpResponseTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/NdpResponseTable.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <algorithm>
+
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+
+namespace {
+
+// Sort entries by key, keeping only the first of entries with equal keys
+template <typename Entries>
+void sortEntries(Entries* entries) {
+  auto keyLess = [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  };
+  auto keyEqual = [](const auto& a, const auto& b) {
+    return a.first == b.first;
+  };
+  std::stable_sort(entries->begin(), entries->end(), keyLess);
+  entries->erase(
+      std::unique(entries->begin(), entries->end(), keyEqual), entries->end());
+  entries->shrink_to_fit();
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+LocalAddressIndex::LocalAddressIndex(const SwitchState& state) {
+  // The interfaces are visited in the order InterfaceMap searches them, so
+  // the first one found for a key is the one it would return.
+  for (const auto& intf : *state.getInterfaces()) {
+    vlanInterfaces_.emplace_back(intf->getVlanID(), intf);
+    for (const auto& addr : intf->getAddresses()) {
+      interfaces_.emplace_back(
+          InterfaceKey(intf->getRouterID(), addr.first), intf);
+    }
+  }
+  for (const auto& vlan : *state.getVlans()) {
+    for (const auto& entry : vlan->getArpResponseTable()->getTable()) {
+      arpResponses_.emplace_back(ArpKey(vlan->getID(), entry.first),
+                                 entry.second);
+    }
+    for (const auto& entry : vlan->getNdpResponseTable()->getTable()) {
+      ndpResponses_.emplace_back(NdpKey(vlan->getID(), entry.first),
+                                 entry.second);
+    }
+  }
+  sortEntries(&interfaces_);
+  sortEntries(&vlanInterfaces_);
+  sortEntries(&arpResponses_);
+  sortEntries(&ndpResponses_);
+}
+
+template <typename Key, typename Value>
+const Value* LocalAddressIndex::find(
+    const SortedVector<Key, Value>& entries,
+    const Key& key) {
+  auto it = std::lower_bound(
+      entries.begin(),
+      entries.end(),
+      key,
+      [](const std::pair<Key, Value>& entry, const Key& k) {
+        return entry.first < k;
+      });
+  if (it == entries.end() || it->first != key) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+std::shared_ptr<Interface> LocalAddressIndex::getInterface(
+    RouterID router,
+    const IPAddress& ip) const {
+  auto intf = find(interfaces_, InterfaceKey(router, ip));
+  return intf ? *intf : nullptr;
+}
+
+std::shared_ptr<Interface> LocalAddressIndex::getInterfaceInVlan(
+    VlanID vlan) const {
+  auto intf = find(vlanInterfaces_, vlan);
+  return intf ? *intf : nullptr;
+}
+
+const NeighborResponseEntry* LocalAddressIndex::getArpResponse(
+    VlanID vlan,
+    IPAddressV4 ip) const {
+  return find(arpResponses_, ArpKey(vlan, ip));
+}
+
+const NeighborResponseEntry* LocalAddressIndex::getNdpResponse(
+    VlanID vlan,
+    const IPAddressV6& ip) const {
+  return find(ndpResponses_, NdpKey(vlan, ip));
+}
+
+std::shared_ptr<const LocalAddressIndex> LocalAddressCache::get(
+    const std::shared_ptr<SwitchState>& state) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (index_ && state->getGeneration() == generation_ &&
+      !state_.owner_before(state) && !state.owner_before(state_)) {
+    return index_;
+  }
+  index_ = std::make_shared<const LocalAddressIndex>(*state);
+  generation_ = state->getGeneration();
+  state_ = state;
+  return index_;
+}
+
+}} // facebook::fboss
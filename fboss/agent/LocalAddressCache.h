@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/state/NeighborResponseTable.h"
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class Interface;
+class SwitchState;
+
+/*
+ * An immutable index of the addresses a SwitchState says are ours, for the
+ * packet handlers to check whether a packet is for us without scanning the
+ * interfaces or walking down to the vlan's response tables.
+ *
+ * Everything is kept in sorted vectors, so a lookup is a binary search over
+ * a few contiguous cache lines.
+ */
+class LocalAddressIndex {
+ public:
+  explicit LocalAddressIndex(const SwitchState& state);
+
+  /*
+   * The interface with address ip in router, as
+   * InterfaceMap::getInterfaceIf() would find it. nullptr if there is none.
+   */
+  std::shared_ptr<Interface> getInterface(
+      RouterID router,
+      const folly::IPAddress& ip) const;
+  /*
+   * The interface on vlan, as InterfaceMap::getInterfaceInVlanIf() would
+   * find it. nullptr if there is none.
+   */
+  std::shared_ptr<Interface> getInterfaceInVlan(VlanID vlan) const;
+
+  /*
+   * How to answer ARP and NDP requests for ip received on vlan, from the
+   * vlan's response table. nullptr if ip isn't ours on that vlan.
+   */
+  const NeighborResponseEntry* getArpResponse(
+      VlanID vlan,
+      folly::IPAddressV4 ip) const;
+  const NeighborResponseEntry* getNdpResponse(
+      VlanID vlan,
+      const folly::IPAddressV6& ip) const;
+
+ private:
+  using InterfaceKey = std::pair<RouterID, folly::IPAddress>;
+  using ArpKey = std::pair<VlanID, folly::IPAddressV4>;
+  using NdpKey = std::pair<VlanID, folly::IPAddressV6>;
+
+  template <typename Key, typename Value>
+  using SortedVector = std::vector<std::pair<Key, Value>>;
+
+  // Forbidden copy constructor and assignment operator
+  LocalAddressIndex(LocalAddressIndex const&) = delete;
+  LocalAddressIndex& operator=(LocalAddressIndex const&) = delete;
+
+  template <typename Key, typename Value>
+  static const Value* find(
+      const SortedVector<Key, Value>& entries,
+      const Key& key);
+
+  SortedVector<InterfaceKey, std::shared_ptr<Interface>> interfaces_;
+  SortedVector<VlanID, std::shared_ptr<Interface>> vlanInterfaces_;
+  SortedVector<ArpKey, NeighborResponseEntry> arpResponses_;
+  SortedVector<NdpKey, NeighborResponseEntry> ndpResponses_;
+};
+
+/*
+ * Holds the LocalAddressIndex of the most recent SwitchState it was asked
+ * about, building a new one when it is asked about a different state.
+ *
+ * As for DHCPRelayCache, the state generation alone doesn't tell states
+ * apart, so the state itself is compared too.
+ *
+ * Called from the packet receiving threads.
+ */
+class LocalAddressCache {
+ public:
+  LocalAddressCache() {}
+
+  std::shared_ptr<const LocalAddressIndex> get(
+      const std::shared_ptr<SwitchState>& state);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  LocalAddressCache(LocalAddressCache const&) = delete;
+  LocalAddressCache& operator=(LocalAddressCache const&) = delete;
+
+  std::mutex lock_;
+  uint32_t generation_{0};
+  // Held weakly so the cache doesn't keep an old state around
+  std::weak_ptr<SwitchState> state_;
+  std::shared_ptr<const LocalAddressIndex> index_;
+};
+
+}} // facebook::fboss
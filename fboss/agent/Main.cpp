@@ -69,6 +69,12 @@ DEFINE_bool(publish_boot_type, true,
             "Publish boot type on startup");
 DEFINE_int32(flush_warmboot_cache_secs, 60,
     "Seconds to wait before flushing warm boot cache");
+DEFINE_bool(staged_initial_config, false,
+            "On cold boot, apply the config needed for forwarding and "
+            "routing clients first, and ACLs, mirrors and sFlow after");
+DEFINE_int32(state_memory_accounting_interval_secs, 300,
+    "How often to publish the memory used by the switch state, in seconds. "
+    "0 disables it");
 DECLARE_int32(thrift_idle_timeout);
 
 using facebook::fboss::SwSwitch;
@@ -152,7 +158,15 @@ class Initializer {
     auto localMac = ret.get();
     XLOG(INFO) << "local MAC is " << localMac;
 
-    sw_->applyConfig("apply initial config");
+    auto staged = FLAGS_staged_initial_config &&
+        sw_->getBootType() == BootType::COLD_BOOT;
+    if (staged) {
+      // Nothing is programmed yet on cold boot, so there is no harm in
+      // holding the ACLs back until routing clients can connect
+      sw_->applyReachabilityConfig("apply initial reachability config");
+    } else {
+      sw_->applyConfig("apply initial config");
+    }
     // Enable route update logging for all routes so that when we are told
     // the first set of routes after a warm boot, we can log any changes
     // from what was programmed before the warm boot.
@@ -162,6 +176,9 @@ class Initializer {
       sw_->logRouteUpdates("0.0.0.0", 0, "fboss-agent-warmboot");
     }
     sw_->initialConfigApplied(startTime);
+    if (staged) {
+      sw_->applyConfig("apply rest of initial config");
+    }
 
     // Start the UpdateSwitchStatsThread
     fs_ = new FunctionScheduler();
@@ -184,6 +201,13 @@ class Initializer {
     fs_->addFunction(flushWarmbootFunc, seconds(1), flushWarmboot,
         seconds(FLAGS_flush_warmboot_cache_secs)/*initial delay*/);
 
+    if (FLAGS_state_memory_accounting_interval_secs > 0) {
+      fs_->addFunction(
+          [=]() { sw_->publishStateMemoryUsage(); },
+          seconds(FLAGS_state_memory_accounting_interval_secs),
+          "publishStateMemoryUsage");
+    }
+
     fs_->start();
     XLOG(INFO) << "Started background thread: UpdateStatsThread";
     initCondition_.notify_all();
@@ -1,6 +1,7 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 #include "fboss/agent/MirrorManager.h"
 
+#include <algorithm>
 #include <tuple>
 #include <boost/container/flat_set.hpp>
 #include "fboss/agent/state/DeltaFunctions.h"
@@ -19,31 +20,71 @@ using folly::Optional;
 namespace facebook {
 namespace fboss {
 
+namespace {
+
+template <typename RoutesDelta>
+bool routesCover(const RoutesDelta& delta, const IPAddress& ip) {
+  auto covers = [&ip](const auto& route) {
+    const auto& prefix = route->prefix();
+    return ip.inSubnet(IPAddress(prefix.network), prefix.mask);
+  };
+  for (const auto& routeDelta : delta) {
+    if ((routeDelta.getOld() && covers(routeDelta.getOld())) ||
+        (routeDelta.getNew() && covers(routeDelta.getNew()))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename NeighborDelta>
+void addChangedNeighbors(
+    const NeighborDelta& delta,
+    flat_set<IPAddress>* changed) {
+  for (const auto& entryDelta : delta) {
+    const auto& entry =
+        entryDelta.getOld() ? entryDelta.getOld() : entryDelta.getNew();
+    changed->insert(IPAddress(entry->getIP()));
+  }
+}
+
+} // unnamed namespace
+
 void MirrorManager::stateUpdated(const StateDelta& delta) {
-  if (!hasMirrorChanges(delta)) {
+  if (delta.newState()->getMirrors()->size() == 0) {
+    mirrorNeighbors_.clear();
+    return;
+  }
+  auto names = getMirrorsToResolve(delta);
+  if (names.empty()) {
     return;
   }
 
-  auto updateMirrorsFn = [this](const std::shared_ptr<SwitchState>& state) {
-    return resolveMirrors(state);
+  auto updateMirrorsFn = [this, names = std::move(names)](
+                             const std::shared_ptr<SwitchState>& state) {
+    return resolveMirrors(state, names);
   };
   sw_->updateState("Updating mirrors", updateMirrorsFn);
 }
 
 std::shared_ptr<SwitchState> MirrorManager::resolveMirrors(
-    const std::shared_ptr<SwitchState>& state) {
+    const std::shared_ptr<SwitchState>& state,
+    const MirrorNames& names) {
   auto mirrors = state->getMirrors()->clone();
   bool mirrorsUpdated = false;
 
-  for (const auto& mirror : *state->getMirrors()) {
-    if (!mirror->getDestinationIp()) {
+  for (const auto& name : names) {
+    auto mirror = state->getMirrors()->getMirrorIf(name);
+    if (!mirror || !mirror->getDestinationIp()) {
       /* SPAN mirror does not require resolving */
       continue;
     }
     const auto destinationIp = mirror->getDestinationIp().value();
+    NeighborIps neighbors;
     std::shared_ptr<Mirror> updatedMirror = destinationIp.isV4()
-        ? v4Manager_->updateMirror(mirror)
-        : v6Manager_->updateMirror(mirror);
+        ? v4Manager_->updateMirror(mirror, &neighbors)
+        : v6Manager_->updateMirror(mirror, &neighbors);
+    mirrorNeighbors_[name] = std::move(neighbors);
     if (updatedMirror) {
       XLOG(INFO) << "Mirror: " << updatedMirror->getID() << " updated.";
       mirrors->updateNode(updatedMirror);
@@ -58,16 +99,61 @@ std::shared_ptr<SwitchState> MirrorManager::resolveMirrors(
   return updatedState;
 }
 
-bool MirrorManager::hasMirrorChanges(const StateDelta& delta) {
-  return (sw_->getState()->getMirrors()->size() > 0) &&
-      (!isEmpty(delta.getRouteTablesDelta()) ||
-       std::any_of(
-           std::begin(delta.getVlansDelta()),
-           std::end(delta.getVlansDelta()),
-           [](const VlanDelta& vlanDelta) {
-             return !isEmpty(vlanDelta.getArpDelta()) ||
-                 !isEmpty(vlanDelta.getNdpDelta());
-           }));
+MirrorManager::MirrorNames MirrorManager::getMirrorsToResolve(
+    const StateDelta& delta) {
+  MirrorNames names;
+  for (const auto& mirrorDelta : delta.getMirrorsDelta()) {
+    const auto& oldMirror = mirrorDelta.getOld();
+    const auto& newMirror = mirrorDelta.getNew();
+    if (!newMirror) {
+      mirrorNeighbors_.erase(oldMirror->getID());
+      continue;
+    }
+    /* updates of the resolved tunnel and egress port are our own doing */
+    if (!oldMirror ||
+        oldMirror->getDestinationIp() != newMirror->getDestinationIp() ||
+        oldMirror->configHasEgressPort() != newMirror->configHasEgressPort() ||
+        (newMirror->configHasEgressPort() &&
+         oldMirror->getEgressPort() != newMirror->getEgressPort())) {
+      names.insert(newMirror->getID());
+    }
+  }
+
+  /* any change to an interface can change which nexthops are reachable */
+  bool intfsChanged = !isEmpty(delta.getIntfsDelta());
+  flat_set<IPAddress> changedNeighbors;
+  for (const auto& vlanDelta : delta.getVlansDelta()) {
+    addChangedNeighbors(vlanDelta.getArpDelta(), &changedNeighbors);
+    addChangedNeighbors(vlanDelta.getNdpDelta(), &changedNeighbors);
+  }
+  auto routesChanged = [&delta](const IPAddress& ip) {
+    for (const auto& routeTableDelta : delta.getRouteTablesDelta()) {
+      if (ip.isV4() ? routesCover(routeTableDelta.getRoutesV4Delta(), ip)
+                    : routesCover(routeTableDelta.getRoutesV6Delta(), ip)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  for (const auto& mirror : *delta.newState()->getMirrors()) {
+    if (!mirror->getDestinationIp() || names.count(mirror->getID())) {
+      continue;
+    }
+    const auto& destinationIp = mirror->getDestinationIp().value();
+    auto neighbors = mirrorNeighbors_.find(mirror->getID());
+    if (neighbors == mirrorNeighbors_.end() || intfsChanged ||
+        routesChanged(destinationIp) ||
+        std::any_of(
+            neighbors->second.begin(),
+            neighbors->second.end(),
+            [&changedNeighbors](const IPAddress& ip) {
+              return changedNeighbors.count(ip) > 0;
+            })) {
+      names.insert(mirror->getID());
+    }
+  }
+  return names;
 }
 
 } // namespace fboss
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+
 #include "fboss/agent/MirrorManagerImpl.h"
 #include "fboss/agent/StateObserver.h"
 #include "fboss/agent/state/RouteNextHop.h"
@@ -22,14 +25,27 @@ class MirrorManager : public AutoRegisterStateObserver {
   void stateUpdated(const StateDelta& delta) override;
 
  private:
+  using MirrorNames = boost::container::flat_set<std::string>;
+  using NeighborIps = boost::container::flat_set<folly::IPAddress>;
+
   SwSwitch* sw_;
   std::unique_ptr<MirrorManagerV4> v4Manager_;
   std::unique_ptr<MirrorManagerV6> v6Manager_;
-
-  bool hasMirrorChanges(const StateDelta& delta);
+  /*
+   * The neighbor entries each mirror's resolution looked at last time it
+   * was resolved. Only accessed from the update thread.
+   */
+  boost::container::flat_map<std::string, NeighborIps> mirrorNeighbors_;
+
+  /*
+   * The mirrors whose resolution may have been changed by the delta: new
+   * mirrors, and those that a changed route or neighbor entry could lead to.
+   */
+  MirrorNames getMirrorsToResolve(const StateDelta& delta);
 
   std::shared_ptr<SwitchState> resolveMirrors(
-      const std::shared_ptr<SwitchState>& state);
+      const std::shared_ptr<SwitchState>& state,
+      const MirrorNames& names);
 };
 } // namespace fboss
 } // namespace facebook
@@ -23,9 +23,12 @@ namespace fboss {
 
 template <typename AddrT>
 std::shared_ptr<Mirror> MirrorManagerImpl<AddrT>::updateMirror(
-    const std::shared_ptr<Mirror>& mirror) {
+    const std::shared_ptr<Mirror>& mirror,
+    boost::container::flat_set<folly::IPAddress>* neighbors) {
   const AddrT destinationIp =
       getIPAddress<AddrT>(mirror->getDestinationIp().value());
+  /* the neighbor entry of a directly connected destination */
+  neighbors->insert(folly::IPAddress(destinationIp));
   const auto state = sw_->getState();
   const auto nexthops = resolveMirrorNextHops(state, destinationIp);
 
@@ -35,6 +38,10 @@ std::shared_ptr<Mirror> MirrorManagerImpl<AddrT>::updateMirror(
       mirror->getDestinationIp());
 
   for (const auto& nexthop : nexthops) {
+    /* a nexthop whose neighbor shows up later would be picked instead */
+    if (nexthop.isResolved()) {
+      neighbors->insert(nexthop.addr());
+    }
     const auto entry =
         resolveMirrorNextHopNeighbor(state, mirror, destinationIp, nexthop);
 
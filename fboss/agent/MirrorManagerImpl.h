@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <boost/container/flat_set.hpp>
+#include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 
@@ -28,7 +30,14 @@ class MirrorManagerImpl {
   explicit MirrorManagerImpl(SwSwitch* sw) : sw_(sw) {}
   ~MirrorManagerImpl() {}
 
-  std::shared_ptr<Mirror> updateMirror(const std::shared_ptr<Mirror>& mirror);
+  /*
+   * Resolve the mirror against the current state, returning nullptr if its
+   * resolution did not change. The addresses of the neighbor entries the
+   * resolution depends on are added to neighbors.
+   */
+  std::shared_ptr<Mirror> updateMirror(
+      const std::shared_ptr<Mirror>& mirror,
+      boost::container::flat_set<folly::IPAddress>* neighbors);
 
 private:
  NextHopSet resolveMirrorNextHops(
@@ -39,6 +39,7 @@ namespace facebook { namespace fboss {
 template <typename NTable>
 class NeighborCache {
   friend class NeighborCacheEntry<NTable>;
+  friend class NeighborCacheImpl<NTable>;
  public:
   typedef typename NTable::Entry::AddressType AddressType;
 
@@ -197,9 +198,20 @@ class NeighborCache {
     return impl_->flushEntry(ip);
   }
 
-  void processEntry(AddressType ip) {
+  // Called on the cache's event base when the timeout of an entry expires.
+  // Only queues the entry, so it does not need the lock.
+  void entryDue(AddressType ip) {
+    impl_->entryDue(ip);
+  }
+
+  // Run the entries queued by entryDue() since the last call
+  void processDueEntries() {
     std::lock_guard<std::mutex> g(cacheLock_);
-    return impl_->processEntry(ip);
+    impl_->processDueEntries();
+  }
+
+  folly::HHWheelTimer* getTimer() const {
+    return impl_->getTimer();
   }
 
   // Has the entry corresponding to ip has been hit in hw
@@ -215,8 +227,10 @@ class NeighborCache {
   std::chrono::seconds timeout_;
   uint32_t maxNeighborProbes_{0};
   std::chrono::seconds staleEntryInterval_;
-  std::unique_ptr<NeighborCacheImpl<NTable>> impl_;
+  // Declared ahead of impl_ to outlive it, the impl destructor waits for
+  // event base callbacks that may take the lock
   std::mutex cacheLock_;
+  std::unique_ptr<NeighborCacheImpl<NTable>> impl_;
 };
 
 }} // facebook::fboss
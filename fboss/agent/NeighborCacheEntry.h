@@ -20,6 +20,7 @@
 #include <folly/MacAddress.h>
 #include <folly/IPAddress.h>
 #include <folly/Random.h>
+#include <folly/io/async/HHWheelTimer.h>
 
 /**
  * This class implements much of the neighbor resolution and unreachable
@@ -52,9 +53,11 @@
  * UNINITIALIZED - Placeholder on startup.
  *
  * Once an entry is created, it is responsible for scheduling the timeout for
- * its next update. When that timeout expires, the state machine is run and the
- * next update is scheduled. If the entry ever transitions to the EXPIRED state,
- * we do not schedule another update and the cache will flush the entry.
+ * its next update on the timer wheel of its cache. When that timeout expires,
+ * the entry is handed to the cache, which runs the state machines of all the
+ * entries that came due in the same tick under one lock and schedules their
+ * next update. If the entry ever transitions to the EXPIRED state, we do not
+ * schedule another update and the cache will flush the entry.
  *
  * There is no locking in this class. Instead, the class relies on the
  * synchronization provided by NeighborCache, which should lock around all calls
@@ -78,7 +81,7 @@ enum class NeighborEntryState : uint8_t {
 template <typename NTable> class NeighborCache;
 
 template <typename NTable>
-class NeighborCacheEntry : private folly::AsyncTimeout {
+class NeighborCacheEntry : private folly::HHWheelTimer::Callback {
  public:
   typedef typename NTable::Entry::AddressType AddressType;
   typedef NeighborCache<NTable> Cache;
@@ -88,10 +91,10 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
                      folly::EventBase* evb,
                      Cache* cache,
                      NeighborEntryState state)
-      : AsyncTimeout(evb),
-        fields_(fields),
+      : fields_(fields),
         cache_(cache),
         evb_(evb),
+        timer_(cache_->getTimer()),
         probesLeft_(cache_->getMaxNeighborProbes()) {
     enter(state);
   }
@@ -222,7 +225,14 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
    * races.
    */
   void timeoutExpired() noexcept override {
-    cache_->processEntry(getIP());
+    cache_->entryDue(getIP());
+  }
+
+  // The timer is only destroyed with the cache, nothing left to do then
+  void callbackCanceled() noexcept override {}
+
+  void scheduleTimeout(std::chrono::milliseconds timeout) {
+    timer_->scheduleTimeout(this, timeout);
   }
 
   /*
@@ -400,6 +410,7 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
   // Additional state kept per cache entry.
   Cache* cache_;
   folly::EventBase* evb_;
+  folly::HHWheelTimer* timer_;
   NeighborEntryState state_{NeighborEntryState::UNINITIALIZED};
   uint8_t probesLeft_{0};
   std::chrono::time_point<std::chrono::steady_clock> expireTime_;
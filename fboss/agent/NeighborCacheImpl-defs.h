@@ -15,9 +15,13 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
 #include <list>
+#include <map>
+#include <mutex>
+#include <vector>
 #include "fboss/agent/ArpHandler.h"
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/NeighborCacheImpl.h"
+#include "fboss/agent/Tracepoints.h"
 #include "fboss/agent/state/ArpTable.h"
 #include "fboss/agent/state/NdpTable.h"
 #include "fboss/agent/state/NeighborEntry.h"
@@ -58,6 +62,45 @@ bool checkVlanAndIntf(
   return true;
 }
 
+/*
+ * Add or update the entry for fields in the neighbor table of vlanID,
+ * cloning *state as needed. Returns false if there was nothing to change.
+ */
+template <typename NTable>
+bool programEntry(
+    std::shared_ptr<SwitchState>* state,
+    const typename NeighborCacheEntry<NTable>::EntryFields& fields,
+    VlanID vlanID) {
+  if (!checkVlanAndIntf<NTable>(*state, fields, vlanID)) {
+    // Either the vlan or intf is no longer valid.
+    return false;
+  }
+
+  auto* vlan = (*state)->getVlans()->getVlanIf(vlanID).get();
+  auto* table = vlan->template getNeighborTable<NTable>().get();
+  auto node = table->getNodeIf(fields.ip);
+
+  if (!node) {
+    table = table->modify(&vlan, state);
+    table->addEntry(fields);
+    XLOG(DBG2) << "Adding entry for " << fields.ip << " --> " << fields.mac;
+  } else {
+    if (node->getMac() == fields.mac &&
+        node->getPort() == fields.port &&
+        node->getIntfID() == fields.interfaceID &&
+        node->getState() == fields.state &&
+        !node->isPending()) {
+      // This entry was already updated while we were waiting on the lock.
+      return false;
+    }
+    table = table->modify(&vlan, state);
+    table->updateEntry(fields);
+    XLOG(DBG2) << "Converting pending entry for " << fields.ip << " --> "
+               << fields.mac;
+  }
+  return true;
+}
+
 }
 
 template <typename NTable>
@@ -65,50 +108,73 @@ void NeighborCacheImpl<NTable>::programEntry(Entry* entry) {
   CHECK(!entry->isPending());
 
   auto fields = entry->getFields();
+  FBOSS_TRACEPOINT(
+      neighbor_resolved,
+      fields.ip.bytes(),
+      AddressType::byteCount(),
+      static_cast<uint16_t>(vlanID_),
+      fields.port.asThriftPort());
+  auto programs = pendingPrograms_;
+  {
+    std::lock_guard<std::mutex> g(programs->lock);
+    programs->entries.erase(fields.ip);
+    programs->entries.emplace(fields.ip, fields);
+    if (programs->scheduled) {
+      // The entry will be picked up by the update already queued
+      return;
+    }
+    programs->scheduled = true;
+  }
+
   auto vlanID = vlanID_;
-  auto updateFn = [fields, vlanID](const std::shared_ptr<SwitchState>& state)
+  auto updateFn = [programs, vlanID](const std::shared_ptr<SwitchState>& state)
       -> std::shared_ptr<SwitchState> {
-    if (!ncachehelpers::checkVlanAndIntf<NTable>(state, fields, vlanID)) {
-      // Either the vlan or intf is no longer valid.
-      return nullptr;
+    std::map<AddressType, EntryFields> entries;
+    {
+      std::lock_guard<std::mutex> g(programs->lock);
+      entries.swap(programs->entries);
+      programs->scheduled = false;
     }
 
-    auto vlan = state->getVlans()->getVlanIf(vlanID).get();
     std::shared_ptr<SwitchState> newState{state};
-    auto* table = vlan->template getNeighborTable<NTable>().get();
-    auto node = table->getNodeIf(fields.ip);
-
-    if (!node) {
-      table = table->modify(&vlan, &newState);
-      table->addEntry(fields);
-      XLOG(DBG2) << "Adding entry for " << fields.ip << " --> " << fields.mac;
-    } else {
-      if (node->getMac() == fields.mac &&
-          node->getPort() == fields.port &&
-          node->getIntfID() == fields.interfaceID &&
-          node->getState() == fields.state &&
-          !node->isPending()) {
-        // This entry was already updated while we were waiting on the lock.
-        return nullptr;
+    bool changed = false;
+    for (const auto& ipAndFields : entries) {
+      if (ncachehelpers::programEntry<NTable>(
+              &newState, ipAndFields.second, vlanID)) {
+        changed = true;
       }
-      table = table->modify(&vlan, &newState);
-      table->updateEntry(fields);
-      XLOG(DBG2) << "Converting pending entry for " << fields.ip << " --> "
-                 << fields.mac;
     }
-    return newState;
+    return changed ? newState : nullptr;
   };
 
-  sw_->updateState(folly::to<std::string>("add neighbor ", fields.ip),
-                   std::move(updateFn));
+  sw_->updateState(folly::to<std::string>("add neighbors on vlan ", vlanID),
+                   std::move(updateFn),
+                   StateUpdate::Priority::NEIGHBOR);
 }
 
+template <typename NTable>
+void NeighborCacheImpl<NTable>::startNewProgramBatch() {
+  auto programs = pendingPrograms_;
+  std::lock_guard<std::mutex> g(programs->lock);
+  if (programs->scheduled) {
+    // Entries resolved from now on must be programmed by an update queued
+    // after the one the caller is about to schedule, not by the one already
+    // queued ahead of it.
+    pendingPrograms_ = std::make_shared<PendingPrograms>();
+  }
+}
 
 template <typename NTable>
 void NeighborCacheImpl<NTable>::programPendingEntry(Entry* entry, bool force) {
   CHECK(entry->isPending());
+  startNewProgramBatch();
 
   auto fields = entry->getFields();
+  FBOSS_TRACEPOINT(
+      neighbor_pending,
+      fields.ip.bytes(),
+      AddressType::byteCount(),
+      static_cast<uint16_t>(vlanID_));
   auto vlanID = vlanID_;
   auto updateFn = [fields, vlanID, force](
     const std::shared_ptr<SwitchState>& state)
@@ -141,12 +207,19 @@ void NeighborCacheImpl<NTable>::programPendingEntry(Entry* entry, bool force) {
 
   sw_->updateStateNoCoalescing(
     folly::to<std::string>("add pending entry ", fields.ip),
-    std::move(updateFn));
+    std::move(updateFn),
+    StateUpdate::Priority::NEIGHBOR);
 }
 
 template <typename NTable>
 NeighborCacheImpl<NTable>::~NeighborCacheImpl() {
   clearEntries();
+  // The timer wheel and the due batch live on the event base too
+  folly::via(evb_, [this]() {
+    dueBatch_.cancelLoopCallback();
+    dueEntries_.clear();
+    timer_.reset();
+  }).get();
 }
 
 template <typename NTable>
@@ -256,14 +329,35 @@ void NeighborCacheImpl<NTable>::setPendingEntry(AddressType ip,
 }
 
 template <typename NTable>
-void NeighborCacheImpl<NTable>::processEntry(AddressType ip) {
+void NeighborCacheImpl<NTable>::entryDue(AddressType ip) {
+  DCHECK(evb_->isInEventBaseThread());
+  dueEntries_.push_back(ip);
+  if (!dueBatch_.isLoopCallbackScheduled()) {
+    evb_->runInLoop(&dueBatch_);
+  }
+}
+
+template <typename NTable>
+void NeighborCacheImpl<NTable>::processDueEntries() {
+  std::vector<AddressType> due;
+  due.swap(dueEntries_);
+  std::vector<AddressType> expired;
+  for (const auto& ip : due) {
+    if (processEntry(ip)) {
+      expired.push_back(ip);
+    }
+  }
+  flushEntries(expired);
+}
+
+template <typename NTable>
+bool NeighborCacheImpl<NTable>::processEntry(AddressType ip) {
   auto entry = getCacheEntry(ip);
   if (entry) {
     entry->process();
-    if (entry->getState() == NeighborEntryState::EXPIRED) {
-      flushEntry(ip);
-    }
+    return entry->getState() == NeighborEntryState::EXPIRED;
   }
+  return false;
 }
 
 template <typename NTable>
@@ -331,6 +425,7 @@ void NeighborCacheImpl<NTable>::flushEntry(AddressType ip, bool* flushed) {
   }
 
   // flush from SwitchState
+  startNewProgramBatch();
   auto updateFn =
     [this, ip, flushed](const std::shared_ptr<SwitchState>& state)
         -> std::shared_ptr<SwitchState> {
@@ -347,10 +442,50 @@ void NeighborCacheImpl<NTable>::flushEntry(AddressType ip, bool* flushed) {
   if (flushed) {
     // need a blocking state update if the caller wants to know if an entry
     // was actually flushed
-    sw_->updateStateBlocking("flush neighbor entry", std::move(updateFn));
+    sw_->updateStateBlocking(
+        "flush neighbor entry",
+        std::move(updateFn),
+        StateUpdate::Priority::NEIGHBOR);
   } else {
-    sw_->updateState("remove neighbor entry", std::move(updateFn));
+    sw_->updateState(
+        "remove neighbor entry",
+        std::move(updateFn),
+        StateUpdate::Priority::NEIGHBOR);
+  }
+}
+
+template <typename NTable>
+void NeighborCacheImpl<NTable>::flushEntries(
+    const std::vector<AddressType>& ips) {
+  std::vector<AddressType> removed;
+  for (const auto& ip : ips) {
+    if (removeEntry(ip)) {
+      removed.push_back(ip);
+    }
   }
+  if (removed.empty()) {
+    return;
+  }
+
+  startNewProgramBatch();
+  auto updateFn =
+    [this, removed](const std::shared_ptr<SwitchState>& state)
+        -> std::shared_ptr<SwitchState> {
+    std::shared_ptr<SwitchState> newState{state};
+    bool changed = false;
+    for (const auto& ip : removed) {
+      if (flushEntryFromSwitchState(&newState, ip)) {
+        changed = true;
+      }
+    }
+    return changed ? newState : nullptr;
+  };
+
+  sw_->updateState(
+      folly::to<std::string>(
+          "remove ", removed.size(), " neighbor entries on vlan ", vlanID_),
+      std::move(updateFn),
+      StateUpdate::Priority::NEIGHBOR);
 }
 
 template <typename NTable>
@@ -19,8 +19,14 @@
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
 #include <folly/Random.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
@@ -62,7 +68,10 @@ class NeighborCacheImpl {
         vlanID_(vlanID),
         vlanName_(vlanName),
         intfID_(intfID),
-        evb_(sw->getNeighborCacheEvb()) {}
+        evb_(sw->getNeighborCacheEvb(vlanID)),
+        timer_(folly::HHWheelTimer::newTimer(evb_)),
+        dueBatch_(this),
+        pendingPrograms_(std::make_shared<PendingPrograms>()) {}
 
   // Methods useful for subclasses
   void setPendingEntry(AddressType ip,
@@ -120,16 +129,36 @@ class NeighborCacheImpl {
 
   void clearEntries();
 
+  // The wheel all the entries schedule their next update on
+  folly::HHWheelTimer* getTimer() const {
+    return timer_.get();
+  }
+
  private:
   // These are used to program entries into the SwitchState
   void programEntry(Entry* entry);
   void programPendingEntry(Entry* entry, bool force = false);
-
-  void processEntry(AddressType ip);
+  // Make entries programmed from now on go into a new state update, so that
+  // they are applied after any update the caller is about to schedule
+  void startNewProgramBatch();
+
+  /*
+   * Entries whose timeout expired are queued by entryDue() and run together
+   * by processDueEntries() from a loop callback, once the timer wheel has
+   * expired everything due in the current tick. The entries that expire are
+   * flushed from the SwitchState by a single update.
+   */
+  void entryDue(AddressType ip);
+  void processDueEntries();
+
+  // Run the state machine of the entry, true if it expired
+  bool processEntry(AddressType ip);
 
   // Pass in a non-null flushed if you care whether an entry
   // was actually flushed from the switch state
   void flushEntry (AddressType ip, bool* flushed = nullptr);
+  // Flush all of ips with a single state update
+  void flushEntries(const std::vector<AddressType>& ips);
 
   bool flushEntryFromSwitchState(std::shared_ptr<SwitchState>* state,
                                  AddressType ip);
@@ -153,6 +182,37 @@ class NeighborCacheImpl {
   InterfaceID intfID_;
   folly::EventBase* evb_;
 
+  class DueBatch : public folly::EventBase::LoopCallback {
+   public:
+    explicit DueBatch(NeighborCacheImpl* impl) : impl_(impl) {}
+    void runLoopCallback() noexcept override {
+      impl_->cache_->processDueEntries();
+    }
+
+   private:
+    NeighborCacheImpl* impl_;
+  };
+
+  // Only used on evb_, by the entries and the due batch
+  folly::HHWheelTimer::UniquePtr timer_;
+  std::vector<AddressType> dueEntries_;
+  DueBatch dueBatch_;
+
+  /*
+   * Resolved entries waiting to be programmed into the SwitchState. All the
+   * entries resolved before the update thread gets to the first of them are
+   * programmed by a single state update. Shared with that update, and
+   * protected by its own lock since the update thread can't take the cache
+   * lock.
+   */
+  struct PendingPrograms {
+    std::mutex lock;
+    std::map<AddressType, EntryFields> entries;
+    // Whether a state update to program entries is queued
+    bool scheduled{false};
+  };
+  std::shared_ptr<PendingPrograms> pendingPrograms_;
+
   // Map of all entries
   std::unordered_map<AddressType, std::shared_ptr<Entry>> entries_;
 };
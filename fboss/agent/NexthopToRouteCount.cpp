@@ -14,6 +14,8 @@
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/Route.h"
 
+#include <folly/hash/Hash.h>
+
 using std::shared_ptr;
 using facebook::fboss::DeltaFunctions::forEachChanged;
 using facebook::fboss::DeltaFunctions::forEachAdded;
@@ -21,106 +23,150 @@ using facebook::fboss::DeltaFunctions::forEachRemoved;
 
 namespace facebook { namespace fboss {
 
-void NexthopToRouteCount::stateChanged(const StateDelta& delta) {
-   for (auto const& rtDelta : delta.getRouteTablesDelta()) {
-      // Do add/changed first so we don't remove next hops due to decrements
-      // in ref count via removed routes, only to add them back again if these
-      // next hops show up in added/changed routes
-     if (rtDelta.getNew()) {
-       RouterID id = rtDelta.getNew()->getID();
-       forEachChanged(
-           rtDelta.getRoutesV4Delta(),
-           &NexthopToRouteCount::processChangedRoute<RouteV4>,
-           &NexthopToRouteCount::processAddedRoute<RouteV4>,
-           [&](NexthopToRouteCount *, RouterID, const shared_ptr<RouteV4>&) {},
-           this,
-           id);
-       forEachChanged(
-           rtDelta.getRoutesV6Delta(),
-           &NexthopToRouteCount::processChangedRoute<RouteV6>,
-           &NexthopToRouteCount::processAddedRoute<RouteV6>,
-           [&](NexthopToRouteCount *, RouterID, const shared_ptr<RouteV6>&) {},
-           this,
-           id);
+namespace {
+template<typename RouteT>
+const RouteNextHopSet* countedNextHops(const shared_ptr<RouteT>& route) {
+  const auto& fwd = route->getForwardInfo();
+  if (route->isResolved() &&
+      fwd.getAction() == RouteForwardAction::NEXTHOPS) {
+    return &fwd.getNextHopSet();
+  }
+  return nullptr;
+}
+} // anonymous namespace
+
+size_t NexthopToRouteCount::NextHopHash::operator()(
+    const NextHop& nhop) const {
+  auto intf = nhop.intfID();
+  return folly::hash::hash_combine(
+      nhop.addr().hash(),
+      intf ? static_cast<uint32_t>(*intf) : ~0u,
+      nhop.weight());
+}
+
+NexthopToRouteCount::NexthopToRouteCount(SwSwitch* sw)
+    // Counting doesn't need to hold up the update thread
+    : AutoRegisterStateObserver(sw, "NexthopToRouteCount", true) {}
+
+NexthopToRouteCount::~NexthopToRouteCount() {
+  unregister();
+}
+
+void NexthopToRouteCount::stateUpdated(const StateDelta& delta) {
+  auto rid2nhopRefCounts = rid2nhopRefCounts_.wlock();
+  for (auto const& rtDelta : delta.getRouteTablesDelta()) {
+    // Do add/changed first so we don't remove next hops due to decrements
+    // in ref count via removed routes, only to add them back again if these
+    // next hops show up in added/changed routes
+    if (rtDelta.getNew()) {
+      auto* counts = &(*rid2nhopRefCounts)[rtDelta.getNew()->getID()];
+      forEachChanged(
+          rtDelta.getRoutesV4Delta(),
+          &NexthopToRouteCount::processChangedRoute<RouteV4>,
+          &NexthopToRouteCount::processAddedRoute<RouteV4>,
+          [](NhopRefCounts*, const shared_ptr<RouteV4>&) {},
+          counts);
+      forEachChanged(
+          rtDelta.getRoutesV6Delta(),
+          &NexthopToRouteCount::processChangedRoute<RouteV6>,
+          &NexthopToRouteCount::processAddedRoute<RouteV6>,
+          [](NhopRefCounts*, const shared_ptr<RouteV6>&) {},
+          counts);
     }
     // Process removed routes
     if (rtDelta.getOld()) {
-      RouterID id = rtDelta.getOld()->getID();
+      auto* counts = &(*rid2nhopRefCounts)[rtDelta.getOld()->getID()];
       forEachRemoved(
           rtDelta.getRoutesV4Delta(),
           &NexthopToRouteCount::processRemovedRoute<RouteV4>,
-          this,
-          id);
+          counts);
       forEachRemoved(
           rtDelta.getRoutesV6Delta(),
           &NexthopToRouteCount::processRemovedRoute<RouteV6>,
-          this,
-          id);
+          counts);
     }
   }
+  for (auto itr = rid2nhopRefCounts->begin();
+       itr != rid2nhopRefCounts->end();) {
+    itr = itr->second.empty() ? rid2nhopRefCounts->erase(itr) : ++itr;
+  }
+}
+
+int64_t NexthopToRouteCount::getCount(
+    RouterID rid,
+    const NextHop& nhop) const {
+  auto rid2nhopRefCounts = rid2nhopRefCounts_.rlock();
+  auto counts = rid2nhopRefCounts->find(rid);
+  if (counts == rid2nhopRefCounts->end()) {
+    return 0;
+  }
+  auto itr = counts->second.find(nhop);
+  return itr == counts->second.end() ? 0 : itr->second;
 }
 
 template<typename RouteT>
-void NexthopToRouteCount::processChangedRoute(const RouterID rid,
+void NexthopToRouteCount::processChangedRoute(NhopRefCounts* counts,
    const shared_ptr<RouteT>& oldRoute, const shared_ptr<RouteT>& newRoute) {
-  // We could compute set differences of nexthops from old and new routes,
-  // but since we would need to compute 2 set differences (new - old and
-  // old - new), it is similar complexity wise to just decrement reference
-  // for old next hops and increment reference for new next hops.
-  //  Do increment first so we don't need to delete and add nexthops
-  //  with ref count 1, which remained unchanged.
-  processAddedRoute(rid, newRoute);
-  processRemovedRoute(rid, oldRoute);
+  const auto* oldNhops = countedNextHops(oldRoute);
+  const auto* newNhops = countedNextHops(newRoute);
+  if (!oldNhops || !newNhops) {
+    processAddedRoute(counts, newRoute);
+    processRemovedRoute(counts, oldRoute);
+    return;
+  }
+  // Both sets are sorted, so one merge pass finds the next hops only in
+  // one of them. Those in both keep their count, which is the common case
+  // for an ECMP group gaining or losing a member.
+  auto oldItr = oldNhops->begin();
+  auto newItr = newNhops->begin();
+  while (oldItr != oldNhops->end() || newItr != newNhops->end()) {
+    if (newItr == newNhops->end() ||
+        (oldItr != oldNhops->end() && *oldItr < *newItr)) {
+      decNexthopReference(counts, *oldItr++);
+    } else if (oldItr == oldNhops->end() || *newItr < *oldItr) {
+      incNexthopReference(counts, *newItr++);
+    } else {
+      ++oldItr;
+      ++newItr;
+    }
+  }
 }
 
 template<typename RouteT>
-void NexthopToRouteCount::processAddedRoute(const RouterID rid,
+void NexthopToRouteCount::processAddedRoute(NhopRefCounts* counts,
     const shared_ptr<RouteT>& newRoute) {
-  const auto &fwd = newRoute->getForwardInfo();
-  if (newRoute->isResolved()
-      && fwd.getAction() == RouteForwardAction::NEXTHOPS) {
-    for (const auto& nhop : fwd.getNextHopSet()) {
-      incNexthopReference(rid, nhop);
+  if (const auto* nhops = countedNextHops(newRoute)) {
+    for (const auto& nhop : *nhops) {
+      incNexthopReference(counts, nhop);
     }
   }
 }
 
 template<typename RouteT>
-void NexthopToRouteCount::processRemovedRoute(const RouterID rid,
+void NexthopToRouteCount::processRemovedRoute(NhopRefCounts* counts,
    const shared_ptr<RouteT>& oldRoute) {
-  const auto &fwd = oldRoute->getForwardInfo();
-  if (oldRoute->isResolved()
-      && fwd.getAction() == RouteForwardAction::NEXTHOPS) {
-    for (const auto& nhop : fwd.getNextHopSet()) {
-      decNexthopReference(rid, nhop);
+  if (const auto* nhops = countedNextHops(oldRoute)) {
+    for (const auto& nhop : *nhops) {
+      decNexthopReference(counts, nhop);
     }
   }
 }
 
-void NexthopToRouteCount::incNexthopReference(RouterID rid,
+void NexthopToRouteCount::incNexthopReference(NhopRefCounts* counts,
     const NextHop& nhop) {
-  auto& nhop2RefCount = rid2nhopRefCounts_[rid];
-  auto itr = nhop2RefCount.find(nhop);
-  if (itr == nhop2RefCount.end()) {
-    nhop2RefCount.emplace(nhop, 1);
-  } else {
-    DCHECK(itr->second >= 1);
-    itr->second++;
-  }
+  auto itr = counts->emplace(nhop, 0).first;
+  DCHECK(itr->second >= 0);
+  itr->second++;
 }
 
-void NexthopToRouteCount::decNexthopReference(RouterID rid,
+void NexthopToRouteCount::decNexthopReference(NhopRefCounts* counts,
     const NextHop& nhop) {
-  auto& nhop2RefCount = rid2nhopRefCounts_[rid];
-  auto itr = nhop2RefCount.find(nhop);
-  CHECK(itr != nhop2RefCount.end());
+  auto itr = counts->find(nhop);
+  CHECK(itr != counts->end());
   itr->second--;
   DCHECK(itr->second >= 0);
   if (itr->second == 0) {
-    nhop2RefCount.erase(itr);
-  }
-  if (nhop2RefCount.empty()) {
-    rid2nhopRefCounts_.erase(rid);
+    counts->erase(itr);
   }
 }
 }}
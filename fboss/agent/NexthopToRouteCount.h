@@ -12,14 +12,19 @@
 #include <boost/container/flat_map.hpp>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
+#include <folly/Synchronized.h>
 
+#include "fboss/agent/StateObserver.h"
 #include "fboss/agent/state/RouteNextHop.h"
 #include "fboss/agent/types.h"
 
+#include <unordered_map>
+
 
 namespace facebook { namespace fboss {
 
 class StateDelta;
+class SwSwitch;
 /*
  * Simple class that maintains a map of route next hops to the
  * number of routes pointing to that next hop. The next hops
@@ -27,40 +32,57 @@ class StateDelta;
  * are in directly attached subnets.
  * This map is then used in NeighborUpdater to pro actively
  * ARP/NDP for any next hops which don't have ARP/NDP resolved
- * for them.
+ * for them, and by drain tooling through getNextHopRouteCounts().
+ *
+ * The counts are kept up to date from the route deltas alone, off the
+ * update thread. A route whose next hop set changes only touches the next
+ * hops that were added to or dropped from the set.
  */
-class NexthopToRouteCount {
+class NexthopToRouteCount : public AutoRegisterStateObserver {
  public:
-   explicit NexthopToRouteCount() {}
-   void stateChanged(const StateDelta& delta);
-   // Using int rather than uint to check against bugs where we
-   // get -ve reference counts
-   using RouterID2NhopRefCounts = boost::container::flat_map<RouterID,
-         boost::container::flat_map<NextHop, int64_t>>;
+  struct NextHopHash {
+    size_t operator()(const NextHop& nhop) const;
+  };
+  // Using int rather than uint to check against bugs where we
+  // get -ve reference counts
+  using NhopRefCounts = std::unordered_map<NextHop, int64_t, NextHopHash>;
+  using RouterID2NhopRefCounts =
+      boost::container::flat_map<RouterID, NhopRefCounts>;
+
+  explicit NexthopToRouteCount(SwSwitch* sw);
+  ~NexthopToRouteCount() override;
+
+  void stateUpdated(const StateDelta& delta) override;
 
-  using const_iterator = RouterID2NhopRefCounts::const_iterator;
-  const_iterator begin() const { return rid2nhopRefCounts_.begin(); }
-  const_iterator end() const { return rid2nhopRefCounts_.end(); }
+  // A copy of all the counts
+  RouterID2NhopRefCounts getCounts() const {
+    return *rid2nhopRefCounts_.rlock();
+  }
+  // The number of routes in rid through nhop
+  int64_t getCount(RouterID rid, const NextHop& nhop) const;
 
  private:
-    // Forbidden copy constructor and assignment operator
-    NexthopToRouteCount(NexthopToRouteCount const &) = delete;
-    NexthopToRouteCount& operator=(NexthopToRouteCount const &) = delete;
-    // Process route changes
-    template<typename RouteT>
-    void processChangedRoute(const RouterID id,
-        const std::shared_ptr<RouteT>& oldRoute,
-        const std::shared_ptr<RouteT>& newRoute);
-    template<typename RouteT>
-    void processAddedRoute(const RouterID id,
-        const std::shared_ptr<RouteT>& newRoute);
-    template<typename RouteT>
-    void processRemovedRoute(const RouterID id,
-        const std::shared_ptr<RouteT>& newRoute);
+  // Forbidden copy constructor and assignment operator
+  NexthopToRouteCount(NexthopToRouteCount const &) = delete;
+  NexthopToRouteCount& operator=(NexthopToRouteCount const &) = delete;
+  // Process route changes
+  template<typename RouteT>
+  static void processChangedRoute(
+      NhopRefCounts* counts,
+      const std::shared_ptr<RouteT>& oldRoute,
+      const std::shared_ptr<RouteT>& newRoute);
+  template<typename RouteT>
+  static void processAddedRoute(
+      NhopRefCounts* counts,
+      const std::shared_ptr<RouteT>& newRoute);
+  template<typename RouteT>
+  static void processRemovedRoute(
+      NhopRefCounts* counts,
+      const std::shared_ptr<RouteT>& oldRoute);
 
-    void incNexthopReference(RouterID rid, const NextHop& nhop);
-    void decNexthopReference(RouterID rid, const NextHop& nhop);
+  static void incNexthopReference(NhopRefCounts* counts, const NextHop& nhop);
+  static void decNexthopReference(NhopRefCounts* counts, const NextHop& nhop);
 
-    RouterID2NhopRefCounts rid2nhopRefCounts_;
+  folly::Synchronized<RouterID2NhopRefCounts> rid2nhopRefCounts_;
 };
 }}
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/PcapPublisher.h"
+
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+
+namespace {
+
+size_t dataLength(const facebook::fboss::PublishedPacket& pkt) {
+  const auto& data = pkt.packet.pkt;
+  return pkt.packet.rx ? data.get_rxpkt().packetData.size()
+                       : data.get_txpkt().packetData.size();
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+PcapPublisher::PcapPublisher(
+    folly::EventBase* evb,
+    SendHandler send,
+    DropHandler onDrop,
+    uint32_t maxBatchPackets,
+    uint32_t maxBatchBytes,
+    std::chrono::milliseconds maxDelay,
+    uint32_t maxInFlight)
+    : evb_(evb),
+      send_(std::move(send)),
+      onDrop_(std::move(onDrop)),
+      maxBatchPackets_(maxBatchPackets),
+      maxBatchBytes_(maxBatchBytes),
+      maxDelay_(maxDelay),
+      maxInFlight_(maxInFlight) {
+  CHECK_GT(maxBatchPackets, 0);
+  CHECK_GT(maxInFlight, 0);
+}
+
+void PcapPublisher::publish(PublishedPacket pkt) {
+  auto length = dataLength(pkt);
+  std::vector<PublishedPacket> full;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    if (batch_.empty()) {
+      auto generation = batchGeneration_;
+      evb_->runInEventBaseThread([this, generation] {
+        evb_->tryRunAfterDelay(
+            [this, generation] {
+              std::vector<PublishedPacket> expired;
+              {
+                std::lock_guard<std::mutex> g2(lock_);
+                if (generation != batchGeneration_) {
+                  // The batch was already sent
+                  return;
+                }
+                expired = takeBatchLocked();
+              }
+              send(std::move(expired));
+            },
+            maxDelay_.count());
+      });
+    }
+    batch_.push_back(std::move(pkt));
+    batchBytes_ += length;
+    if (batch_.size() < maxBatchPackets_ && batchBytes_ < maxBatchBytes_) {
+      return;
+    }
+    full = takeBatchLocked();
+  }
+  send(std::move(full));
+}
+
+void PcapPublisher::flush() {
+  std::vector<PublishedPacket> batch;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    batch = takeBatchLocked();
+  }
+  send(std::move(batch));
+}
+
+std::vector<PublishedPacket> PcapPublisher::takeBatchLocked() {
+  std::vector<PublishedPacket> batch;
+  batch.swap(batch_);
+  batchBytes_ = 0;
+  ++batchGeneration_;
+  return batch;
+}
+
+void PcapPublisher::send(std::vector<PublishedPacket> batch) {
+  if (batch.empty()) {
+    return;
+  }
+  if (inFlight_.fetch_add(1, std::memory_order_acq_rel) >= maxInFlight_) {
+    // The service isn't keeping up. Drop this batch rather than queueing up
+    // more work for it, or blocking the caller.
+    inFlight_.fetch_sub(1, std::memory_order_acq_rel);
+    numDropped_.fetch_add(batch.size(), std::memory_order_relaxed);
+    onDrop_(batch.size());
+    return;
+  }
+  evb_->runInEventBaseThread([ this, batch = std::move(batch) ]() mutable {
+    folly::makeFutureWith([&] { return send_(std::move(batch)); })
+        .ensure([this] { inFlight_.fetch_sub(1, std::memory_order_acq_rel); });
+  });
+}
+
+}} // facebook::fboss
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/futures/Future.h>
+
+#include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace folly {
+class EventBase;
+}
+
+namespace facebook { namespace fboss {
+
+/*
+ * PcapPublisher collects packets bound for the pcap distribution service
+ * into batches, and sends each batch in a single call, rather than making
+ * one RPC per packet.
+ *
+ * A batch is sent once it holds maxBatchPackets packets or maxBatchBytes
+ * bytes of packet data, or maxDelay after its first packet was published,
+ * whichever comes first. Batches are sent from the given EventBase.
+ *
+ * Publishing never blocks: when maxInFlight batches are already waiting to be
+ * sent or waiting for the service to acknowledge them, new batches are
+ * dropped and reported to the drop handler instead.
+ */
+class PcapPublisher {
+ public:
+  using SendHandler =
+      std::function<folly::Future<folly::Unit>(std::vector<PublishedPacket>)>;
+  using DropHandler = std::function<void(size_t numPkts)>;
+
+  PcapPublisher(
+      folly::EventBase* evb,
+      SendHandler send,
+      DropHandler onDrop,
+      uint32_t maxBatchPackets,
+      uint32_t maxBatchBytes,
+      std::chrono::milliseconds maxDelay,
+      uint32_t maxInFlight);
+
+  /*
+   * Queue a packet to be sent. May be called from any thread.
+   */
+  void publish(PublishedPacket pkt);
+
+  /*
+   * Send the packets queued so far without waiting for the batch to fill up.
+   */
+  void flush();
+
+  uint64_t numDropped() const {
+    return numDropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  PcapPublisher(PcapPublisher const &) = delete;
+  PcapPublisher& operator=(PcapPublisher const &) = delete;
+
+  // Must be called with lock_ held
+  std::vector<PublishedPacket> takeBatchLocked();
+  void send(std::vector<PublishedPacket> batch);
+
+  folly::EventBase* evb_;
+  SendHandler send_;
+  DropHandler onDrop_;
+  const uint32_t maxBatchPackets_;
+  const uint32_t maxBatchBytes_;
+  const std::chrono::milliseconds maxDelay_;
+  const uint32_t maxInFlight_;
+
+  // Batches handed to evb_ and not yet acknowledged
+  std::atomic<uint32_t> inFlight_{0};
+  std::atomic<uint64_t> numDropped_{0};
+
+  std::mutex lock_;
+  // Everything below is protected by lock_
+  std::vector<PublishedPacket> batch_;
+  uint64_t batchBytes_{0};
+  // Incremented every time a batch is taken, so that a timeout scheduled for
+  // an older batch doesn't cut a newer one short
+  uint64_t batchGeneration_{0};
+};
+
+}} // facebook::fboss
@@ -0,0 +1,248 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/PendingNeighborQueue.h"
+
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/DeltaFunctions.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <cstring>
+
+DEFINE_int32(pending_neighbor_timeout_ms, 1000,
+             "How long to wait for a solicited neighbor to resolve before "
+             "soliciting it again and dropping the packets queued for it");
+DEFINE_int32(pending_packets_per_neighbor, 4,
+             "Number of packets queued while waiting for a neighbor to "
+             "resolve, 0 to only deduplicate the solicitations");
+DEFINE_int32(pending_neighbors_max, 1024,
+             "Maximum number of neighbors waiting to resolve that are "
+             "tracked at once");
+
+using folly::IPAddress;
+using std::chrono::milliseconds;
+
+namespace facebook { namespace fboss {
+
+PendingNeighborQueue::PendingNeighborQueue(SwSwitch* sw)
+    : AutoRegisterStateObserver(sw, "PendingNeighborQueue"), sw_(sw) {}
+
+PendingNeighborQueue::~PendingNeighborQueue() {}
+
+bool PendingNeighborQueue::startSolicitation(
+    VlanID vlan,
+    const IPAddress& target,
+    Clock::time_point now) {
+  size_t dropped = 0;
+  bool solicit = true;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto it = neighbors_.find(Key(vlan, target));
+    if (it == neighbors_.end()) {
+      // Don't hold up the solicitation if there's no room to track it
+      getNeighbor(Key(vlan, target), now);
+    } else if (
+        now - it->second.solicited <
+        milliseconds(FLAGS_pending_neighbor_timeout_ms)) {
+      solicit = false;
+    } else {
+      // Timed out, start over
+      dropped = it->second.packets.size();
+      numPackets_ -= dropped;
+      it->second.packets.clear();
+      it->second.solicited = now;
+    }
+  }
+  dropPackets(dropped);
+  return solicit;
+}
+
+bool PendingNeighborQueue::enqueue(
+    VlanID vlan,
+    const IPAddress& target,
+    folly::io::Cursor l3,
+    uint32_t l3Len,
+    Clock::time_point now) {
+  if (FLAGS_pending_packets_per_neighbor <= 0 ||
+      !l3.canAdvance(l3Len)) {
+    return false;
+  }
+  auto copy = folly::IOBuf::create(l3Len);
+  l3.pull(copy->writableData(), l3Len);
+  copy->append(l3Len);
+
+  size_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto neighbor = getNeighbor(Key(vlan, target), now);
+    if (!neighbor) {
+      return false;
+    }
+    auto& packets = neighbor->packets;
+    while (packets.size() >=
+           static_cast<size_t>(FLAGS_pending_packets_per_neighbor)) {
+      packets.pop_front();
+      --numPackets_;
+      ++dropped;
+    }
+    packets.push_back(std::move(copy));
+    ++numPackets_;
+  }
+  dropPackets(dropped);
+  sw_->stats()->pendingPktQueued();
+  return true;
+}
+
+void PendingNeighborQueue::resolved(VlanID vlan, const IPAddress& target) {
+  auto packets = remove(Key(vlan, target));
+  if (!packets.empty()) {
+    XLOG(DBG4) << target << " on vlan " << vlan << " resolved, sending "
+               << packets.size() << " queued packets";
+    send(std::move(packets));
+  }
+}
+
+void PendingNeighborQueue::stateUpdated(const StateDelta& delta) {
+  if (empty_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    expire(Clock::now());
+  }
+
+  std::vector<Key> resolvedNeighbors;
+  std::vector<Key> removedNeighbors;
+  auto checkEntry = [&](VlanID vlan, const auto& entry) {
+    if (!entry->isPending()) {
+      resolvedNeighbors.emplace_back(vlan, IPAddress(entry->getIP()));
+    }
+  };
+  auto removeEntry = [&](VlanID vlan, const auto& entry) {
+    removedNeighbors.emplace_back(vlan, IPAddress(entry->getIP()));
+  };
+  for (const auto& vlanDelta : delta.getVlansDelta()) {
+    auto newVlan = vlanDelta.getNew();
+    if (!newVlan) {
+      // Whatever is queued for the vlan times out with the solicitations
+      continue;
+    }
+    auto vlan = newVlan->getID();
+    DeltaFunctions::forEachChanged(
+        vlanDelta.getArpDelta(),
+        [&](const auto& /*oldEntry*/, const auto& newEntry) {
+          checkEntry(vlan, newEntry);
+        },
+        [&](const auto& newEntry) { checkEntry(vlan, newEntry); },
+        [&](const auto& oldEntry) { removeEntry(vlan, oldEntry); });
+    DeltaFunctions::forEachChanged(
+        vlanDelta.getNdpDelta(),
+        [&](const auto& /*oldEntry*/, const auto& newEntry) {
+          checkEntry(vlan, newEntry);
+        },
+        [&](const auto& newEntry) { checkEntry(vlan, newEntry); },
+        [&](const auto& oldEntry) { removeEntry(vlan, oldEntry); });
+  }
+  for (const auto& key : resolvedNeighbors) {
+    resolved(key.first, key.second);
+  }
+  // A pending entry going away means the neighbor never answered
+  for (const auto& key : removedNeighbors) {
+    dropPackets(remove(key).size());
+  }
+}
+
+size_t PendingNeighborQueue::numPackets() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return numPackets_;
+}
+
+size_t PendingNeighborQueue::numNeighbors() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return neighbors_.size();
+}
+
+PendingNeighborQueue::Neighbor* PendingNeighborQueue::getNeighbor(
+    const Key& key,
+    Clock::time_point now) {
+  auto it = neighbors_.find(key);
+  if (it != neighbors_.end()) {
+    return &it->second;
+  }
+  auto maxNeighbors = static_cast<size_t>(
+      std::max(FLAGS_pending_neighbors_max, 0));
+  if (neighbors_.size() >= maxNeighbors) {
+    expire(now);
+    if (neighbors_.size() >= maxNeighbors) {
+      return nullptr;
+    }
+  }
+  auto& neighbor = neighbors_[key];
+  neighbor.solicited = now;
+  empty_ = false;
+  return &neighbor;
+}
+
+PendingNeighborQueue::Packets PendingNeighborQueue::remove(const Key& key) {
+  Packets packets;
+  std::lock_guard<std::mutex> g(lock_);
+  auto it = neighbors_.find(key);
+  if (it != neighbors_.end()) {
+    packets = std::move(it->second.packets);
+    numPackets_ -= packets.size();
+    neighbors_.erase(it);
+    empty_ = neighbors_.empty();
+  }
+  return packets;
+}
+
+void PendingNeighborQueue::expire(Clock::time_point now) {
+  auto timeout = milliseconds(FLAGS_pending_neighbor_timeout_ms);
+  size_t dropped = 0;
+  for (auto it = neighbors_.begin(); it != neighbors_.end();) {
+    if (now - it->second.solicited >= timeout) {
+      dropped += it->second.packets.size();
+      it = neighbors_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  numPackets_ -= dropped;
+  empty_ = neighbors_.empty();
+  dropPackets(dropped);
+}
+
+void PendingNeighborQueue::dropPackets(size_t count) {
+  if (count) {
+    sw_->stats()->pendingPktDropped(count);
+  }
+}
+
+void PendingNeighborQueue::send(Packets packets) {
+  for (auto& l3Pkt : packets) {
+    auto txPkt = sw_->allocateL3TxPacket(l3Pkt->length());
+    auto buf = txPkt->buf();
+    memcpy(buf->writableTail(), l3Pkt->data(), l3Pkt->length());
+    buf->append(l3Pkt->length());
+    // The neighbor is resolved now, so the hardware can route the packet
+    sw_->sendL3Packet(std::move(txPkt));
+    sw_->stats()->pendingPktSent();
+  }
+}
+
+}} // facebook::fboss
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/StateObserver.h"
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+class SwSwitch;
+
+/*
+ * Holds the trapped packets routed towards neighbors that aren't resolved
+ * yet, and remembers the neighbors we have recently solicited.
+ *
+ * When IPv4Handler or IPv6Handler get a packet to forward and the next hop
+ * has no ARP or NDP entry, they solicit it.  Rather than drop the packet, a
+ * copy of its L3 part is queued here, up to a few per neighbor.  Once the
+ * neighbor entry is resolved in the switch state, the queued packets are
+ * sent again through the hardware, which now has a route for them.
+ *
+ * Until the neighbor is resolved, or --pending_neighbor_timeout_ms have
+ * passed, further packets for it don't trigger another solicitation. This
+ * covers the window between sending the first solicitation and the
+ * pending neighbor entry showing up in the switch state.
+ *
+ * Called from the packet receiving threads and the update thread.
+ */
+class PendingNeighborQueue : public AutoRegisterStateObserver {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit PendingNeighborQueue(SwSwitch* sw);
+  ~PendingNeighborQueue() override;
+
+  void stateUpdated(const StateDelta& delta) override;
+
+  /*
+   * Record a solicitation for target on vlan is about to be sent. Returns
+   * false if one was sent less than the timeout ago, in which case it
+   * needn't be sent again.
+   */
+  bool startSolicitation(
+      VlanID vlan,
+      const folly::IPAddress& target,
+      Clock::time_point now = Clock::now());
+
+  /*
+   * Queue a copy of the l3Len bytes of the L3 packet at l3, to be sent once
+   * target on vlan is resolved. If target already has the maximum number
+   * of packets queued, the oldest one is dropped. Returns false if the
+   * packet couldn't be queued because too many neighbors are pending.
+   */
+  bool enqueue(
+      VlanID vlan,
+      const folly::IPAddress& target,
+      folly::io::Cursor l3,
+      uint32_t l3Len,
+      Clock::time_point now = Clock::now());
+
+  /*
+   * Send the packets queued for target on vlan and forget about it. Called
+   * from stateUpdated() when target resolves. If its entry goes away while
+   * still pending instead, the packets are dropped.
+   */
+  void resolved(VlanID vlan, const folly::IPAddress& target);
+
+  // Packets currently queued
+  size_t numPackets() const;
+  // Neighbors with an outstanding solicitation
+  size_t numNeighbors() const;
+
+ private:
+  using Key = std::pair<VlanID, folly::IPAddress>;
+  using Packets = std::deque<std::unique_ptr<folly::IOBuf>>;
+
+  struct Neighbor {
+    Clock::time_point solicited;
+    Packets packets;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  PendingNeighborQueue(PendingNeighborQueue const&) = delete;
+  PendingNeighborQueue& operator=(PendingNeighborQueue const&) = delete;
+
+  // Find or add the neighbor, nullptr if there is no room for it.
+  // Must be called with lock_ held.
+  Neighbor* getNeighbor(const Key& key, Clock::time_point now);
+  // Forget the neighbor, returning the packets queued for it
+  Packets remove(const Key& key);
+  // Forget the neighbors whose solicitation timed out. Must be called with
+  // lock_ held.
+  void expire(Clock::time_point now);
+  void dropPackets(size_t count);
+  void send(Packets packets);
+
+  SwSwitch* sw_{nullptr};
+  mutable std::mutex lock_;
+  std::map<Key, Neighbor> neighbors_;
+  size_t numPackets_{0};
+  // Whether there is anything at all to look for in state updates
+  std::atomic<bool> empty_{true};
+};
+
+}} // facebook::fboss
@@ -56,6 +56,15 @@ void PortStats::pktUnhandled() {
 void PortStats::pktToHost(uint32_t bytes) {
   switchStats_->pktToHost(bytes);
 }
+void PortStats::rxQueueDrop(RxPacketClass cls) {
+  switchStats_->rxQueueDrop(cls);
+}
+void PortStats::pktAclDropped() {
+  switchStats_->pktAclDropped();
+}
+void PortStats::pktPolicerDropped(CpuPolicerClass cls) {
+  switchStats_->pktPolicerDropped(cls);
+}
 
 void PortStats::arpPkt() {
   switchStats_->arpPkt();
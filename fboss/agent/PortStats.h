@@ -14,6 +14,8 @@
 namespace facebook { namespace fboss {
 
 class SwitchStats;
+enum class RxPacketClass : uint8_t;
+enum class CpuPolicerClass : uint8_t;
 
 class PortStats {
  public:
@@ -26,6 +28,9 @@ class PortStats {
   void pktError();
   void pktUnhandled();
   void pktToHost(uint32_t bytes); // number of packets forward to host
+  void rxQueueDrop(RxPacketClass cls); // rx queue for the packet was full
+  void pktAclDropped(); // dropped by a control plane acl
+  void pktPolicerDropped(CpuPolicerClass cls); // dropped by the cpu policer
 
   void arpPkt();
   void arpUnsupported();
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteAdmissionControl.h"
+
+#include "common/stats/ThreadCachedServiceData.h"
+#include "fboss/agent/FbossError.h"
+
+#include <folly/Conv.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+DEFINE_int32(
+    route_client_max_in_flight,
+    4,
+    "Blocking route update calls each routing client may have running at "
+    "once, 0 for no limit. Route deletes and syncFib are always let in");
+DEFINE_int64(
+    route_client_max_queued_routes,
+    1000000,
+    "Routes each routing client may have queued with enqueueAddUnicastRoutes "
+    "and not yet applied, 0 for no limit");
+DEFINE_int32(
+    route_client_admission_wait_ms,
+    1000,
+    "How long a route update over its client's limits waits for room "
+    "before failing (ms)");
+
+using facebook::stats::AVG;
+using facebook::stats::SUM;
+using std::chrono::steady_clock;
+
+namespace facebook { namespace fboss {
+
+RouteAdmissionControl::Ticket::Ticket(
+    RouteAdmissionControl* control,
+    ClientID client,
+    uint64_t routes,
+    bool queued)
+    : control_(control),
+      client_(client),
+      routes_(routes),
+      queued_(queued),
+      admitted_(steady_clock::now()) {}
+
+RouteAdmissionControl::Ticket::Ticket(Ticket&& other) noexcept
+    : control_(other.control_),
+      client_(other.client_),
+      routes_(other.routes_),
+      queued_(other.queued_),
+      admitted_(other.admitted_) {
+  other.control_ = nullptr;
+}
+
+RouteAdmissionControl::Ticket::~Ticket() {
+  if (control_) {
+    control_->release(*this);
+  }
+}
+
+namespace {
+
+std::string counterKey(ClientID client, const char* name) {
+  return folly::to<std::string>(
+      "route_client.", static_cast<int>(client), ".", name);
+}
+
+} // unnamed namespace
+
+RouteAdmissionControl::ClientState::ClientState(ClientID client)
+    : inFlightKey(counterKey(client, "in_flight")),
+      queuedRoutesKey(counterKey(client, "queued_routes")),
+      routesKey(counterKey(client, "routes")),
+      rejectedKey(counterKey(client, "rejected")),
+      latencyKey(counterKey(client, "latency.us")) {}
+
+RouteAdmissionControl::RouteAdmissionControl(
+    uint32_t maxInFlight,
+    uint64_t maxQueuedRoutes,
+    std::chrono::milliseconds maxWait)
+    : maxInFlight_(maxInFlight),
+      maxQueuedRoutes_(maxQueuedRoutes),
+      maxWait_(maxWait) {}
+
+std::unique_ptr<RouteAdmissionControl>
+RouteAdmissionControl::createFromFlags() {
+  return std::make_unique<RouteAdmissionControl>(
+      std::max(FLAGS_route_client_max_in_flight, 0),
+      std::max<int64_t>(FLAGS_route_client_max_queued_routes, 0),
+      std::chrono::milliseconds(
+          std::max(FLAGS_route_client_admission_wait_ms, 0)));
+}
+
+RouteAdmissionControl::Ticket RouteAdmissionControl::admitUpdate(
+    ClientID client,
+    uint64_t routes,
+    bool critical) {
+  return admit(client, routes, false, critical);
+}
+
+RouteAdmissionControl::Ticket RouteAdmissionControl::admitQueued(
+    ClientID client,
+    uint64_t routes,
+    bool critical) {
+  return admit(client, routes, true, critical);
+}
+
+RouteAdmissionControl::Ticket RouteAdmissionControl::admit(
+    ClientID client,
+    uint64_t routes,
+    bool queued,
+    bool critical) {
+  std::unique_lock<std::mutex> g(mutex_);
+  auto& state = getClientState(client);
+  auto hasRoom = [&] {
+    if (queued) {
+      return maxQueuedRoutes_ == 0 || state.queuedRoutes == 0 ||
+          state.queuedRoutes + routes <= maxQueuedRoutes_;
+    }
+    return maxInFlight_ == 0 || state.inFlight < maxInFlight_;
+  };
+  if (!critical && !hasRoom() &&
+      !released_.wait_for(g, maxWait_, hasRoom)) {
+    tcData().addStatValue(state.rejectedKey, 1, SUM);
+    throw FbossError(
+        "Route client ", static_cast<int>(client),
+        " has too many route updates ", queued ? "queued" : "in flight",
+        ", try again later");
+  }
+  if (queued) {
+    state.queuedRoutes += routes;
+    tcData().setCounter(state.queuedRoutesKey, state.queuedRoutes);
+  } else {
+    ++state.inFlight;
+    tcData().setCounter(state.inFlightKey, state.inFlight);
+  }
+  tcData().addStatValue(state.routesKey, routes, SUM);
+  return Ticket(this, client, routes, queued);
+}
+
+void RouteAdmissionControl::release(const Ticket& ticket) {
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      steady_clock::now() - ticket.admitted_);
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    auto& state = getClientState(ticket.client_);
+    if (ticket.queued_) {
+      state.queuedRoutes -= ticket.routes_;
+      tcData().setCounter(state.queuedRoutesKey, state.queuedRoutes);
+    } else {
+      --state.inFlight;
+      tcData().setCounter(state.inFlightKey, state.inFlight);
+    }
+    tcData().addStatValue(state.latencyKey, latency.count(), AVG);
+  }
+  released_.notify_all();
+}
+
+uint32_t RouteAdmissionControl::getInFlight(ClientID client) const {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto it = clients_.find(client);
+  return it == clients_.end() ? 0 : it->second.inFlight;
+}
+
+uint64_t RouteAdmissionControl::getQueuedRoutes(ClientID client) const {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto it = clients_.find(client);
+  return it == clients_.end() ? 0 : it->second.queuedRoutes;
+}
+
+RouteAdmissionControl::ClientState& RouteAdmissionControl::getClientState(
+    ClientID client) {
+  auto it = clients_.find(client);
+  if (it == clients_.end()) {
+    it = clients_
+             .emplace(
+                 std::piecewise_construct,
+                 std::forward_as_tuple(client),
+                 std::forward_as_tuple(client))
+             .first;
+  }
+  return it->second;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/types.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Per routing client admission control of route updates, so a client
+ * flooding the agent with them, say while it restarts, can't grow the
+ * pending updates without bound and starve the other clients.
+ *
+ * Each client may have at most maxInFlight blocking route update calls
+ * running at once, and at most maxQueuedRoutes routes in batches queued
+ * to the RouteUpdateQueue and not yet applied. A client over its limit
+ * is pushed back: its update waits for up to maxWait for room, and then
+ * fails with an FbossError asking it to try again later. A limit of 0 is
+ * no limit, and a single batch is always let in when the client has
+ * nothing queued, however big it is.
+ *
+ * The updates the forwarding of traffic depends on are admitted whatever
+ * the limits: route deletes, which keep traffic off withdrawn routes, and
+ * syncFib, which is how a client recovers. They still count against the
+ * limits of the client's other updates.
+ *
+ * For each client, route_client.<id>.in_flight and .queued_routes export
+ * what it has admitted, .routes and .rejected the routes updated and the
+ * updates rejected, and .latency.us how long updates take from being
+ * admitted to being applied.
+ */
+class RouteAdmissionControl {
+ public:
+  // Held for as long as an admitted update runs, or stays queued
+  class Ticket {
+   public:
+    Ticket(Ticket&& other) noexcept;
+    ~Ticket();
+
+   private:
+    friend class RouteAdmissionControl;
+    Ticket(
+        RouteAdmissionControl* control,
+        ClientID client,
+        uint64_t routes,
+        bool queued);
+
+    Ticket(Ticket const &) = delete;
+    Ticket& operator=(Ticket const &) = delete;
+    Ticket& operator=(Ticket&&) = delete;
+
+    RouteAdmissionControl* control_;
+    const ClientID client_;
+    const uint64_t routes_;
+    const bool queued_;
+    const std::chrono::steady_clock::time_point admitted_;
+  };
+
+  RouteAdmissionControl(
+      uint32_t maxInFlight,
+      uint64_t maxQueuedRoutes,
+      std::chrono::milliseconds maxWait);
+
+  // With the limits of the --route_client_* flags
+  static std::unique_ptr<RouteAdmissionControl> createFromFlags();
+
+  /*
+   * Admit a blocking update of routes routes by client, or a batch of them
+   * to queue. Critical updates are always admitted. Throws FbossError if
+   * the client stayed over its limit.
+   */
+  Ticket admitUpdate(ClientID client, uint64_t routes, bool critical);
+  Ticket admitQueued(ClientID client, uint64_t routes, bool critical);
+
+  uint32_t getInFlight(ClientID client) const;
+  uint64_t getQueuedRoutes(ClientID client) const;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RouteAdmissionControl(RouteAdmissionControl const &) = delete;
+  RouteAdmissionControl& operator=(RouteAdmissionControl const &) = delete;
+
+  struct ClientState {
+    explicit ClientState(ClientID client);
+
+    uint32_t inFlight{0};
+    uint64_t queuedRoutes{0};
+    const std::string inFlightKey;
+    const std::string queuedRoutesKey;
+    const std::string routesKey;
+    const std::string rejectedKey;
+    const std::string latencyKey;
+  };
+
+  Ticket admit(ClientID client, uint64_t routes, bool queued, bool critical);
+  void release(const Ticket& ticket);
+  // With mutex_ held
+  ClientState& getClientState(ClientID client);
+
+  const uint32_t maxInFlight_;
+  const uint64_t maxQueuedRoutes_;
+  const std::chrono::milliseconds maxWait_;
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  std::map<ClientID, ClientState> clients_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteGracefulRestart.h"
+
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateUpdate.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/io/async/EventBase.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <memory>
+
+DEFINE_int32(
+    route_graceful_restart_timeout_s,
+    300,
+    "How long the stale routes of a restarting routing client are kept if "
+    "it never sends its end of RIB. 0 keeps them until it does");
+
+namespace facebook { namespace fboss {
+
+namespace {
+template <typename RibT, typename StaleT>
+void addStaleRoutes(
+    RouterID rid,
+    ClientID client,
+    const RibT& rib,
+    StaleT* stale) {
+  for (const auto& route : *rib.routes()) {
+    if (route->getEntryForClient(client)) {
+      const auto& prefix = route->prefix();
+      stale->emplace(
+          rid,
+          folly::CIDRNetwork(folly::IPAddress(prefix.network), prefix.mask));
+    }
+  }
+}
+} // namespace
+
+size_t RouteGracefulRestart::begin(ClientID client) {
+  std::set<StaleRoute> stale;
+  for (const auto& routeTable : *sw_->getState()->getRouteTables()) {
+    auto rid = routeTable->getID();
+    addStaleRoutes(rid, client, *routeTable->getRibV4(), &stale);
+    addStaleRoutes(rid, client, *routeTable->getRibV6(), &stale);
+  }
+  auto numStale = stale.size();
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    id = nextId_++;
+    restarts_[client] = Restart{id, std::move(stale)};
+  }
+  XLOG(INFO) << "Client " << client << " restarting, marked " << numStale
+             << " routes stale";
+  if (FLAGS_route_graceful_restart_timeout_s > 0) {
+    scheduleTimeout(client, id);
+  }
+  return numStale;
+}
+
+void RouteGracefulRestart::refreshed(
+    ClientID client,
+    RouterID rid,
+    const folly::IPAddress& network,
+    uint8_t mask) {
+  std::lock_guard<std::mutex> g(mutex_);
+  if (restarts_.empty()) {
+    return;
+  }
+  auto it = restarts_.find(client);
+  if (it != restarts_.end()) {
+    it->second.stale.erase(
+        StaleRoute(rid, folly::CIDRNetwork(network.mask(mask), mask)));
+  }
+}
+
+size_t RouteGracefulRestart::endOfRib(ClientID client) {
+  if (!isRestarting(client)) {
+    XLOG(DBG2) << "End of RIB from client " << client
+               << " which wasn't restarting";
+    return 0;
+  }
+  return sweep(client, folly::none, true);
+}
+
+void RouteGracefulRestart::cancel(ClientID client) {
+  std::lock_guard<std::mutex> g(mutex_);
+  restarts_.erase(client);
+}
+
+bool RouteGracefulRestart::isRestarting(ClientID client) const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return restarts_.count(client) > 0;
+}
+
+void RouteGracefulRestart::scheduleTimeout(ClientID client, uint64_t id) {
+  auto evb = sw_->getBackgroundEvb();
+  auto timeoutMs =
+      std::chrono::milliseconds(
+          std::chrono::seconds(FLAGS_route_graceful_restart_timeout_s))
+          .count();
+  evb->runInEventBaseThread([this, evb, client, id, timeoutMs]() {
+    // Does nothing if the client sent its end of RIB or restarted again
+    evb->runAfterDelay(
+        [this, client, id]() { sweep(client, id, false); }, timeoutMs);
+  });
+}
+
+std::set<RouteGracefulRestart::StaleRoute> RouteGracefulRestart::takeStale(
+    ClientID client,
+    folly::Optional<uint64_t> id) {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto it = restarts_.find(client);
+  if (it == restarts_.end() || (id && it->second.id != *id)) {
+    return {};
+  }
+  auto stale = std::move(it->second.stale);
+  restarts_.erase(it);
+  return stale;
+}
+
+size_t RouteGracefulRestart::sweep(
+    ClientID client,
+    folly::Optional<uint64_t> id,
+    bool blocking) {
+  // Taken in the update thread, after the route changes queued before it
+  auto numDeleted = std::make_shared<size_t>(0);
+  auto updateFn = [this, client, id, numDeleted](
+                      const std::shared_ptr<SwitchState>& state)
+      -> std::shared_ptr<SwitchState> {
+    auto stale = takeStale(client, id);
+    if (stale.empty()) {
+      return nullptr;
+    }
+    RouteUpdater updater(state->getRouteTables());
+    for (const auto& route : stale) {
+      updater.delRoute(
+          route.first, route.second.first, route.second.second, client);
+    }
+    *numDeleted = stale.size();
+    XLOG(INFO) << "Deleting " << stale.size() << " stale routes of client "
+               << client;
+    auto newRt = updater.updateDone();
+    if (!newRt) {
+      return nullptr;
+    }
+    auto newState = state->clone();
+    newState->resetRouteTables(std::move(newRt));
+    return newState;
+  };
+  if (!blocking) {
+    sw_->updateState(
+        "delete stale routes",
+        std::move(updateFn),
+        StateUpdate::Priority::ROUTE);
+    return 0;
+  }
+  sw_->updateStateBlocking(
+      "delete stale routes", std::move(updateFn), StateUpdate::Priority::ROUTE);
+  return *numDeleted;
+}
+
+}} // facebook::fboss
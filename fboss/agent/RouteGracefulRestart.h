@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+namespace facebook { namespace fboss {
+
+class SwSwitch;
+
+/*
+ * RouteGracefulRestart lets a routing client restart without its routes
+ * being deleted and added back, in the software tables as in the hardware.
+ *
+ * When the client comes back, begin() marks all of its routes stale. They
+ * keep forwarding while the client re-advertises its routes with the usual
+ * add calls, each of them clearing the mark of its route. endOfRib() then
+ * deletes the routes still marked, which the client no longer has.
+ *
+ * If the client never sends its end of RIB, its stale routes are deleted
+ * after --route_graceful_restart_timeout_s.
+ */
+class RouteGracefulRestart {
+ public:
+  explicit RouteGracefulRestart(SwSwitch* sw) : sw_(sw) {}
+
+  /*
+   * Mark all of the client's routes stale, and return how many there are.
+   * Starts over if the client was already restarting.
+   */
+  size_t begin(ClientID client);
+
+  /*
+   * Note that the client added or deleted a route. Called for every route
+   * change of every client, so it is cheap when none is restarting.
+   */
+  void refreshed(
+      ClientID client,
+      RouterID rid,
+      const folly::IPAddress& network,
+      uint8_t mask);
+
+  /*
+   * Delete the client's routes still stale, and return how many it
+   * deleted. Does nothing if the client isn't restarting.
+   */
+  size_t endOfRib(ClientID client);
+
+  /*
+   * Forget about the client restarting, keeping its stale routes, e.g. once
+   * syncFib replaced all of them anyway.
+   */
+  void cancel(ClientID client);
+
+  bool isRestarting(ClientID client) const;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RouteGracefulRestart(RouteGracefulRestart const&) = delete;
+  RouteGracefulRestart& operator=(RouteGracefulRestart const&) = delete;
+
+  using StaleRoute = std::pair<RouterID, folly::CIDRNetwork>;
+  struct Restart {
+    uint64_t id;
+    std::set<StaleRoute> stale;
+  };
+
+  void scheduleTimeout(ClientID client, uint64_t id);
+  // End the client's restart, which must be restart id if set, and return
+  // its routes still stale
+  std::set<StaleRoute> takeStale(ClientID client, folly::Optional<uint64_t> id);
+  // Delete the stale routes, see takeStale()
+  size_t sweep(ClientID client, folly::Optional<uint64_t> id, bool blocking);
+
+  SwSwitch* sw_;
+  mutable std::mutex mutex_;
+  std::map<ClientID, Restart> restarts_;
+  uint64_t nextId_{1};
+};
+
+}} // facebook::fboss
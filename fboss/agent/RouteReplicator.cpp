@@ -0,0 +1,345 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteReplicator.h"
+
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/state/NodeMapDelta-defs.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteNextHopEntry.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+
+DEFINE_string(
+    route_replica_peers,
+    "",
+    "Comma separated host:port of the agents to replicate the routes of "
+    "--route_replica_clients to, e.g. those of the other cards of a "
+    "chassis. Empty to not replicate any routes");
+DEFINE_string(
+    route_replica_clients,
+    "0,786",
+    "Comma separated IDs of the routing clients whose routes are "
+    "replicated to --route_replica_peers");
+DEFINE_int32(
+    route_replica_timeout_ms,
+    60000,
+    "Timeout for each route update sent to a replica (ms)");
+DEFINE_int32(
+    route_replica_retry_ms,
+    1000,
+    "How long to wait before resyncing a replica an update failed to (ms)");
+
+using folly::SocketAddress;
+using std::shared_ptr;
+using std::vector;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// Only the default VRF is programmed through thrift
+const RouterID kRouterId(0);
+
+template <typename AddrT>
+IpPrefix toIpPrefix(const RoutePrefix<AddrT>& prefix) {
+  IpPrefix ipPrefix;
+  ipPrefix.ip = network::toBinaryAddress(prefix.network);
+  ipPrefix.prefixLength = prefix.mask;
+  return ipPrefix;
+}
+
+template <typename AddrT>
+UnicastRoute toUnicastRoute(
+    const RoutePrefix<AddrT>& prefix,
+    const RouteNextHopEntry& entry) {
+  UnicastRoute route;
+  route.dest = toIpPrefix(prefix);
+  route.nextHops = util::fromRouteNextHopSet(entry.getNextHopSet());
+  for (const auto& nh : route.nextHops) {
+    route.nextHopAddrs.emplace_back(nh.address);
+  }
+  route.adminDistance = entry.getAdminDistance();
+  route.__isset.adminDistance = true;
+  return route;
+}
+
+// The changes to the routes of clients from oldRoute to newRoute, either of
+// which may be null
+template <typename AddrT>
+void addRouteUpdates(
+    const shared_ptr<Route<AddrT>>& oldRoute,
+    const shared_ptr<Route<AddrT>>& newRoute,
+    const std::set<ClientID>& clients,
+    RouteReplicator::ClientUpdates* updates) {
+  const auto& prefix = newRoute ? newRoute->prefix() : oldRoute->prefix();
+  for (auto client : clients) {
+    auto oldEntry = oldRoute ? oldRoute->getEntryForClient(client) : nullptr;
+    auto newEntry = newRoute ? newRoute->getEntryForClient(client) : nullptr;
+    if (newEntry) {
+      if (!oldEntry || !(*oldEntry == *newEntry)) {
+        (*updates)[client].toAdd.push_back(toUnicastRoute(prefix, *newEntry));
+      }
+    } else if (oldEntry) {
+      (*updates)[client].toDelete.push_back(toIpPrefix(prefix));
+    }
+  }
+}
+
+template <typename RibT>
+void addRoutes(
+    const shared_ptr<RibT>& rib,
+    const std::set<ClientID>& clients,
+    std::map<ClientID, vector<UnicastRoute>>* routes) {
+  for (const auto& route : *rib->routes()) {
+    for (auto client : clients) {
+      auto entry = route->getEntryForClient(client);
+      if (entry) {
+        (*routes)[client].push_back(toUnicastRoute(route->prefix(), *entry));
+      }
+    }
+  }
+}
+
+} // unnamed namespace
+
+RouteReplicator::RouteReplicator(
+    SwSwitch* sw,
+    vector<SocketAddress> peers,
+    std::set<ClientID> clients)
+    // Building the updates doesn't need to hold up the update thread
+    : AutoRegisterStateObserver(sw, "RouteReplicator", true),
+      sw_(sw),
+      clients_(std::move(clients)) {
+  for (auto& addr : peers) {
+    peers_.push_back(std::make_unique<Peer>(std::move(addr)));
+  }
+}
+
+RouteReplicator::~RouteReplicator() {
+  unregister();
+  stopping_ = true;
+  // The clients have to go from the thread they run on, which fails their
+  // requests in flight
+  evbThread_.getEventBase()->runInEventBaseThreadAndWait([this]() {
+    for (auto& peer : peers_) {
+      peer->client.reset();
+    }
+  });
+}
+
+std::unique_ptr<RouteReplicator> RouteReplicator::createFromFlags(
+    SwSwitch* sw) {
+  if (FLAGS_route_replica_peers.empty()) {
+    return nullptr;
+  }
+  vector<folly::StringPiece> names;
+  folly::split(',', FLAGS_route_replica_peers, names, true);
+  vector<SocketAddress> peers;
+  for (auto name : names) {
+    SocketAddress addr;
+    try {
+      addr.setFromHostPort(name);
+    } catch (const std::exception& ex) {
+      throw FbossError("Invalid route replica ", name, ": ", ex.what());
+    }
+    peers.push_back(std::move(addr));
+  }
+  vector<folly::StringPiece> ids;
+  folly::split(',', FLAGS_route_replica_clients, ids, true);
+  std::set<ClientID> clients;
+  for (auto id : ids) {
+    clients.insert(ClientID(folly::to<int16_t>(id)));
+  }
+  XLOG(INFO) << "Replicating the routes of clients "
+             << FLAGS_route_replica_clients << " to "
+             << FLAGS_route_replica_peers;
+  return std::make_unique<RouteReplicator>(
+      sw, std::move(peers), std::move(clients));
+}
+
+RouteReplicator::ClientUpdates RouteReplicator::getUpdates(
+    const StateDelta& delta,
+    const std::set<ClientID>& clients) {
+  ClientUpdates updates;
+  for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+    const auto& table = rtDelta.getNew() ? rtDelta.getNew() : rtDelta.getOld();
+    if (table->getID() != kRouterId) {
+      continue;
+    }
+    for (const auto& routeDelta : rtDelta.getRoutesV4Delta()) {
+      addRouteUpdates(
+          routeDelta.getOld(), routeDelta.getNew(), clients, &updates);
+    }
+    for (const auto& routeDelta : rtDelta.getRoutesV6Delta()) {
+      addRouteUpdates(
+          routeDelta.getOld(), routeDelta.getNew(), clients, &updates);
+    }
+  }
+  return updates;
+}
+
+std::map<ClientID, vector<UnicastRoute>> RouteReplicator::getRoutes(
+    const shared_ptr<SwitchState>& state,
+    const std::set<ClientID>& clients) {
+  std::map<ClientID, vector<UnicastRoute>> routes;
+  for (auto client : clients) {
+    // Clients without routes are synced too, to delete any they had
+    routes[client];
+  }
+  auto table = state->getRouteTables()->getRouteTableIf(kRouterId);
+  if (table) {
+    addRoutes(table->getRibV4(), clients, &routes);
+    addRoutes(table->getRibV6(), clients, &routes);
+  }
+  return routes;
+}
+
+void RouteReplicator::stateUpdated(const StateDelta& delta) {
+  if (!sw_->isFibSynced()) {
+    // Our clients aren't back yet, the peers keep the routes they have
+    return;
+  }
+  auto updates = getUpdates(delta, clients_);
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    bool first = !state_;
+    state_ = delta.newState();
+    for (auto& peer : peers_) {
+      if (peer->needsSync) {
+        // Peers are synced for the first time here, and after a failure
+        // once they are retried
+        if (first) {
+          queueSync(peer.get(), state_);
+        }
+        continue;
+      }
+      for (const auto& update : updates) {
+        if (!update.second.toDelete.empty()) {
+          peer->queue.push_back(
+              Op{Op::DELETE, update.first, {}, update.second.toDelete});
+        }
+        if (!update.second.toAdd.empty()) {
+          peer->queue.push_back(
+              Op{Op::ADD, update.first, update.second.toAdd, {}});
+        }
+      }
+    }
+  }
+  evbThread_.getEventBase()->runInEventBaseThread([this]() {
+    for (auto& peer : peers_) {
+      sendNext(peer.get());
+    }
+  });
+}
+
+void RouteReplicator::queueSync(
+    Peer* peer,
+    const shared_ptr<SwitchState>& state) {
+  peer->queue.clear();
+  for (auto& clientRoutes : getRoutes(state, clients_)) {
+    peer->queue.push_back(
+        Op{Op::SYNC, clientRoutes.first, std::move(clientRoutes.second), {}});
+  }
+  peer->needsSync = false;
+}
+
+void RouteReplicator::sendNext(Peer* peer) {
+  if (stopping_) {
+    return;
+  }
+  Op op;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    if (peer->sending || peer->queue.empty()) {
+      return;
+    }
+    op = std::move(peer->queue.front());
+    peer->queue.pop_front();
+    peer->sending = true;
+  }
+  if (!peer->client) {
+    auto socket = apache::thrift::async::TAsyncSocket::newSocket(
+        evbThread_.getEventBase(), peer->addr);
+    auto channel = apache::thrift::HeaderClientChannel::newChannel(socket);
+    channel->setTimeout(FLAGS_route_replica_timeout_ms);
+    peer->client = std::make_unique<FbossCtrlAsyncClient>(std::move(channel));
+  }
+
+  auto client = static_cast<int16_t>(op.client);
+  folly::Future<folly::Unit> result = folly::makeFuture();
+  switch (op.kind) {
+    case Op::SYNC:
+      result = peer->client->future_syncFib(client, op.routes);
+      break;
+    case Op::ADD:
+      result = peer->client->future_addUnicastRoutes(client, op.routes);
+      break;
+    case Op::DELETE:
+      result = peer->client->future_deleteUnicastRoutes(client, op.prefixes);
+      break;
+  }
+  // The client completes its calls from the event base thread
+  result.then([this, peer](folly::Try<folly::Unit>&& t) {
+    sent(peer, t.hasException() ? t.exception() : folly::exception_wrapper());
+  });
+}
+
+void RouteReplicator::sent(Peer* peer, const folly::exception_wrapper& ew) {
+  if (stopping_) {
+    return;
+  }
+  if (!ew) {
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      peer->sending = false;
+    }
+    sendNext(peer);
+    return;
+  }
+
+  XLOG(ERR) << "Failed to replicate routes to " << peer->addr.describe()
+            << ", resyncing it in " << FLAGS_route_replica_retry_ms
+            << "ms: " << ew.what();
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    peer->sending = false;
+    peer->queue.clear();
+    peer->needsSync = true;
+  }
+  evbThread_.getEventBase()->runAfterDelay(
+      [this, peer]() {
+        if (stopping_) {
+          return;
+        }
+        // Reconnect, in case the peer restarted
+        peer->client.reset();
+        {
+          std::lock_guard<std::mutex> g(lock_);
+          if (peer->needsSync && state_) {
+            queueSync(peer, state_);
+          }
+        }
+        sendNext(peer);
+      },
+      FLAGS_route_replica_retry_ms);
+}
+
+}} // facebook::fboss
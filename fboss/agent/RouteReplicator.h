@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/StateObserver.h"
+#include "fboss/agent/if/gen-cpp2/FbossCtrl.h"
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+#include "fboss/agent/types.h"
+
+#include <folly/SocketAddress.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+class SwitchState;
+class SwSwitch;
+
+/*
+ * Replicates the routes of some routing clients to the agents of other
+ * cards of a chassis, e.g. from the fabric card agent of a Galaxy chassis
+ * to those of its line cards, so the routing clients only have to talk to
+ * one of them.
+ *
+ * The routes are replicated as the clients' own: a peer gets a syncFib for
+ * each client when it is first reached, and then only the routes which were
+ * added, changed or deleted by each state update, with addUnicastRoutes and
+ * deleteUnicastRoutes. Each peer has its own queue of updates, sent one at
+ * a time, so a slow peer doesn't hold up the others. A peer whose update
+ * fails loses its queue and is synced again once it is back. Nothing is
+ * replicated until our own FIB is synced, so a restart doesn't wipe the
+ * peers' routes before our clients are back.
+ *
+ * Neighbors aren't replicated: each card resolves the next hops of the
+ * routes over its own interfaces.
+ */
+class RouteReplicator : public AutoRegisterStateObserver {
+ public:
+  struct ClientUpdate {
+    std::vector<UnicastRoute> toAdd;
+    std::vector<IpPrefix> toDelete;
+  };
+  using ClientUpdates = std::map<ClientID, ClientUpdate>;
+
+  RouteReplicator(
+      SwSwitch* sw,
+      std::vector<folly::SocketAddress> peers,
+      std::set<ClientID> clients);
+  ~RouteReplicator() override;
+
+  // Null unless --route_replica_peers is set
+  static std::unique_ptr<RouteReplicator> createFromFlags(SwSwitch* sw);
+
+  void stateUpdated(const StateDelta& delta) override;
+
+  // The routes of each of clients to add and delete for delta, leaving out
+  // the clients without any. Public for tests.
+  static ClientUpdates getUpdates(
+      const StateDelta& delta,
+      const std::set<ClientID>& clients);
+  // All of the routes of each of clients in state. Public for tests.
+  static std::map<ClientID, std::vector<UnicastRoute>> getRoutes(
+      const std::shared_ptr<SwitchState>& state,
+      const std::set<ClientID>& clients);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RouteReplicator(RouteReplicator const &) = delete;
+  RouteReplicator& operator=(RouteReplicator const &) = delete;
+
+  struct Op {
+    enum Kind { SYNC, ADD, DELETE };
+    Kind kind;
+    ClientID client;
+    std::vector<UnicastRoute> routes;
+    std::vector<IpPrefix> prefixes;
+  };
+
+  struct Peer {
+    explicit Peer(folly::SocketAddress a) : addr(std::move(a)) {}
+
+    const folly::SocketAddress addr;
+    // Only used from the event base thread
+    std::unique_ptr<FbossCtrlAsyncClient> client;
+    // The rest only with lock_ held
+    std::deque<Op> queue;
+    bool sending{false};
+    bool needsSync{true};
+  };
+
+  // Queue the syncs of all of the clients' routes in state to peer, with
+  // lock_ held
+  void queueSync(Peer* peer, const std::shared_ptr<SwitchState>& state);
+  // Start sending the peer its next update, unless one is in flight, from
+  // the event base thread
+  void sendNext(Peer* peer);
+  void sent(Peer* peer, const folly::exception_wrapper& ew);
+
+  SwSwitch* const sw_;
+  const std::set<ClientID> clients_;
+  std::atomic<bool> stopping_{false};
+  std::mutex lock_;
+  // The latest state seen, once our FIB is synced, what peers coming back
+  // are synced from, so they miss no update
+  std::shared_ptr<SwitchState> state_;
+  std::vector<std::unique_ptr<Peer>> peers_;
+  folly::ScopedEventBaseThread evbThread_;
+};
+
+}} // facebook::fboss
@@ -61,11 +61,19 @@ RouteUpdateLogger::RouteUpdateLogger(
     SwSwitch* sw,
     std::unique_ptr<RouteLogger<folly::IPAddressV4>> routeLoggerV4,
     std::unique_ptr<RouteLogger<folly::IPAddressV6>> routeLoggerV6)
-    : AutoRegisterStateObserver(sw, "RouteUpdateLogger"),
+    // Logging route changes doesn't need to hold up the update thread
+    : AutoRegisterStateObserver(sw, "RouteUpdateLogger", true),
       routeLoggerV4_(std::move(routeLoggerV4)),
       routeLoggerV6_(std::move(routeLoggerV6)) {}
 
+RouteUpdateLogger::~RouteUpdateLogger() {
+  unregister();
+}
+
 void RouteUpdateLogger::stateUpdated(const StateDelta& delta) {
+  if (prefixTracker_.empty()) {
+    return;
+  }
   for (const auto& rtDelta : delta.getRouteTablesDelta()) {
     DeltaFunctions::forEachChanged(
         rtDelta.getRoutesV4Delta(),
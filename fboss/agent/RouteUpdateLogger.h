@@ -87,7 +87,7 @@ class RouteUpdateLogger : public AutoRegisterStateObserver {
       std::unique_ptr<RouteLogger<folly::IPAddressV4>> routeLoggerV4,
       std::unique_ptr<RouteLogger<folly::IPAddressV6>> routeLoggerV6);
 
-  ~RouteUpdateLogger() override = default;
+  ~RouteUpdateLogger() override;
 
   void stateUpdated(const StateDelta& delta) override;
   void startLoggingForPrefix(const RouteUpdateLoggingInstance& req);
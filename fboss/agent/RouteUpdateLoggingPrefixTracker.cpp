@@ -11,6 +11,8 @@
 #include "RouteUpdateLoggingPrefixTracker.h"
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+
 namespace facebook { namespace fboss {
 
 RouteUpdateLoggingInstance::RouteUpdateLoggingInstance(
@@ -28,26 +30,42 @@ void RouteUpdateLoggingPrefixTracker::track(
     const RouteUpdateLoggingInstance& req) {
   XLOG(INFO) << "Tracking " << req.str();
   SYNCHRONIZED(trackedPrefixes_) {
-    auto found = trackedPrefixes_[req.identifier].insert(
-        req.prefix.network, req.prefix.mask, req);
-    // Use the most recently set configuration
-    if (!found.second) {
-      found.first.value() = req;
+    auto itr = trackedPrefixes_.insert(
+        req.prefix.network, req.prefix.mask, Identifiers()).first;
+    auto& identifiers = itr.value();
+    auto found = identifiers.find(req.identifier);
+    if (found == identifiers.end()) {
+      identifiers.emplace(req.identifier, req.exact);
+      ++numTracked_;
+    } else {
+      // Use the most recently set configuration
+      found->second = req.exact;
     }
   }
 }
 
+size_t RouteUpdateLoggingPrefixTracker::eraseIdentifier(
+    PrefixTree& tree,
+    PrefixTree::Iterator itr,
+    const std::string& identifier) {
+  auto erased = itr.value().erase(identifier);
+  if (itr.value().empty()) {
+    tree.erase(itr);
+  }
+  return erased;
+}
+
 // stop tracking a particular requested prefix
 void RouteUpdateLoggingPrefixTracker::stopTracking(
     const RoutePrefix<folly::IPAddress>& prefix,
     const std::string& identifier) {
   XLOG(INFO) << "Stop tracking " << prefix.str() << " " << identifier;
   SYNCHRONIZED(trackedPrefixes_) {
-    auto itr = trackedPrefixes_.find(identifier);
+    auto itr = trackedPrefixes_.exactMatch(prefix.network, prefix.mask);
     if (itr == trackedPrefixes_.end()) {
       return;
     }
-    itr->second.erase(prefix.network, prefix.mask);
+    numTracked_ -= eraseIdentifier(trackedPrefixes_, itr, identifier);
   }
 }
 
@@ -55,24 +73,52 @@ void RouteUpdateLoggingPrefixTracker::stopTracking(
 void RouteUpdateLoggingPrefixTracker::stopTracking(
     const std::string& identifier) {
   XLOG(INFO) << "Stop tracking all prefixes for " << identifier;
-  trackedPrefixes_->erase(identifier);
+  SYNCHRONIZED(trackedPrefixes_) {
+    // Collect the prefixes first, erasing invalidates the iterators
+    std::vector<RoutePrefix<folly::IPAddress>> prefixes;
+    for (const auto& itr : trackedPrefixes_) {
+      if (itr.value().count(identifier)) {
+        prefixes.push_back({itr.ipAddress(), itr.masklen()});
+      }
+    }
+    for (const auto& prefix : prefixes) {
+      auto itr = trackedPrefixes_.exactMatch(prefix.network, prefix.mask);
+      numTracked_ -= eraseIdentifier(trackedPrefixes_, itr, identifier);
+    }
+  }
 }
 
 bool RouteUpdateLoggingPrefixTracker::trackingImpl(
     const RoutePrefix<folly::IPAddress>& prefix,
     std::vector<std::string>& identifiers) const {
   identifiers.clear();
+  if (empty()) {
+    return false;
+  }
   SYNCHRONIZED_CONST(trackedPrefixes_) {
-    for (const auto& prefixes : trackedPrefixes_) {
-      const auto match =
-          prefixes.second.longestMatch(prefix.network, prefix.mask);
-      if (match != prefixes.second.end()) {
-        if (!match.value().exact) {
-          identifiers.push_back(prefixes.first);
+    PrefixTree::VecConstIterators covering;
+    auto match = trackedPrefixes_.longestMatchWithTrail(
+        prefix.network, prefix.mask, covering);
+    if (match == trackedPrefixes_.end()) {
+      return false;
+    }
+    // Each identifier is decided by its most specific prefix covering this
+    // one, so walk up from the longest match. The identifiers settled one
+    // way or the other are kept in decided.
+    std::vector<const std::string*> decided;
+    for (auto itr = covering.rbegin(); itr != covering.rend(); ++itr) {
+      bool exactMatch = itr->masklen() == prefix.mask;
+      for (const auto& identifier : itr->value()) {
+        auto seen = std::find_if(
+            decided.begin(), decided.end(), [&](const std::string* id) {
+              return *id == identifier.first;
+            });
+        if (seen != decided.end()) {
           continue;
         }
-        if (match.value().prefix == prefix) {
-          identifiers.push_back(prefixes.first);
+        decided.push_back(&identifier.first);
+        if (!identifier.second || exactMatch) {
+          identifiers.push_back(identifier.first);
         }
       }
     }
@@ -84,9 +130,10 @@ std::vector<RouteUpdateLoggingInstance>
 RouteUpdateLoggingPrefixTracker::getTrackedPrefixes() const {
   std::vector<RouteUpdateLoggingInstance> allPrefixes;
   SYNCHRONIZED_CONST(trackedPrefixes_) {
-    for (const auto& prefixes : trackedPrefixes_) {
-      for (const auto& itr : prefixes.second) {
-        allPrefixes.push_back(itr->value());
+    for (const auto& itr : trackedPrefixes_) {
+      RoutePrefix<folly::IPAddress> prefix{itr.ipAddress(), itr.masklen()};
+      for (const auto& identifier : itr.value()) {
+        allPrefixes.emplace_back(prefix, identifier.first, identifier.second);
       }
     }
   }
@@ -11,11 +11,13 @@
 
 #include "fboss/lib/RadixTree.h"
 #include "fboss/agent/state/RouteTypes.h"
+#include <boost/container/flat_map.hpp>
 #include <folly/Synchronized.h>
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
-#include <unordered_map>
 
 namespace facebook { namespace fboss {
 
@@ -42,6 +44,10 @@ struct RouteUpdateLoggingInstance {
  * Keep track of network prefixes that the agent will
  * log route updates for.
  *
+ * The tracked prefixes of all identifiers share one radix tree, so checking
+ * a prefix is a single longest match followed by a walk up the covering
+ * prefixes, however many identifiers there are.
+ *
  * All the methods in this class are thread safe.
  */
 class RouteUpdateLoggingPrefixTracker {
@@ -60,6 +66,10 @@ class RouteUpdateLoggingPrefixTracker {
   // Stop tracking all the prefixes tracked with this identifier
   void stopTracking(const std::string& identifier);
   std::vector<RouteUpdateLoggingInstance> getTrackedPrefixes() const;
+  // Whether no prefix is tracked at all, without taking the lock
+  bool empty() const {
+    return numTracked_.load(std::memory_order_relaxed) == 0;
+  }
 
   /* Returns whether or not the prefix is tracked for logging.
    * Will also populate identifiers with all of the identifiers that
@@ -75,13 +85,23 @@ class RouteUpdateLoggingPrefixTracker {
   }
 
  private:
+  // The identifiers tracking a prefix, and whether each wants exact matches
+  using Identifiers = boost::container::flat_map<std::string, bool>;
+  using PrefixTree = network::RadixTree<folly::IPAddress, Identifiers>;
+
   bool trackingImpl(
       const RoutePrefix<folly::IPAddress>& prefix,
       std::vector<std::string>& identifiers) const;
-  folly::Synchronized<std::unordered_map<
-      std::string,
-      network::RadixTree<folly::IPAddress, RouteUpdateLoggingInstance>>>
-      trackedPrefixes_;
+  // Remove identifier from the prefix at itr, and the prefix if that was
+  // its last identifier. Must be called with trackedPrefixes_ locked.
+  static size_t eraseIdentifier(
+      PrefixTree& tree,
+      PrefixTree::Iterator itr,
+      const std::string& identifier);
+
+  folly::Synchronized<PrefixTree> trackedPrefixes_;
+  // The (prefix, identifier) pairs tracked
+  std::atomic<size_t> numTracked_{0};
 };
 
 }} // facebook::fboss
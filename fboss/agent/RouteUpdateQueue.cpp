@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteUpdateQueue.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateUpdate.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/logging/xlog.h>
+#include <glog/logging.h>
+
+namespace {
+// Failed batch ranges remembered for waitFor()
+constexpr size_t kMaxFailures = 64;
+}
+
+namespace facebook { namespace fboss {
+
+class RouteUpdateQueue::Update : public StateUpdate {
+ public:
+  explicit Update(RouteUpdateQueue* queue)
+      : StateUpdate("queued route updates", true, Priority::ROUTE),
+        queue_(queue) {}
+
+  std::shared_ptr<SwitchState> applyUpdate(
+      const std::shared_ptr<SwitchState>& origState) override {
+    batches_ = queue_->takeBatches();
+    if (batches_.empty()) {
+      return nullptr;
+    }
+    RouteUpdater updater(origState->getRouteTables());
+    for (const auto& batch : batches_) {
+      batch.second(&updater);
+    }
+    auto newRt = updater.updateDone();
+    if (!newRt) {
+      return nullptr;
+    }
+    auto newState = origState->clone();
+    newState->resetRouteTables(std::move(newRt));
+    return newState;
+  }
+
+  void onError(const std::exception& ex) noexcept override {
+    if (!batches_.empty()) {
+      std::string error = ex.what();
+      queue_->batchesDone(
+          batches_.front().first, batches_.back().first, &error);
+    }
+  }
+
+  void onSuccess() override {
+    if (!batches_.empty()) {
+      queue_->batchesDone(
+          batches_.front().first, batches_.back().first, nullptr);
+    }
+  }
+
+ private:
+  RouteUpdateQueue* queue_;
+  std::vector<Batch> batches_;
+};
+
+uint64_t RouteUpdateQueue::enqueue(BatchFn batch) {
+  uint64_t seq;
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    seq = nextSeq_++;
+    batches_.emplace_back(seq, std::move(batch));
+    schedule = !updateScheduled_;
+    updateScheduled_ = true;
+  }
+  // Only one update waits for the batches at a time, any batch queued
+  // before it runs rides along with it
+  if (schedule) {
+    sw_->updateState(std::make_unique<Update>(this));
+  }
+  return seq;
+}
+
+std::vector<RouteUpdateQueue::Batch> RouteUpdateQueue::takeBatches() {
+  std::vector<Batch> batches;
+  std::lock_guard<std::mutex> g(mutex_);
+  batches.swap(batches_);
+  updateScheduled_ = false;
+  return batches;
+}
+
+void RouteUpdateQueue::batchesDone(
+    uint64_t first,
+    uint64_t last,
+    const std::string* error) {
+  if (error) {
+    XLOG(ERR) << "Failed to apply route batches " << first << " to " << last
+              << ": " << *error;
+  }
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    // Updates run one at a time in the update thread, so batches are done
+    // in sequence order
+    DCHECK_GT(last, programmedSeq_);
+    programmedSeq_ = last;
+    if (error) {
+      failures_.emplace(last, std::make_pair(first, *error));
+      if (failures_.size() > kMaxFailures) {
+        failures_.erase(failures_.begin());
+      }
+    }
+  }
+  programmed_.notify_all();
+}
+
+bool RouteUpdateQueue::waitFor(
+    uint64_t seq,
+    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> guard(mutex_);
+  if (seq >= nextSeq_) {
+    throw FbossError("Route batch ", seq, " has not been queued");
+  }
+  if (!programmed_.wait_for(
+          guard, timeout, [&] { return programmedSeq_ >= seq; })) {
+    return false;
+  }
+  auto failure = failures_.lower_bound(seq);
+  if (failure != failures_.end() && failure->second.first <= seq) {
+    throw FbossError(
+        "Route batch ", seq, " failed to apply: ", failure->second.second);
+  }
+  return true;
+}
+
+uint64_t RouteUpdateQueue::getProgrammedSeq() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return programmedSeq_;
+}
+
+}} // facebook::fboss
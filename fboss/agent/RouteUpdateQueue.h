@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class RouteUpdater;
+class SwSwitch;
+
+/*
+ * RouteUpdateQueue lets route clients queue batches of route changes without
+ * waiting for each of them to be applied.
+ *
+ * Every batch queued while no update is pending schedules one state update.
+ * When the update thread gets to it, that update applies all the batches
+ * queued by then, from all clients, in one RouteUpdater pass. They are then
+ * programmed in one hardware update.
+ *
+ * Batches are numbered in the order they are queued, and they are applied
+ * in that order. Callers can wait for everything up to a given sequence
+ * number to be programmed.
+ */
+class RouteUpdateQueue {
+ public:
+  using BatchFn = std::function<void(RouteUpdater* updater)>;
+
+  explicit RouteUpdateQueue(SwSwitch* sw) : sw_(sw) {}
+
+  /*
+   * Queue a batch, and return its sequence number. Sequence numbers start
+   * at 1.
+   *
+   * The batch is called in the update thread. If it throws, none of the
+   * batches applied along with it take effect.
+   */
+  uint64_t enqueue(BatchFn batch);
+
+  /*
+   * Wait for up to timeout until every batch up to seq has been handed to
+   * the hardware, and return whether it was. Throws FbossError if batch
+   * seq failed to apply.
+   */
+  bool waitFor(uint64_t seq, std::chrono::milliseconds timeout);
+
+  /*
+   * Sequence number of the last batch handed to the hardware.
+   */
+  uint64_t getProgrammedSeq() const;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RouteUpdateQueue(RouteUpdateQueue const &) = delete;
+  RouteUpdateQueue& operator=(RouteUpdateQueue const &) = delete;
+
+  class Update;
+  using Batch = std::pair<uint64_t, BatchFn>;
+
+  std::vector<Batch> takeBatches();
+  void batchesDone(uint64_t first, uint64_t last, const std::string* error);
+
+  SwSwitch* sw_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable programmed_;
+  uint64_t nextSeq_{1};
+  std::vector<Batch> batches_;
+  // Whether a scheduled update has yet to take batches_
+  bool updateScheduled_{false};
+  uint64_t programmedSeq_{0};
+  // Recently failed batches, as ranges of sequence numbers keyed by the last
+  // one, and the error they failed with.
+  std::map<uint64_t, std::pair<uint64_t, std::string>> failures_;
+};
+
+}} // facebook::fboss
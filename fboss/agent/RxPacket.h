@@ -12,6 +12,8 @@
 #include "fboss/agent/Packet.h"
 #include "fboss/agent/types.h"
 
+#include <folly/io/Cursor.h>
+
 #include <string>
 #include <tuple>
 #include <vector>
@@ -92,6 +94,22 @@ class RxPacket : public Packet {
     return {};
   }
 
+  /*
+   * The packet data may live in memory owned by the hardware (e.g. an SDK
+   * DMA buffer), which is only given back once the last IOBuf sharing it is
+   * destroyed.  Handlers can use or clone buf() without copying while the
+   * packet is being handled, but anything that keeps the data around after
+   * that (e.g. packet captures) should hold a copy from copyBuf() instead,
+   * so that receive buffers are returned to the hardware promptly.
+   */
+  std::unique_ptr<folly::IOBuf> copyBuf() const {
+    auto length = buf_->computeChainDataLength();
+    auto copy = folly::IOBuf::create(length);
+    folly::io::Cursor(buf_.get()).pull(copy->writableData(), length);
+    copy->append(length);
+    return copy;
+  }
+
  protected:
   PortID srcPort_{0};
   bool isFromAggregatePort_{false};
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RxPacketDispatcher.h"
+
+#include <folly/Conv.h>
+#include <glog/logging.h>
+
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/Utils.h"
+
+namespace {
+// Maximum number of packets handled per event loop iteration, so that the
+// worker still gets to run other callbacks (e.g. stop()) during a storm.
+constexpr int kMaxPacketsPerLoop = 256;
+}
+
+namespace facebook { namespace fboss {
+
+constexpr size_t RxPacketDispatcher::kNumClasses;
+
+const char* rxPacketClassName(RxPacketClass cls) {
+  switch (cls) {
+    case RxPacketClass::CONTROL:
+      return "control";
+    case RxPacketClass::HIGH_PRIORITY:
+      return "high_priority";
+    case RxPacketClass::ARP:
+      return "arp";
+    case RxPacketClass::DEFAULT:
+      return "default";
+  }
+  return "unknown";
+}
+
+RxPacketDispatcher::RxPacketDispatcher(
+    PacketHandler handler,
+    DropHandler dropHandler,
+    uint32_t queueSize)
+    : handler_(std::move(handler)), dropHandler_(std::move(dropHandler)) {
+  CHECK_GT(queueSize, 0);
+  for (auto& queue : queues_) {
+    queue = std::make_unique<Queue>(queueSize);
+  }
+}
+
+RxPacketDispatcher::~RxPacketDispatcher() {
+  stop();
+}
+
+void RxPacketDispatcher::start() {
+  CHECK(!running_.load());
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    auto queue = queues_[i].get();
+    auto name = folly::to<std::string>(
+        "fbossRx.", rxPacketClassName(static_cast<RxPacketClass>(i)));
+    queue->thread = std::make_unique<std::thread>([queue, name] {
+      initThread(name);
+      queue->evb.loopForever();
+    });
+  }
+  running_.store(true);
+}
+
+void RxPacketDispatcher::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  for (auto& queue : queues_) {
+    auto evb = &queue->evb;
+    evb->runInEventBaseThread([evb] { evb->terminateLoopSoon(); });
+  }
+  for (auto& queue : queues_) {
+    queue->thread->join();
+    queue->thread.reset();
+    std::unique_ptr<RxPacket> pkt;
+    while (queue->packets.read(pkt)) {
+      pkt.reset();
+    }
+    queue->drainScheduled.store(false);
+  }
+}
+
+bool RxPacketDispatcher::dispatch(
+    RxPacketClass cls,
+    std::unique_ptr<RxPacket> pkt) {
+  auto queue = queues_[static_cast<size_t>(cls)].get();
+  // write() leaves pkt untouched if the queue is full
+  if (!running_.load() || !queue->packets.write(std::move(pkt))) {
+    dropHandler_(cls, *pkt);
+    return false;
+  }
+  scheduleDrain(queue);
+  return true;
+}
+
+void RxPacketDispatcher::scheduleDrain(Queue* queue) {
+  // Only one drain() needs to be pending at a time: it handles every packet
+  // queued before it resets drainScheduled.
+  if (!queue->drainScheduled.exchange(true)) {
+    queue->evb.runInEventBaseThread([this, queue] { drain(queue); });
+  }
+}
+
+void RxPacketDispatcher::drain(Queue* queue) {
+  queue->drainScheduled.store(false);
+  if (!running_.load()) {
+    // A dispatch() racing with stop() may have scheduled this after the
+    // queues were cleared. The handlers may already be gone by now.
+    return;
+  }
+  std::unique_ptr<RxPacket> pkt;
+  for (int i = 0; i < kMaxPacketsPerLoop; ++i) {
+    if (!queue->packets.read(pkt)) {
+      return;
+    }
+    handler_(std::move(pkt));
+  }
+  scheduleDrain(queue);
+}
+
+}} // facebook::fboss
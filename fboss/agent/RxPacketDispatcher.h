@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/MPMCQueue.h>
+#include <folly/io/async/EventBase.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace facebook { namespace fboss {
+
+class RxPacket;
+
+/*
+ * Classes of received packets. Each class is queued and handled separately,
+ * so that e.g. an ARP storm can't delay LACP or LLDP processing.
+ */
+enum class RxPacketClass : uint8_t {
+  // LACP and LLDP, which keep links and aggregates up
+  CONTROL,
+  // Packets trapped to a high priority CPU CoS queue (e.g. BGP)
+  HIGH_PRIORITY,
+  ARP,
+  // Everything else: NDP, DHCP, other IPv4/IPv6 slow path packets
+  DEFAULT,
+};
+
+const char* rxPacketClassName(RxPacketClass cls);
+
+/*
+ * RxPacketDispatcher takes packets from the thread the HwSwitch received them
+ * on and hands them to a worker thread per RxPacketClass.
+ *
+ * Each class has a bounded lock free queue, served by its own EventBase
+ * thread. When a queue is full, packets for that class are dropped (and
+ * reported to the drop callback) rather than slowing down the thread
+ * receiving them or the other classes.
+ *
+ * Packets of the same class are handled in the order they were dispatched.
+ */
+class RxPacketDispatcher {
+ public:
+  static constexpr size_t kNumClasses =
+      static_cast<size_t>(RxPacketClass::DEFAULT) + 1;
+
+  using PacketHandler = std::function<void(std::unique_ptr<RxPacket>)>;
+  // Called on the dispatching thread for every packet that is dropped
+  using DropHandler = std::function<void(RxPacketClass, const RxPacket&)>;
+
+  RxPacketDispatcher(
+      PacketHandler handler,
+      DropHandler dropHandler,
+      uint32_t queueSize);
+  ~RxPacketDispatcher();
+
+  /*
+   * Start and stop the worker threads. Packets still queued when stopping
+   * are dropped without being handled or reported.
+   */
+  void start();
+  void stop();
+
+  /*
+   * Queue a packet to be handled by the worker for the given class.
+   * Returns false if the packet had to be dropped instead.
+   */
+  bool dispatch(RxPacketClass cls, std::unique_ptr<RxPacket> pkt);
+
+ private:
+  struct Queue {
+    explicit Queue(uint32_t size) : packets(size) {}
+
+    folly::MPMCQueue<std::unique_ptr<RxPacket>> packets;
+    // Whether a drain() call is already pending on evb
+    std::atomic<bool> drainScheduled{false};
+    folly::EventBase evb;
+    std::unique_ptr<std::thread> thread;
+  };
+
+  void scheduleDrain(Queue* queue);
+  void drain(Queue* queue);
+
+  // Forbidden copy constructor and assignment operator
+  RxPacketDispatcher(RxPacketDispatcher const &) = delete;
+  RxPacketDispatcher& operator=(RxPacketDispatcher const &) = delete;
+
+  PacketHandler handler_;
+  DropHandler dropHandler_;
+  std::array<std::unique_ptr<Queue>, kNumClasses> queues_;
+  std::atomic<bool> running_{false};
+};
+
+}} // facebook::fboss
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SflowRateController.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace facebook { namespace fboss {
+
+namespace {
+// Only start sampling more often once we'd still be under the target after
+// doing so, to avoid flapping between two multipliers
+constexpr uint64_t kRecoveryFraction = 4;
+}
+
+SflowRateController::SflowRateController(
+    uint64_t targetSamplesPerSec,
+    uint32_t maxMultiplier)
+    : targetSamplesPerSec_(std::max<uint64_t>(targetSamplesPerSec, 1)),
+      maxMultiplier_(std::max<uint32_t>(maxMultiplier, 1)) {}
+
+void SflowRateController::setConfiguredRates(
+    PortID port,
+    int64_t ingress,
+    int64_t egress) {
+  auto& state = ports_[port];
+  state.configured = Rates{ingress, egress};
+  state.multiplier = 1;
+}
+
+SflowRateController::Rates SflowRateController::getEffectiveRates(
+    PortID port) const {
+  auto it = ports_.find(port);
+  return it == ports_.end() ? Rates() : it->second.effective();
+}
+
+SflowRateController::RateChanges SflowRateController::update(
+    const boost::container::flat_map<PortID, uint64_t>& samples,
+    uint64_t drops,
+    std::chrono::milliseconds interval) {
+  RateChanges changes;
+  auto ms = std::max<int64_t>(interval.count(), 1);
+  uint64_t total = drops;
+  for (const auto& entry : samples) {
+    total += entry.second;
+  }
+  // Compare samples over the interval, rather than per second rates, to
+  // keep everything in integers
+  auto target = targetSamplesPerSec_ * ms / 1000;
+
+  if (drops > 0 || total > target) {
+    auto active = std::count_if(
+        samples.begin(), samples.end(), [](const auto& entry) {
+          return entry.second > 0;
+        });
+    uint64_t fairShare =
+        std::max<uint64_t>(target / std::max<std::ptrdiff_t>(active, 1), 1);
+    auto backOff = [&](PortID port) {
+      auto it = ports_.find(port);
+      if (it == ports_.end() || it->second.multiplier >= maxMultiplier_) {
+        return;
+      }
+      it->second.multiplier =
+          std::min(it->second.multiplier * 2, maxMultiplier_);
+      changes.emplace_back(it->first, it->second.effective());
+    };
+    for (const auto& entry : samples) {
+      if (entry.second >= fairShare) {
+        backOff(entry.first);
+      }
+    }
+    if (changes.empty() && !samples.empty()) {
+      // Dropping samples with every port under its share, so the busiest
+      // port has to give way
+      auto busiest = std::max_element(
+          samples.begin(), samples.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+          });
+      backOff(busiest->first);
+    }
+  } else if (total * kRecoveryFraction < target) {
+    for (auto& entry : ports_) {
+      if (entry.second.multiplier == 1) {
+        continue;
+      }
+      entry.second.multiplier /= 2;
+      changes.emplace_back(entry.first, entry.second.effective());
+    }
+  }
+  return changes;
+}
+
+}} // facebook::fboss
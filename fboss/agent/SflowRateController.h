@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <boost/container/flat_map.hpp>
+
+#include "fboss/agent/types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Decides the sampling rates ports actually run at, so that the number of
+ * sFlow samples punted to the CPU stays near a target regardless of how
+ * much traffic is flowing.
+ *
+ * Each port runs at its configured rates times a power of two multiplier
+ * between 1 and maxMultiplier. Every interval update() is told how many
+ * samples arrived from each port and how many were dropped before they
+ * could be exported. If we are over the target, or dropping samples, the
+ * ports sending more than their fair share of samples are sampled half as
+ * often. Once the sample rate is well below the target again, ports are
+ * sampled twice as often, back down to their configured rates.
+ *
+ * Not thread safe, callers serialize access.
+ */
+class SflowRateController {
+ public:
+  struct Rates {
+    int64_t ingress{0};
+    int64_t egress{0};
+
+    bool operator==(const Rates& other) const {
+      return ingress == other.ingress && egress == other.egress;
+    }
+    bool operator!=(const Rates& other) const {
+      return !(*this == other);
+    }
+  };
+  using RateChanges = std::vector<std::pair<PortID, Rates>>;
+
+  SflowRateController(uint64_t targetSamplesPerSec, uint32_t maxMultiplier);
+
+  /*
+   * Set the rates a port is configured with, which are also the lowest it
+   * will run at. This resets any backing off already done for the port.
+   */
+  void setConfiguredRates(PortID port, int64_t ingress, int64_t egress);
+
+  // The rates the port should currently be sampled at
+  Rates getEffectiveRates(PortID port) const;
+
+  /*
+   * Account for the samples seen over the last interval and return the
+   * ports whose effective rates changed as a result.
+   */
+  RateChanges update(
+      const boost::container::flat_map<PortID, uint64_t>& samples,
+      uint64_t drops,
+      std::chrono::milliseconds interval);
+
+ private:
+  struct PortState {
+    Rates configured;
+    uint32_t multiplier{1};
+
+    Rates effective() const {
+      return Rates{configured.ingress * multiplier,
+                   configured.egress * multiplier};
+    }
+  };
+
+  const uint64_t targetSamplesPerSec_;
+  const uint32_t maxMultiplier_;
+  boost::container::flat_map<PortID, PortState> ports_;
+};
+
+}} // facebook::fboss
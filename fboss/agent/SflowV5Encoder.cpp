@@ -0,0 +1,172 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SflowV5Encoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <arpa/inet.h>
+
+namespace {
+
+constexpr uint32_t kVersion = 5;
+constexpr uint32_t kAddressTypeV4 = 1;
+constexpr uint32_t kAddressTypeV6 = 2;
+// version, address type, sub agent id, sequence, uptime, sample count
+constexpr size_t kHeaderFixedLen = 6 * 4;
+constexpr size_t kMaxHeaderLen = kHeaderFixedLen + 16;
+
+// Enterprise 0 formats
+constexpr uint32_t kFlowSampleFormat = 1;
+constexpr uint32_t kCounterSampleFormat = 2;
+constexpr uint32_t kRawHeaderFormat = 1;
+constexpr uint32_t kGenericInterfaceFormat = 1;
+
+constexpr uint32_t kHeaderProtocolEthernet = 1;
+constexpr uint32_t kIfTypeEthernet = 6;
+constexpr uint32_t kIfDirectionFullDuplex = 1;
+constexpr uint32_t kGenericInterfaceLen = 88;
+
+size_t pad4(size_t len) {
+  return (len + 3) & ~size_t(3);
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+SflowV5Encoder::SflowV5Encoder(size_t maxDatagramSize)
+    : buf_(std::max(maxDatagramSize, kMaxHeaderLen)), pos_(kMaxHeaderLen) {}
+
+size_t SflowV5Encoder::flowSampleSize(size_t headerBytes) {
+  // tag, length, 8 sample fields, record tag, record length,
+  // 4 record fields and the padded header itself
+  return 4 * 16 + pad4(headerBytes);
+}
+
+size_t SflowV5Encoder::counterSampleSize() {
+  // tag, length, 3 sample fields, record tag, record length and the record
+  return 4 * 7 + kGenericInterfaceLen;
+}
+
+void SflowV5Encoder::put32(uint32_t value) {
+  value = htonl(value);
+  memcpy(buf_.data() + pos_, &value, sizeof(value));
+  pos_ += sizeof(value);
+}
+
+void SflowV5Encoder::put64(uint64_t value) {
+  put32(value >> 32);
+  put32(value & 0xffffffff);
+}
+
+void SflowV5Encoder::putBytes(folly::ByteRange bytes) {
+  memcpy(buf_.data() + pos_, bytes.data(), bytes.size());
+  pos_ += bytes.size();
+  auto padding = pad4(bytes.size()) - bytes.size();
+  memset(buf_.data() + pos_, 0, padding);
+  pos_ += padding;
+}
+
+bool SflowV5Encoder::addFlowSample(const FlowSample& sample) {
+  auto size = flowSampleSize(sample.header.size());
+  if (pos_ + size > buf_.size()) {
+    return false;
+  }
+  auto& source = sources_[sample.sourceId];
+  source.samplePool += sample.samplingRate;
+
+  put32(kFlowSampleFormat);
+  put32(size - 8);
+  put32(++source.flowSequence);
+  put32(sample.sourceId);
+  put32(sample.samplingRate);
+  put32(source.samplePool);
+  put32(0); // drops
+  put32(sample.input);
+  put32(sample.output);
+  put32(1); // number of records
+
+  put32(kRawHeaderFormat);
+  put32(4 * 4 + pad4(sample.header.size()));
+  put32(kHeaderProtocolEthernet);
+  put32(sample.frameLength);
+  put32(0); // bytes stripped
+  put32(sample.header.size());
+  putBytes(sample.header);
+
+  ++numSamples_;
+  return true;
+}
+
+bool SflowV5Encoder::addCounterSample(const InterfaceCounters& counters) {
+  auto size = counterSampleSize();
+  if (pos_ + size > buf_.size()) {
+    return false;
+  }
+  auto& source = sources_[counters.ifIndex];
+
+  put32(kCounterSampleFormat);
+  put32(size - 8);
+  put32(++source.counterSequence);
+  put32(counters.ifIndex);
+  put32(1); // number of records
+
+  put32(kGenericInterfaceFormat);
+  put32(kGenericInterfaceLen);
+  put32(counters.ifIndex);
+  put32(kIfTypeEthernet);
+  put64(counters.ifSpeed);
+  put32(kIfDirectionFullDuplex);
+  put32((counters.adminUp ? 1 : 0) | (counters.operUp ? 2 : 0));
+  put64(counters.inOctets);
+  put32(counters.inUcast);
+  put32(counters.inMcast);
+  put32(counters.inBcast);
+  put32(counters.inDiscards);
+  put32(counters.inErrors);
+  put32(0); // unknown protocols
+  put64(counters.outOctets);
+  put32(counters.outUcast);
+  put32(counters.outMcast);
+  put32(counters.outBcast);
+  put32(counters.outDiscards);
+  put32(counters.outErrors);
+  put32(0); // promiscuous mode
+
+  ++numSamples_;
+  return true;
+}
+
+folly::ByteRange SflowV5Encoder::finish(uint32_t uptimeMs) {
+  auto end = pos_;
+  auto headerLen = kHeaderFixedLen + agent_.byteCount();
+  auto start = kMaxHeaderLen - headerLen;
+
+  pos_ = start;
+  put32(kVersion);
+  put32(agent_.isV4() ? kAddressTypeV4 : kAddressTypeV6);
+  memcpy(buf_.data() + pos_, agent_.bytes(), agent_.byteCount());
+  pos_ += agent_.byteCount();
+  put32(subAgentId_);
+  put32(++sequence_);
+  put32(uptimeMs);
+  put32(numSamples_);
+  pos_ = end;
+
+  return folly::ByteRange(buf_.data() + start, buf_.data() + end);
+}
+
+void SflowV5Encoder::reset() {
+  pos_ = kMaxHeaderLen;
+  numSamples_ = 0;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <boost/container/flat_map.hpp>
+#include <folly/IPAddress.h>
+#include <folly/Range.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Builds sFlow version 5 datagrams (sflow.org/sflow_version_5.txt) in a
+ * buffer allocated once up front, so that encoding a sample is a handful of
+ * big endian stores and never allocates.
+ *
+ * Samples are added until the datagram is full, then finish() fills in the
+ * datagram header and hands back the bytes to send, and reset() starts the
+ * next datagram in the same buffer. Sequence numbers and sample pools are
+ * tracked per source across datagrams, as collectors use them to detect
+ * loss.
+ */
+class SflowV5Encoder {
+ public:
+  struct FlowSample {
+    uint32_t sourceId{0};
+    uint32_t samplingRate{0};
+    uint32_t input{0};
+    uint32_t output{0};
+    // Length of the frame as seen on the wire, before truncation
+    uint32_t frameLength{0};
+    // The first bytes of the frame, starting at the ethernet header
+    folly::ByteRange header;
+  };
+
+  // The generic interface counters record (counter format 1)
+  struct InterfaceCounters {
+    uint32_t ifIndex{0};
+    uint64_t ifSpeed{0};
+    bool adminUp{false};
+    bool operUp{false};
+    uint64_t inOctets{0};
+    uint32_t inUcast{0};
+    uint32_t inMcast{0};
+    uint32_t inBcast{0};
+    uint32_t inDiscards{0};
+    uint32_t inErrors{0};
+    uint64_t outOctets{0};
+    uint32_t outUcast{0};
+    uint32_t outMcast{0};
+    uint32_t outBcast{0};
+    uint32_t outDiscards{0};
+    uint32_t outErrors{0};
+  };
+
+  explicit SflowV5Encoder(size_t maxDatagramSize);
+
+  void setAgent(const folly::IPAddress& agent, uint32_t subAgentId = 0) {
+    agent_ = agent;
+    subAgentId_ = subAgentId;
+  }
+
+  /*
+   * Append a sample to the current datagram. Returns false, leaving the
+   * datagram untouched, if the sample doesn't fit in what is left of it.
+   */
+  bool addFlowSample(const FlowSample& sample);
+  bool addCounterSample(const InterfaceCounters& counters);
+
+  /*
+   * Write the datagram header and return the complete datagram. The range
+   * stays valid until the next call to reset().
+   */
+  folly::ByteRange finish(uint32_t uptimeMs);
+
+  // Start a new, empty datagram
+  void reset();
+
+  uint32_t numSamples() const {
+    return numSamples_;
+  }
+
+  static size_t flowSampleSize(size_t headerBytes);
+  static size_t counterSampleSize();
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  SflowV5Encoder(SflowV5Encoder const &) = delete;
+  SflowV5Encoder& operator=(SflowV5Encoder const &) = delete;
+
+  struct SourceState {
+    uint32_t flowSequence{0};
+    uint32_t counterSequence{0};
+    uint32_t samplePool{0};
+  };
+
+  void put32(uint32_t value);
+  void put64(uint64_t value);
+  void putBytes(folly::ByteRange bytes);
+
+  std::vector<uint8_t> buf_;
+  // Samples are written after room for the largest (IPv6) header, which
+  // finish() then writes immediately in front of them
+  size_t pos_;
+  uint32_t numSamples_{0};
+  uint32_t sequence_{0};
+  folly::IPAddress agent_{folly::IPAddressV4()};
+  uint32_t subAgentId_{0};
+  boost::container::flat_map<uint32_t, SourceState> sources_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SlowPathRouteCache.h"
+
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/SwitchState.h"
+
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+
+namespace {
+
+template <typename AddrT>
+AddrT toAddr(const IPAddress& ip);
+
+template <>
+IPAddressV4 toAddr<IPAddressV4>(const IPAddress& ip) {
+  return ip.asV4();
+}
+
+template <>
+IPAddressV6 toAddr<IPAddressV6>(const IPAddress& ip) {
+  return ip.asV6();
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+constexpr size_t SlowPathRouteCache::kMaxEntries;
+
+std::shared_ptr<const SlowPathNextHops<IPAddressV4>>
+SlowPathRouteCache::getNextHops(
+    const std::shared_ptr<SwitchState>& state,
+    IPAddressV4 dest) {
+  return getNextHopsImpl(state, dest, &v4Entries_);
+}
+
+std::shared_ptr<const SlowPathNextHops<IPAddressV6>>
+SlowPathRouteCache::getNextHops(
+    const std::shared_ptr<SwitchState>& state,
+    const IPAddressV6& dest) {
+  return getNextHopsImpl(state, dest, &v6Entries_);
+}
+
+template <typename AddrT>
+std::shared_ptr<const SlowPathNextHops<AddrT>>
+SlowPathRouteCache::getNextHopsImpl(
+    const std::shared_ptr<SwitchState>& state,
+    const AddrT& dest,
+    Entries<AddrT>* entries) {
+  std::lock_guard<std::mutex> g(lock_);
+  checkState(state);
+  auto it = entries->find(dest);
+  if (it != entries->end()) {
+    return it->second;
+  }
+
+  std::shared_ptr<SlowPathNextHops<AddrT>> nextHops;
+  // TODO: assume vrf 0 now
+  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
+  auto route = routeTable
+      ? routeTable->template getRib<AddrT>()->longestMatch(dest)
+      : nullptr;
+  if (route && route->isResolved()) {
+    nextHops = std::make_shared<SlowPathNextHops<AddrT>>();
+    auto intfs = state->getInterfaces();
+    for (const auto& nh : route->getForwardInfo().getNextHopSet()) {
+      auto intf = intfs->getInterfaceIf(nh.intf());
+      if (!intf) {
+        continue;
+      }
+      auto source = toAddr<AddrT>(intf->getAddressToReach(nh.addr())->first);
+      auto target = route->isConnected() ? dest : toAddr<AddrT>(nh.addr());
+      if (source == target) {
+        // This is our own address, there is nothing to resolve
+        continue;
+      }
+      nextHops->push_back(SlowPathNextHop<AddrT>{intf->getID(),
+                                                 intf->getVlanID(),
+                                                 intf->getMac(),
+                                                 intf->getMtu(),
+                                                 source,
+                                                 target});
+    }
+  }
+
+  if (entries->size() >= kMaxEntries) {
+    entries->clear();
+  }
+  entries->emplace(dest, nextHops);
+  return nextHops;
+}
+
+void SlowPathRouteCache::checkState(
+    const std::shared_ptr<SwitchState>& state) {
+  if (state->getGeneration() == generation_ &&
+      !state_.owner_before(state) && !state.owner_before(state_)) {
+    return;
+  }
+  v4Entries_.clear();
+  v6Entries_.clear();
+  generation_ = state->getGeneration();
+  state_ = state;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/MacAddress.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class SwitchState;
+
+/*
+ * A next hop of the route to a destination, with what the packet handlers
+ * need to resolve it: the interface towards it and the addresses to use.
+ */
+template <typename AddrT>
+struct SlowPathNextHop {
+  InterfaceID intf;
+  VlanID vlan;
+  folly::MacAddress intfMac;
+  int intfMtu;
+  // Our address on intf, which neighbor requests are sent from
+  AddrT source;
+  // The neighbor to resolve: the destination itself if the route is
+  // connected, else the next hop
+  AddrT target;
+};
+
+template <typename AddrT>
+using SlowPathNextHops = std::vector<SlowPathNextHop<AddrT>>;
+
+/*
+ * Caches the route lookup and interface resolution IPv4Handler and
+ * IPv6Handler do for every packet trapped to the CPU for a destination
+ * whose neighbor isn't resolved yet. Bursts of such packets tend to go to a
+ * few destinations, which then cost a hash lookup each instead of a walk
+ * down the radix tree and an interface lookup per next hop. Destinations
+ * without a resolved route are cached as well.
+ *
+ * Only what the state's routes and interfaces say is cached: the neighbor
+ * tables still have to be checked for each packet. As for LocalAddressCache,
+ * everything is thrown away as soon as a different state is seen, and the
+ * state generation alone doesn't tell states apart, so the state itself is
+ * compared too. The number of destinations is bounded, and a full cache
+ * starts over.
+ *
+ * Called from the packet receiving threads.
+ */
+class SlowPathRouteCache {
+ public:
+  SlowPathRouteCache() {}
+
+  /*
+   * The next hops of the route to dest in state, leaving out those that are
+   * our own addresses. nullptr if state has no resolved route to dest.
+   */
+  std::shared_ptr<const SlowPathNextHops<folly::IPAddressV4>> getNextHops(
+      const std::shared_ptr<SwitchState>& state,
+      folly::IPAddressV4 dest);
+  std::shared_ptr<const SlowPathNextHops<folly::IPAddressV6>> getNextHops(
+      const std::shared_ptr<SwitchState>& state,
+      const folly::IPAddressV6& dest);
+
+  // Maximum number of destinations cached for each address family
+  static constexpr size_t kMaxEntries = 4096;
+
+ private:
+  template <typename AddrT>
+  using Entries = std::unordered_map<
+      AddrT,
+      std::shared_ptr<const SlowPathNextHops<AddrT>>>;
+
+  // Forbidden copy constructor and assignment operator
+  SlowPathRouteCache(SlowPathRouteCache const&) = delete;
+  SlowPathRouteCache& operator=(SlowPathRouteCache const&) = delete;
+
+  template <typename AddrT>
+  std::shared_ptr<const SlowPathNextHops<AddrT>> getNextHopsImpl(
+      const std::shared_ptr<SwitchState>& state,
+      const AddrT& dest,
+      Entries<AddrT>* entries);
+
+  // Start over if state isn't the one cached. Must be called with lock_
+  // held.
+  void checkState(const std::shared_ptr<SwitchState>& state);
+
+  std::mutex lock_;
+  uint32_t generation_{0};
+  // Held weakly so the cache doesn't keep an old state around
+  std::weak_ptr<SwitchState> state_;
+  Entries<folly::IPAddressV4> v4Entries_;
+  Entries<folly::IPAddressV6> v6Entries_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,356 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateExporter.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+#include "fboss/agent/state/ControlPlane.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/LoadBalancer.h"
+#include "fboss/agent/state/LoadBalancerMap.h"
+#include "fboss/agent/state/Mirror.h"
+#include "fboss/agent/state/MirrorMap.h"
+#include "fboss/agent/state/NodeMapDelta-defs.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/SflowCollector.h"
+#include "fboss/agent/state/SflowCollectorMap.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <folly/Conv.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/json.h>
+#include <folly/logging/xlog.h>
+
+using apache::thrift::ClientReceiveState;
+using apache::thrift::server::TConnectionContext;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace {
+// The keys of SwitchState::toFollyDynamic()
+constexpr auto kInterfaces = "interfaces";
+constexpr auto kPorts = "ports";
+constexpr auto kVlans = "vlans";
+constexpr auto kRouteTables = "routeTables";
+constexpr auto kDefaultVlan = "defaultVlan";
+constexpr auto kAcls = "acls";
+constexpr auto kSflowCollectors = "sFlowCollectors";
+constexpr auto kControlPlane = "controlPlane";
+constexpr auto kLoadBalancers = "loadBalancers";
+constexpr auto kMirrors = "mirrors";
+// And of RouteTable::toFollyDynamic()
+constexpr auto kRibV4 = "ribV4";
+constexpr auto kRibV6 = "ribV6";
+}
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+template <typename IdT>
+string nodeId(const IdT& id) {
+  return folly::to<string>(id);
+}
+
+template <typename AddrT>
+string nodeId(const RoutePrefix<AddrT>& prefix) {
+  return prefix.str();
+}
+
+string nodeId(LoadBalancerID id) {
+  return folly::to<string>(static_cast<int>(id));
+}
+
+StateNodeChange makeChange(const string& subtree, vector<string> path) {
+  StateNodeChange change;
+  change.subtree = subtree;
+  change.path = std::move(path);
+  return change;
+}
+
+void addSubtreeChange(
+    const string& subtree,
+    const folly::dynamic& json,
+    vector<StateNodeChange>* changes) {
+  auto change = makeChange(subtree, {});
+  change.json = folly::toJson(json);
+  change.__isset.json = true;
+  changes->push_back(std::move(change));
+}
+
+// The change to the node of oldNode and newNode, either of which may be
+// null, under path
+template <typename NodeT>
+void addNodeChange(
+    const string& subtree,
+    vector<string> path,
+    const shared_ptr<NodeT>& oldNode,
+    const shared_ptr<NodeT>& newNode,
+    vector<StateNodeChange>* changes) {
+  path.push_back(nodeId(newNode ? newNode->getID() : oldNode->getID()));
+  auto change = makeChange(subtree, std::move(path));
+  if (newNode) {
+    change.json = folly::toJson(newNode->toFollyDynamic());
+    change.__isset.json = true;
+  }
+  changes->push_back(std::move(change));
+}
+
+template <typename MapDeltaT>
+void addNodeChanges(
+    const string& subtree,
+    const vector<string>& path,
+    const MapDeltaT& delta,
+    vector<StateNodeChange>* changes) {
+  for (const auto& entry : delta) {
+    addNodeChange(subtree, path, entry.getOld(), entry.getNew(), changes);
+  }
+}
+
+// The route tables change per route, the rest of a table being its ID
+void addRouteTableChanges(
+    const RTMapDelta& delta,
+    vector<StateNodeChange>* changes) {
+  for (const auto& rtDelta : delta) {
+    const auto& oldTable = rtDelta.getOld();
+    const auto& newTable = rtDelta.getNew();
+    if (!oldTable || !newTable) {
+      addNodeChange(kRouteTables, {}, oldTable, newTable, changes);
+      continue;
+    }
+    auto id = nodeId(newTable->getID());
+    addNodeChanges(
+        kRouteTables, {id, kRibV4}, rtDelta.getRoutesV4Delta(), changes);
+    addNodeChanges(
+        kRouteTables, {id, kRibV6}, rtDelta.getRoutesV6Delta(), changes);
+  }
+}
+
+folly::dynamic getSubtreeJson(
+    const shared_ptr<SwitchState>& state,
+    const string& subtree) {
+  if (subtree == kInterfaces) {
+    return state->getInterfaces()->toFollyDynamic();
+  } else if (subtree == kPorts) {
+    return state->getPorts()->toFollyDynamic();
+  } else if (subtree == kVlans) {
+    return state->getVlans()->toFollyDynamic();
+  } else if (subtree == kRouteTables) {
+    return state->getRouteTables()->toFollyDynamic();
+  } else if (subtree == kDefaultVlan) {
+    return static_cast<uint32_t>(state->getDefaultVlan());
+  } else if (subtree == kAcls) {
+    return state->getAcls()->toFollyDynamic();
+  } else if (subtree == kSflowCollectors) {
+    return state->getSflowCollectors()->toFollyDynamic();
+  } else if (subtree == kControlPlane) {
+    return state->getControlPlane()->toFollyDynamic();
+  } else if (subtree == kLoadBalancers) {
+    return state->getLoadBalancers()->toFollyDynamic();
+  } else if (subtree == kMirrors) {
+    return state->getMirrors()->toFollyDynamic();
+  }
+  throw FbossError("Unknown state subtree ", subtree);
+}
+
+void addSubtreeChanges(
+    const StateDelta& delta,
+    const string& subtree,
+    vector<StateNodeChange>* changes) {
+  const auto& oldState = delta.oldState();
+  const auto& newState = delta.newState();
+  if (subtree == kInterfaces) {
+    addNodeChanges(subtree, {}, delta.getIntfsDelta(), changes);
+  } else if (subtree == kPorts) {
+    addNodeChanges(subtree, {}, delta.getPortsDelta(), changes);
+  } else if (subtree == kVlans) {
+    addNodeChanges(subtree, {}, delta.getVlansDelta(), changes);
+  } else if (subtree == kRouteTables) {
+    addRouteTableChanges(delta.getRouteTablesDelta(), changes);
+  } else if (subtree == kDefaultVlan) {
+    if (oldState->getDefaultVlan() != newState->getDefaultVlan()) {
+      addSubtreeChange(subtree, getSubtreeJson(newState, subtree), changes);
+    }
+  } else if (subtree == kAcls) {
+    addNodeChanges(subtree, {}, delta.getAclsDelta(), changes);
+  } else if (subtree == kSflowCollectors) {
+    addNodeChanges(subtree, {}, delta.getSflowCollectorsDelta(), changes);
+  } else if (subtree == kControlPlane) {
+    if (oldState->getControlPlane() != newState->getControlPlane()) {
+      addSubtreeChange(subtree, getSubtreeJson(newState, subtree), changes);
+    }
+  } else if (subtree == kLoadBalancers) {
+    addNodeChanges(subtree, {}, delta.getLoadBalancersDelta(), changes);
+  } else if (subtree == kMirrors) {
+    addNodeChanges(subtree, {}, delta.getMirrorsDelta(), changes);
+  } else {
+    throw FbossError("Unknown state subtree ", subtree);
+  }
+}
+
+} // unnamed namespace
+
+StateExporter::StateExporter(SwSwitch* sw)
+    // Serializing the changes doesn't need to hold up the update thread
+    : AutoRegisterStateObserver(sw, "StateExporter", true) {
+  auto state = sw->getState();
+  std::lock_guard<std::mutex> g(lock_);
+  if (!state_ || state->getGeneration() > state_->getGeneration()) {
+    state_ = std::move(state);
+  }
+}
+
+StateExporter::~StateExporter() {
+  unregister();
+}
+
+const StateExporter::Subtrees& StateExporter::allSubtrees() {
+  static const Subtrees subtrees = {
+      kInterfaces,
+      kPorts,
+      kVlans,
+      kRouteTables,
+      kDefaultVlan,
+      kAcls,
+      kSflowCollectors,
+      kControlPlane,
+      kLoadBalancers,
+      kMirrors,
+  };
+  return subtrees;
+}
+
+StateExporter::Subtrees StateExporter::getSubtrees(
+    const vector<string>& names) {
+  if (names.empty()) {
+    return allSubtrees();
+  }
+  Subtrees subtrees;
+  for (const auto& name : names) {
+    if (!allSubtrees().count(name)) {
+      throw FbossError("Unknown state subtree ", name);
+    }
+    subtrees.insert(name);
+  }
+  return subtrees;
+}
+
+StateExportUpdate StateExporter::snapshot(
+    const shared_ptr<SwitchState>& state,
+    const Subtrees& subtrees) {
+  StateExportUpdate update;
+  update.generation = state->getGeneration();
+  for (const auto& subtree : subtrees) {
+    addSubtreeChange(subtree, getSubtreeJson(state, subtree), &update.changes);
+  }
+  return update;
+}
+
+StateExportUpdate StateExporter::patch(
+    const StateDelta& delta,
+    const Subtrees& subtrees) {
+  StateExportUpdate update;
+  update.generation = delta.newState()->getGeneration();
+  for (const auto& subtree : subtrees) {
+    addSubtreeChanges(delta, subtree, &update.changes);
+  }
+  return update;
+}
+
+StateExportUpdate StateExporter::subscribe(
+    const TConnectionContext* ctx,
+    shared_ptr<StateListenerClientAsyncClient> client,
+    folly::EventBase* evb,
+    Subtrees subtrees) {
+  // Under the lock, so that the first patch the subscriber gets is the one
+  // following the snapshot
+  std::lock_guard<std::mutex> g(lock_);
+  auto update = snapshot(state_, subtrees);
+  subscribers_[ctx] = Subscriber{std::move(client), evb, std::move(subtrees)};
+  return update;
+}
+
+void StateExporter::unsubscribe(const TConnectionContext* ctx) {
+  std::lock_guard<std::mutex> g(lock_);
+  subscribers_.erase(ctx);
+}
+
+void StateExporter::stateUpdated(const StateDelta& delta) {
+  std::lock_guard<std::mutex> g(lock_);
+  const auto& newState = delta.newState();
+  if (state_ && newState->getGeneration() <= state_->getGeneration()) {
+    // Already in the state the exporter started from
+    return;
+  }
+  state_ = newState;
+  if (subscribers_.empty()) {
+    return;
+  }
+
+  // Build the changes once for everything subscribed to
+  Subtrees subtrees;
+  for (const auto& ctxAndSubscriber : subscribers_) {
+    const auto& subscribed = ctxAndSubscriber.second.subtrees;
+    subtrees.insert(subscribed.begin(), subscribed.end());
+  }
+  auto update = patch(delta, subtrees);
+  if (update.changes.empty()) {
+    return;
+  }
+  for (const auto& ctxAndSubscriber : subscribers_) {
+    const auto& subscriber = ctxAndSubscriber.second;
+    StateExportUpdate subscriberUpdate;
+    subscriberUpdate.generation = update.generation;
+    for (const auto& change : update.changes) {
+      if (subscriber.subtrees.count(change.subtree)) {
+        subscriberUpdate.changes.push_back(change);
+      }
+    }
+    if (!subscriberUpdate.changes.empty()) {
+      send(ctxAndSubscriber.first, subscriber, std::move(subscriberUpdate));
+    }
+  }
+}
+
+void StateExporter::send(
+    const TConnectionContext* ctx,
+    const Subscriber& subscriber,
+    StateExportUpdate update) {
+  auto client = subscriber.client;
+  subscriber.evb->runInEventBaseThread(
+      [this, ctx, client, update = std::move(update)]() {
+        auto clientDone = [this, ctx, client](ClientReceiveState&& state) {
+          try {
+            StateListenerClientAsyncClient::recv_stateChanged(state);
+          } catch (const std::exception& ex) {
+            XLOG(ERR) << "Exception in state listener: " << ex.what();
+            std::lock_guard<std::mutex> g(lock_);
+            auto it = subscribers_.find(ctx);
+            // Unless the connection subscribed again meanwhile
+            if (it != subscribers_.end() && it->second.client == client) {
+              subscribers_.erase(it);
+            }
+          }
+        };
+        client->stateChanged(clientDone, update);
+      });
+}
+
+}} // facebook::fboss
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/StateObserver.h"
+#include "fboss/agent/if/gen-cpp2/StateListenerClient.h"
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace apache { namespace thrift { namespace server {
+class TConnectionContext;
+}}}
+namespace folly {
+class EventBase;
+}
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+class SwitchState;
+class SwSwitch;
+
+/*
+ * Exports SwitchState subtrees to the subscribers of
+ * subscribeToStateChanges, so tools mirroring the agent state get each
+ * change once instead of polling getCurrentStateJSON and reserializing the
+ * whole state every time.
+ *
+ * A subscriber gets a snapshot of its subtrees, then a StateExportUpdate
+ * for each published state that changes them. Node maps are patched per
+ * node, and route tables per route, so a single route or port change
+ * costs the serialization of that one node. The patches are built once
+ * per state for all the subscribers, off the update thread.
+ */
+class StateExporter : public AutoRegisterStateObserver {
+ public:
+  using Subtrees = std::set<std::string>;
+
+  explicit StateExporter(SwSwitch* sw);
+  ~StateExporter() override;
+
+  // The subtrees that can be exported, named as in getCurrentStateJSON
+  static const Subtrees& allSubtrees();
+  // The subtrees to export for names, all of them if names is empty.
+  // Throws FbossError for the names that are not subtrees.
+  static Subtrees getSubtrees(const std::vector<std::string>& names);
+
+  // The whole of subtrees in state
+  static StateExportUpdate snapshot(
+      const std::shared_ptr<SwitchState>& state,
+      const Subtrees& subtrees);
+  // The changes to subtrees from the old state of delta to the new one
+  static StateExportUpdate patch(
+      const StateDelta& delta,
+      const Subtrees& subtrees);
+
+  /*
+   * Start sending the changes to subtrees to client, from evb, and return
+   * the snapshot they apply to. Replaces any previous subscription of the
+   * connection.
+   */
+  StateExportUpdate subscribe(
+      const apache::thrift::server::TConnectionContext* ctx,
+      std::shared_ptr<StateListenerClientAsyncClient> client,
+      folly::EventBase* evb,
+      Subtrees subtrees);
+  void unsubscribe(const apache::thrift::server::TConnectionContext* ctx);
+
+  void stateUpdated(const StateDelta& delta) override;
+
+ private:
+  struct Subscriber {
+    std::shared_ptr<StateListenerClientAsyncClient> client;
+    folly::EventBase* evb;
+    Subtrees subtrees;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  StateExporter(StateExporter const &) = delete;
+  StateExporter& operator=(StateExporter const &) = delete;
+
+  void send(
+      const apache::thrift::server::TConnectionContext* ctx,
+      const Subscriber& subscriber,
+      StateExportUpdate update);
+
+  std::mutex lock_;
+  // The latest state the exporter has seen, what the snapshots are taken
+  // from so that the subscribers miss no patch
+  std::shared_ptr<SwitchState> state_;
+  std::unordered_map<
+      const apache::thrift::server::TConnectionContext*,
+      Subscriber>
+      subscribers_;
+};
+
+}} // facebook::fboss
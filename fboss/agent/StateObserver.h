@@ -22,10 +22,14 @@ class StateObserver : public boost::noncopyable {
 
 class AutoRegisterStateObserver : public StateObserver {
  public:
-  AutoRegisterStateObserver(SwSwitch* sw, const std::string& name) : sw_(sw) {
-    sw_->registerStateObserver(this, name);
+  AutoRegisterStateObserver(
+      SwSwitch* sw,
+      const std::string& name,
+      bool async = false)
+      : sw_(sw) {
+    sw_->registerStateObserver(this, name, async);
   }
-  ~AutoRegisterStateObserver() override { sw_->unregisterStateObserver(this); }
+  ~AutoRegisterStateObserver() override { unregister(); }
 
   // This empty implementation should be overridden by subclasses, but it is
   // needed during destruction in the case that the derived class has been
@@ -34,8 +38,22 @@ class AutoRegisterStateObserver : public StateObserver {
   // during that time if this didn't exist.
   void stateUpdated(const StateDelta& /*delta*/) override {}
 
+ protected:
+  /*
+   * Async observers are notified from another thread, which could be in
+   * stateUpdated() while they are being destroyed. They need to call this
+   * first thing in their destructor.
+   */
+  void unregister() {
+    if (registered_) {
+      sw_->unregisterStateObserver(this);
+      registered_ = false;
+    }
+  }
+
  private:
   SwSwitch* sw_{nullptr};
+  bool registered_{true};
 };
 
 }} // facebook::fboss
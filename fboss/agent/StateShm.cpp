@@ -0,0 +1,528 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateShm.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SysError.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <folly/ScopeGuard.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <tuple>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using folly::IPAddress;
+using std::vector;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// Give up on a lookup after this many races with the writer, which only
+// happen if it writes twice while the lookup runs
+constexpr int kMaxReadAttempts = 1000;
+
+size_t alignTo(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+void copyAddr(const IPAddress& ip, uint8_t* addr, uint8_t* isV6) {
+  memset(addr, 0, 16);
+  if (ip.isV4()) {
+    memcpy(addr, ip.asV4().bytes(), 4);
+    *isV6 = 0;
+  } else {
+    memcpy(addr, ip.asV6().bytes(), 16);
+    *isV6 = 1;
+  }
+}
+
+auto routeKey(const StateShmRoute& route) {
+  // Longest prefixes first, for the lookups
+  return std::make_tuple(
+      route.routerId, route.isV6, 255 - route.prefixLength);
+}
+
+bool routeLess(const StateShmRoute& a, const StateShmRoute& b) {
+  if (routeKey(a) != routeKey(b)) {
+    return routeKey(a) < routeKey(b);
+  }
+  return memcmp(a.addr, b.addr, sizeof(a.addr)) < 0;
+}
+
+bool neighborLess(const StateShmNeighbor& a, const StateShmNeighbor& b) {
+  if (a.isV6 != b.isV6) {
+    return a.isV6 < b.isV6;
+  }
+  int cmp = memcmp(a.addr, b.addr, sizeof(a.addr));
+  if (cmp != 0) {
+    return cmp < 0;
+  }
+  return a.vlan < b.vlan;
+}
+
+template <typename RibT>
+void addRoutes(
+    const RibT& rib,
+    RouterID rid,
+    uint32_t maxRoutes,
+    uint32_t maxNextHops,
+    vector<StateShmRoute>* routes,
+    vector<StateShmNextHop>* nextHops,
+    bool* truncated) {
+  for (const auto& route : *rib.routes()) {
+    const auto& fwd = route->getForwardInfo();
+    const auto& nhops = fwd.getNextHopSet();
+    if (routes->size() == maxRoutes ||
+        nextHops->size() + nhops.size() > maxNextHops) {
+      *truncated = true;
+      return;
+    }
+    StateShmRoute shmRoute{};
+    const auto& prefix = route->prefix();
+    copyAddr(IPAddress(prefix.network), shmRoute.addr, &shmRoute.isV6);
+    shmRoute.prefixLength = prefix.mask;
+    shmRoute.action = static_cast<uint8_t>(fwd.getAction());
+    shmRoute.resolved = route->isResolved();
+    shmRoute.routerId = static_cast<uint32_t>(rid);
+    shmRoute.firstNextHop = nextHops->size();
+    shmRoute.numNextHops = nhops.size();
+    for (const auto& nhop : nhops) {
+      StateShmNextHop shmNextHop{};
+      copyAddr(nhop.addr(), shmNextHop.addr, &shmNextHop.isV6);
+      auto intf = nhop.intfID();
+      shmNextHop.intf = intf ? static_cast<uint32_t>(*intf) : 0;
+      shmNextHop.weight = nhop.weight();
+      nextHops->push_back(shmNextHop);
+    }
+    routes->push_back(shmRoute);
+  }
+}
+
+template <typename TableT>
+void addNeighbors(
+    const TableT& table,
+    VlanID vlan,
+    uint32_t maxNeighbors,
+    vector<StateShmNeighbor>* neighbors,
+    bool* truncated) {
+  for (const auto& entry : table) {
+    if (neighbors->size() == maxNeighbors) {
+      *truncated = true;
+      return;
+    }
+    StateShmNeighbor neighbor{};
+    copyAddr(IPAddress(entry->getIP()), neighbor.addr, &neighbor.isV6);
+    neighbor.state = static_cast<uint8_t>(entry->getState());
+    memcpy(neighbor.mac, entry->getMac().bytes(), sizeof(neighbor.mac));
+    neighbor.vlan = static_cast<uint32_t>(vlan);
+    neighbor.intf = static_cast<uint32_t>(entry->getIntfID());
+    auto port = entry->getPort();
+    if (port.isAggregatePort()) {
+      neighbor.port = static_cast<uint32_t>(port.aggPortID());
+      neighbor.isAggregatePort = 1;
+    } else {
+      neighbor.port = static_cast<uint32_t>(port.phyPortID());
+    }
+    neighbors->push_back(neighbor);
+  }
+}
+
+// Copy records to a slot's records at offset, and return how many there are
+template <typename RecordT>
+uint32_t copyRecords(
+    const vector<RecordT>& records,
+    uint8_t* slotBase,
+    uint64_t offset) {
+  if (!records.empty()) {
+    memcpy(
+        slotBase + offset, records.data(), records.size() * sizeof(RecordT));
+  }
+  return records.size();
+}
+
+template <typename RecordT>
+const RecordT* records(const uint8_t* slotBase, uint64_t offset) {
+  return reinterpret_cast<const RecordT*>(slotBase + offset);
+}
+
+} // unnamed namespace
+
+StateShmWriter::StateShmWriter(
+    const std::string& path,
+    uint32_t maxPorts,
+    uint32_t maxRoutes,
+    uint32_t maxNextHops,
+    uint32_t maxNeighbors)
+    : path_(path) {
+  auto pageSize = sysconf(_SC_PAGESIZE);
+  uint64_t portsOffset = alignTo(sizeof(StateShmSlot), 64);
+  uint64_t routesOffset =
+      alignTo(portsOffset + maxPorts * sizeof(StateShmPort), 64);
+  uint64_t nextHopsOffset =
+      alignTo(routesOffset + maxRoutes * sizeof(StateShmRoute), 64);
+  uint64_t neighborsOffset =
+      alignTo(nextHopsOffset + maxNextHops * sizeof(StateShmNextHop), 64);
+  uint64_t slotSize = alignTo(
+      neighborsOffset + maxNeighbors * sizeof(StateShmNeighbor), pageSize);
+  uint64_t firstSlotOffset = alignTo(sizeof(StateShmHeader), pageSize);
+  size_ = firstSlotOffset + 2 * slotSize;
+
+  // Set up the whole region before it shows up at path
+  auto tmpPath = path_ + ".tmp";
+  int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  sysCheckError(fd, "Unable to create state snapshot file ", tmpPath);
+  SCOPE_EXIT {
+    close(fd);
+  };
+  sysCheckError(
+      ftruncate(fd, size_), "Unable to size state snapshot file ", tmpPath);
+  auto addr =
+      mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    throw SysError(errno, "Unable to mmap state snapshot file ", tmpPath);
+  }
+  base_ = static_cast<uint8_t*>(addr);
+
+  auto header = new (base_) StateShmHeader();
+  header->magic = kStateShmMagic;
+  header->version = kStateShmVersion;
+  header->maxPorts = maxPorts;
+  header->maxRoutes = maxRoutes;
+  header->maxNextHops = maxNextHops;
+  header->maxNeighbors = maxNeighbors;
+  header->slotSize = slotSize;
+  header->slotOffsets[0] = firstSlotOffset;
+  header->slotOffsets[1] = firstSlotOffset + slotSize;
+  header->portsOffset = portsOffset;
+  header->routesOffset = routesOffset;
+  header->nextHopsOffset = nextHopsOffset;
+  header->neighborsOffset = neighborsOffset;
+  // Both slots start out empty, at an even seq
+  for (auto slotOffset : header->slotOffsets) {
+    new (base_ + slotOffset) StateShmSlot();
+  }
+  if (rename(tmpPath.c_str(), path_.c_str()) != 0) {
+    auto err = errno;
+    munmap(base_, size_);
+    throw SysError(err, "Unable to rename state snapshot file to ", path_);
+  }
+}
+
+StateShmWriter::~StateShmWriter() {
+  munmap(base_, size_);
+}
+
+void StateShmWriter::write(const SwitchState& state) {
+  auto header = reinterpret_cast<StateShmHeader*>(base_);
+  bool truncated = false;
+
+  vector<StateShmPort> ports;
+  for (const auto& port : *state.getPorts()) {
+    if (ports.size() == header->maxPorts) {
+      truncated = true;
+      break;
+    }
+    StateShmPort shmPort{};
+    shmPort.id = static_cast<uint32_t>(port->getID());
+    shmPort.speedMbps = static_cast<uint32_t>(port->getSpeed());
+    shmPort.adminUp = port->getAdminState() == cfg::PortState::ENABLED;
+    shmPort.operUp = port->isUp();
+    strncpy(shmPort.name, port->getName().c_str(), sizeof(shmPort.name) - 1);
+    ports.push_back(shmPort);
+  }
+  std::sort(
+      ports.begin(),
+      ports.end(),
+      [](const StateShmPort& a, const StateShmPort& b) { return a.id < b.id; });
+
+  vector<StateShmRoute> routes;
+  vector<StateShmNextHop> nextHops;
+  for (const auto& table : *state.getRouteTables()) {
+    auto rid = table->getID();
+    addRoutes(
+        *table->getRibV4(), rid, header->maxRoutes, header->maxNextHops,
+        &routes, &nextHops, &truncated);
+    addRoutes(
+        *table->getRibV6(), rid, header->maxRoutes, header->maxNextHops,
+        &routes, &nextHops, &truncated);
+  }
+  std::sort(routes.begin(), routes.end(), routeLess);
+
+  vector<StateShmNeighbor> neighbors;
+  for (const auto& vlan : *state.getVlans()) {
+    addNeighbors(
+        *vlan->getArpTable(), vlan->getID(), header->maxNeighbors,
+        &neighbors, &truncated);
+    addNeighbors(
+        *vlan->getNdpTable(), vlan->getID(), header->maxNeighbors,
+        &neighbors, &truncated);
+  }
+  std::sort(neighbors.begin(), neighbors.end(), neighborLess);
+
+  // Write to the slot the readers aren't in
+  auto idx = 1 - header->activeSlot.load(std::memory_order_relaxed);
+  auto slotBase = base_ + header->slotOffsets[idx];
+  auto slot = reinterpret_cast<StateShmSlot*>(slotBase);
+  auto seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->stateGeneration = state.getGeneration();
+  slot->publishedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  slot->truncated = truncated;
+  slot->numPorts = copyRecords(ports, slotBase, header->portsOffset);
+  slot->numRoutes = copyRecords(routes, slotBase, header->routesOffset);
+  slot->numNextHops = copyRecords(nextHops, slotBase, header->nextHopsOffset);
+  slot->numNeighbors =
+      copyRecords(neighbors, slotBase, header->neighborsOffset);
+
+  slot->seq.store(seq + 2, std::memory_order_release);
+  header->activeSlot.store(idx, std::memory_order_release);
+  header->generation.fetch_add(1, std::memory_order_release);
+}
+
+StateShmReader::StateShmReader(const std::string& path) : path_(path) {
+  int fd = open(path_.c_str(), O_RDONLY);
+  sysCheckError(fd, "Unable to open state snapshot file ", path_);
+  SCOPE_EXIT {
+    close(fd);
+  };
+  struct stat st;
+  sysCheckError(
+      fstat(fd, &st), "Unable to stat state snapshot file ", path_);
+  if (st.st_size < static_cast<off_t>(sizeof(StateShmHeader))) {
+    throw FbossError("State snapshot file ", path_, " is too short");
+  }
+  auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    throw SysError(errno, "Unable to mmap state snapshot file ", path_);
+  }
+  size_ = st.st_size;
+  base_ = static_cast<const uint8_t*>(addr);
+  header_ = reinterpret_cast<const StateShmHeader*>(base_);
+  dev_ = st.st_dev;
+  ino_ = st.st_ino;
+
+  auto fail = [&](const char* why) {
+    munmap(const_cast<uint8_t*>(base_), size_);
+    throw FbossError("Bad state snapshot file ", path_, ": ", why);
+  };
+  if (header_->magic != kStateShmMagic) {
+    fail("wrong magic");
+  }
+  if (header_->version != kStateShmVersion) {
+    fail("unsupported version");
+  }
+  if (header_->slotOffsets[0] < sizeof(StateShmHeader) ||
+      header_->slotOffsets[1] < header_->slotOffsets[0] + header_->slotSize ||
+      size_ < header_->slotOffsets[1] + header_->slotSize) {
+    fail("slots out of bounds");
+  }
+  auto fits = [&](uint64_t offset, uint64_t num, size_t size) {
+    return offset >= sizeof(StateShmSlot) &&
+        offset + num * size <= header_->slotSize;
+  };
+  if (!fits(header_->portsOffset, header_->maxPorts, sizeof(StateShmPort)) ||
+      !fits(
+          header_->routesOffset, header_->maxRoutes, sizeof(StateShmRoute)) ||
+      !fits(
+          header_->nextHopsOffset,
+          header_->maxNextHops,
+          sizeof(StateShmNextHop)) ||
+      !fits(
+          header_->neighborsOffset,
+          header_->maxNeighbors,
+          sizeof(StateShmNeighbor))) {
+    fail("records out of bounds");
+  }
+}
+
+StateShmReader::~StateShmReader() {
+  munmap(const_cast<uint8_t*>(base_), size_);
+}
+
+template <typename Fn>
+auto StateShmReader::read(Fn fn) const
+    -> decltype(fn(std::declval<const uint8_t*>())) {
+  for (int i = 0; i < kMaxReadAttempts; ++i) {
+    auto idx = header_->activeSlot.load(std::memory_order_acquire) & 1;
+    auto slotBase = base_ + header_->slotOffsets[idx];
+    auto slot = reinterpret_cast<const StateShmSlot*>(slotBase);
+    auto seq = slot->seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+    auto result = fn(slotBase);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) == seq) {
+      return result;
+    }
+  }
+  throw FbossError(
+      "State snapshot kept changing while reading it from ", path_);
+}
+
+uint64_t StateShmReader::getGeneration() const {
+  return header_->generation.load(std::memory_order_acquire);
+}
+
+uint64_t StateShmReader::getStateGeneration() const {
+  return read([](const uint8_t* slotBase) {
+    return reinterpret_cast<const StateShmSlot*>(slotBase)->stateGeneration;
+  });
+}
+
+bool StateShmReader::isTruncated() const {
+  return read([](const uint8_t* slotBase) {
+    return reinterpret_cast<const StateShmSlot*>(slotBase)->truncated != 0;
+  });
+}
+
+bool StateShmReader::isCurrent() const {
+  struct stat st;
+  if (stat(path_.c_str(), &st) != 0) {
+    return false;
+  }
+  return st.st_dev == dev_ && st.st_ino == ino_;
+}
+
+// The counts are read while the writer may be changing them, so they are
+// kept within the capacities before being used. What is read from a slot
+// that changed is thrown away anyway.
+
+folly::Optional<StateShmPort> StateShmReader::getPort(PortID id) const {
+  return read([&](const uint8_t* slotBase) -> folly::Optional<StateShmPort> {
+    auto slot = reinterpret_cast<const StateShmSlot*>(slotBase);
+    auto begin = records<StateShmPort>(slotBase, header_->portsOffset);
+    auto end = begin + std::min(slot->numPorts, header_->maxPorts);
+    auto it = std::lower_bound(
+        begin, end, static_cast<uint32_t>(id),
+        [](const StateShmPort& port, uint32_t portId) {
+          return port.id < portId;
+        });
+    if (it == end || it->id != static_cast<uint32_t>(id)) {
+      return folly::none;
+    }
+    return *it;
+  });
+}
+
+vector<StateShmPort> StateShmReader::getPorts() const {
+  return read([&](const uint8_t* slotBase) {
+    auto slot = reinterpret_cast<const StateShmSlot*>(slotBase);
+    auto begin = records<StateShmPort>(slotBase, header_->portsOffset);
+    auto end = begin + std::min(slot->numPorts, header_->maxPorts);
+    return vector<StateShmPort>(begin, end);
+  });
+}
+
+folly::Optional<StateShmNeighbor> StateShmReader::getNeighbor(
+    const IPAddress& ip) const {
+  StateShmNeighbor key{};
+  copyAddr(ip, key.addr, &key.isV6);
+  return read(
+      [&](const uint8_t* slotBase) -> folly::Optional<StateShmNeighbor> {
+        auto slot = reinterpret_cast<const StateShmSlot*>(slotBase);
+        auto begin =
+            records<StateShmNeighbor>(slotBase, header_->neighborsOffset);
+        auto end = begin + std::min(slot->numNeighbors, header_->maxNeighbors);
+        // The key has the lowest VLAN, so this is the address's first entry
+        auto it = std::lower_bound(begin, end, key, neighborLess);
+        if (it == end || it->isV6 != key.isV6 ||
+            memcmp(it->addr, key.addr, sizeof(key.addr)) != 0) {
+          return folly::none;
+        }
+        return *it;
+      });
+}
+
+folly::Optional<StateShmReader::Route> StateShmReader::longestMatch(
+    RouterID rid,
+    const IPAddress& addr) const {
+  return read([&](const uint8_t* slotBase) -> folly::Optional<Route> {
+    auto slot = reinterpret_cast<const StateShmSlot*>(slotBase);
+    auto begin = records<StateShmRoute>(slotBase, header_->routesOffset);
+    auto end = begin + std::min(slot->numRoutes, header_->maxRoutes);
+    StateShmRoute key{};
+    key.routerId = static_cast<uint32_t>(rid);
+    key.isV6 = addr.isV6();
+    auto sameTable = [](const StateShmRoute& a, const StateShmRoute& b) {
+      return std::make_tuple(a.routerId, a.isV6) <
+          std::make_tuple(b.routerId, b.isV6);
+    };
+    auto range = std::equal_range(begin, end, key, sameTable);
+    // One binary search per prefix length in the table, longest first
+    for (auto it = range.first; it != range.second;) {
+      key.prefixLength = it->prefixLength;
+      auto samePrefixLength = [](const StateShmRoute& a,
+                                 const StateShmRoute& b) {
+        return a.prefixLength > b.prefixLength;
+      };
+      auto lengthEnd =
+          std::upper_bound(it, range.second, key, samePrefixLength);
+      copyAddr(addr.mask(key.prefixLength), key.addr, &key.isV6);
+      auto match = std::lower_bound(it, lengthEnd, key, routeLess);
+      if (match != lengthEnd &&
+          memcmp(match->addr, key.addr, sizeof(key.addr)) == 0) {
+        Route route;
+        route.prefix = {toIPAddress(match->addr, match->isV6),
+                        match->prefixLength};
+        route.routerId = RouterID(match->routerId);
+        route.action = match->action;
+        route.resolved = match->resolved;
+        auto nhops = records<StateShmNextHop>(
+            slotBase, header_->nextHopsOffset);
+        auto numNextHops = std::min(slot->numNextHops, header_->maxNextHops);
+        if (match->firstNextHop <= numNextHops &&
+            match->numNextHops <= numNextHops - match->firstNextHop) {
+          route.nextHops.assign(
+              nhops + match->firstNextHop,
+              nhops + match->firstNextHop + match->numNextHops);
+        }
+        return route;
+      }
+      it = lengthEnd;
+    }
+    return folly::none;
+  });
+}
+
+IPAddress StateShmReader::toIPAddress(const uint8_t* addr, bool isV6) {
+  if (isV6) {
+    return IPAddress(
+        folly::IPAddressV6::fromBinary(folly::ByteRange(addr, 16)));
+  }
+  return IPAddress(
+      folly::IPAddressV4::fromBinary(folly::ByteRange(addr, 4)));
+}
+
+}} // facebook::fboss
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/MacAddress.h>
+#include <folly/Optional.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class SwitchState;
+
+/*
+ * The layout of the shared memory snapshots of the agent state, for local
+ * readers to look up routes, neighbors and ports without a thrift call.
+ *
+ * The region is a header followed by two slots of the same size. Each slot
+ * holds a whole snapshot as flat, fixed size records at the offsets in the
+ * header from the start of the slot, so it reads the same whichever address
+ * it is mapped at.
+ * The writer fills in the slot that isn't active and then makes it the
+ * active one, so the readers are hardly ever in a slot being written.
+ *
+ * Each slot's seq is odd while it is written. Readers load it before and
+ * after looking at the slot, and retry if it was odd or changed meanwhile.
+ *
+ * The records are sorted for binary searches: ports by ID, neighbors by
+ * address, and routes by router ID, family, prefix length from the
+ * longest down, and address. Addresses are 16 bytes, IPv4 ones in the
+ * first 4.
+ */
+constexpr uint32_t kStateShmMagic = 0xf055a7e5;
+constexpr uint32_t kStateShmVersion = 1;
+
+struct StateShmPort {
+  uint32_t id;
+  uint32_t speedMbps;
+  uint8_t adminUp;
+  uint8_t operUp;
+  uint8_t pad[2];
+  char name[36];
+};
+
+struct StateShmNextHop {
+  uint8_t addr[16];
+  uint8_t isV6;
+  uint8_t pad[3];
+  uint32_t intf;
+  uint32_t weight;
+};
+
+struct StateShmRoute {
+  uint8_t addr[16];
+  uint8_t isV6;
+  uint8_t prefixLength;
+  // A RouteForwardAction
+  uint8_t action;
+  uint8_t resolved;
+  uint32_t routerId;
+  // In the slot's next hops
+  uint32_t firstNextHop;
+  uint32_t numNextHops;
+};
+
+struct StateShmNeighbor {
+  uint8_t addr[16];
+  uint8_t isV6;
+  // A NeighborState
+  uint8_t state;
+  uint8_t mac[6];
+  uint32_t vlan;
+  uint32_t intf;
+  // A physical port unless isAggregatePort
+  uint32_t port;
+  uint8_t isAggregatePort;
+  uint8_t pad[3];
+};
+
+struct StateShmSlot {
+  std::atomic<uint64_t> seq;
+  uint64_t stateGeneration;
+  int64_t publishedMs;
+  // Set when the state had more of some record than fits
+  uint32_t truncated;
+  uint32_t numPorts;
+  uint32_t numRoutes;
+  uint32_t numNextHops;
+  uint32_t numNeighbors;
+  uint32_t pad;
+};
+
+struct StateShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t maxPorts;
+  uint32_t maxRoutes;
+  uint32_t maxNextHops;
+  uint32_t maxNeighbors;
+  uint64_t slotSize;
+  uint64_t slotOffsets[2];
+  // Of each slot's records, from the start of the slot
+  uint64_t portsOffset;
+  uint64_t routesOffset;
+  uint64_t nextHopsOffset;
+  uint64_t neighborsOffset;
+  std::atomic<uint32_t> activeSlot;
+  uint32_t pad;
+  // The number of snapshots published
+  std::atomic<uint64_t> generation;
+};
+
+static_assert(
+    ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+    "The shared memory counters have to be lock free");
+
+/*
+ * Writes snapshots of a SwitchState into the shared memory region at path.
+ * The region is sized for the given capacities, and the writer is the only
+ * one it may have at a time. A new region replaces the file at path rather
+ * than reusing it, so readers still mapping the old one are never cut short.
+ */
+class StateShmWriter {
+ public:
+  StateShmWriter(
+      const std::string& path,
+      uint32_t maxPorts,
+      uint32_t maxRoutes,
+      uint32_t maxNextHops,
+      uint32_t maxNeighbors);
+  ~StateShmWriter();
+
+  void write(const SwitchState& state);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  StateShmWriter(StateShmWriter const &) = delete;
+  StateShmWriter& operator=(StateShmWriter const &) = delete;
+
+  const std::string path_;
+  size_t size_{0};
+  uint8_t* base_{nullptr};
+};
+
+/*
+ * Maps the region at path read only, and looks up the active snapshot in
+ * place. Nothing is copied but the records returned. Lookups throw
+ * FbossError if they keep racing with the writer.
+ *
+ * Once the agent restarts its region is replaced, and the old one is not
+ * written to anymore: isCurrent() tells when to open path again.
+ */
+class StateShmReader {
+ public:
+  struct Route {
+    folly::CIDRNetwork prefix;
+    RouterID routerId;
+    uint8_t action;
+    bool resolved;
+    std::vector<StateShmNextHop> nextHops;
+  };
+
+  explicit StateShmReader(const std::string& path);
+  ~StateShmReader();
+
+  // The number of snapshots published, and the state generation of the
+  // latest one
+  uint64_t getGeneration() const;
+  uint64_t getStateGeneration() const;
+  bool isTruncated() const;
+  bool isCurrent() const;
+
+  folly::Optional<StateShmPort> getPort(PortID id) const;
+  std::vector<StateShmPort> getPorts() const;
+  folly::Optional<StateShmNeighbor> getNeighbor(
+      const folly::IPAddress& ip) const;
+  // The longest prefix match of addr in the routes of rid
+  folly::Optional<Route> longestMatch(
+      RouterID rid,
+      const folly::IPAddress& addr) const;
+
+  static folly::IPAddress toIPAddress(const uint8_t* addr, bool isV6);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  StateShmReader(StateShmReader const &) = delete;
+  StateShmReader& operator=(StateShmReader const &) = delete;
+
+  // Run fn on the active slot until it ran without the slot changing
+  template <typename Fn>
+  auto read(Fn fn) const -> decltype(fn(std::declval<const uint8_t*>()));
+
+  const std::string path_;
+  size_t size_{0};
+  const uint8_t* base_{nullptr};
+  const StateShmHeader* header_{nullptr};
+  // Of the file mapped
+  uint64_t dev_{0};
+  uint64_t ino_{0};
+};
+
+}} // facebook::fboss
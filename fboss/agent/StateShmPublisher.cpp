@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateShmPublisher.h"
+
+#include "fboss/agent/StateShm.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+DEFINE_string(
+    state_shm_path,
+    "",
+    "File to publish snapshots of the routes, neighbors and ports to for "
+    "local readers, e.g. under /dev/shm. Empty to not publish any");
+DEFINE_int32(
+    state_shm_interval_ms,
+    1000,
+    "The least time between two state snapshots published (ms)");
+DEFINE_int32(state_shm_max_ports, 1024, "Ports a state snapshot holds");
+DEFINE_int32(state_shm_max_routes, 131072, "Routes a state snapshot holds");
+DEFINE_int32(
+    state_shm_max_next_hops,
+    262144,
+    "Route next hops a state snapshot holds");
+DEFINE_int32(
+    state_shm_max_neighbors,
+    16384,
+    "ARP and NDP entries a state snapshot holds");
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace facebook { namespace fboss {
+
+StateShmPublisher::StateShmPublisher(
+    SwSwitch* sw,
+    std::unique_ptr<StateShmWriter> writer,
+    milliseconds interval)
+    // Copying the state out doesn't need to hold up the update thread
+    : AutoRegisterStateObserver(sw, "StateShmPublisher", true),
+      writer_(std::move(writer)),
+      interval_(interval) {}
+
+StateShmPublisher::~StateShmPublisher() {
+  unregister();
+}
+
+std::unique_ptr<StateShmPublisher> StateShmPublisher::createFromFlags(
+    SwSwitch* sw) {
+  if (FLAGS_state_shm_path.empty()) {
+    return nullptr;
+  }
+  auto writer = std::make_unique<StateShmWriter>(
+      FLAGS_state_shm_path,
+      std::max(FLAGS_state_shm_max_ports, 0),
+      std::max(FLAGS_state_shm_max_routes, 0),
+      std::max(FLAGS_state_shm_max_next_hops, 0),
+      std::max(FLAGS_state_shm_max_neighbors, 0));
+  XLOG(INFO) << "Publishing state snapshots to " << FLAGS_state_shm_path;
+  return std::make_unique<StateShmPublisher>(
+      sw,
+      std::move(writer),
+      milliseconds(std::max(FLAGS_state_shm_interval_ms, 0)));
+}
+
+void StateShmPublisher::stateUpdated(const StateDelta& delta) {
+  milliseconds delay(0);
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    state_ = delta.newState();
+    if (scheduled_) {
+      // The snapshot scheduled picks this state up
+      return;
+    }
+    scheduled_ = true;
+    auto next = lastPublished_ + interval_;
+    auto now = steady_clock::now();
+    if (next > now) {
+      delay = std::chrono::duration_cast<milliseconds>(next - now);
+    }
+  }
+  auto evb = evbThread_.getEventBase();
+  if (delay.count() == 0) {
+    evb->runInEventBaseThread([this]() { publish(); });
+  } else {
+    evb->runInEventBaseThread([this, evb, delay]() {
+      evb->runAfterDelay([this]() { publish(); }, delay.count());
+    });
+  }
+}
+
+void StateShmPublisher::publish() {
+  std::shared_ptr<SwitchState> state;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    state = std::move(state_);
+    scheduled_ = false;
+    lastPublished_ = steady_clock::now();
+  }
+  if (state) {
+    writer_->write(*state);
+  }
+}
+
+}} // facebook::fboss
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/StateObserver.h"
+
+#include <folly/io/async/ScopedEventBaseThread.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+class StateShmWriter;
+class SwitchState;
+class SwSwitch;
+
+/*
+ * Publishes read only snapshots of the routes, neighbors and ports of the
+ * agent state into shared memory, for local tools to look up with a
+ * StateShmReader instead of making thrift calls.
+ *
+ * Snapshots are written from a thread of their own, at most once every
+ * interval, so bursts of state updates cost one snapshot and neither the
+ * update thread nor the readers ever wait on each other.
+ */
+class StateShmPublisher : public AutoRegisterStateObserver {
+ public:
+  StateShmPublisher(
+      SwSwitch* sw,
+      std::unique_ptr<StateShmWriter> writer,
+      std::chrono::milliseconds interval);
+  ~StateShmPublisher() override;
+
+  // Null unless --state_shm_path is set
+  static std::unique_ptr<StateShmPublisher> createFromFlags(SwSwitch* sw);
+
+  void stateUpdated(const StateDelta& delta) override;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  StateShmPublisher(StateShmPublisher const &) = delete;
+  StateShmPublisher& operator=(StateShmPublisher const &) = delete;
+
+  // From the event base thread
+  void publish();
+
+  const std::unique_ptr<StateShmWriter> writer_;
+  const std::chrono::milliseconds interval_;
+  std::mutex lock_;
+  // The latest state not published yet, if any
+  std::shared_ptr<SwitchState> state_;
+  bool scheduled_{false};
+  std::chrono::steady_clock::time_point lastPublished_;
+  folly::ScopedEventBaseThread evbThread_;
+};
+
+}} // facebook::fboss
@@ -13,43 +13,67 @@
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <thrift/lib/cpp2/async/RequestChannel.h>
 
+#include <folly/Conv.h>
 #include <folly/Demangle.h>
 #include <folly/FileUtil.h>
 #include <folly/GLog.h>
 #include <folly/MacAddress.h>
 #include <folly/MapUtil.h>
+#include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <exception>
 #include <tuple>
 #include "common/stats/ServiceData.h"
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/AgentConfig.h"
+#include "fboss/agent/AllocationProfiler.h"
 #include "fboss/agent/ApplyThriftConfig.h"
 #include "fboss/agent/ArpHandler.h"
+#include "fboss/agent/AsyncStateObserverThread.h"
 #include "fboss/agent/Constants.h"
+#include "fboss/agent/ControlPlanePolicer.h"
+#include "fboss/agent/CpuAclFilter.h"
+#include "fboss/agent/DHCPRelayCache.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/HwSwitch.h"
 #include "fboss/agent/IPv4Handler.h"
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/LacpTypes.h"
+#include "fboss/agent/LatencyQuantiles.h"
 #include "fboss/agent/LinkAggregationManager.h"
 #include "fboss/agent/LldpManager.h"
+#include "fboss/agent/LocalAddressCache.h"
 #include "fboss/agent/MirrorManager.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/NexthopToRouteCount.h"
+#include "fboss/agent/PcapPublisher.h"
+#include "fboss/agent/PendingNeighborQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/PortUpdateHandler.h"
+#include "fboss/agent/RouteAdmissionControl.h"
+#include "fboss/agent/RouteGracefulRestart.h"
+#include "fboss/agent/RouteReplicator.h"
 #include "fboss/agent/RouteUpdateLogger.h"
+#include "fboss/agent/RouteUpdateQueue.h"
 #include "fboss/agent/RxPacket.h"
+#include "fboss/agent/RxPacketDispatcher.h"
+#include "fboss/agent/SlowPathRouteCache.h"
+#include "fboss/agent/StateShmPublisher.h"
 #include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/ThreadPlacement.h"
+#include "fboss/agent/Tracepoints.h"
 #include "fboss/agent/ThriftHandler.h"
 #include "fboss/agent/TunManager.h"
 #include "fboss/agent/TxPacket.h"
+#include "fboss/agent/TxPacketBatcher.h"
 #include "fboss/agent/AlpmUtils.h"
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/capture/PktCaptureManager.h"
@@ -88,16 +112,100 @@ using namespace apache::thrift::async;
 
 
 DEFINE_int32(thread_heartbeat_ms, 1000, "Thread heartbeat interval (ms)");
+DEFINE_int32(
+    update_thread_stall_ms,
+    1000,
+    "Log the state update which held the update thread up when its "
+    "heartbeat is at least this late (ms)");
+DEFINE_int32(
+    update_starvation_ms,
+    1000,
+    "Pending state updates are applied before any of a higher priority "
+    "once they have waited this long (ms)");
+DEFINE_bool(
+    pipeline_state_updates,
+    false,
+    "Program the hardware for a batch of state updates on a dedicated "
+    "thread, while the update thread runs the update functions of the next "
+    "batch");
 DEFINE_int32(
     distribution_timeout_ms,
     1000,
     "Timeout for sending to distribution_service (ms)");
+DEFINE_bool(
+    rx_dispatch_threads,
+    true,
+    "Handle trapped packets on per packet class worker threads, rather than "
+    "on the thread the hardware delivered them on");
+DEFINE_int32(
+    rx_dispatch_queue_size,
+    4096,
+    "Number of trapped packets that can be queued per packet class before "
+    "further packets of that class are dropped");
+DEFINE_int32(
+    rx_high_priority_cos_queue,
+    9,
+    "Trapped packets received on this CPU CoS queue or above are handled "
+    "by the high priority rx worker");
+DEFINE_bool(
+    tx_batching,
+    true,
+    "Queue packets sent out of a port and hand them to the hardware in "
+    "batches, rather than one at a time");
+DEFINE_int32(
+    tx_batch_max_size,
+    64,
+    "Maximum number of packets queued for a port before they are sent");
+DEFINE_int32(
+    neighbor_cache_threads,
+    4,
+    "Number of threads Arp and Ndp cache entries are processed on. Each "
+    "VLAN's entries are all processed by the same thread.");
+DEFINE_int32(
+    pcap_dist_batch_size,
+    256,
+    "Maximum number of packets sent to distribution_service in one call");
+DEFINE_int32(
+    pcap_dist_batch_bytes,
+    1 << 20,
+    "Maximum number of bytes of packet data sent to distribution_service in "
+    "one call");
+DEFINE_int32(
+    pcap_dist_batch_delay_ms,
+    20,
+    "Maximum time a packet is held before being sent to "
+    "distribution_service (ms)");
+DEFINE_int32(
+    pcap_dist_max_in_flight,
+    8,
+    "Number of batches that can be waiting on distribution_service before "
+    "further packets are dropped");
 
 namespace {
 
 constexpr auto kOutOfSyncStateUpdate =
     "state update for failed hardware application";
 
+// Number of state updates we keep the timings of
+constexpr size_t kRecentStateUpdates = 1024;
+
+// In StateUpdate::Priority order
+const char* const kStateUpdatePriorityNames[] = {
+    "link_state",
+    "neighbor",
+    "route",
+    "default",
+};
+static_assert(
+    sizeof(kStateUpdatePriorityNames) / sizeof(kStateUpdatePriorityNames[0]) ==
+        facebook::fboss::StateUpdate::kNumPriorities,
+    "Every StateUpdate::Priority needs a name");
+
+int64_t totalUs(const facebook::fboss::StateUpdateTiming& timing) {
+  return timing.queuedUs + timing.swApplyUs + timing.hwApplyUs +
+      timing.observersUs;
+}
+
 /**
  * Transforms the IPAddressV6 to MacAddress. RFC 2464
  * 33:33:xx:xx:xx:xx (lower 32 bits are copied from addr)
@@ -120,6 +228,45 @@ folly::MacAddress getMulticastMacAddr(folly::IPAddressV4 addr) {
       bytes.begin(), bytes.end()));
 }
 
+/*
+ * Parse the source and destination MAC, as well as the ethertype, leaving c
+ * at the start of the payload.
+ */
+uint16_t parseEthernetHeader(
+    Cursor* c,
+    folly::MacAddress* dstMac,
+    folly::MacAddress* srcMac) {
+  *dstMac = facebook::fboss::PktUtil::readMac(c);
+  *srcMac = facebook::fboss::PktUtil::readMac(c);
+  auto ethertype = c->readBE<uint16_t>();
+  if (ethertype == 0x8100) {
+    // 802.1Q
+    *c += 2; // Advance over the VLAN tag.  We ignore it for now
+    ethertype = c->readBE<uint16_t>();
+  }
+  return ethertype;
+}
+
+facebook::fboss::RxPacketClass classifyRxPacket(
+    const facebook::fboss::RxPacket& pkt,
+    uint16_t ethertype) {
+  using facebook::fboss::RxPacketClass;
+  switch (ethertype) {
+  case facebook::fboss::LldpManager::ETHERTYPE_LLDP:
+  case facebook::fboss::LACPDU::EtherType::SLOW_PROTOCOLS:
+    return RxPacketClass::CONTROL;
+  default:
+    break;
+  }
+  if (pkt.cosQueue() >= FLAGS_rx_high_priority_cos_queue) {
+    return RxPacketClass::HIGH_PRIORITY;
+  }
+  if (ethertype == facebook::fboss::ArpHandler::ETHERTYPE_ARP) {
+    return RxPacketClass::ARP;
+  }
+  return RxPacketClass::DEFAULT;
+}
+
 facebook::fboss::PortStatus fillInPortStatus(
     const facebook::fboss::Port& port,
     const facebook::fboss::SwSwitch* sw) {
@@ -155,17 +302,32 @@ class ChannelCloser : public CloseCallback {
 };
 
 SwSwitch::SwSwitch(std::unique_ptr<Platform> platform)
-    : hw_(platform->getHwSwitch()),
+    : appliedConfigCache_(std::make_unique<AppliedConfigCache>()),
+      hw_(platform->getHwSwitch()),
       platform_(std::move(platform)),
       closer_(new ChannelCloser(this)),
       arp_(new ArpHandler(this)),
       ipv4_(new IPv4Handler(this)),
       ipv6_(new IPv6Handler(this)),
       nUpdater_(new NeighborUpdater(this)),
+      pendingNeighbors_(new PendingNeighborQueue(this)),
+      dhcpRelayCache_(new DHCPRelayCache()),
+      localAddressCache_(new LocalAddressCache()),
+      slowPathRouteCache_(new SlowPathRouteCache()),
       pcapMgr_(new PktCaptureManager(this)),
       mirrorManager_(new MirrorManager(this)),
+      cpuAclFilter_(new CpuAclFilter(this)),
+      cpuPolicer_(ControlPlanePolicer::createFromFlags()),
       routeUpdateLogger_(new RouteUpdateLogger(this)),
-      portUpdateHandler_(new PortUpdateHandler(this)) {
+      nhopRouteCounts_(new NexthopToRouteCount(this)),
+      routeUpdateQueue_(new RouteUpdateQueue(this)),
+      routeAdmissionControl_(RouteAdmissionControl::createFromFlags()),
+      routeGracefulRestart_(new RouteGracefulRestart(this)),
+      routeReplicator_(RouteReplicator::createFromFlags(this)),
+      stateShmPublisher_(StateShmPublisher::createFromFlags(this)),
+      portUpdateHandler_(new PortUpdateHandler(this)),
+      stateUpdateLatency_(new LatencyQuantiles("state_update.latency.us")),
+      rxPacketLatency_(new LatencyQuantiles("rx_packet.latency.us")) {
   // Create the platform-specific state directories if they
   // don't exist already.
   utilCreateDir(platform_->getVolatileStateDir());
@@ -173,6 +335,43 @@ SwSwitch::SwSwitch(std::unique_ptr<Platform> platform)
 
   // doesnt need to be guarded, only accessed by 1 event base
   pcapPusher_ = nullptr;
+
+  if (FLAGS_rx_dispatch_threads) {
+    rxDispatcher_ = std::make_unique<RxPacketDispatcher>(
+        [this](std::unique_ptr<RxPacket> pkt) {
+          handleDispatchedPacket(std::move(pkt));
+        },
+        [this](RxPacketClass cls, const RxPacket& pkt) {
+          portStats(pkt.getSrcPort())->rxQueueDrop(cls);
+        },
+        FLAGS_rx_dispatch_queue_size);
+  }
+  if (FLAGS_tx_batching) {
+    txBatcher_ = std::make_unique<TxPacketBatcher>(
+        &packetTxEventBase_,
+        [this](
+            PortID portID,
+            folly::Optional<uint8_t> cos,
+            std::vector<std::unique_ptr<TxPacket>> pkts,
+            TxPacketBatcher::TimePoint oldestQueued) {
+          sendPacketBatch(portID, cos, std::move(pkts), oldestQueued);
+        },
+        FLAGS_tx_batch_max_size);
+  }
+  auto numNeighborCacheThreads = std::max(FLAGS_neighbor_cache_threads, 1);
+  for (int i = 0; i < numNeighborCacheThreads; ++i) {
+    neighborCacheThreads_.push_back(std::make_unique<NeighborCacheThread>());
+  }
+  pcapPublisher_ = std::make_unique<PcapPublisher>(
+      &pcapDistributionEventBase_,
+      [this](std::vector<PublishedPacket> pkts) {
+        return sendPcapBatch(std::move(pkts));
+      },
+      [this](size_t numPkts) { stats()->pcapDistDropped(numPkts); },
+      FLAGS_pcap_dist_batch_size,
+      FLAGS_pcap_dist_batch_bytes,
+      std::chrono::milliseconds(FLAGS_pcap_dist_batch_delay_ms),
+      FLAGS_pcap_dist_max_in_flight);
 }
 
 
@@ -214,6 +413,12 @@ void SwSwitch::stop() {
   // while we are destroying ourselves
   hw_->unregisterCallbacks();
 
+  // The rx workers call into the packet handlers destroyed below, so stop
+  // them too. Packets still queued for them are dropped.
+  if (rxDispatcher_) {
+    rxDispatcher_->stop();
+  }
+
   // Stop tunMgr so we don't get any packets to process
   // in software that were sent to the switch ip or were
   // routed from kernel to the front panel tunnel interface.
@@ -246,12 +451,15 @@ void SwSwitch::stop() {
   ipv6_.reset();
 
   routeUpdateLogger_.reset();
+  nhopRouteCounts_.reset();
 
   bgThreadHeartbeat_.reset();
   updThreadHeartbeat_.reset();
   packetTxThreadHeartbeat_.reset();
   lacpThreadHeartbeat_.reset();
-  neighborCacheThreadHeartbeat_.reset();
+  for (auto& neighborCacheThread : neighborCacheThreads_) {
+    neighborCacheThread->heartbeat.reset();
+  }
 
   // stops the background and update threads.
   stopThreads();
@@ -342,6 +550,42 @@ void SwSwitch::updateStats(){
     stats()->updateStatsException();
     XLOG(ERR) << "Error running updateStats: " << folly::exceptionStr(ex);
   }
+  if (auto classifier = cpuAclFilter_->getClassifier()) {
+    classifier->publishStats();
+  }
+  stateUpdateLatency_->publish();
+  rxPacketLatency_->publish();
+}
+
+NodeMemoryAccounting SwSwitch::getStateMemoryUsage() const {
+  std::shared_ptr<SwitchState> appliedState;
+  std::shared_ptr<SwitchState> desiredState;
+  std::tie(appliedState, desiredState) = getStates();
+  NodeMemoryAccounting acct;
+  appliedState->accountMemory(&acct);
+  desiredState->accountMemory(&acct);
+  return acct;
+}
+
+void SwSwitch::publishStateMemoryUsage() {
+  auto acct = getStateMemoryUsage();
+  for (const auto& usage : acct.getUsage()) {
+    tcData().setCounter(
+        folly::to<string>("state_memory.", usage.first, ".bytes"),
+        usage.second.bytes);
+    tcData().setCounter(
+        folly::to<string>("state_memory.", usage.first, ".count"),
+        usage.second.count);
+  }
+  tcData().setCounter("state_memory.bytes", acct.totalBytes());
+}
+
+void SwSwitch::publishPacketCounters() {
+  // Get our own stats before locking the other threads' ones
+  auto publisher = stats();
+  for (auto& switchStats : getAllThreadsSwitchStats()) {
+    switchStats.publishPacketCounters(publisher);
+  }
 }
 
 void SwSwitch::registerNeighborListener(
@@ -362,6 +606,30 @@ void SwSwitch::invokeNeighborListener(
 }
 
 bool SwSwitch::getAndClearNeighborHit(RouterID vrf, folly::IPAddress ip) {
+  // Rather than looking up each entry in the hardware on its own, read the
+  // hit bits of the whole table at most once per stale entry interval, which
+  // is how often each entry checks its hit bit.
+  auto now = steady_clock::now();
+  {
+    std::lock_guard<std::mutex> g(neighborHitsLock_);
+    if (bulkNeighborHits_) {
+      auto& hits = neighborHits_[vrf];
+      if (!hits.fetched ||
+          now - *hits.fetched >= getState()->getStaleEntryInterval()) {
+        auto ips = hw_->getAndClearNeighborHits(vrf);
+        if (ips) {
+          hits.ips = std::move(*ips);
+          hits.fetched = now;
+        } else {
+          bulkNeighborHits_ = false;
+        }
+      }
+      if (bulkNeighborHits_) {
+        // Only report each hit once, like the hardware hit bit
+        return hits.ips.erase(ip) > 0;
+      }
+    }
+  }
   return hw_->getAndClearNeighborHit(vrf, ip);
 }
 
@@ -379,41 +647,59 @@ void SwSwitch::clearWarmBootCache() {
 }
 
 void SwSwitch::publishRxPacket(RxPacket* pkt, uint16_t ethertype){
-  RxPacketData pubPkt;
-  pubPkt.srcPort = pkt->getSrcPort();
-  pubPkt.srcVlan = pkt->getSrcVlan();
+  RxPacketData rxPkt;
+  rxPkt.srcPort = pkt->getSrcPort();
+  rxPkt.srcVlan = pkt->getSrcVlan();
 
   for (const auto& r : pkt->getReasons()) {
     RxReason reason;
     reason.bytes = r.bytes;
     reason.description = r.description;
-    pubPkt.reasons.push_back(reason);
+    rxPkt.reasons.push_back(reason);
   }
 
-  folly::IOBuf buf_copy;
-  pkt->buf()->cloneInto(buf_copy);
-  pubPkt.packetData = buf_copy.moveToFbString();
-  auto onError = [&](std::runtime_error& /* unused */) {
-    stats()->pcapDistFailure();
-    FB_LOG_EVERY_MS(ERROR, 1000)
-        << "Unable to push packet to distribution service\n";
-  };
-  pcapPusher_->future_receiveRxPacket(pubPkt, ethertype)
-      .onError(std::move(onError));
+  // Copy the data straight out of the receive buffer. Going through
+  // IOBuf::moveToFbString() would first clone the buffer, which is shared
+  // with the packet handlers, only to copy it anyway.
+  auto length = pkt->buf()->computeChainDataLength();
+  rxPkt.packetData.resize(length);
+  Cursor(pkt->buf()).pull(&rxPkt.packetData[0], length);
+
+  PublishedPacket pubPkt;
+  pubPkt.packet.rx = true;
+  pubPkt.packet.pkt.set_rxpkt(std::move(rxPkt));
+  pubPkt.ethertype = ethertype;
+  pcapPublisher_->publish(std::move(pubPkt));
 }
 
 void SwSwitch::publishTxPacket(TxPacket* pkt, uint16_t ethertype){
-  TxPacketData pubPkt;
+  TxPacketData txPkt;
   folly::IOBuf copy_buf;
   pkt->buf()->cloneInto(copy_buf);
-  pubPkt.packetData = copy_buf.moveToFbString();
-  auto onError = [&](std::runtime_error& /* unused */) {
+  txPkt.packetData = copy_buf.moveToFbString();
+
+  PublishedPacket pubPkt;
+  pubPkt.packet.rx = false;
+  pubPkt.packet.pkt.set_txpkt(std::move(txPkt));
+  pubPkt.ethertype = ethertype;
+  pcapPublisher_->publish(std::move(pubPkt));
+}
+
+folly::Future<folly::Unit> SwSwitch::sendPcapBatch(
+    std::vector<PublishedPacket> pkts) {
+  // Runs in the pcap distribution thread, which owns pcapPusher_
+  if (!pcapPusher_ || !distributionServiceReady_.load()) {
+    stats()->pcapDistDropped(pkts.size());
+    return folly::makeFuture();
+  }
+  auto numPkts = pkts.size();
+  auto onError = [this, numPkts](std::runtime_error& /* unused */) {
     stats()->pcapDistFailure();
+    stats()->pcapDistDropped(numPkts);
     FB_LOG_EVERY_MS(ERROR, 1000)
-        << "Unable to push packet to distribution service\n";
+        << "Unable to push packets to distribution service\n";
   };
-  pcapPusher_->future_receiveTxPacket(pubPkt, ethertype)
-      .onError(std::move(onError));
+  return pcapPusher_->future_receivePackets(pkts).onError(std::move(onError));
 }
 
 void SwSwitch::init(std::unique_ptr<TunManager> tunMgr, SwitchFlags flags) {
@@ -474,6 +760,11 @@ void SwSwitch::init(std::unique_ptr<TunManager> tunMgr, SwitchFlags flags) {
   // applying initial config.
   if (flags & SwitchFlags::PUBLISH_STATS) {
     publishSwitchInfo(hwInitRet);
+    for (const auto& phaseTime : hwInitRet.initPhaseTimes) {
+      publishInitTimes(
+          folly::to<std::string>("fboss.agent.", phaseTime.first),
+          phaseTime.second);
+    }
   }
 
   if (flags & SwitchFlags::ENABLE_LLDP) {
@@ -493,8 +784,7 @@ void SwSwitch::init(std::unique_ptr<TunManager> tunMgr, SwitchFlags flags) {
     bgHeartbeatStatsFunc);
 
   auto updHeartbeatStatsFunc = [this] (int delay, int backLog) {
-    stats()->updHeartbeatDelay(delay);
-    stats()->updEventBacklog(backLog);
+    updateThreadHeartbeat(delay, backLog);
   };
   updThreadHeartbeat_ = std::make_unique<ThreadHeartbeat>(
     &updateEventBase_, "fbossUpdateThread", FLAGS_thread_heartbeat_ms,
@@ -520,14 +810,19 @@ void SwSwitch::init(std::unique_ptr<TunManager> tunMgr, SwitchFlags flags) {
       FLAGS_thread_heartbeat_ms,
       updateLacpThreadHeartbeatStats);
 
-  neighborCacheThreadHeartbeat_ = std::make_unique<ThreadHeartbeat>(
-      &neighborCacheEventBase_,
-      *folly::getThreadName(neighborCacheThread_->get_id()),
-      FLAGS_thread_heartbeat_ms,
-      [this](int delay, int backlog) {
-        stats()->neighborCacheHeartbeatDelay(delay);
-        stats()->neighborCacheEventBacklog(backlog);
-      });
+  for (auto& neighborCacheThread : neighborCacheThreads_) {
+    neighborCacheThread->heartbeat = std::make_unique<ThreadHeartbeat>(
+        &neighborCacheThread->evb,
+        *folly::getThreadName(neighborCacheThread->thread->get_id()),
+        FLAGS_thread_heartbeat_ms,
+        [this](int delay, int backlog) {
+          stats()->neighborCacheHeartbeatDelay(delay);
+          stats()->neighborCacheEventBacklog(backlog);
+        });
+  }
+
+  // The SDK and thrift threads are all up by now
+  ThreadPlacement::get()->applyToAllThreads();
 
   setSwitchRunState(SwitchRunState::INITIALIZED);
 
@@ -538,6 +833,8 @@ void SwSwitch::initialConfigApplied(const steady_clock::time_point& startTime) {
   // notify the hw
   hw_->initialConfigApplied();
   platform_->onInitialConfigApplied(this);
+  // Again for the threads the config started, e.g. the SDK linkscan thread
+  ThreadPlacement::get()->applyToAllThreads();
 
   setSwitchRunState(SwitchRunState::CONFIGURED);
 
@@ -592,10 +889,12 @@ void SwSwitch::fibSynced() {
 }
 
 void SwSwitch::registerStateObserver(StateObserver* observer,
-                                     const string name) {
-  XLOG(DBG2) << "Registering state observer: " << name;
+                                     const string name,
+                                     bool async) {
+  XLOG(DBG2) << "Registering " << (async ? "async " : "")
+             << "state observer: " << name;
   updateEventBase_.runImmediatelyOrRunInEventBaseThreadAndWait([=]() {
-      addStateObserver(observer, name);
+      addStateObserver(observer, name, async);
   });
 }
 
@@ -605,6 +904,14 @@ void SwSwitch::unregisterStateObserver(StateObserver* observer) {
   });
 }
 
+void SwSwitch::waitForStateObservers() {
+  updateEventBase_.runImmediatelyOrRunInEventBaseThreadAndWait([=]() {
+    for (const auto& observerAndThread : asyncStateObservers_) {
+      observerAndThread.second->waitForIdle();
+    }
+  });
+}
+
 bool SwSwitch::stateObserverRegistered(StateObserver* observer) {
   DCHECK(updateEventBase_.isInEventBaseThread());
   return stateObservers_.find(observer) != stateObservers_.end();
@@ -616,14 +923,23 @@ void SwSwitch::removeStateObserver(StateObserver* observer) {
   if (!nErased) {
     throw FbossError("State observer remove failed: observer does not exist");
   }
+  // Lets an async observer finish with the updates it has been sent
+  asyncStateObservers_.erase(observer);
 }
 
-void SwSwitch::addStateObserver(StateObserver* observer, const string& name) {
+void SwSwitch::addStateObserver(
+    StateObserver* observer,
+    const string& name,
+    bool async) {
   DCHECK(updateEventBase_.isInEventBaseThread());
   if (stateObserverRegistered(observer)) {
     throw FbossError("State observer add failed: ", name, " already exists");
   }
   stateObservers_.emplace(observer, name);
+  if (async) {
+    asyncStateObservers_.emplace(
+        observer, std::make_unique<AsyncStateObserverThread>(observer, name));
+  }
 }
 
 void SwSwitch::notifyStateObservers(const StateDelta& delta) {
@@ -632,7 +948,19 @@ void SwSwitch::notifyStateObservers(const StateDelta& delta) {
     // Make sure the SwSwitch is not already being destroyed
     return;
   }
+  // Get the async observers going first. They all share one copy of the
+  // delta, which only holds on to the two immutable states.
+  if (!asyncStateObservers_.empty()) {
+    auto sharedDelta =
+        std::make_shared<const StateDelta>(delta.oldState(), delta.newState());
+    for (const auto& observerAndThread : asyncStateObservers_) {
+      observerAndThread.second->notify(sharedDelta);
+    }
+  }
   for (auto observerName : stateObservers_) {
+    if (asyncStateObservers_.count(observerName.first)) {
+      continue;
+    }
     try {
       auto observer = observerName.first;
       observer->stateUpdated(delta);
@@ -646,10 +974,17 @@ void SwSwitch::notifyStateObservers(const StateDelta& delta) {
 
 void SwSwitch::updateState(
     unique_ptr<StateUpdate> update) {
+  update->queued_ = steady_clock::now();
+  auto priority = static_cast<int>(update->getPriority());
+  FBOSS_TRACEPOINT(state_update_queued, update->getName().c_str(), priority);
+  std::array<size_t, StateUpdate::kNumPriorities> counts;
   {
     folly::SpinLockGuard guard(pendingUpdatesLock_);
-    pendingUpdates_.push_back(*update.release());
+    pendingUpdates_[priority].push_back(*update.release());
+    ++pendingUpdateCounts_[priority];
+    counts = pendingUpdateCounts_;
   }
+  publishPendingUpdateCounts(counts);
 
   // Signal the update thread that updates are pending.
   // We call runInEventBaseThread() with a static function pointer since this
@@ -661,13 +996,14 @@ void SwSwitch::queueStateUpdateForGettingHwInSync(
     StringPiece name,
     StateUpdateFn fn) {
   auto update = make_unique<FunctionStateUpdate>(name, std::move(fn));
+  update->queued_ = steady_clock::now();
   {
     // Push the state update in front to preserver ordering.
     // This is not particularly necessary, since this state
     // update is freely coalesced with other state updates when
     // we come to processing pending updates
     folly::SpinLockGuard guard(pendingUpdatesLock_);
-    pendingUpdates_.push_front(*update.release());
+    pendingHwSyncUpdates_.push_front(*update.release());
   }
   // Don't inform updateEventBase about this update being queued.
   // Rather let this update be processed with the next incoming update.
@@ -684,91 +1020,197 @@ void SwSwitch::queueStateUpdateForGettingHwInSync(
 
 void SwSwitch::updateState(
     StringPiece name,
-    StateUpdateFn fn) {
-  auto update = make_unique<FunctionStateUpdate>(name, std::move(fn));
+    StateUpdateFn fn,
+    StateUpdate::Priority priority) {
+  auto update =
+      make_unique<FunctionStateUpdate>(name, std::move(fn), true, priority);
   updateState(std::move(update));
 }
 
-void SwSwitch::updateStateNoCoalescing(StringPiece name, StateUpdateFn fn) {
-  auto update = make_unique<FunctionStateUpdate>(name, std::move(fn), false);
+void SwSwitch::updateStateNoCoalescing(
+    StringPiece name,
+    StateUpdateFn fn,
+    StateUpdate::Priority priority) {
+  auto update =
+      make_unique<FunctionStateUpdate>(name, std::move(fn), false, priority);
   updateState(std::move(update));
 }
 
-void SwSwitch::updateStateBlocking(folly::StringPiece name, StateUpdateFn fn) {
+void SwSwitch::updateStateBlocking(
+    folly::StringPiece name,
+    StateUpdateFn fn,
+    StateUpdate::Priority priority) {
   auto result = std::make_shared<BlockingUpdateResult>();
-  auto update = make_unique<BlockingStateUpdate>(name, std::move(fn), result);
+  auto update = make_unique<BlockingStateUpdate>(
+      name, std::move(fn), result, true, priority);
   updateState(std::move(update));
   result->wait();
 }
 
+SwSwitch::StateUpdateList* FOLLY_NULLABLE SwSwitch::nextPendingUpdates(
+    steady_clock::time_point now) {
+  // Take the highest priority updates, unless the oldest update of some
+  // priority has been starved for longer than --update_starvation_ms. Then
+  // the longest waiting of those goes first instead.
+  StateUpdateList* next = nullptr;
+  StateUpdateList* starved = nullptr;
+  auto starvedSince = now - milliseconds(FLAGS_update_starvation_ms);
+  for (auto& queue : pendingUpdates_) {
+    if (queue.empty()) {
+      continue;
+    }
+    if (!next) {
+      next = &queue;
+    }
+    auto queued = queue.front().queued_;
+    if (queued <= starvedSince &&
+        (!starved || queued < starved->front().queued_)) {
+      starved = &queue;
+    }
+  }
+  return starved ? starved : next;
+}
+
+void SwSwitch::publishPendingUpdateCounts(
+    const std::array<size_t, StateUpdate::kNumPriorities>& counts) {
+  for (int i = 0; i < StateUpdate::kNumPriorities; ++i) {
+    tcData().setCounter(
+        folly::to<string>(
+            "state_update.pending.", kStateUpdatePriorityNames[i]),
+        counts[i]);
+  }
+}
+
 void SwSwitch::handlePendingUpdatesHelper(SwSwitch* sw) {
   sw->handlePendingUpdates();
 }
 
 void SwSwitch::handlePendingUpdates() {
+  if (nextHwBatch_) {
+    // Both the hardware and the next batch are taken, the updates are picked
+    // up once the batch being programmed is done
+    return;
+  }
+
   // Get the list of updates to run.
   //
   // We might pull multiple updates off the list at once if several updates
   // were scheduled before we had a chance to process them.  In some cases we
   // might also end up finding 0 updates to process if a previous
   // handlePendingUpdates() call processed multiple updates.
-  StateUpdateList updates;
+  //
+  // Updates are only ever pulled off the list of a single priority at a time,
+  // so a batch of urgent updates isn't held up by less urgent ones which
+  // happen to be pending too.
+  auto batch = make_unique<StateUpdateBatch>();
+  auto pickedUp = steady_clock::now();
+  std::array<size_t, StateUpdate::kNumPriorities> counts;
   {
     folly::SpinLockGuard guard(pendingUpdatesLock_);
 
+    auto queue = nextPendingUpdates(pickedUp);
+    if (!queue) {
+      // handlePendingUpdates() is invoked once for each update, but a
+      // previous call might have already processed everything.  The updates
+      // to get the hardware back in sync wait for the next real update.
+      return;
+    }
+    // These start from the applied state, so can't go in a batch computed
+    // while another one is being programmed. None is queued then anyway:
+    // they are only queued when the last batch is done and none is waiting.
+    DCHECK(!hwBatchInFlight_ || pendingHwSyncUpdates_.empty());
+    if (!hwBatchInFlight_) {
+      batch->updates.splice(batch->updates.begin(), pendingHwSyncUpdates_);
+    }
+
     // When deciding how many elements to pull off the pendingUpdates_
     // list, we pull as many as we can, while making sure we don't
     // include any updates after an update that does not allow
     // coalescing.
-    auto iter = pendingUpdates_.begin();
-    while (iter != pendingUpdates_.end()) {
+    auto& count = pendingUpdateCounts_[
+        static_cast<int>(queue->front().getPriority())];
+    auto iter = queue->begin();
+    while (iter != queue->end()) {
       StateUpdate* update = &(*iter);
       ++iter;
+      --count;
       if (!update->allowsCoalescing()) {
         break;
       }
     }
-    updates.splice(updates.begin(), pendingUpdates_,
-                   pendingUpdates_.begin(), iter);
-  }
-
-  // handlePendingUpdates() is invoked once for each update, but a previous
-  // call might have already processed everything.  If we don't have anything
-  // to do just return early.
-  if (updates.empty()) {
-    return;
-  }
-
-  if (updates.size() == 1 &&
-      updates.begin()->getName() == kOutOfSyncStateUpdate) {
-    return;
+    batch->updates.splice(
+        batch->updates.end(), *queue, queue->begin(), iter);
+    counts = pendingUpdateCounts_;
   }
+  publishPendingUpdateCounts(counts);
 
   // This function should never be called with valid updates while we are
   // not initialized yet
   DCHECK(isInitialized());
 
-  std::shared_ptr<SwitchState> oldAppliedState;
-  std::shared_ptr<SwitchState> oldDesiredState;
-  // Call all of the update functions to prepare the new SwitchState
-  std::tie(oldAppliedState, oldDesiredState) = getStates();
-  bool oldOutOfSync = (oldAppliedState != oldDesiredState);
   // We start with the old applied state, and apply state updates one at a
   // time. The first state update applied is one from oldAppliedState ->
   // oldDesiredState. This is the one we always enqueue at the front of the
   // queue whenever applied and desired states diverge. After that, other
   // supplied state updates are applied (that were spliced above).
-  auto newDesiredState = oldAppliedState;
-  auto iter = updates.begin();
-  while (iter != updates.end()) {
+  //
+  // While a batch is being programmed, the updates run on its desired state
+  // instead, which is only published once the hardware is done with it.
+  batch->base =
+      hwBatchInFlight_ ? hwBatchInFlight_->newDesired : getAppliedState();
+  runStateUpdates(batch.get(), pickedUp);
+
+  if (hwBatchInFlight_) {
+    nextHwBatch_ = std::move(batch);
+  } else {
+    applyBatch(std::move(batch));
+  }
+}
+
+SwSwitch::StateUpdateBatch::~StateUpdateBatch() {
+  // Only left with updates if the agent exits before the batch is applied
+  while (!updates.empty()) {
+    unique_ptr<StateUpdate> update(&updates.front());
+    updates.pop_front();
+  }
+}
+
+void SwSwitch::runStateUpdates(
+    StateUpdateBatch* batch,
+    steady_clock::time_point pickedUp) {
+  auto startTimeUs =
+      duration_cast<microseconds>(system_clock::now().time_since_epoch())
+          .count();
+  auto batchSize = batch->updates.size();
+  auto newDesiredState = batch->base;
+  auto iter = batch->updates.begin();
+  while (iter != batch->updates.end()) {
     StateUpdate* update = &(*iter);
     ++iter;
 
     shared_ptr<SwitchState> intermediateState;
     XLOG(INFO) << "preparing state update " << update->getName();
+    StateUpdateTiming timing;
+    timing.name = update->getName();
+    timing.startTimeUs = startTimeUs;
+    timing.queuedUs =
+        duration_cast<microseconds>(pickedUp - update->queued_).count();
+    timing.batchSize = batchSize;
+    auto swApplyStart = steady_clock::now();
     try {
+      AllocationScope allocScope(AllocationPath::STATE_UPDATE_FN, stats());
       intermediateState = update->applyUpdate(newDesiredState);
+      timing.swApplyUs =
+          duration_cast<microseconds>(steady_clock::now() - swApplyStart)
+              .count();
+      FBOSS_TRACEPOINT(state_update_applied, update->getName().c_str(), 0);
+      batch->timings.push_back(std::move(timing));
     } catch (const std::exception& ex) {
+      timing.swApplyUs =
+          duration_cast<microseconds>(steady_clock::now() - swApplyStart)
+              .count();
+      batch->failedTimings.push_back(std::move(timing));
+      FBOSS_TRACEPOINT(state_update_applied, update->getName().c_str(), 1);
       // Call the update's onError() function, and then immediately delete
       // it (therefore removing it from the intrusive list).  This way we won't
       // call it's onSuccess() function later.
@@ -787,40 +1229,137 @@ void SwSwitch::handlePendingUpdates() {
       newDesiredState = intermediateState;
     }
   }
+  batch->newDesired = newDesiredState;
+}
 
-  // Now apply the update and notify subscribers
-  if (newDesiredState != oldAppliedState) {
-    // There was some change during these state updates
-    auto newAppliedState = applyUpdate(oldAppliedState, newDesiredState);
+void SwSwitch::applyBatch(std::unique_ptr<StateUpdateBatch> batch) {
+  DCHECK(!hwBatchInFlight_);
+  std::shared_ptr<SwitchState> oldDesiredState;
+  std::tie(batch->oldApplied, oldDesiredState) = getStates();
+  batch->oldOutOfSync = (batch->oldApplied != oldDesiredState);
+  if (batch->base != batch->oldApplied) {
+    // The batch was run on the desired state of the one before, which the
+    // hardware did not fully take. Start from what it did take instead, the
+    // way the update queued by queueStateUpdateForGettingHwInSync() does, so
+    // what failed is tried again along with this batch.
+    auto hwOutOfSyncState = batch->newDesired->clone();
+    hwOutOfSyncState->inheritGeneration(*batch->oldApplied);
+    hwOutOfSyncState->publish();
+    batch->newDesired = hwOutOfSyncState;
+  }
+
+  auto oldState = batch->oldApplied;
+  auto newState = batch->newDesired;
+  if (newState == oldState) {
+    // Nothing changed
+    finishBatch(std::move(batch), oldState, ApplyUpdateTimes());
+    return;
+  }
+  if (!FLAGS_pipeline_state_updates || !hwUpdateThread_) {
+    ApplyUpdateTimes times;
+    auto newAppliedState = applyUpdate(oldState, newState, &times);
+    finishBatch(std::move(batch), newAppliedState, times);
+    return;
+  }
+
+  // The same checks as applyUpdate()
+  XLOG(INFO) << "Updating state: old_gen=" << oldState->getGeneration()
+             << " new_gen=" << newState->getGeneration();
+  DCHECK_GT(newState->getGeneration(), oldState->getGeneration());
+  if (isExiting()) {
+    finishBatch(std::move(batch), oldState, ApplyUpdateTimes());
+    return;
+  }
+  batch->hwDispatched = steady_clock::now();
+  hwBatchInFlight_ = std::move(batch);
+  hwUpdateEventBase_.runInEventBaseThread([this, oldState, newState]() {
+    auto hwApplyStart = steady_clock::now();
+    auto newAppliedState = isExiting()
+        ? oldState
+        : programHardware(StateDelta(oldState, newState));
+    auto hwApply =
+        duration_cast<microseconds>(steady_clock::now() - hwApplyStart);
+    updateEventBase_.runInEventBaseThread([this, newAppliedState, hwApply]() {
+      hwBatchApplied(newAppliedState, hwApply);
+    });
+  });
+}
+
+void SwSwitch::hwBatchApplied(
+    std::shared_ptr<SwitchState> newAppliedState,
+    microseconds hwApply) {
+  DCHECK(hwBatchInFlight_);
+  auto batch = std::move(hwBatchInFlight_);
+  ApplyUpdateTimes times;
+  times.hwApply = hwApply;
+  if (!isExiting()) {
+    auto observersStart = steady_clock::now();
+    publishUpdate(
+        StateDelta(batch->oldApplied, batch->newDesired), newAppliedState);
+    auto end = steady_clock::now();
+    times.observers = duration_cast<microseconds>(end - observersStart);
+    auto duration = duration_cast<microseconds>(end - batch->hwDispatched);
+    stats()->stateUpdate(duration);
+    XLOG(DBG0) << "Update state took " << duration.count() << "us";
+  }
+  finishBatch(std::move(batch), newAppliedState, times);
+
+  // The batch computed meanwhile goes next, then whatever queued up
+  if (nextHwBatch_) {
+    applyBatch(std::move(nextHwBatch_));
+  }
+  handlePendingUpdates();
+}
+
+void SwSwitch::finishBatch(
+    std::unique_ptr<StateUpdateBatch> batch,
+    const std::shared_ptr<SwitchState>& newAppliedState,
+    const ApplyUpdateTimes& times) {
+  // There was some change during these state updates
+  if (batch->newDesired != batch->oldApplied) {
+    for (auto& timing : batch->timings) {
+      timing.hwApplyUs = times.hwApply.count();
+      timing.observersUs = times.observers.count();
+    }
     // Stick the initial applied->desired in the beginning
+    auto newDesiredState = batch->newDesired;
     bool newOutOfSync = (newAppliedState != newDesiredState);
     if (newOutOfSync) {
       // If we could not apply the whole delta successfully, put the difference
-      // as a state update at the beginning
-      queueStateUpdateForGettingHwInSync(
-          kOutOfSyncStateUpdate,
-          [newDesiredState, newAppliedState](
-              const std::shared_ptr<SwitchState>& /*oldState*/) {
-            // clone the newDesiredState and then inheritGeneration from
-            // newAppliedState otherwise the return state has a smaller gen#
-            // than the one of appliedState
-            auto hwOutOfSyncState = newDesiredState->clone();
-            hwOutOfSyncState->inheritGeneration(*newAppliedState);
-            return hwOutOfSyncState;
-          });
-      if (!isExiting() && !oldOutOfSync) {
+      // as a state update at the beginning. A batch already run on top of
+      // this one starts from the applied state by itself instead.
+      if (!nextHwBatch_) {
+        queueStateUpdateForGettingHwInSync(
+            kOutOfSyncStateUpdate,
+            [newDesiredState, newAppliedState](
+                const std::shared_ptr<SwitchState>& /*oldState*/) {
+              // clone the newDesiredState and then inheritGeneration from
+              // newAppliedState otherwise the return state has a smaller gen#
+              // than the one of appliedState
+              auto hwOutOfSyncState = newDesiredState->clone();
+              hwOutOfSyncState->inheritGeneration(*newAppliedState);
+              return hwOutOfSyncState;
+            });
+      }
+      if (!isExiting() && !batch->oldOutOfSync) {
         stats()->setHwOutOfSync();
       }
     } else {
-      if (!isExiting() && oldOutOfSync) {
+      if (!isExiting() && batch->oldOutOfSync) {
         stats()->clearHwOutOfSync();
       }
     }
   }
 
+  auto& timings = batch->timings;
+  timings.insert(
+      timings.end(), batch->failedTimings.begin(), batch->failedTimings.end());
+  recordStateUpdateTimings(timings);
+
   // Notify all of the updates of success, and delete them. Success is defined
   // as SwSwitch's attempt to apply them to hw, even though they might have not
   // actually been applied yet.
+  auto& updates = batch->updates;
   while (!updates.empty()) {
     unique_ptr<StateUpdate> update(&updates.front());
     updates.pop_front();
@@ -828,6 +1367,72 @@ void SwSwitch::handlePendingUpdates() {
   }
 }
 
+void SwSwitch::recordStateUpdateTimings(
+    const std::vector<StateUpdateTiming>& timings) {
+  for (const auto& timing : timings) {
+    stats()->stateUpdatePhases(
+        timing.name,
+        microseconds(timing.queuedUs),
+        microseconds(timing.swApplyUs),
+        microseconds(timing.hwApplyUs),
+        microseconds(timing.observersUs));
+    stateUpdateLatency_->addValue(microseconds(totalUs(timing)));
+    // The queueing time was not spent on the update thread
+    microseconds threadTime(
+        timing.swApplyUs + timing.hwApplyUs + timing.observersUs);
+    if (threadTime > slowestUpdateSinceHeartbeatTime_) {
+      slowestUpdateSinceHeartbeat_ = timing.name;
+      slowestUpdateSinceHeartbeatTime_ = threadTime;
+    }
+  }
+
+  SYNCHRONIZED(recentStateUpdates_) {
+    for (const auto& timing : timings) {
+      if (recentStateUpdates_.size() == kRecentStateUpdates) {
+        recentStateUpdates_.pop_front();
+      }
+      recentStateUpdates_.push_back(timing);
+    }
+  }
+}
+
+std::vector<StateUpdateTiming> SwSwitch::getSlowestStateUpdates(
+    size_t count) const {
+  std::vector<StateUpdateTiming> timings;
+  SYNCHRONIZED_CONST(recentStateUpdates_) {
+    timings.assign(recentStateUpdates_.begin(), recentStateUpdates_.end());
+  }
+  count = std::min(count, timings.size());
+  std::partial_sort(
+      timings.begin(),
+      timings.begin() + count,
+      timings.end(),
+      [](const StateUpdateTiming& a, const StateUpdateTiming& b) {
+        return totalUs(a) > totalUs(b);
+      });
+  timings.resize(count);
+  return timings;
+}
+
+void SwSwitch::updateThreadHeartbeat(int delayMs, int backlog) {
+  // The heartbeat runs on the update thread, so could only be late because
+  // of something else running there, most likely a state update
+  stats()->updHeartbeatDelay(delayMs);
+  stats()->updEventBacklog(backlog);
+  if (delayMs >= FLAGS_update_thread_stall_ms &&
+      !slowestUpdateSinceHeartbeat_.empty()) {
+    XLOG(WARNING) << "Update thread heartbeat was " << delayMs
+                  << "ms late, slowest state update since the last one was \""
+                  << slowestUpdateSinceHeartbeat_ << "\" taking "
+                  << duration_cast<milliseconds>(
+                         slowestUpdateSinceHeartbeatTime_)
+                         .count()
+                  << "ms";
+  }
+  slowestUpdateSinceHeartbeat_.clear();
+  slowestUpdateSinceHeartbeatTime_ = microseconds(0);
+}
+
 int SwSwitch::getHighresSamplers(HighresSamplerList* samplers,
                                  const set<CounterRequest>& counters) {
   int numCountersAdded = 0;
@@ -875,26 +1480,29 @@ void SwSwitch::setStateInternal(
     std::shared_ptr<SwitchState> newAppliedState,
     std::shared_ptr<SwitchState> newDesiredState) {
   // This is one of the only two places that should ever directly access
-  // stateDontUseDirectly_.  (getState() being the other one.)
+  // statesDontUseDirectly_.  (setDesiredState() being the other one.)
   CHECK(bool(newAppliedState));
   CHECK(bool(newDesiredState));
   CHECK(newAppliedState->isPublished());
   CHECK(newDesiredState->isPublished());
-  folly::SpinLockGuard guard(stateLock_);
-  appliedStateDontUseDirectly_.swap(newAppliedState);
-  desiredStateDontUseDirectly_.swap(newDesiredState);
+  statesDontUseDirectly_.store(std::make_shared<const States>(
+      States{std::move(newAppliedState), std::move(newDesiredState)}));
 }
 
 void SwSwitch::setDesiredState(std::shared_ptr<SwitchState> newDesiredState) {
   CHECK(bool(newDesiredState));
   CHECK(newDesiredState->isPublished());
-  folly::SpinLockGuard guard(stateLock_);
-  desiredStateDontUseDirectly_.swap(newDesiredState);
+  // Only the update thread publishes states, so nothing can change the
+  // applied state between our load and store
+  auto states = statesDontUseDirectly_.load();
+  statesDontUseDirectly_.store(std::make_shared<const States>(
+      States{states->applied, std::move(newDesiredState)}));
 }
 
 std::shared_ptr<SwitchState> SwSwitch::applyUpdate(
     const shared_ptr<SwitchState>& oldState,
-    const shared_ptr<SwitchState>& newState) {
+    const shared_ptr<SwitchState>& newState,
+    ApplyUpdateTimes* times) {
   // Check that we are starting from what has been already applied
   DCHECK_EQ(oldState, getAppliedState());
 
@@ -910,22 +1518,48 @@ std::shared_ptr<SwitchState> SwSwitch::applyUpdate(
     return oldState;
   }
 
-  std::shared_ptr<SwitchState> newAppliedState;
-
   // Inform the HwSwitch of the change.
   //
-  // Note that at this point we have already updated the state pointer and
-  // released stateLock_, so the new state is already published and visible to
-  // other threads.  This does mean that there is a window where the new state
-  // is visible but the hardware is not using the new configuration yet.
+  // Note that at this point we have already updated the state pointer, so
+  // the new state is already published and visible to other threads.  This
+  // does mean that there is a window where the new state is visible but the
+  // hardware is not using the new configuration yet.
   //
   // We could avoid this by holding a lock and block anyone from reading the
   // state while we update the hardware.  However, updating the hardware may
   // take a non-trivial amount of time, and blocking other users seems
   // undesirable.  So far I don't think this brief discrepancy should cause
   // major issues.
+  auto hwApplyStart = std::chrono::steady_clock::now();
+  auto newAppliedState = programHardware(delta);
+  auto hwApplyEnd = std::chrono::steady_clock::now();
+
+  publishUpdate(delta, newAppliedState);
+
+  auto end = std::chrono::steady_clock::now();
+  auto duration =
+    std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  stats()->stateUpdate(duration);
+  if (times) {
+    times->hwApply = duration_cast<microseconds>(hwApplyEnd - hwApplyStart);
+    times->observers = duration_cast<microseconds>(end - hwApplyEnd);
+  }
+  XLOG(DBG0) << "Update state took " << duration.count() << "us";
+  return newAppliedState;
+}
+
+std::shared_ptr<SwitchState> SwSwitch::programHardware(
+    const StateDelta& delta) {
+  const auto& newState = delta.newState();
+  std::shared_ptr<SwitchState> newAppliedState;
   try {
+    AllocationScope allocScope(AllocationPath::HW_STATE_CHANGED, stats());
+    FBOSS_TRACEPOINT(hw_state_changed_begin, newState->getGeneration());
     newAppliedState = hw_->stateChanged(delta);
+    FBOSS_TRACEPOINT(
+        hw_state_changed_end,
+        newState->getGeneration(),
+        newAppliedState == newState);
   } catch (const std::exception& ex) {
     // Notify the hw_ of the crash so it can execute any device specific
     // tasks before we fatal. An example would be to dump the current hw state.
@@ -935,21 +1569,19 @@ std::shared_ptr<SwitchState> SwSwitch::applyUpdate(
     XLOG(FATAL) << "error applying state change to hardware: "
                 << folly::exceptionStr(ex);
   }
+  return newAppliedState;
+}
 
-  setStateInternal(newAppliedState, newState);
+void SwSwitch::publishUpdate(
+    const StateDelta& delta,
+    std::shared_ptr<SwitchState> newAppliedState) {
+  setStateInternal(std::move(newAppliedState), delta.newState());
 
   // Notifies all observers of the current state update. We notify them that
   // the state changed to "desired state", even if the whole state might not
   // have been applied yet. If an observer wants to know the applied state,
   // they can query the SwSwitch about it.
   notifyStateObservers(delta);
-
-  auto end = std::chrono::steady_clock::now();
-  auto duration =
-    std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  stats()->stateUpdate(duration);
-  XLOG(DBG0) << "Update state took " << duration.count() << "us";
-  return newAppliedState;
 }
 
 PortStats* SwSwitch::portStats(PortID portID) {
@@ -1005,8 +1637,9 @@ void SwSwitch::setPortStatusCounter(PortID port, bool up) {
 
 void SwSwitch::packetReceived(std::unique_ptr<RxPacket> pkt) noexcept {
   PortID port = pkt->getSrcPort();
+  FBOSS_TRACEPOINT(pkt_rx, static_cast<int32_t>(port), pkt->getLength());
   try {
-    handlePacket(std::move(pkt));
+    handlePacket(std::move(pkt), rxDispatcher_.get());
   } catch (const std::exception& ex) {
     portStats(port)->pktError();
     XLOG(ERR) << "error processing trapped packet: " << folly::exceptionStr(ex);
@@ -1017,10 +1650,12 @@ void SwSwitch::packetReceived(std::unique_ptr<RxPacket> pkt) noexcept {
 
 void SwSwitch::packetReceivedThrowExceptionOnError(
     std::unique_ptr<RxPacket> pkt) {
-  handlePacket(std::move(pkt));
+  handlePacket(std::move(pkt), nullptr);
 }
 
-void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
+void SwSwitch::handlePacket(
+    std::unique_ptr<RxPacket> pkt,
+    RxPacketDispatcher* dispatcher) {
   // If we are not fully initialized or are already exiting, don't handle
   // packets since the individual handlers, h/w sdk data structures
   // may not be ready or may already be (partially) destroyed
@@ -1040,16 +1675,10 @@ void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
     return;
   }
 
-  // Parse the source and destination MAC, as well as the ethertype.
   Cursor c(pkt->buf());
-  auto dstMac = PktUtil::readMac(&c);
-  auto srcMac = PktUtil::readMac(&c);
-  auto ethertype = c.readBE<uint16_t>();
-  if (ethertype == 0x8100) {
-    // 802.1Q
-    c += 2; // Advance over the VLAN tag.  We ignore it for now
-    ethertype = c.readBE<uint16_t>();
-  }
+  folly::MacAddress dstMac;
+  folly::MacAddress srcMac;
+  auto ethertype = parseEthernetHeader(&c, &dstMac, &srcMac);
 
   if (distributionServiceReady_.load()) {
     publishRxPacket(pkt.get(), ethertype);
@@ -1064,6 +1693,56 @@ void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
              << " src=" << srcMac << " dst=" << dstMac << " ethertype=0x"
              << std::hex << ethertype << " :: " << pkt->describeDetails();
 
+  if (!cpuAclFilter_->permits(*pkt, ethertype, dstMac, c)) {
+    portStats(port)->pktAclDropped();
+    return;
+  }
+
+  ControlPlanePolicer::Class policerClass;
+  if (cpuPolicer_ &&
+      !cpuPolicer_->admit(*pkt, ethertype, srcMac, c, &policerClass)) {
+    portStats(port)->pktPolicerDropped(policerClass);
+    return;
+  }
+
+  if (dispatcher) {
+    dispatcher->dispatch(classifyRxPacket(*pkt, ethertype), std::move(pkt));
+    return;
+  }
+  handlePacketByEthertype(std::move(pkt), dstMac, srcMac, ethertype, c);
+}
+
+void SwSwitch::handleDispatchedPacket(std::unique_ptr<RxPacket> pkt) noexcept {
+  if (!isFullyInitialized()) {
+    return;
+  }
+  PortID port = pkt->getSrcPort();
+  try {
+    // handlePacket() already validated the header, only parse it again
+    Cursor c(pkt->buf());
+    folly::MacAddress dstMac;
+    folly::MacAddress srcMac;
+    auto ethertype = parseEthernetHeader(&c, &dstMac, &srcMac);
+    handlePacketByEthertype(std::move(pkt), dstMac, srcMac, ethertype, c);
+  } catch (const std::exception& ex) {
+    portStats(port)->pktError();
+    XLOG(ERR) << "error processing trapped packet: " << folly::exceptionStr(ex);
+  }
+}
+
+void SwSwitch::handlePacketByEthertype(
+    std::unique_ptr<RxPacket> pkt,
+    folly::MacAddress dstMac,
+    folly::MacAddress srcMac,
+    uint16_t ethertype,
+    Cursor c) {
+  auto start = steady_clock::now();
+  SCOPE_EXIT {
+    rxPacketLatency_->addValue(
+        duration_cast<microseconds>(steady_clock::now() - start));
+  };
+  PortID port = pkt->getSrcPort();
+  AllocationScope allocScope(AllocationPath::RX_PACKET_HANDLER, stats());
   switch (ethertype) {
   case ArpHandler::ETHERTYPE_ARP:
     arp_->handlePacket(std::move(pkt), dstMac, srcMac, c);
@@ -1113,21 +1792,61 @@ void SwSwitch::linkStateChanged(PortID portId, bool up) {
     return;
   }
 
-  // Schedule an update for port's operational status
-  auto updateOperStateFn = [=](const std::shared_ptr<SwitchState>& state) {
-    std::shared_ptr<SwitchState> newState(state);
-    auto* port = newState->getPorts()->getPortIf(portId).get();
-    if (not port) {
-      throw FbossError("Port ", portId, " doesn't exists in SwitchState.");
+  // Schedule an update for port's operational status, unless one is
+  // already pending that the change can be folded into. Changes arriving
+  // while that update waits in the queue then all go out in a single
+  // StateDelta. A change undoing one already in the batch starts a new
+  // batch instead, so that a flap still shows up as down and then up.
+  std::shared_ptr<LinkStateBatch> batch;
+  {
+    std::lock_guard<std::mutex> g(linkStateBatchLock_);
+    if (linkStateBatch_) {
+      auto it = linkStateBatch_->ports.find(portId);
+      if (it == linkStateBatch_->ports.end() || it->second == up) {
+        linkStateBatch_->ports[portId] = up;
+      } else {
+        linkStateBatch_.reset();
+      }
+    }
+    if (!linkStateBatch_) {
+      batch = std::make_shared<LinkStateBatch>();
+      batch->ports.emplace(portId, up);
+      linkStateBatch_ = batch;
     }
+  }
 
-    port = port->modify(&newState);
-    port->setOperState(up);
+  if (batch) {
+    auto updateOperStateFn = [this, batch](
+                                 const std::shared_ptr<SwitchState>& state) {
+      boost::container::flat_map<PortID, bool> ports;
+      {
+        // Close the batch, later changes go into a new update
+        std::lock_guard<std::mutex> g(linkStateBatchLock_);
+        if (linkStateBatch_ == batch) {
+          linkStateBatch_.reset();
+        }
+        ports = batch->ports;
+      }
 
-    return newState;
-  };
-  updateStateNoCoalescing(
-      "Port OperState Update", std::move(updateOperStateFn));
+      std::shared_ptr<SwitchState> newState(state);
+      for (const auto& portAndUp : ports) {
+        auto* port = newState->getPorts()->getPortIf(portAndUp.first).get();
+        if (not port) {
+          XLOG(ERR) << "Port " << portAndUp.first
+                    << " doesn't exist in SwitchState, ignoring its "
+                    << "link state change";
+          continue;
+        }
+        port = port->modify(&newState);
+        port->setOperState(portAndUp.second);
+      }
+      return newState;
+    };
+    updateStateNoCoalescing(
+        "Port OperState Update",
+        std::move(updateOperStateFn),
+        StateUpdate::Priority::LINK_STATE);
+  }
 
   // Log event and update counters
   logLinkStateEvent(portId, up);
@@ -1136,12 +1855,23 @@ void SwSwitch::linkStateChanged(PortID portId, bool up) {
 }
 
 void SwSwitch::startThreads() {
+  if (rxDispatcher_) {
+    rxDispatcher_->start();
+  }
   backgroundThread_.reset(new std::thread(
       [=] { this->threadLoop("fbossBgThread", &backgroundEventBase_); }));
   updateThread_.reset(new std::thread(
       [=] { this->threadLoop("fbossUpdateThread", &updateEventBase_); }));
+  if (FLAGS_pipeline_state_updates) {
+    hwUpdateThread_.reset(new std::thread([=] {
+      this->threadLoop("fbossHwUpdateThread", &hwUpdateEventBase_);
+    }));
+  }
   packetTxThread_.reset(new std::thread(
       [=] { this->threadLoop("fbossPktTxThread", &packetTxEventBase_); }));
+  if (txBatcher_) {
+    txBatcher_->start();
+  }
   pcapDistributionThread_.reset(new std::thread([=] {
     this->threadLoop(
         "fbossPcapDistributionThread", &pcapDistributionEventBase_);
@@ -1150,12 +1880,18 @@ void SwSwitch::startThreads() {
       [=] { this->threadLoop("fbossQsfpCacheThread", &qsfpCacheEventBase_); }));
   lacpThread_.reset(new std::thread(
       [=] { this->threadLoop("fbossLacpThread", &lacpEventBase_); }));
-  neighborCacheThread_.reset(new std::thread([=] {
-    this->threadLoop("fbossNeighborCacheThread", &neighborCacheEventBase_);
-  }));
+  for (size_t i = 0; i < neighborCacheThreads_.size(); ++i) {
+    auto* evb = &neighborCacheThreads_[i]->evb;
+    auto name = folly::to<std::string>("fbossNbrCache", i);
+    neighborCacheThreads_[i]->thread.reset(new std::thread(
+        [this, name, evb] { this->threadLoop(name, evb); }));
+  }
 }
 
 void SwSwitch::stopThreads() {
+  if (rxDispatcher_) {
+    rxDispatcher_->stop();
+  }
   // We use runInEventBaseThread() to terminateLoopSoon() rather than calling it
   // directly here.  This ensures that any events already scheduled via
   // runInEventBaseThread() will have a chance to run.
@@ -1166,15 +1902,28 @@ void SwSwitch::stopThreads() {
     backgroundEventBase_.runInEventBaseThread(
         [this] { backgroundEventBase_.terminateLoopSoon(); });
   }
+  if (hwUpdateThread_) {
+    // Stopped ahead of the update thread, so that it still gets to run the
+    // completions of the batches programmed until now
+    hwUpdateEventBase_.runInEventBaseThread(
+        [this] { hwUpdateEventBase_.terminateLoopSoon(); });
+    hwUpdateThread_->join();
+  }
   if (updateThread_) {
     updateEventBase_.runInEventBaseThread(
         [this] { updateEventBase_.terminateLoopSoon(); });
   }
+  if (txBatcher_) {
+    // Flushes whatever is still queued
+    txBatcher_->stop();
+  }
   if (packetTxThread_) {
     packetTxEventBase_.runInEventBaseThread(
         [this] { packetTxEventBase_.terminateLoopSoon(); });
   }
   if (pcapDistributionThread_) {
+    // Hand the last batch to the distribution thread before stopping it
+    pcapPublisher_->flush();
     pcapDistributionEventBase_.runInEventBaseThread(
         [this] { pcapDistributionEventBase_.terminateLoopSoon(); });
   }
@@ -1186,9 +1935,11 @@ void SwSwitch::stopThreads() {
     lacpEventBase_.runInEventBaseThread(
         [this] { lacpEventBase_.terminateLoopSoon(); });
   }
-  if (neighborCacheThread_) {
-    neighborCacheEventBase_.runInEventBaseThread(
-        [this] { neighborCacheEventBase_.terminateLoopSoon(); });
+  for (auto& neighborCacheThread : neighborCacheThreads_) {
+    if (neighborCacheThread->thread) {
+      auto* evb = &neighborCacheThread->evb;
+      evb->runInEventBaseThread([evb] { evb->terminateLoopSoon(); });
+    }
   }
   if (backgroundThread_) {
     backgroundThread_->join();
@@ -1208,8 +1959,10 @@ void SwSwitch::stopThreads() {
   if (lacpThread_) {
     lacpThread_->join();
   }
-  if (neighborCacheThread_) {
-    neighborCacheThread_->join();
+  for (auto& neighborCacheThread : neighborCacheThreads_) {
+    if (neighborCacheThread->thread) {
+      neighborCacheThread->thread->join();
+    }
   }
 }
 
@@ -1238,6 +1991,10 @@ std::unique_ptr<TxPacket> SwSwitch::allocateL3TxPacket(uint32_t l3Len) {
 void SwSwitch::sendPacketOutOfPortAsync(std::unique_ptr<TxPacket> pkt,
                                         PortID portID,
                                         folly::Optional<uint8_t> cos) noexcept {
+  FBOSS_TRACEPOINT(
+      pkt_tx,
+      static_cast<int32_t>(portID),
+      pkt->buf()->computeChainDataLength());
   pcapMgr_->packetSent(pkt.get());
 
   Cursor c(pkt->buf());
@@ -1255,6 +2012,10 @@ void SwSwitch::sendPacketOutOfPortAsync(std::unique_ptr<TxPacket> pkt,
     publishTxPacket(pkt.get(), ethertype);
   }
 
+  if (txBatcher_) {
+    txBatcher_->send(std::move(pkt), portID, cos);
+    return;
+  }
   if (!hw_->sendPacketOutOfPortAsync(std::move(pkt), portID, cos)) {
     // Just log an error for now.  There's not much the caller can do about
     // send failures--even on successful return from sendPacket*() the
@@ -1264,6 +2025,23 @@ void SwSwitch::sendPacketOutOfPortAsync(std::unique_ptr<TxPacket> pkt,
   }
 }
 
+void SwSwitch::sendPacketBatch(
+    PortID portID,
+    folly::Optional<uint8_t> cos,
+    std::vector<std::unique_ptr<TxPacket>> pkts,
+    std::chrono::steady_clock::time_point oldestQueued) noexcept {
+  auto numPkts = pkts.size();
+  stats()->txBatch(
+      numPkts,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - oldestQueued));
+  if (!hw_->sendPacketsOutOfPortAsync(std::move(pkts), portID, cos)) {
+    // As above, all we can do is log it
+    XLOG(ERR) << "failed to send " << numPkts << " packets out port "
+              << portID;
+  }
+}
+
 void SwSwitch::sendPacketOutOfPortAsync(
     std::unique_ptr<TxPacket> pkt,
     AggregatePortID aggPortID) noexcept {
@@ -1306,6 +2084,7 @@ void SwSwitch::sendPacketOutOfPortAsync(
 }
 
 void SwSwitch::sendPacketSwitchedAsync(std::unique_ptr<TxPacket> pkt) noexcept {
+  FBOSS_TRACEPOINT(pkt_tx, -1, pkt->buf()->computeChainDataLength());
   pcapMgr_->packetSent(pkt.get());
   if (!hw_->sendPacketSwitchedAsync(std::move(pkt))) {
     // Just log an error for now.  There's not much the caller can do about
@@ -1437,7 +2216,7 @@ void SwSwitch::sendL3Packet(
       if (dstAddr.isV6()) {
         ipv6_->sendMulticastNeighborSolicitations(PortID(0), dstAddr.asV6());
       } else {
-        ipv4_->resolveMac(state.get(), PortID(0), dstAddr.asV4());
+        ipv4_->resolveMac(state, PortID(0), dstAddr.asV4());
       }
     }
 
@@ -1470,16 +2249,43 @@ bool SwSwitch::sendPacketToHost(
   }
 }
 
+bool SwSwitch::admitIcmpError(
+    PortID port,
+    folly::MacAddress srcMac,
+    const folly::IPAddress& srcIp) {
+  return !cpuPolicer_ || cpuPolicer_->admitIcmpError(port, srcMac, srcIp);
+}
+
 void SwSwitch::applyConfig(const std::string& reason, bool reload) {
+  applyConfigImpl(reason, reload, false);
+}
+
+void SwSwitch::applyReachabilityConfig(const std::string& reason) {
+  applyConfigImpl(reason, false, true);
+}
+
+void SwSwitch::applyConfigImpl(
+    const std::string& reason,
+    bool reload,
+    bool reachabilityOnly) {
   // We don't need to hold a lock here. updateStateBlocking() does that for us.
   updateStateBlocking(
       reason,
       [&](const shared_ptr<SwitchState>& state) -> shared_ptr<SwitchState> {
         auto target = reload ? platform_->reloadConfig() : platform_->config();
 
-        const auto& newConfig = target->thrift.sw;
-        auto newState =
-          applyThriftConfig(state, &newConfig, platform_.get(), &curConfig_);
+        cfg::SwitchConfig reducedConfig;
+        if (reachabilityOnly) {
+          reducedConfig = reachabilityConfig(target->thrift.sw);
+        }
+        const auto& newConfig =
+            reachabilityOnly ? reducedConfig : target->thrift.sw;
+        auto newState = applyThriftConfig(
+            state,
+            &newConfig,
+            platform_.get(),
+            &curConfig_,
+            appliedConfigCache_.get());
 
         if (!newState) {
           // if config is not updated, the new state will return null
@@ -1493,8 +2299,11 @@ void SwSwitch::applyConfig(const std::string& reason, bool reload) {
         }
 
         curConfig_ = newConfig;
-        curConfigStr_ = target->swConfigRaw();
-        target->dumpConfig(platform_->getRunningConfigDumpFile());
+        if (!reachabilityOnly) {
+          // The rest of the config is still to come
+          curConfigStr_ = target->swConfigRaw();
+          target->dumpConfig(platform_->getRunningConfigDumpFile());
+        }
 
         // TODO(aeckert): this should be unneeded. Remove this
         for (auto& port : *newState->getPorts()) {
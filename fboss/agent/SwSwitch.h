@@ -12,47 +12,79 @@
 #include "fboss/agent/HighresCounterUtil.h"
 #include "fboss/agent/HwSwitch.h"
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+#include "fboss/agent/state/NodeMemoryAccounting.h"
 #include "fboss/agent/state/StateUpdate.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/ThreadHeartbeat.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/agent/Utils.h"
 
+#include <boost/container/flat_map.hpp>
 #include <folly/SpinLock.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
+#include <folly/Synchronized.h>
 #include <folly/IntrusiveList.h>
 #include <folly/Range.h>
 #include <folly/ThreadLocal.h>
+#include <folly/MacAddress.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/futures/Future.h>
 #include <folly/Optional.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_set>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
+struct AppliedConfigCache;
 class ArpHandler;
+class AsyncStateObserverThread;
 class ChannelCloser;
+class DHCPRelayCache;
 class IPv4Handler;
 class IPv6Handler;
+class LatencyQuantiles;
 class LinkAggregationManager;
 class LldpManager;
+class LocalAddressCache;
+class PcapPublisher;
 class PcapPushSubscriberAsyncClient;
+class PublishedPacket;
 class PktCaptureManager;
 class Platform;
 class Port;
 class PortStats;
 class PortUpdateHandler;
 class RxPacket;
+class RxPacketDispatcher;
+class SlowPathRouteCache;
 class SwitchState;
 class SwitchStats;
 class StateDelta;
+class TxPacketBatcher;
 class NeighborUpdater;
+class NexthopToRouteCount;
+class PendingNeighborQueue;
 class RouteUpdateLogger;
+class RouteUpdateQueue;
+class RouteGracefulRestart;
+class RouteAdmissionControl;
+class RouteReplicator;
 class StateObserver;
+class StateShmPublisher;
 class TunManager;
 class MirrorManager;
+class ControlPlanePolicer;
+class CpuAclFilter;
 
 enum SwitchFlags : int {
   DEFAULT = 0,
@@ -159,6 +191,18 @@ class SwSwitch : public HwSwitch::Callback {
 
   void updateStats();
 
+  /*
+   * Memory used by the applied and desired states, by node type. Nodes
+   * shared between the two states are only counted once.
+   *
+   * This walks every node of both states, so it is too expensive to run as
+   * often as updateStats().
+   */
+  NodeMemoryAccounting getStateMemoryUsage() const;
+
+  // Export getStateMemoryUsage() as fb303 counters
+  void publishStateMemoryUsage();
+
 
   /*
    * Get a pointer to the current switch state.
@@ -212,10 +256,14 @@ class SwSwitch : public HwSwitch::Callback {
    * send a single update notification to the HwSwitch and other update
    * subscribers.  Therefore the StateUpdateFn may be called with an
    * unpublished SwitchState in some cases.
+   *
+   * Updates of a higher priority are applied before any pending updates of
+   * a lower one, see StateUpdate::Priority.
    */
   void updateState(
       folly::StringPiece name,
-      StateUpdateFn fn);
+      StateUpdateFn fn,
+      StateUpdate::Priority priority = StateUpdate::Priority::DEFAULT);
 
   /**
    * Schedule an update to the switch state.
@@ -229,7 +277,10 @@ class SwSwitch : public HwSwitch::Callback {
    * but can be used when there is an update that MUST be seen by the hw
    * implementation, even if the inverse update is immediately applied.
    */
-  void updateStateNoCoalescing(folly::StringPiece name, StateUpdateFn fn);
+  void updateStateNoCoalescing(
+      folly::StringPiece name,
+      StateUpdateFn fn,
+      StateUpdate::Priority priority = StateUpdate::Priority::DEFAULT);
 
   /*
    * A version of updateState() that doesn't return until the update has been
@@ -245,7 +296,10 @@ class SwSwitch : public HwSwitch::Callback {
    * thread, and would simply block the calling thread until the operation
    * completes.
    */
-  void updateStateBlocking(folly::StringPiece name, StateUpdateFn fn);
+  void updateStateBlocking(
+      folly::StringPiece name,
+      StateUpdateFn fn,
+      StateUpdate::Priority priority = StateUpdate::Priority::DEFAULT);
 
   /**
    * Apply config from the config file (specified in 'config' flag).
@@ -256,6 +310,13 @@ class SwSwitch : public HwSwitch::Callback {
    */
   void applyConfig(const std::string& reason, bool reload = false);
 
+  /**
+   * Apply just the reachabilityConfig() part of the config, so the switch
+   * can forward and talk to routing clients before the rest of the config
+   * is applied by applyConfig().
+   */
+  void applyReachabilityConfig(const std::string& reason);
+
   /**
    * Get a set of high resolution samplers that we can query quickly.
    *
@@ -282,11 +343,30 @@ class SwSwitch : public HwSwitch::Callback {
    * should register using this api.
    *
    * The only required method for observers is stateUpdated and observers can
-   * count on this always being called from the update thread.
-   */
-  void registerStateObserver(StateObserver* observer, const std::string name);
+   * count on this always being called from the update thread, unless they
+   * register with async set. Those are notified from a thread of their own
+   * instead, so the update thread does not wait for them, and must be
+   * unregistered before they start being destroyed.
+   */
+  void registerStateObserver(
+      StateObserver* observer,
+      const std::string name,
+      bool async = false);
   void unregisterStateObserver(StateObserver* observer);
 
+  /*
+   * Wait until the observers registered with async set have been notified
+   * of every state update so far. Blocks the update thread meanwhile, so
+   * must not be called from an async observer.
+   */
+  void waitForStateObservers();
+
+  /*
+   * How long each phase of the slowest of the recent state updates took,
+   * slowest first, at most count of them.
+   */
+  std::vector<StateUpdateTiming> getSlowestStateUpdates(size_t count) const;
+
   /*
    * Signal to the switch that initial config is applied.
    * The switch may then use this to start certain functions
@@ -310,6 +390,12 @@ class SwSwitch : public HwSwitch::Callback {
    */
   void publishStats();
 
+  /*
+   * Fold the packet counters of every thread's SwitchStats into the exported
+   * stats. Called from publishStats().
+   */
+  void publishPacketCounters();
+
   /*
    * Get the SwitchStats for the current thread.
    *
@@ -412,10 +498,13 @@ class SwSwitch : public HwSwitch::Callback {
   }
 
   /*
-   * Get the EventBase for Arp/Ndp Cache
+   * Get the EventBase for the Arp/Ndp Caches of the given VLAN. VLANs are
+   * spread over several threads, so that neighbor churn on many VLANs at once
+   * isn't all processed by a single thread.
    */
-  folly::EventBase* getNeighborCacheEvb() {
-    return &neighborCacheEventBase_;
+  folly::EventBase* getNeighborCacheEvb(VlanID vlanID) {
+    return &neighborCacheThreads_[
+        static_cast<uint16_t>(vlanID) % neighborCacheThreads_.size()]->evb;
   }
 
   /**
@@ -499,6 +588,15 @@ class SwSwitch : public HwSwitch::Callback {
    */
   bool sendPacketToHost(InterfaceID dstIfID, std::unique_ptr<RxPacket> pkt);
 
+  /**
+   * Whether an ICMP error may be generated for a packet from srcIp, received
+   * from srcMac on port, or the source is over its rate of ICMP errors.
+   */
+  bool admitIcmpError(
+      PortID port,
+      folly::MacAddress srcMac,
+      const folly::IPAddress& srcIp);
+
   /**
    * Get the ArpHandler object.
    *
@@ -529,6 +627,38 @@ class SwSwitch : public HwSwitch::Callback {
     return nUpdater_.get();
   }
 
+  /*
+   * Get the PendingNeighborQueue, holding the packets waiting for their
+   * next hop to resolve.
+   */
+  PendingNeighborQueue* getPendingNeighborQueue() {
+    return pendingNeighbors_.get();
+  }
+
+  /*
+   * Get the DHCPRelayCache, holding the DHCP relay configuration of the
+   * vlans in the current state.
+   */
+  DHCPRelayCache* getDhcpRelayCache() {
+    return dhcpRelayCache_.get();
+  }
+
+  /*
+   * Get the LocalAddressCache, indexing the addresses of the switch in the
+   * current state for the packet handlers.
+   */
+  LocalAddressCache* getLocalAddressCache() {
+    return localAddressCache_.get();
+  }
+
+  /*
+   * Get the SlowPathRouteCache, caching the next hops the packet handlers
+   * resolve for the packets trapped to the CPU.
+   */
+  SlowPathRouteCache* getSlowPathRouteCache() {
+    return slowPathRouteCache_.get();
+  }
+
   /*
    * Get the PktCaptureManager object.
    */
@@ -543,6 +673,13 @@ class SwSwitch : public HwSwitch::Callback {
     return lldpManager_.get();
   }
 
+  /*
+   * Get the NexthopToRouteCount, counting the routes through each next hop
+   */
+  NexthopToRouteCount* getNexthopToRouteCount() {
+    return nhopRouteCounts_.get();
+  }
+
   /*
    * Get the RouteUpdateLogger object
    */
@@ -550,6 +687,30 @@ class SwSwitch : public HwSwitch::Callback {
     return routeUpdateLogger_.get();
   }
 
+  /*
+   * Get the RouteUpdateQueue object, for route changes applied without
+   * blocking the caller
+   */
+  RouteUpdateQueue* getRouteUpdateQueue() {
+    return routeUpdateQueue_.get();
+  }
+
+  /*
+   * Get the RouteAdmissionControl object, which the route updates of each
+   * routing client are admitted through
+   */
+  RouteAdmissionControl* getRouteAdmissionControl() {
+    return routeAdmissionControl_.get();
+  }
+
+  /*
+   * Get the RouteGracefulRestart object, tracking the stale routes of the
+   * routing clients which are restarting
+   */
+  RouteGracefulRestart* getRouteGracefulRestart() {
+    return routeGracefulRestart_.get();
+  }
+
   LinkAggregationManager* getLagManager() {
     return lagManager_.get();
   }
@@ -610,8 +771,7 @@ class SwSwitch : public HwSwitch::Callback {
    * to h/w
    */
   std::shared_ptr<SwitchState> getAppliedState() const {
-    folly::SpinLockGuard guard(stateLock_);
-    return appliedStateDontUseDirectly_;
+    return statesDontUseDirectly_.load()->applied;
   }
 
   /*
@@ -633,10 +793,14 @@ class SwSwitch : public HwSwitch::Callback {
    *
    */
   std::shared_ptr<SwitchState> getDesiredState() const {
-    folly::SpinLockGuard guard(stateLock_);
-    return desiredStateDontUseDirectly_;
+    return statesDontUseDirectly_.load()->desired;
   }
 
+  /*
+   * Queue a copy of a packet to be sent to the distribution process.
+   * Packets are sent in batches by pcapPublisher_, and dropped rather than
+   * queued up without bound when the distribution process can't keep up.
+   */
   void publishRxPacket(RxPacket* packet, uint16_t ethertype);
   void publishTxPacket(TxPacket* packet, uint16_t ethertype);
 
@@ -654,15 +818,28 @@ class SwSwitch : public HwSwitch::Callback {
   typedef folly::IntrusiveList<StateUpdate, &StateUpdate::listHook_>
     StateUpdateList;
 
+  /*
+   * The pending updates to apply next. Must be called with
+   * pendingUpdatesLock_ held.
+   */
+  StateUpdateList* FOLLY_NULLABLE nextPendingUpdates(
+      std::chrono::steady_clock::time_point now);
+  void publishPendingUpdateCounts(
+      const std::array<size_t, StateUpdate::kNumPriorities>& counts);
+
+  void applyConfigImpl(
+      const std::string& reason,
+      bool reload,
+      bool reachabilityOnly);
+
   // Forbidden copy constructor and assignment operator
   SwSwitch(SwSwitch const &) = delete;
   SwSwitch& operator=(SwSwitch const &) = delete;
 
   std::pair<std::shared_ptr<SwitchState>, std::shared_ptr<SwitchState>>
   getStates() const {
-    folly::SpinLockGuard guard(stateLock_);
-    return std::make_pair(
-        appliedStateDontUseDirectly_, desiredStateDontUseDirectly_);
+    auto states = statesDontUseDirectly_.load();
+    return std::make_pair(states->applied, states->desired);
   }
 
   /*
@@ -680,13 +857,92 @@ class SwSwitch : public HwSwitch::Callback {
   void publishSwitchInfo(struct HwInitResult hwInitRet);
   void setSwitchRunState(SwitchRunState desiredState);
   SwitchStats* createSwitchStats();
-  void handlePacket(std::unique_ptr<RxPacket> pkt);
+  /*
+   * Handle a received packet. If dispatcher is non-null, the protocol
+   * handlers run on its worker threads (see handleDispatchedPacket()),
+   * otherwise they run inline.
+   */
+  void handlePacket(
+      std::unique_ptr<RxPacket> pkt,
+      RxPacketDispatcher* dispatcher);
+  void handleDispatchedPacket(std::unique_ptr<RxPacket> pkt) noexcept;
+  void handlePacketByEthertype(
+      std::unique_ptr<RxPacket> pkt,
+      folly::MacAddress dstMac,
+      folly::MacAddress srcMac,
+      uint16_t ethertype,
+      folly::io::Cursor c);
+  /*
+   * Hand a batch of packets queued by txBatcher_ to the hardware.
+   */
+  void sendPacketBatch(
+      PortID portID,
+      folly::Optional<uint8_t> cos,
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      std::chrono::steady_clock::time_point oldestQueued) noexcept;
+  /*
+   * Send a batch of packets queued by pcapPublisher_ to the distribution
+   * process.
+   */
+  folly::Future<folly::Unit> sendPcapBatch(std::vector<PublishedPacket> pkts);
 
   static void handlePendingUpdatesHelper(SwSwitch* sw);
   void handlePendingUpdates();
+  // How long applyUpdate() spent in each of its phases
+  struct ApplyUpdateTimes {
+    std::chrono::microseconds hwApply{0};
+    std::chrono::microseconds observers{0};
+  };
   std::shared_ptr<SwitchState> applyUpdate(
       const std::shared_ptr<SwitchState>& oldState,
-      const std::shared_ptr<SwitchState>& newState);
+      const std::shared_ptr<SwitchState>& newState,
+      ApplyUpdateTimes* times = nullptr);
+  /*
+   * The two halves of applyUpdate(): handing the delta to the HwSwitch, and
+   * publishing the resulting states to the rest of the agent. Only the
+   * latter has to run on the update thread.
+   */
+  std::shared_ptr<SwitchState> programHardware(const StateDelta& delta);
+  void publishUpdate(
+      const StateDelta& delta,
+      std::shared_ptr<SwitchState> newAppliedState);
+
+  /*
+   * A batch of state updates pulled off the queues together, with the new
+   * desired state computed by running them.
+   */
+  struct StateUpdateBatch {
+    ~StateUpdateBatch();
+    StateUpdateList updates;
+    // The timings of the updates which made it to the hardware, and of those
+    // which failed and were dropped
+    std::vector<StateUpdateTiming> timings;
+    std::vector<StateUpdateTiming> failedTimings;
+    // The state the updates were run on, and the one they produced
+    std::shared_ptr<SwitchState> base;
+    std::shared_ptr<SwitchState> newDesired;
+    // The applied state the hardware is programmed from, and whether it
+    // differed from the desired state then
+    std::shared_ptr<SwitchState> oldApplied;
+    bool oldOutOfSync{false};
+    std::chrono::steady_clock::time_point hwDispatched;
+  };
+  void runStateUpdates(StateUpdateBatch* batch,
+                       std::chrono::steady_clock::time_point pickedUp);
+  // Apply the new desired state of batch to the hardware, then finish it.
+  // With --pipeline_state_updates, the hardware part runs on the hw update
+  // thread and this returns right away.
+  void applyBatch(std::unique_ptr<StateUpdateBatch> batch);
+  void hwBatchApplied(
+      std::shared_ptr<SwitchState> newAppliedState,
+      std::chrono::microseconds hwApply);
+  // Get the hardware back in sync if needed and notify the updates of batch
+  void finishBatch(
+      std::unique_ptr<StateUpdateBatch> batch,
+      const std::shared_ptr<SwitchState>& newAppliedState,
+      const ApplyUpdateTimes& times);
+  void recordStateUpdateTimings(const std::vector<StateUpdateTiming>& timings);
+  void updateThreadHeartbeat(int delayMs, int backlog);
 
   void startThreads();
   void stopThreads();
@@ -698,7 +954,10 @@ class SwSwitch : public HwSwitch::Callback {
    * called from the update thread, if the update thread is running.
    */
   bool stateObserverRegistered(StateObserver* observer);
-  void addStateObserver(StateObserver* observer, const std::string& name);
+  void addStateObserver(
+      StateObserver* observer,
+      const std::string& name,
+      bool async);
   void removeStateObserver(StateObserver* observer);
 
   /*
@@ -724,6 +983,9 @@ class SwSwitch : public HwSwitch::Callback {
 
   std::string curConfigStr_;
   cfg::SwitchConfig curConfig_;
+  // The state built from the last config applied, to skip the config sections
+  // which don't change
+  std::unique_ptr<AppliedConfigCache> appliedConfigCache_;
 
   // The HwSwitch object.  This object is owned by the Platform.
   HwSwitch* hw_;
@@ -737,10 +999,17 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<TunManager> tunMgr_;
 
   /*
-   * A list of pending state updates to be applied.
+   * The pending state updates to be applied, one list per priority.
    */
   folly::SpinLock pendingUpdatesLock_;
-  StateUpdateList pendingUpdates_;
+  std::array<StateUpdateList, StateUpdate::kNumPriorities> pendingUpdates_;
+  std::array<size_t, StateUpdate::kNumPriorities> pendingUpdateCounts_{};
+  /*
+   * The updates which bring the hardware back in sync with the desired
+   * state. These start from the applied state, so go ahead of any other
+   * update, whatever its priority.
+   */
+  StateUpdateList pendingHwSyncUpdates_;
 
   /*
    * The current switch state: modelled as two states:
@@ -754,9 +1023,13 @@ class SwSwitch : public HwSwitch::Callback {
    * short amounts of time when state is being applied, but otherwise should be
    * the same.
    *
+   * Both are published together as one immutable snapshot, so readers always
+   * see a matching pair, and never take a lock: getting the states is just an
+   * atomic load of the snapshot. Only the update thread (or init(), before it
+   * starts) publishes new snapshots.
+   *
    * BEWARE: You generally shouldn't access these states directly, even
-   * internally within SwSwitch private methods.  These should only be accessed
-   * while holding stateLock_.
+   * internally within SwSwitch private methods.
    *
    * You almost certainly should call getAppliedState() or getDesiredState() or
    * setStateInternal() instead of directly accessing these.
@@ -764,9 +1037,12 @@ class SwSwitch : public HwSwitch::Callback {
    * This intentionally has an awkward name so people won't forget and try to
    * directly access this pointer.
    */
-  std::shared_ptr<SwitchState> appliedStateDontUseDirectly_;
-  std::shared_ptr<SwitchState> desiredStateDontUseDirectly_;
-  mutable folly::SpinLock stateLock_;
+  struct States {
+    std::shared_ptr<SwitchState> applied;
+    std::shared_ptr<SwitchState> desired;
+  };
+  folly::atomic_shared_ptr<const States> statesDontUseDirectly_{
+      std::make_shared<const States>()};
 
   /*
    * A thread for performing various background tasks.
@@ -775,6 +1051,13 @@ class SwSwitch : public HwSwitch::Callback {
   folly::EventBase backgroundEventBase_;
   std::unique_ptr<ThreadHeartbeat> bgThreadHeartbeat_;
 
+  /*
+   * Batches packets sent out of a port, flushed from the packet TX thread.
+   * Null if every packet is handed to the hardware on its own.
+   * Declared before packetTxEventBase_ so that it outlives it.
+   */
+  std::unique_ptr<TxPacketBatcher> txBatcher_;
+
   /*
    * A thread for processing packets received from
    * host (linux) that may need to be sent out of
@@ -784,6 +1067,13 @@ class SwSwitch : public HwSwitch::Callback {
   folly::EventBase packetTxEventBase_;
   std::unique_ptr<ThreadHeartbeat> packetTxThreadHeartbeat_;
 
+  /*
+   * Batches packets sent to the distribution process, sent from the
+   * distribution thread. Declared before pcapDistributionEventBase_ so that it
+   * outlives it.
+   */
+  std::unique_ptr<PcapPublisher> pcapPublisher_;
+
   /*
    * A thread for sending packets to the distribution process
    */
@@ -796,6 +1086,10 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<std::thread> qsfpCacheThread_;
   folly::EventBase qsfpCacheEventBase_;
 
+  // See hwUpdateThread_
+  std::unique_ptr<StateUpdateBatch> hwBatchInFlight_;
+  std::unique_ptr<StateUpdateBatch> nextHwBatch_;
+
   /*
    * A thread for processing SwitchState updates.
    */
@@ -803,6 +1097,34 @@ class SwSwitch : public HwSwitch::Callback {
   folly::EventBase updateEventBase_;
   std::unique_ptr<ThreadHeartbeat> updThreadHeartbeat_;
 
+  /*
+   * With --pipeline_state_updates, a thread running HwSwitch::stateChanged()
+   * for one batch of state updates, while the update thread runs the update
+   * functions of the next one. Everything else about a batch, publishing its
+   * states, notifying the observers and the updates, stays on the update
+   * thread, in batch order.
+   *
+   * The batch being programmed and the one computed on top of its desired
+   * state, waiting for the hardware, are only accessed from the update
+   * thread. Further updates stay queued until both are done. They are
+   * declared ahead of the threads, to outlive callbacks left on the event
+   * bases at exit.
+   */
+  std::unique_ptr<std::thread> hwUpdateThread_;
+  folly::EventBase hwUpdateEventBase_;
+
+  /*
+   * The timings of the most recent state updates, oldest first.
+   */
+  folly::Synchronized<std::deque<StateUpdateTiming>> recentStateUpdates_;
+  /*
+   * The slowest state update since the last update thread heartbeat, so a
+   * late heartbeat can be blamed on the update which held the thread up.
+   * Only accessed from the update thread.
+   */
+  std::string slowestUpdateSinceHeartbeat_;
+  std::chrono::microseconds slowestUpdateSinceHeartbeatTime_{0};
+
   /*
    * A thread dedicated to LACP processing.
    */
@@ -811,11 +1133,44 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<ThreadHeartbeat> lacpThreadHeartbeat_;
 
   /*
-   * A thread dedicated to Arp and Ndp cache entry processing.
+   * Worker threads handling received packets, one per RxPacketClass.
+   * Null if packets are handled on the thread that received them.
+   */
+  std::unique_ptr<RxPacketDispatcher> rxDispatcher_;
+
+  /*
+   * Threads dedicated to Arp and Ndp cache entry processing, each of them
+   * handling the entries of a subset of the VLANs.
+   */
+  struct NeighborCacheThread {
+    std::unique_ptr<std::thread> thread;
+    folly::EventBase evb;
+    std::unique_ptr<ThreadHeartbeat> heartbeat;
+  };
+  std::vector<std::unique_ptr<NeighborCacheThread>> neighborCacheThreads_;
+
+  /*
+   * Neighbor entries found hit by the last read of the hardware table for
+   * each VRF, and not yet reported to their NeighborCacheEntry.
+   */
+  struct NeighborHits {
+    folly::Optional<std::chrono::steady_clock::time_point> fetched;
+    std::unordered_set<folly::IPAddress> ips;
+  };
+  std::mutex neighborHitsLock_;
+  std::map<RouterID, NeighborHits> neighborHits_;
+  // Cleared if the HwSwitch can't read the hit bits of the whole table at once
+  bool bulkNeighborHits_{true};
+
+  /*
+   * The port oper state changes going into the link state update that is
+   * scheduled but hasn't run yet, if any. See linkStateChanged().
    */
-  std::unique_ptr<std::thread> neighborCacheThread_;
-  folly::EventBase neighborCacheEventBase_;
-  std::unique_ptr<ThreadHeartbeat> neighborCacheThreadHeartbeat_;
+  struct LinkStateBatch {
+    boost::container::flat_map<PortID, bool> ports;
+  };
+  std::mutex linkStateBatchLock_;
+  std::shared_ptr<LinkStateBatch> linkStateBatch_;
 
   /*
    * A callback for listening to neighbors coming and going.
@@ -831,6 +1186,9 @@ class SwSwitch : public HwSwitch::Callback {
    * locking when we access the container during a state update.
    */
   std::map<StateObserver*, std::string> stateObservers_;
+  // The threads notifying the observers registered with async set
+  std::map<StateObserver*, std::unique_ptr<AsyncStateObserverThread>>
+      asyncStateObservers_;
 
   std::unique_ptr<ChannelCloser> closer_; // must be before pcapPusher_
   std::unique_ptr<PcapPushSubscriberAsyncClient> pcapPusher_;
@@ -841,14 +1199,33 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<IPv4Handler> ipv4_;
   std::unique_ptr<IPv6Handler> ipv6_;
   std::unique_ptr<NeighborUpdater> nUpdater_;
+  std::unique_ptr<PendingNeighborQueue> pendingNeighbors_;
+  std::unique_ptr<DHCPRelayCache> dhcpRelayCache_;
+  std::unique_ptr<LocalAddressCache> localAddressCache_;
+  std::unique_ptr<SlowPathRouteCache> slowPathRouteCache_;
   std::unique_ptr<PktCaptureManager> pcapMgr_;
   std::unique_ptr<MirrorManager> mirrorManager_;
+  std::unique_ptr<CpuAclFilter> cpuAclFilter_;
+  // Null unless the --cpu_policer_* flags police something
+  std::unique_ptr<ControlPlanePolicer> cpuPolicer_;
   std::unique_ptr<RouteUpdateLogger> routeUpdateLogger_;
+  std::unique_ptr<NexthopToRouteCount> nhopRouteCounts_;
+  std::unique_ptr<RouteUpdateQueue> routeUpdateQueue_;
+  std::unique_ptr<RouteAdmissionControl> routeAdmissionControl_;
+  std::unique_ptr<RouteGracefulRestart> routeGracefulRestart_;
+  // Null unless replicating routes to other agents
+  std::unique_ptr<RouteReplicator> routeReplicator_;
+  // Null unless publishing state snapshots to shared memory
+  std::unique_ptr<StateShmPublisher> stateShmPublisher_;
   std::unique_ptr<LinkAggregationManager> lagManager_;
 
   BootType bootType_{BootType::UNINITIALIZED};
   std::unique_ptr<LldpManager> lldpManager_;
   std::unique_ptr<PortUpdateHandler> portUpdateHandler_;
+  // The latency of the state updates, from being scheduled to the observers
+  // being notified, and the time spent handling each received packet
+  std::unique_ptr<LatencyQuantiles> stateUpdateLatency_;
+  std::unique_ptr<LatencyQuantiles> rxPacketLatency_;
   SwitchFlags flags_{SwitchFlags::DEFAULT};
 };
 
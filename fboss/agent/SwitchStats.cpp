@@ -9,7 +9,11 @@
  */
 #include "fboss/agent/SwitchStats.h"
 
+#include <cctype>
+
+#include "fboss/agent/ControlPlanePolicer.h"
 #include "fboss/agent/PortStats.h"
+#include "fboss/agent/RxPacketDispatcher.h"
 #include "common/stats/ExportedStatMapImpl.h"
 #include <folly/Memory.h>
 
@@ -19,9 +23,85 @@ using facebook::stats::RATE;
 
 namespace facebook { namespace fboss {
 
+namespace {
+// State updates with names beyond the first kMaxStateUpdateNames share
+// their histograms
+constexpr size_t kMaxStateUpdateNames = 64;
+const std::string kOtherStateUpdates = "other";
+
+// Update names are free form text, make them fit in a counter name
+std::string stateUpdateCounterName(const std::string& name) {
+  std::string counterName;
+  for (auto c : name) {
+    counterName.push_back(
+        std::isalnum(static_cast<unsigned char>(c)) ? std::tolower(c) : '_');
+  }
+  return counterName;
+}
+}
+
 // set to empty string, we'll prepend prefix when fbagent collects counters
 std::string SwitchStats::kCounterPrefix = "";
 
+// In PacketCounter order
+SwitchStats::TLTimeseries SwitchStats::* const
+    SwitchStats::kPacketCounterStats[kNumPacketCounters] = {
+    &SwitchStats::trapPkts_,
+    &SwitchStats::trapPktDrops_,
+    &SwitchStats::trapPktBogus_,
+    &SwitchStats::trapPktErrors_,
+    &SwitchStats::trapPktUnhandled_,
+    &SwitchStats::trapPktToHost_,
+    &SwitchStats::trapPktToHostBytes_,
+    &SwitchStats::pktFromHost_,
+    &SwitchStats::pktFromHostBytes_,
+    &SwitchStats::trapPktArp_,
+    &SwitchStats::arpUnsupported_,
+    &SwitchStats::arpNotMine_,
+    &SwitchStats::arpRequestsRx_,
+    &SwitchStats::arpRepliesRx_,
+    &SwitchStats::arpRequestsTx_,
+    &SwitchStats::arpRepliesTx_,
+    &SwitchStats::arpBadOp_,
+    &SwitchStats::trapPktNdp_,
+    &SwitchStats::ipv6NdpBad_,
+    &SwitchStats::ipv4Rx_,
+    &SwitchStats::ipv4TooSmall_,
+    &SwitchStats::ipv4WrongVer_,
+    &SwitchStats::ipv4Nexthop_,
+    &SwitchStats::ipv4Mine_,
+    &SwitchStats::ipv4NoArp_,
+    &SwitchStats::ipv4TtlExceeded_,
+    &SwitchStats::ipv6HopExceeded_,
+    &SwitchStats::ipv4IcmpErrorSuppressed_,
+    &SwitchStats::ipv6IcmpErrorSuppressed_,
+    &SwitchStats::udpTooSmall_,
+    &SwitchStats::dhcpV4Pkt_,
+    &SwitchStats::dhcpV4BadPkt_,
+    &SwitchStats::dhcpV4DropPkt_,
+    &SwitchStats::dhcpV6Pkt_,
+    &SwitchStats::dhcpV6BadPkt_,
+    &SwitchStats::dhcpV6DropPkt_,
+    &SwitchStats::dhcpV4RelayFwd_,
+    &SwitchStats::dhcpV4RelayReply_,
+    &SwitchStats::dhcpV6RelayFwd_,
+    &SwitchStats::dhcpV6RelayReply_,
+    &SwitchStats::dstLookupFailureV4_,
+    &SwitchStats::dstLookupFailureV6_,
+    &SwitchStats::dstLookupFailure_,
+    &SwitchStats::trapPktTooBig_,
+    &SwitchStats::rxQueueDropsControl_,
+    &SwitchStats::rxQueueDropsHighPriority_,
+    &SwitchStats::rxQueueDropsArp_,
+    &SwitchStats::rxQueueDropsDefault_,
+    &SwitchStats::trapPktAclDrops_,
+    &SwitchStats::trapPktPolicerDropsArp_,
+    &SwitchStats::trapPktPolicerDropsNdp_,
+    &SwitchStats::pendingPktsQueued_,
+    &SwitchStats::pendingPktsSent_,
+    &SwitchStats::pendingPktsDropped_,
+};
+
 SwitchStats::SwitchStats()
     : SwitchStats(stats::ThreadCachedServiceData::get()->getThreadStats()) {
 }
@@ -54,6 +134,16 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
       ipv4NoArp_(map, kCounterPrefix + "ipv4.no_arp", SUM, RATE),
       ipv4TtlExceeded_(map, kCounterPrefix + "ipv4.ttl_exceeded", SUM, RATE),
       ipv6HopExceeded_(map, kCounterPrefix + "ipv6.hop_exceeded", SUM, RATE),
+      ipv4IcmpErrorSuppressed_(
+          map,
+          kCounterPrefix + "ipv4.icmp_error_suppressed",
+          SUM,
+          RATE),
+      ipv6IcmpErrorSuppressed_(
+          map,
+          kCounterPrefix + "ipv6.icmp_error_suppressed",
+          SUM,
+          RATE),
       udpTooSmall_(map, kCounterPrefix + "udp.too_small", SUM, RATE),
       dhcpV4Pkt_(map, kCounterPrefix + "dhcpV4.pkt", SUM, RATE),
       dhcpV4BadPkt_(map, kCounterPrefix + "dhcpV4.bad_pkt", SUM, RATE),
@@ -61,6 +151,36 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
       dhcpV6Pkt_(map, kCounterPrefix + "dhcpV6.pkt", SUM, RATE),
       dhcpV6BadPkt_(map, kCounterPrefix + "dhcpV6.bad_pkt", SUM, RATE),
       dhcpV6DropPkt_(map, kCounterPrefix + "dhcpV6.drop_pkt", SUM, RATE),
+      dhcpV4RelayFwd_(map, kCounterPrefix + "dhcpV4.relay_fwd", SUM, RATE),
+      dhcpV4RelayReply_(
+          map,
+          kCounterPrefix + "dhcpV4.relay_reply",
+          SUM,
+          RATE),
+      dhcpV6RelayFwd_(map, kCounterPrefix + "dhcpV6.relay_fwd", SUM, RATE),
+      dhcpV6RelayReply_(
+          map,
+          kCounterPrefix + "dhcpV6.relay_reply",
+          SUM,
+          RATE),
+      dhcpV4RelayLatency_(
+          map,
+          kCounterPrefix + "dhcpV4.relay_latency.us",
+          50,
+          0,
+          10000,
+          AVG,
+          50,
+          100),
+      dhcpV6RelayLatency_(
+          map,
+          kCounterPrefix + "dhcpV6.relay_latency.us",
+          50,
+          0,
+          10000,
+          AVG,
+          50,
+          100),
       addRouteV4_(map, kCounterPrefix + "route.v4.add", RATE),
       addRouteV6_(map, kCounterPrefix + "route.v6.add", RATE),
       delRouteV4_(map, kCounterPrefix + "route.v4.delete", RATE),
@@ -172,9 +292,28 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
           AVG,
           50,
           100),
+      txBatchSize_(
+          map,
+          kCounterPrefix + "tx_batch_size",
+          1,
+          0,
+          256,
+          AVG,
+          50,
+          100),
+      txBatchLatency_(
+          map,
+          kCounterPrefix + "tx_batch_latency.us",
+          50,
+          0,
+          10000,
+          AVG,
+          50,
+          100),
       linkStateChange_(map, kCounterPrefix + "link_state.flap", SUM),
       hwOutOfSync_(map, kCounterPrefix + "hw_out_of_sync"),
       pcapDistFailure_(map, kCounterPrefix + "pcap_dist_failure.error"),
+      pcapDistDropped_(map, kCounterPrefix + "pcap_dist_dropped", SUM),
       updateStatsExceptions_(
           map,
           kCounterPrefix + "update_stats_exceptions",
@@ -183,7 +322,163 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
           map,
           kCounterPrefix + "trapped.packet_too_big",
           SUM,
-          RATE) {}
+          RATE),
+      rxQueueDropsControl_(
+          map,
+          kCounterPrefix + "trapped.queue_drops.control",
+          SUM,
+          RATE),
+      rxQueueDropsHighPriority_(
+          map,
+          kCounterPrefix + "trapped.queue_drops.high_priority",
+          SUM,
+          RATE),
+      rxQueueDropsArp_(
+          map,
+          kCounterPrefix + "trapped.queue_drops.arp",
+          SUM,
+          RATE),
+      rxQueueDropsDefault_(
+          map,
+          kCounterPrefix + "trapped.queue_drops.default",
+          SUM,
+          RATE),
+      trapPktAclDrops_(
+          map,
+          kCounterPrefix + "trapped.acl_drops",
+          SUM,
+          RATE),
+      trapPktPolicerDropsArp_(
+          map,
+          kCounterPrefix + "trapped.policer_drops.arp",
+          SUM,
+          RATE),
+      trapPktPolicerDropsNdp_(
+          map,
+          kCounterPrefix + "trapped.policer_drops.ndp",
+          SUM,
+          RATE),
+      pendingPktsQueued_(
+          map,
+          kCounterPrefix + "trapped.pending.queued",
+          SUM,
+          RATE),
+      pendingPktsSent_(
+          map,
+          kCounterPrefix + "trapped.pending.sent",
+          SUM,
+          RATE),
+      pendingPktsDropped_(
+          map,
+          kCounterPrefix + "trapped.pending.drops",
+          SUM,
+          RATE),
+      map_(map) {}
+
+SwitchStats::StateUpdateStats::StateUpdateStats(
+    ThreadLocalStatsMap* map,
+    const std::string& prefix)
+    : queued(map, prefix + ".queued.us", 50000, 0, 1000000),
+      swApply(map, prefix + ".sw_apply.us", 50000, 0, 1000000),
+      hwApply(map, prefix + ".hw_apply.us", 50000, 0, 1000000),
+      observers(map, prefix + ".observers.us", 50000, 0, 1000000) {}
+
+SwitchStats::AllocationStats::AllocationStats(
+    ThreadLocalStatsMap* map,
+    const std::string& prefix)
+    : allocations(map, prefix + ".count", AVG),
+      bytes(map, prefix + ".bytes", AVG) {}
+
+SwitchStats::~SwitchStats() {
+  // Don't lose what the thread counted since the last publish
+  publishPacketCounters(this);
+}
+
+void SwitchStats::publishPacketCounters(SwitchStats* publisher) {
+  std::lock_guard<std::mutex> g(publishMutex_);
+  for (int i = 0; i < kNumPacketCounters; ++i) {
+    auto value = packetCounters_[i].load(std::memory_order_relaxed);
+    auto delta = value - publishedPacketCounters_[i];
+    if (delta) {
+      (publisher->*kPacketCounterStats[i]).addValue(delta);
+      publishedPacketCounters_[i] = value;
+    }
+  }
+}
+
+void SwitchStats::rxQueueDrop(RxPacketClass cls) {
+  switch (cls) {
+    case RxPacketClass::CONTROL:
+      count(kRxQueueDropsControl);
+      return;
+    case RxPacketClass::HIGH_PRIORITY:
+      count(kRxQueueDropsHighPriority);
+      return;
+    case RxPacketClass::ARP:
+      count(kRxQueueDropsArp);
+      return;
+    case RxPacketClass::DEFAULT:
+      count(kRxQueueDropsDefault);
+      return;
+  }
+}
+
+void SwitchStats::pktPolicerDropped(CpuPolicerClass cls) {
+  count(kTrapPktDrops);
+  switch (cls) {
+    case CpuPolicerClass::ARP:
+      count(kTrapPktPolicerDropsArp);
+      return;
+    case CpuPolicerClass::NDP:
+      count(kTrapPktPolicerDropsNdp);
+      return;
+    case CpuPolicerClass::ICMP_ERROR:
+      // Only policed by SwSwitch::admitIcmpError(), which drops no packet
+      return;
+  }
+}
+
+void SwitchStats::stateUpdatePhases(
+    const std::string& name,
+    std::chrono::microseconds queued,
+    std::chrono::microseconds swApply,
+    std::chrono::microseconds hwApply,
+    std::chrono::microseconds observers) {
+  auto it = stateUpdateStats_.find(name);
+  if (it == stateUpdateStats_.end()) {
+    const auto& statsName = stateUpdateStats_.size() < kMaxStateUpdateNames
+        ? name
+        : kOtherStateUpdates;
+    it = stateUpdateStats_.find(statsName);
+    if (it == stateUpdateStats_.end()) {
+      auto prefix = kCounterPrefix + "state_update." +
+          stateUpdateCounterName(statsName);
+      it = stateUpdateStats_
+               .emplace(
+                   statsName, std::make_unique<StateUpdateStats>(map_, prefix))
+               .first;
+    }
+  }
+  auto& stats = *it->second;
+  stats.queued.addValue(queued.count());
+  stats.swApply.addValue(swApply.count());
+  stats.hwApply.addValue(hwApply.count());
+  stats.observers.addValue(observers.count());
+}
+
+void SwitchStats::allocations(
+    AllocationPath path,
+    const AllocationCounts& counts) {
+  auto& stats = allocationStats_[static_cast<size_t>(path)];
+  if (!stats) {
+    stats = std::make_unique<AllocationStats>(
+        map_,
+        kCounterPrefix + "allocations." +
+            AllocationProfiler::pathName(path));
+  }
+  stats->allocations.addValue(counts.allocations);
+  stats->bytes.addValue(counts.bytes);
+}
 
 PortStats* FOLLY_NULLABLE SwitchStats::port(PortID portID) {
   auto it = ports_.find(portID);
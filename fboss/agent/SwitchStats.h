@@ -9,19 +9,28 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <boost/container/flat_map.hpp>
 #include <boost/noncopyable.hpp>
 #include "common/stats/ThreadCachedServiceData.h"
+#include "fboss/agent/AllocationProfiler.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/types.h"
+#include "fboss/agent/state/DenseIdMap.h"
 
 namespace facebook { namespace fboss {
 
 class PortStats;
+enum class RxPacketClass : uint8_t;
+enum class CpuPolicerClass : uint8_t;
 
-typedef boost::container::flat_map<PortID,
-          std::unique_ptr<PortStats>> PortStatsMap;
+// Looked up by the ID of the ingress port of every packet
+typedef DenseIdMap<PortID, std::unique_ptr<PortStats>> PortStatsMap;
 
 class SwitchStats : public boost::noncopyable {
  public:
@@ -31,6 +40,7 @@ class SwitchStats : public boost::noncopyable {
   static std::string kCounterPrefix;
 
   SwitchStats();
+  ~SwitchStats();
 
   /*
    * Return the PortStats object for the given PortID.
@@ -55,126 +65,155 @@ class SwitchStats : public boost::noncopyable {
   }
 
   void trappedPkt() {
-    trapPkts_.addValue(1);
+    count(kTrapPkts);
   }
   void pktDropped() {
-    trapPktDrops_.addValue(1);
+    count(kTrapPktDrops);
   }
   void pktBogus() {
-    trapPktBogus_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kTrapPktBogus);
+    count(kTrapPktDrops);
   }
   void pktError() {
-    trapPktErrors_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kTrapPktErrors);
+    count(kTrapPktDrops);
   }
   void pktUnhandled() {
-    trapPktUnhandled_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kTrapPktUnhandled);
+    count(kTrapPktDrops);
   }
   void pktToHost(uint32_t bytes) {
-    trapPktToHost_.addValue(1);
-    trapPktToHostBytes_.addValue(bytes);
+    count(kTrapPktToHost);
+    count(kTrapPktToHostBytes, bytes);
   }
   void pktFromHost(uint32_t bytes) {
-    pktFromHost_.addValue(1);
-    pktFromHostBytes_.addValue(bytes);
+    count(kPktFromHost);
+    count(kPktFromHostBytes, bytes);
   }
 
   void arpPkt() {
-    trapPktArp_.addValue(1);
+    count(kTrapPktArp);
   }
   void arpUnsupported() {
-    arpUnsupported_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kArpUnsupported);
+    count(kTrapPktDrops);
   }
   void arpNotMine() {
-    arpNotMine_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kArpNotMine);
+    count(kTrapPktDrops);
   }
   void arpRequestRx() {
-    arpRequestsRx_.addValue(1);
+    count(kArpRequestsRx);
   }
   void arpRequestTx() {
-    arpRequestsTx_.addValue(1);
+    count(kArpRequestsTx);
   }
   void arpReplyRx() {
-    arpRepliesRx_.addValue(1);
+    count(kArpRepliesRx);
   }
   void arpReplyTx() {
-    arpRepliesTx_.addValue(1);
+    count(kArpRepliesTx);
   }
   void arpBadOp() {
-    arpBadOp_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kArpBadOp);
+    count(kTrapPktDrops);
   }
 
   void ipv6NdpPkt() {
-    trapPktNdp_.addValue(1);
+    count(kTrapPktNdp);
   }
   void ipv6NdpBad() {
-    ipv6NdpBad_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kIpv6NdpBad);
+    count(kTrapPktDrops);
   }
 
   void dhcpV4Pkt() {
-    dhcpV4Pkt_.addValue(1);
+    count(kDhcpV4Pkt);
   }
 
   void dhcpV6Pkt() {
-    dhcpV6Pkt_.addValue(1);
+    count(kDhcpV6Pkt);
   }
 
   void ipv4Rx() {
-    ipv4Rx_.addValue(1);
+    count(kIpv4Rx);
   }
   void ipv4TooSmall() {
-    ipv4TooSmall_.addValue(1);
+    count(kIpv4TooSmall);
   }
   void ipv4WrongVer() {
-    ipv4WrongVer_.addValue(1);
+    count(kIpv4WrongVer);
   }
   void ipv4Nexthop() {
-    ipv4Nexthop_.addValue(1);
+    count(kIpv4Nexthop);
   }
   void ipv4Mine() {
-    ipv4Mine_.addValue(1);
+    count(kIpv4Mine);
   }
   void ipv4NoArp() {
-    ipv4NoArp_.addValue(1);
+    count(kIpv4NoArp);
   }
   void ipv4TtlExceeded() {
-    ipv4TtlExceeded_.addValue(1);
+    count(kIpv4TtlExceeded);
   }
 
   void ipv6HopExceeded() {
-    ipv6HopExceeded_.addValue(1);
+    count(kIpv6HopExceeded);
+  }
+
+  // ICMP error not sent as the source was over its ICMP error rate
+  void ipv4IcmpErrorSuppressed() {
+    count(kIpv4IcmpErrorSuppressed);
+  }
+  void ipv6IcmpErrorSuppressed() {
+    count(kIpv6IcmpErrorSuppressed);
   }
 
   void udpTooSmall() {
-    udpTooSmall_.addValue(1);
+    count(kUdpTooSmall);
   }
 
   void dhcpV4BadPkt() {
-    dhcpV4BadPkt_.addValue(1);
-    dhcpV4DropPkt_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kDhcpV4BadPkt);
+    count(kDhcpV4DropPkt);
+    count(kTrapPktDrops);
   }
 
   void dhcpV4DropPkt() {
-    dhcpV4DropPkt_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kDhcpV4DropPkt);
+    count(kTrapPktDrops);
   }
 
   void dhcpV6BadPkt() {
-    dhcpV6BadPkt_.addValue(1);
-    dhcpV6DropPkt_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kDhcpV6BadPkt);
+    count(kDhcpV6DropPkt);
+    count(kTrapPktDrops);
   }
 
   void dhcpV6DropPkt() {
-    dhcpV6DropPkt_.addValue(1);
-    trapPktDrops_.addValue(1);
+    count(kDhcpV6DropPkt);
+    count(kTrapPktDrops);
+  }
+
+  /*
+   * A DHCP packet was relayed, latency after it was handed to the
+   * DHCPv4Handler or DHCPv6Handler.
+   */
+  void dhcpV4RelayFwd(std::chrono::microseconds latency) {
+    count(kDhcpV4RelayFwd);
+    dhcpV4RelayLatency_.addValue(latency.count());
+  }
+  void dhcpV4RelayReply(std::chrono::microseconds latency) {
+    count(kDhcpV4RelayReply);
+    dhcpV4RelayLatency_.addValue(latency.count());
+  }
+  void dhcpV6RelayFwd(std::chrono::microseconds latency) {
+    count(kDhcpV6RelayFwd);
+    dhcpV6RelayLatency_.addValue(latency.count());
+  }
+  void dhcpV6RelayReply(std::chrono::microseconds latency) {
+    count(kDhcpV6RelayReply);
+    dhcpV6RelayLatency_.addValue(latency.count());
   }
 
   void addRouteV4() {
@@ -191,19 +230,40 @@ class SwitchStats : public boost::noncopyable {
   }
 
   void ipv4DstLookupFailure() {
-    dstLookupFailureV4_.addValue(1);
-    dstLookupFailure_.addValue(1);
+    count(kDstLookupFailureV4);
+    count(kDstLookupFailure);
   }
 
   void ipv6DstLookupFailure() {
-    dstLookupFailureV6_.addValue(1);
-    dstLookupFailure_.addValue(1);
+    count(kDstLookupFailureV6);
+    count(kDstLookupFailure);
   }
 
   void stateUpdate(std::chrono::microseconds us) {
     updateState_.addValue(us.count());
   }
 
+  /*
+   * Time a state update spent in each of its phases: waiting to be picked up
+   * by the update thread, having its function applied to the software state,
+   * having the hardware programmed, and notifying the state observers.
+   * Updates applied together are each charged the hardware and observer time
+   * of the whole batch, since that is how long they all waited for it.
+   *
+   * Kept per update name, so must only be called from the update thread.
+   */
+  void stateUpdatePhases(
+      const std::string& name,
+      std::chrono::microseconds queued,
+      std::chrono::microseconds swApply,
+      std::chrono::microseconds hwApply,
+      std::chrono::microseconds observers);
+
+  /*
+   * Heap allocations made during one sampled AllocationScope on path.
+   */
+  void allocations(AllocationPath path, const AllocationCounts& counts);
+
   void routeUpdate(std::chrono::microseconds us, uint64_t routes) {
     // As syncFib() could include no routes.
     if (routes == 0) {
@@ -236,6 +296,11 @@ class SwitchStats : public boost::noncopyable {
     bgEventBacklog_.addValue(value);
   }
 
+  void txBatch(size_t numPkts, std::chrono::microseconds queued) {
+    txBatchSize_.addValue(numPkts);
+    txBatchLatency_.addValue(queued.count());
+  }
+
   void updEventBacklog(int value) {
     updEventBacklog_.addValue(value);
   }
@@ -268,14 +333,56 @@ class SwitchStats : public boost::noncopyable {
     pcapDistFailure_.incrementValue(1);
   }
 
+  void pcapDistDropped(size_t numPkts) {
+    pcapDistDropped_.addValue(numPkts);
+  }
+
   void updateStatsException(){
     updateStatsExceptions_.addValue(1);
   }
 
   void pktTooBig() {
-    trapPktTooBig_.addValue(1);
+    count(kTrapPktTooBig);
+  }
+
+  // Trapped packet dropped because the queue for its class was full
+  void rxQueueDrop(RxPacketClass cls);
+
+  // Trapped packet dropped by a control plane acl
+  void pktAclDropped() {
+    count(kTrapPktAclDrops);
+    count(kTrapPktDrops);
   }
 
+  // Trapped packet dropped by the software control plane policer
+  void pktPolicerDropped(CpuPolicerClass cls);
+
+  // Trapped packet queued while its next hop is being resolved
+  void pendingPktQueued() {
+    count(kPendingPktsQueued);
+  }
+
+  // Queued packet sent once its next hop resolved
+  void pendingPktSent() {
+    count(kPendingPktsSent);
+  }
+
+  // Queued packets dropped because their next hop didn't resolve in time,
+  // or too many were queued for it. The trapped packets they are copies of
+  // were already counted as dropped.
+  void pendingPktDropped(size_t numPkts) {
+    count(kPendingPktsDropped, numPkts);
+  }
+
+  /*
+   * Add what has been counted on the packet path since the last call to the
+   * exported stats, through the stats of the calling thread.
+   *
+   * The packet counters are only ever written by the thread that owns this
+   * object, but this can be called from any thread.
+   */
+  void publishPacketCounters(SwitchStats* publisher);
+
  private:
   // Forbidden copy constructor and assignment operator
   SwitchStats(SwitchStats const &) = delete;
@@ -289,6 +396,82 @@ class SwitchStats : public boost::noncopyable {
 
   explicit SwitchStats(ThreadLocalStatsMap *map);
 
+  /*
+   * The counters bumped for every trapped or host packet are kept in plain
+   * per-thread integers rather than going through the TLTimeseries, so the
+   * packet path never does more than an increment.
+   * publishPacketCounters() folds them into the exported stats.
+   */
+  enum PacketCounter {
+    kTrapPkts,
+    kTrapPktDrops,
+    kTrapPktBogus,
+    kTrapPktErrors,
+    kTrapPktUnhandled,
+    kTrapPktToHost,
+    kTrapPktToHostBytes,
+    kPktFromHost,
+    kPktFromHostBytes,
+    kTrapPktArp,
+    kArpUnsupported,
+    kArpNotMine,
+    kArpRequestsRx,
+    kArpRepliesRx,
+    kArpRequestsTx,
+    kArpRepliesTx,
+    kArpBadOp,
+    kTrapPktNdp,
+    kIpv6NdpBad,
+    kIpv4Rx,
+    kIpv4TooSmall,
+    kIpv4WrongVer,
+    kIpv4Nexthop,
+    kIpv4Mine,
+    kIpv4NoArp,
+    kIpv4TtlExceeded,
+    kIpv6HopExceeded,
+    kIpv4IcmpErrorSuppressed,
+    kIpv6IcmpErrorSuppressed,
+    kUdpTooSmall,
+    kDhcpV4Pkt,
+    kDhcpV4BadPkt,
+    kDhcpV4DropPkt,
+    kDhcpV6Pkt,
+    kDhcpV6BadPkt,
+    kDhcpV6DropPkt,
+    kDhcpV4RelayFwd,
+    kDhcpV4RelayReply,
+    kDhcpV6RelayFwd,
+    kDhcpV6RelayReply,
+    kDstLookupFailureV4,
+    kDstLookupFailureV6,
+    kDstLookupFailure,
+    kTrapPktTooBig,
+    kRxQueueDropsControl,
+    kRxQueueDropsHighPriority,
+    kRxQueueDropsArp,
+    kRxQueueDropsDefault,
+    kTrapPktAclDrops,
+    kTrapPktPolicerDropsArp,
+    kTrapPktPolicerDropsNdp,
+    kPendingPktsQueued,
+    kPendingPktsSent,
+    kPendingPktsDropped,
+    kNumPacketCounters
+  };
+
+  void count(PacketCounter counter, uint64_t value = 1) {
+    // We are the only writer, so there is no need for an atomic add
+    auto& c = packetCounters_[counter];
+    c.store(c.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed);
+  }
+
+  // The TLTimeseries each PacketCounter is published to
+  static TLTimeseries SwitchStats::* const
+      kPacketCounterStats[kNumPacketCounters];
+
+
   // Total number of trapped packets
   TLTimeseries trapPkts_;
   // Number of trapped packets that were intentionally dropped.
@@ -347,6 +530,9 @@ class SwitchStats : public boost::noncopyable {
 
   // IPv6 hop count exceeded
   TLTimeseries ipv6HopExceeded_;
+  // ICMP errors rate limited by the control plane policer
+  TLTimeseries ipv4IcmpErrorSuppressed_;
+  TLTimeseries ipv6IcmpErrorSuppressed_;
 
   // UDP packets dropped due to smaller packet size
   TLTimeseries udpTooSmall_;
@@ -367,6 +553,17 @@ class SwitchStats : public boost::noncopyable {
   TLTimeseries dhcpV6Pkt_;
   TLTimeseries dhcpV6BadPkt_;
   TLTimeseries dhcpV6DropPkt_;
+  // DHCP requests relayed to the server, and replies relayed to the client
+  TLTimeseries dhcpV4RelayFwd_;
+  TLTimeseries dhcpV4RelayReply_;
+  TLTimeseries dhcpV6RelayFwd_;
+  TLTimeseries dhcpV6RelayReply_;
+  /**
+   * Time taken to relay a DHCP packet once it is handed to the DHCP
+   * handler (in microseconds)
+   */
+  TLHistogram dhcpV4RelayLatency_;
+  TLHistogram dhcpV6RelayLatency_;
 
   /**
    * Routes add/delete stats
@@ -434,6 +631,16 @@ class SwitchStats : public boost::noncopyable {
    */
   TLHistogram neighborCacheEventBacklog_;
 
+  /**
+   * Number of packets per batch sent out of a port
+   */
+  TLHistogram txBatchSize_;
+  /**
+   * Time the oldest packet of a batch spent queued before the batch was
+   * handed to the hardware (in microseconds)
+   */
+  TLHistogram txBatchLatency_;
+
   /**
    * Link state up/down change count
    */
@@ -451,11 +658,64 @@ class SwitchStats : public boost::noncopyable {
   // Number of packets dropped by the PCAP distribution service
   TLCounter pcapDistFailure_;
 
+  // Number of packets not sent to the PCAP distribution service because it
+  // wasn't keeping up
+  TLTimeseries pcapDistDropped_;
+
   // Number of failed updateStats callbacks do to exceptions.
   TLTimeseries updateStatsExceptions_;
 
   // Number of packet too big ICMPv6 triggered
   TLTimeseries trapPktTooBig_;
+
+  // Trapped packets dropped by RxPacketDispatcher, per packet class
+  TLTimeseries rxQueueDropsControl_;
+  TLTimeseries rxQueueDropsHighPriority_;
+  TLTimeseries rxQueueDropsArp_;
+  TLTimeseries rxQueueDropsDefault_;
+
+  // Trapped packets dropped by control plane acls before being handled
+  TLTimeseries trapPktAclDrops_;
+
+  // Trapped packets dropped by the software policer, per policer class
+  TLTimeseries trapPktPolicerDropsArp_;
+  TLTimeseries trapPktPolicerDropsNdp_;
+
+  // Trapped packets held by PendingNeighborQueue until their next hop
+  // resolves, and what became of them
+  TLTimeseries pendingPktsQueued_;
+  TLTimeseries pendingPktsSent_;
+  TLTimeseries pendingPktsDropped_;
+
+  std::array<std::atomic<uint64_t>, kNumPacketCounters> packetCounters_{};
+  // What we have published of packetCounters_ so far
+  std::mutex publishMutex_;
+  std::array<uint64_t, kNumPacketCounters> publishedPacketCounters_{};
+
+  // The histograms of the phases of the state updates with a given name
+  struct StateUpdateStats {
+    StateUpdateStats(ThreadLocalStatsMap* map, const std::string& prefix);
+
+    TLHistogram queued;
+    TLHistogram swApply;
+    TLHistogram hwApply;
+    TLHistogram observers;
+  };
+
+  // Allocations and bytes allocated per sampled AllocationScope
+  struct AllocationStats {
+    AllocationStats(ThreadLocalStatsMap* map, const std::string& prefix);
+
+    TLTimeseries allocations;
+    TLTimeseries bytes;
+  };
+
+  ThreadLocalStatsMap* map_;
+  std::unordered_map<std::string, std::unique_ptr<StateUpdateStats>>
+      stateUpdateStats_;
+  // Created on first use, as most threads only ever see one path
+  std::array<std::unique_ptr<AllocationStats>, kNumAllocationPaths>
+      allocationStats_;
 };
 
 }} // facebook::fboss
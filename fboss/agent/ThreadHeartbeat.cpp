@@ -9,12 +9,57 @@
  */
 // Copyright 2014-present Facebook. All Rights Reserved.
 #include "fboss/agent/ThreadHeartbeat.h"
+#include "common/stats/ThreadCachedServiceData.h"
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
 
 using namespace std::chrono;
+using facebook::stats::SUM;
+
+DEFINE_int32(slow_loop_ms, 100,
+             "Event loop iterations busy for longer than this (ms) are "
+             "counted as <threadName>.slow_loops");
 
 namespace facebook { namespace fboss {
 
+void ThreadHeartbeat::LoopObserver::loopSample(
+    int64_t busyTime,
+    int64_t idleTime) {
+  busyUsecs_ += busyTime;
+  idleUsecs_ += idleTime;
+  maxBusyUsecs_ = std::max(maxBusyUsecs_, busyTime);
+  if (busyTime >= FLAGS_slow_loop_ms * 1000) {
+    ++slowLoops_;
+  }
+  maxQueueSize_ = std::max(maxQueueSize_, evb_->getNotificationQueueSize());
+}
+
+void ThreadHeartbeat::scheduleFirstHeartbeat() {
+  CHECK(evb_->inRunningEventBaseThread());
+  lastTime_ = steady_clock::now();
+  loopObserver_ = std::make_shared<LoopObserver>(evb_);
+  evb_->setObserver(loopObserver_);
+  scheduleTimeout(intervalMsecs_);
+}
+
+void ThreadHeartbeat::exportLoopStats() {
+  auto& loop = *loopObserver_;
+  auto totalUsecs = loop.busyUsecs_ + loop.idleUsecs_;
+  auto busyPct = totalUsecs > 0 ? loop.busyUsecs_ * 100 / totalUsecs : 0;
+  tcData().setCounter(threadName_ + ".busy_pct", busyPct);
+  tcData().setCounter(threadName_ + ".loop_busy_max.us", loop.maxBusyUsecs_);
+  tcData().setCounter(threadName_ + ".queue_depth_max", loop.maxQueueSize_);
+  tcData().addStatValue(threadName_ + ".slow_loops", loop.slowLoops_, SUM);
+  if (loop.slowLoops_ > 0) {
+    XLOG(DBG2) << threadName_ << ": " << loop.slowLoops_
+               << " slow loop iterations, longest busy for "
+               << loop.maxBusyUsecs_ << "us, " << busyPct << "% busy";
+  }
+  loop.reset();
+}
+
 void ThreadHeartbeat::timeoutExpired() noexcept {
   CHECK(evb_->inRunningEventBaseThread());
   auto now = steady_clock::now();
@@ -28,6 +73,7 @@ void ThreadHeartbeat::timeoutExpired() noexcept {
                << " delay ms:" << delay.count()
                << " event queue size:" << evbQueueSize;
   }
+  exportLoopStats();
   lastTime_ = now;
   scheduleTimeout(intervalMsecs_);
 }
@@ -13,6 +13,7 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
 #include <chrono>
+#include <memory>
 
 namespace facebook { namespace fboss {
 
@@ -21,6 +22,12 @@ class ThreadHeartbeat : private folly::AsyncTimeout {
    * Send heartbeat at regular interval to thread.  Measure delay between
    * time we expect heartbeat to be processed vs. time actually processed,
    * and record it to ods.
+   *
+   * Also observes each iteration of the thread's event loop, and exports
+   * per heartbeat interval, as <threadName>.* counters, how busy the loop
+   * was, its longest iteration and the deepest its queue of
+   * runInEventBaseThread() tasks got. A late heartbeat only says the thread
+   * is starved; these say whether by one long callback or by sheer load.
    */
  public:
   ThreadHeartbeat(folly::EventBase* evb, std::string threadName,
@@ -40,24 +47,48 @@ class ThreadHeartbeat : private folly::AsyncTimeout {
   ~ThreadHeartbeat() override {
     evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
       [this]() {
+        evb_->setObserver(nullptr);
         cancelTimeout();
       });
   }
 
  private:
+  /*
+   * Accounts for the loop iterations between two heartbeats. Only used
+   * from the event base thread.
+   */
+  class LoopObserver : public folly::EventBaseObserver {
+   public:
+    explicit LoopObserver(folly::EventBase* evb) : evb_(evb) {}
+
+    uint32_t getSampleRate() const override {
+      return 1;
+    }
+    void loopSample(int64_t busyTime, int64_t idleTime) override;
+    void reset() {
+      busyUsecs_ = idleUsecs_ = maxBusyUsecs_ = slowLoops_ = 0;
+      maxQueueSize_ = 0;
+    }
+
+    folly::EventBase* evb_;
+    int64_t busyUsecs_{0};
+    int64_t idleUsecs_{0};
+    int64_t maxBusyUsecs_{0};
+    int64_t slowLoops_{0};
+    size_t maxQueueSize_{0};
+  };
+
   void timeoutExpired() noexcept override;
 
-  void scheduleFirstHeartbeat() {
-    CHECK(evb_->inRunningEventBaseThread());
-    lastTime_ = std::chrono::steady_clock::now();
-    scheduleTimeout(intervalMsecs_);
-  }
+  void scheduleFirstHeartbeat();
+  void exportLoopStats();
 
   folly::EventBase* evb_;
   std::string threadName_;
   std::chrono::milliseconds intervalMsecs_;
   std::function<void(int, int)> heartbeatStatsFunc_;
   std::chrono::time_point<std::chrono::steady_clock> lastTime_;
+  std::shared_ptr<LoopObserver> loopObserver_;
   //XXX: these thresholds could be made configurable if needed
   int delayThresholdMsecs_ = 1000;
   int backlogThreshold_ = 10;
@@ -0,0 +1,247 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ThreadPlacement.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+DEFINE_string(thread_placement, "auto",
+              "CPUs and priorities of the agent threads, as "
+              "<name prefix>:<setting>[,<setting>...][;...] with settings "
+              "cpus=<n>[-<m>], node=<n>, nice=<n> and fifo=<prio>. 'auto' "
+              "keeps every thread on NUMA node 0 on multi-node boxes, "
+              "'' leaves the threads alone");
+
+using folly::StringPiece;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The longest thread name the kernel keeps
+constexpr size_t kMaxThreadName = 15;
+
+std::vector<facebook::fboss::ThreadPlacement::Rule> autoRules() {
+  using facebook::fboss::ThreadPlacement;
+  string online;
+  if (!folly::readFile("/sys/devices/system/node/online", online)) {
+    return {};
+  }
+  auto nodes = ThreadPlacement::parseCpuList(online);
+  if (nodes.size() < 2 || nodes.count(0) == 0) {
+    return {};
+  }
+  ThreadPlacement::Rule rule;
+  rule.cpus = ThreadPlacement::getNodeCpus(0);
+  return {rule};
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+ThreadPlacement* ThreadPlacement::get() {
+  static auto placement = [] {
+    vector<Rule> rules;
+    try {
+      rules = FLAGS_thread_placement == "auto" ? autoRules()
+                                               : parse(FLAGS_thread_placement);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "Leaving the threads where they are, bad placement '"
+                << FLAGS_thread_placement << "': " << folly::exceptionStr(ex);
+    }
+    return new ThreadPlacement(std::move(rules));
+  }();
+  return placement;
+}
+
+set<int> ThreadPlacement::parseCpuList(StringPiece cpuList) {
+  set<int> cpus;
+  vector<StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(cpuList), ranges);
+  for (auto range : ranges) {
+    range = folly::trimWhitespace(range);
+    if (range.empty()) {
+      continue;
+    }
+    StringPiece first;
+    StringPiece last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto begin = folly::to<int>(first);
+    auto end = folly::to<int>(last);
+    if (begin < 0 || end < begin || end >= CPU_SETSIZE) {
+      throw FbossError("bad CPU range ", range);
+    }
+    for (auto cpu = begin; cpu <= end; ++cpu) {
+      cpus.insert(cpu);
+    }
+  }
+  return cpus;
+}
+
+set<int> ThreadPlacement::getNodeCpus(int node) {
+  string cpuList;
+  auto path = folly::to<string>(
+      "/sys/devices/system/node/node", node, "/cpulist");
+  if (!folly::readFile(path.c_str(), cpuList)) {
+    throw FbossError("no NUMA node ", node);
+  }
+  return parseCpuList(cpuList);
+}
+
+vector<ThreadPlacement::Rule> ThreadPlacement::parse(StringPiece policy) {
+  vector<Rule> rules;
+  vector<StringPiece> ruleSpecs;
+  folly::split(';', policy, ruleSpecs);
+  for (auto spec : ruleSpecs) {
+    spec = folly::trimWhitespace(spec);
+    if (spec.empty()) {
+      continue;
+    }
+    StringPiece prefix;
+    StringPiece settings;
+    if (!folly::split(':', spec, prefix, settings)) {
+      throw FbossError("no settings in thread placement rule ", spec);
+    }
+    Rule rule;
+    rule.prefix = folly::trimWhitespace(prefix).str();
+    if (rule.prefix.size() > kMaxThreadName) {
+      rule.prefix.resize(kMaxThreadName);
+    }
+    vector<StringPiece> fields;
+    folly::split(',', settings, fields);
+    for (auto field : fields) {
+      StringPiece key;
+      StringPiece value;
+      if (!folly::split('=', field, key, value)) {
+        throw FbossError("bad thread placement setting ", field);
+      }
+      key = folly::trimWhitespace(key);
+      value = folly::trimWhitespace(value);
+      if (key == "cpus") {
+        auto cpus = parseCpuList(value);
+        rule.cpus.insert(cpus.begin(), cpus.end());
+      } else if (key == "node") {
+        auto cpus = getNodeCpus(folly::to<int>(value));
+        rule.cpus.insert(cpus.begin(), cpus.end());
+      } else if (key == "nice") {
+        rule.nice = folly::to<int>(value);
+      } else if (key == "fifo") {
+        auto priority = folly::to<int>(value);
+        if (priority < sched_get_priority_min(SCHED_FIFO) ||
+            priority > sched_get_priority_max(SCHED_FIFO)) {
+          throw FbossError("bad SCHED_FIFO priority ", value);
+        }
+        rule.fifoPriority = priority;
+      } else {
+        throw FbossError("unknown thread placement setting ", key);
+      }
+    }
+    rules.push_back(std::move(rule));
+  }
+  return rules;
+}
+
+const ThreadPlacement::Rule* ThreadPlacement::match(StringPiece name) const {
+  for (const auto& rule : rules_) {
+    if (name.startsWith(rule.prefix)) {
+      return &rule;
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPlacement::apply(int tid, StringPiece name, const Rule& rule) {
+  // Failures are logged and otherwise ignored: a misplaced thread is slower,
+  // not broken
+  if (!rule.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto cpu : rule.cpus) {
+      CPU_SET(cpu, &cpus);
+    }
+    if (sched_setaffinity(tid, sizeof(cpus), &cpus) != 0) {
+      XLOG(ERR) << "Failed to set the CPUs of thread " << name << ": "
+                << folly::errnoStr(errno);
+    }
+  }
+  if (rule.fifoPriority) {
+    sched_param param{};
+    param.sched_priority = *rule.fifoPriority;
+    if (sched_setscheduler(tid, SCHED_FIFO, &param) != 0) {
+      XLOG(ERR) << "Failed to make thread " << name << " SCHED_FIFO: "
+                << folly::errnoStr(errno);
+    }
+  }
+  if (rule.nice &&
+      setpriority(PRIO_PROCESS, static_cast<id_t>(tid), *rule.nice) != 0) {
+    XLOG(ERR) << "Failed to set the nice value of thread " << name << ": "
+              << folly::errnoStr(errno);
+  }
+}
+
+void ThreadPlacement::applyToCurrentThread(StringPiece name) const {
+  auto rule = match(name.subpiece(0, kMaxThreadName));
+  if (rule) {
+    apply(syscall(SYS_gettid), name, *rule);
+  }
+}
+
+size_t ThreadPlacement::applyToAllThreads() const {
+  if (rules_.empty()) {
+    return 0;
+  }
+  auto dir = opendir("/proc/self/task");
+  if (!dir) {
+    XLOG(ERR) << "Failed to list the agent threads: "
+              << folly::errnoStr(errno);
+    return 0;
+  }
+  size_t placed = 0;
+  while (auto entry = readdir(dir)) {
+    if (!isdigit(entry->d_name[0])) {
+      // . and ..
+      continue;
+    }
+    auto tid = folly::to<int>(entry->d_name);
+    string name;
+    auto path = folly::to<string>("/proc/self/task/", tid, "/comm");
+    if (!folly::readFile(path.c_str(), name)) {
+      // The thread exited
+      continue;
+    }
+    auto trimmed = folly::trimWhitespace(name);
+    auto rule = match(trimmed);
+    if (rule) {
+      apply(tid, trimmed, *rule);
+      ++placed;
+    }
+  }
+  closedir(dir);
+  XLOG(INFO) << "Placed " << placed << " threads";
+  return placed;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Where the agent's threads run and at what priority, so that e.g. noisy
+ * thrift workers stay off the cores of the SDK RX thread.
+ *
+ * The policy is --thread_placement, a ';' separated list of rules
+ *
+ *   <name prefix>:<setting>[,<setting>...]
+ *
+ * Each thread gets the settings of the first rule whose prefix its name
+ * starts with, an empty prefix matching every thread. Thread names are cut
+ * to 15 characters by the kernel. The settings are
+ *
+ *   cpus=<n>[-<m>]  run on those CPUs, can be given more than once
+ *   node=<n>        run on the CPUs of NUMA node n
+ *   nice=<n>        nice value
+ *   fifo=<prio>     SCHED_FIFO at priority prio
+ *
+ * e.g. "bcmRX:cpus=1,fifo=40;fbossUpdateThr:cpus=2-3;:cpus=4-15". With
+ * "auto", the default, every thread is kept on the CPUs of NUMA node 0 on
+ * multi-socket boxes, next to the agent's memory, and left alone on the
+ * others.
+ *
+ * The agent's own threads place themselves as they start, see
+ * initThread(). The others (thrift, SDK...) are placed by name when
+ * applyToAllThreads() is called.
+ */
+class ThreadPlacement {
+ public:
+  struct Rule {
+    std::string prefix;
+    std::set<int> cpus;
+    folly::Optional<int> nice;
+    folly::Optional<int> fifoPriority;
+  };
+
+  explicit ThreadPlacement(std::vector<Rule> rules)
+      : rules_(std::move(rules)) {}
+
+  // The policy of --thread_placement
+  static ThreadPlacement* get();
+
+  // Throws FbossError if policy is malformed
+  static std::vector<Rule> parse(folly::StringPiece policy);
+  // The CPUs of a NUMA node, throws FbossError if there is no such node
+  static std::set<int> getNodeCpus(int node);
+  static std::set<int> parseCpuList(folly::StringPiece cpuList);
+
+  // The rule for the thread named name, nullptr if there is none
+  const Rule* match(folly::StringPiece name) const;
+
+  // Place the calling thread, named name
+  void applyToCurrentThread(folly::StringPiece name) const;
+  // Place every thread of the process by name, returns how many matched
+  size_t applyToAllThreads() const;
+
+  bool empty() const {
+    return rules_.empty();
+  }
+
+ private:
+  static void apply(int tid, folly::StringPiece name, const Rule& rule);
+
+  std::vector<Rule> rules_;
+};
+
+}} // facebook::fboss
@@ -19,12 +19,17 @@
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/LinkAggregationManager.h"
 #include "fboss/agent/LldpManager.h"
+#include "fboss/agent/StateExporter.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/NexthopToRouteCount.h"
+#include "fboss/agent/RouteAdmissionControl.h"
+#include "fboss/agent/RouteGracefulRestart.h"
 #include "fboss/agent/RouteUpdateLogger.h"
+#include "fboss/agent/RouteUpdateQueue.h"
 #include "fboss/agent/capture/PktCapture.h"
 #include "fboss/agent/capture/PktCaptureManager.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
@@ -39,6 +44,7 @@
 #include "fboss/agent/state/Port.h"
 #include "fboss/agent/state/PortQueue.h"
 #include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteLookupTable.h"
 #include "fboss/agent/state/RouteTable.h"
 #include "fboss/agent/state/RouteTableRib.h"
 #include "fboss/agent/state/RouteUpdater.h"
@@ -49,14 +55,19 @@
 #include "fboss/agent/if/gen-cpp2/NeighborListenerClient.h"
 
 #include <folly/MoveWrapper.h>
+#include <folly/Optional.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/json_pointer.h>
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/async/DuplexChannel.h>
 
+#include <algorithm>
 #include <limits>
+#include <type_traits>
 
 using apache::thrift::ClientReceiveState;
 using facebook::fb303::cpp2::fb_status;
@@ -88,6 +99,49 @@ DEFINE_bool(
     false,
     "Allow external mutations of running config");
 
+DEFINE_bool(
+    highres_shared_sample_loop,
+    true,
+    "Sample highres counter subscriptions in one shared thread, rather than "
+    "a thread per subscription. Subscriptions asking for PAUSE sleeps or a "
+    "lower priority always get a thread of their own.");
+
+DEFINE_bool(
+    delta_sync_fib,
+    true,
+    "Have syncFib only add, change and delete the routes which differ from "
+    "what the client has, rather than deleting all of the client's routes "
+    "and adding them back");
+
+DEFINE_int32(
+    max_route_table_page_size,
+    10000,
+    "Most routes returned by one getRouteTablePage/getRouteTableDetailsPage "
+    "call");
+
+DEFINE_int32(
+    max_l2_table_page_size,
+    10000,
+    "Most entries returned by one getL2TablePage call");
+
+DEFINE_int32(
+    max_traced_flows,
+    100000,
+    "Most flows traced by one traceFlowHashing call");
+
+DEFINE_int32(
+    thrift_read_threads,
+    2,
+    "Threads serving the bulk read thrift calls, such as getAllPortInfo and "
+    "getRouteTableDetails, off the thrift worker threads. 0 serves them on "
+    "the worker threads");
+
+DEFINE_int32(
+    thrift_read_max_pending,
+    64,
+    "Most bulk read thrift calls queued or running at once. Those beyond it "
+    "fail right away");
+
 namespace facebook { namespace fboss {
 
 namespace util {
@@ -119,6 +173,243 @@ std::vector<NextHopThrift> thriftNextHopsFromAddresses(
 }
 }
 
+namespace {
+
+RouteUpdater::ClientRoute toClientRoute(
+    SwSwitch* sw,
+    AdminDistance defaultAdminDistance,
+    const UnicastRoute& route) {
+  folly::IPAddress network = toIPAddress(route.dest.ip);
+  uint8_t mask = static_cast<uint8_t>(route.dest.prefixLength);
+  auto adminDistance = route.__isset.adminDistance ? route.adminDistance :
+    defaultAdminDistance;
+  std::vector<NextHopThrift> nhts;
+  if (route.nextHops.empty() && !route.nextHopAddrs.empty()) {
+    nhts = util::thriftNextHopsFromAddresses(route.nextHopAddrs);
+  } else {
+    nhts = route.nextHops;
+  }
+  if (network.isV4()) {
+    sw->stats()->addRouteV4();
+  } else {
+    sw->stats()->addRouteV6();
+  }
+  RouteNextHopSet nexthops = util::toRouteNextHopSet(nhts);
+  if (nexthops.size()) {
+    return {network, mask,
+            RouteNextHopEntry(std::move(nexthops), adminDistance)};
+  }
+  XLOG(DBG3) << "Blackhole route:" << network << "/"
+             << static_cast<int>(mask);
+  return {network, mask,
+          RouteNextHopEntry(RouteForwardAction::DROP, adminDistance)};
+}
+
+void addRoute(
+    SwSwitch* sw,
+    RouteUpdater* updater,
+    RouterID routerId,
+    ClientID client,
+    AdminDistance defaultAdminDistance,
+    const UnicastRoute& route) {
+  auto clientRoute = toClientRoute(sw, defaultAdminDistance, route);
+  sw->getRouteGracefulRestart()->refreshed(
+      client, routerId, clientRoute.network, clientRoute.mask);
+  updater->addRoute(routerId, clientRoute.network, clientRoute.mask, client,
+                    std::move(clientRoute.entry));
+}
+
+void delRoute(
+    SwSwitch* sw,
+    RouteUpdater* updater,
+    RouterID routerId,
+    ClientID client,
+    const IpPrefix& prefix) {
+  auto network = toIPAddress(prefix.ip);
+  auto mask = static_cast<uint8_t>(prefix.prefixLength);
+  if (network.isV4()) {
+    sw->stats()->delRouteV4();
+  } else {
+    sw->stats()->delRouteV6();
+  }
+  sw->getRouteGracefulRestart()->refreshed(client, routerId, network, mask);
+  updater->delRoute(routerId, network, mask, client);
+}
+
+template <typename AddrT>
+bool routeMatches(
+    const Route<AddrT>& route,
+    const RouteTableFilter& filter) {
+  if (filter.__isset.clientId &&
+      !route.getEntryForClient(ClientID(filter.clientId))) {
+    return false;
+  }
+  if (filter.__isset.prefix) {
+    const auto& prefix = route.prefix();
+    auto network = toIPAddress(filter.prefix.ip);
+    return network.isV4() == std::is_same<AddrT, IPAddressV4>::value &&
+        prefix.mask >= filter.prefix.prefixLength &&
+        folly::IPAddress(prefix.network)
+            .inSubnet(network, filter.prefix.prefixLength);
+  }
+  return true;
+}
+
+/*
+ * Walk one RIB for walkRouteTables(), starting after the prefix `after` if
+ * set. Returns false once the page is full.
+ */
+template <typename AddrT, typename Fn>
+bool walkRib(
+    RouterID vrf,
+    const RouteTableRib<AddrT>& rib,
+    const folly::Optional<RoutePrefix<AddrT>>& after,
+    const RouteTableFilter& filter,
+    int32_t maxRoutes,
+    int32_t* numRoutes,
+    RouteTableCursor* last,
+    Fn& fn) {
+  const auto& routes = rib.routes()->getAllNodes();
+  auto it = after ? routes.upper_bound(*after) : routes.begin();
+  for (; it != routes.end(); ++it) {
+    const auto& route = *it->second;
+    if (!routeMatches(route, filter) || !fn(route)) {
+      continue;
+    }
+    last->vrf = static_cast<int32_t>(vrf);
+    last->lastPrefix.ip = toBinaryAddress(route.prefix().network);
+    last->lastPrefix.prefixLength = route.prefix().mask;
+    if (++*numRoutes == maxRoutes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Walk the routes of state matching the request's filter in cursor order,
+ * starting after the request's cursor, and call fn on each of them. fn
+ * returns whether it added the route to the page.
+ *
+ * Only walks as far as needed to fill the page, so the work and memory spent
+ * per call are bounded by the page size rather than the table size. Returns
+ * the cursor to continue from, or none if the walk got to the end.
+ */
+template <typename Fn>
+folly::Optional<RouteTableCursor> walkRouteTables(
+    const std::shared_ptr<SwitchState>& state,
+    const RouteTablePageRequest& request,
+    Fn fn) {
+  if (request.maxRoutes <= 0) {
+    throw FbossError("maxRoutes must be positive, got ", request.maxRoutes);
+  }
+  auto maxRoutes = std::min(request.maxRoutes, FLAGS_max_route_table_page_size);
+  const auto& filter = request.filter;
+  int32_t numRoutes = 0;
+  RouteTableCursor last;
+  for (const auto& routeTable : *state->getRouteTables()) {
+    auto vrf = routeTable->getID();
+    if (filter.__isset.vrf && vrf != RouterID(filter.vrf)) {
+      continue;
+    }
+    folly::Optional<RoutePrefix<IPAddressV4>> afterV4;
+    folly::Optional<RoutePrefix<IPAddressV6>> afterV6;
+    bool walkV4 = true;
+    if (request.__isset.cursor) {
+      const auto& cursor = request.cursor;
+      if (vrf < RouterID(cursor.vrf)) {
+        continue;
+      }
+      if (vrf == RouterID(cursor.vrf)) {
+        auto ip = toIPAddress(cursor.lastPrefix.ip);
+        uint8_t mask = cursor.lastPrefix.prefixLength;
+        if (ip.isV4()) {
+          afterV4 = RoutePrefix<IPAddressV4>{ip.asV4(), mask};
+        } else {
+          walkV4 = false;
+          afterV6 = RoutePrefix<IPAddressV6>{ip.asV6(), mask};
+        }
+      }
+    }
+    if (walkV4 &&
+        !walkRib(vrf, *routeTable->getRibV4(), afterV4, filter, maxRoutes,
+                 &numRoutes, &last, fn)) {
+      return last;
+    }
+    if (!walkRib(vrf, *routeTable->getRibV6(), afterV6, filter, maxRoutes,
+                 &numRoutes, &last, fn)) {
+      return last;
+    }
+  }
+  return folly::none;
+}
+
+// Batches with fewer lookups of an address family than this just walk the
+// radix tree, rather than paying for building a lookup table
+constexpr size_t kMinBatchForLookupTable = 64;
+
+/*
+ * The lookup table last built for the rib of vrf, if it was built for this
+ * very rib. Otherwise a new one when build is set, or null.
+ */
+template <typename AddrT>
+std::shared_ptr<const RouteLookupTable<AddrT>> getLookupTable(
+    folly::Synchronized<std::map<
+        RouterID,
+        std::shared_ptr<const RouteLookupTable<AddrT>>>>& tables,
+    RouterID vrf,
+    const std::shared_ptr<RouteTableRib<AddrT>>& rib,
+    bool build) {
+  SYNCHRONIZED_CONST(tables) {
+    auto it = tables.find(vrf);
+    if (it != tables.end() && it->second->getRib() == rib) {
+      return it->second;
+    }
+  }
+  if (!build) {
+    return nullptr;
+  }
+  auto table = std::make_shared<const RouteLookupTable<AddrT>>(rib);
+  SYNCHRONIZED(tables) {
+    tables[vrf] = table;
+  }
+  return table;
+}
+
+template <typename AddrT>
+const Route<AddrT>* longestMatch(
+    const RouteTableRib<AddrT>& rib,
+    const RouteLookupTable<AddrT>* table,
+    const AddrT& addr) {
+  if (table) {
+    return table->longestMatch(addr);
+  }
+  // The rib keeps the route alive
+  return rib.longestMatch(addr).get();
+}
+
+template <typename AddrT>
+void fillUnicastRoute(UnicastRoute& route, const Route<AddrT>* match) {
+  if (!match || !match->isResolved()) {
+    route.dest.ip = toBinaryAddress(AddrT());
+    route.dest.prefixLength = 0;
+    return;
+  }
+  const auto& fwdInfo = match->getForwardInfo();
+  route.dest.ip = toBinaryAddress(match->prefix().network);
+  route.dest.prefixLength = match->prefix().mask;
+  route.nextHopAddrs = util::fromFwdNextHops(fwdInfo.getNextHopSet());
+}
+
+template <typename AddrT>
+void fillRouteDetails(RouteDetails& route, const Route<AddrT>* match) {
+  if (match && match->isResolved()) {
+    route = match->toRouteDetails();
+  }
+}
+
+} // unnamed namespace
+
 class RouteUpdateStats {
  public:
   RouteUpdateStats(SwSwitch *sw, const std::string& func, uint32_t routes)
@@ -143,6 +434,11 @@ class RouteUpdateStats {
 };
 
 ThriftHandler::ThriftHandler(SwSwitch* sw) : FacebookBase2("FBOSS"), sw_(sw) {
+  if (FLAGS_thrift_read_threads > 0) {
+    readExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        FLAGS_thrift_read_threads,
+        std::make_shared<folly::NamedThreadFactory>("ThriftRead"));
+  }
   sw->registerNeighborListener(
     [=](const std::vector<std::string>& added,
         const std::vector<std::string>& deleted) {
@@ -167,6 +463,46 @@ fb_status ThriftHandler::getStatus() {
   }
 }
 
+ThriftHandler::~ThriftHandler() {
+  if (readExecutor_) {
+    // Let the reads in flight finish while sw_ is still around
+    readExecutor_->join();
+  }
+}
+
+template <typename Result, typename ReadFn>
+void ThriftHandler::offloadRead(
+    ThriftCallback<std::unique_ptr<Result>> callback,
+    ReadFn read) {
+  auto serve = [this, read](
+                   const ThriftCallback<std::unique_ptr<Result>>& cb) {
+    auto result = std::make_unique<Result>();
+    try {
+      read(*result);
+    } catch (const std::exception& ex) {
+      fail(cb, ex);
+      return;
+    }
+    cb->result(std::move(result));
+  };
+  if (!readExecutor_) {
+    serve(callback);
+    return;
+  }
+  if (++pendingReads_ > FLAGS_thrift_read_max_pending) {
+    --pendingReads_;
+    fail(callback, FbossError("too many bulk reads pending, try again later"));
+    return;
+  }
+  auto wrappedCallback = folly::makeMoveWrapper(std::move(callback));
+  readExecutor_->add([this, serve, wrappedCallback]() mutable {
+    SCOPE_EXIT {
+      --pendingReads_;
+    };
+    serve(*wrappedCallback);
+  });
+}
+
 void ThriftHandler::async_tm_getStatus(ThriftCallback<fb_status> callback) {
   callback->result(getStatus());
 }
@@ -198,6 +534,8 @@ void ThriftHandler::addUnicastRoutes(
     int16_t client, std::unique_ptr<std::vector<UnicastRoute>> routes) {
   ensureConfigured("addUnicastRoutes");
   ensureFibSynced("addUnicastRoutes");
+  auto ticket = sw_->getRouteAdmissionControl()->admitUpdate(
+      ClientID(client), routes->size(), false);
   updateUnicastRoutesImpl(client, routes, "addUnicastRoutes", false);
 }
 
@@ -209,20 +547,16 @@ void ThriftHandler::deleteUnicastRoutes(
     int16_t client, std::unique_ptr<std::vector<IpPrefix>> prefixes) {
   ensureConfigured("deleteUnicastRoutes");
   ensureFibSynced("deleteUnicastRoutes");
+  // Withdrawals keep traffic off the routes, they are never turned away
+  auto ticket = sw_->getRouteAdmissionControl()->admitUpdate(
+      ClientID(client), prefixes->size(), true);
   RouteUpdateStats stats(sw_, "Delete", prefixes->size());
   // Perform the update
   auto updateFn = [&](const shared_ptr<SwitchState>& state) {
     RouteUpdater updater(state->getRouteTables());
     RouterID routerId = RouterID(0); // TODO, default vrf for now
     for (const auto& prefix : *prefixes) {
-      auto network = toIPAddress(prefix.ip);
-      auto mask = static_cast<uint8_t>(prefix.prefixLength);
-      if (network.isV4()) {
-        sw_->stats()->delRouteV4();
-      } else {
-        sw_->stats()->delRouteV6();
-      }
-      updater.delRoute(routerId, network, mask, ClientID(client));
+      delRoute(sw_, &updater, routerId, ClientID(client), prefix);
     }
     auto newRt = updater.updateDone();
     if (!newRt) {
@@ -232,18 +566,83 @@ void ThriftHandler::deleteUnicastRoutes(
     newState->resetRouteTables(std::move(newRt));
     return newState;
   };
-  sw_->updateStateBlocking("delete unicast route", updateFn);
+  sw_->updateStateBlocking(
+      "delete unicast route", updateFn, StateUpdate::Priority::ROUTE);
+}
+
+int64_t ThriftHandler::enqueueAddUnicastRoutes(
+    int16_t client, std::unique_ptr<std::vector<UnicastRoute>> routes) {
+  ensureConfigured("enqueueAddUnicastRoutes");
+  ensureFibSynced("enqueueAddUnicastRoutes");
+  // Held until the batch is applied
+  auto ticket = std::make_shared<RouteAdmissionControl::Ticket>(
+      sw_->getRouteAdmissionControl()->admitQueued(
+          ClientID(client), routes->size(), false));
+  auto clientIdToAdmin = sw_->clientIdToAdminDistance(client);
+  std::shared_ptr<const std::vector<UnicastRoute>> batch(std::move(routes));
+  auto sw = sw_;
+  return sw_->getRouteUpdateQueue()->enqueue(
+      [sw, client, clientIdToAdmin, batch, ticket](RouteUpdater* updater) {
+        RouterID routerId = RouterID(0); // TODO, default vrf for now
+        for (const auto& route : *batch) {
+          addRoute(sw, updater, routerId, ClientID(client), clientIdToAdmin,
+                   route);
+        }
+      });
+}
+
+int64_t ThriftHandler::enqueueDeleteUnicastRoutes(
+    int16_t client, std::unique_ptr<std::vector<IpPrefix>> prefixes) {
+  ensureConfigured("enqueueDeleteUnicastRoutes");
+  ensureFibSynced("enqueueDeleteUnicastRoutes");
+  auto ticket = std::make_shared<RouteAdmissionControl::Ticket>(
+      sw_->getRouteAdmissionControl()->admitQueued(
+          ClientID(client), prefixes->size(), true));
+  std::shared_ptr<const std::vector<IpPrefix>> batch(std::move(prefixes));
+  auto sw = sw_;
+  return sw_->getRouteUpdateQueue()->enqueue(
+      [sw, client, batch, ticket](RouteUpdater* updater) {
+        RouterID routerId = RouterID(0); // TODO, default vrf for now
+        for (const auto& prefix : *batch) {
+          delRoute(sw, updater, routerId, ClientID(client), prefix);
+        }
+      });
+}
+
+bool ThriftHandler::waitForRouteUpdates(int64_t seq, int32_t timeoutMs) {
+  ensureConfigured("waitForRouteUpdates");
+  if (seq <= 0 || timeoutMs < 0) {
+    throw FbossError(
+        "Invalid route batch ", seq, " or timeout ", timeoutMs, "ms");
+  }
+  return sw_->getRouteUpdateQueue()->waitFor(
+      seq, std::chrono::milliseconds(timeoutMs));
 }
 
 void ThriftHandler::syncFib(
     int16_t client, std::unique_ptr<std::vector<UnicastRoute>> routes) {
   ensureConfigured("syncFib");
+  // The sync replaces all of the client's routes, stale or not
+  sw_->getRouteGracefulRestart()->cancel(ClientID(client));
+  // The sync is how a client recovers, it is never turned away
+  auto ticket = sw_->getRouteAdmissionControl()->admitUpdate(
+      ClientID(client), routes->size(), true);
   updateUnicastRoutesImpl(client, routes, "syncFib", true);
   if (!sw_->isFibSynced()) {
     sw_->fibSynced();
   }
 }
 
+int64_t ThriftHandler::beginGracefulRestart(int16_t client) {
+  ensureConfigured("beginGracefulRestart");
+  return sw_->getRouteGracefulRestart()->begin(ClientID(client));
+}
+
+int64_t ThriftHandler::endOfRib(int16_t client) {
+  ensureConfigured("endOfRib");
+  return sw_->getRouteGracefulRestart()->endOfRib(ClientID(client));
+}
+
 void ThriftHandler::updateUnicastRoutesImpl(
   int16_t client, const std::unique_ptr<std::vector<UnicastRoute>>& routes,
   const std::string& updType, bool sync) {
@@ -258,35 +657,21 @@ void ThriftHandler::updateUnicastRoutesImpl(
     RouteUpdater updater(state->getRouteTables());
     RouterID routerId = RouterID(0); // TODO, default vrf for now
     auto clientIdToAdmin = sw_->clientIdToAdminDistance(client);
-    if (sync) {
-      updater.removeAllRoutesForClient(routerId, ClientID(client));
-    }
-    for (const auto& route : *routes) {
-      folly::IPAddress network = toIPAddress(route.dest.ip);
-      uint8_t mask = static_cast<uint8_t>(route.dest.prefixLength);
-      auto adminDistance = route.__isset.adminDistance ? route.adminDistance :
-        clientIdToAdmin;
-      std::vector<NextHopThrift> nhts;
-      if (route.nextHops.empty() && !route.nextHopAddrs.empty()) {
-        nhts = util::thriftNextHopsFromAddresses(route.nextHopAddrs);
-      } else {
-        nhts = route.nextHops;
+    if (sync && FLAGS_delta_sync_fib) {
+      std::vector<RouteUpdater::ClientRoute> clientRoutes;
+      clientRoutes.reserve(routes->size());
+      for (const auto& route : *routes) {
+        clientRoutes.push_back(toClientRoute(sw_, clientIdToAdmin, route));
       }
-      RouteNextHopSet nexthops = util::toRouteNextHopSet(nhts);
-      if (nexthops.size()) {
-        updater.addRoute(routerId, network, mask, ClientID(client),
-                         RouteNextHopEntry(std::move(nexthops), adminDistance));
-      } else {
-        XLOG(DBG3) << "Blackhole route:" << network << "/"
-                   << static_cast<int>(mask);
-        updater.addRoute(routerId, network, mask, ClientID(client),
-                         RouteNextHopEntry(RouteForwardAction::DROP,
-                           adminDistance));
+      updater.syncRoutesForClient(
+          routerId, ClientID(client), std::move(clientRoutes));
+    } else {
+      if (sync) {
+        updater.removeAllRoutesForClient(routerId, ClientID(client));
       }
-      if (network.isV4()) {
-        sw_->stats()->addRouteV4();
-      } else {
-        sw_->stats()->addRouteV6();
+      for (const auto& route : *routes) {
+        addRoute(sw_, &updater, routerId, ClientID(client), clientIdToAdmin,
+                 route);
       }
     }
     auto newRt = updater.updateDone();
@@ -297,7 +682,7 @@ void ThriftHandler::updateUnicastRoutesImpl(
     newState->resetRouteTables(std::move(newRt));
     return newState;
   };
-  sw_->updateStateBlocking(updType, updateFn);
+  sw_->updateStateBlocking(updType, updateFn, StateUpdate::Priority::ROUTE);
 }
 
 static void populateInterfaceDetail(InterfaceDetail& interfaceDetail,
@@ -346,6 +731,20 @@ void ThriftHandler::getInterfaceDetail(InterfaceDetail& interfaceDetail,
   populateInterfaceDetail(interfaceDetail, intf);
 }
 
+void ThriftHandler::async_tm_getNdpTable(
+    ThriftCallback<std::unique_ptr<std::vector<NdpEntryThrift>>> callback) {
+  offloadRead(std::move(callback), [this](std::vector<NdpEntryThrift>& table) {
+    getNdpTable(table);
+  });
+}
+
+void ThriftHandler::async_tm_getArpTable(
+    ThriftCallback<std::unique_ptr<std::vector<ArpEntryThrift>>> callback) {
+  offloadRead(std::move(callback), [this](std::vector<ArpEntryThrift>& table) {
+    getArpTable(table);
+  });
+}
+
 void ThriftHandler::getNdpTable(std::vector<NdpEntryThrift>& ndpTable) {
   ensureConfigured();
   sw_->getNeighborUpdater()->getNdpCacheData(ndpTable);
@@ -362,6 +761,55 @@ void ThriftHandler::getL2Table(std::vector<L2EntryThrift>& l2Table) {
   XLOG(DBG6) << "L2 Table size:" << l2Table.size();
 }
 
+void ThriftHandler::getL2TablePage(
+    L2TablePage& page,
+    std::unique_ptr<L2TablePageRequest> request) {
+  ensureConfigured();
+  if (request->maxEntries <= 0) {
+    throw FbossError("maxEntries must be positive, got ", request->maxEntries);
+  }
+  if (request->__isset.cursor && request->cursor.numReturned < 0) {
+    throw FbossError(
+        "invalid L2 table cursor, ", request->cursor.numReturned, " returned");
+  }
+  auto maxEntries =
+      std::min(request->maxEntries, FLAGS_max_l2_table_page_size);
+  sw_->getHw()->fetchL2TablePage(*request, maxEntries, &page);
+  XLOG(DBG6) << "L2 Table page size:" << page.entries.size();
+}
+
+void ThriftHandler::getQueueBufferStats(
+    std::vector<QueueBufferStats>& stats,
+    int32_t windowSeconds) {
+  ensureConfigured();
+  if (windowSeconds <= 0) {
+    throw FbossError("window must be positive, got ", windowSeconds);
+  }
+  sw_->getHw()->getQueueBufferStats(&stats, seconds(windowSeconds));
+}
+
+void ThriftHandler::getEcmpBalance(
+    std::vector<EcmpGroupBalance>& groups,
+    int32_t maxGroups) {
+  ensureConfigured();
+  if (maxGroups <= 0) {
+    throw FbossError("maxGroups must be positive, got ", maxGroups);
+  }
+  sw_->getHw()->getEcmpBalance(&groups, maxGroups);
+}
+
+void ThriftHandler::traceFlowHashing(
+    FlowHashingReport& report,
+    std::unique_ptr<std::vector<FlowTuple>> flows) {
+  ensureConfigured();
+  if (flows->size() > static_cast<size_t>(FLAGS_max_traced_flows)) {
+    throw FbossError(
+        "can trace at most ", FLAGS_max_traced_flows, " flows at once, got ",
+        flows->size());
+  }
+  sw_->getHw()->traceFlowHashing(*flows, &report);
+}
+
 LacpPortRateThrift ThriftHandler::fromLacpPortRate(cfg::LacpPortRate rate) {
   switch (rate) {
     case cfg::LacpPortRate::SLOW:
@@ -436,6 +884,16 @@ void ThriftHandler::getAggregatePort(
   populateAggregatePortThrift(aggregatePort, aggregatePortThrift);
 }
 
+void ThriftHandler::async_tm_getAggregatePortTable(
+    ThriftCallback<std::unique_ptr<std::vector<AggregatePortThrift>>>
+        callback) {
+  offloadRead(
+      std::move(callback),
+      [this](std::vector<AggregatePortThrift>& aggregatePorts) {
+        getAggregatePortTable(aggregatePorts);
+      });
+}
+
 void ThriftHandler::getAggregatePortTable(
     std::vector<AggregatePortThrift>& aggregatePortsThrift) {
   ensureConfigured();
@@ -444,9 +902,10 @@ void ThriftHandler::getAggregatePortTable(
   // parameter, make sure it's clear() first
   aggregatePortsThrift.clear();
 
-  aggregatePortsThrift.reserve(sw_->getState()->getAggregatePorts()->size());
+  auto aggregatePorts = sw_->getState()->getAggregatePorts();
+  aggregatePortsThrift.reserve(aggregatePorts->size());
 
-  for (const auto& aggregatePort : *(sw_->getState()->getAggregatePorts())) {
+  for (const auto& aggregatePort : *aggregatePorts) {
     aggregatePortsThrift.emplace_back();
 
     populateAggregatePortThrift(aggregatePort, aggregatePortsThrift.back());
@@ -566,6 +1025,14 @@ void ThriftHandler::getPortInfo(PortInfoThrift &portInfo, int32_t portId) {
   getPortInfoHelper(portInfo, port);
 }
 
+void ThriftHandler::async_tm_getAllPortInfo(
+    ThriftCallback<std::unique_ptr<map<int32_t, PortInfoThrift>>> callback) {
+  offloadRead(
+      std::move(callback), [this](map<int32_t, PortInfoThrift>& portInfoMap) {
+        getAllPortInfo(portInfoMap);
+      });
+}
+
 void ThriftHandler::getAllPortInfo(map<int32_t, PortInfoThrift>& portInfoMap) {
   ensureConfigured();
 
@@ -608,9 +1075,11 @@ void ThriftHandler::getCurrentStateJSON(
   if (!jsonPtr) {
     throw FbossError("Malformed JSON Pointer");
   }
-  auto swState = sw_->getState()->toFollyDynamic();
-  auto dyn = swState.get_ptr(jsonPtr.value());
-  ret = folly::json::serialize(*dyn, folly::json::serialization_opts{});
+  // Only serialize the part of the state asked for
+  if (!sw_->getState()->writeJson(jsonPtr.value(), &ret)) {
+    throw FbossError(
+        "JSON Pointer ", *jsonPointerStr, " doesn't point to any state");
+  }
 }
 
 void ThriftHandler::patchCurrentStateJSON(
@@ -624,16 +1093,10 @@ void ThriftHandler::patchCurrentStateJSON(
   if (!jsonPtr) {
     throw FbossError("Malformed JSON Pointer");
   }
+  auto patch = folly::parseJson(*jsonPatchStr);
   // OK to capture by reference because the update call below is blocking
   auto updateFn = [&](const shared_ptr<SwitchState>& oldState) {
-    auto fullDynamic = oldState->toFollyDynamic();
-    auto* partialDynamic = fullDynamic.get_ptr(jsonPtr.value());
-    if (!partialDynamic) {
-      throw FbossError("JSON Pointer does not address proper object");
-    }
-    // mutates in place, i.e. modifies fullDynamic too
-    partialDynamic->merge_patch(folly::parseJson(*jsonPatchStr));
-    return SwitchState::fromFollyDynamic(fullDynamic);
+    return SwitchState::patchJson(oldState, jsonPtr.value(), patch);
   };
   sw_->updateStateBlocking("JSON patch", std::move(updateFn));
 }
@@ -683,7 +1146,7 @@ void ThriftHandler::getRouteTable(std::vector<UnicastRoute>& routes) {
     for (const auto& ipv4 : *(routeTable->getRibV4()->routes())) {
       UnicastRoute tempRoute;
       if (!ipv4->isResolved()) {
-        XLOG(INFO) << "Skipping unresolved route: " << ipv4->toFollyDynamic();
+        XLOG(DBG3) << "Skipping unresolved route: " << ipv4->str();
         continue;
       }
       auto fwdInfo = ipv4->getForwardInfo();
@@ -695,7 +1158,7 @@ void ThriftHandler::getRouteTable(std::vector<UnicastRoute>& routes) {
     for (const auto& ipv6 : *(routeTable->getRibV6()->routes())) {
       UnicastRoute tempRoute;
       if (!ipv6->isResolved()) {
-        XLOG(INFO) << "Skipping unresolved route: " << ipv6->toFollyDynamic();
+        XLOG(DBG3) << "Skipping unresolved route: " << ipv6->str();
         continue;
       }
       auto fwdInfo = ipv6->getForwardInfo();
@@ -745,9 +1208,17 @@ void ThriftHandler::getRouteTableByClient(
   }
 }
 
+void ThriftHandler::async_tm_getRouteTableDetails(
+    ThriftCallback<std::unique_ptr<std::vector<RouteDetails>>> callback) {
+  offloadRead(std::move(callback), [this](std::vector<RouteDetails>& routes) {
+    getRouteTableDetails(routes);
+  });
+}
+
 void ThriftHandler::getRouteTableDetails(std::vector<RouteDetails>& routes) {
   ensureConfigured();
-  for (const auto& routeTable : (*sw_->getState()->getRouteTables())) {
+  auto routeTables = sw_->getState()->getRouteTables();
+  for (const auto& routeTable : *routeTables) {
     for (const auto& ipv4 : *(routeTable->getRibV4()->routes())) {
       RouteDetails rd = ipv4->toRouteDetails();
       routes.emplace_back(std::move(rd));
@@ -759,66 +1230,127 @@ void ThriftHandler::getRouteTableDetails(std::vector<RouteDetails>& routes) {
   }
 }
 
-void ThriftHandler::getIpRoute(UnicastRoute& route,
-                                std::unique_ptr<Address> addr, int32_t vrfId) {
+void ThriftHandler::getRouteTablePage(
+    RouteTablePage& page,
+    std::unique_ptr<RouteTablePageRequest> request) {
+  ensureConfigured();
+  const auto& filter = request->filter;
+  auto next = walkRouteTables(
+      sw_->getAppliedState(), *request, [&](const auto& route) {
+        UnicastRoute tempRoute;
+        tempRoute.dest.ip = toBinaryAddress(route.prefix().network);
+        tempRoute.dest.prefixLength = route.prefix().mask;
+        if (filter.__isset.clientId) {
+          auto entry = route.getEntryForClient(ClientID(filter.clientId));
+          tempRoute.nextHops =
+              util::fromRouteNextHopSet(entry->getNextHopSet());
+          for (const auto& nh : tempRoute.nextHops) {
+            tempRoute.nextHopAddrs.emplace_back(nh.address);
+          }
+        } else if (route.isResolved()) {
+          tempRoute.nextHopAddrs = util::fromFwdNextHops(
+              route.getForwardInfo().getNextHopSet());
+        } else {
+          return false;
+        }
+        page.routes.emplace_back(std::move(tempRoute));
+        return true;
+      });
+  if (next) {
+    page.next = std::move(*next);
+    page.__isset.next = true;
+  }
+}
+
+void ThriftHandler::getRouteTableDetailsPage(
+    RouteDetailsPage& page,
+    std::unique_ptr<RouteTablePageRequest> request) {
   ensureConfigured();
-  folly::IPAddress ipAddr = toIPAddress(*addr);
+  auto next = walkRouteTables(
+      sw_->getAppliedState(), *request, [&](const auto& route) {
+        page.routes.emplace_back(route.toRouteDetails());
+        return true;
+      });
+  if (next) {
+    page.next = std::move(*next);
+    page.__isset.next = true;
+  }
+}
+
+template <typename Fn>
+void ThriftHandler::forEachLongestMatch(
+    const std::vector<Address>& addrs, int32_t vrfId, Fn fn) {
   auto routeTable = sw_->getState()->getRouteTables()->getRouteTableIf(
       RouterID(vrfId));
   if (!routeTable) {
     throw FbossError("No Such VRF ", vrfId);
   }
 
-  if (ipAddr.isV4()) {
-    auto ripV4Rib = routeTable->getRibV4();
-    auto match = ripV4Rib->longestMatch(ipAddr.asV4());
-    if (!match || !match->isResolved()) {
-      route.dest.ip = toBinaryAddress(IPAddressV4("0.0.0.0"));
-      route.dest.prefixLength = 0;
-      return;
-    }
-    const auto fwdInfo = match->getForwardInfo();
-    route.dest.ip = toBinaryAddress(match->prefix().network);
-    route.dest.prefixLength = match->prefix().mask;
-    route.nextHopAddrs = util::fromFwdNextHops(fwdInfo.getNextHopSet());
-  } else {
-    auto ripV6Rib = routeTable->getRibV6();
-    auto match = ripV6Rib->longestMatch(ipAddr.asV6());
-    if (!match || !match->isResolved()) {
-      route.dest.ip = toBinaryAddress(IPAddressV6("::0"));
-      route.dest.prefixLength = 0;
-      return;
+  std::vector<folly::IPAddress> ipAddrs;
+  ipAddrs.reserve(addrs.size());
+  size_t numV4 = 0;
+  for (const auto& addr : addrs) {
+    ipAddrs.push_back(toIPAddress(addr));
+    numV4 += ipAddrs.back().isV4();
+  }
+  auto numV6 = ipAddrs.size() - numV4;
+
+  // The ribs are immutable once published, so a lookup table built for one
+  // stays good for as long as the rib is current. Only build one for batches
+  // big enough to pay for it, but use the last one built whenever we can.
+  const auto& ribV4 = routeTable->getRibV4();
+  const auto& ribV6 = routeTable->getRibV6();
+  auto tableV4 = getLookupTable(v4LookupTables_, RouterID(vrfId), ribV4,
+                                numV4 >= kMinBatchForLookupTable);
+  auto tableV6 = getLookupTable(v6LookupTables_, RouterID(vrfId), ribV6,
+                                numV6 >= kMinBatchForLookupTable);
+  for (const auto& ipAddr : ipAddrs) {
+    if (ipAddr.isV4()) {
+      fn(longestMatch(*ribV4, tableV4.get(), ipAddr.asV4()));
+    } else {
+      fn(longestMatch(*ribV6, tableV6.get(), ipAddr.asV6()));
     }
-    const auto fwdInfo = match->getForwardInfo();
-    route.dest.ip = toBinaryAddress(match->prefix().network);
-    route.dest.prefixLength = match->prefix().mask;
-    route.nextHopAddrs = util::fromFwdNextHops(fwdInfo.getNextHopSet());
   }
 }
 
+void ThriftHandler::getIpRoute(UnicastRoute& route,
+                                std::unique_ptr<Address> addr, int32_t vrfId) {
+  ensureConfigured();
+  forEachLongestMatch({*addr}, vrfId, [&](const auto* match) {
+    fillUnicastRoute(route, match);
+  });
+}
+
 void ThriftHandler::getIpRouteDetails(
   RouteDetails& route, std::unique_ptr<Address> addr, int32_t vrfId) {
   ensureConfigured();
-  folly::IPAddress ipAddr = toIPAddress(*addr);
-  auto routeTable = sw_->getState()->getRouteTables()->getRouteTableIf(
-      RouterID(vrfId));
-  if (!routeTable) {
-    throw FbossError("No Such VRF ", vrfId);
-  }
+  forEachLongestMatch({*addr}, vrfId, [&](const auto* match) {
+    fillRouteDetails(route, match);
+  });
+}
 
-  if (ipAddr.isV4()) {
-    auto ripV4Rib = routeTable->getRibV4();
-    auto match = ripV4Rib->longestMatch(ipAddr.asV4());
-    if (match && match->isResolved()) {
-      route = match->toRouteDetails();
-    }
-  } else {
-    auto ripV6Rib = routeTable->getRibV6();
-    auto match = ripV6Rib->longestMatch(ipAddr.asV6());
-    if (match && match->isResolved()) {
-      route = match->toRouteDetails();
-    }
-  }
+void ThriftHandler::getIpRoutes(
+    std::vector<UnicastRoute>& routes,
+    std::unique_ptr<std::vector<Address>> addrs,
+    int32_t vrfId) {
+  ensureConfigured();
+  routes.reserve(addrs->size());
+  forEachLongestMatch(*addrs, vrfId, [&](const auto* match) {
+    routes.emplace_back();
+    fillUnicastRoute(routes.back(), match);
+  });
+}
+
+void ThriftHandler::getIpRoutesDetails(
+    std::vector<RouteDetails>& routes,
+    std::unique_ptr<std::vector<Address>> addrs,
+    int32_t vrfId) {
+  ensureConfigured();
+  routes.reserve(addrs->size());
+  forEachLongestMatch(*addrs, vrfId, [&](const auto* match) {
+    routes.emplace_back();
+    fillRouteDetails(routes.back(), match);
+  });
 }
 
 static LinkNeighborThrift thriftLinkNeighbor(const LinkNeighbor& n,
@@ -851,6 +1383,14 @@ static LinkNeighborThrift thriftLinkNeighbor(const LinkNeighbor& n,
   return tn;
 }
 
+void ThriftHandler::async_tm_getLldpNeighbors(
+    ThriftCallback<std::unique_ptr<vector<LinkNeighborThrift>>> callback) {
+  offloadRead(
+      std::move(callback), [this](vector<LinkNeighborThrift>& neighbors) {
+        getLldpNeighbors(neighbors);
+      });
+}
+
 void ThriftHandler::getLldpNeighbors(vector<LinkNeighborThrift>& results) {
   ensureConfigured();
   auto lldpMgr = sw_->getLldpMgr();
@@ -861,10 +1401,10 @@ void ThriftHandler::getLldpNeighbors(vector<LinkNeighborThrift>& results) {
   auto* db = lldpMgr->getDB();
   // Do an immediate check for expired neighbors
   db->pruneExpiredNeighbors();
-  auto neighbors = db->getNeighbors();
-  results.reserve(neighbors.size());
+  auto neighbors = db->getNeighborsSnapshot();
+  results.reserve(neighbors->size());
   auto now = steady_clock::now();
-  for (const auto& entry : db->getNeighbors()) {
+  for (const auto& entry : *neighbors) {
     results.push_back(thriftLinkNeighbor(entry, now));
   }
 }
@@ -914,6 +1454,21 @@ void ThriftHandler::startPktCapture(unique_ptr<CaptureInfo> info) {
   auto* mgr = sw_->getCaptureMgr();
   auto capture = make_unique<PktCapture>(
        info->name, info->maxPackets, info->direction, info->filter);
+  if (info->__isset.rotateBytes) {
+    PcapRotationOptions rotation;
+    rotation.segmentBytes = info->rotateBytes;
+    if (info->__isset.rotateSeconds) {
+      rotation.segmentDuration =
+          std::chrono::seconds(info->rotateSeconds);
+    }
+    if (info->__isset.maxFiles) {
+      rotation.maxSegments = info->maxFiles;
+    }
+    if (info->__isset.snaplen) {
+      rotation.snaplen = info->snaplen;
+    }
+    capture->setRotation(rotation);
+  }
   mgr->startCapture(std::move(capture));
 }
 
@@ -969,6 +1524,19 @@ void ThriftHandler::getRouteUpdateLoggingTrackedPrefixes(
   }
 }
 
+void ThriftHandler::getNextHopRouteCounts(
+    std::vector<NextHopRouteCount>& counts) {
+  for (const auto& ridCounts : sw_->getNexthopToRouteCount()->getCounts()) {
+    for (const auto& nhopCount : ridCounts.second) {
+      NextHopRouteCount count;
+      count.vrf = ridCounts.first;
+      count.nextHop = nhopCount.first.toThrift();
+      count.routeCount = nhopCount.second;
+      counts.push_back(std::move(count));
+    }
+  }
+}
+
 void ThriftHandler::beginPacketDump(int32_t port) {
   // Client construction is serialized via SwSwitch event base
   sw_->constructPushClient(port);
@@ -1116,6 +1684,13 @@ void ThriftHandler::connectionDestroyed(TConnectionContext* ctx) {
     listeners_->clients.erase(ctx);
   }
 
+  // State export subscriptions
+  SYNCHRONIZED(stateExporter_) {
+    if (stateExporter_) {
+      stateExporter_->unsubscribe(ctx);
+    }
+  }
+
   // If there is an ongoing high-resolution counter subscription, kill it. Don't
   // grab a write lock if there are no active calls
   if (!as_const(highresKillSwitches_)->empty()) {
@@ -1155,15 +1730,23 @@ void ThriftHandler::async_tm_subscribeToCounters(
     auto producer = make_unique<SampleProducer>(
         std::move(samplers), std::move(sender), std::move(killSwitch),
         eventBase, *req.get(), numCounters);
-    auto wrappedProducer = folly::makeMoveWrapper(std::move(producer));
     auto veryNice = req->veryNice;
-    std::thread producerThread([wrappedProducer, veryNice]() mutable {
-      if (veryNice) {
-        incNiceValue(20);
-      }
-      (*wrappedProducer)->produce();
-    });
-    producerThread.detach();
+    if (FLAGS_highres_shared_sample_loop && !veryNice &&
+        req->sleepMethod == SleepMethod::NANOSLEEP) {
+      std::call_once(sampleLoopInit_, [this]() {
+        sampleLoop_ = std::make_unique<SampleLoop>();
+      });
+      sampleLoop_->addProducer(std::move(producer), req->counterSet);
+    } else {
+      auto wrappedProducer = folly::makeMoveWrapper(std::move(producer));
+      std::thread producerThread([wrappedProducer, veryNice]() mutable {
+        if (veryNice) {
+          incNiceValue(20);
+        }
+        (*wrappedProducer)->produce();
+      });
+      producerThread.detach();
+    }
 
     callback->result(true);
   } else {
@@ -1213,4 +1796,44 @@ SwitchRunState ThriftHandler::getSwitchRunState() {
   return sw_->getSwitchRunState();
 }
 
+void ThriftHandler::getSlowestStateUpdates(
+    std::vector<StateUpdateTiming>& timings,
+    int32_t count) {
+  if (count < 0) {
+    throw FbossError("count must not be negative, got ", count);
+  }
+  timings = sw_->getSlowestStateUpdates(count);
+}
+
+void ThriftHandler::getStateMemoryUsage(
+    std::map<std::string, StateMemoryUsage>& usage) {
+  ensureConfigured();
+  for (const auto& typeUsage : sw_->getStateMemoryUsage().getUsage()) {
+    auto& entry = usage[typeUsage.first];
+    entry.count = typeUsage.second.count;
+    entry.bytes = typeUsage.second.bytes;
+  }
+}
+
+void ThriftHandler::async_eb_subscribeToStateChanges(
+    ThriftCallback<std::unique_ptr<StateExportUpdate>> cb,
+    std::unique_ptr<std::vector<std::string>> subtrees) {
+  auto ctx = cb->getConnectionContext()->getConnectionContext();
+  auto client = ctx->getDuplexClient<StateListenerClientAsyncClient>();
+  try {
+    auto toExport = StateExporter::getSubtrees(*subtrees);
+    auto snapshot = make_unique<StateExportUpdate>();
+    SYNCHRONIZED(stateExporter_) {
+      if (!stateExporter_) {
+        stateExporter_ = make_unique<StateExporter>(sw_);
+      }
+      *snapshot = stateExporter_->subscribe(
+          ctx, std::move(client), cb->getEventBase(), std::move(toExport));
+    }
+    cb->result(std::move(snapshot));
+  } catch (const std::exception& ex) {
+    fail(cb, ex);
+  }
+}
+
 }} // facebook::fboss
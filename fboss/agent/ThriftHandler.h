@@ -9,10 +9,12 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include "common/fb303/cpp/FacebookBase2.h"
 #include "fboss/agent/FbossError.h"
@@ -21,9 +23,11 @@
 #include "fboss/agent/if/gen-cpp2/FbossCtrl.h"
 #include "fboss/agent/if/gen-cpp2/NeighborListenerClient.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/state/RouteLookupTable.h"
 
 #include <folly/Synchronized.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <thrift/lib/cpp/server/TServerEventHandler.h>
 #include <thrift/lib/cpp2/async/DuplexChannel.h>
 
@@ -31,6 +35,7 @@ namespace facebook { namespace fboss {
 
 class AggregatePort;
 class Port;
+class StateExporter;
 class SwSwitch;
 class Vlan;
 
@@ -49,6 +54,7 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
   typedef std::vector<BinaryAddress> BinaryAddresses;
 
   explicit ThriftHandler(SwSwitch* sw);
+  ~ThriftHandler() override;
 
   fb303::cpp2::fb_status getStatus() override;
 
@@ -68,9 +74,18 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       std::unique_ptr<std::vector<UnicastRoute>> routes) override;
   void deleteUnicastRoutes(
       int16_t client, std::unique_ptr<std::vector<IpPrefix>> prefixes) override;
+  int64_t enqueueAddUnicastRoutes(
+      int16_t client,
+      std::unique_ptr<std::vector<UnicastRoute>> routes) override;
+  int64_t enqueueDeleteUnicastRoutes(
+      int16_t client,
+      std::unique_ptr<std::vector<IpPrefix>> prefixes) override;
+  bool waitForRouteUpdates(int64_t seq, int32_t timeoutMs) override;
   void syncFib(
       int16_t client,
       std::unique_ptr<std::vector<UnicastRoute>> routes) override;
+  int64_t beginGracefulRestart(int16_t client) override;
+  int64_t endOfRib(int16_t client) override;
 
   SwSwitch* getSw() const {
     return sw_;
@@ -102,6 +117,15 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
                   std::unique_ptr<Address> addr, int32_t vrfId) override;
   void getIpRouteDetails(RouteDetails& route,
                          std::unique_ptr<Address> addr, int32_t vrfId) override;
+  /* The same for a batch of addresses, in the order they were given */
+  void getIpRoutes(
+      std::vector<UnicastRoute>& routes,
+      std::unique_ptr<std::vector<Address>> addrs,
+      int32_t vrfId) override;
+  void getIpRoutesDetails(
+      std::vector<RouteDetails>& routes,
+      std::unique_ptr<std::vector<Address>> addrs,
+      int32_t vrfId) override;
   void getAllInterfaces(
       std::map<int32_t, InterfaceDetail>& interfaces) override;
   void getInterfaceList(std::vector<std::string>& interfaceList) override;
@@ -111,6 +135,36 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       std::vector<UnicastRoute>& routeTable, int16_t clientId) override;
   void getRouteTableDetails(std::vector<RouteDetails>& routeTable) override;
 
+  /*
+   * The bulk reads below build large responses. They are served from the
+   * --thrift_read_threads pool rather than the thrift worker threads, so
+   * they don't hold up route programming calls.
+   */
+  void async_tm_getRouteTableDetails(
+      ThriftCallback<std::unique_ptr<std::vector<RouteDetails>>> callback)
+      override;
+  void async_tm_getAllPortInfo(
+      ThriftCallback<std::unique_ptr<std::map<int32_t, PortInfoThrift>>>
+          callback) override;
+  void async_tm_getArpTable(
+      ThriftCallback<std::unique_ptr<std::vector<ArpEntryThrift>>> callback)
+      override;
+  void async_tm_getNdpTable(
+      ThriftCallback<std::unique_ptr<std::vector<NdpEntryThrift>>> callback)
+      override;
+  void async_tm_getAggregatePortTable(
+      ThriftCallback<std::unique_ptr<std::vector<AggregatePortThrift>>>
+          callback) override;
+  void async_tm_getLldpNeighbors(
+      ThriftCallback<std::unique_ptr<std::vector<LinkNeighborThrift>>>
+          callback) override;
+  void getRouteTablePage(
+      RouteTablePage& page,
+      std::unique_ptr<RouteTablePageRequest> request) override;
+  void getRouteTableDetailsPage(
+      RouteDetailsPage& page,
+      std::unique_ptr<RouteTablePageRequest> request) override;
+
   void getPortStatus(std::map<int32_t, PortStatus>& status,
                      std::unique_ptr<std::vector<int32_t>> ports)
                      override;
@@ -125,6 +179,18 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
   void getRunningConfig(std::string& configStr) override;
   void getArpTable(std::vector<ArpEntryThrift>& arpTable) override;
   void getL2Table(std::vector<L2EntryThrift>& l2Table) override;
+  void getL2TablePage(
+      L2TablePage& page,
+      std::unique_ptr<L2TablePageRequest> request) override;
+  void getQueueBufferStats(
+      std::vector<QueueBufferStats>& stats,
+      int32_t windowSeconds) override;
+  void getEcmpBalance(
+      std::vector<EcmpGroupBalance>& groups,
+      int32_t maxGroups) override;
+  void traceFlowHashing(
+      FlowHashingReport& report,
+      std::unique_ptr<std::vector<FlowTuple>> flows) override;
   void getAggregatePort(
       AggregatePortThrift& aggregatePortThrift,
       int32_t aggregatePortIDThrift) override;
@@ -156,6 +222,7 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       std::unique_ptr<std::string> identifier) override;
   void getRouteUpdateLoggingTrackedPrefixes(
       std::vector<RouteUpdateLoggingInfo>& infos) override;
+  void getNextHopRouteCounts(std::vector<NextHopRouteCount>& counts) override;
   /*
    * Event handler for when a connection is destroyed.  When there is an ongoing
    * duplex connection, there may be other threads that depend on the connection
@@ -234,6 +301,14 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       std::unique_ptr<std::string> jsonPatch) override;
 
   SwitchRunState getSwitchRunState() override;
+  void getSlowestStateUpdates(
+      std::vector<StateUpdateTiming>& timings,
+      int32_t count) override;
+  void getStateMemoryUsage(
+      std::map<std::string, StateMemoryUsage>& usage) override;
+  void async_eb_subscribeToStateChanges(
+      ThriftCallback<std::unique_ptr<StateExportUpdate>> cb,
+      std::unique_ptr<std::vector<std::string>> subtrees) override;
  protected:
   void ensureConfigured(folly::StringPiece function);
   void ensureConfigured() {
@@ -281,6 +356,14 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       const std::shared_ptr<Port> port);
   void fillPortStats(PortInfoThrift& portInfo, int numPortQs = 0);
 
+  /*
+   * Call fn with the longest match in vrfId for each of addrs in turn, a
+   * null route if there is none.
+   */
+  template <typename Fn>
+  void forEachLongestMatch(
+      const std::vector<Address>& addrs, int32_t vrfId, Fn fn);
+
   Vlan* getVlan(int32_t vlanId);
   Vlan* getVlan(const std::string& vlanName);
   template<typename ADDR_TYPE, typename ADDR_CONVERTER>
@@ -305,6 +388,16 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
     callback->exception(error);
   }
 
+  /*
+   * Have one of the read threads fill in a Result with read and send it
+   * back through callback. Fails the call right away if too many reads are
+   * queued up already.
+   */
+  template <typename Result, typename ReadFn>
+  void offloadRead(
+      ThriftCallback<std::unique_ptr<Result>> callback,
+      ReadFn read);
+
   /*
    * A pointer to the SwSwitch.  We don't own this.
    * It's the main program's responsibility to ensure that the SwSwitch exists
@@ -320,5 +413,26 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
   folly::Synchronized<
       std::unordered_map<const apache::thrift::server::TConnectionContext*,
                          std::shared_ptr<Signal>>> highresKillSwitches_;
+
+  // The thread sampling highres subscriptions which don't need one of their
+  // own, started with the first such subscription
+  std::once_flag sampleLoopInit_;
+  std::unique_ptr<SampleLoop> sampleLoop_;
+
+  // Exports the state to the subscribers of subscribeToStateChanges,
+  // created with the first subscription
+  folly::Synchronized<std::unique_ptr<StateExporter>> stateExporter_;
+
+  // The lookup tables last built for a batch of route lookups, per vrf
+  template <typename AddrT>
+  using RouteLookupTables =
+      std::map<RouterID, std::shared_ptr<const RouteLookupTable<AddrT>>>;
+  folly::Synchronized<RouteLookupTables<folly::IPAddressV4>> v4LookupTables_;
+  folly::Synchronized<RouteLookupTables<folly::IPAddressV6>> v6LookupTables_;
+
+  // Serves the bulk reads, null if they are served inline
+  std::unique_ptr<folly::CPUThreadPoolExecutor> readExecutor_;
+  // The reads queued or running on readExecutor_
+  std::atomic<int32_t> pendingReads_{0};
 };
 }} // facebook::fboss
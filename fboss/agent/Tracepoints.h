@@ -0,0 +1,38 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/tracing/StaticTracepoint.h>
+
+/*
+ * Static (USDT) tracepoints of the agent, all under the "fboss" provider,
+ * e.g. to time the hardware side of the state updates on a running box:
+ *
+ *   bpftrace -e 'usdt:/usr/sbin/wedge_agent:fboss:hw_state_changed_begin
+ *     { @s[arg0] = nsecs } ...'
+ *
+ * A disabled tracepoint is a nop in the code plus a note in the binary, so
+ * they can stay in the hot paths. Their arguments are evaluated all the
+ * same though: only pass what is already at hand and costs nothing to
+ * compute, i.e. integers and pointers, with addresses as a pointer to the
+ * network order bytes and their length rather than as formatted strings.
+ *
+ *   state_update_queued(name, priority)
+ *   state_update_applied(name, failed)           software side only
+ *   hw_state_changed_begin(generation)
+ *   hw_state_changed_end(generation, inSync)
+ *   pkt_rx(port, length)
+ *   pkt_tx(port, length)                         port is -1 when switched
+ *   neighbor_resolved(addr, addrLen, vlan, port)
+ *   neighbor_pending(addr, addrLen, vlan)
+ *   bcm_route_program(vrf, addr, addrLen, maskLen)
+ *   bcm_host_program(vrf, addr, addrLen, port)
+ */
+#define FBOSS_TRACEPOINT(name, ...) FOLLY_SDT(fboss, name, ##__VA_ARGS__)
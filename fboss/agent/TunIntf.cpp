@@ -13,6 +13,7 @@ extern "C" {
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <libnetlink.h>
 #include <linux/if.h>
@@ -25,6 +26,8 @@ extern "C" {
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventHandler.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/NlError.h"
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
@@ -32,6 +35,16 @@ extern "C" {
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/packet/EthHdr.h"
 
+DEFINE_int32(
+    tun_host_queue_length,
+    1024,
+    "Most packets to queue up for the host on each tun interface, before "
+    "dropping them");
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
 namespace facebook { namespace fboss {
 
 namespace {
@@ -41,6 +54,10 @@ const std::string kTunDev = "/dev/net/tun";
 // Max packets to be processed which are received from host
 const int kMaxSentOneTime = 16;
 
+// Most buffers a packet to the host may be chained over before we would
+// rather coalesce it than write it out as is
+const size_t kMaxIovecs = 16;
+
 // Definition of `iplink_req` as it is not well defined in any header files
 struct iplink_req {
   struct nlmsghdr         n;
@@ -70,10 +87,13 @@ TunIntf::TunIntf(
     int mtu)
     : folly::EventHandler(evb),
       sw_(sw),
+      evb_(evb),
       name_(util::createTunIntfName(ifID)),
       ifID_(ifID),
       ifIndex_(ifIndex),
-      mtu_(mtu) {
+      mtu_(mtu),
+      hostQueueKey_("tun." + name_ + ".host_queue"),
+      hostLatencyKey_("tun." + name_ + ".host_latency.us") {
   DCHECK(sw) << "NULL pointer to SwSwitch.";
   DCHECK(evb) << "NULL pointer to EventBase";
 
@@ -101,11 +121,14 @@ TunIntf::TunIntf(
     int mtu)
     : folly::EventHandler(evb),
       sw_(sw),
+      evb_(evb),
       name_(util::createTunIntfName(ifID)),
       ifID_(ifID),
       status_(status),
       addrs_(addr),
-      mtu_(mtu) {
+      mtu_(mtu),
+      hostQueueKey_("tun." + name_ + ".host_queue"),
+      hostLatencyKey_("tun." + name_ + ".host_latency.us") {
   DCHECK(sw) << "NULL pointer to SwSwitch.";
   DCHECK(evb) << "NULL pointer to EventBase";
 
@@ -165,6 +188,7 @@ TunIntf::~TunIntf() {
 
   // Close FD. This will delete the interface if TUNSETPERSIST is not on
   closeFD();
+  tcData().clearCounter(hostQueueKey_);
   XLOG(INFO) << (toDelete_ ? "Delete" : "Detach") << " interface " << name_;
 }
 
@@ -296,20 +320,20 @@ void TunIntf::disableIPv6AddrGenMode(int ifIndex) {
 void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
   CHECK(fd_ != -1);
 
-  // Since this is L3 packet size, we should also reserve some space for L2
-  // header, which is 18 bytes (including one vlan tag)
+  // Read each packet into readBuf_ before copying it into a TxPacket of
+  // its size. Most packets from the host (BGP, BFD, ND) are far smaller
+  // than the MTU, and that way we don't allocate a packet for the read
+  // that finds nothing left either.
+  readBuf_.resize(mtu_);
   int sent = 0;
   int dropped = 0;
   uint64_t bytes = 0;
   bool fdFail = false;
   try {
     while (sent + dropped < kMaxSentOneTime) {
-      std::unique_ptr<TxPacket> pkt;
-      pkt = sw_->allocateL3TxPacket(mtu_);
-      auto buf = pkt->buf();
       int ret = 0;
       do {
-        ret = read(fd_, buf->writableTail(), buf->tailroom());
+        ret = read(fd_, readBuf_.data(), readBuf_.size());
       } while (ret == -1 && errno == EINTR);
       if (ret < 0) {
         if (errno != EAGAIN) {
@@ -324,13 +348,18 @@ void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
         // in debug mode.
         DCHECK(false) << "Unexpected event. Nothing to read.";
         break;
-      } else if (ret > buf->tailroom()) {
+      } else if (static_cast<size_t>(ret) > readBuf_.size()) {
         // The pkt is larger than the buffer. We don't have complete packet.
         // It shall not happen unless the MTU is mis-match. Drop the packet.
-        XLOG(ERR) << "Too large packet (" << ret << " > " << buf->tailroom()
+        XLOG(ERR) << "Too large packet (" << ret << " > " << readBuf_.size()
                   << ") received from host. Drop the packet.";
         ++dropped;
       } else {
+        // This reserves some space for the L2 header as well, which is 18
+        // bytes (including one vlan tag)
+        auto pkt = sw_->allocateL3TxPacket(ret);
+        auto buf = pkt->buf();
+        memcpy(buf->writableTail(), readBuf_.data(), ret);
         bytes += ret;
         buf->append(ret);
         sw_->sendL3Packet(std::move(pkt), ifID_);
@@ -364,16 +393,90 @@ bool TunIntf::sendPacketToHost(std::unique_ptr<RxPacket> pkt) {
   // skip L2 header
   buf->trimStart(l2Len);
 
-  int ret = 0;
+  // Only the first packet of a burst schedules a drain, the rest are
+  // written out along with it
+  size_t depth = 0;
+  bool scheduleDrain = false;
+  {
+    auto queue = hostQueue_.wlock();
+    if (queue->packets.size() >=
+        static_cast<size_t>(FLAGS_tun_host_queue_length)) {
+      XLOG(DBG4) << "Host queue of interface " << ifID_
+                 << " is full, dropping packet";
+      return false;
+    }
+    queue->packets.push_back({std::move(pkt), steady_clock::now()});
+    depth = queue->packets.size();
+    scheduleDrain = !queue->drainScheduled;
+    queue->drainScheduled = true;
+  }
+  tcData().setCounter(hostQueueKey_, depth);
+
+  if (scheduleDrain) {
+    std::weak_ptr<bool> alive = alive_;
+    evb_->runInEventBaseThread([this, alive]() {
+      // We are destroyed on the evb thread too, so if we are still alive
+      // now we will be for the rest of the drain
+      if (alive.lock()) {
+        drainToHost();
+      }
+    });
+  }
+  return true;
+}
+
+void TunIntf::drainToHost() {
+  std::deque<QueuedPacket> packets;
+  {
+    auto queue = hostQueue_.wlock();
+    packets.swap(queue->packets);
+    queue->drainScheduled = false;
+  }
+  tcData().setCounter(hostQueueKey_, 0);
+
+  if (!hostLatency_) {
+    using TLTimeseries = stats::ThreadCachedServiceData::TLTimeseries;
+    hostLatency_ = std::make_unique<TLTimeseries>(
+        tcData().getThreadStats(), hostLatencyKey_, stats::AVG);
+  }
+  for (auto& queued : packets) {
+    if (writeToHost(queued.pkt->buf())) {
+      auto latency = duration_cast<microseconds>(
+          steady_clock::now() - queued.queued);
+      hostLatency_->addValue(latency.count());
+    }
+  }
+}
+
+bool TunIntf::writeToHost(folly::IOBuf* buf) {
+  // Each write to a tun fd is a packet of its own, so packets can't share
+  // a writev(), but a chained packet can go out without being coalesced
+  if (buf->countChainElements() > kMaxIovecs) {
+    buf->coalesce();
+  }
+  struct iovec iov[kMaxIovecs];
+  size_t count = 0;
+  size_t len = 0;
+  for (auto range : *buf) {
+    if (range.empty()) {
+      continue;
+    }
+    iov[count].iov_base = const_cast<uint8_t*>(range.data());
+    iov[count].iov_len = range.size();
+    ++count;
+    len += range.size();
+  }
+
+  ssize_t ret = 0;
   do {
-    ret = write(fd_, buf->data(), buf->length());
+    ret = writev(fd_, iov, count);
   } while (ret == -1 && errno == EINTR);
   if (ret < 0) {
     sysLogError(ret, "Failed to send packet to host from Interface ", ifID_);
     return false;
-  } else if (ret < buf->length()) {
+  } else if (static_cast<size_t>(ret) < len) {
     XLOG(ERR) << "Failed to send full packet to host from Interface " << ifID_
-              << ". " << ret << " bytes sent instead of " << buf->length();
+              << ". " << ret << " bytes sent instead of " << len;
     return false;
   }
 
@@ -9,12 +9,20 @@
  */
 #pragma once
 
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/state/StateUtils.h"
+#include <folly/Synchronized.h>
+#include <folly/io/IOBuf.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventHandler.h>
 
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
 class SwSwitch;
@@ -89,8 +97,11 @@ class TunIntf : private folly::EventHandler {
    * Unlike other methods, which are called on thread that serves the evb,
    * this function can be called from any thread.
    *
-   * @return true The packet is sent to host
-   *         false The packet is dropped due to errors
+   * The packet is only queued up here, and written out from the thread that
+   * serves the evb along with whatever else was queued up by then.
+   *
+   * @return true The packet is queued up for the host
+   *         false The packet is dropped due to errors or a full queue
    */
   bool sendPacketToHost(std::unique_ptr<RxPacket> pkt);
 
@@ -137,6 +148,18 @@ class TunIntf : private folly::EventHandler {
   void openFD();
   void closeFD() noexcept;
 
+  /**
+   * Write out the packets queued up for the host. Called on the thread that
+   * serves the evb.
+   */
+  void drainToHost();
+
+  /**
+   * Write a packet to the host, in one write however many buffers it is
+   * chained over.
+   */
+  bool writeToHost(folly::IOBuf* buf);
+
   /**
    * In newer kernel an interface is automatically gets link-local IPv6 address
    * because of IPv6 autoconf and FBOSS (we) assign one more.
@@ -147,6 +170,7 @@ class TunIntf : private folly::EventHandler {
   static void disableIPv6AddrGenMode(int ifIndex);
 
   SwSwitch *sw_{nullptr};
+  folly::EventBase *evb_{nullptr};
 
   const std::string name_{""};  // The name in the host
   const InterfaceID ifID_{0};   // Switch interface ID
@@ -163,6 +187,31 @@ class TunIntf : private folly::EventHandler {
    */
   int fd_{-1};
   int mtu_{-1};
+
+  /**
+   * Packets from the host are read in here first, so that we only allocate
+   * TxPackets of the size they turn out to be rather than of the full MTU.
+   * Only used from handlerReady().
+   */
+  std::vector<uint8_t> readBuf_;
+
+  struct QueuedPacket {
+    std::unique_ptr<RxPacket> pkt;
+    std::chrono::steady_clock::time_point queued;
+  };
+  struct HostQueue {
+    std::deque<QueuedPacket> packets;
+    // Whether a drainToHost() is already on its way
+    bool drainScheduled{false};
+  };
+  folly::Synchronized<HostQueue> hostQueue_;
+  // Lets the drains scheduled on the evb tell if we are still around
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+  const std::string hostQueueKey_;
+  const std::string hostLatencyKey_;
+  // Resolved on the evb thread by the first drain, which is the only thread
+  // it is used from
+  std::unique_ptr<stats::ThreadCachedServiceData::TLTimeseries> hostLatency_;
 };
 
 }}  // nanesoace facebook::fboss
@@ -29,7 +29,9 @@ extern "C" {
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/state/InterfaceMap.h"
 #include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
 
 #include <boost/container/flat_set.hpp>
 
@@ -81,12 +83,60 @@ void TunManager::stateUpdated(const StateDelta& delta) {
   // SwSwitch is in the configured state. t4155406 should also help
   // with that.
 
-  auto state = delta.newState();
-  evb_->runInEventBaseThread([this, state]() {
+  if (!requiresSync(delta)) {
+    return;
+  }
+
+  // Only schedule a sync if there isn't one pending already, the pending one
+  // picks up this state when it runs.
+  bool scheduled = false;
+  pendingState_.withWLock([&](auto& pending) {
+    scheduled = pending != nullptr;
+    pending = delta.newState();
+  });
+  if (scheduled) {
+    return;
+  }
+  evb_->runInEventBaseThread([this]() {
+    std::shared_ptr<SwitchState> state;
+    pendingState_.wlock()->swap(state);
     this->sync(state);
   });
 }
 
+bool TunManager::requiresSync(const StateDelta& delta) {
+  // Interface added, removed, or changed addresses/mtu
+  const auto intfsDelta = delta.getIntfsDelta();
+  if (intfsDelta.begin() != intfsDelta.end()) {
+    return true;
+  }
+
+  // Interface status is derived from the ports in its vlans
+  for (const auto& portDelta : delta.getPortsDelta()) {
+    const auto& oldPort = portDelta.getOld();
+    const auto& newPort = portDelta.getNew();
+    if (!oldPort || !newPort) {
+      return true;
+    }
+    if (oldPort->isPortUp() != newPort->isPortUp() ||
+        oldPort->getVlans() != newPort->getVlans()) {
+      return true;
+    }
+  }
+
+  // Most vlan changes are to the arp/ndp tables, only the mapping to the
+  // interface matters here
+  for (const auto& vlanDelta : delta.getVlansDelta()) {
+    const auto& oldVlan = vlanDelta.getOld();
+    const auto& newVlan = vlanDelta.getNew();
+    if (!oldVlan || !newVlan ||
+        oldVlan->getInterfaceID() != newVlan->getInterfaceID()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool TunManager::sendPacketToHost(
     InterfaceID dstIfID,
     std::unique_ptr<RxPacket> pkt) {
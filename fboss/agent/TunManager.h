@@ -12,6 +12,7 @@
 #include "fboss/agent/types.h"
 #include "fboss/agent/StateObserver.h"
 #include "fboss/agent/state/Interface.h"
+#include <folly/Synchronized.h>
 #include <folly/io/async/EventBase.h>
 
 #include <boost/container/flat_map.hpp>
@@ -197,6 +198,14 @@ class TunManager : public StateObserver {
   static boost::container::flat_map<InterfaceID, bool> getInterfaceStatus(
       std::shared_ptr<SwitchState> state);
 
+  /**
+   * Whether a state update could change anything sync() programs on the
+   * host, i.e. the interfaces themselves, their addresses or MTU, or their
+   * status as derived from port state and vlan membership. Updates which only
+   * touch routes, neighbor tables, acls etc. leave the tun interfaces alone.
+   */
+  static bool requiresSync(const StateDelta& delta);
+
   template<typename MAPNAME,
            typename CHANGEFN, typename ADDFN, typename REMOVEFN>
   void applyChanges(const MAPNAME& oldMap, const MAPNAME& newMap,
@@ -225,6 +234,13 @@ class TunManager : public StateObserver {
 
   uint64_t numSyncs_{0};
 
+  /**
+   * The newest state waiting to be synced on evb_. sync() reconciles against
+   * the whole state, so when updates arrive faster than we can program them
+   * only the latest one needs to be applied.
+   */
+  folly::Synchronized<std::shared_ptr<SwitchState>> pendingState_;
+
   enum : uint8_t {
     /**
      * The protocol value used to add the source routing IP rule and the
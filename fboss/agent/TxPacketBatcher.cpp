@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/TxPacketBatcher.h"
+
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+
+#include "fboss/agent/TxPacket.h"
+
+namespace facebook { namespace fboss {
+
+TxPacketBatcher::TxPacketBatcher(
+    folly::EventBase* evb,
+    FlushHandler handler,
+    uint32_t maxBatchSize)
+    : evb_(evb), handler_(std::move(handler)), maxBatchSize_(maxBatchSize) {
+  CHECK_GT(maxBatchSize, 0);
+}
+
+void TxPacketBatcher::start() {
+  std::lock_guard<std::mutex> g(lock_);
+  running_ = true;
+}
+
+void TxPacketBatcher::stop() {
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    running_ = false;
+  }
+  flushAll();
+}
+
+void TxPacketBatcher::send(
+    std::unique_ptr<TxPacket> pkt,
+    PortID port,
+    folly::Optional<uint8_t> cos) {
+  Key key(port, cos);
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    if (running_) {
+      auto& batch = batches_[key];
+      if (batch.pkts.empty()) {
+        batch.oldestQueued = std::chrono::steady_clock::now();
+      }
+      batch.pkts.push_back(std::move(pkt));
+      if (batch.pkts.size() < maxBatchSize_) {
+        if (!flushScheduled_) {
+          flushScheduled_ = true;
+          evb_->runInEventBaseThread([this] { flushAll(); });
+        }
+        return;
+      }
+    }
+  }
+  if (pkt) {
+    // Not batching: send the packet on its own
+    Batch batch;
+    batch.oldestQueued = std::chrono::steady_clock::now();
+    batch.pkts.push_back(std::move(pkt));
+    std::lock_guard<std::mutex> g(flushLock_);
+    flush(key, std::move(batch));
+    return;
+  }
+  // The queue for this port is full, flush it right away. Take flushLock_
+  // before picking up the batch, so that it can't overtake an older batch
+  // for the same port being flushed by flushAll().
+  std::lock_guard<std::mutex> fg(flushLock_);
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto it = batches_.find(key);
+    if (it == batches_.end()) {
+      // Somebody else flushed it already
+      return;
+    }
+    batch = std::move(it->second);
+    batches_.erase(it);
+  }
+  flush(key, std::move(batch));
+}
+
+void TxPacketBatcher::flushAll() {
+  std::lock_guard<std::mutex> fg(flushLock_);
+  std::map<Key, Batch> batches;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    flushScheduled_ = false;
+    batches.swap(batches_);
+  }
+  for (auto& keyAndBatch : batches) {
+    flush(keyAndBatch.first, std::move(keyAndBatch.second));
+  }
+}
+
+void TxPacketBatcher::flush(const Key& key, Batch batch) {
+  if (batch.pkts.empty()) {
+    return;
+  }
+  handler_(key.first, key.second, std::move(batch.pkts), batch.oldestQueued);
+}
+
+}} // facebook::fboss
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+
+#include "fboss/agent/types.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace folly {
+class EventBase;
+}
+
+namespace facebook { namespace fboss {
+
+class TxPacket;
+
+/*
+ * TxPacketBatcher collects packets sent out of a given port into per
+ * (port, CoS) queues and hands each queue to the hardware in one go, so
+ * that bursts of control plane packets (gratuitous ARP floods, router
+ * advertisements, neighbor solicitations) cost one hardware send per port
+ * rather than one per packet.
+ *
+ * Queues are flushed from the given EventBase, soon after the first packet is
+ * queued, or right away on the sending thread once a queue holds
+ * maxBatchSize packets. Packets to the same port and CoS are flushed in the
+ * order they were sent.
+ */
+class TxPacketBatcher {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  using FlushHandler = std::function<void(
+      PortID port,
+      folly::Optional<uint8_t> cos,
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      TimePoint oldestQueued)>;
+
+  TxPacketBatcher(
+      folly::EventBase* evb,
+      FlushHandler handler,
+      uint32_t maxBatchSize);
+
+  /*
+   * Start and stop batching. Before start() and after stop(), every packet
+   * is flushed directly on the sending thread, as a batch of its own. stop()
+   * flushes the packets still queued.
+   */
+  void start();
+  void stop();
+
+  void send(
+      std::unique_ptr<TxPacket> pkt,
+      PortID port,
+      folly::Optional<uint8_t> cos);
+
+ private:
+  using Key = std::pair<PortID, folly::Optional<uint8_t>>;
+  struct Batch {
+    std::vector<std::unique_ptr<TxPacket>> pkts;
+    TimePoint oldestQueued;
+  };
+
+  void flushAll();
+  void flush(const Key& key, Batch batch);
+
+  // Forbidden copy constructor and assignment operator
+  TxPacketBatcher(TxPacketBatcher const &) = delete;
+  TxPacketBatcher& operator=(TxPacketBatcher const &) = delete;
+
+  folly::EventBase* evb_;
+  FlushHandler handler_;
+  const uint32_t maxBatchSize_;
+
+  // Held while handing batches to the handler, so that batches for the same
+  // port are flushed in order. Taken before lock_.
+  std::mutex flushLock_;
+  std::mutex lock_;
+  // Everything below is protected by lock_
+  std::map<Key, Batch> batches_;
+  // Whether a flushAll() call is already pending on evb_
+  bool flushScheduled_{false};
+  bool running_{false};
+};
+
+}} // facebook::fboss
@@ -24,7 +24,19 @@ using std::chrono::seconds;
 
 namespace facebook { namespace fboss {
 
-PcapFile::PktHeader::PktHeader(const PcapPkt& pkt) {
+PcapFile::GlobalHeader::GlobalHeader(uint32_t snaplen_) {
+  magic = 0xa1b2c3d4;
+  versionMajor = 2;
+  versionMinor = 4;
+  tzOffset = 0;
+  sigfigs = 0;
+  snaplen = snaplen_ ? snaplen_ : 0xffff;
+  // Link type 1 is ethernet.  Other possible types we might want to use
+  // include 113 for linux "cooked" capture format.
+  linkType = 1;
+}
+
+PcapFile::PktHeader::PktHeader(const PcapPkt& pkt, uint32_t snaplen) {
   auto ts = pkt.timestamp().time_since_epoch();
   seconds tsSec = std::chrono::duration_cast<seconds>(ts);
   microseconds tsUsec = std::chrono::duration_cast<microseconds>(ts);
@@ -32,7 +44,7 @@ PcapFile::PktHeader::PktHeader(const PcapPkt& pkt) {
 
   timeSec = tsSec.count();
   timeUsec = (tsUsec - tsSec).count();
-  includedLen = len;
+  includedLen = (snaplen && len > snaplen) ? snaplen : len;
   origLen = len;
 }
 
@@ -52,25 +64,7 @@ void PcapFile::close() {
 }
 
 void PcapFile::writeGlobalHeader() {
-  struct GlobalHeader {
-    uint32_t magic;
-    uint16_t versionMajor;
-    uint16_t versionMinor;
-    uint32_t tzOffset;
-    uint32_t sigfigs;
-    uint32_t snaplen;
-    uint32_t linkType;
-  } hdr;
-  hdr.magic = 0xa1b2c3d4;
-  hdr.versionMajor = 2;
-  hdr.versionMinor = 4;
-  hdr.tzOffset = 0;
-  hdr.sigfigs = 0;
-  hdr.snaplen = 0xffff;
-  // Link type 1 is ethernet.  Other possible types we might want to use
-  // include 113 for linux "cooked" capture format.
-  hdr.linkType = 1;
-
+  GlobalHeader hdr;
   int ret = writeFull(file_.fd(), &hdr, sizeof(hdr));
   folly::checkUnixError(ret, "error writing pcap global header");
 }
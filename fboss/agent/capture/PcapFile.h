@@ -39,9 +39,24 @@ class PcapFile {
   PcapFile(PcapFile&&) = default;
   PcapFile& operator=(PcapFile&&) = default;
 
- private:
+  /*
+   * The on disk pcap headers.
+   *
+   * A non-zero snaplen limits how much of each packet is captured.
+   */
+  struct GlobalHeader {
+    explicit GlobalHeader(uint32_t snaplen = 0);
+
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    uint32_t tzOffset;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linkType;
+  };
   struct PktHeader {
-    explicit PktHeader(const PcapPkt& pkt);
+    explicit PktHeader(const PcapPkt& pkt, uint32_t snaplen = 0);
 
     uint32_t timeSec{0};
     uint32_t timeUsec{0};
@@ -49,6 +64,8 @@ class PcapFile {
     uint32_t origLen{0};
   };
 
+ private:
+
   // Forbidden copy constructor and assignment operator
   PcapFile(PcapFile const &) = delete;
   PcapFile& operator=(PcapFile const &) = delete;
@@ -33,7 +33,9 @@ PcapPkt::PcapPkt(const RxPacket* pkt, TimePoint timestamp)
     timestamp_(timestamp),
     buf_(),
     reasons_() {
-  pkt->buf()->cloneInto(buf_);
+  // Captured packets are queued for the writer thread, so don't hold on to
+  // the receive buffer itself
+  buf_ = std::move(*pkt->copyBuf());
 }
 
 PcapPkt::PcapPkt(const TxPacket* pkt)
@@ -23,8 +23,8 @@ namespace facebook { namespace fboss {
 PcapQueue::PcapQueue(uint32_t pktCapacity, uint64_t bytesCapacity)
   : pktCapacity_(pktCapacity == 0 ?
                  FLAGS_fboss_pcap_queue_depth : pktCapacity),
-    bytesCapacity_(bytesCapacity) {
-  queue_.reserve(pktCapacity_);
+    bytesCapacity_(bytesCapacity),
+    queue_(pktCapacity_) {
 }
 
 PcapQueue::~PcapQueue() {
@@ -33,51 +33,38 @@ PcapQueue::~PcapQueue() {
 template<typename PktType>
 void PcapQueue::addPktInternal(const PktType* pkt) {
   // Check to see if this would exceed the queue capacity.
-  if (queue_.size() >= pktCapacity_) {
-    pktsDropped_ += 1;
-    return;
+  uint64_t pktBytes = 0;
+  if (bytesCapacity_ > 0) {
+    pktBytes = pkt->buf()->computeChainDataLength();
+    auto newBytes = bytesInQueue_.fetch_add(pktBytes) + pktBytes;
+    if (newBytes >= bytesCapacity_) {
+      bytesInQueue_.fetch_sub(pktBytes);
+      pktsDropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
   }
-  auto newBytes = bytesInQueue_ + pkt->buf()->computeChainDataLength();
-  if (bytesCapacity_ > 0 && newBytes >= bytesCapacity_) {
-    pktsDropped_ += 1;
+  // The PcapPkt is constructed in place in the queue slot
+  if (!queue_.write(pkt)) {
+    bytesInQueue_.fetch_sub(pktBytes);
+    pktsDropped_.fetch_add(1, std::memory_order_relaxed);
     return;
   }
 
-  queue_.emplace_back(pkt);
-}
-
-void PcapQueue::addPkt(const RxPacket* pkt) {
-  {
+  // This pairs with the reader setting readerWaiting_ before checking
+  // whether the queue is empty: either the reader sees our packet, or we see
+  // that it is waiting and wake it up.
+  if (readerWaiting_.load()) {
     std::lock_guard<std::mutex> guard(mutex_);
-    addPktInternal(pkt);
+    cv_.notify_one();
   }
-  cv_.notify_one();
 }
 
-void PcapQueue::addPktLocked(const RxPacket* pkt) {
+void PcapQueue::addPkt(const RxPacket* pkt) {
   addPktInternal(pkt);
-  // It is preferred not to be holding the lock when we signal cv_,
-  // but it is okay to call it with the lock held anyway.  (Having the lock
-  // held will just prevent the reader thread from being able to acquire it
-  // immediately when the reader wakes.)
-  cv_.notify_one();
 }
 
 void PcapQueue::addPkt(const TxPacket* pkt) {
-  {
-    std::lock_guard<std::mutex> guard(mutex_);
-    addPktInternal(pkt);
-  }
-  cv_.notify_one();
-}
-
-void PcapQueue::addPktLocked(const TxPacket* pkt) {
   addPktInternal(pkt);
-  // It is preferred not to be holding the lock when we signal cv_,
-  // but it is okay to call it with the lock held anyway.  (Having the lock
-  // held will just prevent the reader thread from being able to acquire it
-  // immediately when the reader wakes.)
-  cv_.notify_one();
 }
 
 void PcapQueue::finish() {
@@ -92,27 +79,42 @@ bool PcapQueue::isFinished() const {
 }
 
 uint64_t PcapQueue::numDropped() const {
-  std::lock_guard<std::mutex> guard(mutex_);
-  return pktsDropped_;
+  return pktsDropped_.load(std::memory_order_relaxed);
+}
+
+void PcapQueue::drain(std::vector<PcapPkt>* pkts) {
+  PcapPkt pkt;
+  uint64_t bytes = 0;
+  while (pkts->size() < pktCapacity_ && queue_.read(pkt)) {
+    if (bytesCapacity_ > 0) {
+      bytes += pkt.buf()->computeChainDataLength();
+    }
+    pkts->push_back(std::move(pkt));
+  }
+  bytesInQueue_.fetch_sub(bytes);
 }
 
 bool PcapQueue::wait(std::vector<PcapPkt>* swapQueue) {
   swapQueue->clear();
   swapQueue->reserve(pktCapacity_);
 
-  std::unique_lock<std::mutex> guard(mutex_);
-  while (queue_.empty() && !finished_) {
-    cv_.wait(guard);
-  }
-  if (queue_.empty()) {
-    DCHECK(finished_);
-    queue_.shrink_to_fit();
-    return false;
+  while (true) {
+    drain(swapQueue);
+    if (!swapQueue->empty()) {
+      return true;
+    }
+
+    std::unique_lock<std::mutex> guard(mutex_);
+    readerWaiting_.store(true);
+    while (queue_.isEmpty() && !finished_) {
+      cv_.wait(guard);
+    }
+    readerWaiting_.store(false);
+    if (queue_.isEmpty()) {
+      DCHECK(finished_);
+      return false;
+    }
   }
-
-  swapQueue->swap(queue_);
-  bytesInQueue_ = 0;
-  return true;
 }
 
 }} // facebook::fboss
@@ -9,6 +9,11 @@
  */
 #pragma once
 
+#include <folly/MPMCQueue.h>
+
+#include "fboss/agent/capture/PcapPkt.h"
+
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <vector>
@@ -17,14 +22,19 @@ namespace facebook { namespace fboss {
 
 class RxPacket;
 class TxPacket;
-class PcapPkt;
 
 /*
  * PcapQueue stores a queue of PcapPkt objects, for transferring packets
  * from an asynchronous capture thread to a blocking thread that will process
  * the packets.  (For instance, writing them to disk using blocking I/O.)
  *
- * There can only be a single reader.
+ * Packets are copied straight into the preallocated slots of a bounded lock
+ * free queue, so adding a packet never blocks the thread capturing it. The
+ * reader is only woken up when it is waiting for packets, and then picks up
+ * everything queued in one go.
+ *
+ * Packets may be added from any number of threads, but there can only be a
+ * single reader.
  */
 class PcapQueue {
  public:
@@ -32,25 +42,11 @@ class PcapQueue {
   virtual ~PcapQueue();
 
   uint32_t getPktCapacity() const {
-    // pktCapacity_ is const, so no need for locking
     return pktCapacity_;
   }
 
-  /*
-   * Get the mutex protecting this PcapQueue.
-   *
-   * This is exposed to allow callers to also protect their own data
-   * with the same mutex if desired.  Callers should call addPktLocked()
-   * instead of addPkt() when they are already holding the PcapQueue mutex.
-   */
-  std::mutex& mutex() const {
-    return mutex_;
-  }
-
   void addPkt(const RxPacket* pkt);
-  void addPktLocked(const RxPacket* pkt);
   void addPkt(const TxPacket* pkt);
-  void addPktLocked(const TxPacket* pkt);
 
   /*
    * finish() signals that no more packets will be added to the queue.
@@ -86,16 +82,22 @@ class PcapQueue {
 
   template<typename PktType>
   void addPktInternal(const PktType* pkt);
+  void drain(std::vector<PcapPkt>* pkts);
+
+  const uint32_t pktCapacity_{0};
+  const uint64_t bytesCapacity_{0};
+  std::atomic<uint64_t> bytesInQueue_{0};
+  std::atomic<uint64_t> pktsDropped_{0};
+  folly::MPMCQueue<PcapPkt> queue_;
 
+  // Whether the reader is (about to start) sleeping on cv_. Writers only
+  // need to wake it up if it is.
+  std::atomic<bool> readerWaiting_{false};
+  // mutex_ and cv_ are only used to put the reader to sleep, and protect
+  // finished_.
   mutable std::mutex mutex_;
   std::condition_variable cv_;
-
   bool finished_{false};
-  const uint32_t pktCapacity_{0};
-  uint64_t bytesCapacity_{0};
-  uint64_t bytesInQueue_{0};
-  uint64_t pktsDropped_{0};
-  std::vector<PcapPkt> queue_;
 };
 
 }} // facebook::fboss
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/capture/PcapRotatingFile.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/capture/PcapFile.h"
+#include "fboss/agent/capture/PcapPkt.h"
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Anything smaller can't hold the headers and a minimum sized ethernet frame
+constexpr uint64_t kMinSegmentBytes = 4096;
+}
+
+namespace facebook { namespace fboss {
+
+PcapRotatingFile::PcapRotatingFile(
+    folly::StringPiece path,
+    const PcapRotationOptions& options)
+    : path_(path.str()), options_(options) {
+  if (options_.segmentBytes < kMinSegmentBytes) {
+    throw FbossError("pcap file size must be at least ", kMinSegmentBytes,
+                     " bytes, got ", options_.segmentBytes);
+  }
+  openSegment();
+}
+
+PcapRotatingFile::~PcapRotatingFile() {
+  try {
+    close();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error closing pcap file " << segments_.back() << ": "
+              << folly::exceptionStr(ex);
+  }
+}
+
+std::string PcapRotatingFile::segmentPath(
+    folly::StringPiece path,
+    uint64_t index) {
+  return folly::to<std::string>(path, ".", index);
+}
+
+void PcapRotatingFile::close() {
+  closeSegment();
+}
+
+void PcapRotatingFile::writePackets(const std::vector<PcapPkt>& pkts) {
+  if (map_ && options_.segmentDuration.count() > 0 &&
+      std::chrono::steady_clock::now() - segmentStart_ >=
+          options_.segmentDuration) {
+    closeSegment();
+  }
+
+  for (const auto& pkt : pkts) {
+    PcapFile::PktHeader hdr(pkt, options_.snaplen);
+    if (map_ &&
+        used_ + sizeof(hdr) + hdr.includedLen > options_.segmentBytes) {
+      closeSegment();
+    }
+    if (!map_) {
+      openSegment();
+    }
+    // A packet larger than an entire file is truncated to fit
+    auto room = options_.segmentBytes - used_ - sizeof(hdr);
+    if (hdr.includedLen > room) {
+      hdr.includedLen = room;
+    }
+
+    append(&hdr, sizeof(hdr));
+    uint32_t left = hdr.includedLen;
+    for (const auto& range : *pkt.buf()) {
+      if (left == 0) {
+        break;
+      }
+      auto n = std::min<size_t>(range.size(), left);
+      append(range.data(), n);
+      left -= n;
+    }
+  }
+}
+
+void PcapRotatingFile::openSegment() {
+  DCHECK(!map_);
+  auto path = segmentPath(path_, nextIndex_++);
+  file_ = folly::File(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+
+  // Allocate the blocks up front: running out of disk space while writing to
+  // a sparse mapping would get us a SIGBUS rather than an error.
+  int err = posix_fallocate(file_.fd(), 0, options_.segmentBytes);
+  if (err != 0) {
+    folly::throwSystemErrorExplicit(err, "error allocating pcap file ", path);
+  }
+  void* map = mmap(
+      nullptr,
+      options_.segmentBytes,
+      PROT_WRITE,
+      MAP_SHARED,
+      file_.fd(),
+      0);
+  if (map == MAP_FAILED) {
+    folly::throwSystemError("error mapping pcap file ", path);
+  }
+  map_ = static_cast<uint8_t*>(map);
+  used_ = 0;
+  segmentStart_ = std::chrono::steady_clock::now();
+
+  segments_.push_back(path);
+  if (options_.maxSegments > 0 && segments_.size() > options_.maxSegments) {
+    if (unlink(segments_.front().c_str()) != 0) {
+      XLOG(ERR) << "error removing old pcap file " << segments_.front()
+                << ": " << folly::errnoStr(errno);
+    }
+    segments_.pop_front();
+  }
+
+  PcapFile::GlobalHeader globalHdr(options_.snaplen);
+  append(&globalHdr, sizeof(globalHdr));
+}
+
+void PcapRotatingFile::closeSegment() {
+  if (!map_) {
+    return;
+  }
+  munmap(map_, options_.segmentBytes);
+  map_ = nullptr;
+  // Give back the space we preallocated but didn't use
+  folly::checkUnixError(
+      ftruncate(file_.fd(), used_), "error truncating pcap file");
+  file_.close();
+}
+
+void PcapRotatingFile::append(const void* data, size_t length) {
+  DCHECK_LE(used_ + length, options_.segmentBytes);
+  memcpy(map_ + used_, data, length);
+  used_ += length;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class PcapPkt;
+
+struct PcapRotationOptions {
+  // Size of each capture file. Files are preallocated to this size, and
+  // trimmed down to what was written to them when they are closed.
+  uint64_t segmentBytes{64 * 1024 * 1024};
+  // Also start a new file once the current one is this old. 0 disables time
+  // based rotation.
+  std::chrono::seconds segmentDuration{0};
+  // Number of files to keep. The oldest file is deleted when a new one is
+  // started. 0 keeps all of them.
+  uint32_t maxSegments{0};
+  // Only capture up to this many bytes of each packet. 0 captures entire
+  // packets (as long as they fit in a file).
+  uint32_t snaplen{0};
+};
+
+/*
+ * PcapRotatingFile writes packets in pcap format to a series of files,
+ * <path>.0, <path>.1 and so on, each of them a complete pcap file.
+ *
+ * Each file is preallocated and memory mapped when it is started, so writing
+ * a packet is a copy into the mapping rather than a system call, and disk
+ * usage is bounded by segmentBytes * maxSegments.
+ *
+ * Like PcapFile, this performs blocking I/O (when starting a new file, and
+ * when the kernel writes back the mapping), and should be used through
+ * PcapWriter when recording packets from a non-blocking thread.
+ */
+class PcapRotatingFile {
+ public:
+  PcapRotatingFile(folly::StringPiece path, const PcapRotationOptions& options);
+  ~PcapRotatingFile();
+
+  void writePackets(const std::vector<PcapPkt>& pkts);
+  void close();
+
+  static std::string segmentPath(folly::StringPiece path, uint64_t index);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  PcapRotatingFile(PcapRotatingFile const &) = delete;
+  PcapRotatingFile& operator=(PcapRotatingFile const &) = delete;
+
+  void openSegment();
+  void closeSegment();
+  void append(const void* data, size_t length);
+
+  const std::string path_;
+  const PcapRotationOptions options_;
+  uint64_t nextIndex_{0};
+  // Paths of the files written so far which haven't been deleted, oldest
+  // first
+  std::deque<std::string> segments_;
+
+  folly::File file_;
+  uint8_t* map_{nullptr};
+  uint64_t used_{0};
+  std::chrono::steady_clock::time_point segmentStart_;
+};
+
+}} // facebook::fboss
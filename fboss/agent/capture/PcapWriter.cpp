@@ -47,6 +47,13 @@ void PcapWriter::start(folly::StringPiece path, bool overwriteExisting) {
   thread_ = std::thread(&PcapWriter::threadMain, this);
 }
 
+void PcapWriter::start(
+    folly::StringPiece path,
+    const PcapRotationOptions& rotation) {
+  rotatingFile_ = std::make_unique<PcapRotatingFile>(path, rotation);
+  thread_ = std::thread(&PcapWriter::threadMain, this);
+}
+
 void PcapWriter::finish() {
   if (!thread_.joinable()) {
     // already stopped
@@ -62,6 +69,12 @@ void PcapWriter::finish() {
 
 void PcapWriter::threadMain() {
   try {
+    if (rotatingFile_) {
+      // Each rotating file writes its own global header
+      writeLoop();
+      rotatingFile_->close();
+      return;
+    }
     file_.writeGlobalHeader();
     writeLoop();
     file_.close();
@@ -81,7 +94,11 @@ void PcapWriter::writeLoop() {
     }
 
     DCHECK(!pkts.empty());
-    file_.writePackets(pkts);
+    if (rotatingFile_) {
+      rotatingFile_->writePackets(pkts);
+    } else {
+      file_.writePackets(pkts);
+    }
   }
 }
 
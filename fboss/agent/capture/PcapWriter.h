@@ -11,6 +11,9 @@
 
 #include "fboss/agent/capture/PcapFile.h"
 #include "fboss/agent/capture/PcapQueue.h"
+#include "fboss/agent/capture/PcapRotatingFile.h"
+
+#include <memory>
 
 #include <thread>
 
@@ -21,6 +24,9 @@ namespace facebook { namespace fboss {
  * to a pcap file.
  *
  * It performs blocking disk I/O, so it performs the writes in its own thread.
+ *
+ * The packets are either written to a single file, or to a rotating series of
+ * files (see PcapRotatingFile).
  */
 class PcapWriter {
  public:
@@ -31,30 +37,18 @@ class PcapWriter {
   virtual ~PcapWriter();
 
   void start(folly::StringPiece path, bool overwriteExisting = false);
+  void start(folly::StringPiece path, const PcapRotationOptions& rotation);
 
   /*
-   * Get the mutex protecting this PcapWriter.
-   *
-   * This is exposed to allow callers to also protect their own data
-   * with the same mutex if desired.  Callers should call addPktLocked()
-   * instead of addPkt() when they are already holding the PcapWriter mutex.
+   * Queue a packet to be written. This never blocks, and may be called from
+   * any thread.
    */
-  std::mutex& mutex() const {
-    return queue_.mutex();
-  }
-
   void addPkt(const RxPacket* pkt) {
     queue_.addPkt(pkt);
   }
-  void addPktLocked(const RxPacket* pkt) {
-    queue_.addPktLocked(pkt);
-  }
   void addPkt(const TxPacket* pkt) {
     queue_.addPkt(pkt);
   }
-  void addPktLocked(const TxPacket* pkt) {
-    queue_.addPktLocked(pkt);
-  }
   void finish();
 
   /*
@@ -77,6 +71,8 @@ class PcapWriter {
   void writeLoop();
 
   PcapFile file_;
+  // Set when writing to rotating files instead of file_
+  std::unique_ptr<PcapRotatingFile> rotatingFile_;
   PcapQueue queue_;
   std::exception_ptr ex_;
   std::thread thread_;
@@ -9,14 +9,151 @@
  */
 #include "fboss/agent/capture/PktCapture.h"
 
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/packet/Ethertype.h"
+
 #include <folly/Conv.h>
+#include <folly/MacAddress.h>
+#include <folly/io/Cursor.h>
 #include <folly/logging/xlog.h>
 #include <sstream>
 
 using folly::StringPiece;
+using folly::io::Cursor;
+
+namespace {
+uint32_t readBE32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+      (static_cast<uint32_t>(data[1]) << 16) |
+      (static_cast<uint32_t>(data[2]) << 8) |
+      static_cast<uint32_t>(data[3]);
+}
+}
 
 namespace facebook { namespace fboss {
 
+PacketMatcher::PacketMatcher(const PacketMatchFilter& filter) {
+  for (auto port : filter.ports) {
+    ports_.insert(PortID(port));
+  }
+  for (auto vlan : filter.vlans) {
+    vlans_.insert(VlanID(vlan));
+  }
+  for (auto ethertype : filter.ethertypes) {
+    ethertypes_.insert(static_cast<uint16_t>(ethertype));
+  }
+  for (auto proto : filter.ipProtocols) {
+    ipProtocols_.insert(static_cast<uint8_t>(proto));
+  }
+  for (const auto& prefix : filter.prefixes) {
+    auto addr = facebook::network::toIPAddress(prefix.ip);
+    if (prefix.prefixLength < 0 ||
+        static_cast<size_t>(prefix.prefixLength) > addr.bitCount()) {
+      throw FbossError("invalid capture filter prefix ", addr, "/",
+                       prefix.prefixLength);
+    }
+    if (addr.isV4()) {
+      uint32_t mask = prefix.prefixLength == 0
+          ? 0 : ~uint32_t(0) << (32 - prefix.prefixLength);
+      v4Prefixes_.emplace_back(addr.asV4().toLongHBO() & mask, mask);
+    } else {
+      v6Prefixes_.emplace_back(addr.asV6(), prefix.prefixLength);
+    }
+  }
+  matchAll_ = ports_.empty() && vlans_.empty() && ethertypes_.empty() &&
+      ipProtocols_.empty() && v4Prefixes_.empty() && v6Prefixes_.empty();
+}
+
+bool PacketMatcher::matches(
+    const folly::IOBuf* buf,
+    folly::Optional<PortID> port,
+    folly::Optional<VlanID> vlan) const {
+  if (!ports_.empty() && (!port || ports_.find(*port) == ports_.end())) {
+    return false;
+  }
+  try {
+    Cursor cursor(buf);
+    cursor += 2 * folly::MacAddress::SIZE;
+    auto ethertype = cursor.readBE<uint16_t>();
+    if (ethertype == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_VLAN)) {
+      auto tag = cursor.readBE<uint16_t>();
+      if (!vlan) {
+        vlan = VlanID(tag & 0xfff);
+      }
+      ethertype = cursor.readBE<uint16_t>();
+    }
+    if (!vlans_.empty() && (!vlan || vlans_.find(*vlan) == vlans_.end())) {
+      return false;
+    }
+    if (!ethertypes_.empty() &&
+        ethertypes_.find(ethertype) == ethertypes_.end()) {
+      return false;
+    }
+    if (ipProtocols_.empty() && v4Prefixes_.empty() && v6Prefixes_.empty()) {
+      return true;
+    }
+
+    // Only look at the fixed part of the IP header. For IPv6 this means the
+    // protocol is the first next header, not the upper layer protocol behind
+    // any extension headers.
+    uint8_t proto;
+    if (ethertype == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_IPV4)) {
+      uint8_t hdr[20];
+      cursor.pull(hdr, sizeof(hdr));
+      proto = hdr[9];
+      if (!v6Prefixes_.empty() && v4Prefixes_.empty()) {
+        return false;
+      }
+      if (!v4Prefixes_.empty() && !matchesV4(readBE32(hdr + 12)) &&
+          !matchesV4(readBE32(hdr + 16))) {
+        return false;
+      }
+    } else if (ethertype == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_IPV6)) {
+      uint8_t hdr[40];
+      cursor.pull(hdr, sizeof(hdr));
+      proto = hdr[6];
+      if (!v4Prefixes_.empty() && v6Prefixes_.empty()) {
+        return false;
+      }
+      if (!v6Prefixes_.empty()) {
+        auto src =
+            folly::IPAddressV6::fromBinary(folly::ByteRange(hdr + 8, 16));
+        auto dst =
+            folly::IPAddressV6::fromBinary(folly::ByteRange(hdr + 24, 16));
+        if (!matchesV6(src) && !matchesV6(dst)) {
+          return false;
+        }
+      }
+    } else {
+      return false;
+    }
+    return ipProtocols_.empty() ||
+        ipProtocols_.find(proto) != ipProtocols_.end();
+  } catch (const std::out_of_range&) {
+    // Too short to have the headers we are filtering on
+    return false;
+  }
+}
+
+bool PacketMatcher::matchesV4(uint32_t addr) const {
+  for (const auto& prefix : v4Prefixes_) {
+    if ((addr & prefix.second) == prefix.first) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PacketMatcher::matchesV6(const folly::IPAddressV6& addr) const {
+  for (const auto& prefix : v6Prefixes_) {
+    if (addr.inSubnet(prefix.first, prefix.second)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 PktCapture::PktCapture(folly::StringPiece name, uint64_t maxPackets,
                          CaptureDirection direction)
     : PktCapture(name, maxPackets, direction, CaptureFilter()) {
@@ -34,7 +171,11 @@ PktCapture::PktCapture(folly::StringPiece name, uint64_t maxPackets,
 
 void PktCapture::start(StringPiece path) {
   XLOG(INFO) << "starting packet capture " << toString();
-  writer_.start(path, true);
+  if (rotation_) {
+    writer_.start(path, *rotation_);
+  } else {
+    writer_.start(path, true);
+  }
 }
 
 void PktCapture::stop() {
@@ -43,22 +184,21 @@ void PktCapture::stop() {
 }
 
 bool PktCapture::packetReceived(const RxPacket* pkt) {
-  std::lock_guard<std::mutex> guard(writer_.mutex());
   if (direction_ != CaptureDirection::CAPTURE_ONLY_TX &&
       true == packetFilter_.passes(pkt)) {
-    ++numPacketsReceived_;
-    writer_.addPktLocked(pkt);
+    numPacketsReceived_.fetch_add(1, std::memory_order_relaxed);
+    writer_.addPkt(pkt);
   }
-  return (numPacketsSent_ + numPacketsReceived_) < maxPackets_;
+  return numPackets() < maxPackets_;
 }
 
 bool PktCapture::packetSent(const TxPacket* pkt) {
-  std::lock_guard<std::mutex> guard(writer_.mutex());
-  if (direction_ != CaptureDirection::CAPTURE_ONLY_RX) {
-    ++numPacketsSent_;
-    writer_.addPktLocked(pkt);
+  if (direction_ != CaptureDirection::CAPTURE_ONLY_RX &&
+      packetFilter_.passes(pkt)) {
+    numPacketsSent_.fetch_add(1, std::memory_order_relaxed);
+    writer_.addPkt(pkt);
   }
-  return (numPacketsSent_ + numPacketsReceived_) < maxPackets_;
+  return numPackets() < maxPackets_;
 }
 
 std::string PktCapture::toString(bool withStats) const {
@@ -71,8 +211,8 @@ std::string PktCapture::toString(bool withStats) const {
             ? "RX only"
             : "TX only"));
   if (withStats) {
-    ss << ", Packet received:" << numPacketsReceived_
-       << ", Packet sent:" << numPacketsSent_;
+    ss << ", Packet received:" << numPacketsReceived_.load()
+       << ", Packet sent:" << numPacketsSent_.load();
   }
   return ss.str();
 }
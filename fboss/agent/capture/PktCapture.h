@@ -12,8 +12,13 @@
 #include "fboss/agent/capture/PcapWriter.h"
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
 
+#include <folly/IPAddressV6.h>
+#include <folly/Optional.h>
 #include <folly/Range.h>
+#include <atomic>
 #include <string>
+#include <utility>
+#include <vector>
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/TxPacket.h"
 #include <boost/container/flat_set.hpp>
@@ -35,16 +40,59 @@ class RxPacketFilter {
   boost::container::flat_set<CpuCosQueueId> cosQueues_;
 };
 
+/*
+ * PacketMatcher checks a PacketMatchFilter against the headers of a packet.
+ *
+ * The filter is compiled once into sorted sets and prefix masks, and packets
+ * are matched by reading their header fields straight from the packet
+ * buffer, so that packets not matching the filter cost no allocation.
+ */
+class PacketMatcher {
+ public:
+  explicit PacketMatcher(const PacketMatchFilter& filter);
+
+  bool matches(const RxPacket* pkt) const {
+    return matchAll_ ||
+        matches(pkt->buf(), pkt->getSrcPort(), pkt->getSrcVlan());
+  }
+  bool matches(const TxPacket* pkt) const {
+    return matchAll_ ||
+        (ports_.empty() && matches(pkt->buf(), folly::none, folly::none));
+  }
+
+ private:
+  bool matches(
+      const folly::IOBuf* buf,
+      folly::Optional<PortID> port,
+      folly::Optional<VlanID> vlan) const;
+  bool matchesV4(uint32_t addr) const;
+  bool matchesV6(const folly::IPAddressV6& addr) const;
+
+  boost::container::flat_set<PortID> ports_;
+  boost::container::flat_set<VlanID> vlans_;
+  boost::container::flat_set<uint16_t> ethertypes_;
+  boost::container::flat_set<uint8_t> ipProtocols_;
+  // (network, mask), in host byte order
+  std::vector<std::pair<uint32_t, uint32_t>> v4Prefixes_;
+  std::vector<std::pair<folly::IPAddressV6, uint8_t>> v6Prefixes_;
+  bool matchAll_{true};
+};
+
 class PacketFilter {
  public:
    explicit PacketFilter(const CaptureFilter & captureFilter) :
-   rxPacketFilter_(captureFilter.get_rxCaptureFilter()) {}
+   rxPacketFilter_(captureFilter.get_rxCaptureFilter()),
+   matcher_(captureFilter.get_matchFilter()) {}
 
-   bool passes(const RxPacket* pkt) {
-     return rxPacketFilter_.passes(pkt);
+   bool passes(const RxPacket* pkt) const {
+     return rxPacketFilter_.passes(pkt) && matcher_.matches(pkt);
+   }
+   bool passes(const TxPacket* pkt) const {
+     return matcher_.matches(pkt);
    }
  private:
    RxPacketFilter rxPacketFilter_;
+   PacketMatcher matcher_;
 };
 
 /*
@@ -61,6 +109,14 @@ class PktCapture {
     return name_;
   }
 
+  /*
+   * Write the capture to a rotating series of files rather than a single
+   * file. Must be called before start().
+   */
+  void setRotation(const PcapRotationOptions& rotation) {
+    rotation_ = rotation;
+  }
+
   void start(folly::StringPiece path);
   void stop();
 
@@ -74,15 +130,23 @@ class PktCapture {
   PktCapture(PktCapture const &) = delete;
   PktCapture& operator=(PktCapture const &) = delete;
 
+  uint64_t numPackets() const {
+    return numPacketsSent_.load(std::memory_order_relaxed) +
+        numPacketsReceived_.load(std::memory_order_relaxed);
+  }
+
   const std::string name_;
 
-  // Note: the rest of the state in this class is protcted by
-  // the PcapWriter's mutex.
+  // packetReceived() and packetSent() may be called concurrently from
+  // several threads, so the packet counts are atomic. Once maxPackets_ is
+  // reached, a few more packets may be captured by threads racing with the
+  // one that stops the capture.
   PcapWriter writer_;
-  uint64_t maxPackets_{0};
-  uint64_t numPacketsReceived_{0};
-  uint64_t numPacketsSent_{0};
-  CaptureDirection direction_{CaptureDirection::CAPTURE_TX_RX};
-  PacketFilter packetFilter_;
+  folly::Optional<PcapRotationOptions> rotation_;
+  const uint64_t maxPackets_{0};
+  std::atomic<uint64_t> numPacketsReceived_{0};
+  std::atomic<uint64_t> numPacketsSent_{0};
+  const CaptureDirection direction_{CaptureDirection::CAPTURE_TX_RX};
+  const PacketFilter packetFilter_;
 };
 }} // facebook::fboss
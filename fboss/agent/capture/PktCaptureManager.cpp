@@ -39,7 +39,7 @@ void PktCaptureManager::startCapture(unique_ptr<PktCapture> capture) {
   auto path = folly::to<std::string>(captureDir_, "/",
                                      capture->name(), ".pcap");
 
-  std::lock_guard<std::mutex> g(mutex_);
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
 
   const auto& name = capture->name();
   if (activeCaptures_.find(name) != activeCaptures_.end()) {
@@ -52,7 +52,7 @@ void PktCaptureManager::startCapture(unique_ptr<PktCapture> capture) {
 }
 
 void PktCaptureManager::stopCapture(StringPiece name) {
-  std::lock_guard<std::mutex> g(mutex_);
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
 
   auto nameStr = name.str();
   auto it = activeCaptures_.find(nameStr);
@@ -66,7 +66,7 @@ void PktCaptureManager::stopCapture(StringPiece name) {
 }
 
 unique_ptr<PktCapture> PktCaptureManager::forgetCapture(StringPiece name) {
-  std::lock_guard<std::mutex> g(mutex_);
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
   auto nameStr = name.str();
   auto activeIt = activeCaptures_.find(nameStr);
   if (activeIt != activeCaptures_.end()) {
@@ -89,51 +89,65 @@ unique_ptr<PktCapture> PktCaptureManager::forgetCapture(StringPiece name) {
 }
 
 void PktCaptureManager::stopAllCaptures() {
-  std::lock_guard<std::mutex> g(mutex_);
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
 
   // FIXME
 }
 
 void PktCaptureManager::forgetAllCaptures() {
-  std::lock_guard<std::mutex> g(mutex_);
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
 
   // FIXME
 }
 
 template<typename Fn>
 void PktCaptureManager::invokeCaptures(const Fn& fn) {
-  std::lock_guard<std::mutex> g(mutex_);
-
-  for (auto it = activeCaptures_.begin();
-       it != activeCaptures_.end();
-       /* increment in loop */) {
-    // Increment the iterator now, in case this capture deactivates itself and
-    // we need to remove it from the active captures.
-    auto thisIt = it;
-    ++it;
-    PktCapture* capture = thisIt->second.get();
-    bool stillActive = false;
-    try {
-      stillActive = fn(capture);
-    } catch (const std::exception& ex) {
-      XLOG(ERR) << "error when processing packet for capture "
-                << capture->name() << " : " << folly::exceptionStr(ex);
-      stillActive = false;
-    }
-
-    if (!stillActive) {
-      XLOG(INFO) << "auto-stopping packet capture \"" << capture->name()
-                 << "\"";
+  // Packets are captured while holding the lock shared, so that threads
+  // receiving and sending packets don't serialize on it. Captures which are
+  // done are only deactivated afterwards, with the lock held exclusively.
+  std::vector<std::pair<std::string, PktCapture*>> finished;
+  {
+    folly::SharedMutexWritePriority::ReadHolder g(&lock_);
+    for (const auto& nameAndCapture : activeCaptures_) {
+      PktCapture* capture = nameAndCapture.second.get();
+      bool stillActive = false;
       try {
-        inactiveCaptures_[capture->name()] = std::move(thisIt->second);
+        stillActive = fn(capture);
       } catch (const std::exception& ex) {
-        XLOG(ERR) << "error adding capture " << capture->name()
-                  << " to the inactive list";
-        // Can't do much else here.  Just continue and forget the capture.
+        XLOG(ERR) << "error when processing packet for capture "
+                  << capture->name() << " : " << folly::exceptionStr(ex);
+        stillActive = false;
+      }
+      if (!stillActive) {
+        finished.emplace_back(nameAndCapture.first, capture);
       }
-      activeCaptures_.erase(thisIt);
     }
   }
+  if (finished.empty()) {
+    return;
+  }
+
+  folly::SharedMutexWritePriority::WriteHolder g(&lock_);
+  for (const auto& nameAndCapture : finished) {
+    // The capture may have been stopped, or even destroyed and replaced by
+    // another one with the same name, while we weren't holding the lock.
+    auto it = activeCaptures_.find(nameAndCapture.first);
+    if (it == activeCaptures_.end() ||
+        it->second.get() != nameAndCapture.second) {
+      continue;
+    }
+    PktCapture* capture = nameAndCapture.second;
+    XLOG(INFO) << "auto-stopping packet capture \"" << capture->name()
+               << "\"";
+    try {
+      inactiveCaptures_[capture->name()] = std::move(it->second);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "error adding capture " << capture->name()
+                << " to the inactive list";
+      // Can't do much else here.  Just continue and forget the capture.
+    }
+    activeCaptures_.erase(it);
+  }
 
   bool running = !activeCaptures_.empty();
   capturesRunning_.store(running, std::memory_order_release);
@@ -10,12 +10,13 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/SharedMutex.h>
 
 #include <atomic>
 #include <map>
 #include <memory>
-#include <mutex>
 #include <string>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
@@ -89,7 +90,9 @@ class PktCaptureManager {
 
   std::atomic<bool> capturesRunning_{false};
 
-  std::mutex mutex_;
+  // Held shared while capturing packets, exclusively to start and stop
+  // captures.
+  folly::SharedMutexWritePriority lock_;
   std::string captureDir_;
   std::map<std::string, std::unique_ptr<PktCapture>> activeCaptures_;
   std::map<std::string, std::unique_ptr<PktCapture>> inactiveCaptures_;
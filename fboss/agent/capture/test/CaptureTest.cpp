@@ -8,12 +8,15 @@
  *
  */
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/AddressUtil.h"
 #include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/FbossError.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/capture/PktCapture.h"
 #include "fboss/agent/capture/PktCaptureManager.h"
 #include "fboss/agent/capture/test/PcapUtil.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/mock/MockTxPacket.h"
 #include "fboss/agent/packet/PktUtil.h"
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/state/Interface.h"
@@ -270,3 +273,86 @@ TEST(CaptureTest, FullCapture) {
   //
   // EXPECT_BUF_EQ(updatedIpPktData, pcapPkts.at(4).data);
 }
+
+TEST(CaptureTest, MatchFilter) {
+  // UDP from 10.0.0.10 to 10.1.1.1, on VLAN 5
+  auto udpPkt = MockRxPacket::fromHex(
+    // dst mac, src mac
+    "02 00 01 00 00 01  02 00 02 01 02 03"
+    // 802.1q, VLAN 5
+    "81 00 00 05"
+    // IPv4
+    "08 00"
+    // Version(4), IHL(5), DSCP(0), ECN(0), Total Length(20)
+    "45  00  00 14"
+    // Identification(0), Flags(0), Fragment offset(0)
+    "00 00  00 00"
+    // TTL(31), Protocol(17), Checksum (0, fake)
+    "1F  11  00 00"
+    // Source IP (10.0.0.10)
+    "0a 00 00 0a"
+    // Destination IP (10.1.1.1)
+    "0a 01 01 01"
+  );
+  udpPkt->setSrcPort(PortID(12));
+  udpPkt->setSrcVlan(VlanID(5));
+  // LACPDU header only, untagged
+  auto lacpPkt = MockRxPacket::fromHex(
+    "01 80 c2 00 00 02  02 00 02 01 02 03"
+    "88 09  01 01");
+  lacpPkt->setSrcPort(PortID(12));
+  lacpPkt->setSrcVlan(VlanID(5));
+
+  auto prefix = [](StringPiece ip, int16_t len) {
+    IpPrefix pfx;
+    pfx.ip = facebook::network::toBinaryAddress(folly::IPAddress(ip));
+    pfx.prefixLength = len;
+    return pfx;
+  };
+
+  // An empty filter matches everything
+  PacketMatcher all{PacketMatchFilter()};
+  EXPECT_TRUE(all.matches(udpPkt.get()));
+  EXPECT_TRUE(all.matches(lacpPkt.get()));
+
+  // Just LACP on port 12
+  PacketMatchFilter lacpFilter;
+  lacpFilter.ports = {12};
+  lacpFilter.ethertypes = {0x8809};
+  PacketMatcher lacp(lacpFilter);
+  EXPECT_FALSE(lacp.matches(udpPkt.get()));
+  EXPECT_TRUE(lacp.matches(lacpPkt.get()));
+  lacpPkt->setSrcPort(PortID(13));
+  EXPECT_FALSE(lacp.matches(lacpPkt.get()));
+
+  PacketMatchFilter udpFilter;
+  udpFilter.vlans = {5};
+  udpFilter.ipProtocols = {17};
+  udpFilter.prefixes = {prefix("10.1.0.0", 16), prefix("2401:db00::", 32)};
+  PacketMatcher udp(udpFilter);
+  EXPECT_TRUE(udp.matches(udpPkt.get()));
+  EXPECT_FALSE(udp.matches(lacpPkt.get()));
+
+  // Neither address is within the prefix
+  udpFilter.prefixes = {prefix("10.2.0.0", 16)};
+  EXPECT_FALSE(PacketMatcher(udpFilter).matches(udpPkt.get()));
+  // Wrong protocol
+  udpFilter.prefixes.clear();
+  udpFilter.ipProtocols = {6};
+  EXPECT_FALSE(PacketMatcher(udpFilter).matches(udpPkt.get()));
+
+  // Sent packets are matched by their VLAN tag, and never by port
+  MockTxPacket udpTxPkt(udpPkt->buf()->computeChainDataLength());
+  memcpy(
+      udpTxPkt.buf()->writableData(),
+      udpPkt->buf()->data(),
+      udpPkt->buf()->length());
+  udpFilter.ipProtocols = {17};
+  EXPECT_TRUE(PacketMatcher(udpFilter).matches(&udpTxPkt));
+  udpFilter.ports = {12};
+  EXPECT_FALSE(PacketMatcher(udpFilter).matches(&udpTxPkt));
+
+  // Invalid prefixes are rejected
+  udpFilter.prefixes = {prefix("10.0.0.0", 33)};
+  EXPECT_THROW(PacketMatcher{udpFilter}, FbossError);
+}
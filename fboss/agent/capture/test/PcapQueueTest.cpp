@@ -72,3 +72,58 @@ TEST(PcapQueueTest, SimpleAdd) {
   ByteRange waitedPktData = waitedPktBufClone->coalesce();
   EXPECT_EQ(expectedPktData, waitedPktData);
 }
+
+TEST(PcapQueueTest, MultipleWriters) {
+  constexpr int kNumThreads = 4;
+  constexpr int kPktsPerThread = 1000;
+  PcapQueue queue(kNumThreads * kPktsPerThread);
+  std::vector<PcapPkt> waitedPkts;
+
+  std::thread waiter([&]() { pktWaitThread(&queue, &waitedPkts); });
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kNumThreads; ++i) {
+    writers.emplace_back([&queue, i]() {
+      auto pkt = MockRxPacket::fromHex("02 00 01 00 00 01  02 00 02 01 02 03");
+      pkt->setSrcPort(PortID(i));
+      for (int n = 0; n < kPktsPerThread; ++n) {
+        queue.addPkt(pkt.get());
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  queue.finish();
+  waiter.join();
+
+  EXPECT_EQ(0, queue.numDropped());
+  ASSERT_EQ(kNumThreads * kPktsPerThread, waitedPkts.size());
+  std::vector<int> perPort(kNumThreads, 0);
+  for (const auto& pkt : waitedPkts) {
+    ++perPort[static_cast<int>(pkt.port())];
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(kPktsPerThread, perPort[i]);
+  }
+}
+
+TEST(PcapQueueTest, DropsWhenFull) {
+  // Room for 2 packets, or less than 3 packets worth of bytes
+  auto pkt = MockRxPacket::fromHex("02 00 01 00 00 01  02 00 02 01 02 03");
+  PcapQueue pktLimited(2);
+  PcapQueue byteLimited(100, 12 * 3);
+  for (int i = 0; i < 3; ++i) {
+    pktLimited.addPkt(pkt.get());
+    byteLimited.addPkt(pkt.get());
+  }
+  EXPECT_EQ(1, pktLimited.numDropped());
+  EXPECT_EQ(1, byteLimited.numDropped());
+
+  // Reading the queued packets makes room for more
+  std::vector<PcapPkt> pkts;
+  ASSERT_TRUE(byteLimited.wait(&pkts));
+  EXPECT_EQ(2, pkts.size());
+  byteLimited.addPkt(pkt.get());
+  EXPECT_EQ(1, byteLimited.numDropped());
+}
@@ -11,6 +11,7 @@
 #include "fboss/agent/capture/test/PcapUtil.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
 
+#include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/ScopeGuard.h>
 #include <gtest/gtest.h>
@@ -102,3 +103,45 @@ TEST(PcapWriterTest, Drop) {
     EXPECT_EQ(68, pktInfo.hdr.caplen);
   }
 }
+
+TEST(PcapWriterTest, Rotate) {
+  char tmpDir[] = "fbossPcapTest.XXXXXX";
+  if (!mkdtemp(tmpDir)) {
+    folly::throwSystemError("failed to create temporary directory");
+  }
+  auto basePath = folly::to<std::string>(tmpDir, "/capture.pcap");
+
+  // Each file holds the 24 byte global header, plus 16 bytes of header and
+  // 60 bytes of data for each packet: 51 packets per 4096 byte file.
+  PcapRotationOptions rotation;
+  rotation.segmentBytes = 4096;
+  rotation.maxSegments = 2;
+  rotation.snaplen = 60;
+  uint32_t numFiles = 5;
+  SCOPE_EXIT {
+    for (uint32_t n = 0; n < numFiles; ++n) {
+      unlink(PcapRotatingFile::segmentPath(basePath, n).c_str());
+    }
+    rmdir(tmpDir);
+  };
+
+  PcapWriter writer;
+  writer.start(basePath, rotation);
+  addPackets(&writer, 51 * 4 + 10);
+  writer.finish();
+  EXPECT_EQ(0, writer.numDropped());
+
+  // Only the last two files are kept
+  for (uint32_t n = 0; n < 3; ++n) {
+    auto path = PcapRotatingFile::segmentPath(basePath, n);
+    EXPECT_NE(0, access(path.c_str(), F_OK));
+  }
+  auto full = readPcapFile(PcapRotatingFile::segmentPath(basePath, 3).c_str());
+  EXPECT_EQ(51, full.size());
+  auto last = readPcapFile(PcapRotatingFile::segmentPath(basePath, 4).c_str());
+  EXPECT_EQ(10, last.size());
+  for (const auto& pktInfo : last) {
+    EXPECT_EQ(68, pktInfo.hdr.len);
+    EXPECT_EQ(60, pktInfo.hdr.caplen);
+  }
+}
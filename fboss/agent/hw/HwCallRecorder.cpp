@@ -0,0 +1,186 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/HwCallRecorder.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/logging/xlog.h>
+
+#include <cstring>
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace facebook { namespace fboss {
+
+namespace {
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+};
+
+constexpr char kMagic[8] = {'F', 'B', 'H', 'W', 'C', 'A', 'L', 'L'};
+constexpr uint32_t kVersion = 1;
+} // unnamed namespace
+
+constexpr uint8_t HwCallRecord::kV6;
+constexpr size_t HwCallRecorder::kFlushRecords;
+
+const char* hwCallName(HwCall call) {
+  switch (call) {
+    case HwCall::ROUTE_ADD:
+      return "route_add";
+    case HwCall::ROUTE_DELETE:
+      return "route_delete";
+    case HwCall::HOST_ADD:
+      return "host_add";
+    case HwCall::HOST_DELETE:
+      return "host_delete";
+    case HwCall::EGRESS_PROGRAM:
+      return "egress_program";
+    case HwCall::EGRESS_DELETE:
+      return "egress_delete";
+    case HwCall::ECMP_PROGRAM:
+      return "ecmp_program";
+    case HwCall::ECMP_DELETE:
+      return "ecmp_delete";
+    case HwCall::ACL_ADD:
+      return "acl_add";
+    case HwCall::ACL_DELETE:
+      return "acl_delete";
+    case HwCall::PORT_PROGRAM:
+      return "port_program";
+    case HwCall::NUM_CALLS:
+      break;
+  }
+  return "unknown";
+}
+
+void HwCallRecord::setAddress(const folly::IPAddress& ip) {
+  std::memset(addr, 0, sizeof(addr));
+  if (ip.isV6()) {
+    flags |= kV6;
+    std::memcpy(addr, ip.bytes(), 16);
+  } else {
+    flags &= ~kV6;
+    std::memcpy(addr, ip.bytes(), 4);
+  }
+}
+
+folly::IPAddress HwCallRecord::getAddress() const {
+  if (flags & kV6) {
+    return folly::IPAddressV6::fromBinary(folly::ByteRange(addr, 16));
+  }
+  return folly::IPAddressV4::fromBinary(folly::ByteRange(addr, 4));
+}
+
+HwCallRecorder* HwCallRecorder::get() {
+  static HwCallRecorder recorder;
+  return &recorder;
+}
+
+void HwCallRecorder::start(const std::string& path) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (recording_) {
+    flush();
+  }
+  file_ = folly::File(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.recordSize = sizeof(HwCallRecord);
+  auto ret = folly::writeFull(file_.fd(), &header, sizeof(header));
+  folly::checkUnixError(ret, "error writing hw call recording header");
+  buffer_.clear();
+  buffer_.reserve(kFlushRecords);
+  started_ = Clock::now();
+  recording_ = true;
+  XLOG(INFO) << "Recording hardware calls to " << path;
+}
+
+void HwCallRecorder::stop() {
+  std::lock_guard<std::mutex> g(lock_);
+  if (!recording_) {
+    return;
+  }
+  recording_ = false;
+  flush();
+  file_.close();
+}
+
+void HwCallRecorder::record(HwCallRecord record, Clock::time_point start) {
+  auto end = Clock::now();
+  std::lock_guard<std::mutex> g(lock_);
+  // Recording may have stopped, or restarted into another file, since the
+  // call started
+  if (!recording_ || start < started_) {
+    return;
+  }
+  record.timestampNs = duration_cast<nanoseconds>(start - started_).count();
+  record.durationNs = duration_cast<nanoseconds>(end - start).count();
+  buffer_.push_back(record);
+  if (buffer_.size() >= kFlushRecords) {
+    flush();
+  }
+}
+
+void HwCallRecorder::flush() {
+  if (buffer_.empty()) {
+    return;
+  }
+  auto ret = folly::writeFull(
+      file_.fd(), buffer_.data(), buffer_.size() * sizeof(HwCallRecord));
+  buffer_.clear();
+  if (ret < 0) {
+    // Don't take the HwSwitch down over a recording
+    XLOG(ERR) << "error writing hw call recording, stopping: "
+              << folly::errnoStr(errno);
+    recording_ = false;
+  }
+}
+
+std::vector<HwCallRecord> HwCallRecorder::read(const std::string& path) {
+  std::string contents;
+  if (!folly::readFile(path.c_str(), contents)) {
+    throw FbossError("can't read hw call recording ", path);
+  }
+  FileHeader header;
+  if (contents.size() < sizeof(header)) {
+    throw FbossError(path, " is too short to be a hw call recording");
+  }
+  std::memcpy(&header, contents.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.recordSize != sizeof(HwCallRecord)) {
+    throw FbossError(path, " isn't a version ", kVersion, " hw call recording");
+  }
+
+  auto size = contents.size() - sizeof(header);
+  if (size % sizeof(HwCallRecord) != 0) {
+    // Cut short while being written
+    XLOG(WARNING) << "Ignoring the partial record at the end of " << path;
+  }
+  std::vector<HwCallRecord> records(size / sizeof(HwCallRecord));
+  if (records.empty()) {
+    return records;
+  }
+  std::memcpy(
+      records.data(),
+      contents.data() + sizeof(header),
+      records.size() * sizeof(HwCallRecord));
+  return records;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/IPAddress.h>
+#include <folly/Range.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * The hardware programming calls a HwSwitch implementation can record.
+ */
+enum class HwCall : uint8_t {
+  ROUTE_ADD,
+  ROUTE_DELETE,
+  HOST_ADD,
+  HOST_DELETE,
+  EGRESS_PROGRAM,
+  EGRESS_DELETE,
+  ECMP_PROGRAM,
+  ECMP_DELETE,
+  ACL_ADD,
+  ACL_DELETE,
+  PORT_PROGRAM,
+  NUM_CALLS,
+};
+
+const char* hwCallName(HwCall call);
+
+/*
+ * One recorded call, as written to the recording. The fields which don't
+ * apply to a call are left zero.
+ */
+struct HwCallRecord {
+  static constexpr uint8_t kV6 = 0x1;
+
+  // Since the recording started
+  uint64_t timestampNs{0};
+  uint32_t durationNs{0};
+  HwCall call{HwCall::ROUTE_ADD};
+  uint8_t flags{0};
+  // Routes
+  uint8_t prefixLength{0};
+  // How many recorded calls this one was made from. A route add, say,
+  // includes the ECMP group programmed for it, recorded at depth 1.
+  uint8_t depth{0};
+  uint32_t vrf{0};
+  // The egress, ECMP group, port or ACL priority the call is about
+  int32_t id{0};
+  // The number of next hops of routes and ECMP groups
+  int32_t count{0};
+  // The route prefix or host address, IPv4 addresses in the first 4 bytes
+  uint8_t addr[16]{};
+  uint32_t reserved1{0};
+
+  void setAddress(const folly::IPAddress& ip);
+  folly::IPAddress getAddress() const;
+};
+static_assert(sizeof(HwCallRecord) == 48, "HwCallRecord must stay 48 bytes");
+
+/*
+ * Records the hardware programming calls made while recording is on into a
+ * file, as compact fixed size binary records, so that programming-time
+ * problems seen on a switch can be looked at and replayed elsewhere. See
+ * HwCallReplayer.
+ *
+ * The file is a header followed by the HwCallRecord of each call in the
+ * order they finished. Records are buffered and written out in chunks.
+ *
+ * While not recording, an HwCallScope costs one relaxed atomic load.
+ */
+class HwCallRecorder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static HwCallRecorder* get();
+
+  /*
+   * Start recording into path, replacing whatever was recorded there. Calls
+   * that are being made while recording starts aren't recorded.
+   */
+  void start(const std::string& path);
+  // Stop recording and write out what was recorded
+  void stop();
+  bool isRecording() const {
+    return recording_.load(std::memory_order_relaxed);
+  }
+
+  // Record a call that started at start and has just finished
+  void record(HwCallRecord record, Clock::time_point start);
+
+  // Read all the records of a recording, throws FbossError if it isn't one
+  static std::vector<HwCallRecord> read(const std::string& path);
+
+ private:
+  static constexpr size_t kFlushRecords = 4096;
+
+  HwCallRecorder() {}
+  // Forbidden copy constructor and assignment operator
+  HwCallRecorder(HwCallRecorder const&) = delete;
+  HwCallRecorder& operator=(HwCallRecorder const&) = delete;
+
+  // Must be called with lock_ held
+  void flush();
+
+  std::atomic<bool> recording_{false};
+  std::mutex lock_;
+  folly::File file_;
+  Clock::time_point started_;
+  std::vector<HwCallRecord> buffer_;
+};
+
+/*
+ * Times the call made in its scope and records it on destruction, if the
+ * recording was on when the scope was entered.
+ */
+class HwCallScope {
+ public:
+  explicit HwCallScope(HwCall call) {
+    if (HwCallRecorder::get()->isRecording()) {
+      active_ = true;
+      record_.call = call;
+      record_.depth = depth()++;
+      start_ = HwCallRecorder::Clock::now();
+    }
+  }
+  ~HwCallScope() {
+    if (active_) {
+      --depth();
+      HwCallRecorder::get()->record(record_, start_);
+    }
+  }
+
+  bool isActive() const {
+    return active_;
+  }
+  void setAddress(const folly::IPAddress& ip, uint8_t prefixLength = 0) {
+    if (active_) {
+      record_.setAddress(ip);
+      record_.prefixLength = prefixLength;
+    }
+  }
+  void setVrf(uint32_t vrf) {
+    record_.vrf = vrf;
+  }
+  void setId(int32_t id) {
+    record_.id = id;
+  }
+  void setCount(int32_t count) {
+    record_.count = count;
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  HwCallScope(HwCallScope const&) = delete;
+  HwCallScope& operator=(HwCallScope const&) = delete;
+
+  // The recorded calls in progress on this thread
+  static uint8_t& depth() {
+    static thread_local uint8_t depth{0};
+    return depth;
+  }
+
+  bool active_{false};
+  HwCallRecorder::Clock::time_point start_;
+  HwCallRecord record_;
+};
+
+}} // facebook::fboss
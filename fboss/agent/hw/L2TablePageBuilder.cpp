@@ -0,0 +1,39 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/L2TablePageBuilder.h"
+
+namespace facebook { namespace fboss {
+
+L2TablePageBuilder::L2TablePageBuilder(
+    const L2TablePageRequest& request,
+    int32_t maxEntries,
+    L2TablePage* page)
+    : filter_(request.filter),
+      start_(request.__isset.cursor ? request.cursor.numReturned : 0),
+      end_(start_ + maxEntries),
+      page_(page) {}
+
+bool L2TablePageBuilder::onPage(int32_t vlanID, int32_t port) {
+  if ((filter_.__isset.vlanID && vlanID != filter_.vlanID) ||
+      (filter_.__isset.port && port != filter_.port)) {
+    return false;
+  }
+  auto index = numMatched_++;
+  return index >= start_ && index < end_;
+}
+
+void L2TablePageBuilder::finish() {
+  if (numMatched_ > end_) {
+    page_->next.numReturned = end_;
+    page_->__isset.next = true;
+  }
+}
+
+}} // facebook::fboss
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Builds an L2TablePage while walking the L2 table, for HwSwitch
+ * implementations of fetchL2TablePage().
+ *
+ * The walk calls onPage() with the VLAN and port of each entry, in table
+ * order, and only builds and adds the entries it returns true for. Filtering
+ * happens there, before an entry is built, so entries outside of the filter
+ * or the page cost next to nothing however big the table is.
+ */
+class L2TablePageBuilder {
+ public:
+  // maxEntries must already be capped and positive
+  L2TablePageBuilder(
+      const L2TablePageRequest& request,
+      int32_t maxEntries,
+      L2TablePage* page);
+
+  bool onPage(int32_t vlanID, int32_t port);
+
+  void add(L2EntryThrift entry) {
+    page_->entries.push_back(std::move(entry));
+  }
+
+  // Set the page's cursor if there are entries left. Call once at the end
+  // of the walk.
+  void finish();
+
+ private:
+  const L2TableFilter& filter_;
+  int64_t start_;
+  int64_t end_;
+  L2TablePage* page_;
+  // Entries matching the filter walked over so far
+  int64_t numMatched_{0};
+};
+
+}} // facebook::fboss
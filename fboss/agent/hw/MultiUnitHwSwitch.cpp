@@ -0,0 +1,343 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/MultiUnitHwSwitch.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/hw/StateChangeSections.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/Conv.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <map>
+
+namespace facebook { namespace fboss {
+
+MultiUnitHwSwitch::MultiUnitHwSwitch(
+    std::vector<std::unique_ptr<HwSwitch>> units,
+    UnitOfPortFn unitOfPort)
+    : units_(std::move(units)),
+      unitOfPort_(std::move(unitOfPort)),
+      unitApplied_(units_.size()),
+      executor_(
+          std::max<size_t>(units_.size(), 1),
+          std::make_shared<folly::NamedThreadFactory>("HwUnit")) {
+  if (units_.empty()) {
+    throw FbossError("a multi unit switch needs at least one unit");
+  }
+}
+
+MultiUnitHwSwitch::~MultiUnitHwSwitch() {}
+
+HwSwitch* MultiUnitHwSwitch::unitOfPort(PortID port) const {
+  auto unit = unitOfPort_(port);
+  if (unit >= units_.size()) {
+    XLOG(ERR) << "port " << port << " is on unit " << unit << " but there are"
+              << " only " << units_.size() << " units";
+    return nullptr;
+  }
+  return units_[unit].get();
+}
+
+void MultiUnitHwSwitch::forEachUnitConcurrently(
+    const std::function<void(size_t)>& fn) {
+  StateChangeSections units;
+  for (size_t i = 0; i < units_.size(); ++i) {
+    units.add(folly::to<std::string>("unit", i), [&fn, i]() { fn(i); });
+  }
+  units.run(&executor_);
+}
+
+HwInitResult MultiUnitHwSwitch::init(Callback* callback) {
+  std::vector<HwInitResult> results(units_.size());
+  forEachUnitConcurrently(
+      [&](size_t unit) { results[unit] = units_[unit]->init(callback); });
+
+  auto ret = std::move(results[0]);
+  auto ports = std::make_shared<PortMap>();
+  for (size_t unit = 0; unit < results.size(); ++unit) {
+    const auto& result = unit == 0 ? ret : results[unit];
+    if (result.bootType != ret.bootType) {
+      throw FbossError(
+          "unit ", unit, " did not boot the same way as unit 0, can't mix"
+          " warm and cold boots");
+    }
+    for (const auto& port : *result.switchState->getPorts()) {
+      if (unitOfPort_(port->getID()) == unit) {
+        ports->addNode(port);
+      }
+    }
+    ret.initializedTime = std::max(ret.initializedTime, result.initializedTime);
+    ret.bootTime = std::max(ret.bootTime, result.bootTime);
+  }
+  ret.switchState = ret.switchState->clone();
+  ret.switchState->resetPorts(std::move(ports));
+  ret.switchState->publish();
+  // Every unit starts from the whole chassis state and ignores the ports it
+  // doesn't own, as it has no hardware for them
+  std::fill(unitApplied_.begin(), unitApplied_.end(), ret.switchState);
+  return ret;
+}
+
+void MultiUnitHwSwitch::unregisterCallbacks() {
+  for (auto& unit : units_) {
+    unit->unregisterCallbacks();
+  }
+}
+
+std::shared_ptr<SwitchState> MultiUnitHwSwitch::stateChanged(
+    const StateDelta& delta) {
+  auto newState = delta.newState();
+  std::vector<std::shared_ptr<SwitchState>> applied(units_.size());
+  forEachUnitConcurrently([&](size_t unit) {
+    auto oldState = unitApplied_[unit] ? unitApplied_[unit] : delta.oldState();
+    applied[unit] = units_[unit]->stateChanged(StateDelta(oldState, newState));
+  });
+
+  std::shared_ptr<SwitchState> ret = newState;
+  for (size_t unit = 0; unit < units_.size(); ++unit) {
+    unitApplied_[unit] = applied[unit];
+    if (applied[unit] != newState && ret == newState) {
+      XLOG(WARNING) << "unit " << unit << " did not apply all of the change";
+      ret = applied[unit];
+    }
+  }
+  return ret;
+}
+
+bool MultiUnitHwSwitch::isValidStateUpdate(const StateDelta& delta) const {
+  for (size_t unit = 0; unit < units_.size(); ++unit) {
+    if (!units_[unit]->isValidStateUpdate(delta)) {
+      XLOG(ERR) << "update rejected by unit " << unit;
+      return false;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<TxPacket> MultiUnitHwSwitch::allocatePacket(uint32_t size) {
+  return units_[0]->allocatePacket(size);
+}
+
+bool MultiUnitHwSwitch::sendPacketSwitchedAsync(
+    std::unique_ptr<TxPacket> pkt) noexcept {
+  return units_[0]->sendPacketSwitchedAsync(std::move(pkt));
+}
+
+bool MultiUnitHwSwitch::sendPacketOutOfPortAsync(
+    std::unique_ptr<TxPacket> pkt,
+    PortID portID,
+    folly::Optional<uint8_t> cos) noexcept {
+  auto unit = unitOfPort(portID);
+  return unit && unit->sendPacketOutOfPortAsync(std::move(pkt), portID, cos);
+}
+
+bool MultiUnitHwSwitch::sendPacketsOutOfPortAsync(
+    std::vector<std::unique_ptr<TxPacket>> pkts,
+    PortID portID,
+    folly::Optional<uint8_t> cos) noexcept {
+  auto unit = unitOfPort(portID);
+  return unit &&
+      unit->sendPacketsOutOfPortAsync(std::move(pkts), portID, cos);
+}
+
+bool MultiUnitHwSwitch::sendPacketSwitchedSync(
+    std::unique_ptr<TxPacket> pkt) noexcept {
+  return units_[0]->sendPacketSwitchedSync(std::move(pkt));
+}
+
+bool MultiUnitHwSwitch::sendPacketOutOfPortSync(
+    std::unique_ptr<TxPacket> pkt,
+    PortID portID) noexcept {
+  auto unit = unitOfPort(portID);
+  return unit && unit->sendPacketOutOfPortSync(std::move(pkt), portID);
+}
+
+void MultiUnitHwSwitch::updateStats(SwitchStats* switchStats) {
+  // SwitchStats belongs to the calling thread, so no fanning out here
+  for (auto& unit : units_) {
+    unit->updateStats(switchStats);
+  }
+}
+
+int MultiUnitHwSwitch::getHighresSamplers(
+    HighresSamplerList* samplers,
+    const std::string& namespaceString,
+    const std::set<CounterRequest>& counterSet) {
+  int numCounters = 0;
+  for (auto& unit : units_) {
+    numCounters +=
+        unit->getHighresSamplers(samplers, namespaceString, counterSet);
+  }
+  return numCounters;
+}
+
+void MultiUnitHwSwitch::fetchL2Table(std::vector<L2EntryThrift>* l2Table) {
+  for (auto& unit : units_) {
+    unit->fetchL2Table(l2Table);
+  }
+}
+
+void MultiUnitHwSwitch::gracefulExit(folly::dynamic& switchState) {
+  std::vector<folly::dynamic> copies(units_.size() - 1, switchState);
+  forEachUnitConcurrently([&](size_t unit) {
+    units_[unit]->gracefulExit(unit == 0 ? switchState : copies[unit - 1]);
+  });
+}
+
+folly::dynamic MultiUnitHwSwitch::toFollyDynamic() const {
+  // Units only differ in their ports, which are in the agent's state
+  return units_[0]->toFollyDynamic();
+}
+
+void MultiUnitHwSwitch::initialConfigApplied() {
+  for (auto& unit : units_) {
+    unit->initialConfigApplied();
+  }
+}
+
+void MultiUnitHwSwitch::clearWarmBootCache() {
+  for (auto& unit : units_) {
+    unit->clearWarmBootCache();
+  }
+}
+
+void MultiUnitHwSwitch::exitFatal() const {
+  for (const auto& unit : units_) {
+    unit->exitFatal();
+  }
+}
+
+bool MultiUnitHwSwitch::isPortUp(PortID port) const {
+  auto unit = unitOfPort(port);
+  return unit && unit->isPortUp(port);
+}
+
+bool MultiUnitHwSwitch::getPortFECConfig(PortID port) const {
+  auto unit = unitOfPort(port);
+  return unit && unit->getPortFECConfig(port);
+}
+
+bool MultiUnitHwSwitch::getAndClearNeighborHit(
+    RouterID vrf,
+    folly::IPAddress& ip) {
+  // Clear the hit bit on every unit, not just up to the first hit
+  bool hit = false;
+  for (auto& unit : units_) {
+    hit |= unit->getAndClearNeighborHit(vrf, ip);
+  }
+  return hit;
+}
+
+folly::Optional<std::unordered_set<folly::IPAddress>>
+MultiUnitHwSwitch::getAndClearNeighborHits(RouterID vrf) {
+  std::unordered_set<folly::IPAddress> hits;
+  for (auto& unit : units_) {
+    auto unitHits = unit->getAndClearNeighborHits(vrf);
+    if (!unitHits) {
+      return folly::none;
+    }
+    hits.insert(unitHits->begin(), unitHits->end());
+  }
+  return hits;
+}
+
+void MultiUnitHwSwitch::getQueueBufferStats(
+    std::vector<QueueBufferStats>* stats,
+    std::chrono::seconds window) const {
+  for (const auto& unit : units_) {
+    unit->getQueueBufferStats(stats, window);
+  }
+}
+
+void MultiUnitHwSwitch::getEcmpBalance(
+    std::vector<EcmpGroupBalance>* groups,
+    size_t maxGroups) const {
+  for (const auto& unit : units_) {
+    unit->getEcmpBalance(groups, maxGroups);
+  }
+  std::stable_sort(
+      groups->begin(),
+      groups->end(),
+      [](const EcmpGroupBalance& a, const EcmpGroupBalance& b) {
+        return a.maxOverMeanPct > b.maxOverMeanPct;
+      });
+  if (groups->size() > maxGroups) {
+    groups->resize(maxGroups);
+  }
+}
+
+void MultiUnitHwSwitch::traceFlowHashing(
+    const std::vector<FlowTuple>& flows,
+    FlowHashingReport* report) {
+  // Each flow is traced by the unit it comes in on
+  std::vector<std::vector<FlowTuple>> unitFlows(units_.size());
+  for (const auto& flow : flows) {
+    auto unit = unitOfPort_(PortID(flow.ingressPort));
+    if (unit >= units_.size()) {
+      throw FbossError(
+          "can't trace a flow coming in on port ", flow.ingressPort,
+          ", it is on unit ", unit, " which doesn't exist");
+    }
+    unitFlows[unit].push_back(flow);
+  }
+  std::map<std::vector<int32_t>, std::map<int32_t, int64_t>> groups;
+  for (size_t unit = 0; unit < units_.size(); ++unit) {
+    if (unitFlows[unit].empty()) {
+      continue;
+    }
+    FlowHashingReport unitReport;
+    units_[unit]->traceFlowHashing(unitFlows[unit], &unitReport);
+    report->numTraced += unitReport.numTraced;
+    report->numFailed += unitReport.numFailed;
+    for (const auto& group : unitReport.groups) {
+      auto& flowsPerPort = groups[group.potentialEgressPorts];
+      for (const auto& portAndFlows : group.flowsPerEgressPort) {
+        flowsPerPort[portAndFlows.first] += portAndFlows.second;
+      }
+    }
+  }
+  for (auto& group : groups) {
+    EgressHashDistribution distribution;
+    distribution.potentialEgressPorts = group.first;
+    distribution.flowsPerEgressPort = std::move(group.second);
+    report->groups.push_back(std::move(distribution));
+  }
+}
+
+void MultiUnitHwSwitch::clearPortStats(
+    const std::unique_ptr<std::vector<int32_t>>& ports) {
+  std::vector<std::unique_ptr<std::vector<int32_t>>> unitPorts(units_.size());
+  for (auto port : *ports) {
+    auto unit = unitOfPort_(PortID(port));
+    if (unit >= units_.size()) {
+      XLOG(ERR) << "can't clear stats of port " << port << ", it is on unit "
+                << unit << " which doesn't exist";
+      continue;
+    }
+    if (!unitPorts[unit]) {
+      unitPorts[unit] = std::make_unique<std::vector<int32_t>>();
+    }
+    unitPorts[unit]->push_back(port);
+  }
+  for (size_t unit = 0; unit < units_.size(); ++unit) {
+    if (unitPorts[unit]) {
+      units_[unit]->clearPortStats(unitPorts[unit]);
+    }
+  }
+}
+
+}} // facebook::fboss
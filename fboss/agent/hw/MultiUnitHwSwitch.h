@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/HwSwitch.h"
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * A HwSwitch for a chassis with several switch ASICs, made of one HwSwitch
+ * per unit (e.g. a BcmSwitch each), so the rest of the agent still sees a
+ * single HwSwitch.
+ *
+ * Every state change is handed to all the units, each on a thread of its
+ * own, so programming takes about as long as the slowest unit rather than
+ * the sum of them all. Each unit is programmed from the state it applied
+ * last: a unit which failed to apply part of a change catches up by itself
+ * with the next one, like the hardware does as a whole.
+ *
+ * Ports are owned by a single unit each, as given by the unitOfPort
+ * function: packets sent out of a port go through its unit, and the ports
+ * each unit reports at init are put together into one state. Everything
+ * else about packet I/O goes through unit 0, the one whose CPU port the
+ * agent uses.
+ */
+class MultiUnitHwSwitch : public HwSwitch {
+ public:
+  using UnitOfPortFn = std::function<size_t(PortID)>;
+
+  MultiUnitHwSwitch(
+      std::vector<std::unique_ptr<HwSwitch>> units,
+      UnitOfPortFn unitOfPort);
+  ~MultiUnitHwSwitch() override;
+
+  size_t numUnits() const {
+    return units_.size();
+  }
+  HwSwitch* getUnit(size_t unit) const {
+    return units_.at(unit).get();
+  }
+
+  HwInitResult init(Callback* callback) override;
+  void unregisterCallbacks() override;
+
+  /*
+   * The applied state returned is the new state if every unit applied all
+   * of it. Otherwise it is the state applied by one of the units which did
+   * not: what every unit applied isn't known exactly, and the difference to
+   * the desired state just has to be non empty for the agent to retry it.
+   */
+  std::shared_ptr<SwitchState> stateChanged(const StateDelta& delta) override;
+  bool isValidStateUpdate(const StateDelta& delta) const override;
+
+  std::unique_ptr<TxPacket> allocatePacket(uint32_t size) override;
+  bool sendPacketSwitchedAsync(std::unique_ptr<TxPacket> pkt) noexcept
+      override;
+  bool sendPacketOutOfPortAsync(
+      std::unique_ptr<TxPacket> pkt,
+      PortID portID,
+      folly::Optional<uint8_t> cos = folly::none) noexcept override;
+  bool sendPacketsOutOfPortAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      PortID portID,
+      folly::Optional<uint8_t> cos = folly::none) noexcept override;
+  bool sendPacketSwitchedSync(std::unique_ptr<TxPacket> pkt) noexcept
+      override;
+  bool sendPacketOutOfPortSync(
+      std::unique_ptr<TxPacket> pkt,
+      PortID portID) noexcept override;
+
+  void updateStats(SwitchStats* switchStats) override;
+  int getHighresSamplers(
+      HighresSamplerList* samplers,
+      const std::string& namespaceString,
+      const std::set<CounterRequest>& counterSet) override;
+  void fetchL2Table(std::vector<L2EntryThrift>* l2Table) override;
+
+  /*
+   * Unit 0 saves its state into switchState as usual. The other units only
+   * get a copy: they are each expected to detach into warm boot files of
+   * their own.
+   */
+  void gracefulExit(folly::dynamic& switchState) override;
+  folly::dynamic toFollyDynamic() const override;
+  void initialConfigApplied() override;
+  void clearWarmBootCache() override;
+  void exitFatal() const override;
+
+  bool isPortUp(PortID port) const override;
+  bool getPortFECConfig(PortID port) const override;
+  // Hit on any of the units
+  bool getAndClearNeighborHit(RouterID vrf, folly::IPAddress& ip) override;
+  folly::Optional<std::unordered_set<folly::IPAddress>>
+  getAndClearNeighborHits(RouterID vrf) override;
+  void getQueueBufferStats(
+      std::vector<QueueBufferStats>* stats,
+      std::chrono::seconds window) const override;
+  // The worst groups of all the units
+  void getEcmpBalance(
+      std::vector<EcmpGroupBalance>* groups,
+      size_t maxGroups) const override;
+  void traceFlowHashing(
+      const std::vector<FlowTuple>& flows,
+      FlowHashingReport* report) override;
+  void clearPortStats(
+      const std::unique_ptr<std::vector<int32_t>>& ports) override;
+
+ private:
+  HwSwitch* unitOfPort(PortID port) const;
+  // Run fn(unit index) for every unit, each on its own thread
+  void forEachUnitConcurrently(const std::function<void(size_t)>& fn);
+
+  std::vector<std::unique_ptr<HwSwitch>> units_;
+  UnitOfPortFn unitOfPort_;
+  // The state each unit applied last, null until the first state change
+  std::vector<std::shared_ptr<SwitchState>> unitApplied_;
+  folly::CPUThreadPoolExecutor executor_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/StateChangeSections.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/logging/xlog.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace facebook { namespace fboss {
+
+struct StateChangeSections::RunState {
+  std::mutex lock;
+  std::condition_variable allDone;
+  // How many dependencies of each section are not done yet
+  std::vector<size_t> depsLeft;
+  // Sections to skip, as something they depend on threw
+  std::vector<bool> skip;
+  size_t sectionsLeft{0};
+  std::exception_ptr error;
+};
+
+StateChangeSections::SectionID StateChangeSections::add(
+    folly::StringPiece name,
+    std::function<void()> fn,
+    std::vector<SectionID> deps) {
+  auto id = sections_.size();
+  for (auto dep : deps) {
+    if (dep >= id) {
+      throw FbossError(
+          "state change section ", name, " depends on unknown section ", dep);
+    }
+    sections_[dep].dependents.push_back(id);
+  }
+  sections_.push_back(Section{name.str(), std::move(fn), std::move(deps), {}});
+  return id;
+}
+
+std::exception_ptr StateChangeSections::runSection(SectionID id) {
+  const auto& section = sections_[id];
+  auto start = steady_clock::now();
+  std::exception_ptr error;
+  try {
+    section.fn();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  XLOG(DBG3) << "state change section " << section.name << " took "
+             << duration_cast<microseconds>(steady_clock::now() - start)
+                    .count()
+             << "us";
+  return error;
+}
+
+void StateChangeSections::run(folly::Executor* executor) {
+  RunState state;
+  state.depsLeft.resize(sections_.size());
+  state.skip.resize(sections_.size(), false);
+  state.sectionsLeft = sections_.size();
+  for (SectionID id = 0; id < sections_.size(); ++id) {
+    state.depsLeft[id] = sections_[id].deps.size();
+  }
+
+  if (!executor) {
+    // Added after their dependencies, so the order added works
+    for (SectionID id = 0; id < sections_.size(); ++id) {
+      auto error = state.skip[id] ? nullptr : runSection(id);
+      if (error && !state.error) {
+        state.error = error;
+      }
+      if (error || state.skip[id]) {
+        for (auto dependent : sections_[id].dependents) {
+          state.skip[dependent] = true;
+        }
+      }
+    }
+  } else if (!sections_.empty()) {
+    std::vector<SectionID> ready;
+    for (SectionID id = 0; id < sections_.size(); ++id) {
+      if (state.depsLeft[id] == 0) {
+        ready.push_back(id);
+      }
+    }
+    for (auto id : ready) {
+      executor->add([this, id, &state, executor]() {
+        runOnExecutor(id, &state, executor);
+      });
+    }
+    std::unique_lock<std::mutex> g(state.lock);
+    state.allDone.wait(g, [&state] { return state.sectionsLeft == 0; });
+  }
+
+  if (state.error) {
+    std::rethrow_exception(state.error);
+  }
+}
+
+void StateChangeSections::runOnExecutor(
+    SectionID id,
+    RunState* state,
+    folly::Executor* executor) {
+  bool skip;
+  {
+    std::lock_guard<std::mutex> g(state->lock);
+    skip = state->skip[id];
+  }
+  auto error = skip ? nullptr : runSection(id);
+
+  std::vector<SectionID> ready;
+  {
+    std::lock_guard<std::mutex> g(state->lock);
+    if (error && !state->error) {
+      state->error = error;
+    }
+    for (auto dependent : sections_[id].dependents) {
+      if (error || skip) {
+        state->skip[dependent] = true;
+      }
+      if (--state->depsLeft[dependent] == 0) {
+        ready.push_back(dependent);
+      }
+    }
+    if (--state->sectionsLeft == 0) {
+      // Notified under the lock, as run() returns and destroys the state as
+      // soon as it gets the lock back
+      state->allDone.notify_all();
+      return;
+    }
+  }
+  // The sections handed over aren't done, so neither is run()
+  for (auto next : ready) {
+    executor->add([this, next, state, executor]() {
+      runOnExecutor(next, state, executor);
+    });
+  }
+}
+
+}} // facebook::fboss
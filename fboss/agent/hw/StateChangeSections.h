@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Executor.h>
+#include <folly/Range.h>
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * The sections a HwSwitch applies a StateDelta in, e.g. "routes" or "ACLs",
+ * and which sections each has to wait for.
+ *
+ * Without an executor the sections simply run one after the other, in the
+ * order they were added. With one, each section is handed to the executor
+ * as soon as the sections it depends on are done, so sections which don't
+ * depend on each other program the hardware concurrently. Only sections
+ * touching separate hardware tables and software state should be left
+ * independent.
+ */
+class StateChangeSections {
+ public:
+  using SectionID = size_t;
+
+  // deps must all have been added before, so the sections can't loop
+  SectionID add(
+      folly::StringPiece name,
+      std::function<void()> fn,
+      std::vector<SectionID> deps = {});
+
+  size_t size() const {
+    return sections_.size();
+  }
+
+  /*
+   * Run every section, returning once they all are done. If a section
+   * throws, the sections depending on it are skipped, and the first
+   * exception is rethrown once the others finished.
+   */
+  void run(folly::Executor* executor = nullptr);
+
+ private:
+  struct RunState;
+  // Run the section itself, returning what it threw if anything
+  std::exception_ptr runSection(SectionID id);
+  // Run the section on executor, then hand it the sections left ready
+  void runOnExecutor(
+      SectionID id,
+      RunState* state,
+      folly::Executor* executor);
+
+  struct Section {
+    std::string name;
+    std::function<void()> fn;
+    std::vector<SectionID> deps;
+    std::vector<SectionID> dependents;
+  };
+  std::vector<Section> sections_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmAclCompiler.h"
+
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+
+#include <algorithm>
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+template <typename T>
+bool coversExact(const folly::Optional<T>& a, const folly::Optional<T>& b) {
+  return !a || (b && *a == *b);
+}
+
+bool coversNetwork(const folly::CIDRNetwork& a, const folly::CIDRNetwork& b) {
+  if (a.first.empty()) {
+    return true;
+  }
+  return !b.first.empty() && a.first.family() == b.first.family() &&
+      b.second >= a.second && b.first.inSubnet(a.first, a.second);
+}
+
+template <typename T>
+bool coversRange(
+    const folly::Optional<GenericAclRange<T>>& a,
+    const folly::Optional<GenericAclRange<T>>& b) {
+  if (!a) {
+    return true;
+  }
+  if (!b) {
+    return false;
+  }
+  if (a->getInvert() || b->getInvert()) {
+    return *a == *b;
+  }
+  return a->getMin() <= b->getMin() && b->getMax() <= a->getMax();
+}
+
+bool coversTtl(
+    const folly::Optional<AclTtl>& a,
+    const folly::Optional<AclTtl>& b) {
+  if (!a) {
+    return true;
+  }
+  if (!b) {
+    return false;
+  }
+  auto mask = a->getMask();
+  return (b->getMask() & mask) == mask &&
+      (b->getValue() & mask) == (a->getValue() & mask);
+}
+
+// Acls with counters are always programmed, even when never hit, so that
+// their counters are still there to be read
+bool hasCounter(const AclEntry& acl) {
+  auto action = acl.getAclAction();
+  return action && action->getTrafficCounter();
+}
+
+// How one of the ranges of an acl is going to be matched
+struct RangeUse {
+  folly::Optional<AclRange> range;
+  uint32_t prefixes{1};
+  bool needsChecker{false};
+};
+
+RangeUse getRangeUse(
+    uint32_t flags,
+    const folly::Optional<AclL4PortRange>& range) {
+  RangeUse use;
+  if (!range) {
+    return use;
+  }
+  use.range = AclRange(flags, range->getMin(), range->getMax());
+  if (flags == AclRange::PKT_LEN || range->getInvert()) {
+    use.needsChecker = true;
+  } else {
+    use.prefixes = BcmAclCompiler::rangeToPrefixes(
+        range->getMin(), range->getMax()).size();
+  }
+  return use;
+}
+
+} // unnamed namespace
+
+std::vector<BcmAclCompiler::PortMask> BcmAclCompiler::rangeToPrefixes(
+    uint16_t min,
+    uint16_t max) {
+  std::vector<PortMask> prefixes;
+  // Work in 32 bits so that stepping past 0xffff ends the loop
+  uint32_t lo = min;
+  while (lo <= max) {
+    // The biggest aligned block starting at lo that still fits in the range
+    uint32_t size = lo == 0 ? 0x10000 : (lo & -lo);
+    while (lo + size - 1 > max) {
+      size >>= 1;
+    }
+    prefixes.emplace_back(lo, static_cast<uint16_t>(~(size - 1)));
+    lo += size;
+  }
+  return prefixes;
+}
+
+bool BcmAclCompiler::covers(const AclEntry& a, const AclEntry& b) {
+  return coversNetwork(a.getSrcIp(), b.getSrcIp()) &&
+      coversNetwork(a.getDstIp(), b.getDstIp()) &&
+      coversExact(a.getProto(), b.getProto()) &&
+      coversExact(a.getTcpFlagsBitMap(), b.getTcpFlagsBitMap()) &&
+      coversExact(a.getSrcPort(), b.getSrcPort()) &&
+      coversExact(a.getDstPort(), b.getDstPort()) &&
+      coversRange(a.getSrcL4PortRange(), b.getSrcL4PortRange()) &&
+      coversRange(a.getDstL4PortRange(), b.getDstL4PortRange()) &&
+      coversRange(a.getPktLenRange(), b.getPktLenRange()) &&
+      coversExact(a.getIpFrag(), b.getIpFrag()) &&
+      coversExact(a.getIcmpType(), b.getIcmpType()) &&
+      coversExact(a.getIcmpCode(), b.getIcmpCode()) &&
+      coversExact(a.getDscp(), b.getDscp()) &&
+      coversExact(a.getIpType(), b.getIpType()) &&
+      coversTtl(a.getTtl(), b.getTtl()) &&
+      coversExact(a.getDstMac(), b.getDstMac()) &&
+      coversExact(a.getDstIpLocal(), b.getDstIpLocal());
+}
+
+BcmAclCompiler::Result BcmAclCompiler::compile(
+    const std::shared_ptr<AclMap>& acls,
+    uint32_t numRangeCheckers) {
+  std::vector<std::shared_ptr<AclEntry>> sorted(acls->begin(), acls->end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a->getPriority() < b->getPriority();
+  });
+  return compile(sorted, numRangeCheckers);
+}
+
+BcmAclCompiler::Result BcmAclCompiler::compile(
+    const std::vector<std::shared_ptr<AclEntry>>& acls,
+    uint32_t numRangeCheckers) {
+  Result result;
+
+  std::vector<const AclEntry*> programmed;
+  for (const auto& acl : acls) {
+    if (!hasCounter(*acl)) {
+      // Only programmed acls can hide others, a shadowed acl is covered by
+      // whatever covers it anyway
+      auto shadowing = std::find_if(
+          programmed.begin(), programmed.end(), [&](const AclEntry* other) {
+            return covers(*other, *acl);
+          });
+      if (shadowing != programmed.end()) {
+        result.shadowed.emplace(
+            acl->getPriority(), (*shadowing)->getPriority());
+        continue;
+      }
+    }
+    programmed.push_back(acl.get());
+  }
+
+  std::vector<std::pair<RangeUse, RangeUse>> uses;
+  uses.reserve(programmed.size());
+  // TCAM entries saved by giving each range a range checker
+  boost::container::flat_map<AclRange, uint64_t> savings;
+  for (const auto* acl : programmed) {
+    auto l4Src = getRangeUse(AclRange::SRC_L4_PORT, acl->getSrcL4PortRange());
+    auto l4Dst = getRangeUse(AclRange::DST_L4_PORT, acl->getDstL4PortRange());
+    auto pktLen = getRangeUse(AclRange::PKT_LEN, acl->getPktLenRange());
+    for (const auto& use : {l4Src, l4Dst, pktLen}) {
+      if (use.needsChecker) {
+        result.rangeCheckers.insert(*use.range);
+      }
+    }
+    if (l4Src.prefixes > 1) {
+      savings[*l4Src.range] += (l4Src.prefixes - 1) * l4Dst.prefixes;
+    }
+    if (l4Dst.prefixes > 1) {
+      savings[*l4Dst.range] += (l4Dst.prefixes - 1) * l4Src.prefixes;
+    }
+    uses.emplace_back(l4Src, l4Dst);
+  }
+
+  // Ranges that can't be expanded get the range checkers first, the rest go
+  // to the ranges that would cost the most to expand
+  std::vector<std::pair<AclRange, uint64_t>> candidates(
+      savings.begin(), savings.end());
+  std::stable_sort(
+      candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+      });
+  for (const auto& candidate : candidates) {
+    if (result.usesRangeChecker(candidate.first)) {
+      continue;
+    } else if (result.rangeCheckers.size() < numRangeCheckers) {
+      result.rangeCheckers.insert(candidate.first);
+    } else {
+      result.expandedRanges.insert(candidate.first);
+    }
+  }
+
+  for (const auto& use : uses) {
+    auto entries = [&](const RangeUse& range) -> uint32_t {
+      return range.range && !result.usesRangeChecker(*range.range)
+          ? range.prefixes
+          : 1;
+    };
+    result.tcamEntries += entries(use.first) * entries(use.second);
+  }
+  return result;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/hw/bcm/BcmAclRange.h"
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class AclEntry;
+class AclMap;
+
+/*
+ * Works out how the acls of a switch state should be laid out in the TCAM
+ * before BcmAclTable programs them.
+ *
+ * Only the highest priority entry matching a packet takes effect, so an acl
+ * matching nothing that a higher priority acl doesn't already match is never
+ * hit, and is left out of the hardware altogether.
+ *
+ * L4 port ranges can either use one of the few hardware range checkers, or
+ * be expanded into the value/mask pairs covering them at the cost of one
+ * TCAM entry per pair. The range checkers go to the ranges that would cost
+ * the most entries to expand, and everything else is expanded. Packet length
+ * and inverted ranges have no expansion and always need a range checker.
+ */
+class BcmAclCompiler {
+ public:
+  struct Result {
+    // Acls that are never hit, by priority, and the acl hiding each
+    boost::container::flat_map<int, int> shadowed;
+    boost::container::flat_set<AclRange> rangeCheckers;
+    // Ranges taking more than one value/mask pair to match without a range
+    // checker. Ranges in neither set match with a single value/mask pair.
+    boost::container::flat_set<AclRange> expandedRanges;
+    // TCAM entries taken by the acls that are programmed
+    uint32_t tcamEntries{0};
+
+    bool isShadowed(int priority) const {
+      return shadowed.find(priority) != shadowed.end();
+    }
+    bool usesRangeChecker(const AclRange& range) const {
+      return rangeCheckers.find(range) != rangeCheckers.end();
+    }
+  };
+
+  using PortMask = std::pair<uint16_t /* value */, uint16_t /* mask */>;
+
+  static Result compile(
+      const std::shared_ptr<AclMap>& acls,
+      uint32_t numRangeCheckers);
+  // The acls must be in priority order
+  static Result compile(
+      const std::vector<std::shared_ptr<AclEntry>>& acls,
+      uint32_t numRangeCheckers);
+
+  // The fewest value/mask pairs matching exactly the ports in [min, max]
+  static std::vector<PortMask> rangeToPrefixes(uint16_t min, uint16_t max);
+
+  // Whether every packet matched by b is also matched by a
+  static bool covers(const AclEntry& a, const AclEntry& b);
+};
+
+}} // facebook::fboss
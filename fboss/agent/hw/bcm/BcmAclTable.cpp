@@ -15,8 +15,16 @@
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 #include "fboss/agent/hw/bcm/types.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
+#include "fboss/agent/state/AclMap.h"
 
 #include <folly/CppAttributes.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+DEFINE_int32(acl_range_checkers, 32,
+    "Number of hardware range checkers acl port ranges can use before "
+    "being expanded into multiple TCAM entries");
 
 namespace facebook { namespace fboss {
 
@@ -29,15 +37,45 @@ void BcmAclTable::releaseAcls() {
   aclEntryMap_.clear();
   aclStatMap_.clear();
   aclRangeMap_.clear();
+  skippedAcls_.clear();
+  compiled_ = BcmAclCompiler::Result();
+}
+
+std::vector<int> BcmAclTable::compileAcls(
+    const std::shared_ptr<AclMap>& acls) {
+  auto compiled = BcmAclCompiler::compile(acls, FLAGS_acl_range_checkers);
+  std::vector<int> flipped;
+  for (const auto& entry : compiled_.shadowed) {
+    if (!compiled.isShadowed(entry.first)) {
+      flipped.push_back(entry.first);
+    }
+  }
+  for (const auto& entry : compiled.shadowed) {
+    if (!compiled_.isShadowed(entry.first)) {
+      flipped.push_back(entry.first);
+    }
+  }
+  compiled_ = std::move(compiled);
+  return flipped;
 }
 
 void BcmAclTable::processAddedAcl(
   const int groupId,
   const std::shared_ptr<AclEntry>& acl) {
-  if (aclEntryMap_.find(acl->getPriority()) != aclEntryMap_.end()) {
+  if (aclEntryMap_.find(acl->getPriority()) != aclEntryMap_.end() ||
+      skippedAcls_.find(acl->getPriority()) != skippedAcls_.end()) {
     throw FbossError("ACL=", acl->getID(), " already exists");
   }
+  if (compiled_.isShadowed(acl->getPriority())) {
+    XLOG(DBG2) << "Not programming ACL=" << acl->getID()
+               << ", it is shadowed by the acl with priority "
+               << compiled_.shadowed.at(acl->getPriority());
+    skippedAcls_.insert(acl->getPriority());
+    return;
+  }
 
+  HwCallScope call(HwCall::ACL_ADD);
+  call.setId(acl->getPriority());
   std::unique_ptr<BcmAclEntry> bcmAcl =
     std::make_unique<BcmAclEntry>(hw_, groupId, acl);
   const auto& entry = aclEntryMap_.emplace(acl->getPriority(),
@@ -49,6 +87,11 @@ void BcmAclTable::processAddedAcl(
 
 void BcmAclTable::processRemovedAcl(
   const std::shared_ptr<AclEntry>& acl) {
+  if (skippedAcls_.erase(acl->getPriority())) {
+    return;
+  }
+  HwCallScope call(HwCall::ACL_DELETE);
+  call.setId(acl->getPriority());
   const auto numErasedAcl = aclEntryMap_.erase(acl->getPriority());
   if (numErasedAcl == 0) {
     throw FbossError("Failed to erase an existing bcm acl entry");
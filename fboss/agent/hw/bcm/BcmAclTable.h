@@ -10,11 +10,13 @@
 #pragma once
 
 #include "fboss/agent/Utils.h"
+#include "fboss/agent/hw/bcm/BcmAclCompiler.h"
 #include "fboss/agent/hw/bcm/BcmAclEntry.h"
 #include "fboss/agent/hw/bcm/BcmAclRange.h"
 #include "fboss/agent/hw/bcm/BcmAclStat.h"
 
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 
 namespace facebook { namespace fboss {
 
@@ -37,6 +39,22 @@ class BcmAclTable {
 
   explicit BcmAclTable(BcmSwitch* hw) : hw_(hw) {}
   ~BcmAclTable() {}
+
+  /*
+   * Work out the layout of the acls about to be programmed. Returns the
+   * priorities of the acls that became shadowed or stopped being shadowed,
+   * which have to be reprogrammed even if they didn't change themselves.
+   */
+  std::vector<int> compileAcls(const std::shared_ptr<AclMap>& acls);
+  const BcmAclCompiler::Result& getCompiledAcls() const {
+    return compiled_;
+  }
+  // Whether the range should use a range checker rather than be expanded
+  bool useRangeChecker(const AclRange& range) const {
+    return compiled_.usesRangeChecker(range);
+  }
+
+  // Shadowed acls are not written to the TCAM
   void processAddedAcl(const int groupId, const std::shared_ptr<AclEntry>& acl);
   void processRemovedAcl(const std::shared_ptr<AclEntry>& acl);
   void releaseAcls();
@@ -91,6 +109,9 @@ class BcmAclTable {
   BcmAclRangeMap aclRangeMap_;
   BcmAclEntryMap aclEntryMap_;
   BcmAclStatMap aclStatMap_;
+  BcmAclCompiler::Result compiled_;
+  // Priorities of acls left out of the TCAM because they are shadowed
+  boost::container::flat_set<int> skippedAcls_;
 };
 
 }} // facebook::fboss
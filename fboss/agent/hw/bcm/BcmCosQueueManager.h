@@ -75,6 +75,12 @@ public:
 
   virtual int getNumQueues(cfg::StreamType streamType) const = 0;
 
+  /*
+   * The bytes of buffer currently used by a unicast queue, or none if the
+   * hardware can't tell us.
+   */
+  folly::Optional<uint64_t> getQueueOccupancy(opennsl_cos_queue_t cosQ) const;
+
   opennsl_cos_queue_t getCosQueue(cfg::StreamType streamType,
                                   opennsl_gport_t gport) const;
 
@@ -93,6 +99,17 @@ public:
 
   virtual void program(const std::shared_ptr<PortQueue>& queue) = 0;
 
+  /*
+   * Move the queue from the oldQueue settings to the newQueue ones. By
+   * default the queue is programmed from scratch, managers which can tell
+   * which of its parameters changed only write those.
+   */
+  virtual void programChanges(
+      const std::shared_ptr<PortQueue>& /*oldQueue*/,
+      const std::shared_ptr<PortQueue>& newQueue) {
+    program(newQueue);
+  }
+
   struct QueueStatCounters {
     facebook::stats::MonotonicCounter* aggregated = nullptr;
     boost::container::flat_map<int, facebook::stats::MonotonicCounter*> queues;
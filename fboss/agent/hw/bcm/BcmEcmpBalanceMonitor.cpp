@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmEcmpBalanceMonitor.h"
+
+#include "common/stats/ThreadCachedServiceData.h"
+#include "fboss/agent/hw/bcm/BcmHost.h"
+#include "fboss/agent/hw/bcm/BcmPort.h"
+#include "fboss/agent/hw/bcm/BcmPortTable.h"
+#include "fboss/agent/hw/bcm/BcmSwitch.h"
+
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+DEFINE_int32(ecmp_balance_interval_s, 0,
+             "How often to measure how evenly the ECMP groups spread their "
+             "traffic over their member ports, 0 to disable");
+DEFINE_int32(ecmp_imbalance_threshold_pct, 150,
+             "Busiest member load over mean member load, in percent, above "
+             "which an ECMP group counts as imbalanced");
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+namespace {
+// Groups kept for getWorstGroups()
+constexpr size_t kMaxWorstGroups = 256;
+constexpr auto kWorstImbalance = "ecmp_balance.worst_max_over_mean_pct";
+constexpr auto kImbalancedGroups = "ecmp_balance.imbalanced_groups";
+}
+
+namespace facebook { namespace fboss {
+
+uint32_t BcmEcmpBalanceMonitor::maxOverMeanPct(
+    const std::vector<std::pair<uint64_t, uint32_t>>& bytesAndPaths) {
+  double total = 0;
+  uint32_t numPaths = 0;
+  double maxPerPath = 0;
+  for (const auto& member : bytesAndPaths) {
+    total += member.first;
+    numPaths += member.second;
+    maxPerPath =
+        std::max(maxPerPath, static_cast<double>(member.first) / member.second);
+  }
+  if (total == 0) {
+    return 0;
+  }
+  return static_cast<uint32_t>(maxPerPath * numPaths * 100 / total + 0.5);
+}
+
+void BcmEcmpBalanceMonitor::updateStats(steady_clock::time_point now) {
+  if (FLAGS_ecmp_balance_interval_s <= 0 ||
+      now - lastMeasured_ < seconds(FLAGS_ecmp_balance_interval_s)) {
+    return;
+  }
+  collectAndRecord(now);
+}
+
+void BcmEcmpBalanceMonitor::collectAndRecord(steady_clock::time_point now) {
+  PortBytes portBytes;
+  boost::container::flat_map<opennsl_gport_t, PortID> gportToPort;
+  for (const auto& entry : *hw_->getPortTable()) {
+    auto outBytes = entry.second->getPortStats().outBytes_;
+    if (outBytes >= 0) {
+      portBytes.emplace(entry.first, outBytes);
+    }
+    gportToPort.emplace(entry.second->getBcmGport(), entry.first);
+  }
+
+  auto hostTable = hw_->getHostTable();
+  boost::container::flat_map<opennsl_if_t, PortID> egressToPort;
+  for (const auto& portAndEgressIds : *hostTable->getPortAndEgressIdsMap()) {
+    auto port = gportToPort.find(portAndEgressIds->getID());
+    if (port == gportToPort.end()) {
+      // A trunk
+      continue;
+    }
+    for (auto egressId : portAndEgressIds->getEgressIds()) {
+      egressToPort.emplace(egressId, port->second);
+    }
+  }
+
+  std::vector<EcmpGroup> groups;
+  hostTable->forEachEcmpEgress(
+      [&](opennsl_if_t ecmpId, const BcmEcmpEgress::Paths& paths) {
+        std::vector<PortID> ports;
+        ports.reserve(paths.size());
+        for (auto path : paths) {
+          auto port = egressToPort.find(path);
+          if (port == egressToPort.end()) {
+            return;
+          }
+          ports.push_back(port->second);
+        }
+        groups.emplace_back(ecmpId, std::move(ports));
+      });
+  recordMeasurement(portBytes, groups, now);
+}
+
+void BcmEcmpBalanceMonitor::recordMeasurement(
+    const PortBytes& portBytes,
+    const std::vector<EcmpGroup>& groups,
+    steady_clock::time_point now) {
+  auto elapsed = duration_cast<duration<double>>(now - lastMeasured_).count();
+  auto firstMeasurement = lastPortBytes_.empty();
+  auto lastPortBytes = std::move(lastPortBytes_);
+  lastPortBytes_ = portBytes;
+  lastMeasured_ = now;
+  if (firstMeasurement || elapsed <= 0) {
+    return;
+  }
+
+  // Bytes per second out of each port, for those with a previous counter
+  boost::container::flat_map<PortID, uint64_t> rates;
+  for (const auto& entry : portBytes) {
+    auto last = lastPortBytes.find(entry.first);
+    if (last != lastPortBytes.end() && entry.second >= last->second) {
+      rates.emplace(entry.first, (entry.second - last->second) / elapsed);
+    }
+  }
+
+  std::vector<EcmpGroupBalance> balances;
+  uint32_t numImbalanced = 0;
+  boost::container::flat_map<PortID, uint32_t> paths;
+  for (const auto& group : groups) {
+    paths.clear();
+    for (auto port : group.second) {
+      ++paths[port];
+    }
+    if (paths.size() < 2) {
+      continue;
+    }
+    std::vector<std::pair<uint64_t, uint32_t>> bytesAndPaths;
+    bytesAndPaths.reserve(paths.size());
+    for (const auto& portAndPaths : paths) {
+      auto rate = rates.find(portAndPaths.first);
+      if (rate == rates.end()) {
+        break;
+      }
+      bytesAndPaths.emplace_back(rate->second, portAndPaths.second);
+    }
+    auto pct = bytesAndPaths.size() == paths.size()
+        ? maxOverMeanPct(bytesAndPaths)
+        : 0;
+    if (pct == 0) {
+      continue;
+    }
+    if (pct > static_cast<uint32_t>(FLAGS_ecmp_imbalance_threshold_pct)) {
+      ++numImbalanced;
+    }
+    EcmpGroupBalance balance;
+    balance.ecmpId = group.first;
+    balance.maxOverMeanPct = pct;
+    size_t i = 0;
+    for (const auto& portAndPaths : paths) {
+      balance.memberBytesPerSec[portAndPaths.first] = bytesAndPaths[i++].first;
+    }
+    balances.push_back(std::move(balance));
+  }
+
+  auto byImbalance = [](const EcmpGroupBalance& a, const EcmpGroupBalance& b) {
+    return a.maxOverMeanPct > b.maxOverMeanPct;
+  };
+  auto numKept = std::min(balances.size(), kMaxWorstGroups);
+  std::partial_sort(
+      balances.begin(),
+      balances.begin() + numKept,
+      balances.end(),
+      byImbalance);
+  balances.resize(numKept);
+
+  tcData().setCounter(
+      kWorstImbalance, balances.empty() ? 0 : balances.front().maxOverMeanPct);
+  tcData().setCounter(kImbalancedGroups, numImbalanced);
+  XLOG(DBG2) << "Measured the balance of " << groups.size()
+             << " ECMP groups, " << numImbalanced << " imbalanced";
+  *worstGroups_.wlock() = std::move(balances);
+}
+
+std::vector<EcmpGroupBalance> BcmEcmpBalanceMonitor::getWorstGroups(
+    size_t maxGroups) const {
+  auto worstGroups = worstGroups_.rlock();
+  auto end = worstGroups->begin() + std::min(maxGroups, worstGroups->size());
+  return std::vector<EcmpGroupBalance>(worstGroups->begin(), end);
+}
+
+}} // facebook::fboss
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+#include "fboss/agent/types.h"
+
+#include <boost/container/flat_map.hpp>
+#include <folly/Synchronized.h>
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class BcmSwitch;
+
+/*
+ * BcmEcmpBalanceMonitor measures how evenly the ECMP groups spread their
+ * traffic over their members, every --ecmp_balance_interval_s.
+ *
+ * There are no per member counters, so it goes by the egress byte counters
+ * of the member ports, which the stats collection reads anyway: a group's
+ * members are its paths' ports, as found through the port -> egressIds map,
+ * and a member port's load is all that went out of it since the last
+ * measurement, over the number of paths of the group going through it. A
+ * measurement is thus a single pass over the ports and the groups' paths,
+ * without any SDK calls, whatever the number of groups. Groups with paths
+ * over trunks are left out.
+ *
+ * The least balanced groups are kept for getWorstGroups(), and the worst
+ * imbalance and the number of groups over --ecmp_imbalance_threshold_pct
+ * are exported as counters.
+ */
+class BcmEcmpBalanceMonitor {
+ public:
+  // ECMP egress ID and its member ports, a port once for each path over it
+  using EcmpGroup = std::pair<int32_t, std::vector<PortID>>;
+  using PortBytes = boost::container::flat_map<PortID, uint64_t>;
+
+  explicit BcmEcmpBalanceMonitor(const BcmSwitch* hw) : hw_(hw) {}
+
+  /*
+   * Measure, if the interval went by since the last measurement. Called
+   * from the stats collection with the hw lock held, as ECMP groups are
+   * created and destroyed with it.
+   */
+  void updateStats(std::chrono::steady_clock::time_point now);
+
+  /*
+   * The least balanced groups of the last measurement, worst first.
+   */
+  std::vector<EcmpGroupBalance> getWorstGroups(size_t maxGroups) const;
+
+  /*
+   * Measure from the egress byte counters of the ports at now. The first
+   * measurement only records the counters. Public for tests.
+   */
+  void recordMeasurement(
+      const PortBytes& portBytes,
+      const std::vector<EcmpGroup>& groups,
+      std::chrono::steady_clock::time_point now);
+
+  /*
+   * Load of the busiest member over the mean load, in percent, the load of
+   * a member being its bytes per second over its number of paths. 0 if
+   * there is no traffic at all. Public for tests.
+   */
+  static uint32_t maxOverMeanPct(
+      const std::vector<std::pair<uint64_t, uint32_t>>& bytesAndPaths);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BcmEcmpBalanceMonitor(BcmEcmpBalanceMonitor const&) = delete;
+  BcmEcmpBalanceMonitor& operator=(BcmEcmpBalanceMonitor const&) = delete;
+
+  void collectAndRecord(std::chrono::steady_clock::time_point now);
+
+  const BcmSwitch* hw_;
+  std::chrono::steady_clock::time_point lastMeasured_;
+  // Egress byte counters at the last measurement
+  PortBytes lastPortBytes_;
+  // Worst first
+  folly::Synchronized<std::vector<EcmpGroupBalance>> worstGroups_;
+};
+
+}} // facebook::fboss
@@ -10,14 +10,36 @@
 #include "BcmEgress.h"
 
 #include "fboss/agent/Constants.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmHost.h"
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <string>
 
+namespace {
+
+bool ValidateResilientHashSize(const char* flagname, int32_t value) {
+  if (value < 0 || (value & (value - 1)) != 0) {
+    printf("--%s must be 0 or a power of 2, got %d\n", flagname, value);
+    return false;
+  }
+  return true;
+}
+
+}
+
+DEFINE_int32(
+    ecmp_resilient_hash_size,
+    0,
+    "Number of flow buckets in the resilient hashing table of each ECMP "
+    "group, so that a member change only moves the flows hashed to that "
+    "member. 0 programs groups for regular hashing");
+DEFINE_validator(ecmp_resilient_hash_size, &ValidateResilientHashSize);
+
 namespace facebook { namespace fboss {
 
 using folly::IPAddress;
@@ -60,6 +82,9 @@ void BcmEgress::verifyDropEgress(int unit) {
 void BcmEgress::program(opennsl_if_t intfId, opennsl_vrf_t vrf,
     const IPAddress& ip, const MacAddress* mac, opennsl_port_t port,
     RouteForwardAction action) {
+  HwCallScope call(HwCall::EGRESS_PROGRAM);
+  call.setAddress(ip);
+  call.setVrf(vrf);
   opennsl_l3_egress_t eObj;
   opennsl_l3_egress_t_init(&eObj);
   if (mac == nullptr) {
@@ -166,6 +191,7 @@ void BcmEgress::program(opennsl_if_t intfId, opennsl_vrf_t vrf,
     warmBootCache->programmed(egressId2EgressCitr);
   }
   CHECK_NE(id_, INVALID);
+  call.setId(id_);
 }
 
 void BcmEgress::programToCPU() {
@@ -193,6 +219,8 @@ BcmEgress::~BcmEgress() {
   if (id_ == INVALID) {
     return;
   }
+  HwCallScope call(HwCall::EGRESS_DELETE);
+  call.setId(id_);
   auto rc = opennsl_l3_egress_destroy(hw_->getUnit(), id_);
   bcmLogFatal(rc, hw_, "failed to destroy L3 egress object ",
       id_, " on unit ", hw_->getUnit());
@@ -206,9 +234,24 @@ BcmEcmpEgress::BcmEcmpEgress(const BcmSwitchIf* hw, const Paths& paths)
 }
 
 void BcmEcmpEgress::program() {
+  HwCallScope call(HwCall::ECMP_PROGRAM);
+  call.setCount(paths_.size());
   opennsl_l3_egress_ecmp_t obj;
   opennsl_l3_egress_ecmp_t_init(&obj);
   obj.max_paths = ((paths_.size() + 3) >> 2) << 2; // multiple of 4
+  const auto& flowlet = hw_->getHostTable()->getEcmpFlowletConfig();
+  if (flowlet) {
+    // Dynamic load balancing takes precedence over resilient hashing, the
+    // two use the same table in HW
+    obj.dynamic_mode = OPENNSL_L3_ECMP_DYNAMIC_MODE_NORMAL;
+    obj.dynamic_size = flowlet->tableSize;
+    obj.dynamic_age = flowlet->inactivityUsecs;
+  } else if (FLAGS_ecmp_resilient_hash_size > 0) {
+    // Weights are realized by replicating members in paths_, which also
+    // gives heavier members proportionally more of the flow buckets
+    obj.dynamic_mode = OPENNSL_L3_ECMP_DYNAMIC_MODE_RESILIENT;
+    obj.dynamic_size = FLAGS_ecmp_resilient_hash_size;
+  }
 
   const auto warmBootCache = hw_->getWarmBootCache();
   auto egressIds2EcmpCItr = warmBootCache->findEcmp(paths_);
@@ -262,12 +305,16 @@ void BcmEcmpEgress::program() {
                << paths_.size() << " paths";
   }
   CHECK_NE(id_, INVALID);
+  call.setId(id_);
 }
 
 BcmEcmpEgress::~BcmEcmpEgress() {
   if (id_ == INVALID) {
     return;
   }
+  HwCallScope call(HwCall::ECMP_DELETE);
+  call.setId(id_);
+  call.setCount(paths_.size());
   opennsl_l3_egress_ecmp_t obj;
   opennsl_l3_egress_ecmp_t_init(&obj);
   obj.ecmp_intf = id_;
@@ -314,6 +361,17 @@ bool BcmEcmpEgress::removeEgressIdHwLocked(
   return removeEgressIdHwNotLocked(unit, ecmpId, toRemove);
 }
 
+bool BcmEcmpEgress::removeEgressIdsHwNotLocked(
+    int unit,
+    EgressId ecmpId,
+    const EgressIdSet& toRemove) {
+  bool removed = false;
+  for (auto egressId : toRemove) {
+    removed |= removeEgressIdHwNotLocked(unit, ecmpId, egressId);
+  }
+  return removed;
+}
+
 void BcmEgress::programToTrunk(opennsl_if_t intfId, opennsl_vrf_t /* vrf */,
                                const folly::IPAddress& /* ip */,
                                const MacAddress mac, opennsl_trunk_t trunk) {
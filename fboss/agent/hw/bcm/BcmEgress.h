@@ -124,8 +124,37 @@ class BcmEcmpEgress : public BcmEgressBase {
   using Paths = boost::container::flat_multiset<EgressId>;
   enum class Action { SHRINK, EXPAND, SKIP };
 
+  /*
+   * Dynamic load balancing settings, shared by all ECMP groups. Flows are
+   * split into flowlets at idle gaps of at least inactivityUsecs, and each
+   * flowlet goes to the member the ASIC currently rates the least loaded.
+   */
+  struct FlowletConfig {
+    uint32_t inactivityUsecs{0};
+    uint32_t tableSize{0};
+
+    bool operator==(const FlowletConfig& other) const {
+      return inactivityUsecs == other.inactivityUsecs &&
+          tableSize == other.tableSize;
+    }
+    bool operator!=(const FlowletConfig& other) const {
+      return !(*this == other);
+    }
+  };
+
   BcmEcmpEgress(const BcmSwitchIf* hw, const Paths& paths);
   ~BcmEcmpEgress() override;
+  /*
+   * Program the group again, to pick up a change of the flowlet config
+   */
+  void reprogram() {
+    program();
+  }
+  /*
+   * Number of times flowlets of this group moved to another member. Returns
+   * false if the SDK can not tell.
+   */
+  bool getFlowletReassignments(uint64_t* reassignments) const;
   bool pathUnreachableHwLocked(EgressId path);
   bool pathReachableHwLocked(EgressId path);
   const Paths& paths() const {
@@ -150,6 +179,14 @@ class BcmEcmpEgress : public BcmEgressBase {
   removeEgressIdHwNotLocked(int unit, EgressId ecmpId, EgressId toRemove);
   static bool
   removeEgressIdHwLocked(int unit, EgressId ecmpId, EgressId toRemove);
+  /*
+   * Remove several members of one ECMP group. Returns whether any of them
+   * were removed.
+   */
+  static bool removeEgressIdsHwNotLocked(
+      int unit,
+      EgressId ecmpId,
+      const EgressIdSet& toRemove);
 
  private:
   void program();
@@ -0,0 +1,187 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmHashTracer.h"
+
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/UDPHeader.h"
+#include "fboss/agent/hw/bcm/BcmPlatform.h"
+#include "fboss/agent/hw/bcm/BcmSwitch.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/packet/Ethertype.h"
+#include "fboss/agent/packet/IPProto.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
+#include "fboss/agent/packet/IPv6Hdr.h"
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include <algorithm>
+#include <map>
+
+using facebook::network::toIPAddress;
+using folly::MacAddress;
+using folly::io::RWPrivateCursor;
+
+namespace {
+// Flows whose packets are built ahead of the traces at a time
+constexpr size_t kChunkFlows = 256;
+// Untagged: DA (6), SA (6), Protocol (2)
+constexpr uint32_t kEthHdrSize = 14;
+constexpr uint32_t kTcpHdrSize = 20;
+const MacAddress kSrcMac("02:00:00:00:00:01");
+}
+
+namespace facebook { namespace fboss {
+
+BcmHashTracer::BcmHashTracer(BcmSwitchIf* hw)
+    : hw_(hw),
+      builder_(
+          1, std::make_shared<folly::NamedThreadFactory>("HashTraceBuild")) {}
+
+BcmHashTracer::~BcmHashTracer() {}
+
+std::unique_ptr<MockRxPacket> BcmHashTracer::makeFlowPacket(
+    const FlowTuple& flow,
+    MacAddress dstMac) {
+  auto src = toIPAddress(flow.srcIp);
+  auto dst = toIPAddress(flow.dstIp);
+  if (src.version() != dst.version()) {
+    throw FbossError("flow from ", src, " to ", dst, " mixes IPv4 and IPv6");
+  }
+  if (flow.srcPort < 0 || flow.srcPort > 0xffff || flow.dstPort < 0 ||
+      flow.dstPort > 0xffff) {
+    throw FbossError("invalid L4 ports ", flow.srcPort, " -> ", flow.dstPort);
+  }
+  uint8_t proto = flow.ipProtocol;
+  uint32_t l4Size;
+  if (proto == static_cast<uint8_t>(IP_PROTO::IP_PROTO_UDP)) {
+    l4Size = UDPHeader::size();
+  } else if (proto == static_cast<uint8_t>(IP_PROTO::IP_PROTO_TCP)) {
+    l4Size = kTcpHdrSize;
+  } else {
+    throw FbossError(
+        "can only trace TCP and UDP flows, not protocol ",
+        static_cast<int>(proto));
+  }
+  uint32_t ipSize = src.isV4() ? IPv4Hdr::minSize() : IPv6Hdr::size();
+
+  auto buf = folly::IOBuf::create(kEthHdrSize + ipSize + l4Size);
+  buf->append(kEthHdrSize + ipSize + l4Size);
+  RWPrivateCursor cursor(buf.get());
+  if (src.isV4()) {
+    TxPacket::writeEthHeader(
+        &cursor,
+        dstMac,
+        kSrcMac,
+        static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_IPV4));
+    IPv4Hdr ipHdr(src.asV4(), dst.asV4(), proto, l4Size);
+    ipHdr.computeChecksum();
+    ipHdr.write(&cursor);
+  } else {
+    TxPacket::writeEthHeader(
+        &cursor,
+        dstMac,
+        kSrcMac,
+        static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_IPV6));
+    IPv6Hdr ipHdr(src.asV6(), dst.asV6());
+    ipHdr.payloadLength = l4Size;
+    ipHdr.nextHeader = proto;
+    ipHdr.hopLimit = 255;
+    ipHdr.serialize(&cursor);
+  }
+  // The L4 checksums are left out, hashing doesn't look at them
+  if (l4Size == UDPHeader::size()) {
+    UDPHeader(flow.srcPort, flow.dstPort, l4Size).write(&cursor);
+  } else {
+    cursor.writeBE<uint16_t>(flow.srcPort);
+    cursor.writeBE<uint16_t>(flow.dstPort);
+    cursor.writeBE<uint32_t>(0); // sequence number
+    cursor.writeBE<uint32_t>(0); // acknowledgment number
+    cursor.writeBE<uint8_t>(5 << 4); // data offset, in 32 bit words
+    cursor.writeBE<uint8_t>(0x02); // SYN
+    cursor.writeBE<uint16_t>(0xffff); // window
+    cursor.writeBE<uint16_t>(0); // checksum
+    cursor.writeBE<uint16_t>(0); // urgent pointer
+  }
+
+  auto pkt = std::make_unique<MockRxPacket>(std::move(buf));
+  pkt->setSrcPort(PortID(flow.ingressPort));
+  return pkt;
+}
+
+FlowHashingReport BcmHashTracer::aggregate(
+    const std::vector<std::unique_ptr<PacketTraceInfo>>& traces) {
+  FlowHashingReport report;
+  std::map<std::vector<int32_t>, std::map<int32_t, int64_t>> groups;
+  for (const auto& trace : traces) {
+    if (!trace) {
+      ++report.numFailed;
+      continue;
+    }
+    ++report.numTraced;
+    const auto& hashInfo = trace->hashInfo;
+    auto ports = hashInfo.potentialEgressPorts;
+    if (ports.empty()) {
+      // Not ECMP, the flow could only go one way
+      ports.push_back(hashInfo.actualEgressPort);
+    }
+    std::sort(ports.begin(), ports.end());
+    ++groups[std::move(ports)][hashInfo.actualEgressPort];
+  }
+  for (auto& group : groups) {
+    EgressHashDistribution distribution;
+    distribution.potentialEgressPorts = group.first;
+    distribution.flowsPerEgressPort = std::move(group.second);
+    report.groups.push_back(std::move(distribution));
+  }
+  return report;
+}
+
+FlowHashingReport BcmHashTracer::trace(const std::vector<FlowTuple>& flows) {
+  std::vector<std::unique_ptr<PacketTraceInfo>> traces;
+  if (flows.empty()) {
+    return aggregate(traces);
+  }
+  traces.reserve(flows.size());
+  auto dstMac = hw_->getPlatform()->getLocalMac();
+  // Copies the chunk's flows, so a build left running if a trace throws
+  // doesn't outlive them
+  auto build = [this, &flows, dstMac](size_t begin) {
+    auto end = std::min(begin + kChunkFlows, flows.size());
+    std::vector<FlowTuple> chunk(flows.begin() + begin, flows.begin() + end);
+    return folly::via(&builder_, [ chunk = std::move(chunk), dstMac ]() {
+      std::vector<std::unique_ptr<MockRxPacket>> pkts;
+      pkts.reserve(chunk.size());
+      for (const auto& flow : chunk) {
+        pkts.push_back(makeFlowPacket(flow, dstMac));
+      }
+      return pkts;
+    });
+  };
+
+  auto next = build(0);
+  for (size_t begin = 0; begin < flows.size(); begin += kChunkFlows) {
+    auto pkts = next.get();
+    if (begin + kChunkFlows < flows.size()) {
+      next = build(begin + kChunkFlows);
+    }
+    std::lock_guard<std::mutex> g(traceLock_);
+    for (auto& pkt : pkts) {
+      traces.push_back(hw_->getPacketTrace(std::move(pkt)));
+    }
+  }
+  return aggregate(traces);
+}
+
+}} // facebook::fboss
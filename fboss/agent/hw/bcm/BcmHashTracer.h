@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/hw/bcm/gen-cpp2/packettrace_types.h"
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+
+#include <folly/MacAddress.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class BcmSwitchIf;
+class MockRxPacket;
+
+/*
+ * BcmHashTracer runs the packet trace of BcmSwitchIf::getPacketTrace() over
+ * many flows, and adds up which egress port each of them was hashed to.
+ *
+ * The SDK traces one packet at a time, so the traces are serialized, but
+ * the packets of the next chunk of flows are built on a separate thread
+ * while the current chunk is traced. Traces are run from the calling
+ * thread, never the update thread.
+ */
+class BcmHashTracer {
+ public:
+  explicit BcmHashTracer(BcmSwitchIf* hw);
+  ~BcmHashTracer();
+
+  FlowHashingReport trace(const std::vector<FlowTuple>& flows);
+
+  /*
+   * A packet of the flow, addressed to dstMac so it gets routed. Throws
+   * FbossError for protocols other than TCP and UDP, or mixed address
+   * families. Public for tests.
+   */
+  static std::unique_ptr<MockRxPacket> makeFlowPacket(
+      const FlowTuple& flow,
+      folly::MacAddress dstMac);
+
+  /*
+   * Add up the traces, nullptr for the flows which couldn't be traced.
+   * Public for tests.
+   */
+  static FlowHashingReport aggregate(
+      const std::vector<std::unique_ptr<PacketTraceInfo>>& traces);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BcmHashTracer(BcmHashTracer const&) = delete;
+  BcmHashTracer& operator=(BcmHashTracer const&) = delete;
+
+  BcmSwitchIf* hw_;
+  // Builds the packets ahead of the traces
+  folly::CPUThreadPoolExecutor builder_;
+  // Only one trace at a time
+  std::mutex traceLock_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmHighresSampler.h"
+
+#include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmPort.h"
+#include "fboss/agent/hw/bcm/BcmPortTable.h"
+#include "fboss/agent/hw/bcm/BcmSwitch.h"
+
+#include <folly/Conv.h>
+#include <folly/logging/xlog.h>
+
+#include <map>
+
+namespace facebook { namespace fboss {
+
+BcmPortCounterSampler::BcmPortCounterSampler(
+    const BcmSwitch* hw,
+    const std::set<CounterRequest>& counters)
+    : unit_(hw->getUnit()) {
+  std::map<opennsl_port_t, PortCounters> ports;
+  for (const auto& c : counters) {
+    folly::StringPiece name(c.counterName);
+    auto dot = name.find('.');
+    if (dot == folly::StringPiece::npos) {
+      XLOG(WARNING) << "Requested counter " << c.counterName
+                    << " is not of the form <port>.<counter>";
+      continue;
+    }
+    auto portId = folly::tryTo<uint16_t>(name.subpiece(0, dot));
+    auto type = BcmPort::getCounterType(name.subpiece(dot + 1));
+    if (!portId.hasValue() || !type.hasValue()) {
+      XLOG(WARNING) << "Requested counter " << c.counterName
+                    << " does not exist";
+      continue;
+    }
+    auto bcmPort = hw->getPortTable()->getBcmPortIf(PortID(portId.value()));
+    if (!bcmPort) {
+      XLOG(WARNING) << "Requested counter " << c.counterName
+                    << " is for a port which does not exist";
+      continue;
+    }
+    auto port = bcmPort->getBcmPortId();
+    auto& portCounters = ports.emplace(port, PortCounters(port)).first->second;
+    portCounters.types.push_back(type.value());
+    portCounters.requests.push_back(c);
+    ++numCounters_;
+  }
+
+  for (auto& portAndCounters : ports) {
+    auto& portCounters = portAndCounters.second;
+    portCounters.values.resize(portCounters.types.size());
+    ports_.push_back(std::move(portCounters));
+  }
+}
+
+void BcmPortCounterSampler::sample(CounterPublication* pub) {
+  for (auto& portCounters : ports_) {
+    auto rv = opennsl_stat_sync_multi_get(
+        unit_,
+        portCounters.port,
+        portCounters.types.size(),
+        portCounters.types.data(),
+        portCounters.values.data());
+    if (OPENNSL_FAILURE(rv)) {
+      // Every sample needs a value, so repeat the last ones we read
+      LOG_EVERY_N(ERROR, 1000) << "Failed to read counters for port "
+                               << portCounters.port << ": "
+                               << opennsl_errmsg(rv);
+    }
+    for (size_t i = 0; i < portCounters.requests.size(); ++i) {
+      pub->counterValues[portCounters.requests[i]].push_back(
+          portCounters.values[i]);
+    }
+  }
+}
+
+}} // facebook::fboss
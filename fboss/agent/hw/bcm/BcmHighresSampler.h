@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+extern "C" {
+#include <opennsl/types.h>
+#include <opennsl/stat.h>
+}
+
+#include "fboss/agent/HighresCounterUtil.h"
+
+#include <set>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class BcmSwitch;
+
+/*
+ * A sampler that reads port counters straight from the hardware.
+ *
+ * The regular stats collection reads the values the SDK's counter thread
+ * last synced to software, which only changes every
+ * bcm_stat_interval (500ms), so this uses the sync API instead and reads
+ * fresh values on every sample. That costs a trip to the hardware per port,
+ * so all the requested counters of a port are read with one
+ * opennsl_stat_sync_multi_get() call.
+ *
+ * Counters are named "<port id>.<stat name>", with the same stat names as
+ * the port stats we export, e.g. "5.in_bytes".
+ */
+class BcmPortCounterSampler : public HighresSampler {
+ public:
+  BcmPortCounterSampler(const BcmSwitch* hw,
+                        const std::set<CounterRequest>& counters);
+  ~BcmPortCounterSampler() override {}
+  void sample(CounterPublication* pub) override;
+  int numCounters() const override { return numCounters_; }
+
+  static constexpr const char* const kIdentifier = "bcm_port";
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BcmPortCounterSampler(BcmPortCounterSampler const &) = delete;
+  BcmPortCounterSampler& operator=(BcmPortCounterSampler const &) = delete;
+
+  // The requested counters of one port, in the order we ask the SDK for them
+  struct PortCounters {
+    explicit PortCounters(opennsl_port_t p) : port(p) {}
+    opennsl_port_t port;
+    std::vector<opennsl_stat_val_t> types;
+    std::vector<CounterRequest> requests;
+    std::vector<uint64_t> values;
+  };
+
+  const int unit_;
+  std::vector<PortCounters> ports_;
+  int numCounters_{0};
+};
+
+}} // facebook::fboss
@@ -8,15 +8,21 @@
  *
  */
 #include "BcmHost.h"
+#include <chrono>
 #include <string>
 #include <iostream>
 
+#include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/Constants.h"
+#include "fboss/agent/Tracepoints.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
 #include "fboss/agent/hw/bcm/BcmEgress.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmIntf.h"
 #include "fboss/agent/hw/bcm/BcmPort.h"
+#include "fboss/agent/hw/bcm/BcmStats.h"
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 #include "fboss/agent/state/Interface.h"
@@ -44,6 +50,15 @@ std::ostream& operator<<(
   return os << "BcmEcmpHost: " << key.second << "@vrf " << key.first;
 }
 
+size_t BcmEcmpHostKeyHash::operator()(const BcmEcmpHostKey& key) const {
+  size_t hash = std::hash<opennsl_vrf_t>()(key.first);
+  for (const auto& nhop : key.second) {
+    auto intf = nhop.intfID() ? static_cast<uint32_t>(nhop.intf()) : 0;
+    hash = folly::hash::hash_combine(hash, nhop.addr(), intf, nhop.weight());
+  }
+  return hash;
+}
+
 using std::unique_ptr;
 using std::shared_ptr;
 using folly::MacAddress;
@@ -135,6 +150,9 @@ void BcmHost::addToBcmHostTable(bool isMultipath, bool replace) {
     XLOG(DBG3) << "created L3 host object for " << key_.str() << " @egress "
                << getEgressId();
   }
+  if (!addedInHW_) {
+    hw_->writableHostTable()->hostEntryAdded();
+  }
   addedInHW_ = true;
 }
 
@@ -144,6 +162,11 @@ void BcmHost::program(opennsl_if_t intf, const MacAddress* mac,
   BcmEgress* egressPtr{nullptr};
   const auto& addr = key_.addr();
   const auto vrf = key_.getVrf();
+  FBOSS_TRACEPOINT(
+      bcm_host_program, vrf, addr.bytes(), addr.byteCount(), port);
+  HwCallScope call(HwCall::HOST_ADD);
+  call.setAddress(addr);
+  call.setVrf(vrf);
   // get the egress object and then update it with the new MAC
   if (egressId_ == BcmEgressBase::INVALID) {
     XLOG(DBG3) << "Host entry for " << key_.str()
@@ -168,6 +191,7 @@ void BcmHost::program(opennsl_if_t intf, const MacAddress* mac,
     egressId_ = createdEgress->getID();
     hw_->writableHostTable()->insertBcmEgress(std::move(createdEgress));
   }
+  call.setId(egressId_);
 
   // if no host was added already, add one pointing to the egress object
   if (!addedInHW_) {
@@ -237,6 +261,11 @@ void BcmHost::program(opennsl_if_t intf, const MacAddress* mac,
 
   trunk_ = BcmTrunk::INVALID;
   port_ = port;
+  if (mac) {
+    setEgressTarget(BcmEgressTarget(intf, *mac, BcmPort::asGPort(port)));
+  } else {
+    setEgressTarget(folly::none);
+  }
 }
 
 void BcmHost::programToTrunk(opennsl_if_t intf,
@@ -279,19 +308,30 @@ void BcmHost::programToTrunk(opennsl_if_t intf,
 
   port_ = 0;
   trunk_ = trunk;
+  setEgressTarget(BcmEgressTarget(intf, mac, BcmTrunk::asGPort(trunk)));
 }
 
 bool BcmHost::isTrunk() const {
   return trunk_ != BcmTrunk::INVALID;
 }
 
+void BcmHost::setEgressTarget(const folly::Optional<BcmEgressTarget>& target) {
+  hw_->writableHostTable()->egressTargetChanged(egressTarget_, target);
+  egressTarget_ = target;
+}
+
 BcmHost::~BcmHost() {
+  HwCallScope call(HwCall::HOST_DELETE);
+  call.setAddress(key_.addr());
+  call.setVrf(key_.getVrf());
+  call.setId(egressId_);
   if (addedInHW_) {
     opennsl_l3_host_t host;
     initHostCommon(&host);
     auto rc = opennsl_l3_host_delete(hw_->getUnit(), &host);
     bcmLogFatal(rc, hw_, "failed to delete L3 host object for ", key_.str());
     XLOG(DBG3) << "deleted L3 host object for " << key_.str();
+    hw_->writableHostTable()->hostEntryRemoved();
   } else {
     XLOG(DBG3) << "No need to delete L3 host object for " << key_.str()
                << " as it was not added to the HW before";
@@ -299,6 +339,7 @@ BcmHost::~BcmHost() {
   if (egressId_ == BcmEgressBase::INVALID) {
     return;
   }
+  setEgressTarget(folly::none);
   if (isPortOrTrunkSet()) {
     hw_->writableHostTable()->unresolved(egressId_);
   }
@@ -347,10 +388,9 @@ BcmEcmpHost::BcmEcmpHost(const BcmSwitchIf *hw,
     // just one path. No BcmEcmpEgress object this case.
     egressId_ = *paths.begin();
   } else {
-    auto ecmp = std::make_unique<BcmEcmpEgress>(hw, std::move(paths));
+    auto ecmp = table->incRefOrCreateBcmEcmpEgress(paths);
     egressId_ = ecmp->getID();
     ecmpEgressId_ = egressId_;
-    hw_->writableHostTable()->insertBcmEgress(std::move(ecmp));
   }
   fwd_ = std::move(fwd);
 }
@@ -359,8 +399,10 @@ BcmEcmpHost::~BcmEcmpHost() {
   // Deref ECMP egress first since the ECMP egress entry holds references
   // to egress entries.
   XLOG(DBG3) << "Decremented reference for egress object for " << fwd_;
-  hw_->writableHostTable()->derefEgress(ecmpEgressId_);
   BcmHostTable *table = hw_->writableHostTable();
+  if (ecmpEgressId_ != BcmEgressBase::INVALID) {
+    table->derefBcmEcmpEgress(ecmpEgressId_);
+  }
   for (const auto& nhop : fwd_) {
     table->derefBcmHost(BcmHostKey(vrf_, nhop));
   }
@@ -375,26 +417,26 @@ BcmHostTable::BcmHostTable(const BcmSwitchIf *hw) : hw_(hw) {
 BcmHostTable::~BcmHostTable() {
 }
 
-template<typename KeyT, typename HostT>
-HostT* BcmHostTable::incRefOrCreateBcmHostImpl(
-    HostMap<KeyT, HostT>* map,
-    const KeyT& key) {
-  auto iter = map->find(key);
-  if (iter != map->cend()) {
+template <typename MapT>
+typename MapT::HostType* BcmHostTable::incRefOrCreateBcmHostImpl(
+    MapT* map,
+    const typename MapT::KeyType& key) {
+  auto hash = map->hash(key);
+  auto entry = map->find(key, hash);
+  if (entry) {
     // there was an entry already there
-    iter->second.second++;  // increase the reference counter
+    entry->refCount++;  // increase the reference counter
     XLOG(DBG3) << "referenced " << key
-               << ". new ref count: " << iter->second.second;
-    return iter->second.first.get();
-  }
-  auto newHost = std::make_unique<HostT>(hw_, key);
-  auto hostPtr = newHost.get();
-  auto ret = map->emplace(key, std::make_pair(std::move(newHost), 1));
-  CHECK_EQ(ret.second, true)
-    << "must insert BcmHost/BcmEcmpHost as a new entry in this case";
+               << ". new ref count: " << entry->refCount;
+    return entry->host.get();
+  }
+  // Creating an ECMP host references its member hosts, so the host is
+  // created before it is added to the index
+  auto newHost = std::make_unique<typename MapT::HostType>(hw_, key);
+  entry = map->insert(key, hash, std::move(newHost));
   XLOG(DBG3) << "created " << key
-             << ". new ref count: " << ret.first->second.second;
-  return hostPtr;
+             << ". new ref count: " << entry->refCount;
+  return entry->host.get();
 }
 
 BcmHost* BcmHostTable::incRefOrCreateBcmHost(const BcmHostKey& hostKey) {
@@ -416,26 +458,26 @@ uint32_t BcmHostTable::getReferenceCount(const BcmHostKey& key)
   return getReferenceCountImpl(&hosts_, key);
 }
 
-template<typename KeyT, typename HostT>
+template <typename MapT>
 uint32_t BcmHostTable::getReferenceCountImpl(
-    const HostMap<KeyT, HostT>* map,
-    const KeyT& key) const noexcept {
-  auto iter = map->find(key);
-  if (iter == map->cend()) {
+    const MapT* map,
+    const typename MapT::KeyType& key) const noexcept {
+  auto entry = map->find(key);
+  if (!entry) {
     return 0;
   }
-  return iter->second.second;
+  return entry->refCount;
 }
 
-template<typename KeyT, typename HostT>
-HostT* BcmHostTable::getBcmHostIfImpl(
-    const HostMap<KeyT, HostT>* map,
-    const KeyT& key) const noexcept {
-  auto iter = map->find(key);
-  if (iter == map->cend()) {
+template <typename MapT>
+typename MapT::HostType* BcmHostTable::getBcmHostIfImpl(
+    const MapT* map,
+    const typename MapT::KeyType& key) const noexcept {
+  auto entry = map->find(key);
+  if (!entry) {
     return nullptr;
   }
-  return iter->second.first.get();
+  return entry->host.get();
 }
 
 BcmHost* BcmHostTable::getBcmHost(
@@ -467,24 +509,25 @@ BcmEcmpHost* BcmHostTable::getBcmEcmpHostIf(
   return getBcmHostIfImpl(&ecmpHosts_, key);
 }
 
-template<typename KeyT, typename HostT>
-HostT* BcmHostTable::derefBcmHostImpl(
-    HostMap<KeyT, HostT>* map,
-    const KeyT& key) noexcept {
-  auto iter = map->find(key);
-  if (iter == map->cend()) {
+template <typename MapT>
+typename MapT::HostType* BcmHostTable::derefBcmHostImpl(
+    MapT* map,
+    const typename MapT::KeyType& key) noexcept {
+  auto entry = map->find(key);
+  if (!entry) {
     return nullptr;
   }
-  auto& entry = iter->second;
-  CHECK_GT(entry.second, 0);
-  if (--entry.second == 0) {
+  CHECK_GT(entry->refCount, 0);
+  if (--entry->refCount == 0) {
     XLOG(DBG3) << "erase host " << key << " from host map";
-    map->erase(iter);
+    // Destroying an ECMP host dereferences its member hosts, so only do it
+    // once the entry is out of the index
+    map->erase(entry);
     return nullptr;
   }
   XLOG(DBG3) << "dereferenced host " << key
-             << ". new ref count: " << entry.second;
-  return entry.first.get();
+             << ". new ref count: " << entry->refCount;
+  return entry->host.get();
 }
 
 BcmHost* BcmHostTable::derefBcmHost(
@@ -522,7 +565,15 @@ BcmEgressBase* BcmHostTable::derefEgress(opennsl_if_t egressId) {
     if (it->second.first->isEcmp()) {
       CHECK(numEcmpEgressProgrammed_ > 0);
       numEcmpEgressProgrammed_--;
+      const auto& paths =
+          static_cast<BcmEcmpEgress*>(it->second.first.get())->paths();
+      ecmpMembersRemoved(egressId, paths);
+      if (ecmpEgressByPaths_.erase(paths)) {
+        numEcmpReplicatedPaths_ -= numReplicatedPaths(paths);
+      }
     }
+    // The ECMP groups must let go of the egress before it goes away
+    flushBatchedEgress(egressId);
     XLOG(DBG3) << "erase egress " << egressId << " from egress map";
     egressMap_.erase(egressId);
     return nullptr;
@@ -532,12 +583,71 @@ BcmEgressBase* BcmHostTable::derefEgress(opennsl_if_t egressId) {
   return it->second.first.get();
 }
 
+size_t BcmHostTable::EcmpPathsHash::operator()(
+    const BcmEcmpEgress::Paths& paths) const {
+  // Paths are sorted, with weights expanded into repeated egress IDs
+  return folly::hash::hash_range(paths.begin(), paths.end());
+}
+
+uint32_t BcmHostTable::numReplicatedPaths(
+    const BcmEcmpEgress::Paths& paths) {
+  // Weighted next hops show up as the same egress repeated
+  BcmEcmpEgress::EgressIdSet members(paths.begin(), paths.end());
+  return paths.size() - members.size();
+}
+
+BcmEcmpEgress* BcmHostTable::incRefOrCreateBcmEcmpEgress(
+    const BcmEcmpEgress::Paths& paths) {
+  BcmEcmpEgress* ecmp;
+  auto existing = ecmpEgressByPaths_.find(paths);
+  if (existing != ecmpEgressByPaths_.end()) {
+    ecmp = static_cast<BcmEcmpEgress*>(incEgressReference(existing->second));
+    CHECK(ecmp);
+    XLOG(DBG3) << "sharing ECMP egress " << ecmp->getID() << " for "
+               << paths.size() << " paths";
+  } else {
+    auto newEcmp = std::make_unique<BcmEcmpEgress>(hw_, paths);
+    ecmp = newEcmp.get();
+    insertBcmEgress(std::move(newEcmp));
+    ecmpEgressByPaths_.emplace(paths, ecmp->getID());
+    auto replicated = numReplicatedPaths(paths);
+    numEcmpReplicatedPaths_ += replicated;
+    BcmStats::get()->ecmpEgressCreated(replicated);
+  }
+  ++numEcmpEgressReferences_;
+  return ecmp;
+}
+
+void BcmHostTable::derefBcmEcmpEgress(opennsl_if_t ecmpEgressId) {
+  CHECK_GT(numEcmpEgressReferences_, 0);
+  --numEcmpEgressReferences_;
+  derefEgress(ecmpEgressId);
+}
+
 void BcmHostTable::updatePortToEgressMapping(
     opennsl_if_t egressId,
     opennsl_gport_t oldGPort,
     opennsl_gport_t newGPort) {
+  if (batching_) {
+    if (!batchPortAndEgressIds_) {
+      batchPortAndEgressIds_ = getPortAndEgressIdsMap()->clone();
+    }
+    applyPortToEgressMapping(
+        batchPortAndEgressIds_.get(), egressId, oldGPort, newGPort);
+    return;
+  }
   auto newMapping = getPortAndEgressIdsMap()->clone();
+  applyPortToEgressMapping(newMapping.get(), egressId, oldGPort, newGPort);
+  // Publish and replace with the updated mapping
+  newMapping->publish();
+  setPort2EgressIdsInternal(newMapping);
+}
 
+void BcmHostTable::applyPortToEgressMapping(
+    PortAndEgressIdsMap* newMapping,
+    opennsl_if_t egressId,
+    opennsl_gport_t oldGPort,
+    opennsl_gport_t newGPort) {
   if (BcmPort::isValidLocalPort(oldGPort) ||
       BcmTrunk::isValidTrunkPort(oldGPort)) {
     auto old = newMapping->getPortAndEgressIdsIf(oldGPort);
@@ -564,9 +674,6 @@ void BcmHostTable::updatePortToEgressMapping(
       newMapping->addPortAndEgressIds(toAdd);
     }
   }
-  // Publish and replace with the updated mapping
-  newMapping->publish();
-  setPort2EgressIdsInternal(newMapping);
 }
 
 void BcmHostTable::setPort2EgressIdsInternal(
@@ -595,11 +702,57 @@ void BcmHostTable::insertBcmEgress(
   XLOG(DBG3) << "insert egress " << id << " into egress map";
   if (egress->isEcmp()) {
     numEcmpEgressProgrammed_++;
+    ecmpMembersAdded(id, static_cast<BcmEcmpEgress*>(egress.get())->paths());
   }
   auto ret = egressMap_.emplace(id, std::make_pair(std::move(egress), 1));
   CHECK(ret.second);
 }
 
+void BcmHostTable::setEcmpFlowletConfig(
+    const folly::Optional<BcmEcmpEgress::FlowletConfig>& config) {
+  if (config == ecmpFlowletConfig_) {
+    return;
+  }
+  ecmpFlowletConfig_ = config;
+  for (auto& entry : egressMap_) {
+    auto egress = entry.second.first.get();
+    if (egress->isEcmp()) {
+      static_cast<BcmEcmpEgress*>(egress)->reprogram();
+    }
+  }
+  XLOG(DBG1) << (config ? "Enabled" : "Disabled")
+             << " dynamic load balancing for " << numEcmpEgressProgrammed_
+             << " ECMP egress objects";
+}
+
+void BcmHostTable::updateEcmpFlowletStats() {
+  if (!ecmpFlowletConfig_ && ecmpFlowletStatKeys_.empty()) {
+    return;
+  }
+  boost::container::flat_set<std::string> keys;
+  if (ecmpFlowletConfig_) {
+    for (const auto& entry : egressMap_) {
+      auto egress = entry.second.first.get();
+      uint64_t reassignments;
+      if (!egress->isEcmp() ||
+          !static_cast<const BcmEcmpEgress*>(egress)->getFlowletReassignments(
+              &reassignments)) {
+        continue;
+      }
+      auto key = folly::to<std::string>(
+          "ecmp.", egress->getID(), ".flowlet_reassignments");
+      tcData().setCounter(key, reassignments);
+      keys.insert(std::move(key));
+    }
+  }
+  for (const auto& key : ecmpFlowletStatKeys_) {
+    if (keys.find(key) == keys.end()) {
+      tcData().clearCounter(key);
+    }
+  }
+  ecmpFlowletStatKeys_ = std::move(keys);
+}
+
 void BcmHostTable::warmBootHostEntriesSynced() {
   opennsl_port_config_t pcfg;
   auto rv = opennsl_port_config_get(hw_->getUnit(), &pcfg);
@@ -609,19 +762,99 @@ void BcmHostTable::warmBootHostEntriesSynced() {
   // signal up for all up ports.
   XLOG(DBG1) << "Warm boot host entries synced, signalling link "
                 "up for all up ports";
+  // Some ports might have come up or gone down during
+  // the time controller was down. So signal link up or down
+  // for these. We could track this better by just signalling
+  // the ports that actually changed state, but thats a minor
+  // optimization. The egresses of all the ports are gathered
+  // first, so the ECMP groups are updated once rather than
+  // once per port.
+  auto portAndEgressIdMapping = getPortAndEgressIdsMap();
+  EgressIdSet upEgressIds;
+  EgressIdSet downEgressIds;
   opennsl_port_t idx;
   OPENNSL_PBMP_ITER(pcfg.port, idx) {
-    // Some ports might have come up or gone down during
-    // the time controller was down. So call linkUp/DownHwLocked
-    // for these. We could track this better by just calling
-    // linkUp/DownHwLocked only for ports that actually changed
-    // state, but thats a minor optimization.
-    if (hw_->isPortUp(PortID(idx))) {
-      linkUpHwLocked(idx);
+    const auto portAndEgressIds =
+        portAndEgressIdMapping->getPortAndEgressIdsIf(BcmPort::asGPort(idx));
+    if (!portAndEgressIds) {
+      continue;
+    }
+    auto& egressIds =
+        hw_->isPortUp(PortID(idx)) ? upEgressIds : downEgressIds;
+    const auto& portEgressIds = portAndEgressIds->getEgressIds();
+    egressIds.insert(portEgressIds.begin(), portEgressIds.end());
+  }
+  if (!downEgressIds.empty()) {
+    egressResolutionChangedHwNotLocked(downEgressIds, false /*down*/);
+  }
+  if (!upEgressIds.empty()) {
+    egressResolutionChangedHwLocked(
+        upEgressIds, BcmEcmpEgress::Action::EXPAND);
+  }
+}
+
+void BcmHostTable::egressTargetChanged(
+    const folly::Optional<BcmEgressTarget>& oldTarget,
+    const folly::Optional<BcmEgressTarget>& newTarget) {
+  if (oldTarget == newTarget) {
+    return;
+  }
+  if (oldTarget) {
+    auto it = egressTargets_.find(*oldTarget);
+    CHECK(it != egressTargets_.end());
+    if (--it->second == 0) {
+      egressTargets_.erase(it);
+    } else {
+      --numDuplicateEgresses_;
+    }
+  }
+  if (newTarget) {
+    if (++egressTargets_[*newTarget] > 1) {
+      ++numDuplicateEgresses_;
+    }
+  }
+}
+
+void BcmHostTable::startHostBatch() {
+  CHECK(!batching_);
+  batching_ = true;
+}
+
+void BcmHostTable::endHostBatch() {
+  CHECK(batching_);
+  batching_ = false;
+  if (batchPortAndEgressIds_) {
+    batchPortAndEgressIds_->publish();
+    setPort2EgressIdsInternal(std::move(batchPortAndEgressIds_));
+  }
+  EgressIdSet expanded;
+  EgressIdSet shrunk;
+  for (const auto& egressAndAction : batchEgressActions_) {
+    if (egressAndAction.second == BcmEcmpEgress::Action::EXPAND) {
+      expanded.insert(egressAndAction.first);
     } else {
-      linkDownHwLocked(idx);
+      shrunk.insert(egressAndAction.first);
     }
   }
+  batchEgressActions_.clear();
+  if (!shrunk.empty()) {
+    applyEgressResolutionChange(shrunk, BcmEcmpEgress::Action::SHRINK);
+  }
+  if (!expanded.empty()) {
+    applyEgressResolutionChange(expanded, BcmEcmpEgress::Action::EXPAND);
+  }
+}
+
+void BcmHostTable::flushBatchedEgress(opennsl_if_t egressId) {
+  auto it = batchEgressActions_.find(egressId);
+  if (it == batchEgressActions_.end()) {
+    return;
+  }
+  auto action = it->second;
+  batchEgressActions_.erase(it);
+  EgressIdSet affectedEgressIds;
+  affectedEgressIds.insert(egressId);
+  applyEgressResolutionChange(affectedEgressIds, action);
 }
 
 folly::dynamic BcmHost::toFollyDynamic() const {
@@ -660,12 +893,12 @@ folly::dynamic BcmEcmpHost::toFollyDynamic() const {
 
 folly::dynamic BcmHostTable::toFollyDynamic() const {
   folly::dynamic hostsJson = folly::dynamic::array;
-  for (const auto& vrfIpAndHost: hosts_) {
-    hostsJson.push_back(vrfIpAndHost.second.first->toFollyDynamic());
+  for (const auto& entry : hosts_.entries()) {
+    hostsJson.push_back(entry->host->toFollyDynamic());
   }
   folly::dynamic ecmpHostsJson = folly::dynamic::array;
-  for (const auto& vrfNhopsAndHost: ecmpHosts_) {
-    ecmpHostsJson.push_back(vrfNhopsAndHost.second.first->toFollyDynamic());
+  for (const auto& entry : ecmpHosts_.entries()) {
+    ecmpHostsJson.push_back(entry->host->toFollyDynamic());
   }
   folly::dynamic hostTable = folly::dynamic::object;
   hostTable[kHosts] = std::move(hostsJson);
@@ -690,39 +923,95 @@ void BcmHostTable::linkStateChangedMaybeLocked(
         up ? BcmEcmpEgress::Action::EXPAND : BcmEcmpEgress::Action::SHRINK);
   } else {
     CHECK(!up);
-    egressResolutionChangedHwNotLocked(
-        hw_->getUnit(), portAndEgressIds->getEgressIds(), up);
-  }
-}
-
-int BcmHostTable::removeAllEgressesFromEcmpCallback(
-    int unit,
-    opennsl_l3_egress_ecmp_t* ecmp,
-    int intfCount,
-    opennsl_if_t* intfArray,
-    void* userData) {
-  // loop over the egresses present in the ecmp group. For each that is
-  // in the passed in list of egresses to remove (userData),
-  // remove it from the ecmp group.
-  EgressIdSet* egressesToRemove = static_cast<EgressIdSet*>(userData);
-  for (int i = 0; i < intfCount; ++i) {
-    opennsl_if_t egressInHw = intfArray[i];
-    if (egressesToRemove->find(egressInHw) != egressesToRemove->end()) {
-      BcmEcmpEgress::removeEgressIdHwNotLocked(
-          unit, ecmp->ecmp_intf, egressInHw);
+    egressResolutionChangedHwNotLocked(portAndEgressIds->getEgressIds(), up);
+  }
+}
+
+void BcmHostTable::linksDownHwNotLocked(
+    const std::vector<opennsl_gport_t>& gports) {
+  auto portAndEgressIdMapping = getPortAndEgressIdsMap();
+
+  EgressIdSet downEgressIds;
+  for (auto gport : gports) {
+    const auto portAndEgressIds =
+        portAndEgressIdMapping->getPortAndEgressIdsIf(gport);
+    if (portAndEgressIds) {
+      const auto& egressIds = portAndEgressIds->getEgressIds();
+      downEgressIds.insert(egressIds.begin(), egressIds.end());
+    }
+  }
+  if (downEgressIds.empty()) {
+    return;
+  }
+  egressResolutionChangedHwNotLocked(downEgressIds, false /*down*/);
+}
+
+void BcmHostTable::ecmpMembersAdded(
+    opennsl_if_t ecmpId,
+    const BcmEcmpEgress::Paths& paths) {
+  std::lock_guard<std::mutex> g(egressToEcmpsLock_);
+  BcmEcmpEgress::EgressIdSet members(paths.begin(), paths.end());
+  for (auto path : members) {
+    ++egressToEcmps_[path][ecmpId];
+  }
+}
+
+void BcmHostTable::ecmpMembersRemoved(
+    opennsl_if_t ecmpId,
+    const BcmEcmpEgress::Paths& paths) {
+  std::lock_guard<std::mutex> g(egressToEcmpsLock_);
+  BcmEcmpEgress::EgressIdSet members(paths.begin(), paths.end());
+  for (auto path : members) {
+    auto ecmps = egressToEcmps_.find(path);
+    if (ecmps == egressToEcmps_.end()) {
+      continue;
+    }
+    auto ecmp = ecmps->second.find(ecmpId);
+    if (ecmp == ecmps->second.end()) {
+      continue;
+    }
+    if (--ecmp->second == 0) {
+      ecmps->second.erase(ecmp);
+      if (ecmps->second.empty()) {
+        egressToEcmps_.erase(ecmps);
+      }
     }
   }
-  return 0;
+}
+
+BcmHostTable::EcmpMembers BcmHostTable::getEcmpMembers(
+    const BcmEcmpEgress::EgressIdSet& egressIds) const {
+  EcmpMembers ecmpMembers;
+  std::lock_guard<std::mutex> g(egressToEcmpsLock_);
+  for (auto egressId : egressIds) {
+    auto ecmps = egressToEcmps_.find(egressId);
+    if (ecmps == egressToEcmps_.end()) {
+      continue;
+    }
+    for (const auto& ecmpAndCount : ecmps->second) {
+      ecmpMembers[ecmpAndCount.first].insert(egressId);
+    }
+  }
+  return ecmpMembers;
 }
 
 void BcmHostTable::egressResolutionChangedHwNotLocked(
-    int unit,
     const EgressIdSet& affectedEgressIds,
     bool up) {
   CHECK(!up);
-  EgressIdSet tmpEgressIds(affectedEgressIds);
-  opennsl_l3_egress_ecmp_traverse(
-      unit, removeAllEgressesFromEcmpCallback, &tmpEgressIds);
+  auto start = std::chrono::steady_clock::now();
+  // Only touch the ECMP groups which have the affected egresses as members,
+  // rather than traversing all of them in the HW
+  auto ecmpMembers = getEcmpMembers(affectedEgressIds);
+  for (const auto& ecmpAndMembers : ecmpMembers) {
+    BcmEcmpEgress::removeEgressIdsHwNotLocked(
+        hw_->getUnit(), ecmpAndMembers.first, ecmpAndMembers.second);
+  }
+  BcmStats::get()->ecmpShrunk(
+      ecmpMembers.size(),
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
 }
 
 void BcmHostTable::egressResolutionChangedHwLocked(
@@ -731,19 +1020,28 @@ void BcmHostTable::egressResolutionChangedHwLocked(
   if (action == BcmEcmpEgress::Action::SKIP) {
     return;
   }
+  if (batching_) {
+    for (auto egressId : affectedEgressIds) {
+      batchEgressActions_[egressId] = action;
+    }
+    return;
+  }
+  applyEgressResolutionChange(affectedEgressIds, action);
+}
 
-  for (const auto& nextHopsAndEcmpHostInfo : ecmpHosts_) {
-    auto ecmpId = nextHopsAndEcmpHostInfo.second.first->getEcmpEgressId();
-    if (ecmpId == BcmEgressBase::INVALID) {
+void BcmHostTable::applyEgressResolutionChange(
+    const EgressIdSet& affectedEgressIds,
+    BcmEcmpEgress::Action action) {
+  auto start = std::chrono::steady_clock::now();
+  auto ecmpMembers = getEcmpMembers(affectedEgressIds);
+  for (const auto& ecmpAndMembers : ecmpMembers) {
+    auto ecmpEgress = static_cast<BcmEcmpEgress*>(
+        getEgressObjectIf(ecmpAndMembers.first));
+    if (!ecmpEgress) {
+      // ECMP object from the warm boot cache, handled below
       continue;
     }
-    auto ecmpEgress = static_cast<BcmEcmpEgress*>(getEgressObjectIf(ecmpId));
-    // Must find the egress object, we could have done a slower
-    // dynamic cast check to ensure that this is the right type
-    // our map should be pointing to valid Ecmp egress object for
-    // a ecmp egress Id anyways
-    CHECK(ecmpEgress);
-    for (auto egrId : affectedEgressIds) {
+    for (auto egrId : ecmpAndMembers.second) {
       switch (action) {
         case BcmEcmpEgress::Action::EXPAND:
           ecmpEgress->pathReachableHwLocked(egrId);
@@ -791,6 +1089,13 @@ void BcmHostTable::egressResolutionChangedHwLocked(
       }
     }
   }
+  if (action == BcmEcmpEgress::Action::SHRINK) {
+    BcmStats::get()->ecmpShrunk(
+        ecmpMembers.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  }
 }
 
 }}
@@ -16,9 +16,15 @@ extern "C" {
 
 #include <folly/IPAddress.h>
 #include <folly/MacAddress.h>
+#include <folly/Optional.h>
 #include <folly/SpinLock.h>
 #include <folly/dynamic.h>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #include "fboss/agent/hw/bcm/BcmEgress.h"
+#include "fboss/agent/hw/bcm/BcmHostIndex.h"
 #include "fboss/agent/hw/bcm/BcmHostKey.h"
 #include "fboss/agent/hw/bcm/BcmPort.h"
 #include "fboss/agent/hw/bcm/BcmTrunk.h"
@@ -37,6 +43,13 @@ class BcmEgress;
 class BcmSwitchIf;
 class BcmHostTable;
 
+/*
+ * Where the egress of a resolved BcmHost forwards to: the interface, the
+ * MAC and the port or trunk, as a gport.
+ */
+using BcmEgressTarget =
+    std::tuple<opennsl_if_t, folly::MacAddress, opennsl_gport_t>;
+
 class BcmHost {
  public:
   BcmHost(const BcmSwitchIf* hw, BcmHostKey key)
@@ -102,6 +115,7 @@ class BcmHost {
                opennsl_port_t port, RouteForwardAction action);
   void initHostCommon(opennsl_l3_host_t *host) const;
   bool isTrunk() const;
+  void setEgressTarget(const folly::Optional<BcmEgressTarget>& target);
   const BcmSwitchIf* hw_;
   BcmHostKey key_;
   // Port that the corresponding egress object references.
@@ -112,6 +126,8 @@ class BcmHost {
   opennsl_trunk_t trunk_{BcmTrunk::INVALID};
   opennsl_if_t egressId_{BcmEgressBase::INVALID};
   bool addedInHW_{false}; // if added to the HW host(ARP) table or not
+  // Set once resolved to a port or trunk
+  folly::Optional<BcmEgressTarget> egressTarget_;
 };
 
 /**
@@ -126,6 +142,9 @@ class BcmHost {
  * or BcmEcmpEgress).
  */
 using BcmEcmpHostKey = std::pair<opennsl_vrf_t, RouteNextHopSet>;
+struct BcmEcmpHostKeyHash {
+  size_t operator()(const BcmEcmpHostKey& key) const;
+};
 
 class BcmEcmpHost {
  public:
@@ -217,6 +236,18 @@ class BcmHostTable {
   const BcmEgressBase*  getEgressObjectIf(opennsl_if_t egress) const;
   BcmEgressBase* getEgressObjectIf(opennsl_if_t egress);
 
+  /*
+   * ECMP egress objects are interned by their paths: ECMP hosts which
+   * resolve to the same multiset of egress IDs share one HW ECMP group,
+   * whichever VRF and next hops they were created for.
+   * incRefOrCreateBcmEcmpEgress returns the group for the given paths with a
+   * reference taken, creating it if needed. derefBcmEcmpEgress releases a
+   * reference taken by incRefOrCreateBcmEcmpEgress.
+   */
+  BcmEcmpEgress* incRefOrCreateBcmEcmpEgress(
+      const BcmEcmpEgress::Paths& paths);
+  void derefBcmEcmpEgress(opennsl_if_t ecmpEgressId);
+
   /*
    * Port down handling
    * Look up egress entries going over this port and
@@ -234,6 +265,13 @@ class BcmHostTable {
     linkStateChangedMaybeLocked(
         BcmTrunk::asGPort(trunk), false /*down*/, false /*not locked*/);
   }
+  /*
+   * Link down handling for several ports and trunks that went down
+   * together, each as a gport. The egresses over all of them are
+   * removed in a single pass over the ECMP groups they are members of,
+   * so each group is rewritten once however many of its members are gone.
+   */
+  void linksDownHwNotLocked(const std::vector<opennsl_gport_t>& gports);
   void linkDownHwLocked(opennsl_port_t port) {
     // Just call the non locked counterpart here.
     // We don't really need the lock for link down
@@ -262,6 +300,27 @@ class BcmHostTable {
     folly::SpinLockGuard guard(portAndEgressIdsLock_);
     return portAndEgressIdsDontUseDirectly_;
   }
+  /*
+   * Track which ECMP groups each egress is a member of. Together with the
+   * port -> egressIds map this tells link down handling which ECMP groups
+   * to shrink without walking all of them. Called when ECMP egress objects
+   * are created and destroyed, and for ECMP objects read from the warm boot
+   * cache. Adding the same group twice takes two removals to forget it.
+   */
+  void ecmpMembersAdded(
+      opennsl_if_t ecmpId,
+      const BcmEcmpEgress::Paths& paths);
+  void ecmpMembersRemoved(
+      opennsl_if_t ecmpId,
+      const BcmEcmpEgress::Paths& paths);
+  /*
+   * ECMP groups the given egresses are members of, with the affected members
+   * of each of them.
+   */
+  using EcmpMembers =
+      boost::container::flat_map<opennsl_if_t, BcmEcmpEgress::EgressIdSet>;
+  EcmpMembers getEcmpMembers(
+      const BcmEcmpEgress::EgressIdSet& egressIds) const;
   /*
    * Serialize toFollyDynamic
    */
@@ -271,6 +330,20 @@ class BcmHostTable {
    */
   void warmBootHostEntriesSynced();
 
+  /*
+   * Batch the bookkeeping done for each BcmHost programmed, for state
+   * updates changing many neighbor entries at once.
+   *
+   * Between startHostBatch() and endHostBatch(), the BcmHosts are still
+   * programmed to the HW one by one, but the port -> egressIds map is
+   * published and the ECMP groups are expanded or shrunk only once, by
+   * endHostBatch(). An egress whose ECMP membership changes several times
+   * only gets its last change applied. ECMP groups are still updated right
+   * away for an egress about to be destroyed.
+   */
+  void startHostBatch();
+  void endHostBatch();
+
   using EgressIdSet = BcmEcmpEgress::EgressIdSet;
   /*
    * Release all host entries. Should only
@@ -296,6 +369,72 @@ class BcmHostTable {
     return numEcmpEgressProgrammed_;
   }
 
+  /*
+   * Dynamic load balancing of the ECMP groups, none for regular hashing.
+   * Changing it programs all the existing ECMP groups again.
+   */
+  void setEcmpFlowletConfig(
+      const folly::Optional<BcmEcmpEgress::FlowletConfig>& config);
+  const folly::Optional<BcmEcmpEgress::FlowletConfig>& getEcmpFlowletConfig()
+      const {
+    return ecmpFlowletConfig_;
+  }
+  /*
+   * Export how often each ECMP group moved flowlets between its members
+   */
+  void updateEcmpFlowletStats();
+  /*
+   * Call fn(ecmpEgressId, paths) for every ECMP egress object
+   */
+  template <typename Fn>
+  void forEachEcmpEgress(Fn fn) const {
+    for (const auto& entry : egressMap_) {
+      auto egress = entry.second.first.get();
+      if (egress->isEcmp()) {
+        fn(entry.first, static_cast<const BcmEcmpEgress*>(egress)->paths());
+      }
+    }
+  }
+  // Number of ECMP hosts using the ECMP egress objects
+  uint32_t numEcmpEgressReferences() const {
+    return numEcmpEgressReferences_;
+  }
+  // Paths in ECMP egress objects which repeat another path of the same
+  // object, to give its next hop more weight
+  uint32_t numEcmpReplicatedPaths() const {
+    return numEcmpReplicatedPaths_;
+  }
+
+  /*
+   * Track the targets of the resolved BcmHosts. Each BcmHost owns its
+   * egress, since the ECMP groups and host routes using a next hop keep
+   * its egress ID while it is resolved, moved or unresolved again, so two
+   * hosts resolved to the same target have identical egresses. Their number
+   * is exported to size how much of the egress table that takes.
+   */
+  void egressTargetChanged(
+      const folly::Optional<BcmEgressTarget>& oldTarget,
+      const folly::Optional<BcmEgressTarget>& newTarget);
+  // Egresses of resolved hosts with the same target as another one
+  uint32_t numDuplicateEgresses() const {
+    return numDuplicateEgresses_;
+  }
+
+  /*
+   * The BcmHosts added to the HW host table, neighbors and host routes
+   * alike, for BcmRouteTable to tell whether there is room for more host
+   * routes.
+   */
+  void hostEntryAdded() {
+    ++numHostEntries_;
+  }
+  void hostEntryRemoved() {
+    --numHostEntries_;
+  }
+  uint32_t numHostEntries() const {
+    return numHostEntries_;
+  }
+
   void egressResolutionChangedHwLocked(
       const EgressIdSet& affectedEgressIds,
       BcmEcmpEgress::Action action);
@@ -312,18 +451,21 @@ class BcmHostTable {
    * Called both while holding and not holding the hw lock.
    */
   void linkStateChangedMaybeLocked(opennsl_port_t port, bool up, bool locked);
-  static void egressResolutionChangedHwNotLocked(
-      int unit,
+  void applyPortToEgressMapping(
+      PortAndEgressIdsMap* mapping,
+      opennsl_if_t egressId,
+      opennsl_gport_t oldGPort,
+      opennsl_gport_t newGPort);
+  void applyEgressResolutionChange(
+      const EgressIdSet& affectedEgressIds,
+      BcmEcmpEgress::Action action);
+  // Apply the ECMP change batched for egressId, if any
+  void flushBatchedEgress(opennsl_if_t egressId);
+  void egressResolutionChangedHwNotLocked(
       const EgressIdSet& affectedEgressIds,
       bool up);
-  // Callback for traversal in egressResolutionChangedHwNotLocked
-  static int removeAllEgressesFromEcmpCallback(
-      int unit,
-      opennsl_l3_egress_ecmp_t* ecmp, // ecmp object being traversed
-      int intfCount, // number of egresses in the ecmp group
-      opennsl_if_t* intfArray, // array of egresses in the ecmp group
-      void* userData); // egresses we intend to remove from the ecmp group
   void setPort2EgressIdsInternal(std::shared_ptr<PortAndEgressIdsMap> newMap);
+  static uint32_t numReplicatedPaths(const BcmEcmpEgress::Paths& paths);
 
   const BcmSwitchIf* hw_{nullptr};
 
@@ -343,34 +485,67 @@ class BcmHostTable {
   mutable folly::SpinLock portAndEgressIdsLock_;
   boost::container::flat_set<opennsl_if_t> resolvedEgresses_;
   uint32_t numEcmpEgressProgrammed_{0};
+  uint32_t numEcmpEgressReferences_{0};
+  uint32_t numEcmpReplicatedPaths_{0};
+  boost::container::flat_map<BcmEgressTarget, uint32_t> egressTargets_;
+  uint32_t numDuplicateEgresses_{0};
+  uint32_t numHostEntries_{0};
+  folly::Optional<BcmEcmpEgress::FlowletConfig> ecmpFlowletConfig_;
+  // Counters exported by updateEcmpFlowletStats(), to clear those of the
+  // groups that went away
+  boost::container::flat_set<std::string> ecmpFlowletStatKeys_;
+
+  // Changes deferred by startHostBatch(): the port -> egressIds map being
+  // built, unpublished, and the last ECMP change of each egress
+  bool batching_{false};
+  std::shared_ptr<PortAndEgressIdsMap> batchPortAndEgressIds_;
+  boost::container::flat_map<opennsl_if_t, BcmEcmpEgress::Action>
+      batchEgressActions_;
 
   boost::container::flat_map<
       opennsl_if_t,
       std::pair<std::unique_ptr<BcmEgressBase>, uint32_t>>
       egressMap_;
 
-  template <typename KeyT, typename HostT>
-  using HostMap = boost::container::
-    flat_map<KeyT, std::pair<std::unique_ptr<HostT>, uint32_t>>;
-  template <typename KeyT, typename HostT>
-  HostT* incRefOrCreateBcmHostImpl(
-      HostMap<KeyT, HostT>* map,
-      const KeyT& key);
-  template <typename KeyT, typename HostT>
-  HostT* getBcmHostIfImpl(
-      const HostMap<KeyT, HostT>* map,
-      const KeyT& key) const noexcept;
-  template <typename KeyT, typename HostT>
-  HostT* derefBcmHostImpl(
-      HostMap<KeyT, HostT>* map,
-      const KeyT& key) noexcept;
-  template <typename KeyT, typename HostT>
+  /*
+   * egress ID -> (ECMP egress ID -> number of times it was added). Written
+   * while holding the hw lock, but read from the linkscan thread, hence the
+   * separate lock.
+   */
+  struct EcmpPathsHash {
+    size_t operator()(const BcmEcmpEgress::Paths& paths) const;
+  };
+  std::unordered_map<BcmEcmpEgress::Paths, opennsl_if_t, EcmpPathsHash>
+      ecmpEgressByPaths_;
+
+  mutable std::mutex egressToEcmpsLock_;
+  boost::container::flat_map<
+      opennsl_if_t,
+      boost::container::flat_map<opennsl_if_t, uint32_t>>
+      egressToEcmps_;
+
+  using HostMap = BcmHostIndex<BcmHostKey, BcmHost, BcmHostKey::Hash>;
+  using EcmpHostMap =
+      BcmHostIndex<BcmEcmpHostKey, BcmEcmpHost, BcmEcmpHostKeyHash>;
+  template <typename MapT>
+  typename MapT::HostType* incRefOrCreateBcmHostImpl(
+      MapT* map,
+      const typename MapT::KeyType& key);
+  template <typename MapT>
+  typename MapT::HostType* getBcmHostIfImpl(
+      const MapT* map,
+      const typename MapT::KeyType& key) const noexcept;
+  template <typename MapT>
+  typename MapT::HostType* derefBcmHostImpl(
+      MapT* map,
+      const typename MapT::KeyType& key) noexcept;
+  template <typename MapT>
   uint32_t getReferenceCountImpl(
-      const HostMap<KeyT, HostT> *map,
-      const KeyT& key) const noexcept;
+      const MapT* map,
+      const typename MapT::KeyType& key) const noexcept;
 
-  HostMap<BcmHostKey, BcmHost> hosts_;
-  HostMap<BcmEcmpHostKey, BcmEcmpHost> ecmpHosts_;
+  HostMap hosts_;
+  EcmpHostMap ecmpHosts_;
 };
 
 }}
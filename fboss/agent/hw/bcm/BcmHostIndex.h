@@ -0,0 +1,202 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <glog/logging.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * BcmHostIndex is the reference counted host container behind BcmHostTable.
+ *
+ * Each host lives in a heap allocated Entry next to its key, cached hash and
+ * reference count, so pointers to entries and hosts stay valid until the
+ * entry is erased, however many other entries are added or removed. The
+ * entries are kept in a dense vector for iteration, and looked up through an
+ * open addressing (linear probing) table of positions in that vector.
+ *
+ * Hosts create and release other hosts from their constructors and
+ * destructors (an ECMP host references one host per next hop), so erase()
+ * and clear() hand the hosts back to the caller, or destroy them only after
+ * the index is consistent again.
+ */
+template <typename KeyT, typename HostT, typename HashT>
+class BcmHostIndex {
+ public:
+  using KeyType = KeyT;
+  using HostType = HostT;
+
+  class Entry {
+   public:
+    Entry(KeyT k, size_t h, std::unique_ptr<HostT> hostPtr)
+        : key(std::move(k)), hash(h), host(std::move(hostPtr)) {}
+
+    const KeyT key;
+    const size_t hash;
+    std::unique_ptr<HostT> host;
+    uint32_t refCount{1};
+
+   private:
+    friend class BcmHostIndex;
+    // Position in BcmHostIndex::entries_
+    uint32_t pos_{0};
+  };
+  using Entries = std::vector<std::unique_ptr<Entry>>;
+
+  BcmHostIndex() = default;
+
+  size_t hash(const KeyT& key) const {
+    return hasher_(key);
+  }
+
+  Entry* find(const KeyT& key) const {
+    return find(key, hash(key));
+  }
+  Entry* find(const KeyT& key, size_t hash) const {
+    if (entries_.empty()) {
+      return nullptr;
+    }
+    for (auto i = hash & mask(); ; i = (i + 1) & mask()) {
+      auto slot = slots_[i];
+      if (slot == kEmpty) {
+        return nullptr;
+      }
+      if (slot != kDeleted) {
+        auto entry = entries_[slot - kFirstPos].get();
+        if (entry->hash == hash && entry->key == key) {
+          return entry;
+        }
+      }
+    }
+  }
+
+  /*
+   * Add a host for a key which is not in the index yet, with a reference
+   * count of 1. hash must be hash(key).
+   */
+  Entry* insert(KeyT key, size_t hash, std::unique_ptr<HostT> host) {
+    DCHECK(!find(key, hash));
+    if ((entries_.size() + deleted_ + 1) * 4 > slots_.size() * 3) {
+      rehash();
+    }
+    auto entry =
+        std::make_unique<Entry>(std::move(key), hash, std::move(host));
+    auto rawEntry = entry.get();
+    rawEntry->pos_ = entries_.size();
+    entries_.push_back(std::move(entry));
+    auto i = hash & mask();
+    while (slots_[i] != kEmpty && slots_[i] != kDeleted) {
+      i = (i + 1) & mask();
+    }
+    if (slots_[i] == kDeleted) {
+      --deleted_;
+    }
+    slots_[i] = rawEntry->pos_ + kFirstPos;
+    return rawEntry;
+  }
+
+  /*
+   * Remove an entry and return its host. The entry is freed, the host is the
+   * caller's to destroy.
+   */
+  std::unique_ptr<HostT> erase(Entry* entry) {
+    slots_[slotOf(entry)] = kDeleted;
+    ++deleted_;
+    auto pos = entry->pos_;
+    if (pos + 1 != entries_.size()) {
+      // Move the last entry into the hole
+      auto last = entries_.back().get();
+      slots_[slotOf(last)] = pos + kFirstPos;
+      last->pos_ = pos;
+      std::swap(entries_[pos], entries_.back());
+    }
+    auto host = std::move(entries_.back()->host);
+    entries_.pop_back();
+    return host;
+  }
+
+  /*
+   * Remove and destroy all the hosts. Hosts destroyed here see an empty
+   * index.
+   */
+  void clear() {
+    Entries entries;
+    entries.swap(entries_);
+    slots_.clear();
+    deleted_ = 0;
+  }
+
+  const Entries& entries() const {
+    return entries_;
+  }
+  size_t size() const {
+    return entries_.size();
+  }
+  bool empty() const {
+    return entries_.empty();
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BcmHostIndex(BcmHostIndex const &) = delete;
+  BcmHostIndex& operator=(BcmHostIndex const &) = delete;
+
+  // Slots hold an entry position + kFirstPos
+  enum : uint32_t {
+    kEmpty = 0,
+    kDeleted = 1,
+    kFirstPos = 2,
+  };
+  enum : size_t { kMinSlots = 16 };
+
+  size_t mask() const {
+    return slots_.size() - 1;
+  }
+
+  size_t slotOf(const Entry* entry) const {
+    auto target = entry->pos_ + kFirstPos;
+    auto i = entry->hash & mask();
+    while (slots_[i] != target) {
+      DCHECK_NE(slots_[i], uint32_t(kEmpty));
+      i = (i + 1) & mask();
+    }
+    return i;
+  }
+
+  // Resize for one more entry than we have, dropping the tombstones
+  void rehash() {
+    size_t numSlots = kMinSlots;
+    while ((entries_.size() + 1) * 2 > numSlots) {
+      numSlots *= 2;
+    }
+    slots_.assign(numSlots, uint32_t(kEmpty));
+    deleted_ = 0;
+    for (const auto& entry : entries_) {
+      auto i = entry->hash & mask();
+      while (slots_[i] != kEmpty) {
+        i = (i + 1) & mask();
+      }
+      slots_[i] = entry->pos_ + kFirstPos;
+    }
+  }
+
+  HashT hasher_;
+  Entries entries_;
+  // Power of 2 sized, at most 3/4 full counting tombstones
+  std::vector<uint32_t> slots_;
+  size_t deleted_{0};
+};
+
+}} // facebook::fboss
@@ -11,6 +11,8 @@
 
 #include "fboss/agent/FbossError.h"
 
+#include <folly/hash/Hash.h>
+
 namespace facebook { namespace fboss {
 
 BcmHostKey::BcmHostKey(
@@ -30,6 +32,12 @@ BcmHostKey::BcmHostKey(
   }
 }
 
+size_t BcmHostKey::Hash::operator()(const BcmHostKey& key) const {
+  // intfID is only set for v6 link-local addresses
+  uint32_t intf = key.intfID() ? static_cast<uint32_t>(key.intf()) : 0;
+  return folly::hash::hash_combine(key.getVrf(), key.addr(), intf);
+}
+
 std::string BcmHostKey::str() const {
   std::string intfStr = "";
   if (intfID_) {
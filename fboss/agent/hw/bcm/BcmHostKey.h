@@ -20,6 +20,10 @@ namespace facebook { namespace fboss {
 class BcmHostKey {
 
  public:
+  struct Hash {
+    size_t operator()(const BcmHostKey& key) const;
+  };
+
   // Constructor based on the forward info
   BcmHostKey(opennsl_vrf_t vrf, const NextHop& fwd)
     : BcmHostKey(vrf, fwd.addr(), fwd.intfID()) {}
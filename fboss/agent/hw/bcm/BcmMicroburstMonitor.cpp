@@ -0,0 +1,178 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmMicroburstMonitor.h"
+
+#include "fboss/agent/hw/bcm/BcmCosQueueManager.h"
+#include "fboss/agent/hw/bcm/BcmPort.h"
+#include "fboss/agent/hw/bcm/BcmPortTable.h"
+#include "fboss/agent/hw/bcm/BcmSwitch.h"
+
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+DEFINE_uint64(microburst_threshold_bytes, 64 * 1024,
+              "Queue buffer occupancy at or above which a queue is considered "
+              "to be in a microburst");
+DEFINE_int32(microburst_history_seconds, 300,
+             "How long to keep queue buffer occupancy history for");
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace {
+// Bursts kept per queue, older ones are forgotten first
+constexpr size_t kMaxBurstsPerQueue = 128;
+
+int64_t toUs(system_clock::time_point t) {
+  return duration_cast<microseconds>(t.time_since_epoch()).count();
+}
+}
+
+namespace facebook { namespace fboss {
+
+BcmMicroburstMonitor::QueueHistory::QueueHistory()
+    : occupancy(std::make_unique<TimeSeriesWithMinMax<uint64_t>>(
+          seconds(FLAGS_microburst_history_seconds), seconds(1))) {}
+
+BcmMicroburstMonitor::BcmMicroburstMonitor(const BcmSwitch* hw) : hw_(hw) {}
+
+BcmMicroburstMonitor::~BcmMicroburstMonitor() {
+  stop();
+}
+
+void BcmMicroburstMonitor::start(microseconds interval) {
+  if (isRunning()) {
+    return;
+  }
+  XLOG(INFO) << "Sampling queue buffer occupancy every " << interval.count()
+             << "us";
+  stop_ = false;
+  thread_ = std::make_unique<std::thread>([this, interval]() {
+    run(interval);
+  });
+}
+
+void BcmMicroburstMonitor::stop() {
+  if (!isRunning()) {
+    return;
+  }
+  stop_ = true;
+  thread_->join();
+  thread_.reset();
+}
+
+void BcmMicroburstMonitor::run(microseconds interval) {
+  auto nextSample = steady_clock::now();
+  while (!stop_) {
+    sampleQueues();
+    nextSample += interval;
+    auto now = steady_clock::now();
+    if (nextSample < now) {
+      // We can't keep up, rather than trying to catch up just keep going
+      nextSample = now;
+    } else {
+      std::this_thread::sleep_until(nextSample);
+    }
+  }
+}
+
+void BcmMicroburstMonitor::sampleQueues() {
+  struct Sample {
+    PortID port;
+    int queue;
+    uint64_t bytes;
+  };
+  std::vector<Sample> samples;
+  for (const auto& portIdAndPort : *hw_->getPortTable()) {
+    auto queueManager = portIdAndPort.second->getQueueManager();
+    auto numQueues = queueManager->getNumQueues(cfg::StreamType::UNICAST);
+    for (int queue = 0; queue < numQueues; ++queue) {
+      auto bytes = queueManager->getQueueOccupancy(queue);
+      if (bytes) {
+        samples.push_back({portIdAndPort.first, queue, *bytes});
+      }
+    }
+  }
+
+  auto now = system_clock::now();
+  for (const auto& sample : samples) {
+    recordSample(sample.port, sample.queue, sample.bytes, now);
+  }
+}
+
+void BcmMicroburstMonitor::recordSample(
+    PortID port,
+    int queue,
+    uint64_t bytes,
+    system_clock::time_point now) {
+  SYNCHRONIZED(queues_) {
+    auto& history = queues_[QueueKey(port, queue)];
+    history.occupancy->addValue(bytes, now);
+
+    if (bytes >= FLAGS_microburst_threshold_bytes) {
+      if (!history.inBurst) {
+        if (history.bursts.size() == kMaxBurstsPerQueue) {
+          history.bursts.pop_front();
+        }
+        QueueBurstEvent burst;
+        burst.startTimeUs = toUs(now);
+        history.bursts.push_back(burst);
+        history.inBurst = true;
+      }
+      auto& burst = history.bursts.back();
+      burst.peakBytes = std::max<int64_t>(burst.peakBytes, bytes);
+    } else if (history.inBurst) {
+      auto& burst = history.bursts.back();
+      burst.durationUs = toUs(now) - burst.startTimeUs;
+      history.inBurst = false;
+    }
+  }
+}
+
+std::vector<QueueBufferStats> BcmMicroburstMonitor::getQueueBufferStats(
+    seconds window) const {
+  std::vector<QueueBufferStats> stats;
+  auto now = system_clock::now();
+  auto windowStart = now - window;
+  SYNCHRONIZED_CONST(queues_) {
+    for (const auto& keyAndHistory : queues_) {
+      const auto& history = keyAndHistory.second;
+      QueueBufferStats queueStats;
+      try {
+        // Buckets are matched by their start time, include the current one
+        queueStats.maxOccupancyBytes =
+            history.occupancy->getMax(windowStart, now + seconds(1));
+      } catch (const std::runtime_error&) {
+        // Not sampled during the window
+        continue;
+      }
+      queueStats.port = static_cast<int32_t>(keyAndHistory.first.first);
+      queueStats.queue = keyAndHistory.first.second;
+      for (size_t i = 0; i < history.bursts.size(); ++i) {
+        const auto& burst = history.bursts[i];
+        bool ongoing = history.inBurst && i + 1 == history.bursts.size();
+        if (ongoing ||
+            burst.startTimeUs + burst.durationUs >= toUs(windowStart)) {
+          queueStats.bursts.push_back(burst);
+        }
+      }
+      stats.push_back(std::move(queueStats));
+    }
+  }
+  return stats;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+#include "fboss/agent/types.h"
+#include "fboss/lib/TimeSeriesWithMinMax.h"
+
+#include <folly/Synchronized.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class BcmSwitch;
+
+/*
+ * BcmMicroburstMonitor samples the buffer occupancy of every unicast port
+ * queue from a thread of its own, at intervals far shorter than the stats
+ * collection (down to tens of microseconds), to catch bursts which come and
+ * go between two stats cycles.
+ *
+ * For each queue it keeps the maximum occupancy per second in a
+ * TimeSeriesWithMinMax, and a bounded list of the bursts seen, a burst being
+ * a run of samples at or above --microburst_threshold_bytes.
+ */
+class BcmMicroburstMonitor {
+ public:
+  explicit BcmMicroburstMonitor(const BcmSwitch* hw);
+  ~BcmMicroburstMonitor();
+
+  /*
+   * Start sampling every interval. Does nothing if we are sampling already.
+   */
+  void start(std::chrono::microseconds interval);
+  void stop();
+  bool isRunning() const {
+    return thread_ != nullptr;
+  }
+
+  /*
+   * Stats of the queues which were sampled during the last window.
+   */
+  std::vector<QueueBufferStats> getQueueBufferStats(
+      std::chrono::seconds window) const;
+
+  /*
+   * Record one sample of a queue. Called from the sampling thread, public
+   * for tests.
+   */
+  void recordSample(
+      PortID port,
+      int queue,
+      uint64_t bytes,
+      std::chrono::system_clock::time_point now);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BcmMicroburstMonitor(BcmMicroburstMonitor const &) = delete;
+  BcmMicroburstMonitor& operator=(BcmMicroburstMonitor const &) = delete;
+
+  struct QueueHistory {
+    QueueHistory();
+
+    // Max occupancy per second
+    std::unique_ptr<TimeSeriesWithMinMax<uint64_t>> occupancy;
+    // Oldest first. If inBurst, the last one is still going on.
+    std::deque<QueueBurstEvent> bursts;
+    bool inBurst{false};
+  };
+  using QueueKey = std::pair<PortID, int>;
+
+  void run(std::chrono::microseconds interval);
+  void sampleQueues();
+
+  const BcmSwitch* hw_;
+  folly::Synchronized<std::map<QueueKey, QueueHistory>> queues_;
+  std::atomic<bool> stop_{false};
+  std::unique_ptr<std::thread> thread_;
+};
+
+}} // facebook::fboss
@@ -98,6 +98,13 @@ class BcmPlatform : public Platform {
 
   virtual bool v6MirrorTunnelSupported() const = 0;
 
+  /*
+   * Whether ECMP groups can balance flowlets dynamically over their members
+   */
+  virtual bool isDynamicLoadBalancingSupported() const {
+    return false;
+  }
+
  private:
   // Forbidden copy constructor and assignment operator
   BcmPlatform(BcmPlatform const &) = delete;
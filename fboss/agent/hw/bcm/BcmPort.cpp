@@ -18,6 +18,7 @@
 #include "common/stats/ServiceData.h"
 
 #include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmMirrorTable.h"
 #include "fboss/agent/hw/bcm/BcmPlatformPort.h"
@@ -73,6 +74,53 @@ static const std::vector<opennsl_stat_val_t> kOutPktLengthStats = {
 
 // This allows mapping from a speed and port transmission technology
 // to a broadcom supported interface
+namespace {
+// The basic port counters, all read with one opennsl_stat_multi_get() call
+struct PortCounter {
+  folly::StringPiece name;
+  opennsl_stat_val_t type;
+  int64_t HwPortStats::*field;
+};
+}
+
+static const std::vector<PortCounter> kPortCounters = {
+    {kInBytes(), opennsl_spl_snmpIfHCInOctets, &HwPortStats::inBytes_},
+    {kInUnicastPkts(),
+     opennsl_spl_snmpIfHCInUcastPkts,
+     &HwPortStats::inUnicastPkts_},
+    {kInMulticastPkts(),
+     opennsl_spl_snmpIfHCInMulticastPkts,
+     &HwPortStats::inMulticastPkts_},
+    {kInBroadcastPkts(),
+     opennsl_spl_snmpIfHCInBroadcastPkts,
+     &HwPortStats::inBroadcastPkts_},
+    {kInDiscards(), opennsl_spl_snmpIfInDiscards, &HwPortStats::inDiscards_},
+    {kInErrors(), opennsl_spl_snmpIfInErrors, &HwPortStats::inErrors_},
+    {kInIpv4HdrErrors(),
+     opennsl_spl_snmpIpInHdrErrors,
+     &HwPortStats::inIpv4HdrErrors_},
+    {kInIpv6HdrErrors(),
+     opennsl_spl_snmpIpv6IfStatsInHdrErrors,
+     &HwPortStats::inIpv6HdrErrors_},
+    {kInPause(), opennsl_spl_snmpDot3InPauseFrames, &HwPortStats::inPause_},
+    // Egress Stats
+    {kOutBytes(), opennsl_spl_snmpIfHCOutOctets, &HwPortStats::outBytes_},
+    {kOutUnicastPkts(),
+     opennsl_spl_snmpIfHCOutUcastPkts,
+     &HwPortStats::outUnicastPkts_},
+    {kOutMulticastPkts(),
+     opennsl_spl_snmpIfHCOutMulticastPkts,
+     &HwPortStats::outMulticastPkts_},
+    {kOutBroadcastPkts(),
+     opennsl_spl_snmpIfHCOutBroadcastPckts,
+     &HwPortStats::outBroadcastPkts_},
+    {kOutDiscards(),
+     opennsl_spl_snmpIfOutDiscards,
+     &HwPortStats::outDiscards_},
+    {kOutErrors(), opennsl_spl_snmpIfOutErrors, &HwPortStats::outErrors_},
+    {kOutPause(), opennsl_spl_snmpDot3OutPauseFrames, &HwPortStats::outPause_},
+};
+
 static const std::map<cfg::PortSpeed,
   std::map<TransmitterTechnology, opennsl_port_if_t> > kPortTypeMapping = {
     {cfg::PortSpeed::HUNDREDG, {
@@ -128,6 +176,12 @@ void BcmPort::updateName(const std::string& newName) {
   reinitPortStats();
 }
 
+void BcmPort::setupQueue(
+    const std::shared_ptr<PortQueue>& oldQueue,
+    const std::shared_ptr<PortQueue>& newQueue) {
+  queueManager_->programChanges(oldQueue, newQueue);
+}
+
 MonotonicCounter* BcmPort::getPortCounterIf(folly::StringPiece statKey) {
   auto pcitr = portCounters_.find(statKey.str());
   return pcitr != portCounters_.end() ? &pcitr->second : nullptr;
@@ -186,11 +240,8 @@ void BcmPort::reinitPortStats() {
   outPktLengths_ = histMap->getOrCreateLockableHistogram(
       statName("out_pkt_lengths"), &pktLenHist);
 
-  {
-    auto lockedPortStatsPtr = lastPortStats_.wlock();
-    *lockedPortStatsPtr = BcmPortStats(
-      queueManager_->getNumQueues(cfg::StreamType::UNICAST));
-  }
+  setLastPortStats(std::make_shared<BcmPortStats>(
+      queueManager_->getNumQueues(cfg::StreamType::UNICAST)));
 }
 
 BcmPort::BcmPort(BcmSwitch* hw, opennsl_port_t port,
@@ -225,6 +276,10 @@ BcmPort::~BcmPort() {
 }
 
 void BcmPort::init(bool warmBoot) {
+  initPlatformPort(initHw(warmBoot));
+}
+
+bool BcmPort::initHw(bool warmBoot) {
   bool up = false;
   if (warmBoot) {
     // Get port status from HW on warm boot.
@@ -243,11 +298,14 @@ void BcmPort::init(bool warmBoot) {
     bcmCheckError(rv, "failed to set port to known state: ", port_);
   }
 
+  enableLinkscan();
+  return up;
+}
+
+void BcmPort::initPlatformPort(bool up) {
   // Notify platform port of initial state/speed
   getPlatformPort()->linkSpeedChanged(getSpeed());
   getPlatformPort()->linkStatusChanged(up, isEnabled());
-
-  enableLinkscan();
 }
 
 bool BcmPort::supportsSpeed(cfg::PortSpeed speed) {
@@ -365,6 +423,8 @@ void BcmPort::enableLinkscan() {
 
 void BcmPort::program(const shared_ptr<Port>& port) {
   XLOG(DBG1) << "Reprogramming BcmPort for port " << port->getID();
+  HwCallScope call(HwCall::PORT_PROGRAM);
+  call.setId(port->getID());
   setIngressVlan(port);
   if (platformPort_->shouldUsePortResourceAPIs()) {
     setPortResource(port);
@@ -587,6 +647,16 @@ void BcmPort::registerInPortGroup(BcmPortGroup* portGroup) {
              << portGroup->controllingPort()->getPortID();
 }
 
+folly::Optional<opennsl_stat_val_t> BcmPort::getCounterType(
+    folly::StringPiece counterName) {
+  for (const auto& counter : kPortCounters) {
+    if (counter.name == counterName) {
+      return counter.type;
+    }
+  }
+  return folly::none;
+}
+
 std::string BcmPort::statName(folly::StringPiece name) const {
   return folly::to<string>(portName_, ".", name);
 }
@@ -599,84 +669,13 @@ void BcmPort::updateStats() {
   }
   auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
   HwPortStats curPortStats;
-  updateStat(
-      now, kInBytes(), opennsl_spl_snmpIfHCInOctets, &curPortStats.inBytes_);
-  updateStat(
-      now,
-      kInUnicastPkts(),
-      opennsl_spl_snmpIfHCInUcastPkts,
-      &curPortStats.inUnicastPkts_);
-  updateStat(
-      now,
-      kInMulticastPkts(),
-      opennsl_spl_snmpIfHCInMulticastPkts,
-      &curPortStats.inMulticastPkts_);
-  updateStat(
-      now,
-      kInBroadcastPkts(),
-      opennsl_spl_snmpIfHCInBroadcastPkts,
-      &curPortStats.inBroadcastPkts_);
-  updateStat(
-      now,
-      kInDiscards(),
-      opennsl_spl_snmpIfInDiscards,
-      &curPortStats.inDiscards_);
-  updateStat(
-      now, kInErrors(), opennsl_spl_snmpIfInErrors, &curPortStats.inErrors_);
-  updateStat(
-      now,
-      kInIpv4HdrErrors(),
-      opennsl_spl_snmpIpInHdrErrors,
-      &curPortStats.inIpv4HdrErrors_);
-  updateStat(
-      now,
-      kInIpv6HdrErrors(),
-      opennsl_spl_snmpIpv6IfStatsInHdrErrors,
-      &curPortStats.inIpv6HdrErrors_);
-  updateStat(
-      now,
-      kInPause(),
-      opennsl_spl_snmpDot3InPauseFrames,
-      &curPortStats.inPause_);
-  // Egress Stats
-  updateStat(
-      now,
-      kOutBytes(),
-      opennsl_spl_snmpIfHCOutOctets,
-      &curPortStats.outBytes_);
-  updateStat(
-      now,
-      kOutUnicastPkts(),
-      opennsl_spl_snmpIfHCOutUcastPkts,
-      &curPortStats.outUnicastPkts_);
-  updateStat(
-      now,
-      kOutMulticastPkts(),
-      opennsl_spl_snmpIfHCOutMulticastPkts,
-      &curPortStats.outMulticastPkts_);
-  updateStat(
-      now,
-      kOutBroadcastPkts(),
-      opennsl_spl_snmpIfHCOutBroadcastPckts,
-      &curPortStats.outBroadcastPkts_);
-  updateStat(
-      now,
-      kOutDiscards(),
-      opennsl_spl_snmpIfOutDiscards,
-      &curPortStats.outDiscards_);
-  updateStat(
-      now, kOutErrors(), opennsl_spl_snmpIfOutErrors, &curPortStats.outErrors_);
-  updateStat(
-      now,
-      kOutPause(),
-      opennsl_spl_snmpDot3OutPauseFrames,
-      &curPortStats.outPause_);
+  updatePortCounters(now, &curPortStats);
 
   updateBcmStats(now, &curPortStats);
 
   setAdditionalStats(now, &curPortStats);
 
-  auto lastPortStats = lastPortStats_.rlock()->portStats();
+  auto lastPortStats = getLastPortStats()->portStats();
 
   // Compute non pause discards
   const auto kUninit = hardware_stats_constants::STAT_UNINITIALIZED();
@@ -708,10 +707,7 @@ void BcmPort::updateStats() {
     }
   }
 
-  {
-    auto lockedLastPortStatsPtr = lastPortStats_.wlock();
-    *lockedLastPortStatsPtr = BcmPortStats(curPortStats, now);
-  }
+  setLastPortStats(std::make_shared<BcmPortStats>(curPortStats, now));
 
   // Update the queue length stat
   uint32_t qlength;
@@ -732,6 +728,41 @@ void BcmPort::updateStats() {
   updatePktLenHist(now, &outPktLengths_, kOutPktLengthStats);
 };
 
+void BcmPort::updatePortCounters(
+    std::chrono::seconds now,
+    HwPortStats* curPortStats) {
+  static const std::vector<opennsl_stat_val_t> kTypes = [] {
+    std::vector<opennsl_stat_val_t> types;
+    for (const auto& counter : kPortCounters) {
+      types.push_back(counter.type);
+    }
+    return types;
+  }();
+  std::vector<uint64_t> values(kTypes.size());
+  // opennsl_stat_multi_get() unfortunately doesn't correctly const qualify
+  // it's stats arguments right now.
+  auto ret = opennsl_stat_multi_get(
+      unit_,
+      port_,
+      kTypes.size(),
+      const_cast<opennsl_stat_val_t*>(kTypes.data()),
+      values.data());
+  if (OPENNSL_FAILURE(ret)) {
+    XLOG(ERR) << "Failed to get port counters for port " << port_ << " :"
+              << opennsl_errmsg(ret) << ", reading them one at a time";
+    for (const auto& counter : kPortCounters) {
+      updateStat(
+          now, counter.name, counter.type, &(curPortStats->*counter.field));
+    }
+    return;
+  }
+  for (size_t idx = 0; idx < kPortCounters.size(); ++idx) {
+    const auto& counter = kPortCounters[idx];
+    getPortCounterIf(counter.name)->updateValue(now, values[idx]);
+    curPortStats->*counter.field = values[idx];
+  }
+}
+
 void BcmPort::updateStat(
     std::chrono::seconds now,
     folly::StringPiece statKey,
@@ -800,12 +831,24 @@ std::chrono::seconds BcmPort::BcmPortStats::timeRetrieved() const {
   return timeRetrieved_;
 }
 
+std::shared_ptr<const BcmPort::BcmPortStats> BcmPort::getLastPortStats()
+    const {
+  folly::SpinLockGuard guard(lastPortStatsLock_);
+  return lastPortStats_;
+}
+
+void BcmPort::setLastPortStats(std::shared_ptr<const BcmPortStats> stats) {
+  folly::SpinLockGuard guard(lastPortStatsLock_);
+  lastPortStats_.swap(stats);
+  // The old snapshot is released outside of the lock
+}
+
 HwPortStats BcmPort::getPortStats() const {
-  return lastPortStats_.rlock()->portStats();
+  return getLastPortStats()->portStats();
 }
 
 std::chrono::seconds BcmPort::getTimeRetrieved() const {
-  return lastPortStats_.rlock()->timeRetrieved();
+  return getLastPortStats()->timeRetrieved();
 }
 
 void BcmPort::applyMirrorAction(
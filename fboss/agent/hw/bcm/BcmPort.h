@@ -27,7 +27,7 @@ extern "C" {
 #include "fboss/agent/state/Port.h"
 
 #include <folly/Range.h>
-#include <folly/Synchronized.h>
+#include <folly/SpinLock.h>
 #include <mutex>
 #include <utility>
 
@@ -55,6 +55,15 @@ class BcmPort {
   ~BcmPort();
 
   void init(bool warmBoot);
+  /*
+   * The two halves of init(). initHw() only programs this port in the
+   * SDK, so it may run for different ports in parallel, and returns
+   * whether the link is up. initPlatformPort() then notifies the platform
+   * port of its initial state, and must be called from one thread at a
+   * time.
+   */
+  bool initHw(bool warmBoot);
+  void initPlatformPort(bool up);
 
   void enable(const std::shared_ptr<Port>& swPort);
   void enableLinkscan();
@@ -62,6 +71,10 @@ class BcmPort {
   void disableLinkscan();
   void program(const std::shared_ptr<Port>& swPort);
   void setupQueue(const std::shared_ptr<PortQueue>& queue);
+  // Reprogram only the settings of the queue changed since oldQueue
+  void setupQueue(
+      const std::shared_ptr<PortQueue>& oldQueue,
+      const std::shared_ptr<PortQueue>& newQueue);
 
   /*
    * Getters.
@@ -124,6 +137,8 @@ class BcmPort {
   void setIngressVlan(const std::shared_ptr<Port>& swPort);
   void setSpeed(const std::shared_ptr<Port>& swPort);
   void setSflowRates(const std::shared_ptr<Port>& swPort);
+  // Sample at rates other than configured, see SflowRateController
+  void setSflowRates(int64_t ingressRate, int64_t egressRate);
   void disableSflow();
   void setPortResource(const std::shared_ptr<Port>& swPort);
 
@@ -154,6 +169,13 @@ class BcmPort {
    */
   void linkStatusChanged(const std::shared_ptr<Port>& port);
 
+  /*
+   * The SDK stat type of one of the basic port counters, looked up by its
+   * stat name (e.g. "in_bytes"), for readers outside of the stats cycle.
+   */
+  static folly::Optional<opennsl_stat_val_t> getCounterType(
+      folly::StringPiece counterName);
+
   static opennsl_gport_t asGPort(opennsl_port_t port);
   static bool isValidLocalPort(opennsl_gport_t gport);
   BcmCosQueueManager* getQueueManager() const {
@@ -168,10 +190,12 @@ class BcmPort {
   }
 
  private:
+  /*
+   * A snapshot of the port's counters. Each stats cycle fills in a new one
+   * and publishes it in lastPortStats_, so readers only ever copy a pointer
+   * and never wait for the stats collection.
+   */
   class BcmPortStats {
-    // All actions or instantiations of this class need to be done in a
-    // thread-safe way (for example, the way that locking is done on
-    // lastPortStats_) - the class itself does not guarantee this on it's own
    public:
     BcmPortStats() {}
     explicit BcmPortStats(int numUnicastQueues);
@@ -192,6 +216,9 @@ class BcmPort {
   bool shouldReportStats() const;
   void reinitPortStats();
   void reinitPortStat(folly::StringPiece newName);
+  void updatePortCounters(
+      std::chrono::seconds now,
+      HwPortStats* curPortStats);
   void updateStat(std::chrono::seconds now,
                   folly::StringPiece statName,
                   opennsl_stat_val_t type,
@@ -254,7 +281,13 @@ class BcmPort {
   stats::ExportedHistogramMapImpl::LockableHistogram inPktLengths_;
   stats::ExportedHistogramMapImpl::LockableHistogram outPktLengths_;
 
-  folly::Synchronized<BcmPortStats> lastPortStats_;
+  std::shared_ptr<const BcmPortStats> getLastPortStats() const;
+  void setLastPortStats(std::shared_ptr<const BcmPortStats> stats);
+
+  // Only held to copy or replace the lastPortStats_ pointer
+  mutable folly::SpinLock lastPortStatsLock_;
+  std::shared_ptr<const BcmPortStats> lastPortStats_{
+      std::make_shared<BcmPortStats>()};
 };
 
 }} // namespace facebook::fboss
@@ -14,6 +14,7 @@
 #include "fboss/agent/hw/bcm/BcmError.h"
 
 #include <folly/logging/xlog.h>
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/state/Port.h"
 
 namespace {
@@ -158,7 +159,21 @@ bool BcmPortGroup::validConfiguration(
   return true;
 }
 
+uint8_t BcmPortGroup::lanesOfPort(uint8_t lane, LaneMode laneMode) {
+  // The port on the first lane of each group of laneMode lanes gets them all
+  auto lanesPerPort = 4 / laneMode;
+  return lane % lanesPerPort == 0 ? lanesPerPort : 0;
+}
+
 void BcmPortGroup::reconfigureIfNeeded(
+  const std::shared_ptr<SwitchState>& state) {
+  if (prepareReconfiguration(state)) {
+    applyLaneMode();
+    finishReconfiguration(state);
+  }
+}
+
+bool BcmPortGroup::prepareReconfiguration(
   const std::shared_ptr<SwitchState>& state) {
   // This logic is a bit messy. We could encode some notion of port
   // groups into the swith state somehow so it is easy to generate
@@ -171,40 +186,73 @@ void BcmPortGroup::reconfigureIfNeeded(
     ports, controllingPort_->supportedLaneSpeeds());
   if (speedChanged) {
     controllingPort_->getPlatformPort()->linkSpeedChanged(ports[0]->getSpeed());
+    portSpeed_ = ports[0]->getSpeed();
   }
-  if (desiredLaneMode != laneMode_) {
-    reconfigureLaneMode(state, desiredLaneMode);
+  if (desiredLaneMode == laneMode_) {
+    return false;
   }
-}
 
-void BcmPortGroup::reconfigureLaneMode(
-  const std::shared_ptr<SwitchState>& state,
-  LaneMode newLaneMode
-) {
   // The logic for this follows the steps required for flex-port support
   // outlined in the sdk documentation.
   XLOG(DBG1) << "Reconfiguring port " << controllingPort_->getBcmPortId()
-             << " from " << laneMode_ << " active ports to " << newLaneMode
-             << " active ports";
+             << " from " << laneMode_ << " active ports to "
+             << desiredLaneMode << " active ports";
+  newLaneMode_ = desiredLaneMode;
 
-  // 1. Disable linkscan, then disable ports.
+  // 1. Disable linkscan, then disable ports. Only the ports with lanes
+  // before or after have anything to reconfigure.
   for (auto& bcmPort : allPorts_) {
+    auto lane = getLane(bcmPort);
+    if (lanesOfPort(lane, laneMode_) == lanesOfPort(lane, newLaneMode_)) {
+      continue;
+    }
     auto swPort = bcmPort->getSwitchStatePort(state);
     bcmPort->disableLinkscan();
     bcmPort->disable(swPort);
   }
+  return true;
+}
 
+void BcmPortGroup::applyLaneMode() {
   // 2. Set the opennslPortControlLanes setting
-  setActiveLanes(newLaneMode);
+  setActiveLanes(newLaneMode_);
+  laneMode_ = newLaneMode_;
+}
 
+void BcmPortGroup::finishReconfiguration(
+  const std::shared_ptr<SwitchState>& state) {
   // 3. Enable linkscan, then enable ports.
+  auto now = std::chrono::steady_clock::now();
   for (auto& bcmPort : allPorts_) {
     auto swPort = bcmPort->getSwitchStatePort(state);
     if (swPort->isEnabled()) {
+      {
+        std::lock_guard<std::mutex> g(linkUpLock_);
+        awaitingLinkUp_[bcmPort->getBcmPortId()] = now;
+      }
       bcmPort->enableLinkscan();
       bcmPort->enable(swPort);
     }
   }
 }
 
+void BcmPortGroup::linkUp(const BcmPort* port) {
+  std::chrono::steady_clock::time_point enabled;
+  {
+    std::lock_guard<std::mutex> g(linkUpLock_);
+    auto it = awaitingLinkUp_.find(port->getBcmPortId());
+    if (it == awaitingLinkUp_.end()) {
+      return;
+    }
+    enabled = it->second;
+    awaitingLinkUp_.erase(it);
+  }
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - enabled);
+  XLOG(DBG1) << "Port " << port->getBcmPortId() << " came up " << ms.count()
+             << "ms after its port group was reconfigured";
+  tcData().addStatValue(
+      "port_group.reconfigure_link_up.ms", ms.count(), stats::AVG);
+}
+
 }} // namespace facebook::fboss
@@ -19,6 +19,7 @@ extern "C" {
 #include "fboss/agent/state/Port.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 
+#include <chrono>
 #include <mutex>
 #include <boost/container/flat_map.hpp>
 
@@ -70,11 +71,36 @@ class BcmPortGroup {
 
   void reconfigureIfNeeded(const std::shared_ptr<SwitchState>& state);
 
+  /*
+   * reconfigureIfNeeded() in three steps, so that BcmSwitch can take all
+   * the groups of a state update through each step before the next one,
+   * and the links of the different groups train at the same time rather
+   * than one group after the other.
+   *
+   * prepareReconfiguration() works out the lane mode the ports need in
+   * state. If it differs from the current one, it disables the ports whose
+   * lanes change and returns true, the other ports are left alone. Then
+   * applyLaneMode() moves the group to the new lane mode, and
+   * finishReconfiguration() enables the ports enabled in state.
+   */
+  bool prepareReconfiguration(const std::shared_ptr<SwitchState>& state);
+  void applyLaneMode();
+  void finishReconfiguration(const std::shared_ptr<SwitchState>& state);
+
+  /*
+   * Called from the linkscan thread when the link of port comes up, to
+   * report how long it took to come up after the group was reconfigured.
+   */
+  void linkUp(const BcmPort* port);
+
   bool validConfiguration(const std::shared_ptr<SwitchState>& state) const;
 
   static BcmPortGroup::LaneMode calculateDesiredLaneMode(
     const std::vector<Port*>& ports, LaneSpeeds supportedLaneSpeeds);
 
+  // The number of lanes the port on lane has in laneMode, 0 if it has none
+  static uint8_t lanesOfPort(uint8_t lane, LaneMode laneMode);
+
   LaneMode laneMode() {
     return laneMode_;
   }
@@ -87,14 +113,22 @@ class BcmPortGroup {
   uint8_t getLane(const BcmPort* bcmPort) const;
   int retrieveActiveLanes() const;
   void setActiveLanes(LaneMode desiredLaneMode);
-  void reconfigureLaneMode(const std::shared_ptr<SwitchState>& state,
-                   LaneMode newLaneMode);
 
   BcmSwitch* hw_;
   BcmPort* controllingPort_{nullptr};
   std::vector<BcmPort*> allPorts_;
   LaneMode laneMode_;
+  // The lane mode being moved to, between prepareReconfiguration() and
+  // applyLaneMode()
+  LaneMode newLaneMode_;
   cfg::PortSpeed portSpeed_;
+
+  // When the ports enabled by the last reconfiguration were enabled, until
+  // their link comes up
+  std::mutex linkUpLock_;
+  boost::container::
+      flat_map<opennsl_port_t, std::chrono::steady_clock::time_point>
+          awaitingLinkUp_;
 };
 
 }} // namespace facebook::fboss
@@ -81,4 +81,36 @@ BcmPortQueueConfig BcmPortQueueManager::getCurrentQueueSettings() const {
                             std::move(multicastQueues));
 }
 
+void BcmPortQueueManager::programChanges(
+    const std::shared_ptr<PortQueue>& oldQueue,
+    const std::shared_ptr<PortQueue>& newQueue) {
+  if (!oldQueue || oldQueue->getID() != newQueue->getID() ||
+      oldQueue->getStreamType() != newQueue->getStreamType()) {
+    program(newQueue);
+    return;
+  }
+
+  auto cosQ = newQueue->getID();
+  auto gport = getQueueGPort(newQueue->getStreamType(), cosQ);
+  if (oldQueue->getScheduling() != newQueue->getScheduling() ||
+      oldQueue->getWeight() != newQueue->getWeight()) {
+    programSchedulingAndWeight(gport, cosQ, newQueue);
+  }
+  if (oldQueue->getReservedBytes() != newQueue->getReservedBytes()) {
+    programReservedBytes(gport, cosQ, newQueue);
+  }
+  if (oldQueue->getScalingFactor() != newQueue->getScalingFactor()) {
+    programAlpha(gport, cosQ, newQueue);
+  }
+  if (oldQueue->getSharedBytes() != newQueue->getSharedBytes()) {
+    programSharedBytes(gport, cosQ, newQueue);
+  }
+  if (oldQueue->getPacketsPerSec() != newQueue->getPacketsPerSec()) {
+    programBandwidth(gport, cosQ, newQueue);
+  }
+  if (oldQueue->getAqms() != newQueue->getAqms()) {
+    programAqms(gport, cosQ, newQueue);
+  }
+}
+
 }} // facebook::fboss
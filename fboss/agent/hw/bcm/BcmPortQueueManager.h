@@ -45,6 +45,15 @@ public:
 
   void program(const std::shared_ptr<PortQueue>& queue) override;
 
+  /*
+   * Only the scheduling, buffer, bandwidth and AQM settings which differ
+   * between oldQueue and newQueue are written. The queue is programmed
+   * from scratch if there is no oldQueue or it is for another queue.
+   */
+  void programChanges(
+      const std::shared_ptr<PortQueue>& oldQueue,
+      const std::shared_ptr<PortQueue>& newQueue) override;
+
   const std::vector<BcmCosQueueCounterType>&
   getQueueCounterTypes() const override;
 
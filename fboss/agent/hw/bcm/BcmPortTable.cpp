@@ -19,11 +19,21 @@
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 
 #include <folly/Memory.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
 
 extern "C" {
 #include <opennsl/port.h>
 }
 
+DEFINE_int32(port_init_threads, 1,
+             "How many threads to program the ports with on init");
+
 namespace facebook { namespace fboss {
 
 using std::make_unique;
@@ -47,6 +57,7 @@ void BcmPortTable::initPorts(const opennsl_port_config_t* portConfig,
   // 128 ports, if the platform only defines 32 ports we will only create 32
   // BcmPort objects.
   auto platformPorts = hw_->getPlatform()->initPorts();
+  std::vector<BcmPort*> ports;
   for (const auto& entry : platformPorts) {
     opennsl_port_t bcmPortNum = entry.first;
     BcmPlatformPort* platPort = entry.second;
@@ -61,12 +72,44 @@ void BcmPortTable::initPorts(const opennsl_port_config_t* portConfig,
     PortID fbossPortID = platPort->getPortID();
     auto bcmPort = make_unique<BcmPort>(hw_, bcmPortNum, platPort);
     platPort->setBcmPort(bcmPort.get());
-    bcmPort->init(warmBoot);
+    ports.push_back(bcmPort.get());
 
     fbossPhysicalPorts_.emplace(fbossPortID, bcmPort.get());
     bcmPhysicalPorts_.emplace(bcmPortNum, std::move(bcmPort));
   }
 
+  // Programming the ports dominates cold boot on the larger platforms. The
+  // SDK calls for different ports are independent, so spread them over
+  // threads, then tell the platform ports their state from this thread.
+  std::vector<char> linkUp(ports.size(), false);
+  std::vector<std::exception_ptr> errors(ports.size());
+  std::atomic<size_t> next{0};
+  auto initHw = [&]() {
+    for (auto i = next++; i < ports.size(); i = next++) {
+      try {
+        linkUp[i] = ports[i]->initHw(warmBoot);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  auto numThreads = std::min<size_t>(
+      std::max(FLAGS_port_init_threads, 1), ports.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; ++i) {
+    threads.emplace_back(initHw);
+  }
+  initHw();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < ports.size(); ++i) {
+    if (errors[i]) {
+      std::rethrow_exception(errors[i]);
+    }
+    ports[i]->initPlatformPort(linkUp[i]);
+  }
+
   initPortGroups();
 }
 
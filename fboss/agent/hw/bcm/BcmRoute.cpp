@@ -18,18 +18,27 @@ extern "C" {
 #include <folly/IPAddressV6.h>
 #include <folly/logging/xlog.h>
 #include "fboss/agent/Constants.h"
+#include "fboss/agent/LatencyQuantiles.h"
+#include "fboss/agent/Tracepoints.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmHost.h"
 #include "fboss/agent/hw/bcm/BcmIntf.h"
 #include "fboss/agent/hw/bcm/BcmPlatform.h"
+#include "fboss/agent/hw/bcm/BcmStats.h"
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
 
 #include "fboss/agent/state/RouteTypes.h"
 
+#include <boost/container/flat_set.hpp>
+#include <folly/ScopeGuard.h>
 #include <gflags/gflags.h>
+#include <algorithm>
+#include <chrono>
 #include <numeric>
+#include <tuple>
 
 namespace {
 
@@ -50,6 +59,11 @@ DEFINE_int32(
     64,
     "Max ecmp width. Also implies ucmp normalization factor");
 DEFINE_validator(ecmp_width, &ValidateEcmpWidth);
+DEFINE_int32(
+    host_table_route_headroom_pct,
+    10,
+    "Percentage of the L3 host table kept free of host routes for neighbor "
+    "entries. Host routes beyond that go to the route table instead");
 
 namespace facebook { namespace fboss {
 
@@ -197,6 +211,18 @@ void BcmRoute::program(const RouteNextHopEntry& fwd) {
   if (added_ && fwd == fwd_) {
     return;
   }
+  FBOSS_TRACEPOINT(
+      bcm_route_program, vrf_, prefix_.bytes(), prefix_.byteCount(), len_);
+  HwCallScope call(HwCall::ROUTE_ADD);
+  call.setAddress(prefix_, len_);
+  call.setVrf(vrf_);
+  call.setCount(fwd.getNextHopSet().size());
+  auto start = std::chrono::steady_clock::now();
+  SCOPE_SUCCESS {
+    hw_->getRouteProgramLatency()->addValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+  };
 
   // function to clean up the host reference
   auto cleanupHost = [&] (const RouteNextHopSet& nhopsClean) noexcept {
@@ -222,6 +248,7 @@ void BcmRoute::program(const RouteNextHopEntry& fwd) {
         std::make_pair(vrf_, nhops));
     egressId = host->getEgressId();
   }
+  call.setId(egressId);
 
   // At this point host and egress objects for next hops have been
   // created, what remains to be done is to program route into the
@@ -230,7 +257,12 @@ void BcmRoute::program(const RouteNextHopEntry& fwd) {
   SCOPE_FAIL {
     cleanupHost(fwd.getNextHopSet());
   };
-  if (canUseHostTable()) {
+  // Where a route lives is settled when it is added. Spilled host routes
+  // move to the host table through moveToHostTable() only.
+  auto inHostTable = added_
+      ? inHostTable_
+      : canUseHostTable() && hw_->writableRouteTable()->hostRouteFits();
+  if (inHostTable) {
     if (added_) {
       // Delete the already existing host table entry, because we cannot change
       // host entries.
@@ -266,9 +298,18 @@ void BcmRoute::program(const RouteNextHopEntry& fwd) {
 
   // new nexthop has been stored in fwd_. From now on, it is up to
   // ~BcmRoute() to clean up such nexthop.
+  inHostTable_ = inHostTable;
   added_ = true;
 }
 
+void BcmRoute::moveToHostTable() {
+  CHECK(isSpilledHostRoute());
+  // Add the host entry first, so the prefix stays reachable throughout
+  programHostRoute(egressId_, fwd_, false);
+  deleteLpmRoute(hw_->getUnit(), vrf_, prefix_, len_);
+  inHostTable_ = true;
+}
+
 void BcmRoute::programHostRoute(opennsl_if_t egressId,
     const RouteNextHopEntry& fwd, bool replace) {
   XLOG(DBG3) << "creating a host route entry for " << prefix_.str()
@@ -296,6 +337,15 @@ void BcmRoute::programLpmRoute(opennsl_if_t egressId,
 
   bool addRoute = false;
   const auto warmBootCache = hw_->getWarmBootCache();
+  if (!added_ && canUseHostTable()) {
+    // A host route spilled to the route table before a warm boot
+    auto hostRouteCitr =
+        warmBootCache->findHostRouteFromRouteTable(vrf_, prefix_);
+    if (hostRouteCitr != warmBootCache->vrfAndIP2Route_end()) {
+      rt.l3a_flags |= OPENNSL_L3_REPLACE;
+      warmBootCache->programmed(hostRouteCitr);
+    }
+  }
   auto vrfAndPfx2RouteCitr = warmBootCache->findRoute(vrf_, prefix_, len_);
   if (vrfAndPfx2RouteCitr != warmBootCache->vrfAndPrefix2Route_end()) {
     // Lambda to compare if the routes are equivalent and thus we need to
@@ -381,7 +431,11 @@ BcmRoute::~BcmRoute() {
   if (!added_) {
     return;
   }
-  if (canUseHostTable()) {
+  HwCallScope call(HwCall::ROUTE_DELETE);
+  call.setAddress(prefix_, len_);
+  call.setVrf(vrf_);
+  call.setId(egressId_);
+  if (inHostTable_) {
     auto hostKey = BcmHostKey(vrf_, prefix_);
     auto host = hw_->getHostTable()->getBcmHostIf(hostKey);
     CHECK(host);
@@ -440,11 +494,31 @@ BcmRoute* BcmRouteTable::getBcmRoute(
   return rt;
 }
 
+template<typename RouteT>
+BcmRouteTable::Key BcmRouteTable::makeKey(
+    opennsl_vrf_t vrf,
+    const RouteT* route) {
+  const auto& prefix = route->prefix();
+  return Key{folly::IPAddress(prefix.network), prefix.mask, vrf};
+}
+
+template<typename RouteT>
+RouteNextHopEntry BcmRouteTable::getNormalizedForwardInfo(
+    const RouteT* route) {
+  CHECK(route->isResolved());
+  RouteNextHopEntry fwd(route->getForwardInfo());
+  if (fwd.getAction() == RouteForwardAction::NEXTHOPS) {
+    RouteNextHopSet nhops = normalizeNextHops(fwd.getNextHopSet());
+    fwd = RouteNextHopEntry(nhops, fwd.getAdminDistance());
+  }
+  return fwd;
+}
+
 template<typename RouteT>
 void BcmRouteTable::addRoute(opennsl_vrf_t vrf, const RouteT *route) {
   const auto& prefix = route->prefix();
 
-  Key key{folly::IPAddress(prefix.network), prefix.mask, vrf};
+  auto key = makeKey(vrf, route);
   auto ret = fib_.emplace(key, nullptr);
   if (ret.second) {
     SCOPE_FAIL {
@@ -454,24 +528,207 @@ void BcmRouteTable::addRoute(opennsl_vrf_t vrf, const RouteT *route) {
                                         folly::IPAddress(prefix.network),
                                         prefix.mask));
   }
-  CHECK(route->isResolved());
-  RouteNextHopEntry fwd(route->getForwardInfo());
-  if (fwd.getAction() == RouteForwardAction::NEXTHOPS) {
-    RouteNextHopSet nhops = normalizeNextHops(fwd.getNextHopSet());
-    fwd = RouteNextHopEntry(nhops, fwd.getAdminDistance());
+  ret.first->second->program(getNormalizedForwardInfo(route));
+  if (ret.second) {
+    numSpilledHostRoutes_ += ret.first->second->isSpilledHostRoute();
   }
-  ret.first->second->program(fwd);
 }
 
 template<typename RouteT>
 void BcmRouteTable::deleteRoute(opennsl_vrf_t vrf, const RouteT *route) {
-  const auto& prefix = route->prefix();
-  Key key{folly::IPAddress(prefix.network), prefix.mask, vrf};
-  auto iter = fib_.find(key);
+  auto iter = fib_.find(makeKey(vrf, route));
   if (iter == fib_.end()) {
     throw FbossError("Failed to delete a non-existing route ", route->str());
   }
+  numSpilledHostRoutes_ -= iter->second->isSpilledHostRoute();
   fib_.erase(iter);
+  BcmStats::get()->routesDeleted(1);
+}
+
+template<typename RouteT>
+void BcmRouteTable::addRoutes(
+    opennsl_vrf_t vrf,
+    const std::vector<const RouteT*>& routes,
+    const RouteErrorFn& onError) {
+  if (routes.empty()) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<RouteNextHopEntry> fwds;
+  fwds.reserve(routes.size());
+  boost::container::flat_set<RouteNextHopSet> nhopSets;
+  for (const auto* route : routes) {
+    fwds.push_back(getNormalizedForwardInfo(route));
+    if (fwds.back().getAction() == RouteForwardAction::NEXTHOPS) {
+      nhopSets.insert(fwds.back().getNextHopSet());
+    }
+  }
+
+  // Stage 1: create the egress objects for all next hop sets ahead of the
+  // route writes. The batch holds its own reference on each of them until
+  // all routes are programmed. Failures are left for the route that needs
+  // the egress to report.
+  std::vector<BcmEcmpHostKey> stagedHosts;
+  stagedHosts.reserve(nhopSets.size());
+  SCOPE_EXIT {
+    for (const auto& hostKey : stagedHosts) {
+      hw_->writableHostTable()->derefBcmEcmpHost(hostKey);
+    }
+  };
+  for (const auto& nhops : nhopSets) {
+    auto hostKey = std::make_pair(vrf, nhops);
+    try {
+      hw_->writableHostTable()->incRefOrCreateBcmEcmpHost(hostKey);
+      stagedHosts.push_back(std::move(hostKey));
+    } catch (const BcmError& ex) {
+      XLOG(DBG2) << "Failed to create egress for " << nhops
+                 << " ahead of route programming: " << ex.what();
+    }
+  }
+
+  // Stage 2: write the routes. New routes are collected on the side and
+  // merged into fib_ at the end to avoid a sorted insert per route.
+  std::vector<std::pair<Key, std::unique_ptr<BcmRoute>>> newRoutes;
+  SCOPE_EXIT {
+    if (newRoutes.empty()) {
+      return;
+    }
+    std::sort(
+        newRoutes.begin(),
+        newRoutes.end(),
+        [](const std::pair<Key, std::unique_ptr<BcmRoute>>& r1,
+           const std::pair<Key, std::unique_ptr<BcmRoute>>& r2) {
+          return r1.first < r2.first;
+        });
+    fib_.insert(
+        boost::container::ordered_unique_range,
+        std::make_move_iterator(newRoutes.begin()),
+        std::make_move_iterator(newRoutes.end()));
+  };
+  std::vector<size_t> order(routes.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (alpmEnabled_) {
+    std::stable_sort(order.begin(), order.end(), [&](size_t i1, size_t i2) {
+      const auto& p1 = routes[i1]->prefix();
+      const auto& p2 = routes[i2]->prefix();
+      return std::tie(p1.network, p1.mask) < std::tie(p2.network, p2.mask);
+    });
+    for (size_t i = 0; i < order.size(); ++i) {
+      alpmReorderedRoutes_ += order[i] != i;
+    }
+  }
+
+  uint64_t programmed = 0;
+  for (auto i : order) {
+    const auto* route = routes[i];
+    auto key = makeKey(vrf, route);
+    try {
+      auto iter = fib_.find(key);
+      if (iter != fib_.end()) {
+        iter->second->program(fwds[i]);
+      } else {
+        const auto& prefix = route->prefix();
+        auto bcmRoute = std::make_unique<BcmRoute>(
+            hw_, vrf, folly::IPAddress(prefix.network), prefix.mask);
+        bcmRoute->program(fwds[i]);
+        numSpilledHostRoutes_ += bcmRoute->isSpilledHostRoute();
+        newRoutes.emplace_back(std::move(key), std::move(bcmRoute));
+      }
+      ++programmed;
+    } catch (const BcmError& error) {
+      onError(i, error);
+    }
+  }
+
+  auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  BcmStats::get()->routesProgrammed(programmed, usecs.count());
+}
+
+template<typename RouteT>
+void BcmRouteTable::deleteRoutes(
+    opennsl_vrf_t vrf,
+    const std::vector<const RouteT*>& routes) {
+  if (routes.size() <= kBulkDeleteThreshold) {
+    for (const auto* route : routes) {
+      deleteRoute(vrf, route);
+    }
+    return;
+  }
+
+  boost::container::flat_set<Key> toDelete;
+  toDelete.reserve(routes.size());
+  for (const auto* route : routes) {
+    auto key = makeKey(vrf, route);
+    if (fib_.find(key) == fib_.end()) {
+      throw FbossError(
+          "Failed to delete a non-existing route ", route->str());
+    }
+    toDelete.insert(std::move(key));
+  }
+
+  // Rebuild the table without the deleted routes in one pass. The deleted
+  // BcmRoute objects remove themselves from the HW when the old table is
+  // destroyed at the end of this function.
+  decltype(fib_) remaining;
+  remaining.reserve(fib_.size() - toDelete.size());
+  for (auto& entry : fib_) {
+    if (toDelete.find(entry.first) == toDelete.end()) {
+      remaining.emplace_hint(
+          remaining.end(), entry.first, std::move(entry.second));
+    } else {
+      numSpilledHostRoutes_ -= entry.second->isSpilledHostRoute();
+    }
+  }
+  fib_.swap(remaining);
+  BcmStats::get()->routesDeleted(toDelete.size());
+}
+
+uint32_t BcmRouteTable::hostRouteCapacity() const {
+  if (!hostRouteCapacity_) {
+    opennsl_l3_info_t l3Info;
+    opennsl_l3_info_t_init(&l3Info);
+    auto rc = opennsl_l3_info(hw_->getUnit(), &l3Info);
+    bcmCheckError(rc, "failed to get L3 table info");
+    auto headroomPct = std::min(
+        std::max(FLAGS_host_table_route_headroom_pct, 0), 100);
+    hostRouteCapacity_ = static_cast<uint64_t>(l3Info.l3info_max_host) *
+        (100 - headroomPct) / 100;
+  }
+  return hostRouteCapacity_;
+}
+
+bool BcmRouteTable::hostRouteFits() const {
+  return hw_->getHostTable()->numHostEntries() < hostRouteCapacity();
+}
+
+void BcmRouteTable::migrateSpilledHostRoutes() {
+  if (!numSpilledHostRoutes_ || !hostRouteFits()) {
+    return;
+  }
+  uint32_t migrated = 0;
+  for (auto& entry : fib_) {
+    if (!numSpilledHostRoutes_ || !hostRouteFits()) {
+      break;
+    }
+    auto& route = entry.second;
+    if (!route->isSpilledHostRoute()) {
+      continue;
+    }
+    try {
+      route->moveToHostTable();
+    } catch (const BcmError& ex) {
+      // The host table is fuller than we count, try again later
+      XLOG(WARNING) << "Failed to move host route " << entry.first.network
+                    << " to the host table: " << ex.what();
+      break;
+    }
+    --numSpilledHostRoutes_;
+    ++migrated;
+  }
+  XLOG(DBG2) << "Moved " << migrated << " host routes to the host table, "
+             << numSpilledHostRoutes_ << " still in the route table";
 }
 
 folly::dynamic BcmRouteTable::toFollyDynamic() const {
@@ -488,4 +745,18 @@ template void BcmRouteTable::addRoute(opennsl_vrf_t, const RouteV4 *);
 template void BcmRouteTable::addRoute(opennsl_vrf_t, const RouteV6 *);
 template void BcmRouteTable::deleteRoute(opennsl_vrf_t, const RouteV4 *);
 template void BcmRouteTable::deleteRoute(opennsl_vrf_t, const RouteV6 *);
+template void BcmRouteTable::addRoutes(
+    opennsl_vrf_t,
+    const std::vector<const RouteV4*>&,
+    const RouteErrorFn&);
+template void BcmRouteTable::addRoutes(
+    opennsl_vrf_t,
+    const std::vector<const RouteV6*>&,
+    const RouteErrorFn&);
+template void BcmRouteTable::deleteRoutes(
+    opennsl_vrf_t,
+    const std::vector<const RouteV4*>&);
+template void BcmRouteTable::deleteRoutes(
+    opennsl_vrf_t,
+    const std::vector<const RouteV6*>&);
 }}
@@ -22,8 +22,12 @@ extern "C" {
 
 #include <boost/container/flat_map.hpp>
 
+#include <functional>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
+class BcmError;
 class BcmSwitch;
 class BcmHost;
 
@@ -36,6 +40,19 @@ class BcmRoute {
            const folly::IPAddress& addr, uint8_t len);
   ~BcmRoute();
   void program(const RouteNextHopEntry& fwd);
+  /*
+   * Whether this is a host route the host table had no room for when it
+   * was added, see BcmRouteTable::hostRouteFits().
+   */
+  bool isSpilledHostRoute() const {
+    return added_ && !inHostTable_ && canUseHostTable();
+  }
+  /*
+   * Move a spilled host route from the route table to the host table.
+   * Throws BcmError if the host entry can't be added, in which case the
+   * route stays where it is.
+   */
+  void moveToHostTable();
   static bool deleteLpmRoute(int unit,
                              opennsl_vrf_t vrf,
                              const folly::IPAddress& prefix,
@@ -67,6 +84,7 @@ class BcmRoute {
   RouteNextHopEntry fwd_{RouteNextHopEntry::Action::DROP,
                          AdminDistance::MAX_ADMIN_DISTANCE};
   bool added_{false}; // if the route added to HW or not
+  bool inHostTable_{false}; // if added to the host table rather than LPM
   opennsl_if_t egressId_{-1};
   void initL3RouteT(opennsl_l3_route_t* rt) const;
 };
@@ -90,6 +108,65 @@ class BcmRouteTable {
   void addRoute(opennsl_vrf_t vrf, const RouteT *route);
   template<typename RouteT>
   void deleteRoute(opennsl_vrf_t vrf, const RouteT *route);
+
+  /*
+   * Batched versions of addRoute()/deleteRoute() for programming many routes
+   * of one VRF at once, e.g. on a full FIB sync.
+   *
+   * addRoutes() first resolves every distinct next hop set in the batch to
+   * its ECMP/egress object, so the per-route writes that follow only take a
+   * reference on an existing egress. Newly created routes are merged into the
+   * table in a single pass rather than one sorted insert per route.
+   *
+   * With ALPM, the routes are written in address order, each covering prefix
+   * just ahead of the more specific ones under it, rather than in the order
+   * given. ALPM buckets group the routes under a pivot prefix, so this
+   * fills one bucket at a time instead of revisiting every bucket for each
+   * prefix length, which splits buckets that would otherwise stay whole.
+   *
+   * If programming an individual route fails, onError is called with the
+   * index of that route in the batch. If onError returns, the batch carries
+   * on with the next route; if it throws, the batch is aborted and the routes
+   * programmed so far are kept.
+   */
+  using RouteErrorFn = std::function<void(size_t index, const BcmError&)>;
+  template<typename RouteT>
+  void addRoutes(
+      opennsl_vrf_t vrf,
+      const std::vector<const RouteT*>& routes,
+      const RouteErrorFn& onError);
+  template<typename RouteT>
+  void deleteRoutes(
+      opennsl_vrf_t vrf,
+      const std::vector<const RouteT*>& routes);
+
+  // Whether the SDK keeps the routes in ALPM, see addRoutes()
+  void setAlpmEnabled(bool enabled) {
+    alpmEnabled_ = enabled;
+  }
+  // Route writes addRoutes() moved for ALPM so far
+  uint64_t numAlpmReorderedRoutes() const {
+    return alpmReorderedRoutes_;
+  }
+
+  /*
+   * Host routes go to the L3 host table, which is cheaper to look up and
+   * doesn't take LPM space, as long as it has room for them. Once the host
+   * table gets within --host_table_route_headroom_pct of its size, further
+   * host routes spill over to the route table instead, leaving the rest of
+   * the host table to the neighbor entries.
+   *
+   * hostRouteFits() tells whether a new host route goes to the host table.
+   * migrateSpilledHostRoutes() moves spilled routes back to the host table
+   * as room frees up; it is a no-op unless some route has spilled.
+   */
+  bool hostRouteFits() const;
+  void migrateSpilledHostRoutes();
+  // Host routes currently spilled to the route table
+  uint32_t numSpilledHostRoutes() const {
+    return numSpilledHostRoutes_;
+  }
+
   folly::dynamic toFollyDynamic() const;
  private:
   struct Key {
@@ -99,7 +176,22 @@ class BcmRouteTable {
     bool operator<(const Key& k2) const;
   };
 
+  // Deleting more than this many routes at once rebuilds the table instead
+  // of erasing routes one by one
+  static constexpr size_t kBulkDeleteThreshold = 64;
+
+  template<typename RouteT>
+  static Key makeKey(opennsl_vrf_t vrf, const RouteT* route);
+  template<typename RouteT>
+  static RouteNextHopEntry getNormalizedForwardInfo(const RouteT* route);
+  // Host table entries host routes may use, queried from the SDK once
+  uint32_t hostRouteCapacity() const;
+
   const BcmSwitch *hw_;
+  bool alpmEnabled_{false};
+  uint64_t alpmReorderedRoutes_{0};
+  uint32_t numSpilledHostRoutes_{0};
+  mutable uint32_t hostRouteCapacity_{0};
 
   boost::container::flat_map<Key, std::unique_ptr<BcmRoute>> fib_;
 };
@@ -10,6 +10,8 @@
 
 #include "fboss/agent/hw/bcm/BcmRtag7LoadBalancer.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/hw/bcm/BcmHost.h"
+#include "fboss/agent/hw/bcm/BcmPlatform.h"
 #include "fboss/agent/hw/bcm/BcmRtag7Module.h"
 #include "fboss/agent/state/LoadBalancer.h"
 
@@ -43,6 +45,8 @@ void BcmRtag7LoadBalancer::addLoadBalancer(
       break;
   }
 
+  programEcmpFlowlets(loadBalancer);
+
   auto module = std::make_unique<BcmRtag7Module>(moduleControl, offset, hw_);
   module->init(loadBalancer);
 
@@ -60,6 +64,10 @@ void BcmRtag7LoadBalancer::addLoadBalancer(
 
 void BcmRtag7LoadBalancer::deleteLoadBalancer(
     const std::shared_ptr<LoadBalancer>& loadBalancer) {
+  if (loadBalancer->getID() == LoadBalancerID::ECMP) {
+    hw_->writableHostTable()->setEcmpFlowletConfig(folly::none);
+  }
+
   auto numErased = rtag7Modules_.erase(loadBalancer->getID());
 
   if (numErased == 0) {
@@ -84,8 +92,31 @@ void BcmRtag7LoadBalancer::programLoadBalancer(
         ": no corresponding LoadBalancer");
   }
 
+  programEcmpFlowlets(newLoadBalancer);
   it->second->program(oldLoadBalancer, newLoadBalancer);
 }
 
+void BcmRtag7LoadBalancer::programEcmpFlowlets(
+    const std::shared_ptr<LoadBalancer>& loadBalancer) {
+  if (loadBalancer->getID() != LoadBalancerID::ECMP) {
+    return;
+  }
+
+  folly::Optional<BcmEcmpEgress::FlowletConfig> flowlet;
+  if (loadBalancer->getMode() == cfg::LoadBalancingMode::DYNAMIC_FLOWLET) {
+    if (!hw_->getPlatform()->isDynamicLoadBalancingSupported()) {
+      throw FbossError(
+          "failed to program LoadBalancer ",
+          loadBalancer->getID(),
+          ": dynamic load balancing is not supported on this platform");
+    }
+    programPortQualityMetrics();
+    flowlet = BcmEcmpEgress::FlowletConfig{
+        loadBalancer->getFlowletInactivityUsecs(),
+        loadBalancer->getFlowletTableSize()};
+  }
+  hw_->writableHostTable()->setEcmpFlowletConfig(flowlet);
+}
+
 } // namespace fboss
 } // namespace facebook
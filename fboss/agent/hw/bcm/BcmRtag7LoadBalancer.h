@@ -66,6 +66,15 @@ class BcmRtag7LoadBalancer {
 
   opennsl_switch_control_t trunkHashSet0UnicastOffset() const;
 
+  /*
+   * Dynamic load balancing is a property of the ECMP groups rather than of
+   * the RTAG7 modules: the ECMP LoadBalancer's mode is handed to the host
+   * table, which programs the ECMP groups accordingly.
+   */
+  void programEcmpFlowlets(const std::shared_ptr<LoadBalancer>& loadBalancer);
+  // Set up how the ASIC measures the load of the ECMP members
+  void programPortQualityMetrics();
+
   /*
    * The following table encodes the allocation scheme outlined above: each
    * module is dedicated to one LoadBalancer.
@@ -86,111 +86,85 @@ void BcmRtag7Module::programMacroFlowHashing(bool enable) {
   bcmCheckError(rv, "failed to ", enable, "program macro flow hashing");
 }
 
-void BcmRtag7Module::programPreprocessing(bool enable) {
-  auto rv = setUnitControl(moduleControl_.enablePreprocessing, enable);
-  bcmCheckError(
-      rv, "failed to enable pre-processing on module ", moduleControl_.module);
-}
-
-void BcmRtag7Module::programAlgorithm(cfg::HashingAlgorithm algorithm) {
-  int rv;
-  int arg;
-
+int BcmRtag7Module::computeAlgorithm(cfg::HashingAlgorithm algorithm) const {
   if (algorithm == cfg::HashingAlgorithm::CRC16_CCITT) {
-    arg = OPENNSL_HASH_FIELD_CONFIG_CRC16CCITT;
-  } else {
-    throw FbossError("Unrecognized HashingAlgorithm");
+    return OPENNSL_HASH_FIELD_CONFIG_CRC16CCITT;
   }
-
-  // Each block calculates two 16-bit hashes using two different functions. We
-  // currently do not leverage the second hash value so we set its function to
-  // be that of the first hash value (in effect wasting it).
-  rv = setUnitControl(moduleControl_.hashFunction1, arg);
-  bcmCheckError(
-      rv,
-      "failed to configure function ",
-      algorithm,
-      " on ",
-      moduleControl_.module,
-      "0");
-
-  rv = setUnitControl(moduleControl_.hashFunction2, arg);
-  bcmCheckError(
-      rv,
-      "failed to configure function ",
-      algorithm,
-      " on ",
-      moduleControl_.module,
-      "1");
+  throw FbossError("Unrecognized HashingAlgorithm");
 }
 
-void BcmRtag7Module::programOutputSelection() {
-  // Because both outputs are programmed with the same hashing algorithm (see
-  // BcmRtag7Modlue::programAlgorithm), it does not matter which output we
-  // use. For simplicity, the first output is always selected.
-  int rv = setUnitControl(offset_, moduleControl_.selectFirstOutput);
-  bcmCheckError(rv, "failed to select first output on ", moduleControl_.module);
-}
+BcmRtag7Module::ModuleState BcmRtag7Module::computeModuleState(
+    const LoadBalancer& loadBalancer) const {
+  ModuleState state;
 
-void BcmRtag7Module::programFieldSelection(
-    LoadBalancer::IPv4FieldsRange v4FieldsRange,
-    LoadBalancer::IPv6FieldsRange v6FieldsRange,
-    LoadBalancer::TransportFieldsRange transportFieldsRange) {
-  programIPv4FieldSelection(v4FieldsRange, transportFieldsRange);
-  programIPv6FieldSelection(v6FieldsRange, transportFieldsRange);
-}
+  // By unconditonally enabling preprocessing, we are keeping with old behavior
+  state[moduleControl_.enablePreprocessing] = kEnable;
 
-void BcmRtag7Module::programIPv4FieldSelection(
-    LoadBalancer::IPv4FieldsRange v4FieldsRange,
-    LoadBalancer::TransportFieldsRange transportFieldsRange) {
-  int arg = computeIPv4Subfields(v4FieldsRange);
-  arg |= computeTransportSubfields(transportFieldsRange);
+  state[moduleControl_.setSeed] = static_cast<int>(loadBalancer.getSeed());
 
   // TODO(samank): why do we set OPENNSL_HASH_FIELD_{SRC,DST}L4 here...
-  int rv = setUnitControl(moduleControl_.ipv4NonTcpUdpFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
+  auto transportSubfields =
+      computeTransportSubfields(loadBalancer.getTransportFields());
+  auto v4Subfields =
+      computeIPv4Subfields(loadBalancer.getIPv4Fields()) | transportSubfields;
+  auto v6Subfields =
+      computeIPv6Subfields(loadBalancer.getIPv6Fields()) | transportSubfields;
+
+  // We make no distinction between a TCP/UDP segment whose source port does
+  // not equal its destination port and one whose source port is equal to its
+  // destination port
+  state[moduleControl_.ipv4NonTcpUdpFieldSelection] = v4Subfields;
+  state[moduleControl_.ipv4TcpUdpPortsUnequalFieldSelection] = v4Subfields;
+  state[moduleControl_.ipv4TcpUdpPortsEqualFieldSelection] = v4Subfields;
+  state[moduleControl_.ipv6NonTcpUdpFieldSelection] = v6Subfields;
+  state[moduleControl_.ipv6TcpUdpPortsUnequalFieldSelection] = v6Subfields;
+  state[moduleControl_.ipv6TcpUdpPortsEqualFieldSelection] = v6Subfields;
+
+  // Each block calculates two 16-bit hashes using two different functions. We
+  // currently do not leverage the second hash value so we set its function to
+  // be that of the first hash value (in effect wasting it).
+  auto algorithm = computeAlgorithm(loadBalancer.getAlgorithm());
+  state[moduleControl_.hashFunction1] = algorithm;
+  state[moduleControl_.hashFunction2] = algorithm;
 
-  rv = setUnitControl(moduleControl_.ipv4TcpUdpPortsUnequalFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
+  // Because both outputs are programmed with the same hashing algorithm, it
+  // does not matter which output we use. For simplicity, the first output is
+  // always selected.
+  state[offset_] = moduleControl_.selectFirstOutput;
 
-  // We make no distinction between a TCP/UDP segment whose source port does not
-  // equal its destination port (the previous case) and one whose source port
-  // is equal to its destination port (this case)
-  rv = setUnitControl(moduleControl_.ipv4TcpUdpPortsEqualFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
+  return state;
 }
 
-void BcmRtag7Module::programIPv6FieldSelection(
-    LoadBalancer::IPv6FieldsRange v6FieldsRange,
-    LoadBalancer::TransportFieldsRange transportFieldsRange) {
-  auto it = std::find(
-      v6FieldsRange.begin(),
-      v6FieldsRange.end(),
-      LoadBalancer::IPv6Field::FLOW_LABEL);
-  if (it != v6FieldsRange.end()) {
-    enableFlowLabelSelection();
+void BcmRtag7Module::programModuleState(const ModuleState& state) {
+  for (const auto& control : state) {
+    auto it = programmedState_.find(control.first);
+    if (it != programmedState_.end() && it->second == control.second) {
+      continue;
+    }
+    auto rv = setUnitControl(control.first, control.second);
+    bcmCheckError(
+        rv,
+        "failed to assign ",
+        control.second,
+        " to ",
+        control.first,
+        " on module ",
+        moduleControl_.module);
+    programmedState_[control.first] = control.second;
   }
+}
 
-  int arg = computeIPv6Subfields(v6FieldsRange);
-  arg |= computeTransportSubfields(transportFieldsRange);
-
-  // TODO(samank): why do we set OPENNSL_HASH_FIELD_{SRC,DST}L4 here...
-  int rv = setUnitControl(moduleControl_.ipv6NonTcpUdpFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
-
-  rv = setUnitControl(moduleControl_.ipv6TcpUdpPortsUnequalFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
-
-  // We make no distinction between a TCP/UDP segment whose source port does not
-  // equal its destination port (the previous case) and one whose source port
-  // is equal to its destination port (this case)
-  rv = setUnitControl(moduleControl_.ipv6TcpUdpPortsEqualFieldSelection, arg);
-  bcmCheckError(rv, "failed to config field selection");
+bool BcmRtag7Module::hasFlowLabel(const LoadBalancer& loadBalancer) {
+  auto v6Fields = loadBalancer.getIPv6Fields();
+  return std::find(
+             v6Fields.begin(),
+             v6Fields.end(),
+             LoadBalancer::IPv6Field::FLOW_LABEL) != v6Fields.end();
 }
 
-void BcmRtag7Module::programSeed(uint32_t seed) {
-  auto rv = setUnitControl(moduleControl_.setSeed, static_cast<int>(seed));
-  bcmCheckError(rv, "failed to set seed on module ", moduleControl_.module);
+void BcmRtag7Module::programMacroFlowHashing(bool enable) {
+  auto rv = setUnitControl(opennslSwitchEcmpMacroFlowHashEnable, enable);
+  bcmCheckError(rv, "failed to ", enable, "program macro flow hashing");
 }
 
 void BcmRtag7Module::enableRtag7(LoadBalancerID loadBalancerID) {
@@ -209,19 +183,12 @@ void BcmRtag7Module::enableRtag7(LoadBalancerID loadBalancerID) {
 }
 
 void BcmRtag7Module::init(const std::shared_ptr<LoadBalancer>& loadBalancer) {
-  // By unconditonally enabling preprocessing, we are keeping with old behavior
-  programPreprocessing(kEnable);
-
-  programSeed(loadBalancer->getSeed());
-
-  programFieldSelection(
-      loadBalancer->getIPv4Fields(),
-      loadBalancer->getIPv6Fields(),
-      loadBalancer->getTransportFields());
-
-  programAlgorithm(loadBalancer->getAlgorithm());
+  if (hasFlowLabel(*loadBalancer)) {
+    enableFlowLabelSelection();
+  }
 
-  programOutputSelection();
+  programmedState_.clear();
+  programModuleState(computeModuleState(*loadBalancer));
 
   if (!fieldControlProgrammed_) {
     programFieldControl();
@@ -240,45 +207,13 @@ void BcmRtag7Module::init(const std::shared_ptr<LoadBalancer>& loadBalancer) {
 void BcmRtag7Module::program(
     const std::shared_ptr<LoadBalancer>& oldLoadBalancer,
     const std::shared_ptr<LoadBalancer>& newLoadBalancer) {
-  if (oldLoadBalancer->getSeed() != newLoadBalancer->getSeed()) {
-    programSeed(newLoadBalancer->getSeed());
-  }
-
-  bool sameIPv4Fields = std::equal(
-      oldLoadBalancer->getIPv4Fields().begin(),
-      oldLoadBalancer->getIPv4Fields().end(),
-      newLoadBalancer->getIPv4Fields().begin(),
-      newLoadBalancer->getIPv4Fields().end());
-  bool sameIPv6Fields = std::equal(
-      oldLoadBalancer->getIPv6Fields().begin(),
-      oldLoadBalancer->getIPv6Fields().end(),
-      newLoadBalancer->getIPv6Fields().begin(),
-      newLoadBalancer->getIPv6Fields().end());
-  bool sameTransportFields = std::equal(
-      oldLoadBalancer->getTransportFields().begin(),
-      oldLoadBalancer->getTransportFields().end(),
-      newLoadBalancer->getTransportFields().begin(),
-      newLoadBalancer->getTransportFields().end());
-
-  if (!sameIPv4Fields || !sameTransportFields) {
-    programIPv4FieldSelection(
-        newLoadBalancer->getIPv4Fields(),
-        newLoadBalancer->getTransportFields());
-  }
-
-  if (!sameIPv6Fields || !sameTransportFields) {
-    programIPv6FieldSelection(
-        newLoadBalancer->getIPv6Fields(),
-        newLoadBalancer->getTransportFields());
-  }
-
-  if (oldLoadBalancer->getAlgorithm() != newLoadBalancer->getAlgorithm()) {
-    programAlgorithm(newLoadBalancer->getAlgorithm());
+  if (hasFlowLabel(*newLoadBalancer) && !hasFlowLabel(*oldLoadBalancer)) {
+    enableFlowLabelSelection();
   }
 
-  // This is unnecessary because init() is always invoked before program()
-  // and will have already picked off the first output.
-  programOutputSelection();
+  // Only the switch controls whose values differ from what init() or the
+  // last program() wrote are touched
+  programModuleState(computeModuleState(*newLoadBalancer));
 }
 
 int BcmRtag7Module::computeIPv4Subfields(
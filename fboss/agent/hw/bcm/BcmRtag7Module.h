@@ -168,24 +168,23 @@ class BcmRtag7Module {
       const std::shared_ptr<LoadBalancer>& newLoadBalancer);
 
  private:
-  void programPreprocessing(bool enable);
-  void programAlgorithm(cfg::HashingAlgorithm algorithm);
-  void programOutputSelection();
-  void programFieldSelection(
-      LoadBalancer::IPv4FieldsRange v4FieldsRange,
-      LoadBalancer::IPv6FieldsRange v6FieldsRange,
-      LoadBalancer::TransportFieldsRange transportFieldsRange);
-  void programSeed(uint32_t seed);
+  /*
+   * The value of each switch control of the module needed to implement
+   * loadBalancer.
+   */
+  ModuleState computeModuleState(const LoadBalancer& loadBalancer) const;
+  /*
+   * Write the controls of state whose values differ from those last written
+   * by this module.
+   */
+  void programModuleState(const ModuleState& state);
+  static bool hasFlowLabel(const LoadBalancer& loadBalancer);
+
   void programMacroFlowHashing(bool enable);
   void enableRtag7(LoadBalancerID);
-  void programIPv4FieldSelection(
-      LoadBalancer::IPv4FieldsRange v4FieldsRange,
-      LoadBalancer::TransportFieldsRange transportFieldsRange);
-  void programIPv6FieldSelection(
-      LoadBalancer::IPv6FieldsRange v6FieldsRange,
-      LoadBalancer::TransportFieldsRange transportFieldsRange);
   void programFieldControl();
 
+  int computeAlgorithm(cfg::HashingAlgorithm algorithm) const;
   int computeIPv4Subfields(LoadBalancer::IPv4FieldsRange v4FieldsRange) const;
   int computeIPv6Subfields(LoadBalancer::IPv6FieldsRange v6FieldsRange) const;
   int computeTransportSubfields(
@@ -202,6 +201,8 @@ class BcmRtag7Module {
   ModuleControl moduleControl_;
   opennsl_switch_control_t offset_;
   const BcmSwitch* const hw_;
+  // The switch controls as last programmed by this module
+  ModuleState programmedState_;
 
   static bool fieldControlProgrammed_;
 };
@@ -44,6 +44,7 @@ BcmRxPacket::BcmRxPacket(const opennsl_pkt_t* pkt)
       reinterpret_cast<void*>(unit_)); // void* userData
 
   srcPort_ = PortID(pkt->src_port);
+  cos_ = pkt->cos;
   srcVlan_ = VlanID(pkt->vlan);
   len_ = length;
 }
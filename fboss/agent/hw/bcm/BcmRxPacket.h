@@ -24,13 +24,23 @@ class BcmRxPacket : public RxPacket {
    *
    * The rx callback should return OPENNSL_RX_HANDLED_OWNED after successful
    * creation of the BcmRxPacket.
+   *
+   * buf() points directly at the SDK rx buffer, without copying it. The
+   * buffer is handed back to the SDK once the IOBuf and all of its clones
+   * have been destroyed.
    */
   explicit BcmRxPacket(const opennsl_pkt_t* pkt);
 
   ~BcmRxPacket() override;
 
+  int cosQueue() const override {
+    return cos_;
+  }
+
  private:
   int unit_{-1};
+  // CPU CoS queue the packet was received on
+  int cos_{-1};
 };
 
 }} // facebook::fboss
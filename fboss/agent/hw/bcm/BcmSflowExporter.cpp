@@ -9,26 +9,82 @@
  */
 #include "BcmSflowExporter.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
 
 #include <fcntl.h>
 #include <ifaddrs.h>
+#include <sys/socket.h>
 
 #include <folly/Optional.h>
 #include <folly/Range.h>
+#include <folly/ThreadName.h>
 #include <folly/logging/xlog.h>
 #include <glog/logging.h>
 
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/FbossError.h"
 
+DEFINE_int32(
+    sflow_export_queue_size,
+    4096,
+    "Number of sFlow samples that can be waiting for export before new "
+    "samples are dropped");
+DEFINE_int32(
+    sflow_samples_per_datagram,
+    1,
+    "Pack up to this many sFlow samples into one SflowPacketInfoBatch "
+    "datagram. 1 sends every sample as its own SflowPacketInfo, which is "
+    "what existing collectors expect");
+DEFINE_bool(
+    sflow_v5,
+    false,
+    "Export samples as standard sFlow version 5 datagrams, along with "
+    "periodic counter samples, rather than as thrift SflowPacketInfo");
+DEFINE_int32(
+    sflow_header_bytes,
+    128,
+    "Number of bytes of each sampled packet to include in sFlow v5 samples");
+DEFINE_int32(
+    sflow_counter_interval_s,
+    20,
+    "How often to export sFlow v5 counter samples for every port");
+DEFINE_bool(
+    sflow_adaptive_rates,
+    false,
+    "Sample busy ports less often than configured when more sFlow samples "
+    "arrive than we can export");
+DEFINE_int32(
+    sflow_target_samples_per_sec,
+    2000,
+    "Number of sFlow samples a second adaptive rates aim to stay under");
+DEFINE_int32(
+    sflow_max_rate_multiplier,
+    64,
+    "The most adaptive rates will multiply a port's configured sampling "
+    "rates by");
+DEFINE_int32(
+    sflow_rate_adjust_interval_s,
+    5,
+    "How often adaptive rates reconsider the sampling rate of each port");
 
 using namespace std;
 
 namespace {
+// Keep batched datagrams under the largest UDP payload
+constexpr size_t kMaxDatagramBytes = 60000;
+constexpr size_t kMaxMsgsPerSendmmsg = 64;
+// sFlow v5 datagrams are kept under the path MTU, as collectors expect
+constexpr size_t kMaxV5DatagramBytes = 1400;
+
+const std::string kSamplesExported = "sflow.samples_exported";
+const std::string kSamplesDropped = "sflow.samples_dropped";
+
   folly::Optional<folly::IPAddress> getLocalIPv6FromWhoAmI() {
   const std::string whoAmIFn = "/etc/fbwhoami";
   const std::string key = "DEVICE_PRIMARY_IPV6";
@@ -188,26 +244,82 @@ ssize_t BcmSflowExporter::sendUDPDatagram(iovec* vec, const size_t iovec_len) {
   return ret;
 }
 
+size_t BcmSflowExporter::sendUDPDatagrams(
+    const std::vector<std::string>& datagrams) {
+  sockaddr_storage addrStorage;
+  address_.getAddress(&addrStorage);
+
+  size_t sent = 0;
+  while (sent < datagrams.size()) {
+    auto count = std::min(datagrams.size() - sent, kMaxMsgsPerSendmmsg);
+    iovec vecs[kMaxMsgsPerSendmmsg];
+    mmsghdr msgs[kMaxMsgsPerSendmmsg];
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (size_t i = 0; i < count; ++i) {
+      const auto& datagram = datagrams[sent + i];
+      vecs[i].iov_base = const_cast<char*>(datagram.data());
+      vecs[i].iov_len = datagram.size();
+      msgs[i].msg_hdr.msg_name = reinterpret_cast<void*>(&addrStorage);
+      msgs[i].msg_hdr.msg_namelen = address_.getActualSize();
+      msgs[i].msg_hdr.msg_iov = &vecs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    auto ret = ::sendmmsg(socket_, msgs, count, 0);
+    if (ret <= 0) {
+      XLOG(DBG1) << "Failed sending sFlow packets to " << address_.describe()
+                 << " reason: " << folly::errnoStr(errno);
+      break;
+    }
+    sent += ret;
+  }
+  XLOG(DBG4) << "Sent " << sent << " sFlow datagrams to "
+             << address_.describe();
+  return sent;
+}
+
 BcmSflowExporter::~BcmSflowExporter() {
   if (socket_ != -1) {
     close(socket_);
   }
 }
 
+BcmSflowExporterTable::BcmSflowExporterTable()
+    : rateController_(SflowRateController(
+          std::max(FLAGS_sflow_target_samples_per_sec, 1),
+          std::max(FLAGS_sflow_max_rate_multiplier, 1))),
+      lastRateAdjustment_(std::chrono::steady_clock::now()),
+      encoder_(kMaxV5DatagramBytes),
+      start_(std::chrono::steady_clock::now()),
+      lastCounterSamples_(start_) {
+  exportThread_ = std::thread([this]() {
+    folly::setThreadName("SflowExporter");
+    exportLoop();
+  });
+}
+
+BcmSflowExporterTable::~BcmSflowExporterTable() {
+  {
+    std::lock_guard<std::mutex> g(queueMutex_);
+    stopping_ = true;
+  }
+  queueCV_.notify_one();
+  exportThread_.join();
+}
+
 bool BcmSflowExporterTable::contains(
     const shared_ptr<SflowCollector>& c) const {
-  auto iter = map_.find(c->getID());
-  return iter != map_.end();
+  auto map = map_.rlock();
+  return map->find(c->getID()) != map->end();
 }
 
 size_t BcmSflowExporterTable::size() const {
-  return map_.size();
+  return map_.rlock()->size();
 }
 
 void BcmSflowExporterTable::addExporter(const shared_ptr<SflowCollector>& c) {
   try {
     auto exporter = make_unique<BcmSflowExporter>(c->getAddress());
-    map_.emplace(c->getID(), move(exporter));
+    map_.wlock()->emplace(c->getID(), move(exporter));
   } catch (const fboss::thrift::FbossBaseError& ex) {
     XLOG(ERR) << "Could not add exporter: "
               << c->getAddress().getFullyQualified()
@@ -221,50 +333,267 @@ void BcmSflowExporterTable::addExporter(const shared_ptr<SflowCollector>& c) {
 
 void BcmSflowExporterTable::removeExporter(const std::string& id) {
   XLOG(INFO) << "Removed sFlow exporter " << id;
-  map_.erase(id);
+  map_.wlock()->erase(id);
 }
 
 void BcmSflowExporterTable::updateSamplingRates(
     PortID id,
     int64_t inRate,
     int64_t outRate) {
-  std::pair<int64_t, int64_t> rates(inRate, outRate);
-  auto it = port2samplingRates_.find(id);
-  if (it != port2samplingRates_.end()) {
-    it->second = rates;
-  } else {
-    port2samplingRates_.insert(std::make_pair(id, rates));
-  }
+  rateController_.withWLock([&](auto& controller) {
+    controller.setConfiguredRates(id, inRate, outRate);
+    (*port2samplingRates_.wlock())[id] = std::make_pair(inRate, outRate);
+  });
 
   // We piggyback the update of local IPv6
-  localIP_ = getLocalIPv6();
+  auto localIP = getLocalIPv6();
+  *localIP_.wlock() = localIP;
+}
+
+SflowRateController::Rates BcmSflowExporterTable::getSamplingRates(
+    PortID id) const {
+  return rateController_.rlock()->getEffectiveRates(id);
+}
+
+bool BcmSflowExporterTable::samplingRateAdjustmentDue() {
+  if (!FLAGS_sflow_adaptive_rates) {
+    return false;
+  }
+  auto now = std::chrono::steady_clock::now();
+  return now - lastRateAdjustment_ >=
+      std::chrono::seconds(FLAGS_sflow_rate_adjust_interval_s);
+}
+
+SflowRateController::RateChanges
+BcmSflowExporterTable::adjustSamplingRates() {
+  boost::container::flat_map<PortID, uint64_t> seen;
+  uint64_t dropped;
+  {
+    std::lock_guard<std::mutex> g(queueMutex_);
+    seen.swap(samplesSeen_);
+    dropped = samplesDropped_;
+    samplesDropped_ = 0;
+  }
+  auto now = std::chrono::steady_clock::now();
+  auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now - lastRateAdjustment_);
+  lastRateAdjustment_ = now;
+
+  return rateController_.withWLock([&](auto& controller) {
+    auto changes = controller.update(seen, dropped, interval);
+    auto rates = port2samplingRates_.wlock();
+    for (const auto& change : changes) {
+      XLOG(DBG2) << "Sampling port " << change.first << " at "
+                 << change.second.ingress << "/" << change.second.egress;
+      (*rates)[change.first] =
+          std::make_pair(change.second.ingress, change.second.egress);
+    }
+    return changes;
+  });
 }
 
 void BcmSflowExporterTable::sendToAll(const SflowPacketInfo& info) {
-  if (map_.empty()) {
+  auto port = PortID(info.ingressSampled ? info.srcPort : info.dstPort);
+  // Record the rate the port is being sampled at now, as it may have
+  // changed by the time the sample is exported
+  int64_t rate = 0;
+  {
+    auto rates = port2samplingRates_.rlock();
+    auto it = rates->find(port);
+    if (it != rates->end()) {
+      rate = info.ingressSampled ? it->second.first : it->second.second;
+    }
+  }
+
+  bool wasEmpty;
+  {
+    std::unique_lock<std::mutex> g(queueMutex_);
+    ++samplesSeen_[port];
+    if (queue_.size() >= static_cast<size_t>(FLAGS_sflow_export_queue_size)) {
+      ++samplesDropped_;
+      g.unlock();
+      tcData().addStatValue(kSamplesDropped, 1, stats::SUM);
+      return;
+    }
+    wasEmpty = queue_.empty();
+    queue_.push_back(info);
+    queue_.back().samplingRate = rate;
+  }
+  // The export thread only waits on an empty queue
+  if (wasEmpty) {
+    queueCV_.notify_one();
+  }
+}
+
+bool BcmSflowExporterTable::counterSamplesDue() {
+  if (!FLAGS_sflow_v5 || size() == 0) {
+    return false;
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (now - lastCounterSamples_ <
+      std::chrono::seconds(FLAGS_sflow_counter_interval_s)) {
+    return false;
+  }
+  lastCounterSamples_ = now;
+  return true;
+}
+
+void BcmSflowExporterTable::sendCounters(
+    std::vector<SflowV5Encoder::InterfaceCounters> counters) {
+  bool wasEmpty;
+  {
+    std::lock_guard<std::mutex> g(queueMutex_);
+    wasEmpty = queue_.empty() && pendingCounters_.empty();
+    // A round that hasn't gone out yet is stale now anyway
+    pendingCounters_ = std::move(counters);
+  }
+  if (wasEmpty) {
+    queueCV_.notify_one();
+  }
+}
+
+void BcmSflowExporterTable::exportLoop() {
+  std::vector<SflowPacketInfo> samples;
+  std::vector<SflowV5Encoder::InterfaceCounters> counters;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> g(queueMutex_);
+      queueCV_.wait(g, [this]() {
+        return stopping_ || !queue_.empty() || !pendingCounters_.empty();
+      });
+      if (stopping_) {
+        return;
+      }
+      samples.swap(queue_);
+      counters.swap(pendingCounters_);
+    }
+    if (FLAGS_sflow_v5) {
+      exportV5(samples, counters);
+    } else if (!samples.empty()) {
+      exportSamples(samples);
+    }
+    samples.clear();
+    counters.clear();
+  }
+}
+
+void BcmSflowExporterTable::exportSamples(
+    std::vector<SflowPacketInfo>& samples) {
+  auto map = map_.rlock();
+  if (map->empty()) {
     XLOG(DBG1)
         << "zero sFlow collectors with sflow enabled, skipping sample export";
+    tcData().addStatValue(kSamplesDropped, samples.size(), stats::SUM);
     return;
   }
-  // Serialize info to a string and wrap it in an IOBuf for sending
-  string output;
-  apache::thrift::BinarySerializer::serialize(info, &output);
-  auto buf = folly::IOBuf::wrapBuffer(output.data(), output.length());
 
-  // Map the IOBuf to a Linux iovec like a champ
-  iovec vec[16] = {};
-  size_t iovec_len = buf->fillIov(vec, sizeof(vec) / sizeof(vec[0]));
-  if (UNLIKELY(iovec_len == 0)) {
-    buf->coalesce();
-    vec[0].iov_base = const_cast<uint8_t*>(buf->data());
-    vec[0].iov_len = buf->length();
-    iovec_len = 1;
+  std::vector<std::string> datagrams;
+  const size_t perDatagram = std::max(FLAGS_sflow_samples_per_datagram, 1);
+  if (perDatagram == 1) {
+    datagrams.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+      apache::thrift::BinarySerializer::serialize(samples[i], &datagrams[i]);
+    }
+  } else {
+    SflowPacketInfoBatch batch;
+    size_t batchBytes = 0;
+    auto flush = [&]() {
+      if (batch.samples.empty()) {
+        return;
+      }
+      datagrams.emplace_back();
+      apache::thrift::BinarySerializer::serialize(batch, &datagrams.back());
+      batch.samples.clear();
+      batchBytes = 0;
+    };
+    for (auto& sample : samples) {
+      auto sampleBytes = sample.packetData.size();
+      if (batch.samples.size() >= perDatagram ||
+          batchBytes + sampleBytes > kMaxDatagramBytes) {
+        flush();
+      }
+      batchBytes += sampleBytes;
+      batch.samples.push_back(std::move(sample));
+    }
+    flush();
   }
 
-  for (const auto& c: map_) {
-    // TODO: prob need to handle ret code?
-    c.second->sendUDPDatagram(vec, iovec_len);
+  // Each collector has its own socket, so it's one sendmmsg() per collector
+  // for the whole batch
+  size_t exported = 0;
+  for (const auto& c : *map) {
+    exported = std::max(exported, c.second->sendUDPDatagrams(datagrams));
+  }
+  if (exported == datagrams.size()) {
+    tcData().addStatValue(kSamplesExported, samples.size(), stats::SUM);
+  } else {
+    // Samples don't map back to datagrams exactly once batched, so just
+    // account for the datagrams that made it out to some collector
+    auto sentSamples = samples.size() * exported / datagrams.size();
+    tcData().addStatValue(kSamplesExported, sentSamples, stats::SUM);
+    tcData().addStatValue(
+        kSamplesDropped, samples.size() - sentSamples, stats::SUM);
+  }
+}
+
+void BcmSflowExporterTable::exportV5(
+    const std::vector<SflowPacketInfo>& samples,
+    const std::vector<SflowV5Encoder::InterfaceCounters>& counters) {
+  if (size() == 0) {
+    tcData().addStatValue(kSamplesDropped, samples.size(), stats::SUM);
+    return;
+  }
+  encoder_.setAgent(*localIP_.rlock());
+
+  // Any one sample has to fit in a datagram of its own
+  const size_t headerBytes = std::min(
+      static_cast<size_t>(std::max(FLAGS_sflow_header_bytes, 0)),
+      kMaxV5DatagramBytes - SflowV5Encoder::flowSampleSize(0) - 64);
+  for (const auto& info : samples) {
+    SflowV5Encoder::FlowSample sample;
+    auto port = PortID(info.ingressSampled ? info.srcPort : info.dstPort);
+    sample.sourceId = static_cast<uint16_t>(port);
+    sample.samplingRate = info.samplingRate;
+    sample.input = static_cast<uint16_t>(info.srcPort);
+    sample.output = static_cast<uint16_t>(info.dstPort);
+    sample.frameLength = info.packetData.size();
+    sample.header = folly::ByteRange(folly::StringPiece(info.packetData))
+                        .subpiece(0, headerBytes);
+    if (!encoder_.addFlowSample(sample)) {
+      sendV5Datagram();
+      encoder_.addFlowSample(sample);
+    }
+  }
+  for (const auto& counter : counters) {
+    if (!encoder_.addCounterSample(counter)) {
+      sendV5Datagram();
+      encoder_.addCounterSample(counter);
+    }
+  }
+  sendV5Datagram();
+}
+
+void BcmSflowExporterTable::sendV5Datagram() {
+  if (encoder_.numSamples() == 0) {
+    return;
+  }
+  auto uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_);
+  auto datagram = encoder_.finish(uptime.count());
+  iovec vec;
+  vec.iov_base = const_cast<uint8_t*>(datagram.data());
+  vec.iov_len = datagram.size();
+
+  bool sent = false;
+  for (const auto& c : *map_.rlock()) {
+    sent |= c.second->sendUDPDatagram(&vec, 1) > 0;
   }
+  // Counter samples are accounted for along with flow samples
+  tcData().addStatValue(
+      sent ? kSamplesExported : kSamplesDropped,
+      encoder_.numSamples(),
+      stats::SUM);
+  encoder_.reset();
 }
 
 } // namespace fboss
@@ -9,11 +9,20 @@
  */
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include <boost/container/flat_map.hpp>
 #include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
+#include <folly/Synchronized.h>
 
+#include "fboss/agent/SflowRateController.h"
+#include "fboss/agent/SflowV5Encoder.h"
 #include "fboss/agent/if/gen-cpp2/sflow_types.h"
 #include "fboss/agent/state/SflowCollector.h"
 #include "fboss/agent/types.h"
@@ -36,6 +45,12 @@ class BcmSflowExporter {
    */
   ssize_t sendUDPDatagram(iovec* vec, const size_t iovec_len);
 
+  /*
+   * Send each of the buffers as its own datagram, in as few sendmmsg() calls
+   * as the socket allows. Returns the number of datagrams sent.
+   */
+  size_t sendUDPDatagrams(const std::vector<std::string>& datagrams);
+
  private:
   // no copy or assignment
   BcmSflowExporter(BcmSflowExporter const &) = delete;
@@ -45,10 +60,25 @@ class BcmSflowExporter {
   int socket_{-1};
 };
 
+/*
+ * Samples are handed to sendToAll() from the packet RX path, which only
+ * queues them. Serialization and the sends to every collector happen on the
+ * table's own export thread, which drains everything queued since it last
+ * ran in one go, so a burst of samples costs one sendmmsg() per collector.
+ *
+ * With --sflow_v5 the samples are sent as standard sFlow version 5 flow
+ * samples instead, along with periodic counter samples for every port, so
+ * off the shelf collectors can consume them directly.
+ *
+ * With --sflow_adaptive_rates the table also decides the rates ports are
+ * actually sampled at, backing off busy ports when more samples arrive than
+ * we can export and going back to the configured rates once things calm
+ * down. See SflowRateController.
+ */
 class BcmSflowExporterTable {
   public:
-    BcmSflowExporterTable() = default;
-    ~BcmSflowExporterTable() = default;
+    BcmSflowExporterTable();
+    ~BcmSflowExporterTable();
 
     bool contains(const std::shared_ptr<SflowCollector>& collector) const;
     size_t size() const;
@@ -57,18 +87,76 @@ class BcmSflowExporterTable {
 
     void updateSamplingRates(PortID id, int64_t inRate, int64_t outRate);
 
+    // The rates the port should be sampled at right now
+    SflowRateController::Rates getSamplingRates(PortID id) const;
+
+    /*
+     * Whether it is time to reconsider the sampling rates, i.e. adaptive
+     * rates are enabled and --sflow_rate_adjust_interval_s has passed.
+     */
+    bool samplingRateAdjustmentDue();
+
+    /*
+     * Feed the samples seen since the last call to the rate controller and
+     * return the ports whose rates need to be reprogrammed.
+     */
+    SflowRateController::RateChanges adjustSamplingRates();
+
+    /*
+     * Queue a sample for export, dropping it if the export thread has
+     * fallen --sflow_export_queue_size samples behind.
+     */
     void sendToAll(const SflowPacketInfo& info);
+
+    /*
+     * Whether it is time to send another round of counter samples, i.e. we
+     * are exporting sFlow v5 to someone and --sflow_counter_interval_s has
+     * passed since the last round.
+     */
+    bool counterSamplesDue();
+
+    // Queue a round of counter samples, one per port, for export
+    void sendCounters(std::vector<SflowV5Encoder::InterfaceCounters> counters);
   private:
     // no copy or assignment
     BcmSflowExporterTable(BcmSflowExporterTable const &) = delete;
     BcmSflowExporterTable& operator=(BcmSflowExporterTable const &) = delete;
 
-    std::unordered_map<std::string, std::unique_ptr<BcmSflowExporter>> map_;
-    std::unordered_map<
+    void exportLoop();
+    void exportSamples(std::vector<SflowPacketInfo>& samples);
+    void exportV5(
+        const std::vector<SflowPacketInfo>& samples,
+        const std::vector<SflowV5Encoder::InterfaceCounters>& counters);
+    void sendV5Datagram();
+
+    using ExporterMap =
+        std::unordered_map<std::string, std::unique_ptr<BcmSflowExporter>>;
+    // Written by the update thread, read by the export thread
+    folly::Synchronized<ExporterMap> map_;
+    // Written by the update thread, read by the export thread
+    folly::Synchronized<std::unordered_map<
         PortID,
-        std::pair<int64_t /* ingress rate */, int64_t /* egress rate */>>
+        std::pair<int64_t /* ingress rate */, int64_t /* egress rate */>>>
         port2samplingRates_;
-    folly::IPAddress localIP_;
+    folly::Synchronized<folly::IPAddress> localIP_;
+    folly::Synchronized<SflowRateController> rateController_;
+    std::chrono::steady_clock::time_point lastRateAdjustment_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueCV_;
+    std::vector<SflowPacketInfo> queue_;
+    std::vector<SflowV5Encoder::InterfaceCounters> pendingCounters_;
+    // Samples seen and dropped per port since the last rate adjustment
+    boost::container::flat_map<PortID, uint64_t> samplesSeen_;
+    uint64_t samplesDropped_{0};
+    bool stopping_{false};
+    std::thread exportThread_;
+
+    // Only used by the export thread, so the datagram buffer is allocated
+    // once and reused for every datagram sent
+    SflowV5Encoder encoder_;
+    const std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point lastCounterSamples_;
 };
 
 } // namespace fboss
@@ -13,6 +13,15 @@
 #include "fboss/agent/hw/bcm/BcmAddressFBConvertors.h"
 
 #include <boost/container/flat_map.hpp>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+DEFINE_int32(acl_stat_idle_polls, 10,
+    "Number of polls an acl stat has to go unchanged before it is "
+    "considered idle and polled less often");
+DEFINE_int32(acl_stat_idle_poll_interval, 10,
+    "Idle acl stats are only read once every this many polls");
 
 namespace facebook { namespace fboss {
 
@@ -41,7 +50,7 @@ void BcmStatUpdater::toBeAddedAclStat(
     const std::vector<cfg::CounterType>& counterTypes) {
   for (auto type : counterTypes) {
     std::string counterName = name + "." + counterTypeToString(type);
-    toBeAddedAclStats_.emplace(counterName, AclCounterDescriptor(handle, type));
+    toBeAddedAclStats_.emplace(counterName, handle, type);
   }
 }
 
@@ -62,13 +71,28 @@ void BcmStatUpdater::updateStats() {
 void BcmStatUpdater::updateAclStats() {
   auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
   auto lockedAclStats = aclStats_.wlock();
+  std::vector<uint64_t> values;
   for (auto& entry : *lockedAclStats) {
-    updateAclStat(
-        hw_->getUnit(),
-        entry.first.handle,
-        entry.first.counterType,
-        now,
-        entry.second.get());
+    auto& stat = entry.second;
+    // Counters that haven't moved in a while are likely not to move on this
+    // poll either, so save ourselves most of the SDK calls for them
+    if (stat.unchangedPolls >= FLAGS_acl_stat_idle_polls &&
+        ++stat.skippedPolls < FLAGS_acl_stat_idle_poll_interval) {
+      continue;
+    }
+    stat.skippedPolls = 0;
+    if (!readAclStat(hw_->getUnit(), entry.first, stat.types, &values)) {
+      continue;
+    }
+    if (values == stat.lastValues) {
+      ++stat.unchangedPolls;
+    } else {
+      stat.unchangedPolls = 0;
+      stat.lastValues = values;
+    }
+    for (size_t i = 0; i < stat.counters.size(); ++i) {
+      stat.counters[i]->updateValue(now, values[i]);
+    }
   }
 }
 
@@ -77,14 +101,26 @@ void BcmStatUpdater::updateHwTableStats() {
 }
 
 size_t BcmStatUpdater::getCounterCount() const {
-  return aclStats_.rlock()->size();
+  auto lockedAclStats = aclStats_.rlock();
+  size_t count = 0;
+  for (const auto& entry : *lockedAclStats) {
+    count += entry.second.counters.size();
+  }
+  return count;
 }
 
 MonotonicCounter* FOLLY_NULLABLE
 BcmStatUpdater::getCounterIf(BcmAclStatHandle handle, cfg::CounterType type) {
   auto lockedAclStats = aclStats_.rlock();
-  auto iter = lockedAclStats->find(AclCounterDescriptor(handle, type));
-  return iter != lockedAclStats->end() ? iter->second.get() : nullptr;
+  auto iter = lockedAclStats->find(handle);
+  if (iter == lockedAclStats->end()) {
+    return nullptr;
+  }
+  const auto& types = iter->second.types;
+  auto typeIter = std::find(types.begin(), types.end(), type);
+  return typeIter != types.end()
+      ? iter->second.counters[typeIter - types.begin()].get()
+      : nullptr;
 }
 
 void BcmStatUpdater::clearPortStats(
@@ -103,6 +139,10 @@ void BcmStatUpdater::clearPortStats(
 void BcmStatUpdater::refreshHwTableStats(const StateDelta& delta) {
   auto stats = tableStats_.wlock();
   bcmTableStatsManager_->refresh(delta, &(*stats));
+  bcmTableStatsManager_->refreshEcmpSharingStats(&(*stats));
+  bcmTableStatsManager_->refreshAclCompilerStats(&(*stats));
+  bcmTableStatsManager_->refreshAlpmRouteStats(&(*stats));
+  bcmTableStatsManager_->refreshHostRouteStats(&(*stats));
 }
 
 void BcmStatUpdater::refreshAclStats() {
@@ -113,31 +153,26 @@ void BcmStatUpdater::refreshAclStats() {
   auto lockedAclStats = aclStats_.wlock();
 
   while (!toBeRemovedAclStats_.empty()) {
-    BcmAclStatHandle handle = toBeRemovedAclStats_.front();
-    auto itr = lockedAclStats->begin();
-    while (itr != lockedAclStats->end()) {
-      if (itr->first.handle == handle) {
-        lockedAclStats->erase(itr++);
-      } else {
-        ++itr;
-      }
-    }
+    lockedAclStats->erase(toBeRemovedAclStats_.front());
     toBeRemovedAclStats_.pop();
   }
 
   while (!toBeAddedAclStats_.empty()) {
-    const std::string& name = toBeAddedAclStats_.front().first;
-    auto aclCounterDescriptor = toBeAddedAclStats_.front().second;
-    auto inserted = lockedAclStats->emplace(
-        aclCounterDescriptor,
-        std::make_unique<MonotonicCounter>(name, stats::SUM, stats::RATE));
-    if (!inserted.second) {
+    const std::string& name = std::get<0>(toBeAddedAclStats_.front());
+    auto handle = std::get<1>(toBeAddedAclStats_.front());
+    auto type = std::get<2>(toBeAddedAclStats_.front());
+    auto& stat = (*lockedAclStats)[handle];
+    if (std::find(stat.types.begin(), stat.types.end(), type) !=
+        stat.types.end()) {
       throw FbossError(
-          "Duplicate ACL stat handle, handle=",
-          aclCounterDescriptor.handle,
-          ", name=",
-          name);
+          "Duplicate ACL stat handle, handle=", handle, ", name=", name);
     }
+    stat.types.push_back(type);
+    stat.counters.push_back(
+        std::make_unique<MonotonicCounter>(name, stats::SUM, stats::RATE));
+    // Start polling the stat at full rate again
+    stat.lastValues.clear();
+    stat.unchangedPolls = 0;
     toBeAddedAclStats_.pop();
   }
 }
@@ -14,7 +14,10 @@
 #include "fboss/agent/hw/bcm/types.h"
 #include "fboss/agent/types.h"
 
+#include <map>
 #include <queue>
+#include <tuple>
+#include <vector>
 #include <folly/Synchronized.h>
 #include <boost/container/flat_map.hpp>
 
@@ -70,12 +73,15 @@ class BcmStatUpdater {
   }
 
  private:
-  void updateAclStat(
+  /*
+   * Read all the counters of an acl stat with one SDK call, in the order of
+   * types. Returns false if they couldn't be read.
+   */
+  bool readAclStat(
       int unit,
       BcmAclStatHandle handle,
-      cfg::CounterType counterType,
-      std::chrono::seconds now,
-      MonotonicCounter* counter);
+      const std::vector<cfg::CounterType>& types,
+      std::vector<uint64_t>* values);
 
   std::string counterTypeToString(cfg::CounterType type);
 
@@ -88,21 +94,21 @@ class BcmStatUpdater {
   std::unique_ptr<BcmHwTableStatManager> bcmTableStatsManager_;
 
   /* ACL stats */
-  struct AclCounterDescriptor {
-    AclCounterDescriptor(BcmAclStatHandle hdl, cfg::CounterType type)
-        : handle(hdl), counterType(type) {}
-    bool operator<(const AclCounterDescriptor& d) const {
-      return std::tie(handle, counterType) < std::tie(d.handle, d.counterType);
-    }
-    BcmAclStatHandle handle;
-    cfg::CounterType counterType;
+  struct AclStatCounters {
+    std::vector<cfg::CounterType> types;
+    // In the order of types
+    std::vector<std::unique_ptr<MonotonicCounter>> counters;
+    std::vector<uint64_t> lastValues;
+    // Consecutive polls that found all the counters unchanged
+    uint32_t unchangedPolls{0};
+    // Polls skipped since the stat went idle and was last read
+    uint32_t skippedPolls{0};
   };
   folly::Synchronized<BcmHwTableStats> tableStats_;
   std::queue<BcmAclStatHandle> toBeRemovedAclStats_;
-  std::queue<std::pair<std::string, AclCounterDescriptor>> toBeAddedAclStats_;
-  folly::Synchronized<
-      std::map<AclCounterDescriptor, std::unique_ptr<MonotonicCounter>>>
-      aclStats_;
+  std::queue<std::tuple<std::string, BcmAclStatHandle, cfg::CounterType>>
+      toBeAddedAclStats_;
+  folly::Synchronized<std::map<BcmAclStatHandle, AclStatCounters>> aclStats_;
 };
 
 }} // facebook::fboss
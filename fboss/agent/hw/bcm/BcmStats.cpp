@@ -12,12 +12,15 @@
 #include "fboss/agent/SwitchStats.h"
 #include "common/stats/ExportedStatMapImpl.h"
 
+#include <folly/Conv.h>
+
 using facebook::stats::SUM;
 using facebook::stats::RATE;
 
 namespace facebook { namespace fboss {
 
 folly::ThreadLocalPtr<BcmStats> BcmStats::stats_;
+constexpr uint8_t BcmStats::kNumTxCos;
 
 BcmStats::BcmStats()
     : BcmStats(stats::ThreadCachedServiceData::get()->getThreadStats()) {
@@ -28,6 +31,8 @@ BcmStats::BcmStats(ThreadLocalStatsMap *map)
                   SUM, RATE),
       txPktFree_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.freed",
                  SUM, RATE),
+      txPktReused_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.reused",
+                   SUM, RATE),
       txSent_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.sent",
               SUM, RATE),
       txSentDone_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.sent.done",
@@ -36,6 +41,8 @@ BcmStats::BcmStats(ThreadLocalStatsMap *map)
                   SUM, RATE),
       txPktAllocErrors_(map, SwitchStats::kCounterPrefix +
           "bcm.tx.pkt.allocation.errors", SUM, RATE),
+      txPktBackpressured_(map, SwitchStats::kCounterPrefix +
+          "bcm.tx.pkt.backpressured", SUM, RATE),
       txQueued_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.queued_us",
                 100, 0, 1000),
       parityErrors_(map, SwitchStats::kCounterPrefix + "bcm.parity.errors",
@@ -46,7 +53,29 @@ BcmStats::BcmStats(ThreadLocalStatsMap *map)
                           "bcm.parity.uncorr", SUM, RATE),
       asicErrors_(map, SwitchStats::kCounterPrefix +
                   "bcm.asic.error", SUM, RATE),
-      activeMirrors_(map, SwitchStats::kCounterPrefix + "bcm.mirrors.count") {
+      activeMirrors_(map, SwitchStats::kCounterPrefix + "bcm.mirrors.count"),
+      routesProgrammed_(map, SwitchStats::kCounterPrefix +
+                        "bcm.route.programmed", SUM, RATE),
+      routesDeleted_(map, SwitchStats::kCounterPrefix +
+                     "bcm.route.deleted", SUM, RATE),
+      routeBatchProgramming_(map, SwitchStats::kCounterPrefix +
+                             "bcm.route.batch_programming_us",
+                             1000, 0, 100000),
+      ecmpGroupsShrunk_(map, SwitchStats::kCounterPrefix +
+                        "bcm.ecmp.groups_shrunk", SUM, RATE),
+      ecmpShrink_(map, SwitchStats::kCounterPrefix + "bcm.ecmp.shrink_us",
+                  100, 0, 10000),
+      ecmpReplicatedPaths_(map, SwitchStats::kCounterPrefix +
+                           "bcm.ecmp.replicated_paths", 8, 0, 256) {
+  for (int cos = 0; cos < kNumTxCos; ++cos) {
+    txQueuedByCos_.push_back(std::make_unique<TLHistogram>(
+        map,
+        folly::to<std::string>(
+            SwitchStats::kCounterPrefix, "bcm.tx.pkt.queued_us.cos", cos),
+        100,
+        0,
+        1000));
+  }
 }
 
 BcmStats* BcmStats::createThreadStats() {
@@ -12,10 +12,22 @@
 #include "common/stats/ThreadCachedServiceData.h"
 #include <folly/ThreadLocal.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
 class BcmStats {
  public:
+  // TX CoS values with a queuing time histogram of their own, the higher
+  // ones share the last
+  static constexpr uint8_t kNumTxCos = 8;
+
+  static uint8_t txCosIndex(uint8_t cos) {
+    return std::min<uint8_t>(cos, kNumTxCos - 1);
+  }
+
   BcmStats();
 
   /**
@@ -38,12 +50,16 @@ class BcmStats {
   void txPktFree() {
     txPktFree_.addValue(1);
   }
+  void txPktReused() {
+    txPktReused_.addValue(1);
+  }
   void txSent() {
     txSent_.addValue(1);
   }
-  void txSentDone(uint64_t q) {
+  void txSentDone(uint64_t q, uint8_t cos) {
     txSentDone_.addValue(1);
     txQueued_.addValue(q);
+    txQueuedByCos_[txCosIndex(cos)]->addValue(q);
   }
   void txError() {
     txErrors_.addValue(1);
@@ -52,6 +68,9 @@ class BcmStats {
     txErrors_.addValue(1);
     txPktAllocErrors_.addValue(1);
   }
+  void txPktBackpressured(uint64_t numPkts) {
+    txPktBackpressured_.addValue(numPkts);
+  }
 
   void corrParityError() {
     parityErrors_.addValue(1);
@@ -75,6 +94,24 @@ class BcmStats {
     activeMirrors_.incrementValue(-1);
   }
 
+  void routesProgrammed(uint64_t count, uint64_t usecs) {
+    routesProgrammed_.addValue(count);
+    routeBatchProgramming_.addValue(usecs);
+  }
+
+  void routesDeleted(uint64_t count) {
+    routesDeleted_.addValue(count);
+  }
+
+  void ecmpEgressCreated(uint64_t replicatedPaths) {
+    ecmpReplicatedPaths_.addValue(replicatedPaths);
+  }
+
+  void ecmpShrunk(uint64_t groups, uint64_t usecs) {
+    ecmpGroupsShrunk_.addValue(groups);
+    ecmpShrink_.addValue(usecs);
+  }
+
  private:
   // Forbidden copy constructor and assignment operator
   BcmStats(BcmStats const &) = delete;
@@ -94,14 +131,20 @@ class BcmStats {
   // Total number of Tx packet allocated right now
   TLTimeseries txPktAlloc_;
   TLTimeseries txPktFree_;
+  // Tx packets allocated from the BcmTxPacketPool rather than the SDK
+  TLTimeseries txPktReused_;
   TLTimeseries txSent_;
   TLTimeseries txSentDone_;
   // Errors in sending packets
   TLTimeseries txErrors_;
   TLTimeseries txPktAllocErrors_;
 
-  // Time spent for each Tx packet queued in HW
+  // Tx packets refused as too many of their CoS were in flight
+  TLTimeseries txPktBackpressured_;
+
+  // Time spent for each Tx packet queued in HW, overall and per CoS
   TLHistogram txQueued_;
+  std::vector<std::unique_ptr<TLHistogram>> txQueuedByCos_;
 
   // parity errors
   TLTimeseries parityErrors_;
@@ -114,6 +157,19 @@ class BcmStats {
   // Number of active mirrors
   TLCounter activeMirrors_;
 
+  // Routes written to/removed from the HW, the rate gives routes/sec
+  TLTimeseries routesProgrammed_;
+  TLTimeseries routesDeleted_;
+  // Time spent programming each batch of routes
+  TLHistogram routeBatchProgramming_;
+
+  // ECMP groups shrunk on link down or neighbor loss, and the time taken to
+  // shrink all the groups affected by each event
+  TLTimeseries ecmpGroupsShrunk_;
+  TLHistogram ecmpShrink_;
+  // Members replicated to implement weights, for each ECMP group created
+  TLHistogram ecmpReplicatedPaths_;
+
   static folly::ThreadLocalPtr<BcmStats> stats_;
 };
 
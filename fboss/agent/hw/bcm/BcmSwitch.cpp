@@ -9,28 +9,45 @@
  */
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 
+#include <algorithm>
+#include <ctime>
+#include <iterator>
+
 #include <boost/cast.hpp>
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <folly/Conv.h>
 #include <folly/FileUtil.h>
 #include <folly/Memory.h>
+#include <folly/IPAddress.h>
 #include <folly/Optional.h>
+#include <folly/String.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/Constants.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/FibCompressor.h"
+#include "fboss/agent/LatencyQuantiles.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/hw/BufferStatsLogger.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
+#include "fboss/agent/hw/StateChangeSections.h"
 #include "fboss/agent/hw/bcm/BcmAPI.h"
 #include "fboss/agent/hw/bcm/BcmAclTable.h"
 #include "fboss/agent/hw/bcm/BcmCosManager.h"
 #include "fboss/agent/hw/bcm/BcmControlPlane.h"
 #include "fboss/agent/hw/bcm/BcmCosManager.h"
+#include "fboss/agent/hw/bcm/BcmEcmpBalanceMonitor.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmHashTracer.h"
 #include "fboss/agent/hw/bcm/BcmHost.h"
 #include "fboss/agent/hw/bcm/BcmHostKey.h"
 #include "fboss/agent/hw/bcm/BcmIntf.h"
+#include "fboss/agent/hw/bcm/BcmMicroburstMonitor.h"
 #include "fboss/agent/hw/bcm/BcmMirrorTable.h"
 #include "fboss/agent/hw/bcm/BcmPlatform.h"
 #include "fboss/agent/hw/bcm/BcmPort.h"
@@ -46,10 +63,12 @@
 #include "fboss/agent/hw/bcm/BcmTableStats.h"
 #include "fboss/agent/hw/bcm/BcmTrunkTable.h"
 #include "fboss/agent/hw/bcm/BcmTxPacket.h"
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
 #include "fboss/agent/hw/bcm/BcmUnit.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootHelper.h"
 #include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
 #include "fboss/agent/state/AggregatePort.h"
 #include "fboss/agent/state/ArpEntry.h"
 #include "fboss/agent/state/DeltaFunctions.h"
@@ -78,6 +97,7 @@
 #include "fboss/agent/types.h"
 
 extern "C" {
+#include <opennsl/l3.h>
 #include <opennsl/link.h>
 #include <opennsl/port.h>
 #include <opennsl/stg.h>
@@ -109,6 +129,27 @@ DEFINE_bool(flexports, false,
 DEFINE_bool(enable_fine_grained_buffer_stats, false,
             "Enable fine grained buffer stats collection by default");
 DEFINE_bool(force_init_fp, true, "Force full field processor initialization");
+DEFINE_int32(warm_boot_clear_batch_size, 1024,
+             "How many stale routes and host entries to remove from the h/w "
+             "at a time after a warm boot, between state updates");
+DEFINE_int32(microburst_sample_interval_us, 0,
+             "How often to sample queue buffer occupancy for microburst "
+             "detection, 0 to disable");
+DEFINE_string(hw_call_recording, "",
+              "Record the route, host, egress, ECMP, ACL and port programming "
+              "calls into this file, for hw_call_replay");
+DEFINE_int32(bcm_state_change_threads, 0,
+             "Threads running the sections of a state change which program "
+             "separate tables, such as routes, ACLs and sFlow collectors, "
+             "concurrently. 0 runs them one after the other");
+DEFINE_bool(fib_compression, false,
+            "Program each vrf's routes as a smaller set of entries that "
+            "forwards the same way, merging sibling prefixes and leaving out "
+            "routes their covering route already forwards the same way");
+DEFINE_string(critical_route_prefixes, "0.0.0.0/0,::/0",
+              "Comma separated routes, e.g. the default routes and those to "
+              "infrastructure prefixes, which a state change programs before "
+              "its other routes, publishing when they are done");
 
 enum : uint8_t {
   kRxCallbackPriority = 1,
@@ -116,7 +157,24 @@ enum : uint8_t {
 
 namespace {
 constexpr auto kHostTable = "hostTable";
+
+// Run fn, recording how long it took as the init phase called name
+template <typename Fn>
+void timeInitPhase(HwInitResult* ret, folly::StringPiece name, Fn fn) {
+  auto begin = steady_clock::now();
+  fn();
+  ret->initPhaseTimes.emplace_back(
+      folly::to<std::string>("bcm_init.", name),
+      duration_cast<duration<float>>(steady_clock::now() - begin).count());
+}
+
 constexpr int kLogBcmErrorFreqMs = 3000;
+constexpr auto kAclTcamWrites = "acl_tcam_writes";
+constexpr auto kWarmBootStaleEntries = "warm_boot.stale_entries";
+constexpr auto kWarmBootStaleEntriesRemoved =
+    "warm_boot.stale_entries_removed";
+constexpr auto kCriticalRoutesProgrammed =
+    "route_program.critical_routes_programmed";
 /*
  * Dump map containing switch h/w config as a key, value pair
  * to a file. Create parent directories of file if needed.
@@ -162,6 +220,7 @@ BcmSwitch::BcmSwitch(
       fineGrainedBufferStatsEnabled_(FLAGS_enable_fine_grained_buffer_stats),
       mmuBufferBytes_(platform->getMMUBufferBytes()),
       mmuCellBytes_(platform->getMMUCellBytes()),
+      routeProgramLatency_(new LatencyQuantiles("route_program.latency.us")),
       warmBootCache_(new BcmWarmBootCache(this)),
       portTable_(new BcmPortTable(this)),
       intfTable_(new BcmIntfTable(this)),
@@ -172,9 +231,28 @@ BcmSwitch::BcmSwitch(
       trunkTable_(new BcmTrunkTable(this)),
       sFlowExporterTable_(new BcmSflowExporterTable()),
       rtag7LoadBalancer_(new BcmRtag7LoadBalancer(this)),
-      mirrorTable_(new BcmMirrorTable(this)) {
+      mirrorTable_(new BcmMirrorTable(this)),
+      microburstMonitor_(new BcmMicroburstMonitor(this)),
+      ecmpBalanceMonitor_(new BcmEcmpBalanceMonitor(this)),
+      hashTracer_(new BcmHashTracer(this)) {
   dumpConfigMap(BcmAPI::getHwConfig(), platform->getHwConfigDumpFile());
   exportSdkVersion();
+  if (FLAGS_bcm_state_change_threads > 0) {
+    stateChangeExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        FLAGS_bcm_state_change_threads,
+        std::make_shared<folly::NamedThreadFactory>("BcmStateChange"));
+  }
+  std::vector<folly::StringPiece> prefixes;
+  folly::split(',', FLAGS_critical_route_prefixes, prefixes, true);
+  for (auto prefix : prefixes) {
+    auto network =
+        folly::IPAddress::createNetwork(folly::trimWhitespace(prefix));
+    if (network.first.isV4()) {
+      criticalRoutesV4_.insert({network.first.asV4(), network.second});
+    } else {
+      criticalRoutesV6_.insert({network.first.asV6(), network.second});
+    }
+  }
 }
 
 BcmSwitch::BcmSwitch(
@@ -188,6 +266,9 @@ BcmSwitch::BcmSwitch(
 
 BcmSwitch::~BcmSwitch() {
   XLOG(ERR) << "Destroying BcmSwitch";
+  if (!FLAGS_hw_call_recording.empty()) {
+    HwCallRecorder::get()->stop();
+  }
 }
 
 void BcmSwitch::resetTablesImpl(std::unique_lock<std::mutex>& /*lock*/) {
@@ -223,6 +304,7 @@ unique_ptr<BcmUnit> BcmSwitch::releaseUnit() {
   // to make sure they clean up their state now before we reset unit_.
   BcmSwitchEventUtils::resetUnit(unit_);
   resetTablesImpl(lk);
+  BcmTxPacketPool::get()->stop(unit_);
   // We don't maintain a BcmVlan data structure, so the
   // vlans need to be destroyed explicity
   auto rv = opennsl_vlan_destroy_all(unit_);
@@ -244,6 +326,9 @@ void BcmSwitch::initTables(const folly::dynamic& warmBootState) {
   intfTable_ = std::make_unique<BcmIntfTable>(this);
   hostTable_ = std::make_unique<BcmHostTable>(this);
   routeTable_ = std::make_unique<BcmRouteTable>(this);
+  routeTable_->setAlpmEnabled(isAlpmEnabled());
+  compressedFibsV4_.clear();
+  compressedFibsV6_.clear();
   aclTable_ = std::make_unique<BcmAclTable>(this);
   trunkTable_ = std::make_unique<BcmTrunkTable>(this);
   sFlowExporterTable_ = std::make_unique<BcmSflowExporterTable>();
@@ -269,6 +354,7 @@ void BcmSwitch::initTables(const folly::dynamic& warmBootState) {
 }
 
 void BcmSwitch::unregisterCallbacks() {
+  microburstMonitor_->stop();
   if (flags_ & RX_REGISTERED) {
     opennsl_rx_stop(unit_, nullptr);
     auto rv = opennsl_rx_unregister(unit_, packetRxCallback,
@@ -298,6 +384,7 @@ void BcmSwitch::gracefulExit(folly::dynamic& switchState) {
   // SwSwitch, but it does not really matter at the graceful exit time. If
   // this is a concern, this can be moved to the updateEventBase_ of SwSwitch.
   portTable_->preparePortsForGracefulExit();
+  microburstMonitor_->stop();
   if (isBufferStatCollectionEnabled()) {
     stopBufferStatCollection();
   }
@@ -322,8 +409,26 @@ folly::dynamic BcmSwitch::toFollyDynamic() const {
 }
 
 void BcmSwitch::clearWarmBootCache() {
+  // There can be as many stale routes and host entries as the h/w tables
+  // hold. Remove them a batch at a time, releasing lock_ in between, so
+  // state updates aren't held up until all of them are gone.
+  auto batchSize = std::max(FLAGS_warm_boot_clear_batch_size, 1);
+  bool more = true;
+  while (more) {
+    std::lock_guard<std::mutex> g(lock_);
+    more = warmBootCache_->clearSome(batchSize);
+    publishWarmBootClearProgress();
+  }
   std::lock_guard<std::mutex> g(lock_);
   warmBootCache_->clear();
+  publishWarmBootClearProgress();
+}
+
+void BcmSwitch::publishWarmBootClearProgress() const {
+  tcData().setCounter(
+      kWarmBootStaleEntries, warmBootCache_->numStaleEntries());
+  tcData().setCounter(
+      kWarmBootStaleEntriesRemoved, warmBootCache_->numStaleEntriesRemoved());
 }
 
 bool BcmSwitch::isPortUp(PortID port) const {
@@ -418,6 +523,9 @@ HwInitResult BcmSwitch::init(Callback* callback) {
   std::lock_guard<std::mutex> g(lock_);
 
   steady_clock::time_point begin = steady_clock::now();
+  if (!FLAGS_hw_call_recording.empty()) {
+    HwCallRecorder::get()->start(FLAGS_hw_call_recording);
+  }
   if (!unitObject_) {
     unitObject_ = BcmAPI::initOnlyUnit(platform_);
   }
@@ -431,7 +539,7 @@ HwInitResult BcmSwitch::init(Callback* callback) {
   callback_ = callback;
 
   // Possibly run pre-init bcm shell script before ASIC init.
-  runBcmScriptPreAsicInit();
+  timeInitPhase(&ret, "pre_asic_init", [&] { runBcmScriptPreAsicInit(); });
 
   ret.initializedTime =
     duration_cast<duration<float>>(steady_clock::now() - begin).count();
@@ -441,6 +549,7 @@ HwInitResult BcmSwitch::init(Callback* callback) {
   // Add callbacks for unit and parity errors as early as possible to handle
   // critical events
   BcmSwitchEventUtils::initUnit(unit_);
+  BcmTxPacketPool::get()->start(unit_);
   auto fatalCob = make_shared<BcmSwitchEventUnitFatalErrorCallback>();
   auto nonFatalCob = make_shared<BcmSwitchEventUnitNonFatalErrorCallback>();
   BcmSwitchEventUtils::registerSwitchEventCallback(
@@ -456,6 +565,7 @@ HwInitResult BcmSwitch::init(Callback* callback) {
 
   // Create bcmStatUpdater to cache the stat ids
   bcmStatUpdater_ = std::make_unique<BcmStatUpdater>(this, isAlpmEnabled());
+  routeTable_->setAlpmEnabled(isAlpmEnabled());
 
   // Additional switch configuration
   auto state = make_shared<SwitchState>();
@@ -506,8 +616,10 @@ HwInitResult BcmSwitch::init(Callback* callback) {
   bcmCheckError(rv, "failed to set NDP trapping");
 
   if (FLAGS_force_init_fp || !warmBoot || haveMissingOrQSetChangedFPGroups()) {
-    initFieldProcessor();
-    setupFPGroups();
+    timeInitPhase(&ret, "field_processor", [&] {
+      initFieldProcessor();
+      setupFPGroups();
+    });
   }
 
   dropDhcpPackets();
@@ -532,26 +644,38 @@ HwInitResult BcmSwitch::init(Callback* callback) {
     // opennslSwitchL3EgressMode else the egress ids
     // in the host table don't show up correctly.
     warmBootCache_->populate();
+    for (const auto& phaseTime : warmBootCache_->populateTimes()) {
+      ret.initPhaseTimes.emplace_back(
+          folly::to<std::string>("warm_boot_cache.", phaseTime.first),
+          phaseTime.second);
+    }
   }
   setupToCpuEgress();
-  portTable_->initPorts(&pcfg, warmBoot);
+  timeInitPhase(
+      &ret, "ports", [&] { portTable_->initPorts(&pcfg, warmBoot); });
 
-  setupCos();
+  timeInitPhase(&ret, "cos", [&] { setupCos(); });
   configureRxRateLimiting();
   if (fineGrainedBufferStatsEnabled_) {
     startFineGrainedBufferStatLogging();
   }
+  if (FLAGS_microburst_sample_interval_us > 0) {
+    microburstMonitor_->start(
+        microseconds(FLAGS_microburst_sample_interval_us));
+  }
 
   trunkTable_->setupTrunking();
-  setupLinkscan();
-  // If warm booting, force a scan of all ports. Unfortunately
-  // opennsl_enable_set will enable all of the ports and return before
-  // the first loop on the link thread has updated the link status of
-  // ports. This will guarantee we have performed at least one scan of
-  // all ports before proceeding.
-  if (warmBoot) {
-    forceLinkscanOn(pcfg.port);
-  }
+  timeInitPhase(&ret, "linkscan", [&] {
+    setupLinkscan();
+    // If warm booting, force a scan of all ports. Unfortunately
+    // opennsl_enable_set will enable all of the ports and return before
+    // the first loop on the link thread has updated the link status of
+    // ports. This will guarantee we have performed at least one scan of
+    // all ports before proceeding.
+    if (warmBoot) {
+      forceLinkscanOn(pcfg.port);
+    }
+  });
 
   // Set the spanning tree state of all ports to forwarding.
   // TODO: Eventually the spanning tree state should be part of the Port
@@ -569,8 +693,10 @@ HwInitResult BcmSwitch::init(Callback* callback) {
 
   if (warmBoot) {
     auto warmBootState = getWarmBootSwitchState();
-    stateChangedImpl(StateDelta(make_shared<SwitchState>(), warmBootState));
-    hostTable_->warmBootHostEntriesSynced();
+    timeInitPhase(&ret, "warm_boot_state", [&] {
+      stateChangedImpl(StateDelta(make_shared<SwitchState>(), warmBootState));
+      hostTable_->warmBootHostEntriesSynced();
+    });
     ret.switchState = warmBootState;
   } else {
     ret.switchState = getColdBootSwitchState();
@@ -712,18 +838,27 @@ std::shared_ptr<SwitchState> BcmSwitch::stateChangedImpl(
       &BcmMirrorTable::processChangedMirror,
       writableBcmMirrorTable());
 
+  // Routes, ACLs and sFlow collectors each program tables of their own and
+  // don't depend on each other, so may go concurrently. Only the routes
+  // section modifies appliedState.
+  StateChangeSections sections;
+  sections.add("routes", [&]() {
+    // Process any new routes or route changes
+    processAddedChangedRoutes(delta, &appliedState);
+    // Host routes that spilled to the route table go back to the host table
+    // once route or neighbor removals have freed up room there
+    routeTable_->migrateSpilledHostRoutes();
+  });
   // Any ACL changes
-  processAclChanges(delta);
-
+  sections.add("acls", [&]() { processAclChanges(delta); });
   // Any changes to the set of sFlow collectors
-  processSflowCollectorChanges(delta);
+  sections.add(
+      "sflow collectors", [&]() { processSflowCollectorChanges(delta); });
+  sections.run(stateChangeExecutor_.get());
 
   // Any changes to the sampling rate of sflow
   processSflowSamplingRateChanges(delta);
 
-  // Process any new routes or route changes
-  processAddedChangedRoutes(delta, &appliedState);
-
   processAggregatePortChanges(delta);
 
   // Reconfigure port groups in case we are changing between using a port as
@@ -814,27 +949,41 @@ void BcmSwitch::processChangedPortQueues(
   // We expect the number of port queues to remain constant because this is
   // defined by the hardware
   for (const auto& newQueue : newPort->getPortQueues()) {
-    if (oldPort->getPortQueues().size() > 0 &&
-        *(oldPort->getPortQueues().at(newQueue->getID())) == *newQueue) {
+    if (oldPort->getPortQueues().size() == 0) {
+      XLOG(DBG1) << "New cos queue settings on port " << id << " queue "
+                 << static_cast<int>(newQueue->getID());
+      bcmPort->setupQueue(newQueue);
+      continue;
+    }
+    const auto& oldQueue = oldPort->getPortQueues().at(newQueue->getID());
+    if (oldQueue == newQueue || *oldQueue == *newQueue) {
       continue;
     }
 
-    XLOG(DBG1) << "New cos queue settings on port " << id << " queue "
+    // Only write the parameters of the queue that changed
+    XLOG(DBG1) << "Changed cos queue settings on port " << id << " queue "
                << static_cast<int>(newQueue->getID());
-    bcmPort->setupQueue(newQueue);
+    bcmPort->setupQueue(oldQueue, newQueue);
   }
 }
 
 void BcmSwitch::processChangedPorts(const StateDelta& delta) {
+  // What BcmPort::program() looks at
+  constexpr uint32_t kProgrammedFields = Port::SPEED | Port::INGRESS_VLAN |
+      Port::PAUSE | Port::SFLOW | Port::FEC | Port::LOOPBACK_MODE |
+      Port::MIRRORS;
+
   forEachChanged(delta.getPortsDelta(),
     [&] (const shared_ptr<Port>& oldPort, const shared_ptr<Port>& newPort) {
       auto id = newPort->getID();
       auto bcmPort = portTable_->getBcmPort(id);
-      if (oldPort->getName() != newPort->getName()) {
+      // Compared once here, rather than field by field by each step
+      auto changed = Port::getChangedFields(*oldPort, *newPort);
+      if (changed & Port::NAME) {
         bcmPort->updateName(newPort->getName());
       }
 
-      if (platform_->isCosSupported() &&
+      if (platform_->isCosSupported() && (changed & Port::QUEUES) &&
           isPortQueueNameChanged(oldPort, newPort)) {
         bcmPort->getQueueManager()->setupQueueCounters(
             newPort->getPortQueues());
@@ -846,35 +995,20 @@ void BcmSwitch::processChangedPorts(const StateDelta& delta) {
         return;
       }
 
-      auto speedChanged = oldPort->getSpeed() != newPort->getSpeed();
-      XLOG_IF(DBG1, speedChanged) << "New speed on port " << id;
-
-      auto vlanChanged = oldPort->getIngressVlan() != newPort->getIngressVlan();
-      XLOG_IF(DBG1, vlanChanged) << "New ingress vlan on port " << id;
-
-      auto pauseChanged = oldPort->getPause() != newPort->getPause();
-      XLOG_IF(DBG1, pauseChanged) << "New pause settings on port " << id;
-
-      auto sFlowChanged =
-          (oldPort->getSflowIngressRate() != newPort->getSflowIngressRate()) ||
-          (oldPort->getSflowEgressRate() != newPort->getSflowEgressRate());
-      XLOG_IF(DBG1, sFlowChanged) << "New sFlow settings on port " << id;
-
-      auto fecChanged = oldPort->getFEC() != newPort->getFEC();
-      XLOG_IF(DBG1, fecChanged) << "New FEC settings on port " << id;
-
-      auto loopbackChanged =
-          oldPort->getLoopbackMode() != newPort->getLoopbackMode();
-      XLOG_IF(DBG1, loopbackChanged)
+      XLOG_IF(DBG1, changed & Port::SPEED) << "New speed on port " << id;
+      XLOG_IF(DBG1, changed & Port::INGRESS_VLAN)
+          << "New ingress vlan on port " << id;
+      XLOG_IF(DBG1, changed & Port::PAUSE)
+          << "New pause settings on port " << id;
+      XLOG_IF(DBG1, changed & Port::SFLOW)
+          << "New sFlow settings on port " << id;
+      XLOG_IF(DBG1, changed & Port::FEC) << "New FEC settings on port " << id;
+      XLOG_IF(DBG1, changed & Port::LOOPBACK_MODE)
           << "New loopback mode settings on port " << id;
+      XLOG_IF(DBG1, changed & Port::MIRRORS)
+          << "New mirror settings on port " << id;
 
-      auto mirrorChanged =
-          (oldPort->getIngressMirror() != newPort->getIngressMirror()) ||
-          (oldPort->getEgressMirror() != newPort->getEgressMirror());
-      XLOG_IF(DBG1, mirrorChanged) << "New mirror settings on port " << id;
-
-      if (speedChanged || vlanChanged || pauseChanged || sFlowChanged ||
-          fecChanged || loopbackChanged || mirrorChanged) {
+      if (changed & kProgrammedFields) {
         bcmPort->program(newPort);
       }
 
@@ -884,8 +1018,9 @@ void BcmSwitch::processChangedPorts(const StateDelta& delta) {
             "this platform");
       }
 
-      processChangedPortQueues(oldPort, newPort);
-
+      if (changed & Port::QUEUES) {
+        processChangedPortQueues(oldPort, newPort);
+      }
     });
 }
 
@@ -936,6 +1071,8 @@ void BcmSwitch::reconfigurePortGroups(const StateDelta& delta) {
   // changing the configuration of a port group.
 
   auto newState = delta.newState();
+  // Each group is looked at once, however many of its ports changed
+  boost::container::flat_set<BcmPortGroup*> portGroups;
   forEachChanged(delta.getPortsDelta(),
     [&] (const shared_ptr<Port>& oldPort, const shared_ptr<Port>& newPort) {
       auto enabled = !oldPort->isEnabled() && newPort->isEnabled();
@@ -952,10 +1089,25 @@ void BcmSwitch::reconfigurePortGroups(const StateDelta& delta) {
         auto bcmPort = portTable_->getBcmPort(newPort->getID());
         auto portGroup = bcmPort->getPortGroup();
         if (portGroup) {
-          portGroup->reconfigureIfNeeded(newState);
+          portGroups.insert(portGroup);
         }
       }
     });
+
+  // Take all of the groups through each step of the reconfiguration
+  // before the next, so their links come back up together
+  std::vector<BcmPortGroup*> reconfiguring;
+  for (auto portGroup : portGroups) {
+    if (portGroup->prepareReconfiguration(newState)) {
+      reconfiguring.push_back(portGroup);
+    }
+  }
+  for (auto portGroup : reconfiguring) {
+    portGroup->applyLaneMode();
+  }
+  for (auto portGroup : reconfiguring) {
+    portGroup->finishReconfiguration(newState);
+  }
 }
 
 bool BcmSwitch::isValidPortUpdate(const shared_ptr<Port>& oldPort,
@@ -1130,12 +1282,54 @@ void BcmSwitch::processAclChanges(const StateDelta& delta) {
     return;
   }
 
+  // Every acl in the delta is one TCAM entry to be written or cleared, so
+  // keep track of how much each change costs us
+  auto aclsDelta = delta.getAclsDelta();
+  auto tcamWrites = std::distance(aclsDelta.begin(), aclsDelta.end());
+  if (tcamWrites > 0) {
+    XLOG(DBG1) << "Programming " << tcamWrites << " acl entries";
+    tcData().addStatValue(kAclTcamWrites, tcamWrites, stats::SUM);
+  }
+
+  auto oldAcls = delta.oldState()->getAcls();
+  auto newAcls = delta.newState()->getAcls();
+  auto reshadowed = aclTable_->compileAcls(newAcls);
+  const auto& compiled = aclTable_->getCompiledAcls();
+  XLOG(DBG2) << "Compiled acls into " << compiled.tcamEntries
+             << " TCAM entries, " << compiled.shadowed.size()
+             << " shadowed acls and " << compiled.rangeCheckers.size()
+             << " range checkers";
+
   forEachChanged(
-    delta.getAclsDelta(),
+    aclsDelta,
     &BcmSwitch::processChangedAcl,
     &BcmSwitch::processAddedAcl,
     &BcmSwitch::processRemovedAcl,
     this);
+
+  if (reshadowed.empty()) {
+    return;
+  }
+  // Acls in the delta were already programmed the right way, the unchanged
+  // ones whose shadowing changed still need to go in or out of the TCAM
+  boost::container::flat_map<int, std::shared_ptr<AclEntry>> oldByPriority;
+  for (const auto& acl : *oldAcls) {
+    oldByPriority.emplace(acl->getPriority(), acl);
+  }
+  boost::container::flat_map<int, std::shared_ptr<AclEntry>> newByPriority;
+  for (const auto& acl : *newAcls) {
+    newByPriority.emplace(acl->getPriority(), acl);
+  }
+  for (auto priority : reshadowed) {
+    auto oldAcl = oldByPriority.find(priority);
+    auto newAcl = newByPriority.find(priority);
+    if (oldAcl == oldByPriority.end() || newAcl == newByPriority.end() ||
+        oldAcl->second != newAcl->second) {
+      continue;
+    }
+    processRemovedAcl(oldAcl->second);
+    processAddedAcl(newAcl->second);
+  }
 }
 
 void BcmSwitch::processAggregatePortChanges(const StateDelta& delta) {
@@ -1182,10 +1376,20 @@ void BcmSwitch::processSflowSamplingRateChanges(const StateDelta& delta) {
         auto newEgressRate = newPort->getSflowEgressRate();
         auto sFlowChanged = (oldIngressRate != newIngressRate) ||
             (oldEgressRate != newEgressRate);
+        auto id = newPort->getID();
         if (sFlowChanged) {
-          auto id = newPort->getID();
           sFlowExporterTable_->updateSamplingRates(
               id, newIngressRate, newEgressRate);
+          return;
+        }
+        // Programming the port puts it back at its configured rates, so
+        // put back any adjustment made by the rate controller
+        auto rates = sFlowExporterTable_->getSamplingRates(id);
+        if (rates != SflowRateController::Rates() &&
+            (rates.ingress != newIngressRate ||
+             rates.egress != newEgressRate)) {
+          portTable_->getBcmPort(id)->setSflowRates(
+              rates.ingress, rates.egress);
         }
       });
 }
@@ -1295,22 +1499,31 @@ void BcmSwitch::processNeighborEntryDelta(
 void BcmSwitch::processNeighborChanges(
     const StateDelta& delta,
     std::shared_ptr<SwitchState>* appliedState) {
-  for (const auto& vlanDelta : delta.getVlansDelta()) {
-    for (const auto& arpDelta : vlanDelta.getArpDelta()) {
-      using DeltaT = DeltaValue<ArpEntry>;
-      processNeighborEntryDelta<DeltaT, ArpTable>(arpDelta, appliedState);
-    }
-    for (const auto& ndpDelta : vlanDelta.getNdpDelta()) {
-      using DeltaT = DeltaValue<NdpEntry>;
-      processNeighborEntryDelta<DeltaT, NdpTable>(ndpDelta, appliedState);
+  // Ports coming up or a warm boot can resolve many neighbors in one update,
+  // so update the ECMP groups and port mappings for them all at once
+  hostTable_->startHostBatch();
+  try {
+    for (const auto& vlanDelta : delta.getVlansDelta()) {
+      for (const auto& arpDelta : vlanDelta.getArpDelta()) {
+        using DeltaT = DeltaValue<ArpEntry>;
+        processNeighborEntryDelta<DeltaT, ArpTable>(arpDelta, appliedState);
+      }
+      for (const auto& ndpDelta : vlanDelta.getNdpDelta()) {
+        using DeltaT = DeltaValue<NdpEntry>;
+        processNeighborEntryDelta<DeltaT, NdpTable>(ndpDelta, appliedState);
+      }
     }
+  } catch (...) {
+    hostTable_->endHostBatch();
+    throw;
   }
+  hostTable_->endHostBatch();
 }
 
 template <typename RouteT>
 void BcmSwitch::processChangedRoute(
     const RouterID& id,
-    std::shared_ptr<SwitchState>* appliedState,
+    RouteProgramBatch<RouteT>* batch,
     const shared_ptr<RouteT>& oldRoute,
     const shared_ptr<RouteT>& newRoute) {
   std::string routeMessage;
@@ -1328,19 +1541,14 @@ void BcmSwitch::processChangedRoute(
     XLOG(DBG1) << "Non-resolved route HW programming is skipped";
     processRemovedRoute(id, oldRoute);
   } else {
-    try {
-      routeTable_->addRoute(getBcmVrfId(id), newRoute.get());
-    } catch (const BcmError& error) {
-      rethrowIfHwNotFull(error);
-      SwitchState::revertNewRouteEntry(id, newRoute, oldRoute, appliedState);
-    }
+    batch->add(this, {oldRoute, newRoute});
   }
 }
 
 template <typename RouteT>
 void BcmSwitch::processAddedRoute(
     const RouterID& id,
-    std::shared_ptr<SwitchState>* appliedState,
+    RouteProgramBatch<RouteT>* batch,
     const shared_ptr<RouteT>& route) {
   std::string routeMessage;
   folly::toAppend(
@@ -1351,13 +1559,7 @@ void BcmSwitch::processAddedRoute(
     XLOG(DBG1) << "Non-resolved route HW programming is skipped";
     return;
   }
-  try {
-    routeTable_->addRoute(getBcmVrfId(id), route.get());
-  } catch (const BcmError& error) {
-    rethrowIfHwNotFull(error);
-    using AddrT = typename RouteT::Addr;
-    SwitchState::revertNewRouteEntry<AddrT>(id, route, nullptr, appliedState);
-  }
+  batch->add(this, {nullptr, route});
 }
 
 template <typename RouteT>
@@ -1371,60 +1573,205 @@ void BcmSwitch::processRemovedRoute(const RouterID id,
   routeTable_->deleteRoute(getBcmVrfId(id), route.get());
 }
 
+template <typename RouteT, typename DeltaT>
+void BcmSwitch::processRemovedRoutes(const RouterID id, const DeltaT& delta) {
+  std::vector<const RouteT*> removed;
+  forEachRemoved(delta, [&](const shared_ptr<RouteT>& route) {
+    XLOG(DBG3) << "removing route entry @ vrf " << id << " " << route->str();
+    if (!route->isResolved()) {
+      XLOG(DBG1) << "Non-resolved route HW programming is skipped";
+      return;
+    }
+    removed.push_back(route.get());
+  });
+  routeTable_->deleteRoutes(getBcmVrfId(id), removed);
+}
+
 void BcmSwitch::processRemovedRoutes(const StateDelta& delta) {
+  if (FLAGS_fib_compression) {
+    for (auto const& rtDelta : delta.getRouteTablesDelta()) {
+      RouterID id = rtDelta.getNew() ? rtDelta.getNew()->getID()
+                                     : rtDelta.getOld()->getID();
+      processCompressedRouteChanges(
+          id, rtDelta.getRoutesV4Delta(), &compressedFibsV4_[id]);
+      processCompressedRouteChanges(
+          id, rtDelta.getRoutesV6Delta(), &compressedFibsV6_[id]);
+    }
+    return;
+  }
   for (auto const& rtDelta : delta.getRouteTablesDelta()) {
     if (!rtDelta.getOld()) {
       // no old route table, must not removed route, skip
       continue;
     }
     RouterID id = rtDelta.getOld()->getID();
-    forEachRemoved(
-        rtDelta.getRoutesV4Delta(),
-        &BcmSwitch::processRemovedRoute<RouteV4>,
-        this,
-        id);
-    forEachRemoved(
-        rtDelta.getRoutesV6Delta(),
-        &BcmSwitch::processRemovedRoute<RouteV6>,
-        this,
-        id);
+    processRemovedRoutes<RouteV4>(id, rtDelta.getRoutesV4Delta());
+    processRemovedRoutes<RouteV6>(id, rtDelta.getRoutesV6Delta());
   }
 }
 
+template <typename RouteT, typename DeltaT>
+void BcmSwitch::collectAddedChangedRoutes(
+    const RouterID& id,
+    const DeltaT& delta,
+    RouteProgramBatch<RouteT>* batch) {
+  forEachChanged(
+      delta,
+      &BcmSwitch::processChangedRoute<RouteT>,
+      &BcmSwitch::processAddedRoute<RouteT>,
+      [&](BcmSwitch*,
+          const RouterID&,
+          RouteProgramBatch<RouteT>*,
+          const shared_ptr<RouteT>&) {},
+      this,
+      id,
+      batch);
+}
+
+template <typename RouteT>
+void BcmSwitch::programRoutes(
+    const RouterID& id,
+    const std::vector<RouteProgramOp<RouteT>>& ops,
+    std::shared_ptr<SwitchState>* appliedState) {
+  if (ops.empty()) {
+    return;
+  }
+  std::vector<const RouteT*> routes;
+  routes.reserve(ops.size());
+  for (const auto& op : ops) {
+    routes.push_back(op.newRoute.get());
+  }
+  routeTable_->addRoutes(
+      getBcmVrfId(id), routes, [&](size_t index, const BcmError& error) {
+        rethrowIfHwNotFull(error);
+        using AddrT = typename RouteT::Addr;
+        const auto& op = ops[index];
+        SwitchState::revertNewRouteEntry<AddrT>(
+            id, op.newRoute, op.oldRoute, appliedState);
+      });
+}
+
 void BcmSwitch::processAddedChangedRoutes(
     const StateDelta& delta,
     std::shared_ptr<SwitchState>* appliedState) {
+  if (FLAGS_fib_compression) {
+    for (auto& idAndFib : compressedFibsV4_) {
+      programCompressedRoutes(idAndFib.first, &idAndFib.second);
+    }
+    for (auto& idAndFib : compressedFibsV6_) {
+      programCompressedRoutes(idAndFib.first, &idAndFib.second);
+    }
+    return;
+  }
+  // Collect all routes to program first, so that they can be written to the
+  // HW as one batch per vrf and address family, the critical ones before
+  // the others
+  std::vector<std::pair<RouterID, RouteProgramBatch<RouteV4>>> batchesV4;
+  std::vector<std::pair<RouterID, RouteProgramBatch<RouteV6>>> batchesV6;
   for (auto const& rtDelta : delta.getRouteTablesDelta()) {
     if (!rtDelta.getNew()) {
       // no new route table, must not have added or changed route, skip
       continue;
     }
     RouterID id = rtDelta.getNew()->getID();
-    forEachChanged(
-        rtDelta.getRoutesV4Delta(),
-        &BcmSwitch::processChangedRoute<RouteV4>,
-        &BcmSwitch::processAddedRoute<RouteV4>,
-        [&](BcmSwitch*,
-            const RouterID&,
-            std::shared_ptr<SwitchState>*,
-            const shared_ptr<RouteV4>&) {},
-        this,
-        id,
-        appliedState);
-    forEachChanged(
-        rtDelta.getRoutesV6Delta(),
-        &BcmSwitch::processChangedRoute<RouteV6>,
-        &BcmSwitch::processAddedRoute<RouteV6>,
-        [&](BcmSwitch*,
-            const RouterID&,
-            std::shared_ptr<SwitchState>*,
-            const shared_ptr<RouteV6>&) {},
-        this,
-        id,
-        appliedState);
+    batchesV4.emplace_back(id, RouteProgramBatch<RouteV4>());
+    collectAddedChangedRoutes<RouteV4>(
+        id, rtDelta.getRoutesV4Delta(), &batchesV4.back().second);
+    batchesV6.emplace_back(id, RouteProgramBatch<RouteV6>());
+    collectAddedChangedRoutes<RouteV6>(
+        id, rtDelta.getRoutesV6Delta(), &batchesV6.back().second);
+  }
+
+  size_t numCritical = 0;
+  size_t numRest = 0;
+  for (const auto& idAndBatch : batchesV4) {
+    programRoutes(idAndBatch.first, idAndBatch.second.critical, appliedState);
+    numCritical += idAndBatch.second.critical.size();
+    numRest += idAndBatch.second.rest.size();
+  }
+  for (const auto& idAndBatch : batchesV6) {
+    programRoutes(idAndBatch.first, idAndBatch.second.critical, appliedState);
+    numCritical += idAndBatch.second.critical.size();
+    numRest += idAndBatch.second.rest.size();
+  }
+  if (numCritical > 0) {
+    tcData().setCounter(kCriticalRoutesProgrammed, std::time(nullptr));
+    XLOG(DBG1) << "programmed " << numCritical << " critical routes, "
+               << numRest << " more routes to go";
+  }
+
+  for (const auto& idAndBatch : batchesV4) {
+    programRoutes(idAndBatch.first, idAndBatch.second.rest, appliedState);
+  }
+  for (const auto& idAndBatch : batchesV6) {
+    programRoutes(idAndBatch.first, idAndBatch.second.rest, appliedState);
   }
 }
 
+template <typename AddrT, typename DeltaT>
+void BcmSwitch::processCompressedRouteChanges(
+    RouterID id,
+    const DeltaT& delta,
+    CompressedFib<AddrT>* fib) {
+  using RouteT = Route<AddrT>;
+  auto& compressor = fib->compressor;
+  forEachChanged(
+      delta,
+      [&](const shared_ptr<RouteT>& oldRoute,
+          const shared_ptr<RouteT>& newRoute) {
+        if (newRoute->isResolved()) {
+          compressor.addRoute(newRoute);
+        } else {
+          compressor.removeRoute(oldRoute->prefix());
+        }
+      },
+      [&](const shared_ptr<RouteT>& route) {
+        if (route->isResolved()) {
+          compressor.addRoute(route);
+        }
+      },
+      [&](const shared_ptr<RouteT>& route) {
+        compressor.removeRoute(route->prefix());
+      });
+
+  fib->changes = compressor.getChanges();
+  std::vector<const RouteT*> removed;
+  removed.reserve(fib->changes.removed.size());
+  for (const auto& route : fib->changes.removed) {
+    removed.push_back(route.get());
+  }
+  routeTable_->deleteRoutes(getBcmVrfId(id), removed);
+  fib->changes.removed.clear();
+}
+
+template <typename AddrT>
+void BcmSwitch::programCompressedRoutes(
+    RouterID id,
+    CompressedFib<AddrT>* fib) {
+  if (fib->changes.addedChanged.empty()) {
+    return;
+  }
+  auto addedChanged = std::move(fib->changes.addedChanged);
+  fib->changes.addedChanged.clear();
+  std::vector<const Route<AddrT>*> routes;
+  routes.reserve(addedChanged.size());
+  for (const auto& change : addedChanged) {
+    routes.push_back(change.second.get());
+  }
+  routeTable_->addRoutes(
+      getBcmVrfId(id), routes, [&](size_t index, const BcmError& error) {
+        rethrowIfHwNotFull(error);
+        // The entries don't map one to one onto the routes of the applied
+        // state, so there is no route to revert. The compressor tries the
+        // entry again on the next route update of the vrf instead.
+        const auto& change = addedChanged[index];
+        fib->compressor.programFailed(change.second->prefix(), change.first);
+      });
+  XLOG(DBG2) << "vrf " << id << ": " << fib->compressor.numRoutes()
+             << " routes programmed as " << fib->compressor.numProgrammed()
+             << " entries";
+}
+
 void BcmSwitch::linkscanCallback(
     int unit,
     opennsl_port_t bcmPort,
@@ -1434,8 +1781,20 @@ void BcmSwitch::linkscanCallback(
     BcmSwitch* sw = static_cast<BcmSwitch*>(unitObj->getCookie());
     bool up = info->linkstatus == OPENNSL_PORT_LINK_STATUS_UP;
 
-    sw->linkScanBottomHalfEventBase_.runInEventBaseThread(
-        [sw, bcmPort, up]() { sw->linkStateChangedHwNotLocked(bcmPort, up); });
+    // Queue the event for the bottom half. Events arriving while a drain
+    // is already scheduled are picked up by it, so a burst of flaps is
+    // handled as one batch.
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> g(sw->linkEventsLock_);
+      sw->pendingLinkEvents_.emplace_back(bcmPort, up);
+      schedule = !sw->linkEventsScheduled_;
+      sw->linkEventsScheduled_ = true;
+    }
+    if (schedule) {
+      sw->linkScanBottomHalfEventBase_.runInEventBaseThread(
+          [sw]() { sw->linkStateChangedHwNotLocked(); });
+    }
   } catch (const std::exception& ex) {
     XLOG(ERR) << "unhandled exception while processing linkscan callback "
               << "for unit " << unit << " port " << bcmPort << ": "
@@ -1443,24 +1802,50 @@ void BcmSwitch::linkscanCallback(
   }
 }
 
-void BcmSwitch::linkStateChangedHwNotLocked(
-    opennsl_port_t bcmPortId,
-    bool up) {
+void BcmSwitch::linkStateChangedHwNotLocked() {
   CHECK(linkScanBottomHalfEventBase_.inRunningEventBaseThread());
 
-  if (!up) {
+  std::vector<std::pair<opennsl_port_t, bool>> events;
+  {
+    std::lock_guard<std::mutex> g(linkEventsLock_);
+    events.swap(pendingLinkEvents_);
+    linkEventsScheduled_ = false;
+  }
+
+  // Shrink the ECMP groups over all the ports and trunks that went down
+  // in one pass, before telling the SwSwitch about any of them.
+  std::vector<opennsl_gport_t> downGPorts;
+  for (const auto& event : events) {
+    auto bcmPortId = event.first;
+    if (event.second) {
+      // For port up events we wait till ARP/NDP entries
+      // are re resolved after port up before adding them
+      // back. Adding them earlier leads to packet loss.
+      auto bcmPort = portTable_->getBcmPortIf(bcmPortId);
+      if (bcmPort && bcmPort->getPortGroup()) {
+        bcmPort->getPortGroup()->linkUp(bcmPort);
+      }
+      continue;
+    }
     auto trunk = trunkTable_->linkDownHwNotLocked(bcmPortId);
     if (trunk != BcmTrunk::INVALID) {
       XLOG(INFO) << "Shrinking ECMP entries egressing over trunk " << trunk;
-      hostTable_->trunkDownHwNotLocked(trunk);
+      downGPorts.push_back(BcmTrunk::asGPort(trunk));
     }
-    hostTable_->linkDownHwNotLocked(bcmPortId);
-  } else {
-    // For port up events we wait till ARP/NDP entries
-    // are re resolved after port up before adding them
-    // back. Adding them earlier leads to packet loss.
+    downGPorts.push_back(BcmPort::asGPort(bcmPortId));
+  }
+  if (!downGPorts.empty()) {
+    hostTable_->linksDownHwNotLocked(downGPorts);
+  }
+  if (events.size() > 1) {
+    XLOG(DBG2) << "Handled " << events.size()
+               << " link state changes in one batch";
+  }
+
+  for (const auto& event : events) {
+    callback_->linkStateChanged(
+        portTable_->getPortId(event.first), event.second);
   }
-  callback_->linkStateChanged(portTable_->getPortId(bcmPortId), up);
 }
 
 opennsl_rx_t BcmSwitch::packetRxCallback(int unit, opennsl_pkt_t* pkt,
@@ -1514,6 +1899,26 @@ bool BcmSwitch::sendPacketOutOfPortAsync(
   return OPENNSL_SUCCESS(BcmTxPacket::sendAsync(std::move(bcmPkt)));
 }
 
+bool BcmSwitch::sendPacketsOutOfPortAsync(
+    std::vector<unique_ptr<TxPacket>> pkts,
+    PortID portID,
+    folly::Optional<uint8_t> cos) noexcept {
+  auto bcmPort = getPortTable()->getBcmPortId(portID);
+  std::vector<unique_ptr<BcmTxPacket>> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    bcmPkts.emplace_back(
+        boost::polymorphic_downcast<BcmTxPacket*>(pkt.release()));
+    bcmPkts.back()->setDestModPort(bcmPort);
+    if (cos) {
+      bcmPkts.back()->setCos(*cos);
+    }
+  }
+  XLOG(DBG4) << "sendPacketsOutOfPortAsync of " << bcmPkts.size()
+             << " packets for " << bcmPort;
+  return OPENNSL_SUCCESS(BcmTxPacket::sendAsync(std::move(bcmPkts)));
+}
+
 bool BcmSwitch::sendPacketSwitchedSync(unique_ptr<TxPacket> pkt) noexcept {
   unique_ptr<BcmTxPacket> bcmPkt(
       boost::polymorphic_downcast<BcmTxPacket*>(pkt.release()));
@@ -1580,9 +1985,76 @@ void BcmSwitch::updateGlobalStats() {
   portTable_->updatePortStats();
   trunkTable_->updateStats();
   bcmStatUpdater_->updateStats();
+  routeProgramLatency_->publish();
   if (isBufferStatCollectionEnabled()) {
     exportDeviceBufferUsage();
   }
+  if (sFlowExporterTable_->counterSamplesDue()) {
+    exportSflowCounters();
+  }
+  if (sFlowExporterTable_->samplingRateAdjustmentDue()) {
+    adjustSflowSamplingRates();
+  }
+  {
+    // ECMP groups are created and destroyed with the lock held
+    std::lock_guard<std::mutex> g(lock_);
+    hostTable_->updateEcmpFlowletStats();
+    ecmpBalanceMonitor_->updateStats(steady_clock::now());
+  }
+}
+
+void BcmSwitch::adjustSflowSamplingRates() {
+  // Serialized with state updates, which also program sampling rates
+  std::lock_guard<std::mutex> g(lock_);
+  for (const auto& change : sFlowExporterTable_->adjustSamplingRates()) {
+    auto bcmPort = portTable_->getBcmPortIf(change.first);
+    if (!bcmPort) {
+      continue;
+    }
+    try {
+      bcmPort->setSflowRates(change.second.ingress, change.second.egress);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "Failed to change sFlow sampling rates of port "
+                << change.first << ": " << folly::exceptionStr(ex);
+    }
+  }
+}
+
+void BcmSwitch::exportSflowCounters() {
+  std::vector<SflowV5Encoder::InterfaceCounters> counters;
+  for (const auto& entry : *portTable_) {
+    auto port = entry.second;
+    // Based on the stats just collected by updatePortStats()
+    auto stats = port->getPortStats();
+    SflowV5Encoder::InterfaceCounters c;
+    c.ifIndex = static_cast<uint16_t>(entry.first);
+    c.ifSpeed = static_cast<uint64_t>(port->getSpeed()) * 1000 * 1000;
+    try {
+      c.adminUp = port->isEnabled();
+      c.operUp = c.adminUp && port->isUp();
+    } catch (const std::exception& ex) {
+      XLOG(DBG2) << "Failed to get state of port " << entry.first
+                 << " for sFlow: " << folly::exceptionStr(ex);
+    }
+    // Counters that were never collected are negative, report them as 0
+    auto counter = [](int64_t value) {
+      return static_cast<uint64_t>(std::max<int64_t>(value, 0));
+    };
+    c.inOctets = counter(stats.inBytes_);
+    c.inUcast = counter(stats.inUnicastPkts_);
+    c.inMcast = counter(stats.inMulticastPkts_);
+    c.inBcast = counter(stats.inBroadcastPkts_);
+    c.inDiscards = counter(stats.inDiscards_);
+    c.inErrors = counter(stats.inErrors_);
+    c.outOctets = counter(stats.outBytes_);
+    c.outUcast = counter(stats.outUnicastPkts_);
+    c.outMcast = counter(stats.outMulticastPkts_);
+    c.outBcast = counter(stats.outBroadcastPkts_);
+    c.outDiscards = counter(stats.outDiscards_);
+    c.outErrors = counter(stats.outErrors_);
+    counters.push_back(c);
+  }
+  sFlowExporterTable_->sendCounters(std::move(counters));
 }
 
 opennsl_if_t BcmSwitch::getDropEgressId() const {
@@ -1605,15 +2077,92 @@ bool BcmSwitch::getAndClearNeighborHit(
   // lock and opens up the possibility of bg thread getting stuck
   // behind update thread.  For now, stub this out to return true and
   // work on adding a better way to communicate hit bit + stale entry
-  // garbage collection.
+  // garbage collection. getAndClearNeighborHits() is the better way.
   return true;
 }
 
+folly::Optional<std::unordered_set<folly::IPAddress>>
+BcmSwitch::getAndClearNeighborHits(RouterID vrf) {
+  // This only reads and writes the hardware host table, and never touches
+  // our own tables, so it doesn't need lock_ and can't get stuck behind a
+  // state update.
+  struct Traversal {
+    opennsl_vrf_t vrf;
+    std::vector<opennsl_l3_host_t> hits;
+  } traversal;
+  traversal.vrf = vrf;
+  auto collectHits = [](int /*unit*/,
+                        int /*index*/,
+                        opennsl_l3_host_t* host,
+                        void* userData) -> int {
+    auto* t = static_cast<Traversal*>(userData);
+    if (host->l3a_vrf == t->vrf && (host->l3a_flags & OPENNSL_L3_HIT)) {
+      t->hits.push_back(*host);
+    }
+    return 0;
+  };
+
+  opennsl_l3_info_t l3Info;
+  opennsl_l3_info_t_init(&l3Info);
+  auto rv = opennsl_l3_info(unit_, &l3Info);
+  bcmCheckError(rv, "failed to get L3 table info");
+  rv = opennsl_l3_host_traverse(
+      unit_, 0, 0, l3Info.l3info_max_host, collectHits, &traversal);
+  bcmCheckError(rv, "failed to traverse v4 hosts");
+  rv = opennsl_l3_host_traverse(
+      unit_,
+      OPENNSL_L3_IP6,
+      0,
+      // Diag shell uses this for getting # of v6 host entries
+      l3Info.l3info_max_host / 2,
+      collectHits,
+      &traversal);
+  bcmCheckError(rv, "failed to traverse v6 hosts");
+
+  // Clear the hit bits once the traversal is done, rather than modifying the
+  // table while traversing it. Entries that weren't hit don't need clearing.
+  std::unordered_set<folly::IPAddress> hits;
+  for (auto& host : traversal.hits) {
+    auto ip = host.l3a_flags & OPENNSL_L3_IP6
+        ? folly::IPAddress::fromBinary(
+              folly::ByteRange(host.l3a_ip6_addr, sizeof(host.l3a_ip6_addr)))
+        : folly::IPAddress::fromLongHBO(host.l3a_ip_addr);
+    hits.insert(ip);
+    host.l3a_flags |= OPENNSL_L3_HIT_CLEAR;
+    rv = opennsl_l3_host_find(unit_, &host);
+    if (OPENNSL_FAILURE(rv)) {
+      // The entry may have been deleted since the traversal
+      XLOG(DBG3) << "failed to clear hit bit of " << ip << ": "
+                 << opennsl_errmsg(rv);
+    }
+  }
+  return hits;
+}
+
 void BcmSwitch::exitFatal() const {
   dumpState();
   callback_->exitFatal();
 }
 
+void BcmSwitch::getQueueBufferStats(
+    std::vector<QueueBufferStats>* stats,
+    std::chrono::seconds window) const {
+  *stats = microburstMonitor_->getQueueBufferStats(window);
+}
+
+void BcmSwitch::getEcmpBalance(
+    std::vector<EcmpGroupBalance>* groups,
+    size_t maxGroups) const {
+  auto worstGroups = ecmpBalanceMonitor_->getWorstGroups(maxGroups);
+  groups->insert(groups->end(), worstGroups.begin(), worstGroups.end());
+}
+
+void BcmSwitch::traceFlowHashing(
+    const std::vector<FlowTuple>& flows,
+    FlowHashingReport* report) {
+  *report = hashTracer_->trace(flows);
+}
+
 bool BcmSwitch::startFineGrainedBufferStatLogging() {
   if (startBufferStatCollection()) {
     fineGrainedBufferStatsEnabled_ = true;
@@ -1699,10 +2248,12 @@ void BcmSwitch::processChangedControlPlaneQueues(
     const shared_ptr<ControlPlane>& oldCPU,
     const shared_ptr<ControlPlane>& newCPU) {
   // first make sure queue settings changes applied
-  for (const auto newQueue: newCPU->getQueues()) {
-    if (oldCPU->getQueues().size() > 0 &&
-        *(oldCPU->getQueues().at(newQueue->getID())) == *newQueue) {
-      continue;
+  for (const auto& newQueue : newCPU->getQueues()) {
+    if (oldCPU->getQueues().size() > 0) {
+      const auto& oldQueue = oldCPU->getQueues().at(newQueue->getID());
+      if (oldQueue == newQueue || *oldQueue == *newQueue) {
+        continue;
+      }
     }
     XLOG(DBG1) << "New cos queue settings on cpu queue "
                << static_cast<int>(newQueue->getID());
@@ -1718,6 +2269,10 @@ void BcmSwitch::processControlPlaneChanges(const StateDelta& delta) {
   const auto controlPlaneDelta = delta.getControlPlaneDelta();
   const auto& oldCPU = controlPlaneDelta.getOld();
   const auto& newCPU = controlPlaneDelta.getNew();
+  if (oldCPU == newCPU) {
+    // Most updates leave the control plane alone
+    return;
+  }
 
   processChangedControlPlaneQueues(oldCPU, newCPU);
   // TODO(joseph5wu) Add reason-port mapping and cpu acls
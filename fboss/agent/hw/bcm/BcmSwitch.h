@@ -9,17 +9,24 @@
  */
 #pragma once
 
+#include "fboss/agent/FibCompressor.h"
 #include "fboss/agent/HwSwitch.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include <folly/dynamic.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/Optional.h>
 #include <gtest/gtest_prod.h>
 
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 
 extern "C" {
@@ -57,6 +64,7 @@ class PacketTraceInfo;
 class SflowCollector;
 class MockRxPacket;
 class Interface;
+class LatencyQuantiles;
 class Port;
 class PortStats;
 class Vlan;
@@ -65,6 +73,9 @@ class BufferStatsLogger;
 class Mirror;
 class BcmMirror;
 class BcmMirrorTable;
+class BcmEcmpBalanceMonitor;
+class BcmHashTracer;
+class BcmMicroburstMonitor;
 class ControlPlane;
 
 /*
@@ -211,6 +222,10 @@ class BcmSwitch : public BcmSwitchIf {
       std::unique_ptr<TxPacket> pkt,
       PortID portID,
       folly::Optional<uint8_t> cos = folly::none) noexcept override;
+  bool sendPacketsOutOfPortAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      PortID portID,
+      folly::Optional<uint8_t> cos = folly::none) noexcept override;
 
   bool sendPacketSwitchedSync(std::unique_ptr<TxPacket> pkt) noexcept override;
   bool sendPacketOutOfPortSync(
@@ -351,6 +366,20 @@ class BcmSwitch : public BcmSwitchIf {
   };
 
   void fetchL2Table(std::vector<L2EntryThrift> *l2Table) override;
+  void fetchL2TablePage(
+      const L2TablePageRequest& request,
+      int32_t maxEntries,
+      L2TablePage* page) override;
+
+  void getEcmpBalance(
+      std::vector<EcmpGroupBalance>* groups,
+      size_t maxGroups) const override;
+  void traceFlowHashing(
+      const std::vector<FlowTuple>& flows,
+      FlowHashingReport* report) override;
+  void getQueueBufferStats(
+      std::vector<QueueBufferStats>* stats,
+      std::chrono::seconds window) const override;
 
   BcmHostTable* writableHostTable() const override { return hostTable_.get(); }
   BcmAclTable* writableAclTable() const override { return aclTable_.get(); }
@@ -360,6 +389,11 @@ class BcmSwitch : public BcmSwitchIf {
 
   BcmRouteTable* writableRouteTable() const { return routeTable_.get(); }
 
+  // The time BcmRoute::program() takes
+  LatencyQuantiles* getRouteProgramLatency() const {
+    return routeProgramLatency_.get();
+  }
+
   const BcmMirrorTable* getBcmMirrorTable() const override {
     return mirrorTable_.get();
   }
@@ -383,6 +417,8 @@ class BcmSwitch : public BcmSwitchIf {
    */
   bool getAndClearNeighborHit(RouterID vrf,
                               folly::IPAddress& ip) override;
+  folly::Optional<std::unordered_set<folly::IPAddress>>
+  getAndClearNeighborHits(RouterID vrf) override;
 
   bool getPortFECConfig(PortID port) const override;
 
@@ -438,6 +474,8 @@ class BcmSwitch : public BcmSwitchIf {
    * building complete state.
    */
   std::shared_ptr<SwitchState> getWarmBootSwitchState() const;
+  // How far clearWarmBootCache() got. Must be called with lock_ held.
+  void publishWarmBootClearProgress() const;
 
   void setupToCpuEgress();
 
@@ -469,25 +507,91 @@ class BcmSwitch : public BcmSwitchIf {
   void pickupLinkStatusChanges(const StateDelta& delta);
   void reconfigurePortGroups(const StateDelta& delta);
 
+  /*
+   * A route add or change queued for batched programming. oldRoute is null
+   * for newly added routes.
+   */
+  template <typename RouteT>
+  struct RouteProgramOp {
+    std::shared_ptr<RouteT> oldRoute;
+    std::shared_ptr<RouteT> newRoute;
+  };
+
+  /*
+   * The route adds and changes of a vrf, with the ones to routes listed in
+   * --critical_route_prefixes kept apart so they can be programmed first.
+   */
+  template <typename RouteT>
+  struct RouteProgramBatch {
+    std::vector<RouteProgramOp<RouteT>> critical;
+    std::vector<RouteProgramOp<RouteT>> rest;
+
+    void add(const BcmSwitch* hw, RouteProgramOp<RouteT> op) {
+      auto isCritical = hw->isCriticalRoute(op.newRoute->prefix());
+      (isCritical ? critical : rest).push_back(std::move(op));
+    }
+  };
+  bool isCriticalRoute(const RoutePrefixV4& prefix) const {
+    return criticalRoutesV4_.count(prefix) > 0;
+  }
+  bool isCriticalRoute(const RoutePrefixV6& prefix) const {
+    return criticalRoutesV6_.count(prefix) > 0;
+  }
+
   template <typename RouteT>
   void processChangedRoute(
       const RouterID& id,
-      std::shared_ptr<SwitchState>* appliedState,
+      RouteProgramBatch<RouteT>* batch,
       const std::shared_ptr<RouteT>& oldRoute,
       const std::shared_ptr<RouteT>& newRoute);
   template <typename RouteT>
   void processAddedRoute(
       const RouterID& id,
-      std::shared_ptr<SwitchState>* appliedState,
+      RouteProgramBatch<RouteT>* batch,
       const std::shared_ptr<RouteT>& route);
   template <typename RouteT>
   void processRemovedRoute(
       const RouterID id, const std::shared_ptr<RouteT>& route);
+  template <typename RouteT, typename DeltaT>
+  void processRemovedRoutes(const RouterID id, const DeltaT& delta);
   void processRemovedRoutes(const StateDelta& delta);
+  template <typename RouteT, typename DeltaT>
+  void collectAddedChangedRoutes(
+      const RouterID& id,
+      const DeltaT& delta,
+      RouteProgramBatch<RouteT>* batch);
+  template <typename RouteT>
+  void programRoutes(
+      const RouterID& id,
+      const std::vector<RouteProgramOp<RouteT>>& ops,
+      std::shared_ptr<SwitchState>* appliedState);
+  /*
+   * Program the route adds and changes of every vrf, the critical routes
+   * first, and publish when those are done.
+   */
   void processAddedChangedRoutes(
       const StateDelta& delta,
       std::shared_ptr<SwitchState>* appliedState);
 
+  /*
+   * With --fib_compression, the routes of each vrf are programmed as their
+   * FibCompressor works them out. The entries to delete are deleted along
+   * with the removed routes, and the ones to add or change are kept in
+   * changes until routes are added.
+   */
+  template <typename AddrT>
+  struct CompressedFib {
+    FibCompressor<AddrT> compressor;
+    typename FibCompressor<AddrT>::Changes changes;
+  };
+  template <typename AddrT, typename DeltaT>
+  void processCompressedRouteChanges(
+      RouterID id,
+      const DeltaT& delta,
+      CompressedFib<AddrT>* fib);
+  template <typename AddrT>
+  void programCompressedRoutes(RouterID id, CompressedFib<AddrT>* fib);
+
   void processAclChanges(const StateDelta& delta);
   void processChangedAcl(const std::shared_ptr<AclEntry>& oldAcl,
                          const std::shared_ptr<AclEntry>& newAcl);
@@ -541,8 +645,11 @@ class BcmSwitch : public BcmSwitchIf {
    * try to acquire BcmUnitLock and block since the link scan thread is
    * holding that lock.
    * Back traces from deadlocked process here https://phabricator.fb.com/P20042479
+   *
+   * Handles all the events queued in pendingLinkEvents_ by
+   * linkscanCallback since it last ran, in the order they arrived.
    */
-  void linkStateChangedHwNotLocked(opennsl_port_t port, bool up);
+  void linkStateChangedHwNotLocked();
 
   /*
    * For any actions that require a lock or might need to
@@ -696,6 +803,10 @@ class BcmSwitch : public BcmSwitchIf {
 
   MmuState queryMmuState() const;
   void exportDeviceBufferUsage();
+  // Hand the latest port counters to the sFlow exporters
+  void exportSflowCounters();
+  // Reprogram the ports the sFlow rate controller wants sampled differently
+  void adjustSflowSamplingRates();
 
   /*
    * Clear statistics for a list of ports.
@@ -741,12 +852,18 @@ class BcmSwitch : public BcmSwitchIf {
   bool fineGrainedBufferStatsEnabled_{false};
   uint64_t mmuBufferBytes_{0};
   uint64_t mmuCellBytes_{0};
+  std::unique_ptr<LatencyQuantiles> routeProgramLatency_;
   std::unique_ptr<BcmWarmBootCache> warmBootCache_;
   std::unique_ptr<BcmPortTable> portTable_;
   std::unique_ptr<BcmEgress> toCPUEgress_;
   std::unique_ptr<BcmIntfTable> intfTable_;
   std::unique_ptr<BcmHostTable> hostTable_;
   std::unique_ptr<BcmRouteTable> routeTable_;
+  std::map<RouterID, CompressedFib<folly::IPAddressV4>> compressedFibsV4_;
+  std::map<RouterID, CompressedFib<folly::IPAddressV6>> compressedFibsV6_;
+  // From --critical_route_prefixes
+  std::set<RoutePrefixV4> criticalRoutesV4_;
+  std::set<RoutePrefixV6> criticalRoutesV6_;
   std::unique_ptr<BcmAclTable> aclTable_;
   std::unique_ptr<BcmStatUpdater> bcmStatUpdater_;
   std::unique_ptr<BcmCosManager> cosManager_;
@@ -756,9 +873,24 @@ class BcmSwitch : public BcmSwitchIf {
   std::unique_ptr<BcmControlPlane> controlPlane_;
   std::unique_ptr<BcmRtag7LoadBalancer> rtag7LoadBalancer_;
   std::unique_ptr<BcmMirrorTable> mirrorTable_;
+  // Runs the independent sections of stateChangedImpl() concurrently, null
+  // to run them one after the other
+  std::unique_ptr<folly::CPUThreadPoolExecutor> stateChangeExecutor_;
+  // Declared after the tables it samples, so that it stops first
+  std::unique_ptr<BcmMicroburstMonitor> microburstMonitor_;
+  std::unique_ptr<BcmEcmpBalanceMonitor> ecmpBalanceMonitor_;
+  std::unique_ptr<BcmHashTracer> hashTracer_;
 
   std::unique_ptr<std::thread> linkScanBottomHalfThread_;
   folly::EventBase linkScanBottomHalfEventBase_;
+  /*
+   * Link state changes from the linkscan thread not yet handled by the
+   * bottom half, and whether a bottom half run is already scheduled to
+   * handle them.
+   */
+  std::mutex linkEventsLock_;
+  std::vector<std::pair<opennsl_port_t, bool>> pendingLinkEvents_;
+  bool linkEventsScheduled_{false};
 
   /*
    * TODO - Right now we setup copp using logic embedded in code.
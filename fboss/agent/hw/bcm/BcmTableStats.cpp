@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmTableStats.h"
+
+#include "fboss/agent/hw/bcm/BcmAclTable.h"
+#include "fboss/agent/hw/bcm/BcmHost.h"
+#include "fboss/agent/hw/bcm/BcmRoute.h"
+#include "fboss/agent/hw/bcm/BcmSwitch.h"
+
+namespace facebook { namespace fboss {
+
+void BcmHwTableStatManager::refreshEcmpSharingStats(BcmHwTableStats* stats) {
+  auto hostTable = hw_->getHostTable();
+  stats->l3_ecmp_groups_unique = hostTable->numEcmpEgress();
+  stats->l3_ecmp_groups_referenced = hostTable->numEcmpEgressReferences();
+  stats->l3_ecmp_paths_replicated = hostTable->numEcmpReplicatedPaths();
+  stats->l3_egress_duplicates = hostTable->numDuplicateEgresses();
+}
+
+void BcmHwTableStatManager::refreshAclCompilerStats(BcmHwTableStats* stats) {
+  const auto& compiled = hw_->getAclTable()->getCompiledAcls();
+  stats->acl_entries_shadowed = compiled.shadowed.size();
+  stats->acl_range_checkers_used = compiled.rangeCheckers.size();
+  stats->acl_ranges_expanded = compiled.expandedRanges.size();
+  stats->acl_tcam_entries_compiled = compiled.tcamEntries;
+}
+
+void BcmHwTableStatManager::refreshAlpmRouteStats(BcmHwTableStats* stats) {
+  if (!isAlpmEnabled_) {
+    return;
+  }
+  stats->l3_alpm_routes_reordered =
+      hw_->writableRouteTable()->numAlpmReorderedRoutes();
+}
+
+void BcmHwTableStatManager::refreshHostRouteStats(BcmHwTableStats* stats) {
+  stats->l3_host_routes_spilled =
+      hw_->writableRouteTable()->numSpilledHostRoutes();
+}
+
+}}
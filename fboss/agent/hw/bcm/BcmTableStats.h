@@ -24,6 +24,14 @@ class BcmHwTableStatManager {
       : hw_(hw), isAlpmEnabled_(isAlpmEnabled) {}
 
   void refresh(const StateDelta& delta, BcmHwTableStats* stats);
+  // ECMP group and egress sharing, tracked in SW by the host table
+  void refreshEcmpSharingStats(BcmHwTableStats* stats);
+  // ACL layout, as worked out by the acl compiler
+  void refreshAclCompilerStats(BcmHwTableStats* stats);
+  // How the route table laid out the routes for ALPM
+  void refreshAlpmRouteStats(BcmHwTableStats* stats);
+  // Host routes the host table had no room for
+  void refreshHostRouteStats(BcmHwTableStats* stats);
   void publish(BcmHwTableStats stats) const;
 
  private:
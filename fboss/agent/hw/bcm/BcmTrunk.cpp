@@ -15,7 +15,6 @@ extern "C" {
 #include <opennsl/trunk.h>
 }
 
-#include <folly/container/Enumerate.h>
 #include <folly/logging/xlog.h>
 #include <vector>
 
@@ -44,7 +43,7 @@ BcmTrunk::~BcmTrunk() {
   XLOG(INFO) << "deleted trunk " << bcmTrunkID_;
 }
 
-void BcmTrunk::init(const std::shared_ptr<AggregatePort>& aggPort) {
+int BcmTrunk::init(const std::shared_ptr<AggregatePort>& aggPort) {
   static int64_t nextAvailableTrunkID = 0;
   bcmTrunkID_ = nextAvailableTrunkID++;
   auto rv = opennsl_trunk_create(
@@ -61,18 +60,20 @@ void BcmTrunk::init(const std::shared_ptr<AggregatePort>& aggPort) {
   info.ipmc_index = OPENNSL_TRUNK_UNSPEC_INDEX;
   info.psc = BcmTrunk::rtag7();
 
-  vector<opennsl_trunk_member_t> members(aggPort->forwardingSubportCount());
+  vector<opennsl_trunk_member_t> members;
+  members.reserve(aggPort->forwardingSubportCount());
 
   PortID subport;
   AggregatePort::Forwarding fwdState;
 
-  for (auto it : folly::enumerate(aggPort->subportAndFwdState())) {
-    std::tie(subport, fwdState) = *it;
+  for (const auto& subportAndFwdState : aggPort->subportAndFwdState()) {
+    std::tie(subport, fwdState) = subportAndFwdState;
     if (fwdState == AggregatePort::Forwarding::DISABLED) {
       continue;
     }
-    opennsl_trunk_member_t_init(&members[it.index]);
-    members[it.index].gport =
+    members.emplace_back();
+    opennsl_trunk_member_t_init(&members.back());
+    members.back().gport =
         hw_->getPortTable()->getBcmPort(subport)->getBcmGport();
     trunkStats_.grantMembership(subport);
   }
@@ -84,46 +85,50 @@ void BcmTrunk::init(const std::shared_ptr<AggregatePort>& aggPort) {
   BcmTrunk::suppressTrunkInternalFlood(aggPort);
 
   trunkStats_.initialize(aggPort->getID(), aggPort->getName());
+  return members.size();
 }
 
-void BcmTrunk::program(
+int BcmTrunk::program(
     const std::shared_ptr<AggregatePort>& oldAggPort,
     const std::shared_ptr<AggregatePort>& newAggPort) {
-  programForwardingState(oldAggPort->subportAndFwdState(),
-                         newAggPort->subportAndFwdState());
+  auto delta = programForwardingState(
+      oldAggPort->subportAndFwdState(), newAggPort->subportAndFwdState());
 
   if (oldAggPort->getName() != newAggPort->getName()) {
     trunkStats_.initialize(newAggPort->getID(), newAggPort->getName());
   }
+  return delta;
 }
 
-void BcmTrunk::programForwardingState(
+int BcmTrunk::programForwardingState(
      AggregatePort::SubportAndForwardingStateConstRange oldRange,
      AggregatePort::SubportAndForwardingStateConstRange newRange) {
-  PortID oldSubport, newSubport;
-  AggregatePort::Forwarding oldFwdState, newFwdState;
-
-  for (auto newSubportAndFwdState : newRange) {
-    std::tie(newSubport, newFwdState) = newSubportAndFwdState;
-    auto oldSubportAndFwdStateIter = std::find_if(
-        oldRange.begin(),
-        oldRange.end(),
-        [newSubport](AggregatePort::SubportAndForwardingStateValueType val) {
-          return val.first == newSubport;
-        });
-    if (oldSubportAndFwdStateIter == oldRange.end()) {
-      continue;
-    }
-    std::tie(oldSubport, oldFwdState) = *oldSubportAndFwdStateIter;
-    CHECK_EQ(oldSubport, newSubport);
-    if (oldFwdState != newFwdState) {
-      modifyMemberPort(
-          newFwdState == AggregatePort::Forwarding::ENABLED, newSubport);
+  // Both ranges are sorted by PortID, so one merge pass pairs up the
+  // subports present in both. Only members whose forwarding state flipped
+  // are touched in hardware, each with a single member add or delete.
+  int delta = 0;
+  auto oldIt = oldRange.begin();
+  auto newIt = newRange.begin();
+  while (oldIt != oldRange.end() && newIt != newRange.end()) {
+    if (oldIt->first < newIt->first) {
+      ++oldIt;
+    } else if (newIt->first < oldIt->first) {
+      ++newIt;
+    } else {
+      if (oldIt->second != newIt->second) {
+        bool added = newIt->second == AggregatePort::Forwarding::ENABLED;
+        if (modifyMemberPort(added, newIt->first)) {
+          delta += added ? 1 : -1;
+        }
+      }
+      ++oldIt;
+      ++newIt;
     }
   }
+  return delta;
 }
 
-void BcmTrunk::modifyMemberPort(bool added, PortID memberPort) {
+bool BcmTrunk::modifyMemberPort(bool added, PortID memberPort) {
   opennsl_trunk_member_t member;
   opennsl_trunk_member_t_init(&member);
   member.gport = hw_->getPortTable()->getBcmPort(memberPort)->getBcmGport();
@@ -141,7 +146,7 @@ void BcmTrunk::modifyMemberPort(bool added, PortID memberPort) {
       // catching up to the hardware state
       XLOG(INFO) << "already deleted port " << memberPort << " from trunk "
                  << bcmTrunkID_;
-      return;
+      return false;
     }
     bcmCheckError(
         rv, "failed to delete port ", memberPort, " from trunk ", bcmTrunkID_);
@@ -149,9 +154,10 @@ void BcmTrunk::modifyMemberPort(bool added, PortID memberPort) {
                << bcmTrunkID_;
     trunkStats_.revokeMembership(memberPort);
   }
+  return true;
 }
 
-void BcmTrunk::shrinkTrunkGroupHwNotLocked(
+bool BcmTrunk::shrinkTrunkGroupHwNotLocked(
     int unit,
     opennsl_trunk_t trunk,
     opennsl_port_t toDisable) {
@@ -175,7 +181,7 @@ void BcmTrunk::shrinkTrunkGroupHwNotLocked(
   // mind, we ignore the OPENNSL_E_NOT_FOUND error code here and fail hard on
   // other error codes.
   if (rv == OPENNSL_E_NOT_FOUND) {
-    return;
+    return false;
   }
   bcmCheckError(
       rv,
@@ -187,6 +193,7 @@ void BcmTrunk::shrinkTrunkGroupHwNotLocked(
 
   XLOG(INFO) << "removed port " << toDisable << " from trunk " << trunk
              << " in interrupt context";
+  return true;
 }
 
 folly::Optional<opennsl_trunk_t>
@@ -36,12 +36,15 @@ class BcmTrunk {
 
   opennsl_trunk_t id() const { return bcmTrunkID_; }
 
-  void init(const std::shared_ptr<AggregatePort>& aggPort);
-  void program(
+  // Both return the number of member ports enabled (positive) or disabled
+  // (negative) in hardware
+  int init(const std::shared_ptr<AggregatePort>& aggPort);
+  int program(
       const std::shared_ptr<AggregatePort>& oldAggPort,
       const std::shared_ptr<AggregatePort>& newAggPort);
 
-  static void shrinkTrunkGroupHwNotLocked(
+  // Returns false if the update thread already removed the member
+  static bool shrinkTrunkGroupHwNotLocked(
       int unit,
       opennsl_trunk_t trunk,
       opennsl_port_t toDisable);
@@ -60,10 +63,11 @@ private:
   static int rtag7();
   void suppressTrunkInternalFlood(
     const std::shared_ptr<AggregatePort>& aggPort);
-  void programForwardingState(
+  int programForwardingState(
       AggregatePort::SubportAndForwardingStateConstRange oldRange,
       AggregatePort::SubportAndForwardingStateConstRange newRange);
-  void modifyMemberPort(bool added, PortID memberPort);
+  // Returns whether the membership in hardware changed
+  bool modifyMemberPort(bool added, PortID memberPort);
 
   // Forbidden copy constructor and assignment operator
   BcmTrunk(const BcmTrunk&) = delete;
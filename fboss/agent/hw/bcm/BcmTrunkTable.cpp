@@ -53,7 +53,7 @@ void BcmTrunkTable::setupTrunking() {
 
 void BcmTrunkTable::addTrunk(const std::shared_ptr<AggregatePort>& aggPort) {
   auto trunk = std::make_unique<BcmTrunk>(hw_);
-  trunk->init(aggPort);
+  auto enabledMembers = trunk->init(aggPort);
   auto trunkID = trunk->id();
 
   bool inserted;
@@ -68,6 +68,7 @@ void BcmTrunkTable::addTrunk(const std::shared_ptr<AggregatePort>& aggPort) {
   }
 
   trunkToMinLinkCount_.addOrUpdate(trunkID, aggPort->getMinimumLinkCount());
+  trunkToMinLinkCount_.setEnabledMemberCount(trunkID, enabledMembers);
 }
 
 void BcmTrunkTable::programTrunk(
@@ -83,9 +84,10 @@ void BcmTrunkTable::programTrunk(
         ": no corresponding trunk");
   }
 
-  it->second->program(oldAggPort, newAggPort);
+  auto delta = it->second->program(oldAggPort, newAggPort);
   trunkToMinLinkCount_.addOrUpdate(
       it->second->id(), newAggPort->getMinimumLinkCount());
+  trunkToMinLinkCount_.adjustEnabledMemberCount(it->second->id(), delta);
 }
 
 void BcmTrunkTable::deleteTrunk(const std::shared_ptr<AggregatePort>& aggPort) {
@@ -120,20 +122,23 @@ opennsl_trunk_t BcmTrunkTable::linkDownHwNotLocked(opennsl_port_t port) {
   auto trunk = *maybeTrunk;
   XLOG(INFO) << "Found trunk " << trunk << " for port " << port;
 
-  // Note that getEnabledMemberPortsCountHwNotLocked() must be invoked before
-  // shrinkTrunkGroupHwNotLocked()
-  auto count = BcmTrunk::getEnabledMemberPortsCountHwNotLocked(
-      hw_->getUnit(), trunk, port);
-  XLOG(INFO) << count << " member ports enabled in trunk " << trunk;
-  BcmTrunk::shrinkTrunkGroupHwNotLocked(hw_->getUnit(), trunk, port);
-
+  // The member count is tracked as members are added and removed, so it is
+  // read before this member is shrunk out of the trunk below
+  auto maybeCount = trunkToMinLinkCount_.getEnabledMemberCount(trunk);
   auto maybeMinLinkCount = trunkToMinLinkCount_.get(trunk);
-  if (!maybeMinLinkCount) {
+  if (!maybeCount || !maybeMinLinkCount) {
     XLOG(WARNING) << "Trunk " << trunk
                   << " removed out from underneath linkscan thread";
+    BcmTrunk::shrinkTrunkGroupHwNotLocked(hw_->getUnit(), trunk, port);
     return facebook::fboss::BcmTrunk::INVALID;
   }
+  auto count = *maybeCount;
   auto minLinkCount = *maybeMinLinkCount;
+  XLOG(INFO) << count << " member ports enabled in trunk " << trunk;
+
+  if (BcmTrunk::shrinkTrunkGroupHwNotLocked(hw_->getUnit(), trunk, port)) {
+    trunkToMinLinkCount_.adjustEnabledMemberCount(trunk, -1);
+  }
 
   if (count > minLinkCount) { // (1.b)
     return facebook::fboss::BcmTrunk::INVALID;
@@ -11,67 +11,69 @@
 
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmStats.h"
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
 
+#include <gflags/gflags.h>
 
 extern "C" {
 #include <opennsl/tx.h>
 }
 
+DEFINE_int32(tx_max_inflight_per_cos, 1024,
+             "Most packets of one CoS handed to the SDK and not sent yet, "
+             "more are refused until some are done. 0 for no limit.");
+
 using folly::IOBuf;
 using std::unique_ptr;
 
 namespace {
-
-using namespace facebook::fboss;
-void freeTxBuf(void* /*ptr*/, void* arg) {
-  opennsl_pkt_t* pkt = reinterpret_cast<opennsl_pkt_t*>(arg);
-  int rv = opennsl_pkt_free(pkt->unit, pkt);
-  bcmLogError(rv, "Failed to free packet");
-  BcmStats::get()->txPktFree();
+using TxBatch = std::vector<unique_ptr<facebook::fboss::BcmTxPacket>>;
 }
 
-inline void txCallbackImpl(int /*unit*/, opennsl_pkt_t* pkt, void* cookie) {
-  // Put the BcmTxPacket back into a unique_ptr.
-  // This will delete it when we return.
-  unique_ptr<facebook::fboss::BcmTxPacket> bcmTxPkt(
-      static_cast<facebook::fboss::BcmTxPacket*>(cookie));
-  DCHECK_EQ(pkt, bcmTxPkt->getPkt());
-
-  // Now we reset the pkt buffer back to what was originally allocated
-  pkt->pkt_data->data = bcmTxPkt->buf()->writableBuffer();
+namespace facebook { namespace fboss {
 
-  auto end = std::chrono::steady_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-      end - bcmTxPkt->getQueueTime());
-  BcmStats::get()->txSentDone(duration.count());
-}
+std::atomic<uint32_t>& BcmTxPacket::inFlight(uint8_t cos) {
+  static std::atomic<uint32_t> inFlight[BcmStats::kNumTxCos];
+  return inFlight[BcmStats::txCosIndex(cos)];
 }
 
-namespace facebook { namespace fboss {
-
-std::mutex& BcmTxPacket::syncPktMutex() {
-  static std::mutex _syncPktMutex;
-  return _syncPktMutex;
+bool BcmTxPacket::reserveInFlight(uint8_t cos) {
+  auto& count = inFlight(cos);
+  auto prev = count.fetch_add(1, std::memory_order_relaxed);
+  if (FLAGS_tx_max_inflight_per_cos > 0 &&
+      prev >= static_cast<uint32_t>(FLAGS_tx_max_inflight_per_cos)) {
+    count.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
 }
 
-std::condition_variable& BcmTxPacket::syncPktCV() {
-  static std::condition_variable _syncPktCV;
-  return _syncPktCV;
+void BcmTxPacket::releaseInFlight(uint8_t cos) {
+  inFlight(cos).fetch_sub(1, std::memory_order_relaxed);
 }
 
-bool& BcmTxPacket::syncPacketSent() {
-  static bool _syncPktSent{false};
-  return _syncPktSent;
+void BcmTxPacket::txDone(unique_ptr<BcmTxPacket> bcmTxPkt) {
+  // Now we reset the pkt buffer back to what was originally allocated
+  bcmTxPkt->getPkt()->pkt_data->data = bcmTxPkt->buf()->writableBuffer();
+
+  auto cos = bcmTxPkt->getPkt()->cos;
+  releaseInFlight(cos);
+  auto end = std::chrono::steady_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      end - bcmTxPkt->getQueueTime());
+  BcmStats::get()->txSentDone(duration.count(), cos);
+  if (bcmTxPkt->completion_) {
+    bcmTxPkt->completion_->setValue();
+  }
 }
 
 BcmTxPacket::BcmTxPacket(int unit, uint32_t size)
     : queued_(std::chrono::time_point<std::chrono::steady_clock>::min()) {
-  int rv = opennsl_pkt_alloc(unit, size,
-                             OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER, &pkt_);
-  bcmCheckError(rv, "Failed to allocate packet.");
-  buf_ = IOBuf::takeOwnership(pkt_->pkt_data->data, size,
-                              freeTxBuf, reinterpret_cast<void*>(pkt_));
-  BcmStats::get()->txPktAlloc();
+  // The buffer goes back to the pool once the last IOBuf using it is gone
+  auto buffer = BcmTxPacketPool::get()->allocate(unit, size);
+  pkt_ = buffer->pkt;
+  buf_ = IOBuf::takeOwnership(buffer->data, buffer->capacity, size,
+                              BcmTxPacketPool::freeBuffer, buffer);
 }
 
 void BcmTxPacket::enableHiGigHeader() {
@@ -81,44 +83,62 @@ void BcmTxPacket::enableHiGigHeader() {
   pkt_->flags &= ~OPENNSL_TX_ETHER;
 }
 
-inline int BcmTxPacket::sendImpl(unique_ptr<BcmTxPacket> pkt) noexcept {
-  opennsl_pkt_t* bcmPkt = pkt->pkt_;
-  const auto buf = pkt->buf();
+inline void BcmTxPacket::prepareTx() {
+  const auto buf = this->buf();
 
   // TODO(aeckert): Setting the pkt len manually should be replaced in future
   // releases of opennsl with OPENNSL_PKT_TX_LEN_SET or opennsl_flags_len_setup
-  DCHECK(bcmPkt->pkt_data);
-  bcmPkt->pkt_data->len = buf->length();
+  DCHECK(pkt_->pkt_data);
+  pkt_->pkt_data->len = buf->length();
 
   // Now we also set the buffer that will be sent out to point at
   // buf->writableBuffer in case there is unused header space in the IOBuf
-  bcmPkt->pkt_data->data = buf->writableData();
+  pkt_->pkt_data->data = buf->writableData();
+
+  queued_ = std::chrono::steady_clock::now();
+}
+
+inline void BcmTxPacket::updateTxStats(int rv, size_t numPkts) {
+  if (OPENNSL_SUCCESS(rv)) {
+    for (size_t i = 0; i < numPkts; ++i) {
+      BcmStats::get()->txSent();
+    }
+    return;
+  }
+  bcmLogError(rv, "failed to send packet");
+  if (rv == OPENNSL_E_MEMORY) {
+    BcmStats::get()->txPktAllocErrors();
+  } else if (rv) {
+    BcmStats::get()->txError();
+  }
+}
 
-  pkt->queued_ = std::chrono::steady_clock::now();
+inline int BcmTxPacket::sendImpl(unique_ptr<BcmTxPacket> pkt) noexcept {
+  opennsl_pkt_t* bcmPkt = pkt->pkt_;
+  if (!reserveInFlight(bcmPkt->cos)) {
+    BcmStats::get()->txPktBackpressured(1);
+    return OPENNSL_E_RESOURCE;
+  }
+  pkt->prepareTx();
   auto rv = opennsl_tx(bcmPkt->unit, bcmPkt, pkt.get());
   if (OPENNSL_SUCCESS(rv)) {
     pkt.release();
-    BcmStats::get()->txSent();
   } else {
-    bcmLogError(rv, "failed to send packet");
-    if (rv == OPENNSL_E_MEMORY) {
-      BcmStats::get()->txPktAllocErrors();
-    } else if (rv) {
-      BcmStats::get()->txError();
-    }
+    releaseInFlight(bcmPkt->cos);
   }
+  updateTxStats(rv, 1);
   return rv;
 }
 
-void BcmTxPacket::txCallbackAsync(int unit, opennsl_pkt_t* pkt, void* cookie) {
-  txCallbackImpl(unit, pkt, cookie);
-}
-
-void BcmTxPacket::txCallbackSync(int unit, opennsl_pkt_t* pkt, void* cookie) {
-  txCallbackImpl(unit, pkt, cookie);
-  std::lock_guard<std::mutex> lk(syncPktMutex());
-  syncPacketSent() = true;
-  syncPktCV().notify_one();
+void BcmTxPacket::txCallbackAsync(
+    int /*unit*/,
+    opennsl_pkt_t* pkt,
+    void* cookie) {
+  // Put the BcmTxPacket back into a unique_ptr.
+  // This will delete it when we return.
+  unique_ptr<BcmTxPacket> bcmTxPkt(static_cast<BcmTxPacket*>(cookie));
+  DCHECK_EQ(pkt, bcmTxPkt->getPkt());
+  txDone(std::move(bcmTxPkt));
 }
 
 int BcmTxPacket::sendAsync(unique_ptr<BcmTxPacket> pkt) noexcept {
@@ -128,14 +148,85 @@ int BcmTxPacket::sendAsync(unique_ptr<BcmTxPacket> pkt) noexcept {
   return sendImpl(std::move(pkt));
 }
 
+void BcmTxPacket::txCallbackBatch(
+    int /*unit*/,
+    opennsl_pkt_t* /*pkt*/,
+    void* cookie) {
+  // Called once the SDK is done with every packet of the batch
+  unique_ptr<TxBatch> batch(static_cast<TxBatch*>(cookie));
+  for (auto& bcmTxPkt : *batch) {
+    txDone(std::move(bcmTxPkt));
+  }
+}
+
+int BcmTxPacket::sendAsync(std::vector<unique_ptr<BcmTxPacket>> pkts) noexcept {
+  if (pkts.empty()) {
+    return OPENNSL_E_NONE;
+  }
+  if (pkts.size() == 1) {
+    return sendAsync(std::move(pkts.front()));
+  }
+  auto unit = pkts.front()->pkt_->unit;
+  std::vector<opennsl_pkt_t*> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  auto releaseAll = [&]() {
+    for (auto bcmPkt : bcmPkts) {
+      releaseInFlight(bcmPkt->cos);
+    }
+  };
+  for (auto& pkt : pkts) {
+    opennsl_pkt_t* bcmPkt = pkt->pkt_;
+    DCHECK(bcmPkt->call_back == nullptr);
+    DCHECK_EQ(bcmPkt->unit, unit);
+    // The whole batch is refused if it doesn't fit
+    if (!reserveInFlight(bcmPkt->cos)) {
+      releaseAll();
+      BcmStats::get()->txPktBackpressured(pkts.size());
+      return OPENNSL_E_RESOURCE;
+    }
+    pkt->prepareTx();
+    bcmPkts.push_back(bcmPkt);
+  }
+
+  // The batch is handed to the SDK as the cookie of the all done callback,
+  // which takes care of deleting it.
+  auto batch = std::make_unique<TxBatch>(std::move(pkts));
+  auto rv = opennsl_tx_array(
+      unit,
+      bcmPkts.data(),
+      bcmPkts.size(),
+      BcmTxPacket::txCallbackBatch,
+      batch.get());
+  if (OPENNSL_SUCCESS(rv)) {
+    batch.release();
+  } else {
+    releaseAll();
+  }
+  updateTxStats(rv, bcmPkts.size());
+  return rv;
+}
+
+folly::Future<folly::Unit> BcmTxPacket::sendAsyncWithCompletion(
+    unique_ptr<BcmTxPacket> pkt) noexcept {
+  pkt->completion_ = std::make_unique<folly::Promise<folly::Unit>>();
+  auto done = pkt->completion_->getFuture();
+  auto rv = sendAsync(std::move(pkt));
+  if (OPENNSL_FAILURE(rv)) {
+    return folly::makeFuture<folly::Unit>(
+        BcmError(rv, "failed to send packet"));
+  }
+  return done;
+}
+
 int BcmTxPacket::sendSync(unique_ptr<BcmTxPacket> pkt) noexcept {
-  opennsl_pkt_t* bcmPkt = pkt->pkt_;
-  DCHECK(bcmPkt->call_back == nullptr);
-  bcmPkt->call_back = BcmTxPacket::txCallbackSync;
-  std::unique_lock<std::mutex> lock{syncPktMutex()};
-  syncPacketSent() = false;
-  auto rv = sendImpl(std::move(pkt));
-  syncPktCV().wait(lock, [] { return syncPacketSent(); });
+  auto done = sendAsyncWithCompletion(std::move(pkt));
+  done.wait();
+  if (!done.hasException()) {
+    return OPENNSL_E_NONE;
+  }
+  int rv = OPENNSL_E_INTERNAL;
+  done.getTry().exception().with_exception(
+      [&](const BcmError& ex) { rv = ex.getBcmError(); });
   return rv;
 }
 
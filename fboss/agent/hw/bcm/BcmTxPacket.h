@@ -9,9 +9,12 @@
  */
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <mutex>
-#include <condition_variable>
+#include <memory>
+#include <vector>
+
+#include <folly/futures/Future.h>
 
 #include "fboss/agent/TxPacket.h"
 
@@ -61,6 +64,22 @@ class BcmTxPacket : public TxPacket {
    * Returns an OpenNSL error code.
    */
   static int sendAsync(std::unique_ptr<BcmTxPacket> pkt) noexcept;
+  /*
+   * Send several BcmTxPackets asynchronously, with a single call into the
+   * SDK. All the packets must belong to the same unit.
+   *
+   * The packets are deleted once the SDK is done sending all of them.
+   *
+   * Returns an OpenNSL error code. On error, none of the packets were sent.
+   */
+  static int sendAsync(std::vector<std::unique_ptr<BcmTxPacket>> pkts) noexcept;
+  /*
+   * Send a BcmTxPacket asynchronously, like sendAsync(), and get a future
+   * completed once the SDK is done sending it, or failed with a BcmError
+   * if it couldn't be sent.
+   */
+  static folly::Future<folly::Unit> sendAsyncWithCompletion(
+      std::unique_ptr<BcmTxPacket> pkt) noexcept;
   /*
    * Send a BcmTxPacket synchronously.
    *
@@ -75,20 +94,30 @@ class BcmTxPacket : public TxPacket {
 
  private:
   inline static int sendImpl(std::unique_ptr<BcmTxPacket> pkt) noexcept;
+  inline void prepareTx();
+  inline static void updateTxStats(int rv, size_t numPkts);
+  static void txDone(std::unique_ptr<BcmTxPacket> pkt);
   static void txCallbackAsync(int unit, opennsl_pkt_t* pkt, void* cookie);
-  static void txCallbackSync(int unit, opennsl_pkt_t* pkt, void* cookie);
+  static void txCallbackBatch(int unit, opennsl_pkt_t* pkt, void* cookie);
+
+  /*
+   * The packets of each CoS the SDK holds and hasn't sent yet. A
+   * send that would take this beyond FLAGS_tx_max_inflight_per_cos is
+   * refused with OPENNSL_E_RESOURCE, so that a burst pushes back on the
+   * sender instead of piling up in the SDK's TX queues.
+   */
+  static std::atomic<uint32_t>& inFlight(uint8_t cos);
+  static bool reserveInFlight(uint8_t cos);
+  static void releaseInFlight(uint8_t cos);
 
   // Forbidden copy constructor and assignment operator
   BcmTxPacket(BcmTxPacket const &) = delete;
   BcmTxPacket& operator=(BcmTxPacket const &) = delete;
   void enableHiGigHeader();
 
-  // Synchronization around synchrnous packet sending
-  static std::mutex& syncPktMutex();
-  static std::condition_variable& syncPktCV();
-  static bool& syncPacketSent();
-
   opennsl_pkt_t* pkt_{nullptr};
+  // Set for the packets sent with sendAsyncWithCompletion()
+  std::unique_ptr<folly::Promise<folly::Unit>> completion_;
 
   // time point when the packet is queued to HW
   TimePoint queued_;
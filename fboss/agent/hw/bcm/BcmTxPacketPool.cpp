@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
+
+#include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmStats.h"
+
+namespace {
+
+const uint32_t kTxFlags = OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER;
+
+struct SizeClassConfig {
+  uint32_t size;
+  size_t maxFree;
+};
+
+// Control packets and small L3 packets, standard MTU frames and jumbo
+// frames from the tun interfaces
+const SizeClassConfig kSizeClasses[] = {
+    {256, 256},
+    {1536, 128},
+    {9216, 16},
+};
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+BcmTxPacketPool* BcmTxPacketPool::get() {
+  // Never destroyed: the SDK may well be gone by the time static objects
+  // are, and freeing the buffers is left to stop()
+  static auto pool = new BcmTxPacketPool();
+  return pool;
+}
+
+BcmTxPacketPool::Buffer* BcmTxPacketPool::allocate(int unit, uint32_t size) {
+  auto capacity = size;
+  auto sizeClass = -1;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto it = units_.find(unit);
+    if (it != units_.end()) {
+      auto& classes = it->second;
+      for (size_t i = 0; i < classes.size(); ++i) {
+        if (size > classes[i].size) {
+          continue;
+        }
+        if (!classes[i].free.empty()) {
+          auto buffer = classes[i].free.back();
+          classes[i].free.pop_back();
+          BcmStats::get()->txPktReused();
+          return buffer;
+        }
+        capacity = classes[i].size;
+        sizeClass = i;
+        break;
+      }
+    }
+  }
+
+  opennsl_pkt_t* pkt;
+  auto rv = opennsl_pkt_alloc(unit, capacity, kTxFlags, &pkt);
+  bcmCheckError(rv, "Failed to allocate packet.");
+  BcmStats::get()->txPktAlloc();
+  return new Buffer{pkt, pkt->pkt_data->data, capacity, sizeClass};
+}
+
+void BcmTxPacketPool::freeBuffer(void* /*data*/, void* buffer) {
+  get()->release(static_cast<Buffer*>(buffer));
+}
+
+void BcmTxPacketPool::release(Buffer* buffer) {
+  auto pkt = buffer->pkt;
+  if (buffer->sizeClass >= 0) {
+    std::lock_guard<std::mutex> g(lock_);
+    auto it = units_.find(pkt->unit);
+    if (it != units_.end()) {
+      auto& sizeClass = it->second[buffer->sizeClass];
+      if (sizeClass.free.size() < sizeClass.maxFree) {
+        // Undo whatever the packet it was used for changed
+        pkt->pkt_data->data = buffer->data;
+        pkt->pkt_data->len = buffer->capacity;
+        pkt->flags = kTxFlags;
+        pkt->cos = 0;
+        pkt->call_back = nullptr;
+        OPENNSL_PBMP_CLEAR(pkt->tx_pbmp);
+        OPENNSL_PBMP_CLEAR(pkt->tx_upbmp);
+        sizeClass.free.push_back(buffer);
+        return;
+      }
+    }
+  }
+  freeToSdk(buffer);
+}
+
+void BcmTxPacketPool::freeToSdk(Buffer* buffer) {
+  auto pkt = buffer->pkt;
+  pkt->pkt_data->data = buffer->data;
+  int rv = opennsl_pkt_free(pkt->unit, pkt);
+  bcmLogError(rv, "Failed to free packet");
+  BcmStats::get()->txPktFree();
+  delete buffer;
+}
+
+void BcmTxPacketPool::start(int unit) {
+  std::lock_guard<std::mutex> g(lock_);
+  auto& classes = units_[unit];
+  if (!classes.empty()) {
+    return;
+  }
+  for (const auto& config : kSizeClasses) {
+    classes.push_back(SizeClass{config.size, config.maxFree, {}});
+  }
+}
+
+void BcmTxPacketPool::stop(int unit) {
+  SizeClasses classes;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto it = units_.find(unit);
+    if (it == units_.end()) {
+      return;
+    }
+    classes = std::move(it->second);
+    units_.erase(it);
+  }
+  // The buffers still in use are freed as they come back
+  for (auto& sizeClass : classes) {
+    for (auto buffer : sizeClass.free) {
+      freeToSdk(buffer);
+    }
+  }
+}
+
+}} // facebook::fboss
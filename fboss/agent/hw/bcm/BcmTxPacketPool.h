@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <opennsl/pkt.h>
+#include <opennsl/types.h>
+}
+
+namespace facebook { namespace fboss {
+
+/*
+ * Recycles the DMA buffers of BcmTxPackets.
+ *
+ * Allocating a TX packet from the SDK takes a trip through its DMA
+ * allocator, and the control plane sends a steady stream of small packets
+ * (ARP, NDP, LACP, BGP and the like through the tun interfaces). Instead
+ * the packets are rounded up to a few size classes, and once the SDK is
+ * done sending one, or it is dropped without being sent, its buffer is
+ * kept on the free list of its class for the next packet that size.
+ *
+ * Each class keeps a bounded number of free buffers, beyond which they are
+ * freed as before, as are the packets larger than the largest class.
+ * Pooling only happens for the units between start() and stop(), so that
+ * no buffer is handed out again once its unit is going away.
+ */
+class BcmTxPacketPool {
+ public:
+  /*
+   * A DMA buffer from the pool, the IOBuf user data of the packet it is
+   * used for.
+   */
+  struct Buffer {
+    opennsl_pkt_t* pkt;
+    // The start of the packet data as allocated, the SDK packet is pointed
+    // elsewhere while it is being sent
+    uint8_t* data;
+    uint32_t capacity;
+    // Index of the size class, -1 if the buffer is not pooled
+    int sizeClass;
+  };
+
+  static BcmTxPacketPool* get();
+
+  // A buffer for a packet of at least size bytes on unit
+  Buffer* allocate(int unit, uint32_t size);
+
+  /*
+   * Takes back a buffer from allocate(); the IOBuf free function of the
+   * packets, so that the buffer comes back whenever the last IOBuf
+   * referring to it goes away.
+   */
+  static void freeBuffer(void* data, void* buffer);
+
+  // Start pooling the buffers of unit
+  void start(int unit);
+  // Free the pooled buffers of unit, and stop pooling them
+  void stop(int unit);
+
+ private:
+  // Free buffers of one size class
+  struct SizeClass {
+    uint32_t size;
+    size_t maxFree;
+    std::vector<Buffer*> free;
+  };
+  using SizeClasses = std::vector<SizeClass>;
+
+  BcmTxPacketPool() {}
+  // Forbidden copy constructor and assignment operator
+  BcmTxPacketPool(BcmTxPacketPool const&) = delete;
+  BcmTxPacketPool& operator=(BcmTxPacketPool const&) = delete;
+
+  void release(Buffer* buffer);
+  static void freeToSdk(Buffer* buffer);
+
+  std::mutex lock_;
+  // The units pooling their buffers
+  std::unordered_map<int, SizeClasses> units_;
+};
+
+}} // facebook::fboss
@@ -10,6 +10,10 @@
 #include "BcmWarmBootCache.h"
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <string>
 #include <utility>
 
@@ -23,6 +27,7 @@
 #include "fboss/agent/hw/bcm/BcmAclTable.h"
 #include "fboss/agent/hw/bcm/BcmEgress.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmHost.h"
 #include "fboss/agent/hw/bcm/BcmPlatform.h"
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootHelper.h"
@@ -53,6 +58,9 @@ using folly::IPAddress;
 using folly::MacAddress;
 using boost::container::flat_map;
 using boost::container::flat_set;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
 using namespace facebook::fboss;
 
 namespace {
@@ -76,6 +84,13 @@ folly::IPAddress getFullMaskIPv6Address() {
   return folly::IPAddress(folly::IPAddressV6(
       folly::IPAddressV6::fetchMask(folly::IPAddressV6::bitCount())));
 }
+
+// Run fn and return how long it took, in seconds
+float timePhase(const std::function<void()>& fn) {
+  auto begin = steady_clock::now();
+  fn();
+  return duration_cast<duration<float>>(steady_clock::now() - begin).count();
+}
 }
 
 namespace facebook { namespace fboss {
@@ -324,6 +339,9 @@ void BcmWarmBootCache::populateFromWarmBootState(const folly::dynamic&
   for (auto& ecmpIdAndEgress : hwSwitchEcmp2EgressIds_) {
     XLOG(DBG1) << ecmpIdAndEgress.first << " (from warmboot file) ==> "
                << toEgressIdsStr(ecmpIdAndEgress.second);
+    // Link down handling needs to shrink these too
+    hw_->writableHostTable()->ecmpMembersAdded(
+        ecmpIdAndEgress.first, ecmpIdAndEgress.second);
   }
 
   // Extract BcmHost and its egress object from the warm boot file
@@ -383,11 +401,68 @@ BcmWarmBootCache::findEgressFromHost(
 }
 
 void BcmWarmBootCache::populate(folly::Optional<folly::dynamic> warmBootState) {
-  if (warmBootState) {
-    populateFromWarmBootState(*warmBootState);
-  } else {
-    populateFromWarmBootState(getWarmBootState());
+  auto begin = steady_clock::now();
+  populateTimes_.clear();
+  // The egress and ecmp traversals below look up the egress ids found in
+  // the warm boot state, so this needs to be done first.
+  populateTimes_.emplace_back("warm_boot_state", timePhase([&] {
+    if (warmBootState) {
+      populateFromWarmBootState(*warmBootState);
+    } else {
+      populateFromWarmBootState(getWarmBootState());
+    }
+  }));
+
+  opennsl_l3_info_t l3Info;
+  opennsl_l3_info_t_init(&l3Info);
+  opennsl_l3_info(hw_->getUnit(), &l3Info);
+  vrfIp2Host_.reserve(l3Info.l3info_used_host);
+  vrfPrefix2Route_.reserve(l3Info.l3info_used_route);
+  egressId2Egress_.reserve(egressIdsFromBcmHostInWarmBootFile_.size());
+
+  // Each table type is traversed by its own thread. The traversals only read
+  // the state populated above, and each of them writes a disjoint set of
+  // cache containers, so they need no synchronization among themselves. The
+  // SDK itself serializes concurrent calls into the same module as needed.
+  auto traverse = [](const char* name, std::function<void()> fn) {
+    return std::async(std::launch::async, [name, fn]() {
+      return std::make_pair(std::string(name), timePhase(fn));
+    });
+  };
+  std::vector<std::future<std::pair<std::string, float>>> phases;
+  phases.push_back(traverse("hosts", [&] { populateHosts(l3Info); }));
+  phases.push_back(traverse("routes", [&] { populateRoutes(l3Info); }));
+  phases.push_back(traverse("egress", [this] { populateEgress(); }));
+  phases.push_back(traverse("ecmp_egress", [this] { populateEcmpEgress(); }));
+  phases.push_back(traverse("acls", [this] {
+    populateAcls(kACLFieldGroupID, this->aclRange2BcmAclRangeHandle_,
+      this->aclEntry2AclStat_,
+      this->priority2BcmAclEntryHandle_);
+  }));
+  phases.push_back(traverse("rtag7", [this] { populateRtag7State(); }));
+  populateTimes_.emplace_back("vlans", timePhase([this] { populateVlans(); }));
+  // Collect all the results before rethrowing any error, so that no
+  // traversal is still running when we unwind.
+  std::exception_ptr error;
+  for (auto& phase : phases) {
+    try {
+      populateTimes_.push_back(phase.get());
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
+  populateTimes_.emplace_back("total",
+      duration_cast<duration<float>>(steady_clock::now() - begin).count());
+  for (const auto& phaseTime : populateTimes_) {
+    XLOG(DBG1) << "Warm boot cache " << phaseTime.first << " populated in "
+               << phaseTime.second << " seconds";
+  }
+}
+
+void BcmWarmBootCache::populateVlans() {
   opennsl_vlan_data_t* vlanList = nullptr;
   int vlanCount = 0;
   SCOPE_EXIT {
@@ -438,9 +513,9 @@ void BcmWarmBootCache::populate(folly::Optional<folly::dynamic> warmBootState) {
       }
     }
   }
-  opennsl_l3_info_t l3Info;
-  opennsl_l3_info_t_init(&l3Info);
-  opennsl_l3_info(hw_->getUnit(), &l3Info);
+}
+
+void BcmWarmBootCache::populateHosts(const opennsl_l3_info_t& l3Info) {
   // Traverse V4 hosts
   opennsl_l3_host_traverse(hw_->getUnit(), 0, 0, l3Info.l3info_max_host,
       hostTraversalCallback, this);
@@ -449,6 +524,9 @@ void BcmWarmBootCache::populate(folly::Optional<folly::dynamic> warmBootState) {
       // Diag shell uses this for getting # of v6 host entries
       l3Info.l3info_max_host / 2,
       hostTraversalCallback, this);
+}
+
+void BcmWarmBootCache::populateRoutes(const opennsl_l3_info_t& l3Info) {
   // Traverse V4 routes
   opennsl_l3_route_traverse(hw_->getUnit(), 0, 0, l3Info.l3info_max_route,
       routeTraversalCallback, this);
@@ -457,18 +535,15 @@ void BcmWarmBootCache::populate(folly::Optional<folly::dynamic> warmBootState) {
       // Diag shell uses this for getting # of v6 route entries
       l3Info.l3info_max_route / 2,
       routeTraversalCallback, this);
-  // Get egress entries.
+}
+
+void BcmWarmBootCache::populateEgress() {
   opennsl_l3_egress_traverse(hw_->getUnit(), egressTraversalCallback, this);
-  // Traverse ecmp egress entries
+}
+
+void BcmWarmBootCache::populateEcmpEgress() {
   opennsl_l3_egress_ecmp_traverse(hw_->getUnit(), ecmpEgressTraversalCallback,
       this);
-
-  // populate acls, acl stats and acl ranges
-  populateAcls(kACLFieldGroupID, this->aclRange2BcmAclRangeHandle_,
-    this->aclEntry2AclStat_,
-    this->priority2BcmAclEntryHandle_);
-
-  populateRtag7State();
 }
 
 bool BcmWarmBootCache::fillVlanPortInfo(Vlan* vlan) {
@@ -638,53 +713,69 @@ std::string BcmWarmBootCache::toEgressIdsStr(const EgressIds& egressIds) {
   return ss.str();
 }
 
-void BcmWarmBootCache::clear() {
-  // Get rid of all unclaimed entries. The order is important here
-  // since we want to delete entries only after there are no more
-  // references to them.
-  XLOG(DBG1) << "Warm boot: removing unreferenced entries";
-  dumpedSwSwitchState_.reset();
-  hwSwitchEcmp2EgressIds_.clear();
-  // First delete routes (fully qualified and others).
-  //
+bool BcmWarmBootCache::clearSome(size_t maxEntries) {
   // Nothing references routes, but routes reference ecmp egress and egress
-  // entries which are deleted later
-  for (auto vrfPfxAndRoute : vrfPrefix2Route_) {
+  // entries which are deleted later, in clear()
+  for (; maxEntries > 0 && !vrfPrefix2Route_.empty(); --maxEntries) {
+    auto vrfPfxAndRoute = vrfPrefix2Route_.begin();
     XLOG(DBG1) << "Deleting unreferenced route in vrf:"
-               << std::get<0>(vrfPfxAndRoute.first)
-               << " for prefix : " << std::get<1>(vrfPfxAndRoute.first) << "/"
-               << std::get<2>(vrfPfxAndRoute.first);
-    auto rv = opennsl_l3_route_delete(hw_->getUnit(), &(vrfPfxAndRoute.second));
+               << std::get<0>(vrfPfxAndRoute->first)
+               << " for prefix : " << std::get<1>(vrfPfxAndRoute->first) << "/"
+               << std::get<2>(vrfPfxAndRoute->first);
+    auto rv =
+        opennsl_l3_route_delete(hw_->getUnit(), &(vrfPfxAndRoute->second));
     bcmLogFatal(rv, hw_, "failed to delete unreferenced route in vrf:",
-        std::get<0>(vrfPfxAndRoute.first) , " for prefix : " ,
-        std::get<1>(vrfPfxAndRoute.first) , "/" ,
-        std::get<2>(vrfPfxAndRoute.first));
-  }
-  vrfPrefix2Route_.clear();
-  for (auto vrfIPAndRoute: vrfAndIP2Route_) {
+        std::get<0>(vrfPfxAndRoute->first) , " for prefix : " ,
+        std::get<1>(vrfPfxAndRoute->first) , "/" ,
+        std::get<2>(vrfPfxAndRoute->first));
+    vrfPrefix2Route_.erase(vrfPfxAndRoute);
+    ++numStaleEntriesRemoved_;
+  }
+  for (; maxEntries > 0 && !vrfAndIP2Route_.empty(); --maxEntries) {
+    auto vrfIPAndRoute = vrfAndIP2Route_.begin();
     XLOG(DBG1) << "Deleting fully qualified unreferenced route in vrf: "
-               << vrfIPAndRoute.first.first
-               << " prefix: " << vrfIPAndRoute.first.second;
-    auto rv = opennsl_l3_route_delete(hw_->getUnit(), &(vrfIPAndRoute.second));
+               << vrfIPAndRoute->first.first
+               << " prefix: " << vrfIPAndRoute->first.second;
+    auto rv =
+        opennsl_l3_route_delete(hw_->getUnit(), &(vrfIPAndRoute->second));
     bcmLogFatal(rv,
                 hw_,
                 "failed to delete fully qualified unreferenced route in vrf: ",
-                vrfIPAndRoute.first.first,
+                vrfIPAndRoute->first.first,
                 " prefix: ",
-                vrfIPAndRoute.first.second);
+                vrfIPAndRoute->first.second);
+    vrfAndIP2Route_.erase(vrfIPAndRoute);
+    ++numStaleEntriesRemoved_;
   }
-  vrfAndIP2Route_.clear();
 
-  // Delete bcm host entries. Nobody references bcm hosts, but
-  // hosts reference egress objects
-  for (auto vrfIpAndHost : vrfIp2Host_) {
-    XLOG(DBG1) << "Deleting host entry in vrf: " << vrfIpAndHost.first.first
-               << " for : " << vrfIpAndHost.first.second;
-    auto rv = opennsl_l3_host_delete(hw_->getUnit(), &vrfIpAndHost.second);
+  // Nobody references bcm hosts, but hosts reference egress objects
+  for (; maxEntries > 0 && !vrfIp2Host_.empty(); --maxEntries) {
+    auto vrfIpAndHost = vrfIp2Host_.begin();
+    XLOG(DBG1) << "Deleting host entry in vrf: " << vrfIpAndHost->first.first
+               << " for : " << vrfIpAndHost->first.second;
+    auto rv = opennsl_l3_host_delete(hw_->getUnit(), &vrfIpAndHost->second);
     bcmLogFatal(rv, hw_, "failed to delete host entry in vrf: ",
-        vrfIpAndHost.first.first, " for : ", vrfIpAndHost.first.second);
+        vrfIpAndHost->first.first, " for : ", vrfIpAndHost->first.second);
+    vrfIp2Host_.erase(vrfIpAndHost);
+    ++numStaleEntriesRemoved_;
+  }
+  return numStaleEntries() > 0;
+}
+
+void BcmWarmBootCache::clear() {
+  // Get rid of all unclaimed entries. The order is important here
+  // since we want to delete entries only after there are no more
+  // references to them.
+  XLOG(DBG1) << "Warm boot: removing unreferenced entries";
+  dumpedSwSwitchState_.reset();
+  for (const auto& ecmpIdAndEgress : hwSwitchEcmp2EgressIds_) {
+    hw_->writableHostTable()->ecmpMembersRemoved(
+        ecmpIdAndEgress.first, ecmpIdAndEgress.second);
+  }
+  hwSwitchEcmp2EgressIds_.clear();
+  // First delete routes (fully qualified and others), then host entries
+  while (clearSome(numeric_limits<size_t>::max())) {
   }
-  vrfIp2Host_.clear();
 
   // Both routes and host entries (which have been deleted earlier) can refer
   // to ecmp egress objects.  Ecmp egress objects in turn refer to egress
@@ -698,6 +789,7 @@ void BcmWarmBootCache::clear() {
         ecmp.ecmp_intf, " referring to ",
         toEgressIdsStr(idsAndEcmp.first));
   }
+  numStaleEntriesRemoved_ += egressIds2Ecmp_.size();
   egressIds2Ecmp_.clear();
 
   // Delete bcm egress entries. These are referenced by routes, ecmp egress
@@ -713,6 +805,7 @@ void BcmWarmBootCache::clear() {
                   "failed to destroy egress object ",
                   egressIdAndEgress.first);
   }
+  numStaleEntriesRemoved_ += egressId2Egress_.size();
   egressId2Egress_.clear();
 
   // Delete interfaces
@@ -724,6 +817,7 @@ void BcmWarmBootCache::clear() {
     bcmLogFatal(rv, hw_, "failed to delete l3 interface for vlan: ",
         vlanMacAndIntf.first.first, " and mac : ", vlanMacAndIntf.first.second);
   }
+  numStaleEntriesRemoved_ += vlanAndMac2Intf_.size();
   vlanAndMac2Intf_.clear();
   // Delete stations
   for (auto vlanAndStation : vlan2Station_) {
@@ -732,6 +826,7 @@ void BcmWarmBootCache::clear() {
     bcmLogFatal(rv, hw_, "failed to delete station for vlan : ",
         vlanAndStation.first);
   }
+  numStaleEntriesRemoved_ += vlan2Station_.size();
   vlan2Station_.clear();
   opennsl_vlan_t defaultVlan;
   auto rv = opennsl_vlan_default_get(hw_->getUnit(), &defaultVlan);
@@ -21,11 +21,14 @@ extern "C" {
 #include <folly/MacAddress.h>
 #include <folly/Optional.h>
 #include <folly/dynamic.h>
+#include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
 #include <algorithm>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "fboss/agent/hw/bcm/BcmRtag7Module.h"
 #include "fboss/agent/state/RouteTypes.h"
@@ -49,6 +52,14 @@ class BcmWarmBootCache {
  public:
   explicit BcmWarmBootCache(const BcmSwitchIf* hw);
   void populate(folly::Optional<folly::dynamic> warmBootState = folly::none);
+  /*
+   * Time in seconds spent in each phase of the last populate() call, along
+   * with the total time spent in populate().
+   */
+  using PhaseTimes = std::vector<std::pair<std::string, float>>;
+  const PhaseTimes& populateTimes() const {
+    return populateTimes_;
+  }
   struct VlanInfo {
     VlanInfo(VlanID _vlan, opennsl_pbmp_t _untagged, opennsl_pbmp_t _allPorts,
              InterfaceID _intfID):
@@ -128,6 +139,17 @@ class BcmWarmBootCache {
   typedef std::tuple<opennsl_vrf_t, folly::IPAddress,
           folly::IPAddress> VrfAndPrefix;
   typedef std::pair<opennsl_vrf_t, folly::IPAddress> VrfAndIP;
+  struct VrfAndIPHash {
+    size_t operator()(const VrfAndIP& key) const {
+      return folly::hash::hash_combine(key.first, key.second);
+    }
+  };
+  struct VrfAndPrefixHash {
+    size_t operator()(const VrfAndPrefix& key) const {
+      return folly::hash::hash_combine(
+          std::get<0>(key), std::get<1>(key), std::get<2>(key));
+    }
+  };
   /*
    * Cache containers
    */
@@ -135,14 +157,19 @@ class BcmWarmBootCache {
   typedef boost::container::flat_map<VlanID, opennsl_l2_station_t> Vlan2Station;
   typedef boost::container::flat_map<VlanAndMac, opennsl_l3_intf_t>
     VlanAndMac2Intf;
-  typedef boost::container::flat_map<VrfAndIP,
-          opennsl_l3_host_t> VrfAndIP2Host;
-  typedef boost::container::flat_map<VrfAndPrefix, opennsl_l3_route_t>
-    VrfAndPrefix2Route;
+  /*
+   * The host, route and egress tables can be as big as the h/w tables and
+   * are filled one SDK callback at a time, so use hash tables (pre-sized in
+   * populate()) rather than sorted containers for them.
+   */
+  typedef std::unordered_map<VrfAndIP, opennsl_l3_host_t, VrfAndIPHash>
+    VrfAndIP2Host;
+  typedef std::unordered_map<VrfAndPrefix, opennsl_l3_route_t,
+          VrfAndPrefixHash> VrfAndPrefix2Route;
   typedef boost::container::flat_map<EgressIds, EcmpEgress> EgressIds2Ecmp;
   using VrfAndIP2Route =
-      boost::container::flat_map<VrfAndIP, opennsl_l3_route_t>;
-  using EgressId2Egress = boost::container::flat_map<EgressId, Egress>;
+      std::unordered_map<VrfAndIP, opennsl_l3_route_t, VrfAndIPHash>;
+  using EgressId2Egress = std::unordered_map<EgressId, Egress>;
   using HostTableInWarmBootFile = boost::container::flat_map<HostKey, EgressId>;
 
   // current h/w acl ranges: value = <BcmAclRangeHandle, ref_count>
@@ -196,6 +223,16 @@ class BcmWarmBootCache {
 
   void populateRtag7State();
 
+  /*
+   * Helpers for populate(), each of which traverses one type of h/w table
+   * and only fills in the cache containers for that table type.
+   */
+  void populateVlans();
+  void populateHosts(const opennsl_l3_info_t& l3Info);
+  void populateRoutes(const opennsl_l3_info_t& l3Info);
+  void populateEgress();
+  void populateEcmpEgress();
+
  public:
   /*
    * Iterators and find functions for finding VlanInfo
@@ -417,6 +454,23 @@ class BcmWarmBootCache {
    * from hw that had owner as their only remaining owner
    */
   void clear();
+  /*
+   * Remove up to maxEntries of the unclaimed routes and host entries,
+   * which are the bulk of what clear() removes. Returns false once there
+   * are none left. This lets the stale entries be removed a batch at a
+   * time, with state updates programmed in between, before clear()
+   * removes what remains.
+   */
+  bool clearSome(size_t maxEntries);
+  // Unclaimed routes and host entries not removed yet
+  size_t numStaleEntries() const {
+    return vrfPrefix2Route_.size() + vrfAndIP2Route_.size() +
+        vrfIp2Host_.size();
+  }
+  // Unclaimed entries of any kind removed so far
+  size_t numStaleEntriesRemoved() const {
+    return numStaleEntriesRemoved_;
+  }
   bool fillVlanPortInfo(Vlan* vlan);
   /*
    * Serialize to folly::dynamic
@@ -497,5 +551,7 @@ class BcmWarmBootCache {
   AclEntry2AclStat aclEntry2AclStat_;
 
   std::unique_ptr<SwitchState> dumpedSwSwitchState_;
+  PhaseTimes populateTimes_;
+  size_t numStaleEntriesRemoved_{0};
 };
 }} // facebook::fboss
@@ -4,10 +4,14 @@
 #include "fboss/agent/SysError.h"
 #include "fboss/agent/Utils.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/experimental/bser/Bser.h>
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
 #include <glog/logging.h>
@@ -18,11 +22,16 @@ DEFINE_bool(can_warm_boot, true,
             "Enable/disable warm boot functionality");
 DEFINE_string(switch_state_file, "switch_state",
     "File for dumping switch state JSON in on exit");
+DEFINE_bool(binary_switch_state, true,
+    "Dump the switch state on exit in the binary BSER encoding rather than "
+    "as JSON. JSON is easier to inspect, but much slower to write and parse "
+    "with large tables");
 
 namespace {
 constexpr auto wbFlagPrefix = "can_warm_boot_";
 constexpr auto wbDataPrefix = "bcm_sdk_state_";
 constexpr auto forceColdBootPrefix = "cold_boot_once_";
+constexpr auto binarySwitchStateSuffix = ".bser";
 
 /*
  * Remove the given file. Return true if file exists and
@@ -43,6 +52,46 @@ bool removeFile(const string& filename) {
       errno, "error while trying to remove warm boot file ", filename);
 }
 
+bool fileExists(const string& filename) {
+  return access(filename.c_str(), F_OK) == 0;
+}
+
+/*
+ * Parse BSER encoded state directly out of a read only mapping of the file,
+ * rather than reading it into memory first.
+ */
+folly::dynamic parseBserFile(const string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw facebook::fboss::SysError(
+        errno, "Unable to open switch state file ", filename);
+  }
+  SCOPE_EXIT {
+    close(fd);
+  };
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    throw facebook::fboss::SysError(
+        errno, "Unable to stat switch state file ", filename);
+  }
+  if (st.st_size == 0) {
+    throw facebook::fboss::SysError(
+        EINVAL, "Empty switch state file ", filename);
+  }
+  auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    throw facebook::fboss::SysError(
+        errno, "Unable to mmap switch state file ", filename);
+  }
+  SCOPE_EXIT {
+    munmap(addr, st.st_size);
+  };
+  // We are going to read the whole file once, sequentially
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+  return folly::bser::parseBser(
+      folly::ByteRange(static_cast<const uint8_t*>(addr), st.st_size));
+}
+
 }
 
 namespace facebook { namespace fboss {
@@ -86,6 +135,10 @@ std::string DiscBackedBcmWarmBootHelper::warmBootSwitchStateFile() const {
   return folly::to<string>(warmBootDir_, "/", FLAGS_switch_state_file);
 }
 
+std::string DiscBackedBcmWarmBootHelper::warmBootBinarySwitchStateFile() const {
+  return folly::to<string>(warmBootSwitchStateFile(), binarySwitchStateSuffix);
+}
+
 std::string DiscBackedBcmWarmBootHelper::warmBootFlag() const {
   return folly::to<string>(warmBootDir_, "/", wbFlagPrefix, unit_);
 }
@@ -120,10 +173,43 @@ bool DiscBackedBcmWarmBootHelper::checkAndClearWarmBootFlags() {
 
 bool DiscBackedBcmWarmBootHelper::storeWarmBootState(
     const folly::dynamic& switchState) {
-  return dumpStateToFile(warmBootSwitchStateFile(), switchState);
+  // Remove any state in the other format, so that the next warm boot can't
+  // pick up a stale file
+  if (!FLAGS_binary_switch_state) {
+    removeFile(warmBootBinarySwitchStateFile());
+    return dumpStateToFile(warmBootSwitchStateFile(), switchState);
+  }
+  removeFile(warmBootSwitchStateFile());
+  folly::bser::serialization_opts opts;
+  auto bser = folly::bser::toBser(switchState, opts);
+  auto fd = creat(warmBootBinarySwitchStateFile().c_str(),
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd < 0) {
+    XLOG(ERR) << "Unable to create " << warmBootBinarySwitchStateFile()
+              << ": " << errno;
+    return false;
+  }
+  SCOPE_EXIT {
+    close(fd);
+  };
+  // Write the serialized buffer chain out as is, without coalescing it
+  for (const auto& buf : *bser) {
+    if (folly::writeFull(fd, buf.data(), buf.size()) !=
+        static_cast<ssize_t>(buf.size())) {
+      XLOG(ERR) << "Unable to write " << warmBootBinarySwitchStateFile()
+                << ": " << errno;
+      return false;
+    }
+  }
+  return true;
 }
 
 folly::dynamic DiscBackedBcmWarmBootHelper::getWarmBootState() const {
+  // Prefer the binary state, but fall back to JSON, e.g. when warm booting
+  // from a version which did not write binary state yet
+  if (fileExists(warmBootBinarySwitchStateFile())) {
+    return parseBserFile(warmBootBinarySwitchStateFile());
+  }
   std::string warmBootJson;
   auto ret = folly::readFile(warmBootSwitchStateFile().c_str(), warmBootJson);
   sysCheckError(
@@ -68,6 +68,7 @@ class DiscBackedBcmWarmBootHelper: public BcmWarmBootHelper {
   std::string warmBootDataPath() const;
   std::string forceColdBootOnceFlag() const;
   std::string warmBootSwitchStateFile() const;
+  std::string warmBootBinarySwitchStateFile() const;
 
   void setupWarmBootFile();
 
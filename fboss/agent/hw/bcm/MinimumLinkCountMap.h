@@ -11,6 +11,7 @@
 #pragma once
 
 #include <boost/container/flat_map.hpp>
+#include <algorithm>
 #include <utility>
 
 #include <folly/Optional.h>
@@ -19,6 +20,12 @@
 namespace facebook {
 namespace fboss {
 
+/*
+ * Tracks, per trunk, the minimum link count from config and the number of
+ * member ports currently enabled in hardware. The link-scan thread uses the
+ * two to decide in O(1) whether a member going down takes the trunk below
+ * its minimum, without having to read the member list back from the ASIC.
+ */
 class TrunkToMinimumLinkCountMap {
  public:
   TrunkToMinimumLinkCountMap() : trunkToCountLock_(), trunkToCount_() {}
@@ -38,14 +45,44 @@ class TrunkToMinimumLinkCountMap {
     return getLocked(trunk);
   }
 
+  void setEnabledMemberCount(opennsl_trunk_t trunk, int count) {
+    folly::SharedMutexReadPriority::WriteHolder g(&trunkToCountLock_);
+    auto it = trunkToCount_.find(trunk);
+    if (it != trunkToCount_.end()) {
+      it->second.enabledMembers = count;
+    }
+  }
+
+  // Members added (positive) or removed (negative) in hardware
+  void adjustEnabledMemberCount(opennsl_trunk_t trunk, int delta) {
+    if (delta == 0) {
+      return;
+    }
+    folly::SharedMutexReadPriority::WriteHolder g(&trunkToCountLock_);
+    auto it = trunkToCount_.find(trunk);
+    if (it != trunkToCount_.end()) {
+      it->second.enabledMembers =
+          std::max(it->second.enabledMembers + delta, 0);
+    }
+  }
+
+  folly::Optional<int> getEnabledMemberCount(opennsl_trunk_t trunk) const {
+    folly::SharedMutexReadPriority::ReadHolder g(&trunkToCountLock_);
+    auto it = trunkToCount_.find(trunk);
+    return it == trunkToCount_.cend()
+        ? folly::none
+        : folly::make_optional(it->second.enabledMembers);
+  }
+
  private:
+  struct Counts {
+    uint8_t minLinkCount{0};
+    int enabledMembers{0};
+  };
+
   void addLocked(opennsl_trunk_t trunk, uint8_t count) {
-    bool inserted;
-    boost::container::flat_map<opennsl_trunk_t, uint8_t>::iterator it;
-    std::tie(it, inserted) = trunkToCount_.emplace(trunk, count);
-    if (!inserted) {
-      it->second = count;
-    }
+    // Keeps the enabled member count of an existing trunk
+    trunkToCount_[trunk].minLinkCount = count;
   }
 
   void delLocked(opennsl_trunk_t trunk) {
@@ -56,12 +93,13 @@ class TrunkToMinimumLinkCountMap {
 
   folly::Optional<uint8_t> getLocked(opennsl_trunk_t trunk) const {
     auto it = trunkToCount_.find(trunk);
-    return it == trunkToCount_.cend() ? folly::none
-                                      : folly::make_optional(it->second);
+    return it == trunkToCount_.cend()
+        ? folly::none
+        : folly::make_optional(it->second.minLinkCount);
   }
 
   mutable folly::SharedMutexReadPriority trunkToCountLock_;
-  boost::container::flat_map<opennsl_trunk_t, uint8_t> trunkToCount_;
+  boost::container::flat_map<opennsl_trunk_t, Counts> trunkToCount_;
 };
 }
 }
@@ -36,6 +36,13 @@ class MockBcmSwitch : public BcmSwitchIf {
       folly::Optional<uint8_t> cos = folly::none) noexcept override {
     return sendPacketOutOfPortAsyncImpl(pkt.get(), portID, cos);
   }
+  // send batches one packet at a time, through the method above
+  bool sendPacketsOutOfPortAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts,
+      PortID portID,
+      folly::Optional<uint8_t> cos = folly::none) noexcept override {
+    return HwSwitch::sendPacketsOutOfPortAsync(std::move(pkts), portID, cos);
+  }
   // hackery, since GMOCK does no support forwarding
   bool sendPacketSwitchedSync(std::unique_ptr<TxPacket> pkt) noexcept override {
     return sendPacketSwitchedAsyncImpl(pkt.get());
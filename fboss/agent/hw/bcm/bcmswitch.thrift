@@ -58,4 +58,27 @@ struct BcmHwTableStats {
   36: i32 mirrors_max = STAT_UNINITIALIZED
   37: i32 mirrors_span = STAT_UNINITIALIZED
   38: i32 mirrors_erspan = STAT_UNINITIALIZED
+
+  // ECMP egress objects shared between ECMP hosts with the same paths
+  39: i32 l3_ecmp_groups_unique = STAT_UNINITIALIZED
+  40: i32 l3_ecmp_groups_referenced = STAT_UNINITIALIZED
+  // Paths repeated within ECMP groups to implement weighted next hops
+  41: i32 l3_ecmp_paths_replicated = STAT_UNINITIALIZED
+
+  // How the acls were laid out in the TCAM by the acl compiler
+  42: i32 acl_entries_shadowed = STAT_UNINITIALIZED
+  43: i32 acl_range_checkers_used = STAT_UNINITIALIZED
+  44: i32 acl_ranges_expanded = STAT_UNINITIALIZED
+  45: i32 acl_tcam_entries_compiled = STAT_UNINITIALIZED
+
+  // Egresses of neighbors resolved to the same interface, MAC and port or
+  // trunk as another neighbor's
+  46: i32 l3_egress_duplicates = STAT_UNINITIALIZED
+
+  // Route writes moved to keep the prefixes under each other together in
+  // the ALPM buckets
+  47: i64 l3_alpm_routes_reordered = STAT_UNINITIALIZED
+
+  // Host routes in the route table for want of room in the host table
+  48: i32 l3_host_routes_spilled = STAT_UNINITIALIZED
 }
@@ -53,6 +53,12 @@ void BcmCosQueueManager::programBandwidth(
     opennsl_cos_queue_t /*cosQ*/,
     const std::shared_ptr<PortQueue>& /*queue*/) {}
 
+folly::Optional<uint64_t> BcmCosQueueManager::getQueueOccupancy(
+    opennsl_cos_queue_t /*cosQ*/) const {
+  // API not available in opennsl
+  return folly::none;
+}
+
 void BcmCosQueueManager::updateQueueAggregatedStat(
     const BcmCosQueueCounterType& /*type*/,
     facebook::stats::MonotonicCounter* /*counter*/,
@@ -26,4 +26,9 @@ bool BcmEcmpEgress::addEgressIdHwLocked(
   return false; // Not supported in opennsl
 }
 
+bool BcmEcmpEgress::getFlowletReassignments(
+    uint64_t* /*reassignments*/) const {
+  return false; // Not supported in opennsl
+}
+
 }}
@@ -29,6 +29,9 @@ bool BcmPort::isFECEnabled() {
 }
 
 void BcmPort::setSflowRates(const std::shared_ptr<Port>& /* swPort */) {}
+void BcmPort::setSflowRates(
+    int64_t /* ingressRate */,
+    int64_t /* egressRate */) {}
 void BcmPort::disableSflow() {}
 
 void BcmPort::setAdditionalStats(
@@ -19,5 +19,10 @@ opennsl_switch_control_t BcmRtag7LoadBalancer::trunkHashSet0UnicastOffset()
   throw FbossError("Symbol not exported in OpenNSL");
 }
 
+void BcmRtag7LoadBalancer::programPortQualityMetrics() {
+  // The quality measurement controls are not exported in OpenNSL, so the
+  // ASIC's defaults are used
+}
+
 } // namespace fboss
 } // namespace facebook
@@ -13,10 +13,11 @@ namespace facebook { namespace fboss {
 
 using facebook::stats::MonotonicCounter;
 
-void BcmStatUpdater::updateAclStat(
+bool BcmStatUpdater::readAclStat(
     int /*unit*/,
     BcmAclStatHandle /*handle*/,
-    cfg::CounterType /*counterType*/,
-    std::chrono::seconds /*now*/,
-    MonotonicCounter* /*counter*/) {}
+    const std::vector<cfg::CounterType>& /*types*/,
+    std::vector<uint64_t>* /*values*/) {
+  return false;
+}
 }} // facebook::fboss
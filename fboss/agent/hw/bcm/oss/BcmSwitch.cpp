@@ -10,7 +10,9 @@
 #include "fboss/agent/hw/bcm/BcmSwitch.h"
 
 #include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmHighresSampler.h"
 #include "fboss/agent/hw/BufferStatsLogger.h"
+#include "fboss/agent/hw/L2TablePageBuilder.h"
 #include "fboss/agent/hw/bcm/BcmRxPacket.h"
 #include "fboss/agent/hw/bcm/gen-cpp2/packettrace_types.h"
 
@@ -86,10 +88,18 @@ std::unique_ptr<PacketTraceInfo> BcmSwitch::getPacketTrace(
 }
 
 int BcmSwitch::getHighresSamplers(
-    HighresSamplerList* /*samplers*/,
-    const std::string& /*namespaceString*/,
-    const std::set<CounterRequest>& /*counterSet*/) {
-  return 0;
+    HighresSamplerList* samplers,
+    const std::string& namespaceString,
+    const std::set<CounterRequest>& counterSet) {
+  if (namespaceString != BcmPortCounterSampler::kIdentifier) {
+    return 0;
+  }
+  auto sampler = std::make_unique<BcmPortCounterSampler>(this, counterSet);
+  auto numCounters = sampler->numCounters();
+  if (numCounters > 0) {
+    samplers->push_back(std::move(sampler));
+  }
+  return numCounters;
 }
 
 void BcmSwitch::exportSdkVersion() const {}
@@ -140,10 +150,8 @@ void BcmSwitch::printDiagCmd(const std::string& /*cmd*/) const {}
 
 void BcmSwitch::forceLinkscanOn(opennsl_pbmp_t /*ports*/) {}
 
-static int _addL2Entry(int /*unit*/, opennsl_l2_addr_t* l2addr,
-                       void* user_data) {
+static L2EntryThrift _toL2Entry(const opennsl_l2_addr_t* l2addr) {
   L2EntryThrift entry;
-  auto l2Table = static_cast<std::vector<L2EntryThrift>*>(user_data);
   entry.mac = folly::sformat("{0:02x}:{1:02x}:{2:02x}:{3:02x}:{4:02x}:{5:02x}",
                              l2addr->mac[0], l2addr->mac[1], l2addr->mac[2],
                              l2addr->mac[3], l2addr->mac[4], l2addr->mac[5]);
@@ -151,7 +159,24 @@ static int _addL2Entry(int /*unit*/, opennsl_l2_addr_t* l2addr,
   entry.port = l2addr->port;
   XLOG(DBG6) << "L2 entry: Mac:" << entry.mac << " Vid:" << entry.vlanID
              << " Port:" << entry.port;
-  l2Table->push_back(entry);
+  return entry;
+}
+
+static int _addL2Entry(int /*unit*/, opennsl_l2_addr_t* l2addr,
+                       void* user_data) {
+  auto l2Table = static_cast<std::vector<L2EntryThrift>*>(user_data);
+  l2Table->push_back(_toL2Entry(l2addr));
+  return 0;
+}
+
+static int _addL2EntryToPage(int /*unit*/, opennsl_l2_addr_t* l2addr,
+                             void* user_data) {
+  // The traversal can't be stopped early, but entries off the page are
+  // skipped before being formatted
+  auto builder = static_cast<L2TablePageBuilder*>(user_data);
+  if (builder->onPage(l2addr->vid, l2addr->port)) {
+    builder->add(_toL2Entry(l2addr));
+  }
   return 0;
 }
 
@@ -160,4 +185,14 @@ void BcmSwitch::fetchL2Table(std::vector<L2EntryThrift> *l2Table) {
   bcmCheckError(rv, "opennsl_l2_traverse failed");
 }
 
+void BcmSwitch::fetchL2TablePage(
+    const L2TablePageRequest& request,
+    int32_t maxEntries,
+    L2TablePage* page) {
+  L2TablePageBuilder builder(request, maxEntries, page);
+  int rv = opennsl_l2_traverse(unit_, _addL2EntryToPage, &builder);
+  bcmCheckError(rv, "opennsl_l2_traverse failed");
+  builder.finish();
+}
+
 }} //facebook::fboss
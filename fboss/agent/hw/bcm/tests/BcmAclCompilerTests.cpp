@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmAclCompiler.h"
+
+#include "fboss/agent/state/AclEntry.h"
+
+#include <folly/IPAddress.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+shared_ptr<AclEntry> makeAcl(int priority) {
+  return make_shared<AclEntry>(priority, "acl" + std::to_string(priority));
+}
+
+} // unnamed namespace
+
+TEST(BcmAclCompiler, rangeToPrefixes) {
+  using Prefixes = vector<BcmAclCompiler::PortMask>;
+  EXPECT_EQ(Prefixes({{80, 0xffff}}), BcmAclCompiler::rangeToPrefixes(80, 80));
+  EXPECT_EQ(Prefixes({{0, 0}}), BcmAclCompiler::rangeToPrefixes(0, 0xffff));
+  EXPECT_EQ(
+      Prefixes({{1024, 0xfc00}, {2048, 0xf800}, {4096, 0xf000},
+                {8192, 0xe000}, {16384, 0xc000}, {32768, 0x8000}}),
+      BcmAclCompiler::rangeToPrefixes(1024, 0xffff));
+  EXPECT_EQ(
+      Prefixes({{1, 0xffff}, {2, 0xfffe}, {4, 0xfffc}, {8, 0xfffe}}),
+      BcmAclCompiler::rangeToPrefixes(1, 9));
+  // The worst case for 16 bits
+  EXPECT_EQ(30, BcmAclCompiler::rangeToPrefixes(1, 0xfffe).size());
+}
+
+TEST(BcmAclCompiler, covers) {
+  auto wide = makeAcl(1);
+  wide->setDstIp(IPAddress::createNetwork("10.0.0.0/8"));
+  wide->setProto(6);
+  wide->setDstL4PortRange(AclL4PortRange(1000, 2000, false));
+
+  auto narrow = makeAcl(2);
+  narrow->setDstIp(IPAddress::createNetwork("10.1.0.0/16"));
+  narrow->setProto(6);
+  narrow->setDscp(10);
+  narrow->setDstL4PortRange(AclL4PortRange(1500, 1600, false));
+  EXPECT_TRUE(BcmAclCompiler::covers(*wide, *narrow));
+  EXPECT_FALSE(BcmAclCompiler::covers(*narrow, *wide));
+
+  narrow->setDstL4PortRange(AclL4PortRange(1500, 2500, false));
+  EXPECT_FALSE(BcmAclCompiler::covers(*wide, *narrow));
+  narrow->setDstL4PortRange(AclL4PortRange(1500, 1600, false));
+
+  narrow->setDstIp(IPAddress::createNetwork("11.0.0.0/16"));
+  EXPECT_FALSE(BcmAclCompiler::covers(*wide, *narrow));
+  narrow->setDstIp(IPAddress::createNetwork("2401:db00::/32"));
+  EXPECT_FALSE(BcmAclCompiler::covers(*wide, *narrow));
+
+  // Inverted ranges only cover the identical range
+  auto inverted = makeAcl(3);
+  inverted->setSrcL4PortRange(AclL4PortRange(0, 1023, true));
+  auto other = makeAcl(4);
+  other->setSrcL4PortRange(AclL4PortRange(2000, 3000, false));
+  EXPECT_FALSE(BcmAclCompiler::covers(*inverted, *other));
+  other->setSrcL4PortRange(AclL4PortRange(0, 1023, true));
+  EXPECT_TRUE(BcmAclCompiler::covers(*inverted, *other));
+
+  auto ttl = makeAcl(5);
+  ttl->setTtl(AclTtl(0x80, 0x80));
+  auto exactTtl = makeAcl(6);
+  exactTtl->setTtl(AclTtl(0xff, 0xff));
+  EXPECT_TRUE(BcmAclCompiler::covers(*ttl, *exactTtl));
+  EXPECT_FALSE(BcmAclCompiler::covers(*exactTtl, *ttl));
+}
+
+TEST(BcmAclCompiler, shadowed) {
+  auto dropAll = makeAcl(10);
+  dropAll->setActionType(cfg::AclActionType::DENY);
+  dropAll->setDstIp(IPAddress::createNetwork("10.0.0.0/8"));
+  auto hidden = makeAcl(20);
+  hidden->setDstIp(IPAddress::createNetwork("10.1.0.0/16"));
+  hidden->setProto(17);
+  auto visible = makeAcl(30);
+  visible->setDstIp(IPAddress::createNetwork("192.168.0.0/16"));
+  // Higher priority acls are never shadowed by what comes after them
+  auto first = makeAcl(5);
+  first->setDstIp(IPAddress::createNetwork("10.2.0.0/16"));
+
+  auto result =
+      BcmAclCompiler::compile({first, dropAll, hidden, visible}, 32);
+  EXPECT_EQ(1, result.shadowed.size());
+  ASSERT_TRUE(result.isShadowed(20));
+  EXPECT_EQ(10, result.shadowed.at(20));
+  EXPECT_EQ(3, result.tcamEntries);
+
+  // Acls with counters stay programmed, to keep their counters around
+  MatchAction action;
+  cfg::TrafficCounter counter;
+  counter.name = "hidden";
+  action.setTrafficCounter(counter);
+  hidden->setAclAction(action);
+  result = BcmAclCompiler::compile({first, dropAll, hidden, visible}, 32);
+  EXPECT_TRUE(result.shadowed.empty());
+  EXPECT_EQ(4, result.tcamEntries);
+}
+
+TEST(BcmAclCompiler, rangeCheckers) {
+  // Two prefixes to expand
+  auto cheap = makeAcl(1);
+  cheap->setSrcL4PortRange(AclL4PortRange(1, 2, false));
+  // Thirty prefixes, in combination with the two of the source range
+  auto expensive = makeAcl(2);
+  expensive->setSrcL4PortRange(AclL4PortRange(1, 2, false));
+  expensive->setDstL4PortRange(AclL4PortRange(1, 0xfffe, false));
+  auto exact = makeAcl(3);
+  exact->setDstL4PortRange(AclL4PortRange(53, 53, false));
+  auto pktLen = makeAcl(4);
+  pktLen->setPktLenRange(AclPktLenRange(64, 128, false));
+  vector<shared_ptr<AclEntry>> acls{cheap, expensive, exact, pktLen};
+
+  AclRange srcRange(AclRange::SRC_L4_PORT, 1, 2);
+  AclRange dstRange(AclRange::DST_L4_PORT, 1, 0xfffe);
+  AclRange pktLenRange(AclRange::PKT_LEN, 64, 128);
+
+  auto result = BcmAclCompiler::compile(acls, 8);
+  EXPECT_EQ(3, result.rangeCheckers.size());
+  EXPECT_TRUE(result.expandedRanges.empty());
+  EXPECT_EQ(4, result.tcamEntries);
+
+  // The only spare range checker goes to the range costing the most
+  result = BcmAclCompiler::compile(acls, 2);
+  EXPECT_TRUE(result.usesRangeChecker(pktLenRange));
+  EXPECT_TRUE(result.usesRangeChecker(dstRange));
+  EXPECT_EQ(1, result.expandedRanges.count(srcRange));
+  EXPECT_EQ(2 + 2 + 1 + 1, result.tcamEntries);
+
+  // Packet length ranges can't be expanded, so they always get one
+  result = BcmAclCompiler::compile(acls, 0);
+  EXPECT_TRUE(result.usesRangeChecker(pktLenRange));
+  EXPECT_EQ(2, result.expandedRanges.size());
+  EXPECT_EQ(2 + 2 * 30 + 1 + 1, result.tcamEntries);
+}
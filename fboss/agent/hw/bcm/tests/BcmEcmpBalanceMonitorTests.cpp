@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmEcmpBalanceMonitor.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+TEST(BcmEcmpBalanceMonitor, maxOverMeanPct) {
+  // Even
+  EXPECT_EQ(100, BcmEcmpBalanceMonitor::maxOverMeanPct({{100, 1}, {100, 1}}));
+  // One member with 3/4 of the traffic of two
+  EXPECT_EQ(150, BcmEcmpBalanceMonitor::maxOverMeanPct({{300, 1}, {100, 1}}));
+  // Twice the traffic over twice the paths is even
+  EXPECT_EQ(100, BcmEcmpBalanceMonitor::maxOverMeanPct({{200, 2}, {100, 1}}));
+  // No traffic
+  EXPECT_EQ(0, BcmEcmpBalanceMonitor::maxOverMeanPct({{0, 1}, {0, 1}}));
+}
+
+TEST(BcmEcmpBalanceMonitor, worstGroups) {
+  // Measurements are only recorded by hand, so no hardware is needed
+  BcmEcmpBalanceMonitor monitor(nullptr);
+  std::vector<BcmEcmpBalanceMonitor::EcmpGroup> groups{
+      {100001, {PortID(1), PortID(2)}},
+      {100002, {PortID(3), PortID(4)}},
+      // A single port, no balance to speak of
+      {100003, {PortID(5), PortID(5)}},
+      // A port without counters
+      {100004, {PortID(1), PortID(6)}},
+  };
+  BcmEcmpBalanceMonitor::PortBytes bytes{
+      {PortID(1), 1000},
+      {PortID(2), 1000},
+      {PortID(3), 1000},
+      {PortID(4), 1000},
+      {PortID(5), 1000},
+  };
+  auto start = steady_clock::now();
+  // The first measurement only records the counters
+  monitor.recordMeasurement(bytes, groups, start);
+  EXPECT_TRUE(monitor.getWorstGroups(10).empty());
+
+  bytes[PortID(1)] += 2000;
+  bytes[PortID(2)] += 2000;
+  bytes[PortID(3)] += 3000;
+  bytes[PortID(4)] += 1000;
+  monitor.recordMeasurement(bytes, groups, start + seconds(2));
+
+  auto worst = monitor.getWorstGroups(10);
+  ASSERT_EQ(2, worst.size());
+  EXPECT_EQ(100002, worst[0].ecmpId);
+  EXPECT_EQ(150, worst[0].maxOverMeanPct);
+  EXPECT_EQ(1500, worst[0].memberBytesPerSec.at(3));
+  EXPECT_EQ(500, worst[0].memberBytesPerSec.at(4));
+  EXPECT_EQ(100001, worst[1].ecmpId);
+  EXPECT_EQ(100, worst[1].maxOverMeanPct);
+
+  worst = monitor.getWorstGroups(1);
+  ASSERT_EQ(1, worst.size());
+  EXPECT_EQ(100002, worst[0].ecmpId);
+}
@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmHashTracer.h"
+
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/UDPHeader.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
+#include "fboss/agent/packet/IPv6Hdr.h"
+
+#include <folly/io/Cursor.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using facebook::network::toBinaryAddress;
+using folly::IPAddress;
+using folly::MacAddress;
+
+namespace {
+FlowTuple makeFlow(const std::string& src, const std::string& dst) {
+  FlowTuple flow;
+  flow.srcIp = toBinaryAddress(IPAddress(src));
+  flow.dstIp = toBinaryAddress(IPAddress(dst));
+  flow.srcPort = 10000;
+  flow.dstPort = 443;
+  flow.ingressPort = 5;
+  return flow;
+}
+
+std::unique_ptr<PacketTraceInfo> makeTrace(
+    std::vector<int32_t> potential,
+    int32_t actual) {
+  auto trace = std::make_unique<PacketTraceInfo>();
+  trace->hashInfo.potentialEgressPorts = std::move(potential);
+  trace->hashInfo.actualEgressPort = actual;
+  return trace;
+}
+}
+
+TEST(BcmHashTracer, flowPackets) {
+  MacAddress dstMac("02:00:00:00:00:0a");
+  auto pkt = BcmHashTracer::makeFlowPacket(
+      makeFlow("10.0.0.1", "10.1.0.1"), dstMac);
+  EXPECT_EQ(PortID(5), pkt->getSrcPort());
+  folly::io::Cursor cursor(pkt->buf());
+  EXPECT_EQ(dstMac, MacAddress::fromBinary(folly::ByteRange(cursor.data(), 6)));
+  cursor.skip(12);
+  EXPECT_EQ(0x0800, cursor.readBE<uint16_t>());
+  IPv4Hdr v4Hdr(cursor);
+  EXPECT_EQ(IPAddress("10.0.0.1"), v4Hdr.srcAddr);
+  EXPECT_EQ(IPAddress("10.1.0.1"), v4Hdr.dstAddr);
+  EXPECT_EQ(17, v4Hdr.protocol);
+  UDPHeader udpHdr;
+  udpHdr.parse(&cursor);
+  EXPECT_EQ(10000, udpHdr.srcPort);
+  EXPECT_EQ(443, udpHdr.dstPort);
+
+  auto flow = makeFlow("2401:db00::1", "2401:db00::2");
+  flow.ipProtocol = 6;
+  pkt = BcmHashTracer::makeFlowPacket(flow, dstMac);
+  cursor = folly::io::Cursor(pkt->buf());
+  cursor.skip(12);
+  EXPECT_EQ(0x86DD, cursor.readBE<uint16_t>());
+  IPv6Hdr v6Hdr(cursor);
+  EXPECT_EQ(6, v6Hdr.nextHeader);
+  EXPECT_EQ(10000, cursor.readBE<uint16_t>());
+  EXPECT_EQ(443, cursor.readBE<uint16_t>());
+
+  flow.ipProtocol = 1;
+  EXPECT_THROW(BcmHashTracer::makeFlowPacket(flow, dstMac), FbossError);
+  EXPECT_THROW(
+      BcmHashTracer::makeFlowPacket(
+          makeFlow("10.0.0.1", "2401:db00::2"), dstMac),
+      FbossError);
+}
+
+TEST(BcmHashTracer, aggregate) {
+  std::vector<std::unique_ptr<PacketTraceInfo>> traces;
+  traces.push_back(makeTrace({3, 1, 2}, 1));
+  traces.push_back(makeTrace({1, 2, 3}, 1));
+  traces.push_back(makeTrace({1, 2, 3}, 3));
+  // Not ECMP
+  traces.push_back(makeTrace({}, 7));
+  traces.push_back(nullptr);
+
+  auto report = BcmHashTracer::aggregate(traces);
+  EXPECT_EQ(4, report.numTraced);
+  EXPECT_EQ(1, report.numFailed);
+  ASSERT_EQ(2, report.groups.size());
+  EXPECT_EQ((std::vector<int32_t>{1, 2, 3}),
+            report.groups[0].potentialEgressPorts);
+  EXPECT_EQ((std::map<int32_t, int64_t>{{1, 2}, {3, 1}}),
+            report.groups[0].flowsPerEgressPort);
+  EXPECT_EQ(std::vector<int32_t>{7}, report.groups[1].potentialEgressPorts);
+  EXPECT_EQ(1, report.groups[1].flowsPerEgressPort.at(7));
+}
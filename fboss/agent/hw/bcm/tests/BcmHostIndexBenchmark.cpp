@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmHost.h"
+#include "fboss/agent/hw/bcm/BcmHostIndex.h"
+
+#include <boost/container/flat_map.hpp>
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <gflags/gflags.h>
+
+#include <vector>
+
+extern "C" {
+  struct ibde_t;
+  ibde_t* bde;
+}
+
+DEFINE_int32(ecmp_groups, 1024, "Number of ECMP groups to create");
+DEFINE_int32(ecmp_width, 64, "Number of next hops in each ECMP group");
+DEFINE_int32(next_hops, 256, "Number of distinct next hops");
+
+using namespace facebook::fboss;
+using folly::IPAddressV6;
+
+/*
+ * Creates and dereferences ECMP hosts the way BcmHostTable does, each ECMP
+ * host referencing one host per next hop, without programming anything.
+ * The hosts only hold a back pointer to their table, so this measures the
+ * cost of the host containers themselves.
+ */
+namespace {
+
+std::vector<BcmEcmpHostKey> makeKeys() {
+  std::vector<IPAddressV6> addrs;
+  for (int i = 0; i < FLAGS_next_hops; ++i) {
+    addrs.emplace_back(folly::to<std::string>("2401:db00::", i + 1));
+  }
+  std::vector<BcmEcmpHostKey> keys;
+  for (int group = 0; group < FLAGS_ecmp_groups; ++group) {
+    RouteNextHopSet nhops;
+    for (int i = 0; i < FLAGS_ecmp_width; ++i) {
+      nhops.emplace(ResolvedNextHop(
+          addrs[(group + i) % addrs.size()], InterfaceID(1), ECMP_WEIGHT));
+    }
+    keys.emplace_back(0, std::move(nhops));
+  }
+  return keys;
+}
+
+// The host containers BcmHostTable used before BcmHostIndex
+class FlatMapTable {
+ public:
+  struct Host {
+    Host(FlatMapTable*, const BcmHostKey&) {}
+  };
+  struct EcmpHost {
+    EcmpHost(FlatMapTable* table, const BcmEcmpHostKey& key)
+        : table_(table), key_(key) {
+      for (const auto& nhop : key_.second) {
+        table_->incRef(&table_->hosts_, BcmHostKey(key_.first, nhop));
+      }
+    }
+    ~EcmpHost() {
+      for (const auto& nhop : key_.second) {
+        table_->deref(&table_->hosts_, BcmHostKey(key_.first, nhop));
+      }
+    }
+    FlatMapTable* table_;
+    BcmEcmpHostKey key_;
+  };
+  template <typename KeyT, typename HostT>
+  using HostMap = boost::container::
+      flat_map<KeyT, std::pair<std::unique_ptr<HostT>, uint32_t>>;
+
+  template <typename KeyT, typename HostT>
+  HostT* incRef(HostMap<KeyT, HostT>* map, const KeyT& key) {
+    auto iter = map->find(key);
+    if (iter != map->end()) {
+      iter->second.second++;
+      return iter->second.first.get();
+    }
+    auto newHost = std::make_unique<HostT>(this, key);
+    auto hostPtr = newHost.get();
+    map->emplace(key, std::make_pair(std::move(newHost), 1));
+    return hostPtr;
+  }
+  template <typename KeyT, typename HostT>
+  void deref(HostMap<KeyT, HostT>* map, const KeyT& key) {
+    auto iter = map->find(key);
+    if (--iter->second.second == 0) {
+      map->erase(iter);
+    }
+  }
+
+  HostMap<BcmHostKey, Host> hosts_;
+  HostMap<BcmEcmpHostKey, EcmpHost> ecmpHosts_;
+};
+
+class HashIndexTable {
+ public:
+  struct Host {
+    Host(HashIndexTable*, const BcmHostKey&) {}
+  };
+  struct EcmpHost {
+    EcmpHost(HashIndexTable* table, const BcmEcmpHostKey& key)
+        : table_(table), key_(key) {
+      for (const auto& nhop : key_.second) {
+        table_->incRef(&table_->hosts_, BcmHostKey(key_.first, nhop));
+      }
+    }
+    ~EcmpHost() {
+      for (const auto& nhop : key_.second) {
+        table_->deref(&table_->hosts_, BcmHostKey(key_.first, nhop));
+      }
+    }
+    HashIndexTable* table_;
+    BcmEcmpHostKey key_;
+  };
+
+  template <typename MapT>
+  typename MapT::HostType* incRef(
+      MapT* map,
+      const typename MapT::KeyType& key) {
+    auto hash = map->hash(key);
+    auto entry = map->find(key, hash);
+    if (entry) {
+      entry->refCount++;
+      return entry->host.get();
+    }
+    auto newHost = std::make_unique<typename MapT::HostType>(this, key);
+    return map->insert(key, hash, std::move(newHost))->host.get();
+  }
+  template <typename MapT>
+  void deref(MapT* map, const typename MapT::KeyType& key) {
+    auto entry = map->find(key);
+    if (--entry->refCount == 0) {
+      map->erase(entry);
+    }
+  }
+
+  BcmHostIndex<BcmHostKey, Host, BcmHostKey::Hash> hosts_;
+  BcmHostIndex<BcmEcmpHostKey, EcmpHost, BcmEcmpHostKeyHash> ecmpHosts_;
+};
+
+const std::vector<BcmEcmpHostKey>& keys() {
+  static const auto kKeys = makeKeys();
+  return kKeys;
+}
+
+template <typename TableT>
+void createAndDeref(int numIters) {
+  TableT table;
+  for (int iter = 0; iter < numIters; ++iter) {
+    for (const auto& key : keys()) {
+      table.incRef(&table.ecmpHosts_, key);
+    }
+    // Routes pointing to the same groups only bump the reference counts
+    for (const auto& key : keys()) {
+      table.incRef(&table.ecmpHosts_, key);
+    }
+    for (const auto& key : keys()) {
+      table.deref(&table.ecmpHosts_, key);
+    }
+    for (const auto& key : keys()) {
+      table.deref(&table.ecmpHosts_, key);
+    }
+  }
+}
+
+} // unnamed namespace
+
+BENCHMARK(FlatMapEcmpCreateDeref, numIters) {
+  BENCHMARK_SUSPEND {
+    keys();
+  }
+  createAndDeref<FlatMapTable>(numIters);
+}
+
+BENCHMARK_RELATIVE(HashIndexEcmpCreateDeref, numIters) {
+  BENCHMARK_SUSPEND {
+    keys();
+  }
+  createAndDeref<HashIndexTable>(numIters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmHostIndex.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+using namespace facebook::fboss;
+
+namespace {
+
+struct Host {
+  explicit Host(int v) : value(v) {}
+  int value;
+};
+
+// Sends every key to the same few slots, to exercise probing
+struct CollidingHash {
+  size_t operator()(int key) const {
+    return key % 3;
+  }
+};
+
+using TestIndex = BcmHostIndex<int, Host, CollidingHash>;
+
+TestIndex::Entry* add(TestIndex* index, int key) {
+  return index->insert(key, index->hash(key), std::make_unique<Host>(key));
+}
+
+} // unnamed namespace
+
+TEST(BcmHostIndex, insertFindErase) {
+  TestIndex index;
+  EXPECT_EQ(nullptr, index.find(1));
+
+  std::map<int, TestIndex::Entry*> added;
+  for (int i = 0; i < 100; ++i) {
+    added[i] = add(&index, i);
+  }
+  ASSERT_EQ(100, index.size());
+  for (const auto& keyAndEntry : added) {
+    auto entry = index.find(keyAndEntry.first);
+    // Entries don't move as the index grows
+    EXPECT_EQ(keyAndEntry.second, entry);
+    EXPECT_EQ(keyAndEntry.first, entry->host->value);
+    EXPECT_EQ(1, entry->refCount);
+  }
+
+  // Erase every other entry, the rest stay where they are
+  for (int i = 0; i < 100; i += 2) {
+    auto host = index.erase(added[i]);
+    EXPECT_EQ(i, host->value);
+    added.erase(i);
+  }
+  EXPECT_EQ(50, index.size());
+  for (int i = 0; i < 100; ++i) {
+    auto entry = index.find(i);
+    if (i % 2 == 0) {
+      EXPECT_EQ(nullptr, entry);
+    } else {
+      EXPECT_EQ(added[i], entry);
+    }
+  }
+
+  // Erased keys can be added back
+  for (int i = 0; i < 100; i += 2) {
+    add(&index, i);
+  }
+  EXPECT_EQ(100, index.size());
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_NE(nullptr, index.find(i));
+    EXPECT_EQ(i, index.find(i)->host->value);
+  }
+}
+
+TEST(BcmHostIndex, entriesAndClear) {
+  TestIndex index;
+  for (int i = 0; i < 10; ++i) {
+    add(&index, i);
+  }
+  index.erase(index.find(3));
+  int sum = 0;
+  for (const auto& entry : index.entries()) {
+    sum += entry->host->value;
+  }
+  EXPECT_EQ(45 - 3, sum);
+
+  index.clear();
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(nullptr, index.find(1));
+  add(&index, 1);
+  EXPECT_EQ(1, index.find(1)->host->value);
+}
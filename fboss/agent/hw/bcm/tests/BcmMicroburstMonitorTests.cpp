@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmMicroburstMonitor.h"
+
+#include <gtest/gtest.h>
+
+DECLARE_uint64(microburst_threshold_bytes);
+
+using namespace facebook::fboss;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+using std::chrono::system_clock;
+
+TEST(BcmMicroburstMonitor, maxAndBursts) {
+  FLAGS_microburst_threshold_bytes = 1000;
+  // Samples are only recorded by hand, so no hardware is needed
+  BcmMicroburstMonitor monitor(nullptr);
+  EXPECT_TRUE(monitor.getQueueBufferStats(seconds(60)).empty());
+
+  auto start = system_clock::now();
+  auto at = [&](int us) { return start + microseconds(us); };
+  monitor.recordSample(PortID(1), 0, 10, at(0));
+  // A 200us burst peaking at 3000 bytes
+  monitor.recordSample(PortID(1), 0, 1500, at(100));
+  monitor.recordSample(PortID(1), 0, 3000, at(200));
+  monitor.recordSample(PortID(1), 0, 500, at(300));
+  // And one which is still going on
+  monitor.recordSample(PortID(1), 0, 2000, at(400));
+  // Another queue which never crosses the threshold
+  monitor.recordSample(PortID(2), 3, 999, at(0));
+
+  auto stats = monitor.getQueueBufferStats(seconds(60));
+  ASSERT_EQ(2, stats.size());
+
+  EXPECT_EQ(1, stats[0].port);
+  EXPECT_EQ(0, stats[0].queue);
+  EXPECT_EQ(3000, stats[0].maxOccupancyBytes);
+  ASSERT_EQ(2, stats[0].bursts.size());
+  EXPECT_EQ(200, stats[0].bursts[0].durationUs);
+  EXPECT_EQ(3000, stats[0].bursts[0].peakBytes);
+  EXPECT_EQ(
+      stats[0].bursts[0].startTimeUs + 300, stats[0].bursts[1].startTimeUs);
+  EXPECT_EQ(0, stats[0].bursts[1].durationUs);
+  EXPECT_EQ(2000, stats[0].bursts[1].peakBytes);
+
+  EXPECT_EQ(2, stats[1].port);
+  EXPECT_EQ(3, stats[1].queue);
+  EXPECT_EQ(999, stats[1].maxOccupancyBytes);
+  EXPECT_TRUE(stats[1].bursts.empty());
+}
@@ -35,6 +35,9 @@ class MockHwSwitch : public HwSwitch {
       stateChangedMock,
       std::shared_ptr<SwitchState>(const StateDelta&));
   MOCK_METHOD2(getAndClearNeighborHit, bool(RouterID, folly::IPAddress&));
+  MOCK_METHOD1(
+      getAndClearNeighborHits,
+      folly::Optional<std::unordered_set<folly::IPAddress>>(RouterID));
 
   std::unique_ptr<TxPacket> allocatePacket(uint32_t size) override;
 
@@ -43,6 +43,8 @@ MockableHwSwitch::MockableHwSwitch(MockPlatform *platform, HwSwitch* realHw)
     .WillByDefault(Invoke(realHw_, &HwSwitch::stateChanged));
   ON_CALL(*this, getAndClearNeighborHit(_, _))
     .WillByDefault(Invoke(realHw_, &HwSwitch::getAndClearNeighborHit));
+  ON_CALL(*this, getAndClearNeighborHits(_))
+    .WillByDefault(Invoke(realHw_, &HwSwitch::getAndClearNeighborHits));
   ON_CALL(*this, toFollyDynamic())
     .WillByDefault(Invoke(realHw_, &HwSwitch::toFollyDynamic));
   ON_CALL(*this, updateStats(_))
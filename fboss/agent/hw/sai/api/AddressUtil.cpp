@@ -10,6 +10,7 @@
 
 #include "AddressUtil.h"
 
+#include <folly/Bits.h>
 #include <folly/lang/Assume.h>
 
 namespace facebook {
@@ -54,6 +55,43 @@ sai_ip_address_t toSaiIpAddress(const folly::IPAddressV6& addr) {
   return out;
 }
 
+folly::CIDRNetwork fromSaiIpPrefix(const sai_ip_prefix_t& prefix) {
+  switch (prefix.addr_family) {
+    case SAI_IP_ADDR_FAMILY_IPV4:
+      return folly::CIDRNetwork(
+          fromSaiIpAddress(prefix.addr.ip4),
+          folly::popcount(prefix.mask.ip4));
+    case SAI_IP_ADDR_FAMILY_IPV6: {
+      uint8_t len = 0;
+      for (auto byte : prefix.mask.ip6) {
+        len += folly::popcount(static_cast<uint32_t>(byte));
+      }
+      return folly::CIDRNetwork(fromSaiIpAddress(prefix.addr.ip6), len);
+    }
+  }
+  folly::assume_unreachable();
+}
+
+sai_ip_prefix_t toSaiIpPrefix(const folly::CIDRNetwork& prefix) {
+  sai_ip_prefix_t out;
+  auto network = prefix.first.mask(prefix.second);
+  if (network.isV4()) {
+    out.addr_family = SAI_IP_ADDR_FAMILY_IPV4;
+    out.addr.ip4 = network.asV4().toLong();
+    auto mask = folly::IPAddressV4::fetchMask(prefix.second);
+    out.mask.ip4 = folly::IPAddressV4::fromBinary(
+                       folly::ByteRange(mask.data(), mask.size()))
+                       .toLong();
+  } else {
+    out.addr_family = SAI_IP_ADDR_FAMILY_IPV6;
+    folly::ByteRange r = network.asV6().toBinary();
+    std::copy(std::begin(r), std::end(r), std::begin(out.addr.ip6));
+    auto mask = folly::IPAddressV6::fetchMask(prefix.second);
+    std::copy(std::begin(mask), std::end(mask), std::begin(out.mask.ip6));
+  }
+  return out;
+}
+
 folly::MacAddress fromSaiMacAddress(const sai_mac_t& mac) {
   return folly::MacAddress::fromBinary(
       folly::ByteRange(std::begin(mac), std::end(mac)));
@@ -28,6 +28,9 @@ sai_ip_address_t toSaiIpAddress(const folly::IPAddress& addr);
 sai_ip_address_t toSaiIpAddress(const folly::IPAddressV4& addr);
 sai_ip_address_t toSaiIpAddress(const folly::IPAddressV6& addr);
 
+folly::CIDRNetwork fromSaiIpPrefix(const sai_ip_prefix_t& prefix);
+sai_ip_prefix_t toSaiIpPrefix(const folly::CIDRNetwork& prefix);
+
 folly::MacAddress fromSaiMacAddress(const sai_mac_t& mac);
 void toSaiMacAddress(const folly::MacAddress& src, sai_mac_t& dst);
 
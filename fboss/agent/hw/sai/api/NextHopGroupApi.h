@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "SaiApi.h"
+
+#include "fboss/agent/hw/sai/api/SaiAttribute.h"
+
+#include <folly/logging/xlog.h>
+
+#include <vector>
+
+extern "C" {
+  #include <sai.h>
+}
+
+namespace facebook {
+namespace fboss {
+
+struct NextHopGroupTypes {
+  struct Attributes {
+    using EnumType = sai_next_hop_group_attr_t;
+    using NextHopMemberList = SaiAttribute<
+        EnumType,
+        SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_MEMBER_LIST,
+        sai_object_list_t,
+        std::vector<sai_object_id_t>>;
+    using Type =
+        SaiAttribute<EnumType, SAI_NEXT_HOP_GROUP_ATTR_TYPE, sai_int32_t>;
+  };
+  using AttributeType =
+      boost::variant<Attributes::NextHopMemberList, Attributes::Type>;
+  struct MemberAttributes {
+    using EnumType = sai_next_hop_group_member_attr_t;
+    using NextHopGroupId = SaiAttribute<
+        EnumType,
+        SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_GROUP_ID,
+        sai_object_id_t,
+        SaiObjectIdT>;
+    using NextHopId = SaiAttribute<
+        EnumType,
+        SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_ID,
+        sai_object_id_t,
+        SaiObjectIdT>;
+    using Weight = SaiAttribute<
+        EnumType,
+        SAI_NEXT_HOP_GROUP_MEMBER_ATTR_WEIGHT,
+        sai_uint32_t>;
+  };
+  using MemberAttributeType = boost::variant<
+      MemberAttributes::NextHopGroupId,
+      MemberAttributes::NextHopId,
+      MemberAttributes::Weight>;
+  struct EntryType {};
+};
+
+class NextHopGroupApi : public SaiApi<NextHopGroupApi, NextHopGroupTypes> {
+ public:
+  NextHopGroupApi() {
+    sai_status_t res = sai_api_query(
+        SAI_API_NEXT_HOP_GROUP, reinterpret_cast<void**>(&api_));
+    if (res != SAI_STATUS_SUCCESS) {
+      throw SaiApiError(res);
+    }
+  }
+  NextHopGroupApi(const NextHopGroupApi& other) = delete;
+
+ protected:
+  sai_status_t _create(
+      sai_object_id_t* next_hop_group_id,
+      sai_attribute_t* attr_list,
+      size_t count,
+      sai_object_id_t switch_id) {
+    return api_->create_next_hop_group(
+        next_hop_group_id, switch_id, count, attr_list);
+  }
+  sai_status_t _remove(sai_object_id_t next_hop_group_id) {
+    return api_->remove_next_hop_group(next_hop_group_id);
+  }
+  sai_status_t _getAttr(sai_attribute_t* attr, sai_object_id_t handle) const {
+    return api_->get_next_hop_group_attribute(handle, 1, attr);
+  }
+  sai_status_t _setAttr(const sai_attribute_t* attr, sai_object_id_t handle) {
+    return api_->set_next_hop_group_attribute(handle, attr);
+  }
+  sai_status_t _createMember(
+      sai_object_id_t* next_hop_group_member_id,
+      sai_attribute_t* attr_list,
+      size_t count,
+      sai_object_id_t switch_id) {
+    return api_->create_next_hop_group_member(
+        next_hop_group_member_id, switch_id, count, attr_list);
+  }
+  sai_status_t _removeMember(sai_object_id_t next_hop_group_member_id) {
+    return api_->remove_next_hop_group_member(next_hop_group_member_id);
+  }
+  sai_status_t _getMemberAttr(sai_attribute_t* attr, sai_object_id_t handle)
+      const {
+    return api_->get_next_hop_group_member_attribute(handle, 1, attr);
+  }
+  sai_status_t _setMemberAttr(
+      const sai_attribute_t* attr,
+      sai_object_id_t handle) {
+    return api_->set_next_hop_group_member_attribute(handle, attr);
+  }
+
+  // Use the native bulk member calls when the SAI implementation has them
+  sai_status_t _bulkCreateMembers(
+      size_t count,
+      const uint32_t* attrCounts,
+      sai_attribute_t* const* attrLists,
+      sai_bulk_op_error_mode_t mode,
+      sai_object_id_t* ids,
+      sai_status_t* statuses,
+      sai_object_id_t switch_id) {
+    if (!api_->create_next_hop_group_members) {
+      return SaiApi::_bulkCreateMembers(
+          count, attrCounts, attrLists, mode, ids, statuses, switch_id);
+    }
+    return api_->create_next_hop_group_members(
+        switch_id,
+        count,
+        attrCounts,
+        const_cast<const sai_attribute_t**>(attrLists),
+        mode,
+        ids,
+        statuses);
+  }
+  sai_status_t _bulkRemoveMembers(
+      const sai_object_id_t* ids,
+      size_t count,
+      sai_bulk_op_error_mode_t mode,
+      sai_status_t* statuses) {
+    if (!api_->remove_next_hop_group_members) {
+      return SaiApi::_bulkRemoveMembers(ids, count, mode, statuses);
+    }
+    return api_->remove_next_hop_group_members(count, ids, mode, statuses);
+  }
+
+ private:
+  sai_next_hop_group_api_t* api_;
+  friend class SaiApi<NextHopGroupApi, NextHopGroupTypes>;
+};
+
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,18 @@
+#include "RouteApi.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <functional>
+
+namespace std {
+size_t hash<facebook::fboss::RouteTypes::RouteEntry>::operator()(
+    const facebook::fboss::RouteTypes::RouteEntry& r) const {
+  size_t seed = 0;
+  boost::hash_combine(seed, r.switchId());
+  boost::hash_combine(seed, r.virtualRouterId());
+  auto prefix = r.prefix();
+  boost::hash_combine(seed, std::hash<folly::IPAddress>()(prefix.first));
+  boost::hash_combine(seed, prefix.second);
+  return seed;
+}
+} // namespace std
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "SaiAttribute.h"
+#include "SaiAttributeList.h"
 #include "Traits.h"
 
 #include <folly/Format.h>
@@ -100,11 +101,167 @@ class SaiApi {
     }
   }
 
+  /*
+   * create() variants taking a SaiAttributeList, for the paths where the
+   * attributes are known at compile time. The sai_attribute_t array is
+   * built on the stack, straight from the attributes, so these don't
+   * allocate or visit a variant.
+   */
+  template <typename T = ApiTypes, typename... AttrTs, typename... Args>
+  typename std::enable_if<apiUsesObjectId<T>::value, sai_object_id_t>::type
+  create(const SaiAttributeList<AttrTs...>& attributes, Args&&... args) {
+    checkAttributeList<typename T::Attributes, AttrTs...>();
+    sai_object_id_t id;
+    auto saiAttributeTs = attributes.saiAttributeTs();
+    sai_status_t res = impl()._create(
+        &id,
+        saiAttributeTs.data(),
+        saiAttributeTs.size(),
+        std::forward<Args>(args)...);
+    if (res != SAI_STATUS_SUCCESS) {
+      throw SaiApiError(res);
+    }
+    return id;
+  }
+
+  template <typename T = ApiTypes, typename... AttrTs, typename... Args>
+  typename std::enable_if<apiUsesEntry<T>::value, void>::type create(
+      const typename T::EntryType& entry,
+      const SaiAttributeList<AttrTs...>& attributes,
+      Args&&... args) {
+    checkAttributeList<typename T::Attributes, AttrTs...>();
+    auto saiAttributeTs = attributes.saiAttributeTs();
+    sai_status_t res = impl()._create(
+        entry,
+        saiAttributeTs.data(),
+        saiAttributeTs.size(),
+        std::forward<Args>(args)...);
+    if (res != SAI_STATUS_SUCCESS) {
+      throw SaiApiError(res);
+    }
+  }
+
   template <typename T>
   sai_status_t remove(const T& t) {
     return impl()._remove(t);
   }
 
+  /*
+   * Bulk variants of create() and remove(), for programming many objects of
+   * the same type at once. Each object gets its own status; with
+   * SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR the objects after the first failure
+   * are not attempted and get SAI_STATUS_NOT_EXECUTED. Failures are reported
+   * through the statuses rather than thrown.
+   *
+   * The sai_attribute_t structs of all the objects are copied into one
+   * buffer, which is kept across calls to avoid reallocating it for every
+   * batch. Apis whose SAI tables have native bulk entry points can provide
+   * _bulkCreate/_bulkRemove to use them, the others fall back to one call per
+   * object.
+   */
+  template <typename T = ApiTypes, typename... Args>
+  typename std::enable_if<
+      apiUsesObjectId<T>::value,
+      std::vector<sai_status_t>>::type
+  bulkCreate(
+      const std::vector<std::vector<typename T::AttributeType>>& attributeSets,
+      std::vector<sai_object_id_t>* ids,
+      sai_bulk_op_error_mode_t mode,
+      Args&&... args) {
+    static_assert(
+        std::is_same<T, ApiTypes>::value,
+        "AttributeType must come from correct ApiTypes");
+    fillBulkAttributes(attributeSets);
+    std::vector<sai_status_t> statuses(
+        attributeSets.size(), SAI_STATUS_NOT_EXECUTED);
+    ids->assign(attributeSets.size(), SAI_NULL_OBJECT_ID);
+    impl()._bulkCreate(
+        attributeSets.size(),
+        bulkAttrCounts_.data(),
+        bulkAttrLists_.data(),
+        mode,
+        ids->data(),
+        statuses.data(),
+        std::forward<Args>(args)...);
+    return statuses;
+  }
+
+  template <typename T = ApiTypes, typename... Args>
+  typename std::enable_if<
+      apiUsesEntry<T>::value,
+      std::vector<sai_status_t>>::type
+  bulkCreate(
+      const std::vector<typename T::EntryType>& entries,
+      const std::vector<std::vector<typename T::AttributeType>>& attributeSets,
+      sai_bulk_op_error_mode_t mode,
+      Args&&... args) {
+    static_assert(
+        std::is_same<T, ApiTypes>::value,
+        "AttributeType or EntryTypes must come from correct ApiTypes");
+    if (entries.size() != attributeSets.size()) {
+      throw SaiApiError(SAI_STATUS_INVALID_PARAMETER);
+    }
+    fillBulkAttributes(attributeSets);
+    std::vector<sai_status_t> statuses(
+        entries.size(), SAI_STATUS_NOT_EXECUTED);
+    impl()._bulkCreate(
+        entries.data(),
+        entries.size(),
+        bulkAttrCounts_.data(),
+        bulkAttrLists_.data(),
+        mode,
+        statuses.data(),
+        std::forward<Args>(args)...);
+    return statuses;
+  }
+
+  template <typename T>
+  std::vector<sai_status_t> bulkRemove(
+      const std::vector<T>& ts,
+      sai_bulk_op_error_mode_t mode) {
+    std::vector<sai_status_t> statuses(ts.size(), SAI_STATUS_NOT_EXECUTED);
+    impl()._bulkRemove(ts.data(), ts.size(), mode, statuses.data());
+    return statuses;
+  }
+
+  // Bulk variants of createMember() and removeMember(), as above
+  template <typename T = ApiTypes, typename... Args>
+  typename std::enable_if<
+      apiHasMembers<T>::value,
+      std::vector<sai_status_t>>::type
+  bulkCreateMembers(
+      const std::vector<std::vector<typename T::MemberAttributeType>>&
+          attributeSets,
+      std::vector<sai_object_id_t>* ids,
+      sai_bulk_op_error_mode_t mode,
+      Args&&... args) {
+    fillBulkAttributes(attributeSets);
+    std::vector<sai_status_t> statuses(
+        attributeSets.size(), SAI_STATUS_NOT_EXECUTED);
+    ids->assign(attributeSets.size(), SAI_NULL_OBJECT_ID);
+    impl()._bulkCreateMembers(
+        attributeSets.size(),
+        bulkAttrCounts_.data(),
+        bulkAttrLists_.data(),
+        mode,
+        ids->data(),
+        statuses.data(),
+        std::forward<Args>(args)...);
+    return statuses;
+  }
+
+  template <typename T = ApiTypes>
+  typename std::enable_if<
+      apiHasMembers<T>::value,
+      std::vector<sai_status_t>>::type
+  bulkRemoveMembers(
+      const std::vector<sai_object_id_t>& ids,
+      sai_bulk_op_error_mode_t mode) {
+    std::vector<sai_status_t> statuses(ids.size(), SAI_STATUS_NOT_EXECUTED);
+    impl()._bulkRemoveMembers(ids.data(), ids.size(), mode, statuses.data());
+    return statuses;
+  }
+
   template <typename AttrT, typename... Args>
   typename std::remove_reference<AttrT>::type::ValueType getAttribute(
       AttrT&& attr,
@@ -157,11 +314,154 @@ class SaiApi {
     return id;
   }
 
+  template <typename T = ApiTypes, typename... AttrTs, typename... Args>
+  typename std::enable_if<apiHasMembers<T>::value, sai_object_id_t>::type
+  createMember(
+      const SaiAttributeList<AttrTs...>& attributes,
+      Args&&... args) {
+    checkAttributeList<typename T::MemberAttributes, AttrTs...>();
+    auto saiAttributeTs = attributes.saiAttributeTs();
+    sai_object_id_t id;
+    sai_status_t res = impl()._createMember(
+        &id,
+        saiAttributeTs.data(),
+        saiAttributeTs.size(),
+        std::forward<Args>(args)...);
+    if (res != SAI_STATUS_SUCCESS) {
+      throw SaiApiError(res);
+    }
+    return id;
+  }
+
   sai_status_t removeMember(sai_object_id_t id) {
     return impl()._removeMember(id);
   }
 
+ protected:
+  /*
+   * Fallbacks for apis without native bulk calls, one _create or _remove
+   * per object. They return SAI_STATUS_FAILURE if any object failed, like
+   * the SAI bulk calls do.
+   */
+  template <typename... Args>
+  sai_status_t _bulkCreate(
+      size_t count,
+      const uint32_t* attrCounts,
+      sai_attribute_t* const* attrLists,
+      sai_bulk_op_error_mode_t mode,
+      sai_object_id_t* ids,
+      sai_status_t* statuses,
+      Args&&... args) {
+    return bulkForEach(count, mode, statuses, [&](size_t i) {
+      return impl()._create(&ids[i], attrLists[i], attrCounts[i], args...);
+    });
+  }
+
+  template <typename EntryT, typename... Args>
+  sai_status_t _bulkCreate(
+      const EntryT* entries,
+      size_t count,
+      const uint32_t* attrCounts,
+      sai_attribute_t* const* attrLists,
+      sai_bulk_op_error_mode_t mode,
+      sai_status_t* statuses,
+      Args&&... args) {
+    return bulkForEach(count, mode, statuses, [&](size_t i) {
+      return impl()._create(entries[i], attrLists[i], attrCounts[i], args...);
+    });
+  }
+
+  template <typename T>
+  sai_status_t _bulkRemove(
+      const T* ts,
+      size_t count,
+      sai_bulk_op_error_mode_t mode,
+      sai_status_t* statuses) {
+    return bulkForEach(count, mode, statuses, [&](size_t i) {
+      return impl()._remove(ts[i]);
+    });
+  }
+
+  template <typename... Args>
+  sai_status_t _bulkCreateMembers(
+      size_t count,
+      const uint32_t* attrCounts,
+      sai_attribute_t* const* attrLists,
+      sai_bulk_op_error_mode_t mode,
+      sai_object_id_t* ids,
+      sai_status_t* statuses,
+      Args&&... args) {
+    return bulkForEach(count, mode, statuses, [&](size_t i) {
+      return impl()._createMember(
+          &ids[i], attrLists[i], attrCounts[i], args...);
+    });
+  }
+
+  sai_status_t _bulkRemoveMembers(
+      const sai_object_id_t* ids,
+      size_t count,
+      sai_bulk_op_error_mode_t mode,
+      sai_status_t* statuses) {
+    return bulkForEach(count, mode, statuses, [&](size_t i) {
+      return impl()._removeMember(ids[i]);
+    });
+  }
+
  private:
+  template <typename Fn>
+  static sai_status_t bulkForEach(
+      size_t count,
+      sai_bulk_op_error_mode_t mode,
+      sai_status_t* statuses,
+      Fn fn) {
+    sai_status_t res = SAI_STATUS_SUCCESS;
+    for (size_t i = 0; i < count; ++i) {
+      statuses[i] = fn(i);
+      if (statuses[i] != SAI_STATUS_SUCCESS) {
+        res = SAI_STATUS_FAILURE;
+        if (mode == SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR) {
+          break;
+        }
+      }
+    }
+    return res;
+  }
+
+  // Lay out the sai_attribute_t structs of all the objects back to back in
+  // bulkAttributes_, with bulkAttrLists_ pointing at those of each object
+  template <typename AttrT>
+  void fillBulkAttributes(
+      const std::vector<std::vector<AttrT>>& attributeSets) {
+    size_t total = 0;
+    for (const auto& attributes : attributeSets) {
+      total += attributes.size();
+    }
+    bulkAttributes_.clear();
+    bulkAttributes_.reserve(total);
+    bulkAttrCounts_.clear();
+    bulkAttrLists_.clear();
+    for (const auto& attributes : attributeSets) {
+      bulkAttrCounts_.push_back(attributes.size());
+      for (const auto& attribute : attributes) {
+        bulkAttributes_.push_back(
+            boost::apply_visitor(getSaiAttributeVisitor(), attribute));
+      }
+    }
+    // Only take the pointers once the buffer is done growing
+    auto next = bulkAttributes_.data();
+    for (auto attrCount : bulkAttrCounts_) {
+      bulkAttrLists_.push_back(next);
+      next += attrCount;
+    }
+  }
+
+  template <typename AttributesT, typename... AttrTs>
+  static void checkAttributeList() {
+    static_assert(
+        detail::AllOfEnumType<typename AttributesT::EnumType, AttrTs...>::value,
+        "SaiAttributeList must hold attributes of the correct ApiTypes");
+  }
+
   // boost visitor that takes a SaiAttribute and returns a copy of the
   // underlying sai_attribute_t.
   class getSaiAttributeVisitor : public boost::static_visitor<sai_attribute_t> {
@@ -176,9 +476,7 @@ class SaiApi {
   // (ApiTypes::AttributeType or ApiTypes::MemberAttributeType), return a vector
   // of the underlying sai_attribute_t structs. Helper function for various
   // methods of SaiApi that take multiple attributes, particularly create()
-  // TODO(borisb): In the future, we can create an AttributeList class that
-  // provides this behavior more directly and stores the sai_attribute_t structs
-  // inline to prevent unnecessary copying
+  // See SaiAttributeList for the allocation free alternative
   template <typename AttrT>
   std::vector<sai_attribute_t> getSaiAttributeTs(
       const std::vector<AttrT>& attributes) const {
@@ -197,6 +495,10 @@ class SaiApi {
   ApiT& impl() {
     return static_cast<ApiT&>(*this);
   }
+
+  std::vector<sai_attribute_t> bulkAttributes_;
+  std::vector<uint32_t> bulkAttrCounts_;
+  std::vector<sai_attribute_t*> bulkAttrLists_;
   };
 
 } // namespace fboss
@@ -250,8 +250,10 @@ class SaiAttribute<
         std::is_same<DataT, ValueT>::value ||
         isDuplicateValueType<ValueT>::value>::type> {
  public:
+  using EnumType = AttrEnumT;
   using DataType = DataT;
   using ValueType = DataT;
+  static constexpr AttrEnumT Id = AttrEnum;
 
   SaiAttribute() {
     saiAttr_.id = AttrEnum;
@@ -305,8 +307,10 @@ class SaiAttribute<
         !std::is_same<DataT, ValueT>::value &&
         !isDuplicateValueType<ValueT>::value>::type> {
  public:
+  using EnumType = AttrEnumT;
   using DataType = DataT;
   using ValueType = ValueT;
+  static constexpr AttrEnumT Id = AttrEnum;
 
   SaiAttribute() {
     saiAttr_.id = AttrEnum;
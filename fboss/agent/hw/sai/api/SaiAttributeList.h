@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "SaiAttribute.h"
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <sai.h>
+}
+
+/*
+ * SaiAttributeList is a fixed set of SaiAttributes, known at compile time,
+ * to pass to SAI together, e.g., on create:
+ *
+ * using Attrs = NextHopTypes::Attributes;
+ * auto attributes = makeSaiAttributeList(
+ *     Attrs::Type(SAI_NEXT_HOP_TYPE_IP),
+ *     Attrs::Ip(ip),
+ *     Attrs::RouterInterfaceId(routerInterfaceId));
+ * auto id = nextHopApi.create(attributes, switchId);
+ *
+ * Unlike a vector of boost::variant wrapped attributes, the attributes are
+ * stored inline in a std::tuple, and the sai_attribute_t array handed to
+ * SAI lives on the stack, so creating an object neither allocates nor
+ * visits a variant.
+ *
+ * Every attribute in a list must belong to the same SAI object type and may
+ * only appear once; both are checked at compile time.
+ *
+ * List valued attributes point into the vector they hold, so move them into
+ * the list, as above, rather than copying them.
+ */
+
+namespace facebook {
+namespace fboss {
+
+namespace detail {
+
+template <typename... AttrTs>
+struct SameEnumType;
+
+template <>
+struct SameEnumType<> : std::true_type {};
+
+template <typename AttrT>
+struct SameEnumType<AttrT> : std::true_type {};
+
+template <typename AttrT, typename NextT, typename... AttrTs>
+struct SameEnumType<AttrT, NextT, AttrTs...>
+    : std::integral_constant<
+          bool,
+          std::is_same<typename AttrT::EnumType, typename NextT::EnumType>::
+                  value &&
+              SameEnumType<NextT, AttrTs...>::value> {};
+
+template <typename EnumT, typename... AttrTs>
+struct AllOfEnumType;
+
+template <typename EnumT>
+struct AllOfEnumType<EnumT> : std::true_type {};
+
+template <typename EnumT, typename AttrT, typename... AttrTs>
+struct AllOfEnumType<EnumT, AttrT, AttrTs...>
+    : std::integral_constant<
+          bool,
+          std::is_same<EnumT, typename AttrT::EnumType>::value &&
+              AllOfEnumType<EnumT, AttrTs...>::value> {};
+
+template <size_t N>
+constexpr bool idsUnique(const sai_attr_id_t (&ids)[N]) {
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = i + 1; j < N; ++j) {
+      if (ids[i] == ids[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename... AttrTs>
+constexpr bool attributeIdsUnique() {
+  constexpr sai_attr_id_t ids[] = {static_cast<sai_attr_id_t>(AttrTs::Id)...};
+  return idsUnique(ids);
+}
+
+template <>
+constexpr bool attributeIdsUnique<>() {
+  return true;
+}
+
+} // namespace detail
+
+template <typename... AttrTs>
+class SaiAttributeList {
+  static_assert(
+      detail::SameEnumType<AttrTs...>::value,
+      "SaiAttributeList attributes must belong to the same object type");
+  static_assert(
+      detail::attributeIdsUnique<AttrTs...>(),
+      "SaiAttributeList must not contain an attribute twice");
+
+ public:
+  using SaiAttributeTs = std::array<sai_attribute_t, sizeof...(AttrTs)>;
+
+  explicit SaiAttributeList(AttrTs... attrs) : attrs_(std::move(attrs)...) {}
+
+  static constexpr size_t size() {
+    return sizeof...(AttrTs);
+  }
+
+  template <typename AttrT>
+  AttrT& get() {
+    return std::get<AttrT>(attrs_);
+  }
+
+  template <typename AttrT>
+  const AttrT& get() const {
+    return std::get<AttrT>(attrs_);
+  }
+
+  /*
+   * The underlying sai_attribute_t structs, in the order of the attributes.
+   * List valued attributes point into storage owned by this list, so the
+   * result must not outlive it.
+   */
+  SaiAttributeTs saiAttributeTs() const {
+    return saiAttributeTs(std::index_sequence_for<AttrTs...>());
+  }
+
+ private:
+  template <size_t... I>
+  SaiAttributeTs saiAttributeTs(std::index_sequence<I...>) const {
+    return SaiAttributeTs{{*std::get<I>(attrs_).saiAttr()...}};
+  }
+
+  std::tuple<AttrTs...> attrs_;
+};
+
+template <typename... AttrTs>
+SaiAttributeList<typename std::decay<AttrTs>::type...> makeSaiAttributeList(
+    AttrTs&&... attrs) {
+  return SaiAttributeList<typename std::decay<AttrTs>::type...>(
+      std::forward<AttrTs>(attrs)...);
+}
+
+} // namespace fboss
+} // namespace facebook
@@ -38,6 +38,11 @@ template <>
 struct apiUsesObjectId<NeighborTypes> : public std::false_type {};
 template <>
 struct apiUsesEntry<NeighborTypes> : public std::true_type {};
+class RouteTypes;
+template <>
+struct apiUsesObjectId<RouteTypes> : public std::false_type {};
+template <>
+struct apiUsesEntry<RouteTypes> : public std::true_type {};
 
 /*
  * apiHasMembers<T>::value is true if T is an ApiTypes which
@@ -48,10 +53,13 @@ template <typename ApiTypes>
 struct apiHasMembers : public std::false_type {};
 
 class BridgeTypes;
+class NextHopGroupTypes;
 class VlanTypes;
 template <>
 struct apiHasMembers<BridgeTypes> : public std::true_type {};
 template <>
+struct apiHasMembers<NextHopGroupTypes> : public std::true_type {};
+template <>
 struct apiHasMembers<VlanTypes> : public std::true_type {};
 
 /*
@@ -48,6 +48,22 @@ TEST(AddressUtilTest, IPAddressV6) {
   EXPECT_EQ(ip6, reverse6);
 }
 
+TEST(AddressUtilTest, IPPrefix) {
+  auto prefix4 = folly::IPAddress::createNetwork("42.42.0.0/16");
+  sai_ip_prefix_t sai4 = toSaiIpPrefix(prefix4);
+  EXPECT_EQ(SAI_IP_ADDR_FAMILY_IPV4, sai4.addr_family);
+  EXPECT_EQ(prefix4, fromSaiIpPrefix(sai4));
+  auto prefix6 = folly::IPAddress::createNetwork("4242:4242::/32");
+  sai_ip_prefix_t sai6 = toSaiIpPrefix(prefix6);
+  EXPECT_EQ(SAI_IP_ADDR_FAMILY_IPV6, sai6.addr_family);
+  EXPECT_EQ(prefix6, fromSaiIpPrefix(sai6));
+  // Host bits are masked off
+  auto host = std::make_pair(folly::IPAddress(str4), 24);
+  EXPECT_EQ(
+      folly::IPAddress::createNetwork("42.42.12.0/24"),
+      fromSaiIpPrefix(toSaiIpPrefix(host)));
+}
+
 TEST(AddressUtilTest, MacAddress) {
   folly::MacAddress mac(strMac);
   sai_mac_t saiMac;
@@ -8,6 +8,7 @@
  *
  */
 #include "fboss/agent/hw/sai/api/SaiAttribute.h"
+#include "fboss/agent/hw/sai/api/SaiAttributeList.h"
 
 #include <folly/logging/xlog.h>
 
@@ -179,3 +180,37 @@ TEST(Attribute, dupeType) {
       std::is_same<UInt64TAttr::ValueType, uint64_t>::value,
       "uint64_t attr ValueT should be uint64_t");
 }
+
+using BoolAttr = SaiAttribute<sai_attr_id_t, 1, bool>;
+using IdListAttr = SaiAttribute<
+    sai_attr_id_t,
+    2,
+    sai_object_list_t,
+    std::vector<sai_object_id_t>>;
+TEST(AttributeList, saiAttributeTs) {
+  std::vector<sai_object_id_t> v{0, 1, 4, 9};
+  auto attributes = makeSaiAttributeList(BoolAttr(true), IdListAttr(v));
+  static_assert(
+      decltype(attributes)::size() == 2, "list should hold two attributes");
+  auto saiAttributeTs = attributes.saiAttributeTs();
+  EXPECT_EQ(1, saiAttributeTs[0].id);
+  EXPECT_TRUE(saiAttributeTs[0].value.booldata);
+  EXPECT_EQ(2, saiAttributeTs[1].id);
+  ASSERT_EQ(4, saiAttributeTs[1].value.objlist.count);
+  for (int i = 0; i < saiAttributeTs[1].value.objlist.count; ++i) {
+    EXPECT_EQ(i * i, saiAttributeTs[1].value.objlist.list[i]);
+  }
+  EXPECT_EQ(v, attributes.get<IdListAttr>().value());
+}
+
+TEST(AttributeList, modifyAttribute) {
+  auto attributes = makeSaiAttributeList(BoolAttr(true));
+  attributes.get<BoolAttr>().saiAttr()->value.booldata = false;
+  EXPECT_FALSE(attributes.saiAttributeTs()[0].value.booldata);
+}
+
+TEST(AttributeList, empty) {
+  auto attributes = makeSaiAttributeList();
+  static_assert(decltype(attributes)::size() == 0, "list should be empty");
+  EXPECT_TRUE(attributes.saiAttributeTs().empty());
+}
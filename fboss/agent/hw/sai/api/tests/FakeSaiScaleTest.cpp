@@ -0,0 +1,179 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sai/api/NeighborApi.h"
+#include "fboss/agent/hw/sai/api/NextHopApi.h"
+#include "fboss/agent/hw/sai/api/RouteApi.h"
+#include "fboss/agent/hw/sai/fake/FakeSai.h"
+
+#include <folly/IPAddress.h>
+#include <folly/IPAddressV6.h>
+#include <folly/logging/xlog.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+using namespace facebook::fboss;
+
+/*
+ * Programs FakeSai at the scale of a full table, to keep the fakes usable
+ * for scale tests, and logs how many objects per second each step goes
+ * through.
+ */
+namespace {
+
+constexpr int kRoutes = 100000;
+constexpr int kNeighbors = 10000;
+constexpr int kNextHops = 64;
+
+folly::IPAddressV6 makeAddr(uint8_t hi, uint32_t i) {
+  std::array<uint8_t, 16> bytes{{0x24, 0x01, 0xdb, 0x00, hi}};
+  for (int b = 0; b < 4; ++b) {
+    bytes[15 - b] = (i >> (8 * b)) & 0xff;
+  }
+  return folly::IPAddressV6(bytes);
+}
+
+class Timer {
+ public:
+  explicit Timer(const char* what, int count)
+      : what_(what), count_(count), start_(std::chrono::steady_clock::now()) {}
+  ~Timer() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    XLOG(INFO) << what_ << ": " << count_ << " in " << elapsed.count()
+               << "s, " << static_cast<uint64_t>(count_ / elapsed.count())
+               << "/s";
+  }
+
+ private:
+  const char* what_;
+  int count_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // unnamed namespace
+
+class FakeSaiScaleTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    fs = FakeSai::getInstance();
+    sai_api_initialize(0, nullptr);
+    neighborApi = std::make_unique<NeighborApi>();
+    nextHopApi = std::make_unique<NextHopApi>();
+    routeApi = std::make_unique<RouteApi>();
+  }
+  std::shared_ptr<FakeSai> fs;
+  std::unique_ptr<NeighborApi> neighborApi;
+  std::unique_ptr<NextHopApi> nextHopApi;
+  std::unique_ptr<RouteApi> routeApi;
+};
+
+TEST_F(FakeSaiScaleTest, neighbors) {
+  std::vector<NeighborTypes::NeighborEntry> neighbors;
+  for (int i = 0; i < kNeighbors; ++i) {
+    neighbors.emplace_back(0, 0, folly::IPAddress(makeAddr(1, i)));
+  }
+  folly::MacAddress mac("42:42:42:12:34:56");
+  {
+    Timer t("create neighbors", kNeighbors);
+    for (const auto& neighbor : neighbors) {
+      neighborApi->create(
+          neighbor,
+          makeSaiAttributeList(NeighborTypes::Attributes::DstMac(mac)));
+    }
+  }
+  EXPECT_EQ(kNeighbors, fs->nm.map().size());
+  {
+    Timer t("get neighbors", kNeighbors);
+    for (const auto& neighbor : neighbors) {
+      NeighborTypes::Attributes::DstMac dstMac;
+      EXPECT_EQ(mac, neighborApi->getAttribute(dstMac, neighbor));
+    }
+  }
+  {
+    Timer t("remove neighbors", kNeighbors);
+    for (const auto& neighbor : neighbors) {
+      EXPECT_EQ(SAI_STATUS_SUCCESS, neighborApi->remove(neighbor));
+    }
+  }
+  EXPECT_TRUE(fs->nm.map().empty());
+}
+
+TEST_F(FakeSaiScaleTest, routes) {
+  std::vector<sai_object_id_t> nextHopIds;
+  for (int i = 0; i < kNextHops; ++i) {
+    nextHopIds.push_back(nextHopApi->create(
+        makeSaiAttributeList(
+            NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+            NextHopTypes::Attributes::Ip(folly::IPAddress(makeAddr(1, i))),
+            NextHopTypes::Attributes::RouterInterfaceId(0)),
+        0));
+  }
+  std::vector<RouteTypes::RouteEntry> routes;
+  std::vector<std::vector<RouteTypes::AttributeType>> attributeSets;
+  for (int i = 0; i < kRoutes; ++i) {
+    routes.emplace_back(
+        0, 0, folly::CIDRNetwork(folly::IPAddress(makeAddr(2, i << 8)), 120));
+    attributeSets.push_back(
+        {RouteTypes::Attributes::NextHopId(nextHopIds[i % kNextHops])});
+  }
+  {
+    Timer t("bulk create routes", kRoutes);
+    auto statuses = routeApi->bulkCreate(
+        routes, attributeSets, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+    EXPECT_EQ(std::vector<sai_status_t>(kRoutes, SAI_STATUS_SUCCESS), statuses);
+  }
+  EXPECT_EQ(kRoutes, fs->rm.map().size());
+  {
+    Timer t("get routes", kRoutes);
+    for (int i = 0; i < kRoutes; ++i) {
+      RouteTypes::Attributes::NextHopId nextHopId;
+      EXPECT_EQ(
+          nextHopIds[i % kNextHops],
+          routeApi->getAttribute(nextHopId, routes[i]));
+    }
+  }
+  {
+    Timer t("bulk remove routes", kRoutes);
+    auto statuses =
+        routeApi->bulkRemove(routes, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+    EXPECT_EQ(std::vector<sai_status_t>(kRoutes, SAI_STATUS_SUCCESS), statuses);
+  }
+  EXPECT_TRUE(fs->rm.map().empty());
+  for (auto nextHopId : nextHopIds) {
+    nextHopApi->remove(nextHopId);
+  }
+  EXPECT_TRUE(fs->nhm.map().empty());
+}
+
+TEST_F(FakeSaiScaleTest, nextHopIdChurn) {
+  // Ids of removed next hops are reused, so churn doesn't grow the store
+  std::vector<sai_object_id_t> nextHopIds;
+  Timer t("create and remove next hops", kNeighbors);
+  for (int i = 0; i < kNeighbors; ++i) {
+    auto id = nextHopApi->create(
+        makeSaiAttributeList(
+            NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+            NextHopTypes::Attributes::Ip(folly::IPAddress(makeAddr(3, i))),
+            NextHopTypes::Attributes::RouterInterfaceId(0)),
+        0);
+    nextHopIds.push_back(id);
+    if (nextHopIds.size() == kNextHops) {
+      for (auto nextHopId : nextHopIds) {
+        nextHopApi->remove(nextHopId);
+      }
+      nextHopIds.clear();
+    }
+    EXPECT_GT(kNextHops, id);
+  }
+}
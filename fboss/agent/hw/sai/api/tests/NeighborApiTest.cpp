@@ -109,3 +109,30 @@ TEST_F(NeighborApiTest, setV6DstMac) {
       neighborApi->getAttribute(NeighborTypes::Attributes::DstMac(), n);
   EXPECT_EQ(gotMac, dstMac2);
 }
+
+TEST_F(NeighborApiTest, bulkCreateRemove) {
+  std::vector<NeighborTypes::NeighborEntry> entries = {
+      NeighborTypes::NeighborEntry(0, 0, ip4),
+      NeighborTypes::NeighborEntry(0, 0, ip6)};
+  folly::MacAddress dstMac2("22:22:22:22:22:22");
+  std::vector<std::vector<NeighborTypes::AttributeType>> attributeSets = {
+      {NeighborTypes::Attributes::DstMac(dstMac)},
+      {NeighborTypes::Attributes::DstMac(dstMac2)}};
+  auto statuses = neighborApi->bulkCreate(
+      entries, attributeSets, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(2, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(fs->nm.get(entries[0]).dstMac, dstMac);
+  EXPECT_EQ(fs->nm.get(entries[1]).dstMac, dstMac2);
+
+  // Entries and attributes must pair up
+  attributeSets.pop_back();
+  EXPECT_THROW(
+      neighborApi->bulkCreate(
+          entries, attributeSets, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR),
+      SaiApiError);
+
+  statuses =
+      neighborApi->bulkRemove(entries, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(2, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(fs->nm.map().size(), 0);
+}
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <vector>
 
 using namespace facebook::fboss;
 
@@ -54,6 +55,22 @@ TEST_F(NextHopApiTest, badCreate) {
   EXPECT_THROW(nextHopApi->create({}, 0), SaiApiError);
 }
 
+TEST_F(NextHopApiTest, createNextHopFromAttributeList) {
+  auto attributes = makeSaiAttributeList(
+      NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+      NextHopTypes::Attributes::Ip(ip4),
+      NextHopTypes::Attributes::RouterInterfaceId(0));
+  auto nextHopId = nextHopApi->create(attributes, 0);
+  auto fnh = fs->nhm.get(nextHopId);
+  EXPECT_EQ(SAI_NEXT_HOP_TYPE_IP, fnh.type);
+  EXPECT_EQ(ip4, fnh.ip);
+  EXPECT_EQ(0, fnh.routerInterfaceId);
+}
+
+TEST_F(NextHopApiTest, badCreateFromAttributeList) {
+  EXPECT_THROW(nextHopApi->create(makeSaiAttributeList(), 0), SaiApiError);
+}
+
 TEST_F(NextHopApiTest, removeNextHop) {
   auto nextHopId = createNextHop(ip4);
   EXPECT_EQ(fs->nhm.map().size(), 1);
@@ -75,3 +92,68 @@ TEST_F(NextHopApiTest, setIp) {
       nextHopApi->setAttribute(ipAttribute, nextHopId),
       SAI_STATUS_INVALID_PARAMETER);
 }
+
+TEST_F(NextHopApiTest, bulkCreateRemove) {
+  std::vector<std::vector<NextHopTypes::AttributeType>> attributeSets;
+  for (const auto& ip : {"42.42.12.34", "42.42.12.35", "42.42.12.36"}) {
+    attributeSets.push_back(
+        {NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+         NextHopTypes::Attributes::Ip(folly::IPAddress(ip)),
+         NextHopTypes::Attributes::RouterInterfaceId(0)});
+  }
+  std::vector<sai_object_id_t> ids;
+  auto statuses = nextHopApi->bulkCreate(
+      attributeSets, &ids, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR, 0);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  ASSERT_EQ(3, ids.size());
+  EXPECT_EQ(3, fs->nhm.map().size());
+  EXPECT_EQ(folly::IPAddress("42.42.12.35"), fs->nhm.get(ids[1]).ip);
+
+  statuses = nextHopApi->bulkRemove(ids, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(0, fs->nhm.map().size());
+}
+
+TEST_F(NextHopApiTest, bulkCreateErrorModes) {
+  std::vector<std::vector<NextHopTypes::AttributeType>> attributeSets = {
+      {NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+       NextHopTypes::Attributes::Ip(ip4),
+       NextHopTypes::Attributes::RouterInterfaceId(0)},
+      // Missing the mandatory attributes
+      {},
+      {NextHopTypes::Attributes::Type(SAI_NEXT_HOP_TYPE_IP),
+       NextHopTypes::Attributes::Ip(ip4),
+       NextHopTypes::Attributes::RouterInterfaceId(0)}};
+
+  std::vector<sai_object_id_t> ids;
+  auto statuses = nextHopApi->bulkCreate(
+      attributeSets, &ids, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR, 0);
+  EXPECT_EQ(
+      std::vector<sai_status_t>(
+          {SAI_STATUS_SUCCESS,
+           SAI_STATUS_INVALID_PARAMETER,
+           SAI_STATUS_NOT_EXECUTED}),
+      statuses);
+  EXPECT_EQ(1, fs->nhm.map().size());
+  EXPECT_EQ(SAI_NULL_OBJECT_ID, ids[2]);
+
+  statuses = nextHopApi->bulkCreate(
+      attributeSets, &ids, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR, 0);
+  EXPECT_EQ(
+      std::vector<sai_status_t>(
+          {SAI_STATUS_SUCCESS,
+           SAI_STATUS_INVALID_PARAMETER,
+           SAI_STATUS_SUCCESS}),
+      statuses);
+  EXPECT_EQ(3, fs->nhm.map().size());
+
+  // Removing what is already gone fails for that object only
+  nextHopApi->remove(ids[0]);
+  statuses = nextHopApi->bulkRemove(
+      std::vector<sai_object_id_t>{ids[0], ids[2]},
+      SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(
+      std::vector<sai_status_t>(
+          {SAI_STATUS_ITEM_NOT_FOUND, SAI_STATUS_SUCCESS}),
+      statuses);
+}
@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sai/api/NextHopGroupApi.h"
+#include "fboss/agent/hw/sai/fake/FakeSai.h"
+
+#include <folly/logging/xlog.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace facebook::fboss;
+
+class NextHopGroupApiTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    fs = FakeSai::getInstance();
+    sai_api_initialize(0, nullptr);
+    nextHopGroupApi = std::make_unique<NextHopGroupApi>();
+  }
+  sai_object_id_t createNextHopGroup() {
+    NextHopGroupTypes::AttributeType typeAttribute =
+        NextHopGroupTypes::Attributes::Type(SAI_NEXT_HOP_GROUP_TYPE_ECMP);
+    auto nextHopGroupId = nextHopGroupApi->create({typeAttribute}, 0);
+    EXPECT_EQ(nextHopGroupId, fs->nhgm.get(nextHopGroupId).id);
+    EXPECT_EQ(
+        SAI_NEXT_HOP_GROUP_TYPE_ECMP, fs->nhgm.get(nextHopGroupId).type);
+    return nextHopGroupId;
+  }
+  std::vector<NextHopGroupTypes::MemberAttributeType> memberAttributes(
+      sai_object_id_t nextHopGroupId,
+      sai_object_id_t nextHopId) const {
+    return {NextHopGroupTypes::MemberAttributes::NextHopGroupId(nextHopGroupId),
+            NextHopGroupTypes::MemberAttributes::NextHopId(nextHopId)};
+  }
+  sai_object_id_t createMember(
+      sai_object_id_t nextHopGroupId,
+      sai_object_id_t nextHopId) {
+    auto memberId = nextHopGroupApi->createMember(
+        memberAttributes(nextHopGroupId, nextHopId), 0);
+    const auto& member = fs->nhgm.getMember(memberId);
+    EXPECT_EQ(memberId, member.id);
+    EXPECT_EQ(nextHopGroupId, member.nextHopGroupId);
+    EXPECT_EQ(nextHopId, member.nextHopId);
+    return memberId;
+  }
+  std::shared_ptr<FakeSai> fs;
+  std::unique_ptr<NextHopGroupApi> nextHopGroupApi;
+};
+
+TEST_F(NextHopGroupApiTest, createNextHopGroup) {
+  createNextHopGroup();
+}
+
+TEST_F(NextHopGroupApiTest, badCreate) {
+  EXPECT_THROW(nextHopGroupApi->create({}, 0), SaiApiError);
+}
+
+TEST_F(NextHopGroupApiTest, removeNextHopGroup) {
+  auto nextHopGroupId = createNextHopGroup();
+  auto memberId = createMember(nextHopGroupId, 5);
+  // Can't remove a group that still has members
+  EXPECT_EQ(
+      SAI_STATUS_OBJECT_IN_USE, nextHopGroupApi->remove(nextHopGroupId));
+  nextHopGroupApi->removeMember(memberId);
+  EXPECT_EQ(SAI_STATUS_SUCCESS, nextHopGroupApi->remove(nextHopGroupId));
+  EXPECT_EQ(0, fs->nhgm.map().count(nextHopGroupId));
+}
+
+TEST_F(NextHopGroupApiTest, members) {
+  auto nextHopGroupId1 = createNextHopGroup();
+  auto nextHopGroupId2 = createNextHopGroup();
+  auto memberId1 = createMember(nextHopGroupId1, 5);
+  auto memberId2 = createMember(nextHopGroupId2, 6);
+  // Member ids are unique across the groups
+  EXPECT_NE(memberId1, memberId2);
+  NextHopGroupTypes::Attributes::NextHopMemberList memberList(
+      std::vector<sai_object_id_t>(4));
+  EXPECT_EQ(
+      std::vector<sai_object_id_t>{memberId1},
+      nextHopGroupApi->getAttribute(memberList, nextHopGroupId1));
+
+  NextHopGroupTypes::MemberAttributes::Weight weight(3);
+  nextHopGroupApi->setMemberAttribute(weight, memberId2);
+  EXPECT_EQ(3, fs->nhgm.getMember(memberId2).weight);
+  EXPECT_EQ(
+      SAI_STATUS_SUCCESS, nextHopGroupApi->removeMember(memberId1));
+  EXPECT_EQ(
+      SAI_STATUS_ITEM_NOT_FOUND, nextHopGroupApi->removeMember(memberId1));
+}
+
+TEST_F(NextHopGroupApiTest, bulkCreateRemoveMembers) {
+  auto nextHopGroupId = createNextHopGroup();
+  std::vector<sai_object_id_t> memberIds;
+  auto statuses = nextHopGroupApi->bulkCreateMembers(
+      {memberAttributes(nextHopGroupId, 1),
+       memberAttributes(nextHopGroupId, 2),
+       memberAttributes(nextHopGroupId, 3)},
+      &memberIds,
+      SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+      0);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(3, fs->nhgm.get(nextHopGroupId).fm().map().size());
+  EXPECT_EQ(2, fs->nhgm.getMember(memberIds[1]).nextHopId);
+
+  // A member of a group that doesn't exist fails on its own
+  statuses = nextHopGroupApi->bulkCreateMembers(
+      {memberAttributes(nextHopGroupId + 100, 4),
+       memberAttributes(nextHopGroupId, 5)},
+      &memberIds,
+      SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR,
+      0);
+  EXPECT_EQ(SAI_STATUS_INVALID_PARAMETER, statuses[0]);
+  EXPECT_EQ(SAI_STATUS_NOT_EXECUTED, statuses[1]);
+  EXPECT_EQ(3, fs->nhgm.get(nextHopGroupId).fm().map().size());
+
+  memberIds.clear();
+  for (const auto& member : fs->nhgm.get(nextHopGroupId).fm().map()) {
+    memberIds.push_back(member.first);
+  }
+  statuses = nextHopGroupApi->bulkRemoveMembers(
+      memberIds, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_TRUE(fs->nhgm.get(nextHopGroupId).fm().map().empty());
+}
@@ -0,0 +1,163 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sai/api/RouteApi.h"
+#include "fboss/agent/hw/sai/fake/FakeSai.h"
+
+#include <folly/Benchmark.h>
+#include <folly/IPAddressV6.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+DEFINE_int32(bulk_size, 256, "Number of routes programmed per bulk call");
+DEFINE_bool(ipv6, true, "Program IPv6 /64 routes instead of IPv4 /32 ones");
+
+using namespace facebook::fboss;
+
+/*
+ * Measures the cost of programming routes through RouteApi against FakeSai,
+ * one route per iteration, so the results read as time per route and can be
+ * put next to those of the BCM route programming path on the same host.
+ *
+ * FakeSai does little more than a hash map insert per route, so this is
+ * mostly the cost of the SaiApi layer: marshalling the attributes and the
+ * route entries, and for bulk calls, laying them out for SAI.
+ */
+namespace {
+
+std::unique_ptr<RouteApi> routeApi;
+
+std::vector<RouteTypes::RouteEntry> makeRoutes(size_t count) {
+  std::vector<RouteTypes::RouteEntry> routes;
+  routes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (FLAGS_ipv6) {
+      std::array<uint8_t, 16> bytes{{0x24, 0x01, 0xdb, 0x00}};
+      for (int b = 0; b < 4; ++b) {
+        bytes[7 - b] = (i >> (8 * b)) & 0xff;
+      }
+      routes.emplace_back(
+          0, 0, folly::CIDRNetwork(folly::IPAddressV6(bytes), 64));
+    } else {
+      routes.emplace_back(
+          0,
+          0,
+          folly::CIDRNetwork(
+              folly::IPAddressV4::fromLongHBO((10 << 24) + i), 32));
+    }
+  }
+  return routes;
+}
+
+std::vector<RouteTypes::AttributeType> routeAttributes(size_t i) {
+  return {RouteTypes::Attributes::NextHopId(i % 64 + 1)};
+}
+
+void removeAll(const std::vector<RouteTypes::RouteEntry>& routes) {
+  routeApi->bulkRemove(routes, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+}
+
+} // unnamed namespace
+
+BENCHMARK(RouteApiCreate, numIters) {
+  std::vector<RouteTypes::RouteEntry> routes;
+  BENCHMARK_SUSPEND {
+    routes = makeRoutes(numIters);
+  }
+  for (size_t i = 0; i < routes.size(); ++i) {
+    routeApi->create(routes[i], routeAttributes(i));
+  }
+  BENCHMARK_SUSPEND {
+    removeAll(routes);
+  }
+}
+
+BENCHMARK_RELATIVE(RouteApiCreateAttributeList, numIters) {
+  std::vector<RouteTypes::RouteEntry> routes;
+  BENCHMARK_SUSPEND {
+    routes = makeRoutes(numIters);
+  }
+  for (size_t i = 0; i < routes.size(); ++i) {
+    routeApi->create(
+        routes[i],
+        makeSaiAttributeList(RouteTypes::Attributes::NextHopId(i % 64 + 1)));
+  }
+  BENCHMARK_SUSPEND {
+    removeAll(routes);
+  }
+}
+
+BENCHMARK_RELATIVE(RouteApiBulkCreate, numIters) {
+  std::vector<RouteTypes::RouteEntry> routes;
+  std::vector<std::vector<RouteTypes::RouteEntry>> batches;
+  std::vector<std::vector<std::vector<RouteTypes::AttributeType>>>
+      attributeSets;
+  BENCHMARK_SUSPEND {
+    routes = makeRoutes(numIters);
+    for (size_t i = 0; i < routes.size(); i += FLAGS_bulk_size) {
+      auto end = std::min(routes.size(), i + FLAGS_bulk_size);
+      batches.emplace_back(routes.begin() + i, routes.begin() + end);
+      attributeSets.emplace_back();
+      for (size_t j = i; j < end; ++j) {
+        attributeSets.back().push_back(routeAttributes(j));
+      }
+    }
+  }
+  for (size_t i = 0; i < batches.size(); ++i) {
+    routeApi->bulkCreate(
+        batches[i], attributeSets[i], SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  }
+  BENCHMARK_SUSPEND {
+    removeAll(routes);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(RouteApiRemove, numIters) {
+  std::vector<RouteTypes::RouteEntry> routes;
+  BENCHMARK_SUSPEND {
+    routes = makeRoutes(numIters);
+    for (size_t i = 0; i < routes.size(); ++i) {
+      routeApi->create(routes[i], routeAttributes(i));
+    }
+  }
+  for (const auto& route : routes) {
+    routeApi->remove(route);
+  }
+}
+
+BENCHMARK_RELATIVE(RouteApiBulkRemove, numIters) {
+  std::vector<std::vector<RouteTypes::RouteEntry>> batches;
+  BENCHMARK_SUSPEND {
+    auto routes = makeRoutes(numIters);
+    for (size_t i = 0; i < routes.size(); ++i) {
+      routeApi->create(routes[i], routeAttributes(i));
+    }
+    for (size_t i = 0; i < routes.size(); i += FLAGS_bulk_size) {
+      auto end = std::min(routes.size(), i + FLAGS_bulk_size);
+      batches.emplace_back(routes.begin() + i, routes.begin() + end);
+    }
+  }
+  for (const auto& batch : batches) {
+    routeApi->bulkRemove(batch, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  sai_api_initialize(0, nullptr);
+  routeApi = std::make_unique<RouteApi>();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sai/api/RouteApi.h"
+#include "fboss/agent/hw/sai/fake/FakeSai.h"
+
+#include <folly/IPAddress.h>
+#include <folly/logging/xlog.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace facebook::fboss;
+
+class RouteApiTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    fs = FakeSai::getInstance();
+    sai_api_initialize(0, nullptr);
+    routeApi = std::make_unique<RouteApi>();
+  }
+  RouteTypes::RouteEntry makeRoute(folly::StringPiece prefix) const {
+    return RouteTypes::RouteEntry(
+        0, 0, folly::IPAddress::createNetwork(prefix));
+  }
+  std::vector<RouteTypes::AttributeType> forwardTo(
+      sai_object_id_t nextHopId) const {
+    return {RouteTypes::Attributes::NextHopId(nextHopId)};
+  }
+  std::shared_ptr<FakeSai> fs;
+  std::unique_ptr<RouteApi> routeApi;
+};
+
+TEST_F(RouteApiTest, createV4Route) {
+  auto r = makeRoute("42.42.0.0/16");
+  routeApi->create(r, forwardTo(5));
+  EXPECT_EQ(5, fs->rm.get(r).nextHopId);
+  EXPECT_EQ(SAI_PACKET_ACTION_FORWARD, fs->rm.get(r).packetAction);
+}
+
+TEST_F(RouteApiTest, createV6Route) {
+  auto r = makeRoute("4242:4242::/32");
+  routeApi->create(r, forwardTo(5));
+  EXPECT_EQ(5, fs->rm.get(r).nextHopId);
+  EXPECT_EQ(folly::IPAddress::createNetwork("4242:4242::/32"), r.prefix());
+}
+
+TEST_F(RouteApiTest, createDuplicateRoute) {
+  auto r = makeRoute("42.42.0.0/16");
+  routeApi->create(r, forwardTo(5));
+  EXPECT_THROW(routeApi->create(r, forwardTo(6)), SaiApiError);
+  EXPECT_EQ(5, fs->rm.get(r).nextHopId);
+}
+
+TEST_F(RouteApiTest, removeRoute) {
+  auto r = makeRoute("42.42.0.0/16");
+  routeApi->create(r, forwardTo(5));
+  EXPECT_EQ(1, fs->rm.map().size());
+  EXPECT_EQ(SAI_STATUS_SUCCESS, routeApi->remove(r));
+  EXPECT_EQ(0, fs->rm.map().size());
+  EXPECT_EQ(SAI_STATUS_ITEM_NOT_FOUND, routeApi->remove(r));
+}
+
+TEST_F(RouteApiTest, setNextHop) {
+  auto r = makeRoute("42.42.0.0/16");
+  routeApi->create(r, forwardTo(5));
+  RouteTypes::Attributes::NextHopId nextHopId(6);
+  routeApi->setAttribute(nextHopId, r);
+  EXPECT_EQ(6, fs->rm.get(r).nextHopId);
+  RouteTypes::Attributes::NextHopId blank;
+  EXPECT_EQ(6, routeApi->getAttribute(blank, r));
+}
+
+TEST_F(RouteApiTest, dropRoute) {
+  auto r = makeRoute("42.42.0.0/16");
+  routeApi->create(
+      r, {RouteTypes::Attributes::PacketAction(SAI_PACKET_ACTION_DROP)});
+  EXPECT_EQ(SAI_PACKET_ACTION_DROP, fs->rm.get(r).packetAction);
+  EXPECT_EQ(SAI_NULL_OBJECT_ID, fs->rm.get(r).nextHopId);
+}
+
+TEST_F(RouteApiTest, bulkCreateRemove) {
+  std::vector<RouteTypes::RouteEntry> routes{makeRoute("42.42.0.0/16"),
+                                             makeRoute("42.43.0.0/16"),
+                                             makeRoute("4242:4242::/32")};
+  auto statuses = routeApi->bulkCreate(
+      routes,
+      {forwardTo(1), forwardTo(2), forwardTo(3)},
+      SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(3, fs->rm.map().size());
+  EXPECT_EQ(2, fs->rm.get(routes[1]).nextHopId);
+
+  statuses = routeApi->bulkRemove(routes, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(std::vector<sai_status_t>(3, SAI_STATUS_SUCCESS), statuses);
+  EXPECT_EQ(0, fs->rm.map().size());
+}
+
+TEST_F(RouteApiTest, bulkCreateErrorModes) {
+  auto existing = makeRoute("42.43.0.0/16");
+  routeApi->create(existing, forwardTo(1));
+  std::vector<RouteTypes::RouteEntry> routes{
+      makeRoute("42.42.0.0/16"), existing, makeRoute("42.44.0.0/16")};
+  std::vector<std::vector<RouteTypes::AttributeType>> attributeSets{
+      forwardTo(2), forwardTo(2), forwardTo(2)};
+
+  auto statuses = routeApi->bulkCreate(
+      routes, attributeSets, SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+  EXPECT_EQ(SAI_STATUS_SUCCESS, statuses[0]);
+  EXPECT_EQ(SAI_STATUS_ITEM_ALREADY_EXISTS, statuses[1]);
+  EXPECT_EQ(SAI_STATUS_NOT_EXECUTED, statuses[2]);
+  EXPECT_EQ(2, fs->rm.map().size());
+  // The existing route is left alone
+  EXPECT_EQ(1, fs->rm.get(existing).nextHopId);
+
+  routeApi->remove(routes[0]);
+  statuses = routeApi->bulkCreate(
+      routes, attributeSets, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR);
+  EXPECT_EQ(SAI_STATUS_SUCCESS, statuses[0]);
+  EXPECT_EQ(SAI_STATUS_ITEM_ALREADY_EXISTS, statuses[1]);
+  EXPECT_EQ(SAI_STATUS_SUCCESS, statuses[2]);
+  EXPECT_EQ(3, fs->rm.map().size());
+
+  EXPECT_THROW(
+      routeApi->bulkCreate(
+          routes, {forwardTo(1)}, SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR),
+      SaiApiError);
+}
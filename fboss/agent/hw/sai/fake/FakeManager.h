@@ -9,7 +9,16 @@
  */
 #pragma once
 
+#include <folly/Optional.h>
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 extern "C" {
   #include <sai.h>
@@ -18,6 +27,217 @@ extern "C" {
 namespace facebook {
 namespace fboss {
 
+/*
+ * Hands out dense object ids, reusing the ids of removed objects before
+ * growing, like hardware tables do.
+ */
+class FakeIdAllocator {
+ public:
+  sai_object_id_t allocate() {
+    if (free_.empty()) {
+      return static_cast<sai_object_id_t>(next_++);
+    }
+    auto id = free_.back();
+    free_.pop_back();
+    return id;
+  }
+  void release(sai_object_id_t id) {
+    free_.push_back(id);
+  }
+
+ private:
+  size_t next_ = 0;
+  std::vector<sai_object_id_t> free_;
+};
+
+/*
+ * Map like store for the fake objects, sized for scale tests with hundreds
+ * of thousands of objects.
+ *
+ * Objects live in slots of a std::deque, so references to them stay valid
+ * as others are added, and the slots of removed objects are reused. Objects
+ * with ids handed out by the store itself are found by using the id as the
+ * slot index, without hashing. Objects with other keys, e.g. the entries of
+ * neighbors and routes or ids handed out by someone else, are found through
+ * a hash index from the key to the slot.
+ *
+ * Iteration is in slot order and yields std::pair<const K, T>, so this can
+ * be used in place of the std::unordered_map it replaces.
+ *
+ * A store holding objects by id either picks all the ids itself, through
+ * emplaceWithNewId(), or none of them, through emplace(); mixing the two
+ * could hand out an id that is already taken.
+ */
+template <typename K, typename T>
+class FakeObjectStore {
+ public:
+  using value_type = std::pair<const K, T>;
+
+ private:
+  using Slot = folly::Optional<value_type>;
+  using Slots = std::deque<Slot>;
+
+  template <typename SlotsT, typename ValueT>
+  class IteratorImpl
+      : public std::iterator<std::forward_iterator_tag, ValueT> {
+   public:
+    IteratorImpl(SlotsT* slots, size_t pos) : slots_(slots), pos_(pos) {
+      skipEmpty();
+    }
+    ValueT& operator*() const {
+      return *(*slots_)[pos_];
+    }
+    ValueT* operator->() const {
+      return &**this;
+    }
+    IteratorImpl& operator++() {
+      ++pos_;
+      skipEmpty();
+      return *this;
+    }
+    bool operator==(const IteratorImpl& other) const {
+      return pos_ == other.pos_;
+    }
+    bool operator!=(const IteratorImpl& other) const {
+      return pos_ != other.pos_;
+    }
+
+   private:
+    void skipEmpty() {
+      while (pos_ < slots_->size() && !(*slots_)[pos_]) {
+        ++pos_;
+      }
+    }
+    SlotsT* slots_;
+    size_t pos_;
+  };
+
+ public:
+  using iterator = IteratorImpl<Slots, value_type>;
+  using const_iterator = IteratorImpl<const Slots, const value_type>;
+
+  // Add an object with an id picked by the store
+  template <typename E = K, typename... Args>
+  typename std::enable_if<std::is_same<E, sai_object_id_t>::value, T&>::type
+  emplaceWithNewId(sai_object_id_t* id, Args&&... args) {
+    *id = slotIds_.allocate();
+    if (*id >= slots_.size()) {
+      slots_.resize(*id + 1);
+    }
+    slots_[*id].emplace(*id, T{std::forward<Args>(args)...});
+    ++size_;
+    return slots_[*id]->second;
+  }
+
+  // Add an object under the given key, unless there already is one
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(const K& k, Args&&... args) {
+    auto itr = find(k);
+    if (itr != end()) {
+      return std::make_pair(itr, false);
+    }
+    auto slot = slotIds_.allocate();
+    if (slot >= slots_.size()) {
+      slots_.resize(slot + 1);
+    }
+    slots_[slot].emplace(k, T{std::forward<Args>(args)...});
+    index_.emplace(k, slot);
+    ++size_;
+    return std::make_pair(iterator(&slots_, slot), true);
+  }
+
+  size_t erase(const K& k) {
+    auto slot = slotOf(k);
+    if (slot == kNoSlot) {
+      return 0;
+    }
+    index_.erase(k);
+    slots_[slot] = folly::none;
+    slotIds_.release(slot);
+    --size_;
+    return 1;
+  }
+
+  iterator find(const K& k) {
+    auto slot = slotOf(k);
+    return slot == kNoSlot ? end() : iterator(&slots_, slot);
+  }
+  const_iterator find(const K& k) const {
+    auto slot = slotOf(k);
+    return slot == kNoSlot ? end() : const_iterator(&slots_, slot);
+  }
+  size_t count(const K& k) const {
+    return slotOf(k) == kNoSlot ? 0 : 1;
+  }
+  T& at(const K& k) {
+    auto slot = slotOf(k);
+    if (slot == kNoSlot) {
+      throw std::out_of_range("no fake object with this key");
+    }
+    return slots_[slot]->second;
+  }
+  const T& at(const K& k) const {
+    return const_cast<FakeObjectStore*>(this)->at(k);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  iterator begin() {
+    return iterator(&slots_, 0);
+  }
+  iterator end() {
+    return iterator(&slots_, slots_.size());
+  }
+  const_iterator begin() const {
+    return const_iterator(&slots_, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(&slots_, slots_.size());
+  }
+
+ private:
+  static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+  bool slotKeyEquals(size_t slot, const K& k) const {
+    return slot < slots_.size() && slots_[slot] && slots_[slot]->first == k;
+  }
+
+  template <typename E = K>
+  typename std::enable_if<std::is_same<E, sai_object_id_t>::value, size_t>::
+      type
+      denseSlot(const K& k) const {
+    return static_cast<size_t>(k);
+  }
+  template <typename E = K>
+  typename std::enable_if<!std::is_same<E, sai_object_id_t>::value, size_t>::
+      type
+      denseSlot(const K& /* k */) const {
+    return kNoSlot;
+  }
+
+  size_t slotOf(const K& k) const {
+    auto slot = denseSlot(k);
+    if (slotKeyEquals(slot, k)) {
+      return slot;
+    }
+    auto itr = index_.find(k);
+    return itr == index_.end() ? kNoSlot : itr->second;
+  }
+
+  Slots slots_;
+  FakeIdAllocator slotIds_;
+  std::unordered_map<K, size_t> index_;
+  size_t size_ = 0;
+};
+
+template <typename K, typename T>
+constexpr size_t FakeObjectStore<K, T>::kNoSlot;
+
 template <typename K, typename T>
 class FakeManager {
  public:
@@ -25,17 +245,24 @@ class FakeManager {
   typename std::
       enable_if<std::is_same<E, sai_object_id_t>::value, sai_object_id_t>::type
       create(Args&&... args) {
-    sai_object_id_t id = static_cast<sai_object_id_t>(count_++);
-    auto ins = map_.emplace(id, T{std::forward<Args>(args)...});
-    ins.first->second.id = id;
+    sai_object_id_t id;
+    auto& t = map_.emplaceWithNewId(&id, std::forward<Args>(args)...);
+    t.id = id;
     return id;
   }
 
+  // For ids handed out by someone else, e.g. members shared by all groups
+  template <typename E = K, typename... Args>
+  typename std::enable_if<std::is_same<E, sai_object_id_t>::value, void>::type
+  createWithId(sai_object_id_t id, Args&&... args) {
+    auto ins = map_.emplace(id, std::forward<Args>(args)...);
+    ins.first->second.id = id;
+  }
+
   template <typename E = K, typename... Args>
   typename std::enable_if<!std::is_same<E, sai_object_id_t>::value, void>::type
   create(const K& k, Args&&... args) {
-    auto ins = map_.emplace(k, T{std::forward<Args>(args)...});
-    count_++;
+    map_.emplace(k, std::forward<Args>(args)...);
   }
 
   size_t remove(const K& k) {
@@ -49,17 +276,42 @@ class FakeManager {
     return map_.at(k);
   }
 
-  std::unordered_map<K, T>& map() {
+  FakeObjectStore<K, T>& map() {
     return map_;
   }
-  const std::unordered_map<K, T>& map() const {
+  const FakeObjectStore<K, T>& map() const {
     return map_;
   }
  private:
-  size_t count_ = 0;
-  std::unordered_map<K, T> map_;
+  FakeObjectStore<K, T> map_;
 };
 
+/*
+ * Implements a fake SAI bulk call on top of the call for a single object,
+ * fn(i) doing the i-th one. Like the real bulk calls, returns
+ * SAI_STATUS_FAILURE if any object failed.
+ */
+template <typename Fn>
+sai_status_t fakeBulk(
+    uint32_t object_count,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses,
+    Fn fn) {
+  sai_status_t res = SAI_STATUS_SUCCESS;
+  std::fill(
+      object_statuses, object_statuses + object_count, SAI_STATUS_NOT_EXECUTED);
+  for (uint32_t i = 0; i < object_count; ++i) {
+    object_statuses[i] = fn(i);
+    if (object_statuses[i] != SAI_STATUS_SUCCESS) {
+      res = SAI_STATUS_FAILURE;
+      if (mode == SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR) {
+        break;
+      }
+    }
+  }
+  return res;
+}
+
 /*
  * For managing fakes of sai apis that have a membership concept, we will
  * nest fake managers. In this class template, GroupT denotes an owning "group"
@@ -75,12 +327,21 @@ class FakeManagerWithMembers : public FakeManager<sai_object_id_t, GroupT> {
   template <typename... Args>
   sai_object_id_t createMember(sai_object_id_t groupId, Args&&... args) {
     GroupT& group = this->get(groupId);
-    sai_object_id_t memberId = group.fm().create(std::forward<Args>(args)...);
+    // Member ids are unique across the groups, so they can be looked up
+    // without knowing the group
+    auto memberId = memberIds_.allocate();
+    group.fm().createWithId(memberId, std::forward<Args>(args)...);
     memberToGroupMap_[memberId] = groupId;
     return memberId;
   }
   size_t removeMember(sai_object_id_t memberId) {
-    GroupT& group = this->get(memberToGroupMap_.at(memberId));
+    auto itr = memberToGroupMap_.find(memberId);
+    if (itr == memberToGroupMap_.end()) {
+      return 0;
+    }
+    GroupT& group = this->get(itr->second);
+    memberToGroupMap_.erase(itr);
+    memberIds_.release(memberId);
     return group.fm().remove(memberId);
   }
   MemberT& getMember(sai_object_id_t memberId) {
@@ -93,6 +354,7 @@ class FakeManagerWithMembers : public FakeManager<sai_object_id_t, GroupT> {
   }
 
  private:
+  FakeIdAllocator memberIds_;
   std::unordered_map<sai_object_id_t, sai_object_id_t> memberToGroupMap_;
 };
 
@@ -56,10 +56,19 @@ sai_status_t sai_api_query(sai_api_t sai_api_id, void** api_method_table) {
           (sai_next_hop_api_t**)api_method_table);
       res = SAI_STATUS_SUCCESS;
       break;
+    case SAI_API_NEXT_HOP_GROUP:
+      facebook::fboss::populate_next_hop_group_api(
+          (sai_next_hop_group_api_t**)api_method_table);
+      res = SAI_STATUS_SUCCESS;
+      break;
     case SAI_API_PORT:
       facebook::fboss::populate_port_api((sai_port_api_t**)api_method_table);
       res = SAI_STATUS_SUCCESS;
       break;
+    case SAI_API_ROUTE:
+      facebook::fboss::populate_route_api((sai_route_api_t**)api_method_table);
+      res = SAI_STATUS_SUCCESS;
+      break;
   case SAI_API_ROUTER_INTERFACE:
     facebook::fboss::populate_router_interface_api(
         (sai_router_interface_api_t**)api_method_table);
@@ -11,8 +11,10 @@
 
 #include "FakeSaiBridge.h"
 #include "FakeSaiNextHop.h"
+#include "FakeSaiNextHopGroup.h"
 #include "FakeSaiNeighbor.h"
 #include "FakeSaiPort.h"
+#include "FakeSaiRoute.h"
 #include "FakeSaiRouterInterface.h"
 #include "FakeSaiSwitch.h"
 #include "FakeSaiVirtualRouter.h"
@@ -32,7 +34,9 @@ struct FakeSai {
   FakeBridgeManager brm;
   FakeNeighborManager nm;
   FakeNextHopManager nhm;
+  FakeNextHopGroupManager nhgm;
   FakePortManager pm;
+  FakeRouteManager rm;
   FakeRouterInterfaceManager rim;
   FakeSwitchManager swm;
   FakeVirtualRouterManager vrm;
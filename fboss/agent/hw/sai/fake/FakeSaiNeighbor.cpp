@@ -50,7 +50,9 @@ sai_status_t remove_neighbor_entry_fn(
   auto ip = facebook::fboss::fromSaiIpAddress(neighbor_entry->ip_address);
   facebook::fboss::NeighborTypes::NeighborEntry n(
       neighbor_entry->switch_id, neighbor_entry->rif_id, ip);
-  fs->nm.remove(n);
+  if (!fs->nm.remove(n)) {
+    return SAI_STATUS_ITEM_NOT_FOUND;
+  }
   return SAI_STATUS_SUCCESS;
 }
 
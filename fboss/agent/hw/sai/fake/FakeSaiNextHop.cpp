@@ -50,7 +50,9 @@ sai_status_t create_next_hop_fn(
 
 sai_status_t remove_next_hop_fn(sai_object_id_t next_hop_id) {
   auto fs = FakeSai::getInstance();
-  fs->nhm.remove(next_hop_id);
+  if (!fs->nhm.remove(next_hop_id)) {
+    return SAI_STATUS_ITEM_NOT_FOUND;
+  }
   return SAI_STATUS_SUCCESS;
 }
 
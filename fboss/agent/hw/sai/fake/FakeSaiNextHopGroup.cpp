@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "FakeSaiNextHopGroup.h"
+#include "FakeSai.h"
+
+#include <folly/logging/xlog.h>
+#include <folly/Optional.h>
+
+using facebook::fboss::FakeSai;
+
+sai_status_t create_next_hop_group_fn(
+    sai_object_id_t* next_hop_group_id,
+    sai_object_id_t /* switch_id */,
+    uint32_t attr_count,
+    const sai_attribute_t* attr_list) {
+  auto fs = FakeSai::getInstance();
+  folly::Optional<sai_next_hop_group_type_t> type;
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr_list[i].id) {
+      case SAI_NEXT_HOP_GROUP_ATTR_TYPE:
+        type = static_cast<sai_next_hop_group_type_t>(attr_list[i].value.s32);
+        break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  if (!type) {
+    return SAI_STATUS_INVALID_PARAMETER;
+  }
+  *next_hop_group_id = fs->nhgm.create(type.value());
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t remove_next_hop_group_fn(sai_object_id_t next_hop_group_id) {
+  auto fs = FakeSai::getInstance();
+  auto itr = fs->nhgm.map().find(next_hop_group_id);
+  if (itr == fs->nhgm.map().end()) {
+    return SAI_STATUS_ITEM_NOT_FOUND;
+  }
+  if (!itr->second.fm().map().empty()) {
+    return SAI_STATUS_OBJECT_IN_USE;
+  }
+  fs->nhgm.remove(next_hop_group_id);
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t set_next_hop_group_attribute_fn(
+    sai_object_id_t /* next_hop_group_id */,
+    const sai_attribute_t* attr) {
+  switch (attr->id) {
+    default:
+      return SAI_STATUS_INVALID_PARAMETER;
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t get_next_hop_group_attribute_fn(
+    sai_object_id_t next_hop_group_id,
+    uint32_t attr_count,
+    sai_attribute_t* attr) {
+  auto fs = FakeSai::getInstance();
+  const auto& nextHopGroup = fs->nhgm.get(next_hop_group_id);
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr[i].id) {
+      case SAI_NEXT_HOP_GROUP_ATTR_TYPE:
+        attr[i].value.s32 = static_cast<int32_t>(nextHopGroup.type);
+        break;
+      case SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_MEMBER_LIST: {
+        const auto& memberMap = nextHopGroup.fm().map();
+        if (attr[i].value.objlist.count < memberMap.size()) {
+          attr[i].value.objlist.count = memberMap.size();
+          return SAI_STATUS_BUFFER_OVERFLOW;
+        }
+        attr[i].value.objlist.count = memberMap.size();
+        int j = 0;
+        for (const auto& m : memberMap) {
+          attr[i].value.objlist.list[j++] = m.first;
+        }
+      } break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t create_next_hop_group_member_fn(
+    sai_object_id_t* next_hop_group_member_id,
+    sai_object_id_t /* switch_id */,
+    uint32_t attr_count,
+    const sai_attribute_t* attr_list) {
+  auto fs = FakeSai::getInstance();
+  folly::Optional<sai_object_id_t> nextHopGroupId;
+  folly::Optional<sai_object_id_t> nextHopId;
+  uint32_t weight = 1;
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr_list[i].id) {
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_GROUP_ID:
+        nextHopGroupId = attr_list[i].value.oid;
+        break;
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_ID:
+        nextHopId = attr_list[i].value.oid;
+        break;
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_WEIGHT:
+        weight = attr_list[i].value.u32;
+        break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  if (!nextHopGroupId || !nextHopId ||
+      !fs->nhgm.map().count(nextHopGroupId.value())) {
+    return SAI_STATUS_INVALID_PARAMETER;
+  }
+  *next_hop_group_member_id = fs->nhgm.createMember(
+      nextHopGroupId.value(),
+      nextHopGroupId.value(),
+      nextHopId.value(),
+      weight);
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t remove_next_hop_group_member_fn(
+    sai_object_id_t next_hop_group_member_id) {
+  auto fs = FakeSai::getInstance();
+  if (!fs->nhgm.removeMember(next_hop_group_member_id)) {
+    return SAI_STATUS_ITEM_NOT_FOUND;
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t set_next_hop_group_member_attribute_fn(
+    sai_object_id_t next_hop_group_member_id,
+    const sai_attribute_t* attr) {
+  auto fs = FakeSai::getInstance();
+  auto& member = fs->nhgm.getMember(next_hop_group_member_id);
+  switch (attr->id) {
+    case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_WEIGHT:
+      member.weight = attr->value.u32;
+      break;
+    default:
+      return SAI_STATUS_INVALID_PARAMETER;
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t get_next_hop_group_member_attribute_fn(
+    sai_object_id_t next_hop_group_member_id,
+    uint32_t attr_count,
+    sai_attribute_t* attr) {
+  auto fs = FakeSai::getInstance();
+  const auto& member = fs->nhgm.getMember(next_hop_group_member_id);
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr[i].id) {
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_GROUP_ID:
+        attr[i].value.oid = member.nextHopGroupId;
+        break;
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_NEXT_HOP_ID:
+        attr[i].value.oid = member.nextHopId;
+        break;
+      case SAI_NEXT_HOP_GROUP_MEMBER_ATTR_WEIGHT:
+        attr[i].value.u32 = member.weight;
+        break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t create_next_hop_group_members_fn(
+    sai_object_id_t switch_id,
+    uint32_t object_count,
+    const uint32_t* attr_count,
+    const sai_attribute_t** attr_list,
+    sai_bulk_op_error_mode_t mode,
+    sai_object_id_t* object_id,
+    sai_status_t* object_statuses) {
+  return facebook::fboss::fakeBulk(
+      object_count, mode, object_statuses, [&](uint32_t i) {
+        return create_next_hop_group_member_fn(
+            &object_id[i], switch_id, attr_count[i], attr_list[i]);
+      });
+}
+
+sai_status_t remove_next_hop_group_members_fn(
+    uint32_t object_count,
+    const sai_object_id_t* object_id,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses) {
+  return facebook::fboss::fakeBulk(
+      object_count, mode, object_statuses, [&](uint32_t i) {
+        return remove_next_hop_group_member_fn(object_id[i]);
+      });
+}
+
+namespace facebook {
+namespace fboss {
+
+static sai_next_hop_group_api_t _next_hop_group_api;
+
+void populate_next_hop_group_api(
+    sai_next_hop_group_api_t** next_hop_group_api) {
+  _next_hop_group_api.create_next_hop_group = &create_next_hop_group_fn;
+  _next_hop_group_api.remove_next_hop_group = &remove_next_hop_group_fn;
+  _next_hop_group_api.set_next_hop_group_attribute =
+      &set_next_hop_group_attribute_fn;
+  _next_hop_group_api.get_next_hop_group_attribute =
+      &get_next_hop_group_attribute_fn;
+  _next_hop_group_api.create_next_hop_group_member =
+      &create_next_hop_group_member_fn;
+  _next_hop_group_api.remove_next_hop_group_member =
+      &remove_next_hop_group_member_fn;
+  _next_hop_group_api.set_next_hop_group_member_attribute =
+      &set_next_hop_group_member_attribute_fn;
+  _next_hop_group_api.get_next_hop_group_member_attribute =
+      &get_next_hop_group_member_attribute_fn;
+  _next_hop_group_api.create_next_hop_group_members =
+      &create_next_hop_group_members_fn;
+  _next_hop_group_api.remove_next_hop_group_members =
+      &remove_next_hop_group_members_fn;
+  *next_hop_group_api = &_next_hop_group_api;
+}
+
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "FakeSai.h"
+#include "FakeSaiRoute.h"
+
+#include "fboss/agent/hw/sai/api/AddressUtil.h"
+
+#include <folly/logging/xlog.h>
+
+using facebook::fboss::FakeSai;
+using facebook::fboss::RouteTypes;
+
+namespace {
+
+RouteTypes::RouteEntry makeRouteEntry(const sai_route_entry_t* route_entry) {
+  return RouteTypes::RouteEntry(
+      route_entry->switch_id,
+      route_entry->vr_id,
+      facebook::fboss::fromSaiIpPrefix(route_entry->destination));
+}
+
+} // namespace
+
+sai_status_t create_route_entry_fn(
+    const sai_route_entry_t* route_entry,
+    uint32_t attr_count,
+    const sai_attribute_t* attr_list) {
+  auto fs = FakeSai::getInstance();
+  auto r = makeRouteEntry(route_entry);
+  if (fs->rm.map().count(r)) {
+    return SAI_STATUS_ITEM_ALREADY_EXISTS;
+  }
+  sai_packet_action_t packetAction = SAI_PACKET_ACTION_FORWARD;
+  sai_object_id_t nextHopId = SAI_NULL_OBJECT_ID;
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr_list[i].id) {
+      case SAI_ROUTE_ENTRY_ATTR_PACKET_ACTION:
+        packetAction = static_cast<sai_packet_action_t>(attr_list[i].value.s32);
+        break;
+      case SAI_ROUTE_ENTRY_ATTR_NEXT_HOP_ID:
+        nextHopId = attr_list[i].value.oid;
+        break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  fs->rm.create(r, packetAction, nextHopId);
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t remove_route_entry_fn(const sai_route_entry_t* route_entry) {
+  auto fs = FakeSai::getInstance();
+  if (!fs->rm.remove(makeRouteEntry(route_entry))) {
+    return SAI_STATUS_ITEM_NOT_FOUND;
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t set_route_entry_attribute_fn(
+    const sai_route_entry_t* route_entry,
+    const sai_attribute_t* attr) {
+  auto fs = FakeSai::getInstance();
+  auto& fr = fs->rm.get(makeRouteEntry(route_entry));
+  switch (attr->id) {
+    case SAI_ROUTE_ENTRY_ATTR_PACKET_ACTION:
+      fr.packetAction = static_cast<sai_packet_action_t>(attr->value.s32);
+      break;
+    case SAI_ROUTE_ENTRY_ATTR_NEXT_HOP_ID:
+      fr.nextHopId = attr->value.oid;
+      break;
+    default:
+      return SAI_STATUS_INVALID_PARAMETER;
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t get_route_entry_attribute_fn(
+    const sai_route_entry_t* route_entry,
+    uint32_t attr_count,
+    sai_attribute_t* attr_list) {
+  auto fs = FakeSai::getInstance();
+  const auto& fr = fs->rm.get(makeRouteEntry(route_entry));
+  for (int i = 0; i < attr_count; ++i) {
+    switch (attr_list[i].id) {
+      case SAI_ROUTE_ENTRY_ATTR_PACKET_ACTION:
+        attr_list[i].value.s32 = static_cast<int32_t>(fr.packetAction);
+        break;
+      case SAI_ROUTE_ENTRY_ATTR_NEXT_HOP_ID:
+        attr_list[i].value.oid = fr.nextHopId;
+        break;
+      default:
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+  }
+  return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t create_route_entries_fn(
+    uint32_t object_count,
+    const sai_route_entry_t* route_entry,
+    const uint32_t* attr_count,
+    const sai_attribute_t** attr_list,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses) {
+  return facebook::fboss::fakeBulk(
+      object_count, mode, object_statuses, [&](uint32_t i) {
+        return create_route_entry_fn(
+            &route_entry[i], attr_count[i], attr_list[i]);
+      });
+}
+
+sai_status_t remove_route_entries_fn(
+    uint32_t object_count,
+    const sai_route_entry_t* route_entry,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses) {
+  return facebook::fboss::fakeBulk(
+      object_count, mode, object_statuses, [&](uint32_t i) {
+        return remove_route_entry_fn(&route_entry[i]);
+      });
+}
+
+namespace facebook {
+namespace fboss {
+
+static sai_route_api_t _route_api;
+
+void populate_route_api(sai_route_api_t** route_api) {
+  _route_api.create_route_entry = &create_route_entry_fn;
+  _route_api.remove_route_entry = &remove_route_entry_fn;
+  _route_api.set_route_entry_attribute = &set_route_entry_attribute_fn;
+  _route_api.get_route_entry_attribute = &get_route_entry_attribute_fn;
+  _route_api.create_route_entries = &create_route_entries_fn;
+  _route_api.remove_route_entries = &remove_route_entries_fn;
+  *route_api = &_route_api;
+}
+
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/hw/sai/api/RouteApi.h"
+#include "fboss/agent/hw/sai/fake/FakeManager.h"
+
+extern "C" {
+  #include <sai.h>
+}
+
+sai_status_t create_route_entry_fn(
+    const sai_route_entry_t* route_entry,
+    uint32_t attr_count,
+    const sai_attribute_t* attr_list);
+
+sai_status_t remove_route_entry_fn(const sai_route_entry_t* route_entry);
+
+sai_status_t set_route_entry_attribute_fn(
+    const sai_route_entry_t* route_entry,
+    const sai_attribute_t* attr);
+
+sai_status_t get_route_entry_attribute_fn(
+    const sai_route_entry_t* route_entry,
+    uint32_t attr_count,
+    sai_attribute_t* attr_list);
+
+sai_status_t create_route_entries_fn(
+    uint32_t object_count,
+    const sai_route_entry_t* route_entry,
+    const uint32_t* attr_count,
+    const sai_attribute_t** attr_list,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses);
+
+sai_status_t remove_route_entries_fn(
+    uint32_t object_count,
+    const sai_route_entry_t* route_entry,
+    sai_bulk_op_error_mode_t mode,
+    sai_status_t* object_statuses);
+
+namespace facebook {
+namespace fboss {
+
+struct FakeRoute {
+  FakeRoute(sai_packet_action_t packetAction, sai_object_id_t nextHopId)
+      : packetAction(packetAction), nextHopId(nextHopId) {}
+  sai_packet_action_t packetAction;
+  sai_object_id_t nextHopId;
+};
+
+using FakeRouteManager = FakeManager<RouteTypes::RouteEntry, FakeRoute>;
+
+void populate_route_api(sai_route_api_t** route_api);
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sai/fake/FakeManager.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace facebook::fboss;
+
+namespace {
+
+struct FakeObject {
+  explicit FakeObject(int value) : value(value) {}
+  int value;
+  sai_object_id_t id;
+};
+
+struct FakeEntryObject {
+  explicit FakeEntryObject(int value) : value(value) {}
+  int value;
+};
+
+class FakeGroupMember {
+ public:
+  explicit FakeGroupMember(sai_object_id_t groupId) : groupId(groupId) {}
+  sai_object_id_t groupId;
+  sai_object_id_t id;
+};
+
+class FakeGroup {
+ public:
+  sai_object_id_t id;
+  FakeManager<sai_object_id_t, FakeGroupMember>& fm() {
+    return fm_;
+  }
+  const FakeManager<sai_object_id_t, FakeGroupMember>& fm() const {
+    return fm_;
+  }
+
+ private:
+  FakeManager<sai_object_id_t, FakeGroupMember> fm_;
+};
+
+} // unnamed namespace
+
+TEST(FakeManager, denseIds) {
+  FakeManager<sai_object_id_t, FakeObject> fm;
+  auto id0 = fm.create(10);
+  auto id1 = fm.create(11);
+  auto id2 = fm.create(12);
+  EXPECT_EQ(0, id0);
+  EXPECT_EQ(1, id1);
+  EXPECT_EQ(2, id2);
+  EXPECT_EQ(11, fm.get(id1).value);
+  EXPECT_EQ(id1, fm.get(id1).id);
+
+  // Removed ids are handed out again before new ones
+  EXPECT_EQ(1, fm.remove(id1));
+  EXPECT_EQ(0, fm.remove(id1));
+  EXPECT_EQ(2, fm.map().size());
+  EXPECT_EQ(0, fm.map().count(id1));
+  EXPECT_THROW(fm.get(id1), std::out_of_range);
+  EXPECT_EQ(id1, fm.create(13));
+  EXPECT_EQ(13, fm.get(id1).value);
+  EXPECT_EQ(3, fm.create(14));
+}
+
+TEST(FakeManager, referencesStayValid) {
+  FakeManager<sai_object_id_t, FakeObject> fm;
+  auto id = fm.create(1);
+  auto& object = fm.get(id);
+  for (int i = 0; i < 10000; ++i) {
+    fm.create(i);
+  }
+  EXPECT_EQ(&object, &fm.get(id));
+  EXPECT_EQ(1, object.value);
+}
+
+TEST(FakeManager, iterate) {
+  FakeManager<sai_object_id_t, FakeObject> fm;
+  for (int i = 0; i < 5; ++i) {
+    fm.create(i);
+  }
+  fm.remove(1);
+  fm.remove(3);
+  std::vector<sai_object_id_t> ids;
+  for (const auto& object : fm.map()) {
+    EXPECT_EQ(object.first, object.second.id);
+    ids.push_back(object.first);
+  }
+  EXPECT_EQ(std::vector<sai_object_id_t>({0, 2, 4}), ids);
+
+  const auto& constFm = fm;
+  EXPECT_NE(constFm.map().end(), constFm.map().find(2));
+  EXPECT_EQ(constFm.map().end(), constFm.map().find(3));
+}
+
+TEST(FakeManager, entryKeys) {
+  FakeManager<std::string, FakeEntryObject> fm;
+  fm.create("a", 1);
+  fm.create("b", 2);
+  // Creating an existing entry leaves it alone
+  fm.create("a", 3);
+  EXPECT_EQ(2, fm.map().size());
+  EXPECT_EQ(1, fm.get("a").value);
+  EXPECT_EQ(1, fm.remove("a"));
+  EXPECT_EQ(0, fm.map().count("a"));
+  fm.create("c", 4);
+  EXPECT_EQ(4, fm.get("c").value);
+  EXPECT_EQ(2, fm.get("b").value);
+  EXPECT_FALSE(fm.map().empty());
+}
+
+TEST(FakeManager, membersUniqueAcrossGroups) {
+  FakeManagerWithMembers<FakeGroup, FakeGroupMember> fm;
+  auto group1 = fm.create();
+  auto group2 = fm.create();
+  auto member1 = fm.createMember(group1, group1);
+  auto member2 = fm.createMember(group2, group2);
+  EXPECT_NE(member1, member2);
+  EXPECT_EQ(group2, fm.getMember(member2).groupId);
+  EXPECT_EQ(member2, fm.get(group2).fm().get(member2).id);
+
+  EXPECT_EQ(1, fm.removeMember(member1));
+  EXPECT_EQ(0, fm.removeMember(member1));
+  EXPECT_TRUE(fm.get(group1).fm().map().empty());
+  // The id is reused, in whichever group
+  EXPECT_EQ(member1, fm.createMember(group2, group2));
+  EXPECT_EQ(2, fm.get(group2).fm().map().size());
+}
@@ -0,0 +1,280 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sim/HwCallReplayer.h"
+
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/MacAddress.h>
+
+#include <algorithm>
+#include <array>
+
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::shared_ptr;
+
+namespace facebook { namespace fboss {
+
+namespace {
+// At most this many next hop addresses are made up per interface subnet
+constexpr uint32_t kMaxNextHops = 4096;
+
+// The address offset past the network address of addr/mask
+IPAddress
+addressInSubnet(const IPAddress& addr, uint8_t mask, uint32_t offset) {
+  if (addr.isV4()) {
+    auto network = addr.asV4().mask(mask).toLongHBO();
+    return IPAddressV4::fromLongHBO(network + offset);
+  }
+  auto bytes = addr.asV6().mask(mask).toByteArray();
+  // offset is smaller than the subnet, so it never carries into the prefix
+  for (int b = 0; b < 4; ++b) {
+    bytes[15 - b] += (offset >> (8 * b)) & 0xff;
+  }
+  return IPAddressV6(bytes);
+}
+
+// A locally administered MAC address, distinct for each of a subnet's hosts
+MacAddress hostMac(const IPAddress& ip) {
+  auto bytes = ip.bytes() + ip.byteCount() - 4;
+  std::array<uint8_t, 6> mac{{0x02, 0x00, bytes[0], bytes[1], bytes[2],
+                              bytes[3]}};
+  return MacAddress::fromBinary(folly::ByteRange(mac.data(), mac.size()));
+}
+} // unnamed namespace
+
+HwCallReplayer::HwCallReplayer(SwSwitch* sw, Options options)
+    : sw_(sw), options_(options) {}
+
+bool HwCallReplayer::isReplayed(const HwCallRecord& record) {
+  if (record.depth != 0) {
+    return false;
+  }
+  switch (record.call) {
+    case HwCall::ROUTE_ADD:
+    case HwCall::ROUTE_DELETE:
+    case HwCall::HOST_ADD:
+    case HwCall::HOST_DELETE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+HwCallReplayer::Result HwCallReplayer::replay(
+    const std::vector<HwCallRecord>& records) {
+  // Records are written as calls finish, batch them by when they started
+  std::vector<HwCallRecord> calls;
+  for (const auto& record : records) {
+    if (isReplayed(record)) {
+      calls.push_back(record);
+    }
+  }
+  std::stable_sort(
+      calls.begin(),
+      calls.end(),
+      [](const HwCallRecord& a, const HwCallRecord& b) {
+        return a.timestampNs < b.timestampNs;
+      });
+
+  Result result;
+  auto window = duration_cast<nanoseconds>(options_.batchWindow).count();
+  auto start = std::chrono::steady_clock::now();
+  size_t begin = 0;
+  while (begin < calls.size()) {
+    auto end = begin + 1;
+    while (end < calls.size() &&
+           calls[end].timestampNs - calls[begin].timestampNs <=
+               static_cast<uint64_t>(window)) {
+      ++end;
+    }
+    replayBatch(calls, begin, end, &result);
+    begin = end;
+  }
+  result.replayTime = duration_cast<nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+  for (const auto& call : calls) {
+    result.recordedTime += nanoseconds(call.durationNs);
+  }
+  return result;
+}
+
+void HwCallReplayer::replayBatch(
+    const std::vector<HwCallRecord>& records,
+    size_t begin,
+    size_t end,
+    Result* result) {
+  Result batch;
+  auto updateFn = [&](const shared_ptr<SwitchState>& state) {
+    batch = Result();
+    auto newState = state;
+    RouteUpdater updater(state->getRouteTables());
+    for (auto i = begin; i < end; ++i) {
+      const auto& record = records[i];
+      bool replayed;
+      if (record.call == HwCall::ROUTE_ADD ||
+          record.call == HwCall::ROUTE_DELETE) {
+        replayed = applyRoute(record, state, &updater);
+      } else {
+        replayed = applyHost(record, &newState);
+      }
+      if (!replayed) {
+        ++batch.notReplayed;
+      } else if (record.call == HwCall::ROUTE_ADD) {
+        ++batch.routesAdded;
+      } else if (record.call == HwCall::ROUTE_DELETE) {
+        ++batch.routesDeleted;
+      } else if (record.call == HwCall::HOST_ADD) {
+        ++batch.hostsAdded;
+      } else {
+        ++batch.hostsDeleted;
+      }
+    }
+    auto newRt = updater.updateDone();
+    if (newRt) {
+      if (newState == state) {
+        newState = state->clone();
+      }
+      newState->resetRouteTables(std::move(newRt));
+    }
+    return newState == state ? shared_ptr<SwitchState>() : newState;
+  };
+  sw_->updateStateBlocking("replay hw calls", updateFn);
+
+  ++result->stateUpdates;
+  result->routesAdded += batch.routesAdded;
+  result->routesDeleted += batch.routesDeleted;
+  result->hostsAdded += batch.hostsAdded;
+  result->hostsDeleted += batch.hostsDeleted;
+  result->notReplayed += batch.notReplayed;
+}
+
+bool HwCallReplayer::applyRoute(
+    const HwCallRecord& record,
+    const shared_ptr<SwitchState>& state,
+    RouteUpdater* updater) {
+  auto vrf = RouterID(record.vrf);
+  auto prefix = record.getAddress();
+  auto clientId = StdClientIds2ClientID(StdClientIds::STATIC_ROUTE);
+  if (record.call == HwCall::ROUTE_DELETE) {
+    updater->delRoute(vrf, prefix, record.prefixLength, clientId);
+    return true;
+  }
+  if (record.count == 0) {
+    updater->addRoute(
+        vrf,
+        prefix,
+        record.prefixLength,
+        clientId,
+        RouteNextHopEntry(
+            RouteForwardAction::TO_CPU, AdminDistance::STATIC_ROUTE));
+    return true;
+  }
+
+  // Make up the next hops in the first subnet of the vrf with room for them,
+  // so that they resolve
+  for (const auto& intf : *state->getInterfaces()) {
+    if (intf->getRouterID() != vrf) {
+      continue;
+    }
+    for (const auto& addr : intf->getAddresses()) {
+      if (addr.first.isV4() != prefix.isV4()) {
+        continue;
+      }
+      auto hostBits = addr.first.bitCount() - addr.second;
+      if (hostBits < 2) {
+        continue;
+      }
+      // Leave out the network and broadcast addresses and the first host,
+      // usually the interface's own address
+      auto range = hostBits >= 13 ? kMaxNextHops : (1u << hostBits) - 3;
+      RouteNextHopEntry::NextHopSet nhops;
+      for (int32_t i = 0; i < record.count; ++i) {
+        auto offset =
+            (static_cast<uint32_t>(record.id) * record.count + i) % range;
+        nhops.emplace(UnresolvedNextHop(
+            addressInSubnet(addr.first, addr.second, offset + 2),
+            ECMP_WEIGHT));
+      }
+      updater->addRoute(
+          vrf,
+          prefix,
+          record.prefixLength,
+          clientId,
+          RouteNextHopEntry(std::move(nhops), AdminDistance::STATIC_ROUTE));
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HwCallReplayer::applyHost(
+    const HwCallRecord& record,
+    shared_ptr<SwitchState>* state) {
+  auto ip = record.getAddress();
+  shared_ptr<Interface> intf;
+  for (const auto& candidate : *(*state)->getInterfaces()) {
+    if (candidate->getRouterID() == RouterID(record.vrf) &&
+        candidate->canReachAddress(ip)) {
+      intf = candidate;
+      break;
+    }
+  }
+  if (!intf) {
+    return false;
+  }
+  auto vlan = (*state)->getVlans()->getVlanIf(intf->getVlanID());
+  if (!vlan || vlan->getPorts().empty()) {
+    return false;
+  }
+
+  auto replay = [&](auto table, auto addr) {
+    auto entry = table->getEntryIf(addr);
+    if (record.call == HwCall::HOST_DELETE) {
+      if (!entry) {
+        return false;
+      }
+      table->modify(vlan->getID(), state)->removeEntry(addr);
+      return true;
+    }
+    if (entry) {
+      // Reprogrammed, which the recording doesn't say enough to replay
+      return false;
+    }
+    table->modify(vlan->getID(), state)
+        ->addEntry(
+            addr,
+            hostMac(ip),
+            PortDescriptor(vlan->getPorts().begin()->first),
+            intf->getID());
+    return true;
+  };
+  if (ip.isV4()) {
+    return replay(vlan->getArpTable(), ip.asV4());
+  }
+  return replay(vlan->getNdpTable(), ip.asV6());
+}
+
+}} // facebook::fboss
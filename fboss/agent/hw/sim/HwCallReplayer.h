@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/hw/HwCallRecorder.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+class RouteUpdater;
+class SwSwitch;
+class SwitchState;
+
+/*
+ * Replays a recording made by HwCallRecorder as SwitchState updates, so the
+ * programming seen on a switch can be reproduced against another HwSwitch,
+ * normally a SimSwitch with a HwModel of the hardware's latencies.
+ *
+ * Only the route and host calls the HwSwitch was asked to make are replayed
+ * (the records at depth 0); the egresses and ECMP groups they programmed
+ * follow from them. Recorded calls that started within batchWindow of each
+ * other go into one state update, so the window trades how closely updates
+ * follow the recording for how much they are coalesced.
+ *
+ * The recording doesn't hold next hop addresses. A route gets as many next
+ * hops as it was recorded with, made up in the subnet of an interface of
+ * its vrf, and routes recorded on the same egress or ECMP group get the
+ * same ones. Hosts are added on the vlan of the interface whose subnet
+ * covers them. Whatever can't be placed is counted as not replayed.
+ */
+class HwCallReplayer {
+ public:
+  struct Options {
+    std::chrono::microseconds batchWindow{0};
+  };
+
+  struct Result {
+    uint64_t stateUpdates{0};
+    uint64_t routesAdded{0};
+    uint64_t routesDeleted{0};
+    uint64_t hostsAdded{0};
+    uint64_t hostsDeleted{0};
+    uint64_t notReplayed{0};
+    // How long the replayed calls took when they were recorded
+    std::chrono::nanoseconds recordedTime{0};
+    // How long the state updates took to apply
+    std::chrono::nanoseconds replayTime{0};
+  };
+
+  HwCallReplayer(SwSwitch* sw, Options options);
+
+  Result replay(const std::vector<HwCallRecord>& records);
+
+  static bool isReplayed(const HwCallRecord& record);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  HwCallReplayer(HwCallReplayer const&) = delete;
+  HwCallReplayer& operator=(HwCallReplayer const&) = delete;
+
+  // Replay records[begin, end) as one state update
+  void replayBatch(
+      const std::vector<HwCallRecord>& records,
+      size_t begin,
+      size_t end,
+      Result* result);
+
+  /*
+   * Apply one record to the state being built, routes going through
+   * updater. Returns false if there was nowhere to put it.
+   */
+  bool applyRoute(
+      const HwCallRecord& record,
+      const std::shared_ptr<SwitchState>& state,
+      RouteUpdater* updater);
+  bool applyHost(
+      const HwCallRecord& record,
+      std::shared_ptr<SwitchState>* state);
+
+  SwSwitch* sw_{nullptr};
+  Options options_;
+};
+
+}} // facebook::fboss
@@ -9,8 +9,19 @@
  */
 #include "fboss/agent/hw/sim/SimSwitch.h"
 
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+#include "fboss/agent/state/ArpEntry.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/DeltaFunctions.h"
+#include "fboss/agent/state/NdpEntry.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/SwitchState-defs.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
 #include "fboss/agent/hw/mock/MockTxPacket.h"
 
@@ -18,10 +29,15 @@
 #include <folly/dynamic.h>
 #include <folly/Memory.h>
 
+#include <thread>
+
 using std::make_unique;
 using std::make_shared;
 using std::shared_ptr;
 using std::string;
+using std::chrono::microseconds;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
 
 namespace facebook { namespace fboss {
 
@@ -43,8 +59,193 @@ HwInitResult SimSwitch::init(HwSwitch::Callback* callback) {
 }
 
 std::shared_ptr<SwitchState> SimSwitch::stateChanged(const StateDelta& delta) {
-  // TODO
-  return delta.newState();
+  auto appliedState = delta.newState();
+  microseconds latency{0};
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    auto before = stats_;
+    ++stats_.stateChangedCalls;
+
+    // Free up table space before taking more of it
+    for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+      auto unprogram = [&](const auto& route) { unprogramRoute(*route); };
+      DeltaFunctions::forEachRemoved(rtDelta.getRoutesV4Delta(), unprogram);
+      DeltaFunctions::forEachRemoved(rtDelta.getRoutesV6Delta(), unprogram);
+    }
+
+    for (const auto& vlanDelta : delta.getVlansDelta()) {
+      processNeighborDelta<ArpEntry, ArpTable>(
+          vlanDelta.getArpDelta(), &appliedState);
+      processNeighborDelta<NdpEntry, NdpTable>(
+          vlanDelta.getNdpDelta(), &appliedState);
+    }
+
+    for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+      if (!rtDelta.getNew()) {
+        continue;
+      }
+      auto id = rtDelta.getNew()->getID();
+      processRouteDelta<IPAddressV4>(
+          id, rtDelta.getRoutesV4Delta(), &appliedState);
+      processRouteDelta<IPAddressV6>(
+          id, rtDelta.getRoutesV6Delta(), &appliedState);
+    }
+
+    processAclDelta(delta, &appliedState);
+
+    latency = model_.perUpdateLatency +
+        model_.hostLatency * (stats_.hostOps - before.hostOps) +
+        model_.lpmLatency * (stats_.lpmOps - before.lpmOps) +
+        model_.ecmpLatency * (stats_.ecmpOps - before.ecmpOps) +
+        model_.aclLatency * (stats_.aclOps - before.aclOps);
+    stats_.modeledLatency += latency;
+  }
+
+  if (latency.count() > 0) {
+    std::this_thread::sleep_for(latency);
+  }
+  appliedState->publish();
+  return appliedState;
+}
+
+template <typename EntryT, typename NeighborTableT, typename DeltaT>
+void SimSwitch::processNeighborDelta(
+    const DeltaT& delta,
+    std::shared_ptr<SwitchState>* appliedState) {
+  DeltaFunctions::forEachRemoved(delta, [&](const shared_ptr<EntryT>&) {
+    --stats_.hostEntries;
+    ++stats_.hostOps;
+  });
+  DeltaFunctions::forEachChanged(
+      delta,
+      [&](const shared_ptr<EntryT>&, const shared_ptr<EntryT>&) {
+        ++stats_.hostOps;
+      },
+      [&](const shared_ptr<EntryT>& entry) {
+        if (stats_.hostEntries >= model_.hostTableSize) {
+          ++stats_.tableFullErrors;
+          SwitchState::revertNewNeighborEntry<EntryT, NeighborTableT>(
+              entry, nullptr, appliedState);
+          return;
+        }
+        ++stats_.hostEntries;
+        ++stats_.hostOps;
+      },
+      [](const shared_ptr<EntryT>&) {});
+}
+
+template <typename AddrT, typename DeltaT>
+void SimSwitch::processRouteDelta(
+    RouterID id,
+    const DeltaT& delta,
+    std::shared_ptr<SwitchState>* appliedState) {
+  using RouteT = Route<AddrT>;
+  DeltaFunctions::forEachChanged(
+      delta,
+      [&](const shared_ptr<RouteT>& oldRoute,
+          const shared_ptr<RouteT>& newRoute) {
+        unprogramRoute(*oldRoute);
+        if (!programRoute(*newRoute)) {
+          ++stats_.tableFullErrors;
+          // Takes back the space the old route just gave up
+          auto reprogrammed = programRoute(*oldRoute);
+          DCHECK(reprogrammed);
+          SwitchState::revertNewRouteEntry<AddrT>(
+              id, newRoute, oldRoute, appliedState);
+        }
+      },
+      [&](const shared_ptr<RouteT>& newRoute) {
+        if (!programRoute(*newRoute)) {
+          ++stats_.tableFullErrors;
+          SwitchState::revertNewRouteEntry<AddrT>(
+              id, newRoute, nullptr, appliedState);
+        }
+      },
+      [](const shared_ptr<RouteT>&) {});
+}
+
+void SimSwitch::processAclDelta(
+    const StateDelta& delta,
+    std::shared_ptr<SwitchState>* appliedState) {
+  DeltaFunctions::forEachRemoved(
+      delta.getAclsDelta(), [&](const shared_ptr<AclEntry>&) {
+        --stats_.aclEntries;
+        ++stats_.aclOps;
+      });
+  DeltaFunctions::forEachChanged(
+      delta.getAclsDelta(),
+      [&](const shared_ptr<AclEntry>&, const shared_ptr<AclEntry>&) {
+        ++stats_.aclOps;
+      },
+      [&](const shared_ptr<AclEntry>& acl) {
+        if (stats_.aclEntries >= model_.aclTableSize) {
+          ++stats_.tableFullErrors;
+          (*appliedState)
+              ->getAcls()
+              ->modify(appliedState)
+              ->removeEntry(acl->getID());
+          return;
+        }
+        ++stats_.aclEntries;
+        ++stats_.aclOps;
+      },
+      [](const shared_ptr<AclEntry>&) {});
+}
+
+template <typename RouteT>
+bool SimSwitch::programRoute(const RouteT& route) {
+  // Like BcmSwitch, unresolved routes are not programmed
+  if (!route.isResolved()) {
+    return true;
+  }
+  if (stats_.lpmEntries >= model_.lpmTableSize) {
+    return false;
+  }
+  const auto& nhops = route.getForwardInfo().getNextHopSet();
+  if (nhops.size() > 1) {
+    auto it = ecmpGroups_.find(nhops);
+    if (it != ecmpGroups_.end()) {
+      ++it->second;
+    } else if (stats_.ecmpGroups >= model_.ecmpTableSize) {
+      return false;
+    } else {
+      ecmpGroups_.emplace(nhops, 1);
+      ++stats_.ecmpGroups;
+      ++stats_.ecmpOps;
+    }
+  }
+  ++stats_.lpmEntries;
+  ++stats_.lpmOps;
+  return true;
+}
+
+template <typename RouteT>
+void SimSwitch::unprogramRoute(const RouteT& route) {
+  if (!route.isResolved()) {
+    return;
+  }
+  --stats_.lpmEntries;
+  ++stats_.lpmOps;
+  const auto& nhops = route.getForwardInfo().getNextHopSet();
+  if (nhops.size() > 1) {
+    auto it = ecmpGroups_.find(nhops);
+    CHECK(it != ecmpGroups_.end());
+    if (--it->second == 0) {
+      ecmpGroups_.erase(it);
+      --stats_.ecmpGroups;
+      ++stats_.ecmpOps;
+    }
+  }
+}
+
+void SimSwitch::setHwModel(const HwModel& model) {
+  std::lock_guard<std::mutex> g(lock_);
+  model_ = model;
+}
+
+SimSwitch::Stats SimSwitch::getStats() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return stats_;
 }
 
 std::unique_ptr<TxPacket> SimSwitch::allocatePacket(uint32_t size) {
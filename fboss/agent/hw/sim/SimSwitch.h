@@ -10,9 +10,16 @@
 #pragma once
 
 #include "fboss/agent/HwSwitch.h"
+#include "fboss/agent/state/RouteNextHopEntry.h"
+#include "fboss/agent/types.h"
 
 #include <folly/Optional.h>
 
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+
 namespace facebook { namespace fboss {
 
 class SimPlatform;
@@ -20,6 +27,48 @@ class SwitchState;
 
 class SimSwitch : public HwSwitch {
  public:
+  /*
+   * An optional model of the hardware tables and how long they take to
+   * program.  By default the tables have no limit and programming is free,
+   * so that every state is accepted instantly.
+   *
+   * When a table is full, the entries that don't fit are left out of the
+   * applied state, the way BcmSwitch handles a full table, so that SwSwitch
+   * sees the hardware as out of sync.  Each stateChanged() call takes
+   * perUpdateLatency plus the latency of every entry it programs.
+   */
+  struct HwModel {
+    // Neighbor entries, ARP and NDP together
+    uint32_t hostTableSize{std::numeric_limits<uint32_t>::max()};
+    // Resolved routes, IPv4 and IPv6 together
+    uint32_t lpmTableSize{std::numeric_limits<uint32_t>::max()};
+    // Distinct next hop sets of the routes with more than one next hop
+    uint32_t ecmpTableSize{std::numeric_limits<uint32_t>::max()};
+    uint32_t aclTableSize{std::numeric_limits<uint32_t>::max()};
+
+    std::chrono::microseconds perUpdateLatency{0};
+    std::chrono::microseconds hostLatency{0};
+    std::chrono::microseconds lpmLatency{0};
+    std::chrono::microseconds ecmpLatency{0};
+    std::chrono::microseconds aclLatency{0};
+  };
+
+  struct Stats {
+    uint32_t hostEntries{0};
+    uint32_t lpmEntries{0};
+    uint32_t ecmpGroups{0};
+    uint32_t aclEntries{0};
+
+    uint64_t stateChangedCalls{0};
+    uint64_t hostOps{0};
+    uint64_t lpmOps{0};
+    uint64_t ecmpOps{0};
+    uint64_t aclOps{0};
+    // Entries left out of the applied state because their table was full
+    uint64_t tableFullErrors{0};
+    std::chrono::microseconds modeledLatency{0};
+  };
+
   SimSwitch(SimPlatform* platform, uint32_t numPorts);
 
   HwInitResult init(Callback* callback) override;
@@ -58,6 +107,13 @@ class SimSwitch : public HwSwitch {
 
   void resetTxCount() { txCount_ = 0; }
   uint64_t getTxCount() const { return txCount_; }
+
+  /*
+   * Set before the first state update; changing the capacities under
+   * programmed entries doesn't evict them.
+   */
+  void setHwModel(const HwModel& model);
+  Stats getStats() const;
   void exitFatal() const override {
     // TODO
   }
@@ -90,9 +146,38 @@ class SimSwitch : public HwSwitch {
   SimSwitch(SimSwitch const &) = delete;
   SimSwitch& operator=(SimSwitch const &) = delete;
 
+  template <typename EntryT, typename NeighborTableT, typename DeltaT>
+  void processNeighborDelta(
+      const DeltaT& delta,
+      std::shared_ptr<SwitchState>* appliedState);
+  template <typename AddrT, typename DeltaT>
+  void processRouteDelta(
+      RouterID id,
+      const DeltaT& delta,
+      std::shared_ptr<SwitchState>* appliedState);
+  void processAclDelta(
+      const StateDelta& delta,
+      std::shared_ptr<SwitchState>* appliedState);
+
+  /*
+   * Take a table entry for the route, and an ECMP group if it needs
+   * one.  Returns false, having taken nothing, if either table is full.
+   */
+  template <typename RouteT>
+  bool programRoute(const RouteT& route);
+  template <typename RouteT>
+  void unprogramRoute(const RouteT& route);
+
   HwSwitch::Callback* callback_{nullptr};
   uint32_t numPorts_{0};
   uint64_t txCount_{0};
+
+  // Protects the model, the stats and the ECMP groups
+  mutable std::mutex lock_;
+  HwModel model_;
+  Stats stats_;
+  // Number of routes using each ECMP group
+  std::map<RouteNextHopSet, uint32_t> ecmpGroups_;
 };
 
 }} // facebook::fboss
@@ -87,6 +87,44 @@ struct RouteDetails {
   6: optional AdminDistance adminDistance,
 }
 
+struct RouteTableFilter {
+  // Only routes of this VRF
+  1: optional i32 vrf,
+  // Only routes this client has next hops for
+  2: optional i16 clientId,
+  // Only routes for this prefix or prefixes within it
+  3: optional IpPrefix prefix,
+}
+
+/*
+ * Where a paginated route table walk stopped. Routes are walked by VRF, IPv4
+ * before IPv6, and then in prefix order.
+ */
+struct RouteTableCursor {
+  1: i32 vrf,
+  // The last route returned
+  2: IpPrefix lastPrefix,
+}
+
+struct RouteTablePageRequest {
+  1: RouteTableFilter filter,
+  // Start after this, from the beginning if unset
+  2: optional RouteTableCursor cursor,
+  // Capped by the agent's --max_route_table_page_size
+  3: i32 maxRoutes = 1000,
+}
+
+struct RouteTablePage {
+  1: list<UnicastRoute> routes,
+  // Pass this in the next request to continue, unset once we are done
+  2: optional RouteTableCursor next,
+}
+
+struct RouteDetailsPage {
+  1: list<RouteDetails> routes,
+  2: optional RouteTableCursor next,
+}
+
 struct ArpEntryThrift {
   1: string mac,
   2: i32 port,
@@ -107,6 +145,37 @@ struct L2EntryThrift {
   4: optional i32 trunk
 }
 
+struct L2TableFilter {
+  // Only entries of this VLAN
+  1: optional i32 vlanID,
+  // Only entries learned on this port
+  2: optional i32 port,
+}
+
+/*
+ * Where a paginated L2 table walk stopped. The walk goes in hardware table
+ * order, which entries learned or aged out between pages shift, so a walk
+ * may miss or repeat some of them.
+ */
+struct L2TableCursor {
+  // Entries matching the filter already returned
+  1: i32 numReturned,
+}
+
+struct L2TablePageRequest {
+  1: L2TableFilter filter,
+  // Start after this, from the beginning if unset
+  2: optional L2TableCursor cursor,
+  // Capped by the agent's --max_l2_table_page_size
+  3: i32 maxEntries = 1000,
+}
+
+struct L2TablePage {
+  1: list<L2EntryThrift> entries,
+  // Pass this in the next request to continue, unset once we are done
+  2: optional L2TableCursor next,
+}
+
 enum LacpPortRateThrift {
   SLOW = 0,
   FAST = 1,
@@ -210,10 +279,74 @@ struct QueueStats {
   2: i64 outBytes,
 }
 
+/*
+ * A period during which a queue's buffer occupancy stayed at or above the
+ * microburst threshold.
+ */
+struct QueueBurstEvent {
+  // Microseconds since the epoch
+  1: i64 startTimeUs,
+  // 0 if the burst is still going on
+  2: i64 durationUs,
+  3: i64 peakBytes,
+}
+
+/*
+ * Buffer occupancy of a unicast queue over the requested window.
+ */
+struct QueueBufferStats {
+  1: i32 port,
+  2: i32 queue,
+  3: i64 maxOccupancyBytes,
+  // Oldest first
+  4: list<QueueBurstEvent> bursts = [];
+}
+
+/*
+ * How evenly an ECMP group's traffic was spread over its member ports, going
+ * by the ports' egress counters over the last measurement interval. A port
+ * carrying traffic of other groups as well counts all of it.
+ */
+struct EcmpGroupBalance {
+  1: i32 ecmpId,
+  // Bytes per second out of each member port, by port ID
+  2: map<i32, i64> memberBytesPerSec,
+  // Load of the busiest member over the mean load of the members, in
+  // percent, each member weighted by its number of paths. 100 is even.
+  3: i32 maxOverMeanPct,
+}
+
 /*
  * Values in these counters are cumulative since the last time the agent
  * started.
  */
+// A flow whose hashing to be traced, as a packet coming in on ingressPort
+struct FlowTuple {
+  1: Address.BinaryAddress srcIp,
+  2: Address.BinaryAddress dstIp,
+  // Of the TCP or UDP header
+  3: i32 srcPort,
+  4: i32 dstPort,
+  // TCP (6) or UDP (17)
+  5: i16 ipProtocol = 17,
+  6: i32 ingressPort,
+}
+
+struct EgressHashDistribution {
+  // Egress ports the group's flows could be hashed to
+  1: list<i32> potentialEgressPorts,
+  // Flows hashed to each of them, the ports which got none left out
+  2: map<i32, i64> flowsPerEgressPort,
+}
+
+struct FlowHashingReport {
+  // One per distinct set of potential egress ports
+  1: list<EgressHashDistribution> groups,
+  2: i64 numTraced,
+  // Flows the hardware couldn't trace
+  3: i64 numFailed,
+}
+
 struct PortCounters {
   1: i64 bytes,
   2: i64 ucastPkts,
@@ -328,8 +461,27 @@ struct RxCaptureFilter {
   # can put additional Rx filters here if need be
 }
 
+/*
+ * Packet header criteria, checked against each packet before it is copied
+ * into the capture. A packet must match every non-empty list below, and
+ * matches a list if it matches any entry in it.
+ */
+struct PacketMatchFilter {
+  // Ingress ports. Sent packets never match a port filter.
+  1: list<i32> ports
+  // The VLAN a packet was received on, or its 802.1Q VLAN tag
+  2: list<i32> vlans
+  3: list<i32> ethertypes
+  // Only IPv4 and IPv6 packets can match these. The protocol is the IPv4
+  // protocol or the IPv6 next header field.
+  4: list<i32> ipProtocols
+  // Packets with a source or destination address within any of the prefixes
+  5: list<IpPrefix> prefixes
+}
+
 struct CaptureFilter {
   1: RxCaptureFilter rxCaptureFilter;
+  2: PacketMatchFilter matchFilter;
 }
 
 struct CaptureInfo {
@@ -349,6 +501,18 @@ struct CaptureInfo {
    * set of criteria that packet must meet to be captured
    */
   4: CaptureFilter  filter
+  /*
+   * When set, write the capture to a series of files of at most rotateBytes
+   * each, <name>.pcap.0, <name>.pcap.1, ..., rather than to a single file.
+   * A new file is also started every rotateSeconds if set, and only the
+   * latest maxFiles files are kept if set, so that a capture can be left
+   * running with bounded disk usage. snaplen limits how many bytes of each
+   * packet are written to these files.
+   */
+  5: optional i64 rotateBytes
+  6: optional i32 rotateSeconds
+  7: optional i32 maxFiles
+  8: optional i32 snaplen
 }
 
 struct RouteUpdateLoggingInfo {
@@ -364,6 +528,69 @@ struct RouteUpdateLoggingInfo {
   3: bool exact
 }
 
+/*
+ * How long a state update took in each of its phases, in microseconds.
+ * Updates applied in the same batch share the hwApply and observers time.
+ */
+struct StateUpdateTiming {
+  1: string name
+  // When the update thread picked the update up, in microseconds since epoch
+  2: i64 startTimeUs
+  // Waiting for the update thread
+  3: i64 queuedUs
+  // Running the update function on the software state
+  4: i64 swApplyUs
+  // Programming the hardware
+  5: i64 hwApplyUs
+  // Notifying the state observers
+  6: i64 observersUs
+  // Number of updates applied in the same batch, this one included
+  7: i32 batchSize
+}
+
+/*
+ * The number of resolved routes forwarding through a next hop
+ */
+struct NextHopRouteCount {
+  1: i32 vrf
+  2: NextHopThrift nextHop
+  3: i64 routeCount
+}
+
+/*
+ * Estimated memory used by the nodes of one type in the switch state
+ */
+struct StateMemoryUsage {
+  // Number of distinct nodes of this type
+  1: i64 count
+  2: i64 bytes
+}
+
+/*
+ * A change to one of the SwitchState subtrees exported through
+ * subscribeToStateChanges, in the JSON getCurrentStateJSON returns
+ */
+struct StateNodeChange {
+  // "ports", "vlans", "routeTables"... as in getCurrentStateJSON
+  1: string subtree
+  // IDs of the nodes leading to the one that changed within the subtree,
+  // e.g. [portId] or [routerId, "ribV4", prefix]. Empty if the whole
+  // subtree is replaced
+  2: list<string> path
+  // The new subtree or node, unset if the node was removed
+  3: optional string json
+}
+
+/*
+ * A snapshot of the subscribed subtrees, or the changes from one published
+ * state to the next
+ */
+struct StateExportUpdate {
+  // Generation of the state the update brings the subscriber to
+  1: i64 generation
+  2: list<StateNodeChange> changes
+}
+
 /*
  * Information about an LLDP neighbor
  */
@@ -421,8 +648,35 @@ service FbossCtrl extends fb303.FacebookService {
     throws (1: fboss.FbossBaseError error)
   void deleteUnicastRoutes(1: i16 clientId, 2: list<IpPrefix> r)
     throws (1: fboss.FbossBaseError error)
+  /*
+   * Non-blocking versions of addUnicastRoutes and deleteUnicastRoutes.
+   * They return the batch's sequence number as soon as it is queued.
+   * Batches queued by any client while an update is pending are applied
+   * together, in one pass over the route tables and one hardware update.
+   */
+  i64 enqueueAddUnicastRoutes(1: i16 clientId, 2: list<UnicastRoute> r)
+    throws (1: fboss.FbossBaseError error)
+  i64 enqueueDeleteUnicastRoutes(1: i16 clientId, 2: list<IpPrefix> r)
+    throws (1: fboss.FbossBaseError error)
+  /*
+   * Wait for up to timeoutMs until every route batch up to seq has been
+   * programmed, and return whether it was. Throws if batch seq failed.
+   */
+  bool waitForRouteUpdates(1: i64 seq, 2: i32 timeoutMs)
+    throws (1: fboss.FbossBaseError error)
   void syncFib(1: i16 clientId, 2: list<UnicastRoute> routes)
     throws (1: fboss.FbossBaseError error)
+  /*
+   * Graceful restart of a routing client, as an alternative to syncFib.
+   * beginGracefulRestart marks all of the client's routes stale, leaving
+   * them in place, and returns their number. The client then re-advertises
+   * its routes with the add calls, and endOfRib deletes its routes which
+   * are still stale, returning how many it deleted.
+   */
+  i64 beginGracefulRestart(1: i16 clientId)
+    throws (1: fboss.FbossBaseError error)
+  i64 endOfRib(1: i16 clientId)
+    throws (1: fboss.FbossBaseError error)
 
   /*
    * Begins a packet stream from the switch to a distribution service
@@ -512,6 +766,16 @@ service FbossCtrl extends fb303.FacebookService {
     throws (1: fboss.FbossBaseError error)
   RouteDetails getIpRouteDetails(1: Address.Address addr 2: i32 vrfId)
     throws (1: fboss.FbossBaseError error)
+  /*
+   * getIpRoute/getIpRouteDetails for a batch of addresses, the results are
+   * in the same order as addrs
+   */
+  list<UnicastRoute> getIpRoutes(1: list<Address.Address> addrs 2: i32 vrfId)
+    throws (1: fboss.FbossBaseError error)
+  list<RouteDetails> getIpRoutesDetails(
+    1: list<Address.Address> addrs
+    2: i32 vrfId)
+    throws (1: fboss.FbossBaseError error)
   map<i32, InterfaceDetail> getAllInterfaces()
     throws (1: fboss.FbossBaseError error)
   void registerForNeighborChanged()
@@ -528,6 +792,18 @@ service FbossCtrl extends fb303.FacebookService {
     throws (1: fboss.FbossBaseError error)
   list<RouteDetails> getRouteTableDetails()
     throws (1: fboss.FbossBaseError error)
+  /*
+   * Paginated versions of getRouteTable/getRouteTableByClient and
+   * getRouteTableDetails, for tables too big to return in one go.
+   *
+   * With a client filter getRouteTablePage returns that client's next hops,
+   * like getRouteTableByClient. Otherwise it only returns resolved routes,
+   * like getRouteTable.
+   */
+  RouteTablePage getRouteTablePage(1: RouteTablePageRequest request)
+    throws (1: fboss.FbossBaseError error)
+  RouteDetailsPage getRouteTableDetailsPage(1: RouteTablePageRequest request)
+    throws (1: fboss.FbossBaseError error)
   InterfaceDetail getInterfaceDetail(1: i32 interfaceId)
     throws (1: fboss.FbossBaseError error)
 
@@ -575,6 +851,36 @@ service FbossCtrl extends fb303.FacebookService {
     throws (1: fboss.FbossBaseError error)
   list<L2EntryThrift> getL2Table()
     throws (1: fboss.FbossBaseError error)
+  /*
+   * Paginated version of getL2Table, for L2 tables too big to walk in one
+   * go.
+   */
+  L2TablePage getL2TablePage(1: L2TablePageRequest request)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Maximum buffer occupancy and microbursts of every unicast queue over the
+   * last windowSeconds, for queues which are being monitored
+   * (--microburst_sample_interval_us).
+   */
+  list<QueueBufferStats> getQueueBufferStats(1: i32 windowSeconds)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * The ECMP groups whose traffic is spread the least evenly, worst first,
+   * at most maxGroups of them, as last measured (--ecmp_balance_interval_s).
+   */
+  list<EcmpGroupBalance> getEcmpBalance(1: i32 maxGroups)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Trace how the hardware would hash each of the flows, and count the flows
+   * going out of each of the ports they could go out of. Made for checking
+   * ECMP hashing with large numbers of synthetic flows, at most
+   * --max_traced_flows of them in one call.
+   */
+  FlowHashingReport traceFlowHashing(1: list<FlowTuple> flows)
+    throws (1: fboss.FbossBaseError error)
 
   AggregatePortThrift getAggregatePort(1: i32 aggregatePortID)
     throws (1: fboss.FbossBaseError error)
@@ -622,6 +928,13 @@ service FbossCtrl extends fb303.FacebookService {
   void stopLoggingAnyRouteUpdates(1: string identifier)
   list<RouteUpdateLoggingInfo> getRouteUpdateLoggingTrackedPrefixes()
 
+  /*
+   * The next hops resolved routes forward through, with the number of
+   * routes through each, e.g. to check nothing is left on a link before
+   * draining it. Kept up to date as routes change, so cheap to call.
+   */
+  list<NextHopRouteCount> getNextHopRouteCounts()
+
   void keepalive()
 
   i32 getIdleTimeout()
@@ -655,6 +968,31 @@ service FbossCtrl extends fb303.FacebookService {
   */
   SwitchRunState getSwitchRunState()
 
+  /*
+   * The slowest of the recently applied state updates, slowest first, by
+   * total time from being queued to the observers being notified.
+   */
+  list<StateUpdateTiming> getSlowestStateUpdates(1: i32 count)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Memory used by the applied and desired switch states, by node type.
+   * Nodes shared between the two states are counted once. This walks the
+   * whole state, so avoid calling it often on large states.
+   */
+  map<string, StateMemoryUsage> getStateMemoryUsage()
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Mirror selected SwitchState subtrees without polling. Returns a
+   * snapshot of the subtrees, all of them if subtrees is empty, then calls
+   * StateListenerClient.stateChanged on the duplex connection with the
+   * changes of each later state that touches them. Node maps are patched
+   * per node.
+   */
+  StateExportUpdate subscribeToStateChanges(1: list<string> subtrees)
+    throws (1: fboss.FbossBaseError error) (thread='eb')
+
 }
 
 service NeighborListenerClient extends fb303.FacebookService {
@@ -668,3 +1006,12 @@ service NeighborListenerClient extends fb303.FacebookService {
   void neighborsChanged(1: list<string> added, 2: list<string> removed)
     throws (1: fboss.FbossBaseError error)
 }
+
+service StateListenerClient extends fb303.FacebookService {
+  /*
+   * Sends the changes of a published state to a subscriber of
+   * subscribeToStateChanges, in the order the states were published.
+   */
+  void stateChanged(1: StateExportUpdate update)
+    throws (1: fboss.FbossBaseError error)
+}
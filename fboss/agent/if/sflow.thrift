@@ -26,4 +26,16 @@ struct SflowPacketInfo {
 
   // The packet itself
   7: binary packetData
+
+  // The rate the port was sampled at, which can be higher than configured
+  // when the agent is backing off under load
+  8: i64 samplingRate
+}
+
+//
+// Several samples exported in one datagram, when the agent is started with
+// --sflow_samples_per_datagram > 1
+//
+struct SflowPacketInfoBatch {
+  1: list<SflowPacketInfo> samples
 }
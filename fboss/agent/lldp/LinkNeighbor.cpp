@@ -9,6 +9,8 @@
 #include <folly/logging/xlog.h>
 #include <glog/logging.h>
 
+#include <cstring>
+
 using folly::ByteRange;
 using folly::IPAddressV4;
 using folly::IPAddressV6;
@@ -124,6 +126,7 @@ bool LinkNeighbor::parseLldpPdu(PortID srcPort,
   localVlan_ = vlan;
   srcMac_ = srcMac;
 
+  const Cursor start = *cursor;
   bool chassisIdPresent{false};
   bool portIdPresent{false};
   bool ttlPresent{false};
@@ -164,9 +167,16 @@ bool LinkNeighbor::parseLldpPdu(PortID srcPort,
     return false;
   }
 
+  auto pdu = start;
+  lldpPdu_ = pdu.readFixedString(start.totalLength() - cursor->totalLength());
   return true;
 }
 
+bool LinkNeighbor::isSameLldpPdu(ByteRange pdu) const {
+  return !lldpPdu_.empty() && pdu.size() >= lldpPdu_.size() &&
+      memcmp(pdu.data(), lldpPdu_.data(), lldpPdu_.size()) == 0;
+}
+
 LinkNeighbor::LldpTlvType LinkNeighbor::parseLldpTlv(Cursor* cursor) {
   // Parse the type (7 bits) and length (9 bits)
   uint16_t length = cursor->readBE<uint16_t>();
@@ -185,6 +185,12 @@ struct LinkNeighbor {
                     uint16_t ethertype,
                     folly::io::Cursor* cursor);
 
+  /*
+   * Whether pdu starts with the LLDP TLVs this neighbor was parsed from, in
+   * which case parsing it would only give this neighbor again.
+   */
+  bool isSameLldpPdu(folly::ByteRange pdu) const;
+
   /*
    * Set neighbor fields based on a CDP packet.
    *
@@ -304,6 +310,8 @@ struct LinkNeighbor {
   std::string systemName_;
   std::string portDescription_;
   std::string systemDescription_;
+  // The TLVs parseLldpPdu() parsed, up to and including the end TLV
+  std::string lldpPdu_;
 
   std::chrono::seconds receivedTTL_;
   std::chrono::steady_clock::time_point expirationTime_;
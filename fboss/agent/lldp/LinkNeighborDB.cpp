@@ -1,6 +1,8 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 #include "fboss/agent/lldp/LinkNeighborDB.h"
 
+#include <algorithm>
+
 using std::chrono::steady_clock;
 using std::lock_guard;
 using std::mutex;
@@ -8,49 +10,16 @@ using std::vector;
 
 namespace facebook { namespace fboss {
 
-LinkNeighborDB::NeighborKey::NeighborKey(const LinkNeighbor& neighbor)
-  : chassisIdType_(neighbor.getChassisIdType()),
-    portIdType_(neighbor.getPortIdType()),
-    chassisId_(neighbor.getChassisId()),
-    portId_(neighbor.getPortId()) {
-}
-
-bool LinkNeighborDB::NeighborKey::operator<(const NeighborKey& other) const {
-  if (chassisIdType_ < other.chassisIdType_) {
-    return true;
-  } else if (chassisIdType_ > other.chassisIdType_) {
-    return false;
-  }
-
-  if (portIdType_ < other.portIdType_) {
-    return true;
-  } else if (portIdType_ > other.portIdType_) {
-    return false;
-  }
-
-  if (chassisId_ < other.chassisId_) {
-    return true;
-  } else if (chassisId_ > other.chassisId_) {
-    return false;
-  }
-
-  if (portId_ < other.portId_) {
-    return true;
-  } else if (portId_ > other.portId_) {
-    return false;
-  }
-
-  return false;
+LinkNeighborDB::LinkNeighborDB() {
 }
 
-bool LinkNeighborDB::NeighborKey::operator==(const NeighborKey& other) const {
-  return (chassisIdType_ == other.chassisIdType_ &&
-          portIdType_ == other.portIdType_ &&
-          chassisId_ == other.chassisId_ &&
-          portId_ == other.portId_);
-}
-
-LinkNeighborDB::LinkNeighborDB() {
+bool LinkNeighborDB::sameNeighbor(
+    const LinkNeighbor& a,
+    const LinkNeighbor& b) {
+  return (a.getChassisIdType() == b.getChassisIdType() &&
+          a.getPortIdType() == b.getPortIdType() &&
+          a.getChassisId() == b.getChassisId() &&
+          a.getPortId() == b.getPortId());
 }
 
 void LinkNeighborDB::update(const LinkNeighbor& neighbor) {
@@ -59,44 +28,71 @@ void LinkNeighborDB::update(const LinkNeighbor& neighbor) {
   // Go ahead and prune expired neighbors each time we get updated.
   pruneLocked(steady_clock::now());
 
-  auto it = byLocalPort_.find(neighbor.getLocalPort());
-  if (it == byLocalPort_.end()) {
-    // This is the first time we have seen data for this port.
-    auto ret = byLocalPort_.emplace(neighbor.getLocalPort(),
-                                    NeighborMap());
-    it = ret.first;
+  auto& neighbors = byLocalPort_[neighbor.getLocalPort()];
+  auto it = std::find_if(
+      neighbors.begin(), neighbors.end(), [&](const LinkNeighbor& existing) {
+        return sameNeighbor(existing, neighbor);
+      });
+  if (it == neighbors.end()) {
+    neighbors.push_back(neighbor);
+  } else {
+    *it = neighbor;
   }
-
-  NeighborKey key(neighbor);
-  // It would be nicer to use insert_or_assign() once we move to C++17
-  it->second[key] = neighbor;
+  snapshot_.reset();
 }
 
-vector<LinkNeighbor> LinkNeighborDB::getNeighbors() {
-  vector<LinkNeighbor> results;
+bool LinkNeighborDB::refresh(
+    PortID port,
+    VlanID vlan,
+    folly::MacAddress srcMac,
+    folly::ByteRange pdu) {
   lock_guard<mutex> guard(mutex_);
 
-  for (const auto& portEntry : byLocalPort_) {
-    for (const auto& entry : portEntry.second) {
-      results.push_back(entry.second);
+  auto now = steady_clock::now();
+  pruneLocked(now);
+
+  auto portIt = byLocalPort_.find(port);
+  if (portIt == byLocalPort_.end()) {
+    return false;
+  }
+  for (auto& neighbor : portIt->second) {
+    if (neighbor.getMac() == srcMac && neighbor.getLocalVlan() == vlan &&
+        neighbor.isSameLldpPdu(pdu)) {
+      // Same PDU, same TTL
+      neighbor.setTTL(neighbor.getTTL(), now + neighbor.getTTL());
+      snapshot_.reset();
+      return true;
     }
   }
+  return false;
+}
 
-  return results;
+vector<LinkNeighbor> LinkNeighborDB::getNeighbors() {
+  return *getNeighborsSnapshot();
+}
+
+std::shared_ptr<const vector<LinkNeighbor>>
+LinkNeighborDB::getNeighborsSnapshot() {
+  lock_guard<mutex> guard(mutex_);
+  if (!snapshot_) {
+    auto results = std::make_shared<vector<LinkNeighbor>>();
+    for (const auto& portEntry : byLocalPort_) {
+      results->insert(
+          results->end(), portEntry.second.begin(), portEntry.second.end());
+    }
+    snapshot_ = std::move(results);
+  }
+  return snapshot_;
 }
 
 vector<LinkNeighbor> LinkNeighborDB::getNeighbors(PortID port) {
-  vector<LinkNeighbor> results;
   lock_guard<mutex> guard(mutex_);
 
   auto it = byLocalPort_.find(port);
   if (it != byLocalPort_.end()) {
-    for (const auto& entry : it->second) {
-      results.push_back(entry.second);
-    }
+    return it->second;
   }
-
-  return results;
+  return vector<LinkNeighbor>();
 }
 
 void LinkNeighborDB::pruneExpiredNeighbors() {
@@ -112,7 +108,9 @@ void LinkNeighborDB::pruneExpiredNeighbors(steady_clock::time_point now) {
 void LinkNeighborDB::portDown(PortID port) {
   lock_guard<mutex> guard(mutex_);
   // Port went down, prune lldp entries for that port
-  byLocalPort_.erase(port);
+  if (byLocalPort_.erase(port)) {
+    snapshot_.reset();
+  }
 }
 
 void LinkNeighborDB::pruneLocked(steady_clock::time_point now) {
@@ -124,16 +122,15 @@ void LinkNeighborDB::pruneLocked(steady_clock::time_point now) {
   // implementing right now.
 
   for (auto& portEntry : byLocalPort_) {
-    // Advance the iterator manually to avoid make sure we don't
-    // have invalid iterators to erased elements.
-    auto& map = portEntry.second;
-    auto it = map.begin();
-    while (it != map.end()) {
-      auto current = it;
-      ++it;
-      if (current->second.isExpired(now)) {
-        map.erase(current);
-      }
+    auto& neighbors = portEntry.second;
+    auto end = std::remove_if(
+        neighbors.begin(), neighbors.end(), [&](const LinkNeighbor& n) {
+          return n.isExpired(now);
+        });
+    if (end != neighbors.end()) {
+      neighbors.erase(end, neighbors.end());
+      // Only rebuild the snapshot once something actually expired
+      snapshot_.reset();
     }
   }
 }
@@ -4,8 +4,9 @@
 #include "fboss/agent/types.h"
 #include "fboss/agent/lldp/LinkNeighbor.h"
 
+#include <boost/container/flat_map.hpp>
 #include <chrono>
-#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -27,6 +28,20 @@ class LinkNeighborDB {
    */
   void update(const LinkNeighbor& neighbor);
 
+  /*
+   * Refresh the neighbor seen on port and vlan from srcMac, if the LLDP PDU
+   * it sent is byte for byte the one it was learned from. This only pushes
+   * back its expiration, so that the PDUs a neighbor keeps sending don't
+   * have to be parsed again.
+   *
+   * Returns false if there is no such neighbor, and so the PDU has to be
+   * parsed and passed to update().
+   */
+  bool refresh(PortID port,
+               VlanID vlan,
+               folly::MacAddress srcMac,
+               folly::ByteRange pdu);
+
   /*
    * Get all known neighbors.
    *
@@ -34,6 +49,14 @@ class LinkNeighborDB {
    */
   std::vector<LinkNeighbor> getNeighbors();
 
+  /*
+   * Get all known neighbors, without copying them.
+   *
+   * The snapshot is immutable and is shared by all callers until the
+   * neighbor information next changes, so polling this is cheap.
+   */
+  std::shared_ptr<const std::vector<LinkNeighbor>> getNeighborsSnapshot();
+
   /*
    * Get all known neighbors on a specific port.
    *
@@ -49,19 +72,11 @@ class LinkNeighborDB {
   void portDown(PortID port);
 
  private:
-  class NeighborKey {
-   public:
-    explicit NeighborKey(const LinkNeighbor& neighbor);
-    bool operator<(const NeighborKey& other) const;
-    bool operator==(const NeighborKey& other) const;
-
-   private:
-    LldpChassisIdType chassisIdType_;
-    LldpPortIdType portIdType_;
-    std::string chassisId_;
-    std::string portId_;
-  };
-  typedef std::map<NeighborKey, LinkNeighbor> NeighborMap;
+  // Ports only ever have a handful of neighbors, so a vector we scan
+  // linearly beats a map keyed by copies of the neighbor's id strings
+  typedef std::vector<LinkNeighbor> NeighborList;
+
+  static bool sameNeighbor(const LinkNeighbor& a, const LinkNeighbor& b);
 
   // Forbidden copy constructor and assignment operator
   LinkNeighborDB(LinkNeighborDB const &) = delete;
@@ -70,7 +85,9 @@ class LinkNeighborDB {
   void pruneLocked(std::chrono::steady_clock::time_point now);
 
   std::mutex mutex_;
-  std::map<PortID, NeighborMap> byLocalPort_;
+  boost::container::flat_map<PortID, NeighborList> byLocalPort_;
+  // Built on demand by getNeighborsSnapshot(), dropped on any change
+  std::shared_ptr<const std::vector<LinkNeighbor>> snapshot_;
 };
 
 }} // facebook::fboss
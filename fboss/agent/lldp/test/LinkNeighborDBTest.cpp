@@ -104,3 +104,39 @@ TEST(LinkNeighborDB, test) {
   ASSERT_EQ(1, neighbors.size());
   EXPECT_EQ("neighbor3 name", neighbors[0].getSystemName());
 }
+
+TEST(LinkNeighborDB, snapshot) {
+  LinkNeighborDB db;
+
+  LinkNeighbor n1;
+  n1.setProtocol(LinkProtocol::LLDP);
+  n1.setLocalPort(PortID(1));
+  n1.setLocalVlan(VlanID(1));
+  n1.setMac(MacAddress("00:11:22:33:44:55"));
+  n1.setChassisId("neighbor1", LldpChassisIdType::LOCALLY_ASSIGNED);
+  n1.setPortId("1/1", LldpPortIdType::LOCALLY_ASSIGNED);
+  n1.setTTL(seconds(5));
+  db.update(n1);
+
+  // Unchanged DB hands out the same snapshot
+  auto snapshot = db.getNeighborsSnapshot();
+  ASSERT_EQ(1, snapshot->size());
+  EXPECT_EQ(snapshot, db.getNeighborsSnapshot());
+
+  // Pruning nothing keeps it
+  db.pruneExpiredNeighbors(steady_clock::now());
+  EXPECT_EQ(snapshot, db.getNeighborsSnapshot());
+
+  // Updates produce a new one, the old one is left as it was
+  n1.setSystemName("neighbor1 name");
+  db.update(n1);
+  auto updated = db.getNeighborsSnapshot();
+  EXPECT_NE(snapshot, updated);
+  ASSERT_EQ(1, updated->size());
+  EXPECT_EQ("neighbor1 name", updated->at(0).getSystemName());
+  EXPECT_EQ("", snapshot->at(0).getSystemName());
+
+  db.portDown(PortID(1));
+  EXPECT_EQ(0, db.getNeighborsSnapshot()->size());
+  EXPECT_EQ(1, updated->size());
+}
@@ -1,11 +1,13 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 #include "fboss/agent/lldp/LinkNeighbor.h"
+#include "fboss/agent/lldp/LinkNeighborDB.h"
 #include "fboss/agent/packet/PktUtil.h"
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 
 #include <gtest/gtest.h>
 #include <chrono>
+#include <vector>
 
 using namespace facebook::fboss;
 using folly::IOBuf;
@@ -103,6 +105,48 @@ TEST(LinkNeighbor, parseLldp) {
   EXPECT_EQ("SERVERS", info.getPortDescription());
 }
 
+TEST(LinkNeighbor, refreshSameLldp) {
+  IOBuf iob(IOBuf::WRAP_BUFFER, basicLldpPacket, sizeof(basicLldpPacket));
+  Cursor cursor(&iob);
+  cursor.skip(12);
+  uint16_t ethertype = cursor.readBE<uint16_t>();
+  auto pdu = cursor.peekBytes();
+  MacAddress srcMac("2c:54:2d:f5:89:3e");
+
+  LinkNeighborDB db;
+  // Nothing to refresh yet
+  EXPECT_FALSE(db.refresh(PortID(1), VlanID(1), srcMac, pdu));
+
+  LinkNeighbor info;
+  ASSERT_TRUE(
+      info.parseLldpPdu(PortID(1), VlanID(1), srcMac, ethertype, &cursor));
+  EXPECT_TRUE(info.isSameLldpPdu(pdu));
+  // Pretend it was learned a while ago
+  info.setTTL(seconds(120), steady_clock::now() - seconds(60));
+  db.update(info);
+
+  EXPECT_TRUE(db.refresh(PortID(1), VlanID(1), srcMac, pdu));
+  auto neighbors = db.getNeighbors();
+  ASSERT_EQ(1, neighbors.size());
+  EXPECT_GE(
+      neighbors[0].getExpirationTime(),
+      steady_clock::now() + seconds(119));
+  EXPECT_EQ("Ethernet1/23", neighbors[0].getPortId());
+
+  // Only the same neighbor sending the same PDU is refreshed
+  EXPECT_FALSE(db.refresh(PortID(2), VlanID(1), srcMac, pdu));
+  EXPECT_FALSE(db.refresh(PortID(1), VlanID(2), srcMac, pdu));
+  EXPECT_FALSE(db.refresh(
+      PortID(1), VlanID(1), MacAddress("2c:54:2d:f5:89:3f"), pdu));
+  std::vector<uint8_t> changed(pdu.begin(), pdu.end());
+  changed[changed.size() / 2] ^= 0xff;
+  EXPECT_FALSE(db.refresh(
+      PortID(1), VlanID(1), srcMac,
+      folly::ByteRange(changed.data(), changed.size())));
+  EXPECT_FALSE(db.refresh(
+      PortID(1), VlanID(1), srcMac, pdu.subpiece(0, pdu.size() / 2)));
+}
+
 const uint8_t badLldpPacket [] = {
   0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e, 0x2c, 0x54,
   0x2d, 0xf5, 0x89, 0x3e, 0x88, 0xcc, 0x02, 0x97,
@@ -16,6 +16,7 @@
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/TxPacket.h"
+#include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/ICMPHdr.h"
 #include "fboss/agent/packet/IPv6Hdr.h"
 #include "fboss/agent/packet/PktUtil.h"
@@ -24,6 +25,9 @@
 #include "fboss/agent/state/Vlan.h"
 #include "fboss/agent/state/VlanMap.h"
 
+#include <algorithm>
+#include <cstring>
+
 using folly::IPAddressV6;
 using folly::MacAddress;
 using folly::io::Cursor;
@@ -44,6 +48,16 @@ uint32_t getAdvertisementPacketBodySize(uint32_t items_count)  {
   return bodyLength;
 }
 
+const MacAddress kAllNodesMac("33:33:00:00:00:01");
+const IPAddressV6 kAllNodesIP("ff02::1");
+
+// Where the RA packets we build have their destination IP and ICMPv6
+// checksum: after the ethernet header with its vlan tag, then in the IPv6
+// and ICMPv6 headers.
+constexpr size_t kDstIPOffset = facebook::fboss::EthHdr::SIZE + 24;
+constexpr size_t kChecksumOffset =
+    facebook::fboss::EthHdr::SIZE + facebook::fboss::IPv6Hdr::SIZE + 2;
+
 template<typename F>
 void foreachAddrToAdvertise(const facebook::fboss::Interface* intf, F f) {
   for (const auto& addr : intf->getAddresses()) {
@@ -65,136 +79,162 @@ void foreachAddrToAdvertise(const facebook::fboss::Interface* intf, F f) {
 
 namespace facebook { namespace fboss {
 
-/*
- * IPv6RAImpl is the class that actually handles sending out the RA packets.
- *
- * This uses AsyncTimeout to receive timeout notifications in the SwSwitch's
- * background event thread, and send out RA packets every time the timer fires.
- */
-class IPv6RAImpl : private folly::AsyncTimeout {
- public:
-  IPv6RAImpl(SwSwitch* sw,
-             const SwitchState* state,
-             const Interface* intf);
-
-  SwSwitch* getSw() const {
-    return sw_;
-  }
-
-  static void start(IPv6RAImpl* ra);
-  static void stop(IPv6RAImpl* ra);
-
- private:
-  // Forbidden copy constructor and assignment operator
-  IPv6RAImpl(IPv6RAImpl const &) = delete;
-  IPv6RAImpl& operator=(IPv6RAImpl const &) = delete;
+constexpr std::chrono::milliseconds IPv6RAScheduler::kBatchWindow;
 
-  void timeoutExpired() noexcept override {
-    sendRouteAdvertisement();
-    scheduleTimeout(interval_);
-  }
-
-  void initPacket(const Interface* intf);
-  void sendRouteAdvertisement();
+RouteAdvertisementTemplate::RouteAdvertisementTemplate(
+    std::shared_ptr<const Interface> intf)
+    : intf_(std::move(intf)) {
+  auto totalLength = IPv6RouteAdvertiser::getPacketSize(intf_.get());
+  buf_ = IOBuf(IOBuf::CREATE, totalLength);
+  buf_.append(totalLength);
+  RWPrivateCursor cursor(&buf_);
+  IPv6RouteAdvertiser::createAdvertisementPacket(
+      intf_.get(), &cursor, kAllNodesMac, kAllNodesIP);
+}
 
-  std::chrono::milliseconds interval_;
-  folly::IOBuf buf_;
-  SwSwitch* const sw_{nullptr};
-};
+std::unique_ptr<TxPacket> RouteAdvertisementTemplate::createPacket(
+    SwSwitch* sw) const {
+  auto pkt = sw->allocatePacket(buf_.length());
+  memcpy(pkt->buf()->writableData(), buf_.data(), buf_.length());
+  return pkt;
+}
 
-IPv6RAImpl::IPv6RAImpl(
+std::unique_ptr<TxPacket> RouteAdvertisementTemplate::createPacket(
     SwSwitch* sw,
-    const SwitchState* /*state*/,
-    const Interface* intf)
-    : AsyncTimeout(sw->getBackgroundEvb()), sw_(sw) {
-  std::chrono::seconds raInterval(
-      intf->getNdpConfig().routerAdvertisementSeconds);
-  interval_ = raInterval;
-  initPacket(intf);
+    MacAddress dstMac,
+    const IPAddressV6& dstIP) const {
+  auto pkt = createPacket(sw);
+  auto* data = pkt->buf()->writableData();
+  memcpy(data, dstMac.bytes(), MacAddress::SIZE);
+
+  // Only the destination IP changes in what the checksum covers, so
+  // adjust the checksum rather than computing it over the whole RA again.
+  auto* ipData = data + kDstIPOffset;
+  auto* csumData = data + kChecksumOffset;
+  uint16_t csum = (csumData[0] << 8) | csumData[1];
+  csum = PktUtil::updateChecksum(
+      csum,
+      folly::ByteRange(kAllNodesIP.bytes(), IPAddressV6::byteCount()),
+      folly::ByteRange(dstIP.bytes(), IPAddressV6::byteCount()));
+  csumData[0] = csum >> 8;
+  csumData[1] = csum & 0xff;
+  memcpy(ipData, dstIP.bytes(), IPAddressV6::byteCount());
+  return pkt;
 }
 
-void IPv6RAImpl::start(IPv6RAImpl* ra) {
-  ra->scheduleTimeout(ra->interval_);
+IPv6RAScheduler::IPv6RAScheduler(SwSwitch* sw)
+    : AsyncTimeout(sw->getBackgroundEvb()), sw_(sw) {}
+
+void IPv6RAScheduler::destroy(IPv6RAScheduler* scheduler) {
+  scheduler->run([scheduler]() { delete scheduler; });
 }
 
-void IPv6RAImpl::stop(IPv6RAImpl* ra) {
-  /*
-   * Just before going down we send one last route
-   * advertisement to avoid RA's timing out while
-   * controller is restarted
-   */
-  ra->sendRouteAdvertisement();
-  delete ra;
+void IPv6RAScheduler::add(
+    std::shared_ptr<const RouteAdvertisementTemplate> ra) {
+  run([this, ra = std::move(ra)]() mutable {
+    auto intfID = ra->getInterface()->getID();
+    std::chrono::milliseconds interval(std::chrono::seconds(
+        ra->getInterface()->getNdpConfig().routerAdvertisementSeconds));
+    auto now = std::chrono::steady_clock::now();
+    auto it = advertisements_.find(intfID);
+    if (it == advertisements_.end()) {
+      advertisements_.emplace(
+          intfID, Advertisement{std::move(ra), interval, now + interval});
+    } else {
+      auto& adv = it->second;
+      adv.ra = std::move(ra);
+      if (adv.interval != interval) {
+        adv.interval = interval;
+        adv.nextSend = now + interval;
+      }
+    }
+    reschedule();
+  });
 }
 
-void IPv6RAImpl::initPacket(const Interface* intf) {
-  auto totalLength = IPv6RouteAdvertiser::getPacketSize(intf);
-  buf_ = IOBuf(IOBuf::CREATE, totalLength);
-  buf_.append(totalLength);
-  RWPrivateCursor cursor(&buf_);
-  IPv6RouteAdvertiser::createAdvertisementPacket(
-    intf, &cursor, MacAddress("33:33:00:00:00:01"), IPAddressV6("ff02::1"));
+void IPv6RAScheduler::remove(InterfaceID intfID) {
+  run([this, intfID]() {
+    auto it = advertisements_.find(intfID);
+    if (it == advertisements_.end()) {
+      return;
+    }
+    sw_->sendPacketSwitchedAsync(it->second.ra->createPacket(sw_));
+    advertisements_.erase(it);
+    reschedule();
+  });
 }
 
-void IPv6RAImpl::sendRouteAdvertisement() {
-  XLOG(DBG5) << "sending route advertisement:\n"
-             << PktUtil::hexDump(Cursor(&buf_));
-
-  // Allocate a new packet, and copy our data into it.
-  //
-  // Note that we unfortunately do need to perform a buffer copy here.
-  // The TxPacket is required to use DMA memory for its buffer, so we can't do
-  // a simple clone.
-  //
-  // TODO: In the future it would be nice to support allocating buf_ in a DMA
-  // buffer so that we really can just clone a reference to it here, rather
-  // than doing a copy.
-  uint32_t pktLen = buf_.length();
-  auto pkt = sw_->allocatePacket(pktLen);
-  RWPrivateCursor cursor(pkt->buf());
-  cursor.push(buf_.data(), buf_.length());
-
-  sw_->sendPacketSwitchedAsync(std::move(pkt));
+void IPv6RAScheduler::run(folly::Function<void()> fn) {
+  if (!sw_->getBackgroundEvb()->runInEventBaseThread(std::move(fn))) {
+    XLOG(ERR) << "failed to schedule IPv6 route advertisement work";
+  }
 }
 
-IPv6RouteAdvertiser::IPv6RouteAdvertiser(SwSwitch* sw,
-                                         const SwitchState* state,
-                                         const Interface* intf) {
-  adv_ = new IPv6RAImpl(sw, state, intf);
-  bool ret = sw->getBackgroundEvb()->runInEventBaseThread(
-      IPv6RAImpl::start, adv_);
-  if (!ret) {
-    delete adv_;
-    adv_ = nullptr;
-    throw FbossError("failed to start IPv6 route advertiser for interface ",
-                     intf->getID());
+void IPv6RAScheduler::timeoutExpired() noexcept {
+  auto now = std::chrono::steady_clock::now();
+  auto batchEnd = now + kBatchWindow;
+  for (auto& entry : advertisements_) {
+    auto& adv = entry.second;
+    if (adv.nextSend > batchEnd) {
+      continue;
+    }
+    auto pkt = adv.ra->createPacket(sw_);
+    XLOG(DBG5) << "sending route advertisement:\n"
+               << PktUtil::hexDump(Cursor(pkt->buf()));
+    sw_->sendPacketSwitchedAsync(std::move(pkt));
+    // Keep the cadence of the interface, unless we fell behind
+    adv.nextSend = std::max(adv.nextSend + adv.interval, now);
+  }
+  reschedule();
+}
 
+void IPv6RAScheduler::reschedule() {
+  if (advertisements_.empty()) {
+    cancelTimeout();
+    return;
   }
+  auto next = std::chrono::steady_clock::time_point::max();
+  for (const auto& entry : advertisements_) {
+    next = std::min(next, entry.second.nextSend);
+  }
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      next - std::chrono::steady_clock::now());
+  scheduleTimeout(std::max(delay, std::chrono::milliseconds(0)));
+}
+
+IPv6RouteAdvertiser::IPv6RouteAdvertiser(
+    IPv6RAScheduler* scheduler,
+    std::shared_ptr<const RouteAdvertisementTemplate> ra)
+    : scheduler_(scheduler), intfID_(ra->getInterface()->getID()) {
+  scheduler_->add(std::move(ra));
 }
 
 IPv6RouteAdvertiser::IPv6RouteAdvertiser(IPv6RouteAdvertiser&& other) noexcept
-  : adv_(other.adv_) {
-    other.adv_ = nullptr;
+  : scheduler_(other.scheduler_), intfID_(other.intfID_) {
+    other.scheduler_ = nullptr;
 }
 
 IPv6RouteAdvertiser::~IPv6RouteAdvertiser() {
-  if (!adv_) {
+  if (!scheduler_) {
     return;
   }
-  bool ret = adv_->getSw()->getBackgroundEvb()->runInEventBaseThread(
-      IPv6RAImpl::stop, adv_);
-  if (!ret) {
-    XLOG(ERR) << "failed to stop IPv6 route advertiser";
-  }
+  scheduler_->remove(intfID_);
 }
 
 IPv6RouteAdvertiser& IPv6RouteAdvertiser::operator=(
     IPv6RouteAdvertiser&& other) noexcept {
-  adv_ = other.adv_;
-  other.adv_ = nullptr;
+  scheduler_ = other.scheduler_;
+  intfID_ = other.intfID_;
+  other.scheduler_ = nullptr;
   return *this;
 }
 
+void IPv6RouteAdvertiser::update(
+    std::shared_ptr<const RouteAdvertisementTemplate> ra) {
+  CHECK_EQ(ra->getInterface()->getID(), intfID_);
+  scheduler_->add(std::move(ra));
+}
+
 /* static */ uint32_t IPv6RouteAdvertiser::getPacketSize(
     const Interface* intf) {
   uint32_t count = 0;
@@ -9,10 +9,17 @@
  */
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/AsyncTimeout.h>
 
+#include "fboss/agent/types.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+
 namespace folly {
 
 class MacAddress;
@@ -23,9 +30,41 @@ class IPAddressV6;
 namespace facebook { namespace fboss {
 
 class Interface;
-class IPv6RAImpl;
 class SwitchState;
 class SwSwitch;
+class TxPacket;
+
+/**
+ * The route advertisement of an interface, built once and copied into every
+ * RA packet sent on the interface, periodic or solicited, until the
+ * interface changes.
+ *
+ * The packets can't share the template's buffer, since a TxPacket needs DMA
+ * memory, but copying it is much cheaper than building the RA again.
+ */
+class RouteAdvertisementTemplate {
+ public:
+  explicit RouteAdvertisementTemplate(std::shared_ptr<const Interface> intf);
+
+  // The interface this is the RA of, as it was when the RA was built
+  const Interface* getInterface() const {
+    return intf_.get();
+  }
+
+  // The RA to all nodes, as sent periodically
+  std::unique_ptr<TxPacket> createPacket(SwSwitch* sw) const;
+  // The RA in response to a solicitation from dstMac and dstIP
+  std::unique_ptr<TxPacket> createPacket(
+      SwSwitch* sw,
+      folly::MacAddress dstMac,
+      const folly::IPAddressV6& dstIP) const;
+
+ private:
+  std::shared_ptr<const Interface> intf_;
+  folly::IOBuf buf_;
+};
+
+class IPv6RAScheduler;
 
 /**
  * IPv6RouteAdvertiser takes care of periodically sending out IPv6 route
@@ -37,14 +76,21 @@ class SwSwitch;
  */
 class IPv6RouteAdvertiser {
  public:
-  IPv6RouteAdvertiser(SwSwitch* sw, const SwitchState* state,
-                      const Interface* intf);
+  IPv6RouteAdvertiser(
+      IPv6RAScheduler* scheduler,
+      std::shared_ptr<const RouteAdvertisementTemplate> ra);
   ~IPv6RouteAdvertiser();
 
   // IPv6RouteAdvertiser objects are movable
   IPv6RouteAdvertiser(IPv6RouteAdvertiser&& other) noexcept;
   IPv6RouteAdvertiser& operator=(IPv6RouteAdvertiser&& other) noexcept;
 
+  /*
+   * Advertise ra, for the same interface after it changed, from now on.
+   * The RAs keep their schedule unless the interval changed.
+   */
+  void update(std::shared_ptr<const RouteAdvertisementTemplate> ra);
+
   static uint32_t getPacketSize(const Interface* intf);
   static void createAdvertisementPacket(const Interface* intf,
                                         folly::io::RWPrivateCursor* cursor,
@@ -52,16 +98,62 @@ class IPv6RouteAdvertiser {
                                         const folly::IPAddressV6& dstIP);
 
  private:
+  IPv6RAScheduler* scheduler_{nullptr};
+  InterfaceID intfID_{0};
+};
+
+/**
+ * IPv6RAScheduler sends the periodic RAs of all the interfaces from a single
+ * timer in the SwSwitch's background event thread.
+ *
+ * The RAs due within kBatchWindow of each other go out together, so the
+ * interfaces added together, e.g. by a config change, share their wakeups
+ * rather than each having a timer of its own.
+ *
+ * It is only ever accessed from the background thread, so the methods below
+ * just schedule the work there.
+ */
+class IPv6RAScheduler : private folly::AsyncTimeout {
+ public:
+  static constexpr std::chrono::milliseconds kBatchWindow{50};
+
+  explicit IPv6RAScheduler(SwSwitch* sw);
+
   /*
-   * All of the work is actually done by an IPv6RAImpl object.
-   *
-   * The separation between IPv6RouteAdvertiser and IPv6RAImpl is primarily to
-   * handle proper synchronization with the background thread when the
-   * IPv6RAImpl object is destroyed.  When the IPv6RAImpl is destroyed, the
-   * IPv6RAImpl still needs to remain around briefly until the timeout can be
-   * cancelled in the background thread.
+   * Delete the scheduler in the background thread, after the work already
+   * scheduled there.
    */
-  IPv6RAImpl* adv_{nullptr};
+  static void destroy(IPv6RAScheduler* scheduler);
+
+  SwSwitch* getSw() const {
+    return sw_;
+  }
+
+  // Start or update the RAs of an interface
+  void add(std::shared_ptr<const RouteAdvertisementTemplate> ra);
+  /*
+   * Stop the RAs of an interface. Just before, we send one last RA so that
+   * hosts don't time it out while the controller restarts.
+   */
+  void remove(InterfaceID intfID);
+
+ private:
+  struct Advertisement {
+    std::shared_ptr<const RouteAdvertisementTemplate> ra;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point nextSend;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  IPv6RAScheduler(IPv6RAScheduler const &) = delete;
+  IPv6RAScheduler& operator=(IPv6RAScheduler const &) = delete;
+
+  void timeoutExpired() noexcept override;
+  void reschedule();
+  void run(folly::Function<void()> fn);
+
+  SwSwitch* const sw_{nullptr};
+  std::map<InterfaceID, Advertisement> advertisements_;
 };
 
 }} // facebook::fboss
@@ -17,7 +17,9 @@ namespace facebook { namespace fboss {
 
 void SwSwitch::publishInitTimes(std::string /*name*/, const float& /*time*/) {}
 
-void SwSwitch::publishStats() {}
+void SwSwitch::publishStats() {
+  publishPacketCounters();
+}
 
 void SwSwitch::publishSwitchInfo(struct HwInitResult /*hwInitRet*/) {}
 
@@ -9,6 +9,8 @@
  */
 #include "fboss/agent/Utils.h"
 
+#include "fboss/agent/ThreadPlacement.h"
+
 #include <folly/system/ThreadName.h>
 
 namespace facebook {
@@ -16,6 +18,7 @@ namespace fboss {
 
 void initThread(folly::StringPiece name) {
   folly::setThreadName(name);
+  ThreadPlacement::get()->applyToCurrentThread(name);
 }
 } // namespace fboss
 } // namespace facebook
@@ -11,6 +11,8 @@
 
 #include <stdexcept>
 
+#include "fboss/agent/packet/PktUtil.h"
+
 namespace facebook { namespace fboss {
 
 using folly::IPAddressV4;
@@ -19,23 +21,23 @@ using folly::io::Cursor;
 
 ArpHdr::ArpHdr(Cursor& cursor) {
   try {
-    htype = cursor.readBE<uint16_t>();
-    ptype = cursor.readBE<uint16_t>();
-    hlen = cursor.read<uint8_t>();
-    plen = cursor.read<uint8_t>();
-    oper = cursor.readBE<uint16_t>();
-    uint8_t macAddress[6];
-    uint32_t ipAddress;
-    cursor.pull(&macAddress, 6);
+    // Ethernet/IPv4 ARP, which is all that is handled
+    uint8_t tmp[28];
+    auto buf = PktUtil::pullBytes(&cursor, tmp, sizeof(tmp));
+    htype = (static_cast<uint16_t>(buf[0]) << 8)
+          |  static_cast<uint16_t>(buf[1]);
+    ptype = (static_cast<uint16_t>(buf[2]) << 8)
+          |  static_cast<uint16_t>(buf[3]);
+    hlen = buf[4];
+    plen = buf[5];
+    oper = (static_cast<uint16_t>(buf[6]) << 8)
+         |  static_cast<uint16_t>(buf[7]);
     sha = MacAddress::fromBinary(
-      folly::ByteRange(&macAddress[0], MacAddress::SIZE));
-    cursor.pull(&ipAddress, 4);
-    spa = IPAddressV4::fromLong(ipAddress);
-    cursor.pull(&macAddress, 6);
+      folly::ByteRange(&buf[8], MacAddress::SIZE));
+    spa = IPAddressV4::fromBinary(folly::ByteRange(&buf[14], 4));
     tha = MacAddress::fromBinary(
-      folly::ByteRange(&macAddress[0], MacAddress::SIZE));
-    cursor.pull(&ipAddress, 4);
-    tpa = IPAddressV4::fromLong(ipAddress);
+      folly::ByteRange(&buf[18], MacAddress::SIZE));
+    tpa = IPAddressV4::fromBinary(folly::ByteRange(&buf[24], 4));
   } catch (const std::out_of_range& e) {
     throw HdrParseError("ARP header too small");
   }
@@ -9,6 +9,8 @@
  */
 #include "fboss/agent/packet/EthHdr.h"
 
+#include "fboss/agent/packet/PktUtil.h"
+
 #include <stdexcept>
 #include <sstream>
 
@@ -21,8 +23,8 @@ using std::stringstream;
 
 EthHdr::EthHdr(Cursor& cursor) {
   try {
-    uint8_t buf[14];
-    cursor.pull(buf, sizeof(buf));
+    uint8_t tmp[14];
+    auto buf = PktUtil::pullBytes(&cursor, tmp, sizeof(tmp));
     dstAddr = MacAddress::fromBinary(
       folly::ByteRange(&buf[0], MacAddress::SIZE));
     srcAddr = MacAddress::fromBinary(
@@ -32,7 +34,7 @@ EthHdr::EthHdr(Cursor& cursor) {
     // Look for VLAN tags.
     while (etherType == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_VLAN)
        ||  etherType == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_QINQ)) {
-      cursor.pull(buf, 4);
+      buf = PktUtil::pullBytes(&cursor, tmp, 4);
       uint32_t tag = (static_cast<uint32_t>(etherType) << 16)
                    | (static_cast<uint32_t>(buf[0]) << 8)
                    |  static_cast<uint32_t>(buf[1]);
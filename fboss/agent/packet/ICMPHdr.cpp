@@ -32,9 +32,12 @@ using folly::io::RWPrivateCursor;
 
 ICMPHdr::ICMPHdr(Cursor& cursor) {
   try {
-    type = cursor.read<uint8_t>();
-    code = cursor.read<uint8_t>();
-    csum = cursor.readBE<uint16_t>();
+    uint8_t tmp[SIZE];
+    auto buf = PktUtil::pullBytes(&cursor, tmp, sizeof(tmp));
+    type = buf[0];
+    code = buf[1];
+    csum = (static_cast<uint16_t>(buf[2]) << 8)
+         |  static_cast<uint16_t>(buf[3]);
   } catch (const std::out_of_range& e) {
     throw HdrParseError("ICMPv6 header too small");
   }
@@ -27,8 +27,9 @@ using folly::io::Appender;
 
 IPv4Hdr::IPv4Hdr(Cursor& cursor) {
   try {
-    uint8_t buf[12];
-    cursor.pull(buf, sizeof(buf));
+    // The fixed part of the header, options aside
+    uint8_t tmp[20];
+    auto buf = PktUtil::pullBytes(&cursor, tmp, sizeof(tmp));
     version = buf[0] >> 4;
     if (version != IPV4_VERSION) {
       throw HdrParseError("IPv4: version != 4");
@@ -58,10 +59,8 @@ IPv4Hdr::IPv4Hdr(Cursor& cursor) {
     csum = (static_cast<uint16_t>(buf[10]) << 8)
          |  static_cast<uint16_t>(buf[11]);
     // TODO: check the checksum
-    uint32_t srcAddrRaw = cursor.readBE<uint32_t>();
-    uint32_t dstAddrRaw = cursor.readBE<uint32_t>();
-    srcAddr = IPAddressV4::fromLongHBO(srcAddrRaw);
-    dstAddr = IPAddressV4::fromLongHBO(dstAddrRaw);
+    srcAddr = IPAddressV4::fromBinary(folly::ByteRange(&buf[12], 4));
+    dstAddr = IPAddressV4::fromBinary(folly::ByteRange(&buf[16], 4));
 
     if (UNLIKELY(ihl > 5)) {
       cursor.pull(optionBuf, (ihl - 5) * sizeof(uint32_t));
@@ -102,6 +101,14 @@ void IPv4Hdr::computeChecksum() {
   csum = PktUtil::internetChecksum(buf->data(), size());
 }
 
+void IPv4Hdr::decrementTtl() {
+  // The TTL shares its 16 bit word with the protocol
+  uint16_t oldWord = (ttl << 8) | protocol;
+  --ttl;
+  uint16_t newWord = (ttl << 8) | protocol;
+  csum = PktUtil::updateChecksum(csum, oldWord, newWord);
+}
+
 uint32_t IPv4Hdr::pseudoHdrPartialCsum() const {
   return pseudoHdrPartialCsum(length - (ihl * 4));
 }
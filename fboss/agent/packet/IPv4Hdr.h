@@ -124,6 +124,11 @@ class IPv4Hdr {
   }
 
   void computeChecksum();
+  /*
+   * Decrement the TTL, updating the checksum for it rather than computing
+   * it again. The checksum must be valid beforehand.
+   */
+  void decrementTtl();
   template<typename CursorType>
   void write(CursorType* cursor) const;
   template<typename CursorType>
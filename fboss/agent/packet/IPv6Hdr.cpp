@@ -28,8 +28,8 @@ using std::stringstream;
 
 IPv6Hdr::IPv6Hdr(Cursor& cursor) {
   try {
-    uint8_t buf[16];
-    cursor.pull(buf, 4);
+    uint8_t tmp[SIZE];
+    auto buf = PktUtil::pullBytes(&cursor, tmp, sizeof(tmp));
     version = buf[0] >> 4;
     if (version != IPV6_VERSION) {
       throw HdrParseError("IPv6: version != 6");
@@ -39,14 +39,17 @@ IPv6Hdr::IPv6Hdr(Cursor& cursor) {
     flowLabel = (static_cast<uint32_t>(buf[1] & 0x0F) << 16)
               | (static_cast<uint32_t>(buf[2]) << 8)
               |  static_cast<uint32_t>(buf[3]);
-    payloadLength = cursor.readBE<uint16_t>();
-    nextHeader = cursor.read<uint8_t>();
-    hopLimit = cursor.read<uint8_t>();
+    payloadLength = (static_cast<uint16_t>(buf[4]) << 8)
+                  |  static_cast<uint16_t>(buf[5]);
+    nextHeader = buf[6];
+    hopLimit = buf[7];
     if (hopLimit == 0) {
       throw HdrParseError("IPv6: Hop Limit == 0");
     }
-    srcAddr = PktUtil::readIPv6(&cursor);
-    dstAddr = PktUtil::readIPv6(&cursor);
+    srcAddr = IPAddressV6::fromBinary(
+        folly::ByteRange(&buf[8], IPAddressV6::byteCount()));
+    dstAddr = IPAddressV6::fromBinary(
+        folly::ByteRange(&buf[24], IPAddressV6::byteCount()));
   } catch (const std::out_of_range& e) {
     throw HdrParseError("IPv6 header too small");
   }
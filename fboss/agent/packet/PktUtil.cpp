@@ -9,6 +9,7 @@
  */
 #include "fboss/agent/packet/PktUtil.h"
 
+#include <folly/Bits.h>
 #include <folly/Format.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
@@ -16,6 +17,13 @@
 #include <folly/io/Cursor.h>
 #include "fboss/agent/FbossError.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 using folly::IPAddressV4;
 using folly::IPAddressV6;
 using folly::MacAddress;
@@ -26,20 +34,91 @@ using folly::IOBuf;
 using folly::StringPiece;
 using std::string;
 
+namespace {
+
+/*
+ * Ones' complement sum of a contiguous range, folded to 16 bits and returned
+ * in host byte order, as if the range was summed one 16 bit network order
+ * word at a time. A trailing odd byte is the most significant byte of its
+ * word.
+ *
+ * The sum is done on 32 bit words in host byte order: the ones' complement
+ * sum is byte order independent (RFC 1071 section 2), so swapping the
+ * folded result gives the network order sum. With AVX2 or SSE2 the bulk of
+ * the range is summed a vector at a time, each 32 bit word zero extended
+ * into a 64 bit lane, and the lanes are added up at the end.
+ */
+uint16_t sumContiguous(const uint8_t* data, size_t length) {
+  // Summing 32 bit words into 64 bit accumulators can't overflow for any
+  // range shorter than 2^32 words.
+  uint64_t sum = 0;
+#if defined(__AVX2__)
+  if (length >= sizeof(__m256i)) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    for (; length >= sizeof(__m256i);
+         data += sizeof(__m256i), length -= sizeof(__m256i)) {
+      auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+      acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(v, zero));
+      acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(v, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#elif defined(__SSE2__)
+  if (length >= sizeof(__m128i)) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for (; length >= sizeof(__m128i);
+         data += sizeof(__m128i), length -= sizeof(__m128i)) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+      acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+      acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum += lanes[0] + lanes[1];
+  }
+#endif
+  for (; length >= 4; data += 4, length -= 4) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    sum += word;
+  }
+  uint8_t tail[4] = {0, 0, 0, 0};
+  memcpy(tail, data, length);
+  uint32_t word;
+  memcpy(&word, tail, sizeof(word));
+  sum += word;
+
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return folly::Endian::big(static_cast<uint16_t>(sum));
+}
+
+}
+
 namespace facebook { namespace fboss {
 
 MacAddress PktUtil::readMac(Cursor* cursor) {
-  // Common case is that the MAC data is contiguous
-  if (cursor->length() >= MacAddress::SIZE) {
+  uint8_t buf[MacAddress::SIZE];
+  auto data = pullBytes(cursor, buf, MacAddress::SIZE);
+  return MacAddress::fromBinary(folly::ByteRange(data, MacAddress::SIZE));
+}
+
+const uint8_t* PktUtil::pullBytes(Cursor* cursor, uint8_t* buf, size_t len) {
+  // Common case is that the data is contiguous
+  if (cursor->length() >= len) {
     const auto* data = cursor->data();
-    cursor->skip(MacAddress::SIZE);
-    return MacAddress::fromBinary(folly::ByteRange(data, MacAddress::SIZE));
+    cursor->skip(len);
+    return data;
   }
 
-  // Copy to a temporary buffer to handle the non-contiguous case.
-  uint8_t buf[MacAddress::SIZE];
-  cursor->pull(buf, MacAddress::SIZE);
-  return MacAddress::fromBinary(folly::ByteRange(buf, MacAddress::SIZE));
+  // Copy to the temporary buffer to handle the non-contiguous case.
+  cursor->pull(buf, len);
+  return buf;
 }
 
 IPAddressV4 PktUtil::readIPv4(Cursor* cursor) {
@@ -50,17 +129,9 @@ IPAddressV4 PktUtil::readIPv4(Cursor* cursor) {
 
 IPAddressV6 PktUtil::readIPv6(Cursor* cursor) {
   enum { IPV6_LENGTH = IPAddressV6::byteCount() };
-  // Common case is that the IP address data is contiguous
-  if (cursor->length() >= IPV6_LENGTH) {
-    const auto* data = cursor->data();
-    cursor->skip(IPV6_LENGTH);
-    return IPAddressV6::fromBinary(ByteRange(data, IPV6_LENGTH));
-  }
-
-  // Copy to a temporary buffer to handle the non-contiguous case.
   uint8_t buf[IPV6_LENGTH];
-  cursor->pull(buf, IPV6_LENGTH);
-  return IPAddressV6::fromBinary(ByteRange(buf, IPV6_LENGTH));
+  auto data = pullBytes(cursor, buf, IPV6_LENGTH);
+  return IPAddressV6::fromBinary(ByteRange(data, IPV6_LENGTH));
 }
 
 uint16_t PktUtil::internetChecksum(folly::io::Cursor start, uint64_t length) {
@@ -68,8 +139,7 @@ uint16_t PktUtil::internetChecksum(folly::io::Cursor start, uint64_t length) {
 }
 
 uint16_t PktUtil::internetChecksum(const uint8_t* buffer, uint32_t size) {
-  auto buf = IOBuf(IOBuf::WRAP_BUFFER, buffer, size);
-  return finalizeChecksum(Cursor(&buf), size, 0);
+  return finalizeChecksum(sumContiguous(buffer, size));
 }
 
 uint16_t PktUtil::internetChecksum(const IOBuf* buf) {
@@ -79,18 +149,21 @@ uint16_t PktUtil::internetChecksum(const IOBuf* buf) {
 uint32_t PktUtil::partialChecksumImpl(folly::io::Cursor cursor,
                                       uint64_t length,
                                       uint32_t value) {
-  // Checksum all the pairs of bytes first
-  while  (length > 1) {
-    value += cursor.readBE<uint16_t>();
-    length -= 2;
-  }
-  if (length) {
-    // Bytes are interpreted in n/w byte order
-    // so this last octet represents the 8 MSbits
-    // of the last 16 bit number in this buffer.
-    uint16_t last = cursor.read<uint8_t>();
-    value += (last << 8);
-    --length;
+  // Sum each contiguous piece of the buffer chain in one go. A piece that
+  // starts at an odd offset from the start has its bytes on the other side
+  // of each 16 bit word, so its sum is byte swapped before being added.
+  bool oddOffset = false;
+  while (length > 0) {
+    auto bytes = cursor.peekBytes();
+    if (bytes.empty()) {
+      throw std::out_of_range("underflow");
+    }
+    auto n = std::min<uint64_t>(bytes.size(), length);
+    auto sum = sumContiguous(bytes.data(), n);
+    value += oddOffset ? folly::Endian::swap(sum) : sum;
+    oddOffset ^= (n & 1);
+    cursor.skip(n);
+    length -= n;
   }
   return value;
 }
@@ -118,6 +191,31 @@ uint16_t PktUtil::finalizeChecksum(uint32_t sum) {
   return static_cast<uint16_t>(sum);
 }
 
+uint16_t PktUtil::updateChecksum(
+    uint16_t csum,
+    uint16_t oldWord,
+    uint16_t newWord) {
+  // HC' = ~(~HC + ~m + m'), RFC 1624 equation 3
+  uint32_t sum = static_cast<uint16_t>(~csum);
+  sum += static_cast<uint16_t>(~oldWord);
+  sum += newWord;
+  return finalizeChecksum(sum);
+}
+
+uint16_t PktUtil::updateChecksum(
+    uint16_t csum,
+    ByteRange oldBytes,
+    ByteRange newBytes) {
+  CHECK_EQ(oldBytes.size(), newBytes.size());
+  CHECK((oldBytes.size() & 1) == 0);
+  uint32_t sum = static_cast<uint16_t>(~csum);
+  for (size_t i = 0; i < oldBytes.size(); i += 2) {
+    sum += static_cast<uint16_t>(~((oldBytes[i] << 8) | oldBytes[i + 1]));
+    sum += (newBytes[i] << 8) | newBytes[i + 1];
+  }
+  return finalizeChecksum(sum);
+}
+
 string PktUtil::hexDump(Cursor cursor) {
   return hexDump(cursor, cursor.totalLength());
 }
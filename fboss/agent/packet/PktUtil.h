@@ -13,6 +13,7 @@
 
 #include <folly/MacAddress.h>
 #include <folly/IPAddressV4.h>
+#include <folly/Range.h>
 #include <folly/IPAddressV6.h>
 
 namespace folly {
@@ -35,6 +36,19 @@ class PktUtil {
    */
   static folly::MacAddress readMac(folly::io::Cursor* cursor);
 
+  /**
+   * Read the next len bytes from a Cursor in one go, so that a header parser
+   * checks the length once and then decodes its fields at fixed offsets.
+   *
+   * Returns a pointer into the packet's buffer when the bytes are
+   * contiguous, the common case, and otherwise pulls them into buf, which
+   * must hold len bytes. Either way the cursor is moved past them. Throws
+   * std::out_of_range if fewer than len bytes are left.
+   */
+  static const uint8_t* pullBytes(folly::io::Cursor* cursor,
+                                  uint8_t* buf,
+                                  size_t len);
+
   /**
    * Read an IPv4 adddress from a Cursor pointing into this packet's buffer.
    *
@@ -85,6 +99,24 @@ class PktUtil {
                                    uint32_t value);
   static uint16_t finalizeChecksum(uint32_t value);
 
+  /*
+   * Update the internet checksum csum of some data, in host byte order, for
+   * a change to that data rather than computing it again (RFC 1624).
+   *
+   * The first version is for a 16 bit word, in host byte order, changing
+   * from oldWord to newWord. The second is for oldBytes, which must start
+   * at an even offset of the data and have an even length, being replaced
+   * by newBytes of the same length.
+   */
+  static uint16_t updateChecksum(
+      uint16_t csum,
+      uint16_t oldWord,
+      uint16_t newWord);
+  static uint16_t updateChecksum(
+      uint16_t csum,
+      folly::ByteRange oldBytes,
+      folly::ByteRange newBytes);
+
   /**
    * Return a string containing a human readable hex dump of the binary data.
    */
@@ -269,6 +269,20 @@ TEST(IPv4HdrTest, write_to_buffer) {
   EXPECT_TRUE(lhs == rhs);
 }
 
+TEST(IPv4HdrTest, decrement_ttl) {
+  IPv4Hdr hdr(IPV4_VERSION, 5, 0, 0, 20, 0, false, false, 0, 64,
+      static_cast<uint8_t>(IP_PROTO::IP_PROTO_UDP), 0,
+      IPAddressV4("10.0.0.15"), IPAddressV4("10.0.0.1"));
+  hdr.computeChecksum();
+  for (int i = 0; i < 63; ++i) {
+    hdr.decrementTtl();
+    auto updated = hdr.csum;
+    hdr.computeChecksum();
+    EXPECT_EQ(hdr.csum, updated) << "ttl " << int(hdr.ttl);
+  }
+  EXPECT_EQ(1, hdr.ttl);
+}
+
 TEST(IPv4HdrTest, assignment_operator) {
   uint8_t version = IPV4_VERSION;
   uint8_t ihl = 5;
@@ -118,6 +118,39 @@ TEST(PktUtilTest, ReadIPv6) {
   EXPECT_THROW(PktUtil::readIPv6(&c), std::out_of_range);
 }
 
+TEST(PktUtilTest, PullBytes) {
+  auto buf = setupBuf();
+  uint8_t tmp[16];
+
+  // Contiguous bytes are returned in place
+  Cursor c(&buf);
+  auto data = PktUtil::pullBytes(&c, tmp, 4);
+  EXPECT_EQ(buf.data(), data);
+  EXPECT_EQ(0x04, data[3]);
+  EXPECT_EQ(Cursor(&buf) + 4, c);
+
+  // Up to the end of the first buffer
+  c = Cursor(&buf) + 4;
+  data = PktUtil::pullBytes(&c, tmp, 16);
+  EXPECT_EQ(buf.data() + 4, data);
+  EXPECT_EQ(0x1a, data[15]);
+  EXPECT_EQ(Cursor(&buf) + 20, c);
+
+  // Bytes spanning two buffers are copied
+  c = Cursor(&buf) + 18;
+  data = PktUtil::pullBytes(&c, tmp, 4);
+  EXPECT_EQ(tmp, data);
+  EXPECT_EQ(0x19, data[0]);
+  EXPECT_EQ(0x1a, data[1]);
+  EXPECT_EQ(0x21, data[2]);
+  EXPECT_EQ(0x22, data[3]);
+  EXPECT_EQ(Cursor(&buf) + 22, c);
+
+  // Too few bytes left
+  c = Cursor(&buf) + 30;
+  EXPECT_THROW(PktUtil::pullBytes(&c, tmp, 16), std::out_of_range);
+}
+
 TEST(PktUtilTest, HexDump) {
   size_t length = 64;
   IOBuf buf(IOBuf::CREATE, length);
@@ -213,3 +246,111 @@ TEST(Checksum, TestKnownOdd) {
   expected = ~expected;
   EXPECT_EQ(expected, PktUtil::internetChecksum(bytes, 9));
 }
+
+TEST(Checksum, TestChained) {
+  // Checksumming a buffer split into pieces at odd and even offsets gives
+  // the same result as the contiguous buffer it was split from
+  uint8_t bytes[301];
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    bytes[i] = Random::rand32(std::numeric_limits<uint8_t>::max());
+  }
+  auto expected = PktUtil::internetChecksum(bytes, sizeof(bytes));
+
+  for (auto split : {1, 2, 3, 7, 64, 150, 299}) {
+    auto head = IOBuf::copyBuffer(bytes, split);
+    head->appendChain(IOBuf::copyBuffer(bytes + split, 1));
+    head->appendChain(
+        IOBuf::copyBuffer(bytes + split + 1, sizeof(bytes) - split - 1));
+    EXPECT_EQ(expected, PktUtil::internetChecksum(head.get()))
+        << "split at " << split;
+    EXPECT_EQ(
+        expected,
+        PktUtil::finalizeChecksum(
+            Cursor(head.get()) + 300,
+            1,
+            PktUtil::partialChecksum(Cursor(head.get()), 300)))
+        << "split at " << split;
+  }
+}
+
+TEST(Checksum, TestTooShort) {
+  auto buf = IOBuf::copyBuffer("\x01\x02\x03\x04", 4);
+  EXPECT_THROW(
+      PktUtil::internetChecksum(Cursor(buf.get()), 6), std::out_of_range);
+}
+
+namespace {
+
+// The checksum of RFC 1071 section 4.1, a 16 bit word at a time
+uint16_t referenceCsum(const uint8_t* data, size_t length) {
+  uint32_t sum = 0;
+  for (; length > 1; data += 2, length -= 2) {
+    sum += (data[0] << 8) | data[1];
+  }
+  if (length > 0) {
+    sum += data[0] << 8;
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return ~sum;
+}
+
+} // unnamed namespace
+
+TEST(Checksum, TestAllLengths) {
+  // Every length and alignment around the vector sizes, so each of the
+  // vector, word and byte loops and the transitions between them are hit
+  uint8_t bytes[300];
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    bytes[i] = Random::rand32(std::numeric_limits<uint8_t>::max());
+  }
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t length = 0; length + offset <= sizeof(bytes); ++length) {
+      EXPECT_EQ(
+          referenceCsum(bytes + offset, length),
+          PktUtil::internetChecksum(bytes + offset, length))
+          << "offset " << offset << " length " << length;
+    }
+  }
+}
+
+TEST(Checksum, TestAllOnes) {
+  // The largest possible sums, to check the carries are all folded back
+  uint8_t bytes[1500];
+  memset(bytes, 0xff, sizeof(bytes));
+  EXPECT_EQ(
+      referenceCsum(bytes, sizeof(bytes)),
+      PktUtil::internetChecksum(bytes, sizeof(bytes)));
+  EXPECT_EQ(
+      referenceCsum(bytes, sizeof(bytes) - 1),
+      PktUtil::internetChecksum(bytes, sizeof(bytes) - 1));
+}
+
+TEST(Checksum, TestUpdate) {
+  uint8_t bytes[64];
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    bytes[i] = Random::rand32(std::numeric_limits<uint8_t>::max());
+  }
+  auto csum = PktUtil::internetChecksum(bytes, sizeof(bytes));
+
+  // Change a single word
+  uint16_t oldWord = (bytes[10] << 8) | bytes[11];
+  uint16_t newWord = oldWord + 1;
+  bytes[10] = newWord >> 8;
+  bytes[11] = newWord & 0xff;
+  csum = PktUtil::updateChecksum(csum, oldWord, newWord);
+  EXPECT_EQ(PktUtil::internetChecksum(bytes, sizeof(bytes)), csum);
+
+  // And a range of them, such as an address
+  uint8_t oldBytes[16];
+  memcpy(oldBytes, bytes + 24, sizeof(oldBytes));
+  for (size_t i = 24; i < 40; ++i) {
+    bytes[i] = Random::rand32(std::numeric_limits<uint8_t>::max());
+  }
+  csum = PktUtil::updateChecksum(
+      csum,
+      folly::ByteRange(oldBytes, sizeof(oldBytes)),
+      folly::ByteRange(bytes + 24, sizeof(oldBytes)));
+  EXPECT_EQ(PktUtil::internetChecksum(bytes, sizeof(bytes)), csum);
+}
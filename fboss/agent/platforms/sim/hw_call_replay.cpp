@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Memory.h>
+#include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/hw/HwCallRecorder.h"
+#include "fboss/agent/hw/sim/HwCallReplayer.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <gflags/gflags.h>
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using std::make_unique;
+using std::shared_ptr;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+/*
+ * Replays a recording made with --hw_call_recording on a switch against a
+ * SimSwitch, and prints how long the recorded calls took on the switch next
+ * to how long SimSwitch's model says they take when replayed with the
+ * given latencies and batch window.
+ */
+
+DEFINE_string(recording, "", "The hw call recording to replay");
+DEFINE_int64(batch_window_us, 0,
+             "Replay the calls started within this many microseconds of each "
+             "other as one state update");
+DEFINE_string(config, "",
+              "The switch config to replay against. By default one vlan and "
+              "interface holding all the ports, with the subnets 10.0.0.0/16 "
+              "and 2401:db00:2110:3001::/64");
+DEFINE_int32(num_ports, 64, "The number of ports in the simulated switch");
+DEFINE_int64(per_update_latency_us, 0,
+             "Modeled latency of each hardware state update");
+DEFINE_int64(host_latency_us, 0, "Modeled latency of a host entry");
+DEFINE_int64(lpm_latency_us, 0, "Modeled latency of a route entry");
+DEFINE_int64(ecmp_latency_us, 0, "Modeled latency of an ECMP group");
+
+namespace {
+
+constexpr auto kLocalMac = "02:00:00:00:00:01";
+
+cfg::SwitchConfig makeConfig() {
+  cfg::SwitchConfig config;
+  config.ports.resize(FLAGS_num_ports);
+  config.vlanPorts.resize(FLAGS_num_ports);
+  for (int p = 0; p < FLAGS_num_ports; ++p) {
+    config.ports[p].logicalID = p + 1;
+    config.vlanPorts[p].logicalPort = p + 1;
+    config.vlanPorts[p].vlanID = 1;
+  }
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.vlans[0].intfID = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = kLocalMac;
+  config.interfaces[0].ipAddresses.resize(2);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/16";
+  config.interfaces[0].ipAddresses[1] = "2401:db00:2110:3001::1/64";
+  return config;
+}
+
+int64_t usec(std::chrono::nanoseconds time) {
+  return duration_cast<microseconds>(time).count();
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_recording.empty()) {
+    std::cerr << "--recording is required" << std::endl;
+    return 1;
+  }
+  auto records = HwCallRecorder::read(FLAGS_recording);
+
+  gflags::SetCommandLineOptionWithMode(
+      "tun_intf", "no", gflags::SET_FLAGS_DEFAULT);
+  auto platform =
+      make_unique<SimPlatform>(MacAddress(kLocalMac), FLAGS_num_ports);
+  auto simSwitch = static_cast<SimSwitch*>(platform->getHwSwitch());
+  SimSwitch::HwModel model;
+  model.perUpdateLatency = microseconds(FLAGS_per_update_latency_us);
+  model.hostLatency = microseconds(FLAGS_host_latency_us);
+  model.lpmLatency = microseconds(FLAGS_lpm_latency_us);
+  model.ecmpLatency = microseconds(FLAGS_ecmp_latency_us);
+  simSwitch->setHwModel(model);
+
+  SwSwitch sw(std::move(platform));
+  sw.init(nullptr /* No custom TunManager */);
+  sw.updateStateBlocking(
+      "apply config", [&](const shared_ptr<SwitchState>& state) {
+        if (!FLAGS_config.empty()) {
+          return applyThriftConfigFile(
+                     state, FLAGS_config, sw.getPlatform(), nullptr)
+              .first;
+        }
+        auto config = makeConfig();
+        return applyThriftConfig(state, &config, sw.getPlatform());
+      });
+  sw.initialConfigApplied(std::chrono::steady_clock::now());
+
+  std::array<uint64_t, static_cast<size_t>(HwCall::NUM_CALLS)> counts{};
+  for (const auto& record : records) {
+    if (record.call < HwCall::NUM_CALLS) {
+      ++counts[static_cast<size_t>(record.call)];
+    }
+  }
+  std::cout << records.size() << " recorded calls\n";
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (counts[i]) {
+      std::cout << "  " << std::left << std::setw(16)
+                << hwCallName(static_cast<HwCall>(i)) << std::right
+                << std::setw(12) << counts[i] << "\n";
+    }
+  }
+
+  HwCallReplayer::Options options;
+  options.batchWindow = microseconds(FLAGS_batch_window_us);
+  HwCallReplayer replayer(&sw, options);
+  auto result = replayer.replay(records);
+  auto stats = simSwitch->getStats();
+
+  std::cout << "replayed in " << result.stateUpdates << " state updates\n"
+            << "  routes added " << result.routesAdded << ", deleted "
+            << result.routesDeleted << "\n"
+            << "  hosts added " << result.hostsAdded << ", deleted "
+            << result.hostsDeleted << "\n"
+            << "  not replayed " << result.notReplayed << "\n"
+            << "recorded time " << std::setw(12) << usec(result.recordedTime)
+            << " us\n"
+            << "modeled time  " << std::setw(12) << usec(stats.modeledLatency)
+            << " us\n"
+            << "replay time   " << std::setw(12) << usec(result.replayTime)
+            << " us\n"
+            << "hw entries: " << stats.hostEntries << " host, "
+            << stats.lpmEntries << " lpm, " << stats.ecmpGroups << " ecmp, "
+            << stats.tableFullErrors << " table full errors" << std::endl;
+  return 0;
+}
@@ -37,6 +37,9 @@ class WedgeTomahawkPlatform : public WedgePlatform {
   bool v6MirrorTunnelSupported() const override {
     return false;
   }
+  bool isDynamicLoadBalancingSupported() const override {
+    return true;
+  }
 };
 
 } // namespace fboss
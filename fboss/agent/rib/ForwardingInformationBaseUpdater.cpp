@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteNextHop.h"
+#include "fboss/agent/state/SwitchState.h"
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+namespace {
+
+// The RIB has its own copies of these types, see RoutingInformationBase
+using FibNextHopEntry = facebook::fboss::RouteNextHopEntry;
+template <typename AddressT>
+using FibPrefix = facebook::fboss::RoutePrefix<AddressT>;
+template <typename AddressT>
+using FibRoute = facebook::fboss::Route<AddressT>;
+
+FibNextHopEntry toFibNextHopEntry(const RouteNextHopEntry& fwd) {
+  switch (fwd.getAction()) {
+    case RouteForwardAction::DROP:
+      return FibNextHopEntry(
+          FibNextHopEntry::Action::DROP, fwd.getAdminDistance());
+    case RouteForwardAction::TO_CPU:
+      return FibNextHopEntry(
+          FibNextHopEntry::Action::TO_CPU, fwd.getAdminDistance());
+    case RouteForwardAction::NEXTHOPS: {
+      FibNextHopEntry::NextHopSet nhops;
+      for (const auto& nhop : fwd.getNextHopSet()) {
+        nhops.emplace(facebook::fboss::ResolvedNextHop(
+            nhop.addr(), nhop.intf(), nhop.weight()));
+      }
+      return FibNextHopEntry(std::move(nhops), fwd.getAdminDistance());
+    }
+  }
+  throw FbossError(
+      "Unknown forward action ", static_cast<int>(fwd.getAction()));
+}
+
+template <typename AddressT>
+std::shared_ptr<FibRoute<AddressT>> toFibRoute(
+    const Route<AddressT>& ribRoute,
+    FibNextHopEntry fwd) {
+  FibPrefix<AddressT> prefix{ribRoute.prefix().network,
+                             ribRoute.prefix().mask};
+  auto fibRoute = std::make_shared<FibRoute<AddressT>>(
+      prefix, ribRoute.getBestEntry().first, fwd);
+  fibRoute->setResolved(std::move(fwd));
+  if (ribRoute.isConnected()) {
+    fibRoute->setConnected();
+  }
+  return fibRoute;
+}
+
+// Whether fibRoute is what toFibRoute() would make of ribRoute and fwd
+template <typename AddressT>
+bool isUpToDate(
+    const FibRoute<AddressT>& fibRoute,
+    const Route<AddressT>& ribRoute,
+    const FibNextHopEntry& fwd) {
+  return fibRoute.isConnected() == ribRoute.isConnected() &&
+      fibRoute.getForwardInfo() == fwd &&
+      fibRoute.getBestEntry().first == ribRoute.getBestEntry().first;
+}
+
+} // namespace
+
+ForwardingInformationBaseUpdater::ForwardingInformationBaseUpdater(
+    RouterID vrf,
+    const IPv4NetworkToRouteMap& v4NetworkToRoute,
+    const IPv6NetworkToRouteMap& v6NetworkToRoute)
+    : vrf_(vrf),
+      v4NetworkToRoute_(v4NetworkToRoute),
+      v6NetworkToRoute_(v6NetworkToRoute) {}
+
+std::shared_ptr<SwitchState> ForwardingInformationBaseUpdater::operator()(
+    const std::shared_ptr<SwitchState>& state) {
+  const auto& fibs = state->getFibs();
+  auto container = fibs->getNodeIf(vrf_);
+  auto newContainer = container
+      ? container
+      : std::make_shared<ForwardingInformationBaseContainer>(vrf_);
+
+  auto fibV4 = createUpdatedFib(v4NetworkToRoute_, newContainer->getFibV4());
+  auto fibV6 = createUpdatedFib(v6NetworkToRoute_, newContainer->getFibV6());
+  if (container && fibV4 == container->getFibV4() &&
+      fibV6 == container->getFibV6()) {
+    return nullptr;
+  }
+
+  if (container) {
+    newContainer = container->clone();
+  }
+  newContainer->setFib(std::move(fibV4));
+  newContainer->setFib(std::move(fibV6));
+
+  auto newFibs = fibs->clone();
+  if (container) {
+    newFibs->updateNode(newContainer);
+  } else {
+    newFibs->addNode(newContainer);
+  }
+  auto newState = state->clone();
+  newState->resetFibs(std::move(newFibs));
+  return newState;
+}
+
+template <typename AddressT>
+std::shared_ptr<ForwardingInformationBaseUpdater::FibT<AddressT>>
+ForwardingInformationBaseUpdater::createUpdatedFib(
+    const NetworkToRouteMap<AddressT>& rib,
+    const std::shared_ptr<FibT<AddressT>>& fib) {
+  // Only cloned once a route needs changing, so that an up to date FIB is
+  // shared with the new state as is
+  std::shared_ptr<FibT<AddressT>> updatedFib;
+  auto writableFib = [&]() {
+    if (!updatedFib) {
+      updatedFib = fib->clone();
+    }
+    return updatedFib.get();
+  };
+
+  for (const auto& entry : rib) {
+    const auto& ribRoute = entry.value();
+    if (!ribRoute.isResolved()) {
+      continue;
+    }
+    auto fwd = toFibNextHopEntry(ribRoute.getForwardInfo());
+    auto fibRoute = fib->exactMatch(
+        FibPrefix<AddressT>{ribRoute.prefix().network,
+                            ribRoute.prefix().mask});
+    if (!fibRoute) {
+      writableFib()->addNode(toFibRoute(ribRoute, std::move(fwd)));
+    } else if (!isUpToDate(*fibRoute, ribRoute, fwd)) {
+      writableFib()->updateNode(toFibRoute(ribRoute, std::move(fwd)));
+    }
+  }
+
+  // Drop the routes that left the RIB or are no longer resolved
+  for (const auto& fibRoute : *fib) {
+    const auto& prefix = fibRoute->prefix();
+    auto it = rib.exactMatch(prefix.network, prefix.mask);
+    if (it == rib.end() || !it->value().isResolved()) {
+      writableFib()->removeNode(fibRoute);
+    }
+  }
+  return updatedFib ? updatedFib : fib;
+}
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
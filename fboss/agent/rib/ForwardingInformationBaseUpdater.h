@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/state/ForwardingInformationBase.h"
+#include "fboss/agent/types.h"
+
+#include <memory>
+
+namespace facebook {
+namespace fboss {
+
+class SwitchState;
+
+namespace rib {
+
+/*
+ * Publishes the routes of one VRF of the RoutingInformationBase into the
+ * ForwardingInformationBaseMap of a SwitchState, for use as a StateUpdateFn.
+ *
+ * Only resolved routes make it into the FIB, and each carries just what the
+ * HwSwitch programs: the next hops it resolved to, and the client those
+ * came from. The next hops of the other clients stay in the RIB. The FIB
+ * routes that forward the same way as before are kept as they are, so the
+ * new SwitchState shares them with the old one and the StateDelta between
+ * the two only walks the routes that changed.
+ *
+ * The updater refers to the RIB's routes rather than copying them, so it
+ * must run before the RIB is next updated, e.g. with
+ * SwSwitch::updateStateBlocking() from the FibUpdateFunction.
+ */
+class ForwardingInformationBaseUpdater {
+ public:
+  ForwardingInformationBaseUpdater(
+      RouterID vrf,
+      const IPv4NetworkToRouteMap& v4NetworkToRoute,
+      const IPv6NetworkToRouteMap& v6NetworkToRoute);
+
+  // Returns nullptr if the FIB of the VRF is already up to date
+  std::shared_ptr<SwitchState> operator()(
+      const std::shared_ptr<SwitchState>& state);
+
+ private:
+  template <typename AddressT>
+  using FibT = facebook::fboss::ForwardingInformationBase<AddressT>;
+
+  // The new FIB for rib, or fib itself if it is up to date
+  template <typename AddressT>
+  static std::shared_ptr<FibT<AddressT>> createUpdatedFib(
+      const NetworkToRouteMap<AddressT>& rib,
+      const std::shared_ptr<FibT<AddressT>>& fib);
+
+  RouterID vrf_;
+  const IPv4NetworkToRouteMap& v4NetworkToRoute_;
+  const IPv6NetworkToRouteMap& v6NetworkToRoute_;
+};
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
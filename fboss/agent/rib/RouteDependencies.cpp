@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/rib/RouteDependencies.h"
+
+#include <glog/logging.h>
+
+using folly::CIDRNetwork;
+using folly::IPAddress;
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+void RouteDependencies::clear() {
+  dependents_.clear();
+  lookups_.clear();
+  unresolvedV4_.clear();
+  unresolvedV6_.clear();
+  valid_ = false;
+}
+
+std::multimap<IPAddress, CIDRNetwork>* RouteDependencies::unresolvedFor(
+    const IPAddress& addr) {
+  return addr.isV4() ? &unresolvedV4_ : &unresolvedV6_;
+}
+
+const std::multimap<IPAddress, CIDRNetwork>& RouteDependencies::unresolvedFor(
+    const IPAddress& addr) const {
+  return addr.isV4() ? unresolvedV4_ : unresolvedV6_;
+}
+
+void RouteDependencies::addLookup(
+    const CIDRNetwork& dependent,
+    const IPAddress& nexthop,
+    const folly::Optional<CIDRNetwork>& resolvedVia) {
+  lookups_.emplace(dependent, Lookup(nexthop, resolvedVia));
+  if (resolvedVia) {
+    dependents_[*resolvedVia].emplace(dependent, nexthop);
+  } else {
+    unresolvedFor(nexthop)->emplace(nexthop, dependent);
+  }
+}
+
+void RouteDependencies::removeLookups(const CIDRNetwork& dependent) {
+  auto range = lookups_.equal_range(dependent);
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto& nexthop = it->second.first;
+    const auto& resolvedVia = it->second.second;
+    if (resolvedVia) {
+      auto depIt = dependents_.find(*resolvedVia);
+      CHECK(depIt != dependents_.end());
+      depIt->second.erase(DependentLookup(dependent, nexthop));
+      if (depIt->second.empty()) {
+        dependents_.erase(depIt);
+      }
+    } else {
+      auto* unresolved = unresolvedFor(nexthop);
+      auto nhRange = unresolved->equal_range(nexthop);
+      for (auto nhIt = nhRange.first; nhIt != nhRange.second; ++nhIt) {
+        if (nhIt->second == dependent) {
+          unresolved->erase(nhIt);
+          break;
+        }
+      }
+    }
+  }
+  lookups_.erase(range.first, range.second);
+}
+
+void RouteDependencies::addDirectDependents(
+    const CIDRNetwork& prefix,
+    std::set<CIDRNetwork>* affected,
+    std::vector<CIDRNetwork>* toVisit) const {
+  auto it = dependents_.find(prefix);
+  if (it == dependents_.end()) {
+    return;
+  }
+  for (const auto& lookup : it->second) {
+    if (affected->insert(lookup.first).second) {
+      toVisit->push_back(lookup.first);
+    }
+  }
+}
+
+void RouteDependencies::addCoveredDependents(
+    const CIDRNetwork& prefix,
+    std::set<CIDRNetwork>* affected,
+    std::vector<CIDRNetwork>* toVisit) const {
+  const auto& network = prefix.first;
+  const auto mask = prefix.second;
+  auto add = [&](const CIDRNetwork& dependent) {
+    if (affected->insert(dependent).second) {
+      toVisit->push_back(dependent);
+    }
+  };
+
+  // Next hops within prefix which were resolved through a less specific
+  // prefix may now resolve through prefix instead (or stop doing so)
+  for (int len = mask - 1; len >= 0; --len) {
+    auto it = dependents_.find(CIDRNetwork(network.mask(len), len));
+    if (it == dependents_.end()) {
+      continue;
+    }
+    for (const auto& lookup : it->second) {
+      if (lookup.second.inSubnet(network, mask)) {
+        add(lookup.first);
+      }
+    }
+  }
+
+  // Likewise for next hops within prefix which did not resolve at all
+  const auto& unresolved = unresolvedFor(network);
+  for (auto it = unresolved.lower_bound(network);
+       it != unresolved.end() && it->first.inSubnet(network, mask);
+       ++it) {
+    add(it->second);
+  }
+}
+
+std::set<CIDRNetwork> RouteDependencies::getAffected(
+    const std::vector<CIDRNetwork>& changed) const {
+  std::set<CIDRNetwork> affected;
+  std::vector<CIDRNetwork> toVisit;
+  for (const auto& prefix : changed) {
+    if (affected.insert(prefix).second) {
+      toVisit.push_back(prefix);
+    }
+    // Only the changed prefixes can alter which prefix a next hop lookup
+    // matches. Routes that are affected only because their resolution may
+    // change are re-resolved in place, so only their direct dependents are
+    // affected in turn.
+    addCoveredDependents(prefix, &affected, &toVisit);
+  }
+  while (!toVisit.empty()) {
+    auto prefix = std::move(toVisit.back());
+    toVisit.pop_back();
+    addDirectDependents(prefix, &affected, &toVisit);
+  }
+  return affected;
+}
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
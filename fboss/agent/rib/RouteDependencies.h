@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+/*
+ * RouteDependencies is a reverse index of how routes were resolved by
+ * RouteUpdater. For every next hop that was looked up while resolving a
+ * route, it remembers which prefix (if any) the lookup matched.
+ *
+ * This allows RouteUpdater to only re-resolve the routes which can be affected
+ * by a set of changed prefixes, instead of the entire table:
+ *  - routes that resolved a next hop through a changed prefix
+ *  - routes that resolved a next hop through a less specific prefix, where the
+ *    next hop falls within a changed (e.g. newly added) prefix
+ *  - routes with a next hop that did not match any prefix, where the next hop
+ *    falls within a changed prefix
+ *  - transitively, routes that resolved through any of the above
+ *
+ * Prefixes of both address families are stored in the same index, since a
+ * route of one family may resolve through routes of the other.
+ */
+class RouteDependencies {
+ public:
+  RouteDependencies() = default;
+
+  /*
+   * Whether the index is known to describe the current resolution of the
+   * route table. A default constructed index is not, so the first update
+   * resolves the whole table.
+   */
+  bool isValid() const {
+    return valid_;
+  }
+  void setValid() {
+    valid_ = true;
+  }
+
+  void clear();
+
+  /*
+   * Record that resolving `dependent` looked up `nexthop`, and that the lookup
+   * matched `resolvedVia`, or no prefix if resolvedVia is none.
+   */
+  void addLookup(
+      const folly::CIDRNetwork& dependent,
+      const folly::IPAddress& nexthop,
+      const folly::Optional<folly::CIDRNetwork>& resolvedVia);
+
+  /*
+   * Forget all lookups done while resolving `dependent`, e.g. before it is
+   * re-resolved or after it is deleted.
+   */
+  void removeLookups(const folly::CIDRNetwork& dependent);
+
+  /*
+   * Compute every route whose resolution may change as a result of changes
+   * to the given prefixes. The result includes the changed prefixes
+   * themselves.
+   */
+  std::set<folly::CIDRNetwork> getAffected(
+      const std::vector<folly::CIDRNetwork>& changed) const;
+
+  size_t numLookups() const {
+    return lookups_.size();
+  }
+
+ private:
+  using Lookup =
+      std::pair<folly::IPAddress, folly::Optional<folly::CIDRNetwork>>;
+  // (dependent, next hop looked up by it)
+  using DependentLookup = std::pair<folly::CIDRNetwork, folly::IPAddress>;
+
+  void addDirectDependents(
+      const folly::CIDRNetwork& prefix,
+      std::set<folly::CIDRNetwork>* affected,
+      std::vector<folly::CIDRNetwork>* toVisit) const;
+  void addCoveredDependents(
+      const folly::CIDRNetwork& prefix,
+      std::set<folly::CIDRNetwork>* affected,
+      std::vector<folly::CIDRNetwork>* toVisit) const;
+  std::multimap<folly::IPAddress, folly::CIDRNetwork>* unresolvedFor(
+      const folly::IPAddress& addr);
+  const std::multimap<folly::IPAddress, folly::CIDRNetwork>& unresolvedFor(
+      const folly::IPAddress& addr) const;
+
+  // resolving prefix -> lookups which matched it
+  std::map<folly::CIDRNetwork, std::set<DependentLookup>> dependents_;
+  // dependent -> lookups done while resolving it
+  std::multimap<folly::CIDRNetwork, Lookup> lookups_;
+  // next hop -> dependents whose lookup of that next hop did not match
+  // anything, kept per address family so next hops within a prefix are
+  // contiguous
+  std::multimap<folly::IPAddress, folly::CIDRNetwork> unresolvedV4_;
+  std::multimap<folly::IPAddress, folly::CIDRNetwork> unresolvedV6_;
+  bool valid_{false};
+};
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
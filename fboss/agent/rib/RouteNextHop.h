@@ -23,6 +23,7 @@
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
 inline folly::StringPiece constexpr kInterface() {
   return "interface";
@@ -78,7 +79,7 @@ struct INextHop {
       nht.address = network::toBinaryAddress(addr());
       nht.weight = weight();
       if (isResolved()) {
-        nht.address.set_ifName(util::createTunIntfName(intf()));
+        nht.address.set_ifName(fboss::util::createTunIntfName(intf()));
       }
       return nht;
     }
@@ -164,5 +165,6 @@ namespace util {
 NextHop fromThrift(const NextHopThrift& nht);
 NextHop nextHopFromFollyDynamic(const folly::dynamic& nhopJson);
 } // namespace util
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
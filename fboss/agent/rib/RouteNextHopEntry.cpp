@@ -33,6 +33,7 @@ std::vector<facebook::fboss::NextHopThrift> thriftNextHopsFromAddresses(
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
 namespace util {
 
@@ -185,5 +186,6 @@ RouteNextHopEntry RouteNextHopEntry::from(
       : RouteNextHopEntry(RouteForwardAction::DROP, adminDistance);
 }
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
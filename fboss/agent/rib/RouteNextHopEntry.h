@@ -20,6 +20,7 @@
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
 class UnicastRoute;
 
@@ -124,5 +125,6 @@ RouteNextHopSet toRouteNextHopSet(std::vector<NextHopThrift> const& nhts);
 std::vector<NextHopThrift> fromRouteNextHopSet(RouteNextHopSet const& nhs);
 } // namespace util
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
@@ -11,6 +11,7 @@
 #include "RouteUpdater.h"
 
 #include <numeric>
+#include <set>
 
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
@@ -32,15 +33,33 @@ using folly::IPAddressV6;
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
 static const PrefixV6 kIPv6LinkLocalPrefix{folly::IPAddressV6("fe80::"), 64};
 static const auto kInterfaceRouteClientId =
     StdClientIds2ClientID(StdClientIds::INTERFACE_ROUTE);
 
+namespace {
+template <typename AddressT>
+CIDRNetwork toCIDRNetwork(const RoutePrefix<AddressT>& prefix) {
+  return CIDRNetwork(IPAddress(prefix.network), prefix.mask);
+}
+} // anonymous namespace
+
 RouteUpdater::RouteUpdater(
     IPv4NetworkToRouteMap* v4Routes,
-    IPv6NetworkToRouteMap* v6Routes)
-    : v4Routes_(v4Routes), v6Routes_(v6Routes) {}
+    IPv6NetworkToRouteMap* v6Routes,
+    RouteDependencies* dependencies)
+    : v4Routes_(v4Routes),
+      v6Routes_(v6Routes),
+      dependencies_(dependencies) {}
+
+template <typename AddressT>
+void RouteUpdater::prefixChanged(const Prefix<AddressT>& prefix) {
+  if (dependencies_) {
+    changedPrefixes_.push_back(toCIDRNetwork(prefix));
+  }
+}
 
 template <typename AddressT>
 void RouteUpdater::addRouteImpl(
@@ -57,12 +76,14 @@ void RouteUpdater::addRouteImpl(
     }
 
     route->update(clientID, entry);
+    prefixChanged(prefix);
     return;
   }
 
   CHECK(it == routes->end());
   routes->insert(
       prefix.network, prefix.mask, Route<AddressT>(prefix, clientID, entry));
+  prefixChanged(prefix);
 }
 
 void RouteUpdater::addRoute(
@@ -130,6 +151,7 @@ void RouteUpdater::delRouteImpl(
 
   Route<AddressT>& route = it->value();
   route.delEntryForClient(clientID);
+  prefixChanged(prefix);
 
   XLOG(DBG3) << "Deleted next-hops for prefix " << prefix.str()
              << "from client " << clientID;
@@ -162,7 +184,11 @@ void RouteUpdater::removeAllRoutesFromClientImpl(
 
   for (auto it : *routes) {
     Route<AddressT>& route = it->value();
+    if (!route.getEntryForClient(clientID)) {
+      continue;
+    }
     route.delEntryForClient(clientID);
+    prefixChanged(route.prefix());
     if (route.hasNoEntry()) {
       // The nexthops we removed was the only one.  Delete the route.
       toDelete.push_back(it);
@@ -370,6 +396,7 @@ RouteNextHopSet mergeForwardInfos(
 
 template <typename AddressT>
 void RouteUpdater::getFwdInfoFromNhop(
+    const CIDRNetwork& dependent,
     NetworkToRouteMap<AddressT>* routes,
     const AddressT& nh,
     bool* hasToCpu,
@@ -378,12 +405,19 @@ void RouteUpdater::getFwdInfoFromNhop(
   auto it = routes->longestMatch(nh, nh.bitCount());
   if (it == routes->end()) {
     XLOG(DBG3) << "Could not find subnet for next-hop:  " << nh;
+    if (dependencies_) {
+      dependencies_->addLookup(dependent, IPAddress(nh), folly::none);
+    }
     // Unresolvable next hop
     return;
   }
 
   Route<AddressT>* route = &(it->value());
   CHECK(route);
+  if (dependencies_) {
+    dependencies_->addLookup(
+        dependent, IPAddress(nh), toCIDRNetwork(route->prefix()));
+  }
 
   if (route->needResolve()) {
     resolveOne(route);
@@ -419,6 +453,7 @@ void RouteUpdater::resolveOne(Route<AddressT>* route) {
   bool hasToCpu{false};
   bool hasDrop{false};
   RouteNextHopSet fwd;
+  const auto prefix = toCIDRNetwork(route->prefix());
 
   auto bestPair = route->getBestEntry();
   const auto clientId = bestPair.first;
@@ -449,11 +484,21 @@ void RouteUpdater::resolveOne(Route<AddressT>* route) {
 
       if (addr.isV4()) {
         getFwdInfoFromNhop(
-            v4Routes_, nh.addr().asV4(), &hasToCpu, &hasDrop, nhToFwds[nh]);
+            prefix,
+            v4Routes_,
+            nh.addr().asV4(),
+            &hasToCpu,
+            &hasDrop,
+            nhToFwds[nh]);
       } else {
         CHECK(addr.isV6());
         getFwdInfoFromNhop(
-            v6Routes_, nh.addr().asV6(), &hasToCpu, &hasDrop, nhToFwds[nh]);
+            prefix,
+            v6Routes_,
+            nh.addr().asV6(),
+            &hasToCpu,
+            &hasDrop,
+            nhToFwds[nh]);
       }
     }
 
@@ -499,10 +544,73 @@ void RouteUpdater::updateDoneImpl(NetworkToRouteMap<AddressT>* routes) {
   resolve(routes);
 }
 
+template <typename AddressT>
+Route<AddressT>* RouteUpdater::clearForwardIfExists(
+    NetworkToRouteMap<AddressT>* routes,
+    const AddressT& network,
+    uint8_t mask) {
+  auto it = routes->exactMatch(network, mask);
+  if (it == routes->end()) {
+    return nullptr;
+  }
+  Route<AddressT>* route = &(it->value());
+  route->clearForward();
+  return route;
+}
+
+void RouteUpdater::incrementalUpdateDone() {
+  auto affected = dependencies_->getAffected(changedPrefixes_);
+  XLOG(DBG3) << "Re-resolving " << affected.size() << " routes affected by "
+             << changedPrefixes_.size() << " changed prefixes";
+
+  // First invalidate every affected route (including deleted ones, which no
+  // longer depend on anything), so that none of them is used to resolve
+  // another one before it has been re-resolved itself.
+  std::vector<Route<IPAddressV4>*> v4ToResolve;
+  std::vector<Route<IPAddressV6>*> v6ToResolve;
+  for (const auto& prefix : affected) {
+    dependencies_->removeLookups(prefix);
+    if (prefix.first.isV4()) {
+      if (auto route = clearForwardIfExists(
+              v4Routes_, prefix.first.asV4(), prefix.second)) {
+        v4ToResolve.push_back(route);
+      }
+    } else {
+      if (auto route = clearForwardIfExists(
+              v6Routes_, prefix.first.asV6(), prefix.second)) {
+        v6ToResolve.push_back(route);
+      }
+    }
+  }
+
+  for (auto route : v4ToResolve) {
+    if (route->needResolve()) {
+      resolveOne(route);
+    }
+  }
+  for (auto route : v6ToResolve) {
+    if (route->needResolve()) {
+      resolveOne(route);
+    }
+  }
+}
+
 void RouteUpdater::updateDone() {
+  if (dependencies_ && dependencies_->isValid()) {
+    incrementalUpdateDone();
+    return;
+  }
+  if (dependencies_) {
+    // Fully resolving the table below rebuilds the index from scratch
+    dependencies_->clear();
+  }
   updateDoneImpl(v4Routes_);
   updateDoneImpl(v6Routes_);
+  if (dependencies_) {
+    dependencies_->setValid();
+  }
 }
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
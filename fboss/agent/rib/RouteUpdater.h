@@ -14,14 +14,18 @@
 
 #include "fboss/agent/rib/NetworkToRouteMap.h"
 #include "fboss/agent/rib/Route.h"
+#include "fboss/agent/rib/RouteDependencies.h"
 #include "fboss/agent/rib/RouteNextHopEntry.h"
 #include "fboss/agent/rib/RouteNextHopsMulti.h"
 #include "fboss/agent/rib/RouteTypes.h"
 
 #include <folly/IPAddress.h>
 
+#include <vector>
+
 namespace facebook {
 namespace fboss {
+namespace rib {
 
 /**
  * Expected behavior of RouteUpdater::resolve():
@@ -46,12 +50,18 @@ namespace fboss {
  *    only IP nexthops will be in the final ECMP group.
  * 5. If and only if TO_CPU is the only nexthop (directly or indirectly) of
  *    a route, TO_CPU action will be only path in the resolved ECMP group.
+ *
+ * If a RouteDependencies index is passed in, updateDone() only re-resolves
+ * the routes which may be affected by the prefixes changed through this
+ * RouteUpdater, and keeps the index up to date. Otherwise, every route is
+ * re-resolved.
  */
 class RouteUpdater {
  public:
   RouteUpdater(
       IPv4NetworkToRouteMap* v4Routes,
-      IPv6NetworkToRouteMap* v6Routes);
+      IPv6NetworkToRouteMap* v6Routes,
+      RouteDependencies* dependencies = nullptr);
 
   void addRoute(
       const folly::IPAddress& network,
@@ -76,6 +86,9 @@ class RouteUpdater {
  private:
   IPv4NetworkToRouteMap* v4Routes_{nullptr};
   IPv6NetworkToRouteMap* v6Routes_{nullptr};
+  RouteDependencies* dependencies_{nullptr};
+  // Prefixes added, modified or deleted since construction
+  std::vector<folly::CIDRNetwork> changedPrefixes_;
 
   // TODO(samank): rename in original file
   template <typename AddressT>
@@ -99,6 +112,14 @@ class RouteUpdater {
       ClientID clientID);
   template <typename AddressT>
   void updateDoneImpl(NetworkToRouteMap<AddressT>* routes);
+  void incrementalUpdateDone();
+  template <typename AddressT>
+  void prefixChanged(const Prefix<AddressT>& prefix);
+  template <typename AddressT>
+  Route<AddressT>* clearForwardIfExists(
+      NetworkToRouteMap<AddressT>* routes,
+      const AddressT& network,
+      uint8_t mask);
 
   template <typename AddressT>
   void resolve(NetworkToRouteMap<AddressT>* routes);
@@ -107,6 +128,7 @@ class RouteUpdater {
 
   template <typename AddressT>
   void getFwdInfoFromNhop(
+      const folly::CIDRNetwork& dependent,
       NetworkToRouteMap<AddressT>* routes,
       const AddressT& nh,
       bool* hasToCpu,
@@ -114,5 +136,6 @@ class RouteUpdater {
       RouteNextHopSet& fwd);
 };
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
@@ -17,28 +17,45 @@
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
-void RoutingInformationBase::update(
-    RouterID routerID,
-    ClientID clientID,
-    AdminDistance adminDistanceFromClientID,
-    const std::vector<UnicastRoute>& toAdd,
-    const std::vector<IpPrefix>& toDelete,
-    bool resetClientsRoutes) {
-  auto lockedRouteTables = synchronizedRouteTables_.wlock();
+RoutingInformationBase::SynchronizedRouteTable*
+RoutingInformationBase::getOrCreateRouteTable(RouterID routerID) {
+  {
+    auto lockedRouteTables = synchronizedRouteTables_.rlock();
+    auto it = lockedRouteTables->find(routerID);
+    if (it != lockedRouteTables->end()) {
+      return it->second.get();
+    }
+  }
 
+  auto lockedRouteTables = synchronizedRouteTables_.wlock();
   auto it = lockedRouteTables->find(routerID);
   if (it == lockedRouteTables->end()) {
     // We can be more strict about admitting VRFs by taking the set of valid
     // VRFs on construction, and checking routerID belongs to that set here.
     bool inserted = false;
-    std::tie(it, inserted) = lockedRouteTables->emplace(routerID, RouteTable());
+    std::tie(it, inserted) = lockedRouteTables->emplace(
+        routerID, std::make_unique<SynchronizedRouteTable>());
     CHECK(inserted);
   }
+  return it->second.get();
+}
+
+void RoutingInformationBase::update(
+    RouterID routerID,
+    ClientID clientID,
+    AdminDistance adminDistanceFromClientID,
+    const std::vector<UnicastRoute>& toAdd,
+    const std::vector<IpPrefix>& toDelete,
+    bool resetClientsRoutes,
+    const FibUpdateFunction& fibUpdateCallback) {
+  auto lockedRouteTable = getOrCreateRouteTable(routerID)->wlock();
 
   RouteUpdater updater(
-      &(it->second.v4NetworkToRoute),
-      &(it->second.v6NetworkToRoute));
+      &(lockedRouteTable->v4NetworkToRoute),
+      &(lockedRouteTable->v6NetworkToRoute),
+      &(lockedRouteTable->dependencies));
 
   if (resetClientsRoutes) {
     updater.removeAllRoutesForClient(clientID);
@@ -63,7 +80,13 @@ void RoutingInformationBase::update(
   }
 
   updater.updateDone();
+
+  fibUpdateCallback(
+      routerID,
+      lockedRouteTable->v4NetworkToRoute,
+      lockedRouteTable->v6NetworkToRoute);
 }
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
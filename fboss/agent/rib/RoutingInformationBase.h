@@ -12,18 +12,38 @@
 #include "fboss/agent/types.h"
 
 #include <folly/Synchronized.h>
+#include <functional>
+#include <memory>
 #include <thread>
 #include <vector>
 
 #include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/RouteDependencies.h"
 
 #include "fboss/agent/if/gen-cpp2/FbossCtrl.h"
 
 namespace facebook {
 namespace fboss {
+namespace rib {
 
+/*
+ * The RIB keeps every client's routes and resolves them. It has its own
+ * Route and next hop types, in this namespace, which keep more than the
+ * HwSwitch needs: updates publish only what the routes resolved to, into
+ * the SwitchState's ForwardingInformationBaseMap, through the
+ * FibUpdateFunction (see ForwardingInformationBaseUpdater).
+ */
 class RoutingInformationBase {
  public:
+  /*
+   * Called with the routes of the VRF once an update has been applied to
+   * them, with the VRF locked. The routes are only valid during the call.
+   */
+  using FibUpdateFunction = std::function<void(
+      RouterID vrf,
+      const IPv4NetworkToRouteMap& v4NetworkToRoute,
+      const IPv6NetworkToRouteMap& v6NetworkToRoute)>;
+
   // If a UnicastRoute does not specify its admin distance, then we derive its
   // admin distance via its clientID.  This is accomplished by a mapping from
   // client IDs to admin distances provided in configuration. Unfortunately,
@@ -36,7 +56,8 @@ class RoutingInformationBase {
       AdminDistance adminDistanceFromClientID,
       const std::vector<UnicastRoute>& toAdd,
       const std::vector<IpPrefix>& toDelete,
-      bool resetClientsRoutes = false);
+      bool resetClientsRoutes,
+      const FibUpdateFunction& fibUpdateCallback);
 
  private:
   struct RouteTable {
@@ -44,19 +65,29 @@ class RoutingInformationBase {
 
     IPv4NetworkToRouteMap v4NetworkToRoute;
     IPv6NetworkToRouteMap v6NetworkToRoute;
+    RouteDependencies dependencies;
   };
 
-  // Currently, route updates to separate VRFs are made to be sequential. In the
-  // event FBOSS has to operate in a routing architecture with numerous VRFs,
-  // we can avoid a slow down by a factor of the the number of VRFs by
-  // parallelizing route updates across VRFs. This can be accomplished simply by
-  // associating the mutex implicit in folly::Synchronized with an individual
-  // RouteTable.
-  using RouterIDToRouteTable = boost::container::flat_map<RouterID, RouteTable>;
+  // Each VRF's RouteTable is protected by its own lock, so that route updates
+  // to separate VRFs (e.g. from different clients) proceed concurrently
+  // instead of serializing on a single lock over all VRFs. The outer lock only
+  // guards the set of VRFs and is held briefly, in shared mode in the common
+  // case where the VRF already exists. RouteTables are never removed, so a
+  // pointer obtained under the outer lock remains valid after releasing it.
+  //
+  // Within a VRF, v4 and v6 resolution are not run concurrently: a route of
+  // one address family may recursively resolve through routes of the other
+  // (e.g. a v4 prefix with a v6 next-hop), which mutates them.
+  using SynchronizedRouteTable = folly::Synchronized<RouteTable>;
+  using RouterIDToRouteTable = boost::container::
+      flat_map<RouterID, std::unique_ptr<SynchronizedRouteTable>>;
   using SynchronizedRouteTables = folly::Synchronized<RouterIDToRouteTable>;
 
+  SynchronizedRouteTable* getOrCreateRouteTable(RouterID routerID);
+
   SynchronizedRouteTables synchronizedRouteTables_;
 };
 
+} // namespace rib
 } // namespace fboss
 } // namespace facebook
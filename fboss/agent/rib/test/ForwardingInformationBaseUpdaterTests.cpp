@@ -0,0 +1,150 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/RouteNextHop.h"
+#include "fboss/agent/rib/RouteNextHopEntry.h"
+#include "fboss/agent/rib/RouteUpdater.h"
+#include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/IPAddress.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+// Not facebook::fboss::rib as well, whose Route and next hop types have the
+// same names as the SwitchState's
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+
+namespace {
+const ClientID kClient = ClientID(1001);
+const RouterID kVrf = RouterID(0);
+
+rib::RouteNextHopEntry makeNextHop(const std::string& ipAsString) {
+  rib::RouteNextHopSet nhops;
+  nhops.emplace(
+      rib::UnresolvedNextHop(IPAddress(ipAsString), rib::ECMP_WEIGHT));
+  return rib::RouteNextHopEntry(std::move(nhops), AdminDistance::EBGP);
+}
+
+/*
+ * A RIB with 1.1.1.1/24 and 1::1/48 on interface 1, with the FIB it
+ * published as state_
+ */
+class ForwardingInformationBaseUpdaterTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    rib::RouteUpdater updater(&v4Routes_, &v6Routes_);
+    updater.addInterfaceRoute(
+        IPAddress("1.1.1.1"), 24, IPAddress("1.1.1.1"), InterfaceID(1));
+    updater.addInterfaceRoute(
+        IPAddress("1::1"), 48, IPAddress("1::1"), InterfaceID(1));
+    updater.addRoute(
+        IPAddress("10.0.0.0"), 8, kClient, makeNextHop("1.1.1.10"));
+    // No route to the next hop, so it doesn't resolve
+    updater.addRoute(
+        IPAddress("20.0.0.0"), 8, kClient, makeNextHop("9.9.9.9"));
+    updater.updateDone();
+
+    state_ = updateFib(std::make_shared<SwitchState>());
+    ASSERT_NE(nullptr, state_);
+  }
+
+ protected:
+  std::shared_ptr<SwitchState> updateFib(
+      const std::shared_ptr<SwitchState>& state) {
+    rib::ForwardingInformationBaseUpdater updater(
+        kVrf, v4Routes_, v6Routes_);
+    auto newState = updater(state);
+    if (newState) {
+      newState->publish();
+    }
+    return newState;
+  }
+
+  std::shared_ptr<RouteV4> getFibRouteV4(
+      const std::shared_ptr<SwitchState>& state,
+      const std::string& network,
+      uint8_t mask) {
+    auto fib = state->getFibs()->getNode(kVrf)->getFibV4();
+    return fib->exactMatch(RoutePrefixV4{IPAddressV4(network), mask});
+  }
+
+  rib::IPv4NetworkToRouteMap v4Routes_;
+  rib::IPv6NetworkToRouteMap v6Routes_;
+  std::shared_ptr<SwitchState> state_;
+};
+} // namespace
+
+TEST_F(ForwardingInformationBaseUpdaterTest, publishesResolvedRoutes) {
+  auto container = state_->getFibs()->getNode(kVrf);
+  EXPECT_EQ(2, container->getFibV4()->size());
+  EXPECT_EQ(1, container->getFibV6()->size());
+
+  auto connected = getFibRouteV4(state_, "1.1.1.0", 24);
+  ASSERT_NE(nullptr, connected);
+  EXPECT_TRUE(connected->isResolved());
+  EXPECT_TRUE(connected->isConnected());
+
+  auto route = getFibRouteV4(state_, "10.0.0.0", 8);
+  ASSERT_NE(nullptr, route);
+  EXPECT_TRUE(route->isResolved());
+  EXPECT_FALSE(route->isConnected());
+  EXPECT_EQ(kClient, route->getBestEntry().first);
+  const auto& nhops = route->getForwardInfo().getNextHopSet();
+  ASSERT_EQ(1, nhops.size());
+  EXPECT_EQ(IPAddress("1.1.1.10"), nhops.begin()->addr());
+  EXPECT_EQ(InterfaceID(1), nhops.begin()->intf());
+
+  EXPECT_EQ(nullptr, getFibRouteV4(state_, "20.0.0.0", 8));
+
+  auto v6Route = container->getFibV6()->exactMatch(
+      RoutePrefixV6{IPAddressV6("1::"), 48});
+  ASSERT_NE(nullptr, v6Route);
+  EXPECT_TRUE(v6Route->isConnected());
+}
+
+TEST_F(ForwardingInformationBaseUpdaterTest, keepsUnchangedRoutes) {
+  // Nothing changed in the RIB
+  EXPECT_EQ(nullptr, updateFib(state_));
+
+  rib::RouteUpdater updater(&v4Routes_, &v6Routes_);
+  updater.addRoute(
+      IPAddress("30.0.0.0"), 8, kClient, makeNextHop("1.1.1.30"));
+  updater.updateDone();
+  auto newState = updateFib(state_);
+  ASSERT_NE(nullptr, newState);
+
+  EXPECT_NE(nullptr, getFibRouteV4(newState, "30.0.0.0", 8));
+  EXPECT_EQ(
+      getFibRouteV4(state_, "10.0.0.0", 8),
+      getFibRouteV4(newState, "10.0.0.0", 8));
+  EXPECT_EQ(
+      state_->getFibs()->getNode(kVrf)->getFibV6(),
+      newState->getFibs()->getNode(kVrf)->getFibV6());
+}
+
+TEST_F(ForwardingInformationBaseUpdaterTest, removesRoutes) {
+  rib::RouteUpdater updater(&v4Routes_, &v6Routes_);
+  updater.delRoute(IPAddress("10.0.0.0"), 8, kClient);
+  updater.updateDone();
+  auto newState = updateFib(state_);
+  ASSERT_NE(nullptr, newState);
+
+  EXPECT_EQ(nullptr, getFibRouteV4(newState, "10.0.0.0", 8));
+  EXPECT_EQ(1, newState->getFibs()->getNode(kVrf)->getFibV4()->size());
+}
@@ -21,6 +21,7 @@
 #include <vector>
 
 using namespace facebook::fboss;
+using namespace facebook::fboss::rib;
 
 namespace {
 
@@ -26,6 +26,7 @@
 
 namespace {
 using namespace facebook::fboss;
+using namespace facebook::fboss::rib;
 const ClientID kClientA = ClientID(1001);
 const ClientID kClientB = ClientID(1002);
 const ClientID kClientC = ClientID(1003);
@@ -34,6 +35,7 @@ const ClientID kClientE = ClientID(1005);
 } // namespace
 
 using namespace facebook::fboss;
+using namespace facebook::fboss::rib;
 using folly::IPAddress;
 using folly::IPAddressV4;
 using folly::IPAddressV6;
@@ -1359,7 +1361,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
       FbossError);
 
   // Convert to thrift object
-  auto nhts = util::fromRouteNextHopSet(nhs);
+  auto nhts = rib::util::fromRouteNextHopSet(nhs);
   ASSERT_EQ(4, nhts.size());
 
   auto verify = [&](const std::string& ipaddr,
@@ -1367,7 +1369,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
     auto bAddr = facebook::network::toBinaryAddress(folly::IPAddress(ipaddr));
     if (intf.hasValue()) {
       bAddr.__isset.ifName = true;
-      bAddr.ifName = util::createTunIntfName(intf.value());
+      bAddr.ifName = facebook::fboss::util::createTunIntfName(intf.value());
     }
     bool found = false;
     for (const auto& entry : nhts) {
@@ -1390,7 +1392,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
   verify("fe80::1", InterfaceID(4));
 
   // Convert back to RouteNextHopSet
-  auto newNhs = util::toRouteNextHopSet(nhts);
+  auto newNhs = rib::util::toRouteNextHopSet(nhts);
   EXPECT_EQ(nhs, newNhs);
 
   //
@@ -1405,7 +1407,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
   NextHopThrift nht;
   nht.address = addr;
   {
-    NextHop nh = util::fromThrift(nht);
+    NextHop nh = rib::util::fromThrift(nht);
     EXPECT_EQ(folly::IPAddress("10.0.0.1"), nh.addr());
     EXPECT_EQ(folly::none, nh.intfID());
   }
@@ -1415,7 +1417,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
   addr.ifName = "fboss10";
   nht.address = addr;
   {
-    NextHop nh = util::fromThrift(nht);
+    NextHop nh = rib::util::fromThrift(nht);
     EXPECT_EQ(folly::IPAddress("face::1"), nh.addr());
     EXPECT_EQ(folly::none, nh.intfID());
   }
@@ -1425,7 +1427,7 @@ TEST(RouteTypes, toFromRouteNextHops) {
   addr.ifName = "fboss10";
   nht.address = addr;
   {
-    NextHop nh = util::fromThrift(nht);
+    NextHop nh = rib::util::fromThrift(nht);
     EXPECT_EQ(folly::IPAddress("fe80::1"), nh.addr());
     EXPECT_EQ(InterfaceID(10), nh.intfID());
   }
@@ -18,8 +18,41 @@ AggregatePortMap::AggregatePortMap() {}
 
 AggregatePortMap::~AggregatePortMap() {}
 
+const AggregatePortMap::MemberIndex* AggregatePortMap::getMemberIndex() const {
+  if (!isPublished()) {
+    return nullptr;
+  }
+  auto index = std::atomic_load(&memberIndex_);
+  if (!index) {
+    auto built = std::make_shared<MemberIndex>();
+    for (const auto& aggPort : *this) {
+      for (const auto& subport : aggPort->sortedSubports()) {
+        auto id = static_cast<size_t>(subport.portID);
+        if (id >= built->size()) {
+          built->resize(id + 1);
+        }
+        // A port is a member of a single aggregate port, but keep the first
+        // one as a scan would if the config says otherwise
+        if (!(*built)[id]) {
+          (*built)[id] = aggPort;
+        }
+      }
+    }
+    std::shared_ptr<const MemberIndex> result = std::move(built);
+    // Threads racing to build it all keep the first one stored
+    if (std::atomic_compare_exchange_strong(&memberIndex_, &index, result)) {
+      index = std::move(result);
+    }
+  }
+  return index.get();
+}
+
 std::shared_ptr<AggregatePort> AggregatePortMap::getAggregatePortIf(
     PortID port) const {
+  if (auto index = getMemberIndex()) {
+    auto id = static_cast<size_t>(port);
+    return id < index->size() ? (*index)[id] : nullptr;
+  }
   for (const auto& aggPort : *this) {
     if (aggPort->isMemberPort(port)) {
       return aggPort;
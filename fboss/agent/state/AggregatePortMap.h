@@ -11,6 +11,9 @@
 
 #include "fboss/agent/state/NodeMap.h"
 
+#include <memory>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
 class AggregatePort;
@@ -34,9 +37,9 @@ class AggregatePortMap
     return getNode(id);
   }
 
-  /* This method will iterate over every member port in every aggregate port,
-   * so it is a quadratic operation. If it turns out to be a bottleneck, we can
-   * maintain an index to speed it up.
+  /* The aggregate port port is a member of, if any. This is an array lookup
+   * once the map is published, and a scan of the members of every aggregate
+   * port before.
    */
   std::shared_ptr<AggregatePort> getAggregatePortIf(PortID port) const;
 
@@ -45,9 +48,17 @@ class AggregatePortMap
   AggregatePortMap* modify(std::shared_ptr<SwitchState>* state);
 
  private:
+  // The aggregate ports indexed by member PortID
+  using MemberIndex = std::vector<std::shared_ptr<AggregatePort>>;
+
   // Inherit the constructors required for clone()
   using NodeMapT::NodeMapT;
   friend class CloneAllocator;
+
+  // Built on first use, null while the map is unpublished
+  const MemberIndex* getMemberIndex() const;
+
+  mutable std::shared_ptr<const MemberIndex> memberIndex_;
 };
 
 }} // facebook::fboss
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace facebook { namespace fboss {
+
+/*
+ * DenseIdMap is a sorted associative container with the subset of the
+ * boost::container::flat_map API used by NodeMapT, for maps keyed by small
+ * integer IDs such as PortID or VlanID that are looked up on every packet.
+ *
+ * The entries are kept in a sorted vector, exactly like a flat_map, so
+ * iteration and the copy done by NodeMapT::clone() cost the same. Next to
+ * it an index maps each ID in [first key, last key] to the position of its
+ * entry, so find() is an array lookup rather than a binary search.
+ *
+ * The index is only kept while the keys are dense enough for it to stay
+ * small next to the entries (see kDenseFactor): a map with a few far apart
+ * IDs, like VLANs 1 and 4094, falls back to binary searching the entries.
+ */
+template <typename KeyT, typename MappedT>
+class DenseIdMap {
+ public:
+  using key_type = KeyT;
+  using mapped_type = MappedT;
+  using value_type = std::pair<KeyT, MappedT>;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+ private:
+  using Entries = std::vector<value_type>;
+
+ public:
+  using iterator = typename Entries::iterator;
+  using const_iterator = typename Entries::const_iterator;
+  using reverse_iterator = typename Entries::reverse_iterator;
+  using const_reverse_iterator = typename Entries::const_reverse_iterator;
+
+  // The index covers at most kDenseFactor IDs per entry, plus kDenseSlack
+  static constexpr size_t kDenseFactor = 4;
+  static constexpr size_t kDenseSlack = 64;
+
+  DenseIdMap() {}
+
+  size_t size() const {
+    return entries_.size();
+  }
+  bool empty() const {
+    return entries_.empty();
+  }
+  void clear() {
+    entries_.clear();
+    index_.clear();
+  }
+  // Whether lookups go through the index, mainly for tests
+  bool isIndexed() const {
+    return !index_.empty();
+  }
+  // Storage of the entries and the index
+  size_t memoryUsage() const {
+    return entries_.capacity() * sizeof(value_type) +
+        index_.capacity() * sizeof(uint32_t);
+  }
+
+  const_iterator begin() const {
+    return entries_.begin();
+  }
+  const_iterator end() const {
+    return entries_.end();
+  }
+  const_iterator cbegin() const {
+    return entries_.cbegin();
+  }
+  const_iterator cend() const {
+    return entries_.cend();
+  }
+  iterator begin() {
+    return entries_.begin();
+  }
+  iterator end() {
+    return entries_.end();
+  }
+  const_reverse_iterator rbegin() const {
+    return entries_.rbegin();
+  }
+  const_reverse_iterator rend() const {
+    return entries_.rend();
+  }
+  reverse_iterator rbegin() {
+    return entries_.rbegin();
+  }
+  reverse_iterator rend() {
+    return entries_.rend();
+  }
+
+  const_iterator find(const KeyT& key) const {
+    return entries_.begin() + locate(key);
+  }
+  iterator find(const KeyT& key) {
+    return entries_.begin() + locate(key);
+  }
+  size_t count(const KeyT& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  std::pair<iterator, bool> insert(value_type value);
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  iterator erase(const_iterator it) {
+    auto pos = it - entries_.cbegin();
+    entries_.erase(entries_.begin() + pos);
+    reindex();
+    return entries_.begin() + pos;
+  }
+  size_t erase(const KeyT& key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    erase(it);
+    return 1;
+  }
+
+ private:
+  static int64_t id(const KeyT& key) {
+    return static_cast<int64_t>(key);
+  }
+
+  static bool keyLess(const value_type& entry, const KeyT& key) {
+    return entry.first < key;
+  }
+
+  // Position of the entry for key, entries_.size() if there is none
+  size_t locate(const KeyT& key) const {
+    if (!index_.empty()) {
+      auto slot = id(key) - base_;
+      if (slot < 0 || static_cast<size_t>(slot) >= index_.size() ||
+          index_[slot] == 0) {
+        return entries_.size();
+      }
+      return index_[slot] - 1;
+    }
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key, keyLess);
+    if (it == entries_.end() || key < it->first) {
+      return entries_.size();
+    }
+    return it - entries_.begin();
+  }
+
+  // Rebuild the index, or drop it if the keys are too sparse
+  void reindex();
+
+  Entries entries_;
+  // Position + 1 of the entry for each ID from base_ on, 0 for no entry
+  std::vector<uint32_t> index_;
+  int64_t base_{0};
+};
+
+template <typename KeyT, typename MappedT>
+constexpr size_t DenseIdMap<KeyT, MappedT>::kDenseFactor;
+template <typename KeyT, typename MappedT>
+constexpr size_t DenseIdMap<KeyT, MappedT>::kDenseSlack;
+
+template <typename KeyT, typename MappedT>
+std::pair<typename DenseIdMap<KeyT, MappedT>::iterator, bool>
+DenseIdMap<KeyT, MappedT>::insert(value_type value) {
+  auto it =
+      std::lower_bound(entries_.begin(), entries_.end(), value.first, keyLess);
+  if (it != entries_.end() && !(value.first < it->first)) {
+    return std::make_pair(it, false);
+  }
+  auto pos = it - entries_.begin();
+  auto appended = it == entries_.end();
+  entries_.insert(it, std::move(value));
+
+  // Maps are mostly built in key order, only extend the index for that
+  auto slot = id(entries_.back().first) - base_;
+  if (appended && !index_.empty() &&
+      static_cast<size_t>(slot) < kDenseFactor * size() + kDenseSlack) {
+    index_.resize(slot + 1, 0);
+    index_[slot] = entries_.size();
+  } else {
+    reindex();
+  }
+  return std::make_pair(entries_.begin() + pos, true);
+}
+
+template <typename KeyT, typename MappedT>
+void DenseIdMap<KeyT, MappedT>::reindex() {
+  index_.clear();
+  if (entries_.empty()) {
+    return;
+  }
+  base_ = id(entries_.front().first);
+  auto range = static_cast<size_t>(id(entries_.back().first) - base_) + 1;
+  if (range > kDenseFactor * size() + kDenseSlack) {
+    // Too sparse, binary search the entries instead
+    return;
+  }
+  index_.resize(range, 0);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    DCHECK_EQ(0, index_[id(entries_[i].first) - base_]);
+    index_[id(entries_[i].first) - base_] = i + 1;
+  }
+}
+
+}} // facebook::fboss
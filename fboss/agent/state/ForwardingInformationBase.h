@@ -10,6 +10,7 @@
 #pragma once
 
 #include "fboss/agent/state/NodeMap.h"
+#include "fboss/agent/state/PersistentFlatMap.h"
 #include "fboss/agent/state/Route.h"
 #include "fboss/agent/state/RouteTypes.h"
 
@@ -20,8 +21,13 @@ namespace facebook {
 namespace fboss {
 
 template <typename AddressT>
-using ForwardingInformationBaseTraits =
-    NodeMapTraits<RoutePrefix<AddressT>, Route<AddressT>>;
+struct ForwardingInformationBaseTraits
+    : public NodeMapTraits<RoutePrefix<AddressT>, Route<AddressT>> {
+  // See RouteTableRibNodeMapTraits
+  using NodeContainer = PersistentFlatMap<
+      RoutePrefix<AddressT>,
+      std::shared_ptr<Route<AddressT>>>;
+};
 
 template <typename AddressT>
 class ForwardingInformationBase
@@ -45,6 +45,13 @@ class ForwardingInformationBaseContainer
   const std::shared_ptr<ForwardingInformationBaseV4>& getFibV4() const;
   const std::shared_ptr<ForwardingInformationBaseV6>& getFibV6() const;
 
+  void setFib(std::shared_ptr<ForwardingInformationBaseV4> fib) {
+    writableFields()->fibV4.swap(fib);
+  }
+  void setFib(std::shared_ptr<ForwardingInformationBaseV6> fib) {
+    writableFields()->fibV6.swap(fib);
+  }
+
   static std::shared_ptr<ForwardingInformationBaseContainer> fromFollyDynamic(
       const folly::dynamic& json);
   folly::dynamic toFollyDynamic() const override;
@@ -8,10 +8,13 @@
  *
  */
 #include "fboss/agent/state/InterfaceMap.h"
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <folly/Conv.h>
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/state/NodeMap-defs.h"
+#include "fboss/lib/RadixTree.h"
 
 using std::string;
 using folly::IPAddress;
@@ -24,8 +27,91 @@ InterfaceMap::InterfaceMap() {
 InterfaceMap::~InterfaceMap() {
 }
 
+struct InterfaceMap::AddressIndex {
+  struct Router {
+    // First interface in ID order wins addresses or subnets on several
+    // interfaces, as it did with a scan of the interfaces
+    std::unordered_map<IPAddress, std::shared_ptr<Interface>> addresses;
+    network::RadixTree<folly::IPAddressV4, IntfAddrToReach> subnetsV4;
+    network::RadixTree<folly::IPAddressV6, IntfAddrToReach> subnetsV6;
+  };
+
+  explicit AddressIndex(const InterfaceMap& intfs) {
+    for (const auto& intf : intfs) {
+      auto& router = routers[intf->getRouterID()];
+      for (const auto& addr : intf->getAddresses()) {
+        router.addresses.emplace(addr.first, intf);
+        IntfAddrToReach reach(intf.get(), &addr.first, addr.second);
+        if (addr.first.isV4()) {
+          router.subnetsV4.insert(
+              addr.first.asV4().mask(addr.second), addr.second, reach);
+        } else {
+          router.subnetsV6.insert(
+              addr.first.asV6().mask(addr.second), addr.second, reach);
+        }
+      }
+    }
+  }
+
+  const Router* getRouter(RouterID router) const {
+    auto it = routers.find(router);
+    return it != routers.end() ? &it->second : nullptr;
+  }
+
+  const std::shared_ptr<Interface>* getInterface(
+      RouterID routerID, const IPAddress& ip) const {
+    auto router = getRouter(routerID);
+    if (!router) {
+      return nullptr;
+    }
+    auto it = router->addresses.find(ip);
+    return it != router->addresses.end() ? &it->second : nullptr;
+  }
+
+  IntfAddrToReach getIntfAddrToReach(
+      RouterID routerID, const IPAddress& dest) const {
+    auto router = getRouter(routerID);
+    if (router) {
+      if (dest.isV4()) {
+        auto it = router->subnetsV4.longestMatch(dest.asV4(), 32);
+        if (it != router->subnetsV4.end()) {
+          return it->value();
+        }
+      } else {
+        auto it = router->subnetsV6.longestMatch(dest.asV6(), 128);
+        if (it != router->subnetsV6.end()) {
+          return it->value();
+        }
+      }
+    }
+    return IntfAddrToReach(nullptr, nullptr, 0);
+  }
+
+  std::map<RouterID, Router> routers;
+};
+
+const InterfaceMap::AddressIndex* InterfaceMap::getAddressIndex() const {
+  if (!isPublished()) {
+    return nullptr;
+  }
+  auto index = std::atomic_load(&addressIndex_);
+  if (!index) {
+    // Threads racing to build it all keep the first one stored
+    std::shared_ptr<const AddressIndex> built =
+        std::make_shared<AddressIndex>(*this);
+    if (std::atomic_compare_exchange_strong(&addressIndex_, &index, built)) {
+      index = std::move(built);
+    }
+  }
+  return index.get();
+}
+
 std::shared_ptr<Interface>
 InterfaceMap::getInterfaceIf(RouterID router, const IPAddress& ip) const {
+  if (auto index = getAddressIndex()) {
+    auto intf = index->getInterface(router, ip);
+    return intf ? *intf : nullptr;
+  }
   for (auto itr = begin(); itr != end(); ++itr) {
     if ((*itr)->getRouterID() == router && (*itr)->hasAddress(ip)) {
       return *itr;
@@ -36,9 +122,15 @@ InterfaceMap::getInterfaceIf(RouterID router, const IPAddress& ip) const {
 
 const std::shared_ptr<Interface>&
 InterfaceMap::getInterface(RouterID router, const IPAddress& ip) const {
-  for (auto itr = begin(); itr != end(); ++itr) {
-    if ((*itr)->getRouterID() == router && (*itr)->hasAddress(ip)) {
-      return *itr;
+  if (auto index = getAddressIndex()) {
+    if (auto intf = index->getInterface(router, ip)) {
+      return *intf;
+    }
+  } else {
+    for (auto itr = begin(); itr != end(); ++itr) {
+      if ((*itr)->getRouterID() == router && (*itr)->hasAddress(ip)) {
+        return *itr;
+      }
     }
   }
   throw FbossError("No interface with ip : ", ip);
@@ -65,16 +157,23 @@ InterfaceMap::getInterfaceInVlan(VlanID vlan) const {
 
 InterfaceMap::IntfAddrToReach InterfaceMap::getIntfAddrToReach(
     RouterID router, const folly::IPAddress& dest) const {
+  if (auto index = getAddressIndex()) {
+    return index->getIntfAddrToReach(router, dest);
+  }
+  IntfAddrToReach best(nullptr, nullptr, 0);
   for (auto iter = begin(); iter != end(); iter++) {
     const auto& intf = *iter;
-    if (intf->getRouterID() == router) {
-      auto addrIter = intf->getAddressToReach(dest);
-      if (addrIter != intf->getAddresses().end()) {
-        return IntfAddrToReach(intf.get(), &addrIter->first, addrIter->second);
+    if (intf->getRouterID() != router) {
+      continue;
+    }
+    for (const auto& addr : intf->getAddresses()) {
+      if ((!best.intf || addr.second > best.mask) &&
+          dest.inSubnet(addr.first, addr.second)) {
+        best = IntfAddrToReach(intf.get(), &addr.first, addr.second);
       }
     }
   }
-  return IntfAddrToReach(nullptr, nullptr, 0);
+  return best;
 }
 
 void InterfaceMap::addInterface(const std::shared_ptr<Interface>& interface) {
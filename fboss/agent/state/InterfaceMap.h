@@ -8,6 +8,7 @@
  *
  */
 #pragma once
+#include <memory>
 #include <vector>
 #include <folly/IPAddress.h>
 #include "fboss/agent/types.h"
@@ -83,7 +84,11 @@ class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
   };
 
   /*
-   * Find an interface with its address to reach the given destination
+   * Find an interface with its address to reach the given destination,
+   * the one with the longest matching subnet if there are several.
+   *
+   * Like getInterfaceIf(router, ip) this is an index lookup, not a scan of
+   * all the interfaces, once the map is published.
    */
   IntfAddrToReach getIntfAddrToReach(
       RouterID router, const folly::IPAddress& dest) const;
@@ -113,9 +118,19 @@ class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
   }
 
  private:
+  struct AddressIndex;
+
   // Inherit the constructors required for clone()
   using NodeMapT::NodeMapT;
   friend class CloneAllocator;
+
+  /*
+   * The interfaces by address and subnet, built on first use. Null while
+   * the map is unpublished, as it can still change.
+   */
+  const AddressIndex* getAddressIndex() const;
+
+  mutable std::shared_ptr<const AddressIndex> addressIndex_;
 };
 
 }} // facebook::fboss
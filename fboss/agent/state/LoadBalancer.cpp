@@ -26,6 +26,10 @@ static constexpr folly::StringPiece kSeed{"seed"};
 static constexpr folly::StringPiece kIPv4Fields{"v4Fields"};
 static constexpr folly::StringPiece kIPv6Fields{"v6Fields"};
 static constexpr folly::StringPiece kTransportFields{"transportFields"};
+static constexpr folly::StringPiece kMode{"mode"};
+static constexpr folly::StringPiece kFlowletInactivityUsecs{
+    "flowletInactivityUsecs"};
+static constexpr folly::StringPiece kFlowletTableSize{"flowletTableSize"};
 }; // namespace
 
 namespace facebook {
@@ -82,6 +86,18 @@ LoadBalancer::TransportFieldsRange LoadBalancer::getTransportFields() const {
       getFields()->transportFields_.end());
 }
 
+cfg::LoadBalancingMode LoadBalancer::getMode() const {
+  return getFields()->mode_;
+}
+
+uint32_t LoadBalancer::getFlowletInactivityUsecs() const {
+  return getFields()->flowletInactivityUsecs_;
+}
+
+uint32_t LoadBalancer::getFlowletTableSize() const {
+  return getFields()->flowletTableSize_;
+}
+
 std::shared_ptr<LoadBalancer> LoadBalancer::fromFollyDynamic(
     const folly::dynamic& json) {
   auto id = static_cast<LoadBalancerID>(json[kLoadBalancerID].asInt());
@@ -145,13 +161,30 @@ std::shared_ptr<LoadBalancer> LoadBalancer::fromFollyDynamic(
     }
   }
 
-  return std::make_shared<LoadBalancer>(
+  auto loadBalancer = std::make_shared<LoadBalancer>(
       id,
       algorithm,
       seed,
       std::move(ipv4Fields),
       std::move(ipv6Fields),
       std::move(transportFields));
+
+  // Older agents did not serialize the mode, they only did STATIC
+  if (json.count(kMode)) {
+    auto mode = static_cast<cfg::LoadBalancingMode>(json[kMode].asInt());
+    switch (mode) {
+      case cfg::LoadBalancingMode::STATIC:
+      case cfg::LoadBalancingMode::DYNAMIC_FLOWLET:
+        // valid
+        break;
+      default:
+        throw FbossError("Invalid LoadBalancingMode ", mode);
+    }
+    loadBalancer->setMode(mode);
+    loadBalancer->setFlowlet(
+        json[kFlowletInactivityUsecs].asInt(), json[kFlowletTableSize].asInt());
+  }
+  return loadBalancer;
 }
 
 folly::dynamic LoadBalancer::toFollyDynamic() const {
@@ -181,6 +214,11 @@ folly::dynamic LoadBalancer::toFollyDynamic() const {
         static_cast<int64_t>(transportField));
   }
 
+  using ModeType = std::underlying_type<cfg::LoadBalancingMode>::type;
+  serialized[kMode] = static_cast<ModeType>(getMode());
+  serialized[kFlowletInactivityUsecs] = getFlowletInactivityUsecs();
+  serialized[kFlowletTableSize] = getFlowletTableSize();
+
   return serialized;
 }
 
@@ -222,7 +260,10 @@ bool LoadBalancer::operator==(const LoadBalancer& rhs) const {
              getTransportFields().begin(),
              getTransportFields().end(),
              rhs.getTransportFields().begin(),
-             rhs.getTransportFields().end());
+             rhs.getTransportFields().end()) &&
+      getMode() == rhs.getMode() &&
+      getFlowletInactivityUsecs() == rhs.getFlowletInactivityUsecs() &&
+      getFlowletTableSize() == rhs.getFlowletTableSize();
 }
 
 bool LoadBalancer::operator!=(const LoadBalancer& rhs) const {
@@ -50,6 +50,10 @@ struct LoadBalancerFields {
   IPv4Fields v4Fields_;
   IPv6Fields v6Fields_;
   TransportFields transportFields_;
+  cfg::LoadBalancingMode mode_{cfg::LoadBalancingMode::STATIC};
+  // Only meaningful in DYNAMIC_FLOWLET mode
+  uint32_t flowletInactivityUsecs_{0};
+  uint32_t flowletTableSize_{0};
 };
 
 /* A LoadBalancer represents a logical point in the data-path which may
@@ -107,6 +111,17 @@ class LoadBalancer : public NodeBaseT<LoadBalancer, LoadBalancerFields> {
   IPv6FieldsRange getIPv6Fields() const;
   TransportFieldsRange getTransportFields() const;
 
+  cfg::LoadBalancingMode getMode() const;
+  uint32_t getFlowletInactivityUsecs() const;
+  uint32_t getFlowletTableSize() const;
+  void setMode(cfg::LoadBalancingMode mode) {
+    writableFields()->mode_ = mode;
+  }
+  void setFlowlet(uint32_t inactivityUsecs, uint32_t tableSize) {
+    writableFields()->flowletInactivityUsecs_ = inactivityUsecs;
+    writableFields()->flowletTableSize_ = tableSize;
+  }
+
   static std::shared_ptr<LoadBalancer> fromFollyDynamic(
       const folly::dynamic& json);
   folly::dynamic toFollyDynamic() const override;
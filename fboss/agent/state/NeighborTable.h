@@ -14,6 +14,7 @@
 #include <folly/json.h>
 #include "fboss/agent/state/NeighborEntry.h"
 #include "fboss/agent/state/NodeMap.h"
+#include "fboss/agent/state/PersistentFlatMap.h"
 #include "fboss/agent/state/PortDescriptor.h"
 
 namespace {
@@ -30,6 +31,8 @@ struct NeighborTableTraits {
   typedef IPADDR KeyType;
   typedef ENTRY Node;
   typedef NodeMapNoExtraFields ExtraFields;
+  // Vlans can have thousands of neighbors, see NeighborTable below
+  using NodeContainer = PersistentFlatMap<IPADDR, std::shared_ptr<ENTRY>>;
 
   static KeyType getKey(const std::shared_ptr<Node>& entry) {
     return entry->getIP();
@@ -39,12 +42,11 @@ struct NeighborTableTraits {
 /*
  * A map of IP --> MAC for the IP addresses of other nodes on a VLAN.
  *
- * TODO: We should switch from NodeMap to PrefixMap when the new PrefixMap
- * implementation is ready.
- *
- * Any change to a NodeMap is O(N), so it is really only suitable for small
- * maps that do not change frequently.  Our new PrefixMap implementation will
- * allow us to perform cheaper copy-on-write updates.
+ * The entries are kept in a PersistentFlatMap, so cloning the table to add,
+ * update or remove a neighbor copies only the chunk of entries it is in
+ * rather than the whole table, and the rest is shared with the published
+ * table.  The changes are journalled by NodeMapT, so the VlanDelta for a
+ * neighbor update only visits the entries that changed.
  */
 template<typename IPADDR, typename ENTRY, typename SUBCLASS>
 class NeighborTable
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "NodeBase.h"
+#include "NodeMemoryAccounting.h"
 
 #include <memory>
 
@@ -31,4 +32,21 @@ void NodeBaseT<NodeT, FieldsT>::publish() {
   NodeBase::publish();
 }
 
+template<typename NodeT, typename FieldsT>
+void NodeBaseT<NodeT, FieldsT>::accountMemory(
+    NodeMemoryAccounting* acct) const {
+  if (!acct->visit(this)) {
+    return;
+  }
+  acct->add<NodeT>(
+      sizeof(NodeT) + detail::fieldsMemoryUsage(fields_, acct, 0));
+  // forEachChild() is only provided non-const, for publish(), but the
+  // callback here doesn't modify anything
+  const_cast<Fields&>(fields_).forEachChild([acct](NodeBase* child) {
+    if (child) {
+      child->accountMemory(acct);
+    }
+  });
+}
+
 }} // facebook::fboss
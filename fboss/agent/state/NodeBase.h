@@ -23,6 +23,8 @@
 
 namespace facebook { namespace fboss {
 
+class NodeMemoryAccounting;
+
 /*
  * NodeBase is the base class for all nodes in our SwitchState tree.
  *
@@ -113,6 +115,12 @@ class NodeBase {
     return nodeID_;
   }
 
+  /*
+   * Add the memory used by this node and the subtree below it to acct,
+   * skipping anything acct has already counted.
+   */
+  virtual void accountMemory(NodeMemoryAccounting* acct) const = 0;
+
  protected:
   NodeBase();
   NodeBase(NodeID id, uint32_t generation)
@@ -148,7 +156,9 @@ class NodeBase {
  *
  * Fields structures must provided a forEachChild() template method, which
  * calls the specified function on child node stored in the fields.  This is
- * used to implement publish().
+ * used to implement publish() and accountMemory().  Fields may also provide a
+ * memoryUsage(NodeMemoryAccounting*) method returning the bytes they hold
+ * outside of the node object, e.g. in a container of children.
  *
  * For an example of how to use NodeBaseT, see Vlan.h or Port.h.
  */
@@ -200,6 +210,8 @@ class NodeBaseT : public NodeBase {
 
   void publish() override;
 
+  void accountMemory(NodeMemoryAccounting* acct) const override;
+
   const Fields* getFields() const {
     return &fields_;
   }
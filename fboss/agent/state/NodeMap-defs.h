@@ -53,7 +53,7 @@ NodeMapT<MapTypeT, TraitsT>::getNodeIf(KeyType key) const {
 
 template <typename MapTypeT, typename TraitsT>
 void NodeMapT<MapTypeT, TraitsT>::addNode(const std::shared_ptr<Node>& node) {
-  auto& nodes = writableNodes();
+  auto& nodes = journalledNodes(TraitsT::getKey(node));
   auto ret = nodes.insert(std::make_pair(TraitsT::getKey(node), node));
   if (!ret.second) {
     throw FbossError("duplicate node ID ", TraitsT::getKey(node));
@@ -63,7 +63,7 @@ void NodeMapT<MapTypeT, TraitsT>::addNode(const std::shared_ptr<Node>& node) {
 template <typename MapTypeT, typename TraitsT>
 void
 NodeMapT<MapTypeT, TraitsT>::updateNode(const std::shared_ptr<Node>& node) {
-  auto& nodes = writableNodes();
+  auto& nodes = journalledNodes(TraitsT::getKey(node));
   auto it = nodes.find(TraitsT::getKey(node));
   if (it == nodes.end()) {
     throw FbossError("node ID ", TraitsT::getKey(node), " does not exist");
@@ -74,7 +74,7 @@ NodeMapT<MapTypeT, TraitsT>::updateNode(const std::shared_ptr<Node>& node) {
 template <typename MapTypeT, typename TraitsT>
 void NodeMapT<MapTypeT, TraitsT>::removeNode(
     const std::shared_ptr<Node>& node) {
-  auto& nodes = writableNodes();
+  auto& nodes = journalledNodes(TraitsT::getKey(node));
   auto it = nodes.find(TraitsT::getKey(node));
   if (it == nodes.end()) {
     throw FbossError("node ID ", TraitsT::getKey(node), " does not exist");
@@ -95,7 +95,7 @@ NodeMapT<MapTypeT, TraitsT>::removeNode(const KeyType& key) {
 template <typename MapTypeT, typename TraitsT>
 std::shared_ptr<typename TraitsT::Node>
 NodeMapT<MapTypeT, TraitsT>::removeNodeIf(const KeyType& key) {
-  auto& nodes = writableNodes();
+  auto& nodes = journalledNodes(key);
   auto it = nodes.find(key);
   if (it == nodes.end()) {
     return nullptr;
@@ -105,6 +105,33 @@ NodeMapT<MapTypeT, TraitsT>::removeNodeIf(const KeyType& key) {
   return node;
 }
 
+template <typename MapTypeT, typename TraitsT>
+std::unique_ptr<std::vector<typename TraitsT::KeyType>>
+NodeMapT<MapTypeT, TraitsT>::changedKeysSince(const MapTypeT* old) const {
+  const auto* fields = this->getFields();
+  if (!old || fields->parentJournalID == 0) {
+    return nullptr;
+  }
+  boost::container::flat_set<KeyType> keys(fields->changedKeys);
+  auto baseID = fields->parentJournalID;
+  auto entry = fields->history.get();
+  const auto oldID = old->getFields()->journalID;
+  while (baseID != oldID) {
+    if (!entry) {
+      return nullptr;
+    }
+    keys.insert(entry->keys.begin(), entry->keys.end());
+    // Once a sizable fraction of the map changed, a linear merge of the two
+    // maps is cheaper than looking up every key individually.
+    if (keys.size() > Fields::kMaxJournalKeys) {
+      return nullptr;
+    }
+    baseID = entry->baseID;
+    entry = entry->prev.get();
+  }
+  return std::make_unique<std::vector<KeyType>>(keys.begin(), keys.end());
+}
+
 template <typename MapTypeT, typename TraitsT>
 folly::dynamic NodeMapT<MapTypeT, TraitsT>::toFollyDynamic() const {
   folly::dynamic nodesJson = folly::dynamic::array;
@@ -9,13 +9,77 @@
  */
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+#include <folly/Traits.h>
 
 #include "fboss/agent/state/NodeBase.h"
 #include "fboss/agent/state/NodeMapIterator.h"
+#include "fboss/agent/state/NodeMemoryAccounting.h"
 
 namespace facebook { namespace fboss {
 
+/*
+ * Journal bookkeeping for NodeMapT.
+ *
+ * Every NodeMapT instance gets a unique journal ID.  When a map is cloned, the
+ * clone remembers the journal ID of the map it was cloned from, and records
+ * the keys passed to addNode()/updateNode()/removeNode() from then on.  The
+ * keys recorded by the previous few clones are kept as an immutable, shared
+ * history chain, so that the difference between a map and a recent ancestor
+ * (e.g. across several coalesced state updates) can be computed without
+ * walking the whole map.  See NodeMapT::changedKeysSince().
+ *
+ * Modifying the container directly via writableNodes() bypasses the journal,
+ * in which case the journal is dropped and deltas fall back to a full walk.
+ */
+inline uint64_t allocateNodeMapJournalID() {
+  static std::atomic<uint64_t> nextJournalID{1};
+  return nextJournalID.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename KeyType>
+struct NodeMapJournalEntry {
+  NodeMapJournalEntry(
+      uint64_t base,
+      std::vector<KeyType> changed,
+      std::shared_ptr<const NodeMapJournalEntry> previous,
+      uint32_t entryDepth)
+      : baseID(base),
+        keys(std::move(changed)),
+        prev(std::move(previous)),
+        depth(entryDepth) {}
+
+  // Journal ID of the map these keys are relative to
+  uint64_t baseID;
+  std::vector<KeyType> keys;
+  std::shared_ptr<const NodeMapJournalEntry> prev;
+  uint32_t depth;
+};
+
+/*
+ * NodeMapContainer selects the container type used to store the children of
+ * a NodeMapT.  This defaults to a boost::container::flat_map, but traits may
+ * pick a different container (e.g. PersistentFlatMap for very large maps) by
+ * defining a NodeContainer type.
+ */
+template <typename TraitsT, typename = void>
+struct NodeMapContainer {
+  using type = boost::container::flat_map<
+      typename TraitsT::KeyType,
+      std::shared_ptr<typename TraitsT::Node>>;
+};
+
+template <typename TraitsT>
+struct NodeMapContainer<
+    TraitsT,
+    folly::void_t<typename TraitsT::NodeContainer>> {
+  using type = typename TraitsT::NodeContainer;
+};
+
 /*
  * NodeMapFields defines the fields contained inside a NodeMapT instantiation
  */
@@ -24,13 +88,25 @@ struct NodeMapFields {
   using KeyType = typename TraitsT::KeyType;
   using Node = typename TraitsT::Node;
   using ExtraFields = typename TraitsT::ExtraFields;
-  using NodeContainer =
-      boost::container::flat_map<KeyType, std::shared_ptr<Node>>;
+  using NodeContainer = typename NodeMapContainer<TraitsT>::type;
+  using JournalEntry = NodeMapJournalEntry<KeyType>;
+
+  // Maximum number of clones remembered in the journal history
+  static constexpr uint32_t kMaxJournalDepth = 16;
+  // Stop journalling once this many keys have changed since the parent
+  static constexpr size_t kMaxJournalKeys = 4096;
 
   NodeMapFields() {}
+  NodeMapFields(const NodeMapFields& other)
+    : nodes(other.nodes),
+      extra(other.extra) {
+    inheritJournal(other);
+  }
   NodeMapFields(const NodeMapFields& other, NodeContainer nodes)
     : nodes(std::move(nodes)),
-      extra(other.extra) {}
+      extra(other.extra) {
+    inheritJournal(other);
+  }
 
   template<typename Fn>
   void forEachChild(Fn fn) {
@@ -40,8 +116,54 @@ struct NodeMapFields {
     extra.forEachChild(fn);
   }
 
+  uint64_t memoryUsage(NodeMemoryAccounting* acct) const {
+    return containerMemoryUsage(nodes, acct);
+  }
+
+  void recordChange(const KeyType& key) {
+    if (parentJournalID == 0) {
+      return;
+    }
+    changedKeys.insert(key);
+    if (changedKeys.size() > kMaxJournalKeys) {
+      dropJournal();
+    }
+  }
+
+  void dropJournal() {
+    parentJournalID = 0;
+    changedKeys.clear();
+    history.reset();
+  }
+
   NodeContainer nodes;
   ExtraFields extra;
+
+  uint64_t journalID{allocateNodeMapJournalID()};
+  // Journal ID of the map we were cloned from, 0 if not tracked
+  uint64_t parentJournalID{0};
+  boost::container::flat_set<KeyType> changedKeys;
+  std::shared_ptr<const JournalEntry> history;
+
+ private:
+  void inheritJournal(const NodeMapFields& other) {
+    parentJournalID = other.journalID;
+    if (other.parentJournalID == 0) {
+      return;
+    }
+    auto prev = other.history;
+    uint32_t depth = prev ? prev->depth + 1 : 1;
+    if (depth > kMaxJournalDepth) {
+      prev.reset();
+      depth = 1;
+    }
+    history = std::make_shared<JournalEntry>(
+        other.parentJournalID,
+        std::vector<KeyType>(
+            other.changedKeys.begin(), other.changedKeys.end()),
+        std::move(prev),
+        depth);
+  }
 };
 
 struct NodeMapNoExtraFields {
@@ -100,8 +222,15 @@ class NodeMapT : public NodeBaseT<MapTypeT,
   const NodeContainer& getAllNodes() const {
     return this->getFields()->nodes;
   }
+  /*
+   * Direct access to the node container.  Changes made this way are not
+   * journalled, so this invalidates the change journal of this map; prefer
+   * addNode()/updateNode()/removeNode() on hot paths.
+   */
   NodeContainer& writableNodes() {
-    return this->writableFields()->nodes;
+    auto fields = this->writableFields();
+    fields->dropJournal();
+    return fields->nodes;
   }
 
   const ExtraFields& getExtraFields() const {
@@ -136,6 +265,16 @@ class NodeMapT : public NodeBaseT<MapTypeT,
   std::shared_ptr<Node> removeNode(const KeyType& key);
   std::shared_ptr<Node> removeNodeIf(const KeyType& key);
 
+  /*
+   * Return the sorted set of keys that may differ between this map and
+   * "old", using the change journal maintained by clone() and the modify
+   * functions above.  Returns nullptr if "old" is not a recent ancestor of
+   * this map, or if the journal was dropped; callers must then fall back to
+   * comparing the maps entry by entry.
+   */
+  std::unique_ptr<std::vector<KeyType>> changedKeysSince(
+      const MapTypeT* old) const;
+
   /*
    * Serialize to folly::dynamic
    */
@@ -158,6 +297,12 @@ class NodeMapT : public NodeBaseT<MapTypeT,
   static constexpr char kEntries[] = "entries";
 
  private:
+  NodeContainer& journalledNodes(const KeyType& key) {
+    auto fields = this->writableFields();
+    fields->recordChange(key);
+    return fields->nodes;
+  }
+
   // Inherit the constructor required for clone()
   using NodeBaseT<MapTypeT, NodeMapFields<TraitsT>>::NodeBaseT;
   friend class CloneAllocator;
@@ -39,6 +39,22 @@ NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::Iterator(
   updateValue();
 }
 
+template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
+NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::Iterator(
+    const MapType* oldMap,
+    const MapType* newMap,
+    const KeyList* keys,
+    typename KeyList::const_iterator keyIt)
+  : oldIt_(oldMap->end()),
+    newIt_(newMap->end()),
+    oldMap_(oldMap),
+    newMap_(newMap),
+    keys_(keys),
+    keyIt_(keyIt),
+    value_(nullNode_, nullNode_) {
+  skipUnchangedKeys();
+}
+
 template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
 NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::Iterator()
   : oldIt_(),
@@ -73,8 +89,30 @@ void NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::updateValue() {
   }
 }
 
+template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
+void NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::skipUnchangedKeys() {
+  // A journalled key may have been modified and then restored, or added and
+  // then removed again, so skip keys whose nodes are identical on both sides.
+  while (keyIt_ != keys_->end()) {
+    auto oldNode = oldMap_->getNodeIf(*keyIt_);
+    auto newNode = newMap_->getNodeIf(*keyIt_);
+    if (oldNode != newNode) {
+      value_.reset(oldNode, newNode);
+      return;
+    }
+    ++keyIt_;
+  }
+  value_.reset(nullNode_, nullNode_);
+}
+
 template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
 void NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::advance() {
+  if (keys_) {
+    CHECK(keyIt_ != keys_->end());
+    ++keyIt_;
+    skipUnchangedKeys();
+    return;
+  }
   // If we have already hit the end of one side, advance the other.
   // We are immediately done after this.
   if (oldIt_ == oldMap_->end()) {
@@ -13,6 +13,7 @@
 #include <memory>
 #include <type_traits>
 #include <cstddef>
+#include <vector>
 
 #include <folly/functional/ApplyTuple.h>
 
@@ -64,11 +65,16 @@ class NodeMapDelta {
   using MapPointerType = typename MAPPOINTERTRAITS::MapPointerType;
   using RawConstPointerType = typename MAPPOINTERTRAITS::RawConstPointerType;
   using Node = typename MAP::Node;
+  using KeyType = typename MAP::KeyType;
   class Iterator;
 
   NodeMapDelta(MapPointerType&& oldMap, MapPointerType&& newMap)
     : old_(std::move(oldMap)),
-      new_(std::move(newMap)) {}
+      new_(std::move(newMap)) {
+    if (getOld() && getNew() && getOld() != getNew()) {
+      changedKeys_ = getNew()->changedKeysSince(getOld());
+    }
+  }
 
   RawConstPointerType getOld() const {
     return MAPPOINTERTRAITS::getRawPointer(old_);
@@ -87,6 +93,15 @@ class NodeMapDelta {
    */
   Iterator end() const;
 
+  /*
+   * Returns true if the change journal of the new map covered the old map,
+   * so iteration only visits the keys that were actually modified instead of
+   * walking both maps.
+   */
+  bool isJournalled() const {
+    return changedKeys_ != nullptr;
+  }
+
  private:
   /*
    * NodeMapDelta is used by StateDelta.  StateDelta holds a shared_ptr to
@@ -100,6 +115,8 @@ class NodeMapDelta {
    */
   MapPointerType old_;
   MapPointerType new_;
+  // Keys that may have changed between old_ and new_, if known
+  std::shared_ptr<const std::vector<KeyType>> changedKeys_;
 };
 
 template<typename NODE>
@@ -151,10 +168,21 @@ class NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator {
   using pointer = VALUE*;
   using reference = VALUE&;
 
+  using KeyType = typename MAP::KeyType;
+  using KeyList = std::vector<KeyType>;
+
   Iterator(const MapType* oldMap,
            typename MapType::Iterator oldIt,
            const MapType* newMap,
            typename MapType::Iterator newIt);
+  /*
+   * Iterate only over the specified sorted keys, looking each one up in the
+   * old and new maps.
+   */
+  Iterator(const MapType* oldMap,
+           const MapType* newMap,
+           const KeyList* keys,
+           typename KeyList::const_iterator keyIt);
   Iterator();
 
   const value_type& operator*() const {
@@ -175,6 +203,9 @@ class NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator {
   }
 
   bool operator==(const Iterator& other) const {
+    if (keys_) {
+      return keyIt_ == other.keyIt_;
+    }
     return oldIt_ == other.oldIt_ && newIt_ == other.newIt_;
   }
   bool operator!=(const Iterator& other) const {
@@ -187,11 +218,14 @@ class NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator {
 
   void advance();
   void updateValue();
+  void skipUnchangedKeys();
 
   InnerIter oldIt_{nullptr};
   InnerIter newIt_{nullptr};
   const MapType* oldMap_{nullptr};
   const MapType* newMap_{nullptr};
+  const KeyList* keys_{nullptr};
+  typename KeyList::const_iterator keyIt_;
   VALUE value_;
 
   static std::shared_ptr<Node> nullNode_;
@@ -203,6 +237,10 @@ NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::begin() const {
   if (old_ == new_) {
     return end();
   }
+  if (changedKeys_) {
+    return Iterator(
+        getOld(), getNew(), changedKeys_.get(), changedKeys_->begin());
+  }
   // To support deltas where the old node is null (to represent newly created
   // nodes), point the old side of the iterator at the new node, but start it
   // at the end of the map.
@@ -219,6 +257,10 @@ NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::begin() const {
 template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
 typename NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator
 NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::end() const {
+  if (changedKeys_) {
+    return Iterator(
+        getOld(), getNew(), changedKeys_.get(), changedKeys_->end());
+  }
   if (!old_) {
     return Iterator(getNew(), new_->end(), getNew(), new_->end());
   }
@@ -0,0 +1,23 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/NodeMemoryAccounting.h"
+
+namespace facebook { namespace fboss {
+
+std::string NodeMemoryAccounting::stripNamespace(std::string name) {
+  static const std::string kNamespace = "facebook::fboss::";
+  size_t pos;
+  while ((pos = name.find(kNamespace)) != std::string::npos) {
+    name.erase(pos, kNamespace.size());
+  }
+  return name;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/state/DenseIdMap.h"
+#include "fboss/agent/state/PersistentFlatMap.h"
+
+#include <boost/container/flat_map.hpp>
+#include <folly/Demangle.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_set>
+
+namespace facebook { namespace fboss {
+
+/*
+ * NodeMemoryAccounting adds up the memory held by SwitchState nodes, by node
+ * type, as found by NodeBase::accountMemory().
+ *
+ * Nodes and container chunks are shared between successive SwitchStates
+ * (and between the route maps and the RIB radix trees), so the accounting
+ * remembers every object it has counted and counts each one only once. To
+ * account for several states together, e.g. the applied and the desired
+ * state, walk all of them with the same NodeMemoryAccounting.
+ *
+ * The numbers are estimates: they cover the node objects themselves and the
+ * storage of the containers holding their children, not heap memory owned by
+ * individual fields (strings, small vectors, ...).
+ */
+class NodeMemoryAccounting {
+ public:
+  struct Usage {
+    uint64_t count{0};
+    uint64_t bytes{0};
+  };
+  using UsageMap = std::map<std::string, Usage>;
+
+  /*
+   * Record that obj is being accounted for. Returns false if it already was,
+   * in which case it must not be counted again.
+   */
+  bool visit(const void* obj) {
+    return seen_.insert(obj).second;
+  }
+
+  void add(const std::string& type, uint64_t bytes) {
+    auto& usage = usage_[type];
+    ++usage.count;
+    usage.bytes += bytes;
+    totalBytes_ += bytes;
+  }
+
+  template <typename T>
+  void add(uint64_t bytes) {
+    add(typeName<T>(), bytes);
+  }
+
+  const UsageMap& getUsage() const {
+    return usage_;
+  }
+  uint64_t totalBytes() const {
+    return totalBytes_;
+  }
+
+  // T's name without the facebook::fboss:: qualification, e.g. "PortMap"
+  template <typename T>
+  static const std::string& typeName() {
+    static const std::string name = stripNamespace(
+        folly::demangle(typeid(T)).toStdString());
+    return name;
+  }
+
+ private:
+  static std::string stripNamespace(std::string name);
+
+  std::unordered_set<const void*> seen_;
+  UsageMap usage_;
+  uint64_t totalBytes_{0};
+};
+
+/*
+ * Storage used by the container holding the children of a NodeMap, beyond
+ * the NodeMap object itself.
+ */
+template <typename ContainerT>
+uint64_t containerMemoryUsage(
+    const ContainerT& container,
+    NodeMemoryAccounting* /*acct*/) {
+  return container.size() * sizeof(typename ContainerT::value_type);
+}
+
+template <typename KeyT, typename ValueT, typename... Args>
+uint64_t containerMemoryUsage(
+    const boost::container::flat_map<KeyT, ValueT, Args...>& container,
+    NodeMemoryAccounting* /*acct*/) {
+  using Container = boost::container::flat_map<KeyT, ValueT, Args...>;
+  return container.capacity() * sizeof(typename Container::value_type);
+}
+
+template <typename KeyT, typename MappedT>
+uint64_t containerMemoryUsage(
+    const DenseIdMap<KeyT, MappedT>& container,
+    NodeMemoryAccounting* /*acct*/) {
+  return container.memoryUsage();
+}
+
+// Chunks shared with other copies of the map are only counted once
+template <typename KeyT, typename MappedT, size_t kChunkSize>
+uint64_t containerMemoryUsage(
+    const PersistentFlatMap<KeyT, MappedT, kChunkSize>& container,
+    NodeMemoryAccounting* acct) {
+  uint64_t bytes = 0;
+  container.forEachChunk([&](const void* chunk, uint64_t chunkBytes) {
+    if (acct->visit(chunk)) {
+      bytes += chunkBytes;
+    }
+  });
+  return bytes + container.numChunks() * sizeof(std::shared_ptr<void>);
+}
+
+namespace detail {
+
+// Node fields may provide memoryUsage(acct) to account for storage beyond
+// the fields object itself
+template <typename FieldsT>
+auto fieldsMemoryUsage(
+    const FieldsT& fields,
+    NodeMemoryAccounting* acct,
+    int) -> decltype(fields.memoryUsage(acct)) {
+  return fields.memoryUsage(acct);
+}
+
+template <typename FieldsT>
+uint64_t fieldsMemoryUsage(
+    const FieldsT& /*fields*/,
+    NodeMemoryAccounting* /*acct*/,
+    long) {
+  return 0;
+}
+
+} // namespace detail
+
+}} // facebook::fboss
@@ -0,0 +1,419 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace facebook { namespace fboss {
+
+/*
+ * PersistentFlatMap is a sorted associative container with the subset of the
+ * boost::container::flat_map API used by NodeMapT, whose copies share
+ * structure with each other.
+ *
+ * Entries are stored in sorted chunks of up to 2 * kChunkSize elements, and
+ * the container itself only holds a vector of shared_ptrs to those chunks.
+ * Copying the container therefore only copies O(n / kChunkSize) chunk
+ * pointers rather than every entry, and modifying an entry in a copy only
+ * copies the one chunk holding it (copy-on-write on the chunk level).
+ *
+ * This is meant for very large NodeMaps (e.g. route tables), where the
+ * flat_map clone done by NodeMapT::clone() before every modification would
+ * otherwise copy the whole table.
+ *
+ * Mutable iterators (returned by the non-const find()/begin()/insert()) make
+ * the chunk they point to exclusively owned by this container before handing
+ * out a writable reference, so writes through them never affect other
+ * copies.  Chunks are only shared between containers, never between threads
+ * writing to them: like the rest of the SwitchState, a container may only be
+ * modified while it is unpublished and visible to a single thread.
+ */
+template <typename KeyT, typename MappedT, size_t kChunkSize = 128>
+class PersistentFlatMap {
+ public:
+  using key_type = KeyT;
+  using mapped_type = MappedT;
+  using value_type = std::pair<KeyT, MappedT>;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+ private:
+  using Chunk = std::vector<value_type>;
+  using ChunkList = std::vector<std::shared_ptr<Chunk>>;
+
+  template <bool IsConst>
+  class IteratorImpl {
+   public:
+    using MapPtr = typename std::conditional<
+        IsConst,
+        const PersistentFlatMap*,
+        PersistentFlatMap*>::type;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename PersistentFlatMap::value_type;
+    using difference_type = ptrdiff_t;
+    using reference = typename std::conditional<
+        IsConst,
+        const value_type&,
+        value_type&>::type;
+    using pointer = typename std::conditional<
+        IsConst,
+        const value_type*,
+        value_type*>::type;
+
+    IteratorImpl() {}
+    IteratorImpl(MapPtr map, size_t chunk, size_t pos)
+        : map_(map), chunk_(chunk), pos_(pos) {
+      prepare();
+    }
+    // Allow conversion from iterator to const_iterator
+    template <
+        bool OtherConst,
+        typename = typename std::enable_if<IsConst && !OtherConst>::type>
+    /* implicit */ IteratorImpl(const IteratorImpl<OtherConst>& other)
+        : map_(other.map_), chunk_(other.chunk_), pos_(other.pos_) {}
+
+    reference operator*() const {
+      return (*map_->chunks_[chunk_])[pos_];
+    }
+    pointer operator->() const {
+      return &(*map_->chunks_[chunk_])[pos_];
+    }
+
+    IteratorImpl& operator++() {
+      if (++pos_ == map_->chunks_[chunk_]->size()) {
+        ++chunk_;
+        pos_ = 0;
+        prepare();
+      }
+      return *this;
+    }
+    IteratorImpl operator++(int) {
+      IteratorImpl tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+    IteratorImpl& operator--() {
+      if (pos_ == 0) {
+        --chunk_;
+        pos_ = map_->chunks_[chunk_]->size() - 1;
+        prepare();
+      } else {
+        --pos_;
+      }
+      return *this;
+    }
+    IteratorImpl operator--(int) {
+      IteratorImpl tmp(*this);
+      --(*this);
+      return tmp;
+    }
+
+    template <bool OtherConst>
+    bool operator==(const IteratorImpl<OtherConst>& other) const {
+      return chunk_ == other.chunk_ && pos_ == other.pos_;
+    }
+    template <bool OtherConst>
+    bool operator!=(const IteratorImpl<OtherConst>& other) const {
+      return !operator==(other);
+    }
+
+   private:
+    friend class PersistentFlatMap;
+    template <bool>
+    friend class IteratorImpl;
+
+    void prepare();
+
+    MapPtr map_{nullptr};
+    size_t chunk_{0};
+    size_t pos_{0};
+  };
+
+ public:
+  using iterator = IteratorImpl<false>;
+  using const_iterator = IteratorImpl<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  PersistentFlatMap() {}
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+  /*
+   * Number of chunks currently referenced by this container. Exposed mainly
+   * for tests and memory accounting.
+   */
+  size_t numChunks() const {
+    return chunks_.size();
+  }
+
+  // Calls fn(chunk, bytes) with the identity and storage size of each chunk
+  template <typename Fn>
+  void forEachChunk(Fn fn) const {
+    for (const auto& chunk : chunks_) {
+      fn(static_cast<const void*>(chunk.get()),
+         chunk->capacity() * sizeof(value_type));
+    }
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, chunks_.size(), 0);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  iterator begin() {
+    return iterator(this, 0, 0);
+  }
+  iterator end() {
+    return iterator(this, chunks_.size(), 0);
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+  const_iterator find(const KeyT& key) const {
+    size_t chunk, pos;
+    if (!locate(key, &chunk, &pos)) {
+      return end();
+    }
+    return const_iterator(this, chunk, pos);
+  }
+  iterator find(const KeyT& key) {
+    size_t chunk, pos;
+    if (!locate(key, &chunk, &pos)) {
+      return end();
+    }
+    return iterator(this, chunk, pos);
+  }
+  size_t count(const KeyT& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  /*
+   * First entry whose key is > key, used to resume walks over the map.
+   */
+  const_iterator upper_bound(const KeyT& key) const {
+    auto chunkIt = std::upper_bound(
+        chunks_.begin(),
+        chunks_.end(),
+        key,
+        [](const KeyT& k, const std::shared_ptr<Chunk>& chunk) {
+          return k < chunk->back().first;
+        });
+    if (chunkIt == chunks_.end()) {
+      return end();
+    }
+    const auto& entries = **chunkIt;
+    auto it = std::upper_bound(
+        entries.begin(),
+        entries.end(),
+        key,
+        [](const KeyT& k, const value_type& entry) { return k < entry.first; });
+    return const_iterator(
+        this, chunkIt - chunks_.begin(), it - entries.begin());
+  }
+
+  std::pair<iterator, bool> insert(value_type value);
+
+  /*
+   * Replace the contents with the entries of [begin, end), which must be
+   * sorted by key without duplicates.  Builds full chunks directly, instead
+   * of inserting the entries one by one and splitting chunks as they grow.
+   */
+  template <typename InputIt>
+  void assignSorted(InputIt begin, InputIt end);
+
+  iterator erase(const_iterator it);
+  size_t erase(const KeyT& key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    erase(it);
+    return 1;
+  }
+
+ private:
+  static bool keyLess(const value_type& entry, const KeyT& key) {
+    return entry.first < key;
+  }
+
+  /*
+   * Index of the first chunk whose last key is >= key, or chunks_.size() if
+   * key is bigger than every key in the container.
+   */
+  size_t chunkFor(const KeyT& key) const {
+    auto it = std::lower_bound(
+        chunks_.begin(),
+        chunks_.end(),
+        key,
+        [](const std::shared_ptr<Chunk>& chunk, const KeyT& k) {
+          return chunk->back().first < k;
+        });
+    return it - chunks_.begin();
+  }
+
+  bool locate(const KeyT& key, size_t* chunk, size_t* pos) const {
+    *chunk = chunkFor(key);
+    if (*chunk == chunks_.size()) {
+      return false;
+    }
+    const auto& entries = *chunks_[*chunk];
+    auto it = std::lower_bound(entries.begin(), entries.end(), key, keyLess);
+    if (it == entries.end() || key < it->first) {
+      return false;
+    }
+    *pos = it - entries.begin();
+    return true;
+  }
+
+  /*
+   * Make sure chunk is only referenced by this container, copying it if it
+   * is currently shared with other copies of the container.
+   */
+  void unshare(size_t chunk) {
+    auto& ptr = chunks_[chunk];
+    if (ptr.use_count() != 1) {
+      ptr = std::make_shared<Chunk>(*ptr);
+    }
+  }
+
+  ChunkList chunks_;
+  size_t size_{0};
+};
+
+template <typename KeyT, typename MappedT, size_t kChunkSize>
+template <bool IsConst>
+void PersistentFlatMap<KeyT, MappedT, kChunkSize>::IteratorImpl<
+    IsConst>::prepare() {
+  // Mutable iterators may hand out writable references into the chunk they
+  // point to, so take exclusive ownership of it first.
+  if (!IsConst && map_ && chunk_ < map_->chunks_.size()) {
+    const_cast<PersistentFlatMap*>(map_)->unshare(chunk_);
+  }
+}
+
+template <typename KeyT, typename MappedT, size_t kChunkSize>
+std::pair<
+    typename PersistentFlatMap<KeyT, MappedT, kChunkSize>::iterator,
+    bool>
+PersistentFlatMap<KeyT, MappedT, kChunkSize>::insert(value_type value) {
+  if (chunks_.empty()) {
+    chunks_.push_back(std::make_shared<Chunk>());
+    chunks_.back()->reserve(kChunkSize);
+    chunks_.back()->push_back(std::move(value));
+    ++size_;
+    return std::make_pair(iterator(this, 0, 0), true);
+  }
+  auto chunk = std::min(chunkFor(value.first), chunks_.size() - 1);
+  {
+    const auto& entries = *chunks_[chunk];
+    auto it =
+        std::lower_bound(entries.begin(), entries.end(), value.first, keyLess);
+    if (it != entries.end() && !(value.first < it->first)) {
+      return std::make_pair(iterator(this, chunk, it - entries.begin()), false);
+    }
+  }
+
+  unshare(chunk);
+  auto& entries = *chunks_[chunk];
+  size_t pos =
+      std::lower_bound(entries.begin(), entries.end(), value.first, keyLess) -
+      entries.begin();
+  entries.insert(entries.begin() + pos, std::move(value));
+  ++size_;
+
+  // Split chunks that grew too big so that copy-on-write stays cheap
+  if (entries.size() > 2 * kChunkSize) {
+    auto upper = std::make_shared<Chunk>(
+        std::make_move_iterator(entries.begin() + kChunkSize),
+        std::make_move_iterator(entries.end()));
+    entries.resize(kChunkSize);
+    chunks_.insert(chunks_.begin() + chunk + 1, std::move(upper));
+    if (pos >= kChunkSize) {
+      ++chunk;
+      pos -= kChunkSize;
+    }
+  }
+  return std::make_pair(iterator(this, chunk, pos), true);
+}
+
+template <typename KeyT, typename MappedT, size_t kChunkSize>
+template <typename InputIt>
+void PersistentFlatMap<KeyT, MappedT, kChunkSize>::assignSorted(
+    InputIt begin,
+    InputIt end) {
+  clear();
+  for (auto it = begin; it != end; ++it) {
+    DCHECK(chunks_.empty() || chunks_.back()->back().first < it->first);
+    if (chunks_.empty() || chunks_.back()->size() == kChunkSize) {
+      chunks_.push_back(std::make_shared<Chunk>());
+      chunks_.back()->reserve(kChunkSize);
+    }
+    chunks_.back()->push_back(*it);
+    ++size_;
+  }
+}
+
+template <typename KeyT, typename MappedT, size_t kChunkSize>
+typename PersistentFlatMap<KeyT, MappedT, kChunkSize>::iterator
+PersistentFlatMap<KeyT, MappedT, kChunkSize>::erase(const_iterator it) {
+  CHECK(it.map_ == this);
+  CHECK_LT(it.chunk_, chunks_.size());
+  auto chunk = it.chunk_;
+  auto pos = it.pos_;
+  unshare(chunk);
+  auto& entries = *chunks_[chunk];
+  entries.erase(entries.begin() + pos);
+  --size_;
+  if (entries.empty()) {
+    chunks_.erase(chunks_.begin() + chunk);
+    return iterator(this, chunk, 0);
+  }
+  if (pos == entries.size()) {
+    return iterator(this, chunk + 1, 0);
+  }
+  return iterator(this, chunk, pos);
+}
+
+}} // facebook::fboss
@@ -37,7 +37,8 @@ PortFields::VlanInfo::fromThrift(const state::VlanInfo& vlanThrift) {
 // static
 PortFields PortFields::fromThrift(state::PortFields const& portThrift) {
   PortFields port(PortID(portThrift.portId), portThrift.portName);
-  port.description = portThrift.portDescription;
+  auto* portConfig = port.writableConfigFields();
+  portConfig->description = portThrift.portDescription;
 
   // For backwards compatibility, we still need the ability to read in
   // both possible names for the admin port state. The production agent
@@ -82,25 +83,25 @@ PortFields PortFields::fromThrift(state::PortFields const& portThrift) {
     port.loopbackMode = cfg::PortLoopbackMode(itrPortLoopbackMode->second);
   }
 
-  port.pause.tx = portThrift.txPause;
-  port.pause.rx = portThrift.rxPause;
+  portConfig->pause.tx = portThrift.txPause;
+  portConfig->pause.rx = portThrift.rxPause;
 
   for (const auto& vlanInfo : portThrift.vlanMemberShips) {
-    port.vlans.emplace(
+    portConfig->vlans.emplace(
         VlanID(to<uint32_t>(vlanInfo.first)),
         VlanInfo::fromThrift(vlanInfo.second));
   }
 
-  port.sFlowIngressRate = portThrift.sFlowIngressRate;
-  port.sFlowEgressRate = portThrift.sFlowEgressRate;
+  portConfig->sFlowIngressRate = portThrift.sFlowIngressRate;
+  portConfig->sFlowEgressRate = portThrift.sFlowEgressRate;
 
   for (const auto& queue : portThrift.queues) {
-    port.queues.push_back(
+    portConfig->queues.push_back(
         std::make_shared<PortQueue>(PortQueueFields::fromThrift(queue)));
   }
 
-  port.ingressMirror.assign(portThrift.ingressMirror);
-  port.egressMirror.assign(portThrift.egressMirror);
+  portConfig->ingressMirror.assign(portThrift.ingressMirror);
+  portConfig->egressMirror.assign(portThrift.egressMirror);
 
   return port;
 }
@@ -110,7 +111,8 @@ state::PortFields PortFields::toThrift() const {
 
   port.portId = id;
   port.portName = name;
-  port.portDescription = description;
+  const auto& portConfig = getConfigFields();
+  port.portDescription = portConfig.description;
 
   // TODO: store admin state as enum, not string?
   auto itrAdminState  = cfg::_PortState_VALUES_TO_NAMES.find(adminState);
@@ -141,23 +143,23 @@ state::PortFields PortFields::toThrift() const {
       << "Unexpected port LoopbackMode: " << static_cast<int>(loopbackMode);
   port.portLoopbackMode = itrPortLoopbackMode->second;
 
-  port.txPause = pause.tx;
-  port.rxPause = pause.rx;
+  port.txPause = portConfig.pause.tx;
+  port.rxPause = portConfig.pause.rx;
 
-  for (const auto& vlan: vlans) {
+  for (const auto& vlan: portConfig.vlans) {
     port.vlanMemberShips[to<string>(vlan.first)] = vlan.second.toThrift();
   }
 
-  port.sFlowIngressRate = sFlowIngressRate;
-  port.sFlowEgressRate = sFlowEgressRate;
+  port.sFlowIngressRate = portConfig.sFlowIngressRate;
+  port.sFlowEgressRate = portConfig.sFlowEgressRate;
 
-  for (const auto& queue : queues) {
+  for (const auto& queue : portConfig.queues) {
     // TODO: Use PortQueue::toThrift() when available
     port.queues.push_back(queue->getFields()->toThrift());
   }
 
-  port.ingressMirror.assign(ingressMirror);
-  port.egressMirror.assign(egressMirror);
+  port.ingressMirror.assign(portConfig.ingressMirror);
+  port.egressMirror.assign(portConfig.egressMirror);
 
   return port;
 }
@@ -174,6 +176,60 @@ void Port::initDefaultConfigState(cfg::Port* config) const {
   config->state = cfg::PortState::DISABLED;
 }
 
+uint32_t Port::getChangedFields(const Port& oldPort, const Port& newPort) {
+  const auto& oldFields = *oldPort.getFields();
+  const auto& newFields = *newPort.getFields();
+  uint32_t changed = 0;
+  if (oldFields.name != newFields.name) {
+    changed |= NAME;
+  }
+  if (oldFields.adminState != newFields.adminState) {
+    changed |= ADMIN_STATE;
+  }
+  if (oldFields.operState != newFields.operState) {
+    changed |= OPER_STATE;
+  }
+  if (oldFields.speed != newFields.speed) {
+    changed |= SPEED;
+  }
+  if (oldFields.ingressVlan != newFields.ingressVlan) {
+    changed |= INGRESS_VLAN;
+  }
+  if (oldFields.fec != newFields.fec) {
+    changed |= FEC;
+  }
+  if (oldFields.loopbackMode != newFields.loopbackMode) {
+    changed |= LOOPBACK_MODE;
+  }
+  if (oldFields.configFields == newFields.configFields) {
+    return changed;
+  }
+
+  const auto& oldConfig = oldFields.getConfigFields();
+  const auto& newConfig = newFields.getConfigFields();
+  if (oldConfig.description != newConfig.description) {
+    changed |= DESCRIPTION;
+  }
+  if (oldConfig.pause != newConfig.pause) {
+    changed |= PAUSE;
+  }
+  if (oldConfig.vlans != newConfig.vlans) {
+    changed |= VLANS;
+  }
+  if (oldConfig.sFlowIngressRate != newConfig.sFlowIngressRate ||
+      oldConfig.sFlowEgressRate != newConfig.sFlowEgressRate) {
+    changed |= SFLOW;
+  }
+  if (!isSameQueueConfig(oldConfig.queues, newConfig.queues)) {
+    changed |= QUEUES;
+  }
+  if (oldConfig.ingressMirror != newConfig.ingressMirror ||
+      oldConfig.egressMirror != newConfig.egressMirror) {
+    changed |= MIRRORS;
+  }
+  return changed;
+}
+
 Port* Port::modify(std::shared_ptr<SwitchState>* state) {
   if (!isPublished()) {
     CHECK(!(*state)->isPublished());
@@ -17,6 +17,7 @@
 #include "fboss/agent/types.h"
 
 #include <boost/container/flat_map.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -45,10 +46,41 @@ struct PortFields {
     UP = 1,
   };
 
+  /*
+   * The settings which only change with config. These are shared between
+   * clones of a Port until one of them writes to its copy, so that cloning a
+   * Port for the changes which happen all the time (e.g. oper state on link
+   * flaps) doesn't copy its queues, vlans and mirror names.
+   */
+  struct ConfigFields {
+    std::string description;
+    cfg::PortPause pause;
+    VlanMembership vlans;
+    // settings for ingress/egress sFlow sampling rate; we sample every 1:N'th
+    // packets randomly based on those settings. Zero means no sampling.
+    int64_t sFlowIngressRate{0};
+    int64_t sFlowEgressRate{0};
+    QueueConfig queues;
+    folly::Optional<std::string> ingressMirror;
+    folly::Optional<std::string> egressMirror;
+  };
+
   PortFields(PortID id, std::string name)
     : id(id),
       name(name) {}
 
+  const ConfigFields& getConfigFields() const {
+    return *configFields;
+  }
+  ConfigFields* writableConfigFields() {
+    // Nothing else can take a reference to the ConfigFields of the
+    // (unpublished) node being written while we are checking
+    if (configFields.use_count() > 1) {
+      configFields = std::make_shared<ConfigFields>(*configFields);
+    }
+    return configFields.get();
+  }
+
   template <typename Fn>
   void forEachChild(Fn /*fn*/) {}
 
@@ -58,22 +90,13 @@ struct PortFields {
 
   const PortID id{0};
   std::string name;
-  std::string description;
   cfg::PortState adminState{cfg::PortState::DISABLED}; // is the port enabled
   OperState operState{OperState::DOWN}; // is the port actually up
   VlanID ingressVlan{0};
   cfg::PortSpeed speed{cfg::PortSpeed::DEFAULT};
-  cfg::PortPause pause;
-  VlanMembership vlans;
-  // settings for ingress/egress sFlow sampling rate; we sample every 1:N'th
-  // packets randomly based on those settings. Zero means no sampling.
-  int64_t sFlowIngressRate{0};
-  int64_t sFlowEgressRate{0};
-  QueueConfig queues;
   cfg::PortFEC fec{cfg::PortFEC::OFF};  // TODO: should this default to ON?
   cfg::PortLoopbackMode loopbackMode{cfg::PortLoopbackMode::NONE};
-  folly::Optional<std::string> ingressMirror;
-  folly::Optional<std::string> egressMirror;
+  std::shared_ptr<ConfigFields> configFields{std::make_shared<ConfigFields>()};
 };
 
 /*
@@ -85,8 +108,35 @@ class Port : public ThriftyBaseT<state::PortFields, Port, PortFields> {
   using VlanMembership = PortFields::VlanMembership;
   using OperState = PortFields::OperState;
 
+  /*
+   * The groups of settings of a Port, as bits of what getChangedFields()
+   * returns, so that the hardware only reprograms what changed.
+   */
+  enum ChangedField : uint32_t {
+    NAME = 1 << 0,
+    ADMIN_STATE = 1 << 1,
+    OPER_STATE = 1 << 2,
+    SPEED = 1 << 3,
+    INGRESS_VLAN = 1 << 4,
+    FEC = 1 << 5,
+    LOOPBACK_MODE = 1 << 6,
+    PAUSE = 1 << 7,
+    VLANS = 1 << 8,
+    SFLOW = 1 << 9,
+    QUEUES = 1 << 10,
+    MIRRORS = 1 << 11,
+    DESCRIPTION = 1 << 12,
+  };
+
   Port(PortID id, const std::string& name);
 
+  /*
+   * The ChangedField bits of the settings which differ between oldPort and
+   * newPort. The config settings are only compared if the two ports don't
+   * share them, which a port changed by anything but config does.
+   */
+  static uint32_t getChangedFields(const Port& oldPort, const Port& newPort);
+
   /*
    * Initialize a cfg::Port object with the default settings
    * that would be applied for this port. Port identifiers
@@ -110,11 +160,11 @@ class Port : public ThriftyBaseT<state::PortFields, Port, PortFields> {
   }
 
   const std::string& getDescription() const {
-    return getFields()->description;
+    return getFields()->getConfigFields().description;
   }
 
   void setDescription(const std::string& description) {
-    writableFields()->description = description;
+    writableFields()->writableConfigFields()->description = description;
   }
 
   cfg::PortState getAdminState() const {
@@ -150,18 +200,18 @@ class Port : public ThriftyBaseT<state::PortFields, Port, PortFields> {
   }
 
   const VlanMembership& getVlans() const {
-    return getFields()->vlans;
+    return getFields()->getConfigFields().vlans;
   }
   void setVlans(VlanMembership vlans) {
-    writableFields()->vlans.swap(vlans);
+    writableFields()->writableConfigFields()->vlans.swap(vlans);
   }
 
   const QueueConfig& getPortQueues() {
-    return getFields()->queues;
+    return getFields()->getConfigFields().queues;
   }
 
   void resetPortQueues(QueueConfig queues) {
-    writableFields()->queues.swap(queues);
+    writableFields()->writableConfigFields()->queues.swap(queues);
   }
 
   VlanID getIngressVlan() const {
@@ -179,10 +229,10 @@ class Port : public ThriftyBaseT<state::PortFields, Port, PortFields> {
   }
 
   cfg::PortPause getPause() const {
-    return getFields()->pause;
+    return getFields()->getConfigFields().pause;
   }
   void setPause(cfg::PortPause pause) {
-    writableFields()->pause = pause;
+    writableFields()->writableConfigFields()->pause = pause;
   }
 
   cfg::PortFEC getFEC() const {
@@ -200,33 +250,33 @@ class Port : public ThriftyBaseT<state::PortFields, Port, PortFields> {
   }
 
   int64_t getSflowIngressRate() const {
-    return getFields()->sFlowIngressRate;
+    return getFields()->getConfigFields().sFlowIngressRate;
   }
   void setSflowIngressRate(int64_t ingressRate) {
-    writableFields()->sFlowIngressRate = ingressRate;
+    writableFields()->writableConfigFields()->sFlowIngressRate = ingressRate;
   }
 
   int64_t getSflowEgressRate() const {
-    return getFields()->sFlowEgressRate;
+    return getFields()->getConfigFields().sFlowEgressRate;
   }
   void setSflowEgressRate(int64_t egressRate) {
-    writableFields()->sFlowEgressRate = egressRate;
+    writableFields()->writableConfigFields()->sFlowEgressRate = egressRate;
   }
 
   folly::Optional<std::string> getIngressMirror() const {
-    return getFields()->ingressMirror;
+    return getFields()->getConfigFields().ingressMirror;
   }
 
   void setIngressMirror(folly::Optional<std::string> mirror) {
-    writableFields()->ingressMirror.assign(mirror);
+    writableFields()->writableConfigFields()->ingressMirror.assign(mirror);
   }
 
   folly::Optional<std::string> getEgressMirror() const {
-    return getFields()->egressMirror;
+    return getFields()->getConfigFields().egressMirror;
   }
 
   void setEgressMirror(folly::Optional<std::string> mirror) {
-    writableFields()->egressMirror.assign(mirror);
+    writableFields()->writableConfigFields()->egressMirror.assign(mirror);
   }
 
   Port* modify(std::shared_ptr<SwitchState>* state);
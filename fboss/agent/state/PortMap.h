@@ -10,13 +10,18 @@
 #pragma once
 
 #include "fboss/agent/types.h"
+#include "fboss/agent/state/DenseIdMap.h"
 #include "fboss/agent/state/NodeMap.h"
 
 namespace facebook { namespace fboss {
 
 class SwitchState;
 class Port;
-typedef NodeMapTraits<PortID, Port> PortMapTraits;
+
+struct PortMapTraits : NodeMapTraits<PortID, Port> {
+  // Ports are looked up by ID for every packet, and the IDs are dense
+  using NodeContainer = DenseIdMap<PortID, std::shared_ptr<Port>>;
+};
 
 /*
  * A container for the set of ports.
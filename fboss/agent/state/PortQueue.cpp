@@ -142,6 +142,18 @@ bool checkSwConfPortQueueMatch(
          swQueue->getName() == cfgQueue->name;
 }
 
+bool isSameQueueConfig(const QueueConfig& a, const QueueConfig& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i] != b[i] && *a[i] != *b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 template class NodeBaseT<PortQueue, PortQueueFields>;
 
 }} // facebook::fboss
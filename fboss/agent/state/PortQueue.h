@@ -60,7 +60,6 @@ class PortQueue :
 
   explicit PortQueue(uint8_t id);
   bool operator==(const PortQueue& queue) const {
-    // TODO(joseph5wu) Add sharedBytes
     return getFields()->id == queue.getID() &&
            getFields()->streamType == queue.getStreamType() &&
            getFields()->weight == queue.getWeight() &&
@@ -69,6 +68,7 @@ class PortQueue :
            getFields()->scheduling == queue.getScheduling() &&
            getFields()->aqms == queue.getAqms() &&
            getFields()->packetsPerSec == queue.getPacketsPerSec() &&
+           getFields()->sharedBytes == queue.getSharedBytes() &&
            getFields()->name == queue.getName();
   }
   bool operator!=(const PortQueue& queue) const {
@@ -172,4 +172,10 @@ bool comparePortQueueAQMs(
 bool checkSwConfPortQueueMatch(
   const std::shared_ptr<PortQueue>& swQueue,
   const cfg::PortQueue* cfgQueue);
+
+/*
+ * Whether two queue configs have the same queues. Clones share the queues
+ * they didn't change, so those are told apart without comparing them.
+ */
+bool isSameQueueConfig(const QueueConfig& a, const QueueConfig& b);
 }} // facebook::fboss
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/RouteLookupTable.h"
+
+#include <algorithm>
+
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+
+namespace {
+
+using V6Key = std::pair<uint64_t, uint64_t>;
+
+constexpr uint64_t kAllOnes = ~uint64_t(0);
+
+uint32_t keyOf(const IPAddressV4& addr) {
+  return addr.toLongHBO();
+}
+
+V6Key keyOf(const IPAddressV6& addr) {
+  const auto& bytes = addr.toByteArray();
+  V6Key key{0, 0};
+  for (int i = 0; i < 8; ++i) {
+    key.first = (key.first << 8) | bytes[i];
+    key.second = (key.second << 8) | bytes[i + 8];
+  }
+  return key;
+}
+
+// The last address of the prefix starting at network
+uint32_t lastOf(uint32_t network, uint8_t mask) {
+  return mask >= 32 ? network : network | (~uint32_t(0) >> mask);
+}
+
+V6Key lastOf(V6Key network, uint8_t mask) {
+  auto lowBits = [](int bits) -> uint64_t {
+    return bits >= 64 ? kAllOnes : bits <= 0 ? 0 : (uint64_t(1) << bits) - 1;
+  };
+  int hostBits = 128 - mask;
+  return {network.first | lowBits(hostBits - 64),
+          network.second | lowBits(hostBits)};
+}
+
+bool isLast(uint32_t key) {
+  return key == ~uint32_t(0);
+}
+
+bool isLast(V6Key key) {
+  return key.first == kAllOnes && key.second == kAllOnes;
+}
+
+uint32_t next(uint32_t key) {
+  return key + 1;
+}
+
+V6Key next(V6Key key) {
+  return key.second == kAllOnes ? V6Key{key.first + 1, 0}
+                                : V6Key{key.first, key.second + 1};
+}
+
+} // anonymous namespace
+
+namespace facebook { namespace fboss {
+
+template <typename AddrT>
+RouteLookupTable<AddrT>::RouteLookupTable(
+    std::shared_ptr<const RouteTableRib<AddrT>> rib)
+    : rib_(std::move(rib)) {
+  struct Range {
+    Key first;
+    Key last;
+    uint8_t mask;
+    const Route<AddrT>* route;
+  };
+  std::vector<Range> ranges;
+  ranges.reserve(rib_->size());
+  for (const auto& route : *rib_->routes()) {
+    const auto& prefix = route->prefix();
+    auto first = toKey(prefix.network);
+    ranges.push_back(
+        {first, lastOf(first, prefix.mask), prefix.mask, route.get()});
+  }
+  // Prefixes are either disjoint or nested, put the outer ones first
+  std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+    return a.first < b.first || (a.first == b.first && a.mask < b.mask);
+  });
+
+  auto add = [this](Key start, const Route<AddrT>* route) {
+    if (!starts_.empty() && starts_.back() == start) {
+      // A more specific prefix starting at the same address
+      routes_.back() = route;
+    } else if (routes_.empty() || routes_.back() != route) {
+      starts_.push_back(start);
+      routes_.push_back(route);
+    }
+  };
+  // The prefixes containing the current address, innermost last
+  std::vector<const Range*> open;
+  auto closeLast = [&]() {
+    auto closed = open.back();
+    open.pop_back();
+    if (!isLast(closed->last)) {
+      add(next(closed->last), open.empty() ? nullptr : open.back()->route);
+    }
+  };
+  for (const auto& range : ranges) {
+    while (!open.empty() && open.back()->last < range.first) {
+      closeLast();
+    }
+    open.push_back(&range);
+    add(range.first, range.route);
+  }
+  while (!open.empty()) {
+    closeLast();
+  }
+  starts_.shrink_to_fit();
+  routes_.shrink_to_fit();
+}
+
+template <typename AddrT>
+const Route<AddrT>* RouteLookupTable<AddrT>::longestMatch(
+    const AddrT& addr) const {
+  auto it = std::upper_bound(starts_.begin(), starts_.end(), toKey(addr));
+  if (it == starts_.begin()) {
+    return nullptr;
+  }
+  return routes_[it - starts_.begin() - 1];
+}
+
+template <typename AddrT>
+typename RouteLookupTable<AddrT>::Key RouteLookupTable<AddrT>::toKey(
+    const AddrT& addr) {
+  return keyOf(addr);
+}
+
+template class RouteLookupTable<folly::IPAddressV4>;
+template class RouteLookupTable<folly::IPAddressV6>;
+
+}} // facebook::fboss
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTableRib.h"
+
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * A read only longest prefix match index over the routes of a published
+ * RouteTableRib.
+ *
+ * The address space is flattened into the ranges over which the longest
+ * match does not change, so a lookup is a single binary search over a
+ * contiguous array of integers rather than a walk down the radix tree.
+ * Building one costs a sort of the routes, so it only pays off when used
+ * for many lookups against the same rib, e.g. for batches of lookups.
+ */
+template <typename AddrT>
+class RouteLookupTable {
+ public:
+  using Key = typename std::conditional<
+      std::is_same<AddrT, folly::IPAddressV4>::value,
+      uint32_t,
+      std::pair<uint64_t, uint64_t>>::type;
+
+  explicit RouteLookupTable(std::shared_ptr<const RouteTableRib<AddrT>> rib);
+
+  /*
+   * The route with the longest prefix containing addr, like
+   * RouteTableRib::longestMatch(), or null if there is none.
+   */
+  const Route<AddrT>* longestMatch(const AddrT& addr) const;
+
+  const std::shared_ptr<const RouteTableRib<AddrT>>& getRib() const {
+    return rib_;
+  }
+
+  static Key toKey(const AddrT& addr);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RouteLookupTable(RouteLookupTable const &) = delete;
+  RouteLookupTable& operator=(RouteLookupTable const &) = delete;
+
+  // Keeps the routes we point to alive
+  std::shared_ptr<const RouteTableRib<AddrT>> rib_;
+  // The first address of each range, and the longest match over it
+  std::vector<Key> starts_;
+  std::vector<const Route<AddrT>*> routes_;
+};
+
+}} // facebook::fboss
@@ -11,6 +11,13 @@
 
 #include "fboss/agent/FbossError.h"
 
+#include <folly/hash/Hash.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 namespace {
 constexpr auto kNexthops = "nexthops";
 constexpr auto kAction = "action";
@@ -43,13 +50,89 @@ fromRouteNextHopSet(RouteNextHopSet const& nhs) {
 
 } // namespace util
 
+struct RouteNextHopEntry::NextHopSetTable {
+  using Bucket = std::vector<std::weak_ptr<const InternedNextHopSet>>;
+
+  std::mutex lock;
+  // The interned sets by hash. The entries of a set expire when the last
+  // RouteNextHopEntry using it goes away, and are cleaned up by release().
+  std::unordered_map<size_t, Bucket> sets;
+};
+
+RouteNextHopEntry::NextHopSetTable& RouteNextHopEntry::nextHopSetTable() {
+  // Leaked, so that it outlives the entries of other static objects
+  static auto* table = new NextHopSetTable();
+  return *table;
+}
+
+const std::shared_ptr<const RouteNextHopEntry::InternedNextHopSet>&
+RouteNextHopEntry::emptyNextHopSet() {
+  // Shared by every DROP and TO_CPU entry, without going through the table
+  static const auto* empty = new std::shared_ptr<const InternedNextHopSet>(
+      std::make_shared<InternedNextHopSet>(InternedNextHopSet{{}, 0}));
+  return *empty;
+}
+
+std::shared_ptr<const RouteNextHopEntry::InternedNextHopSet>
+RouteNextHopEntry::intern(NextHopSet nhops) {
+  size_t hash = 0;
+  for (const auto& nhop : nhops) {
+    auto intf = nhop.intfID();
+    hash = folly::hash::hash_combine(
+        hash,
+        nhop.addr().hash(),
+        intf ? static_cast<uint32_t>(*intf) : ~0u,
+        nhop.weight());
+  }
+
+  // The sets looked at are only released once the lock is, as release()
+  // takes it too
+  std::vector<std::shared_ptr<const InternedNextHopSet>> others;
+  auto& table = nextHopSetTable();
+  std::lock_guard<std::mutex> g(table.lock);
+  auto& bucket = table.sets[hash];
+  for (const auto& weak : bucket) {
+    auto interned = weak.lock();
+    if (interned && interned->nhops == nhops) {
+      return interned;
+    }
+    others.push_back(std::move(interned));
+  }
+  std::shared_ptr<const InternedNextHopSet> interned(
+      new InternedNextHopSet{std::move(nhops), hash}, &release);
+  bucket.push_back(interned);
+  return interned;
+}
+
+void RouteNextHopEntry::release(const InternedNextHopSet* interned) {
+  {
+    auto& table = nextHopSetTable();
+    std::lock_guard<std::mutex> g(table.lock);
+    auto it = table.sets.find(interned->hash);
+    if (it != table.sets.end()) {
+      auto& bucket = it->second;
+      bucket.erase(
+          std::remove_if(
+              bucket.begin(),
+              bucket.end(),
+              [](const std::weak_ptr<const InternedNextHopSet>& weak) {
+                return weak.expired();
+              }),
+          bucket.end());
+      if (bucket.empty()) {
+        table.sets.erase(it);
+      }
+    }
+  }
+  delete interned;
+}
+
 RouteNextHopEntry::RouteNextHopEntry(NextHopSet nhopSet, AdminDistance distance)
-    : adminDistance_(distance),
-      action_(Action::NEXTHOPS),
-      nhopSet_(std::move(nhopSet)) {
-  if (nhopSet_.size() == 0) {
+    : adminDistance_(distance), action_(Action::NEXTHOPS) {
+  if (nhopSet.size() == 0) {
     throw FbossError("Empty nexthop set is passed to the RouteNextHopEntry");
   }
+  nhopSet_ = intern(std::move(nhopSet));
 }
 
 NextHopWeight RouteNextHopEntry::getTotalWeight() const {
@@ -78,8 +161,9 @@ std::string RouteNextHopEntry::str() const {
 }
 
 bool operator==(const RouteNextHopEntry& a, const RouteNextHopEntry& b) {
+  // Interned, so the same next hops are the same set
   return (a.getAction() == b.getAction()
-          and a.getNextHopSet() == b.getNextHopSet()
+          and &a.getNextHopSet() == &b.getNextHopSet()
           and a.getAdminDistance() == b.getAdminDistance());
 }
 
@@ -87,9 +171,11 @@ bool operator< (const RouteNextHopEntry& a, const RouteNextHopEntry& b) {
   if (a.getAdminDistance() != b.getAdminDistance()) {
     return a.getAdminDistance() < b.getAdminDistance();
   }
-  return ((a.getAction() == b.getAction())
-          ? (a.getNextHopSet() < b.getNextHopSet())
-          : a.getAction() < b.getAction());
+  if (a.getAction() != b.getAction()) {
+    return a.getAction() < b.getAction();
+  }
+  return &a.getNextHopSet() != &b.getNextHopSet() &&
+      a.getNextHopSet() < b.getNextHopSet();
 }
 
 // Methods for RouteNextHopEntry
@@ -127,7 +213,7 @@ folly::dynamic RouteNextHopEntry::toFollyDynamic() const {
   folly::dynamic entry = folly::dynamic::object;
   entry[kAction] = forwardActionStr(action_);
   folly::dynamic nhops = folly::dynamic::array;
-  for (const auto& nhop: nhopSet_) {
+  for (const auto& nhop : getNextHopSet()) {
     nhops.push_back(nhop.toFollyDynamic());
   }
   entry[kNexthops] = std::move(nhops);
@@ -144,8 +230,12 @@ RouteNextHopEntry::fromFollyDynamic(const folly::dynamic& entryJson) {
       : AdminDistance(entryJson[kAdminDistance].asInt());
   RouteNextHopEntry entry(Action::DROP, adminDistance);
   entry.action_ = action;
+  NextHopSet nhops;
   for (const auto& nhop : entryJson[kNexthops]) {
-    entry.nhopSet_.insert(util::nextHopFromFollyDynamic(nhop));
+    nhops.insert(util::nextHopFromFollyDynamic(nhop));
+  }
+  if (!nhops.empty()) {
+    entry.nhopSet_ = intern(std::move(nhops));
   }
   return entry;
 }
@@ -13,6 +13,8 @@
 
 #include <folly/dynamic.h>
 
+#include <memory>
+
 #include "fboss/agent/state/RouteNextHop.h"
 #include "fboss/agent/state/RouteTypes.h"
 
@@ -24,16 +26,16 @@ class RouteNextHopEntry {
   using NextHopSet = boost::container::flat_set<NextHop>;
 
   RouteNextHopEntry(Action action, AdminDistance distance)
-      : adminDistance_(distance), action_(action) {
+      : adminDistance_(distance),
+        action_(action),
+        nhopSet_(emptyNextHopSet()) {
     CHECK_NE(action_, Action::NEXTHOPS);
   }
 
   RouteNextHopEntry(NextHopSet nhopSet, AdminDistance distance);
 
   RouteNextHopEntry(NextHop nhop, AdminDistance distance)
-      : adminDistance_(distance), action_(Action::NEXTHOPS) {
-    nhopSet_.emplace(std::move(nhop));
-  }
+      : RouteNextHopEntry(NextHopSet{std::move(nhop)}, distance) {}
 
   AdminDistance getAdminDistance() const {
     return adminDistance_;
@@ -44,7 +46,7 @@ class RouteNextHopEntry {
   }
 
   const NextHopSet& getNextHopSet() const {
-    return nhopSet_;
+    return nhopSet_->nhops;
   }
 
   // Get the sum of the weights of all the nexthops in the entry
@@ -75,14 +77,32 @@ class RouteNextHopEntry {
 
   // Reset the NextHopSet
   void reset() {
-    nhopSet_.clear();
+    nhopSet_ = emptyNextHopSet();
     action_ = Action::DROP;
   }
 
  private:
+  /*
+   * Next hop sets are interned: the entries with the same next hops share
+   * one immutable copy of them, which goes away with the last of those
+   * entries. Routes through the same ECMP group don't each keep a copy of
+   * it, and two entries have the same next hops exactly when they point
+   * to the same copy.
+   */
+  struct InternedNextHopSet {
+    NextHopSet nhops;
+    size_t hash;
+  };
+  struct NextHopSetTable;
+
+  static std::shared_ptr<const InternedNextHopSet> intern(NextHopSet nhops);
+  static void release(const InternedNextHopSet* interned);
+  static NextHopSetTable& nextHopSetTable();
+  static const std::shared_ptr<const InternedNextHopSet>& emptyNextHopSet();
+
   AdminDistance adminDistance_;
   Action action_{Action::DROP};
-  NextHopSet nhopSet_;
+  std::shared_ptr<const InternedNextHopSet> nhopSet_;
 };
 
 /**
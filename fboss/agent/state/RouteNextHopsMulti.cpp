@@ -13,6 +13,8 @@
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/state/StateUtils.h"
 
+#include <algorithm>
+
 namespace {
 constexpr auto kNexthopDelim = "@";
 }
@@ -77,10 +79,35 @@ std::string RouteNextHopsMulti::str() const {
   return ret;
 }
 
+RouteNextHopsMulti::ClientEntries::iterator RouteNextHopsMulti::find(
+    ClientID clientId) {
+  auto iter = std::lower_bound(
+      map_.begin(),
+      map_.end(),
+      clientId,
+      [](const ClientEntries::value_type& entry, ClientID id) {
+        return entry.first < id;
+      });
+  return (iter != map_.end() && iter->first == clientId) ? iter : map_.end();
+}
+
+RouteNextHopsMulti::ClientEntries::const_iterator RouteNextHopsMulti::find(
+    ClientID clientId) const {
+  return const_cast<RouteNextHopsMulti*>(this)->find(clientId);
+}
+
 void RouteNextHopsMulti::update(ClientID clientId, RouteNextHopEntry nhe) {
-  auto iter = map_.find(clientId);
+  auto distance = nhe.getAdminDistance();
+  auto iter = find(clientId);
   if (iter == map_.end()) {
-    map_.insert(std::make_pair(clientId, std::move(nhe)));
+    iter = std::upper_bound(
+        map_.begin(),
+        map_.end(),
+        clientId,
+        [](ClientID id, const ClientEntries::value_type& entry) {
+          return id < entry.first;
+        });
+    map_.insert(iter, std::make_pair(clientId, std::move(nhe)));
   } else {
     iter->second = std::move(nhe);
   }
@@ -93,7 +120,7 @@ void RouteNextHopsMulti::update(ClientID clientId, RouteNextHopEntry nhe) {
   auto entry = getEntryForClient(lowestAdminDistanceClientId_);
   if (!entry) {
     lowestAdminDistanceClientId_ = findLowestAdminDistance();
-  } else if (nhe.getAdminDistance() < entry->getAdminDistance()) {
+  } else if (distance < entry->getAdminDistance()) {
     // Arbritary choice to use the newest one if we have multiple
     // with the same admin distance
     lowestAdminDistanceClientId_ = clientId;
@@ -121,7 +148,10 @@ ClientID RouteNextHopsMulti::findLowestAdminDistance() {
 }
 
 void RouteNextHopsMulti::delEntryForClient(ClientID clientId) {
-  map_.erase(clientId);
+  auto iter = find(clientId);
+  if (iter != map_.end()) {
+    map_.erase(iter);
+  }
 
   // Let's regen the next best entry
   if (lowestAdminDistanceClientId_ == clientId) {
@@ -131,7 +161,7 @@ void RouteNextHopsMulti::delEntryForClient(ClientID clientId) {
 
 const RouteNextHopEntry* RouteNextHopsMulti::getEntryForClient(
     ClientID clientId) const {
-  auto iter = map_.find(clientId);
+  auto iter = find(clientId);
   if (iter == map_.end()) {
     return nullptr;
   }
@@ -12,8 +12,7 @@
 #include <folly/dynamic.h>
 #include <folly/FBString.h>
 #include <folly/IPAddress.h>
-
-#include <boost/container/flat_map.hpp>
+#include <folly/small_vector.h>
 
 #include "fboss/agent/state/RouteNextHopEntry.h"
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
@@ -44,8 +43,16 @@ namespace facebook { namespace fboss {
  */
 class RouteNextHopsMulti {
  protected:
+   // The entries sorted by client ID. Most routes come from a single
+   // client, so one entry is kept inline instead of on the heap.
+   using ClientEntries =
+       folly::small_vector<std::pair<ClientID, RouteNextHopEntry>, 1>;
+
    ClientID findLowestAdminDistance();
-   boost::container::flat_map<ClientID, RouteNextHopEntry> map_;
+   ClientEntries::iterator find(ClientID clientId);
+   ClientEntries::const_iterator find(ClientID clientId) const;
+
+   ClientEntries map_;
    ClientID lowestAdminDistanceClientId_;
 
  public:
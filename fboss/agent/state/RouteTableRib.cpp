@@ -14,12 +14,70 @@
 #include "fboss/agent/state/RouteTable.h"
 #include "fboss/agent/state/SwitchState.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
 namespace {
 constexpr auto kRoutes = "routes";
+// Routes parsed by one thread at a time when deserializing a route table,
+// so that tables smaller than this are parsed without spawning threads
+constexpr size_t kRoutesPerParseChunk = 8192;
 }
 
 namespace facebook { namespace fboss {
 
+namespace {
+
+/*
+ * Parse routesJson, an array of serialized routes, with one thread per core.
+ * Warm boot deserializes every route of every table before the switch can
+ * come back up, and parsing a route is independent of the others: each
+ * thread claims chunks of the array and writes the routes it builds into
+ * their slots of the result, so no locking is needed beyond the chunk index.
+ */
+template <typename AddrT>
+std::vector<std::shared_ptr<Route<AddrT>>> parseRoutes(
+    const folly::dynamic& routesJson) {
+  std::vector<std::shared_ptr<Route<AddrT>>> routes(routesJson.size());
+  auto numChunks =
+      (routes.size() + kRoutesPerParseChunk - 1) / kRoutesPerParseChunk;
+  std::vector<std::exception_ptr> errors(numChunks);
+  std::atomic<size_t> next{0};
+  auto parse = [&]() {
+    for (auto chunk = next++; chunk < numChunks; chunk = next++) {
+      try {
+        auto begin = chunk * kRoutesPerParseChunk;
+        auto end = std::min(begin + kRoutesPerParseChunk, routes.size());
+        for (auto i = begin; i < end; ++i) {
+          routes[i] = Route<AddrT>::fromFollyDynamic(routesJson[i]);
+        }
+      } catch (...) {
+        errors[chunk] = std::current_exception();
+      }
+    }
+  };
+  auto numThreads = std::min<size_t>(
+      std::max(std::thread::hardware_concurrency(), 1u), numChunks);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; ++i) {
+    threads.emplace_back(parse);
+  }
+  parse();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return routes;
+}
+
+} // namespace
+
 template <typename AddrT>
 void RouteTableRibNodeMap<AddrT>::addRoute(
     const std::shared_ptr<Route<AddrT>>& rt) {
@@ -60,12 +118,32 @@ template <typename AddrT>
 std::shared_ptr<RouteTableRib<AddrT>>
 RouteTableRib<AddrT>::fromFollyDynamic(const folly::dynamic& routes) {
   auto rib = std::make_shared<RouteTableRib<AddrT>>();
-  auto routesJson = routes[kRoutes];
-  for (const auto& routeJson: routesJson) {
-    auto route = Route<AddrT>::fromFollyDynamic(routeJson);
-    rib->addRoute(route);
-    rib->addRouteInRadixTree(route);
+  auto parsed = parseRoutes<AddrT>(routes[kRoutes]);
+
+  // toFollyDynamic() writes the routes in prefix order, so the node map can
+  // be built a chunk at a time rather than by inserting every route
+  auto prefixLess = [](const std::shared_ptr<Route<AddrT>>& a,
+                       const std::shared_ptr<Route<AddrT>>& b) {
+    return a->prefix() < b->prefix();
+  };
+  if (!std::is_sorted(parsed.begin(), parsed.end(), prefixLess)) {
+    std::sort(parsed.begin(), parsed.end(), prefixLess);
   }
+  std::vector<std::pair<Prefix, std::shared_ptr<Route<AddrT>>>> entries;
+  RadixTreeEntries radixTreeEntries;
+  entries.reserve(parsed.size());
+  radixTreeEntries.reserve(parsed.size());
+  for (auto& route : parsed) {
+    if (!entries.empty() && !(entries.back().first < route->prefix())) {
+      throw FbossError("Duplicate route for ", route->str());
+    }
+    const auto& prefix = route->prefix();
+    radixTreeEntries.emplace_back(
+        std::make_pair(prefix.network, prefix.mask), route);
+    entries.emplace_back(prefix, std::move(route));
+  }
+  rib->nodeMap_->writableNodes().assignSorted(entries.begin(), entries.end());
+  rib->resetRadixTree(std::move(radixTreeEntries));
   return rib;
 }
 
@@ -88,11 +166,13 @@ RouteTableRib<AddrT>* RouteTableRib<AddrT>::modify(
   // modify() is that we have a cloned RouteTableRib return if the current one
   // is published. To make sure the cloned RouteTableRib works, we need to
   // ensure radixTree_ and nodeMap_ in sync before we return a newly cloned rib.
+  RadixTreeEntries entries;
+  entries.reserve(size());
   for (const auto& node: nodeMap_->getAllNodes()) {
-    clonedRib->radixTree_.insert(node.first.network, node.first.mask,
-                                 node.second);
+    entries.emplace_back(
+        std::make_pair(node.first.network, node.first.mask), node.second);
   }
-  CHECK_EQ(clonedRib->size(), clonedRib->radixTree_.size());
+  clonedRib->resetRadixTree(std::move(entries));
 
   auto clonedRibPtr = clonedRib.get();
   clonedRouteTable->setRib(clonedRib);
@@ -118,6 +198,21 @@ void RouteTableRib<AddrT>::removeRoute(
   nodeMap_->removeRoute(route);
 }
 
+template <typename AddrT>
+void RouteTableRib<AddrT>::resetRadixTree(RadixTreeEntries entries) {
+  std::sort(
+      entries.begin(),
+      entries.end(),
+      [](const typename RadixTreeEntries::value_type& a,
+         const typename RadixTreeEntries::value_type& b) {
+        return a.first < b.first;
+      });
+  radixTree_.assignSorted(
+      std::make_move_iterator(entries.begin()),
+      std::make_move_iterator(entries.end()));
+  CHECK_EQ(size(), radixTree_.size());
+}
+
 template class RouteTableRib<folly::IPAddressV4>;
 template class RouteTableRib<folly::IPAddressV6>;
 
@@ -13,6 +13,8 @@
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/state/NodeMap.h"
+#include "fboss/agent/state/NodeMemoryAccounting.h"
+#include "fboss/agent/state/PersistentFlatMap.h"
 #include "fboss/agent/state/RouteTypes.h"
 #include "fboss/lib/RadixTree.h"
 
@@ -25,8 +27,18 @@ class SwitchState;
 template <typename AddrT>
 class RouteTableRib;
 
-template<typename AddrT> using RouteTableRibNodeMapTraits
-  = NodeMapTraits<RoutePrefix<AddrT>, Route<AddrT>>;
+/*
+ * Route tables can hold hundreds of thousands of routes, so store them in a
+ * PersistentFlatMap: cloning the map to modify a few routes then only copies
+ * the affected chunks instead of the whole table.
+ */
+template <typename AddrT>
+struct RouteTableRibNodeMapTraits
+    : public NodeMapTraits<RoutePrefix<AddrT>, Route<AddrT>> {
+  using NodeContainer = PersistentFlatMap<
+      RoutePrefix<AddrT>,
+      std::shared_ptr<Route<AddrT>>>;
+};
 
 template<typename AddrT>
 class RouteTableRibNodeMap
@@ -104,6 +116,22 @@ class RouteTableRib : public NodeBase {
     NodeBase::publish();
   }
 
+  void accountMemory(NodeMemoryAccounting* acct) const override {
+    if (!acct->visit(this)) {
+      return;
+    }
+    acct->add<RouteTableRib>(sizeof(RouteTableRib));
+    // The radix tree belongs to this rib only, but may hold clones of the
+    // routes in nodeMap_ rather than the same route objects
+    acct->add(
+        NodeMemoryAccounting::typeName<RouteTableRib>() + ".radixTree",
+        radixTree_.memoryUsage());
+    for (auto it = radixTree_.begin(); it != radixTree_.end(); ++it) {
+      it->value()->accountMemory(acct);
+    }
+    nodeMap_->accountMemory(acct);
+  }
+
   RouteTableRib* modify(RouterID id, std::shared_ptr<SwitchState>* state);
 
   std::shared_ptr<RouteTableRib> clone() const {
@@ -156,16 +184,19 @@ class RouteTableRib : public NodeBase {
   void cloneToRadixTreeWithForwardClear() {
     // We should expect this function is called only before we publish the rib
     CHECK(!isPublished());
-    radixTree_.clear();
+    RadixTreeEntries entries;
+    entries.reserve(size());
     for (const auto& node: nodeMap_->getAllNodes()) {
       auto route = node.second;
       if (route->isPublished()) {
         route = route->clone(RouteType::Fields::COPY_PREFIX_AND_NEXTHOPS);
       }
       route->clearForward();
-      radixTree_.insert(node.first.network, node.first.mask, route);
+      entries.emplace_back(
+          std::make_pair(node.first.network, node.first.mask),
+          std::move(route));
     }
-    CHECK_EQ(size(), radixTree_.size());
+    resetRadixTree(std::move(entries));
   }
 
   // STRONGLY RECOMMEND to use routes() which returns the NodeMap
@@ -209,6 +240,19 @@ class RouteTableRib : public NodeBase {
   }
 
  private:
+  using RadixTreeEntries = std::vector<std::pair<
+      std::pair<AddrT, uint8_t>,
+      std::shared_ptr<Route<AddrT>>>>;
+
+  /*
+   * Replace radixTree_ with the routes of entries, which may come in any
+   * order. They are sorted into the order RadixTree::assignSorted() builds
+   * the tree from, which is cheaper than inserting the routes one by one;
+   * the prefix order of nodeMap_ sorts by mask length first, so it isn't
+   * that order.
+   */
+  void resetRadixTree(RadixTreeEntries entries);
+
   RoutesRadixTree radixTree_;
   std::shared_ptr<RoutesNodeMap> nodeMap_;
 };
@@ -10,6 +10,7 @@
 // Copyright 2004-present Facebook.  All rights reserved.
 #include "RouteUpdater.h"
 
+#include <algorithm>
 #include <numeric>
 
 #include <boost/integer/common_factor.hpp>
@@ -247,6 +248,93 @@ void RouteUpdater::removeAllRoutesForClient(RouterID rid, ClientID clientId) {
   removeAllRoutesForClientImpl<IPAddressV6>(getRibV6(rid), clientId);
 }
 
+template<typename PrefixT, typename RibT>
+void RouteUpdater::syncRoutesForClientImpl(
+    RibT* ribCloned,
+    ClientID clientId,
+    std::vector<std::pair<PrefixT, RouteNextHopEntry>> routes) {
+  using PrefixAndEntry = std::pair<PrefixT, RouteNextHopEntry>;
+  // Sort the new routes in RIB order. If a prefix is given more than once
+  // the last one wins, like it would with addRoute().
+  std::stable_sort(
+      routes.begin(),
+      routes.end(),
+      [](const PrefixAndEntry& a, const PrefixAndEntry& b) {
+        return a.first < b.first;
+      });
+  std::vector<PrefixAndEntry> newRoutes;
+  newRoutes.reserve(routes.size());
+  for (auto& route : routes) {
+    if (!newRoutes.empty() && newRoutes.back().first == route.first) {
+      newRoutes.back() = std::move(route);
+    } else {
+      newRoutes.push_back(std::move(route));
+    }
+  }
+
+  // Merge them with the current routes. Changes are only collected here, as
+  // applying them may modify the RIB we are walking.
+  std::vector<PrefixT> toDelete;
+  std::vector<PrefixAndEntry> toAdd;
+  const auto& oldRoutes = ribCloned->rib->routes()->getAllNodes();
+  auto oldIt = oldRoutes.begin();
+  for (auto& route : newRoutes) {
+    for (; oldIt != oldRoutes.end() && oldIt->first < route.first; ++oldIt) {
+      if (oldIt->second->getEntryForClient(clientId)) {
+        toDelete.push_back(oldIt->first);
+      }
+    }
+    if (oldIt != oldRoutes.end() && oldIt->first == route.first) {
+      bool unchanged = oldIt->second->has(clientId, route.second);
+      ++oldIt;
+      if (unchanged) {
+        continue;
+      }
+    }
+    toAdd.push_back(std::move(route));
+  }
+  for (; oldIt != oldRoutes.end(); ++oldIt) {
+    if (oldIt->second->getEntryForClient(clientId)) {
+      toDelete.push_back(oldIt->first);
+    }
+  }
+
+  XLOG(DBG2) << "Syncing " << newRoutes.size() << " routes for client "
+             << clientId << ": " << toAdd.size() << " added or changed, "
+             << toDelete.size() << " deleted";
+  for (const auto& prefix : toDelete) {
+    delRouteImpl(prefix, ribCloned, clientId);
+  }
+  for (auto& route : toAdd) {
+    addRouteImpl(route.first, ribCloned, clientId, std::move(route.second));
+  }
+}
+
+void RouteUpdater::syncRoutesForClient(
+    RouterID rid,
+    ClientID clientId,
+    std::vector<ClientRoute> routes) {
+  std::vector<std::pair<PrefixV4, RouteNextHopEntry>> routesV4;
+  std::vector<std::pair<PrefixV6, RouteNextHopEntry>> routesV6;
+  for (auto& route : routes) {
+    auto mask = route.mask;
+    if (route.network.isV4()) {
+      PrefixV4 prefix{route.network.asV4().mask(mask), mask};
+      routesV4.emplace_back(prefix, std::move(route.entry));
+    } else {
+      PrefixV6 prefix{route.network.asV6().mask(mask), mask};
+      if (prefix.network.isLinkLocal()) {
+        XLOG(DBG2) << "Ignoring v6 link-local interface route: "
+                   << prefix.str();
+        continue;
+      }
+      routesV6.emplace_back(prefix, std::move(route.entry));
+    }
+  }
+  syncRoutesForClientImpl(getRibV4(rid), clientId, std::move(routesV4));
+  syncRoutesForClientImpl(getRibV6(rid), clientId, std::move(routesV6));
+}
+
 // Some helper functions for recursive weight resolution
 // These aren't really usefully reusable, but structuring them
 // this way helps with clarifying their meaning.
@@ -20,6 +20,9 @@
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
 
+#include <utility>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
 namespace cfg {
@@ -77,6 +80,23 @@ class RouteUpdater {
   // method to delete all routes from a client
   void removeAllRoutesForClient(RouterID rid, ClientID clientId);
 
+  struct ClientRoute {
+    folly::IPAddress network;
+    uint8_t mask;
+    RouteNextHopEntry entry;
+  };
+
+  /*
+   * Make routes the only routes of a client. This has the same result as
+   * removeAllRoutesForClient() followed by addRoute() for each of the
+   * routes, but works out the difference with a sorted merge against the
+   * RIB first, and only touches the routes which really change.
+   */
+  void syncRoutesForClient(
+      RouterID rid,
+      ClientID clientId,
+      std::vector<ClientRoute> routes);
+
   std::shared_ptr<RouteTableMap> updateDone();
 
   // Add all interface routes (directly connected routes) and link local routes
@@ -124,6 +144,11 @@ class RouteUpdater {
   void delRouteImpl(const PrefixT& prefix, RibT *ribCloned, ClientID clientId);
   template<typename AddrT, typename RibT>
   void removeAllRoutesForClientImpl(RibT *ribCloned, ClientID clientId);
+  template<typename PrefixT, typename RibT>
+  void syncRoutesForClientImpl(
+      RibT* ribCloned,
+      ClientID clientId,
+      std::vector<std::pair<PrefixT, RouteNextHopEntry>> routes);
 
   // resolve all routes that are not resolved yet
   void resolve();
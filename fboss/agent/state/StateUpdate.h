@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <folly/IntrusiveList.h>
@@ -32,9 +33,28 @@ class SwitchState;
  */
 class StateUpdate {
  public:
-  explicit StateUpdate(folly::StringPiece name, bool allowCoalesce = true)
+  /*
+   * Pending updates are applied highest priority first, so small latency
+   * critical updates don't have to wait behind large ones. Updates of the
+   * same priority are applied in the order they were scheduled.
+   */
+  enum class Priority : uint8_t {
+    LINK_STATE,
+    NEIGHBOR,
+    ROUTE,
+    // Config changes, and anything else
+    DEFAULT,
+  };
+  static constexpr int kNumPriorities =
+      static_cast<int>(Priority::DEFAULT) + 1;
+
+  explicit StateUpdate(
+      folly::StringPiece name,
+      bool allowCoalesce = true,
+      Priority priority = Priority::DEFAULT)
       : name_(name.str()),
-        allowCoalesce_(allowCoalesce) {}
+        allowCoalesce_(allowCoalesce),
+        priority_(priority) {}
   virtual ~StateUpdate() {}
 
   const std::string& getName() const {
@@ -45,6 +65,10 @@ class StateUpdate {
     return allowCoalesce_;
   }
 
+  Priority getPriority() const {
+    return priority_;
+  }
+
   /*
    * Apply the update, and return a new SwitchState.
    *
@@ -85,6 +109,9 @@ class StateUpdate {
 
   std::string name_;
   bool allowCoalesce_;
+  Priority priority_;
+  // When the update was queued, set by the SwSwitch
+  std::chrono::steady_clock::time_point queued_;
 
   // An intrusive list hook for maintaining the list of pending updates.
   folly::IntrusiveListHook listHook_;
@@ -27,6 +27,13 @@
 
 #include "fboss/agent/state/NodeBase-defs.h"
 
+#include <folly/Conv.h>
+#include <folly/json.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
 using std::make_shared;
 using std::shared_ptr;
 using std::chrono::seconds;
@@ -109,9 +116,274 @@ SwitchStateFields::fromFollyDynamic(const folly::dynamic& swJson) {
   return switchState;
 }
 
+namespace {
+
+using Tokens = std::vector<std::string>;
+
+void appendJson(const folly::dynamic& json, std::string* out) {
+  out->append(folly::json::serialize(json, folly::json::serialization_opts{}));
+}
+
+void appendKey(folly::StringPiece key, std::string* out) {
+  appendJson(folly::dynamic(key), out);
+  out->push_back(':');
+}
+
+bool parseIndex(const std::string& token, size_t* index) {
+  if (token.empty() ||
+      !std::all_of(token.begin(), token.end(), [](unsigned char c) {
+        return std::isdigit(c);
+      })) {
+    return false;
+  }
+  *index = folly::to<size_t>(token);
+  return true;
+}
+
+// What tokens [pos, end) point to in json, as folly::dynamic's get_ptr()
+// would find it. nullptr if they don't point to anything.
+template <typename DynamicT>
+DynamicT* lookup(DynamicT& json, const Tokens& tokens, size_t pos) {
+  auto* cur = &json;
+  for (; pos < tokens.size() && cur; ++pos) {
+    size_t index;
+    if (cur->isObject()) {
+      cur = cur->get_ptr(tokens[pos]);
+    } else if (
+        cur->isArray() && parseIndex(tokens[pos], &index) &&
+        index < cur->size()) {
+      cur = &(*cur)[index];
+    } else {
+      cur = nullptr;
+    }
+  }
+  return cur;
+}
+
+bool writeDynamic(
+    const folly::dynamic& json,
+    const Tokens& tokens,
+    size_t pos,
+    std::string* out) {
+  const auto* part = lookup(json, tokens, pos);
+  if (!part) {
+    return false;
+  }
+  appendJson(*part, out);
+  return true;
+}
+
+template <typename MapT>
+void writeEntries(const MapT& map, std::string* out) {
+  out->push_back('[');
+  bool first = true;
+  for (const auto& node : map) {
+    if (!first) {
+      out->push_back(',');
+    }
+    first = false;
+    appendJson(node->toFollyDynamic(), out);
+  }
+  out->push_back(']');
+}
+
+// Write what tokens [pos, end) point to in map->toFollyDynamic(), for the
+// maps using the NodeMapT serialization
+template <typename MapT>
+bool writeNodeMap(
+    const MapT& map,
+    const Tokens& tokens,
+    size_t pos,
+    std::string* out) {
+  if (pos == tokens.size()) {
+    // Build one entry at a time rather than the whole map
+    out->push_back('{');
+    appendKey(MapT::kEntries, out);
+    writeEntries(map, out);
+    out->push_back(',');
+    appendKey(MapT::kExtraFields, out);
+    appendJson(map.getExtraFields().toFollyDynamic(), out);
+    out->push_back('}');
+    return true;
+  }
+  if (tokens[pos] == MapT::kExtraFields) {
+    return writeDynamic(
+        map.getExtraFields().toFollyDynamic(), tokens, pos + 1, out);
+  }
+  if (tokens[pos] != MapT::kEntries) {
+    return false;
+  }
+  if (pos + 1 == tokens.size()) {
+    writeEntries(map, out);
+    return true;
+  }
+  size_t index;
+  if (!parseIndex(tokens[pos + 1], &index) || index >= map.size()) {
+    return false;
+  }
+  auto it = map.begin();
+  std::advance(it, index);
+  return writeDynamic((*it)->toFollyDynamic(), tokens, pos + 2, out);
+}
+
+// Apply patch to what tokens [pos, end) point to in json
+folly::dynamic patchDynamic(
+    folly::dynamic json,
+    const Tokens& tokens,
+    size_t pos,
+    const folly::dynamic& patch) {
+  auto* part = lookup(json, tokens, pos);
+  if (!part) {
+    throw FbossError("JSON Pointer does not address proper object");
+  }
+  // mutates in place, i.e. modifies json too
+  part->merge_patch(patch);
+  return json;
+}
+
+// Apply patch to what tokens [pos, end) point to in map->toFollyDynamic(),
+// for the maps using the NodeMapT serialization. Only the entry patched is
+// deserialized again when tokens point into one, so the other entries are
+// shared with map.
+template <typename MapT>
+std::shared_ptr<MapT> patchNodeMap(
+    const std::shared_ptr<MapT>& map,
+    const Tokens& tokens,
+    size_t pos,
+    const folly::dynamic& patch) {
+  size_t index;
+  if (tokens.size() < pos + 2 || tokens[pos] != MapT::kEntries ||
+      !parseIndex(tokens[pos + 1], &index) || index >= map->size()) {
+    return MapT::fromFollyDynamic(
+        patchDynamic(map->toFollyDynamic(), tokens, pos, patch));
+  }
+  auto it = map->begin();
+  std::advance(it, index);
+  const auto& oldNode = *it;
+  auto newNode = MapT::Node::fromFollyDynamic(
+      patchDynamic(oldNode->toFollyDynamic(), tokens, pos + 2, patch));
+
+  auto newMap = map->clone();
+  auto oldKey = MapT::Traits::getKey(oldNode);
+  if (MapT::Traits::getKey(newNode) == oldKey) {
+    newMap->updateNode(newNode);
+  } else {
+    newMap->removeNode(oldKey);
+    newMap->addNode(newNode);
+  }
+  return newMap;
+}
+
+} // unnamed namespace
+
 SwitchState::SwitchState() {
 }
 
+std::shared_ptr<SwitchState> SwitchState::patchJson(
+    const std::shared_ptr<SwitchState>& state,
+    const folly::json_pointer& ptr,
+    const folly::dynamic& patch) {
+  const auto& tokens = ptr.tokens();
+  if (tokens.empty()) {
+    return fromFollyDynamic(
+        patchDynamic(state->toFollyDynamic(), tokens, 0, patch));
+  }
+
+  const auto& fields = *state->getFields();
+  const auto& key = tokens[0];
+  auto newState = state->clone();
+  if (key == kPorts) {
+    newState->resetPorts(patchNodeMap(fields.ports, tokens, 1, patch));
+  } else if (key == kVlans) {
+    newState->resetVlans(patchNodeMap(fields.vlans, tokens, 1, patch));
+  } else if (key == kRouteTables) {
+    newState->resetRouteTables(
+        patchNodeMap(fields.routeTables, tokens, 1, patch));
+  } else if (key == kAcls) {
+    newState->resetAcls(patchNodeMap(fields.acls, tokens, 1, patch));
+  } else if (key == kSflowCollectors) {
+    newState->resetSflowCollectors(
+        patchNodeMap(fields.sFlowCollectors, tokens, 1, patch));
+  } else if (key == kMirrors) {
+    newState->resetMirrors(patchNodeMap(fields.mirrors, tokens, 1, patch));
+  } else if (key == kInterfaces) {
+    newState->resetIntfs(InterfaceMap::fromFollyDynamic(patchDynamic(
+        fields.interfaces->toFollyDynamic(), tokens, 1, patch)));
+  } else if (key == kLoadBalancers) {
+    newState->resetLoadBalancers(LoadBalancerMap::fromFollyDynamic(patchDynamic(
+        fields.loadBalancers->toFollyDynamic(), tokens, 1, patch)));
+  } else if (key == kControlPlane) {
+    newState->resetControlPlane(ControlPlane::fromFollyDynamic(patchDynamic(
+        fields.controlPlane->toFollyDynamic(), tokens, 1, patch)));
+  } else if (key == kDefaultVlan) {
+    auto defaultVlan = patchDynamic(
+        folly::dynamic(static_cast<uint32_t>(fields.defaultVlan)),
+        tokens,
+        1,
+        patch);
+    newState->setDefaultVlan(VlanID(defaultVlan.asInt()));
+  } else {
+    throw FbossError("JSON Pointer does not address proper object");
+  }
+  return newState;
+}
+
+bool SwitchState::writeJson(
+    const folly::json_pointer& ptr,
+    std::string* out) const {
+  const auto& tokens = ptr.tokens();
+  if (tokens.empty()) {
+    // Write out the members one by one, see SwitchStateFields
+    out->push_back('{');
+    bool first = true;
+    for (auto key : {kInterfaces, kPorts, kVlans, kRouteTables, kAcls,
+                     kSflowCollectors, kDefaultVlan, kControlPlane,
+                     kLoadBalancers, kMirrors}) {
+      if (!first) {
+        out->push_back(',');
+      }
+      first = false;
+      appendKey(key, out);
+      auto written = writeJson(folly::json_pointer::parse(
+          folly::to<std::string>("/", key)), out);
+      DCHECK(written);
+    }
+    out->push_back('}');
+    return true;
+  }
+
+  const auto& fields = *getFields();
+  const auto& key = tokens[0];
+  if (key == kPorts) {
+    return writeNodeMap(*fields.ports, tokens, 1, out);
+  } else if (key == kVlans) {
+    return writeNodeMap(*fields.vlans, tokens, 1, out);
+  } else if (key == kRouteTables) {
+    return writeNodeMap(*fields.routeTables, tokens, 1, out);
+  } else if (key == kAcls) {
+    return writeNodeMap(*fields.acls, tokens, 1, out);
+  } else if (key == kSflowCollectors) {
+    return writeNodeMap(*fields.sFlowCollectors, tokens, 1, out);
+  } else if (key == kMirrors) {
+    return writeNodeMap(*fields.mirrors, tokens, 1, out);
+  } else if (key == kInterfaces) {
+    // Serialized as a plain array, and small
+    return writeDynamic(fields.interfaces->toFollyDynamic(), tokens, 1, out);
+  } else if (key == kLoadBalancers) {
+    return writeDynamic(
+        fields.loadBalancers->toFollyDynamic(), tokens, 1, out);
+  } else if (key == kControlPlane) {
+    return writeDynamic(fields.controlPlane->toFollyDynamic(), tokens, 1, out);
+  } else if (key == kDefaultVlan) {
+    return writeDynamic(
+        folly::dynamic(static_cast<uint32_t>(fields.defaultVlan)),
+        tokens,
+        1,
+        out);
+  }
+  return false;
+}
+
 SwitchState::~SwitchState() {
 }
 
@@ -253,6 +525,11 @@ const std::shared_ptr<ForwardingInformationBaseMap>& SwitchState::getFibs()
   return getFields()->fibs;
 }
 
+void SwitchState::resetFibs(
+    std::shared_ptr<ForwardingInformationBaseMap> fibs) {
+  writableFields()->fibs.swap(fibs);
+}
+
 template class NodeBaseT<SwitchState, SwitchStateFields>;
 
 }} // facebook::fboss
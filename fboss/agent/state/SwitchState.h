@@ -14,6 +14,7 @@
 
 #include <folly/FBString.h>
 #include <folly/dynamic.h>
+#include <folly/json_pointer.h>
 #include <folly/Memory.h>
 
 #include "fboss/agent/state/AclMap.h"
@@ -161,6 +162,27 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
     return getFields()->toFollyDynamic();
   }
 
+  /*
+   * Append to out the JSON serialization of the part of toFollyDynamic()
+   * that ptr points to, without serializing the rest of the state. Node
+   * maps are followed down to the entry ptr points to, and written out one
+   * entry at a time when ptr points to a whole map. Returns false if ptr
+   * doesn't point to anything.
+   */
+  bool writeJson(const folly::json_pointer& ptr, std::string* out) const;
+
+  /*
+   * Return a clone of state with patch merged into the part of
+   * toFollyDynamic() that ptr points to. Only that part is deserialized
+   * again: when ptr points into a node map entry, the other entries are
+   * shared with state, so the StateDelta is no bigger than the patch.
+   * Throws FbossError if ptr doesn't point to anything.
+   */
+  static std::shared_ptr<SwitchState> patchJson(
+      const std::shared_ptr<SwitchState>& state,
+      const folly::json_pointer& ptr,
+      const folly::dynamic& patch);
+
   static void modify(std::shared_ptr<SwitchState>* state);
 
   template <typename EntryClassT, typename NTableT>
@@ -302,6 +324,7 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
   void resetControlPlane(std::shared_ptr<ControlPlane> cpu);
   void resetLoadBalancers(std::shared_ptr<LoadBalancerMap> loadBalancers);
   void resetMirrors(std::shared_ptr<MirrorMap> mirrors);
+  void resetFibs(std::shared_ptr<ForwardingInformationBaseMap> fibs);
 
  private:
   // Inherit the constructor required for clone()
@@ -65,6 +65,7 @@ VlanFields::PortInfo::fromFollyDynamic(const folly::dynamic& json) {
 VlanFields::VlanFields(VlanID _id, string _name)
   : id(_id),
     name(std::move(_name)),
+    configFields(std::make_shared<ConfigFields>()),
     arpTable(new ArpTable),
     arpResponseTable(new ArpResponseTable),
     ndpTable(new NdpTable),
@@ -80,13 +81,14 @@ VlanFields::VlanFields(VlanID _id,
   : id(_id),
     name(std::move(_name)),
     intfID(_intfID),
-    dhcpV4Relay(v4Relay),
-    dhcpV6Relay(v6Relay),
-    ports(std::move(ports)),
+    configFields(std::make_shared<ConfigFields>()),
     arpTable(new ArpTable),
     arpResponseTable(new ArpResponseTable),
     ndpTable(new NdpTable),
     ndpResponseTable(new NdpResponseTable) {
+  configFields->dhcpV4Relay = v4Relay;
+  configFields->dhcpV6Relay = v6Relay;
+  configFields->ports = std::move(ports);
 }
 
 folly::dynamic VlanFields::toFollyDynamic() const {
@@ -94,18 +96,19 @@ folly::dynamic VlanFields::toFollyDynamic() const {
   vlan[kVlanId] = static_cast<uint16_t>(id);
   vlan[kVlanName] = name;
   vlan[kIntfID] = static_cast<uint32_t>(intfID);
-  vlan[kDhcpV4Relay] = dhcpV4Relay.str();
-  vlan[kDhcpV6Relay] = dhcpV6Relay.str();
+  const auto& vlanConfig = getConfigFields();
+  vlan[kDhcpV4Relay] = vlanConfig.dhcpV4Relay.str();
+  vlan[kDhcpV6Relay] = vlanConfig.dhcpV6Relay.str();
   vlan[kDhcpV4RelayOverrides] = folly::dynamic::object;
-  for (const auto& o: dhcpRelayOverridesV4) {
+  for (const auto& o: vlanConfig.dhcpRelayOverridesV4) {
     vlan[kDhcpV4RelayOverrides][o.first.toString()] = o.second.str();
   }
   vlan[kDhcpV6RelayOverrides] = folly::dynamic::object;
-  for (const auto& o: dhcpRelayOverridesV6) {
+  for (const auto& o: vlanConfig.dhcpRelayOverridesV6) {
     vlan[kDhcpV6RelayOverrides][o.first.toString()] = o.second.str();
   }
   folly::dynamic memberPorts = folly::dynamic::object;
-  for (const auto& port: ports) {
+  for (const auto& port: vlanConfig.ports) {
     folly::dynamic portInfo = folly::dynamic::object;
     memberPorts[to<string>(static_cast<uint16_t>(port.first))] =
         port.second.toFollyDynamic();
@@ -122,21 +125,23 @@ VlanFields VlanFields::fromFollyDynamic(const folly::dynamic& vlanJson) {
   VlanFields vlan(VlanID(vlanJson[kVlanId].asInt()),
       vlanJson[kVlanName].asString());
   vlan.intfID = InterfaceID(vlanJson[kIntfID].asInt());
-  vlan.dhcpV4Relay = folly::IPAddressV4(
+  auto* vlanConfig = vlan.writableConfigFields();
+  vlanConfig->dhcpV4Relay = folly::IPAddressV4(
       vlanJson[kDhcpV4Relay].stringPiece());
-  vlan.dhcpV6Relay = folly::IPAddressV6(
+  vlanConfig->dhcpV6Relay = folly::IPAddressV6(
       vlanJson[kDhcpV6Relay].stringPiece());
   for (const auto& o: vlanJson[kDhcpV4RelayOverrides].items()) {
-    vlan.dhcpRelayOverridesV4[MacAddress(o.first.asString())] =
+    vlanConfig->dhcpRelayOverridesV4[MacAddress(o.first.asString())] =
         folly::IPAddressV4(o.second.stringPiece());
   }
   for (const auto& o: vlanJson[kDhcpV6RelayOverrides].items()) {
-    vlan.dhcpRelayOverridesV6[MacAddress(o.first.asString())] =
+    vlanConfig->dhcpRelayOverridesV6[MacAddress(o.first.asString())] =
         folly::IPAddressV6(o.second.stringPiece());
   }
   for (const auto& portInfo: vlanJson[kMemberPorts].items()) {
-    vlan.ports.emplace(PortID(to<uint16_t>(portInfo.first.asString())),
-          PortInfo::fromFollyDynamic(portInfo.second));
+    vlanConfig->ports.emplace(
+        PortID(to<uint16_t>(portInfo.first.asString())),
+        PortInfo::fromFollyDynamic(portInfo.second));
   }
   vlan.arpTable = ArpTable::fromFollyDynamic(vlanJson[kArpTable]);
   vlan.ndpTable = NdpTable::fromFollyDynamic(vlanJson[kNdpTable]);
@@ -189,7 +194,8 @@ Vlan* Vlan::modify(std::shared_ptr<SwitchState>* state) {
 }
 
 void Vlan::addPort(PortID id, bool tagged) {
-  writableFields()->ports.insert(make_pair(id, PortInfo(tagged)));
+  writableFields()->writableConfigFields()->ports.insert(
+      make_pair(id, PortInfo(tagged)));
 }
 
 template class NodeBaseT<Vlan, VlanFields>;
@@ -20,9 +20,10 @@
 #include "fboss/agent/state/NdpTable.h"
 
 #include <boost/container/flat_map.hpp>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
-#include <map>
 
 namespace facebook { namespace fboss {
 
@@ -52,6 +53,30 @@ struct VlanFields {
   };
   typedef boost::container::flat_map<PortID, PortInfo> MemberPorts;
 
+  /*
+   * The settings which only change with config. These are shared between
+   * clones of a Vlan until one of them writes to its copy, so that cloning a
+   * Vlan for a neighbor table update doesn't copy its member ports and DHCP
+   * relay overrides.
+   */
+  struct ConfigFields {
+    // DHCP server IP for the DHCP relay
+    folly::IPAddressV4 dhcpV4Relay;
+    folly::IPAddressV6 dhcpV6Relay;
+    DhcpV4OverrideMap dhcpRelayOverridesV4;
+    DhcpV6OverrideMap dhcpRelayOverridesV6;
+    // The list of ports in the VLAN.
+    // We only store PortIDs, and not pointers to the actual Port objects.
+    // This way VLAN objects don't need to change when a Port object is
+    // modified.
+    //
+    // (Port state is copy-on-write, so when it changes a new copy of the Port
+    // object is created.  If we pointed at the Port object here we would also
+    // have to modify the Vlan object.  By storing only the PortID the Vlan
+    // does not need to be modified.)
+    MemberPorts ports;
+  };
+
   VlanFields(VlanID id, std::string name);
   VlanFields(VlanID id,
              std::string name,
@@ -71,23 +96,22 @@ struct VlanFields {
   folly::dynamic toFollyDynamic() const;
   static VlanFields fromFollyDynamic(const folly::dynamic& vlanJson);
 
+  const ConfigFields& getConfigFields() const {
+    return *configFields;
+  }
+  ConfigFields* writableConfigFields() {
+    // Nothing else can take a reference to the ConfigFields of the
+    // (unpublished) node being written while we are checking
+    if (configFields.use_count() > 1) {
+      configFields = std::make_shared<ConfigFields>(*configFields);
+    }
+    return configFields.get();
+  }
+
   const VlanID id{0};
   std::string name;
   InterfaceID intfID{0};
-  // DHCP server IP for the DHCP relay
-  folly::IPAddressV4 dhcpV4Relay;
-  folly::IPAddressV6 dhcpV6Relay;
-  DhcpV4OverrideMap dhcpRelayOverridesV4;
-  DhcpV6OverrideMap dhcpRelayOverridesV6;
-  // The list of ports in the VLAN.
-  // We only store PortIDs, and not pointers to the actual Port objects.
-  // This way VLAN objects don't need to change when a Port object is modified.
-  //
-  // (Port state is copy-on-write, so when it changes a new copy of the Port
-  // object is created.  If we pointed at the Port object here we would also
-  // have to modify the Vlan object.  By storing only the PortID the Vlan does
-  // not need to be modified.)
-  MemberPorts ports;
+  std::shared_ptr<ConfigFields> configFields;
   std::shared_ptr<ArpTable> arpTable;
   std::shared_ptr<ArpResponseTable> arpResponseTable;
   std::shared_ptr<NdpTable> ndpTable;
@@ -138,10 +162,10 @@ class Vlan : public NodeBaseT<Vlan, VlanFields> {
   }
 
   const MemberPorts& getPorts() const {
-    return getFields()->ports;
+    return getFields()->getConfigFields().ports;
   }
   void setPorts(MemberPorts ports) {
-    writableFields()->ports.swap(ports);
+    writableFields()->writableConfigFields()->ports.swap(ports);
   }
 
   Vlan* modify(std::shared_ptr<SwitchState>* state);
@@ -188,33 +212,33 @@ class Vlan : public NodeBaseT<Vlan, VlanFields> {
   // dhcp relay
 
   folly::IPAddressV4 getDhcpV4Relay() const {
-    return getFields()->dhcpV4Relay;
+    return getFields()->getConfigFields().dhcpV4Relay;
   }
   void setDhcpV4Relay(folly::IPAddressV4 v4Relay) {
-     writableFields()->dhcpV4Relay = v4Relay;
+     writableFields()->writableConfigFields()->dhcpV4Relay = v4Relay;
   }
 
   folly::IPAddressV6 getDhcpV6Relay() const {
-    return getFields()->dhcpV6Relay;
+    return getFields()->getConfigFields().dhcpV6Relay;
   }
   void setDhcpV6Relay(folly::IPAddressV6 v6Relay) {
-     writableFields()->dhcpV6Relay = v6Relay;
+     writableFields()->writableConfigFields()->dhcpV6Relay = v6Relay;
   }
 
   // dhcp overrides
 
   DhcpV4OverrideMap getDhcpV4RelayOverrides() const {
-    return getFields()->dhcpRelayOverridesV4;
+    return getFields()->getConfigFields().dhcpRelayOverridesV4;
   }
   void setDhcpV4RelayOverrides(DhcpV4OverrideMap map) {
-    writableFields()->dhcpRelayOverridesV4 = map;
+    writableFields()->writableConfigFields()->dhcpRelayOverridesV4 = map;
   }
 
   DhcpV6OverrideMap getDhcpV6RelayOverrides() const {
-    return getFields()->dhcpRelayOverridesV6;
+    return getFields()->getConfigFields().dhcpRelayOverridesV6;
   }
   void setDhcpV6RelayOverrides(DhcpV6OverrideMap map) {
-    writableFields()->dhcpRelayOverridesV6 = map;
+    writableFields()->writableConfigFields()->dhcpRelayOverridesV6 = map;
   }
 
   /*
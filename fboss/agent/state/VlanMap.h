@@ -11,13 +11,19 @@
 
 #include <string>
 #include "fboss/agent/types.h"
+#include "fboss/agent/state/DenseIdMap.h"
 #include "fboss/agent/state/NodeMap.h"
 
 namespace facebook { namespace fboss {
 
 class SwitchState;
 class Vlan;
-typedef NodeMapTraits<VlanID, Vlan> VlanMapTraits;
+
+struct VlanMapTraits : NodeMapTraits<VlanID, Vlan> {
+  // VLANs are looked up by ID for every packet, and the IDs mostly come in
+  // ranges
+  using NodeContainer = DenseIdMap<VlanID, std::shared_ptr<Vlan>>;
+};
 
 /*
  * A container for the set of VLANs.
@@ -14,12 +14,16 @@
 #include "fboss/agent/state/AclMap.h"
 #include "fboss/agent/state/AclEntry.h"
 #include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/SflowCollectorMap.h"
 #include "fboss/agent/state/SwitchState.h"
 
+#include <folly/Conv.h>
 #include <folly/IPAddress.h>
 #include <folly/MacAddress.h>
 #include <gtest/gtest.h>
 
+#include <iterator>
+
 using namespace facebook::fboss;
 using std::make_pair;
 using std::make_shared;
@@ -29,6 +33,8 @@ using folly::MacAddress;
 namespace {
 // We offset the start point in ApplyThriftConfig
 constexpr auto kAclStartPriority = 100000;
+// and leave gaps between acls
+constexpr auto kAclPriorityGap = 16;
 }
 
 TEST(Acl, applyConfig) {
@@ -221,6 +227,55 @@ TEST(Acl, applyConfig) {
   EXPECT_FALSE(aclV7->getDstMac());
 }
 
+TEST(Acl, applyConfigCache) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+  stateV0->registerPort(PortID(1), "port1");
+
+  cfg::SwitchConfig config;
+  config.ports.resize(1);
+  config.ports[0].logicalID = 1;
+  config.ports[0].name = "port1";
+  config.ports[0].state = cfg::PortState::ENABLED;
+  config.acls.resize(1);
+  config.acls[0].name = "acl1";
+  config.acls[0].actionType = cfg::AclActionType::DENY;
+  config.acls[0].__isset.srcPort = true;
+  config.acls[0].srcPort = 5;
+
+  AppliedConfigCache cache;
+  auto stateV1 = publishAndApplyConfig(
+      stateV0, &config, platform.get(), nullptr, &cache);
+  ASSERT_NE(nullptr, stateV1);
+  EXPECT_EQ(stateV1->getAcls(), cache.acls);
+
+  // Only the port changed, the ACLs we built are kept
+  config.ports[0].name = "port1.renamed";
+  auto stateV2 = publishAndApplyConfig(
+      stateV1, &config, platform.get(), nullptr, &cache);
+  ASSERT_NE(nullptr, stateV2);
+  EXPECT_EQ(stateV1->getAcls(), stateV2->getAcls());
+  EXPECT_EQ("port1.renamed", stateV2->getPort(PortID(1))->getName());
+
+  // The ACLs were changed behind the config's back, so are rebuilt
+  stateV2->publish();
+  auto stateV3 = stateV2;
+  stateV3->getAcls()->modify(&stateV3)->removeEntry("acl1");
+  auto stateV4 = publishAndApplyConfig(
+      stateV3, &config, platform.get(), nullptr, &cache);
+  ASSERT_NE(nullptr, stateV4);
+  ASSERT_NE(nullptr, stateV4->getAcl("acl1"));
+  EXPECT_EQ(5, stateV4->getAcl("acl1")->getSrcPort());
+
+  // And so are ACLs whose config changed
+  config.acls[0].srcPort = 7;
+  auto stateV5 = publishAndApplyConfig(
+      stateV4, &config, platform.get(), nullptr, &cache);
+  ASSERT_NE(nullptr, stateV5);
+  EXPECT_EQ(7, stateV5->getAcl("acl1")->getSrcPort());
+  EXPECT_EQ(stateV5->getAcls(), cache.acls);
+}
+
 TEST(Acl, stateDelta) {
   auto platform = createMockPlatform();
   auto stateV0 = make_shared<SwitchState>();
@@ -292,6 +347,91 @@ TEST(Acl, stateDelta) {
   EXPECT_EQ(iter, aclDelta45.end());
 }
 
+TEST(Acl, stablePriorities) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  config.acls.resize(4);
+  for (int i = 0; i < 4; ++i) {
+    config.acls[i].name = folly::to<std::string>("acl", i);
+    config.acls[i].actionType = cfg::AclActionType::DENY;
+    config.acls[i].__isset.srcPort = true;
+    config.acls[i].srcPort = i;
+  }
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+
+  auto countChanges = [](const StateDelta& delta) {
+    auto aclDelta = delta.getAclsDelta();
+    return std::distance(aclDelta.begin(), aclDelta.end());
+  };
+
+  // Inserting at the top leaves every other acl where it was
+  cfg::AclEntry top;
+  top.name = "top";
+  top.actionType = cfg::AclActionType::DENY;
+  config.acls.insert(config.acls.begin(), top);
+  auto stateV2 = publishAndApplyConfig(stateV1, &config, platform.get());
+  ASSERT_NE(nullptr, stateV2);
+  EXPECT_EQ(1, countChanges(StateDelta(stateV1, stateV2)));
+  EXPECT_LT(
+      stateV2->getAcl("top")->getPriority(),
+      stateV2->getAcl("acl0")->getPriority());
+  for (int i = 0; i < 4; ++i) {
+    auto name = folly::to<std::string>("acl", i);
+    EXPECT_EQ(stateV1->getAcl(name), stateV2->getAcl(name));
+  }
+
+  // And so does inserting in the middle
+  cfg::AclEntry middle;
+  middle.name = "middle";
+  middle.actionType = cfg::AclActionType::DENY;
+  config.acls.insert(config.acls.begin() + 3, middle);
+  auto stateV3 = publishAndApplyConfig(stateV2, &config, platform.get());
+  ASSERT_NE(nullptr, stateV3);
+  EXPECT_EQ(1, countChanges(StateDelta(stateV2, stateV3)));
+  EXPECT_LT(
+      stateV3->getAcl("acl1")->getPriority(),
+      stateV3->getAcl("middle")->getPriority());
+  EXPECT_LT(
+      stateV3->getAcl("middle")->getPriority(),
+      stateV3->getAcl("acl2")->getPriority());
+
+  // Moving an acl only changes that acl
+  std::swap(config.acls[1], config.acls[2]);
+  auto stateV4 = publishAndApplyConfig(stateV3, &config, platform.get());
+  ASSERT_NE(nullptr, stateV4);
+  EXPECT_EQ(2, countChanges(StateDelta(stateV3, stateV4)));
+  EXPECT_LT(
+      stateV4->getAcl("acl1")->getPriority(),
+      stateV4->getAcl("acl0")->getPriority());
+
+  // Removing one leaves the others alone
+  config.acls.erase(config.acls.begin() + 3);
+  auto stateV5 = publishAndApplyConfig(stateV4, &config, platform.get());
+  ASSERT_NE(nullptr, stateV5);
+  EXPECT_EQ(1, countChanges(StateDelta(stateV4, stateV5)));
+  EXPECT_EQ(nullptr, stateV5->getAcl("middle"));
+
+  // Once a gap runs out everything is spread out again
+  for (int i = 0; i < 40; ++i) {
+    cfg::AclEntry filler;
+    filler.name = folly::to<std::string>("filler", i);
+    filler.actionType = cfg::AclActionType::DENY;
+    config.acls.insert(config.acls.begin() + 3, filler);
+  }
+  auto stateV6 = publishAndApplyConfig(stateV5, &config, platform.get());
+  ASSERT_NE(nullptr, stateV6);
+  EXPECT_EQ(kAclStartPriority, stateV6->getAcl("top")->getPriority());
+  int lastPriority = -1;
+  for (const auto& acl : config.acls) {
+    auto priority = stateV6->getAcl(acl.name)->getPriority();
+    EXPECT_LT(lastPriority, priority);
+    lastPriority = priority;
+  }
+}
+
 TEST(Acl, Icmp) {
   auto platform = createMockPlatform();
   auto stateV0 = make_shared<SwitchState>();
@@ -420,13 +560,14 @@ TEST(Acl, AclGeneration) {
   EXPECT_NE(acls->getEntryIf("acl5"), nullptr);
 
   EXPECT_EQ(acls->getEntryIf("acl1")->getPriority(), kAclStartPriority);
-  EXPECT_EQ(acls->getEntryIf("acl4")->getPriority(), kAclStartPriority + 1);
+  EXPECT_EQ(acls->getEntryIf("acl4")->getPriority(),
+      kAclStartPriority + kAclPriorityGap);
   EXPECT_EQ(acls->getEntryIf("acl2")->getPriority(),
-      kAclStartPriority + 2);
+      kAclStartPriority + 2 * kAclPriorityGap);
   EXPECT_EQ(acls->getEntryIf("acl3")->getPriority(),
-      kAclStartPriority + 3);
+      kAclStartPriority + 3 * kAclPriorityGap);
   EXPECT_EQ(acls->getEntryIf("acl5")->getPriority(),
-      kAclStartPriority + 4);
+      kAclStartPriority + 4 * kAclPriorityGap);
 
   // Ensure that the global actions in global traffic policy has been added to
   // the ACL entries
@@ -697,3 +838,43 @@ TEST(Acl, DstIpLocal) {
   EXPECT_NE(nullptr, aclV1);
   EXPECT_TRUE(aclV1->getDstIpLocal());
 }
+
+TEST(Acl, reachabilityConfig) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+  stateV0->registerPort(PortID(1), "port1");
+
+  cfg::SwitchConfig config;
+  config.ports.resize(1);
+  config.ports[0].logicalID = 1;
+  config.ports[0].name = "port1";
+  config.ports[0].state = cfg::PortState::ENABLED;
+  config.ports[0].sFlowIngressRate = 100;
+  config.acls.resize(1);
+  config.acls[0].name = "acl1";
+  config.acls[0].actionType = cfg::AclActionType::DENY;
+  config.acls[0].__isset.dstIp = true;
+  config.acls[0].dstIp = "192.168.0.0/24";
+  config.sFlowCollectors.resize(1);
+  config.sFlowCollectors[0].ip = "2401:db00:1:9000::a";
+  config.sFlowCollectors[0].port = 6343;
+
+  // The ports are there, the ACLs and sFlow aren't
+  auto reduced = reachabilityConfig(config);
+  auto stateV1 = publishAndApplyConfig(stateV0, &reduced, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+  auto port = stateV1->getPorts()->getPort(PortID(1));
+  EXPECT_EQ(cfg::PortState::ENABLED, port->getAdminState());
+  EXPECT_EQ(0, port->getSflowIngressRate());
+  EXPECT_EQ(0, stateV1->getAcls()->size());
+  EXPECT_EQ(0, stateV1->getSflowCollectors()->size());
+
+  // And come with the full config
+  auto stateV2 =
+      publishAndApplyConfig(stateV1, &config, platform.get(), &reduced);
+  ASSERT_NE(nullptr, stateV2);
+  EXPECT_NE(nullptr, stateV2->getAcl("acl1"));
+  EXPECT_EQ(1, stateV2->getSflowCollectors()->size());
+  EXPECT_EQ(
+      100, stateV2->getPorts()->getPort(PortID(1))->getSflowIngressRate());
+}
@@ -496,6 +496,40 @@ TEST(AggregatePort, multiTrunkAdd) {
   checkChangedAggPorts(startAggPorts, endAggPorts, {}, {55, 155}, {});
 }
 
+TEST(AggregatePort, memberPortLookup) {
+  MockPlatform platform;
+
+  auto config = testConfigA();
+  config.aggregatePorts.resize(2);
+  config.aggregatePorts[0].key = 55;
+  config.aggregatePorts[0].name = "lag55";
+  setAggregatePortMemberIDs(config.aggregatePorts[0].memberPorts, {1, 2});
+  config.aggregatePorts[1].key = 155;
+  config.aggregatePorts[1].name = "lag155";
+  setAggregatePortMemberIDs(config.aggregatePorts[1].memberPorts, {15, 20});
+
+  auto state = publishAndApplyConfig(testStateA(), &config, &platform);
+  ASSERT_NE(nullptr, state);
+  auto aggPorts = state->getAggregatePorts();
+
+  // The same answers before publishing, from a scan, and after, from the
+  // member port index
+  for (auto published : {false, true}) {
+    if (published) {
+      state->publish();
+    }
+    EXPECT_EQ(published, aggPorts->isPublished());
+    EXPECT_EQ(
+        aggPorts->getAggregatePortIf(AggregatePortID(55)),
+        aggPorts->getAggregatePortIf(PortID(2)));
+    EXPECT_EQ(
+        aggPorts->getAggregatePortIf(AggregatePortID(155)),
+        aggPorts->getAggregatePortIf(PortID(20)));
+    EXPECT_EQ(nullptr, aggPorts->getAggregatePortIf(PortID(3)));
+    EXPECT_EQ(nullptr, aggPorts->getAggregatePortIf(PortID(1000)));
+  }
+}
+
 TEST(AggregatePort, multiTrunkIdempotence) {
   MockPlatform platform;
 
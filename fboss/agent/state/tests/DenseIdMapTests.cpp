@@ -0,0 +1,144 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/DenseIdMap.h"
+
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+
+#include <folly/Conv.h>
+
+#include <map>
+#include <memory>
+#include <random>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+namespace {
+using TestMap = DenseIdMap<int, std::shared_ptr<int>>;
+
+void checkEqual(const std::map<int, int>& expected, const TestMap& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  auto it = actual.begin();
+  for (const auto& entry : expected) {
+    ASSERT_NE(actual.end(), it);
+    EXPECT_EQ(entry.first, it->first);
+    EXPECT_EQ(entry.second, *it->second);
+    auto found = actual.find(entry.first);
+    ASSERT_NE(actual.end(), found);
+    EXPECT_EQ(entry.second, *found->second);
+    ++it;
+  }
+  EXPECT_EQ(actual.end(), it);
+}
+} // namespace
+
+TEST(DenseIdMap, insertFindErase) {
+  TestMap map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.end(), map.find(1));
+
+  for (int i = 20; i > 0; --i) {
+    EXPECT_TRUE(map.insert({i, std::make_shared<int>(i * 10)}).second);
+  }
+  EXPECT_TRUE(map.isIndexed());
+  auto ret = map.emplace(5, std::make_shared<int>(0));
+  EXPECT_FALSE(ret.second);
+  EXPECT_EQ(50, *ret.first->second);
+
+  std::map<int, int> expected;
+  for (int i = 1; i <= 20; ++i) {
+    expected[i] = i * 10;
+  }
+  checkEqual(expected, map);
+  EXPECT_EQ(map.end(), map.find(0));
+  EXPECT_EQ(map.end(), map.find(21));
+  EXPECT_EQ(map.end(), map.find(-5));
+
+  EXPECT_EQ(1, map.erase(7));
+  EXPECT_EQ(0, map.erase(7));
+  expected.erase(7);
+  auto next = map.erase(map.find(1));
+  expected.erase(1);
+  EXPECT_EQ(2, next->first);
+  checkEqual(expected, map);
+  EXPECT_EQ(map.end(), map.find(7));
+}
+
+TEST(DenseIdMap, sparseKeys) {
+  // Far apart IDs are binary searched rather than indexed
+  TestMap map;
+  map.insert({1, std::make_shared<int>(1)});
+  map.insert({4094, std::make_shared<int>(4094)});
+  EXPECT_FALSE(map.isIndexed());
+  checkEqual({{1, 1}, {4094, 4094}}, map);
+  EXPECT_EQ(map.end(), map.find(2));
+
+  // An offset range is still dense
+  TestMap offset;
+  for (int i = 2000; i < 2100; ++i) {
+    offset.insert({i, std::make_shared<int>(i)});
+  }
+  EXPECT_TRUE(offset.isIndexed());
+  EXPECT_EQ(2050, *offset.find(2050)->second);
+  EXPECT_EQ(offset.end(), offset.find(1999));
+
+  // Erasing entries until the keys are sparse drops the index
+  offset.insert({2300, std::make_shared<int>(2300)});
+  EXPECT_TRUE(offset.isIndexed());
+  for (int i = 2000; i < 2090; ++i) {
+    offset.erase(i);
+  }
+  EXPECT_FALSE(offset.isIndexed());
+  EXPECT_EQ(2300, *offset.find(2300)->second);
+  EXPECT_EQ(2095, *offset.find(2095)->second);
+  EXPECT_EQ(offset.end(), offset.find(2050));
+}
+
+TEST(DenseIdMap, randomOperations) {
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> key(0, 300);
+  TestMap map;
+  std::map<int, int> expected;
+  for (int i = 0; i < 2000; ++i) {
+    auto k = key(gen);
+    if (gen() % 3 == 0) {
+      EXPECT_EQ(expected.erase(k), map.erase(k));
+    } else {
+      auto inserted = expected.emplace(k, i).second;
+      EXPECT_EQ(inserted, map.insert({k, std::make_shared<int>(i)}).second);
+    }
+  }
+  checkEqual(expected, map);
+
+  // Copies are independent
+  auto copy = map;
+  copy.clear();
+  EXPECT_TRUE(copy.empty());
+  checkEqual(expected, map);
+}
+
+TEST(DenseIdMap, portMap) {
+  auto ports = std::make_shared<PortMap>();
+  for (int i = 1; i <= 64; ++i) {
+    ports->registerPort(PortID(i), folly::to<std::string>("port", i));
+  }
+  EXPECT_TRUE(ports->getAllNodes().isIndexed());
+  EXPECT_EQ(PortID(33), ports->getPort(PortID(33))->getID());
+  EXPECT_EQ(nullptr, ports->getPortIf(PortID(65)));
+
+  ports->publish();
+  auto clone = ports->clone();
+  clone->removeNode(PortID(33));
+  EXPECT_EQ(nullptr, clone->getPortIf(PortID(33)));
+  EXPECT_NE(nullptr, ports->getPortIf(PortID(33)));
+  EXPECT_EQ(63, clone->size());
+}
@@ -19,6 +19,7 @@
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 
+#include <folly/Conv.h>
 #include <gtest/gtest.h>
 
 using namespace facebook::fboss;
@@ -88,6 +89,63 @@ TEST(Interface, addrToReach) {
   EXPECT_EQ(0, ret.mask);
 }
 
+TEST(InterfaceMap, addrLookups) {
+  auto makeIntf = [](int id, Interface::Addresses addrs) {
+    auto intf = make_shared<Interface>(
+        InterfaceID(id),
+        RouterID(0),
+        VlanID(id),
+        folly::to<std::string>("intf", id),
+        MacAddress("00:02:00:00:00:01"),
+        9000,
+        false,
+        false);
+    intf->setAddresses(std::move(addrs));
+    return intf;
+  };
+  auto intfs = make_shared<InterfaceMap>();
+  intfs->addInterface(makeIntf(1, {{IPAddress("10.0.0.1"), 8}}));
+  intfs->addInterface(makeIntf(
+      2, {{IPAddress("10.1.0.1"), 16}, {IPAddress("2401:db00::1"), 64}}));
+  // The same subnet as interface 2, which comes first
+  intfs->addInterface(makeIntf(3, {{IPAddress("10.1.0.2"), 16}}));
+  auto intf1 = intfs->getInterface(InterfaceID(1));
+  auto intf2 = intfs->getInterface(InterfaceID(2));
+  auto intf3 = intfs->getInterface(InterfaceID(3));
+
+  // The same answers before publishing, from scans, and after, from the
+  // address index
+  for (auto published : {false, true}) {
+    if (published) {
+      intfs->publish();
+    }
+    // Longest match
+    auto ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("10.1.2.3"));
+    EXPECT_EQ(intf2.get(), ret.intf);
+    EXPECT_EQ(IPAddress("10.1.0.1"), *ret.addr);
+    EXPECT_EQ(16, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("10.2.0.1"));
+    EXPECT_EQ(intf1.get(), ret.intf);
+    EXPECT_EQ(8, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("2401:db00::5"));
+    EXPECT_EQ(intf2.get(), ret.intf);
+    EXPECT_EQ(64, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("11.0.0.1"));
+    EXPECT_EQ(nullptr, ret.intf);
+    ret = intfs->getIntfAddrToReach(RouterID(1), IPAddress("10.0.0.2"));
+    EXPECT_EQ(nullptr, ret.intf);
+
+    EXPECT_EQ(intf3, intfs->getInterfaceIf(RouterID(0), IPAddress("10.1.0.2")));
+    EXPECT_EQ(intf2, intfs->getInterface(RouterID(0), IPAddress("10.1.0.1")));
+    EXPECT_EQ(
+        nullptr, intfs->getInterfaceIf(RouterID(0), IPAddress("10.1.0.3")));
+    EXPECT_EQ(
+        nullptr, intfs->getInterfaceIf(RouterID(1), IPAddress("10.0.0.1")));
+    EXPECT_THROW(
+        intfs->getInterface(RouterID(0), IPAddress("10.1.0.3")), FbossError);
+  }
+}
+
 TEST(Interface, applyConfig) {
   auto platform = createMockPlatform();
   cfg::SwitchConfig config;
@@ -8,6 +8,7 @@
  *
  */
 #include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/FbossError.h"
 #include "fboss/agent/gen-cpp2/switch_config_constants.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/agent/hw/mock/MockPlatform.h"
@@ -208,6 +209,56 @@ TEST(LoadBalancer, deserializationInverseOfSerlization) {
           origTransportSrcAndDst.begin(), origTransportSrcAndDst.end()));
 }
 
+TEST(LoadBalancer, dynamicFlowlet) {
+  auto platform = createMockPlatform();
+  auto initialState = std::make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  config.loadBalancers = defaultLoadBalancers();
+  config.loadBalancers[0].mode = cfg::LoadBalancingMode::DYNAMIC_FLOWLET;
+
+  auto state = publishAndApplyConfig(initialState, &config, platform.get());
+  ASSERT_NE(nullptr, state);
+  auto ecmpLoadBalancer =
+      state->getLoadBalancers()->getLoadBalancerIf(LoadBalancerID::ECMP);
+  ASSERT_NE(nullptr, ecmpLoadBalancer);
+  EXPECT_EQ(
+      cfg::LoadBalancingMode::DYNAMIC_FLOWLET, ecmpLoadBalancer->getMode());
+  // Defaults apply when no flowlet config is given
+  cfg::FlowletConfig defaults;
+  EXPECT_EQ(
+      defaults.inactivityIntervalUsecs,
+      ecmpLoadBalancer->getFlowletInactivityUsecs());
+  EXPECT_EQ(defaults.flowletTableSize, ecmpLoadBalancer->getFlowletTableSize());
+  EXPECT_EQ(
+      cfg::LoadBalancingMode::STATIC,
+      state->getLoadBalancers()
+          ->getLoadBalancerIf(LoadBalancerID::AGGREGATE_PORT)
+          ->getMode());
+
+  auto deserialized =
+      LoadBalancer::fromFollyDynamic(ecmpLoadBalancer->toFollyDynamic());
+  EXPECT_EQ(*ecmpLoadBalancer, *deserialized);
+
+  // Changing only the flowlet config is a change
+  cfg::FlowletConfig flowlet;
+  flowlet.inactivityIntervalUsecs = 512;
+  config.loadBalancers[0].set_flowlet(flowlet);
+  auto newState = publishAndApplyConfig(state, &config, platform.get());
+  ASSERT_NE(nullptr, newState);
+  EXPECT_EQ(
+      512,
+      newState->getLoadBalancers()
+          ->getLoadBalancerIf(LoadBalancerID::ECMP)
+          ->getFlowletInactivityUsecs());
+
+  // Only ECMP can balance dynamically
+  config.loadBalancers[1].mode = cfg::LoadBalancingMode::DYNAMIC_FLOWLET;
+  EXPECT_THROW(
+      publishAndApplyConfig(initialState, &config, platform.get()),
+      FbossError);
+}
+
 namespace {
 
 void checkLoadBalancersDelta(
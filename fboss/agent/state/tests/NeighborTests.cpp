@@ -11,11 +11,15 @@
 #include "fboss/agent/test/TestUtils.h"
 
 #include "fboss/agent/state/ArpEntry.h"
+#include "fboss/agent/state/ArpTable.h"
 #include "fboss/agent/state/NeighborResponseTable.h"
 #include "fboss/agent/state/NdpEntry.h"
+#include "fboss/agent/state/NodeMapDelta.h"
 
 #include <gtest/gtest.h>
 
+#include <set>
+
 using namespace facebook::fboss;
 using folly::MacAddress;
 using folly::IPAddressV4;
@@ -72,3 +76,58 @@ TEST(NeighborResponseEntry, serialize) {
 
   EXPECT_TRUE(*entry == entryBack);
 }
+
+TEST(ArpTable, cloneSharesEntries) {
+  auto makeIP = [](uint32_t i) {
+    return IPAddressV4::fromLongHBO(0x0a000000 + i);
+  };
+  auto table = std::make_shared<ArpTable>();
+  for (uint32_t i = 1; i <= 2000; ++i) {
+    table->addEntry(
+        makeIP(i),
+        MacAddress("01:01:01:01:01:01"),
+        PortDescriptor(PortID(1)),
+        InterfaceID(1));
+  }
+  table->publish();
+
+  auto newTable = table->clone();
+  newTable->updateEntry(
+      makeIP(10),
+      MacAddress("02:02:02:02:02:02"),
+      PortDescriptor(PortID(2)),
+      InterfaceID(1));
+  newTable->removeEntry(makeIP(1500));
+  newTable->addEntry(
+      makeIP(5000),
+      MacAddress("03:03:03:03:03:03"),
+      PortDescriptor(PortID(3)),
+      InterfaceID(1));
+  newTable->publish();
+  EXPECT_EQ(2000, newTable->size());
+
+  // Only the chunks holding the changed entries were copied, or split by
+  // the new one
+  std::set<const void*> oldChunks;
+  table->getAllNodes().forEachChunk(
+      [&](const void* chunk, uint64_t) { oldChunks.insert(chunk); });
+  size_t copied = 0;
+  newTable->getAllNodes().forEachChunk([&](const void* chunk, uint64_t) {
+    copied += oldChunks.count(chunk) ? 0 : 1;
+  });
+  EXPECT_GT(oldChunks.size(), 3);
+  EXPECT_LE(copied, 4);
+
+  // And the delta only visits the changed entries
+  NodeMapDelta<ArpTable> delta(table.get(), newTable.get());
+  EXPECT_TRUE(delta.isJournalled());
+  std::set<IPAddressV4> changed;
+  for (const auto& entryDelta : delta) {
+    auto entry =
+        entryDelta.getNew() ? entryDelta.getNew() : entryDelta.getOld();
+    changed.insert(entry->getIP());
+  }
+  EXPECT_EQ(
+      (std::set<IPAddressV4>{makeIP(10), makeIP(1500), makeIP(5000)}),
+      changed);
+}
@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/NodeMemoryAccounting.h"
+
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using std::make_shared;
+using std::shared_ptr;
+
+namespace {
+
+shared_ptr<SwitchState> stateWithPorts(int numPorts) {
+  auto state = make_shared<SwitchState>();
+  for (int p = 1; p <= numPorts; ++p) {
+    state->registerPort(PortID(p), folly::to<std::string>("port", p));
+  }
+  state->publish();
+  return state;
+}
+
+NodeMemoryAccounting::Usage usageOf(
+    const NodeMemoryAccounting& acct,
+    const std::string& type) {
+  auto it = acct.getUsage().find(type);
+  return it == acct.getUsage().end() ? NodeMemoryAccounting::Usage()
+                                     : it->second;
+}
+
+} // unnamed namespace
+
+TEST(NodeMemoryAccounting, typeName) {
+  EXPECT_EQ("PortMap", NodeMemoryAccounting::typeName<PortMap>());
+  EXPECT_EQ(
+      "RouteTableRib<folly::IPAddressV6>",
+      NodeMemoryAccounting::typeName<RouteTableRib<folly::IPAddressV6>>());
+}
+
+TEST(NodeMemoryAccounting, countsEveryNode) {
+  auto state = stateWithPorts(10);
+  NodeMemoryAccounting acct;
+  state->accountMemory(&acct);
+
+  EXPECT_EQ(10, usageOf(acct, "Port").count);
+  EXPECT_EQ(10 * sizeof(Port), usageOf(acct, "Port").bytes);
+  EXPECT_EQ(1, usageOf(acct, "PortMap").count);
+  // The map's own storage for its children is charged to the map
+  EXPECT_LT(sizeof(PortMap), usageOf(acct, "PortMap").bytes);
+  EXPECT_EQ(1, usageOf(acct, "SwitchState").count);
+
+  uint64_t total = 0;
+  for (const auto& usage : acct.getUsage()) {
+    total += usage.second.bytes;
+  }
+  EXPECT_EQ(total, acct.totalBytes());
+}
+
+TEST(NodeMemoryAccounting, sharedNodesCountedOnce) {
+  auto state = stateWithPorts(10);
+  NodeMemoryAccounting single;
+  state->accountMemory(&single);
+
+  // Walking the same state twice doesn't count anything twice
+  NodeMemoryAccounting twice;
+  state->accountMemory(&twice);
+  state->accountMemory(&twice);
+  EXPECT_EQ(single.totalBytes(), twice.totalBytes());
+
+  // A modified copy only adds the nodes on the path to the change
+  auto newState = state->clone();
+  auto port = newState->getPorts()->getPort(PortID(1))->modify(&newState);
+  port->setName("renamed");
+  newState->publish();
+
+  NodeMemoryAccounting both;
+  state->accountMemory(&both);
+  newState->accountMemory(&both);
+  EXPECT_EQ(11, usageOf(both, "Port").count);
+  EXPECT_EQ(2, usageOf(both, "PortMap").count);
+  EXPECT_EQ(2, usageOf(both, "SwitchState").count);
+  EXPECT_EQ(
+      usageOf(single, "VlanMap").count, usageOf(both, "VlanMap").count);
+}
+
+TEST(NodeMemoryAccounting, routeTables) {
+  auto state = testStateA();
+  NodeMemoryAccounting acct;
+  state->accountMemory(&acct);
+
+  auto rib = state->getRouteTables()->getRouteTable(RouterID(0))->getRibV4();
+  EXPECT_LT(0, usageOf(acct, "Route<folly::IPAddressV4>").count);
+  EXPECT_LE(
+      rib->size(), usageOf(acct, "Route<folly::IPAddressV4>").count);
+  auto radixTree =
+      usageOf(acct, "RouteTableRib<folly::IPAddressV4>.radixTree");
+  EXPECT_EQ(1, radixTree.count);
+  EXPECT_EQ(rib->routesRadixTree().memoryUsage(), radixTree.bytes);
+}
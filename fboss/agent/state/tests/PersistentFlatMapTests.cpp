@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/PersistentFlatMap.h"
+
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+namespace {
+// Use small chunks so that the tests exercise splitting and merging
+using TestMap = PersistentFlatMap<int, std::shared_ptr<int>, 4>;
+
+void checkEqual(const std::map<int, int>& expected, const TestMap& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  auto it = actual.begin();
+  for (const auto& entry : expected) {
+    ASSERT_NE(actual.end(), it);
+    EXPECT_EQ(entry.first, it->first);
+    EXPECT_EQ(entry.second, *it->second);
+    auto found = actual.find(entry.first);
+    ASSERT_NE(actual.end(), found);
+    EXPECT_EQ(entry.second, *found->second);
+    ++it;
+  }
+  EXPECT_EQ(actual.end(), it);
+}
+} // namespace
+
+TEST(PersistentFlatMap, insertFindErase) {
+  TestMap map;
+  std::map<int, int> expected;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dist(0, 200);
+  for (int i = 0; i < 1000; ++i) {
+    auto key = dist(gen);
+    if (i % 3 == 2) {
+      EXPECT_EQ(expected.erase(key), map.erase(key));
+    } else {
+      auto ret = map.insert(std::make_pair(key, std::make_shared<int>(i)));
+      auto expectedRet = expected.insert(std::make_pair(key, i));
+      EXPECT_EQ(expectedRet.second, ret.second);
+      EXPECT_EQ(key, ret.first->first);
+    }
+  }
+  checkEqual(expected, map);
+  EXPECT_EQ(map.end(), map.find(1000));
+}
+
+TEST(PersistentFlatMap, reverseIteration) {
+  TestMap map;
+  for (int i = 0; i < 20; ++i) {
+    map.insert(std::make_pair(i, std::make_shared<int>(i)));
+  }
+  int expected = 19;
+  for (auto it = map.rbegin(); it != map.rend(); ++it) {
+    EXPECT_EQ(expected--, it->first);
+  }
+  EXPECT_EQ(-1, expected);
+}
+
+TEST(PersistentFlatMap, upperBound) {
+  TestMap map;
+  std::map<int, int> expected;
+  for (int i = 0; i < 40; i += 2) {
+    map.insert(std::make_pair(i, std::make_shared<int>(i)));
+    expected[i] = i;
+  }
+  for (int key = -1; key < 41; ++key) {
+    auto it = map.upper_bound(key);
+    auto expectedIt = expected.upper_bound(key);
+    if (expectedIt == expected.end()) {
+      EXPECT_EQ(map.end(), it);
+    } else {
+      ASSERT_NE(map.end(), it);
+      EXPECT_EQ(expectedIt->first, it->first);
+    }
+  }
+}
+
+TEST(PersistentFlatMap, copiesAreIndependent) {
+  TestMap orig;
+  std::map<int, int> expected;
+  for (int i = 0; i < 64; ++i) {
+    orig.insert(std::make_pair(i, std::make_shared<int>(i)));
+    expected[i] = i;
+  }
+
+  TestMap copy(orig);
+  auto it = copy.find(10);
+  ASSERT_NE(copy.end(), it);
+  it->second = std::make_shared<int>(100);
+  copy.erase(20);
+  copy.insert(std::make_pair(1000, std::make_shared<int>(1000)));
+  for (auto& entry : copy) {
+    if (entry.first == 30) {
+      entry.second = std::make_shared<int>(300);
+    }
+  }
+
+  // The original is unaffected by any of the writes to the copy
+  checkEqual(expected, orig);
+
+  expected[10] = 100;
+  expected.erase(20);
+  expected[1000] = 1000;
+  expected[30] = 300;
+  checkEqual(expected, copy);
+
+  // Both copies still share the chunks that were never written to
+  TestMap reader(copy);
+  EXPECT_EQ(copy.numChunks(), reader.numChunks());
+  checkEqual(expected, reader);
+}
@@ -149,6 +149,16 @@ TEST(PortQueue, serialization) {
   }
 }
 
+TEST(PortQueue, sharedBytesChange) {
+  std::shared_ptr<PortQueue> queue(generatePortQueue());
+  auto changed = queue->clone();
+  EXPECT_EQ(*queue, *changed);
+  // Changing only the shared bytes still makes it a different queue, so
+  // that the change gets programmed
+  changed->setSharedBytes(20000);
+  EXPECT_NE(*queue, *changed);
+}
+
 TEST(PortQueue, serializationBadForm) {
   auto pqObject = generatePortQueue();
 
@@ -19,6 +19,7 @@
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/SwitchState.h"
 
+#include <folly/Conv.h>
 #include <gtest/gtest.h>
 
 using namespace facebook::fboss;
@@ -647,3 +648,111 @@ TEST(PortMap, iterateOrder) {
   ++it;
   EXPECT_EQ(ports->end(), it);
 }
+
+TEST(PortMap, journalledDelta) {
+  auto portsV0 = make_shared<PortMap>();
+  for (uint16_t id = 1; id <= 8; ++id) {
+    portsV0->registerPort(PortID(id), folly::to<std::string>("port", id));
+  }
+  portsV0->publish();
+
+  // Modify one port in each of a chain of clones, as coalesced state updates
+  // in SwSwitch would do.
+  auto portsV1 = portsV0->clone();
+  auto port2 = portsV1->getPort(PortID(2))->clone();
+  port2->setAdminState(cfg::PortState::ENABLED);
+  portsV1->updatePort(port2);
+  portsV1->publish();
+
+  auto portsV2 = portsV1->clone();
+  auto port7 = portsV2->getPort(PortID(7))->clone();
+  port7->setAdminState(cfg::PortState::ENABLED);
+  portsV2->updatePort(port7);
+  portsV2->publish();
+
+  NodeMapDelta<PortMap> delta(portsV0.get(), portsV2.get());
+  EXPECT_TRUE(delta.isJournalled());
+  checkChangedPorts(portsV0, portsV2, {2, 7});
+  checkChangedPorts(portsV1, portsV2, {7});
+
+  // Unrelated maps can't use the journal, but still produce the right delta
+  auto portsOther = portsV0->clone();
+  portsOther->publish();
+  NodeMapDelta<PortMap> unrelated(portsOther.get(), portsV2.get());
+  EXPECT_FALSE(unrelated.isJournalled());
+  checkChangedPorts(portsOther, portsV2, {2, 7});
+
+  // Changes made directly on the container drop the journal
+  auto portsV3 = portsV2->clone();
+  portsV3->writableNodes();
+  portsV3->publish();
+  NodeMapDelta<PortMap> dropped(portsV2.get(), portsV3.get());
+  EXPECT_FALSE(dropped.isJournalled());
+  checkChangedPorts(portsV2, portsV3, {});
+}
+
+TEST(Port, configFieldsSharedByClones) {
+  auto port = make_shared<Port>(PortID(1), "port1");
+  port->setDescription("uplink");
+  port->setSflowIngressRate(100);
+  port->publish();
+
+  // Changing the oper state leaves the config settings shared
+  auto portV1 = port->clone();
+  portV1->setOperState(true);
+  EXPECT_EQ(
+      &port->getFields()->getConfigFields(),
+      &portV1->getFields()->getConfigFields());
+  EXPECT_EQ("uplink", portV1->getDescription());
+
+  // Changing a config setting copies them, leaving the original alone
+  portV1->setSflowIngressRate(200);
+  EXPECT_NE(
+      &port->getFields()->getConfigFields(),
+      &portV1->getFields()->getConfigFields());
+  EXPECT_EQ(100, port->getSflowIngressRate());
+  EXPECT_EQ(200, portV1->getSflowIngressRate());
+  EXPECT_EQ("uplink", portV1->getDescription());
+
+  // Once copied, further changes don't copy again
+  const auto* configFields = &portV1->getFields()->getConfigFields();
+  portV1->setSflowEgressRate(300);
+  EXPECT_EQ(configFields, &portV1->getFields()->getConfigFields());
+  EXPECT_EQ(0, port->getSflowEgressRate());
+}
+
+TEST(Port, changedFields) {
+  auto port = make_shared<Port>(PortID(1), "port1");
+  QueueConfig queues;
+  for (uint8_t id = 0; id < 2; ++id) {
+    queues.push_back(make_shared<PortQueue>(id));
+  }
+  port->resetPortQueues(queues);
+  port->publish();
+  EXPECT_EQ(0, Port::getChangedFields(*port, *port));
+
+  // Config settings shared with the original compare equal
+  auto portV1 = port->clone();
+  portV1->setOperState(true);
+  portV1->setSpeed(cfg::PortSpeed::HUNDREDG);
+  EXPECT_EQ(
+      Port::OPER_STATE | Port::SPEED, Port::getChangedFields(*port, *portV1));
+
+  // Copied ones are compared, only reporting what differs
+  auto portV2 = port->clone();
+  portV2->setSflowIngressRate(100);
+  portV2->setDescription("");
+  EXPECT_EQ(Port::SFLOW, Port::getChangedFields(*port, *portV2));
+
+  // As are the queues, whether replaced or copied with the same settings
+  auto portV3 = port->clone();
+  QueueConfig newQueues{make_shared<PortQueue>(0), queues[1]};
+  portV3->resetPortQueues(newQueues);
+  EXPECT_EQ(0, Port::getChangedFields(*port, *portV3));
+  newQueues = {make_shared<PortQueue>(0), queues[1]};
+  newQueues[0]->setWeight(5);
+  portV3->resetPortQueues(newQueues);
+  EXPECT_EQ(Port::QUEUES, Port::getChangedFields(*port, *portV3));
+  portV3->resetPortQueues({queues[0]});
+  EXPECT_EQ(Port::QUEUES, Port::getChangedFields(*port, *portV3));
+}
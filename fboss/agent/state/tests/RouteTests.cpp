@@ -17,6 +17,7 @@
 #include "fboss/agent/state/InterfaceMap.h"
 #include "fboss/agent/state/Route.h"
 #include "fboss/agent/state/RouteDelta.h"
+#include "fboss/agent/state/RouteLookupTable.h"
 #include "fboss/agent/state/RouteTableRib.h"
 #include "fboss/agent/state/RouteTable.h"
 #include "fboss/agent/state/RouteTableMap.h"
@@ -1634,6 +1635,120 @@ TEST(Route, delRoutes) {
   EXPECT_TRUE(nullptr == ribV4->exactMatch(prefix22));
 }
 
+template <typename AddrT>
+void EXPECT_LOOKUP_TABLE_MATCH(
+    const std::shared_ptr<RouteTableRib<AddrT>>& rib,
+    const std::vector<std::string>& addrs) {
+  RouteLookupTable<AddrT> table(rib);
+  for (const auto& addr : addrs) {
+    AddrT ip(addr);
+    EXPECT_EQ(rib->longestMatch(ip).get(), table.longestMatch(ip)) << addr;
+  }
+}
+
+TEST(Route, lookupTable) {
+  auto stateV1 = make_shared<SwitchState>();
+  stateV1->publish();
+  auto rid = RouterID(0);
+  RouteUpdater u1(stateV1->getRouteTables());
+  auto addRoute = [&](const std::string& network, uint8_t mask) {
+    u1.addRoute(rid, IPAddress(network), mask, CLIENT_A,
+                RouteNextHopEntry(TO_CPU, DISTANCE));
+  };
+  addRoute("10.0.0.0", 8);
+  addRoute("10.1.0.0", 16);
+  addRoute("10.1.2.0", 24);
+  addRoute("10.1.2.3", 32);
+  addRoute("10.255.255.255", 32);
+  addRoute("11.0.0.0", 8);
+  addRoute("255.255.255.255", 32);
+  addRoute("2401:db00::", 32);
+  addRoute("2401:db00::", 64);
+  addRoute("2401:db00::1", 128);
+  addRoute("2401:db00:0:0:8000::", 65);
+  addRoute("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", 128);
+  auto tables = u1.updateDone();
+  auto table = tables->getRouteTable(rid);
+
+  std::vector<std::string> v4Addrs{
+      "0.0.0.0", "9.255.255.255", "10.0.0.0", "10.0.255.255", "10.1.0.0",
+      "10.1.2.2", "10.1.2.3", "10.1.2.4", "10.1.2.255", "10.1.3.0",
+      "10.2.0.0", "10.255.255.254", "10.255.255.255", "11.0.0.0",
+      "11.255.255.255", "12.0.0.0", "255.255.255.254", "255.255.255.255"};
+  std::vector<std::string> v6Addrs{
+      "::", "2401:daff:ffff:ffff:ffff:ffff:ffff:ffff", "2401:db00::",
+      "2401:db00::1", "2401:db00::2", "2401:db00::7fff:ffff:ffff:ffff",
+      "2401:db00:0:0:8000::", "2401:db00::ffff:ffff:ffff:ffff",
+      "2401:db00:0:1::", "2401:db00:ffff:ffff:ffff:ffff:ffff:ffff",
+      "2401:db01::", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:fffe",
+      "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"};
+  EXPECT_LOOKUP_TABLE_MATCH(table->getRibV4(), v4Addrs);
+  EXPECT_LOOKUP_TABLE_MATCH(table->getRibV6(), v6Addrs);
+
+  // And with default routes covering everything else
+  RouteUpdater u2(tables);
+  u2.addRoute(rid, IPAddress("0.0.0.0"), 0, CLIENT_A,
+              RouteNextHopEntry(TO_CPU, DISTANCE));
+  u2.addRoute(rid, IPAddress("::"), 0, CLIENT_A,
+              RouteNextHopEntry(TO_CPU, DISTANCE));
+  table = u2.updateDone()->getRouteTable(rid);
+  EXPECT_LOOKUP_TABLE_MATCH(table->getRibV4(), v4Addrs);
+  EXPECT_LOOKUP_TABLE_MATCH(table->getRibV6(), v6Addrs);
+  RouteLookupTable<IPAddressV4> v4Table(table->getRibV4());
+  EXPECT_EQ(0, v4Table.longestMatch(IPAddressV4("12.0.0.0"))->prefix().mask);
+}
+
+// Test replacing all the routes of a client
+TEST(RouteUpdater, syncRoutesForClient) {
+  auto stateV1 = make_shared<SwitchState>();
+  stateV1->publish();
+  auto tables1 = stateV1->getRouteTables();
+  auto rid = RouterID(0);
+  RouteUpdater u1(tables1);
+
+  RouteV4::Prefix prefix10{IPAddressV4("10.10.10.10"), 32};
+  RouteV4::Prefix prefix22{IPAddressV4("22.22.22.22"), 32};
+  RouteV4::Prefix prefix33{IPAddressV4("33.33.33.33"), 32};
+  RouteV4::Prefix prefix44{IPAddressV4("44.44.44.44"), 32};
+  RouteV6::Prefix prefix1001{IPAddressV6("1001::"), 48};
+
+  auto nhops = RouteNextHopEntry(newNextHops(3, "1.1.1."), DISTANCE);
+  u1.addRoute(rid, IPAddress("10.10.10.10"), 32, CLIENT_A, nhops);
+  u1.addRoute(rid, IPAddress("22.22.22.22"), 32, CLIENT_A, nhops);
+  u1.addRoute(rid, IPAddress("1001::"), 48, CLIENT_A, nhops);
+  u1.addRoute(rid, IPAddress("10.10.10.10"), 32, CLIENT_B, nhops);
+  u1.addRoute(rid, IPAddress("33.33.33.33"), 32, CLIENT_B, nhops);
+  tables1 = u1.updateDone();
+  tables1->publish();
+
+  // Keep 10.10.10.10, change 22.22.22.22, add 44.44.44.44 and drop 1001::/48
+  auto toCpu = RouteNextHopEntry(RouteForwardAction::TO_CPU, DISTANCE);
+  RouteUpdater u2(tables1);
+  std::vector<RouteUpdater::ClientRoute> routes;
+  routes.push_back({IPAddress("22.22.22.22"), 32, toCpu});
+  routes.push_back({IPAddress("44.44.44.44"), 32, nhops});
+  routes.push_back({IPAddress("10.10.10.10"), 32, nhops});
+  u2.syncRoutesForClient(rid, CLIENT_A, routes);
+  auto tables2 = u2.updateDone();
+  ASSERT_NE(nullptr, tables2);
+  EXPECT_NODEMAP_MATCH(tables2);
+
+  auto ribV4 = tables2->getRouteTable(rid)->getRibV4();
+  EXPECT_TRUE(ribV4->exactMatch(prefix10)->has(CLIENT_A, nhops));
+  EXPECT_TRUE(ribV4->exactMatch(prefix10)->has(CLIENT_B, nhops));
+  EXPECT_TRUE(ribV4->exactMatch(prefix22)->has(CLIENT_A, toCpu));
+  EXPECT_TRUE(ribV4->exactMatch(prefix33)->has(CLIENT_B, nhops));
+  EXPECT_TRUE(ribV4->exactMatch(prefix44)->has(CLIENT_A, nhops));
+  EXPECT_EQ(4, ribV4->size());
+  EXPECT_EQ(nullptr,
+            tables2->getRouteTable(rid)->getRibV6()->exactMatch(prefix1001));
+
+  // Syncing the same routes again changes nothing
+  RouteUpdater u3(tables2);
+  u3.syncRoutesForClient(rid, CLIENT_A, routes);
+  EXPECT_EQ(nullptr, u3.updateDone());
+}
+
 // Test equality of RouteNextHopsMulti.
 TEST(Route, equality) {
   // Create two identical RouteNextHopsMulti, and compare
@@ -1674,6 +1789,28 @@ TEST(Route, equality) {
   EXPECT_TRUE(nhm1 == nhm2);
 }
 
+// The clients' entries don't depend on the order the clients came in
+TEST(Route, equalityAcrossClientOrder) {
+  RouteNextHopsMulti nhm1;
+  nhm1.update(CLIENT_C, RouteNextHopEntry(newNextHops(1, "3.3.3."), DISTANCE));
+  nhm1.update(CLIENT_A, RouteNextHopEntry(newNextHops(3, "1.1.1."), DISTANCE));
+  nhm1.update(CLIENT_B, RouteNextHopEntry(newNextHops(2, "2.2.2."), DISTANCE));
+
+  RouteNextHopsMulti nhm2;
+  nhm2.update(CLIENT_B, RouteNextHopEntry(newNextHops(2, "2.2.2."), DISTANCE));
+  nhm2.update(CLIENT_A, RouteNextHopEntry(newNextHops(3, "1.1.1."), DISTANCE));
+  nhm2.update(CLIENT_C, RouteNextHopEntry(newNextHops(1, "3.3.3."), DISTANCE));
+  EXPECT_TRUE(nhm1 == nhm2);
+
+  nhm1.delEntryForClient(CLIENT_A);
+  EXPECT_EQ(nullptr, nhm1.getEntryForClient(CLIENT_A));
+  ASSERT_NE(nullptr, nhm1.getEntryForClient(CLIENT_B));
+  EXPECT_EQ(2, nhm1.getEntryForClient(CLIENT_B)->getNextHopSet().size());
+  ASSERT_NE(nullptr, nhm1.getEntryForClient(CLIENT_C));
+  EXPECT_EQ(1, nhm1.getEntryForClient(CLIENT_C)->getNextHopSet().size());
+  EXPECT_FALSE(nhm1 == nhm2);
+}
+
 // Test that a copy of a RouteNextHopsMulti is a deep copy, and that the
 // resulting objects can be modified independently.
 TEST(Route, deepCopy) {
@@ -2118,6 +2255,44 @@ TEST(Route, serializeRouteTable) {
   EXPECT_ROUTETABLERIB_MATCH(origRt->getRibV6(), desRt->getRibV6());
 }
 
+TEST(Route, deserializeLargeRouteTable) {
+  // Enough routes to be parsed in several chunks, serialized out of order
+  auto nhops = makeNextHops({"1.1.1.10"});
+  folly::dynamic routesJson = folly::dynamic::array;
+  for (uint32_t i = 0; i < 20000; ++i) {
+    auto network = IPAddressV4::fromLongHBO((10u << 24) + ((i * 7919) << 8));
+    RouteV4 route(RouteV4::Prefix{network, 24});
+    route.update(CLIENT_A, RouteNextHopEntry(nhops, DISTANCE));
+    routesJson.push_back(route.toFollyDynamic());
+  }
+  folly::dynamic ribJson = folly::dynamic::object("routes", routesJson);
+
+  auto rib = RouteTableRib<IPAddressV4>::fromFollyDynamic(ribJson);
+  ASSERT_EQ(20000, rib->size());
+  EXPECT_EQ(rib->size(), rib->routesRadixTree().size());
+  const RouteV4::Prefix* prev = nullptr;
+  for (const auto& route : *rib->routes()) {
+    if (prev) {
+      EXPECT_TRUE(*prev < route->prefix());
+    }
+    prev = &route->prefix();
+    EXPECT_TRUE(route->has(CLIENT_A, RouteNextHopEntry(nhops, DISTANCE)));
+    auto match = rib->longestMatch(route->prefix().network);
+    ASSERT_NE(nullptr, match);
+    EXPECT_EQ(route->prefix(), match->prefix());
+  }
+
+  // Serializing the deserialized table comes back to the same routes
+  auto rib2 = RouteTableRib<IPAddressV4>::fromFollyDynamic(
+      rib->toFollyDynamic());
+  EXPECT_ROUTETABLERIB_MATCH(rib, rib2);
+
+  routesJson.push_back(routesJson[1234]);
+  ribJson["routes"] = routesJson;
+  EXPECT_THROW(
+      RouteTableRib<IPAddressV4>::fromFollyDynamic(ribJson), FbossError);
+}
+
 // Test utility functions for converting RouteNextHopSet to thrift and back
 TEST(RouteTypes, toFromRouteNextHops) {
   RouteNextHopSet nhs;
@@ -2235,6 +2410,45 @@ TEST(Route, nextHopTest) {
   EXPECT_TRUE(unh < rnh && rnh > unh);
 }
 
+TEST(Route, nextHopSetsAreShared) {
+  auto makeNextHops = [](std::vector<std::string> ips) {
+    RouteNextHopSet nhops;
+    for (const auto& ip : ips) {
+      nhops.emplace(ResolvedNextHop(IPAddress(ip), InterfaceID(1), 0));
+    }
+    return nhops;
+  };
+  RouteNextHopEntry a(makeNextHops({"1.1.1.1", "1.1.1.2"}), DISTANCE);
+  RouteNextHopEntry b(makeNextHops({"1.1.1.2", "1.1.1.1"}), DISTANCE);
+  RouteNextHopEntry c(makeNextHops({"1.1.1.1"}), DISTANCE);
+  EXPECT_EQ(&a.getNextHopSet(), &b.getNextHopSet());
+  EXPECT_EQ(a, b);
+  EXPECT_NE(&a.getNextHopSet(), &c.getNextHopSet());
+  EXPECT_NE(a, c);
+  EXPECT_TRUE(c < a || a < c);
+  EXPECT_FALSE(a < b || b < a);
+
+  // Copies and entries deserialized share it too
+  auto copy = a;
+  EXPECT_EQ(&a.getNextHopSet(), &copy.getNextHopSet());
+  auto deserialized = RouteNextHopEntry::fromFollyDynamic(a.toFollyDynamic());
+  EXPECT_EQ(&a.getNextHopSet(), &deserialized.getNextHopSet());
+
+  // Released with its last entry, and interned afresh after that
+  {
+    RouteNextHopEntry d(makeNextHops({"1.1.1.3"}), DISTANCE);
+    EXPECT_EQ(1, d.getNextHopSet().size());
+  }
+  RouteNextHopEntry e(makeNextHops({"1.1.1.3"}), DISTANCE);
+  EXPECT_EQ(IPAddress("1.1.1.3"), e.getNextHopSet().begin()->addr());
+
+  RouteNextHopEntry drop(RouteNextHopEntry::Action::DROP, DISTANCE);
+  RouteNextHopEntry toCpu(RouteNextHopEntry::Action::TO_CPU, DISTANCE);
+  EXPECT_TRUE(drop.getNextHopSet().empty());
+  EXPECT_EQ(&drop.getNextHopSet(), &toCpu.getNextHopSet());
+  EXPECT_NE(drop, toCpu);
+}
+
 TEST(Route, nodeMapMatchesRadixTree) {
   auto stateV1 = applyInitConfig();
   ASSERT_NE(nullptr, stateV1);
@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/json.h>
+#include <folly/json_pointer.h>
+#include <gtest/gtest.h>
+
+#include <iterator>
+
+using namespace facebook::fboss;
+using folly::json_pointer;
+
+namespace {
+
+void checkWriteJson(const SwitchState& state, const std::string& ptrStr) {
+  SCOPED_TRACE(ptrStr);
+  auto ptr = json_pointer::parse(ptrStr);
+  auto expected = state.toFollyDynamic();
+  auto expectedPart = expected.get_ptr(ptr);
+  ASSERT_NE(nullptr, expectedPart);
+
+  std::string out;
+  EXPECT_TRUE(state.writeJson(ptr, &out));
+  EXPECT_EQ(*expectedPart, folly::parseJson(out));
+}
+
+} // unnamed namespace
+
+TEST(SwitchState, writeJson) {
+  auto state = testStateA();
+  for (const auto& ptr :
+       {"",
+        "/ports",
+        "/ports/entries",
+        "/ports/entries/0",
+        "/ports/entries/1/portName",
+        "/ports/extraFields",
+        "/vlans/entries/0",
+        "/vlans/entries/1/arpTable",
+        "/interfaces",
+        "/interfaces/0",
+        "/routeTables",
+        "/defaultVlan",
+        "/controlPlane",
+        "/loadBalancers",
+        "/mirrors"}) {
+    checkWriteJson(*state, ptr);
+  }
+}
+
+TEST(SwitchState, writeJsonMissing) {
+  auto state = testStateA();
+  for (const auto& ptr :
+       {"/nothing",
+        "/ports/nothing",
+        "/ports/entries/12345",
+        "/ports/entries/x",
+        "/ports/entries/0/nothing",
+        "/interfaces/12345",
+        "/defaultVlan/0"}) {
+    SCOPED_TRACE(ptr);
+    std::string out;
+    EXPECT_FALSE(state->writeJson(json_pointer::parse(ptr), &out));
+  }
+}
+
+TEST(SwitchState, patchJsonEntry) {
+  auto state = testStateA();
+  auto ptr = json_pointer::parse("/ports/entries/1");
+  auto newState = SwitchState::patchJson(
+      state, ptr, folly::dynamic::object("portDescription", "patched"));
+
+  auto expected = state->toFollyDynamic();
+  expected.get_ptr(ptr)->merge_patch(
+      folly::dynamic::object("portDescription", "patched"));
+  EXPECT_EQ(expected, newState->toFollyDynamic());
+
+  // Only the patched port is new, the rest of the state is shared
+  auto oldPorts = state->getPorts();
+  auto newPorts = newState->getPorts();
+  auto oldIt = oldPorts->begin();
+  auto newIt = newPorts->begin();
+  for (size_t i = 0; oldIt != oldPorts->end(); ++i, ++oldIt, ++newIt) {
+    if (i == 1) {
+      EXPECT_NE(*oldIt, *newIt);
+      EXPECT_EQ("patched", (*newIt)->getDescription());
+    } else {
+      EXPECT_EQ(*oldIt, *newIt);
+    }
+  }
+  EXPECT_EQ(state->getVlans(), newState->getVlans());
+  EXPECT_EQ(state->getInterfaces(), newState->getInterfaces());
+
+  auto patchedID = (*std::next(oldPorts->begin()))->getID();
+  StateDelta delta(state, newState);
+  size_t changed = 0;
+  for (const auto& portDelta : delta.getPortsDelta()) {
+    EXPECT_EQ(patchedID, portDelta.getOld()->getID());
+    ++changed;
+  }
+  EXPECT_EQ(1, changed);
+}
+
+TEST(SwitchState, patchJsonMember) {
+  auto state = testStateA();
+  auto newState = SwitchState::patchJson(
+      state, json_pointer::parse("/defaultVlan"), folly::dynamic(2));
+  EXPECT_EQ(VlanID(2), newState->getDefaultVlan());
+  EXPECT_EQ(state->getPorts(), newState->getPorts());
+
+  newState = SwitchState::patchJson(
+      state, json_pointer::parse(""), folly::dynamic::object("defaultVlan", 2));
+  EXPECT_EQ(VlanID(2), newState->getDefaultVlan());
+
+  newState = SwitchState::patchJson(
+      state, json_pointer::parse("/interfaces/0"), folly::dynamic::object());
+  EXPECT_EQ(state->toFollyDynamic(), newState->toFollyDynamic());
+
+  EXPECT_THROW(
+      SwitchState::patchJson(
+          state,
+          json_pointer::parse("/ports/entries/12345/nothing"),
+          folly::dynamic::object()),
+      FbossError);
+  EXPECT_THROW(
+      SwitchState::patchJson(
+          state, json_pointer::parse("/nothing"), folly::dynamic::object()),
+      FbossError);
+}
@@ -12,6 +12,7 @@
 #include "fboss/agent/test/TestUtils.h"
 #include "fboss/agent/hw/mock/MockPlatform.h"
 #include "fboss/agent/state/ArpResponseTable.h"
+#include "fboss/agent/state/ArpTable.h"
 #include "fboss/agent/state/DeltaFunctions.h"
 #include "fboss/agent/state/NdpResponseTable.h"
 #include "fboss/agent/state/NodeMapDelta.h"
@@ -271,6 +272,26 @@ void checkChangedVlans(const shared_ptr<VlanMap>& oldVlans,
   EXPECT_EQ(removedIDs, foundRemoved);
 }
 
+TEST(Vlan, configFieldsSharedByClones) {
+  auto vlan = make_shared<Vlan>(VlanID(1234), kVlan1234);
+  vlan->addPort(PortID(1), false);
+  vlan->setDhcpV4Relay(IPAddressV4("1.2.3.4"));
+  vlan->publish();
+
+  // Updating the neighbor tables leaves the config settings shared
+  auto vlanV1 = vlan->clone();
+  vlanV1->setArpTable(make_shared<ArpTable>());
+  EXPECT_EQ(&vlan->getPorts(), &vlanV1->getPorts());
+  EXPECT_EQ(IPAddressV4("1.2.3.4"), vlanV1->getDhcpV4Relay());
+
+  // Changing a config setting copies them, leaving the original alone
+  vlanV1->addPort(PortID(2), true);
+  EXPECT_NE(&vlan->getPorts(), &vlanV1->getPorts());
+  EXPECT_EQ(1, vlan->getPorts().size());
+  EXPECT_EQ(2, vlanV1->getPorts().size());
+  EXPECT_EQ(IPAddressV4("1.2.3.4"), vlanV1->getDhcpV4Relay());
+}
+
 TEST(VlanMap, applyConfig) {
   auto platform = createMockPlatform();
   auto stateV0 = make_shared<SwitchState>();
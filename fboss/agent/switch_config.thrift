@@ -786,6 +786,22 @@ enum HashingAlgorithm {
   CRC16_CCITT = 1
 }
 
+enum LoadBalancingMode {
+  // Each flow sticks to the member its hash picks
+  STATIC = 1,
+  // Flows are split into flowlets at idle gaps, and each flowlet is assigned
+  // to the least loaded member, as measured by the port quality metrics of
+  // the ASIC. Only supported for ECMP, and only on some ASICs.
+  DYNAMIC_FLOWLET = 2,
+}
+
+struct FlowletConfig {
+  // How long a flow has to be idle before it may move to another member
+  1: i32 inactivityIntervalUsecs = 256
+  // Number of flowlet entries of each ECMP group
+  2: i32 flowletTableSize = 2048
+}
+
 struct LoadBalancer {
   1: LoadBalancerID id
   2: Fields fieldSelection
@@ -793,6 +809,9 @@ struct LoadBalancer {
   // If not set, the seed will be chosen so as to remain constant across process
   // restarts
   4: optional i32 seed
+  5: LoadBalancingMode mode = LoadBalancingMode.STATIC
+  // Used when mode is DYNAMIC_FLOWLET, defaults apply if not set
+  6: optional FlowletConfig flowlet
 }
 
 enum CounterType {
@@ -14,6 +14,8 @@
 #include "fboss/agent/gen-cpp2/agent_config_types.h"
 #include "fboss/agent/AgentConfig.h"
 
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 using namespace facebook::fboss;
@@ -95,3 +97,37 @@ TEST(AgentConfigTest, AcceptsNewAndOldStyleConfigs) {
 
   EXPECT_EQ(fromOldStyle->swConfigRaw(), fromNewStyle->swConfigRaw());
 }
+
+TEST(AgentConfigTest, CachesParsedConfig) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "agent.conf").string();
+  auto cachePath = path + ".cache";
+  auto config = createAgentConfig();
+  auto raw =
+      apache::thrift::SimpleJSONSerializer::serialize<std::string>(config);
+  ASSERT_TRUE(folly::writeFile(raw, path.c_str()));
+
+  auto parsed = AgentConfig::fromFile(path);
+  EXPECT_EQ(config, parsed->thrift);
+  std::string cache;
+  ASSERT_TRUE(folly::readFile(cachePath.c_str(), cache));
+
+  // Read back from the cache
+  auto cached = AgentConfig::fromFile(path);
+  EXPECT_EQ(config, cached->thrift);
+  EXPECT_EQ(raw, cached->raw);
+
+  // A changed config is parsed again, whatever the cache says
+  config.sw.arpTimeoutSeconds = 42;
+  raw = apache::thrift::SimpleJSONSerializer::serialize<std::string>(config);
+  ASSERT_TRUE(folly::writeFile(raw, path.c_str()));
+  auto changed = AgentConfig::fromFile(path);
+  EXPECT_EQ(42, changed->thrift.sw.arpTimeoutSeconds);
+  EXPECT_EQ(raw, changed->raw);
+
+  // As is one whose cache is corrupt
+  ASSERT_TRUE(folly::readFile(cachePath.c_str(), cache));
+  cache.resize(cache.size() / 2);
+  ASSERT_TRUE(folly::writeFile(cache, cachePath.c_str()));
+  EXPECT_EQ(config, AgentConfig::fromFile(path)->thrift);
+}
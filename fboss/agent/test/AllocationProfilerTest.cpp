@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/AllocationProfiler.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+DECLARE_int32(allocation_profile_sample_rate);
+
+/*
+ * agent_test doesn't link AllocationHooks.cpp, so these tests report
+ * allocations to the profiler themselves.
+ */
+
+namespace {
+
+class AllocationProfilerTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    oldSampleRate_ = FLAGS_allocation_profile_sample_rate;
+    AllocationProfiler::resetPathCounts();
+  }
+  void TearDown() override {
+    FLAGS_allocation_profile_sample_rate = oldSampleRate_;
+  }
+
+ private:
+  int32_t oldSampleRate_{0};
+};
+
+constexpr auto kPath = AllocationPath::RX_PACKET_HANDLER;
+
+} // unnamed namespace
+
+TEST_F(AllocationProfilerTest, disabledByDefault) {
+  FLAGS_allocation_profile_sample_rate = 0;
+  {
+    AllocationScope scope(kPath, nullptr);
+    AllocationProfiler::recordAllocation(100);
+  }
+  EXPECT_EQ(0, AllocationProfiler::getPathSamples(kPath));
+  EXPECT_EQ(0, AllocationProfiler::getPathCounts(kPath).allocations);
+}
+
+TEST_F(AllocationProfilerTest, countsInsideScopesOnly) {
+  FLAGS_allocation_profile_sample_rate = 1;
+  AllocationProfiler::recordAllocation(1000);
+  {
+    AllocationScope scope(kPath, nullptr);
+    AllocationProfiler::recordAllocation(100);
+    AllocationProfiler::recordAllocation(20);
+  }
+  AllocationProfiler::recordAllocation(1000);
+
+  EXPECT_EQ(1, AllocationProfiler::getPathSamples(kPath));
+  auto counts = AllocationProfiler::getPathCounts(kPath);
+  EXPECT_EQ(2, counts.allocations);
+  EXPECT_EQ(120, counts.bytes);
+  EXPECT_EQ(
+      0,
+      AllocationProfiler::getPathCounts(AllocationPath::STATE_UPDATE_FN)
+          .allocations);
+}
+
+TEST_F(AllocationProfilerTest, sampling) {
+  FLAGS_allocation_profile_sample_rate = 4;
+  for (int i = 0; i < 20; ++i) {
+    AllocationScope scope(kPath, nullptr);
+    AllocationProfiler::recordAllocation(8);
+  }
+  EXPECT_EQ(5, AllocationProfiler::getPathSamples(kPath));
+  EXPECT_EQ(5, AllocationProfiler::getPathCounts(kPath).allocations);
+  EXPECT_EQ(40, AllocationProfiler::getPathCounts(kPath).bytes);
+}
+
+TEST_F(AllocationProfilerTest, nestedScopes) {
+  FLAGS_allocation_profile_sample_rate = 1;
+  {
+    AllocationScope outer(AllocationPath::STATE_UPDATE_FN, nullptr);
+    AllocationProfiler::recordAllocation(10);
+    {
+      AllocationScope inner(kPath, nullptr);
+      AllocationProfiler::recordAllocation(5);
+    }
+  }
+  // The outer scope includes what the inner one allocated
+  EXPECT_EQ(
+      15,
+      AllocationProfiler::getPathCounts(AllocationPath::STATE_UPDATE_FN)
+          .bytes);
+  EXPECT_EQ(5, AllocationProfiler::getPathCounts(kPath).bytes);
+}
@@ -22,6 +22,7 @@
 #include "fboss/agent/hw/mock/MockHwSwitch.h"
 #include "fboss/agent/hw/mock/MockPlatform.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
 #include "fboss/agent/packet/PktUtil.h"
 #include "fboss/agent/state/ArpEntry.h"
 #include "fboss/agent/state/ArpResponseTable.h"
@@ -41,6 +42,7 @@
 #include <array>
 #include <future>
 #include <string>
+#include <unordered_set>
 
 using namespace facebook::fboss;
 using facebook::network::toBinaryAddress;
@@ -48,6 +50,7 @@ using facebook::network::toIPAddress;
 using facebook::network::thrift::BinaryAddress;
 using folly::io::Cursor;
 using folly::IOBuf;
+using folly::IPAddress;
 using folly::IPAddressV4;
 using std::make_unique;
 using folly::StringPiece;
@@ -199,6 +202,26 @@ TxMatchFn checkArpRequest(IPAddressV4 senderIP, MacAddress senderMAC,
                      targetIP, MacAddress::BROADCAST, vlan);
 }
 
+// An IPv4 packet sent to the hardware to be routed to dstIP
+TxMatchFn checkRoutedIPv4Pkt(IPAddressV4 dstIP) {
+  return [=](const TxPacket* pkt) {
+    Cursor c(pkt->buf());
+    c.skip(12); // dst and src MAC
+    auto ethertype = c.readBE<uint16_t>();
+    if (ethertype == 0x8100) {
+      c.skip(2);
+      ethertype = c.readBE<uint16_t>();
+    }
+    if (ethertype != 0x0800) {
+      throw FbossError("expected IPv4 ethertype, found ", ethertype);
+    }
+    IPv4Hdr v4Hdr(c);
+    if (v4Hdr.dstAddr != dstIP) {
+      throw FbossError("expected dest IP ", dstIP, "; found ", v4Hdr.dstAddr);
+    }
+  };
+}
+
 const std::shared_ptr<ArpEntry>
 getArpEntry(SwSwitch* sw, IPAddressV4 ip, VlanID vlanID = VlanID(1)) {
   return sw->getState()
@@ -788,6 +811,51 @@ TEST(ArpTest, FlushEntry) {
                FbossError);
 }
 
+TEST(ArpTest, CoalesceEntryUpdates) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  // Hold the update thread, so that all of the replies below are resolved
+  // before it gets to program any of them
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  sw->getUpdateEvb()->runInEventBaseThread([released] { released.wait(); });
+
+  // All of the entries are programmed by a single state update
+  EXPECT_HW_CALL(sw, stateChangedMock(_)).Times(1);
+  sendArpReply(handle.get(), "10.0.0.11", "02:10:20:30:40:11", 2);
+  sendArpReply(handle.get(), "10.0.0.15", "02:10:20:30:40:15", 3);
+  sendArpReply(handle.get(), "10.0.0.7", "02:10:20:30:40:07", 1);
+  sendArpReply(handle.get(), "10.0.0.22", "02:10:20:30:40:22", 4);
+  release.set_value();
+  waitForStateUpdates(sw);
+
+  auto arpTable =
+      sw->getState()->getVlans()->getVlan(VlanID(1))->getArpTable();
+  for (auto ip : {"10.0.0.11", "10.0.0.15", "10.0.0.7", "10.0.0.22"}) {
+    SCOPED_TRACE(ip);
+    auto entry = arpTable->getEntryIf(IPAddressV4(ip));
+    ASSERT_NE(nullptr, entry);
+    EXPECT_FALSE(entry->isPending());
+  }
+}
+
+TEST(ArpTest, BulkHitBits) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  IPAddress used("10.0.0.11");
+  IPAddress unused("10.0.0.15");
+
+  // The hardware table is only read once per stale entry interval, and each
+  // hit is only reported once
+  EXPECT_HW_CALL(sw, getAndClearNeighborHits(RouterID(0)))
+      .WillOnce(testing::Return(std::unordered_set<IPAddress>({used})));
+  EXPECT_HW_CALL(sw, getAndClearNeighborHit(_, _)).Times(0);
+  EXPECT_TRUE(sw->getAndClearNeighborHit(RouterID(0), used));
+  EXPECT_FALSE(sw->getAndClearNeighborHit(RouterID(0), unused));
+  EXPECT_FALSE(sw->getAndClearNeighborHit(RouterID(0), used));
+}
+
 TEST(ArpTest, PendingArp) {
   auto handle = setupTestHandle();
   auto sw = handle->getSw();
@@ -845,6 +913,8 @@ TEST(ArpTest, PendingArp) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.ipv4.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "ipv4.nexthop.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "ipv4.no_arp.sum", 0);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "trapped.pending.queued.sum", 1);
 
   // Receiving this duplicate packet should NOT trigger an ARP request out,
   // and no state update for now.
@@ -870,8 +940,13 @@ TEST(ArpTest, PendingArp) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.ipv4.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "ipv4.nexthop.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "ipv4.no_arp.sum", 1);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "trapped.pending.queued.sum", 1);
 
   EXPECT_HW_CALL(sw, stateChangedMock(_)).Times(1);
+  // Both packets were held until the entry resolves, and go out then
+  EXPECT_PKT(sw, "queued packet", checkRoutedIPv4Pkt(IPAddressV4("10.0.0.10")))
+      .Times(2);
   // Receive an arp reply for our pending entry
   sendArpReply(handle.get(), "10.0.0.10", "02:10:20:30:40:22", 1);
 
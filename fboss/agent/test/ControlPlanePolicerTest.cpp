@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ControlPlanePolicer.h"
+
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+
+#include <folly/io/Cursor.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using folly::io::Cursor;
+using std::chrono::milliseconds;
+
+namespace {
+
+using Class = ControlPlanePolicer::Class;
+
+const MacAddress kMac1("02:00:00:00:00:01");
+const MacAddress kMac2("02:00:00:00:00:02");
+
+// ARP only, 10 packets per second with bursts of up to 5
+std::unique_ptr<ControlPlanePolicer> makePolicer(size_t tableSize = 1024) {
+  std::array<ControlPlanePolicer::Params, ControlPlanePolicer::kNumClasses>
+      params;
+  params[static_cast<size_t>(Class::ARP)].rate = 10;
+  params[static_cast<size_t>(Class::ARP)].burst = 5;
+  return std::make_unique<ControlPlanePolicer>(params, tableSize);
+}
+
+// Number of packets admitted out of count sent by a source at once
+int admitted(
+    ControlPlanePolicer* policer,
+    int count,
+    ControlPlanePolicer::Clock::time_point now,
+    MacAddress mac = kMac1,
+    PortID port = PortID(1),
+    uint64_t ipHash = 1) {
+  int numAdmitted = 0;
+  for (int i = 0; i < count; ++i) {
+    numAdmitted += policer->admit(Class::ARP, port, mac, ipHash, now);
+  }
+  return numAdmitted;
+}
+
+// The payload of a packet, after the ethernet header
+Cursor payload(const MockRxPacket& pkt) {
+  Cursor c(pkt.buf());
+  c.skip(14);
+  return c;
+}
+
+} // unnamed namespace
+
+TEST(ControlPlanePolicer, burstThenRate) {
+  auto policer = makePolicer();
+  auto now = ControlPlanePolicer::Clock::now();
+  EXPECT_EQ(5, admitted(policer.get(), 20, now));
+  EXPECT_EQ(15, policer->getDrops(Class::ARP));
+
+  // 10 packets per second, so one more every 100ms
+  EXPECT_EQ(1, admitted(policer.get(), 5, now + milliseconds(100)));
+  EXPECT_EQ(3, admitted(policer.get(), 5, now + milliseconds(400)));
+  // The bucket never holds more than the burst
+  EXPECT_EQ(5, admitted(policer.get(), 20, now + milliseconds(60000)));
+}
+
+TEST(ControlPlanePolicer, sourcesAreIndependent) {
+  auto policer = makePolicer();
+  auto now = ControlPlanePolicer::Clock::now();
+  EXPECT_EQ(5, admitted(policer.get(), 10, now));
+  EXPECT_EQ(5, admitted(policer.get(), 10, now, kMac2));
+  EXPECT_EQ(5, admitted(policer.get(), 10, now, kMac1, PortID(2)));
+  EXPECT_EQ(5, admitted(policer.get(), 10, now, kMac1, PortID(1), 2));
+  EXPECT_EQ(0, admitted(policer.get(), 10, now));
+}
+
+TEST(ControlPlanePolicer, unpolicedClass) {
+  auto policer = makePolicer();
+  auto now = ControlPlanePolicer::Clock::now();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(policer->admit(Class::NDP, PortID(1), kMac1, 1, now));
+  }
+  EXPECT_EQ(0, policer->getDrops(Class::NDP));
+}
+
+TEST(ControlPlanePolicer, icmpErrors) {
+  std::array<ControlPlanePolicer::Params, ControlPlanePolicer::kNumClasses>
+      params;
+  params[static_cast<size_t>(Class::ICMP_ERROR)].rate = 1;
+  params[static_cast<size_t>(Class::ICMP_ERROR)].burst = 2;
+  ControlPlanePolicer policer(params, 1024);
+
+  folly::IPAddress src1("1.2.3.4");
+  folly::IPAddress src2("2401:db00:2110:3004::a");
+  EXPECT_TRUE(policer.admitIcmpError(PortID(1), kMac1, src1));
+  EXPECT_TRUE(policer.admitIcmpError(PortID(1), kMac1, src1));
+  EXPECT_FALSE(policer.admitIcmpError(PortID(1), kMac1, src1));
+  // Each source has its own bucket
+  EXPECT_TRUE(policer.admitIcmpError(PortID(1), kMac1, src2));
+  EXPECT_EQ(1, policer.getDrops(Class::ICMP_ERROR));
+  // ICMP errors don't use up the tokens of trapped packets
+  EXPECT_EQ(20, admitted(&policer, 20, ControlPlanePolicer::Clock::now()));
+}
+
+TEST(ControlPlanePolicer, tableHoldsAtMostTableSizeSources) {
+  auto policer = makePolicer(8);
+  EXPECT_EQ(8, policer->tableSize());
+  auto now = ControlPlanePolicer::Clock::now();
+  // Many more sources than fit still only get a burst each at a time, and
+  // evicted sources start over with a full bucket
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(
+        5,
+        admitted(
+            policer.get(), 10, now, MacAddress::fromHBO(0x020000000000 + i)));
+  }
+}
+
+TEST(ControlPlanePolicer, classifiesPackets) {
+  std::array<ControlPlanePolicer::Params, ControlPlanePolicer::kNumClasses>
+      params;
+  for (auto& classParams : params) {
+    classParams.rate = 1;
+    classParams.burst = 1;
+  }
+  ControlPlanePolicer policer(params, 1024);
+
+  auto arp = MockRxPacket::fromHex(
+      // dst mac, src mac, ARP
+      "ff ff ff ff ff ff  02 00 00 00 00 01  08 06"
+      // ethernet, IPv4, request
+      "00 01 08 00 06 04 00 01"
+      // sender mac and ip (10.0.0.15), target mac and ip (10.0.0.1)
+      "02 00 00 00 00 01  0a 00 00 0f"
+      "00 00 00 00 00 00  0a 00 00 01");
+  arp->setSrcPort(PortID(1));
+  EXPECT_TRUE(policer.admit(*arp, 0x0806, kMac1, payload(*arp)));
+  ControlPlanePolicer::Class dropped;
+  EXPECT_FALSE(policer.admit(*arp, 0x0806, kMac1, payload(*arp), &dropped));
+  EXPECT_EQ(Class::ARP, dropped);
+
+  auto ns = MockRxPacket::fromHex(
+      // dst mac, src mac, IPv6
+      "33 33 ff 00 00 0a  02 00 00 00 00 01  86 dd"
+      // version, flow label, length (32), ICMPv6, hop limit
+      "60 00 00 00  00 20 3a ff"
+      // src 2401:db00:2110:3004::1
+      "24 01 db 00 21 10 30 04  00 00 00 00 00 00 00 01"
+      // dst ff02::1:ff00:a
+      "ff 02 00 00 00 00 00 00  00 00 00 01 ff 00 00 0a"
+      // neighbor solicitation, code, checksum (fake), reserved
+      "87 00 12 34  00 00 00 00"
+      // target 2401:db00:2110:3004::a
+      "24 01 db 00 21 10 30 04  00 00 00 00 00 00 00 0a");
+  ns->setSrcPort(PortID(1));
+  EXPECT_TRUE(policer.admit(*ns, 0x86dd, kMac1, payload(*ns)));
+  EXPECT_FALSE(policer.admit(*ns, 0x86dd, kMac1, payload(*ns), &dropped));
+  EXPECT_EQ(Class::NDP, dropped);
+
+  // ICMPv6 that isn't NDP, e.g. an echo request, isn't policed
+  auto ping = MockRxPacket::fromHex(
+      "02 00 01 00 00 01  02 00 00 00 00 01  86 dd"
+      "60 00 00 00  00 08 3a 40"
+      "24 01 db 00 21 10 30 04  00 00 00 00 00 00 00 01"
+      "24 01 db 00 21 10 30 04  00 00 00 00 00 00 00 0a"
+      "80 00 12 34  00 01 00 01");
+  ping->setSrcPort(PortID(1));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(policer.admit(*ping, 0x86dd, kMac1, payload(*ping)));
+  }
+  EXPECT_EQ(1, policer.getDrops(Class::ARP));
+  EXPECT_EQ(1, policer.getDrops(Class::NDP));
+}
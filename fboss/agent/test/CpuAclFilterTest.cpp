@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/CpuAclFilter.h"
+
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+
+#include <folly/io/Cursor.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::MacAddress;
+using folly::io::Cursor;
+using std::make_shared;
+
+namespace {
+
+const MacAddress kDstMac("02:00:00:00:00:01");
+
+// UDP from 10.0.0.1:1024 to 10.0.0.2:53, DSCP 46, TTL 64
+std::unique_ptr<MockRxPacket> makeDnsPacket() {
+  auto pkt = MockRxPacket::fromHex(
+      // dst mac, src mac, IPv4
+      "02 00 00 00 00 01  02 00 00 00 00 02  08 00"
+      // version, IHL, DSCP, length, id, no fragments, TTL, UDP, checksum
+      "45 b8 00 2e  00 00 00 00  40 11 00 00"
+      "0a 00 00 01  0a 00 00 02"
+      // UDP ports, length, checksum
+      "04 00 00 35  00 1a 00 00");
+  pkt->padToLength(64);
+  pkt->setSrcPort(PortID(1));
+  return pkt;
+}
+
+// TCP SYN from [2401:db00::1]:49152 to [2401:db00::2]:179, hop limit 255
+std::unique_ptr<MockRxPacket> makeBgpPacket() {
+  auto pkt = MockRxPacket::fromHex(
+      "02 00 00 00 00 01  02 00 00 00 00 02  86 dd"
+      // version, traffic class, flow label, length, TCP, hop limit
+      "60 00 00 00  00 14  06  ff"
+      "24 01 db 00 00 00 00 00  00 00 00 00 00 00 00 01"
+      "24 01 db 00 00 00 00 00  00 00 00 00 00 00 00 02"
+      // TCP ports, sequence and ack numbers, data offset, SYN
+      "c0 00 00 b3  00 00 00 01  00 00 00 00  50 02 ff ff"
+      "00 00 00 00");
+  pkt->padToLength(78);
+  pkt->setSrcPort(PortID(2));
+  return pkt;
+}
+
+std::unique_ptr<MockRxPacket> makeArpPacket() {
+  auto pkt = MockRxPacket::fromHex(
+      "ff ff ff ff ff ff  02 00 00 00 00 02  08 06"
+      "00 01  08 00  06  04  00 01"
+      "02 00 00 00 00 02  0a 00 00 01"
+      "00 00 00 00 00 00  0a 00 00 02");
+  pkt->padToLength(64);
+  pkt->setSrcPort(PortID(1));
+  return pkt;
+}
+
+CpuAclClassifier::PacketFields parse(const RxPacket& pkt) {
+  Cursor c(pkt.buf());
+  c.skip(12);
+  auto ethertype = c.readBE<uint16_t>();
+  return CpuAclClassifier::parse(pkt, ethertype, kDstMac, c);
+}
+
+std::shared_ptr<AclEntry> makeDeny(int priority, const std::string& name) {
+  auto acl = make_shared<AclEntry>(priority, name);
+  acl->setActionType(cfg::AclActionType::DENY);
+  return acl;
+}
+
+std::shared_ptr<AclEntry> makeCopp(int priority, const std::string& name) {
+  auto acl = make_shared<AclEntry>(priority, name);
+  cfg::QueueMatchAction queue;
+  queue.queueId = 9;
+  MatchAction action;
+  action.setSendToQueue(std::make_pair(queue, true));
+  acl->setAclAction(action);
+  return acl;
+}
+
+std::shared_ptr<AclMap> makeAcls() {
+  auto acls = make_shared<AclMap>();
+
+  auto allowDns = makeCopp(10, "allowDns");
+  allowDns->setProto(17);
+  allowDns->setDstL4PortRange(AclL4PortRange(53, 53, false));
+  acls->addEntry(allowDns);
+
+  // Would drop the DNS packet, if it wasn't allowed first
+  auto denyUdp = makeDeny(20, "denyUdp");
+  denyUdp->setProto(17);
+  acls->addEntry(denyUdp);
+
+  auto denyBgpSyn = makeDeny(30, "denyBgpSyn");
+  denyBgpSyn->setSrcIp(IPAddress::createNetwork("2401:db00::/32"));
+  denyBgpSyn->setDstL4PortRange(AclL4PortRange(179, 179, false));
+  denyBgpSyn->setTcpFlagsBitMap(0x02);
+  acls->addEntry(denyBgpSyn);
+
+  // Can't be checked in software
+  auto denyLocal = makeDeny(40, "denyLocal");
+  denyLocal->setDstIpLocal(true);
+  acls->addEntry(denyLocal);
+
+  // Not a control plane acl
+  auto dataPlane = make_shared<AclEntry>(50, "dataPlane");
+  dataPlane->setDscp(46);
+  acls->addEntry(dataPlane);
+  return acls;
+}
+
+} // unnamed namespace
+
+TEST(CpuAclFilter, parseIPv4) {
+  auto pkt = makeDnsPacket();
+  auto fields = parse(*pkt);
+  EXPECT_EQ(PortID(1), fields.srcPort);
+  EXPECT_EQ(64, fields.length);
+  EXPECT_TRUE(fields.isV4);
+  EXPECT_EQ(IPAddress("10.0.0.1"), fields.srcIp);
+  EXPECT_EQ(IPAddress("10.0.0.2"), fields.dstIp);
+  EXPECT_EQ(17, fields.proto);
+  EXPECT_EQ(46, fields.dscp);
+  EXPECT_EQ(64, fields.ttl);
+  EXPECT_FALSE(fields.moreFragments || fields.nonFirstFragment);
+  EXPECT_TRUE(fields.hasL4Ports);
+  EXPECT_EQ(1024, fields.srcL4Port);
+  EXPECT_EQ(53, fields.dstL4Port);
+  EXPECT_FALSE(fields.hasTcpFlags);
+}
+
+TEST(CpuAclFilter, parseIPv6) {
+  auto pkt = makeBgpPacket();
+  auto fields = parse(*pkt);
+  EXPECT_TRUE(fields.isV6);
+  EXPECT_EQ(IPAddress("2401:db00::1"), fields.srcIp);
+  EXPECT_EQ(IPAddress("2401:db00::2"), fields.dstIp);
+  EXPECT_EQ(6, fields.proto);
+  EXPECT_EQ(255, fields.ttl);
+  EXPECT_EQ(49152, fields.srcL4Port);
+  EXPECT_EQ(179, fields.dstL4Port);
+  EXPECT_TRUE(fields.hasTcpFlags);
+  EXPECT_EQ(0x02, fields.tcpFlags);
+}
+
+TEST(CpuAclFilter, parseNonIp) {
+  auto pkt = makeArpPacket();
+  auto fields = parse(*pkt);
+  EXPECT_FALSE(fields.isV4 || fields.isV6);
+  EXPECT_FALSE(fields.hasL4Ports);
+}
+
+TEST(CpuAclFilter, classify) {
+  CpuAclClassifier classifier(makeAcls());
+  EXPECT_EQ(3, classifier.size());
+
+  auto dns = makeDnsPacket();
+  EXPECT_TRUE(classifier.permits(parse(*dns)));
+  EXPECT_EQ(1, classifier.getHits("allowDns"));
+  EXPECT_EQ(0, classifier.getHits("denyUdp"));
+
+  auto bgp = makeBgpPacket();
+  EXPECT_FALSE(classifier.permits(parse(*bgp)));
+  EXPECT_EQ(1, classifier.getHits("denyBgpSyn"));
+
+  auto arp = makeArpPacket();
+  EXPECT_TRUE(classifier.permits(parse(*arp)));
+  EXPECT_EQ(0, classifier.getHits("dataPlane"));
+  EXPECT_EQ(0, classifier.getHits("denyLocal"));
+}
+
+TEST(CpuAclFilter, hitsCarryOver) {
+  CpuAclClassifier classifier(makeAcls());
+  auto bgp = makeBgpPacket();
+  EXPECT_FALSE(classifier.permits(parse(*bgp)));
+  EXPECT_FALSE(classifier.permits(parse(*bgp)));
+
+  // Without the allow rule, DNS is now dropped too
+  auto acls = makeAcls();
+  acls->removeEntry("allowDns");
+  CpuAclClassifier updated(acls, &classifier);
+  EXPECT_EQ(2, updated.getHits("denyBgpSyn"));
+  auto dns = makeDnsPacket();
+  EXPECT_FALSE(updated.permits(parse(*dns)));
+  EXPECT_EQ(1, updated.getHits("denyUdp"));
+  EXPECT_EQ(0, updated.getHits("allowDns"));
+}
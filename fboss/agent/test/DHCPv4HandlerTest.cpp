@@ -377,9 +377,54 @@ TEST(DHCPv4HandlerTest, DHCPRequest) {
 
   counters.update();
   counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.pkt.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.relay_fwd.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum", 1);
 }
 
+TEST(DHCPv4HandlerTest, DHCPRequestAfterRelayChange) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  const char* senderIP = "00 00 00 00";
+  // Client mac
+  auto senderMac = kClientMac.toString();
+  std::replace(senderMac.begin(), senderMac.end(), ':', ' ');
+  const string targetMac = "ff ff ff ff ff ff";
+  const string targetIP = "ff ff ff ff";
+  const string bootpOp = "01";
+  const string vlan = "00 01";
+  const string srcPort = "00 43";
+  const string dstPort = "00 44";
+  // DHCP Message type (option = 53, len = 1, message type = DHCP discover
+  const string dhcpMsgTypeOpt = "35  01  01";
+  CounterCache counters(sw);
+
+  EXPECT_PLATFORM_CALL(sw, getLocalMac()).
+    WillRepeatedly(Return(kPlatformMac));
+
+  EXPECT_PKT(sw, "DHCP request", checkDHCPReq());
+  sendDHCPPacket(handle.get(), senderMac, targetMac, vlan,
+      senderIP, targetIP, srcPort, dstPort, bootpOp, dhcpMsgTypeOpt);
+
+  // The relay configuration cached for the vlan must not outlive the state
+  const IPAddressV4 kNewDhcpV4Relay("40.40.40.40");
+  sw->updateStateBlocking(
+      "change DHCP relay", [&](const shared_ptr<SwitchState>& state) {
+        auto newState = state->clone();
+        auto newVlan =
+            newState->getVlans()->getVlan(VlanID(1))->modify(&newState);
+        newVlan->setDhcpV4Relay(kNewDhcpV4Relay);
+        return newState;
+      });
+
+  EXPECT_PKT(sw, "DHCP request", checkDHCPReq(kNewDhcpV4Relay));
+  sendDHCPPacket(handle.get(), senderMac, targetMac, vlan,
+      senderIP, targetIP, srcPort, dstPort, bootpOp, dhcpMsgTypeOpt);
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.relay_fwd.sum", 2);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.drop_pkt.sum", 0);
+}
+
 TEST(DHCPv4HandlerOverrideTest, DHCPRequest) {
   auto handle = setupTestHandle();
   auto sw = handle->getSw();
@@ -477,6 +522,8 @@ TEST(DHCPv4HandlerTest, DHCPReply) {
 
   counters.update();
   counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.pkt.sum", 1);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "dhcpV4.relay_reply.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum", 1);
 }
 
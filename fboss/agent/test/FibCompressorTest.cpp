@@ -0,0 +1,257 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/FibCompressor.h"
+
+#include "fboss/agent/state/RouteNextHop.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using std::make_shared;
+using std::shared_ptr;
+
+namespace {
+
+/*
+ * Forwarding 0 drops, 1 goes to the CPU, and the others each go to a next
+ * hop of their own
+ */
+RouteNextHopEntry forwarding(int fwd) {
+  if (fwd == 0) {
+    return RouteNextHopEntry(RouteForwardAction::DROP, AdminDistance::EBGP);
+  }
+  if (fwd == 1) {
+    return RouteNextHopEntry(RouteForwardAction::TO_CPU, AdminDistance::EBGP);
+  }
+  RouteNextHopEntry::NextHopSet nhops;
+  nhops.emplace(ResolvedNextHop(
+      IPAddress(folly::to<std::string>("1.1.1.", fwd)),
+      InterfaceID(1),
+      ECMP_WEIGHT));
+  return RouteNextHopEntry(std::move(nhops), AdminDistance::EBGP);
+}
+
+RoutePrefixV4 makePrefix(IPAddressV4 network, uint8_t length) {
+  return RoutePrefixV4{network.mask(length), length};
+}
+
+RoutePrefixV4 makePrefix(const std::string& cidr) {
+  auto network = IPAddress::createNetwork(cidr);
+  return makePrefix(network.first.asV4(), network.second);
+}
+
+shared_ptr<RouteV4> makeRoute(const RoutePrefixV4& prefix, int fwd) {
+  auto route = make_shared<RouteV4>(prefix, ClientID(1), forwarding(fwd));
+  route->setResolved(forwarding(fwd));
+  return route;
+}
+
+shared_ptr<RouteV4> makeRoute(const std::string& cidr, int fwd) {
+  return makeRoute(makePrefix(cidr), fwd);
+}
+
+/*
+ * What a HwSwitch would have programmed, kept up to date from the changes
+ */
+class ProgrammedTable {
+ public:
+  void apply(const FibCompressorV4::Changes& changes) {
+    for (const auto& route : changes.removed) {
+      EXPECT_EQ(1, routes_.erase(key(route)));
+    }
+    for (const auto& change : changes.addedChanged) {
+      auto it = routes_.find(key(change.second));
+      if (change.first) {
+        ASSERT_NE(routes_.end(), it);
+        EXPECT_TRUE(FibCompressorV4::sameForwarding(change.first, it->second));
+        it->second = change.second;
+      } else {
+        EXPECT_EQ(routes_.end(), it);
+        routes_.emplace(key(change.second), change.second);
+      }
+    }
+  }
+
+  shared_ptr<RouteV4> getRouteIf(const std::string& cidr) const {
+    auto it = routes_.find(key(makeRoute(cidr, 0)));
+    return it == routes_.end() ? nullptr : it->second;
+  }
+
+  size_t size() const {
+    return routes_.size();
+  }
+
+  const std::map<std::pair<uint32_t, uint8_t>, shared_ptr<RouteV4>>& routes()
+      const {
+    return routes_;
+  }
+
+ private:
+  static std::pair<uint32_t, uint8_t> key(const shared_ptr<RouteV4>& route) {
+    return std::make_pair(
+        route->prefix().network.toLongHBO(), route->prefix().mask);
+  }
+
+  std::map<std::pair<uint32_t, uint8_t>, shared_ptr<RouteV4>> routes_;
+};
+
+// The route of the longest prefix in routes holding addr, nullptr if none
+template <typename RouteMap>
+shared_ptr<RouteV4> longestMatch(const RouteMap& routes, uint32_t addr) {
+  for (int length = 32; length >= 0; --length) {
+    auto network = length ? addr & (~0u << (32 - length)) : 0;
+    auto it = routes.find(std::make_pair(network, length));
+    if (it != routes.end()) {
+      return it->second;
+    }
+  }
+  return nullptr;
+}
+
+} // unnamed namespace
+
+TEST(FibCompressor, mergesSiblings) {
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  compressor.addRoute(makeRoute("10.0.0.0/25", 2));
+  compressor.addRoute(makeRoute("10.0.0.128/25", 2));
+  compressor.addRoute(makeRoute("10.0.1.0/24", 2));
+  compressor.addRoute(makeRoute("10.0.2.0/24", 3));
+  programmed.apply(compressor.getChanges());
+
+  EXPECT_EQ(4, compressor.numRoutes());
+  EXPECT_EQ(2, compressor.numProgrammed());
+  ASSERT_EQ(2, programmed.size());
+  auto merged = programmed.getRouteIf("10.0.0.0/23");
+  ASSERT_NE(nullptr, merged);
+  EXPECT_EQ(forwarding(2), merged->getForwardInfo());
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.2.0/24"));
+
+  // Splitting a half off undoes the merges above it
+  compressor.addRoute(makeRoute("10.0.0.128/25", 3));
+  programmed.apply(compressor.getChanges());
+  EXPECT_EQ(4, programmed.size());
+  EXPECT_EQ(nullptr, programmed.getRouteIf("10.0.0.0/23"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.0.0/25"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.0.128/25"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.1.0/24"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.2.0/24"));
+}
+
+TEST(FibCompressor, dropsCoveredRoutes) {
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  compressor.addRoute(makeRoute("10.0.0.0/16", 2));
+  compressor.addRoute(makeRoute("10.0.1.0/24", 2));
+  compressor.addRoute(makeRoute("10.0.1.128/25", 3));
+  compressor.addRoute(makeRoute("10.0.1.192/26", 2));
+  programmed.apply(compressor.getChanges());
+
+  EXPECT_EQ(3, programmed.size());
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.0.0/16"));
+  EXPECT_EQ(nullptr, programmed.getRouteIf("10.0.1.0/24"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.1.128/25"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.1.192/26"));
+
+  // Without the covering route the /24 is needed again
+  compressor.removeRoute(makePrefix("10.0.0.0/16"));
+  programmed.apply(compressor.getChanges());
+  EXPECT_EQ(3, programmed.size());
+  EXPECT_EQ(nullptr, programmed.getRouteIf("10.0.0.0/16"));
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.1.0/24"));
+}
+
+TEST(FibCompressor, keepsHostRoutes) {
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  compressor.addRoute(makeRoute("10.0.0.2/32", 2));
+  compressor.addRoute(makeRoute("10.0.0.3/32", 2));
+  programmed.apply(compressor.getChanges());
+  EXPECT_EQ(2, programmed.size());
+  EXPECT_EQ(nullptr, programmed.getRouteIf("10.0.0.2/31"));
+}
+
+TEST(FibCompressor, sameForwardingIsNotReprogrammed) {
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  compressor.addRoute(makeRoute("10.0.0.0/24", 2));
+  programmed.apply(compressor.getChanges());
+  ASSERT_EQ(1, programmed.size());
+
+  // A new route object with another admin distance forwards the same way
+  auto route = make_shared<RouteV4>(
+      makePrefix("10.0.0.0/24"), ClientID(2), forwarding(2));
+  auto fwd = forwarding(2);
+  route->setResolved(
+      RouteNextHopEntry(fwd.getNextHopSet(), AdminDistance::STATIC_ROUTE));
+  compressor.addRoute(route);
+  EXPECT_TRUE(compressor.getChanges().empty());
+}
+
+TEST(FibCompressor, retriesFailedEntries) {
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  compressor.addRoute(makeRoute("10.0.0.0/24", 2));
+  auto changes = compressor.getChanges();
+  ASSERT_EQ(1, changes.addedChanged.size());
+  compressor.programFailed(
+      changes.addedChanged[0].second->prefix(), nullptr);
+  EXPECT_EQ(0, compressor.numProgrammed());
+
+  programmed.apply(compressor.getChanges());
+  EXPECT_EQ(1, compressor.numProgrammed());
+  EXPECT_NE(nullptr, programmed.getRouteIf("10.0.0.0/24"));
+}
+
+TEST(FibCompressor, forwardsAsTheTable) {
+  // Routes in 10.0.0.0/16 only, so every address can be checked
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<uint32_t> addrDist(0, 0xffff);
+  std::uniform_int_distribution<int> lengthDist(16, 32);
+  std::uniform_int_distribution<int> fwdDist(0, 3);
+  std::uniform_int_distribution<int> opDist(0, 3);
+
+  FibCompressorV4 compressor;
+  ProgrammedTable programmed;
+  std::map<std::pair<uint32_t, uint8_t>, shared_ptr<RouteV4>> table;
+  const uint32_t base = IPAddressV4("10.0.0.0").toLongHBO();
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 200; ++i) {
+      auto prefix = makePrefix(
+          IPAddressV4::fromLongHBO(base + addrDist(gen)), lengthDist(gen));
+      auto key = std::make_pair(prefix.network.toLongHBO(), prefix.mask);
+      if (opDist(gen) == 0) {
+        table.erase(key);
+        compressor.removeRoute(prefix);
+      } else {
+        auto route = makeRoute(prefix, fwdDist(gen));
+        table[key] = route;
+        compressor.addRoute(route);
+      }
+    }
+    programmed.apply(compressor.getChanges());
+
+    EXPECT_EQ(table.size(), compressor.numRoutes());
+    EXPECT_EQ(programmed.size(), compressor.numProgrammed());
+    EXPECT_LE(programmed.size(), table.size());
+    for (uint32_t addr = base; addr <= base + 0xffff; ++addr) {
+      auto expected = longestMatch(table, addr);
+      auto actual = longestMatch(programmed.routes(), addr);
+      ASSERT_TRUE(FibCompressorV4::sameForwarding(expected, actual))
+          << "round " << round << " " << IPAddressV4::fromLongHBO(addr);
+    }
+  }
+}
@@ -0,0 +1,193 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/HwCallRecorder.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/mock/MockTestHandle.h"
+#include "fboss/agent/hw/sim/HwCallReplayer.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using std::chrono::microseconds;
+
+namespace {
+
+class HwCallRecorderTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    int fd = mkstemp(path_);
+    folly::checkUnixError(fd, "failed to create temporary file");
+    close(fd);
+  }
+  void TearDown() override {
+    HwCallRecorder::get()->stop();
+    unlink(path_);
+  }
+
+ protected:
+  char path_[32] = "fbossHwCallTest.XXXXXX";
+};
+
+HwCallRecord makeRecord(
+    HwCall call,
+    uint64_t timestampUs,
+    const IPAddress& addr,
+    uint8_t prefixLength = 0,
+    int32_t id = 0,
+    int32_t count = 0) {
+  HwCallRecord record;
+  record.call = call;
+  record.timestampNs = timestampUs * 1000;
+  record.durationNs = 1000;
+  record.setAddress(addr);
+  record.prefixLength = prefixLength;
+  record.id = id;
+  record.count = count;
+  return record;
+}
+
+} // unnamed namespace
+
+TEST_F(HwCallRecorderTest, recordsNestedCalls) {
+  auto recorder = HwCallRecorder::get();
+  recorder->start(path_);
+  EXPECT_TRUE(recorder->isRecording());
+  {
+    HwCallScope route(HwCall::ROUTE_ADD);
+    EXPECT_TRUE(route.isActive());
+    route.setAddress(IPAddress("2401:db00:1::"), 64);
+    route.setVrf(1);
+    route.setCount(2);
+    {
+      HwCallScope ecmp(HwCall::ECMP_PROGRAM);
+      ecmp.setCount(2);
+      ecmp.setId(200256);
+    }
+    route.setId(200256);
+  }
+  {
+    HwCallScope host(HwCall::HOST_ADD);
+    host.setAddress(IPAddress("10.0.0.2"));
+    host.setId(100003);
+  }
+  recorder->stop();
+  EXPECT_FALSE(recorder->isRecording());
+
+  auto records = HwCallRecorder::read(path_);
+  ASSERT_EQ(3, records.size());
+  // In the order the calls finished
+  EXPECT_EQ(HwCall::ECMP_PROGRAM, records[0].call);
+  EXPECT_EQ(1, records[0].depth);
+  EXPECT_EQ(200256, records[0].id);
+
+  EXPECT_EQ(HwCall::ROUTE_ADD, records[1].call);
+  EXPECT_EQ(0, records[1].depth);
+  EXPECT_EQ(IPAddress("2401:db00:1::"), records[1].getAddress());
+  EXPECT_EQ(64, records[1].prefixLength);
+  EXPECT_EQ(1, records[1].vrf);
+  EXPECT_EQ(2, records[1].count);
+  EXPECT_EQ(200256, records[1].id);
+  EXPECT_LE(records[1].timestampNs, records[0].timestampNs);
+  EXPECT_GE(records[1].durationNs, records[0].durationNs);
+
+  EXPECT_EQ(HwCall::HOST_ADD, records[2].call);
+  EXPECT_EQ(0, records[2].depth);
+  EXPECT_EQ(IPAddress("10.0.0.2"), records[2].getAddress());
+  EXPECT_EQ(100003, records[2].id);
+}
+
+TEST_F(HwCallRecorderTest, nothingRecordedWhenStopped) {
+  auto recorder = HwCallRecorder::get();
+  {
+    HwCallScope route(HwCall::ROUTE_ADD);
+    EXPECT_FALSE(route.isActive());
+    // Started in the middle of the call, which isn't recorded
+    recorder->start(path_);
+  }
+  recorder->stop();
+  {
+    HwCallScope host(HwCall::HOST_ADD);
+    EXPECT_FALSE(host.isActive());
+  }
+  EXPECT_TRUE(HwCallRecorder::read(path_).empty());
+}
+
+TEST_F(HwCallRecorderTest, rejectsOtherFiles) {
+  ASSERT_TRUE(folly::writeFile(std::string("not a recording"), path_));
+  EXPECT_THROW(HwCallRecorder::read(path_), FbossError);
+}
+
+TEST(HwCallReplayer, replaysRoutesAndHosts) {
+  auto handle = createTestHandle(testStateA());
+  auto sw = handle->getSw();
+
+  std::vector<HwCallRecord> records;
+  // Two routes on the same ECMP group, and the group they programmed
+  auto ecmp = makeRecord(HwCall::ECMP_PROGRAM, 0, IPAddress("::"), 0, 7, 2);
+  ecmp.depth = 1;
+  records.push_back(ecmp);
+  records.push_back(makeRecord(
+      HwCall::ROUTE_ADD, 0, IPAddress("2401:db00:1::"), 64, 7, 2));
+  records.push_back(makeRecord(
+      HwCall::ROUTE_ADD, 10, IPAddress("2401:db00:2::"), 64, 7, 2));
+  records.push_back(makeRecord(HwCall::HOST_ADD, 20, IPAddress("10.0.0.10")));
+  // Outside every subnet
+  records.push_back(makeRecord(HwCall::HOST_ADD, 30, IPAddress("10.9.9.9")));
+  // Well after the others
+  records.push_back(makeRecord(
+      HwCall::ROUTE_DELETE, 1000, IPAddress("2401:db00:1::"), 64));
+
+  HwCallReplayer::Options options;
+  options.batchWindow = microseconds(100);
+  HwCallReplayer replayer(sw, options);
+  auto result = replayer.replay(records);
+
+  EXPECT_EQ(2, result.stateUpdates);
+  EXPECT_EQ(2, result.routesAdded);
+  EXPECT_EQ(1, result.routesDeleted);
+  EXPECT_EQ(1, result.hostsAdded);
+  EXPECT_EQ(0, result.hostsDeleted);
+  EXPECT_EQ(1, result.notReplayed);
+  EXPECT_EQ(std::chrono::nanoseconds(5000), result.recordedTime);
+
+  auto state = waitForStateUpdates(sw);
+  auto rib = state->getRouteTables()->getRouteTable(RouterID(0))->getRibV6();
+  RouteV6::Prefix deleted{IPAddressV6("2401:db00:1::"), 64};
+  RouteV6::Prefix added{IPAddressV6("2401:db00:2::"), 64};
+  EXPECT_EQ(nullptr, rib->exactMatch(deleted));
+  auto route = rib->exactMatch(added);
+  ASSERT_NE(nullptr, route);
+  EXPECT_TRUE(route->isResolved());
+  const auto& nhops = route->getForwardInfo().getNextHopSet();
+  ASSERT_EQ(2, nhops.size());
+  for (const auto& nhop : nhops) {
+    EXPECT_TRUE(nhop.addr().inSubnet("2401:db00:2110:3001::/64"));
+  }
+
+  auto arpTable = state->getVlans()->getVlan(VlanID(1))->getArpTable();
+  EXPECT_NE(nullptr, arpTable->getEntryIf(IPAddressV4("10.0.0.10")));
+}
@@ -39,6 +39,8 @@
 #include "fboss/agent/state/RouteUpdater.h"
 
 #include <boost/cast.hpp>
+#include <folly/ScopeGuard.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 using namespace facebook::fboss;
@@ -53,6 +55,9 @@ using std::string;
 using ::testing::_;
 using testing::Return;
 
+DECLARE_int32(cpu_policer_icmp_error_pps);
+DECLARE_int32(cpu_policer_icmp_error_burst);
+
 namespace {
 
 const MacAddress kPlatformMac("02:01:02:03:04:05");
@@ -326,6 +331,51 @@ TEST(ICMPTest, TTLExceededV4) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "ipv4.ttl_exceeded.sum", 1);
 }
 
+TEST(ICMPTest, TTLExceededV4RateLimited) {
+  auto oldPps = FLAGS_cpu_policer_icmp_error_pps;
+  auto oldBurst = FLAGS_cpu_policer_icmp_error_burst;
+  SCOPE_EXIT {
+    FLAGS_cpu_policer_icmp_error_pps = oldPps;
+    FLAGS_cpu_policer_icmp_error_burst = oldBurst;
+  };
+  // At most 3 ICMP errors at once, and then hardly any
+  FLAGS_cpu_policer_icmp_error_pps = 1;
+  FLAGS_cpu_policer_icmp_error_burst = 3;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  // An IPv4 UDP packet from 1.2.3.4 to 10.1.0.10 with TTL = 1
+  auto pkt = PktUtil::parseHexData(
+      // dst mac, src mac
+      "00 02 00 00 00 01  02 00 02 01 02 03"
+      // 802.1q, VLAN 1
+      "81 00 00 01"
+      // IPv4
+      "08 00"
+      "45 00 00 24  00 00 00 00  01 11 12 34"
+      "01 02 03 04  0a 01 00 0a"
+      // UDP
+      "00 45 00 46  00 10 12 34"
+      "01 02 03 04 05 06 07 08");
+
+  CounterCache counters(sw);
+
+  EXPECT_PLATFORM_CALL(sw, getLocalMac()).
+    WillRepeatedly(Return(kPlatformMac));
+  EXPECT_HW_CALL(sw, sendPacketSwitchedAsync_(_)).Times(3);
+
+  for (int i = 0; i < 10; ++i) {
+    handle->rxPacket(std::make_unique<folly::IOBuf>(pkt), PortID(1),
+                     VlanID(1));
+  }
+
+  counters.update();
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "ipv4.ttl_exceeded.sum", 10);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "ipv4.icmp_error_suppressed.sum", 7);
+}
+
 // Force ICMP TTL expiration to test that serialize(unserialize(x)) = x
 // even if we have extra IPv4 options
 TEST(ICMPTest, TTLExceededV4IPExtraOptions) {
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/LatencyQuantiles.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace facebook::fboss;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+
+DECLARE_int32(latency_quantiles_half_life_s);
+
+TEST(LatencyQuantiles, mergesThreads) {
+  LatencyQuantiles latency("test.latency.us");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&latency, t] {
+      for (int i = 0; i < 1000; ++i) {
+        latency.addValue(microseconds(t == 3 ? 5000 : 10));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  latency.addValue(microseconds(10));
+
+  auto now = LatencyQuantiles::Clock::now();
+  latency.publish(now);
+  auto sketch = latency.getSketch();
+  EXPECT_NEAR(4001, sketch.count(), 1e-6);
+  EXPECT_EQ(10, sketch.quantile(0.5));
+  EXPECT_NEAR(5000, sketch.quantile(0.99), 5000 / QuantileSketch::kSubBuckets);
+
+  // Nothing new, the samples only decay
+  latency.publish(now + seconds(FLAGS_latency_quantiles_half_life_s));
+  EXPECT_NEAR(2000.5, latency.getSketch().count(), 1e-6);
+}
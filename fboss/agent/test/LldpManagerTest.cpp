@@ -113,6 +113,22 @@ TEST(LldpManagerTest, LldpSend) {
   lldpManager.sendLldpOnAllPorts(false);
 }
 
+TEST(LldpManagerTest, LldpSendReusesFrames) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  auto numPorts = sw->getState()->getPorts()->size();
+
+  // The frames built on the first round are sent again as they were
+  EXPECT_HW_CALL(
+      sw,
+      sendPacketOutOfPortAsync_(
+          TxPacketMatcher::createMatcher("Lldp PDU", checkLldpPDU()), _, _))
+      .Times(AtLeast(2 * numPorts));
+  LldpManager lldpManager(sw);
+  lldpManager.sendLldpOnAllPorts(false);
+  lldpManager.sendLldpOnAllPorts(false);
+}
+
 TEST(LldpManagerTest, NotEnabledTest) {
   // Setup switch without flags enabling LLDP, and
   // send an LLDP frame nevertheless. Used to segfault
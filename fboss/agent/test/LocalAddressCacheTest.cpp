@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/LocalAddressCache.h"
+
+#include "fboss/agent/state/ArpResponseTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/NdpResponseTable.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+
+namespace {
+
+const MacAddress kMac("00:02:00:00:00:01");
+
+std::shared_ptr<SwitchState> stateWithResponses() {
+  auto state = testStateA();
+  auto vlan = state->getVlans()->getVlan(VlanID(1));
+  auto arpTable = std::make_shared<ArpResponseTable>();
+  arpTable->setEntry(IPAddressV4("10.0.0.1"), kMac, InterfaceID(1));
+  vlan->setArpResponseTable(arpTable);
+  auto ndpTable = std::make_shared<NdpResponseTable>();
+  ndpTable->setEntry(IPAddressV6("2401:db00:2110:3001::1"), kMac,
+                     InterfaceID(1));
+  vlan->setNdpResponseTable(ndpTable);
+  return state;
+}
+
+} // unnamed namespace
+
+TEST(LocalAddressCache, lookups) {
+  LocalAddressCache cache;
+  auto state = stateWithResponses();
+  auto index = cache.get(state);
+
+  auto intf = index->getInterface(RouterID(0), IPAddress("10.0.55.1"));
+  ASSERT_NE(nullptr, intf);
+  EXPECT_EQ(InterfaceID(55), intf->getID());
+  intf = index->getInterface(
+      RouterID(0), IPAddress("2401:db00:2110:3001::1"));
+  ASSERT_NE(nullptr, intf);
+  EXPECT_EQ(InterfaceID(1), intf->getID());
+  EXPECT_EQ(nullptr, index->getInterface(RouterID(0), IPAddress("10.0.0.2")));
+  EXPECT_EQ(nullptr, index->getInterface(RouterID(1), IPAddress("10.0.0.1")));
+
+  intf = index->getInterfaceInVlan(VlanID(55));
+  ASSERT_NE(nullptr, intf);
+  EXPECT_EQ(InterfaceID(55), intf->getID());
+  EXPECT_EQ(nullptr, index->getInterfaceInVlan(VlanID(2)));
+
+  auto entry = index->getArpResponse(VlanID(1), IPAddressV4("10.0.0.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(kMac, entry->mac);
+  EXPECT_EQ(InterfaceID(1), entry->interfaceID);
+  // Responses are only for the vlan they are configured on
+  EXPECT_EQ(
+      nullptr, index->getArpResponse(VlanID(55), IPAddressV4("10.0.0.1")));
+  EXPECT_EQ(nullptr, index->getArpResponse(VlanID(1), IPAddressV4("10.0.0.2")));
+
+  entry = index->getNdpResponse(
+      VlanID(1), IPAddressV6("2401:db00:2110:3001::1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(kMac, entry->mac);
+  EXPECT_EQ(nullptr, index->getNdpResponse(
+      VlanID(55), IPAddressV6("2401:db00:2110:3001::1")));
+}
+
+TEST(LocalAddressCache, rebuiltOnStateChange) {
+  LocalAddressCache cache;
+  auto state = stateWithResponses();
+  state->publish();
+  auto index = cache.get(state);
+  EXPECT_EQ(index, cache.get(state));
+
+  // A state with the same generation is still told apart
+  auto other = stateWithResponses();
+  other->publish();
+  auto otherIndex = cache.get(other);
+  EXPECT_NE(index, otherIndex);
+
+  // And so is a state cloned from it
+  auto newState = other->clone();
+  auto vlan = newState->getVlans()->getVlan(VlanID(1))->modify(&newState);
+  vlan->setArpResponseTable(std::make_shared<ArpResponseTable>());
+  newState->publish();
+  auto newIndex = cache.get(newState);
+  EXPECT_NE(otherIndex, newIndex);
+  EXPECT_EQ(nullptr,
+            newIndex->getArpResponse(VlanID(1), IPAddressV4("10.0.0.1")));
+  // The index the handler got for the old state stays valid
+  EXPECT_NE(nullptr,
+            otherIndex->getArpResponse(VlanID(1), IPAddressV4("10.0.0.1")));
+}
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/MultiUnitHwSwitch.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/hw/mock/MockHwSwitch.h"
+#include "fboss/agent/hw/mock/MockPlatform.h"
+#include "fboss/agent/hw/mock/MockTxPacket.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/Conv.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+/*
+ * A unit which applies every change, unless told to stay stuck at some
+ * state, and remembers the state it was last told it is at.
+ */
+class FakeUnit : public MockHwSwitch {
+ public:
+  explicit FakeUnit(MockPlatform* platform) : MockHwSwitch(platform) {}
+
+  std::shared_ptr<SwitchState> stateChanged(const StateDelta& delta) override {
+    lastOld = delta.oldState();
+    return stuckAt ? stuckAt : delta.newState();
+  }
+
+  std::shared_ptr<SwitchState> lastOld;
+  std::shared_ptr<SwitchState> stuckAt;
+};
+
+std::shared_ptr<SwitchState> stateWithPorts(int first, int last) {
+  auto state = std::make_shared<SwitchState>();
+  for (int i = first; i <= last; ++i) {
+    state->registerPort(PortID(i), folly::to<std::string>("port", i));
+  }
+  return state;
+}
+
+class MultiUnitHwSwitchTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    std::vector<std::unique_ptr<HwSwitch>> units;
+    for (int i = 0; i < 2; ++i) {
+      auto unit = std::make_unique<FakeUnit>(&platform_);
+      units_.push_back(unit.get());
+      units.push_back(std::move(unit));
+    }
+    // Ports 1 and 2 are on unit 0, 3 and 4 on unit 1
+    hw_ = std::make_unique<MultiUnitHwSwitch>(
+        std::move(units),
+        [](PortID port) { return static_cast<int>(port) <= 2 ? 0 : 1; });
+  }
+
+  HwInitResult init() {
+    for (int i = 0; i < 2; ++i) {
+      HwInitResult result;
+      result.switchState = stateWithPorts(1 + i * 2, 2 + i * 2);
+      result.bootType = BootType::COLD_BOOT;
+      result.bootTime = 1.0 + i;
+      EXPECT_CALL(*units_[i], init(_)).WillOnce(Return(result));
+    }
+    return hw_->init(nullptr);
+  }
+
+  std::shared_ptr<SwitchState> newState(
+      const std::shared_ptr<SwitchState>& state) {
+    auto ret = state->clone();
+    ret->publish();
+    return ret;
+  }
+
+ protected:
+  MockPlatform platform_;
+  std::vector<FakeUnit*> units_;
+  std::unique_ptr<MultiUnitHwSwitch> hw_;
+};
+} // namespace
+
+TEST_F(MultiUnitHwSwitchTest, initMergesPorts) {
+  auto result = init();
+  EXPECT_EQ(BootType::COLD_BOOT, result.bootType);
+  EXPECT_EQ(2.0, result.bootTime);
+  auto ports = result.switchState->getPorts();
+  EXPECT_EQ(4, ports->size());
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_NE(nullptr, ports->getPortIf(PortID(i)));
+  }
+}
+
+TEST_F(MultiUnitHwSwitchTest, initMixedBootTypes) {
+  for (int i = 0; i < 2; ++i) {
+    HwInitResult result;
+    result.switchState = stateWithPorts(1 + i * 2, 2 + i * 2);
+    result.bootType = i == 0 ? BootType::COLD_BOOT : BootType::WARM_BOOT;
+    EXPECT_CALL(*units_[i], init(_)).WillOnce(Return(result));
+  }
+  EXPECT_THROW(hw_->init(nullptr), FbossError);
+}
+
+TEST_F(MultiUnitHwSwitchTest, stateChangedOnEveryUnit) {
+  auto initState = init().switchState;
+  auto state1 = newState(initState);
+  EXPECT_EQ(state1, hw_->stateChanged(StateDelta(initState, state1)));
+  for (auto unit : units_) {
+    EXPECT_EQ(initState, unit->lastOld);
+  }
+
+  // A unit failing part of a change makes the whole switch out of sync
+  units_[1]->stuckAt = state1;
+  auto state2 = newState(state1);
+  EXPECT_EQ(state1, hw_->stateChanged(StateDelta(state1, state2)));
+
+  // and each unit then carries on from what it applied
+  units_[1]->stuckAt = nullptr;
+  auto state3 = newState(state2);
+  EXPECT_EQ(state3, hw_->stateChanged(StateDelta(state1, state3)));
+  EXPECT_EQ(state2, units_[0]->lastOld);
+  EXPECT_EQ(state1, units_[1]->lastOld);
+}
+
+TEST_F(MultiUnitHwSwitchTest, portsGoToTheirUnit) {
+  init();
+  EXPECT_CALL(*units_[0], sendPacketOutOfPortAsync_(_, _, _)).Times(0);
+  EXPECT_CALL(*units_[1], sendPacketOutOfPortAsync_(_, PortID(3), _));
+  EXPECT_TRUE(hw_->sendPacketOutOfPortAsync(
+      std::make_unique<MockTxPacket>(64), PortID(3)));
+
+  EXPECT_CALL(*units_[0], isPortUp(PortID(2))).WillOnce(Return(true));
+  EXPECT_CALL(*units_[1], isPortUp(_)).Times(0);
+  EXPECT_TRUE(hw_->isPortUp(PortID(2)));
+
+  // Switched packets go out through unit 0
+  EXPECT_CALL(*units_[0], sendPacketSwitchedAsync_(_));
+  EXPECT_CALL(*units_[1], sendPacketSwitchedAsync_(_)).Times(0);
+  EXPECT_TRUE(
+      hw_->sendPacketSwitchedAsync(std::make_unique<MockTxPacket>(64)));
+}
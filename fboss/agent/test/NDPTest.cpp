@@ -17,6 +17,7 @@
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/ndp/IPv6RouteAdvertiser.h"
 #include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/Ethertype.h"
 #include "fboss/agent/packet/ICMPHdr.h"
@@ -712,6 +713,41 @@ TEST(NdpTest, RouterAdvertisement) {
                                9000, expectedPrefixes));
 }
 
+TEST(NdpTest, RouterAdvertisementTemplate) {
+  auto config = createSwitchConfig(seconds(0), seconds(0));
+  auto handle = createTestHandle(&config, kPlatformMac);
+  auto sw = handle->getSw();
+
+  auto intf = sw->getState()->getInterfaces()->getInterface(InterfaceID(1234));
+  RouteAdvertisementTemplate ra(intf);
+  PrefixVector expectedPrefixes{
+    { IPAddressV6("2401:db00:2110:3004::"), 64 },
+    { IPAddressV6("fe80::"), 64 },
+  };
+
+  // The same template makes both the periodic and the solicited RAs, with
+  // the right checksum for each destination
+  auto periodic = ra.createPacket(sw);
+  checkRouterAdvert(kPlatformMac,
+                    IPAddressV6("fe80::1:02ff:fe03:0405"),
+                    MacAddress("33:33:00:00:00:01"),
+                    IPAddressV6("ff02::1"),
+                    VlanID(5), intf->getNdpConfig(),
+                    9000, expectedPrefixes)(periodic.get());
+  for (auto dstIP : {IPAddressV6("2401:db00:2110:1234::1:0"),
+                     IPAddressV6("fe80::5:73ff:fef9:46fc"),
+                     IPAddressV6("ff01::1")}) {
+    auto solicited =
+        ra.createPacket(sw, MacAddress("02:05:73:f9:46:fc"), dstIP);
+    checkRouterAdvert(kPlatformMac,
+                      IPAddressV6("fe80::1:02ff:fe03:0405"),
+                      MacAddress("02:05:73:f9:46:fc"),
+                      dstIP,
+                      VlanID(5), intf->getNdpConfig(),
+                      9000, expectedPrefixes)(solicited.get());
+  }
+}
+
 TEST(NdpTest, FlushEntry) {
   auto handle = setupTestHandle();
   auto sw = handle->getSw();
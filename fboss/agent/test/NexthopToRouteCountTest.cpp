@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/NexthopToRouteCount.h"
+
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/HwTestHandle.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/IPAddress.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using std::shared_ptr;
+
+namespace {
+
+const auto kClientID = StdClientIds2ClientID(StdClientIds::BGPD);
+
+class NexthopToRouteCountTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    handle_ = createTestHandle(testStateA());
+    sw_ = handle_->getSw();
+    counts_ = std::make_unique<NexthopToRouteCount>(sw_);
+    state_ = sw_->getState();
+  }
+
+  void addRoute(const std::string& network, std::vector<std::string> nhops) {
+    RouteUpdater updater(state_->getRouteTables());
+    updater.addRoute(
+        RouterID(0),
+        IPAddress(network),
+        24,
+        kClientID,
+        RouteNextHopEntry(makeNextHops(nhops), AdminDistance::EBGP));
+    update(updater);
+  }
+
+  void delRoute(const std::string& network) {
+    RouteUpdater updater(state_->getRouteTables());
+    updater.delRoute(RouterID(0), IPAddress(network), 24, kClientID);
+    update(updater);
+  }
+
+  // The routes through the next hops with address addr
+  int64_t count(const std::string& addr) const {
+    int64_t total = 0;
+    for (const auto& ridCounts : counts_->getCounts()) {
+      for (const auto& nhopCount : ridCounts.second) {
+        if (nhopCount.first.addr() == IPAddress(addr)) {
+          EXPECT_EQ(
+              nhopCount.second,
+              counts_->getCount(ridCounts.first, nhopCount.first));
+          total += nhopCount.second;
+        }
+      }
+    }
+    return total;
+  }
+
+ protected:
+  void update(RouteUpdater& updater) {
+    auto newState = state_->clone();
+    newState->resetRouteTables(updater.updateDone());
+    counts_->stateUpdated(StateDelta(state_, newState));
+    state_ = newState;
+  }
+
+  std::unique_ptr<HwTestHandle> handle_;
+  SwSwitch* sw_{nullptr};
+  std::unique_ptr<NexthopToRouteCount> counts_;
+  shared_ptr<SwitchState> state_;
+};
+
+} // unnamed namespace
+
+TEST_F(NexthopToRouteCountTest, addChangeRemove) {
+  addRoute("1.1.1.0", {"10.0.0.2", "10.0.0.3"});
+  addRoute("2.2.2.0", {"10.0.0.2"});
+  EXPECT_EQ(2, count("10.0.0.2"));
+  EXPECT_EQ(1, count("10.0.0.3"));
+
+  // Only the next hops that came and went are touched
+  addRoute("1.1.1.0", {"10.0.0.2", "10.0.0.4"});
+  EXPECT_EQ(2, count("10.0.0.2"));
+  EXPECT_EQ(0, count("10.0.0.3"));
+  EXPECT_EQ(1, count("10.0.0.4"));
+
+  delRoute("1.1.1.0");
+  EXPECT_EQ(1, count("10.0.0.2"));
+  EXPECT_EQ(0, count("10.0.0.4"));
+  delRoute("2.2.2.0");
+  EXPECT_TRUE(counts_->getCounts().empty());
+}
+
+TEST_F(NexthopToRouteCountTest, unresolvedRoutesNotCounted) {
+  // No interface subnet covers the next hop
+  addRoute("1.1.1.0", {"5.5.5.5"});
+  EXPECT_EQ(0, count("5.5.5.5"));
+  EXPECT_TRUE(counts_->getCounts().empty());
+
+  addRoute("1.1.1.0", {"10.0.0.2"});
+  EXPECT_EQ(1, count("10.0.0.2"));
+  addRoute("1.1.1.0", {"5.5.5.5"});
+  EXPECT_EQ(0, count("10.0.0.2"));
+}
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/PcapPublisher.h"
+
+#include <folly/io/async/EventBase.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using namespace facebook::fboss;
+using std::chrono::milliseconds;
+
+namespace {
+
+// Records the batches sent, and leaves them unacknowledged until the test
+// fulfills their promise
+struct Sender {
+  PcapPublisher::SendHandler handler() {
+    return [this](std::vector<PublishedPacket> pkts) {
+      std::vector<size_t> lengths;
+      for (const auto& pkt : pkts) {
+        lengths.push_back(pkt.packet.pkt.get_txpkt().packetData.size());
+      }
+      batches.push_back(lengths);
+      promises.emplace_back();
+      return promises.back().getFuture();
+    };
+  }
+
+  void ackAll() {
+    for (auto& promise : promises) {
+      promise.setValue();
+    }
+    promises.clear();
+  }
+
+  // Packets are told apart by their length
+  std::vector<std::vector<size_t>> batches;
+  std::vector<folly::Promise<folly::Unit>> promises;
+};
+
+PublishedPacket makePacket(size_t length) {
+  TxPacketData txPkt;
+  txPkt.packetData.resize(length);
+  PublishedPacket pkt;
+  pkt.packet.rx = false;
+  pkt.packet.pkt.set_txpkt(std::move(txPkt));
+  pkt.ethertype = 0x0800;
+  return pkt;
+}
+
+} // unnamed namespace
+
+TEST(PcapPublisher, sendsFullBatches) {
+  folly::EventBase evb;
+  Sender sender;
+  size_t dropped = 0;
+  PcapPublisher publisher(
+      &evb,
+      sender.handler(),
+      [&](size_t n) { dropped += n; },
+      3,
+      1 << 20,
+      milliseconds(10000),
+      4);
+
+  for (size_t i = 0; i < 7; ++i) {
+    publisher.publish(makePacket(60 + i));
+  }
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(2, sender.batches.size());
+  EXPECT_EQ(std::vector<size_t>({60, 61, 62}), sender.batches[0]);
+  EXPECT_EQ(std::vector<size_t>({63, 64, 65}), sender.batches[1]);
+
+  publisher.flush();
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(3, sender.batches.size());
+  EXPECT_EQ(std::vector<size_t>({66}), sender.batches[2]);
+  EXPECT_EQ(0, dropped);
+  sender.ackAll();
+}
+
+TEST(PcapPublisher, sendsOnSize) {
+  folly::EventBase evb;
+  Sender sender;
+  PcapPublisher publisher(
+      &evb, sender.handler(), [](size_t) {}, 100, 1000, milliseconds(10000), 4);
+
+  publisher.publish(makePacket(600));
+  publisher.publish(makePacket(600));
+  publisher.publish(makePacket(60));
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(1, sender.batches.size());
+  EXPECT_EQ(std::vector<size_t>({600, 600}), sender.batches[0]);
+  sender.ackAll();
+}
+
+TEST(PcapPublisher, sendsAfterDelay) {
+  folly::EventBase evb;
+  Sender sender;
+  PcapPublisher publisher(
+      &evb, sender.handler(), [](size_t) {}, 100, 1 << 20, milliseconds(50), 4);
+
+  publisher.publish(makePacket(60));
+  publisher.publish(makePacket(61));
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_TRUE(sender.batches.empty());
+
+  while (sender.batches.empty()) {
+    evb.loopOnce();
+  }
+  ASSERT_EQ(1, sender.batches.size());
+  EXPECT_EQ(std::vector<size_t>({60, 61}), sender.batches[0]);
+  sender.ackAll();
+}
+
+TEST(PcapPublisher, dropsWhenBackedUp) {
+  folly::EventBase evb;
+  Sender sender;
+  size_t dropped = 0;
+  PcapPublisher publisher(
+      &evb,
+      sender.handler(),
+      [&](size_t n) { dropped += n; },
+      2,
+      1 << 20,
+      milliseconds(10000),
+      2);
+
+  for (size_t i = 0; i < 8; ++i) {
+    publisher.publish(makePacket(60 + i));
+  }
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  // Only two batches can be outstanding at a time
+  ASSERT_EQ(2, sender.batches.size());
+  EXPECT_EQ(4, dropped);
+  EXPECT_EQ(4, publisher.numDropped());
+
+  // Once they are acknowledged, batches go through again
+  sender.ackAll();
+  publisher.publish(makePacket(70));
+  publisher.publish(makePacket(71));
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(3, sender.batches.size());
+  EXPECT_EQ(std::vector<size_t>({70, 71}), sender.batches[2]);
+  EXPECT_EQ(4, dropped);
+  sender.ackAll();
+}
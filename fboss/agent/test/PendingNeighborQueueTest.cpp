@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/PendingNeighborQueue.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/hw/mock/MockHwSwitch.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
+#include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/test/HwTestHandle.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/io/Cursor.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::io::Cursor;
+using std::chrono::milliseconds;
+
+DECLARE_int32(pending_neighbor_timeout_ms);
+DECLARE_int32(pending_packets_per_neighbor);
+DECLARE_int32(pending_neighbors_max);
+
+namespace {
+
+const VlanID kVlan(1);
+const IPAddress kTarget("10.0.0.10");
+
+// A 20 byte IPv4 packet from 1.2.3.4 to 10.0.0.10
+const auto kL3Pkt = PktUtil::parseHexData(
+    "45  00  00 14"
+    "00 00  00 00"
+    "1F  06  00 00"
+    "01 02 03 04"
+    "0a 00 00 0a");
+
+class PendingNeighborQueueTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    oldTimeout_ = FLAGS_pending_neighbor_timeout_ms;
+    oldPackets_ = FLAGS_pending_packets_per_neighbor;
+    oldNeighbors_ = FLAGS_pending_neighbors_max;
+    FLAGS_pending_neighbor_timeout_ms = 1000;
+    FLAGS_pending_packets_per_neighbor = 4;
+    FLAGS_pending_neighbors_max = 1024;
+    handle_ = createTestHandle(testStateA());
+    sw_ = handle_->getSw();
+    queue_ = sw_->getPendingNeighborQueue();
+  }
+  void TearDown() override {
+    handle_.reset();
+    FLAGS_pending_neighbor_timeout_ms = oldTimeout_;
+    FLAGS_pending_packets_per_neighbor = oldPackets_;
+    FLAGS_pending_neighbors_max = oldNeighbors_;
+  }
+
+  bool enqueue(
+      const IPAddress& target,
+      PendingNeighborQueue::Clock::time_point now) {
+    IOBuf buf(IOBuf::WRAP_BUFFER, kL3Pkt.data(), kL3Pkt.length());
+    return queue_->enqueue(kVlan, target, Cursor(&buf), kL3Pkt.length(), now);
+  }
+
+ protected:
+  std::unique_ptr<HwTestHandle> handle_;
+  SwSwitch* sw_{nullptr};
+  PendingNeighborQueue* queue_{nullptr};
+
+ private:
+  int32_t oldTimeout_{0};
+  int32_t oldPackets_{0};
+  int32_t oldNeighbors_{0};
+};
+
+TxMatchFn checkQueuedPkt() {
+  return [=](const TxPacket* pkt) {
+    Cursor c(pkt->buf());
+    c.skip(12); // dst and src MAC
+    auto ethertype = c.readBE<uint16_t>();
+    if (ethertype == 0x8100) {
+      c.skip(2);
+      ethertype = c.readBE<uint16_t>();
+    }
+    if (ethertype != 0x0800) {
+      throw FbossError("expected IPv4 ethertype, found ", ethertype);
+    }
+    IPv4Hdr v4Hdr(c);
+    if (IPAddress(v4Hdr.dstAddr) != kTarget) {
+      throw FbossError("expected dest IP ", kTarget, "; found ", v4Hdr.dstAddr);
+    }
+  };
+}
+
+} // unnamed namespace
+
+TEST_F(PendingNeighborQueueTest, oneSolicitationPerTimeout) {
+  auto now = PendingNeighborQueue::Clock::now();
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, kTarget, now));
+  EXPECT_FALSE(queue_->startSolicitation(kVlan, kTarget, now));
+  EXPECT_FALSE(
+      queue_->startSolicitation(kVlan, kTarget, now + milliseconds(999)));
+  // Other neighbors are solicited independently
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, IPAddress("10.0.0.11"), now));
+  EXPECT_TRUE(queue_->startSolicitation(VlanID(55), kTarget, now));
+  EXPECT_EQ(3, queue_->numNeighbors());
+
+  // Once the solicitation times out, solicit again
+  EXPECT_TRUE(
+      queue_->startSolicitation(kVlan, kTarget, now + milliseconds(1000)));
+  EXPECT_FALSE(
+      queue_->startSolicitation(kVlan, kTarget, now + milliseconds(1500)));
+}
+
+TEST_F(PendingNeighborQueueTest, boundedPerNeighbor) {
+  auto now = PendingNeighborQueue::Clock::now();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(enqueue(kTarget, now));
+  }
+  // The oldest packets make room for the newer ones
+  EXPECT_EQ(4, queue_->numPackets());
+  EXPECT_EQ(1, queue_->numNeighbors());
+
+  // Timing out drops what was queued
+  EXPECT_TRUE(
+      queue_->startSolicitation(kVlan, kTarget, now + milliseconds(1000)));
+  EXPECT_EQ(0, queue_->numPackets());
+}
+
+TEST_F(PendingNeighborQueueTest, boundedNeighbors) {
+  FLAGS_pending_neighbors_max = 2;
+  auto now = PendingNeighborQueue::Clock::now();
+  EXPECT_TRUE(enqueue(IPAddress("10.0.0.10"), now));
+  EXPECT_TRUE(enqueue(IPAddress("10.0.0.11"), now));
+  EXPECT_FALSE(enqueue(IPAddress("10.0.0.12"), now));
+  // Solicitations still go out for neighbors we can't track
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, IPAddress("10.0.0.12"), now));
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, IPAddress("10.0.0.12"), now));
+  EXPECT_EQ(2, queue_->numNeighbors());
+
+  // Room is made by expiring the neighbors that timed out
+  EXPECT_TRUE(enqueue(IPAddress("10.0.0.12"), now + milliseconds(1000)));
+  EXPECT_EQ(1, queue_->numNeighbors());
+  EXPECT_EQ(1, queue_->numPackets());
+}
+
+TEST_F(PendingNeighborQueueTest, noQueueing) {
+  FLAGS_pending_packets_per_neighbor = 0;
+  auto now = PendingNeighborQueue::Clock::now();
+  EXPECT_FALSE(enqueue(kTarget, now));
+  EXPECT_EQ(0, queue_->numPackets());
+}
+
+TEST_F(PendingNeighborQueueTest, sendOnResolution) {
+  auto now = PendingNeighborQueue::Clock::now();
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, kTarget, now));
+  EXPECT_TRUE(enqueue(kTarget, now));
+  EXPECT_TRUE(enqueue(kTarget, now));
+
+  EXPECT_PKT(sw_, "queued packet", checkQueuedPkt()).Times(2);
+  queue_->resolved(kVlan, kTarget);
+  EXPECT_EQ(0, queue_->numPackets());
+  EXPECT_EQ(0, queue_->numNeighbors());
+
+  // Nothing left to send
+  queue_->resolved(kVlan, kTarget);
+  // And the next packet solicits again
+  EXPECT_TRUE(queue_->startSolicitation(kVlan, kTarget, now));
+}
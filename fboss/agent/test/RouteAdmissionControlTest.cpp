@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteAdmissionControl.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace facebook::fboss;
+using std::chrono::milliseconds;
+
+namespace {
+const ClientID kBgp(0);
+const ClientID kOpenr(786);
+}
+
+TEST(RouteAdmissionControl, inFlightLimit) {
+  RouteAdmissionControl control(2, 0, milliseconds(0));
+  auto first = std::make_unique<RouteAdmissionControl::Ticket>(
+      control.admitUpdate(kBgp, 10, false));
+  auto second = control.admitUpdate(kBgp, 10, false);
+  EXPECT_EQ(2, control.getInFlight(kBgp));
+  EXPECT_THROW(control.admitUpdate(kBgp, 10, false), FbossError);
+
+  // Deletes and syncs still get in, and other clients have limits of their
+  // own
+  {
+    auto critical = control.admitUpdate(kBgp, 10, true);
+    EXPECT_EQ(3, control.getInFlight(kBgp));
+    auto other = control.admitUpdate(kOpenr, 10, false);
+    EXPECT_EQ(1, control.getInFlight(kOpenr));
+  }
+  EXPECT_EQ(0, control.getInFlight(kOpenr));
+
+  first.reset();
+  EXPECT_EQ(1, control.getInFlight(kBgp));
+  auto third = control.admitUpdate(kBgp, 10, false);
+  EXPECT_EQ(2, control.getInFlight(kBgp));
+}
+
+TEST(RouteAdmissionControl, queuedRoutesLimit) {
+  RouteAdmissionControl control(0, 10, milliseconds(0));
+  {
+    // However big, a batch gets in when nothing is queued
+    auto big = control.admitQueued(kBgp, 100, false);
+    EXPECT_EQ(100, control.getQueuedRoutes(kBgp));
+    EXPECT_THROW(control.admitQueued(kBgp, 1, false), FbossError);
+  }
+  EXPECT_EQ(0, control.getQueuedRoutes(kBgp));
+
+  auto first = control.admitQueued(kBgp, 8, false);
+  auto second = control.admitQueued(kBgp, 2, false);
+  EXPECT_THROW(control.admitQueued(kBgp, 1, false), FbossError);
+  auto critical = control.admitQueued(kBgp, 5, true);
+  EXPECT_EQ(15, control.getQueuedRoutes(kBgp));
+  // Blocking calls are limited separately, and not at all here
+  auto update = control.admitUpdate(kBgp, 5, false);
+  EXPECT_EQ(15, control.getQueuedRoutes(kBgp));
+}
+
+TEST(RouteAdmissionControl, waitsForRoom) {
+  RouteAdmissionControl control(1, 0, milliseconds(10000));
+  auto ticket = std::make_unique<RouteAdmissionControl::Ticket>(
+      control.admitUpdate(kBgp, 1, false));
+  std::thread releaser([&ticket]() {
+    std::this_thread::sleep_for(milliseconds(50));
+    ticket.reset();
+  });
+  // Held back until the other update is done
+  auto waited = control.admitUpdate(kBgp, 1, false);
+  releaser.join();
+  EXPECT_EQ(1, control.getInFlight(kBgp));
+}
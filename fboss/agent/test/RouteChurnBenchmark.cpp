@@ -0,0 +1,354 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/IPAddressV6.h>
+#include <folly/Memory.h>
+#include "common/network/if/gen-cpp2/Address_types.h"
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/AllocationProfiler.h"
+#include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/ThriftHandler.h"
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/state/DeltaFunctions.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+
+using namespace facebook::fboss;
+using facebook::network::toBinaryAddress;
+using folly::IPAddress;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using std::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+/*
+ * Costs along the route programming path, from the thrift calls down to
+ * the SwitchState, with SimSwitch standing in for the hardware so that
+ * only the agent's own work is measured:
+ *
+ * - addUnicastRoutes and syncFib through the ThriftHandler
+ * - RouteUpdater::updateDone, which resolves the routes and builds the new
+ *   route tables
+ * - iterating over the StateDelta of a large route change
+ * - cloning and publishing a SwitchState holding a large route table
+ *
+ * Once the benchmarks are done, the allocations made by the state update
+ * functions and by SimSwitch::stateChanged() while syncing the fib are
+ * counted with AllocationProfiler and printed too, along with the memory
+ * each route takes up in a SwitchState.
+ */
+
+DECLARE_int32(allocation_profile_sample_rate);
+
+namespace {
+
+constexpr int16_t kClientId = 1;
+constexpr int kEcmpWidth = 4;
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<ThriftHandler> handler;
+
+cfg::SwitchConfig makeConfig() {
+  cfg::SwitchConfig config;
+  config.ports.resize(kEcmpWidth);
+  config.vlanPorts.resize(kEcmpWidth);
+  for (int p = 0; p < kEcmpWidth; ++p) {
+    config.ports[p].logicalID = p + 1;
+    config.vlanPorts[p].logicalPort = p + 1;
+    config.vlanPorts[p].vlanID = 1;
+  }
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.vlans[0].intfID = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "02:00:01:00:00:01";
+  config.interfaces[0].ipAddresses.resize(2);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+  config.interfaces[0].ipAddresses[1] = "2401:db00:2110:3001::1/64";
+  return config;
+}
+
+void init() {
+  sw = make_unique<SwSwitch>(
+      make_unique<SimPlatform>(MacAddress("02:00:01:00:00:01"), kEcmpWidth));
+  sw->init(nullptr /* No custom TunManager */);
+  auto config = makeConfig();
+  sw->updateStateBlocking(
+      "apply config", [&](const shared_ptr<SwitchState>& state) {
+        return applyThriftConfig(state, &config, sw->getPlatform());
+      });
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  handler = make_unique<ThriftHandler>(sw.get());
+  // Also marks the fib as synced, which addUnicastRoutes requires
+  handler->syncFib(kClientId, make_unique<vector<UnicastRoute>>());
+}
+
+// 2401:db00:<i>::/64, distinct for every i
+IPAddressV6 prefixAddr(uint32_t i) {
+  std::array<uint8_t, 16> bytes{{0x24, 0x01, 0xdb, 0x00}};
+  for (int b = 0; b < 4; ++b) {
+    bytes[7 - b] = (i >> (8 * b)) & 0xff;
+  }
+  return IPAddressV6(bytes);
+}
+
+// The next hops of a route, all on the interface subnet so they resolve
+vector<IPAddress> nextHopAddrs(uint32_t group) {
+  vector<IPAddress> addrs;
+  for (int i = 0; i < kEcmpWidth; ++i) {
+    addrs.emplace_back(folly::to<std::string>(
+        "2401:db00:2110:3001::", (group * kEcmpWidth + i) % 0xfff + 2));
+  }
+  return addrs;
+}
+
+/*
+ * numRoutes routes, from the thrift client's point of view. Routes spread
+ * over a few ECMP groups, and nextHopShift moves every route to another
+ * group.
+ */
+vector<UnicastRoute> makeRoutes(size_t numRoutes, uint32_t nextHopShift = 0) {
+  vector<UnicastRoute> routes(numRoutes);
+  for (size_t i = 0; i < numRoutes; ++i) {
+    auto& route = routes[i];
+    route.dest.ip = toBinaryAddress(IPAddress(prefixAddr(i)));
+    route.dest.prefixLength = 64;
+    for (const auto& addr : nextHopAddrs(i % 16 + nextHopShift)) {
+      route.nextHopAddrs.push_back(toBinaryAddress(addr));
+    }
+  }
+  return routes;
+}
+
+void removeAllRoutes() {
+  handler->syncFib(kClientId, make_unique<vector<UnicastRoute>>());
+}
+
+// The route tables of the current state, plus numRoutes routes
+shared_ptr<RouteTableMap> addRoutes(
+    const shared_ptr<RouteTableMap>& tables,
+    size_t numRoutes,
+    uint32_t nextHopShift) {
+  RouteUpdater updater(tables);
+  for (size_t i = 0; i < numRoutes; ++i) {
+    RouteNextHopEntry::NextHopSet nhops;
+    for (const auto& addr : nextHopAddrs(i % 16 + nextHopShift)) {
+      nhops.emplace(UnresolvedNextHop(addr, ECMP_WEIGHT));
+    }
+    updater.addRoute(
+        RouterID(0),
+        prefixAddr(i),
+        64,
+        ClientID(kClientId),
+        RouteNextHopEntry(std::move(nhops), AdminDistance::EBGP));
+  }
+  return updater.updateDone();
+}
+
+shared_ptr<SwitchState> stateWithRoutes(
+    size_t numRoutes,
+    uint32_t nextHopShift = 0) {
+  auto state = sw->getState()->clone();
+  state->resetRouteTables(
+      addRoutes(state->getRouteTables(), numRoutes, nextHopShift));
+  state->publish();
+  return state;
+}
+
+void addUnicastRoutes(size_t numIters, size_t numRoutes) {
+  for (size_t n = 0; n < numIters; ++n) {
+    unique_ptr<vector<UnicastRoute>> routes;
+    BENCHMARK_SUSPEND {
+      routes = make_unique<vector<UnicastRoute>>(makeRoutes(numRoutes));
+    }
+    handler->addUnicastRoutes(kClientId, std::move(routes));
+    BENCHMARK_SUSPEND {
+      removeAllRoutes();
+    }
+  }
+}
+
+// Sync numRoutes routes over as many existing ones, moving a tenth of them
+// to other next hops
+void syncFib(size_t numIters, size_t numRoutes) {
+  for (size_t n = 0; n < numIters; ++n) {
+    unique_ptr<vector<UnicastRoute>> routes;
+    BENCHMARK_SUSPEND {
+      handler->syncFib(
+          kClientId, make_unique<vector<UnicastRoute>>(makeRoutes(numRoutes)));
+      routes = make_unique<vector<UnicastRoute>>(makeRoutes(numRoutes));
+      auto moved = makeRoutes(numRoutes, 1);
+      for (size_t i = 0; i < numRoutes; i += 10) {
+        (*routes)[i] = moved[i];
+      }
+    }
+    handler->syncFib(kClientId, std::move(routes));
+    BENCHMARK_SUSPEND {
+      removeAllRoutes();
+    }
+  }
+}
+
+void routeUpdaterUpdateDone(size_t numIters, size_t numRoutes) {
+  for (size_t n = 0; n < numIters; ++n) {
+    unique_ptr<RouteUpdater> updater;
+    BENCHMARK_SUSPEND {
+      updater = make_unique<RouteUpdater>(sw->getState()->getRouteTables());
+      for (size_t i = 0; i < numRoutes; ++i) {
+        RouteNextHopEntry::NextHopSet nhops;
+        for (const auto& addr : nextHopAddrs(i % 16)) {
+          nhops.emplace(UnresolvedNextHop(addr, ECMP_WEIGHT));
+        }
+        updater->addRoute(
+            RouterID(0),
+            prefixAddr(i),
+            64,
+            ClientID(kClientId),
+            RouteNextHopEntry(std::move(nhops), AdminDistance::EBGP));
+      }
+    }
+    folly::doNotOptimizeAway(updater->updateDone());
+    BENCHMARK_SUSPEND {
+      updater.reset();
+    }
+  }
+}
+
+// Walk the routes changed between states with numRoutes routes each, all
+// of them on other next hops in the new state
+void stateDeltaIteration(size_t numIters, size_t numRoutes) {
+  shared_ptr<SwitchState> oldState;
+  shared_ptr<SwitchState> newState;
+  BENCHMARK_SUSPEND {
+    oldState = stateWithRoutes(numRoutes);
+    newState = stateWithRoutes(numRoutes, 1);
+  }
+  for (size_t n = 0; n < numIters; ++n) {
+    StateDelta delta(oldState, newState);
+    size_t changed = 0;
+    for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+      DeltaFunctions::forEachChanged(
+          rtDelta.getRoutesV6Delta(),
+          [&](const shared_ptr<RouteV6>&, const shared_ptr<RouteV6>&) {
+            ++changed;
+          },
+          [&](const shared_ptr<RouteV6>&) { ++changed; },
+          [&](const shared_ptr<RouteV6>&) { ++changed; });
+    }
+    folly::doNotOptimizeAway(changed);
+  }
+}
+
+void switchStateClonePublish(size_t numIters, size_t numRoutes) {
+  shared_ptr<SwitchState> state;
+  BENCHMARK_SUSPEND {
+    state = stateWithRoutes(numRoutes);
+  }
+  for (size_t n = 0; n < numIters; ++n) {
+    auto newState = state->clone();
+    newState->publish();
+    folly::doNotOptimizeAway(newState);
+  }
+}
+
+void printAllocations(const char* name, AllocationPath path) {
+  auto counts = AllocationProfiler::getPathCounts(path);
+  auto samples =
+      std::max<uint64_t>(AllocationProfiler::getPathSamples(path), 1);
+  printf(
+      "%-36s %12.1f allocations/update %14.1f bytes/update\n",
+      name,
+      static_cast<double>(counts.allocations) / samples,
+      static_cast<double>(counts.bytes) / samples);
+}
+
+// Sync numRoutes routes over as many existing ones, moving a tenth of them
+// to other next hops, and print what the update allocated
+void printSyncFibAllocations(size_t numRoutes) {
+  handler->syncFib(
+      kClientId, make_unique<vector<UnicastRoute>>(makeRoutes(numRoutes)));
+  auto routes = make_unique<vector<UnicastRoute>>(makeRoutes(numRoutes));
+  auto moved = makeRoutes(numRoutes, 1);
+  for (size_t i = 0; i < numRoutes; i += 10) {
+    (*routes)[i] = moved[i];
+  }
+
+  AllocationProfiler::resetPathCounts();
+  handler->syncFib(kClientId, std::move(routes));
+  auto prefix = folly::to<std::string>("syncFib(", numRoutes, ") ");
+  printAllocations(
+      (prefix + "update function").c_str(), AllocationPath::STATE_UPDATE_FN);
+  printAllocations(
+      (prefix + "stateChanged").c_str(), AllocationPath::HW_STATE_CHANGED);
+  removeAllRoutes();
+}
+
+// Print the memory that numRoutes routes add to a SwitchState, per route
+void printRouteMemory(size_t numRoutes) {
+  auto before = AllocationProfiler::getThreadLiveBytes();
+  auto state = stateWithRoutes(numRoutes);
+  auto bytes = AllocationProfiler::getThreadLiveBytes() - before;
+  auto name = folly::to<std::string>("SwitchState(", numRoutes, " routes)");
+  printf(
+      "%-36s %12.1f bytes/route %14zu bytes/RouteV6 node\n",
+      name.c_str(),
+      static_cast<double>(bytes) / numRoutes,
+      sizeof(RouteV6));
+}
+
+} // unnamed namespace
+
+BENCHMARK_NAMED_PARAM(addUnicastRoutes, 1k, 1000);
+BENCHMARK_NAMED_PARAM(addUnicastRoutes, 10k, 10000);
+BENCHMARK_NAMED_PARAM(addUnicastRoutes, 100k, 100000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(syncFib, 1k, 1000);
+BENCHMARK_NAMED_PARAM(syncFib, 10k, 10000);
+BENCHMARK_NAMED_PARAM(syncFib, 100k, 100000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(routeUpdaterUpdateDone, 1k, 1000);
+BENCHMARK_NAMED_PARAM(routeUpdaterUpdateDone, 10k, 10000);
+BENCHMARK_NAMED_PARAM(routeUpdaterUpdateDone, 100k, 100000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(stateDeltaIteration, 10k, 10000);
+BENCHMARK_NAMED_PARAM(stateDeltaIteration, 100k, 100000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(switchStateClonePublish, 10k, 10000);
+BENCHMARK_NAMED_PARAM(switchStateClonePublish, 100k, 100000);
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+
+  // Profile every update, but only once the timings are done
+  FLAGS_allocation_profile_sample_rate = 1;
+  printSyncFibAllocations(10000);
+  printSyncFibAllocations(100000);
+  printRouteMemory(10000);
+  printRouteMemory(100000);
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RouteReplicator.h"
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/IPAddress.h>
+#include <gtest/gtest.h>
+
+#include <functional>
+
+using namespace facebook::fboss;
+using facebook::network::toIPAddress;
+using folly::IPAddress;
+using std::shared_ptr;
+
+namespace {
+
+const RouterID kRid0(0);
+const ClientID kBgp(0);
+const ClientID kOpenr(786);
+const ClientID kStatic(1);
+
+shared_ptr<SwitchState> updateRoutes(
+    const shared_ptr<SwitchState>& state,
+    std::function<void(RouteUpdater*)> fn) {
+  RouteUpdater updater(state->getRouteTables());
+  fn(&updater);
+  auto newState = state->clone();
+  newState->resetRouteTables(updater.updateDone());
+  return newState;
+}
+
+RouteNextHopEntry nextHops(std::vector<std::string> ips) {
+  return RouteNextHopEntry(makeNextHops(std::move(ips)), AdminDistance::EBGP);
+}
+
+} // unnamed namespace
+
+TEST(RouteReplicator, updatesOnlyForReplicatedClients) {
+  std::set<ClientID> clients{kBgp, kOpenr};
+  auto state0 = testStateA();
+  auto state1 = updateRoutes(state0, [](RouteUpdater* updater) {
+    updater->addRoute(
+        kRid0, IPAddress("10.0.0.0"), 24, kBgp, nextHops({"10.0.0.1"}));
+    updater->addRoute(
+        kRid0, IPAddress("2401:db00::"), 64, kOpenr, nextHops({"10.0.0.2"}));
+    updater->addRoute(
+        kRid0, IPAddress("10.1.0.0"), 24, kStatic, nextHops({"10.0.0.3"}));
+  });
+
+  auto updates =
+      RouteReplicator::getUpdates(StateDelta(state0, state1), clients);
+  ASSERT_EQ(2, updates.size());
+  ASSERT_EQ(1, updates[kBgp].toAdd.size());
+  EXPECT_TRUE(updates[kBgp].toDelete.empty());
+  const auto& route = updates[kBgp].toAdd[0];
+  EXPECT_EQ(IPAddress("10.0.0.0"), toIPAddress(route.dest.ip));
+  EXPECT_EQ(24, route.dest.prefixLength);
+  ASSERT_EQ(1, route.nextHopAddrs.size());
+  EXPECT_EQ(IPAddress("10.0.0.1"), toIPAddress(route.nextHopAddrs[0]));
+  EXPECT_EQ(1, updates[kOpenr].toAdd.size());
+
+  // The static route is programmed on each card from its own config
+  EXPECT_EQ(0, updates.count(kStatic));
+
+  // Changing one client's next hops only updates that client, and removing
+  // a client's entry deletes the route for it alone
+  auto state2 = updateRoutes(state1, [](RouteUpdater* updater) {
+    updater->addRoute(
+        kRid0, IPAddress("10.0.0.0"), 24, kOpenr, nextHops({"10.0.0.4"}));
+    updater->delRoute(kRid0, IPAddress("2401:db00::"), 64, kOpenr);
+  });
+  updates = RouteReplicator::getUpdates(StateDelta(state1, state2), clients);
+  ASSERT_EQ(1, updates.size());
+  ASSERT_EQ(1, updates[kOpenr].toAdd.size());
+  EXPECT_EQ(
+      IPAddress("10.0.0.0"), toIPAddress(updates[kOpenr].toAdd[0].dest.ip));
+  ASSERT_EQ(1, updates[kOpenr].toDelete.size());
+  EXPECT_EQ(
+      IPAddress("2401:db00::"), toIPAddress(updates[kOpenr].toDelete[0].ip));
+
+  // Nothing changed
+  updates = RouteReplicator::getUpdates(StateDelta(state2, state2), clients);
+  EXPECT_TRUE(updates.empty());
+}
+
+TEST(RouteReplicator, routesForSync) {
+  std::set<ClientID> clients{kBgp, kOpenr};
+  auto state = updateRoutes(testStateA(), [](RouteUpdater* updater) {
+    updater->addRoute(
+        kRid0, IPAddress("10.0.0.0"), 24, kBgp, nextHops({"10.0.0.1"}));
+    updater->addRoute(
+        kRid0, IPAddress("10.0.1.0"), 24, kBgp, nextHops({"10.0.0.1"}));
+    updater->addRoute(
+        kRid0, IPAddress("10.1.0.0"), 24, kStatic, nextHops({"10.0.0.3"}));
+  });
+
+  auto routes = RouteReplicator::getRoutes(state, clients);
+  ASSERT_EQ(2, routes.size());
+  EXPECT_EQ(2, routes[kBgp].size());
+  // Clients without routes still get synced, to clear what they had
+  EXPECT_TRUE(routes[kOpenr].empty());
+}
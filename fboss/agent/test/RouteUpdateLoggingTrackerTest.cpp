@@ -11,6 +11,8 @@
 #include "fboss/agent/state/RouteTypes.h"
 #include <folly/IPAddress.h>
 
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 using namespace facebook::fboss;
@@ -155,4 +157,38 @@ TEST_F(PrefixTrackerTest, DeleteLessSpecificUntracked) {
   checkNotTracking(p2);
 }
 
+
+// Identifiers tracking overlapping prefixes are matched independently, each
+// by its own most specific prefix
+TEST_F(PrefixTrackerTest, IdentifiersMatchIndependently) {
+  startTracking("1:1::", 32, "broad", false);
+  startTracking("1:1::", 32, "exact", true);
+  startTracking("1:1:1:1::", 64, "narrow", true);
+  startTracking("1:1::", 16, "narrow", false);
+
+  std::vector<std::string> ids;
+  EXPECT_TRUE(tracker.tracking(p1, ids));
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ((std::vector<std::string>{"broad", "narrow"}), ids);
+
+  // The most specific prefix of "narrow" is exact, so it doesn't fall back
+  // to its broader one
+  RoutePrefix<folly::IPAddressV6> p3{folly::IPAddressV6{"1:1:1:1::"}, 80};
+  EXPECT_TRUE(tracker.tracking(p3, ids));
+  EXPECT_EQ(std::vector<std::string>{"broad"}, ids);
+
+  EXPECT_TRUE(tracker.tracking(p2, ids));
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ((std::vector<std::string>{"broad", "exact", "narrow"}), ids);
+
+  tracker.stopTracking("narrow");
+  EXPECT_TRUE(tracker.tracking(p1, ids));
+  EXPECT_EQ(std::vector<std::string>{"broad"}, ids);
+  EXPECT_EQ(2, tracker.getTrackedPrefixes().size());
+
+  tracker.stopTracking("broad");
+  tracker.stopTracking("exact");
+  EXPECT_TRUE(tracker.empty());
+  checkNotTracking(p2);
+}
 }
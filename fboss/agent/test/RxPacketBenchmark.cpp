@@ -0,0 +1,330 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/cast.hpp>
+
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/AllocationProfiler.h"
+#include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using std::make_unique;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+/*
+ * Throughput of SwSwitch::packetReceived() for the packets the agent handles
+ * itself, on a single thread against SimSwitch.  The iters/s folly reports
+ * are packets per second on one core.
+ *
+ * Once the benchmarks are done, the allocations made by the packet handlers
+ * for each kind of packet are counted with AllocationProfiler and printed
+ * too.  Only the handler's own thread is counted, so work it hands off
+ * (e.g., to the LACP state machines) is not included.
+ */
+
+DECLARE_int32(allocation_profile_sample_rate);
+
+namespace {
+
+const MacAddress kPlatformMac("02:00:01:00:00:01");
+constexpr int kNumPorts = 10;
+// Member of the LACP aggregate port
+constexpr int kLagPort = 10;
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<MockRxPacket> arpRequest;
+unique_ptr<MockRxPacket> ndpSolicitation;
+unique_ptr<MockRxPacket> lldpFrame;
+unique_ptr<MockRxPacket> lacpdu;
+unique_ptr<MockRxPacket> dhcpDiscover;
+unique_ptr<MockRxPacket> ipv4TtlExpired;
+
+cfg::SwitchConfig makeConfig() {
+  cfg::SwitchConfig config;
+  config.ports.resize(kNumPorts);
+  config.vlanPorts.resize(kNumPorts);
+  for (int p = 0; p < kNumPorts; ++p) {
+    config.ports[p].logicalID = p + 1;
+    config.vlanPorts[p].logicalPort = p + 1;
+    config.vlanPorts[p].vlanID = 1;
+  }
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.vlans[0].intfID = 1;
+  config.vlans[0].__isset.dhcpRelayAddressV4 = true;
+  config.vlans[0].dhcpRelayAddressV4 = "20.20.20.20";
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = kPlatformMac.toString();
+  config.interfaces[0].ipAddresses.resize(2);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+  config.interfaces[0].ipAddresses[1] = "2401:db00:2110:3004::a/64";
+  config.aggregatePorts.resize(1);
+  config.aggregatePorts[0].key = 1;
+  config.aggregatePorts[0].name = "lag1";
+  config.aggregatePorts[0].memberPorts.resize(1);
+  config.aggregatePorts[0].memberPorts[0].memberPortID = kLagPort;
+  return config;
+}
+
+unique_ptr<SwSwitch> setupSwitch() {
+  auto sw =
+      make_unique<SwSwitch>(make_unique<SimPlatform>(kPlatformMac, kNumPorts));
+  sw->init(
+      nullptr /* No custom TunManager */,
+      static_cast<SwitchFlags>(
+          SwitchFlags::ENABLE_LLDP | SwitchFlags::ENABLE_LACP));
+  auto config = makeConfig();
+  sw->updateStateBlocking(
+      "setup", [&](const shared_ptr<SwitchState>& state) {
+        return applyThriftConfig(state, &config, sw->getPlatform());
+      });
+  return sw;
+}
+
+unique_ptr<MockRxPacket>
+makePacket(const string& hex, uint32_t length, int port = 1) {
+  auto pkt = MockRxPacket::fromHex(hex);
+  pkt->padToLength(length);
+  pkt->setSrcPort(PortID(port));
+  pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+string zeros(size_t numBytes) {
+  string hex;
+  for (size_t i = 0; i < numBytes; ++i) {
+    hex += "00 ";
+  }
+  return hex;
+}
+
+void init() {
+  sw = setupSwitch();
+
+  arpRequest = makePacket(
+      // dst mac, src mac
+      "ff ff ff ff ff ff  00 02 00 01 02 03"
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+      "08 06  00 01  08 00  06  04"
+      // ARP Request
+      "00 01"
+      // Sender MAC, sender IP: 10.0.0.15
+      "00 02 00 01 02 03  0a 00 00 0f"
+      // Target MAC, target IP: 10.0.0.1
+      "00 00 00 00 00 00  0a 00 00 01",
+      68);
+
+  ndpSolicitation = makePacket(
+      // dst mac, src mac
+      "33 33 ff 00 00 0a  02 05 73 f9 46 fc"
+      // 802.1q, VLAN 1
+      "81 00 00 01"
+      // IPv6, version 6, traffic class, flow label
+      "86 dd  6e 00 00 00"
+      // Payload length: 24, next header: 58 (ICMPv6), hop limit: 255
+      "00 18  3a ff"
+      // src addr (::0)
+      "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00"
+      // dst addr (2401:db00:2110:3004::a)
+      "24 01 db 00 21 10 30 04 00 00 00 00 00 00 00 0a"
+      // neighbor solicitation, code, checksum, reserved
+      "87  00  d8 6c  00 00 00 00"
+      // target address (2401:db00:2110:3004::a)
+      "24 01 db 00 21 10 30 04 00 00 00 00 00 00 00 0a",
+      86);
+
+  lldpFrame = makePacket(
+      // LLDP multicast dst mac, src mac
+      "01 80 c2 00 00 0e  02 00 02 01 02 03"
+      // 802.1q, VLAN 1, LLDP
+      "81 00 00 01  88 cc"
+      // Chassis ID: MAC address 02:00:02:01:02:03
+      "02 07  04  02 00 02 01 02 03"
+      // Port ID: interface name eth0
+      "04 05  05  65 74 68 30"
+      // TTL: 120 seconds
+      "06 02  00 78"
+      // End of LLDPDU
+      "00 00",
+      68);
+
+  lacpdu = makePacket(
+      // Slow protocols multicast dst mac, src mac
+      "01 80 c2 00 00 02  02 00 02 01 02 03"
+      // Slow protocols, LACP, version 1
+      "88 09  01  01"
+      // Actor: system priority, system ID, key, port priority, port, state
+      "01 14  ff ff  02 00 02 01 02 03  00 01  ff ff  00 0a  3d  00 00 00"
+      // Partner
+      "02 14  ff ff  02 00 01 00 00 01  00 01  ff ff  00 0a  3d  00 00 00"
+      // Collector: max delay
+      "03 10  00 00" +
+          zeros(12) +
+          // Terminator, followed by 50 reserved bytes of padding
+          "00 00",
+      128,
+      kLagPort);
+
+  dhcpDiscover = makePacket(
+      // dst mac, src mac
+      "ff ff ff ff ff ff  02 00 00 00 00 02"
+      // 802.1q, VLAN 1, IPv4
+      "81 00 00 01  08 00"
+      // Version, IHL, DSCP, ECN, length (272), id, flags, fragment offset
+      "45 00 01 10  00 00 00 00"
+      // TTL, protocol (UDP), checksum, src 0.0.0.0, dst 255.255.255.255
+      "ff 11 00 00  00 00 00 00  ff ff ff ff"
+      // UDP from port 68 to 67, length (252), checksum
+      "00 44 00 43  00 fc 00 00"
+      // BOOTREQUEST, ethernet, hlen 6, hops 0, xid
+      "01 01 06 00  0a 0a 0a 01"
+      // secs, flags, ciaddr, yiaddr, siaddr, giaddr
+      + zeros(20) +
+          // chaddr
+          "02 00 00 00 00 02 " + zeros(10) +
+          // sname, file
+          zeros(64 + 128) +
+          // DHCP cookie, message type option: discover, end
+          "63 82 53 63  35 01 01  ff",
+      290);
+
+  ipv4TtlExpired = makePacket(
+      // dst mac, src mac
+      "02 00 01 00 00 01  02 00 02 01 02 03"
+      // 802.1q, VLAN 1, IPv4
+      "81 00 00 01  08 00"
+      // Version, IHL, DSCP, ECN, length (36), id, flags, fragment offset
+      "45 1d 00 24  34 56 53 45"
+      // TTL (1), protocol (UDP), checksum (fake)
+      "01 11 12 34"
+      // src 1.2.3.4, dst 10.1.0.10, not one of ours
+      "01 02 03 04  0a 01 00 0a"
+      // UDP ports, length, checksum (fake), payload
+      "00 45 00 46  00 10 12 34  01 02 03 04 05 06 07 08",
+      68);
+}
+
+SimSwitch* getSim() {
+  return boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+}
+
+/*
+ * Hand the packet to the switch numIters times.  If it is one the switch
+ * replies to, make sure it did, so that we don't end up measuring an early
+ * drop.  LACP controllers transmit on their own, so only check that there
+ * were at least as many packets sent as received.
+ */
+void receive(size_t numIters, const MockRxPacket& pkt, bool expectReply) {
+  BENCHMARK_SUSPEND {
+    getSim()->resetTxCount();
+  }
+
+  for (size_t n = 0; n < numIters; ++n) {
+    sw->packetReceived(pkt.clone());
+  }
+
+  BENCHMARK_SUSPEND {
+    if (expectReply) {
+      CHECK_GE(getSim()->getTxCount(), numIters);
+    }
+  }
+}
+
+void printAllocationsPerPacket(
+    const char* name,
+    const MockRxPacket& pkt,
+    size_t numPackets = 10000) {
+  std::vector<unique_ptr<RxPacket>> pkts;
+  pkts.reserve(numPackets);
+  for (size_t n = 0; n < numPackets; ++n) {
+    pkts.push_back(pkt.clone());
+  }
+
+  AllocationProfiler::resetPathCounts();
+  for (auto& rxPkt : pkts) {
+    sw->packetReceived(std::move(rxPkt));
+  }
+  auto path = AllocationPath::RX_PACKET_HANDLER;
+  auto counts = AllocationProfiler::getPathCounts(path);
+  // Packets that reached a handler
+  auto samples =
+      std::max<uint64_t>(AllocationProfiler::getPathSamples(path), 1);
+  printf(
+      "%-24s %8.2f allocations/packet %10.1f bytes/packet\n",
+      name,
+      static_cast<double>(counts.allocations) / samples,
+      static_cast<double>(counts.bytes) / samples);
+}
+
+} // unnamed namespace
+
+BENCHMARK(ArpRequest, numIters) {
+  receive(numIters, *arpRequest, true);
+}
+
+BENCHMARK(NdpSolicitation, numIters) {
+  receive(numIters, *ndpSolicitation, true);
+}
+
+BENCHMARK(Lldp, numIters) {
+  receive(numIters, *lldpFrame, false);
+}
+
+BENCHMARK(Lacpdu, numIters) {
+  receive(numIters, *lacpdu, false);
+}
+
+BENCHMARK(DhcpV4Relay, numIters) {
+  receive(numIters, *dhcpDiscover, true);
+}
+
+BENCHMARK(IcmpTtlExceeded, numIters) {
+  receive(numIters, *ipv4TtlExpired, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  // As in ArpBenchmark, set up the switch and the packets once, outside of
+  // the benchmark functions
+  init();
+
+  folly::runBenchmarks();
+
+  // Profile every packet, but only once the timings are done
+  FLAGS_allocation_profile_sample_rate = 1;
+  printAllocationsPerPacket("ArpRequest", *arpRequest);
+  printAllocationsPerPacket("NdpSolicitation", *ndpSolicitation);
+  printAllocationsPerPacket("Lldp", *lldpFrame);
+  printAllocationsPerPacket("Lacpdu", *lacpdu);
+  printAllocationsPerPacket("DhcpV4Relay", *dhcpDiscover);
+  printAllocationsPerPacket("IcmpTtlExceeded", *ipv4TtlExpired);
+  return 0;
+}
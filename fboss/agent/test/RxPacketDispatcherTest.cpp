@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RxPacketDispatcher.h"
+
+#include <folly/io/IOBuf.h>
+#include <folly/synchronization/Baton.h>
+
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace facebook::fboss;
+
+namespace {
+
+std::unique_ptr<RxPacket> makePacket(PortID port) {
+  auto pkt = std::make_unique<MockRxPacket>(folly::IOBuf::create(64));
+  pkt->setSrcPort(port);
+  return std::move(pkt);
+}
+
+} // unnamed namespace
+
+TEST(RxPacketDispatcher, perClassOrderAndThreads) {
+  constexpr int kPacketsPerClass = 100;
+  std::mutex lock;
+  std::map<std::thread::id, std::vector<PortID>> handled;
+  int numHandled = 0;
+  folly::Baton<> allHandled;
+
+  RxPacketDispatcher dispatcher(
+      [&](std::unique_ptr<RxPacket> pkt) {
+        std::lock_guard<std::mutex> g(lock);
+        handled[std::this_thread::get_id()].push_back(pkt->getSrcPort());
+        if (++numHandled == kPacketsPerClass * 2) {
+          allHandled.post();
+        }
+      },
+      [](RxPacketClass, const RxPacket&) { FAIL() << "unexpected drop"; },
+      kPacketsPerClass);
+  dispatcher.start();
+  // Use the port number to tell the classes apart
+  for (int i = 0; i < kPacketsPerClass; ++i) {
+    EXPECT_TRUE(dispatcher.dispatch(
+        RxPacketClass::CONTROL, makePacket(PortID(i))));
+    EXPECT_TRUE(dispatcher.dispatch(
+        RxPacketClass::ARP, makePacket(PortID(1000 + i))));
+  }
+  allHandled.wait();
+  dispatcher.stop();
+
+  // Each class was handled on its own worker, in order
+  ASSERT_EQ(2, handled.size());
+  for (const auto& threadAndPorts : handled) {
+    EXPECT_NE(std::this_thread::get_id(), threadAndPorts.first);
+    const auto& ports = threadAndPorts.second;
+    ASSERT_EQ(kPacketsPerClass, ports.size());
+    auto base = ports[0] < PortID(1000) ? 0 : 1000;
+    for (int i = 0; i < kPacketsPerClass; ++i) {
+      EXPECT_EQ(PortID(base + i), ports[i]);
+    }
+  }
+}
+
+TEST(RxPacketDispatcher, dropsWhenQueueFull) {
+  constexpr int kQueueSize = 4;
+  folly::Baton<> arpBlocked;
+  folly::Baton<> unblockArp;
+  folly::Baton<> controlHandled;
+  std::map<RxPacketClass, int> drops;
+
+  RxPacketDispatcher dispatcher(
+      [&](std::unique_ptr<RxPacket> pkt) {
+        if (pkt->getSrcPort() == PortID(1)) {
+          arpBlocked.post();
+          unblockArp.wait();
+        } else if (pkt->getSrcPort() == PortID(2)) {
+          controlHandled.post();
+        }
+      },
+      [&](RxPacketClass cls, const RxPacket&) { ++drops[cls]; },
+      kQueueSize);
+
+  // Nothing is accepted before the workers are started
+  EXPECT_FALSE(dispatcher.dispatch(RxPacketClass::ARP, makePacket(PortID(0))));
+  EXPECT_EQ(1, drops[RxPacketClass::ARP]);
+  drops.clear();
+
+  dispatcher.start();
+  // Block the ARP worker on its first packet, then fill up its queue
+  EXPECT_TRUE(dispatcher.dispatch(RxPacketClass::ARP, makePacket(PortID(1))));
+  arpBlocked.wait();
+  for (int i = 0; i < kQueueSize; ++i) {
+    EXPECT_TRUE(dispatcher.dispatch(
+        RxPacketClass::ARP, makePacket(PortID(0))));
+  }
+  EXPECT_FALSE(dispatcher.dispatch(RxPacketClass::ARP, makePacket(PortID(0))));
+  EXPECT_EQ(1, drops[RxPacketClass::ARP]);
+
+  // Other classes keep being handled while the ARP worker is stuck
+  EXPECT_TRUE(dispatcher.dispatch(
+      RxPacketClass::CONTROL, makePacket(PortID(2))));
+  controlHandled.wait();
+  EXPECT_EQ(0, drops[RxPacketClass::CONTROL]);
+
+  unblockArp.post();
+  dispatcher.stop();
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SflowRateController.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using boost::container::flat_map;
+using std::chrono::milliseconds;
+using Rates = SflowRateController::Rates;
+
+namespace {
+
+SflowRateController makeController() {
+  // 1000 samples a second, backing off at most 8x
+  SflowRateController controller(1000, 8);
+  controller.setConfiguredRates(PortID(1), 100, 200);
+  controller.setConfiguredRates(PortID(2), 1000, 0);
+  return controller;
+}
+
+} // unnamed namespace
+
+TEST(SflowRateController, underTarget) {
+  auto controller = makeController();
+  flat_map<PortID, uint64_t> samples{{PortID(1), 300}, {PortID(2), 300}};
+  EXPECT_TRUE(controller.update(samples, 0, milliseconds(1000)).empty());
+  EXPECT_EQ(Rates({100, 200}), controller.getEffectiveRates(PortID(1)));
+  EXPECT_EQ(Rates({1000, 0}), controller.getEffectiveRates(PortID(2)));
+  EXPECT_EQ(Rates(), controller.getEffectiveRates(PortID(3)));
+}
+
+TEST(SflowRateController, backOffBusyPorts) {
+  auto controller = makeController();
+  // Port 1 is sending well over its half of the target
+  flat_map<PortID, uint64_t> samples{{PortID(1), 1500}, {PortID(2), 100}};
+  auto changes = controller.update(samples, 0, milliseconds(1000));
+  ASSERT_EQ(1, changes.size());
+  EXPECT_EQ(PortID(1), changes[0].first);
+  EXPECT_EQ(Rates({200, 400}), changes[0].second);
+  EXPECT_EQ(Rates({1000, 0}), controller.getEffectiveRates(PortID(2)));
+
+  // Backing off stops at the maximum multiplier
+  for (int i = 0; i < 5; ++i) {
+    controller.update(samples, 0, milliseconds(1000));
+  }
+  EXPECT_EQ(Rates({800, 1600}), controller.getEffectiveRates(PortID(1)));
+  EXPECT_TRUE(controller.update(samples, 0, milliseconds(1000)).empty());
+}
+
+TEST(SflowRateController, backOffOnDrops) {
+  auto controller = makeController();
+  // Under the target, but samples are being dropped
+  flat_map<PortID, uint64_t> samples{{PortID(1), 100}, {PortID(2), 200}};
+  auto changes = controller.update(samples, 10, milliseconds(1000));
+  ASSERT_EQ(1, changes.size());
+  EXPECT_EQ(PortID(2), changes[0].first);
+  EXPECT_EQ(Rates({2000, 0}), changes[0].second);
+}
+
+TEST(SflowRateController, recover) {
+  auto controller = makeController();
+  flat_map<PortID, uint64_t> busy{{PortID(1), 4000}};
+  controller.update(busy, 0, milliseconds(1000));
+  controller.update(busy, 0, milliseconds(1000));
+  EXPECT_EQ(Rates({400, 800}), controller.getEffectiveRates(PortID(1)));
+
+  // Somewhat under the target isn't enough to sample more often
+  flat_map<PortID, uint64_t> quieter{{PortID(1), 500}};
+  EXPECT_TRUE(controller.update(quieter, 0, milliseconds(1000)).empty());
+
+  flat_map<PortID, uint64_t> quiet{{PortID(1), 100}};
+  auto changes = controller.update(quiet, 0, milliseconds(1000));
+  ASSERT_EQ(1, changes.size());
+  EXPECT_EQ(Rates({200, 400}), changes[0].second);
+  controller.update(quiet, 0, milliseconds(1000));
+  EXPECT_EQ(Rates({100, 200}), controller.getEffectiveRates(PortID(1)));
+  EXPECT_TRUE(controller.update(quiet, 0, milliseconds(1000)).empty());
+}
+
+TEST(SflowRateController, reconfigureResets) {
+  auto controller = makeController();
+  flat_map<PortID, uint64_t> busy{{PortID(1), 4000}};
+  controller.update(busy, 0, milliseconds(1000));
+  EXPECT_EQ(Rates({200, 400}), controller.getEffectiveRates(PortID(1)));
+  controller.setConfiguredRates(PortID(1), 50, 50);
+  EXPECT_EQ(Rates({50, 50}), controller.getEffectiveRates(PortID(1)));
+}
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SflowV5Encoder.h"
+
+#include <folly/IPAddress.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::ByteRange;
+using folly::IPAddress;
+using folly::io::Cursor;
+
+namespace {
+
+void checkHeader(
+    Cursor& c,
+    const IPAddress& agent,
+    uint32_t seq,
+    uint32_t uptime,
+    uint32_t nsamples) {
+  EXPECT_EQ(5, c.readBE<uint32_t>());
+  EXPECT_EQ(agent.isV4() ? 1 : 2, c.readBE<uint32_t>());
+  std::vector<uint8_t> addr(agent.byteCount());
+  c.pull(addr.data(), addr.size());
+  EXPECT_EQ(0, memcmp(addr.data(), agent.bytes(), addr.size()));
+  EXPECT_EQ(0, c.readBE<uint32_t>()); // sub agent
+  EXPECT_EQ(seq, c.readBE<uint32_t>());
+  EXPECT_EQ(uptime, c.readBE<uint32_t>());
+  EXPECT_EQ(nsamples, c.readBE<uint32_t>());
+}
+
+} // unnamed namespace
+
+TEST(SflowV5Encoder, flowSample) {
+  SflowV5Encoder encoder(1400);
+  IPAddress agent("10.0.0.1");
+  encoder.setAgent(agent);
+
+  std::vector<uint8_t> frame = {1, 2, 3, 4, 5, 6, 7};
+  SflowV5Encoder::FlowSample sample;
+  sample.sourceId = 3;
+  sample.samplingRate = 100;
+  sample.input = 3;
+  sample.output = 0x3fffffff;
+  sample.frameLength = 1500;
+  sample.header = ByteRange(frame.data(), frame.size());
+  EXPECT_TRUE(encoder.addFlowSample(sample));
+  EXPECT_TRUE(encoder.addFlowSample(sample));
+  EXPECT_EQ(2, encoder.numSamples());
+
+  auto datagram = encoder.finish(1234);
+  EXPECT_EQ(28 + 2 * SflowV5Encoder::flowSampleSize(frame.size()),
+            datagram.size());
+  auto buf = folly::IOBuf::wrapBuffer(datagram);
+  Cursor c(buf.get());
+  checkHeader(c, agent, 1, 1234, 2);
+  for (uint32_t i = 1; i <= 2; ++i) {
+    EXPECT_EQ(1, c.readBE<uint32_t>()); // flow sample
+    EXPECT_EQ(SflowV5Encoder::flowSampleSize(frame.size()) - 8,
+              c.readBE<uint32_t>());
+    EXPECT_EQ(i, c.readBE<uint32_t>()); // sequence
+    EXPECT_EQ(3, c.readBE<uint32_t>());
+    EXPECT_EQ(100, c.readBE<uint32_t>());
+    EXPECT_EQ(100 * i, c.readBE<uint32_t>()); // sample pool
+    EXPECT_EQ(0, c.readBE<uint32_t>());
+    EXPECT_EQ(3, c.readBE<uint32_t>());
+    EXPECT_EQ(0x3fffffff, c.readBE<uint32_t>());
+    EXPECT_EQ(1, c.readBE<uint32_t>());
+    EXPECT_EQ(1, c.readBE<uint32_t>()); // raw packet header
+    EXPECT_EQ(16 + 8, c.readBE<uint32_t>());
+    EXPECT_EQ(1, c.readBE<uint32_t>()); // ethernet
+    EXPECT_EQ(1500, c.readBE<uint32_t>());
+    EXPECT_EQ(0, c.readBE<uint32_t>());
+    EXPECT_EQ(frame.size(), c.readBE<uint32_t>());
+    std::vector<uint8_t> header(8);
+    c.pull(header.data(), header.size());
+    EXPECT_TRUE(std::equal(frame.begin(), frame.end(), header.begin()));
+    EXPECT_EQ(0, header.back()); // padding
+  }
+  EXPECT_TRUE(c.isAtEnd());
+}
+
+TEST(SflowV5Encoder, counterSample) {
+  SflowV5Encoder encoder(1400);
+  IPAddress agent("2401:db00::1");
+  encoder.setAgent(agent);
+
+  SflowV5Encoder::InterfaceCounters counters;
+  counters.ifIndex = 7;
+  counters.ifSpeed = 100000000000;
+  counters.adminUp = true;
+  counters.operUp = false;
+  counters.inOctets = 0x100000001;
+  counters.outErrors = 9;
+  EXPECT_TRUE(encoder.addCounterSample(counters));
+
+  auto datagram = encoder.finish(5);
+  EXPECT_EQ(40 + 116, datagram.size());
+  auto buf = folly::IOBuf::wrapBuffer(datagram);
+  Cursor c(buf.get());
+  checkHeader(c, agent, 1, 5, 1);
+  EXPECT_EQ(2, c.readBE<uint32_t>()); // counter sample
+  EXPECT_EQ(108, c.readBE<uint32_t>());
+  EXPECT_EQ(1, c.readBE<uint32_t>());
+  EXPECT_EQ(7, c.readBE<uint32_t>());
+  EXPECT_EQ(1, c.readBE<uint32_t>());
+  EXPECT_EQ(1, c.readBE<uint32_t>()); // generic interface counters
+  EXPECT_EQ(88, c.readBE<uint32_t>());
+  EXPECT_EQ(7, c.readBE<uint32_t>());
+  EXPECT_EQ(6, c.readBE<uint32_t>());
+  EXPECT_EQ(100000000000, c.readBE<uint64_t>());
+  EXPECT_EQ(1, c.readBE<uint32_t>());
+  EXPECT_EQ(1, c.readBE<uint32_t>()); // admin up, oper down
+  EXPECT_EQ(0x100000001, c.readBE<uint64_t>());
+  c.skip(4 * 6 + 8 + 4 * 4);
+  EXPECT_EQ(9, c.readBE<uint32_t>());
+  EXPECT_EQ(0, c.readBE<uint32_t>());
+  EXPECT_TRUE(c.isAtEnd());
+}
+
+TEST(SflowV5Encoder, fullDatagram) {
+  auto sampleSize = SflowV5Encoder::counterSampleSize();
+  SflowV5Encoder encoder(40 + 2 * sampleSize);
+  SflowV5Encoder::InterfaceCounters counters;
+  EXPECT_TRUE(encoder.addCounterSample(counters));
+  EXPECT_TRUE(encoder.addCounterSample(counters));
+  EXPECT_FALSE(encoder.addCounterSample(counters));
+  EXPECT_EQ(2, encoder.numSamples());
+  EXPECT_EQ(28 + 2 * sampleSize, encoder.finish(0).size());
+
+  // Sequence numbers carry on into the next datagram
+  encoder.reset();
+  EXPECT_EQ(0, encoder.numSamples());
+  EXPECT_TRUE(encoder.addCounterSample(counters));
+  auto datagram = encoder.finish(0);
+  auto buf = folly::IOBuf::wrapBuffer(datagram);
+  Cursor c(buf.get());
+  checkHeader(c, IPAddress("0.0.0.0"), 2, 0, 1);
+  c.skip(8);
+  EXPECT_EQ(3, c.readBE<uint32_t>());
+}
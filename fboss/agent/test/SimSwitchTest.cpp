@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sim/SimSwitch.h"
+
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddressV4;
+using folly::MacAddress;
+using std::make_shared;
+using std::shared_ptr;
+using std::chrono::microseconds;
+
+namespace {
+
+shared_ptr<SwitchState> apply(
+    SimSwitch* sim,
+    const shared_ptr<SwitchState>& oldState,
+    const shared_ptr<SwitchState>& newState) {
+  newState->publish();
+  return sim->stateChanged(StateDelta(oldState, newState));
+}
+
+shared_ptr<SwitchState> addArpEntries(
+    const shared_ptr<SwitchState>& state,
+    int numEntries) {
+  auto newState = state->clone();
+  auto arpTable = newState->getVlans()
+                      ->getVlan(VlanID(1))
+                      ->getArpTable()
+                      ->modify(VlanID(1), &newState);
+  for (int i = 0; i < numEntries; ++i) {
+    arpTable->addEntry(
+        IPAddressV4::fromLongHBO((10u << 24) + 10 + i),
+        MacAddress::fromHBO(0x020000000010 + i),
+        PortDescriptor(PortID(1)),
+        InterfaceID(1));
+  }
+  return newState;
+}
+
+shared_ptr<SwitchState> addAcls(
+    const shared_ptr<SwitchState>& state,
+    int numAcls) {
+  auto newState = state->clone();
+  for (int i = 0; i < numAcls; ++i) {
+    auto acl = make_shared<AclEntry>(i, folly::to<std::string>("acl", i));
+    acl->setProto(6);
+    newState->addAcl(acl);
+  }
+  return newState;
+}
+
+} // unnamed namespace
+
+TEST(SimSwitch, acceptsEverythingByDefault) {
+  SimSwitch sim(nullptr, 0);
+  auto empty = make_shared<SwitchState>();
+  auto state = testStateA();
+  EXPECT_EQ(state, apply(&sim, empty, state));
+
+  auto stats = sim.getStats();
+  EXPECT_EQ(1, stats.stateChangedCalls);
+  EXPECT_EQ(1, stats.ecmpGroups);
+  EXPECT_GT(stats.lpmEntries, 0);
+  EXPECT_EQ(0, stats.tableFullErrors);
+  EXPECT_EQ(microseconds(0), stats.modeledLatency);
+}
+
+TEST(SimSwitch, lpmTableFull) {
+  auto empty = make_shared<SwitchState>();
+  auto state = testStateA();
+  uint32_t numRoutes;
+  {
+    SimSwitch sim(nullptr, 0);
+    apply(&sim, empty, state);
+    numRoutes = sim.getStats().lpmEntries;
+  }
+
+  SimSwitch sim(nullptr, 0);
+  SimSwitch::HwModel model;
+  model.lpmTableSize = numRoutes - 1;
+  sim.setHwModel(model);
+  auto applied = apply(&sim, empty, state);
+  EXPECT_NE(state, applied);
+
+  auto stats = sim.getStats();
+  EXPECT_EQ(numRoutes - 1, stats.lpmEntries);
+  EXPECT_EQ(1, stats.tableFullErrors);
+}
+
+TEST(SimSwitch, ecmpTableFull) {
+  SimSwitch sim(nullptr, 0);
+  SimSwitch::HwModel model;
+  model.ecmpTableSize = 0;
+  sim.setHwModel(model);
+
+  auto state = testStateA();
+  auto applied = apply(&sim, make_shared<SwitchState>(), state);
+  EXPECT_NE(state, applied);
+  // The only ECMP route is left out, the interface routes are in
+  EXPECT_NO_ROUTE(applied->getRouteTables(), RouterID(0), "10.1.1.0/24");
+  EXPECT_NE(
+      nullptr,
+      GET_ROUTE_V4(applied->getRouteTables(), RouterID(0), "10.0.0.0/24"));
+
+  auto stats = sim.getStats();
+  EXPECT_EQ(0, stats.ecmpGroups);
+  EXPECT_EQ(1, stats.tableFullErrors);
+}
+
+TEST(SimSwitch, hostTableFull) {
+  SimSwitch sim(nullptr, 0);
+  SimSwitch::HwModel model;
+  model.hostTableSize = 3;
+  sim.setHwModel(model);
+
+  auto state = testStateA();
+  state = apply(&sim, make_shared<SwitchState>(), state);
+  auto newState = addArpEntries(state, 5);
+  auto applied = apply(&sim, state, newState);
+  EXPECT_EQ(
+      3, applied->getVlans()->getVlan(VlanID(1))->getArpTable()->size());
+  EXPECT_EQ(3, sim.getStats().hostEntries);
+  EXPECT_EQ(2, sim.getStats().tableFullErrors);
+
+  // Removing the entries frees their space
+  auto removed = apply(&sim, applied, state);
+  EXPECT_EQ(state, removed);
+  EXPECT_EQ(0, sim.getStats().hostEntries);
+}
+
+TEST(SimSwitch, aclTableFull) {
+  SimSwitch sim(nullptr, 0);
+  SimSwitch::HwModel model;
+  model.aclTableSize = 2;
+  sim.setHwModel(model);
+
+  auto empty = make_shared<SwitchState>();
+  auto applied = apply(&sim, empty, addAcls(empty, 4));
+  EXPECT_EQ(2, applied->getAcls()->size());
+  EXPECT_EQ(2, sim.getStats().aclEntries);
+  EXPECT_EQ(2, sim.getStats().tableFullErrors);
+}
+
+TEST(SimSwitch, latency) {
+  SimSwitch sim(nullptr, 0);
+  SimSwitch::HwModel model;
+  model.perUpdateLatency = microseconds(100);
+  model.aclLatency = microseconds(10);
+  sim.setHwModel(model);
+
+  auto empty = make_shared<SwitchState>();
+  auto state = addAcls(empty, 3);
+  state = apply(&sim, empty, state);
+  EXPECT_EQ(microseconds(130), sim.getStats().modeledLatency);
+
+  // Every call pays the fixed cost, even with nothing to program
+  auto unchanged = state->clone();
+  apply(&sim, state, unchanged);
+  EXPECT_EQ(microseconds(230), sim.getStats().modeledLatency);
+  EXPECT_EQ(2, sim.getStats().stateChangedCalls);
+}
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/SlowPathRouteCache.h"
+
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+
+TEST(SlowPathRouteCache, lookups) {
+  SlowPathRouteCache cache;
+  auto state = testStateA();
+  state->publish();
+
+  // Connected, the destination itself is resolved
+  auto nhs = cache.getNextHops(state, IPAddressV4("10.0.0.5"));
+  ASSERT_NE(nullptr, nhs);
+  ASSERT_EQ(1, nhs->size());
+  const auto& nh = nhs->front();
+  EXPECT_EQ(InterfaceID(1), nh.intf);
+  EXPECT_EQ(VlanID(1), nh.vlan);
+  EXPECT_EQ(MacAddress("00:02:00:00:00:01"), nh.intfMac);
+  EXPECT_EQ(9000, nh.intfMtu);
+  EXPECT_EQ(IPAddressV4("10.0.0.1"), nh.source);
+  EXPECT_EQ(IPAddressV4("10.0.0.5"), nh.target);
+
+  // Through the resolved next hops of 10.1.1.0/24
+  nhs = cache.getNextHops(state, IPAddressV4("10.1.1.5"));
+  ASSERT_NE(nullptr, nhs);
+  std::set<IPAddressV4> targets;
+  for (const auto& hop : *nhs) {
+    EXPECT_EQ(VlanID(1), hop.vlan);
+    targets.insert(hop.target);
+  }
+  EXPECT_EQ(
+      std::set<IPAddressV4>(
+          {IPAddressV4("10.0.0.22"), IPAddressV4("10.0.0.23")}),
+      targets);
+
+  // Our own address has a route, but nothing to resolve
+  nhs = cache.getNextHops(state, IPAddressV4("10.0.0.1"));
+  ASSERT_NE(nullptr, nhs);
+  EXPECT_TRUE(nhs->empty());
+
+  EXPECT_EQ(nullptr, cache.getNextHops(state, IPAddressV4("8.8.8.8")));
+
+  nhs = cache.getNextHops(state, IPAddressV6("2401:db00:2110:3055::5"));
+  ASSERT_NE(nullptr, nhs);
+  ASSERT_EQ(1, nhs->size());
+  EXPECT_EQ(VlanID(55), nhs->front().vlan);
+  EXPECT_EQ(IPAddressV6("2401:db00:2110:3055::1"), nhs->front().source);
+  EXPECT_EQ(IPAddressV6("2401:db00:2110:3055::5"), nhs->front().target);
+  EXPECT_EQ(
+      nullptr, cache.getNextHops(state, IPAddressV6("2401:db00:9999::5")));
+}
+
+TEST(SlowPathRouteCache, rebuiltOnStateChange) {
+  SlowPathRouteCache cache;
+  auto state = testStateA();
+  state->publish();
+  auto nhs = cache.getNextHops(state, IPAddressV4("10.1.1.5"));
+  ASSERT_NE(nullptr, nhs);
+  EXPECT_EQ(nhs, cache.getNextHops(state, IPAddressV4("10.1.1.5")));
+  EXPECT_EQ(nullptr, cache.getNextHops(state, IPAddressV4("20.0.0.1")));
+
+  // A state routing 20.0.0.0/8 is seen without waiting for anything to
+  // expire
+  auto newState = state->clone();
+  RouteUpdater updater(newState->getRouteTables());
+  RouteNextHopSet nexthops;
+  nexthops.emplace(
+      UnresolvedNextHop(IPAddress("10.0.0.22"), UCMP_DEFAULT_WEIGHT));
+  updater.addRoute(
+      RouterID(0),
+      IPAddress("20.0.0.0"),
+      8,
+      ClientID(1001),
+      RouteNextHopEntry(nexthops, AdminDistance::MAX_ADMIN_DISTANCE));
+  newState->resetRouteTables(updater.updateDone());
+  newState->publish();
+
+  auto newNhs = cache.getNextHops(newState, IPAddressV4("20.0.0.1"));
+  ASSERT_NE(nullptr, newNhs);
+  ASSERT_EQ(1, newNhs->size());
+  EXPECT_EQ(IPAddressV4("10.0.0.22"), newNhs->front().target);
+  EXPECT_NE(nhs, cache.getNextHops(newState, IPAddressV4("10.1.1.5")));
+  // What the handler got for the old state stays valid
+  EXPECT_EQ(2, nhs->size());
+}
+
+TEST(SlowPathRouteCache, bounded) {
+  SlowPathRouteCache cache;
+  auto state = testStateA();
+  state->publish();
+  auto first = cache.getNextHops(state, IPAddressV4("10.0.0.2"));
+  EXPECT_EQ(first, cache.getNextHops(state, IPAddressV4("10.0.0.2")));
+  for (uint32_t i = 0; i < SlowPathRouteCache::kMaxEntries; ++i) {
+    cache.getNextHops(state, IPAddressV4::fromLongHBO(0x0a640000 + i));
+  }
+  // The cache started over, the entry is looked up anew
+  auto again = cache.getNextHops(state, IPAddressV4("10.0.0.2"));
+  ASSERT_NE(nullptr, again);
+  EXPECT_NE(first, again);
+  EXPECT_EQ(IPAddressV4("10.0.0.2"), again->front().target);
+}
@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/StateChangeSections.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+namespace {
+class RunOrder {
+ public:
+  std::function<void()> record(const std::string& name) {
+    return [this, name]() {
+      std::lock_guard<std::mutex> g(lock_);
+      order_.push_back(name);
+    };
+  }
+  std::vector<std::string> get() {
+    std::lock_guard<std::mutex> g(lock_);
+    return order_;
+  }
+  size_t position(const std::string& name) {
+    auto order = get();
+    return std::find(order.begin(), order.end(), name) - order.begin();
+  }
+
+ private:
+  std::mutex lock_;
+  std::vector<std::string> order_;
+};
+} // namespace
+
+TEST(StateChangeSections, sequential) {
+  RunOrder order;
+  StateChangeSections sections;
+  auto a = sections.add("a", order.record("a"));
+  sections.add("b", order.record("b"));
+  sections.add("c", order.record("c"), {a});
+  sections.run();
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c"}), order.get());
+
+  EXPECT_THROW(sections.add("d", order.record("d"), {7}), FbossError);
+}
+
+TEST(StateChangeSections, dependenciesGoFirst) {
+  folly::CPUThreadPoolExecutor executor(4);
+  RunOrder order;
+  StateChangeSections sections;
+  auto a = sections.add("a", order.record("a"));
+  auto b = sections.add("b", order.record("b"));
+  auto c = sections.add("c", order.record("c"), {a, b});
+  sections.add("d", order.record("d"), {c});
+  sections.add("e", order.record("e"), {a});
+  sections.run(&executor);
+
+  ASSERT_EQ(5, order.get().size());
+  EXPECT_LT(order.position("a"), order.position("c"));
+  EXPECT_LT(order.position("b"), order.position("c"));
+  EXPECT_LT(order.position("c"), order.position("d"));
+  EXPECT_LT(order.position("a"), order.position("e"));
+}
+
+TEST(StateChangeSections, independentRunConcurrently) {
+  // Each section waits for the other to start, so they only both finish
+  // if they run at the same time
+  folly::CPUThreadPoolExecutor executor(2);
+  std::promise<void> aStarted;
+  std::promise<void> bStarted;
+  StateChangeSections sections;
+  sections.add("a", [&]() {
+    aStarted.set_value();
+    bStarted.get_future().wait();
+  });
+  sections.add("b", [&]() {
+    bStarted.set_value();
+    aStarted.get_future().wait();
+  });
+  sections.run(&executor);
+}
+
+TEST(StateChangeSections, failureSkipsDependents) {
+  folly::CPUThreadPoolExecutor executor(2);
+  for (auto* exec : {static_cast<folly::Executor*>(nullptr),
+                     static_cast<folly::Executor*>(&executor)}) {
+    RunOrder order;
+    StateChangeSections sections;
+    auto bad = sections.add("bad", []() { throw FbossError("failed"); });
+    auto skipped = sections.add("skipped", order.record("skipped"), {bad});
+    sections.add("alsoSkipped", order.record("alsoSkipped"), {skipped});
+    sections.add("unrelated", order.record("unrelated"));
+    EXPECT_THROW(sections.run(exec), FbossError);
+    EXPECT_EQ(std::vector<std::string>({"unrelated"}), order.get());
+  }
+}
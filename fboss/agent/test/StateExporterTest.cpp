@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateExporter.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/json.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using std::string;
+using std::vector;
+
+namespace {
+const StateNodeChange* findChange(
+    const StateExportUpdate& update,
+    const string& subtree,
+    const vector<string>& path) {
+  for (const auto& change : update.changes) {
+    if (change.subtree == subtree && change.path == path) {
+      return &change;
+    }
+  }
+  return nullptr;
+}
+} // unnamed namespace
+
+TEST(StateExporter, subtrees) {
+  EXPECT_EQ(StateExporter::allSubtrees(), StateExporter::getSubtrees({}));
+  EXPECT_EQ(
+      StateExporter::Subtrees({"ports", "vlans"}),
+      StateExporter::getSubtrees({"vlans", "ports"}));
+  EXPECT_THROW(StateExporter::getSubtrees({"ports", "bogus"}), FbossError);
+}
+
+TEST(StateExporter, snapshot) {
+  auto state = testStateA();
+  state->publish();
+  auto update = StateExporter::snapshot(state, {"ports", "defaultVlan"});
+  EXPECT_EQ(state->getGeneration(), update.generation);
+  ASSERT_EQ(2, update.changes.size());
+
+  auto ports = findChange(update, "ports", {});
+  ASSERT_NE(nullptr, ports);
+  ASSERT_TRUE(ports->__isset.json);
+  EXPECT_EQ(
+      state->getPorts()->toFollyDynamic(), folly::parseJson(ports->json));
+  auto defaultVlan = findChange(update, "defaultVlan", {});
+  ASSERT_NE(nullptr, defaultVlan);
+  EXPECT_EQ(
+      static_cast<uint32_t>(state->getDefaultVlan()),
+      folly::parseJson(defaultVlan->json).asInt());
+}
+
+TEST(StateExporter, patch) {
+  auto state = testStateA();
+  state->publish();
+
+  auto newState = state->clone();
+  newState->getPorts()->getPort(PortID(1))->modify(&newState)->setName("up1");
+  newState->getPorts()->modify(&newState)->removeNode(PortID(2));
+  RouteUpdater updater(newState->getRouteTables());
+  RouteNextHopSet nexthops;
+  nexthops.emplace(
+      UnresolvedNextHop(IPAddress("10.0.0.22"), UCMP_DEFAULT_WEIGHT));
+  updater.addRoute(
+      RouterID(0),
+      IPAddress("20.0.0.0"),
+      8,
+      ClientID(1001),
+      RouteNextHopEntry(nexthops, AdminDistance::MAX_ADMIN_DISTANCE));
+  newState->resetRouteTables(updater.updateDone());
+  newState->publish();
+
+  StateDelta delta(state, newState);
+  auto update = StateExporter::patch(delta, StateExporter::allSubtrees());
+  EXPECT_EQ(newState->getGeneration(), update.generation);
+
+  auto changed = findChange(update, "ports", {"1"});
+  ASSERT_NE(nullptr, changed);
+  ASSERT_TRUE(changed->__isset.json);
+  EXPECT_EQ(
+      newState->getPorts()->getPort(PortID(1))->toFollyDynamic(),
+      folly::parseJson(changed->json));
+  auto removed = findChange(update, "ports", {"2"});
+  ASSERT_NE(nullptr, removed);
+  EXPECT_FALSE(removed->__isset.json);
+
+  // Only the new route, not the table it is in
+  auto route = findChange(update, "routeTables", {"0", "ribV4", "20.0.0.0/8"});
+  ASSERT_NE(nullptr, route);
+  EXPECT_TRUE(route->__isset.json);
+  EXPECT_EQ(nullptr, findChange(update, "routeTables", {"0"}));
+  EXPECT_EQ(nullptr, findChange(update, "controlPlane", {}));
+  EXPECT_EQ(nullptr, findChange(update, "defaultVlan", {}));
+
+  // Changes outside the subscribed subtrees are left out
+  update = StateExporter::patch(delta, {"vlans", "acls"});
+  EXPECT_TRUE(update.changes.empty());
+}
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateShm.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/RouteTypes.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::MacAddress;
+
+namespace {
+
+const RouterID kRid0(0);
+
+std::shared_ptr<SwitchState> stateWithNeighbor() {
+  auto state = testStateA();
+  auto vlan = state->getVlans()->getVlan(VlanID(1));
+  vlan->getArpTable()->modify(VlanID(1), &state)->addEntry(
+      IPAddressV4("10.0.0.22"),
+      MacAddress("02:00:00:00:00:22"),
+      PortDescriptor(PortID(2)),
+      InterfaceID(1));
+  return state;
+}
+
+} // unnamed namespace
+
+TEST(StateShm, lookups) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "state").string();
+  StateShmWriter writer(path, 64, 64, 64, 64);
+  StateShmReader reader(path);
+  EXPECT_EQ(0, reader.getGeneration());
+  EXPECT_FALSE(reader.getPort(PortID(1)).hasValue());
+
+  auto state = stateWithNeighbor();
+  writer.write(*state);
+  EXPECT_EQ(1, reader.getGeneration());
+  EXPECT_EQ(state->getGeneration(), reader.getStateGeneration());
+  EXPECT_FALSE(reader.isTruncated());
+
+  EXPECT_EQ(20, reader.getPorts().size());
+  auto port = reader.getPort(PortID(5));
+  ASSERT_TRUE(port.hasValue());
+  EXPECT_EQ(5, port->id);
+  EXPECT_STREQ("port5", port->name);
+  EXPECT_FALSE(reader.getPort(PortID(21)).hasValue());
+
+  auto neighbor = reader.getNeighbor(IPAddress("10.0.0.22"));
+  ASSERT_TRUE(neighbor.hasValue());
+  EXPECT_EQ(1, neighbor->vlan);
+  EXPECT_EQ(2, neighbor->port);
+  EXPECT_EQ(
+      MacAddress("02:00:00:00:00:22"),
+      MacAddress::fromBinary(folly::ByteRange(neighbor->mac, 6)));
+  EXPECT_FALSE(reader.getNeighbor(IPAddress("10.0.0.23")).hasValue());
+
+  // The longest prefix wins
+  auto route = reader.longestMatch(kRid0, IPAddress("10.1.1.9"));
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(IPAddress("10.1.1.0"), route->prefix.first);
+  EXPECT_EQ(24, route->prefix.second);
+  EXPECT_TRUE(route->resolved);
+  EXPECT_EQ(RouteForwardAction::NEXTHOPS, route->action);
+  ASSERT_EQ(2, route->nextHops.size());
+  for (const auto& nhop : route->nextHops) {
+    EXPECT_EQ(1, nhop.intf);
+  }
+  EXPECT_EQ(
+      IPAddress("10.0.0.22"),
+      StateShmReader::toIPAddress(
+          route->nextHops[0].addr, route->nextHops[0].isV6));
+
+  route = reader.longestMatch(kRid0, IPAddress("2401:db00:2110:3055::9"));
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(IPAddress("2401:db00:2110:3055::"), route->prefix.first);
+  EXPECT_EQ(64, route->prefix.second);
+
+  EXPECT_FALSE(reader.longestMatch(kRid0, IPAddress("8.8.8.8")).hasValue());
+  EXPECT_FALSE(
+      reader.longestMatch(RouterID(1), IPAddress("10.1.1.9")).hasValue());
+
+  // Publishing again flips to the other slot
+  writer.write(*testStateA());
+  EXPECT_EQ(2, reader.getGeneration());
+  EXPECT_FALSE(reader.getNeighbor(IPAddress("10.0.0.22")).hasValue());
+  EXPECT_TRUE(reader.longestMatch(kRid0, IPAddress("10.1.1.9")).hasValue());
+}
+
+TEST(StateShm, truncated) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "state").string();
+  StateShmWriter writer(path, 4, 2, 64, 64);
+  writer.write(*testStateA());
+  StateShmReader reader(path);
+  EXPECT_TRUE(reader.isTruncated());
+  EXPECT_EQ(4, reader.getPorts().size());
+}
+
+TEST(StateShm, replacedRegion) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "state").string();
+  EXPECT_THROW(StateShmReader{path}, FbossError);
+
+  auto writer = std::make_unique<StateShmWriter>(path, 64, 64, 64, 64);
+  StateShmReader reader(path);
+  EXPECT_TRUE(reader.isCurrent());
+  // As when the agent restarts
+  writer = std::make_unique<StateShmWriter>(path, 64, 64, 64, 64);
+  EXPECT_FALSE(reader.isCurrent());
+  writer->write(*testStateA());
+  EXPECT_EQ(0, reader.getGeneration());
+  EXPECT_EQ(1, StateShmReader(path).getGeneration());
+}
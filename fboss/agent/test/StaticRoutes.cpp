@@ -169,3 +169,47 @@ TEST(StaticRoutes, configureUnconfigure) {
   // No routes and hence no routing table
   ASSERT_EQ(nullptr, t2);
 }
+
+TEST(StaticRoutes, reloadOnlyChangesDifferentRoutes) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  config.__isset.staticRoutesToNull = true;
+  config.staticRoutesToNull.resize(1);
+  config.staticRoutesToNull[0].prefix = "1.1.1.1/32";
+  config.__isset.staticRoutesWithNhops = true;
+  config.staticRoutesWithNhops.resize(1);
+  config.staticRoutesWithNhops[0].prefix = "3.3.3.3/32";
+  config.staticRoutesWithNhops[0].nexthops.resize(1);
+  config.staticRoutesWithNhops[0].nexthops[0] = "1.1.1.1";
+
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+
+  // The same static routes again change nothing
+  EXPECT_EQ(
+      nullptr,
+      publishAndApplyConfig(stateV1, &config, platform.get(), &config));
+
+  // The route to 1.1.1.1 now goes to the CPU, and 3.3.3.3 follows even
+  // though its own config is the same
+  auto newConfig = config;
+  newConfig.staticRoutesToNull.clear();
+  newConfig.__isset.staticRoutesToCPU = true;
+  newConfig.staticRoutesToCPU.resize(1);
+  newConfig.staticRoutesToCPU[0].prefix = "1.1.1.1/32";
+  auto stateV2 =
+      publishAndApplyConfig(stateV1, &newConfig, platform.get(), &config);
+  ASSERT_NE(nullptr, stateV2);
+  auto rib = stateV2->getRouteTables()->getRouteTable(RouterID(0))->getRibV4();
+  for (auto addr : {"1.1.1.1", "3.3.3.3"}) {
+    auto route = rib->exactMatch({IPAddressV4(addr), 32});
+    ASSERT_NE(nullptr, route);
+    EXPECT_TRUE(route->isResolved());
+    EXPECT_EQ(
+        RouteNextHopEntry(TO_CPU, AdminDistance::MAX_ADMIN_DISTANCE),
+        route->getForwardInfo());
+    EXPECT_NE(nullptr, route->getEntryForClient(kStaticClient));
+  }
+}
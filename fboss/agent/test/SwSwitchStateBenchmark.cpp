@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/Memory.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using std::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+
+/*
+ * Throughput of SwSwitch::getState() from many threads at once, as seen
+ * from the thrift handler and packet rx threads, both with the state left
+ * alone and with the update thread publishing new states as fast as it can.
+ */
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+
+void init() {
+  MacAddress localMac("02:00:01:00:00:01");
+  sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init(nullptr /* No custom TunManager */);
+}
+
+void getStateConcurrently(size_t numIters, size_t numThreads, bool update) {
+  std::atomic<bool> done{false};
+  std::unique_ptr<std::thread> updater;
+  BENCHMARK_SUSPEND {
+    if (update) {
+      updater = make_unique<std::thread>([&]() {
+        for (int i = 0; !done; ++i) {
+          sw->updateStateBlocking(
+              "rename", [=](const shared_ptr<SwitchState>& state) {
+                auto newState = state->clone();
+                auto port = newState->getPorts()->getPort(PortID(1));
+                port->modify(&newState)->setName(folly::to<std::string>(i));
+                return newState;
+              });
+        }
+      });
+    }
+  }
+
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < numThreads; ++t) {
+    readers.emplace_back([=]() {
+      for (size_t n = 0; n < numIters; ++n) {
+        folly::doNotOptimizeAway(sw->getState());
+      }
+    });
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  BENCHMARK_SUSPEND {
+    done = true;
+    if (updater) {
+      updater->join();
+    }
+  }
+}
+
+} // unnamed namespace
+
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 1_thread, 1, false)
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 4_threads, 4, false)
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 16_threads, 16, false)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 1_thread_updating, 1, true)
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 4_threads_updating, 4, true)
+BENCHMARK_NAMED_PARAM(getStateConcurrently, 16_threads_updating, 16, true)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Set up the switch once, outside of the benchmark functions
+  init();
+
+  folly::runBenchmarks();
+  sw.reset();
+  return 0;
+}
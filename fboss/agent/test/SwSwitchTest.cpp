@@ -10,17 +10,52 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
 #include "fboss/agent/Main.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/PortStats.h"
+#include "fboss/agent/StateObserver.h"
 #include "fboss/agent/state/Port.h"
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/test/TestUtils.h"
 #include "fboss/agent/test/HwTestHandle.h"
 #include "fboss/agent/test/CounterCache.h"
 
+#include <folly/Conv.h>
+
+DECLARE_bool(pipeline_state_updates);
+DECLARE_int32(update_starvation_ms);
+
 using namespace facebook::fboss;
 using std::string;
+using std::chrono::milliseconds;
+using ::testing::_;
+
+namespace {
+// Records which thread it was notified from
+class ThreadRecordingObserver : public AutoRegisterStateObserver {
+ public:
+  ThreadRecordingObserver(SwSwitch* sw, const string& name, bool async)
+      : AutoRegisterStateObserver(sw, name, async) {}
+  ~ThreadRecordingObserver() override {
+    unregister();
+  }
+
+  void stateUpdated(const StateDelta& /*delta*/) override {
+    ++numUpdates;
+    threadId = std::this_thread::get_id();
+  }
+
+  std::atomic<int> numUpdates{0};
+  std::thread::id threadId;
+};
+} // namespace
 
 class SwSwitchTest: public ::testing::Test {
 public:
@@ -79,3 +114,244 @@ TEST_F(SwSwitchTest, UpdateStatsExceptionCounter){
     SwitchStats::kCounterPrefix + "update_stats_exceptions.sum.60", 1);
 
 }
+
+TEST_F(SwSwitchTest, AsyncStateObserver) {
+  ThreadRecordingObserver syncObserver(sw, "syncObserver", false);
+  ThreadRecordingObserver asyncObserver(sw, "asyncObserver", true);
+
+  sw->updateStateBlocking(
+      "change state", [](const std::shared_ptr<SwitchState>& state) {
+        auto newState = state->clone();
+        auto port =
+            newState->getPorts()->getPort(PortID(1))->modify(&newState);
+        port->setName("renamed");
+        return newState;
+      });
+  sw->waitForStateObservers();
+
+  EXPECT_EQ(1, syncObserver.numUpdates);
+  EXPECT_EQ(1, asyncObserver.numUpdates);
+  EXPECT_NE(syncObserver.threadId, asyncObserver.threadId);
+}
+
+TEST_F(SwSwitchTest, SlowestStateUpdates) {
+  auto renamePort = [&](const std::string& name, milliseconds delay) {
+    sw->updateStateBlocking(
+        name, [=](const std::shared_ptr<SwitchState>& state) {
+          /* sleep override */
+          std::this_thread::sleep_for(delay);
+          auto newState = state->clone();
+          auto port =
+              newState->getPorts()->getPort(PortID(1))->modify(&newState);
+          port->setName(name);
+          return newState;
+        });
+  };
+  renamePort("fast update", milliseconds(0));
+  renamePort("slow update", milliseconds(20));
+
+  // Updates applied while setting up the switch are in there too
+  auto timings = sw->getSlowestStateUpdates(100);
+  auto find = [&](const std::string& name) {
+    return std::find_if(
+        timings.begin(), timings.end(), [&](const StateUpdateTiming& t) {
+          return t.name == name;
+        });
+  };
+  auto fast = find("fast update");
+  auto slow = find("slow update");
+  ASSERT_NE(timings.end(), fast);
+  ASSERT_NE(timings.end(), slow);
+  EXPECT_LT(slow, fast);
+  EXPECT_GE(slow->swApplyUs, 20000);
+  EXPECT_EQ(1, slow->batchSize);
+
+  EXPECT_EQ(1, sw->getSlowestStateUpdates(1).size());
+}
+
+namespace {
+/*
+ * Queue updates of each priority while the update thread is busy, and
+ * return the order they were applied in.
+ */
+std::vector<std::string> applyOrder(SwSwitch* sw) {
+  std::vector<std::string> applied;
+  auto record = [&applied](const std::string& name) {
+    return [&applied, name](const std::shared_ptr<SwitchState>&) {
+      applied.push_back(name);
+      return std::shared_ptr<SwitchState>();
+    };
+  };
+
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future();
+  sw->updateState("busy", [&](const std::shared_ptr<SwitchState>&) {
+    started.set_value();
+    released.wait();
+    return std::shared_ptr<SwitchState>();
+  });
+  started.get_future().wait();
+
+  // Not coalesced with the flush, which may be queued before this is applied
+  sw->updateStateNoCoalescing("config", record("config"));
+  sw->updateState("route", record("route"), StateUpdate::Priority::ROUTE);
+  sw->updateState(
+      "neighbor", record("neighbor"), StateUpdate::Priority::NEIGHBOR);
+  sw->updateState("link", record("link"), StateUpdate::Priority::LINK_STATE);
+  release.set_value();
+  sw->updateStateBlocking("flush", record("flush"));
+  return applied;
+}
+}
+
+TEST_F(SwSwitchTest, UpdatePriorities) {
+  std::vector<std::string> expected{
+      "link", "neighbor", "route", "config", "flush"};
+  EXPECT_EQ(expected, applyOrder(sw));
+}
+
+TEST_F(SwSwitchTest, StarvedUpdatesGoFirst) {
+  // Every update is starved right away, so they go in the order queued
+  auto oldStarvation = FLAGS_update_starvation_ms;
+  FLAGS_update_starvation_ms = 0;
+  std::vector<std::string> expected{
+      "config", "route", "neighbor", "link", "flush"};
+  EXPECT_EQ(expected, applyOrder(sw));
+  FLAGS_update_starvation_ms = oldStarvation;
+}
+
+TEST_F(SwSwitchTest, ConcurrentStateReads) {
+  // Readers racing with the update thread always see a published state, and
+  // never one older than what they saw before
+  std::atomic<bool> done{false};
+  std::atomic<int> numErrors{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      uint32_t lastApplied = 0;
+      uint32_t lastDesired = 0;
+      while (!done) {
+        auto applied = sw->getAppliedState();
+        auto desired = sw->getDesiredState();
+        if (!applied || !desired || !applied->isPublished() ||
+            applied->getGeneration() < lastApplied ||
+            desired->getGeneration() < lastDesired) {
+          ++numErrors;
+          continue;
+        }
+        lastApplied = applied->getGeneration();
+        lastDesired = desired->getGeneration();
+      }
+    });
+  }
+
+  auto startGeneration = sw->getState()->getGeneration();
+  for (int i = 0; i < 50; ++i) {
+    sw->updateStateBlocking(
+        "rename", [=](const std::shared_ptr<SwitchState>& state) {
+          auto newState = state->clone();
+          auto port =
+              newState->getPorts()->getPort(PortID(1))->modify(&newState);
+          port->setName(folly::to<string>("port", i));
+          return newState;
+        });
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(0, numErrors);
+  EXPECT_LT(startGeneration, sw->getState()->getGeneration());
+  EXPECT_EQ(sw->getState(), sw->getAppliedState());
+}
+
+TEST_F(SwSwitchTest, LinkStateChangesBatched) {
+  ThreadRecordingObserver observer(sw, "observer", false);
+
+  // Keep the update thread busy while the link state changes come in
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future();
+  sw->updateState("busy", [&](const std::shared_ptr<SwitchState>&) {
+    started.set_value();
+    released.wait();
+    return std::shared_ptr<SwitchState>();
+  });
+  started.get_future().wait();
+
+  sw->linkStateChanged(PortID(1), false);
+  sw->linkStateChanged(PortID(2), false);
+  sw->linkStateChanged(PortID(3), false);
+  // Undoes a change already batched, so goes into an update of its own
+  sw->linkStateChanged(PortID(1), true);
+  release.set_value();
+  waitForStateUpdates(sw);
+
+  EXPECT_EQ(2, observer.numUpdates);
+  auto ports = sw->getState()->getPorts();
+  EXPECT_TRUE(ports->getPort(PortID(1))->isUp());
+  EXPECT_FALSE(ports->getPort(PortID(2))->isUp());
+  EXPECT_FALSE(ports->getPort(PortID(3))->isUp());
+}
+
+class SwSwitchPipelineTest : public SwSwitchTest {
+ public:
+  void SetUp() override {
+    FLAGS_pipeline_state_updates = true;
+    SwSwitchTest::SetUp();
+  }
+  void TearDown() override {
+    SwSwitchTest::TearDown();
+    FLAGS_pipeline_state_updates = false;
+  }
+};
+
+TEST_F(SwSwitchPipelineTest, NextBatchComputedWhileProgramming) {
+  ThreadRecordingObserver observer(sw, "observer", false);
+  auto portName = [this]() {
+    return sw->getState()->getPorts()->getPort(PortID(1))->getName();
+  };
+  auto renamePort = [](const std::string& name) {
+    return [name](const std::shared_ptr<SwitchState>& state) {
+      auto newState = state->clone();
+      auto port =
+          newState->getPorts()->getPort(PortID(1))->modify(&newState);
+      port->setName(name);
+      return newState;
+    };
+  };
+
+  // Hold the hardware in the middle of programming the first rename
+  std::promise<std::thread::id> programming;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  EXPECT_HW_CALL(sw, stateChangedMock(_))
+      .WillOnce(testing::Invoke([&](const StateDelta& delta) {
+        programming.set_value(std::this_thread::get_id());
+        released.wait();
+        return delta.newState();
+      }))
+      .WillOnce(testing::Return(nullptr));
+  sw->updateStateNoCoalescing("first", renamePort("first"));
+  auto hwThread = programming.get_future().get();
+
+  // The second update runs on top of the first one, but is not published
+  // until the hardware is done with both
+  std::promise<std::string> secondRan;
+  sw->updateState("second", [&](const std::shared_ptr<SwitchState>& state) {
+    secondRan.set_value(state->getPorts()->getPort(PortID(1))->getName());
+    return renamePort("second")(state);
+  });
+  EXPECT_EQ("first", secondRan.get_future().get());
+  EXPECT_NE("first", portName());
+
+  release.set_value();
+  waitForStateUpdates(sw);
+  EXPECT_EQ("second", portName());
+  EXPECT_EQ(sw->getState(), sw->getAppliedState());
+  // Both notified, from the update thread rather than the hardware one
+  EXPECT_EQ(2, observer.numUpdates);
+  EXPECT_NE(hwThread, observer.threadId);
+}
@@ -0,0 +1,298 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/json.h>
+#include "fboss/agent/state/AclEntry.h"
+#include "fboss/agent/state/AclMap.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <array>
+#include <string>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+
+DEFINE_int32(num_ports, 128, "Number of ports in the benchmarked state");
+DEFINE_int32(num_neighbors, 10000,
+             "Number of ARP and of NDP entries in the benchmarked state");
+DEFINE_int32(num_routes, 100000,
+             "Number of IPv6 routes in the benchmarked state, with a tenth "
+             "as many IPv4 routes on top");
+DEFINE_int32(num_acls, 1000, "Number of ACLs in the benchmarked state");
+
+/*
+ * Cost of turning a SwitchState into folly::dynamic and JSON and back, as
+ * done for warm boot and getCurrentStateJSON(), for each of the large
+ * subtrees of a state the size of a busy switch, and for the whole state.
+ *
+ * After the benchmarks, the size of each subtree's JSON is printed, both
+ * compact and pretty printed as in the warm boot state file.
+ */
+
+namespace {
+
+constexpr InterfaceID kIntfID(1);
+constexpr VlanID kVlanID(1);
+
+// Global state used by the benchmarks
+shared_ptr<SwitchState> state;
+folly::dynamic portsJson;
+folly::dynamic vlansJson;
+folly::dynamic interfacesJson;
+folly::dynamic routeTablesJson;
+folly::dynamic aclsJson;
+folly::dynamic stateJson;
+string stateJsonStr;
+
+IPAddressV4 neighborV4(uint32_t i) {
+  return IPAddressV4::fromLongHBO((10u << 24) + 2 + i);
+}
+
+IPAddressV6 neighborV6(uint32_t i) {
+  std::array<uint8_t, 16> bytes{{0x24, 0x01, 0xdb, 0x00, 0x21, 0x10, 0x30,
+                                 0x01}};
+  for (int b = 0; b < 4; ++b) {
+    bytes[15 - b] = ((i + 2) >> (8 * b)) & 0xff;
+  }
+  return IPAddressV6(bytes);
+}
+
+MacAddress neighborMac(uint32_t i) {
+  return MacAddress::fromHBO((0x0200ull << 32) + i + 1);
+}
+
+shared_ptr<Vlan> makeVlan() {
+  auto vlan = make_shared<Vlan>(kVlanID, "vlan1");
+  auto arpTable = make_shared<ArpTable>();
+  auto ndpTable = make_shared<NdpTable>();
+  for (int i = 0; i < FLAGS_num_neighbors; ++i) {
+    auto port = PortDescriptor(PortID(i % FLAGS_num_ports + 1));
+    arpTable->addEntry(neighborV4(i), neighborMac(i), port, kIntfID);
+    ndpTable->addEntry(neighborV6(i), neighborMac(i), port, kIntfID);
+  }
+  vlan->setArpTable(arpTable);
+  vlan->setNdpTable(ndpTable);
+  for (int p = 1; p <= FLAGS_num_ports; ++p) {
+    vlan->addPort(PortID(p), false);
+  }
+  return vlan;
+}
+
+shared_ptr<Interface> makeInterface() {
+  auto intf = make_shared<Interface>(
+      kIntfID,
+      RouterID(0),
+      kVlanID,
+      "interface1",
+      MacAddress("02:00:01:00:00:01"),
+      9000,
+      false, /* is virtual */
+      false /* is state_sync disabled */);
+  Interface::Addresses addrs;
+  addrs.emplace(IPAddress("10.0.0.1"), 8);
+  addrs.emplace(IPAddress("2401:db00:2110:3001::1"), 64);
+  intf->setAddresses(addrs);
+  return intf;
+}
+
+// 2401:db01::/32 split into /64s
+IPAddressV6 routeV6(uint32_t i) {
+  std::array<uint8_t, 16> bytes{{0x24, 0x01, 0xdb, 0x01}};
+  for (int b = 0; b < 4; ++b) {
+    bytes[7 - b] = (i >> (8 * b)) & 0xff;
+  }
+  return IPAddressV6(bytes);
+}
+
+// 11.0.0.0/8 split into /24s
+IPAddressV4 routeV4(uint32_t i) {
+  return IPAddressV4::fromLongHBO((11u << 24) + ((i << 8) & 0xffffff));
+}
+
+// Routes over ECMP groups of the neighbors, 4 next hops each
+shared_ptr<RouteTableMap> makeRouteTables(
+    const shared_ptr<SwitchState>& state) {
+  RouteUpdater updater(state->getRouteTables());
+  updater.addInterfaceAndLinkLocalRoutes(state->getInterfaces());
+  auto addRoutes = [&](int numRoutes, bool v6) {
+    for (int i = 0; i < numRoutes; ++i) {
+      RouteNextHopEntry::NextHopSet nhops;
+      for (int n = 0; n < 4; ++n) {
+        auto neighbor = (i * 4 + n) % FLAGS_num_neighbors;
+        nhops.emplace(UnresolvedNextHop(
+            v6 ? IPAddress(neighborV6(neighbor))
+               : IPAddress(neighborV4(neighbor)),
+            ECMP_WEIGHT));
+      }
+      updater.addRoute(
+          RouterID(0),
+          v6 ? IPAddress(routeV6(i)) : IPAddress(routeV4(i)),
+          v6 ? 64 : 24,
+          ClientID(1),
+          RouteNextHopEntry(std::move(nhops), AdminDistance::EBGP));
+    }
+  };
+  addRoutes(FLAGS_num_routes, true);
+  addRoutes(FLAGS_num_routes / 10, false);
+  return updater.updateDone();
+}
+
+shared_ptr<AclMap> makeAcls() {
+  auto acls = make_shared<AclMap>();
+  for (int i = 0; i < FLAGS_num_acls; ++i) {
+    auto acl = make_shared<AclEntry>(i, folly::to<string>("acl", i));
+    acl->setSrcIp(IPAddress::createNetwork(
+        folly::to<string>("2401:db00:", i % 0xffff, "::/48")));
+    acl->setProto(6);
+    acl->setDstL4PortRange(AclL4PortRange(i % 1024, i % 1024, false));
+    acl->setActionType(
+        i % 2 ? cfg::AclActionType::DENY : cfg::AclActionType::PERMIT);
+    acls->addEntry(acl);
+  }
+  return acls;
+}
+
+void init() {
+  state = make_shared<SwitchState>();
+  for (int p = 1; p <= FLAGS_num_ports; ++p) {
+    state->registerPort(PortID(p), folly::to<string>("port", p));
+  }
+  state->addVlan(makeVlan());
+  state->addIntf(makeInterface());
+  state->resetRouteTables(makeRouteTables(state));
+  state->resetAcls(makeAcls());
+  state->publish();
+
+  portsJson = state->getPorts()->toFollyDynamic();
+  vlansJson = state->getVlans()->toFollyDynamic();
+  interfacesJson = state->getInterfaces()->toFollyDynamic();
+  routeTablesJson = state->getRouteTables()->toFollyDynamic();
+  aclsJson = state->getAcls()->toFollyDynamic();
+  stateJson = state->toFollyDynamic();
+  stateJsonStr = folly::toJson(stateJson);
+}
+
+template <typename NodeT>
+void serialize(size_t numIters, const shared_ptr<NodeT>& node) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(node->toFollyDynamic());
+  }
+}
+
+template <typename NodeT>
+void deserialize(size_t numIters, const folly::dynamic& json) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(NodeT::fromFollyDynamic(json));
+  }
+}
+
+void printSize(const char* name, const folly::dynamic& json) {
+  printf(
+      "%-16s %12zu bytes JSON, %12zu bytes pretty JSON\n",
+      name,
+      folly::toJson(json).size(),
+      folly::toPrettyJson(json).size());
+}
+
+} // unnamed namespace
+
+BENCHMARK(PortsToFollyDynamic, numIters) {
+  serialize(numIters, state->getPorts());
+}
+
+BENCHMARK(VlansToFollyDynamic, numIters) {
+  serialize(numIters, state->getVlans());
+}
+
+BENCHMARK(InterfacesToFollyDynamic, numIters) {
+  serialize(numIters, state->getInterfaces());
+}
+
+BENCHMARK(RouteTablesToFollyDynamic, numIters) {
+  serialize(numIters, state->getRouteTables());
+}
+
+BENCHMARK(AclsToFollyDynamic, numIters) {
+  serialize(numIters, state->getAcls());
+}
+
+BENCHMARK(SwitchStateToFollyDynamic, numIters) {
+  serialize(numIters, state);
+}
+
+BENCHMARK(SwitchStateToJson, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(folly::toJson(state->toFollyDynamic()));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(PortsFromFollyDynamic, numIters) {
+  deserialize<PortMap>(numIters, portsJson);
+}
+
+BENCHMARK(VlansFromFollyDynamic, numIters) {
+  deserialize<VlanMap>(numIters, vlansJson);
+}
+
+BENCHMARK(InterfacesFromFollyDynamic, numIters) {
+  deserialize<InterfaceMap>(numIters, interfacesJson);
+}
+
+BENCHMARK(RouteTablesFromFollyDynamic, numIters) {
+  deserialize<RouteTableMap>(numIters, routeTablesJson);
+}
+
+BENCHMARK(AclsFromFollyDynamic, numIters) {
+  deserialize<AclMap>(numIters, aclsJson);
+}
+
+BENCHMARK(SwitchStateFromFollyDynamic, numIters) {
+  deserialize<SwitchState>(numIters, stateJson);
+}
+
+BENCHMARK(SwitchStateFromJson, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(SwitchState::fromJson(stateJsonStr));
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+
+  printSize("ports", portsJson);
+  printSize("vlans", vlansJson);
+  printSize("interfaces", interfacesJson);
+  printSize("routeTables", routeTablesJson);
+  printSize("acls", aclsJson);
+  printSize("switchState", stateJson);
+  return 0;
+}
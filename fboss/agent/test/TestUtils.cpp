@@ -54,6 +54,8 @@ using ::testing::Return;
 using ::testing::NiceMock;
 
 DEFINE_bool(switch_hw, false, "Run tests for actual hw");
+DECLARE_bool(rx_dispatch_threads);
+DECLARE_bool(tx_batching);
 
 namespace facebook { namespace fboss {
 
@@ -133,9 +135,10 @@ shared_ptr<SwitchState> publishAndApplyConfig(
     shared_ptr<SwitchState>& state,
     const cfg::SwitchConfig* config,
     const Platform* platform,
-    const cfg::SwitchConfig* prevCfg) {
+    const cfg::SwitchConfig* prevCfg,
+    AppliedConfigCache* cache) {
   state->publish();
-  return applyThriftConfig(state, config, platform, prevCfg);
+  return applyThriftConfig(state, config, platform, prevCfg, cache);
 }
 
 unique_ptr<MockPlatform> createMockPlatform() {
@@ -151,6 +154,11 @@ unique_ptr<SwSwitch> createMockSw(
     const shared_ptr<SwitchState>& state,
     const folly::Optional<MacAddress>& mac,
     SwitchFlags flags) {
+  // Tests expect received packets to be handled on the thread receiving
+  // them, and sent packets to reach the mock hardware on the thread sending
+  // them, rather than later on the rx worker and packet tx threads.
+  FLAGS_rx_dispatch_threads = false;
+  FLAGS_tx_batching = false;
   auto platform = createMockPlatform();
   if (mac) {
     EXPECT_CALL(*platform.get(), getLocalMac()).WillRepeatedly(
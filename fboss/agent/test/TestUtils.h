@@ -27,6 +27,7 @@
 
 namespace facebook { namespace fboss {
 
+struct AppliedConfigCache;
 class MockHwSwitch;
 class MockPlatform;
 class MockTunManager;
@@ -57,7 +58,8 @@ std::shared_ptr<SwitchState> publishAndApplyConfig(
     std::shared_ptr<SwitchState>& state,
     const cfg::SwitchConfig* config,
     const Platform* platform,
-    const cfg::SwitchConfig* prevCfg=nullptr);
+    const cfg::SwitchConfig* prevCfg=nullptr,
+    AppliedConfigCache* cache=nullptr);
 
 /*
  * Create a SwSwitch for testing purposes, with the specified initial state.
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ThreadPlacement.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using std::set;
+
+TEST(ThreadPlacement, parseCpuList) {
+  EXPECT_EQ(
+      set<int>({0, 1, 2, 3, 8}), ThreadPlacement::parseCpuList("0-3,8\n"));
+  EXPECT_EQ(set<int>({5}), ThreadPlacement::parseCpuList("5"));
+  EXPECT_TRUE(ThreadPlacement::parseCpuList("").empty());
+  EXPECT_THROW(ThreadPlacement::parseCpuList("3-1"), FbossError);
+  EXPECT_ANY_THROW(ThreadPlacement::parseCpuList("a"));
+}
+
+TEST(ThreadPlacement, parse) {
+  auto rules = ThreadPlacement::parse(
+      "bcmRX:cpus=1,fifo=40; fbossUpdateThread:cpus=2-3,cpus=6,nice=-5;"
+      ":cpus=4-15");
+  ASSERT_EQ(3, rules.size());
+  EXPECT_EQ("bcmRX", rules[0].prefix);
+  EXPECT_EQ(set<int>({1}), rules[0].cpus);
+  EXPECT_EQ(40, rules[0].fifoPriority.value());
+  EXPECT_FALSE(rules[0].nice);
+  // Cut to what the kernel keeps of the thread name
+  EXPECT_EQ("fbossUpdateThre", rules[1].prefix);
+  EXPECT_EQ(set<int>({2, 3, 6}), rules[1].cpus);
+  EXPECT_EQ(-5, rules[1].nice.value());
+  EXPECT_FALSE(rules[1].fifoPriority);
+  EXPECT_EQ("", rules[2].prefix);
+  EXPECT_EQ(12, rules[2].cpus.size());
+
+  EXPECT_TRUE(ThreadPlacement::parse("").empty());
+  EXPECT_THROW(ThreadPlacement::parse("bcmRX"), FbossError);
+  EXPECT_THROW(ThreadPlacement::parse("bcmRX:cpu=1"), FbossError);
+  EXPECT_THROW(ThreadPlacement::parse("bcmRX:fifo=1000"), FbossError);
+}
+
+TEST(ThreadPlacement, match) {
+  ThreadPlacement placement(
+      ThreadPlacement::parse("bcmRX:cpus=1;fbossBg:cpus=2;:cpus=3"));
+  EXPECT_EQ(set<int>({1}), placement.match("bcmRX")->cpus);
+  EXPECT_EQ(set<int>({2}), placement.match("fbossBgThread")->cpus);
+  EXPECT_EQ(set<int>({3}), placement.match("ThriftIO0")->cpus);
+
+  // First match wins
+  ThreadPlacement ordered(
+      ThreadPlacement::parse("fboss:nice=1;fbossBg:nice=2"));
+  EXPECT_EQ(1, ordered.match("fbossBgThread")->nice.value());
+  EXPECT_EQ(nullptr, ordered.match("bcmRX"));
+  EXPECT_EQ(0, ThreadPlacement({}).applyToAllThreads());
+}
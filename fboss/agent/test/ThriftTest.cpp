@@ -29,6 +29,8 @@ using folly::StringPiece;
 using std::unique_ptr;
 using std::shared_ptr;
 using testing::UnorderedElementsAreArray;
+using facebook::network::thrift::Address;
+using facebook::network::toAddress;
 using facebook::network::toBinaryAddress;
 using cfg::PortSpeed;
 
@@ -300,3 +302,337 @@ TEST(ThriftTest, syncFib) {
   EXPECT_EQ(4 + 1, tables3->getRouteTable(rid)->getRibV4()->size());
   EXPECT_EQ(4 + 1, tables3->getRouteTable(rid)->getRibV6()->size());
 }
+
+TEST(ThriftTest, getRouteTablePages) {
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(2);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+  config.interfaces[0].ipAddresses[1] = "2401:db00:2110:3001::0001/64";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  std::vector<IpPrefix> clientPrefixes;
+  for (int i = 0; i < 10; ++i) {
+    auto prefix = folly::to<std::string>("7.", i, ".0.0/16");
+    handler.addUnicastRoute(10, makeUnicastRoute(prefix, "10.0.0.2"));
+    clientPrefixes.push_back(ipPrefix(folly::to<std::string>("7.", i, ".0.0"),
+                                      16));
+  }
+  for (int i = 0; i < 5; ++i) {
+    auto prefix = folly::to<std::string>("aaaa:", i, "::/64");
+    handler.addUnicastRoute(10, makeUnicastRoute(prefix, "2401:db00::2"));
+    clientPrefixes.push_back(ipPrefix(folly::to<std::string>("aaaa:", i, "::"),
+                                      64));
+  }
+
+  // Page through everything, a few routes at a time
+  std::vector<RouteDetails> allDetails;
+  handler.getRouteTableDetails(allDetails);
+  std::vector<IpPrefix> expected;
+  for (const auto& rd : allDetails) {
+    expected.push_back(rd.dest);
+  }
+  auto request = std::make_unique<RouteTablePageRequest>();
+  request->maxRoutes = 3;
+  std::vector<IpPrefix> paged;
+  while (true) {
+    RouteDetailsPage page;
+    handler.getRouteTableDetailsPage(
+        page, std::make_unique<RouteTablePageRequest>(*request));
+    EXPECT_LE(page.routes.size(), 3);
+    for (const auto& rd : page.routes) {
+      paged.push_back(rd.dest);
+    }
+    if (!page.__isset.next) {
+      break;
+    }
+    request->cursor = page.next;
+    request->__isset.cursor = true;
+  }
+  EXPECT_THAT(paged, UnorderedElementsAreArray(expected));
+  EXPECT_EQ(expected.size(), paged.size());
+
+  // Only the routes of client 10
+  request = std::make_unique<RouteTablePageRequest>();
+  request->maxRoutes = 4;
+  request->filter.clientId = 10;
+  request->filter.__isset.clientId = true;
+  paged.clear();
+  while (true) {
+    RouteTablePage page;
+    handler.getRouteTablePage(
+        page, std::make_unique<RouteTablePageRequest>(*request));
+    for (const auto& route : page.routes) {
+      paged.push_back(route.dest);
+      EXPECT_EQ(1, route.nextHops.size());
+    }
+    if (!page.__isset.next) {
+      break;
+    }
+    request->cursor = page.next;
+    request->__isset.cursor = true;
+  }
+  EXPECT_THAT(paged, UnorderedElementsAreArray(clientPrefixes));
+
+  // Only the routes within 7.0.0.0/8, all fitting in one page
+  request = std::make_unique<RouteTablePageRequest>();
+  request->filter.prefix = ipPrefix("7.0.0.0", 8);
+  request->filter.__isset.prefix = true;
+  RouteDetailsPage page;
+  handler.getRouteTableDetailsPage(
+      page, std::make_unique<RouteTablePageRequest>(*request));
+  EXPECT_EQ(10, page.routes.size());
+  EXPECT_FALSE(page.__isset.next);
+
+  request->maxRoutes = 0;
+  EXPECT_THROW(
+      handler.getRouteTableDetailsPage(
+          page, std::make_unique<RouteTablePageRequest>(*request)),
+      FbossError);
+}
+
+TEST(ThriftTest, getIpRoutes) {
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(2);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+  config.interfaces[0].ipAddresses[1] = "2401:db00:2110:3001::0001/64";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  handler.addUnicastRoute(10, makeUnicastRoute("7.0.0.0/8", "10.0.0.2"));
+  handler.addUnicastRoute(10, makeUnicastRoute("7.1.0.0/16", "10.0.0.3"));
+  handler.addUnicastRoute(10, makeUnicastRoute("aaaa::/64", "2401:db00::2"));
+
+  // Enough addresses of each family for a lookup table to be built, and
+  // some with no route at all
+  auto addrs = std::make_unique<std::vector<Address>>();
+  for (int i = 0; i < 100; ++i) {
+    addrs->push_back(toAddress(
+        IPAddress(folly::to<std::string>("7.", i % 3, ".0.", i))));
+    addrs->push_back(toAddress(
+        IPAddress(folly::to<std::string>("aaaa:0:0:", i % 2, "::1"))));
+  }
+  auto expectMatches = [&]() {
+    std::vector<UnicastRoute> routes;
+    std::vector<RouteDetails> details;
+    handler.getIpRoutes(
+        routes, std::make_unique<std::vector<Address>>(*addrs), 0);
+    handler.getIpRoutesDetails(
+        details, std::make_unique<std::vector<Address>>(*addrs), 0);
+    ASSERT_EQ(addrs->size(), routes.size());
+    ASSERT_EQ(addrs->size(), details.size());
+    for (size_t i = 0; i < addrs->size(); ++i) {
+      UnicastRoute route;
+      handler.getIpRoute(route, std::make_unique<Address>((*addrs)[i]), 0);
+      EXPECT_EQ(route.dest, routes[i].dest);
+      EXPECT_EQ(route.nextHopAddrs, routes[i].nextHopAddrs);
+      RouteDetails detail;
+      handler.getIpRouteDetails(
+          detail, std::make_unique<Address>((*addrs)[i]), 0);
+      EXPECT_EQ(detail.dest, details[i].dest);
+    }
+  };
+  expectMatches();
+  std::vector<UnicastRoute> routes;
+  handler.getIpRoutes(
+      routes, std::make_unique<std::vector<Address>>(*addrs), 0);
+  EXPECT_EQ(ipPrefix("7.0.0.0", 8), routes[0].dest);
+  EXPECT_EQ(ipPrefix("7.1.0.0", 16), routes[2].dest);
+  EXPECT_EQ(ipPrefix("aaaa::", 64), routes[1].dest);
+  EXPECT_EQ(ipPrefix("::0", 0), routes[3].dest);
+
+  // Lookups see route changes made since the last batch
+  handler.addUnicastRoute(10, makeUnicastRoute("7.2.0.0/16", "10.0.0.2"));
+  expectMatches();
+  routes.clear();
+  handler.getIpRoutes(
+      routes, std::make_unique<std::vector<Address>>(*addrs), 0);
+  EXPECT_EQ(ipPrefix("7.2.0.0", 16), routes[4].dest);
+
+  EXPECT_THROW(
+      handler.getIpRoutes(
+          routes, std::make_unique<std::vector<Address>>(*addrs), 1),
+      FbossError);
+}
+
+TEST(ThriftTest, enqueueRouteUpdates) {
+  RouterID rid = RouterID(0);
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  // Batches from two clients, and a delete of one of the routes
+  auto routes = std::make_unique<std::vector<UnicastRoute>>();
+  routes->push_back(*makeUnicastRoute("7.1.0.0/16", "10.0.0.2"));
+  routes->push_back(*makeUnicastRoute("7.2.0.0/16", "10.0.0.2"));
+  auto seq1 = handler.enqueueAddUnicastRoutes(10, std::move(routes));
+  routes = std::make_unique<std::vector<UnicastRoute>>();
+  routes->push_back(*makeUnicastRoute("7.3.0.0/16", "10.0.0.3"));
+  auto seq2 = handler.enqueueAddUnicastRoutes(20, std::move(routes));
+  auto prefixes = std::make_unique<std::vector<IpPrefix>>();
+  prefixes->push_back(ipPrefix("7.2.0.0", 16));
+  auto seq3 = handler.enqueueDeleteUnicastRoutes(10, std::move(prefixes));
+  EXPECT_LT(seq1, seq2);
+  EXPECT_LT(seq2, seq3);
+
+  EXPECT_TRUE(handler.waitForRouteUpdates(seq3, 10000));
+  auto tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, "7.1.0.0/16");
+  GET_ROUTE_V4(tables, rid, "7.3.0.0/16");
+  EXPECT_NO_ROUTE(tables, rid, "7.2.0.0/16");
+
+  // Batches which were never queued can't be waited for
+  EXPECT_THROW(handler.waitForRouteUpdates(seq3 + 1, 0), FbossError);
+}
+
+TEST(ThriftTest, clientGracefulRestart) {
+  RouterID rid = RouterID(0);
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  handler.addUnicastRoute(10, makeUnicastRoute("7.1.0.0/16", "10.0.0.2"));
+  handler.addUnicastRoute(10, makeUnicastRoute("7.2.0.0/16", "10.0.0.2"));
+  handler.addUnicastRoute(10, makeUnicastRoute("aaaa:1::0/64", "11:11::0"));
+  handler.addUnicastRoute(20, makeUnicastRoute("7.4.0.0/16", "10.0.0.4"));
+
+  // Client 10 restarts, and only re-advertises some of its routes
+  EXPECT_EQ(3, handler.beginGracefulRestart(10));
+  handler.addUnicastRoute(10, makeUnicastRoute("7.1.0.0/16", "10.0.0.3"));
+  handler.addUnicastRoute(10, makeUnicastRoute("7.3.0.0/16", "10.0.0.3"));
+  // Its stale routes are still there until the end of RIB
+  auto tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, "7.2.0.0/16");
+  GET_ROUTE_V6(tables, rid, "aaaa:1::0/64");
+
+  EXPECT_EQ(2, handler.endOfRib(10));
+  tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, "7.1.0.0/16");
+  GET_ROUTE_V4(tables, rid, "7.3.0.0/16");
+  GET_ROUTE_V4(tables, rid, "7.4.0.0/16");
+  EXPECT_NO_ROUTE(tables, rid, "7.2.0.0/16");
+  EXPECT_NO_ROUTE(tables, rid, "aaaa:1::0/64");
+
+  // An end of RIB without a restart deletes nothing
+  EXPECT_EQ(0, handler.endOfRib(10));
+  tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, "7.1.0.0/16");
+}
+
+TEST(ThriftTest, getL2TablePages) {
+  cfg::SwitchConfig config;
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  ThriftHandler handler(sw);
+
+  std::vector<L2EntryThrift> l2Table;
+  for (int i = 0; i < 10; ++i) {
+    L2EntryThrift entry;
+    entry.mac = folly::to<std::string>("02:00:00:00:00:0", i);
+    entry.port = i % 2 + 1;
+    entry.vlanID = 1;
+    l2Table.push_back(entry);
+  }
+  EXPECT_CALL(*getMockHw(sw), fetchL2Table(testing::_))
+      .WillRepeatedly(testing::Invoke(
+          [&](std::vector<L2EntryThrift>* entries) { *entries = l2Table; }));
+
+  // Page through the entries of port 2, a few at a time
+  auto request = std::make_unique<L2TablePageRequest>();
+  request->filter.port = 2;
+  request->filter.__isset.port = true;
+  request->maxEntries = 2;
+  std::vector<std::string> paged;
+  while (true) {
+    L2TablePage page;
+    handler.getL2TablePage(
+        page, std::make_unique<L2TablePageRequest>(*request));
+    EXPECT_LE(page.entries.size(), 2);
+    for (const auto& entry : page.entries) {
+      EXPECT_EQ(2, entry.port);
+      paged.push_back(entry.mac);
+    }
+    if (!page.__isset.next) {
+      break;
+    }
+    request->cursor = page.next;
+    request->__isset.cursor = true;
+  }
+  std::vector<std::string> expected;
+  for (int i = 1; i < 10; i += 2) {
+    expected.push_back(folly::to<std::string>("02:00:00:00:00:0", i));
+  }
+  EXPECT_EQ(expected, paged);
+
+  // Everything in one page, and a VLAN with no entries
+  request = std::make_unique<L2TablePageRequest>();
+  L2TablePage page;
+  handler.getL2TablePage(page, std::make_unique<L2TablePageRequest>(*request));
+  EXPECT_EQ(10, page.entries.size());
+  EXPECT_FALSE(page.__isset.next);
+  request->filter.vlanID = 2;
+  request->filter.__isset.vlanID = true;
+  page = L2TablePage();
+  handler.getL2TablePage(page, std::make_unique<L2TablePageRequest>(*request));
+  EXPECT_TRUE(page.entries.empty());
+  EXPECT_FALSE(page.__isset.next);
+
+  request->maxEntries = 0;
+  EXPECT_THROW(
+      handler.getL2TablePage(
+          page, std::make_unique<L2TablePageRequest>(*request)),
+      FbossError);
+}
@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/TxPacketBatcher.h"
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBase.h>
+
+#include "fboss/agent/hw/mock/MockTxPacket.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::Optional;
+
+namespace {
+
+struct Flush {
+  PortID port;
+  Optional<uint8_t> cos;
+  // Packets are told apart by their length
+  std::vector<size_t> lengths;
+};
+
+TxPacketBatcher::FlushHandler recordFlushes(std::vector<Flush>* flushes) {
+  return [flushes](
+             PortID port,
+             Optional<uint8_t> cos,
+             std::vector<std::unique_ptr<TxPacket>> pkts,
+             TxPacketBatcher::TimePoint /*oldestQueued*/) {
+    Flush flush{port, cos, {}};
+    for (const auto& pkt : pkts) {
+      flush.lengths.push_back(pkt->buf()->length());
+    }
+    flushes->push_back(flush);
+  };
+}
+
+std::unique_ptr<TxPacket> makePacket(uint32_t length) {
+  return std::make_unique<MockTxPacket>(length);
+}
+
+} // unnamed namespace
+
+TEST(TxPacketBatcher, batchesPerPortAndCos) {
+  folly::EventBase evb;
+  std::vector<Flush> flushes;
+  TxPacketBatcher batcher(&evb, recordFlushes(&flushes), 64);
+  batcher.start();
+
+  batcher.send(makePacket(60), PortID(1), folly::none);
+  batcher.send(makePacket(61), PortID(2), uint8_t(7));
+  batcher.send(makePacket(62), PortID(1), folly::none);
+  batcher.send(makePacket(63), PortID(1), uint8_t(7));
+  batcher.send(makePacket(64), PortID(2), uint8_t(7));
+  // Nothing is sent until the event base gets to run
+  EXPECT_TRUE(flushes.empty());
+
+  evb.loopOnce();
+  ASSERT_EQ(3, flushes.size());
+  EXPECT_EQ(PortID(1), flushes[0].port);
+  EXPECT_FALSE(flushes[0].cos.hasValue());
+  EXPECT_EQ(std::vector<size_t>({60, 62}), flushes[0].lengths);
+  EXPECT_EQ(PortID(1), flushes[1].port);
+  EXPECT_EQ(7, flushes[1].cos.value());
+  EXPECT_EQ(std::vector<size_t>({63}), flushes[1].lengths);
+  EXPECT_EQ(PortID(2), flushes[2].port);
+  EXPECT_EQ(7, flushes[2].cos.value());
+  EXPECT_EQ(std::vector<size_t>({61, 64}), flushes[2].lengths);
+  batcher.stop();
+}
+
+TEST(TxPacketBatcher, flushesFullBatchRightAway) {
+  folly::EventBase evb;
+  std::vector<Flush> flushes;
+  TxPacketBatcher batcher(&evb, recordFlushes(&flushes), 3);
+  batcher.start();
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    batcher.send(makePacket(60 + i), PortID(1), folly::none);
+  }
+  ASSERT_EQ(1, flushes.size());
+  EXPECT_EQ(std::vector<size_t>({60, 61, 62}), flushes[0].lengths);
+
+  // stop() flushes the rest
+  batcher.stop();
+  ASSERT_EQ(2, flushes.size());
+  EXPECT_EQ(std::vector<size_t>({63}), flushes[1].lengths);
+
+  // The flush scheduled before stop() has nothing left to do
+  evb.loopOnce();
+  EXPECT_EQ(2, flushes.size());
+}
+
+TEST(TxPacketBatcher, sendsDirectlyWhenStopped) {
+  folly::EventBase evb;
+  std::vector<Flush> flushes;
+  TxPacketBatcher batcher(&evb, recordFlushes(&flushes), 64);
+
+  batcher.send(makePacket(60), PortID(1), folly::none);
+  batcher.send(makePacket(61), PortID(1), folly::none);
+  ASSERT_EQ(2, flushes.size());
+  EXPECT_EQ(std::vector<size_t>({60}), flushes[0].lengths);
+  EXPECT_EQ(std::vector<size_t>({61}), flushes[1].lengths);
+}
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CppWrapper.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace {
+const char* const kPreamble = R"(// Generated by HeaderToThrift --cpp-wrappers, do not edit.
+#pragma once
+
+#include <type_traits>
+)";
+
+const char* const kTracing = R"(
+#ifdef BCM_WRAPPER_TRACING
+#include <chrono>
+#endif
+
+namespace facebook { namespace fboss { namespace bcm_wrapper {
+
+#ifdef BCM_WRAPPER_TRACING
+// Called after every SDK call made through the wrappers
+void callTraced(const char* function, std::chrono::nanoseconds duration);
+
+class CallTimer {
+ public:
+  explicit CallTimer(const char* function)
+      : function_(function), start_(std::chrono::steady_clock::now()) {}
+  ~CallTimer() {
+    callTraced(function_, std::chrono::steady_clock::now() - start_);
+  }
+ private:
+  const char* function_;
+  std::chrono::steady_clock::time_point start_;
+};
+#endif
+)";
+} // namespace
+
+namespace facebook { namespace fboss {
+
+CppWrapperFunction::CppWrapperFunction(const clang::FunctionDecl& function) {
+  if (function.isVariadic()) {
+    throw std::runtime_error("can't forward a variadic function");
+  }
+  auto rt = function.getReturnType();
+  if (rt->isFunctionPointerType() || rt->isArrayType()) {
+    throw std::runtime_error("can't spell the return type of the function");
+  }
+  name = function.getName().str();
+  returnType_ = rt.getAsString();
+  functionType_ = function.getType().getAsString();
+
+  clang::PrintingPolicy policy(function.getASTContext().getLangOpts());
+  int i = 0;
+  for (const clang::ParmVarDecl* param : function.parameters()) {
+    auto paramName = param->getName().str();
+    if (paramName.empty()) {
+      paramName = folly::sformat("arg{}", i);
+    }
+    // Printing the type with the name declares function pointer and array
+    // parameters properly too
+    std::string parameter;
+    llvm::raw_string_ostream os(parameter);
+    param->getType().print(os, policy, paramName);
+    parameters_.push_back(os.str());
+    arguments_.push_back(paramName);
+    ++i;
+  }
+}
+
+std::string CppWrapperFunction::getCpp() const {
+  std::stringstream ss;
+  ss << "static_assert(\n"
+     << "    std::is_same<decltype(::" << name << "), " << functionType_
+     << ">::value,\n"
+     << "    \"" << name << " doesn't match its generated wrapper\");\n";
+  ss << "inline " << returnType_ << " " << name << "("
+     << folly::join(", ", parameters_) << ") {\n";
+  ss << "#ifdef BCM_WRAPPER_TRACING\n"
+     << "  CallTimer timer(\"" << name << "\");\n"
+     << "#endif\n";
+  ss << "  return ::" << name << "(" << folly::join(", ", arguments_)
+     << ");\n";
+  ss << "}";
+  return ss.str();
+}
+
+void CppWrapperFile::addFunction(
+    std::unique_ptr<CppWrapperFunction> function) {
+  functions_.push_back(std::move(function));
+}
+
+std::string CppWrapperFile::getCpp(
+    const std::vector<std::string>& includes) const {
+  std::stringstream ss;
+  ss << kPreamble;
+  if (!includes.empty()) {
+    ss << "\nextern \"C\" {\n";
+    for (const auto& include : includes) {
+      ss << "#include \"" << include << "\"\n";
+    }
+    ss << "}\n";
+  }
+  ss << kTracing;
+  for (const auto& function : functions_) {
+    ss << "\n" << function->getCpp() << "\n";
+  }
+  ss << "\n}}} // facebook::fboss::bcm_wrapper\n";
+  return ss.str();
+}
+
+}} // facebook::fboss
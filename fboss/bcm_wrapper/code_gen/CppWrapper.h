@@ -0,0 +1,64 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <clang/Tooling/Tooling.h>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Represents an inline C++ shim forwarding to one SDK function. The shim has
+ * the same name, parameter and return types as the SDK function, spelled as
+ * clang prints them, so calling it compiles down to calling the SDK directly.
+ *
+ * The generated code also static_asserts that the SDK function still has the
+ * type seen when generating, so the shims can't silently drift from the SDK
+ * headers they are compiled against.
+ *
+ * When BCM_WRAPPER_TRACING is defined, each call is timed and reported
+ * through bcm_wrapper::callTraced(), see CppWrapperFile.
+ */
+class CppWrapperFunction {
+ public:
+  explicit CppWrapperFunction(const clang::FunctionDecl& function);
+  std::string getCpp() const;
+  std::string name;
+ private:
+  std::string returnType_;
+  // The type of the function itself, eg "int (int, foo_t *)"
+  std::string functionType_;
+  // Each parameter declared with its name, eg "foo_t *info"
+  std::vector<std::string> parameters_;
+  std::vector<std::string> arguments_;
+};
+
+/*
+ * Represents the generated header of shims. It includes the SDK headers the
+ * functions were parsed from, and declares the tracing hook used when
+ * BCM_WRAPPER_TRACING is defined:
+ *
+ *   void bcm_wrapper::callTraced(const char* function,
+ *                                std::chrono::nanoseconds duration);
+ *
+ * which the binary compiled with tracing has to define.
+ */
+class CppWrapperFile {
+ public:
+  void addFunction(std::unique_ptr<CppWrapperFunction> function);
+  std::string getCpp(const std::vector<std::string>& includes) const;
+ private:
+  std::vector<std::unique_ptr<CppWrapperFunction>> functions_;
+};
+
+}} // facebook::fboss
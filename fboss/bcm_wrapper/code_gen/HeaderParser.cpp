@@ -34,7 +34,8 @@ HeaderParser::functionDeclMatcher() {
 }
 
 HeaderParser::HeaderParser()
-    : file_(std::make_unique<ThriftFile>("BcmWrapper")) {}
+    : file_(std::make_unique<ThriftFile>("BcmWrapper")),
+      wrappers_(std::make_unique<CppWrapperFile>()) {}
 
 void HeaderParser::run(
     const clang::ast_matchers::MatchFinder::MatchResult& result) {
@@ -59,6 +60,12 @@ void HeaderParser::run(
   const clang::FunctionDecl* fd =
       result.Nodes.getNodeAs<clang::FunctionDecl>("fd");
   if (fd) {
+    // Functions we can't express in thrift can usually still be wrapped
+    try {
+      wrappers_->addFunction(std::make_unique<CppWrapperFunction>(*fd));
+    } catch (const std::exception& e) {
+      // Left for the callers to make directly, eg variadic functions
+    }
     try {
       auto tm = std::make_unique<ThriftMethod>(*fd);
       auto ts = std::make_unique<ThriftStruct>(*fd);
@@ -79,4 +86,9 @@ std::string HeaderParser::getThrift() const {
   return file_->getThrift();
 };
 
+std::string HeaderParser::getCppWrappers(
+    const std::vector<std::string>& includes) const {
+  return wrappers_->getCpp(includes);
+}
+
 }} // facebook::fboss
@@ -12,12 +12,14 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/Tooling.h>
 
+#include "CppWrapper.h"
 #include "ThriftIDL.h"
 
 namespace facebook { namespace fboss {
@@ -29,7 +31,8 @@ namespace facebook { namespace fboss {
  *
  * As we visit those declarations, we populate objects which represent ThrifIDL
  * objects corresponding to those declarations which we can finally use to
- * output thrift corresponding to the processed header file.
+ * output thrift corresponding to the processed header file. Functions also
+ * get an inline C++ wrapper, for the header returned by getCppWrappers().
  */
 class HeaderParser : public clang::ast_matchers::MatchFinder::MatchCallback {
  public:
@@ -44,11 +47,15 @@ class HeaderParser : public clang::ast_matchers::MatchFinder::MatchCallback {
   static const clang::ast_matchers::DeclarationMatcher& functionDeclMatcher();
   // return the the thrift code we have generated while processing the header
   std::string getThrift() const;
+  // return the header of C++ wrappers for the functions we have seen, which
+  // includes the given SDK headers
+  std::string getCppWrappers(const std::vector<std::string>& includes) const;
  private:
   // These will store the generated Thrift IDL objects we parse as we go.
   // We need to store because functions will result in methods (the function
   // itself) and structs (the return type) so we have to write out the file
   // at the end rather than as we go.
   std::unique_ptr<ThriftFile> file_;
+  std::unique_ptr<CppWrapperFile> wrappers_;
 };
 }} // facebook::fboss
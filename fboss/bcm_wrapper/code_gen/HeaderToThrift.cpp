@@ -17,6 +17,12 @@ static llvm::cl::extrahelp commonHelp(
     clang::tooling::CommonOptionsParser::HelpMessage);
 static llvm::cl::OptionCategory headerToThriftCategory(
     "HeaderToThrift options");
+static llvm::cl::opt<bool> cppWrappers(
+    "cpp-wrappers",
+    llvm::cl::desc(
+        "Output a header of inline C++ wrappers for the functions, rather "
+        "than thrift"),
+    llvm::cl::cat(headerToThriftCategory));
 
 int main(int argc, char **argv) {
   clang::tooling::CommonOptionsParser optionsParser(
@@ -29,5 +35,9 @@ int main(int argc, char **argv) {
   mf.addMatcher(facebook::fboss::HeaderParser::enumDeclMatcher(), &hp);
   mf.addMatcher(facebook::fboss::HeaderParser::functionDeclMatcher(), &hp);
   tool.run(clang::tooling::newFrontendActionFactory(&mf).get());
-  llvm::outs() << hp.getThrift() << "\n";
+  if (cppWrappers) {
+    llvm::outs() << hp.getCppWrappers(optionsParser.getSourcePathList());
+  } else {
+    llvm::outs() << hp.getThrift() << "\n";
+  }
 }
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <clang/Tooling/Tooling.h>
+#include <gtest/gtest.h>
+
+#include "fboss/bcm_wrapper/code_gen/HeaderParser.h"
+
+class CppWrapperGenTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    mf_.addMatcher(facebook::fboss::HeaderParser::functionDeclMatcher(), &hp_);
+  }
+  // given some c source code, generate the corresponding wrappers
+  std::string genCpp(const std::string& source) {
+    clang::tooling::runToolOnCode(
+        clang::tooling::newFrontendActionFactory(&mf_).get()->create(),
+        source,
+        "lol.h");
+    return hp_.getCppWrappers({"lol.h"});
+  }
+  static bool contains(const std::string& s, const std::string& part) {
+    return s.find(part) != std::string::npos;
+  }
+ private:
+  facebook::fboss::HeaderParser hp_;
+  clang::ast_matchers::MatchFinder mf_;
+};
+
+TEST_F(CppWrapperGenTest, SimpleFunction) {
+  auto actual = genCpp("int foo(int x);");
+  EXPECT_TRUE(contains(actual, "#include \"lol.h\"\n"));
+  EXPECT_TRUE(contains(actual, "std::is_same<decltype(::foo), int (int)>"));
+  EXPECT_TRUE(contains(actual, "inline int foo(int x) {\n"));
+  EXPECT_TRUE(contains(actual, "  CallTimer timer(\"foo\");\n"));
+  EXPECT_TRUE(contains(actual, "  return ::foo(x);\n"));
+}
+
+TEST_F(CppWrapperGenTest, PointerParameterFunction) {
+  auto actual = genCpp("void foo(int *x, int y);");
+  EXPECT_TRUE(contains(actual, "inline void foo(int *x, int y) {\n"));
+  EXPECT_TRUE(contains(actual, "  return ::foo(x, y);\n"));
+}
+
+TEST_F(CppWrapperGenTest, FunctionPointerParameterFunction) {
+  // Can't be expressed in thrift, but can still be forwarded
+  auto actual = genCpp("int foo(int (*fn)(int));");
+  EXPECT_TRUE(contains(actual, "inline int foo(int (*fn)(int)) {\n"));
+  EXPECT_TRUE(contains(actual, "  return ::foo(fn);\n"));
+}
+
+TEST_F(CppWrapperGenTest, UnnamedParameterFunction) {
+  auto actual = genCpp("int foo(int, int);");
+  EXPECT_TRUE(contains(actual, "inline int foo(int arg0, int arg1) {\n"));
+  EXPECT_TRUE(contains(actual, "  return ::foo(arg0, arg1);\n"));
+}
+
+TEST_F(CppWrapperGenTest, VariadicFunction) {
+  auto actual = genCpp("int foo(int x, ...);");
+  EXPECT_FALSE(contains(actual, "foo("));
+}
@@ -0,0 +1,274 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <folly/Optional.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
+#include <glog/logging.h>
+
+namespace facebook { namespace network {
+
+/*
+ * ConcurrentRadixTree is a radix tree for longest match lookups from many
+ * threads, e.g. packet handlers consulting a software FIB, while a writer
+ * keeps it current.
+ *
+ * RadixTree is mutated in place and relies on the SwitchState cloning it
+ * before each change. Instead ConcurrentRadixTree never modifies a node
+ * reachable by readers: an update copies only the path from the root to
+ * the node it changes (at most one node per address bit), shares every
+ * other node with the previous version, and publishes the new root with a
+ * single atomic store. Readers load the root once and then walk immutable
+ * nodes through plain pointers, so a lookup never takes a lock or retries,
+ * however busy the writer is, and always sees one consistent version.
+ *
+ * Reclamation is deferred as with RCU: the root a reader loaded keeps the
+ * whole version it sees alive, and the nodes an update replaced are freed
+ * once the last reader that could reach them is done. Use snapshot() to do
+ * several lookups against the same version.
+ *
+ * Updates are serialized on an internal mutex, and are meant to be rare
+ * compared to lookups.
+ */
+template <typename IPADDRTYPE, typename T>
+class ConcurrentRadixTree {
+  struct Node {
+    Node(const IPADDRTYPE& ip, uint8_t len) : ipAddress(ip), masklen(len) {}
+
+    IPADDRTYPE ipAddress;
+    uint8_t masklen;
+    // Unset on the internal nodes joining two subtrees
+    folly::Optional<T> value;
+    std::shared_ptr<const Node> left;
+    std::shared_ptr<const Node> right;
+  };
+  using NodePtr = std::shared_ptr<const Node>;
+
+ public:
+  /*
+   * One version of the tree, which stays valid and unchanged however the
+   * tree is updated afterwards.
+   */
+  class Snapshot {
+   public:
+    // The value of the longest prefix holding ipaddr/masklen, nullptr if
+    // there is none. Valid as long as the snapshot is.
+    const T* longestMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) const {
+      const T* match = nullptr;
+      auto toMatch = ipaddr.mask(masklen);
+      for (auto node = root_.get(); node && holds(*node, toMatch, masklen);) {
+        if (node->value) {
+          match = node->value.get_pointer();
+        }
+        if (node->masklen == masklen) {
+          break;
+        }
+        node = child(*node, toMatch).get();
+      }
+      return match;
+    }
+
+    // The value of ipaddr/masklen itself, nullptr if it is not in the tree
+    const T* exactMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) const {
+      auto toMatch = ipaddr.mask(masklen);
+      for (auto node = root_.get(); node && holds(*node, toMatch, masklen);) {
+        if (node->masklen == masklen) {
+          return node->value.get_pointer();
+        }
+        node = child(*node, toMatch).get();
+      }
+      return nullptr;
+    }
+
+    bool empty() const {
+      return !root_;
+    }
+
+   private:
+    friend class ConcurrentRadixTree;
+    explicit Snapshot(NodePtr root) : root_(std::move(root)) {}
+
+    NodePtr root_;
+  };
+
+  ConcurrentRadixTree() {}
+  ConcurrentRadixTree(const ConcurrentRadixTree&) = delete;
+  ConcurrentRadixTree& operator=(const ConcurrentRadixTree&) = delete;
+
+  Snapshot snapshot() const {
+    return Snapshot(root_.load(std::memory_order_acquire));
+  }
+
+  // Copy of the value of the longest prefix holding ipaddr/masklen
+  folly::Optional<T> longestMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const {
+    auto snap = snapshot();
+    auto match = snap.longestMatch(ipaddr, masklen);
+    return match ? folly::Optional<T>(*match) : folly::none;
+  }
+
+  // Copy of the value of ipaddr/masklen
+  folly::Optional<T> exactMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const {
+    auto snap = snapshot();
+    auto match = snap.exactMatch(ipaddr, masklen);
+    return match ? folly::Optional<T>(*match) : folly::none;
+  }
+
+  /*
+   * Add ipaddr/masklen, or replace its value if it is already in the tree.
+   * Returns whether the prefix was added.
+   */
+  bool insertOrAssign(const IPADDRTYPE& ipaddr, uint8_t masklen, T value) {
+    std::lock_guard<std::mutex> guard(writeMutex_);
+    auto inserted = false;
+    auto root = root_.load(std::memory_order_relaxed);
+    root_.store(
+        insertImpl(root, ipaddr.mask(masklen), masklen, std::move(value),
+          &inserted),
+        std::memory_order_release);
+    if (inserted) {
+      size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return inserted;
+  }
+
+  // Remove ipaddr/masklen, returns false if it was not in the tree
+  bool erase(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    std::lock_guard<std::mutex> guard(writeMutex_);
+    auto erased = false;
+    auto root = root_.load(std::memory_order_relaxed);
+    auto newRoot = eraseImpl(root, ipaddr.mask(masklen), masklen, &erased);
+    if (erased) {
+      root_.store(std::move(newRoot), std::memory_order_release);
+      size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return erased;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> guard(writeMutex_);
+    root_.store(nullptr, std::memory_order_release);
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+  // Number of prefixes in the latest version
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Whether node is ip/masklen or one of its less specific prefixes
+  static bool holds(const Node& node, const IPADDRTYPE& ip, uint8_t masklen) {
+    return node.masklen <= masklen && ip.mask(node.masklen) == node.ipAddress;
+  }
+
+  // The child of node towards ip, which node must hold
+  static const NodePtr& child(const Node& node, const IPADDRTYPE& ip) {
+    return ip.getNthMSBit(node.masklen) ? node.right : node.left;
+  }
+
+  static std::shared_ptr<Node> copyNode(const Node& node) {
+    return std::make_shared<Node>(node);
+  }
+
+  // node with child replaced by newChild, the subtree towards ip
+  static std::shared_ptr<Node> withChild(const Node& node,
+      const IPADDRTYPE& ip, NodePtr newChild) {
+    auto copy = copyNode(node);
+    if (ip.getNthMSBit(node.masklen)) {
+      copy->right = std::move(newChild);
+    } else {
+      copy->left = std::move(newChild);
+    }
+    return copy;
+  }
+
+  // An internal node over two subtrees, neither of which holds the other
+  static NodePtr join(NodePtr a, NodePtr b) {
+    auto prefix = IPADDRTYPE::longestCommonPrefix(
+        {a->ipAddress, a->masklen}, {b->ipAddress, b->masklen});
+    auto node = std::make_shared<Node>(prefix.first, prefix.second);
+    if (a->ipAddress.getNthMSBit(prefix.second)) {
+      std::swap(a, b);
+    }
+    node->left = std::move(a);
+    node->right = std::move(b);
+    return node;
+  }
+
+  // The subtree of node with ip/masklen set to value, copying the path
+  static NodePtr insertImpl(const NodePtr& node, const IPADDRTYPE& ip,
+      uint8_t masklen, T value, bool* inserted) {
+    if (!node || !holds(*node, ip, masklen)) {
+      auto newNode = std::make_shared<Node>(ip, masklen);
+      newNode->value = std::move(value);
+      *inserted = true;
+      if (!node) {
+        return newNode;
+      }
+      if (holds(*newNode, node->ipAddress, node->masklen)) {
+        // The new prefix goes between node and its parent
+        return withChild(*newNode, node->ipAddress, node);
+      }
+      return join(std::move(newNode), node);
+    }
+    if (node->masklen == masklen) {
+      *inserted = !node->value;
+      auto copy = copyNode(*node);
+      copy->value = std::move(value);
+      return copy;
+    }
+    return withChild(*node, ip,
+        insertImpl(child(*node, ip), ip, masklen, std::move(value), inserted));
+  }
+
+  // The subtree of node without ip/masklen, node itself if it is not there
+  static NodePtr eraseImpl(const NodePtr& node, const IPADDRTYPE& ip,
+      uint8_t masklen, bool* erased) {
+    if (!node || !holds(*node, ip, masklen)) {
+      return node;
+    }
+    NodePtr left = node->left;
+    NodePtr right = node->right;
+    if (node->masklen == masklen) {
+      if (!node->value) {
+        return node;
+      }
+      *erased = true;
+    } else {
+      auto& toChange = ip.getNthMSBit(node->masklen) ? right : left;
+      auto newChild = eraseImpl(toChange, ip, masklen, erased);
+      if (!*erased) {
+        return node;
+      }
+      toChange = std::move(newChild);
+      if (node->value) {
+        auto copy = copyNode(*node);
+        copy->left = std::move(left);
+        copy->right = std::move(right);
+        return copy;
+      }
+    }
+    // node is going away, or is an internal node that lost a child: keep it
+    // only if it still joins two subtrees
+    if (left && right) {
+      auto copy = std::make_shared<Node>(node->ipAddress, node->masklen);
+      copy->left = std::move(left);
+      copy->right = std::move(right);
+      return copy;
+    }
+    return left ? left : right;
+  }
+
+  folly::atomic_shared_ptr<const Node> root_;
+  std::atomic<size_t> size_{0};
+  std::mutex writeMutex_;
+};
+
+}} // facebook::network
@@ -0,0 +1,173 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+#ifndef MULTIBIT_TRIE_H
+#error "This should only be included by MultibitTrie.h"
+#endif
+
+#include <algorithm>
+
+namespace facebook { namespace network {
+
+template <typename IPADDRTYPE, typename T>
+constexpr uint8_t MultibitTrie<IPADDRTYPE, T>::kStride;
+template <typename IPADDRTYPE, typename T>
+constexpr size_t MultibitTrie<IPADDRTYPE, T>::kSlots;
+template <typename IPADDRTYPE, typename T>
+constexpr size_t MultibitTrie<IPADDRTYPE, T>::kLevels;
+
+template <typename IPADDRTYPE, typename T>
+template <typename VALUE>
+std::pair<typename MultibitTrie<IPADDRTYPE, T>::Iterator, bool>
+MultibitTrie<IPADDRTYPE, T>::insert(const IPADDRTYPE& ipaddr,
+    uint8_t masklen, VALUE&& value) {
+  CHECK_LE(masklen, IPADDRTYPE::bitCount());
+  auto ret = prefixes_.emplace(Key(ipaddr.mask(masklen), masklen),
+      std::forward<VALUE>(value));
+  if (ret.second) {
+    addToTrie(ret.first);
+  }
+  return std::make_pair(makeItr(ret.first), ret.second);
+}
+
+template <typename IPADDRTYPE, typename T>
+bool MultibitTrie<IPADDRTYPE, T>::erase(Iterator itr) {
+  if (itr.atEnd()) {
+    return false;
+  }
+  auto prefix = itr.mapIterator();
+  auto removeRoot = eraseFromTrie(root_.get(), 0, prefix);
+  if (removeRoot) {
+    root_.reset();
+  }
+  prefixes_.erase(prefix);
+  return true;
+}
+
+template <typename IPADDRTYPE, typename T>
+typename MultibitTrie<IPADDRTYPE, T>::ConstIterator
+MultibitTrie<IPADDRTYPE, T>::longestMatch(const IPADDRTYPE& ipaddr,
+    uint8_t masklen) const {
+  const Leaf* best = nullptr;
+  const Node* node = root_.get();
+  for (size_t level = 0; node && level < kLevels; ++level) {
+    auto slot = ipaddr.getNthMSByte(level);
+    if ((level + 1) * kStride > masklen) {
+      // Some prefixes ending in this node may be longer than masklen, so the
+      // expanded slots can't be used. Check the prefixes ending here directly.
+      const MapIter* match = nullptr;
+      for (const auto& prefix : node->prefixes) {
+        auto len = prefix->first.second;
+        if (len <= masklen && (!match || len > (*match)->first.second) &&
+            ipaddr.mask(len) == prefix->first.first) {
+          match = &prefix;
+        }
+      }
+      if (match) {
+        return makeCItr(*match);
+      }
+      break;
+    }
+    if (auto l = leaf(node, slot)) {
+      best = l;
+    }
+    node = child(node, slot);
+  }
+  return best ? makeCItr(best->prefix) : end();
+}
+
+template <typename IPADDRTYPE, typename T>
+typename MultibitTrie<IPADDRTYPE, T>::Node*
+MultibitTrie<IPADDRTYPE, T>::getOrCreateChild(Node* node, uint8_t slot) {
+  auto index = rank(node->childBits, slot);
+  if (testBit(node->childBits, slot)) {
+    return node->children[index - 1].get();
+  }
+  setBit(node->childBits, slot);
+  auto it = node->children.insert(
+      node->children.begin() + index, std::make_unique<Node>());
+  return it->get();
+}
+
+template <typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::addToTrie(MapIter prefix) {
+  const auto& network = prefix->first.first;
+  auto targetLevel = levelFor(prefix->first.second);
+  if (!root_) {
+    root_ = std::make_unique<Node>();
+  }
+  auto node = root_.get();
+  for (size_t level = 0; level < targetLevel; ++level) {
+    node = getOrCreateChild(node, network.getNthMSByte(level));
+  }
+  node->prefixes.push_back(prefix);
+  rebuildLeaves(node, targetLevel);
+}
+
+template <typename IPADDRTYPE, typename T>
+bool MultibitTrie<IPADDRTYPE, T>::eraseFromTrie(Node* node, size_t level,
+    MapIter prefix) {
+  CHECK(node);
+  auto targetLevel = levelFor(prefix->first.second);
+  if (level == targetLevel) {
+    auto it = std::find(node->prefixes.begin(), node->prefixes.end(), prefix);
+    CHECK(it != node->prefixes.end());
+    node->prefixes.erase(it);
+    rebuildLeaves(node, level);
+  } else {
+    auto slot = prefix->first.first.getNthMSByte(level);
+    CHECK(testBit(node->childBits, slot));
+    auto index = rank(node->childBits, slot) - 1;
+    if (eraseFromTrie(node->children[index].get(), level + 1, prefix)) {
+      node->children.erase(node->children.begin() + index);
+      clearBit(node->childBits, slot);
+    }
+  }
+  // Let the caller free this node if nothing references it anymore
+  return node->empty();
+}
+
+template <typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::rebuildLeaves(Node* node, size_t level) {
+  // Expand every prefix ending in this node into the slots it covers, from
+  // the least to the most specific, so that each slot ends up with its
+  // longest match
+  std::sort(node->prefixes.begin(), node->prefixes.end(),
+      [](const MapIter& a, const MapIter& b) {
+        return a->first.second < b->first.second;
+      });
+  std::array<Leaf, kSlots> slots;
+  for (const auto& prefix : node->prefixes) {
+    auto bits = prefix->first.second - level * kStride;
+    auto first = prefix->first.first.getNthMSByte(level);
+    auto count = size_t(1) << (kStride - bits);
+    std::fill(slots.begin() + first, slots.begin() + first + count,
+        Leaf(prefix));
+  }
+
+  // Compress the slots into runs of identical leaves
+  node->leafBits = Bitmap{};
+  node->leaves.clear();
+  if (node->prefixes.empty()) {
+    return;
+  }
+  for (size_t slot = 0; slot < kSlots; ++slot) {
+    if (slot == 0 || slots[slot] != slots[slot - 1]) {
+      setBit(node->leafBits, slot);
+      node->leaves.push_back(slots[slot]);
+    }
+  }
+  node->leaves.shrink_to_fit();
+}
+
+template <typename IPADDRTYPE, typename T>
+size_t MultibitTrie<IPADDRTYPE, T>::countNodes(const Node* node) {
+  if (!node) {
+    return 0;
+  }
+  size_t count = 1;
+  for (const auto& c : node->children) {
+    count += countNodes(c.get());
+  }
+  return count;
+}
+
+}} // facebook::network
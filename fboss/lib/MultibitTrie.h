@@ -0,0 +1,309 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#ifndef MULTIBIT_TRIE_H
+#define MULTIBIT_TRIE_H
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glog/logging.h>
+#include <folly/Conv.h>
+
+namespace facebook { namespace network {
+
+/*
+ * MultibitTrie is a longest prefix match structure with the same
+ * insert/erase/exactMatch/longestMatch/iteration API as the single family
+ * RadixTree, optimized for lookup speed.
+ *
+ * Prefixes and their values are owned by an ordered map, which also provides
+ * exact match and iteration. Longest match lookups go through a compressed
+ * trie with a stride of 8 bits, so a full length lookup visits at most
+ * bitCount() / 8 nodes (4 for IPv4, 16 for IPv6) instead of one node per
+ * bit on the path as in the binary RadixTree.
+ *
+ * Each trie node covers one byte of the address. Prefixes ending within a
+ * node's byte are expanded into the 256 slots of that node (controlled prefix
+ * expansion), so that every slot knows the longest prefix ending in the node
+ * which covers it. Like in Poptrie, both the child pointers and the per slot
+ * matches are stored compressed, and are indexed by the popcount of a 256 bit
+ * bitmap:
+ *  - childBits has a bit set for each slot with a child node, and children
+ *    holds only those children, in slot order.
+ *  - leafBits has a bit set for each slot where the matching prefix differs
+ *    from the previous slot, and leaves holds one entry per such run.
+ * A lookup therefore only touches a few cache lines per level, and a sparse
+ * node (e.g. on a long IPv6 path) costs a few dozen bytes rather than 256
+ * pointers.
+ *
+ * Updates rebuild the slots of the one node the prefix ends in, which is
+ * O(256) work, plus the map update.
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitTrie {
+ public:
+  using Key = std::pair<IPADDRTYPE, uint8_t>;
+  using PrefixMap = std::map<Key, T>;
+
+  /*
+   * Iterators mirror the RadixTree iterators: dereferencing one yields the
+   * iterator itself, which provides ipAddress(), masklen() and value().
+   * Iteration is in (address, mask length) order.
+   */
+  template <typename MapIter, typename ValueT, typename DESIREDITERTYPE>
+  class IteratorImpl
+      : public std::iterator<std::forward_iterator_tag, DESIREDITERTYPE> {
+   public:
+    IteratorImpl() {}
+    IteratorImpl(MapIter it, MapIter end) : it_(it), end_(end) {}
+
+    DESIREDITERTYPE& operator++() {
+      checkDereference();
+      ++it_;
+      return static_cast<DESIREDITERTYPE&>(*this);
+    }
+    DESIREDITERTYPE operator++(int) {
+      DESIREDITERTYPE tmp(static_cast<DESIREDITERTYPE&>(*this));
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const IteratorImpl& r) const {
+      return it_ == r.it_;
+    }
+    bool operator!=(const IteratorImpl& r) const {
+      return it_ != r.it_;
+    }
+
+    const DESIREDITERTYPE& operator*() const {
+      checkDereference();
+      return static_cast<const DESIREDITERTYPE&>(*this);
+    }
+    const DESIREDITERTYPE* operator->() const {
+      checkDereference();
+      return static_cast<const DESIREDITERTYPE*>(this);
+    }
+    DESIREDITERTYPE& operator*() {
+      checkDereference();
+      return static_cast<DESIREDITERTYPE&>(*this);
+    }
+    DESIREDITERTYPE* operator->() {
+      checkDereference();
+      return static_cast<DESIREDITERTYPE*>(this);
+    }
+
+    bool atEnd() const { return it_ == end_; }
+    ValueT& value() const {
+      checkDereference();
+      return it_->second;
+    }
+    const IPADDRTYPE& ipAddress() const {
+      checkDereference();
+      return it_->first.first;
+    }
+    uint8_t masklen() const {
+      checkDereference();
+      return it_->first.second;
+    }
+    std::string str(bool printValue = true) const {
+      checkDereference();
+      auto nodeStr = folly::to<std::string>(
+          it_->first.first.str(), "/", uint32_t(it_->first.second));
+      if (printValue) {
+        nodeStr += folly::to<std::string>("(", it_->second, ")");
+      }
+      return nodeStr;
+    }
+    MapIter mapIterator() const { return it_; }
+    MapIter endIterator() const { return end_; }
+
+   protected:
+    void checkDereference() const {
+      CHECK(!atEnd());
+    }
+    MapIter it_;
+    MapIter end_;
+  };
+
+  class ConstIterator;
+  class Iterator : public IteratorImpl<
+      typename PrefixMap::iterator, T, Iterator> {
+   public:
+    using IteratorImpl<typename PrefixMap::iterator, T,
+          Iterator>::IteratorImpl;
+  };
+  class ConstIterator : public IteratorImpl<
+      typename PrefixMap::const_iterator, const T, ConstIterator> {
+   public:
+    using IteratorImpl<typename PrefixMap::const_iterator, const T,
+          ConstIterator>::IteratorImpl;
+    ConstIterator() {}
+    explicit ConstIterator(Iterator itr)
+        : ConstIterator(itr.mapIterator(), itr.endIterator()) {}
+  };
+
+  MultibitTrie() {}
+  MultibitTrie(const MultibitTrie&) = delete;
+  MultibitTrie& operator=(const MultibitTrie&) = delete;
+  // Moving the prefix map keeps iterators to its elements valid, so the trie
+  // can simply be moved along with it.
+  MultibitTrie(MultibitTrie&& r) noexcept
+      : prefixes_(std::move(r.prefixes_)), root_(std::move(r.root_)) {}
+  MultibitTrie& operator=(MultibitTrie&& r) noexcept {
+    prefixes_ = std::move(r.prefixes_);
+    root_ = std::move(r.root_);
+    return *this;
+  }
+
+  Iterator begin() { return makeItr(prefixes_.begin()); }
+  Iterator end() { return makeItr(prefixes_.end()); }
+  ConstIterator begin() const { return makeCItr(prefixes_.begin()); }
+  ConstIterator end() const { return makeCItr(prefixes_.end()); }
+
+  void clear() {
+    root_.reset();
+    prefixes_.clear();
+  }
+  size_t size() const { return prefixes_.size(); }
+
+  /*
+   * Insert a IP, mask, value. Returns an iterator to the inserted prefix and
+   * true, or to the existing prefix and false if it was already present.
+   */
+  template <typename VALUE>
+  std::pair<Iterator, bool> insert(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VALUE&& value);
+
+  bool erase(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    return erase(exactMatch(ipaddr, masklen));
+  }
+  bool erase(Iterator itr);
+
+  // Given a IP, mask return the longest prefix containing it
+  // NOTE: masklen is unsigned and must be <= ipaddr.bitCount()
+  ConstIterator longestMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const;
+  Iterator longestMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    auto citr = const_cast<const MultibitTrie*>(this)->longestMatch(
+        ipaddr, masklen);
+    return constCast(citr);
+  }
+
+  ConstIterator exactMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const {
+    return makeCItr(prefixes_.find(Key(ipaddr.mask(masklen), masklen)));
+  }
+  Iterator exactMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    return makeItr(prefixes_.find(Key(ipaddr.mask(masklen), masklen)));
+  }
+
+  // Number of trie nodes, exposed for tests and memory accounting
+  size_t numNodes() const {
+    return countNodes(root_.get());
+  }
+
+ private:
+  static constexpr uint8_t kStride = 8;
+  static constexpr size_t kSlots = 1 << kStride;
+  static constexpr size_t kLevels = IPADDRTYPE::bitCount() / kStride;
+
+  using MapIter = typename PrefixMap::iterator;
+  using Bitmap = std::array<uint64_t, kSlots / 64>;
+
+  struct Leaf {
+    Leaf() {}
+    explicit Leaf(MapIter it) : prefix(it), valid(true) {}
+    bool operator==(const Leaf& r) const {
+      return valid == r.valid && (!valid || prefix == r.prefix);
+    }
+    bool operator!=(const Leaf& r) const {
+      return !(*this == r);
+    }
+    MapIter prefix;
+    bool valid{false};
+  };
+
+  struct Node {
+    Bitmap childBits{};
+    std::vector<std::unique_ptr<Node>> children;
+    Bitmap leafBits{};
+    std::vector<Leaf> leaves;
+    // Prefixes ending within this node
+    std::vector<MapIter> prefixes;
+
+    bool empty() const {
+      return children.empty() && prefixes.empty();
+    }
+  };
+
+  static bool testBit(const Bitmap& bits, uint8_t slot) {
+    return bits[slot >> 6] & (uint64_t(1) << (slot & 63));
+  }
+  static void setBit(Bitmap& bits, uint8_t slot) {
+    bits[slot >> 6] |= uint64_t(1) << (slot & 63);
+  }
+  static void clearBit(Bitmap& bits, uint8_t slot) {
+    bits[slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+  }
+  // Number of bits set in bits at positions [0, slot]
+  static size_t rank(const Bitmap& bits, uint8_t slot) {
+    size_t count = 0;
+    auto word = slot >> 6;
+    for (size_t i = 0; i < word; ++i) {
+      count += __builtin_popcountll(bits[i]);
+    }
+    auto shift = 63 - (slot & 63);
+    return count + __builtin_popcountll(bits[word] << shift);
+  }
+
+  // Trie level at which a prefix of masklen ends
+  static size_t levelFor(uint8_t masklen) {
+    return masklen ? (masklen - 1) / kStride : 0;
+  }
+
+  static const Node* child(const Node* node, uint8_t slot) {
+    if (!testBit(node->childBits, slot)) {
+      return nullptr;
+    }
+    return node->children[rank(node->childBits, slot) - 1].get();
+  }
+  static const Leaf* leaf(const Node* node, uint8_t slot) {
+    if (node->leaves.empty()) {
+      return nullptr;
+    }
+    const auto& l = node->leaves[rank(node->leafBits, slot) - 1];
+    return l.valid ? &l : nullptr;
+  }
+
+  Node* getOrCreateChild(Node* node, uint8_t slot);
+  void addToTrie(MapIter prefix);
+  bool eraseFromTrie(Node* node, size_t level, MapIter prefix);
+  static void rebuildLeaves(Node* node, size_t level);
+  static size_t countNodes(const Node* node);
+
+  Iterator makeItr(MapIter it) {
+    return Iterator(it, prefixes_.end());
+  }
+  ConstIterator makeCItr(typename PrefixMap::const_iterator it) const {
+    return ConstIterator(it, prefixes_.end());
+  }
+  Iterator constCast(ConstIterator citr) {
+    // Erasing an empty range is the constant time way to get a non const map
+    // iterator from a const one
+    return makeItr(prefixes_.erase(citr.mapIterator(), citr.mapIterator()));
+  }
+
+  PrefixMap prefixes_;
+  std::unique_ptr<Node> root_;
+};
+
+}} // facebook::network
+
+#include "fboss/lib/MultibitTrie-inl.h"
+
+#endif
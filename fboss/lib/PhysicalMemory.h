@@ -12,6 +12,10 @@
 #include <boost/noncopyable.hpp>
 #include <folly/File.h>
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
 namespace facebook {
 namespace fboss {
 
@@ -75,6 +79,49 @@ class PhysicalMemory : public boost::noncopyable {
   void writeImpl(uint32_t offset, ValueT value) {
     *atOffset<ValueT>(offset) = value;
   }
+
+  /*
+   * The range versions check the bounds once for count registers starting
+   * at offset, then access them in order. Each register is still accessed
+   * on its own, with its own width, as devices don't take the wider or
+   * unaligned accesses memcpy() may do. The fences keep the accesses to
+   * the range from being reordered with the ones before and after it.
+   */
+  template <typename ValueT>
+  volatile ValueT* atRange(uint32_t offset, uint32_t count) const {
+    CHECK_LE(uint64_t(offset) + uint64_t(count) * sizeof(ValueT), size_);
+    // offset must be aligned
+    CHECK(!(offset & (std::alignment_of<ValueT>::value - 1)));
+    return reinterpret_cast<volatile ValueT*>(
+        reinterpret_cast<char*>(virtAddr_) + offset);
+  }
+
+  template <typename ValueT>
+  void readRangeImpl(uint32_t offset, ValueT* values, uint32_t count) const {
+    auto regs = atRange<ValueT>(offset, count);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (uint32_t i = 0; i < count; ++i) {
+      values[i] = regs[i];
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  template <typename ValueT>
+  void writeRangeImpl(uint32_t offset, const ValueT* values, uint32_t count) {
+    auto regs = atRange<ValueT>(offset, count);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (uint32_t i = 0; i < count; ++i) {
+      regs[i] = values[i];
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  template <typename ValueT>
+  std::vector<ValueT> snapshotImpl(uint32_t offset, uint32_t count) const {
+    std::vector<ValueT> values(count);
+    readRangeImpl(offset, values.data(), count);
+    return values;
+  }
 };
 
 template <typename BaseT = PhysicalMemory>
@@ -87,6 +134,16 @@ class PhysicalMemory8 : public BaseT {
   void write(uint32_t offset, uint8_t val) {
     return BaseT::template writeImpl(offset, val);
   }
+  void read(uint32_t offset, uint8_t* values, uint32_t count) const {
+    BaseT::template readRangeImpl(offset, values, count);
+  }
+  void write(uint32_t offset, const uint8_t* values, uint32_t count) {
+    BaseT::template writeRangeImpl(offset, values, count);
+  }
+  // Read count registers in one pass, e.g. to scan status registers
+  std::vector<uint8_t> snapshot(uint32_t offset, uint32_t count) const {
+    return BaseT::template snapshotImpl<uint8_t>(offset, count);
+  }
 };
 
 template <typename BaseT = PhysicalMemory>
@@ -99,6 +156,16 @@ class PhysicalMemory16 : public BaseT {
   void write(uint32_t offset, uint16_t val) {
     return BaseT::template writeImpl(offset, val);
   }
+  void read(uint32_t offset, uint16_t* values, uint32_t count) const {
+    BaseT::template readRangeImpl(offset, values, count);
+  }
+  void write(uint32_t offset, const uint16_t* values, uint32_t count) {
+    BaseT::template writeRangeImpl(offset, values, count);
+  }
+  // Read count registers in one pass, e.g. to scan status registers
+  std::vector<uint16_t> snapshot(uint32_t offset, uint32_t count) const {
+    return BaseT::template snapshotImpl<uint16_t>(offset, count);
+  }
 };
 
 template <typename BaseT = PhysicalMemory>
@@ -111,6 +178,16 @@ class PhysicalMemory32 : public BaseT {
   void write(uint32_t offset, uint32_t val) {
     return BaseT::template writeImpl(offset, val);
   }
+  void read(uint32_t offset, uint32_t* values, uint32_t count) const {
+    BaseT::template readRangeImpl(offset, values, count);
+  }
+  void write(uint32_t offset, const uint32_t* values, uint32_t count) {
+    BaseT::template writeRangeImpl(offset, values, count);
+  }
+  // Read count registers in one pass, e.g. to scan status registers
+  std::vector<uint32_t> snapshot(uint32_t offset, uint32_t count) const {
+    return BaseT::template snapshotImpl<uint32_t>(offset, count);
+  }
 };
 
 } // namespace fboss
@@ -0,0 +1,57 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+#include "fboss/lib/QuantileSketch.h"
+
+#include <algorithm>
+
+namespace facebook {
+namespace fboss {
+
+constexpr int QuantileSketch::kSubBucketBits;
+constexpr int64_t QuantileSketch::kSubBuckets;
+constexpr int QuantileSketch::kMaxValueBits;
+constexpr int64_t QuantileSketch::kMaxValue;
+constexpr size_t QuantileSketch::kNumBuckets;
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+}
+
+void QuantileSketch::decay(double factor) {
+  for (auto& count : counts_) {
+    count *= factor;
+  }
+  count_ *= factor;
+}
+
+void QuantileSketch::clear() {
+  counts_.fill(0);
+  count_ = 0;
+}
+
+int64_t QuantileSketch::quantile(double q) const {
+  auto target = std::min(std::max(q, 0.0), 1.0) * count_;
+  double seen = 0;
+  size_t last = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    if (counts_[i] <= 0) {
+      continue;
+    }
+    seen += counts_[i];
+    last = i;
+    if (seen >= target) {
+      break;
+    }
+  }
+  if (seen <= 0) {
+    return 0;
+  }
+  // Rounding may leave seen just short of the total, in which case the
+  // last bucket with samples is the right one anyway
+  return bucketLow(last) + (bucketHigh(last) - bucketLow(last)) / 2;
+}
+
+}
+}
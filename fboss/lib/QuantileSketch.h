@@ -0,0 +1,102 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook {
+namespace fboss {
+
+/*
+ * A streaming quantile sketch for non-negative integer samples such as
+ * latencies, in the style of HdrHistogram. Samples are counted in buckets
+ * whose width grows with the value, so any quantile is known to within
+ * 1 / kSubBuckets of its value, in a fixed amount of memory however many
+ * samples are added.
+ *
+ * Sketches merge by adding up their counts, and decay() scales all of the
+ * counts down, so that a sketch can weigh the recent samples more than the
+ * older ones. This is why the counts are not integers.
+ *
+ * Not thread safe.
+ */
+class QuantileSketch {
+ public:
+  // Buckets per power of two
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int64_t kSubBuckets = int64_t(1) << kSubBucketBits;
+  // Larger values are counted as kMaxValue
+  static constexpr int kMaxValueBits = 40;
+  static constexpr int64_t kMaxValue = (int64_t(1) << kMaxValueBits) - 1;
+  static constexpr size_t kNumBuckets =
+      (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  /*
+   * The bucket value is counted in. Values below kSubBuckets each have a
+   * bucket of their own, then each power of two is split in kSubBuckets.
+   */
+  static size_t bucketOf(int64_t value) {
+    if (value < kSubBuckets) {
+      return value < 0 ? 0 : value;
+    }
+    if (value > kMaxValue) {
+      value = kMaxValue;
+    }
+    int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+  }
+
+  // The smallest and largest values counted in bucket
+  static int64_t bucketLow(size_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    int shift = bucket / kSubBuckets - 1;
+    return (kSubBuckets + bucket % kSubBuckets) << shift;
+  }
+  static int64_t bucketHigh(size_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    int shift = bucket / kSubBuckets - 1;
+    return bucketLow(bucket) + (int64_t(1) << shift) - 1;
+  }
+
+  void addValue(int64_t value, double weight = 1) {
+    addToBucket(bucketOf(value), weight);
+  }
+  void addToBucket(size_t bucket, double weight) {
+    counts_[bucket] += weight;
+    count_ += weight;
+  }
+
+  void merge(const QuantileSketch& other);
+
+  /*
+   * Scale the weight of all of the samples so far by factor, which should
+   * be in [0, 1].
+   */
+  void decay(double factor);
+
+  void clear();
+
+  // The total weight of the samples
+  double count() const {
+    return count_;
+  }
+
+  /*
+   * The value below which a fraction q of the samples fall, as the middle
+   * of the bucket it is counted in. 0 if there are no samples.
+   */
+  int64_t quantile(double q) const;
+
+ private:
+  std::array<double, kNumBuckets> counts_{};
+  double count_{0};
+};
+
+}
+}
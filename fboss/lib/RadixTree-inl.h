@@ -140,7 +140,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
       // specific root.
       auto prefix = IPADDRTYPE::longestCommonPrefix(
         {root_->ipAddress(), root_->masklen()}, {toAdd, mask});
-      std::unique_ptr<TreeNode> newRoot = nullptr;
+      NodePtr newRoot = nullptr;
       if (prefix.first == toAdd && prefix.second == mask) {
         // To be added node is the new root
         newRoot = std::move(newNode);
@@ -209,7 +209,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         // bestMatchChild and new node.
         auto internalNode = makeNode(prefix.first, prefix.second);
         auto internalNodeRaw = internalNode.get();
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        NodePtr oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
           oldBestMatchChild = bestMatch->resetLeft(std::move(internalNode));
         } else {
@@ -228,7 +228,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         CHECK(internalNode == nullptr);
       } else {
         // New node needs to be inserted  b/w bestMatch and bestMatchChild
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        NodePtr oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
           oldBestMatchChild = bestMatch->resetLeft(std::move(newNode));
         } else {
@@ -251,6 +251,87 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
   return std::make_pair(traits_.makeItr(newNodeRaw), true);
 }
 
+template <typename IPADDRTYPE, typename T, typename TreeTraits>
+template <typename ForwardIt>
+void RadixTree<IPADDRTYPE, T, TreeTraits>::assignSorted(
+    ForwardIt begin, ForwardIt end) {
+  clear();
+  // Each prefix needs at most one value node and one internal node
+  reserve(2 * std::distance(begin, end));
+  // Nodes from the root to the node added last, which is always a leaf
+  std::vector<TreeNode*> path;
+  path.reserve(IPADDRTYPE::bitCount() + 1);
+  for (auto it = begin; it != end; ++it) {
+    auto&& entry = *it;
+    auto mask = entry.first.second;
+    // Can't trust the clients to have 0s in all bits after mask length
+    auto toAdd = entry.first.first.mask(mask);
+    if (!path.empty()) {
+      const auto* last = path.back();
+      CHECK(std::make_pair(last->ipAddress(), last->masklen()) <
+            std::make_pair(toAdd, static_cast<uint32_t>(mask)))
+        << "Prefixes are not sorted: " << toAdd.str() << "/"
+        << static_cast<int>(mask) << " after " << last->str(false);
+    }
+    auto newNode = makeNode(toAdd, mask,
+        std::forward<decltype(entry)>(entry).second);
+    auto newNodeRaw = newNode.get();
+
+    // Walk up to the closest node holding the new prefix, remembering the
+    // subtree we came from
+    TreeNode* child = nullptr;
+    while (!path.empty()) {
+      auto direction = path.back()->searchDirection(toAdd, mask);
+      if (direction == TreeDirection::LEFT ||
+          direction == TreeDirection::RIGHT) {
+        break;
+      }
+      child = path.back();
+      path.pop_back();
+    }
+    TreeNode* parent = path.empty() ? nullptr : path.back();
+
+    if (!child) {
+      // The new prefix is under the node added last, or the first one
+      if (!parent) {
+        makeRoot(std::move(newNode));
+      } else if (parent->searchDirection(newNodeRaw) == TreeDirection::LEFT) {
+        parent->resetLeft(std::move(newNode));
+      } else {
+        parent->resetRight(std::move(newNode));
+      }
+    } else if (parent &&
+        parent->searchDirection(newNodeRaw) != parent->searchDirection(child)) {
+      // Sorted input fills the left subtree of parent before the right one
+      CHECK(!parent->right());
+      parent->resetRight(std::move(newNode));
+    } else {
+      // The new prefix goes next to the subtree of child, under a non value
+      // internal node. It can't hold child, as child came before it.
+      auto prefix = IPADDRTYPE::longestCommonPrefix(
+        {child->ipAddress(), child->masklen()}, {toAdd, mask});
+      CHECK_LT(prefix.second, mask);
+      auto internalNode = makeNode(prefix.first, prefix.second);
+      auto internalNodeRaw = internalNode.get();
+      NodePtr subTree = nullptr;
+      if (!parent) {
+        subTree = std::move(root_);
+        makeRoot(std::move(internalNode));
+      } else if (parent->searchDirection(child) == TreeDirection::LEFT) {
+        subTree = parent->resetLeft(std::move(internalNode));
+      } else {
+        subTree = parent->resetRight(std::move(internalNode));
+      }
+      internalNodeRaw->resetLeft(std::move(subTree));
+      internalNodeRaw->resetRight(std::move(newNode));
+      path.push_back(internalNodeRaw);
+    }
+    CHECK(newNode == nullptr);
+    path.push_back(newNodeRaw);
+    ++size_;
+  }
+}
+
 /*
  * One condition that must be true before and after erase
  * is that all non value nodes should have 2 children. Assuming
@@ -391,18 +472,16 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::radixSubTreesEqual(
 
 
 template<typename IPADDRTYPE, typename T, typename TreeTraits>
-std::unique_ptr<typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode>
+typename RadixTree<IPADDRTYPE, T, TreeTraits>::NodePtr
 RadixTree<IPADDRTYPE, T, TreeTraits>::cloneSubTree(const TreeNode* node) {
   if (!node) {
     return nullptr;
   }
-  std::unique_ptr<TreeNode> copy;
+  NodePtr copy;
   if (node->isValueNode()) {
-    copy = std::make_unique<TreeNode>(node->ipAddress(),
-      node->masklen(), node->value(), node->nodeDeleteCallback());
+    copy = makeNode(node->ipAddress(), node->masklen(), node->value());
   } else {
-    copy = std::make_unique<TreeNode>(node->ipAddress(),
-      node->masklen(), node->nodeDeleteCallback());
+    copy = makeNode(node->ipAddress(), node->masklen());
   }
   copy->resetLeft(cloneSubTree(node->left()));
   copy->resetRight(cloneSubTree(node->right()));
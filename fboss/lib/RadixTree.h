@@ -9,6 +9,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <folly/Conv.h>
@@ -19,35 +20,40 @@
 #include <folly/IPAddressV6.h>
 
 namespace facebook { namespace network {
+
+template<typename NODETYPE>
+class RadixTreeNodePool;
+
 /*
  * Node in RadixTree, holds IP, mask. Will hold  value for nodes
  * created as a result of user inserts. Other type of nodes are
  * ones created by the radix tree implementation, which will
  * hold no values. All non value nodes will have 2 children,
  * this invariant must be maintained at all times.
+ * Nodes are allocated from, and returned to, the RadixTreeNodePool
+ * owned by their tree.
 */
 template<typename IPADDRTYPE, typename T>
 class RadixTreeNode {
  public:
-  // Optional function parameter to call from destructor
+  // Optional function called by the tree before destroying a node
   typedef std::function<void(const RadixTreeNode<IPADDRTYPE, T>&)>
     NodeDeleteCallback;
+  typedef RadixTreeNodePool<RadixTreeNode> Pool;
+
+  // Returns nodes to the pool they were allocated from
+  struct Deleter {
+    void operator()(RadixTreeNode* node) const;
+  };
+  typedef std::unique_ptr<RadixTreeNode, Deleter> NodePtr;
 
-  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen,
-      NodeDeleteCallback deleteCallback):
-    ipAddress_(ipAddr), masklen_(mlen), deleteCallback_(deleteCallback) {}
+  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen, Pool* pool):
+    ipAddress_(ipAddr), masklen_(mlen), pool_(pool) {}
 
   template<typename VALUE>
   RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen, VALUE&& val,
-       NodeDeleteCallback deleteCallback): ipAddress_(ipAddr),
-  masklen_(mlen), value_(std::forward<VALUE>(val)),
-  deleteCallback_(deleteCallback) {}
-
-  ~RadixTreeNode() {
-    if (deleteCallback_) {
-      deleteCallback_(*this);
-    }
-  }
+       Pool* pool): ipAddress_(ipAddr),
+  masklen_(mlen), value_(std::forward<VALUE>(val)), pool_(pool) {}
 
   enum class TreeDirection { LEFT, RIGHT, PARENT, THIS_NODE};
 
@@ -64,7 +70,7 @@ class RadixTreeNode {
   bool    isLeaf()  const { return left_ == nullptr && right_ == nullptr; }
   const T& value() const { return value_.value();  }
   T&       value()       { return value_.value();  }
-  NodeDeleteCallback nodeDeleteCallback() const { return deleteCallback_; }
+  NodeDeleteCallback nodeDeleteCallback() const;
   std::string str(bool printValue = true) const {
     auto nodeStr = folly::to<std::string>(ipAddress_.str(), "/", masklen_);
     if (printValue) {
@@ -90,8 +96,7 @@ class RadixTreeNode {
           this->value() == r.value());
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetLeft(std::unique_ptr<RadixTreeNode> newLeft) {
+  NodePtr resetLeft(NodePtr newLeft) {
     auto old = std::move(left_);
     left_ = std::move(newLeft);
     if (left_) {
@@ -100,8 +105,7 @@ class RadixTreeNode {
     return old;
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetRight(std::unique_ptr<RadixTreeNode> newRight) {
+  NodePtr resetRight(NodePtr newRight) {
     auto old = std::move(right_);
     right_ = std::move(newRight);
     if (right_) {
@@ -126,12 +130,143 @@ class RadixTreeNode {
   IPADDRTYPE ipAddress_;
   uint32_t masklen_{0}; // Number of bits to match.
   folly::Optional<T> value_;
-  std::unique_ptr<RadixTreeNode> left_{nullptr};
-  std::unique_ptr<RadixTreeNode> right_{nullptr};
+  NodePtr left_{nullptr};
+  NodePtr right_{nullptr};
   RadixTreeNode* parent_{nullptr};
+  // Pool this node was allocated from. This is a single pointer, so that
+  // nodes don't each carry a copy of the tree's delete callback.
+  Pool* pool_{nullptr};
+};
+
+/*
+ * Slab allocator for the nodes of a single RadixTree.
+ *
+ * Nodes are carved out of slabs of slots which grow geometrically, and freed
+ * nodes are kept on a free list for reuse rather than returned to the heap.
+ * This avoids a heap allocation per node, keeps nodes of a tree close
+ * together in memory, and makes clear() followed by re-inserts (as done when
+ * rebuilding a route table's radix tree) allocation free.
+ *
+ * The pool also holds the tree level delete callback, which is called for
+ * every node right before it is destroyed.
+ * All nodes must be destroyed before the pool is.
+ */
+template<typename NODETYPE>
+class RadixTreeNodePool {
+ public:
+  typedef typename NODETYPE::NodeDeleteCallback NodeDeleteCallback;
+  typedef typename NODETYPE::NodePtr NodePtr;
+
+  explicit RadixTreeNodePool(NodeDeleteCallback deleteCallback):
+    deleteCallback_(std::move(deleteCallback)) {}
+  ~RadixTreeNodePool() {
+    CHECK_EQ(liveNodes_, 0u);
+  }
+  RadixTreeNodePool(const RadixTreeNodePool&) = delete;
+  RadixTreeNodePool& operator=(const RadixTreeNodePool&) = delete;
+
+  template<typename... Args>
+  NodePtr create(Args&&... args) {
+    auto mem = allocate();
+    try {
+      return NodePtr(new (mem) NODETYPE(std::forward<Args>(args)..., this));
+    } catch (...) {
+      release(mem);
+      throw;
+    }
+  }
+
+  void destroy(NODETYPE* node) {
+    if (deleteCallback_) {
+      deleteCallback_(*node);
+    }
+    node->~NODETYPE();
+    release(node);
+  }
+
+  // Make sure at least count more nodes can be created without growing
+  void reserve(size_t count) {
+    auto available = capacity_ - liveNodes_;
+    if (available < count) {
+      addSlab(count - available);
+    }
+  }
+
+  const NodeDeleteCallback& deleteCallback() const { return deleteCallback_; }
+  void swapDeleteCallback(RadixTreeNodePool& r) noexcept {
+    deleteCallback_.swap(r.deleteCallback_);
+  }
+
+  size_t liveNodes() const { return liveNodes_; }
+  size_t capacity() const { return capacity_; }
+  // Bytes allocated by the pool, including free slots
+  size_t memoryUsage() const {
+    return capacity_ * sizeof(Slot) +
+        slabs_.capacity() * sizeof(std::unique_ptr<Slot[]>);
+  }
+
+ private:
+  union Slot {
+    Slot* next;
+    typename std::aligned_storage<sizeof(NODETYPE),
+             alignof(NODETYPE)>::type storage;
+  };
+  static constexpr size_t kMinSlabSlots = 64;
+  static constexpr size_t kMaxSlabSlots = 8192;
+
+  void* allocate() {
+    if (!freeList_) {
+      addSlab(std::min(std::max(capacity_, kMinSlabSlots), kMaxSlabSlots));
+    }
+    auto slot = freeList_;
+    freeList_ = slot->next;
+    ++liveNodes_;
+    return slot;
+  }
+
+  void release(void* mem) {
+    auto slot = static_cast<Slot*>(mem);
+    slot->next = freeList_;
+    freeList_ = slot;
+    --liveNodes_;
+  }
+
+  void addSlab(size_t slots) {
+    std::unique_ptr<Slot[]> slab(new Slot[slots]);
+    // Thread the free list in address order, so that nodes allocated one
+    // after the other are adjacent in memory
+    for (size_t i = slots; i > 0; --i) {
+      slab[i - 1].next = freeList_;
+      freeList_ = &slab[i - 1];
+    }
+    slabs_.push_back(std::move(slab));
+    capacity_ += slots;
+  }
+
   NodeDeleteCallback deleteCallback_;
+  std::vector<std::unique_ptr<Slot[]>> slabs_;
+  Slot* freeList_{nullptr};
+  size_t capacity_{0};
+  size_t liveNodes_{0};
 };
 
+template<typename NODETYPE>
+constexpr size_t RadixTreeNodePool<NODETYPE>::kMinSlabSlots;
+template<typename NODETYPE>
+constexpr size_t RadixTreeNodePool<NODETYPE>::kMaxSlabSlots;
+
+template<typename IPADDRTYPE, typename T>
+void RadixTreeNode<IPADDRTYPE, T>::Deleter::operator()(
+    RadixTreeNode* node) const {
+  node->pool_->destroy(node);
+}
+
+template<typename IPADDRTYPE, typename T>
+typename RadixTreeNode<IPADDRTYPE, T>::NodeDeleteCallback
+RadixTreeNode<IPADDRTYPE, T>::nodeDeleteCallback() const {
+  return pool_->deleteCallback();
+}
+
 
 /*
  * Forward Iterator to traverse a Radix tree
@@ -344,6 +479,8 @@ class RadixTree {
   typedef RadixTreeNode<IPADDRTYPE, T>           TreeNode;
   typedef typename TreeNode::TreeDirection       TreeDirection;
   typedef typename TreeNode::NodeDeleteCallback  NodeDeleteCallback;
+  typedef typename TreeNode::NodePtr             NodePtr;
+  typedef typename TreeNode::Pool                NodePool;
   typedef typename TreeTraits::Iterator          Iterator;
   typedef typename TreeTraits::ConstIterator     ConstIterator;
   typedef typename std::vector<ConstIterator>    VecConstIterators;
@@ -351,7 +488,8 @@ class RadixTree {
   explicit RadixTree(NodeDeleteCallback nodeDelCallback =
       NodeDeleteCallback(),
       const TreeTraits& treeTraits = TreeTraits()):
-    nodeDeleteCallback_(nodeDelCallback), traits_(treeTraits) {}
+    pool_(std::make_unique<NodePool>(std::move(nodeDelCallback))),
+    traits_(treeTraits) {}
 
   RadixTree(const RadixTree& r) = delete;
   RadixTree& operator=(const RadixTree& r) = delete;
@@ -361,20 +499,31 @@ class RadixTree {
   ConstIterator begin() const { return traits_.makeCItr(root_.get()); }
   ConstIterator end()   const { return traits_.makeCItr(nullptr);  }
 
-  // Free all nodes and clear the tree.
+  // Free all nodes and clear the tree. The memory of the nodes is kept
+  // by the tree for reuse by subsequent inserts.
   void clear() {
     root_.reset(nullptr);
     size_ = 0;
   }
+  // Preallocate memory for count more nodes. Note that inserting a prefix
+  // may create up to 2 nodes.
+  void reserve(size_t count) {
+    pool_->reserve(count);
+  }
   RadixTree(RadixTree&& r) noexcept
-   : nodeDeleteCallback_(r.nodeDeleteCallback_),
+   : pool_(std::make_unique<NodePool>(r.pool_->deleteCallback())),
   traits_(r.traits_) {
     *this = std::move(r);
   }
   // Move radix tree onto this
   RadixTree& operator=(RadixTree&& r) noexcept {
     // Don't copy the traits and delete callback, use
-    // ones with which this Radix tree was created
+    // ones with which this Radix tree was created.
+    // r's nodes live in r's pool, so take the pool along with them, and
+    // leave r with our (now empty) pool.
+    clear();
+    pool_.swap(r.pool_);
+    pool_->swapDeleteCallback(*r.pool_);
     size_ = r.size_;
     makeRoot(std::move(r.root_));
     r.size_ = 0;
@@ -386,9 +535,12 @@ class RadixTree {
     clone() const {
     static_assert(std::is_same<T, U>::value,
         "clone template type must be the same as Radix tree value type");
-    RadixTree copy(nodeDeleteCallback_, traits_);
+    RadixTree copy(pool_->deleteCallback(), traits_);
+    // Allocate all the nodes needed for the copy up front, so that they are
+    // carved out of a single slab
+    copy.reserve(pool_->liveNodes());
     copy.size_ = size_;
-    copy.root_ = cloneSubTree(root_.get());
+    copy.root_ = copy.cloneSubTree(root_.get());
     return copy;
   }
   /*
@@ -403,6 +555,19 @@ class RadixTree {
   std::pair<Iterator, bool>  insert(const IPADDRTYPE& ipaddr,
       uint8_t masklen, VALUE&& value);
 
+  /*
+   * Replace the contents of the tree with the entries of [begin, end), each
+   * a ((IP, mask), value) pair such as
+   * std::pair<std::pair<IPADDRTYPE, uint8_t>, T>. Use a std::move_iterator
+   * to move the values into the tree.
+   * The entries must be sorted by masked IP, then mask, without duplicates.
+   * That is the pre-order of the tree, so every prefix attaches to the path
+   * leading to the one before it, and the tree is built in a single pass
+   * rather than with one lookup per prefix as insert() does.
+   */
+  template <typename ForwardIt>
+  void assignSorted(ForwardIt begin, ForwardIt end);
+
   // Erase a IP, mask
   bool erase(const IPADDRTYPE& ipaddr, uint8_t masklen) {
     return erase(exactMatch(ipaddr, masklen));
@@ -524,12 +689,16 @@ class RadixTree {
   }
 
   size_t size()  const { return size_; }
+  // Bytes allocated for the nodes of the tree
+  size_t memoryUsage() const { return pool_->memoryUsage(); }
   const TreeNode* root() const { return root_.get(); }
   TreeNode* root() { return root_.get();  }
-  NodeDeleteCallback nodeDeleteCallback() const { return nodeDeleteCallback_; }
+  NodeDeleteCallback nodeDeleteCallback() const {
+    return pool_->deleteCallback();
+  }
   const TreeTraits&  traits() const { return traits_; }
  private:
-  static std::unique_ptr<TreeNode> cloneSubTree(const TreeNode* node);
+  NodePtr cloneSubTree(const TreeNode* node);
   // Worker function to do the actual longest match lookup.
   const TreeNode* longestMatchImpl(const IPADDRTYPE& ipaddr,
       uint8_t masklen, bool& foundExact, bool includeNonValueNodes = false,
@@ -544,20 +713,16 @@ class RadixTree {
             masklen, foundExact, includeNonValueNodes, trail));
   }
 
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen) {
-    return std::make_unique<TreeNode>(ip, masklen, nodeDeleteCallback_);
+  NodePtr makeNode(const IPADDRTYPE& ip, uint8_t masklen) {
+    return pool_->create(ip, masklen);
   }
 
   template<typename VALUE>
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen, VALUE&& value) {
-    return std::make_unique<TreeNode>(ip, masklen,
-                                        std::forward<VALUE>(value),
-                                        nodeDeleteCallback_);
+  NodePtr makeNode(const IPADDRTYPE& ip, uint8_t masklen, VALUE&& value) {
+    return pool_->create(ip, masklen, std::forward<VALUE>(value));
   }
 
-  void makeRoot(std::unique_ptr<TreeNode> newRoot) {
+  void makeRoot(NodePtr newRoot) {
     CHECK(root_ != newRoot || root_ == nullptr);
     if (newRoot) {
         newRoot->setParent(nullptr);
@@ -568,9 +733,11 @@ class RadixTree {
   inline void trailAppend(VecConstIterators* trail,
   bool includeNonValueNodes, const TreeNode* node) const;
 
-  std::unique_ptr<TreeNode> root_{nullptr};
+  // The pool must outlive all nodes, so it is declared (and thus constructed)
+  // before, and destroyed after, root_
+  std::unique_ptr<NodePool> pool_;
+  NodePtr root_{nullptr};
   size_t  size_{0};
-  NodeDeleteCallback nodeDeleteCallback_;
   TreeTraits  traits_;
 };
 
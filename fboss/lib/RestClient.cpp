@@ -11,9 +11,11 @@
 
 #include <sstream>
 
+#include "common/stats/ThreadCachedServiceData.h"
 #include "fboss/agent/FbossError.h"
 
-#include <curl/curl.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 
 namespace facebook { namespace fboss {
 
@@ -36,6 +38,16 @@ RestClient::RestClient(folly::IPAddress ipAddress, int port,
   createEndpoint();
 }
 
+RestClient::~RestClient() {
+  // The async requests still pending use the curl handle
+  if (executor_) {
+    executor_->join();
+  }
+  if (curl_) {
+    curl_easy_cleanup(curl_);
+  }
+}
+
 void RestClient::createEndpoint() {
   if (!hostname_.empty()) {
     endpoint_ = hostname_;
@@ -50,43 +62,80 @@ void RestClient::createEndpoint() {
 }
 
 void RestClient::setTimeout(std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> g(lock_);
   timeout_ = timeout;
 }
 
 std::string RestClient::requestWithOutput(std::string path) {
-  CURL* curl;
-  CURLcode resp;
+  std::lock_guard<std::mutex> g(lock_);
+  return perform(endpoint_ + path);
+}
+
+std::string RestClient::requestWithOutputCached(
+    const std::string& path,
+    std::chrono::seconds maxAge) {
+  std::lock_guard<std::mutex> g(lock_);
+  auto now = Clock::now();
+  auto it = cache_.find(path);
+  if (it != cache_.end() && now - it->second.fetched < maxAge) {
+    return it->second.output;
+  }
+  auto output = perform(endpoint_ + path);
+  cache_[path] = CachedOutput{now, output};
+  return output;
+}
+
+std::string RestClient::perform(const std::string& url) {
   std::stringbuf write_buffer;
-  endpoint_ = endpoint_ + path;
   /* for curl errors */
   char error[CURL_ERROR_SIZE];
+  error[0] = '\0';
 
-  curl = curl_easy_init();
-  if (curl) {
-    /* Set the curl options */
-    curl_easy_setopt(curl, CURLOPT_URL, endpoint_.c_str());
-    curl_easy_setopt(curl, CURLOPT_PROTOCOLS,CURLPROTO_HTTP);
-    curl_easy_setopt(curl, CURLOPT_PORT, port_);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_.count());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::writer);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &write_buffer);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, error);
-    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-
-    /* if an interface is specified use that */
-    if (!interface_.empty()) {
-      curl_easy_setopt(curl, CURLOPT_INTERFACE, interface_.c_str());
+  if (!curl_) {
+    curl_ = curl_easy_init();
+    if (!curl_) {
+      throw FbossError("Error initializing curl interface");
     }
+  }
+  auto start = std::chrono::steady_clock::now();
 
-    resp = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-    if (resp == CURLE_OK) {
-      return write_buffer.str();
-    } else {
-      throw FbossError("Error querying api: ", endpoint_, " error: ", error);
-    }
+  /*
+   * Set the curl options. They stick to the handle, which then reuses the
+   * connection to the server if it is still open.
+   */
+  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_PROTOCOLS, CURLPROTO_HTTP);
+  curl_easy_setopt(curl_, CURLOPT_PORT, port_);
+  curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, timeout_.count());
+  curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT_MS, timeout_.count());
+  curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, RestClient::writer);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &write_buffer);
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, error);
+  curl_easy_setopt(curl_, CURLOPT_FAILONERROR, 1L);
+
+  /* if an interface is specified use that */
+  if (!interface_.empty()) {
+    curl_easy_setopt(curl_, CURLOPT_INTERFACE, interface_.c_str());
+  }
+
+  auto resp = curl_easy_perform(curl_);
+  // The error buffer and the write buffer don't outlive this call
+  curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, nullptr);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, nullptr);
+
+  tcData().addStatValue(
+      "rest_client.latency.ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count(),
+      stats::AVG);
+  if (resp != CURLE_OK) {
+    tcData().addStatValue("rest_client.errors", 1, stats::SUM);
+    throw FbossError("Error querying api: ", url, " error: ", error);
   }
-  throw FbossError("Error initializing curl interface");
+  return write_buffer.str();
 }
 
 bool RestClient::request(std::string path) {
@@ -98,6 +147,28 @@ bool RestClient::request(std::string path) {
   return false;
 }
 
+folly::Future<std::string> RestClient::requestWithOutputAsync(
+    std::string path) {
+  return folly::via(getExecutor(), [this, path = std::move(path)]() {
+    return requestWithOutput(path);
+  });
+}
+
+folly::Future<bool> RestClient::requestAsync(std::string path) {
+  return folly::via(getExecutor(), [this, path = std::move(path)]() {
+    return request(path);
+  });
+}
+
+folly::CPUThreadPoolExecutor* RestClient::getExecutor() {
+  std::lock_guard<std::mutex> g(executorLock_);
+  if (!executor_) {
+    executor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        1, std::make_shared<folly::NamedThreadFactory>("RestClient"));
+  }
+  return executor_.get();
+}
+
 size_t RestClient::writer(char *buffer, size_t size,
                                 size_t entries, std::stringbuf *writer_buffer) {
   std::streamsize data_put = writer_buffer->sputn(buffer, size * entries);
@@ -11,15 +11,38 @@
 
 #include <string>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <folly/IPAddress.h>
+#include <folly/futures/Future.h>
+
+#include <curl/curl.h>
+
+namespace folly {
+class CPUThreadPoolExecutor;
+}
 
 namespace facebook { namespace fboss {
 
+/*
+ * A client for the REST api of a server, in practice the BMC.
+ *
+ * The client keeps its curl handle, and with it the connection to the
+ * server, from one request to the next. Requests are serialized, as a curl
+ * handle can only do one at a time. The *Async() versions run on a thread
+ * of the client's own, so that a slow server only ever holds up that
+ * thread and not the caller's.
+ *
+ * Each request adds to the rest_client.latency.ms and rest_client.errors
+ * counters.
+ */
 class RestClient {
  public:
   RestClient(std::string hostname, int port);
   RestClient(folly::IPAddress ipAddress, int port);
   RestClient(folly::IPAddress ipAddress, int port, std::string interface);
+  ~RestClient();
   /*
    * Calls the particular Rest api
    */
@@ -27,7 +50,26 @@ class RestClient {
   std::string requestWithOutput(std::string path);
   void setTimeout(std::chrono::milliseconds timeout);
 
+  folly::Future<bool> requestAsync(std::string path);
+  folly::Future<std::string> requestWithOutputAsync(std::string path);
+
+  /*
+   * The output of path, reusing the one from a previous request less than
+   * maxAge ago if there is one. For data that rarely changes, such as the
+   * product information.
+   */
+  std::string requestWithOutputCached(
+      const std::string& path,
+      std::chrono::seconds maxAge);
+
  private:
+  using Clock = std::chrono::steady_clock;
+
+  struct CachedOutput {
+    Clock::time_point fetched;
+    std::string output;
+  };
+
   // Forbidden copy contructor and assignment operator
   RestClient(RestClient const &) = delete;
   RestClient& operator=(RestClient const &) = delete;
@@ -35,12 +77,24 @@ class RestClient {
   static size_t writer(char *buffer, size_t size,
                         size_t entries, std::stringbuf *writer_buffer);
   void createEndpoint();
+  // Must be called with lock_ held
+  std::string perform(const std::string& url);
+  folly::CPUThreadPoolExecutor* getExecutor();
+
   std::string hostname_;
   folly::IPAddress ipAddress_;
   std::string interface_;
   int port_;
-  std::chrono::milliseconds timeout_{1000};
   std::string endpoint_;
+
+  std::mutex lock_;
+  std::chrono::milliseconds timeout_{1000};
+  CURL* curl_{nullptr};
+  std::unordered_map<std::string, CachedOutput> cache_;
+
+  std::mutex executorLock_;
+  // Created on the first async request
+  std::unique_ptr<folly::CPUThreadPoolExecutor> executor_;
 };
 
 }} // namespace facebook::fboss
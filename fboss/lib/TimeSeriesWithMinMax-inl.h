@@ -2,243 +2,198 @@
 #include "TimeSeriesWithMinMax.h"
 
 #include <algorithm>
+#include <stdexcept>
 
 namespace facebook {
 namespace fboss {
 
+template <class ValueType>
+constexpr int64_t TimeSeriesWithMinMax<ValueType>::kNoBucket;
+
 /*
- * Add value into bucket. This will place the value in the most
- * recent bucket if it is within the bucket's time frame, else
- * it will create a new bucket at the end of the vector, and place
- * the value inside it.
+ * Add value into the bucket for the current time. As time only moves
+ * forward, this never lands in a slot holding a newer bucket.
  */
 template <class ValueType>
 void TimeSeriesWithMinMax<ValueType>::addValue(const ValueType& value) {
-  auto t = std::chrono::system_clock::now();
-  auto locked_buf = buf_.wlock();
-  auto last_bucket = locked_buf->size() == 0
-      ? nullptr
-      : &locked_buf->at(locked_buf->size() - 1);
-  if (last_bucket != nullptr && last_bucket->isTimeInBucket(t)) {
-    last_bucket->addValue(value);
-  } else {
-    Bucket b(t, bucketInterval_);
-    b.addValue(value);
-    locked_buf->push_back(std::move(b));
-  }
+  auto bucket = bucketOf(std::chrono::system_clock::now());
+  addValueLocked(&*buf_.wlock(), value, bucket);
 }
 
-/*
- * If the time is specified for the addition, then more
- * caution is required to maintain the integrity of the
- * structure.
- */
 template <class ValueType>
 void TimeSeriesWithMinMax<ValueType>::addValue(
     const ValueType& value,
     typename TimeSeriesWithMinMax<ValueType>::Time t) {
-  auto locked_buf = buf_.wlock();
-
   /*
    * If the time is out of the buffer, return.
    */
   if (t < std::chrono::system_clock::now() - interval_) {
     return;
   }
+  addValueLocked(&*buf_.wlock(), value, bucketOf(t));
+}
 
-  /*
-   * If the buffer is empty, add the first bucket to the
-   * end of the buffer.
-   */
-  if (locked_buf->size() == 0) {
-    Bucket b(t, bucketInterval_);
-    b.addValue(value);
-    locked_buf->push_back(std::move(b));
-    return;
+template <class ValueType>
+void TimeSeriesWithMinMax<ValueType>::addValues(
+    folly::Range<TimeSeriesWithMinMax* const*> series,
+    folly::Range<const ValueType*> values,
+    typename TimeSeriesWithMinMax<ValueType>::Time t) {
+  assert(series.size() == values.size());
+  auto now = std::chrono::system_clock::now();
+  for (size_t i = 0; i < series.size(); ++i) {
+    auto ts = series[i];
+    if (t < now - ts->interval_) {
+      continue;
+    }
+    ts->addValueLocked(&*ts->buf_.wlock(), values[i], ts->bucketOf(t));
   }
+}
 
-  /*
-   * Handle the case of the time being less than the earliest
-   * time in the buffer.
-   */
-  if (t < locked_buf->at(0).getInstantiatedTime()) {
-    Bucket b(t, bucketInterval_);
-    b.addValue(value);
-    locked_buf->insert(locked_buf->begin(), std::move(b));
+/*
+ * Bucket n lives in slot n % size. A slot holding an older bucket has
+ * expired and is started over, while a slot holding a newer one means value
+ * is too old to be kept.
+ */
+template <class ValueType>
+void TimeSeriesWithMinMax<ValueType>::addValueLocked(
+    Buckets* buf,
+    const ValueType& value,
+    int64_t bucket) {
+  auto slot = static_cast<size_t>(bucket % buf->size());
+  if (buf->ids[slot] > bucket) {
     return;
   }
-
-  /*
-   * Handle the case of the time being greater than the newest
-   * time in the buffer.
-   */
-  if (t > locked_buf->at(locked_buf->size() - 1).getInstantiatedTime() +
-          bucketInterval_) {
-    Bucket b(t, bucketInterval_);
-    b.addValue(value);
-    locked_buf->push_back(std::move(b));
+  if (buf->ids[slot] < bucket) {
+    buf->ids[slot] = bucket;
+    buf->maxes[slot] = value;
+    buf->mins[slot] = value;
+    buf->sums[slot] = value;
+    buf->counts[slot] = 1;
     return;
   }
+  buf->maxes[slot] = std::max(value, buf->maxes[slot]);
+  buf->mins[slot] = std::min(value, buf->mins[slot]);
+  buf->sums[slot] += value;
+  ++buf->counts[slot];
+}
 
-  /*
-   * Handle the case when we have to add a bucket in the middle
-   * of the buffer.
-   */
-  for (int i = 0; i < locked_buf->size(); i++) {
-    auto b = &locked_buf->at(i);
-    if (b->isTimeInBucket(t)) {
-      b->addValue(value);
-      return;
-    } else if (i + 1 < locked_buf->size()) {
-      if (t < locked_buf->at(i + 1).getInstantiatedTime() &&
-          t > b->getInstantiatedTime()) {
-        Bucket b(t, bucketInterval_);
-        b.addValue(value);
-        locked_buf->insert(locked_buf->begin() + i, std::move(b));
-        return;
-      }
-    }
-  }
+template <class ValueType>
+int64_t TimeSeriesWithMinMax<ValueType>::bucketOf(Time t) const {
+  return t.time_since_epoch().count() / bucketTicks_;
 }
 
 /*
- * Maintains the buffer. Enforces that all buckets within the
- * buffer are within the appropriate time frame, and that the
- * size of the buffer is not longer than expected.
+ * A bucket expires once the interval has passed since its start, which
+ * leaves exactly one bucket per slot.
  */
-template <class T>
-void TimeSeriesWithMinMax<T>::maintainBuffer(Time /*now*/) {
-  auto locked_buf = buf_.wlock();
-  // remove buckets that are out of date
-  locked_buf->erase(
-      std::remove_if(
-          locked_buf->begin(),
-          locked_buf->end(),
-          [&](Bucket b) {
-            return std::chrono::system_clock::now() - interval_ >=
-                b.getInstantiatedTime();
-          }),
-      locked_buf->end());
+template <class ValueType>
+int64_t TimeSeriesWithMinMax<ValueType>::oldestBucket(Time now) const {
+  return bucketOf(now) - numBuckets_ + 1;
 }
 
 /*
- * Return the maximum value in the buffer.
+ * Written so that each of the arrays is read once, in order, with selects
+ * rather than branches, which lets the compiler vectorize the loop.
  */
 template <class ValueType>
-ValueType TimeSeriesWithMinMax<ValueType>::getMax() {
-  maintainBuffer(std::chrono::system_clock::now());
-  auto locked_buf = buf_.rlock();
-  if (locked_buf->size() == 0) {
-    throw std::runtime_error("Empty Buffer!");
-  }
-  ValueType max = std::numeric_limits<ValueType>::lowest();
-  for (auto b : *locked_buf) {
-    max = std::max(max, b.getMax());
-  }
-  return max;
+typename TimeSeriesWithMinMax<ValueType>::Aggregate
+TimeSeriesWithMinMax<ValueType>::aggregate(
+    const Buckets& buf,
+    int64_t first,
+    int64_t last) {
+  Aggregate agg;
+  const auto size = buf.size();
+  const auto ids = buf.ids.data();
+  const auto maxes = buf.maxes.data();
+  const auto mins = buf.mins.data();
+  const auto sums = buf.sums.data();
+  const auto counts = buf.counts.data();
+  for (size_t i = 0; i < size; ++i) {
+    bool in = ids[i] >= first && ids[i] <= last;
+    agg.max = std::max(
+        agg.max, in ? maxes[i] : std::numeric_limits<ValueType>::lowest());
+    agg.min =
+        std::min(agg.min, in ? mins[i] : std::numeric_limits<ValueType>::max());
+    agg.sum += in ? sums[i] : ValueType();
+    agg.count += in ? counts[i] : 0;
+    agg.buckets += in;
+  }
+  return agg;
 }
 
 template <class ValueType>
-ValueType TimeSeriesWithMinMax<ValueType>::getMax(
-    typename TimeSeriesWithMinMax<ValueType>::Time start,
-    typename TimeSeriesWithMinMax<ValueType>::Time end) {
-  maintainBuffer(std::chrono::system_clock::now());
-  auto locked_buf = buf_.rlock();
-
-  if (locked_buf->size() == 0) {
+typename TimeSeriesWithMinMax<ValueType>::Aggregate
+TimeSeriesWithMinMax<ValueType>::aggregateRange(
+    Time start,
+    Time end,
+    bool all) {
+  auto oldest = oldestBucket(std::chrono::system_clock::now());
+  auto buf = buf_.rlock();
+  auto agg = aggregate(*buf, oldest, std::numeric_limits<int64_t>::max());
+  if (agg.buckets == 0) {
     throw std::runtime_error("Empty Buffer!");
   }
-
-  ValueType max = std::numeric_limits<ValueType>::lowest();
-  bool isValid = false;
-  for (auto b : *locked_buf) {
-    auto t = b.getInstantiatedTime();
-    if (t >= start && t < end) {
-      isValid = true;
-      max = std::max(b.getMax(), max);
-    }
+  if (all) {
+    return agg;
   }
-  if (!isValid) {
+
+  // The buckets whose start is in [start, end)
+  auto first =
+      (start.time_since_epoch().count() + bucketTicks_ - 1) / bucketTicks_;
+  auto last =
+      (end.time_since_epoch().count() + bucketTicks_ - 1) / bucketTicks_ - 1;
+  agg = aggregate(*buf, std::max(first, oldest), last);
+  if (agg.buckets == 0) {
     throw std::runtime_error("Bad range specified");
   }
-  return max;
+  return agg;
 }
 
 /*
- * Return the minimum value in the buffer.
+ * Return the maximum value in the buffer.
  */
 template <class ValueType>
-ValueType TimeSeriesWithMinMax<ValueType>::getMin() {
-  maintainBuffer(std::chrono::system_clock::now());
-  auto locked_buf = buf_.rlock();
-  if (locked_buf->size() == 0) {
-    throw std::runtime_error("Empty Buffer!");
-  }
-  ValueType min = std::numeric_limits<ValueType>::max();
-  for (auto b : *locked_buf) {
-    min = std::min(min, b.getMin());
-  }
-  return min;
+ValueType TimeSeriesWithMinMax<ValueType>::getMax() {
+  return aggregateRange(Time(), Time(), true).max;
 }
 
 template <class ValueType>
-ValueType TimeSeriesWithMinMax<ValueType>::getMin(
+ValueType TimeSeriesWithMinMax<ValueType>::getMax(
     typename TimeSeriesWithMinMax<ValueType>::Time start,
     typename TimeSeriesWithMinMax<ValueType>::Time end) {
-  maintainBuffer(std::chrono::system_clock::now());
-  auto locked_buf = buf_.rlock();
-
-  if (locked_buf->size() == 0) {
-    throw std::runtime_error("Empty Buffer!");
-  }
-
-  ValueType min = std::numeric_limits<ValueType>::max();
-  bool isValid = false;
-  for (auto b : *locked_buf) {
-    auto t = b.getInstantiatedTime();
-    if (t >= start && t < end) {
-      isValid = true;
-      min = std::min(b.getMin(), min);
-    }
-  }
-  if (!isValid) {
-    throw std::runtime_error("Bad range specified");
-  }
-  return min;
+  return aggregateRange(start, end, false).max;
 }
 
 /*
- * Create a Bucket object. This will create a bucket granular
- * to the bucket interval.
+ * Return the minimum value in the buffer.
  */
 template <class ValueType>
-TimeSeriesWithMinMax<ValueType>::Bucket::Bucket(Time now, Duration width)
-    : width_(width) {
-  auto epoch = std::chrono::duration_cast<Duration>(now.time_since_epoch());
-  auto leftover = epoch % width;
-  startTime_ = now - leftover;
+ValueType TimeSeriesWithMinMax<ValueType>::getMin() {
+  return aggregateRange(Time(), Time(), true).min;
 }
 
-/*
- * This function does not check that the value is
- * within the time expected for the buffer. For correct
- * usage, the user must check this for themselves.
- */
 template <class ValueType>
-void TimeSeriesWithMinMax<ValueType>::Bucket::addValue(const ValueType& value) {
-  max_ = std::max(value, max_);
-  min_ = std::min(value, min_);
+ValueType TimeSeriesWithMinMax<ValueType>::getMin(
+    typename TimeSeriesWithMinMax<ValueType>::Time start,
+    typename TimeSeriesWithMinMax<ValueType>::Time end) {
+  return aggregateRange(start, end, false).min;
 }
 
+/*
+ * Return the average of all the values in the buffer.
+ */
 template <class ValueType>
-bool TimeSeriesWithMinMax<ValueType>::Bucket::isTimeInBucket(Time time) {
-  return time >= startTime_ && time <= startTime_ + width_;
+ValueType TimeSeriesWithMinMax<ValueType>::getAverage() {
+  auto agg = aggregateRange(Time(), Time(), true);
+  return agg.sum / agg.count;
 }
 
 template <class ValueType>
-typename TimeSeriesWithMinMax<ValueType>::Time
-TimeSeriesWithMinMax<ValueType>::Bucket::getInstantiatedTime() const{
-  return startTime_;
+ValueType TimeSeriesWithMinMax<ValueType>::getAverage(
+    typename TimeSeriesWithMinMax<ValueType>::Time start,
+    typename TimeSeriesWithMinMax<ValueType>::Time end) {
+  auto agg = aggregateRange(start, end, false);
+  return agg.sum / agg.count;
 }
 }
 }
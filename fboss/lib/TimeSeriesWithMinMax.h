@@ -2,11 +2,13 @@
 
 #pragma once
 
+#include <folly/Range.h>
 #include <folly/Synchronized.h>
+#include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <limits>
-#include <numeric>
-#include <boost/circular_buffer.hpp>
+#include <vector>
 
 namespace facebook {
 namespace fboss {
@@ -20,6 +22,12 @@ namespace fboss {
  * allows for configuration of the length of time to record over,
  * and the granularity of the data recorded. This structure's functions
  * are all thread safe, and are intended to be used for data logging.
+ *
+ * The buckets are slots of a ring indexed by bucket number, with the max,
+ * min, sum and count of all the buckets each kept in an array of their
+ * own. Aggregating over a window is a branch-free pass over those arrays,
+ * which the compiler can vectorize, and nothing is allocated once the
+ * series is constructed.
  */
 template <class ValueType>
 class TimeSeriesWithMinMax {
@@ -34,18 +42,19 @@ class TimeSeriesWithMinMax {
    * Instantiate a time series.
    * interval : Length of time to record max over.
    * bucketInterval : The granularity of the data.
-   * The class relies on the buffer's buckets being sorted
-   * by time covered.
    */
   explicit TimeSeriesWithMinMax(
       Duration interval = Duration(60),
       Duration bucketInterval = Duration(1))
-      : interval_(interval), bucketInterval_(bucketInterval) {
+      : interval_(interval),
+        bucketInterval_(bucketInterval),
+        numBuckets_(interval.count() / bucketInterval.count()),
+        bucketTicks_(std::chrono::duration_cast<Time::duration>(bucketInterval)
+                         .count()) {
     assert(interval.count() >= bucketInterval.count());
     assert(bucketInterval.count() > 0);
     assert(interval.count() > 0);
-    buf_ = boost::circular_buffer<Bucket>(
-        interval.count() / bucketInterval_.count());
+    buf_.wlock()->resize(numBuckets_);
   }
 
   /*
@@ -58,6 +67,16 @@ class TimeSeriesWithMinMax {
    */
   void addValue(const ValueType& value, Time t);
 
+  /*
+   * Add values[i] into series[i] for each i, all at time t, e.g. when
+   * sampling the queues of all the ports at once. Both ranges must be the
+   * same size.
+   */
+  static void addValues(
+      folly::Range<TimeSeriesWithMinMax* const*> series,
+      folly::Range<const ValueType*> values,
+      Time t = std::chrono::system_clock::now());
+
   /*
    * Get the current maximum value of the buffer.
    */
@@ -78,62 +97,77 @@ class TimeSeriesWithMinMax {
    */
   ValueType getMin(Time start, Time end);
 
+  /*
+   * Get the current average value of the buffer.
+   */
+  ValueType getAverage();
+
+  /*
+   * Get the average value over an interval
+   */
+  ValueType getAverage(Time start, Time end);
 
  private:
   /*
-   * Internal bucket class to keep granularity of data.
+   * The buckets, structure of arrays style. Slot i holds bucket number
+   * ids[i], counted in bucket intervals since the epoch, or kNoBucket.
    */
-  class Bucket {
-   public:
-    /*
-     * Construct a Bucket object.
-     */
-    Bucket(Time now, Duration width);
-
-    /*
-     * Add a value into a bucket.
-     */
-    void addValue(const ValueType& value);
-
-    /*
-     * Field querying methods.
-     */
-    bool isTimeInBucket(Time time);
-
-    Time getInstantiatedTime() const;
-
-    ValueType getMax() const {
-      return max_;
+  struct Buckets {
+    void resize(size_t slots) {
+      ids.assign(slots, kNoBucket);
+      maxes.assign(slots, std::numeric_limits<ValueType>::lowest());
+      mins.assign(slots, std::numeric_limits<ValueType>::max());
+      sums.assign(slots, ValueType());
+      counts.assign(slots, 0);
     }
-
-    ValueType getMin() const {
-      return min_;
+    size_t size() const {
+      return ids.size();
     }
 
-   private:
-    ValueType max_ = std::numeric_limits<ValueType>::lowest();
-    ValueType min_ = std::numeric_limits<ValueType>::max();
-    Time startTime_;
-    Duration width_;
+    std::vector<int64_t> ids;
+    std::vector<ValueType> maxes;
+    std::vector<ValueType> mins;
+    std::vector<ValueType> sums;
+    std::vector<uint64_t> counts;
   };
 
+  // Aggregates of the buckets numbered first to last
+  struct Aggregate {
+    ValueType max = std::numeric_limits<ValueType>::lowest();
+    ValueType min = std::numeric_limits<ValueType>::max();
+    ValueType sum = ValueType();
+    uint64_t count = 0;
+    size_t buckets = 0;
+  };
+
+  static constexpr int64_t kNoBucket = std::numeric_limits<int64_t>::min();
+
+  // The number of the bucket t falls in
+  int64_t bucketOf(Time t) const;
+  // The oldest bucket still within the interval
+  int64_t oldestBucket(Time now) const;
+  void addValueLocked(Buckets* buf, const ValueType& value, int64_t bucket);
+  static Aggregate
+  aggregate(const Buckets& buf, int64_t first, int64_t last);
   /*
-   * Internal method to restrict buffer length, and remove buckets
-   * from outside of the time window.
+   * Aggregate the buckets starting in [start, end), or all of the buckets
+   * with no range. Throws if there are none.
    */
-  void maintainBuffer(Time now);
+  Aggregate aggregateRange(Time start, Time end, bool all);
 
   /*
    * Local copies of constructor arguments.
    */
   Duration interval_;
   Duration bucketInterval_;
+  int64_t numBuckets_;
+  // bucketInterval_ in clock ticks
+  int64_t bucketTicks_;
 
   /*
-   * Vector structure to hold buckets of data. Using folly
-   * Synchronized provides the thread-safety needed.
+   * Using folly Synchronized provides the thread-safety needed.
    */
-  folly::Synchronized<boost::circular_buffer<Bucket>> buf_;
+  folly::Synchronized<Buckets> buf_;
 };
 }
 }
@@ -0,0 +1,153 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "common/base/Random.h"
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include "fboss/lib/ConcurrentRadixTree.h"
+
+using namespace facebook::network;
+using namespace std;
+
+namespace {
+using IPAddressV4 = folly::IPAddressV4;
+using IPAddressV6 = folly::IPAddressV6;
+
+// Longest match the slow way, from every prefix in the table
+const int* expectedMatch(
+    const map<pair<IPAddressV4, uint8_t>, int>& table,
+    const IPAddressV4& ip) {
+  for (int masklen = 32; masklen >= 0; --masklen) {
+    auto it = table.find(make_pair(ip.mask(masklen), masklen));
+    if (it != table.end()) {
+      return &it->second;
+    }
+  }
+  return nullptr;
+}
+} // unnamed namespace
+
+TEST(ConcurrentRadixTree, InsertEraseLookup) {
+  ConcurrentRadixTree<IPAddressV4, int> tree;
+  EXPECT_FALSE(tree.longestMatch(IPAddressV4("10.0.0.1"), 32));
+
+  EXPECT_TRUE(tree.insertOrAssign(IPAddressV4("10.0.0.0"), 8, 1));
+  EXPECT_TRUE(tree.insertOrAssign(IPAddressV4("10.1.0.0"), 16, 2));
+  EXPECT_TRUE(tree.insertOrAssign(IPAddressV4("10.1.2.0"), 24, 3));
+  // Not masked, stored as 11.0.0.0/8
+  EXPECT_TRUE(tree.insertOrAssign(IPAddressV4("11.2.3.4"), 8, 4));
+  EXPECT_EQ(4, tree.size());
+
+  EXPECT_EQ(3, *tree.longestMatch(IPAddressV4("10.1.2.3"), 32));
+  EXPECT_EQ(2, *tree.longestMatch(IPAddressV4("10.1.3.3"), 32));
+  EXPECT_EQ(1, *tree.longestMatch(IPAddressV4("10.2.0.0"), 16));
+  EXPECT_EQ(4, *tree.longestMatch(IPAddressV4("11.0.0.1"), 32));
+  EXPECT_FALSE(tree.longestMatch(IPAddressV4("12.0.0.1"), 32));
+  EXPECT_EQ(2, *tree.exactMatch(IPAddressV4("10.1.0.0"), 16));
+  EXPECT_FALSE(tree.exactMatch(IPAddressV4("10.1.0.0"), 20));
+
+  // Replacing a value doesn't add a prefix
+  EXPECT_FALSE(tree.insertOrAssign(IPAddressV4("10.1.0.0"), 16, 5));
+  EXPECT_EQ(4, tree.size());
+  EXPECT_EQ(5, *tree.longestMatch(IPAddressV4("10.1.3.3"), 32));
+
+  EXPECT_TRUE(tree.erase(IPAddressV4("10.1.0.0"), 16));
+  EXPECT_FALSE(tree.erase(IPAddressV4("10.1.0.0"), 16));
+  EXPECT_EQ(3, tree.size());
+  EXPECT_EQ(1, *tree.longestMatch(IPAddressV4("10.1.3.3"), 32));
+  EXPECT_EQ(3, *tree.longestMatch(IPAddressV4("10.1.2.3"), 32));
+
+  tree.clear();
+  EXPECT_EQ(0, tree.size());
+  EXPECT_TRUE(tree.snapshot().empty());
+}
+
+TEST(ConcurrentRadixTree, SnapshotsDontChange) {
+  ConcurrentRadixTree<IPAddressV6, int> tree;
+  tree.insertOrAssign(IPAddressV6("2401:db00::"), 32, 1);
+  auto before = tree.snapshot();
+
+  tree.insertOrAssign(IPAddressV6("2401:db00::"), 32, 2);
+  tree.insertOrAssign(IPAddressV6("2401:db00:1::"), 48, 3);
+  auto after = tree.snapshot();
+  tree.erase(IPAddressV6("2401:db00::"), 32);
+
+  auto ip = IPAddressV6("2401:db00:1::1");
+  ASSERT_NE(nullptr, before.longestMatch(ip, 128));
+  EXPECT_EQ(1, *before.longestMatch(ip, 128));
+  EXPECT_EQ(nullptr, before.exactMatch(IPAddressV6("2401:db00:1::"), 48));
+  ASSERT_NE(nullptr, after.exactMatch(IPAddressV6("2401:db00::"), 32));
+  EXPECT_EQ(2, *after.exactMatch(IPAddressV6("2401:db00::"), 32));
+  EXPECT_EQ(3, *after.longestMatch(ip, 128));
+  EXPECT_EQ(
+      nullptr, tree.snapshot().exactMatch(IPAddressV6("2401:db00::"), 32));
+}
+
+TEST(ConcurrentRadixTree, MatchesTable) {
+  ConcurrentRadixTree<IPAddressV4, int> tree;
+  map<pair<IPAddressV4, uint8_t>, int> table;
+  for (auto i = 0; i < 20000; ++i) {
+    // Prefixes under 10.0.0.0/12, so that they nest and share paths
+    auto masklen = folly::Random::rand32(33);
+    auto ip = IPAddressV4::fromLongHBO(
+        (10u << 24) | (folly::Random::rand32() & 0x000fffff)).mask(masklen);
+    auto key = make_pair(ip, static_cast<uint8_t>(masklen));
+    if (folly::Random::rand32(3) == 0) {
+      EXPECT_EQ(table.erase(key) == 1, tree.erase(ip, masklen));
+    } else {
+      EXPECT_EQ(table.count(key) == 0, tree.insertOrAssign(ip, masklen, i));
+      table[key] = i;
+    }
+    ASSERT_EQ(table.size(), tree.size());
+
+    if (i % 1000 == 0) {
+      auto snap = tree.snapshot();
+      for (auto j = 0; j < 1000; ++j) {
+        auto addr = IPAddressV4::fromLongHBO(
+            (10u << 24) | (folly::Random::rand32() & 0x000fffff));
+        auto expected = expectedMatch(table, addr);
+        auto match = snap.longestMatch(addr, 32);
+        ASSERT_EQ(expected == nullptr, match == nullptr) << addr;
+        if (expected) {
+          EXPECT_EQ(*expected, *match) << addr;
+        }
+      }
+    }
+  }
+}
+
+TEST(ConcurrentRadixTree, ConcurrentReaders) {
+  ConcurrentRadixTree<IPAddressV4, int> tree;
+  tree.insertOrAssign(IPAddressV4("0.0.0.0"), 0, -1);
+  atomic<bool> done{false};
+  atomic<int> lookupFailures{0};
+  vector<thread> readers;
+  for (auto i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        auto addr = IPAddressV4::fromLongHBO(folly::Random::rand32());
+        // The default route is always there, whatever else changes
+        if (!tree.longestMatch(addr, 32)) {
+          ++lookupFailures;
+        }
+      }
+    });
+  }
+  for (uint32_t i = 0; i < 100000; ++i) {
+    auto ip = IPAddressV4::fromLongHBO(i * 2654435761u).mask(24);
+    tree.insertOrAssign(ip, 24, i);
+    if (i % 2) {
+      tree.erase(ip, 24);
+    }
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, lookupFailures);
+}
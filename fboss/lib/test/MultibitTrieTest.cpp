@@ -0,0 +1,150 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <set>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/base/Random.h"
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include "fboss/lib/MultibitTrie.h"
+#include "fboss/lib/RadixTree.h"
+#include "Utils.h"
+
+using namespace facebook;
+using namespace facebook::network;
+using namespace std;
+
+namespace {
+using IPAddressV4 = folly::IPAddressV4;
+using IPAddressV6 = folly::IPAddressV6;
+
+IPAddressV6 randomV6() {
+  ByteArray16 ba;
+  *(uint64_t*)(&ba[0]) = folly::Random::rand64();
+  *(uint64_t*)(&ba[8]) = folly::Random::rand64();
+  return IPAddressV6(ba);
+}
+
+// Check that trie and rtree hold the same prefixes and agree on every lookup
+template <typename IPADDRTYPE>
+void checkLookups(const MultibitTrie<IPADDRTYPE, int>& trie,
+    const RadixTree<IPADDRTYPE, int>& rtree,
+    const vector<pair<IPADDRTYPE, uint8_t>>& lookups) {
+  ASSERT_EQ(rtree.size(), trie.size());
+  for (const auto& lookup : lookups) {
+    auto rmatch = rtree.longestMatch(lookup.first, lookup.second);
+    auto tmatch = trie.longestMatch(lookup.first, lookup.second);
+    ASSERT_EQ(rmatch == rtree.end(), tmatch == trie.end());
+    if (rmatch != rtree.end()) {
+      EXPECT_EQ(rmatch->ipAddress(), tmatch->ipAddress());
+      EXPECT_EQ(rmatch->masklen(), tmatch->masklen());
+      EXPECT_EQ(rmatch->value(), tmatch->value());
+    }
+    auto rexact = rtree.exactMatch(lookup.first, lookup.second);
+    auto texact = trie.exactMatch(lookup.first, lookup.second);
+    EXPECT_EQ(rexact == rtree.end(), texact == trie.end());
+  }
+}
+} // namespace
+
+TEST(MultibitTrie, Basic4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  EXPECT_TRUE(trie.insert(IPAddressV4("10.0.0.0"), 8, 1).second);
+  EXPECT_TRUE(trie.insert(IPAddressV4("10.1.0.0"), 16, 2).second);
+  EXPECT_TRUE(trie.insert(IPAddressV4("10.1.1.0"), 24, 3).second);
+  EXPECT_TRUE(trie.insert(IPAddressV4("0.0.0.0"), 0, 4).second);
+  EXPECT_FALSE(trie.insert(IPAddressV4("10.1.1.0"), 24, 5).second);
+  EXPECT_EQ(4, trie.size());
+
+  EXPECT_EQ(3, trie.longestMatch(IPAddressV4("10.1.1.1"), 32)->value());
+  EXPECT_EQ(2, trie.longestMatch(IPAddressV4("10.1.2.1"), 32)->value());
+  EXPECT_EQ(1, trie.longestMatch(IPAddressV4("10.2.2.1"), 32)->value());
+  EXPECT_EQ(4, trie.longestMatch(IPAddressV4("11.2.2.1"), 32)->value());
+  // Prefix lookups only match prefixes no longer than the mask
+  EXPECT_EQ(2, trie.longestMatch(IPAddressV4("10.1.1.0"), 23)->value());
+  EXPECT_EQ(1, trie.longestMatch(IPAddressV4("10.1.1.0"), 15)->value());
+  EXPECT_EQ(4, trie.longestMatch(IPAddressV4("10.1.1.0"), 0)->value());
+
+  EXPECT_TRUE(trie.erase(IPAddressV4("10.1.0.0"), 16));
+  EXPECT_FALSE(trie.erase(IPAddressV4("10.1.0.0"), 16));
+  EXPECT_EQ(1, trie.longestMatch(IPAddressV4("10.1.2.1"), 32)->value());
+  EXPECT_TRUE(trie.erase(IPAddressV4("0.0.0.0"), 0));
+  EXPECT_EQ(trie.end(), trie.longestMatch(IPAddressV4("11.2.2.1"), 32));
+
+  trie.clear();
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(0, trie.numNodes());
+}
+
+TEST(MultibitTrie, RadixTreeCompare4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  RadixTree<IPAddressV4, int> rtree;
+  vector<pair<IPAddressV4, uint8_t>> inserted;
+  vector<pair<IPAddressV4, uint8_t>> lookups;
+  for (auto i = 0; i < 5000; ++i) {
+    auto mask = folly::Random::rand32(33);
+    auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+    EXPECT_EQ(rtree.insert(ip, mask, i).second, trie.insert(ip, mask, i).second);
+    inserted.emplace_back(ip, mask);
+    lookups.emplace_back(ip, folly::Random::rand32(mask + 1));
+    lookups.emplace_back(IPAddressV4::fromLongHBO(folly::Random::rand32()), 32);
+  }
+  checkLookups(trie, rtree, lookups);
+
+  for (auto i = 0; i < 2000; ++i) {
+    const auto& pfx = inserted[folly::Random::rand32(inserted.size())];
+    EXPECT_EQ(rtree.erase(pfx.first, pfx.second),
+        trie.erase(pfx.first, pfx.second));
+  }
+  checkLookups(trie, rtree, lookups);
+
+  for (const auto& pfx : inserted) {
+    trie.erase(pfx.first, pfx.second);
+  }
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(0, trie.numNodes());
+}
+
+TEST(MultibitTrie, RadixTreeCompare6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  RadixTree<IPAddressV6, int> rtree;
+  vector<pair<IPAddressV6, uint8_t>> inserted;
+  vector<pair<IPAddressV6, uint8_t>> lookups;
+  for (auto i = 0; i < 5000; ++i) {
+    auto mask = folly::Random::rand32(129);
+    auto ip = randomV6().mask(mask);
+    EXPECT_EQ(rtree.insert(ip, mask, i).second, trie.insert(ip, mask, i).second);
+    inserted.emplace_back(ip, mask);
+    lookups.emplace_back(ip, folly::Random::rand32(mask + 1));
+    lookups.emplace_back(randomV6(), 128);
+  }
+  checkLookups(trie, rtree, lookups);
+
+  for (auto i = 0; i < 2000; ++i) {
+    const auto& pfx = inserted[folly::Random::rand32(inserted.size())];
+    EXPECT_EQ(rtree.erase(pfx.first, pfx.second),
+        trie.erase(pfx.first, pfx.second));
+  }
+  checkLookups(trie, rtree, lookups);
+}
+
+TEST(MultibitTrie, Iterator) {
+  MultibitTrie<IPAddressV4, int> trie;
+  set<Prefix4> expected;
+  for (auto i = 0; i < 1000; ++i) {
+    auto mask = folly::Random::rand32(33);
+    auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+    trie.insert(ip, mask, i);
+    expected.insert(Prefix4(ip, mask));
+  }
+  auto expectedItr = expected.begin();
+  for (auto itr : trie) {
+    ASSERT_NE(expected.end(), expectedItr);
+    EXPECT_EQ(expectedItr->ip, itr->ipAddress());
+    EXPECT_EQ(expectedItr->mask, itr->masklen());
+    ++expectedItr;
+  }
+  EXPECT_EQ(expected.end(), expectedItr);
+}
@@ -9,6 +9,8 @@
  */
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "FakePhysicalMemory.h"
 
 namespace {
@@ -69,5 +71,41 @@ TEST(PhysicalMemoryTest, io) {
   }
 }
 
+TEST(PhysicalMemoryTest, rangeIO) {
+  auto testRangeIO = [](auto& pm, auto value) {
+    using ValueT = decltype(value);
+    constexpr uint32_t OFFSET = 200;
+    pm.mmap();
+    std::vector<ValueT> values{1, 2, 3, 4};
+    pm.write(OFFSET, values.data(), values.size());
+    for (auto i = 0; i < 4; i++) {
+      EXPECT_EQ(pm.read(OFFSET + i * sizeof(ValueT)), i + 1);
+    }
+    std::vector<ValueT> read(4);
+    pm.read(OFFSET, read.data(), read.size());
+    EXPECT_EQ(values, read);
+    EXPECT_EQ(values, pm.snapshot(OFFSET, 4));
+
+    // The whole range must fit
+    EXPECT_EQ(1, pm.snapshot(kFakeSize - sizeof(ValueT), 1).size());
+    EXPECT_DEATH(pm.snapshot(kFakeSize - sizeof(ValueT), 2), "");
+  };
+
+  {
+    FakePhysicalMemory8 p8{kFakePhysicalAddr, kFakeSize};
+    testRangeIO(p8, uint8_t());
+  }
+
+  {
+    FakePhysicalMemory16 p16{kFakePhysicalAddr, kFakeSize};
+    testRangeIO(p16, uint16_t());
+  }
+
+  {
+    FakePhysicalMemory32 p32{kFakePhysicalAddr, kFakeSize};
+    testRangeIO(p32, uint32_t());
+  }
+}
+
 } // namespace fboss
 } // namespace facebook
@@ -0,0 +1,68 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+#include "fboss/lib/QuantileSketch.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+TEST(QuantileSketch, Buckets) {
+  // Small values are exact, then every bucket follows the previous one
+  for (int64_t v = 0; v < QuantileSketch::kSubBuckets; ++v) {
+    EXPECT_EQ(v, QuantileSketch::bucketOf(v));
+  }
+  for (size_t b = 1; b < QuantileSketch::kNumBuckets; ++b) {
+    EXPECT_EQ(
+        QuantileSketch::bucketHigh(b - 1) + 1, QuantileSketch::bucketLow(b));
+    EXPECT_EQ(b, QuantileSketch::bucketOf(QuantileSketch::bucketLow(b)));
+    EXPECT_EQ(b, QuantileSketch::bucketOf(QuantileSketch::bucketHigh(b)));
+  }
+  EXPECT_EQ(
+      QuantileSketch::kMaxValue,
+      QuantileSketch::bucketHigh(QuantileSketch::kNumBuckets - 1));
+  EXPECT_EQ(
+      QuantileSketch::kNumBuckets - 1,
+      QuantileSketch::bucketOf(QuantileSketch::kMaxValue + 1000));
+  EXPECT_EQ(0, QuantileSketch::bucketOf(-5));
+}
+
+TEST(QuantileSketch, Quantiles) {
+  QuantileSketch sketch;
+  EXPECT_EQ(0, sketch.quantile(0.5));
+
+  for (int64_t v = 1; v <= 10000; ++v) {
+    sketch.addValue(v);
+  }
+  EXPECT_DOUBLE_EQ(10000, sketch.count());
+  // Within the relative error of the buckets
+  EXPECT_NEAR(5000, sketch.quantile(0.5), 5000 / QuantileSketch::kSubBuckets);
+  EXPECT_NEAR(9900, sketch.quantile(0.99), 9900 / QuantileSketch::kSubBuckets);
+  EXPECT_NEAR(
+      9990, sketch.quantile(0.999), 9990 / QuantileSketch::kSubBuckets);
+  EXPECT_EQ(1, sketch.quantile(0));
+  EXPECT_NEAR(10000, sketch.quantile(1), 10000 / QuantileSketch::kSubBuckets);
+}
+
+TEST(QuantileSketch, MergeAndDecay) {
+  QuantileSketch low;
+  QuantileSketch high;
+  for (int i = 0; i < 100; ++i) {
+    low.addValue(10);
+    high.addValue(1000);
+  }
+  low.merge(high);
+  EXPECT_DOUBLE_EQ(200, low.count());
+  EXPECT_EQ(10, low.quantile(0.25));
+  EXPECT_NEAR(1000, low.quantile(0.75), 1000 / QuantileSketch::kSubBuckets);
+
+  // Once the old samples have decayed, the new ones dominate
+  low.decay(0.01);
+  for (int i = 0; i < 100; ++i) {
+    low.addValue(10);
+  }
+  EXPECT_NEAR(102, low.count(), 1e-9);
+  EXPECT_EQ(10, low.quantile(0.99));
+
+  low.clear();
+  EXPECT_EQ(0, low.count());
+  EXPECT_EQ(0, low.quantile(0.5));
+}
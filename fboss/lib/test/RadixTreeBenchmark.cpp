@@ -1,5 +1,6 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 
+#include <map>
 #include <set>
 #include <vector>
 #include "common/init/Init.h"
@@ -7,6 +8,7 @@
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include <folly/Benchmark.h>
+#include "fboss/lib/MultibitTrie.h"
 #include "fboss/lib/RadixTree.h"
 #include "PyRadixWrapper.h"
 
@@ -30,6 +32,8 @@ set<Prefix6> insertSet6;
 set<Prefix6> eraseSet6;
 set<Prefix6> exactMatchSet6;
 set<Prefix6> longestMatchSet6;
+vector<IPAddressV4> hostLookupSet4;
+vector<IPAddressV6> hostLookupSet6;
 vector<int>  valueSet;
 
 // V4 Benchmarks
@@ -111,6 +115,101 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch4) {
   }
 }
 
+BENCHMARK(RadixTreeClone4) {
+  RadixTree<IPAddressV4, int> rtree;
+  BENCHMARK_SUSPEND {
+    setupTree4(rtree);
+  }
+  auto copy = rtree.clone();
+  BENCHMARK_SUSPEND {
+    copy.clear();
+  }
+}
+
+BENCHMARK_RELATIVE(MultibitTrieLongestMatch4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree4(trie);
+  }
+  for (auto pfx: longestMatchSet4) {
+    trie.longestMatch(pfx.ip, pfx.mask);
+  }
+}
+
+// Full length (host address) lookups, as done on the forwarding slow path
+BENCHMARK(RadixTreeHostLookup4) {
+  RadixTree<IPAddressV4, int> rtree;
+  BENCHMARK_SUSPEND {
+    setupTree4(rtree);
+  }
+  for (auto ip: hostLookupSet4) {
+    rtree.longestMatch(ip, 32);
+  }
+}
+
+BENCHMARK_RELATIVE(MultibitTrieHostLookup4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree4(trie);
+  }
+  for (auto ip: hostLookupSet4) {
+    trie.longestMatch(ip, 32);
+  }
+}
+
+// Building a whole table at once, as warm boot does, one prefix at a time
+// or with assignSorted()
+using SortedEntries4 = vector<pair<pair<IPAddressV4, uint8_t>, int>>;
+
+const SortedEntries4& sortedEntries4(size_t count) {
+  static map<size_t, SortedEntries4> entriesByCount;
+  auto& entries = entriesByCount[count];
+  if (entries.empty()) {
+    set<Prefix4> prefixes;
+    while (prefixes.size() < count) {
+      // Mostly /24s and longer, as in a full routing table
+      auto mask = 8 + folly::Random::rand32(25);
+      auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+      prefixes.insert(Prefix4(ip, mask));
+    }
+    for (const auto& pfx : prefixes) {
+      entries.push_back(make_pair(make_pair(pfx.ip, pfx.mask), pfx.mask));
+    }
+  }
+  return entries;
+}
+
+void radixTreeBuildInsert4(size_t iters, size_t count) {
+  const SortedEntries4* entries;
+  BENCHMARK_SUSPEND {
+    entries = &sortedEntries4(count);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    RadixTree<IPAddressV4, int> rtree;
+    for (const auto& entry : *entries) {
+      rtree.insert(entry.first.first, entry.first.second, entry.second);
+    }
+  }
+}
+
+void radixTreeBuildAssignSorted4(size_t iters, size_t count) {
+  const SortedEntries4* entries;
+  BENCHMARK_SUSPEND {
+    entries = &sortedEntries4(count);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    RadixTree<IPAddressV4, int> rtree;
+    rtree.assignSorted(entries->begin(), entries->end());
+  }
+}
+
+BENCHMARK_NAMED_PARAM(radixTreeBuildInsert4, 100k, 100000)
+BENCHMARK_RELATIVE_NAMED_PARAM(radixTreeBuildAssignSorted4, 100k, 100000)
+BENCHMARK_NAMED_PARAM(radixTreeBuildInsert4, 500k, 500000)
+BENCHMARK_RELATIVE_NAMED_PARAM(radixTreeBuildAssignSorted4, 500k, 500000)
+BENCHMARK_NAMED_PARAM(radixTreeBuildInsert4, 1M, 1000000)
+BENCHMARK_RELATIVE_NAMED_PARAM(radixTreeBuildAssignSorted4, 1M, 1000000)
+
 // V6 benchmarks
 
 template<typename TREE>
@@ -191,6 +290,36 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch6) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieLongestMatch6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree6(trie);
+  }
+  for (auto pfx: longestMatchSet6) {
+    trie.longestMatch(pfx.ip, pfx.mask);
+  }
+}
+
+BENCHMARK(RadixTreeHostLookup6) {
+  RadixTree<IPAddressV6, int> rtree;
+  BENCHMARK_SUSPEND {
+    setupTree6(rtree);
+  }
+  for (auto ip: hostLookupSet6) {
+    rtree.longestMatch(ip, 128);
+  }
+}
+
+BENCHMARK_RELATIVE(MultibitTrieHostLookup6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree6(trie);
+  }
+  for (auto ip: hostLookupSet6) {
+    trie.longestMatch(ip, 128);
+  }
+}
+
 }
 
 int main(int /*argc*/, char* /*argv*/ []) {
@@ -218,6 +347,9 @@ int main(int /*argc*/, char* /*argv*/ []) {
     auto newIp = pfx.ip.mask(newMask);
     longestMatchSet4.insert(Prefix4(newIp, newMask));
   }
+  while (hostLookupSet4.size() < FLAGS_lookup_count) {
+    hostLookupSet4.push_back(IPAddressV4::fromLongHBO(folly::Random::rand32()));
+  }
 
   // Generate random V6 prefixes
   vector<Prefix6> inserted6;
@@ -246,6 +378,12 @@ int main(int /*argc*/, char* /*argv*/ []) {
     auto newIp = pfx.ip.mask(newMask);
     longestMatchSet6.insert(Prefix6(newIp, newMask));
   }
+  while (hostLookupSet6.size() < FLAGS_lookup_count) {
+    ByteArray16 ba;
+    *(uint64_t*)(&ba[0]) = folly::Random::rand64();
+    *(uint64_t*)(&ba[8]) = folly::Random::rand64();
+    hostLookupSet6.push_back(IPAddressV6(ba));
+  }
   runBenchmarks();
 }
 
@@ -1322,6 +1322,74 @@ TEST(RadixTree, Clone) {
   EXPECT_TRUE(v6Tree == v6TreeCopy);
   EXPECT_TRUE(ipTree == ipTreeCopy);
 }
+/*
+ * Build trees with assignSorted() and compare them with the same prefixes
+ * inserted one by one
+ */
+TEST(RadixTree, AssignSorted) {
+  RadixTree<IPAddressV4, int> v4Tree;
+  RadixTree<IPAddressV6, int> v6Tree;
+  setupTestTree4(v4Tree);
+  setupTestTree6(v6Tree);
+  vector<pair<pair<IPAddressV4, uint8_t>, int>> v4Entries;
+  vector<pair<pair<IPAddressV6, uint8_t>, int>> v6Entries;
+  for (auto v4itr: v4Tree) {
+    v4Entries.push_back(make_pair(
+          make_pair(v4itr->ipAddress(), v4itr->masklen()), v4itr->value()));
+  }
+  for (auto v6itr: v6Tree) {
+    v6Entries.push_back(make_pair(
+          make_pair(v6itr->ipAddress(), v6itr->masklen()), v6itr->value()));
+  }
+  sort(v4Entries.begin(), v4Entries.end());
+  sort(v6Entries.begin(), v6Entries.end());
+
+  RadixTree<IPAddressV4, int> v4Bulk;
+  RadixTree<IPAddressV6, int> v6Bulk;
+  // Whatever the trees held before is replaced
+  v4Bulk.insert(IPAddressV4("10.0.0.0"), 8, 1);
+  v4Bulk.assignSorted(v4Entries.begin(), v4Entries.end());
+  v6Bulk.assignSorted(v6Entries.begin(), v6Entries.end());
+  EXPECT_TRUE(v4Tree == v4Bulk);
+  EXPECT_TRUE(v6Tree == v6Bulk);
+
+  v4Bulk.assignSorted(v4Entries.end(), v4Entries.end());
+  EXPECT_EQ(0, v4Bulk.size());
+  EXPECT_EQ(nullptr, v4Bulk.root());
+
+  // Random prefixes, moved into the tree
+  set<Prefix4> prefixes;
+  while (prefixes.size() < 1000) {
+    auto mask = folly::Random::rand32(33);
+    auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+    prefixes.insert(Prefix4(ip, mask));
+  }
+  RadixTree<IPAddressV4, int> rtree;
+  vector<pair<pair<IPAddressV4, uint8_t>, int>> entries;
+  for (const auto& pfx : prefixes) {
+    rtree.insert(pfx.ip, pfx.mask, pfx.mask);
+    entries.push_back(make_pair(make_pair(pfx.ip, pfx.mask), pfx.mask));
+  }
+  RadixTree<IPAddressV4, int> bulk;
+  bulk.assignSorted(std::make_move_iterator(entries.begin()),
+      std::make_move_iterator(entries.end()));
+  EXPECT_EQ(prefixes.size(), bulk.size());
+  EXPECT_TRUE(rtree == bulk);
+
+  // The built tree takes inserts and erases like any other
+  for (auto i = 0; i < 100; ++i) {
+    auto entry = *std::next(prefixes.begin(),
+        folly::Random::rand32(prefixes.size()));
+    rtree.erase(entry.ip, entry.mask);
+    bulk.erase(entry.ip, entry.mask);
+    auto mask = folly::Random::rand32(33);
+    auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+    rtree.insert(ip, mask, -1);
+    bulk.insert(ip, mask, -1);
+  }
+  EXPECT_TRUE(rtree == bulk);
+}
+
 /*
  * Compare with py-radix
  * Insert a set of random prefixes on both py-radix and our radix tree
@@ -69,3 +69,42 @@ TEST(TimeSeriesWithMinMax, BasicTest) {
   } catch (std::runtime_error& e) {
   }
 }
+
+TEST(TimeSeriesWithMinMax, Average) {
+  TimeSeriesWithMinMax<double> buffer(seconds(10), seconds(1));
+  auto now = std::chrono::system_clock::now();
+
+  buffer.addValue(1.0, now - seconds(4));
+  buffer.addValue(3.0, now - seconds(4));
+  buffer.addValue(8.0, now);
+  EXPECT_DOUBLE_EQ(buffer.getAverage(), 4.0);
+  EXPECT_DOUBLE_EQ(
+      buffer.getAverage(now - seconds(5), now - seconds(2)), 2.0);
+  EXPECT_DOUBLE_EQ(buffer.getAverage(now - seconds(1), now + seconds(1)), 8.0);
+  EXPECT_THROW(
+      buffer.getAverage(now - seconds(3), now - seconds(2)),
+      std::runtime_error);
+}
+
+TEST(TimeSeriesWithMinMax, AddValues) {
+  TimeSeriesWithMinMax<int> first(seconds(10), seconds(1));
+  TimeSeriesWithMinMax<int> second(seconds(10), seconds(1));
+  TimeSeriesWithMinMax<int>* series[] = {&first, &second};
+  const int values[] = {4, 9};
+  auto now = std::chrono::system_clock::now();
+
+  TimeSeriesWithMinMax<int>::addValues(
+      folly::range(series), folly::range(values), now - seconds(2));
+  first.addValue(6, now);
+  EXPECT_EQ(first.getMax(), 6);
+  EXPECT_EQ(first.getMin(), 4);
+  EXPECT_EQ(second.getMax(), 9);
+  EXPECT_EQ(second.getMax(now - seconds(3), now - seconds(1)), 9);
+  EXPECT_THROW(
+      second.getMax(now - seconds(1), now + seconds(1)), std::runtime_error);
+
+  // Too old for the interval
+  TimeSeriesWithMinMax<int>::addValues(
+      folly::range(series), folly::range(values), now - seconds(20));
+  EXPECT_EQ(first.getMin(), 4);
+}
@@ -11,6 +11,8 @@
 #include "fboss/lib/usb/BaseWedgeI2CBus.h"
 #include "fboss/lib/usb/UsbError.h"
 
+#include <folly/ScopeGuard.h>
+
 using folly::MutableByteRange;
 using std::lock_guard;
 
@@ -22,6 +24,7 @@ void BaseWedgeI2CBus::open() {
   selectedPort_ = NO_PORT;
   verifyBus(true);
   initBus();
+  selectionValid_ = true;
 
   VLOG(4) << "successfully opened wedge CP2112 I2C bus";
 }
@@ -79,9 +82,6 @@ void BaseWedgeI2CBus::moduleRead(unsigned int module, uint8_t address,
   CHECK_NE(selectedPort_, NO_PORT);
 
   read(address, offset, len, buf);
-
-  // TODO: remove this after we ensure exclusive access to cp2112 chip
-  unselectQsfp();
 }
 
 void BaseWedgeI2CBus::moduleWrite(unsigned int module, uint8_t address,
@@ -90,23 +90,39 @@ void BaseWedgeI2CBus::moduleWrite(unsigned int module, uint8_t address,
   CHECK_NE(selectedPort_, NO_PORT);
 
   write(address, offset, len, buf);
+}
+
+void BaseWedgeI2CBus::moduleBatch(unsigned int module,
+                                  const std::vector<ModuleOp>& ops) {
+  selectQsfp(module);
+  CHECK_NE(selectedPort_, NO_PORT);
 
-  // TODO: remove this after we ensure exclusive access to cp2112 chip
-  unselectQsfp();
+  for (const auto& op : ops) {
+    if (op.write) {
+      write(op.i2cAddress, op.offset, op.len, op.buf);
+    } else {
+      read(op.i2cAddress, op.offset, op.len, op.buf);
+    }
+  }
 }
 
 void BaseWedgeI2CBus::selectQsfp(unsigned int port) {
   VLOG(4) << "selecting QSFP " << port;
   CHECK_GT(port, 0);
+  if (!selectionValid_) {
+    // We failed part way through switching the muxes before, so clear
+    // them all rather than trusting selectedPort_.
+    VLOG(1) << "mux selection unknown, clearing all muxes";
+    selectedPort_ = NO_PORT;
+    initBus();
+    selectionValid_ = true;
+  }
   if (port != selectedPort_) {
+    SCOPE_FAIL {
+      invalidateSelection();
+    };
     selectQsfpImpl(port);
-  }
-}
-
-void BaseWedgeI2CBus::unselectQsfp() {
-  VLOG(4) << "unselecting all QSFPs";
-  if (selectedPort_ != NO_PORT) {
-    selectQsfpImpl(NO_PORT);
+    ++muxSwitches_;
   }
 }
 
@@ -42,9 +42,16 @@ class BaseWedgeI2CBus : public TransceiverI2CApi {
       int offset,
       int len,
       const uint8_t* buf) override;
+  void moduleBatch(
+      unsigned int module,
+      const std::vector<ModuleOp>& ops) override;
   void read(uint8_t i2cAddress, int offset, int len, uint8_t* buf);
   void write(uint8_t i2cAddress, int offset, int len, const uint8_t* buf);
 
+  uint64_t getMuxSwitches() const override {
+    return muxSwitches_;
+  }
+
  protected:
   enum : unsigned int {
     NO_PORT = 0,
@@ -53,16 +60,28 @@ class BaseWedgeI2CBus : public TransceiverI2CApi {
   virtual void initBus() = 0;
   virtual void selectQsfpImpl(unsigned int module) = 0;
 
+  /*
+   * Forget what we think the muxes are set to, e.g. after failing to set
+   * them, so they are all cleared before the next module is selected.
+   */
+  void invalidateSelection() {
+    selectionValid_ = false;
+  }
+
   std::unique_ptr<CP2112Intf> dev_;
   unsigned int selectedPort_{NO_PORT};
 
  private:
   /*
    * Set the PCA9548 switches so that we can read from the selected QSFP
-   * module.
+   * module. The module stays selected after the access, so that further
+   * accesses to it don't have to touch the muxes again.
    */
   void selectQsfp(unsigned int module);
-  void unselectQsfp();
+
+  // Whether selectedPort_ reflects how the muxes are actually set
+  bool selectionValid_{true};
+  uint64_t muxSwitches_{0};
 
   // Forbidden copy constructor and assignment operator
   BaseWedgeI2CBus(BaseWedgeI2CBus const &) = delete;
@@ -104,10 +104,17 @@ class PCA9548MuxedBus : public BaseWedgeI2CBus {
   }
 
   void verifyBus(bool /* autoReset */) override {
-    // Hacky bus verification for now that removes any assumptions
-    // about what the currently selected path is. We should probably
-    // extend this to do more bus health checking in the future.
-    selectedPort_ = NO_PORT;
+    // Hacky bus verification for now that just makes sure nothing is
+    // left selected, so we start out from a known path. We should
+    // probably extend this to do more bus health checking in the future.
+    if (selectedPort_ != NO_PORT) {
+      try {
+        selectQsfpImpl(NO_PORT);
+      } catch (const std::exception&) {
+        invalidateSelection();
+        throw;
+      }
+    }
   }
 
  protected:
@@ -12,6 +12,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
@@ -33,6 +34,18 @@ class I2cError : public std::exception {
  */
 class TransceiverI2CApi {
  public:
+  /*
+   * A single read from or write to a module, queued up for moduleBatch().
+   * For writes buf is only read from.
+   */
+  struct ModuleOp {
+    bool write;
+    uint8_t i2cAddress;
+    int offset;
+    int len;
+    uint8_t* buf;
+  };
+
   TransceiverI2CApi() {};
   virtual ~TransceiverI2CApi() {}
   virtual void open() = 0;
@@ -42,8 +55,33 @@ class TransceiverI2CApi {
   virtual void moduleWrite(unsigned int module, uint8_t i2cAddress,
                            int offset, int len, const uint8_t* buf) = 0;
 
+  /*
+   * Perform all of the ops against one module, in order. This exists so
+   * that buses with a per-transfer setup cost (locking, opening the device,
+   * selecting the module through the muxes) only pay it once for a series
+   * of transfers, e.g. selecting and reading each of the upper pages.
+   */
+  virtual void moduleBatch(unsigned int module,
+                           const std::vector<ModuleOp>& ops) {
+    for (const auto& op : ops) {
+      if (op.write) {
+        moduleWrite(module, op.i2cAddress, op.offset, op.len, op.buf);
+      } else {
+        moduleRead(module, op.i2cAddress, op.offset, op.len, op.buf);
+      }
+    }
+  }
+
   virtual void verifyBus(bool autoReset) = 0;
 
+  /*
+   * The number of times we have had to switch the muxes over to a
+   * different module since the bus was created, for buses with muxes.
+   */
+  virtual uint64_t getMuxSwitches() const {
+    return 0;
+  }
+
   virtual bool isPresent(unsigned int module) {
     uint8_t buf = 0;
     try {
@@ -0,0 +1,263 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/lib/usb/UsbTransferEngine.h"
+
+#include <folly/ScopeGuard.h>
+#include <folly/io/async/EventHandler.h>
+#include <glog/logging.h>
+
+#include <libusb-1.0/libusb.h>
+#include <poll.h>
+
+#include "fboss/lib/usb/UsbError.h"
+#include "fboss/lib/usb/UsbHandle.h"
+
+using std::chrono::milliseconds;
+
+namespace facebook { namespace fboss {
+
+class UsbTransferEngine::PollHandler : public folly::EventHandler {
+ public:
+  PollHandler(UsbTransferEngine* engine, int fd, short events)
+      : folly::EventHandler(engine->evb_, fd), engine_(engine) {
+    uint16_t flags = folly::EventHandler::PERSIST;
+    if (events & POLLIN) {
+      flags |= folly::EventHandler::READ;
+    }
+    if (events & POLLOUT) {
+      flags |= folly::EventHandler::WRITE;
+    }
+    registerHandler(flags);
+  }
+
+  void handlerReady(uint16_t /* events */) noexcept override {
+    // Handling the events may remove, and destroy, this handler
+    engine_->handleEvents();
+  }
+
+ private:
+  UsbTransferEngine* engine_;
+};
+
+struct UsbTransferEngine::Transfer {
+  UsbTransferEngine* engine;
+  std::vector<uint8_t> buf;
+  folly::Promise<std::vector<uint8_t>> promise;
+};
+
+UsbTransferEngine::UsbTransferEngine(
+    folly::EventBase* evb,
+    libusb_context* ctx)
+    : folly::AsyncTimeout(evb),
+      evb_(evb),
+      ctx_(ctx),
+      fdsHandleTimeouts_(libusb_pollfds_handle_timeouts(ctx) != 0) {
+  auto fds = libusb_get_pollfds(ctx_);
+  if (!fds) {
+    throw UsbError("failed to get the libusb file descriptors");
+  }
+  SCOPE_EXIT {
+    libusb_free_pollfds(fds);
+  };
+  for (auto fd = fds; *fd; ++fd) {
+    addPollFd((*fd)->fd, (*fd)->events);
+  }
+  libusb_set_pollfd_notifiers(ctx_, pollFdAdded, pollFdRemoved, this);
+}
+
+UsbTransferEngine::~UsbTransferEngine() {
+  {
+    std::lock_guard<std::mutex> g(inFlightMutex_);
+    for (auto transfer : inFlight_) {
+      libusb_cancel_transfer(transfer);
+    }
+  }
+  // Cancelled transfers still complete through the libusb events, which
+  // is when their buffers are freed and their futures failed
+  while (numInFlight_ > 0) {
+    struct timeval tv{0, 100000};
+    libusb_handle_events_timeout_completed(ctx_, &tv, nullptr);
+  }
+  libusb_set_pollfd_notifiers(ctx_, nullptr, nullptr, nullptr);
+  pollHandlers_.clear();
+}
+
+folly::Future<std::vector<uint8_t>> UsbTransferEngine::interruptTransfer(
+    UsbHandle& handle,
+    uint8_t endpoint,
+    std::vector<uint8_t> buf,
+    milliseconds timeout) {
+  return submit(
+      handle, LIBUSB_TRANSFER_TYPE_INTERRUPT, endpoint, std::move(buf),
+      timeout);
+}
+
+folly::Future<std::vector<uint8_t>> UsbTransferEngine::bulkTransfer(
+    UsbHandle& handle,
+    uint8_t endpoint,
+    std::vector<uint8_t> buf,
+    milliseconds timeout) {
+  return submit(
+      handle, LIBUSB_TRANSFER_TYPE_BULK, endpoint, std::move(buf), timeout);
+}
+
+folly::Future<std::vector<uint8_t>> UsbTransferEngine::submit(
+    UsbHandle& handle,
+    uint8_t type,
+    uint8_t endpoint,
+    std::vector<uint8_t> buf,
+    milliseconds timeout) {
+  DCHECK(handle.isOpen());
+  auto transfer = libusb_alloc_transfer(0);
+  if (!transfer) {
+    return folly::makeFuture<std::vector<uint8_t>>(
+        UsbError("failed to allocate a USB transfer"));
+  }
+  auto xfer = std::make_unique<Transfer>();
+  xfer->engine = this;
+  xfer->buf = std::move(buf);
+  auto future = xfer->promise.getFuture();
+
+  transfer->dev_handle = handle.handle();
+  transfer->endpoint = endpoint;
+  transfer->type = type;
+  transfer->timeout = timeout.count();
+  transfer->buffer = xfer->buf.data();
+  transfer->length = xfer->buf.size();
+  transfer->callback = transferDone;
+  transfer->user_data = xfer.get();
+  {
+    // Held while submitting, so the transfer is known to be in flight by
+    // the time it completes
+    std::lock_guard<std::mutex> g(inFlightMutex_);
+    int rc = libusb_submit_transfer(transfer);
+    if (rc != 0) {
+      libusb_free_transfer(transfer);
+      return folly::makeFuture<std::vector<uint8_t>>(LibusbError(
+          rc, "failed to submit USB transfer to endpoint ",
+          static_cast<int>(endpoint)));
+    }
+    inFlight_.insert(transfer);
+    ++numInFlight_;
+  }
+  xfer.release();
+
+  if (!fdsHandleTimeouts_) {
+    if (evb_->isInEventBaseThread()) {
+      updateTimeout();
+    } else {
+      evb_->runInEventBaseThread([this]() { updateTimeout(); });
+    }
+  }
+  return future;
+}
+
+void UsbTransferEngine::transferDone(libusb_transfer* transfer) {
+  std::unique_ptr<Transfer> xfer(static_cast<Transfer*>(transfer->user_data));
+  auto engine = xfer->engine;
+  {
+    std::lock_guard<std::mutex> g(engine->inFlightMutex_);
+    engine->inFlight_.erase(transfer);
+  }
+  auto status = transfer->status;
+  auto length = transfer->actual_length;
+  auto endpoint = transfer->endpoint;
+  libusb_free_transfer(transfer);
+
+  int rc;
+  switch (status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+      xfer->buf.resize(length);
+      xfer->promise.setValue(std::move(xfer->buf));
+      --engine->numInFlight_;
+      return;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+      rc = LIBUSB_ERROR_TIMEOUT;
+      break;
+    case LIBUSB_TRANSFER_CANCELLED:
+      rc = LIBUSB_ERROR_INTERRUPTED;
+      break;
+    case LIBUSB_TRANSFER_STALL:
+      rc = LIBUSB_ERROR_PIPE;
+      break;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+      rc = LIBUSB_ERROR_NO_DEVICE;
+      break;
+    case LIBUSB_TRANSFER_OVERFLOW:
+      rc = LIBUSB_ERROR_OVERFLOW;
+      break;
+    default:
+      rc = LIBUSB_ERROR_IO;
+      break;
+  }
+  xfer->promise.setException(LibusbError(
+      rc, "USB transfer on endpoint ", static_cast<int>(endpoint),
+      " failed"));
+  // Last, as the destructor may be waiting on it
+  --engine->numInFlight_;
+}
+
+void UsbTransferEngine::handleEvents() {
+  // If another thread is handling the events, say for a synchronous
+  // transfer, this returns right away and that thread completes ours too
+  struct timeval zero{0, 0};
+  int rc = libusb_handle_events_timeout_completed(ctx_, &zero, nullptr);
+  if (rc != 0) {
+    LOG(ERROR) << "error handling libusb events: " << libusb_error_name(rc);
+  }
+  updateTimeout();
+}
+
+void UsbTransferEngine::updateTimeout() {
+  if (fdsHandleTimeouts_) {
+    return;
+  }
+  struct timeval tv;
+  if (libusb_get_next_timeout(ctx_, &tv) != 1) {
+    cancelTimeout();
+    return;
+  }
+  scheduleTimeout(milliseconds(tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000));
+}
+
+void UsbTransferEngine::timeoutExpired() noexcept {
+  handleEvents();
+}
+
+void UsbTransferEngine::addPollFd(int fd, short events) {
+  pollHandlers_[fd] = std::make_unique<PollHandler>(this, fd, events);
+}
+
+void UsbTransferEngine::removePollFd(int fd) {
+  pollHandlers_.erase(fd);
+}
+
+void UsbTransferEngine::pollFdAdded(int fd, short events, void* engine) {
+  // libusb adds and removes descriptors from whichever thread opens and
+  // closes devices
+  auto self = static_cast<UsbTransferEngine*>(engine);
+  if (self->evb_->isInEventBaseThread()) {
+    self->addPollFd(fd, events);
+  } else {
+    self->evb_->runInEventBaseThread(
+        [self, fd, events]() { self->addPollFd(fd, events); });
+  }
+}
+
+void UsbTransferEngine::pollFdRemoved(int fd, void* engine) {
+  auto self = static_cast<UsbTransferEngine*>(engine);
+  if (self->evb_->isInEventBaseThread()) {
+    self->removePollFd(fd);
+  } else {
+    self->evb_->runInEventBaseThread([self, fd]() { self->removePollFd(fd); });
+  }
+}
+
+}} // facebook::fboss
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/futures/Future.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+struct libusb_context;
+struct libusb_transfer;
+
+namespace facebook { namespace fboss {
+
+class UsbHandle;
+
+/*
+ * Asynchronous bulk and interrupt transfers, using the libusb async API.
+ *
+ * The synchronous libusb transfers block their thread until the device
+ * answers, so each thread only ever has one transfer in flight. Transfers
+ * submitted here return right away with a future, and any number of them
+ * can be in flight at once, on any number of devices of the context.
+ *
+ * libusb only makes progress on transfers from threads handling its events.
+ * Here that is the EventBase thread: the libusb file descriptors are watched
+ * by the EventBase, and their events handled as soon as they are ready, so
+ * the futures are all completed from the EventBase thread. If libusb can't
+ * report its timeouts through file descriptors, those are tracked with an
+ * AsyncTimeout.
+ *
+ * Transfers may be submitted from any thread. The engine must be created
+ * and destroyed from the EventBase thread, or while its loop isn't running.
+ * Destroying it cancels the transfers still in flight, and fails their
+ * futures.
+ */
+class UsbTransferEngine : private folly::AsyncTimeout {
+ public:
+  UsbTransferEngine(folly::EventBase* evb, libusb_context* ctx);
+  ~UsbTransferEngine() override;
+
+  /*
+   * Transfer buf to or from the endpoint, depending on its direction.
+   *
+   * For IN endpoints buf is only sized to the most bytes to receive. For
+   * either direction the future gets buf back, resized to the bytes
+   * actually transferred, or fails with a LibusbError.
+   */
+  folly::Future<std::vector<uint8_t>> interruptTransfer(
+      UsbHandle& handle,
+      uint8_t endpoint,
+      std::vector<uint8_t> buf,
+      std::chrono::milliseconds timeout);
+  folly::Future<std::vector<uint8_t>> bulkTransfer(
+      UsbHandle& handle,
+      uint8_t endpoint,
+      std::vector<uint8_t> buf,
+      std::chrono::milliseconds timeout);
+
+  size_t numInFlight() const {
+    return numInFlight_;
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  UsbTransferEngine(UsbTransferEngine const&) = delete;
+  UsbTransferEngine& operator=(UsbTransferEngine const&) = delete;
+
+  class PollHandler;
+  struct Transfer;
+
+  folly::Future<std::vector<uint8_t>> submit(
+      UsbHandle& handle,
+      uint8_t type,
+      uint8_t endpoint,
+      std::vector<uint8_t> buf,
+      std::chrono::milliseconds timeout);
+
+  // Let libusb complete whatever transfers it can, without blocking
+  void handleEvents();
+  // Wake up for libusb's next timeout, unless its file descriptors cover it
+  void updateTimeout();
+  void timeoutExpired() noexcept override;
+
+  // From evb_'s thread
+  void addPollFd(int fd, short events);
+  void removePollFd(int fd);
+
+  static void transferDone(libusb_transfer* transfer);
+  static void pollFdAdded(int fd, short events, void* engine);
+  static void pollFdRemoved(int fd, void* engine);
+
+  folly::EventBase* evb_;
+  libusb_context* ctx_;
+  const bool fdsHandleTimeouts_;
+  // Only from evb_'s thread
+  std::map<int, std::unique_ptr<PollHandler>> pollHandlers_;
+  // The transfers submitted but not completed yet, to cancel on destruction
+  std::mutex inFlightMutex_;
+  std::set<libusb_transfer*> inFlight_;
+  std::atomic<size_t> numInFlight_{0};
+};
+
+}} // facebook::fboss
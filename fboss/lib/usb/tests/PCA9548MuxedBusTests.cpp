@@ -10,6 +10,7 @@
 
 #include "fboss/lib/usb/CP2112.h"
 #include "fboss/lib/usb/PCA9548MuxedBus.h"
+#include "fboss/lib/usb/UsbError.h"
 
 #include <folly/container/Enumerate.h>
 #include <gmock/gmock.h>
@@ -56,6 +57,8 @@ class FakeMuxBus
       : PCA9548MuxedBus<pow(MUXES_PER_LAYER * PCA9548::WIDTH, LAYERS)>(
             std::make_unique<MockCP2112>()) {}
   MuxLayer createMuxes() override {
+    // the bus may be reinitialized, so start over
+    leafMuxes_.clear();
     MuxLayer roots;
     for (int i = 0; i < MUXES_PER_LAYER; ++i) {
       roots.push_back(std::make_unique<QsfpMux>(this->dev_.get(), i));
@@ -300,3 +303,82 @@ TEST(PCA9548MuxedBusTests, MultiLayerMultiMux) {
     EXPECT_EQ(root2->children(7)[1]->mux()->selected(), 0);
   }
 }
+
+TEST(PCA9548MuxedBusTests, BatchSelectsOnce) {
+  FakeMuxBus<1, 1> bus;
+  bus.open();
+
+  uint8_t page = 3;
+  uint8_t data[128];
+  std::vector<TransceiverI2CApi::ModuleOp> ops = {
+    {true, TransceiverI2CApi::ADDR_QSFP, 127, sizeof(page), &page},
+    {false, TransceiverI2CApi::ADDR_QSFP, 128, sizeof(data), data},
+  };
+
+  {
+    InSequence dummy;
+
+    // one write to select the module, one for the page select, one to
+    // set the offset of the read and then the read itself
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _)).Times(3);
+    EXPECT_CALL(*bus.fakeDev(), read(_, _, _)).Times(1);
+
+    bus.moduleBatch(1, ops);
+    EXPECT_TRUE(bus.roots()[0]->mux()->isSelected(0));
+  }
+}
+
+TEST(PCA9548MuxedBusTests, SelectionCached) {
+  FakeMuxBus<2, 1> bus;
+  bus.open();
+
+  auto& root = bus.roots()[0];
+  uint8_t data;
+
+  {
+    InSequence dummy;
+
+    // two mux writes to select the module, then the offset and the read
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _)).Times(3);
+    EXPECT_CALL(*bus.fakeDev(), read(_, _, _)).Times(1);
+    bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(data), &data);
+    EXPECT_EQ(bus.getMuxSwitches(), 1u);
+
+    // same module again, the muxes are left alone
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _)).Times(1);
+    EXPECT_CALL(*bus.fakeDev(), read(_, _, _)).Times(1);
+    bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(data), &data);
+    EXPECT_EQ(bus.getMuxSwitches(), 1u);
+    EXPECT_TRUE(root->children(0)[0]->mux()->isSelected(0));
+
+    // verifying the bus clears the path again, child mux first
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _)).Times(2);
+    bus.verifyBus(false);
+    EXPECT_EQ(root->mux()->selected(), 0);
+  }
+}
+
+TEST(PCA9548MuxedBusTests, SelectionInvalidatedOnError) {
+  FakeMuxBus<1, 2> bus;
+  bus.open();
+
+  uint8_t data;
+
+  {
+    InSequence dummy;
+
+    // fail to select the module
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _))
+      .WillOnce(::testing::Throw(UsbError("select failed")));
+    EXPECT_THROW(
+      bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(data), &data),
+      UsbError);
+
+    // so all muxes are cleared before selecting again: one write for
+    // each mux, one for the select, then the offset and the read
+    EXPECT_CALL(*bus.fakeDev(), write(_, _, _)).Times(4);
+    EXPECT_CALL(*bus.fakeDev(), read(_, _, _)).Times(1);
+    bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(data), &data);
+    EXPECT_TRUE(bus.roots()[0]->mux()->isSelected(0));
+  }
+}
@@ -12,7 +12,10 @@
 #include "fboss/mdio/Phy.h"
 
 #include <cstdint>
+#include <iterator>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <folly/Synchronized.h>
 
@@ -41,6 +44,9 @@ namespace fboss {
  *
  * MdioController and MdioDevice are templated types based on the
  * variant of Mdio being used.
+ *
+ * Cl45Op: a register read or write, for running a sequence of them
+ * through MdioController::transaction().
  */
 
 class Mdio {
@@ -60,6 +66,40 @@ class Mdio {
       phy::Cl45Data data) = 0;
 };
 
+struct Cl45Op {
+  enum class Type : uint8_t { READ, WRITE };
+
+  /*
+   * A cacheable read is served from the controller's register cache when
+   * the register's value is known, and a cacheable write is skipped when
+   * the register already holds the data. Only use this for registers the
+   * PHY doesn't change on its own.
+   */
+  static Cl45Op read(
+      phy::PhyAddress physAddr,
+      phy::Cl45DeviceAddress devAddr,
+      phy::Cl45RegisterAddress regAddr,
+      bool cacheable = false) {
+    return Cl45Op{Type::READ, physAddr, devAddr, regAddr, 0, cacheable};
+  }
+  static Cl45Op write(
+      phy::PhyAddress physAddr,
+      phy::Cl45DeviceAddress devAddr,
+      phy::Cl45RegisterAddress regAddr,
+      phy::Cl45Data data,
+      bool cacheable = false) {
+    return Cl45Op{Type::WRITE, physAddr, devAddr, regAddr, data, cacheable};
+  }
+
+  Type type;
+  phy::PhyAddress physAddr;
+  phy::Cl45DeviceAddress devAddr;
+  phy::Cl45RegisterAddress regAddr;
+  // The data to write, or the data read once the op has run
+  phy::Cl45Data data;
+  bool cacheable;
+};
+
 template <typename IO>
 class MdioController {
  public:
@@ -73,7 +113,10 @@ class MdioController {
       phy::PhyAddress physAddr,
       phy::Cl45DeviceAddress devAddr,
       phy::Cl45RegisterAddress regAddr) {
-    return io_.lock()->readCl45(physAddr, devAddr, regAddr);
+    auto op = Cl45Op::read(physAddr, devAddr, regAddr);
+    auto io = io_.lock();
+    runLocked(io, &op);
+    return op.data;
   }
 
   void writeCl45(
@@ -81,7 +124,34 @@ class MdioController {
       phy::Cl45DeviceAddress devAddr,
       phy::Cl45RegisterAddress regAddr,
       phy::Cl45Data data) {
-    io_.lock()->writeCl45(physAddr, devAddr, regAddr, data);
+    auto op = Cl45Op::write(physAddr, devAddr, regAddr, data);
+    auto io = io_.lock();
+    runLocked(io, &op);
+  }
+
+  // Run the ops in order without releasing the controller, which saves
+  // taking the lock for each register in long sequences such as PHY
+  // initialization. The data of the reads is filled in.
+  void transaction(std::vector<Cl45Op>& ops) {
+    auto io = io_.lock();
+    for (auto& op : ops) {
+      runLocked(io, &op);
+    }
+  }
+
+  // The register cache is off until enabled. It is write-through, so it
+  // only ever holds what was last read from or written to each register.
+  // Invalidate a PHY's registers once it is reset.
+  void enableRegisterCache(bool enable) {
+    auto io = io_.lock();
+    cacheEnabled_ = enable;
+    cache_.clear();
+  }
+  void invalidateRegisterCache(phy::PhyAddress physAddr) {
+    auto io = io_.lock();
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      it = (it->first >> 24) == physAddr ? cache_.erase(it) : std::next(it);
+    }
   }
 
   // This can be useful by clients to do multiple MDIO reads/writes
@@ -91,12 +161,49 @@ class MdioController {
   //   io->write(...);
   //   io->read(...);
   // }
+  // These accesses bypass the register cache, so clients that enable it
+  // must invalidate the registers they write this way.
   LockedPtr lock() {
     return io_.lock();
   }
 
  private:
+  static uint32_t cacheKey(const Cl45Op& op) {
+    return (uint32_t(op.physAddr) << 24) | (uint32_t(op.devAddr) << 16) |
+        op.regAddr;
+  }
+
+  void runLocked(LockedPtr& io, Cl45Op* op) {
+    if (!cacheEnabled_) {
+      if (op->type == Cl45Op::Type::READ) {
+        op->data = io->readCl45(op->physAddr, op->devAddr, op->regAddr);
+      } else {
+        io->writeCl45(op->physAddr, op->devAddr, op->regAddr, op->data);
+      }
+      return;
+    }
+    auto key = cacheKey(*op);
+    auto cached = cache_.find(key);
+    if (op->type == Cl45Op::Type::READ) {
+      if (op->cacheable && cached != cache_.end()) {
+        op->data = cached->second;
+        return;
+      }
+      op->data = io->readCl45(op->physAddr, op->devAddr, op->regAddr);
+    } else {
+      if (op->cacheable && cached != cache_.end() &&
+          cached->second == op->data) {
+        return;
+      }
+      io->writeCl45(op->physAddr, op->devAddr, op->regAddr, op->data);
+    }
+    cache_[key] = op->data;
+  }
+
   folly::Synchronized<IO, std::mutex> io_;
+  // Protected by io_'s lock
+  bool cacheEnabled_{false};
+  std::unordered_map<uint32_t, phy::Cl45Data> cache_;
 };
 
 template <typename IO>
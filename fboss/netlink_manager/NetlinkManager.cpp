@@ -1,6 +1,9 @@
 #include "NetlinkManager.h"
+#include <algorithm>
 #include <chrono>
+#include <iterator>
 #include "NetlinkManagerException.h"
+#include "fboss/netlink_manager/utils/RouteDump.h"
 #include "folly/Format.h"
 #include "folly/ScopeGuard.h"
 #include "folly/futures/Future.h"
@@ -17,6 +20,21 @@ DEFINE_string(
     interfaces,
     "",
     "comma-separated list of names of interfaces to listen to");
+DEFINE_int32(
+    route_batch_ms,
+    20,
+    "How long to buffer route updates before sending them to the agent in "
+    "one batch. 0 sends every update as soon as it is received");
+DEFINE_int32(
+    route_batch_size,
+    5000,
+    "Send buffered route updates right away once this many prefixes are "
+    "pending");
+DEFINE_int32(
+    route_sync_chunk_size,
+    10000,
+    "Number of routes per thrift call when syncing the kernel routes to the "
+    "agent at startup");
 
 namespace {
 struct nl_dump_params initDumpParams() {
@@ -108,13 +126,72 @@ void NetlinkManager::testFbossClient() {
 }
 
 // The fboss agent will not accept incremental route changes
-// (e.g., addUnicastRoute() ) until *after* syncFib() is called
-//  to unblock the open source, it's probably ok to call syncFib()
-// with an empty list of routes and then we'll go back and fix this.
+// (e.g., addUnicastRoute() ) until *after* syncFib() is called.
+// The kernel routes are dumped straight off a raw netlink socket and sent in
+// chunks as they are parsed: the first chunk goes out in syncFib(), which
+// replaces whatever routes we had programmed before, and the rest are added
+// incrementally on top of it.
 void NetlinkManager::callSyncFib() {
+  FbossClient fbossClient = getFbossClient(FLAGS_ip, FLAGS_fboss_port);
+  bool synced = false;
+  size_t numRoutes = 0;
+  dumpUnicastRoutes(
+      std::max(FLAGS_route_sync_chunk_size, 1),
+      [&](std::vector<UnicastRoute> routes) {
+        numRoutes += routes.size();
+        if (!synced) {
+          fbossClient->sync_syncFib(FBOSS_CLIENT_ID, routes);
+          synced = true;
+        } else {
+          fbossClient->sync_addUnicastRoutes(FBOSS_CLIENT_ID, routes);
+        }
+      });
+  if (!synced) {
+    std::vector<UnicastRoute> routes;
+    fbossClient->sync_syncFib(FBOSS_CLIENT_ID, routes);
+  }
+  VLOG(0) << "Synced " << numRoutes << " kernel routes to FBOSS agent";
+}
+
+void NetlinkManager::resyncRoutes() {
+  CHECK(eb_->isInEventBaseThread());
+  // Anything still buffered predates the dump below and is superseded by it
+  pendingRoutes_.clear();
+
+  auto errCode =
+      nl_cache_refill(nlResources_->sock, nlResources_->routeCache);
+  if (errCode < 0) {
+    VLOG(0) << "Failed to refill route cache: " << nl_geterror(errCode);
+  }
+
+  // We're on the event base here, so unlike callSyncFib() this can't block
+  // on the agent. Send the whole table in one syncFib() instead.
   std::vector<UnicastRoute> routes;
+  try {
+    dumpUnicastRoutes(
+        std::max(FLAGS_route_sync_chunk_size, 1),
+        [&](std::vector<UnicastRoute> chunk) {
+          routes.insert(
+              routes.end(),
+              std::make_move_iterator(chunk.begin()),
+              std::make_move_iterator(chunk.end()));
+        });
+  } catch (const NetlinkManagerException& ex) {
+    VLOG(0) << "Failed to dump kernel routes for resync: " << ex.what();
+    return;
+  }
+
+  auto numRoutes = routes.size();
   FbossClient fbossClient = getFbossClient(FLAGS_ip, FLAGS_fboss_port);
-  fbossClient->sync_syncFib(FBOSS_CLIENT_ID, routes);
+  fbossClient->future_syncFib(FBOSS_CLIENT_ID, routes)
+      .thenValue([numRoutes](auto&&) {
+        VLOG(0) << "Resynced " << numRoutes << " routes to FBOSS agent";
+      })
+      .onError([](const std::exception& ex) {
+        VLOG(0) << folly::sformat(
+            "Route resync failed. Error sending thrift calls to FBOSS agent: {}",
+            ex.what());
+      });
 }
 
 void NetlinkManager::setMonitoredInterfaces() {
@@ -166,7 +243,8 @@ void NetlinkManager::registerWNetlink() {
 
 void NetlinkManager::startListening() {
   int fd = nl_cache_mngr_get_fd(nlResources_->manager);
-  poller_ = std::make_unique<NetlinkPoller>(eb_, fd, nlResources_->manager);
+  poller_ = std::make_unique<NetlinkPoller>(
+      eb_, fd, nlResources_->manager, [this]() { resyncRoutes(); });
 }
 
 void NetlinkManager::terminateEventBase() {
@@ -265,37 +343,95 @@ void NetlinkManager::addRouteViaFbossThrift(
   UnicastRoute unicastRoute;
   unicastRoute.dest = nlAddrToIpPrefix(nlDst);
   unicastRoute.nextHopAddrs = nexthops;
-  eb_->runInEventBaseThread([this, unicastRoute]() {
-    FbossClient fbossClient = getFbossClient(FLAGS_ip, FLAGS_fboss_port);
-    fbossClient->future_addUnicastRoute(FBOSS_CLIENT_ID, unicastRoute)
-        .thenValue(
-            [](auto&&) { VLOG(2) << "NetlinkManager route add success"; })
-        .onError([unicastRoute](const std::exception& ex) {
-          BinaryAddress binaryDst = unicastRoute.dest.ip;
-          VLOG(2) << folly::sformat(
-              "Route add failed for destination {}. Error sending thrift calls to FBOSS agent: {}",
-              binAddrToStr(binaryDst),
-              ex.what());
-        });
-  });
+  queueRouteUpdate(
+      {nlAddrToFollyAddr(nlDst),
+       static_cast<uint8_t>(nl_addr_get_prefixlen(nlDst))},
+      std::move(unicastRoute),
+      true);
 }
 
 void NetlinkManager::deleteRouteViaFbossThrift(struct nl_addr* nlDst) {
-  IpPrefix prefix = nlAddrToIpPrefix(nlDst);
-
-  eb_->runInEventBaseThread([this, prefix]() {
-    FbossClient fbossClient = getFbossClient(FLAGS_ip, FLAGS_fboss_port);
-    fbossClient->future_deleteUnicastRoute(FBOSS_CLIENT_ID, prefix)
-        .thenValue(
-            [](auto&&) { VLOG(2) << "NetlinkManager route delete success"; })
-        .onError([prefix](const std::exception& ex) {
-          BinaryAddress binaryDst = prefix.ip;
+  UnicastRoute unicastRoute;
+  unicastRoute.dest = nlAddrToIpPrefix(nlDst);
+  queueRouteUpdate(
+      {nlAddrToFollyAddr(nlDst),
+       static_cast<uint8_t>(nl_addr_get_prefixlen(nlDst))},
+      std::move(unicastRoute),
+      false);
+}
+
+void NetlinkManager::queueRouteUpdate(
+    folly::CIDRNetwork prefix,
+    UnicastRoute route,
+    bool add) {
+  CHECK(eb_->isInEventBaseThread());
+  // A later update for the same prefix supersedes an earlier one. An add
+  // followed by a delete still has to send the delete, as the agent may have
+  // had the route from a previous batch.
+  auto& pending = pendingRoutes_[prefix];
+  pending.route = std::move(route);
+  pending.add = add;
+
+  if (FLAGS_route_batch_ms <= 0 ||
+      pendingRoutes_.size() >= static_cast<size_t>(FLAGS_route_batch_size)) {
+    flushRouteUpdates();
+    return;
+  }
+  if (!flushScheduled_) {
+    flushScheduled_ = true;
+    eb_->runAfterDelay(
+        [this]() {
+          flushScheduled_ = false;
+          flushRouteUpdates();
+        },
+        FLAGS_route_batch_ms);
+  }
+}
+
+void NetlinkManager::flushRouteUpdates() {
+  if (pendingRoutes_.empty()) {
+    return;
+  }
+  std::vector<UnicastRoute> toAdd;
+  std::vector<IpPrefix> toDelete;
+  for (auto& entry : pendingRoutes_) {
+    if (entry.second.add) {
+      toAdd.push_back(std::move(entry.second.route));
+    } else {
+      toDelete.push_back(std::move(entry.second.route.dest));
+    }
+  }
+  pendingRoutes_.clear();
+  VLOG(2) << "Sending " << toAdd.size() << " route adds and "
+          << toDelete.size() << " route deletes to FBOSS agent";
+
+  FbossClient fbossClient = getFbossClient(FLAGS_ip, FLAGS_fboss_port);
+  if (!toDelete.empty()) {
+    auto numRoutes = toDelete.size();
+    fbossClient->future_deleteUnicastRoutes(FBOSS_CLIENT_ID, toDelete)
+        .thenValue([numRoutes](auto&&) {
+          VLOG(2) << "NetlinkManager deleted " << numRoutes << " routes";
+        })
+        .onError([numRoutes](const std::exception& ex) {
+          VLOG(2) << folly::sformat(
+              "Delete of {} routes failed. Error sending thrift calls to FBOSS agent: {}",
+              numRoutes,
+              ex.what());
+        });
+  }
+  if (!toAdd.empty()) {
+    auto numRoutes = toAdd.size();
+    fbossClient->future_addUnicastRoutes(FBOSS_CLIENT_ID, toAdd)
+        .thenValue([numRoutes](auto&&) {
+          VLOG(2) << "NetlinkManager added " << numRoutes << " routes";
+        })
+        .onError([numRoutes](const std::exception& ex) {
           VLOG(2) << folly::sformat(
-              "Route delete failed for destination {}. Error sending thrift calls to FBOSS agent: {}",
-              binAddrToStr(binaryDst),
+              "Add of {} routes failed. Error sending thrift calls to FBOSS agent: {}",
+              numRoutes,
               ex.what());
         });
-  });
+  }
 }
 } // namespace fboss
 } // namespace facebook
@@ -5,6 +5,8 @@ extern "C" {
 #include <netlink/socket.h>
 }
 
+#include <folly/IPAddress.h>
+#include <map>
 #include <mutex>
 #include <string>
 #include "NetlinkPoller.h"
@@ -42,6 +44,9 @@ class NetlinkManager {
   void startListening();
   void testFbossClient();
   void callSyncFib();
+  // Called after netlink messages were dropped: refill the route cache and
+  // replace the agent's routes with a fresh dump of the kernel's
+  void resyncRoutes();
   static void netlinkRouteUpdated(
       struct nl_cache* cache, // Route cache
       struct nl_object* obj, // New route object
@@ -69,6 +74,17 @@ class NetlinkManager {
       struct nl_addr* nlDst,
       const std::vector<BinaryAddress>& nexthops);
   void deleteRouteViaFbossThrift(struct nl_addr* nlDst);
+  /*
+   * Route updates are buffered per prefix for up to --route_batch_ms and sent
+   * to the agent as one addUnicastRoutes and one deleteUnicastRoutes call.
+   * Only the last update for a prefix within a batch is sent. The buffer is
+   * only touched from eb_, where the netlink callbacks run.
+   */
+  void queueRouteUpdate(
+      folly::CIDRNetwork prefix,
+      UnicastRoute route,
+      bool add);
+  void flushRouteUpdates();
   void logAndDie(const char* msg);
   void terminateEventBase();
 
@@ -77,6 +93,13 @@ class NetlinkManager {
   std::unique_ptr<NetlinkPoller> poller_{nullptr};
   std::unique_ptr<NlResources> nlResources_{nullptr};
   std::mutex interfacesMutex_;
+
+  struct PendingRoute {
+    UnicastRoute route;
+    bool add{false};
+  };
+  std::map<folly::CIDRNetwork, PendingRoute> pendingRoutes_;
+  bool flushScheduled_{false};
 };
 } // namespace fboss
 } // namespace facebook
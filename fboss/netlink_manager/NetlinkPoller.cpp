@@ -1,24 +1,86 @@
 #include "NetlinkPoller.h"
+
+extern "C" {
+#include <netlink/errno.h>
+#include <sys/socket.h>
+}
+
+#include <gflags/gflags.h>
+#include "common/stats/ThreadCachedServiceData.h"
+#include "folly/String.h"
 #include "folly/io/async/EventBase.h"
 
+DEFINE_int32(
+    netlink_rcvbuf,
+    16 * 1024 * 1024,
+    "Receive buffer size for the netlink notification socket. Route storms "
+    "overrun the default size and the kernel drops updates when that happens");
+
+namespace {
+// Bounds the time spent in one wakeup so a continuous stream of updates
+// cannot starve the rest of the event base
+constexpr int kMaxReadsPerWakeup = 64;
+} // namespace
+
 namespace facebook {
 namespace fboss {
 
 NetlinkPoller::NetlinkPoller(
     folly::EventBase* eb,
     int fd,
-    struct nl_cache_mngr* manager)
-    : folly::EventHandler(eb, fd), manager_(manager) {
+    struct nl_cache_mngr* manager,
+    std::function<void()> onOverrun)
+    : folly::EventHandler(eb, fd),
+      manager_(manager),
+      onOverrun_(std::move(onOverrun)) {
   DCHECK(eb) << "NULL pointer to EventBase";
   if (fd == -1) {
-    int mngrFd = nl_cache_mngr_get_fd(manager);
-    changeHandlerFD(mngrFd);
+    fd = nl_cache_mngr_get_fd(manager);
+    changeHandlerFD(fd);
   }
+  setReceiveBuffer(fd);
   registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
 }
 
+void NetlinkPoller::setReceiveBuffer(int fd) {
+  int size = FLAGS_netlink_rcvbuf;
+  // SO_RCVBUFFORCE lets us go past net.core.rmem_max when we have
+  // CAP_NET_ADMIN, which is the common case
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == 0) {
+    return;
+  }
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+    VLOG(0) << "Failed to set netlink receive buffer to " << size << ": "
+            << folly::errnoStr(errno);
+  }
+}
+
 void NetlinkPoller::handlerReady(uint16_t /*events*/) noexcept {
-  nl_cache_mngr_data_ready(manager_);
+  int64_t numEvents = 0;
+  bool overrun = false;
+  for (int i = 0; i < kMaxReadsPerWakeup; ++i) {
+    auto ret = nl_cache_mngr_data_ready(manager_);
+    if (ret > 0) {
+      numEvents += ret;
+      continue;
+    }
+    // libnl reports ENOBUFS from the socket as NLE_NOMEM
+    if (ret == -NLE_NOMEM) {
+      overrun = true;
+    } else if (ret < 0 && ret != -NLE_AGAIN) {
+      VLOG(0) << "Error processing netlink messages: " << nl_geterror(ret);
+    }
+    break;
+  }
+  tcData().addStatValue(eventsKey_, numEvents, stats::RATE);
+
+  if (overrun) {
+    VLOG(0) << "Netlink socket overrun, route updates were lost. Resyncing";
+    tcData().addStatValue(overrunsKey_, 1, stats::SUM);
+    if (onOverrun_) {
+      onOverrun_();
+    }
+  }
   return;
 }
 } // namespace fboss
@@ -3,6 +3,8 @@ extern "C" {
 }
 
 #include <folly/io/async/EventHandler.h>
+#include <functional>
+#include <string>
 
 namespace folly {
 class EventBase;
@@ -14,15 +16,29 @@ namespace fboss {
 /*
  * This class listen in on the netlink socket and call handlerReady when an
  * event is registered.
+ *
+ * All messages queued on the socket are processed on each wakeup. If the
+ * kernel had to drop messages because we fell behind (ENOBUFS), the libnl
+ * cache no longer reflects the kernel and onOverrun is called so the owner
+ * can resync from scratch.
  */
 
 class NetlinkPoller : public folly::EventHandler {
  public:
-  NetlinkPoller(folly::EventBase* eb, int fd, struct nl_cache_mngr* manager);
+  NetlinkPoller(
+      folly::EventBase* eb,
+      int fd,
+      struct nl_cache_mngr* manager,
+      std::function<void()> onOverrun);
   void handlerReady(uint16_t events) noexcept override;
 
  private:
+  void setReceiveBuffer(int fd);
+
   struct nl_cache_mngr* manager_;
+  std::function<void()> onOverrun_;
+  const std::string eventsKey_{"netlink_manager.netlink_events"};
+  const std::string overrunsKey_{"netlink_manager.netlink_overruns"};
 };
 
 } // namespace fboss
@@ -0,0 +1,196 @@
+#include "RouteDump.h"
+
+extern "C" {
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include "fboss/agent/if/gen-cpp2/FbossCtrl.h"
+#include "fboss/netlink_manager/NetlinkManagerException.h"
+#include "folly/FBString.h"
+#include "folly/Format.h"
+#include "folly/ScopeGuard.h"
+#include "folly/String.h"
+
+DEFINE_int32(
+    netlink_dump_rcvbuf,
+    8 * 1024 * 1024,
+    "Socket receive buffer used for the initial kernel route dump, large "
+    "enough that the kernel does not have to wait on us while dumping");
+
+namespace {
+// netlink dumps fill one skb per recv, which is at most a few pages, but a
+// bigger buffer lets us pick up several of them at once
+constexpr size_t kRecvBufSize = 256 * 1024;
+
+size_t addrLen(int family) {
+  return family == AF_INET ? 4 : 16;
+}
+
+facebook::network::thrift::BinaryAddress toBinAddr(
+    const struct rtattr* rta,
+    int family) {
+  facebook::network::thrift::BinaryAddress addr;
+  auto len = std::min<size_t>(RTA_PAYLOAD(rta), addrLen(family));
+  addr.addr = folly::fbstring(static_cast<const char*>(RTA_DATA(rta)), len);
+  return addr;
+}
+
+void addGateways(
+    const struct rtattr* rta,
+    int len,
+    int family,
+    std::vector<facebook::network::thrift::BinaryAddress>& nexthops) {
+  for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+    if (rta->rta_type == RTA_GATEWAY) {
+      nexthops.push_back(toBinAddr(rta, family));
+    }
+  }
+}
+
+// Returns false if the message is not a unicast route we should sync
+bool parseRoute(
+    const struct nlmsghdr* nlh,
+    facebook::fboss::UnicastRoute& route) {
+  const auto* rtm = static_cast<const struct rtmsg*>(NLMSG_DATA(nlh));
+  if ((rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6) ||
+      rtm->rtm_type != RTN_UNICAST || (rtm->rtm_flags & RTM_F_CLONED)) {
+    return false;
+  }
+  int family = rtm->rtm_family;
+
+  bool haveDst = false;
+  int len = RTM_PAYLOAD(nlh);
+  for (auto rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+    switch (rta->rta_type) {
+      case RTA_DST:
+        route.dest.ip = toBinAddr(rta, family);
+        haveDst = true;
+        break;
+      case RTA_GATEWAY:
+        route.nextHopAddrs.push_back(toBinAddr(rta, family));
+        break;
+      case RTA_MULTIPATH: {
+        auto rtnh = static_cast<const struct rtnexthop*>(RTA_DATA(rta));
+        int nhLen = RTA_PAYLOAD(rta);
+        while (RTNH_OK(rtnh, nhLen)) {
+          addGateways(
+              RTNH_DATA(rtnh),
+              rtnh->rtnh_len - sizeof(*rtnh),
+              family,
+              route.nextHopAddrs);
+          nhLen -= NLMSG_ALIGN(rtnh->rtnh_len);
+          rtnh = RTNH_NEXT(rtnh);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (!haveDst) {
+    // Default route, the kernel leaves out RTA_DST
+    route.dest.ip.addr = folly::fbstring(addrLen(family), '\0');
+  }
+  route.dest.prefixLength = rtm->rtm_dst_len;
+  return !route.nextHopAddrs.empty();
+}
+} // namespace
+
+namespace facebook {
+namespace fboss {
+
+void dumpUnicastRoutes(
+    size_t chunkSize,
+    const std::function<void(std::vector<UnicastRoute>)>& onChunk) {
+  int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (fd < 0) {
+    throw NetlinkManagerException(folly::sformat(
+        "Failed to open netlink socket for route dump: {}",
+        folly::errnoStr(errno)));
+  }
+  SCOPE_EXIT {
+    close(fd);
+  };
+  int rcvbuf = FLAGS_netlink_dump_rcvbuf;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+    VLOG(1) << "Failed to set netlink receive buffer to " << rcvbuf << ": "
+            << folly::errnoStr(errno);
+  }
+
+  struct {
+    struct nlmsghdr nlh;
+    struct rtmsg rtm;
+  } req;
+  memset(&req, 0, sizeof(req));
+  const uint32_t seq = time(nullptr);
+  req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.rtm));
+  req.nlh.nlmsg_type = RTM_GETROUTE;
+  req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  req.nlh.nlmsg_seq = seq;
+  req.rtm.rtm_family = AF_UNSPEC;
+  if (send(fd, &req, req.nlh.nlmsg_len, 0) < 0) {
+    throw NetlinkManagerException(folly::sformat(
+        "Failed to send route dump request: {}", folly::errnoStr(errno)));
+  }
+
+  std::vector<UnicastRoute> chunk;
+  chunk.reserve(chunkSize);
+  std::vector<char> buf(kRecvBufSize);
+  size_t numRoutes = 0;
+  bool done = false;
+  while (!done) {
+    auto ret = recv(fd, buf.data(), buf.size(), 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw NetlinkManagerException(folly::sformat(
+          "Failed to read route dump: {}", folly::errnoStr(errno)));
+    }
+    int len = ret;
+    for (auto nlh = reinterpret_cast<const struct nlmsghdr*>(buf.data());
+         NLMSG_OK(nlh, len);
+         nlh = NLMSG_NEXT(nlh, len)) {
+      if (nlh->nlmsg_seq != seq) {
+        continue;
+      }
+      if (nlh->nlmsg_type == NLMSG_DONE) {
+        done = true;
+        break;
+      }
+      if (nlh->nlmsg_type == NLMSG_ERROR) {
+        const auto* err = static_cast<const struct nlmsgerr*>(NLMSG_DATA(nlh));
+        throw NetlinkManagerException(folly::sformat(
+            "Route dump failed: {}", folly::errnoStr(-err->error)));
+      }
+      if (nlh->nlmsg_type != RTM_NEWROUTE) {
+        continue;
+      }
+      UnicastRoute route;
+      if (!parseRoute(nlh, route)) {
+        continue;
+      }
+      chunk.push_back(std::move(route));
+      ++numRoutes;
+      if (chunk.size() >= chunkSize) {
+        onChunk(std::move(chunk));
+        chunk.clear();
+        chunk.reserve(chunkSize);
+      }
+    }
+  }
+  if (!chunk.empty()) {
+    onChunk(std::move(chunk));
+  }
+  VLOG(1) << "Dumped " << numRoutes << " unicast routes from the kernel";
+}
+
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace facebook {
+namespace fboss {
+
+class UnicastRoute;
+
+/*
+ * Dump the kernel's unicast routes with a single RTM_GETROUTE request on a
+ * raw NETLINK_ROUTE socket, decoding the rtattrs straight into UnicastRoute
+ * instead of going through libnl objects and string conversions.
+ *
+ * Routes are handed to onChunk as soon as chunkSize of them have been parsed,
+ * so the caller can start sending them on while the rest of the dump is
+ * still being read. As with the route cache callbacks, routes without any
+ * gateway are skipped. Throws NetlinkManagerException on socket or netlink
+ * errors.
+ */
+void dumpUnicastRoutes(
+    size_t chunkSize,
+    const std::function<void(std::vector<UnicastRoute>)>& onChunk);
+
+} // namespace fboss
+} // namespace facebook
@@ -2,23 +2,57 @@
 
 #include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
 
+#include <gflags/gflags.h>
+
+DEFINE_int32(
+    pcap_buffer_idle_s,
+    0,
+    "Stop buffering the packets of an ethertype once its buffer wasn't "
+    "dumped for this long, until it is dumped again. 0 buffers all of them");
+
+namespace {
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}
+
 namespace facebook { namespace fboss {
 
 uint16_t PcapBufferManager::UNKNOWN = 0xFFFF;
 
+constexpr uint8_t PcapBufferManager::kNoBuffer;
+
 PcapBufferManager::PcapBufferManager() {
-  for(auto e : PcapBufferManager::getEthertypes()){
-    buffers_[e] = PcapCircularBuffer();
+  bufferIndex_.fill(kNoBuffer);
+  for (auto e : PcapBufferManager::getEthertypes()) {
+    bufferIndex_[e] = buffers_.size();
+    buffers_.push_back(std::make_unique<PcapCircularBuffer>());
+  }
+  unknownIndex_ = bufferIndex_[UNKNOWN];
+  // Buffer everything to start with, as if just dumped
+  lastDumped_.reset(new std::atomic<int64_t>[buffers_.size()]);
+  auto now = nowNs();
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    lastDumped_[i] = now;
   }
 }
 
-void PcapBufferManager::addPkt(PcapPkt&& pkt, uint16_t ethertype) {
-  auto it = buffers_.find(ethertype);
-  if (it == buffers_.end()) {
-    buffers_[UNKNOWN].addPkt(std::move(pkt));
-  } else {
-    it->second.addPkt(std::move(pkt));
+bool PcapBufferManager::wantsPkt(uint16_t ethertype) const {
+  if (FLAGS_pcap_buffer_idle_s <= 0) {
+    return true;
   }
+  auto idleNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::seconds(FLAGS_pcap_buffer_idle_s))
+                    .count();
+  auto lastDumped =
+      lastDumped_[indexOf(ethertype)].load(std::memory_order_relaxed);
+  return nowNs() - lastDumped < idleNs;
+}
+
+void PcapBufferManager::addPkt(PcapPkt&& pkt, uint16_t ethertype) {
+  buffers_[indexOf(ethertype)]->addPkt(std::move(pkt));
 }
 
 /*
@@ -28,8 +62,13 @@ void PcapBufferManager::addPkt(PcapPkt&& pkt, uint16_t ethertype) {
 void PcapBufferManager::dumpPackets(
     std::vector<CapturedPacket>& out,
     uint16_t ethertype) {
-  auto buf = buffers_[ethertype].release();
-  for (int i = 0; i < buf.size(); i++) {
+  auto index = bufferIndex_[ethertype];
+  if (index == kNoBuffer) {
+    return;
+  }
+  lastDumped_[index].store(nowNs(), std::memory_order_relaxed);
+  auto buf = buffers_[index]->release();
+  for (size_t i = 0; i < buf.size(); i++) {
     CapturedPacket p;
     p.rx = buf[i].isRx();
 
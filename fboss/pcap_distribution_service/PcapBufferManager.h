@@ -8,7 +8,10 @@
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/LldpManager.h"
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
 
 namespace facebook {
@@ -19,6 +22,12 @@ class CapturedPacket;
 class PcapBufferManager {
  public:
   PcapBufferManager();
+  /*
+   * Whether packets of this ethertype are buffered. With
+   * --pcap_buffer_idle_s, only those of ethertypes dumped within that long
+   * are, so nobody pays for buffers nobody looks at.
+   */
+  bool wantsPkt(uint16_t ethertype) const;
   void addPkt(PcapPkt&& pkt, uint16_t ethertype);
   void dumpPackets(std::vector<CapturedPacket>& out, uint16_t ethertype);
   static uint16_t UNKNOWN;
@@ -33,7 +42,26 @@ class PcapBufferManager {
   }
 
  private:
-  std::map<uint16_t, PcapCircularBuffer> buffers_;
+  // Forbidden copy constructor and assignment operator
+  PcapBufferManager(PcapBufferManager const &) = delete;
+  PcapBufferManager& operator=(PcapBufferManager const &) = delete;
+
+  static constexpr uint8_t kNoBuffer = 0xFF;
+
+  uint8_t indexOf(uint16_t ethertype) const {
+    auto index = bufferIndex_[ethertype];
+    return index == kNoBuffer ? unknownIndex_ : index;
+  }
+
+  // One buffer per entry in getEthertypes(), in the same order
+  std::vector<std::unique_ptr<PcapCircularBuffer>> buffers_;
+  // Index in buffers_ of the buffer for each ethertype, kNoBuffer for the
+  // ethertypes we don't keep a buffer for. Never changes after construction,
+  // so it can be read without locking.
+  std::array<uint8_t, 1 << 16> bufferIndex_;
+  uint8_t unknownIndex_{kNoBuffer};
+  // When each buffer was last dumped, in steady clock nanoseconds
+  std::unique_ptr<std::atomic<int64_t>[]> lastDumped_;
 };
 }
 }
@@ -1,47 +1,96 @@
 #pragma once
 
-#include <boost/circular_buffer.hpp>
-
 #include "fboss/agent/capture/PcapPkt.h"
 
-#include "folly/Synchronized.h"
+#include <folly/MicroSpinLock.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
+/*
+ * A fixed capacity ring of the most recent packets.
+ *
+ * Writers claim a slot by bumping an atomic cursor, so they never wait on
+ * each other, or on readers dumping the whole ring. Each slot records the
+ * sequence number of the packet it holds: a reader takes the cursor as its
+ * snapshot, and keeps only the slots whose sequence number still matches,
+ * skipping packets that were overwritten by a later lap while it was copying.
+ * Slots are copied under a per slot spin lock, since packets aren't trivially
+ * copyable; writers and readers only ever contend on the same slot.
+ */
 class PcapCircularBuffer {
  public:
-  explicit PcapCircularBuffer(int n = 100)
-      : buf_(boost::circular_buffer<PcapPkt>(n)) {}
-
-  void addPkt(PcapPkt pkt) {
-    buf_.wlock()->push_back(std::move(pkt));
+  explicit PcapCircularBuffer(uint32_t n = 100)
+      : capacity_(n), slots_(new Slot[n]) {
+    for (uint32_t i = 0; i < n; ++i) {
+      slots_[i].lock.init();
+    }
   }
 
-  void resize(int n) {
-    buf_.wlock()->set_capacity(n);
+  void addPkt(PcapPkt pkt) {
+    auto seq = next_.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = slots_[seq % capacity_];
+    std::lock_guard<folly::MicroSpinLock> g(slot.lock);
+    // With more than capacity_ writers racing, a writer from a later lap may
+    // have got to the slot first. Its packet is the newer one.
+    if (slot.seq > seq) {
+      return;
+    }
+    slot.pkt = std::move(pkt);
+    slot.seq = seq + 1;
   }
 
-  int size() {
-    return buf_.rlock()->size();
+  uint32_t size() const {
+    return std::min<uint64_t>(
+        next_.load(std::memory_order_acquire), capacity_);
   }
 
-  int capacity() {
-    return buf_.rlock()->capacity();
+  uint32_t capacity() const {
+    return capacity_;
   }
 
-  // release the buffer to a user to dump, and swap in
-  // a new buffer
-  boost::circular_buffer<PcapPkt> release() {
-    return buf_.copy();
+  // Copy out the packets currently in the buffer, oldest first
+  std::vector<PcapPkt> release() const {
+    auto end = next_.load(std::memory_order_acquire);
+    auto begin = end > capacity_ ? end - capacity_ : 0;
+    std::vector<PcapPkt> out;
+    out.reserve(end - begin);
+    for (auto seq = begin; seq < end; ++seq) {
+      auto& slot = slots_[seq % capacity_];
+      std::lock_guard<folly::MicroSpinLock> g(slot.lock);
+      // Skip packets which haven't been written yet, or have already been
+      // replaced by newer ones
+      if (slot.seq == seq + 1) {
+        out.push_back(slot.pkt);
+      }
+    }
+    return out;
   }
 
   // can add new functions, such as get after timestamp
 
  private:
-  folly::Synchronized<boost::circular_buffer<PcapPkt>> buf_;
+  struct Slot {
+    folly::MicroSpinLock lock;
+    // Sequence number of pkt plus one, 0 if the slot was never written
+    uint64_t seq{0};
+    PcapPkt pkt;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  PcapCircularBuffer(PcapCircularBuffer const &) = delete;
+  PcapCircularBuffer& operator=(PcapCircularBuffer const &) = delete;
+
+  const uint32_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  // Sequence number of the next packet to add
+  std::atomic<uint64_t> next_{0};
 };
 
 }}
@@ -1,21 +1,36 @@
 #include "fboss/pcap_distribution_service/PcapDistributor.h"
 
 #include <folly/GLog.h>
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <tuple>
 
+#include <folly/Conv.h>
 #include <folly/SocketAddress.h>
 #include <folly/Synchronized.h>
+#include <folly/io/IOBufQueue.h>
 #include <folly/io/async/EventBase.h>
+#include <gflags/gflags.h>
 
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include "fboss/pcap_distribution_service/if/gen-cpp2/PcapSubscriber.h"
 
+DEFINE_int32(
+    pcap_dist_batch_packets,
+    256,
+    "Most packets sent to a subscriber in one receivePacketBatch call");
+DEFINE_int32(
+    pcap_subscriber_queue_batches,
+    64,
+    "Batches queued for a subscriber before its oldest ones are dropped");
+
 using namespace std;
 using namespace folly;
 using namespace apache::thrift::server;
@@ -24,21 +39,52 @@ using namespace apache::thrift;
 
 namespace facebook { namespace fboss {
 
-void PcapDistributor::subscribe(unique_ptr<string> hostname, int port) {
-  auto creation = [&, hostname = move(hostname), port ]() {
-    auto locked_map = subs_.wlock();
-    auto locked_callbacks = callbacks_.wlock();
+PcapDistributor::FilterGroup::FilterGroup(SubscriberFilter filter)
+    : filter_(move(filter)),
+      ethertypes_(filter_.ethertypes.begin(), filter_.ethertypes.end()),
+      ports_(filter_.ports.begin(), filter_.ports.end()),
+      vlans_(filter_.vlans.begin(), filter_.vlans.end()),
+      sampleRatio_(max(filter_.sampleRatio, 1)) {}
+
+bool PcapDistributor::FilterGroup::matches(
+    uint16_t ethertype,
+    const RxPacketData* rxPkt) const {
+  if (filter_.__isset.ethertypes && !ethertypes_.count(ethertype)) {
+    return false;
+  }
+  if (filter_.__isset.ports && (!rxPkt || !ports_.count(rxPkt->srcPort))) {
+    return false;
+  }
+  if (filter_.__isset.vlans && (!rxPkt || !vlans_.count(rxPkt->srcVlan))) {
+    return false;
+  }
+  return true;
+}
+
+void PcapDistributor::subscribe(
+    unique_ptr<string> hostname,
+    int port,
+    SubscriberFilter filter) {
+  auto creation =
+      [&, hostname = move(hostname), port, filter = move(filter) ]() mutable {
     SocketAddress addr(*hostname, port, true);
     auto socket = TAsyncSocket::newSocket(evb_.get(), addr);
     auto chan = HeaderClientChannel::newChannel(socket);
     auto key = pair<string, int>(*hostname, port);
-    ChannelCloserCB closer(this, key);
-    locked_map->erase(key);
-    locked_callbacks->erase(key);
-    locked_callbacks->emplace(key, move(closer));
-    chan->setCloseCallback(&locked_callbacks->at(key));
-    locked_map->emplace(
-        key, make_unique<PcapSubscriberAsyncClient>(move(chan)));
+    auto sub = make_shared<Subscriber>(this, key);
+    chan->setCloseCallback(&sub->closer);
+    sub->client = make_unique<PcapSubscriberAsyncClient>(move(chan));
+    auto locked_map = subs_.wlock();
+    for (const auto& i : *locked_map) {
+      if (i.first != key && i.second->group->getFilter() == filter) {
+        sub->group = i.second->group;
+        break;
+      }
+    }
+    if (!sub->group) {
+      sub->group = make_shared<FilterGroup>(move(filter));
+    }
+    (*locked_map)[key] = move(sub);
     LOG(INFO) << "CREATED SUBSCRIBER: " << *hostname << " " << port;
   };
   evb_->runInEventBaseThread(move(creation));
@@ -46,27 +92,151 @@ void PcapDistributor::subscribe(unique_ptr<string> hostname, int port) {
 
 void PcapDistributor::unsubscribe(const string& hostname, int port) {
   subs_.wlock()->erase(pair<string, int>(hostname, port));
-  callbacks_.wlock()->erase(pair<string, int>(hostname, port));
   LOG(INFO) << "UNSUBSCRIBED CLIENT: " << hostname << " " << port;
 }
 
-void PcapDistributor::distributeRxPacket(RxPacketData* packetData) {
-  auto locked_map = subs_.rlock();
-  auto onError = [](runtime_error& e) {
-    FB_LOG_EVERY_MS(ERROR, 1000) << e.what();
-  };
-  for (auto& i : *locked_map) {
-    i.second->future_receiveRxPacket(*packetData).onError(move(onError));
+bool PcapDistributor::wanted(uint16_t ethertype, const RxPacketData* rxPkt) {
+  for (const auto& i : *subs_.rlock()) {
+    if (i.second->group->matches(ethertype, rxPkt)) {
+      return true;
+    }
   }
+  return false;
 }
 
-void PcapDistributor::distributeTxPacket(TxPacketData* packetData) {
-  auto locked_map = subs_.rlock();
-  auto onError = [](runtime_error& e) {
-    FB_LOG_EVERY_MS(ERROR, 1000) << e.what();
-  };
-  for (auto& i : *locked_map) {
-    i.second->future_receiveTxPacket(*packetData).onError(move(onError));
+void PcapDistributor::distributeRxPacket(
+    RxPacketData* packetData,
+    uint16_t ethertype) {
+  if (!wanted(ethertype, packetData)) {
+    return;
+  }
+  CapturedPacket pkt;
+  pkt.rx = true;
+  pkt.pkt.set_rxpkt(*packetData);
+  distribute(move(pkt), ethertype);
+}
+
+void PcapDistributor::distributeTxPacket(
+    TxPacketData* packetData,
+    uint16_t ethertype) {
+  if (!wanted(ethertype, nullptr)) {
+    return;
+  }
+  CapturedPacket pkt;
+  pkt.rx = false;
+  pkt.pkt.set_txpkt(*packetData);
+  distribute(move(pkt), ethertype);
+}
+
+void PcapDistributor::distribute(CapturedPacket pkt, uint16_t ethertype) {
+  pending_.wlock()->push_back(PendingPacket{move(pkt), ethertype});
+  // Packets coming in while a flush is scheduled go out with it, so the
+  // batches grow with the packet rate
+  if (!flushScheduled_.exchange(true)) {
+    evb_->runInEventBaseThread([this]() { flush(); });
+  }
+}
+
+void PcapDistributor::flush() {
+  flushScheduled_ = false;
+  vector<PendingPacket> pkts;
+  pending_.wlock()->swap(pkts);
+  map<FilterGroup*, vector<shared_ptr<Subscriber>>> groups;
+  for (const auto& i : *subs_.rlock()) {
+    groups[i.second->group.get()].push_back(i.second);
+  }
+  if (pkts.empty()) {
+    return;
+  }
+
+  // Each group only serializes the packets passing its filter, so the
+  // packets are copied for all but the last group
+  size_t numGroupsLeft = groups.size();
+  for (auto& group : groups) {
+    bool last = --numGroupsLeft == 0;
+    vector<CapturedPacket> groupPkts;
+    for (auto& pkt : pkts) {
+      auto rxPkt = pkt.pkt.rx ? &pkt.pkt.pkt.get_rxpkt() : nullptr;
+      if (group.first->matches(pkt.ethertype, rxPkt) &&
+          group.first->sample()) {
+        groupPkts.push_back(last ? move(pkt.pkt) : pkt.pkt);
+      }
+    }
+    if (!groupPkts.empty()) {
+      queueBatches(move(groupPkts), group.second);
+    }
+  }
+  for (auto& group : groups) {
+    for (auto& sub : group.second) {
+      sendNext(sub);
+    }
+  }
+}
+
+void PcapDistributor::queueBatches(
+    vector<CapturedPacket> pkts,
+    const vector<shared_ptr<Subscriber>>& subs) {
+  size_t batchPkts = max(FLAGS_pcap_dist_batch_packets, 1);
+  size_t maxQueued = max(FLAGS_pcap_subscriber_queue_batches, 1);
+  for (size_t start = 0; start < pkts.size(); start += batchPkts) {
+    auto end = min(start + batchPkts, pkts.size());
+    CapturedPacketBatch packets;
+    packets.packets.assign(
+        make_move_iterator(pkts.begin() + start),
+        make_move_iterator(pkts.begin() + end));
+    IOBufQueue queue;
+    CompactSerializer::serialize(packets, &queue);
+    auto batch = make_shared<Batch>();
+    batch->serialized = queue.move();
+    batch->numPkts = end - start;
+
+    for (auto& sub : subs) {
+      if (sub->queue.size() >= maxQueued) {
+        auto dropped = sub->queue.front()->numPkts;
+        sub->queue.pop_front();
+        sub->numDropped += dropped;
+        numDropped_ += dropped;
+      }
+      sub->queue.push_back(batch);
+    }
+  }
+}
+
+void PcapDistributor::sendNext(const shared_ptr<Subscriber>& sub) {
+  if (sub->sending || sub->queue.empty()) {
+    return;
+  }
+  auto batch = move(sub->queue.front());
+  sub->queue.pop_front();
+  sub->sending = true;
+  weak_ptr<Subscriber> weakSub = sub;
+  // The client completes its calls from evb_, like the rest of the sends
+  sub->client->future_receivePacketBatch(batch->serialized)
+      .then([this, weakSub, batch](Try<Unit>&& result) {
+        auto sub = weakSub.lock();
+        if (!sub) {
+          // Unsubscribed in the meantime
+          return;
+        }
+        sub->sending = false;
+        if (result.hasException()) {
+          FB_LOG_EVERY_MS(ERROR, 1000) << result.exception().what();
+          sub->numDropped += batch->numPkts;
+          numDropped_ += batch->numPkts;
+        } else {
+          ++numBatchesSent_;
+        }
+        sendNext(sub);
+      });
+}
+
+void PcapDistributor::getCounters(map<string, int64_t>& counters) {
+  counters["pcap_dist.batches_sent"] = numBatchesSent_;
+  counters["pcap_dist.packets_dropped"] = numDropped_;
+  for (const auto& i : *subs_.rlock()) {
+    auto name = folly::to<string>(
+        "pcap_dist.packets_dropped.", i.first.first, ":", i.first.second);
+    counters[name] = i.second->numDropped;
   }
 }
 }}
@@ -1,7 +1,11 @@
 #pragma once
 
-#include <memory>
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <vector>
 
 #include <thrift/lib/cpp2/async/RequestChannel.h>
 
@@ -10,6 +14,7 @@
 #include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_constants.h"
 
 #include "folly/Synchronized.h"
+#include "folly/io/IOBuf.h"
 
 namespace facebook { namespace fboss {
 
@@ -21,13 +26,32 @@ class PcapDistributor {
    * This class handles subscriptions from clients, and distributes
    * packets received from the switch to all clients.
    *
+   * Packets are collected into batches, and each batch is serialized once
+   * into an IOBuf which all of the subscribers' sends share. Every
+   * subscriber has its own bounded queue of batches, with one send in
+   * flight at a time: a subscriber which can't keep up loses its oldest
+   * batches, counted in its dropped packets, rather than slowing the others
+   * down or growing without bound.
+   *
+   * Subscribers may only want some of the packets. Their filters are
+   * applied before packets are copied or serialized, and subscribers with
+   * the same filter share their batches.
+   *
    */
  public:
   explicit PcapDistributor(std::shared_ptr<folly::EventBase> b) : evb_(b) {}
-  void subscribe(std::unique_ptr<std::string> hostname, int port);
+  void subscribe(
+      std::unique_ptr<std::string> hostname,
+      int port,
+      SubscriberFilter filter = SubscriberFilter());
   void unsubscribe(const std::string& hostname, int port);
-  void distributeRxPacket(RxPacketData* packetData);
-  void distributeTxPacket(TxPacketData* packetData);
+  void distributeRxPacket(RxPacketData* packetData, uint16_t ethertype);
+  void distributeTxPacket(TxPacketData* packetData, uint16_t ethertype);
+
+  /*
+   * Batches sent and packets dropped, overall and by subscriber
+   */
+  void getCounters(std::map<std::string, int64_t>& counters);
 
  private:
   /*
@@ -50,13 +74,82 @@ class PcapDistributor {
     const std::pair<std::string, int> key_;
   };
 
-  // Map of hostname and port to client object
-  folly::Synchronized<std::map<
-      std::pair<std::string, int>,
-      std::unique_ptr<PcapSubscriberAsyncClient>>>
+  /*
+   * The subscribers with the same filter. Sampling is only done from evb_.
+   */
+  class FilterGroup {
+   public:
+    explicit FilterGroup(SubscriberFilter filter);
+
+    const SubscriberFilter& getFilter() const {
+      return filter_;
+    }
+
+    // Whether the packet passes the filter, before sampling
+    bool matches(uint16_t ethertype, const RxPacketData* rxPkt) const;
+
+    // Whether to keep the next packet passing the filter
+    bool sample() {
+      return sampleRatio_ <= 1 || numMatched_++ % sampleRatio_ == 0;
+    }
+
+   private:
+    const SubscriberFilter filter_;
+    const std::set<uint16_t> ethertypes_;
+    const std::set<int32_t> ports_;
+    const std::set<int32_t> vlans_;
+    const uint32_t sampleRatio_;
+    uint64_t numMatched_{0};
+  };
+
+  struct PendingPacket {
+    CapturedPacket pkt;
+    uint16_t ethertype;
+  };
+
+  struct Batch {
+    std::unique_ptr<folly::IOBuf> serialized;
+    size_t numPkts;
+  };
+
+  /*
+   * A subscriber's client and send queue. Apart from numDropped, only used
+   * from evb_.
+   */
+  struct Subscriber {
+    Subscriber(PcapDistributor* p, std::pair<std::string, int> key)
+        : closer(p, std::move(key)) {}
+
+    std::unique_ptr<PcapSubscriberAsyncClient> client;
+    ChannelCloserCB closer;
+    std::shared_ptr<FilterGroup> group;
+    std::deque<std::shared_ptr<const Batch>> queue;
+    bool sending{false};
+    std::atomic<uint64_t> numDropped{0};
+  };
+
+  // Whether any subscriber's filter passes the packet
+  bool wanted(uint16_t ethertype, const RxPacketData* rxPkt);
+  void distribute(CapturedPacket pkt, uint16_t ethertype);
+  // Serialize the pending packets and queue them to every subscriber, from
+  // evb_
+  void flush();
+  // Serialize the packets, in batches, and queue them to the subscribers
+  void queueBatches(
+      std::vector<CapturedPacket> pkts,
+      const std::vector<std::shared_ptr<Subscriber>>& subs);
+  // Start sending the subscriber's next batch, unless one is in flight
+  void sendNext(const std::shared_ptr<Subscriber>& sub);
+
+  // Map of hostname and port to subscriber
+  folly::Synchronized<
+      std::map<std::pair<std::string, int>, std::shared_ptr<Subscriber>>>
       subs_;
-  folly::Synchronized<std::map<std::pair<std::string, int>, ChannelCloserCB>>
-      callbacks_;
+  // Packets waiting for the next flush
+  folly::Synchronized<std::vector<PendingPacket>> pending_;
+  std::atomic<bool> flushScheduled_{false};
+  std::atomic<uint64_t> numBatchesSent_{0};
+  std::atomic<uint64_t> numDropped_{0};
   std::shared_ptr<folly::EventBase> evb_;
 };
 }}
@@ -15,6 +15,13 @@ void ThriftHandler::subscribe(unique_ptr<string> hostname, int port) {
   dist_->subscribe(move(hostname), port);
 }
 
+void ThriftHandler::subscribeFiltered(
+    unique_ptr<string> hostname,
+    int port,
+    unique_ptr<SubscriberFilter> filter) {
+  dist_->subscribe(move(hostname), port, move(*filter));
+}
+
 void ThriftHandler::unsubscribe(unique_ptr<string> hostname, int port) {
   dist_->unsubscribe(*hostname, port);
 }
@@ -22,15 +29,38 @@ void ThriftHandler::unsubscribe(unique_ptr<string> hostname, int port) {
 void ThriftHandler::receiveRxPacket(
     unique_ptr<RxPacketData> pkt,
     int16_t ethertype) {
-  dist_->distributeRxPacket(pkt.get());
-  buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  dist_->distributeRxPacket(pkt.get(), ethertype);
+  if (buffMgr_->wantsPkt(ethertype)) {
+    buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  }
 }
 
 void ThriftHandler::receiveTxPacket(
     unique_ptr<TxPacketData> pkt,
     int16_t ethertype) {
-  dist_->distributeTxPacket(pkt.get());
-  buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  dist_->distributeTxPacket(pkt.get(), ethertype);
+  if (buffMgr_->wantsPkt(ethertype)) {
+    buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  }
+}
+
+void ThriftHandler::receivePackets(
+    unique_ptr<vector<PublishedPacket>> pkts) {
+  for (auto& pkt : *pkts) {
+    auto& data = pkt.packet.pkt;
+    auto buffer = buffMgr_->wantsPkt(pkt.ethertype);
+    if (pkt.packet.rx) {
+      dist_->distributeRxPacket(&data.mutable_rxpkt(), pkt.ethertype);
+      if (buffer) {
+        buffMgr_->addPkt(PcapPkt(&data.get_rxpkt()), pkt.ethertype);
+      }
+    } else {
+      dist_->distributeTxPacket(&data.mutable_txpkt(), pkt.ethertype);
+      if (buffer) {
+        buffMgr_->addPkt(PcapPkt(&data.get_txpkt()), pkt.ethertype);
+      }
+    }
+  }
 }
 
 void ThriftHandler::kill(){
@@ -51,4 +81,8 @@ void ThriftHandler::dumpPacketsByType(
     buffMgr_->dumpPackets(out, type);
   }
 }
+
+void ThriftHandler::getCounters(map<string, int64_t>& counters) {
+  dist_->getCounters(counters);
+}
 }}
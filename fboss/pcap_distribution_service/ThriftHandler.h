@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <memory>
 
 #include "fboss/pcap_distribution_service/if/gen-cpp2/PcapPushSubscriber.h"
@@ -23,6 +24,10 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
    * Called by clients to subscribe to the distribution service
    */
   void subscribe(std::unique_ptr<std::string> hostname, int port) override;
+  void subscribeFiltered(
+      std::unique_ptr<std::string> hostname,
+      int port,
+      std::unique_ptr<SubscriberFilter> filter) override;
   void unsubscribe(std::unique_ptr<std::string> hostname, int port) override;
 
   /*
@@ -32,6 +37,8 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
       override;
   void receiveTxPacket(std::unique_ptr<TxPacketData> pkt, int16_t ethertype)
       override;
+  void receivePackets(std::unique_ptr<std::vector<PublishedPacket>> pkts)
+      override;
   /*
    * A thrift kill switch for the service
    */
@@ -45,6 +52,8 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
       std::vector<CapturedPacket>& out,
       std::unique_ptr<std::vector<int16_t>> ethertypes) override;
 
+  void getCounters(std::map<std::string, int64_t>& counters) override;
+
  private:
   std::unique_ptr<PcapDistributor> dist_;
   std::unique_ptr<PcapBufferManager> buffMgr_;
@@ -4,6 +4,7 @@ namespace py.asyncio neteng.fboss.asyncio.pcap_pubsub
 namespace d neteng.fboss.pcap_pubsub
 
 typedef binary (cpp2.type = "::folly::fbstring") fbbinary
+typedef binary (cpp2.type = "std::unique_ptr<folly::IOBuf>") IOBufPtr
 
 const i32 PCAP_PUBSUB_PORT = 5911
 
@@ -43,6 +44,27 @@ struct CapturedPacket {
   2: required PacketData pkt
 }
 
+// Which packets a subscriber gets. Unset fields match any packet. A port or
+// VLAN filter only matches RX packets, as TX packets have neither.
+struct SubscriberFilter {
+  1: optional list<i16> ethertypes,
+  2: optional list<i32> ports,
+  3: optional list<i32> vlans,
+  // Only one in this many of the matching packets
+  4: i32 sampleRatio = 1
+}
+
+// Packets the distributor sends to its subscribers in one call
+struct CapturedPacketBatch {
+  1: required list<CapturedPacket> packets
+}
+
+// A packet sent to the distributor by the switch, along with its ethertype
+struct PublishedPacket {
+  1: required CapturedPacket packet,
+  2: required i16 ethertype
+}
+
 // This interface is for a user to connect to the service,
 // and open subscriptions and request packet dumps
 service PcapPushSubscriber {
@@ -50,6 +72,9 @@ service PcapPushSubscriber {
   // distributor
   void receiveRxPacket(1: RxPacketData packet, 2: i16 type)
   void receiveTxPacket(1: TxPacketData packet, 2: i16 type)
+  // Called by the switch to send a batch of packets to the
+  // distributor in one call
+  void receivePackets(1: list<PublishedPacket> packets)
 
   // Give the switch the ability to kill the distribution
   // process if needed
@@ -59,11 +84,17 @@ service PcapPushSubscriber {
   // the service
   void subscribe(1: string client, 2: i32 port)
   void unsubscribe(1: string client, 2: i32 port)
+  // Subscribe to only some of the packets, filtered before they are sent
+  void subscribeFiltered(1: string client, 2: i32 port,
+                         3: SubscriberFilter filter)
 
   // Dump the requested packet as a list
   // Request by type of packet, or get all ethertypes
   list<CapturedPacket> dumpAllPackets()
   list<CapturedPacket> dumpPacketsByType(1: list<i16> ethertypes)
+
+  // Batches sent and packets dropped, overall and by subscriber
+  map<string, i64> getCounters()
 }
 
 // This interface is for a subscriber to receive a packet stream
@@ -73,4 +104,8 @@ service PcapSubscriber {
   // distributor upon receiving a packet from the switch.
   void receiveRxPacket(1: RxPacketData packet)
   void receiveTxPacket(1: TxPacketData packet)
+  // Called by the distributor with a CapturedPacketBatch serialized with
+  // the compact protocol, which it only serializes once for all of its
+  // subscribers
+  void receivePacketBatch(1: IOBufPtr serializedBatch)
 }
@@ -8,7 +8,10 @@ import threading
 
 from fboss.thrift_clients import PcapPushSubClient
 from neteng.fboss.asyncio.pcap_pubsub import PcapSubscriber as ThriftSub
+from neteng.fboss.asyncio.pcap_pubsub.ttypes import CapturedPacketBatch
+from thrift.protocol import TCompactProtocol
 from thrift.server import TAsyncioServer
+from thrift.util import Serializer
 
 
 class PcapSubscriber(ThriftSub.Iface):
@@ -17,14 +20,34 @@ class PcapSubscriber(ThriftSub.Iface):
         self.hostname = socket.gethostname()
         self.port = port
 
-    def subscribe(self, pub_hostname):
+    def subscribe(self, pub_hostname, sub_filter=None):
         # setup client
         self._client = PcapPushSubClient(pub_hostname)
-        self._client.subscribe(self.hostname, self.port)
+        if sub_filter is None:
+            self._client.subscribe(self.hostname, self.port)
+        else:
+            # a SubscriberFilter, applied by the distributor
+            self._client.subscribeFiltered(
+                self.hostname, self.port, sub_filter
+            )
 
     def unsubscribe(self):
         self._client.unsubscribe(self.hostname, self.port)
 
+    def receivePacketBatch(self, serializedBatch):
+        # The distributor serializes each batch once for all subscribers,
+        # hand its packets to the on receive functions one at a time
+        batch = Serializer.deserialize(
+            TCompactProtocol.TCompactProtocolFactory(),
+            serializedBatch,
+            CapturedPacketBatch(),
+        )
+        for pkt in batch.packets:
+            if pkt.rx:
+                self.receiveRxPacket(pkt.pkt.get_rxpkt())
+            else:
+                self.receiveTxPacket(pkt.pkt.get_txpkt())
+
     # inherit this class and override the on receive functions
     # additionally, these functions need to be thread-safe
 
@@ -45,4 +45,23 @@ void QsfpServiceHandler::syncPorts(
   manager_->syncPorts(info, std::move(ports));
 }
 
+void QsfpServiceHandler::getTransceiverChanges(
+    TransceiverChanges& changes, int64_t sinceGeneration) {
+  manager_->getTransceiverChanges(changes, sinceGeneration);
+}
+
+void QsfpServiceHandler::getTransceiverInfoSnapshot(
+    TransceiverInfoSnapshot& snapshot,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int64_t sinceVersion) {
+  manager_->getTransceiverInfoSnapshot(snapshot, std::move(ids), sinceVersion);
+}
+
+void QsfpServiceHandler::getTransceiverHistory(
+    std::map<int32_t, TransceiverHistory>& history,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int32_t windowSeconds) {
+  manager_->getTransceiversHistory(history, std::move(ids), windowSeconds);
+}
+
 }} // facebook::fboss
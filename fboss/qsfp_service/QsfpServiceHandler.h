@@ -39,6 +39,30 @@ class QsfpServiceHandler : public facebook::fboss::QsfpServiceSvIf,
     std::map<int32_t, TransceiverInfo>& info,
     std::unique_ptr<std::map<int32_t, PortStatus>> ports) override;
 
+  /*
+   * Return the transceivers that changed since the given generation.
+   */
+  void getTransceiverChanges(
+    TransceiverChanges& changes, int64_t sinceGeneration) override;
+
+  /*
+   * Return the information of the transceivers as of the last refresh,
+   * serialized, unless nothing changed since the given version.
+   */
+  void getTransceiverInfoSnapshot(
+    TransceiverInfoSnapshot& snapshot,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int64_t sinceVersion) override;
+
+  /*
+   * Return a summary of the DOM sensor readings of each passed in
+   * transceiver over the last windowSeconds.
+   */
+  void getTransceiverHistory(
+    std::map<int32_t, TransceiverHistory>& history,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int32_t windowSeconds) override;
+
   /*
    * Customise the transceiver based on the speed at which it has
    * been configured to operate at
@@ -13,6 +13,8 @@
 #include <folly/io/async/EventBase.h>
 #include "fboss/qsfp_service/TransceiverManager.h"
 
+#include <chrono>
+
 namespace facebook { namespace fboss {
 class StatsPublisher {
  public:
@@ -25,6 +27,10 @@ class StatsPublisher {
   static void bumpWriteFailure();
   static void bumpModuleErrors();
   static void missingPorts(TransceiverID module);
+  // How long refreshing all of the transceivers took
+  static void refreshLatency(std::chrono::milliseconds latency);
+  // How many times the muxes were switched over while refreshing them
+  static void muxSwitchesPerRefresh(uint64_t switches);
 
  private:
   TransceiverManager* transceiverManager_{nullptr};
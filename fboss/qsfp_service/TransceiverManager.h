@@ -20,6 +20,14 @@ class TransceiverManager {
   virtual void syncPorts(
     std::map<int32_t, TransceiverInfo>& info,
     std::unique_ptr<std::map<int32_t, PortStatus>> ports) = 0;
+  virtual void getTransceiverChanges(
+    TransceiverChanges& changes, int64_t sinceGeneration) = 0;
+  virtual void getTransceiverInfoSnapshot(
+    TransceiverInfoSnapshot& snapshot,
+    std::unique_ptr<std::vector<int32_t>> ids, int64_t sinceVersion) = 0;
+  virtual void getTransceiversHistory(
+    std::map<int32_t, TransceiverHistory>& history,
+    std::unique_ptr<std::vector<int32_t>> ids, int32_t windowSeconds) = 0;
 
   bool isValidTransceiver(int32_t id) {
     return id < transceivers_.size() && id >= 0;
@@ -37,4 +37,34 @@ service QsfpService extends fb303.FacebookService {
   map<i32, transceiver.TransceiverInfo> syncPorts(1: map<i32, ctrl.PortStatus> ports)
     throws (1: fboss.FbossBaseError error)
 
+  /*
+   * Get the transceivers whose information changed in a way clients care
+   * about (presence, vendor or cable data, settings, alarm and warning
+   * flags) since the given generation, which is 0 to get all of them.
+   * Changes to just the raw sensor readings are not reported, so this is
+   * cheap to call as often as needed to stay in sync.
+   */
+  transceiver.TransceiverChanges getTransceiverChanges(1: i64 sinceGeneration)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Get the min, max and average of the DOM sensor readings of each
+   * transceiver over the last windowSeconds, along with whether they are
+   * trending the way a failing transceiver's do. Transceivers with no
+   * readings in the window are left out.
+   */
+  map<i32, transceiver.TransceiverHistory> getTransceiverHistory(
+      1: list<i32> idx, 2: i32 windowSeconds)
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Like getTransceiverInfo, but as of the last refresh cycle, and only if
+   * any of it changed since sinceVersion, which is 0 to always get it. The
+   * response for each version and set of transceivers is only serialized
+   * once, so this is cheap to poll from any number of clients.
+   */
+  transceiver.TransceiverInfoSnapshot getTransceiverInfoSnapshot(
+      1: list<i32> idx, 2: i64 sinceVersion)
+    throws (1: fboss.FbossBaseError error)
+
 }
@@ -162,6 +162,7 @@ struct TransceiverInfo {
 }
 
 typedef binary (cpp2.type = "folly::IOBuf") IOBuf
+typedef binary (cpp2.type = "std::unique_ptr<folly::IOBuf>") IOBufPtr
 
 struct RawDOMData {
   // The SFF DOM exposes at most 256 bytes at a time and is divided in
@@ -174,3 +175,50 @@ struct RawDOMData {
   2: IOBuf page0,
   3: optional IOBuf page3,
 }
+
+struct TransceiverChanges {
+  // Pass this back in the next request to only get later changes
+  1: i64 generation,
+  // Only the transceivers which changed since the requested generation
+  2: map<i32, TransceiverInfo> changed,
+}
+
+struct TransceiverInfoMap {
+  1: map<i32, TransceiverInfo> infos,
+}
+
+struct TransceiverInfoSnapshot {
+  // Pass this back in the next request to only get the infos once they
+  // change again
+  1: i64 version,
+  // A TransceiverInfoMap, serialized with the compact protocol. Unset if
+  // nothing changed since the requested version
+  2: optional IOBufPtr infos,
+}
+
+struct SensorHistory {
+  1: double min,
+  2: double max,
+  3: double average,
+  // Average over the later half of the window minus that over the earlier
+  // half, i.e. which way the readings are heading
+  4: double trend,
+  // Whether the trend is past the threshold qsfp_service considers a sign
+  // of the transceiver wearing out
+  5: bool degrading,
+}
+
+struct ChannelHistory {
+  1: i32 channel,
+  2: SensorHistory rxPwr,
+  3: SensorHistory txBias,
+  4: SensorHistory txPwr,
+}
+
+struct TransceiverHistory {
+  1: i32 port,  // physical port number
+  // The window the history covers, which may be shorter than was asked for
+  2: i32 windowSeconds,
+  3: optional SensorHistory temp,
+  4: list<ChannelHistory> channels,
+}
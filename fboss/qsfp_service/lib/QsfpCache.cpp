@@ -18,6 +18,7 @@ namespace facebook { namespace fboss {
 
 namespace {
 constexpr std::chrono::seconds kLivenessCheckInterval(30);
+constexpr std::chrono::seconds kChangesCheckInterval(5);
 }
 
 void QsfpCache::init(folly::EventBase* evb, const PortMapThrift& ports) {
@@ -35,7 +36,7 @@ void QsfpCache::init(folly::EventBase* evb, const PortMapThrift& ports) {
   portsChanged(ports);
 
   attachEventBase(evb);
-  scheduleTimeout(kLivenessCheckInterval);
+  scheduleTimeout(kChangesCheckInterval);
 
 }
 
@@ -123,7 +124,8 @@ folly::Future<folly::Unit> QsfpCache::confirmAlive() {
       // on qsfp_service side
       XLOG(DBG1) << "qsfp_service restarted. aliveSince: " << remoteAliveSince_
                  << " -> " << aliveSince;
-      std::tie(remoteAliveSince_,  remoteGen_) = std::make_tuple(aliveSince, 0);
+      std::tie(remoteAliveSince_,  remoteGen_, remoteTcvrGen_) =
+          std::make_tuple(aliveSince, 0, 0);
     }
   };
 
@@ -131,6 +133,34 @@ folly::Future<folly::Unit> QsfpCache::confirmAlive() {
      getAliveSince).thenValue(storeIt);
 }
 
+folly::Future<folly::Unit> QsfpCache::fetchChanges() {
+  CHECK(evb_->isInEventBaseThread());
+
+  auto getChanges = [gen = remoteTcvrGen_](
+                        std::unique_ptr<QsfpServiceAsyncClient> client) {
+    XLOG(DBG3) << "Polling qsfp_service for changes since " << gen;
+    auto options = QsfpClient::getRpcOptions();
+    return client->future_getTransceiverChanges(options, gen);
+  };
+  auto storeIt = [this, oldAliveSince = remoteAliveSince_](auto&& changes) {
+    XLOG(DBG3) << changes.changed.size() << " transceivers changed by "
+               << "generation " << changes.generation;
+    this->updateCache(changes.changed);
+    if (remoteAliveSince_ == oldAliveSince) {
+      // no restart occurred in middle of request, store gen
+      remoteTcvrGen_ = changes.generation;
+    }
+  };
+
+  return QsfpClient::createClient(evb_)
+      .then(evb_, getChanges)
+      .then(evb_, storeIt)
+      .onError([](const std::exception& e) {
+        XLOG(ERR) << "Exception getting changes from qsfp_service: "
+                  << e.what();
+      });
+}
+
 folly::Future<folly::Unit> QsfpCache::doSync(PortMapThrift&& toSync) {
   CHECK(evb_->isInEventBaseThread());
 
@@ -221,8 +251,16 @@ folly::Future<TransceiverInfo> QsfpCache::futureGet(TransceiverID tcvrId) {
 }
 
 void QsfpCache::timeoutExpired() noexcept {
-  confirmAlive().then(&QsfpCache::maybeSync, this);
-  scheduleTimeout(kLivenessCheckInterval);
+  auto now = std::chrono::steady_clock::now();
+  if (now - lastAliveCheck_ >= kLivenessCheckInterval) {
+    lastAliveCheck_ = now;
+    confirmAlive()
+        .then(&QsfpCache::maybeSync, this)
+        .then(&QsfpCache::fetchChanges, this);
+  } else {
+    fetchChanges();
+  }
+  scheduleTimeout(kChangesCheckInterval);
 }
 
 void QsfpCache::dump() {
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <mutex>
 
 #include <boost/container/flat_map.hpp>
@@ -51,12 +52,21 @@
  * qsfp_service. This request has all ports s.t the generation number
  * for the latest change to that port is > remoteGen_.
  *
+ * Picking up transceiver changes
+ * ------------------------------
+ * Transceivers also change on their own (modules plugged in, alarms
+ * raised), so we periodically ask qsfp_service for the transceivers
+ * that changed since the generation of its change log we last saw, via
+ * getTransceiverChanges. This is cheap while nothing changes, as nothing
+ * but the generation is returned in that case.
+ *
  * Detecting restarts
  * ------------------
  * We also need to handle potential restarts of the qsfp_service. In
  * this case, we periodically make aliveSince calls to qsfp_service
  * and store the last aliveSince. If this changes, we reset remoteGen_
- * back to zero so we will re-sync all ports.
+ * and remoteTcvrGen_ back to zero so we will re-sync all ports and
+ * transceivers.
  *
  * Threading model
  * ---------------
@@ -130,6 +140,9 @@ class QsfpCache : private folly::AsyncTimeout {
   // checks qsfp_service is alive and detects restarts
   folly::Future<folly::Unit> confirmAlive();
 
+  // picks up transceivers that changed since remoteTcvrGen_
+  folly::Future<folly::Unit> fetchChanges();
+
   /* Called after successful sync to update transceivers in to our
    * cache.
    */
@@ -157,6 +170,10 @@ class QsfpCache : private folly::AsyncTimeout {
 
   // last aliveSince from qsfp_service
   int64_t remoteAliveSince_{-1};
+  std::chrono::steady_clock::time_point lastAliveCheck_;
+
+  // generation of qsfp_service's transceiver changes we are up to date with
+  int64_t remoteTcvrGen_{0};
 
   std::atomic_bool initialized_{false};
 };
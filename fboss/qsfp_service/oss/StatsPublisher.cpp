@@ -28,4 +28,8 @@ void StatsPublisher::missingPorts(TransceiverID /* unused */) {
 }
 // static
 void StatsPublisher::bumpModuleErrors() {}
+// static
+void StatsPublisher::refreshLatency(std::chrono::milliseconds /* unused */) {}
+// static
+void StatsPublisher::muxSwitchesPerRefresh(uint64_t /* unused */) {}
 }}
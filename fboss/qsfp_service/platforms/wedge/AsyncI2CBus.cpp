@@ -0,0 +1,235 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/qsfp_service/platforms/wedge/AsyncI2CBus.h"
+
+#include <folly/Try.h>
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <cstring>
+
+DEFINE_int32(
+    i2c_interactive_burst,
+    4,
+    "Most interactive I2C accesses to perform in a row while background "
+    "ones are waiting");
+
+namespace facebook { namespace fboss {
+
+namespace {
+thread_local AsyncI2CBus::Priority threadPriority =
+    AsyncI2CBus::Priority::INTERACTIVE;
+}
+
+AsyncI2CBus::PriorityGuard::PriorityGuard(Priority priority)
+    : previous_(threadPriority) {
+  threadPriority = priority;
+}
+
+AsyncI2CBus::PriorityGuard::~PriorityGuard() {
+  threadPriority = previous_;
+}
+
+AsyncI2CBus::AsyncI2CBus(std::unique_ptr<TransceiverI2CApi> bus)
+    : bus_(std::move(bus)) {
+  thread_ = std::thread([this]() { run(); });
+}
+
+AsyncI2CBus::~AsyncI2CBus() {
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+folly::Future<std::unique_ptr<folly::IOBuf>> AsyncI2CBus::moduleReadAsync(
+    unsigned int module, uint8_t i2cAddress, int offset, int len,
+    Priority priority) {
+  Request request;
+  request.read = std::make_unique<Read>();
+  request.read->module = module;
+  request.read->i2cAddress = i2cAddress;
+  request.read->offset = offset;
+  request.read->len = len;
+  auto future = request.read->promise.getFuture();
+  enqueue(priority, std::move(request));
+  return future;
+}
+
+folly::Future<folly::Unit> AsyncI2CBus::moduleWriteAsync(
+    unsigned int module, uint8_t i2cAddress, int offset, int len,
+    const uint8_t* buf, Priority priority) {
+  std::vector<uint8_t> data(buf, buf + len);
+  return enqueueJob(
+      priority,
+      [module, i2cAddress, offset, len, data = std::move(data)](
+          TransceiverI2CApi* bus) {
+        bus->moduleWrite(module, i2cAddress, offset, len, data.data());
+      });
+}
+
+void AsyncI2CBus::open() {
+  bus_->open();
+}
+
+void AsyncI2CBus::close() {
+  bus_->close();
+}
+
+void AsyncI2CBus::moduleRead(unsigned int module, uint8_t i2cAddress,
+                             int offset, int len, uint8_t* buf) {
+  auto data =
+      moduleReadAsync(module, i2cAddress, offset, len, threadPriority).get();
+  memcpy(buf, data->data(), len);
+}
+
+void AsyncI2CBus::moduleWrite(unsigned int module, uint8_t i2cAddress,
+                              int offset, int len, const uint8_t* buf) {
+  // We wait for the write, so there's no need to copy buf
+  enqueueJob(threadPriority, [=](TransceiverI2CApi* bus) {
+    bus->moduleWrite(module, i2cAddress, offset, len, buf);
+  }).get();
+}
+
+void AsyncI2CBus::moduleBatch(unsigned int module,
+                              const std::vector<ModuleOp>& ops) {
+  // The batch goes as one request, so it still only selects the module once
+  enqueueJob(threadPriority, [module, &ops](TransceiverI2CApi* bus) {
+    bus->moduleBatch(module, ops);
+  }).get();
+}
+
+void AsyncI2CBus::verifyBus(bool autoReset) {
+  enqueueJob(threadPriority, [autoReset](TransceiverI2CApi* bus) {
+    bus->verifyBus(autoReset);
+  }).get();
+}
+
+uint64_t AsyncI2CBus::getMuxSwitches() const {
+  return bus_->getMuxSwitches();
+}
+
+folly::Future<folly::Unit> AsyncI2CBus::enqueueJob(
+    Priority priority, Job job) {
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  Request request;
+  request.job = [job = std::move(job), promise = std::move(promise)](
+      TransceiverI2CApi* bus) mutable {
+    promise.setWith([&]() { job(bus); });
+  };
+  enqueue(priority, std::move(request));
+  return future;
+}
+
+void AsyncI2CBus::enqueue(Priority priority, Request request) {
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    queues_[static_cast<int>(priority)].push_back(std::move(request));
+  }
+  cv_.notify_one();
+}
+
+void AsyncI2CBus::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() {
+      return stop_ || !queues_[0].empty() || !queues_[1].empty();
+    });
+    if (stop_) {
+      return;
+    }
+    auto requests = nextLocked();
+    lock.unlock();
+    perform(requests);
+    lock.lock();
+  }
+}
+
+std::vector<AsyncI2CBus::Request> AsyncI2CBus::nextLocked() {
+  auto& interactive = queues_[static_cast<int>(Priority::INTERACTIVE)];
+  auto& background = queues_[static_cast<int>(Priority::BACKGROUND)];
+  auto takeInteractive = !interactive.empty() &&
+      (background.empty() || interactiveStreak_ < FLAGS_i2c_interactive_burst);
+  interactiveStreak_ = takeInteractive ? interactiveStreak_ + 1 : 0;
+  auto& queue = takeInteractive ? interactive : background;
+
+  std::vector<Request> requests;
+  requests.push_back(std::move(queue.front()));
+  queue.pop_front();
+  if (!requests.front().read) {
+    return requests;
+  }
+
+  // Merge the reads queued up behind this one, up to the next request
+  // which isn't a read, as a write or batch may change what they'd read.
+  // Keep going until nothing more merges, as each merge widens the range.
+  const auto& first = *requests.front().read;
+  int start = first.offset;
+  int end = first.offset + first.len;
+  for (bool merged = true; merged;) {
+    merged = false;
+    for (auto it = queue.begin(); it != queue.end() && it->read;) {
+      const auto& read = *it->read;
+      auto newStart = std::min(start, read.offset);
+      auto newEnd = std::max(end, read.offset + read.len);
+      if (read.module != first.module || read.i2cAddress != first.i2cAddress ||
+          read.offset > end || read.offset + read.len < start ||
+          newEnd - newStart > MAX_MERGED_READ) {
+        ++it;
+        continue;
+      }
+      start = newStart;
+      end = newEnd;
+      requests.push_back(std::move(*it));
+      it = queue.erase(it);
+      merged = true;
+    }
+  }
+  return requests;
+}
+
+void AsyncI2CBus::perform(std::vector<Request>& requests) {
+  if (!requests.front().read) {
+    requests.front().job(bus_.get());
+    return;
+  }
+
+  const auto& first = *requests.front().read;
+  int start = first.offset;
+  int end = first.offset + first.len;
+  for (const auto& request : requests) {
+    start = std::min(start, request.read->offset);
+    end = std::max(end, request.read->offset + request.read->len);
+  }
+
+  auto data = folly::IOBuf::create(end - start);
+  data->append(end - start);
+  auto result = folly::makeTryWith([&]() {
+    bus_->moduleRead(
+        first.module, first.i2cAddress, start, end - start,
+        data->writableData());
+  });
+  mergedReads_ += requests.size() - 1;
+
+  for (auto& request : requests) {
+    auto& read = *request.read;
+    if (result.hasException()) {
+      read.promise.setException(result.exception());
+    } else {
+      read.promise.setValue(folly::IOBuf::copyBuffer(
+          data->data() + (read.offset - start), read.len));
+    }
+  }
+}
+
+}} // facebook::fboss
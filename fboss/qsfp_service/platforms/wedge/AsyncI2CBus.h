@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/lib/usb/TransceiverI2CApi.h"
+
+#include <folly/Function.h>
+#include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * Queues up the accesses to a bus and performs them one at a time from a
+ * thread of its own, so callers can wait on futures rather than tie up
+ * their own threads on the bus.
+ *
+ * Accesses are either interactive, i.e. on behalf of a thrift call, or
+ * background, i.e. the periodic refreshes. Interactive ones go first, but
+ * after i2c_interactive_burst of them in a row a waiting background one
+ * gets its turn, so neither can starve the other. Reads of adjacent or
+ * overlapping ranges of the same module which are queued up together are
+ * merged into a single transfer.
+ *
+ * The blocking TransceiverI2CApi calls go through the queue as well, at the
+ * priority the calling thread set with a PriorityGuard, or interactive if
+ * it didn't, so this can stand in for the bus it wraps.
+ */
+class AsyncI2CBus : public TransceiverI2CApi {
+ public:
+  enum class Priority {
+    INTERACTIVE,
+    BACKGROUND,
+  };
+
+  /*
+   * Sets the priority of the blocking calls made from this thread, for as
+   * long as the guard is in scope.
+   */
+  class PriorityGuard {
+   public:
+    explicit PriorityGuard(Priority priority);
+    ~PriorityGuard();
+
+   private:
+    Priority previous_;
+  };
+
+  explicit AsyncI2CBus(std::unique_ptr<TransceiverI2CApi> bus);
+  // Requests still queued up are failed with a BrokenPromise
+  ~AsyncI2CBus() override;
+
+  folly::Future<std::unique_ptr<folly::IOBuf>> moduleReadAsync(
+      unsigned int module, uint8_t i2cAddress, int offset, int len,
+      Priority priority);
+  // buf is copied, so it need not outlive the call
+  folly::Future<folly::Unit> moduleWriteAsync(
+      unsigned int module, uint8_t i2cAddress, int offset, int len,
+      const uint8_t* buf, Priority priority);
+
+  // Opening and closing just hold the device open, so these go straight
+  // through to the bus
+  void open() override;
+  void close() override;
+  void moduleRead(unsigned int module, uint8_t i2cAddress,
+                  int offset, int len, uint8_t* buf) override;
+  void moduleWrite(unsigned int module, uint8_t i2cAddress,
+                   int offset, int len, const uint8_t* buf) override;
+  void moduleBatch(unsigned int module,
+                   const std::vector<ModuleOp>& ops) override;
+  void verifyBus(bool autoReset) override;
+  uint64_t getMuxSwitches() const override;
+
+  /*
+   * The number of transfers saved by merging reads together.
+   */
+  uint64_t getMergedReads() const {
+    return mergedReads_;
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  AsyncI2CBus(AsyncI2CBus const &) = delete;
+  AsyncI2CBus& operator=(AsyncI2CBus const &) = delete;
+
+  enum : int {
+    // Never merge reads past a page's worth, which every bus can read
+    // in one go
+    MAX_MERGED_READ = 128,
+  };
+
+  using Job = folly::Function<void(TransceiverI2CApi*)>;
+
+  struct Read {
+    unsigned int module;
+    uint8_t i2cAddress;
+    int offset;
+    int len;
+    folly::Promise<std::unique_ptr<folly::IOBuf>> promise;
+  };
+
+  struct Request {
+    // Set for reads, which may be merged with others
+    std::unique_ptr<Read> read;
+    // Set for everything else
+    Job job;
+  };
+
+  folly::Future<folly::Unit> enqueueJob(Priority priority, Job job);
+  void enqueue(Priority priority, Request request);
+  void run();
+  /*
+   * Take the next request to perform off the queues. If it is a read, it
+   * comes with any queued reads it can be merged with.
+   */
+  std::vector<Request> nextLocked();
+  void perform(std::vector<Request>& requests);
+
+  std::unique_ptr<TransceiverI2CApi> bus_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // Indexed by Priority, only touched with mutex_ held
+  std::array<std::deque<Request>, 2> queues_;
+  int interactiveStreak_{0};
+  bool stop_{false};
+
+  std::atomic<uint64_t> mergedReads_{0};
+  std::thread thread_;
+};
+
+}} // facebook::fboss
@@ -46,6 +46,11 @@ void WedgeI2CBusLock::verifyBus(bool autoReset) {
   wedgeI2CBus_->verifyBus(autoReset);
 }
 
+uint64_t WedgeI2CBusLock::getMuxSwitches() const {
+  lock_guard<std::mutex> g(busMutex_);
+  return wedgeI2CBus_->getMuxSwitches();
+}
+
 void WedgeI2CBusLock::moduleRead(unsigned int module, uint8_t address,
                              int offset, int len, uint8_t *buf) {
   BusGuard g(this);
@@ -58,6 +63,13 @@ void WedgeI2CBusLock::moduleWrite(unsigned int module, uint8_t address,
   wedgeI2CBus_->moduleWrite(module, address, offset, len, buf);
 }
 
+void WedgeI2CBusLock::moduleBatch(unsigned int module,
+                                  const std::vector<ModuleOp>& ops) {
+  // One guard for the batch, so we only lock and open the device once
+  BusGuard g(this);
+  wedgeI2CBus_->moduleBatch(module, ops);
+}
+
 void WedgeI2CBusLock::read(uint8_t address, int offset,
                            int len, uint8_t *buf) {
   BusGuard g(this);
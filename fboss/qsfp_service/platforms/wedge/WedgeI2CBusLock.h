@@ -29,11 +29,14 @@ class WedgeI2CBusLock : public TransceiverI2CApi {
                   int offset, int len, uint8_t* buf);
   void moduleWrite(unsigned int module, uint8_t i2cAddress,
                   int offset, int len, const uint8_t* buf);
+  void moduleBatch(unsigned int module, const std::vector<ModuleOp>& ops);
   void read(uint8_t i2cAddress, int offset, int len, uint8_t* buf);
   void write(uint8_t i2cAddress, int offset, int len, const uint8_t* buf);
 
   void verifyBus(bool autoReset);
 
+  uint64_t getMuxSwitches() const;
+
  private:
   // Forbidden copy constructor and assignment operator
   WedgeI2CBusLock(WedgeI2CBusLock const &) = delete;
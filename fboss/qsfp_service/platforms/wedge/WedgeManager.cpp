@@ -1,21 +1,105 @@
 #include "fboss/qsfp_service/platforms/wedge/WedgeManager.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/gen/Base.h>
+#include <folly/io/IOBufQueue.h>
 
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include "fboss/agent/FbossError.h"
+#include "fboss/qsfp_service/StatsPublisher.h"
+#include "fboss/qsfp_service/platforms/wedge/AsyncI2CBus.h"
 #include "fboss/qsfp_service/platforms/wedge/WedgeQsfp.h"
 #include "fboss/qsfp_service/sff/QsfpModule.h"
 
+#include <algorithm>
+#include <thread>
+
+DEFINE_int32(
+    qsfp_module_refresh_timeout_ms,
+    1000,
+    "Refreshes of a module taking longer than this count as failures, "
+    "making us back off from refreshing it");
+DEFINE_int32(
+    qsfp_max_refresh_backoff_cycles,
+    32,
+    "Most refresh cycles to skip a failing module for. Each failure in a "
+    "row doubles the number of cycles skipped, up to this");
+
+using apache::thrift::CompactSerializer;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
 namespace facebook { namespace fboss {
 
-WedgeManager::WedgeManager() {}
+namespace {
+
+// Most sets of IDs to keep serialized responses for, in each version
+constexpr size_t kMaxCachedResponses = 64;
+
+bool sameFlags(const Sensor& a, const Sensor& b) {
+  return a.__isset.flags == b.__isset.flags &&
+      (!a.__isset.flags || a.flags == b.flags);
+}
+
+/*
+ * Whether b differs from a in anything but the raw sensor readings and
+ * stats, which change on just about every refresh. Crossing a threshold
+ * still counts, since that changes the alarm and warning flags.
+ */
+bool notableChange(const TransceiverInfo& a, const TransceiverInfo& b) {
+  if (a.present != b.present || a.transceiver != b.transceiver ||
+      a.port != b.port ||
+      a.__isset.vendor != b.__isset.vendor || !(a.vendor == b.vendor) ||
+      a.__isset.cable != b.__isset.cable || !(a.cable == b.cable) ||
+      a.__isset.settings != b.__isset.settings ||
+      !(a.settings == b.settings) ||
+      a.__isset.thresholds != b.__isset.thresholds ||
+      !(a.thresholds == b.thresholds) ||
+      a.__isset.sensor != b.__isset.sensor ||
+      a.channels.size() != b.channels.size()) {
+    return true;
+  }
+  if (a.__isset.sensor && (!sameFlags(a.sensor.temp, b.sensor.temp) ||
+                           !sameFlags(a.sensor.vcc, b.sensor.vcc))) {
+    return true;
+  }
+  for (size_t i = 0; i < a.channels.size(); ++i) {
+    const auto& sa = a.channels[i].sensors;
+    const auto& sb = b.channels[i].sensors;
+    if (a.channels[i].channel != b.channels[i].channel ||
+        !sameFlags(sa.rxPwr, sb.rxPwr) || !sameFlags(sa.txBias, sb.txBias) ||
+        !sameFlags(sa.txPwr, sb.txPwr)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // unnamed namespace
+
+WedgeManager::WedgeManager()
+    // Versions start from the time we came up, so those of an earlier run
+    // clients may still pass in don't match ours
+    : lastVersion_(duration_cast<milliseconds>(
+                       system_clock::now().time_since_epoch())
+                       .count()) {
+  auto snapshot = std::make_shared<InfoSnapshot>();
+  snapshot->version = lastVersion_;
+  *snapshot_.wlock() = std::move(snapshot);
+}
 
 void WedgeManager::initTransceiverMap() {
   // If we can't get access to the USB devices, don't bother to
   // create the QSFP objects;  this is likely to be a permanent
   // error.
   try {
-    wedgeI2cBus_ = getI2CBus();
+    // Queue up the accesses to the bus, so those made for thrift calls get
+    // their turn ahead of the background refreshes
+    wedgeI2cBus_ = std::make_unique<AsyncI2CBus>(getI2CBus());
   } catch (const I2cError& ex) {
     XLOG(ERR) << "failed to initialize I2C interface: " << ex.what();
     return;
@@ -37,11 +121,22 @@ void WedgeManager::initTransceiverMap() {
     transceivers_.push_back(move(qsfp));
     XLOG(INFO) << "making QSFP for " << idx;
   }
+
+  latestInfos_.resize(transceivers_.size());
+  for (int idx = 0; idx < static_cast<int>(transceivers_.size()); ++idx) {
+    try {
+      publishInfo(idx, transceivers_[idx]->getTransceiverInfo());
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "Transceiver " << idx
+                << ": Error calling getTransceiverInfo(): " << ex.what();
+    }
+  }
+  publishSnapshot();
 }
 
 void WedgeManager::getTransceiversInfo(std::map<int32_t, TransceiverInfo>& info,
     std::unique_ptr<std::vector<int32_t>> ids) {
-  XLOG(INFO) << "Received request for getTransceiverInfo, with ids: "
+  XLOG(DBG2) << "Received request for getTransceiverInfo, with ids: "
              << (ids->size() > 0 ? folly::join(",", *ids) : "None");
   if (ids->empty()) {
     folly::gen::range(0, getNumQsfpModules()) |
@@ -65,7 +160,7 @@ void WedgeManager::getTransceiversInfo(std::map<int32_t, TransceiverInfo>& info,
 void WedgeManager::getTransceiversRawDOMData(
     std::map<int32_t, RawDOMData>& info,
     std::unique_ptr<std::vector<int32_t>> ids) {
-  XLOG(INFO) << "Received request for getTransceiversRawDOMData, with ids: "
+  XLOG(DBG2) << "Received request for getTransceiversRawDOMData, with ids: "
              << (ids->size() > 0 ? folly::join(",", *ids) : "None");
   if (ids->empty()) {
     folly::gen::range(0, getNumQsfpModules()) |
@@ -81,7 +176,38 @@ void WedgeManager::getTransceiversRawDOMData(
                   << ": Error calling getRawDOMData(): " << ex.what();
       }
     }
-    info[i] = data;
+    info[i] = std::move(data);
+  }
+}
+
+void WedgeManager::getTransceiversHistory(
+    std::map<int32_t, TransceiverHistory>& history,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int32_t windowSeconds) {
+  XLOG(DBG2) << "Received request for getTransceiversHistory, with ids: "
+             << (ids->size() > 0 ? folly::join(",", *ids) : "None")
+             << ", window: " << windowSeconds << "s";
+  if (windowSeconds <= 0) {
+    throw FbossError("Invalid history window: ", windowSeconds, "s");
+  }
+  if (ids->empty()) {
+    folly::gen::range(0, getNumQsfpModules()) |
+      folly::gen::appendTo(*ids);
+  }
+  for (const auto& i : *ids) {
+    if (!isValidTransceiver(i)) {
+      continue;
+    }
+    try {
+      auto moduleHistory =
+        transceivers_[TransceiverID(i)]->getTransceiverHistory(windowSeconds);
+      if (moduleHistory.__isset.temp || !moduleHistory.channels.empty()) {
+        history[i] = std::move(moduleHistory);
+      }
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "Transceiver " << i
+                << ": Error calling getTransceiverHistory(): " << ex.what();
+    }
   }
 }
 
@@ -102,35 +228,243 @@ void WedgeManager::syncPorts(
       })
     | folly::gen::as<std::vector>();
 
+  // Syncing may customize the modules inline, so sync the modules behind
+  // each controller in parallel, like we refresh them
+  std::map<int, std::vector<int>> groupsByController;
+  for (int i = 0; i < static_cast<int>(groups.size()); ++i) {
+    groupsByController[getI2CControllerForModule(groups[i].key())]
+        .push_back(i);
+  }
+  std::vector<folly::Optional<TransceiverInfo>> synced(groups.size());
+
   std::lock_guard<std::mutex> g(mutex_);
-  for (auto& group : groups) {
-    int32_t transceiverIdx = group.key();
-    XLOG(INFO) << "Syncing ports of transceiver " << transceiverIdx;
+  latestInfos_.resize(transceivers_.size());
+  forEachController(
+      groupsByController, [this, &groups, &synced](const std::vector<int>& m) {
+        for (auto i : m) {
+          auto& group = groups[i];
+          int32_t transceiverIdx = group.key();
+          XLOG(INFO) << "Syncing ports of transceiver " << transceiverIdx;
 
-    try {
-      auto transceiver = transceivers_.at(transceiverIdx).get();
-      transceiver->transceiverPortsChanged(group.values());
-      info[transceiverIdx] = transceiver->getTransceiverInfo();
-    } catch (const std::exception& ex) {
-      XLOG(ERR) << "Transceiver " << transceiverIdx
-                << ": Error calling syncPorts(): " << ex.what();
+          try {
+            auto transceiver = transceivers_.at(transceiverIdx).get();
+            transceiver->transceiverPortsChanged(group.values());
+            synced[i] = transceiver->getTransceiverInfo();
+            publishInfo(transceiverIdx, *synced[i]);
+          } catch (const std::exception& ex) {
+            XLOG(ERR) << "Transceiver " << transceiverIdx
+                      << ": Error calling syncPorts(): " << ex.what();
+          }
+        }
+      });
+  publishSnapshot();
+
+  // Failed modules are left out of the result, so callers retry them
+  std::vector<int32_t> failed;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    if (synced[i]) {
+      info[groups[i].key()] = std::move(*synced[i]);
+    } else {
+      failed.push_back(groups[i].key());
     }
   }
+  if (!failed.empty()) {
+    XLOG(WARNING) << "Synced " << info.size() << " of " << groups.size()
+                  << " transceivers, failed: " << folly::join(",", failed);
+  }
 }
 
 void WedgeManager::refreshTransceivers() {
   std::lock_guard<std::mutex> g(mutex_);
+  AsyncI2CBus::PriorityGuard priority(AsyncI2CBus::Priority::BACKGROUND);
+  auto start = steady_clock::now();
 
+  // Keep the bus open for the whole cycle, rather than opening it for each
+  // access, so module selections are kept between the accesses to a module
+  wedgeI2cBus_->open();
+  SCOPE_EXIT {
+    wedgeI2cBus_->close();
+  };
   wedgeI2cBus_->verifyBus(false);
+  auto muxSwitches = wedgeI2cBus_->getMuxSwitches();
 
-  for (const auto& transceiver : transceivers_) {
+  refreshStates_.resize(transceivers_.size());
+  latestInfos_.resize(transceivers_.size());
+  std::map<int, std::vector<int>> modulesByController;
+  for (int idx = 0; idx < static_cast<int>(transceivers_.size()); ++idx) {
+    auto& state = refreshStates_[idx];
+    if (state.skipCycles > 0) {
+      --state.skipCycles;
+      continue;
+    }
+    modulesByController[getI2CControllerForModule(idx)].push_back(idx);
+  }
+
+  forEachController(modulesByController, [this](const std::vector<int>& m) {
+    refreshModules(m);
+  });
+  publishSnapshot();
+
+  StatsPublisher::refreshLatency(
+      duration_cast<milliseconds>(steady_clock::now() - start));
+  StatsPublisher::muxSwitchesPerRefresh(
+      wedgeI2cBus_->getMuxSwitches() - muxSwitches);
+}
+
+void WedgeManager::forEachController(
+    const std::map<int, std::vector<int>>& modulesByController,
+    const std::function<void(const std::vector<int>&)>& fn) {
+  // Each controller gets a thread of its own, bar the first which we handle
+  // from this thread
+  if (modulesByController.empty()) {
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (auto it = std::next(modulesByController.begin());
+       it != modulesByController.end();
+       ++it) {
+    const auto& modules = it->second;
+    threads.emplace_back([&fn, &modules]() { fn(modules); });
+  }
+  fn(modulesByController.begin()->second);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void WedgeManager::refreshModules(const std::vector<int>& modules) {
+  // We may be on a thread of our own, which needs its priority set too
+  AsyncI2CBus::PriorityGuard priority(AsyncI2CBus::Priority::BACKGROUND);
+  for (auto idx : modules) {
+    const auto& transceiver = transceivers_[idx];
+    auto start = steady_clock::now();
+    bool ok = true;
     try {
       transceiver->refresh();
+      publishInfo(idx, transceiver->getTransceiverInfo());
     } catch (const std::exception& ex) {
       XLOG(DBG2) << "Transceiver " << static_cast<int>(transceiver->getID())
                 << ": Error calling refresh(): " << ex.what();
+      ok = false;
+    }
+    moduleRefreshed(
+        idx, ok, duration_cast<milliseconds>(steady_clock::now() - start));
+  }
+}
+
+void WedgeManager::moduleRefreshed(int module, bool ok, milliseconds took) {
+  // Each module is only refreshed from one thread, and refreshStates_ isn't
+  // resized while refreshing, so this needs no locking of its own
+  auto& state = refreshStates_[module];
+  if (ok && took.count() <= FLAGS_qsfp_module_refresh_timeout_ms) {
+    state.failures = 0;
+    return;
+  }
+  ++state.failures;
+  state.skipCycles = std::min(
+      1 << std::min(state.failures - 1, 30),
+      FLAGS_qsfp_max_refresh_backoff_cycles);
+  XLOG(WARNING) << "Transceiver " << module << ": refresh "
+                << (ok ? "took " : "failed after ") << took.count()
+                << "ms, skipping it for " << state.skipCycles
+                << " refresh cycles";
+}
+
+void WedgeManager::publishInfo(int module, const TransceiverInfo& info) {
+  // Each module is only published from one thread at a time, and
+  // latestInfos_ isn't resized while publishing
+  latestInfos_[module] = info;
+  changes_.withWLock([module, &info](auto& lockedChanges) {
+    if (module >= static_cast<int>(lockedChanges.modules.size())) {
+      lockedChanges.modules.resize(module + 1);
+    }
+    auto& published = lockedChanges.modules[module];
+    if (published.generation != 0 && !notableChange(published.info, info)) {
+      return;
+    }
+    published.generation = ++lockedChanges.generation;
+    published.info = info;
+  });
+}
+
+void WedgeManager::getTransceiverChanges(
+    TransceiverChanges& changes, int64_t sinceGeneration) {
+  auto lockedChanges = changes_.rlock();
+  // A generation from the future means we restarted since the client last
+  // asked, so it has to start over.
+  if (sinceGeneration > lockedChanges->generation) {
+    sinceGeneration = 0;
+  }
+  for (int idx = 0; idx < static_cast<int>(lockedChanges->modules.size());
+       ++idx) {
+    const auto& published = lockedChanges->modules[idx];
+    if (published.generation > sinceGeneration) {
+      changes.changed[idx] = published.info;
     }
   }
+  changes.generation = lockedChanges->generation;
+}
+
+void WedgeManager::publishSnapshot() {
+  auto snapshot = std::make_shared<InfoSnapshot>();
+  for (int idx = 0; idx < static_cast<int>(latestInfos_.size()); ++idx) {
+    const auto& latest = latestInfos_[idx];
+    snapshot->infos[idx] = latest ? *latest : TransceiverInfo();
+  }
+  // Nothing but us replaces the snapshot, and we have mutex_ held
+  if (snapshot->infos == snapshot_.copy()->infos) {
+    // Keep the responses serialized so far
+    return;
+  }
+  snapshot->version = ++lastVersion_;
+  *snapshot_.wlock() = std::move(snapshot);
+}
+
+void WedgeManager::getTransceiverInfoSnapshot(
+    TransceiverInfoSnapshot& result,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int64_t sinceVersion) {
+  auto snapshot = snapshot_.copy();
+  result.version = snapshot->version;
+  if (sinceVersion == snapshot->version) {
+    return;
+  }
+
+  if (ids->empty()) {
+    folly::gen::range(0, getNumQsfpModules()) |
+      folly::gen::appendTo(*ids);
+  } else {
+    // The response is the same whichever order the IDs come in
+    std::sort(ids->begin(), ids->end());
+    ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+  }
+
+  std::shared_ptr<const folly::IOBuf> serialized;
+  snapshot->responses.withRLock([&](const auto& responses) {
+    auto it = responses.find(*ids);
+    if (it != responses.end()) {
+      serialized = it->second;
+    }
+  });
+  if (!serialized) {
+    TransceiverInfoMap response;
+    for (auto i : *ids) {
+      auto info = snapshot->infos.find(i);
+      response.infos[i] =
+          info != snapshot->infos.end() ? info->second : TransceiverInfo();
+    }
+    folly::IOBufQueue queue;
+    CompactSerializer::serialize(response, &queue);
+    serialized = queue.move();
+    snapshot->responses.withWLock([&](auto& responses) {
+      if (responses.size() < kMaxCachedResponses) {
+        responses.emplace(std::move(*ids), serialized);
+      }
+    });
+  }
+  // Clones share the buffer, rather than copying it
+  result.infos = serialized->clone();
+  result.__isset.infos = true;
 }
 
 std::unique_ptr<TransceiverI2CApi> WedgeManager::getI2CBus() {
@@ -1,6 +1,16 @@
 #pragma once
 
 #include <boost/container/flat_map.hpp>
+#include <folly/Optional.h>
+#include <folly/Synchronized.h>
+#include <folly/io/IOBuf.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "fboss/lib/usb/WedgeI2CBus.h"
 #include "fboss/qsfp_service/platforms/wedge/WedgeI2CBusLock.h"
@@ -22,6 +32,16 @@ class WedgeManager : public TransceiverManager {
     std::unique_ptr<std::vector<int32_t>> ids) override;
   void customizeTransceiver(int32_t idx, cfg::PortSpeed speed) override;
   void syncPorts(TransceiverMap& info, std::unique_ptr<PortMap> ports) override;
+  void getTransceiverChanges(
+    TransceiverChanges& changes, int64_t sinceGeneration) override;
+  void getTransceiverInfoSnapshot(
+    TransceiverInfoSnapshot& snapshot,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int64_t sinceVersion) override;
+  void getTransceiversHistory(
+    std::map<int32_t, TransceiverHistory>& history,
+    std::unique_ptr<std::vector<int32_t>> ids,
+    int32_t windowSeconds) override;
 
   int getNumQsfpModules() override {
     return 16;
@@ -34,6 +54,16 @@ class WedgeManager : public TransceiverManager {
 
  protected:
   virtual std::unique_ptr<TransceiverI2CApi> getI2CBus();
+
+  /*
+   * The I2C controller a module sits behind. Modules behind different
+   * controllers are refreshed in parallel, those behind the same one (even
+   * if on different mux channels, which still share the controller) one
+   * after the other. All of our platforms have a single controller.
+   */
+  virtual int getI2CControllerForModule(int /* module */) const {
+    return 0;
+  }
   std::unique_ptr<TransceiverI2CApi>
       wedgeI2cBus_; /* thread safe handle to access bus */
 
@@ -42,6 +72,74 @@ class WedgeManager : public TransceiverManager {
   WedgeManager(WedgeManager const &) = delete;
   WedgeManager& operator=(WedgeManager const &) = delete;
 
+  struct ModuleRefreshState {
+    // Refresh cycles to skip the module for
+    int skipCycles{0};
+    // Consecutive refreshes which failed or were too slow
+    int failures{0};
+  };
+
+  /*
+   * Call fn with the modules behind each controller, in parallel for the
+   * different controllers, and wait for all of them to finish.
+   */
+  void forEachController(
+      const std::map<int, std::vector<int>>& modulesByController,
+      const std::function<void(const std::vector<int>&)>& fn);
+  /*
+   * Refresh the modules behind one controller, one after the other.
+   */
+  void refreshModules(const std::vector<int>& modules);
+  /*
+   * Record how the refresh of a module went, and back off from refreshing
+   * it if it failed or was too slow, so it doesn't hold up the others.
+   */
+  void moduleRefreshed(int module, bool ok, std::chrono::milliseconds took);
+
+  /*
+   * Check whether the info of a module changed in a way that
+   * getTransceiverChanges() reports, and record a new generation if so.
+   */
+  void publishInfo(int module, const TransceiverInfo& info);
+  /*
+   * Make the latest info of all the modules the next version served by
+   * getTransceiverInfoSnapshot(), if any of it changed. Called with mutex_
+   * held, at the end of every refresh cycle or sync.
+   */
+  void publishSnapshot();
+
+  struct PublishedInfo {
+    // The generation the module last changed in, 0 if never published
+    int64_t generation{0};
+    TransceiverInfo info;
+  };
+  struct ChangeLog {
+    // Bumped for every change published
+    int64_t generation{0};
+    // Indexed by module
+    std::vector<PublishedInfo> modules;
+  };
+
+  struct InfoSnapshot {
+    int64_t version{0};
+    TransceiverMap infos;
+    // Responses serialized so far, by the sorted IDs they are for
+    mutable folly::Synchronized<
+        std::map<std::vector<int32_t>, std::shared_ptr<const folly::IOBuf>>>
+        responses;
+  };
+
   std::mutex mutex_;
+  // Indexed by module, only touched with mutex_ held
+  std::vector<ModuleRefreshState> refreshStates_;
+  // Indexed by module, only touched with mutex_ held. Unset until a module
+  // first reports its info
+  std::vector<folly::Optional<TransceiverInfo>> latestInfos_;
+  // Only touched with mutex_ held
+  int64_t lastVersion_{0};
+  // Replaced as a whole, so readers never wait on refreshes or modules
+  folly::Synchronized<std::shared_ptr<const InfoSnapshot>> snapshot_;
+  // Has its own lock so clients can poll it without waiting on refreshes
+  folly::Synchronized<ChangeLog> changes_;
 };
 }} // facebook::fboss
@@ -87,6 +87,28 @@ int WedgeQsfp::writeTransceiver(
   return len;
 }
 
+void WedgeQsfp::batchTransceiver(
+    const std::vector<TransceiverI2CApi::ModuleOp>& ops) {
+  try {
+    SCOPE_EXIT {
+      wedgeQsfpstats_.updateReadDownTime();
+      wedgeQsfpstats_.updateWriteDownTime();
+    };
+    SCOPE_FAIL {
+      StatsPublisher::bumpReadFailure();
+    };
+    SCOPE_SUCCESS {
+      wedgeQsfpstats_.recordReadSuccess();
+      wedgeQsfpstats_.recordWriteSuccess();
+    };
+    threadSafeI2CBus_->moduleBatch(module_ + 1, ops);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "Batch of " << ops.size() << " transfers with transceiver "
+              << module_ << " failed: " << folly::exceptionStr(ex);
+    throw;
+  }
+}
+
 folly::StringPiece WedgeQsfp::getName() {
   return moduleName_;
 }
@@ -79,6 +79,10 @@ class WedgeQsfp : public TransceiverImpl {
   int writeTransceiver(int dataAddress, int offset,
                        int len, uint8_t* fieldValue) override;
 
+  /* run a series of reads and writes while holding on to the bus */
+  void batchTransceiver(
+      const std::vector<TransceiverI2CApi::ModuleOp>& ops) override;
+
   /* This function detects if a SFP is present on the particular port */
   bool detectTransceiver() override;
 
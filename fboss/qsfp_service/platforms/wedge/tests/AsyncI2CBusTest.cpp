@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "fboss/qsfp_service/platforms/wedge/AsyncI2CBus.h"
+
+#include <folly/synchronization/Baton.h>
+#include <gflags/gflags.h>
+
+#include <gtest/gtest.h>
+
+#include <tuple>
+#include <vector>
+
+DECLARE_int32(i2c_interactive_burst);
+
+using namespace facebook::fboss;
+
+namespace {
+
+constexpr uint8_t kAddr = TransceiverI2CApi::ADDR_QSFP;
+constexpr unsigned int kBadModule = 7;
+
+/*
+ * Reads one byte of offset + i into each buf[i]. The first read blocks
+ * until released, so tests can queue up requests behind it.
+ */
+class FakeI2CBus : public TransceiverI2CApi {
+ public:
+  void open() override {}
+  void close() override {}
+  void moduleRead(unsigned int module, uint8_t, int offset, int len,
+                  uint8_t* buf) override {
+    if (blockNext_) {
+      blockNext_ = false;
+      started.post();
+      release.wait();
+    }
+    if (module == kBadModule) {
+      throw I2cError("no such module");
+    }
+    reads.emplace_back(module, offset, len);
+    for (int i = 0; i < len; ++i) {
+      buf[i] = offset + i;
+    }
+  }
+  void moduleWrite(unsigned int, uint8_t, int, int, const uint8_t*) override {}
+  void verifyBus(bool) override {}
+
+  folly::Baton<> started;
+  folly::Baton<> release;
+  // Only touched from the bus' thread until the reads are done
+  std::vector<std::tuple<unsigned int, int, int>> reads;
+
+ private:
+  bool blockNext_{true};
+};
+
+class AsyncI2CBusTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    auto fake = std::make_unique<FakeI2CBus>();
+    fake_ = fake.get();
+    bus_ = std::make_unique<AsyncI2CBus>(std::move(fake));
+  }
+
+  // Tie up the bus, so the requests made next queue up behind this one
+  folly::Future<std::unique_ptr<folly::IOBuf>> block() {
+    auto blocker = bus_->moduleReadAsync(
+        99, kAddr, 0, 1, AsyncI2CBus::Priority::BACKGROUND);
+    fake_->started.wait();
+    return blocker;
+  }
+
+  FakeI2CBus* fake_;
+  std::unique_ptr<AsyncI2CBus> bus_;
+};
+
+} // unnamed namespace
+
+TEST_F(AsyncI2CBusTest, MergesAdjacentReads) {
+  auto blocker = block();
+  auto p = AsyncI2CBus::Priority::BACKGROUND;
+  auto a = bus_->moduleReadAsync(0, kAddr, 10, 10, p);
+  auto b = bus_->moduleReadAsync(0, kAddr, 30, 10, p);
+  auto c = bus_->moduleReadAsync(0, kAddr, 20, 10, p);
+  // Same range of another module
+  auto d = bus_->moduleReadAsync(1, kAddr, 20, 10, p);
+  fake_->release.post();
+
+  std::move(blocker).get();
+  auto bData = std::move(b).get();
+  std::move(a).get();
+  std::move(c).get();
+  std::move(d).get();
+
+  using Read = std::tuple<unsigned int, int, int>;
+  std::vector<Read> expected{Read(99, 0, 1), Read(0, 10, 30), Read(1, 20, 10)};
+  EXPECT_EQ(expected, fake_->reads);
+  EXPECT_EQ(2u, bus_->getMergedReads());
+  // Each read only gets its own range back
+  ASSERT_EQ(10u, bData->length());
+  EXPECT_EQ(30, bData->data()[0]);
+  EXPECT_EQ(39, bData->data()[9]);
+}
+
+TEST_F(AsyncI2CBusTest, BackgroundGetsTurn) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_i2c_interactive_burst = 2;
+
+  auto blocker = block();
+  std::vector<folly::Future<std::unique_ptr<folly::IOBuf>>> reads;
+  auto background = AsyncI2CBus::Priority::BACKGROUND;
+  auto interactive = AsyncI2CBus::Priority::INTERACTIVE;
+  reads.push_back(bus_->moduleReadAsync(11, kAddr, 0, 1, background));
+  reads.push_back(bus_->moduleReadAsync(12, kAddr, 0, 1, background));
+  reads.push_back(bus_->moduleReadAsync(1, kAddr, 0, 1, interactive));
+  reads.push_back(bus_->moduleReadAsync(2, kAddr, 0, 1, interactive));
+  reads.push_back(bus_->moduleReadAsync(3, kAddr, 0, 1, interactive));
+  fake_->release.post();
+
+  std::move(blocker).get();
+  for (auto& read : reads) {
+    std::move(read).get();
+  }
+
+  std::vector<unsigned int> order;
+  for (const auto& read : fake_->reads) {
+    order.push_back(std::get<0>(read));
+  }
+  std::vector<unsigned int> expected{99, 1, 2, 11, 3, 12};
+  EXPECT_EQ(expected, order);
+}
+
+TEST_F(AsyncI2CBusTest, BlockingCallsRethrow) {
+  fake_->release.post();
+  uint8_t buf[4];
+  bus_->moduleRead(0, kAddr, 4, sizeof(buf), buf);
+  EXPECT_EQ(4, buf[0]);
+  EXPECT_EQ(7, buf[3]);
+  EXPECT_THROW(bus_->moduleRead(kBadModule, kAddr, 0, 1, buf), I2cError);
+}
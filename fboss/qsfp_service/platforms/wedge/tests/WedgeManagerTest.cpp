@@ -9,6 +9,7 @@
  */
 
 #include <folly/Memory.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/qsfp_service/if/gen-cpp2/transceiver_types.h"
 #include "fboss/qsfp_service/platforms/wedge/WedgeManager.h"
@@ -37,6 +38,47 @@ class MockWedgeManager : public WedgeManager {
   std::vector<MockQsfpModule*> mockTransceivers_;
 };
 
+// A bus which is always fine, none of the modules using it touch it
+class NoopI2CBus : public TransceiverI2CApi {
+ public:
+  void open() override {}
+  void close() override {}
+  void moduleRead(unsigned int, uint8_t, int, int, uint8_t*) override {}
+  void moduleWrite(unsigned int, uint8_t, int, int, const uint8_t*) override {}
+  void verifyBus(bool) override {}
+};
+
+class RefreshMockQsfpModule : public MockQsfpModule {
+ public:
+  explicit RefreshMockQsfpModule(unsigned int portsPerTransceiver)
+      : MockQsfpModule(nullptr, portsPerTransceiver) {}
+  MOCK_METHOD0(refresh, void());
+  MOCK_METHOD1(
+      transceiverPortsChanged,
+      void(const std::vector<std::pair<const int, PortStatus>>&));
+};
+
+// Modules spread over several controllers, refreshed in parallel
+class RefreshWedgeManager : public WedgeManager {
+ public:
+  RefreshWedgeManager() {
+    wedgeI2cBus_ = std::make_unique<NoopI2CBus>();
+    for (int idx = 0; idx < getNumQsfpModules(); idx++) {
+      auto qsfp = std::make_unique<NiceMock<RefreshMockQsfpModule>>(
+          numPortsPerTransceiver());
+      mockTransceivers_.push_back(qsfp.get());
+      transceivers_.push_back(move(qsfp));
+    }
+  }
+
+  std::vector<RefreshMockQsfpModule*> mockTransceivers_;
+
+ protected:
+  int getI2CControllerForModule(int module) const override {
+    return module % 4;
+  }
+};
+
 class WedgeManagerTest : public ::testing::Test {
  public:
   void SetUp() override {
@@ -65,4 +107,150 @@ TEST_F(WedgeManagerTest, getTransceiverInfo) {
       std::make_unique<std::vector<int32_t>>(data));
 }
 
+TEST(WedgeManagerRefreshTest, backOffFromFailingModules) {
+  RefreshWedgeManager manager;
+  auto failing = manager.mockTransceivers_[3];
+  for (auto trans : manager.mockTransceivers_) {
+    if (trans != failing) {
+      EXPECT_CALL(*trans, refresh()).Times(6);
+    }
+  }
+  // Refreshed in cycles 1, 3 and 6: skipped for one cycle after the first
+  // failure, and two after the second
+  EXPECT_CALL(*failing, refresh())
+      .Times(3)
+      .WillRepeatedly(Throw(std::runtime_error("no reply")));
+  for (int i = 0; i < 6; ++i) {
+    manager.refreshTransceivers();
+  }
+}
+
+TEST(WedgeManagerRefreshTest, onlyNotableChangesPublished) {
+  RefreshWedgeManager manager;
+  size_t numModules = manager.getNumQsfpModules();
+
+  // Everything is new to begin with
+  manager.refreshTransceivers();
+  TransceiverChanges changes;
+  manager.getTransceiverChanges(changes, 0);
+  EXPECT_EQ(changes.changed.size(), numModules);
+  auto generation = changes.generation;
+
+  // Nothing changed
+  manager.refreshTransceivers();
+  changes = TransceiverChanges();
+  manager.getTransceiverChanges(changes, generation);
+  EXPECT_EQ(changes.changed.size(), 0u);
+  EXPECT_EQ(changes.generation, generation);
+
+  // A module showing up is reported, as is one starting to report sensors
+  TransceiverInfo present;
+  present.present = true;
+  ON_CALL(*manager.mockTransceivers_[2], getTransceiverInfo())
+      .WillByDefault(Return(present));
+  TransceiverInfo warmer;
+  warmer.__isset.sensor = true;
+  warmer.sensor.temp.value = 50;
+  ON_CALL(*manager.mockTransceivers_[5], getTransceiverInfo())
+      .WillByDefault(Return(warmer));
+  manager.refreshTransceivers();
+  changes = TransceiverChanges();
+  manager.getTransceiverChanges(changes, generation);
+  EXPECT_EQ(changes.changed.size(), 2u);
+  EXPECT_TRUE(changes.changed.at(2).present);
+  EXPECT_EQ(changes.changed.count(5), 1u);
+  generation = changes.generation;
+
+  // but a new temperature reading isn't
+  warmer.sensor.temp.value = 60;
+  ON_CALL(*manager.mockTransceivers_[5], getTransceiverInfo())
+      .WillByDefault(Return(warmer));
+  manager.refreshTransceivers();
+  changes = TransceiverChanges();
+  manager.getTransceiverChanges(changes, generation);
+  EXPECT_EQ(changes.changed.size(), 0u);
+
+  // Clients which last saw a later generation have missed a restart
+  changes = TransceiverChanges();
+  manager.getTransceiverChanges(changes, generation + 100);
+  EXPECT_EQ(changes.changed.size(), numModules);
+}
+
+TEST(WedgeManagerRefreshTest, infoSnapshotsServedUntilChanged) {
+  RefreshWedgeManager manager;
+  size_t numModules = manager.getNumQsfpModules();
+  auto getSnapshot = [&manager](std::vector<int32_t> ids, int64_t since) {
+    TransceiverInfoSnapshot snapshot;
+    manager.getTransceiverInfoSnapshot(
+        snapshot, std::make_unique<std::vector<int32_t>>(ids), since);
+    return snapshot;
+  };
+  auto deserialize = [](const TransceiverInfoSnapshot& snapshot) {
+    return apache::thrift::CompactSerializer::deserialize<TransceiverInfoMap>(
+        snapshot.infos.get());
+  };
+
+  manager.refreshTransceivers();
+  auto all = getSnapshot({}, 0);
+  ASSERT_TRUE(all.__isset.infos);
+  EXPECT_EQ(deserialize(all).infos.size(), numModules);
+  auto version = all.version;
+
+  // The same IDs, in any order, share the buffer serialized the first time
+  auto some = getSnapshot({7, 3, 3}, 0);
+  auto sameSome = getSnapshot({3, 7}, 0);
+  ASSERT_TRUE(some.__isset.infos);
+  EXPECT_EQ(some.infos->data(), sameSome.infos->data());
+  auto infos = deserialize(some).infos;
+  EXPECT_EQ(infos.size(), 2u);
+  EXPECT_EQ(infos.count(3), 1u);
+
+  // Refreshing to the same info keeps the version, and its buffers
+  manager.refreshTransceivers();
+  auto unchanged = getSnapshot({}, version);
+  EXPECT_EQ(unchanged.version, version);
+  EXPECT_FALSE(unchanged.__isset.infos);
+  EXPECT_EQ(getSnapshot({}, 0).infos->data(), all.infos->data());
+
+  // Any change at all makes a new version, even a new sensor reading
+  TransceiverInfo warmer;
+  warmer.__isset.sensor = true;
+  warmer.sensor.temp.value = 50;
+  ON_CALL(*manager.mockTransceivers_[5], getTransceiverInfo())
+      .WillByDefault(Return(warmer));
+  manager.refreshTransceivers();
+  auto changed = getSnapshot({5}, version);
+  EXPECT_GT(changed.version, version);
+  ASSERT_TRUE(changed.__isset.infos);
+  EXPECT_EQ(deserialize(changed).infos.at(5).sensor.temp.value, 50);
+}
+
+TEST(WedgeManagerRefreshTest, syncPortsReportsFailures) {
+  RefreshWedgeManager manager;
+  auto failing = manager.mockTransceivers_[6];
+  EXPECT_CALL(*failing, transceiverPortsChanged(_))
+      .WillOnce(Throw(std::runtime_error("no reply")));
+
+  // One port on each of the first eight modules, spread over all of the
+  // controllers
+  auto ports = std::make_unique<std::map<int32_t, PortStatus>>();
+  for (int i = 0; i < 8; ++i) {
+    PortStatus status;
+    status.__isset.transceiverIdx = true;
+    status.transceiverIdx.transceiverId = i;
+    (*ports)[i * 4 + 1] = status;
+  }
+  for (int i = 0; i < 8; ++i) {
+    if (manager.mockTransceivers_[i] != failing) {
+      EXPECT_CALL(*manager.mockTransceivers_[i], transceiverPortsChanged(_))
+          .Times(1);
+    }
+  }
+
+  std::map<int32_t, TransceiverInfo> info;
+  manager.syncPorts(info, std::move(ports));
+  EXPECT_EQ(info.size(), 7u);
+  EXPECT_EQ(info.count(6), 0u);
+}
+
 }
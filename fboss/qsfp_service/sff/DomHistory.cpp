@@ -0,0 +1,176 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/qsfp_service/sff/DomHistory.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/Optional.h>
+#include <gflags/gflags.h>
+
+DEFINE_int32(
+    qsfp_dom_history_seconds,
+    3600,
+    "how long to keep the DOM sensor history of each transceiver for");
+DEFINE_int32(
+    qsfp_dom_history_bucket_seconds,
+    60,
+    "granularity of the DOM sensor history of each transceiver");
+DEFINE_double(
+    qsfp_power_degradation_db,
+    2.0,
+    "drop in rx or tx power, in dB, between the two halves of a history "
+    "window at which a channel is flagged as degrading");
+DEFINE_double(
+    qsfp_tx_bias_degradation_pct,
+    20.0,
+    "rise in tx bias, in percent, between the two halves of a history "
+    "window at which a channel is flagged as degrading");
+DEFINE_double(
+    qsfp_temp_degradation_c,
+    10.0,
+    "rise in temperature, in degrees C, between the two halves of a history "
+    "window at which a transceiver is flagged as degrading");
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+using Series = DomHistory::Series;
+using Time = DomHistory::Time;
+
+bool powerDropping(double earlier, double later) {
+  // Powers are in mW, but losses add up in dB
+  if (earlier <= 0) {
+    return false;
+  }
+  if (later <= 0) {
+    return true;
+  }
+  return 10 * std::log10(earlier / later) > FLAGS_qsfp_power_degradation_db;
+}
+
+bool biasRising(double earlier, double later) {
+  // The bias current goes up as a laser ages to keep its output constant
+  return earlier > 0 &&
+      (later - earlier) * 100 / earlier > FLAGS_qsfp_tx_bias_degradation_pct;
+}
+
+bool tempRising(double earlier, double later) {
+  return later - earlier > FLAGS_qsfp_temp_degradation_c;
+}
+
+/*
+ * Summarize the readings in series between start and end, with the trend
+ * being that from the half of the window before middle to the half after.
+ * Returns none if there are no readings in the window.
+ */
+folly::Optional<SensorHistory> summarize(
+    Series& series,
+    Time start,
+    Time middle,
+    Time end,
+    bool (*degrading)(double earlier, double later)) {
+  SensorHistory history;
+  try {
+    history.min = series.getMin(start, end);
+    history.max = series.getMax(start, end);
+    history.average = series.getAverage(start, end);
+  } catch (const std::runtime_error&) {
+    return folly::none;
+  }
+
+  try {
+    auto earlier = series.getAverage(start, middle);
+    auto later = series.getAverage(middle, end);
+    history.trend = later - earlier;
+    history.degrading = degrading(earlier, later);
+  } catch (const std::runtime_error&) {
+    // Readings from only one half of the window, so no trend to speak of
+  }
+  return history;
+}
+
+} // unnamed namespace
+
+DomHistory::DomHistory(unsigned int numChannels)
+    : DomHistory(
+          numChannels,
+          Duration(FLAGS_qsfp_dom_history_seconds),
+          Duration(FLAGS_qsfp_dom_history_bucket_seconds)) {}
+
+DomHistory::DomHistory(
+    unsigned int numChannels,
+    Duration interval,
+    Duration bucketInterval)
+    : interval_(interval),
+      bucketInterval_(bucketInterval),
+      temp_(interval, bucketInterval) {
+  for (unsigned int i = 0; i < numChannels; ++i) {
+    channels_.push_back(
+        std::make_unique<ChannelSeries>(interval, bucketInterval));
+  }
+}
+
+void DomHistory::record(const TransceiverInfo& info, Time t) {
+  if (info.__isset.sensor) {
+    temp_.addValue(info.sensor.temp.value, t);
+  }
+  if (!info.__isset.channels) {
+    return;
+  }
+  for (const auto& channel : info.channels) {
+    if (channel.channel < 0 ||
+        static_cast<size_t>(channel.channel) >= channels_.size()) {
+      continue;
+    }
+    auto& series = channels_[channel.channel];
+    series->rxPwr.addValue(channel.sensors.rxPwr.value, t);
+    series->txBias.addValue(channel.sensors.txBias.value, t);
+    series->txPwr.addValue(channel.sensors.txPwr.value, t);
+  }
+}
+
+TransceiverHistory DomHistory::get(Duration window, Time now) {
+  window = std::min(window, interval_);
+  TransceiverHistory history;
+  history.windowSeconds = window.count();
+
+  // Buckets are matched by when they start, so run the window on to the
+  // end of the current bucket to take in the latest readings.
+  auto start = now - window;
+  auto middle = start + window / 2;
+  auto end = now + bucketInterval_;
+
+  auto temp = summarize(temp_, start, middle, end, tempRising);
+  if (temp) {
+    history.temp = *temp;
+    history.__isset.temp = true;
+  }
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    auto& series = channels_[i];
+    auto rxPwr = summarize(series->rxPwr, start, middle, end, powerDropping);
+    auto txBias = summarize(series->txBias, start, middle, end, biasRising);
+    auto txPwr = summarize(series->txPwr, start, middle, end, powerDropping);
+    if (!rxPwr || !txBias || !txPwr) {
+      // All three are recorded together, so this channel has no readings
+      continue;
+    }
+    ChannelHistory channel;
+    channel.channel = i;
+    channel.rxPwr = *rxPwr;
+    channel.txBias = *txBias;
+    channel.txPwr = *txPwr;
+    history.channels.push_back(std::move(channel));
+  }
+  return history;
+}
+
+}} // namespace facebook::fboss
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "fboss/lib/TimeSeriesWithMinMax.h"
+#include "fboss/qsfp_service/if/gen-cpp2/transceiver_types.h"
+
+namespace facebook { namespace fboss {
+
+/*
+ * Rolling history of the DOM sensor readings of a transceiver: its
+ * temperature, and the rx power, tx bias and tx power of each channel.
+ *
+ * Readings are only kept as the min, max and average of each bucket of
+ * qsfp_dom_history_bucket_seconds, for the last qsfp_dom_history_seconds,
+ * so the footprint doesn't depend on how often the transceiver is read.
+ */
+class DomHistory {
+ public:
+  using Series = TimeSeriesWithMinMax<double>;
+  using Time = Series::Time;
+  using Duration = Series::Duration;
+
+  explicit DomHistory(unsigned int numChannels);
+  DomHistory(
+      unsigned int numChannels,
+      Duration interval,
+      Duration bucketInterval);
+
+  /*
+   * Record the sensor readings in info, as taken at time t.
+   */
+  void record(
+      const TransceiverInfo& info,
+      Time t = std::chrono::system_clock::now());
+
+  /*
+   * Summarize the readings taken over the window leading up to now. The
+   * window is capped at the length of the history, and the port left for
+   * the caller to fill in.
+   */
+  TransceiverHistory get(
+      Duration window,
+      Time now = std::chrono::system_clock::now());
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  DomHistory(DomHistory const &) = delete;
+  DomHistory& operator=(DomHistory const &) = delete;
+
+  struct ChannelSeries {
+    ChannelSeries(Duration interval, Duration bucketInterval)
+        : rxPwr(interval, bucketInterval),
+          txBias(interval, bucketInterval),
+          txPwr(interval, bucketInterval) {}
+
+    Series rxPwr;
+    Series txBias;
+    Series txPwr;
+  };
+
+  Duration interval_;
+  Duration bucketInterval_;
+  Series temp_;
+  std::vector<std::unique_ptr<ChannelSeries>> channels_;
+};
+
+}} // namespace facebook::fboss
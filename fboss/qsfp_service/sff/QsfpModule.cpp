@@ -23,8 +23,9 @@
 
 DEFINE_int32(
     qsfp_data_refresh_interval,
-    10,
-    "how often to refetch qsfp data that changes frequently");
+    60,
+    "how often to refetch qsfp data that changes frequently when the "
+    "module's interrupt flags have not signalled a change");
 DEFINE_int32(
     customize_interval,
     30,
@@ -42,7 +43,7 @@ using folly::IOBuf;
 namespace facebook { namespace fboss {
 
 // As per SFF-8636
-static SffFieldInfo::SffFieldMap qsfpFields = {
+constexpr SffFieldEntry kQsfpFieldEntries[] = {
   // Base page values, including alarms and sensors
   {SffField::IDENTIFIER, {QsfpPages::LOWER, 0, 1} },
   {SffField::STATUS, {QsfpPages::LOWER, 1, 2} },
@@ -95,6 +96,8 @@ static SffFieldInfo::SffFieldMap qsfpFields = {
   {SffField::TX_BIAS_THRESH, {QsfpPages::PAGE3, 184, 8} },
 };
 
+constexpr SffFieldTable qsfpFields = makeSffFieldTable(kQsfpFieldEntries);
+
 static SffFieldMultiplier qsfpMultiplier = {
   {SffField::LENGTH_SM_KM, 1000},
   {SffField::LENGTH_OM3, 2},
@@ -542,6 +545,7 @@ QsfpModule::QsfpModule(
     std::unique_ptr<TransceiverImpl> qsfpImpl,
     unsigned int portsPerTransceiver)
     : qsfpImpl_(std::move(qsfpImpl)),
+      history_(std::make_unique<DomHistory>(CHANNEL_COUNT)),
       portsPerTransceiver_(portsPerTransceiver) {
   CHECK_GT(portsPerTransceiver_, 0);
 }
@@ -630,6 +634,8 @@ bool QsfpModule::detectPresenceLocked() {
                << " QSFP status changed to " << currentQsfpStatus;
     dirty_ = true;
     present_ = currentQsfpStatus;
+    // Whatever is plugged in now has a history of its own
+    history_ = std::make_unique<DomHistory>(CHANNEL_COUNT);
   }
   return currentQsfpStatus;
 }
@@ -677,17 +683,29 @@ TransceiverInfo QsfpModule::parseDataLocked() {
 }
 
 RawDOMData QsfpModule::getRawDOMData() {
+  // Copying the snapshot only shares its buffers, it doesn't copy them
+  auto snapshot = rawData_.copy();
+  return snapshot ? *snapshot : RawDOMData();
+}
+
+TransceiverHistory QsfpModule::getTransceiverHistory(int32_t windowSeconds) {
   lock_guard<std::mutex> g(qsfpModuleMutex_);
-  RawDOMData data;
+  auto history = history_->get(std::chrono::seconds(windowSeconds));
+  history.port = qsfpImpl_->getNum();
+  return history;
+}
+
+void QsfpModule::publishRawDataLocked() {
+  auto data = std::make_shared<RawDOMData>();
   if (present_) {
-    data.lower = IOBuf::wrapBufferAsValue(lowerPage_, MAX_QSFP_PAGE_SIZE);
-    data.page0 = IOBuf::wrapBufferAsValue(page0_, MAX_QSFP_PAGE_SIZE);
+    data->lower = IOBuf(IOBuf::COPY_BUFFER, lowerPage_, MAX_QSFP_PAGE_SIZE);
+    data->page0 = IOBuf(IOBuf::COPY_BUFFER, page0_, MAX_QSFP_PAGE_SIZE);
     if (!flatMem_) {
-      data.__isset.page3 = true;
-      data.page3 = IOBuf::wrapBufferAsValue(page3_, MAX_QSFP_PAGE_SIZE);
+      data->__isset.page3 = true;
+      data->page3 = IOBuf(IOBuf::COPY_BUFFER, page3_, MAX_QSFP_PAGE_SIZE);
     }
   }
-  return data;
+  *rawData_.wlock() = std::move(data);
 }
 
 bool QsfpModule::safeToCustomize() const {
@@ -737,6 +755,28 @@ bool QsfpModule::shouldRefresh(time_t cooldown) const {
   return std::time(nullptr) - lastRefreshTime_ >= cooldown;
 }
 
+bool QsfpModule::flagsChangedLocked() {
+  if (!present_) {
+    return false;
+  }
+  uint8_t flags[LATCHED_FLAGS_LENGTH] = {};
+  try {
+    qsfpImpl_->readTransceiver(TransceiverI2CApi::ADDR_QSFP,
+        LATCHED_FLAGS_OFFSET, sizeof(flags), flags);
+  } catch (const std::exception& ex) {
+    // Let the full refresh deal with (and report) a misbehaving module
+    XLOG(DBG2) << "Error polling flags for transceiver:"
+               << qsfpImpl_->getName() << ": " << ex.what();
+    return true;
+  }
+  bool changed = false;
+  for (unsigned int i = 0; i < LATCHED_FLAGS_LENGTH; ++i) {
+    latchedFlags_[i] |= flags[i];
+    changed = changed || flags[i];
+  }
+  return changed;
+}
+
 cfg::PortSpeed QsfpModule::getPortSpeed() const {
   cfg::PortSpeed speed = cfg::PortSpeed::DEFAULT;
   for (const auto& port : ports_) {
@@ -789,7 +829,9 @@ void QsfpModule::refreshLocked() {
   detectPresenceLocked();
 
   auto customizeWanted = customizationWanted(FLAGS_customize_interval);
-  auto willRefresh = !dirty_ && shouldRefresh(FLAGS_qsfp_data_refresh_interval);
+  // Only poll the flags if we aren't about to read the lower page anyway
+  auto willRefresh = !dirty_ && !customizeWanted &&
+    (shouldRefresh(FLAGS_qsfp_data_refresh_interval) || flagsChangedLocked());
   if (!dirty_ && !customizeWanted && !willRefresh) {
     return;
   }
@@ -814,7 +856,10 @@ void QsfpModule::refreshLocked() {
   }
 
   // assign
-  info_.wlock()->assign(parseDataLocked());
+  auto info = parseDataLocked();
+  history_->record(info);
+  info_.wlock()->assign(std::move(info));
+  publishRawDataLocked();
 }
 
 void QsfpModule::getFieldValue(SffField fieldName,
@@ -838,6 +883,11 @@ void QsfpModule::updateQsfpData(bool allPages) {
                << folly::to<std::string>(qsfpImpl_->getName());
     qsfpImpl_->readTransceiver(TransceiverI2CApi::ADDR_QSFP, 0,
         sizeof(lowerPage_), lowerPage_);
+    // Don't lose any flags the last poll cleared from under us
+    for (unsigned int i = 0; i < LATCHED_FLAGS_LENGTH; ++i) {
+      lowerPage_[LATCHED_FLAGS_OFFSET + i] |= latchedFlags_[i];
+      latchedFlags_[i] = 0;
+    }
     lastRefreshTime_ = std::time(nullptr);
     dirty_ = false;
     setQsfpIdprom();
@@ -851,21 +901,24 @@ void QsfpModule::updateQsfpData(bool allPages) {
       return;
     }
 
-    // If we have flat memory, we don't have to set the page
+    // Queue up the page selects and reads so the bus and module selection
+    // are only set up once for all of the upper pages. If we have flat
+    // memory, we don't have to set the page and there is no page 3.
+    uint8_t pages[] = {0, 3};
+    std::vector<TransceiverI2CApi::ModuleOp> ops;
     if (!flatMem_) {
-      uint8_t page = 0;
-      qsfpImpl_->writeTransceiver(TransceiverI2CApi::ADDR_QSFP, 127,
-          sizeof(page), &page);
+      ops.push_back({true, TransceiverI2CApi::ADDR_QSFP, 127,
+                     sizeof(pages[0]), &pages[0]});
     }
-    qsfpImpl_->readTransceiver(TransceiverI2CApi::ADDR_QSFP, 128,
-        sizeof(page0_), page0_);
+    ops.push_back({false, TransceiverI2CApi::ADDR_QSFP, 128,
+                   sizeof(page0_), page0_});
     if (!flatMem_) {
-      uint8_t page = 3;
-      qsfpImpl_->writeTransceiver(TransceiverI2CApi::ADDR_QSFP, 127,
-          sizeof(page), &page);
-      qsfpImpl_->readTransceiver(TransceiverI2CApi::ADDR_QSFP, 128,
-          sizeof(page3_), page3_);
+      ops.push_back({true, TransceiverI2CApi::ADDR_QSFP, 127,
+                     sizeof(pages[1]), &pages[1]});
+      ops.push_back({false, TransceiverI2CApi::ADDR_QSFP, 128,
+                     sizeof(page3_), page3_});
     }
+    qsfpImpl_->batchTransceiver(ops);
   } catch (const std::exception& ex) {
     // No matter what kind of exception throws, we need to set the dirty_ flag
     // to true.
@@ -9,7 +9,9 @@
  */
 #pragma once
 #include <cstdint>
+#include <memory>
 #include <mutex>
+#include "fboss/qsfp_service/sff/DomHistory.h"
 #include "fboss/qsfp_service/sff/Transceiver.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/qsfp_service/if/gen-cpp2/transceiver_types.h"
@@ -109,6 +111,8 @@ class QsfpModule : public Transceiver {
 
   RawDOMData getRawDOMData() override;
 
+  TransceiverHistory getTransceiverHistory(int32_t windowSeconds) override;
+
   void transceiverPortsChanged(
     const std::vector<std::pair<const int, PortStatus>>& ports) override;
 
@@ -136,6 +140,10 @@ class QsfpModule : public Transceiver {
     MAX_GAUGE = 30,
     DECIMAL_BASE = 10,
     HEX_BASE = 16,
+    // Bytes 3-21 of the lower page latch the interrupt flags, see
+    // SFF-8636 section 6.2.3. Reading them clears them.
+    LATCHED_FLAGS_OFFSET = 3,
+    LATCHED_FLAGS_LENGTH = 19,
   };
   // QSFP+ requires a bottom 128 byte page describing important monitoring
   // information, and then an upper 128 byte page with less frequently
@@ -145,6 +153,8 @@ class QsfpModule : public Transceiver {
   uint8_t lowerPage_[MAX_QSFP_PAGE_SIZE];
   uint8_t page0_[MAX_QSFP_PAGE_SIZE];
   uint8_t page3_[MAX_QSFP_PAGE_SIZE];
+  // Flags latched by the last flags poll, not yet merged into lowerPage_
+  uint8_t latchedFlags_[LATCHED_FLAGS_LENGTH] = {};
 
   /* Qsfp Internal Implementation */
   std::unique_ptr<TransceiverImpl> qsfpImpl_;
@@ -158,6 +168,14 @@ class QsfpModule : public Transceiver {
   bool needsCustomization_{false};
 
   folly::Synchronized<folly::Optional<TransceiverInfo>> info_;
+  /*
+   * Immutable copy of the pages as of the last refresh, so readers of the
+   * raw data neither take qsfpModuleMutex_ nor see a half updated page.
+   */
+  folly::Synchronized<std::shared_ptr<const RawDOMData>> rawData_;
+  // Sensor readings of the module currently plugged in, guarded by
+  // qsfpModuleMutex_
+  std::unique_ptr<DomHistory> history_;
   /*
    * qsfpModuleMutex_ is held around all the read and writes to the qsfpModule
    *
@@ -364,6 +382,19 @@ class QsfpModule : public Transceiver {
    */
   bool shouldRefresh(time_t cooldown) const;
 
+  /*
+   * Cheaply poll the latched interrupt flags of the lower page and
+   * return whether any are set, i.e. whether the module has seen a
+   * change worth doing a full refresh of the DOM data for. Since the
+   * flags clear on read they are held until the next updateQsfpData().
+   */
+  bool flagsChangedLocked();
+
+  /*
+   * Copy the current pages into a new rawData_ snapshot.
+   */
+  void publishRawDataLocked();
+
   /*
    * Determine set speed of enabled member ports.
    */
@@ -62,5 +62,14 @@ SffFieldInfo SffFieldInfo::getSffFieldAddress(const SffFieldMap& map,
   return info->second;
 }
 
+SffFieldInfo SffFieldInfo::getSffFieldAddress(const SffFieldTable& table,
+                                              const SffField field) {
+  auto index = static_cast<std::size_t>(field);
+  if (index >= kNumSffFields || !table.present[index]) {
+    throw FbossError("Invalid SFF Field ID");
+  }
+  return table.fields[index];
+}
+
 
 }} //namespace facebook::fboss
@@ -5,6 +5,7 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <map>
 
@@ -99,6 +100,10 @@ enum class SffField {
   VENDOR_CONTROL, // Vendor Specific Control
 };
 
+// Keep in sync with the last entry of SffField
+constexpr std::size_t kNumSffFields =
+    static_cast<std::size_t>(SffField::VENDOR_CONTROL) + 1;
+
 enum DeviceTechnology : uint8_t {
   TRANSMITTER_TECH_SHIFT = 4,
   OPTICAL_MAX_VALUE = 0b1001,
@@ -157,6 +162,8 @@ enum CdrControl : uint8_t {
   CDR_CONTROL_TX_MASK = 0xf0,
 };
 
+struct SffFieldTable;
+
 class SffFieldInfo {
  public:
   int dataAddress;
@@ -189,8 +196,37 @@ class SffFieldInfo {
    */
   static SffFieldInfo getSffFieldAddress(const SffFieldMap& map,
                                          SffField field);
+
+  static SffFieldInfo getSffFieldAddress(const SffFieldTable& table,
+                                         SffField field);
+};
+
+struct SffFieldEntry {
+  SffField field;
+  SffFieldInfo info;
 };
 
+/*
+ * The same layout as an SffFieldMap, flattened into an array indexed by
+ * field so that decoding a field on the refresh path is a plain load.
+ * Build these with makeSffFieldTable() so they are laid out at compile time.
+ */
+struct SffFieldTable {
+  SffFieldInfo fields[kNumSffFields];
+  bool present[kNumSffFields];
+};
+
+template <std::size_t N>
+constexpr SffFieldTable makeSffFieldTable(const SffFieldEntry (&entries)[N]) {
+  SffFieldTable table{};
+  for (std::size_t i = 0; i < N; ++i) {
+    auto index = static_cast<std::size_t>(entries[i].field);
+    table.fields[index] = entries[i].info;
+    table.present[index] = true;
+  }
+  return table;
+}
+
 // Store multipliers for various conversion functions:
 
 typedef std::map<SffField, std::uint32_t> SffFieldMultiplier;
@@ -54,6 +54,11 @@ class Transceiver {
    */
   virtual RawDOMData getRawDOMData() = 0;
 
+  /*
+   * Summarize the DOM sensor readings over the last windowSeconds
+   */
+  virtual TransceiverHistory getTransceiverHistory(int32_t windowSeconds) = 0;
+
   /*
    * Set speed specific settings for the transceiver
    */
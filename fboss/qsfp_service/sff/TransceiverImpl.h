@@ -14,6 +14,7 @@
 #include <folly/String.h>
 #include "fboss/agent/types.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/lib/usb/TransceiverI2CApi.h"
 #include "fboss/qsfp_service/if/gen-cpp2/transceiver_types.h"
 
 
@@ -35,6 +36,21 @@ class TransceiverImpl {
   virtual int writeTransceiver(int dataAddress, int offset,
                               int len, uint8_t* fieldValue) = 0;
 
+  /*
+   * Perform a series of reads and writes in order. Implementations
+   * that can hold on to the bus between them should override this.
+   */
+  virtual void batchTransceiver(
+      const std::vector<TransceiverI2CApi::ModuleOp>& ops) {
+    for (const auto& op : ops) {
+      if (op.write) {
+        writeTransceiver(op.i2cAddress, op.offset, op.len, op.buf);
+      } else {
+        readTransceiver(op.i2cAddress, op.offset, op.len, op.buf);
+      }
+    }
+  }
+
   /*
    * This function will check if the transceiver is present or not
    */
@@ -15,6 +15,7 @@
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
+#include "fboss/qsfp_service/sff/DomHistory.h"
 #include "fboss/qsfp_service/sff/TransceiverImpl.h"
 #include "fboss/qsfp_service/sff/QsfpModule.h"
 #include "fboss/qsfp_service/sff/SffFieldInfo.h"
@@ -380,6 +381,64 @@ TEST_F(QsfpModuleTest, refreshDirtyNoPorts) {
   qsfp_->refresh();
 }
 
+TEST_F(QsfpModuleTest, refreshOnlyPollsFlagsWhenUnchanged) {
+  gflags::FlagSaver saver;
+  // refresh, which should set module dirty_ = false
+  qsfp_->refresh();
+
+  // Never let the periodic refresh kick in on its own
+  gflags::SetCommandLineOptionWithMode(
+    "qsfp_data_refresh_interval", "2147483647", gflags::SET_FLAGS_DEFAULT);
+
+  // No flags latched: we should only read the flags, nothing else
+  EXPECT_CALL(*transImpl_, readTransceiver(_, _, _, _)).Times(1);
+  EXPECT_CALL(*qsfp_, updateQsfpData(_)).Times(0);
+  qsfp_->refresh();
+
+  // A latched temperature alarm means we refetch the lower page
+  EXPECT_CALL(*transImpl_, readTransceiver(_, _, _, _))
+    .WillOnce(DoAll(
+      Invoke([](int, int, int length, uint8_t* buf) {
+        std::fill(buf, buf + length, 0);
+        buf[6 - 3] = 0x80;
+      }),
+      Return(0)));
+  EXPECT_CALL(*qsfp_, updateQsfpData(false)).Times(1);
+  qsfp_->refresh();
+}
+
+TEST_F(QsfpModuleTest, rawDOMDataSnapshot) {
+  gflags::FlagSaver saver;
+  // Nothing to return before the first refresh
+  EXPECT_EQ(qsfp_->getRawDOMData().lower.length(), 0u);
+
+  uint8_t fill = 0x10;
+  ON_CALL(*transImpl_, readTransceiver(_, _, _, _))
+    .WillByDefault(Invoke([&fill](int, int, int length, uint8_t* buf) {
+      std::fill(buf, buf + length, fill);
+      return length;
+    }));
+  ON_CALL(*qsfp_, updateQsfpData(_))
+    .WillByDefault(Invoke(qsfp_.get(), &MockQsfpModule::actualUpdateQsfpData));
+
+  // refresh all pages
+  qsfp_->refresh();
+  auto before = qsfp_->getRawDOMData();
+  ASSERT_EQ(before.lower.length(), QsfpModule::MAX_QSFP_PAGE_SIZE);
+  EXPECT_EQ(before.lower.data()[0], 0x10);
+  EXPECT_EQ(before.page0.data()[0], 0x10);
+
+  // then just the lower page, which shouldn't touch what we returned before
+  gflags::SetCommandLineOptionWithMode(
+    "qsfp_data_refresh_interval", "0", gflags::SET_FLAGS_DEFAULT);
+  fill = 0x20;
+  qsfp_->refresh();
+  EXPECT_EQ(before.lower.data()[0], 0x10);
+  auto after = qsfp_->getRawDOMData();
+  EXPECT_EQ(after.lower.data()[0], 0x20);
+  EXPECT_EQ(after.page0.data()[0], 0x10);
+}
+
 TEST_F(QsfpModuleTest, updateQsfpDataPartial) {
   // Ensure that partial updates don't ever call writeTranscevier,
   // which needs to gain control of the bus and slows the call
@@ -437,4 +496,57 @@ TEST_F(QsfpModuleTest, skipCustomizingCopperPorts) {
   qsfp_->refresh();
 }
 
+TEST(DomHistoryTest, summarizesWindow) {
+  using std::chrono::seconds;
+  DomHistory history(2, seconds(100), seconds(10));
+  auto reading = [](double temp, double rxPwr, double txBias) {
+    TransceiverInfo info;
+    info.__isset.sensor = true;
+    info.sensor.temp.value = temp;
+    info.__isset.channels = true;
+    Channel chan;
+    chan.channel = 0;
+    chan.sensors.rxPwr.value = rxPwr;
+    chan.sensors.txBias.value = txBias;
+    chan.sensors.txPwr.value = 1.0;
+    info.channels.push_back(chan);
+    return info;
+  };
+
+  // A laser fading while its bias climbs to make up for it
+  auto now = std::chrono::system_clock::now();
+  history.record(reading(30, 1.0, 6.0), now - seconds(80));
+  history.record(reading(32, 0.9, 6.4), now - seconds(60));
+  history.record(reading(34, 0.5, 7.0), now - seconds(30));
+  history.record(reading(36, 0.4, 8.5), now - seconds(10));
+
+  auto all = history.get(seconds(1000), now);
+  EXPECT_EQ(all.windowSeconds, 100);
+  ASSERT_TRUE(all.__isset.temp);
+  EXPECT_DOUBLE_EQ(all.temp.min, 30);
+  EXPECT_DOUBLE_EQ(all.temp.max, 36);
+  EXPECT_DOUBLE_EQ(all.temp.average, 33);
+  EXPECT_DOUBLE_EQ(all.temp.trend, 4);
+  EXPECT_FALSE(all.temp.degrading);
+  // Nothing was read from the second channel
+  ASSERT_EQ(all.channels.size(), 1u);
+  const auto& chan = all.channels[0];
+  EXPECT_EQ(chan.channel, 0);
+  EXPECT_DOUBLE_EQ(chan.rxPwr.min, 0.4);
+  EXPECT_DOUBLE_EQ(chan.rxPwr.max, 1.0);
+  EXPECT_TRUE(chan.rxPwr.degrading);
+  EXPECT_TRUE(chan.txBias.degrading);
+  EXPECT_DOUBLE_EQ(chan.txPwr.trend, 0);
+  EXPECT_FALSE(chan.txPwr.degrading);
+
+  // Only the latest reading, so there's no trend to flag
+  auto latest = history.get(seconds(20), now);
+  EXPECT_EQ(latest.windowSeconds, 20);
+  ASSERT_EQ(latest.channels.size(), 1u);
+  EXPECT_DOUBLE_EQ(latest.channels[0].rxPwr.min, 0.4);
+  EXPECT_DOUBLE_EQ(latest.channels[0].rxPwr.max, 0.4);
+  EXPECT_DOUBLE_EQ(latest.channels[0].rxPwr.average, 0.4);
+  EXPECT_FALSE(latest.channels[0].rxPwr.degrading);
+}
+
 }} // namespace facebook::fboss
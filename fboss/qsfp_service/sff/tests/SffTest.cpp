@@ -13,8 +13,10 @@
 #include <folly/Memory.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include "fboss/agent/FbossError.h"
 #include "fboss/qsfp_service/sff/TransceiverImpl.h"
 #include "fboss/qsfp_service/sff/QsfpModule.h"
+#include "fboss/qsfp_service/sff/SffFieldInfo.h"
 
 #include <gtest/gtest.h>
 
@@ -232,4 +234,20 @@ TEST(BadSffTest, simpleRead) {
   EXPECT_THROW(qsfp->refresh(), QsfpModuleError);
 }
 
+TEST(SffFieldInfoTest, tableLookup) {
+  constexpr SffFieldEntry entries[] = {
+    {SffField::IDENTIFIER, {QsfpPages::LOWER, 0, 1}},
+    {SffField::VENDOR_NAME, {QsfpPages::PAGE0, 148, 16}},
+  };
+  constexpr SffFieldTable table = makeSffFieldTable(entries);
+
+  auto info = SffFieldInfo::getSffFieldAddress(table, SffField::VENDOR_NAME);
+  EXPECT_EQ(QsfpPages::PAGE0, info.dataAddress);
+  EXPECT_EQ(148u, info.offset);
+  EXPECT_EQ(16u, info.length);
+  EXPECT_THROW(
+      SffFieldInfo::getSffFieldAddress(table, SffField::LENGTH_SM),
+      FbossError);
+}
+
 } // namespace facebook::fboss
@@ -0,0 +1,239 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+//
+// This is a standalone utility that simulates how flows are spread over the
+// ECMP members of a chain of switches, each hashing with its own RTAG7
+// configuration, to help pick seeds and hash fields that avoid polarization.
+//
+// Polarization happens when a switch hashes the flows it receives the same
+// way as the switch that sent them: all of those flows then land on the same
+// few members, leaving the others idle.
+//
+// The hash is modeled as CRC16-CCITT over the seed followed by the selected
+// fields, and the member is picked as the hash modulo the number of members.
+// This follows the shape of the RTAG7 computation but is not bit exact, so
+// use it to compare configurations rather than to predict where a given flow
+// goes.
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using folly::StringPiece;
+using std::string;
+using std::vector;
+
+DEFINE_string(fields, "src_ip,dst_ip,src_port,dst_port",
+              "Comma separated fields hashed by every tier, out of src_ip, "
+              "dst_ip, src_port, dst_port and flow_label");
+DEFINE_string(tiers, "64:0,64:0",
+              "Comma separated tiers, each one the number of ECMP members "
+              "and the RTAG7 seed separated by a colon. The flows reaching "
+              "the first member of a tier are hashed by the next one");
+DEFINE_bool(ipv6, false, "Simulate IPv6 flows instead of IPv4 ones");
+DEFINE_int32(flows, 100000, "The number of random flows to simulate");
+DEFINE_int32(random_seed, 1, "Seed for generating the flows");
+
+namespace {
+
+struct Flow {
+  uint8_t srcIp[16];
+  uint8_t dstIp[16];
+  uint16_t srcPort;
+  uint16_t dstPort;
+  uint32_t flowLabel;
+};
+
+struct Tier {
+  uint32_t members;
+  uint32_t seed;
+};
+
+enum Field : uint32_t {
+  kSrcIp = 1 << 0,
+  kDstIp = 1 << 1,
+  kSrcPort = 1 << 2,
+  kDstPort = 1 << 3,
+  kFlowLabel = 1 << 4,
+};
+
+uint32_t parseFields(StringPiece fields) {
+  vector<StringPiece> names;
+  folly::split(',', fields, names, true);
+  uint32_t parsed = 0;
+  for (auto name : names) {
+    if (name == "src_ip") {
+      parsed |= kSrcIp;
+    } else if (name == "dst_ip") {
+      parsed |= kDstIp;
+    } else if (name == "src_port") {
+      parsed |= kSrcPort;
+    } else if (name == "dst_port") {
+      parsed |= kDstPort;
+    } else if (name == "flow_label") {
+      parsed |= kFlowLabel;
+    } else {
+      LOG(FATAL) << "unknown hash field: " << name;
+    }
+  }
+  return parsed;
+}
+
+vector<Tier> parseTiers(StringPiece tiers) {
+  vector<StringPiece> specs;
+  folly::split(',', tiers, specs, true);
+  vector<Tier> parsed;
+  for (auto spec : specs) {
+    StringPiece members;
+    StringPiece seed;
+    if (!folly::split(':', spec, members, seed)) {
+      LOG(FATAL) << "tier must be <members>:<seed>, got: " << spec;
+    }
+    Tier tier;
+    tier.members = folly::to<uint32_t>(members);
+    tier.seed = std::stoul(seed.str(), nullptr, 0);
+    if (tier.members == 0) {
+      LOG(FATAL) << "tier needs at least one member: " << spec;
+    }
+    parsed.push_back(tier);
+  }
+  return parsed;
+}
+
+class Crc16Ccitt {
+ public:
+  void update(uint8_t byte) {
+    crc_ ^= static_cast<uint16_t>(byte) << 8;
+    for (int i = 0; i < 8; ++i) {
+      crc_ = (crc_ & 0x8000) ? ((crc_ << 1) ^ 0x1021) : (crc_ << 1);
+    }
+  }
+  void update(const uint8_t* bytes, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      update(bytes[i]);
+    }
+  }
+  template <typename T>
+  void updateBE(T value) {
+    for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+      update(static_cast<uint8_t>(value >> shift));
+    }
+  }
+  uint16_t value() const {
+    return crc_;
+  }
+
+ private:
+  uint16_t crc_{0xffff};
+};
+
+uint16_t hashFlow(const Flow& flow, uint32_t fields, uint32_t seed) {
+  size_t ipLen = FLAGS_ipv6 ? 16 : 4;
+  Crc16Ccitt crc;
+  crc.updateBE(seed);
+  if (fields & kSrcIp) {
+    crc.update(flow.srcIp, ipLen);
+  }
+  if (fields & kDstIp) {
+    crc.update(flow.dstIp, ipLen);
+  }
+  if (fields & kSrcPort) {
+    crc.updateBE(flow.srcPort);
+  }
+  if (fields & kDstPort) {
+    crc.updateBE(flow.dstPort);
+  }
+  if ((fields & kFlowLabel) && FLAGS_ipv6) {
+    crc.updateBE(flow.flowLabel & 0xfffff);
+  }
+  return crc.value();
+}
+
+vector<Flow> generateFlows(int count) {
+  std::mt19937 gen(FLAGS_random_seed);
+  std::uniform_int_distribution<uint32_t> dist;
+  vector<Flow> flows(count);
+  for (auto& flow : flows) {
+    for (int i = 0; i < 16; ++i) {
+      flow.srcIp[i] = dist(gen);
+      flow.dstIp[i] = dist(gen);
+    }
+    flow.srcPort = dist(gen);
+    flow.dstPort = dist(gen);
+    flow.flowLabel = dist(gen);
+  }
+  return flows;
+}
+
+void printTier(size_t index, const Tier& tier, const vector<uint64_t>& load) {
+  uint64_t total = 0;
+  uint32_t used = 0;
+  for (auto flows : load) {
+    total += flows;
+    used += flows > 0;
+  }
+  auto minmax = std::minmax_element(load.begin(), load.end());
+  double mean = static_cast<double>(total) / load.size();
+  double variance = 0;
+  for (auto flows : load) {
+    variance += (flows - mean) * (flows - mean);
+  }
+  variance /= load.size();
+
+  printf(
+      "tier %zu (%u members, seed 0x%x): %" PRIu64 " flows\n",
+      index,
+      tier.members,
+      tier.seed,
+      total);
+  printf("  members used: %u/%u\n", used, tier.members);
+  printf(
+      "  flows per member: min %" PRIu64 ", max %" PRIu64 ", mean %.1f\n",
+      *minmax.first,
+      *minmax.second,
+      mean);
+  if (mean > 0) {
+    printf(
+        "  max/mean: %.3f, coefficient of variation: %.3f\n",
+        *minmax.second / mean,
+        std::sqrt(variance) / mean);
+  }
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  auto fields = parseFields(FLAGS_fields);
+  auto tiers = parseTiers(FLAGS_tiers);
+  if (tiers.empty()) {
+    LOG(FATAL) << "no tiers to simulate";
+  }
+
+  // Each tier only sees the flows the previous one sent to its first member
+  auto flows = generateFlows(FLAGS_flows);
+  for (size_t i = 0; i < tiers.size(); ++i) {
+    const auto& tier = tiers[i];
+    vector<uint64_t> load(tier.members);
+    vector<Flow> forwarded;
+    for (const auto& flow : flows) {
+      auto member = hashFlow(flow, fields, tier.seed) % tier.members;
+      ++load[member];
+      if (member == 0) {
+        forwarded.push_back(flow);
+      }
+    }
+    printTier(i, tier, load);
+    flows = std::move(forwarded);
+  }
+  return 0;
+}
@@ -11,6 +11,9 @@
 #include <folly/Exception.h>
 #include <folly/FileUtil.h>
 #include <folly/Memory.h>
+#include <folly/String.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/EventBase.h>
 #include <gflags/gflags.h>
@@ -57,6 +60,11 @@ DEFINE_bool(cdr_disable, false,
 DEFINE_int32(open_timeout, 30, "Number of seconds to wait to open bus");
 DEFINE_bool(direct_i2c, false,
     "Read Transceiver info from i2c bus instead of qsfp_service");
+DEFINE_bool(batch, false,
+    "Read all the pages of the requested ports, or of all ports, in one "
+    "pass and print them as JSON");
+DEFINE_int32(batch_num_modules, 32,
+    "Ports to scan with --batch --direct_i2c when none are given");
 
 bool overrideLowPower(
     TransceiverI2CApi* bus,
@@ -177,7 +185,9 @@ std::map<int32_t, RawDOMData> fetchDataFromQsfpService(
 RawDOMData fetchDataFromLocalI2CBus(TransceiverI2CApi* bus, unsigned int port) {
   RawDOMData rawDOMData;
   rawDOMData.lower = IOBuf(IOBuf::CREATE, 128);
+  rawDOMData.lower.append(128);
   rawDOMData.page0 = IOBuf(IOBuf::CREATE, 128);
+  rawDOMData.page0.append(128);
 
   // Read the lower 128 bytes.
   bus->moduleRead(port, TransceiverI2CApi::ADDR_QSFP, 0,
@@ -185,32 +195,84 @@ RawDOMData fetchDataFromLocalI2CBus(TransceiverI2CApi* bus, unsigned int port) {
 
   uint8_t flatMem = rawDOMData.lower.data()[2] & (1 << 2);
 
+  // The upper pages are read in one batch, so the module is only selected
+  // once for all of them
+  std::vector<TransceiverI2CApi::ModuleOp> ops;
+  uint8_t page0 = 0;
+  uint8_t page3 = 0x3;
+
   // Read page 0 from the upper 128 bytes.
   // First see if we need to select page 0.
-  if (!flatMem) {
-    uint8_t page0 = 0;
-    if (rawDOMData.lower.data()[127] != page0) {
-      bus->moduleWrite(port, TransceiverI2CApi::ADDR_QSFP,
-                       127, 1, &page0);
-    }
+  if (!flatMem && rawDOMData.lower.data()[127] != page0) {
+    ops.push_back({true, TransceiverI2CApi::ADDR_QSFP, 127, 1, &page0});
   }
-  bus->moduleRead(port, TransceiverI2CApi::ADDR_QSFP, 128,
-    128, rawDOMData.page0.writableData());
+  ops.push_back({false, TransceiverI2CApi::ADDR_QSFP, 128, 128,
+                 rawDOMData.page0.writableData()});
 
   // Make sure page3 exist
   if (!flatMem) {
     rawDOMData.page3 = IOBuf(IOBuf::CREATE, 128);
-    uint8_t page3 = 0x3;
-    bus->moduleWrite(port, TransceiverI2CApi::ADDR_QSFP, 127, 1, &page3);
-
-    // read page 3
-    bus->moduleRead(port, TransceiverI2CApi::ADDR_QSFP, 128,
-      128, rawDOMData.page3.writableData());
+    rawDOMData.page3.append(128);
+    ops.push_back({true, TransceiverI2CApi::ADDR_QSFP, 127, 1, &page3});
+    ops.push_back({false, TransceiverI2CApi::ADDR_QSFP, 128, 128,
+                   rawDOMData.page3.writableData()});
     rawDOMData.__isset.page3 = true;
   }
+  bus->moduleBatch(port, ops);
   return rawDOMData;
 }
 
+std::string hexPage(const IOBuf& page) {
+  std::string hex;
+  for (auto range : page) {
+    hex += folly::hexlify(range);
+  }
+  return hex;
+}
+
+folly::dynamic rawDOMDataToJson(const RawDOMData& rawDOMData) {
+  folly::dynamic pages = folly::dynamic::object
+    ("lower", hexPage(rawDOMData.lower))
+    ("page0", hexPage(rawDOMData.page0));
+  if (rawDOMData.__isset.page3) {
+    pages["page3"] = hexPage(rawDOMData.page3);
+  }
+  return pages;
+}
+
+void printBatch(const folly::dynamic& ports) {
+  printf("%s\n", folly::toPrettyJson(ports).c_str());
+}
+
+int batchScanLocalI2CBus(
+    TransceiverI2CApi* bus,
+    std::vector<unsigned int> ports) {
+  if (ports.empty()) {
+    for (int i = 1; i <= FLAGS_batch_num_modules; ++i) {
+      ports.push_back(i);
+    }
+  }
+  // The bus stays open for the whole scan, and each module gets two
+  // batches: its lower page, then all of its upper pages
+  int retcode = EX_OK;
+  folly::dynamic result = folly::dynamic::object;
+  for (auto portNum : ports) {
+    auto key = folly::to<std::string>(portNum);
+    try {
+      result[key] = rawDOMDataToJson(fetchDataFromLocalI2CBus(bus, portNum));
+    } catch (const I2cError& ex) {
+      // This generally means the QSFP module is not present, which is no
+      // reason to fail the scan.
+      result[key] = folly::dynamic::object("error", ex.what());
+    } catch (const std::exception& ex) {
+      result[key] = folly::dynamic::object("error", ex.what());
+      retcode = EX_SOFTWARE;
+    }
+  }
+  printBatch(result);
+  return retcode;
+}
+
 void printPortSummary(TransceiverI2CApi*) {
   // TODO: Implement code for showing a summary of all ports.
   // At the moment I haven't tested this since my test switch has some
@@ -526,6 +588,10 @@ int main(int argc, char* argv[]) {
                      FLAGS_tx_enable || FLAGS_set_100g || FLAGS_set_40g ||
                      FLAGS_cdr_enable || FLAGS_cdr_disable ||
                      FLAGS_set_low_power);
+  if (FLAGS_batch && !printInfo) {
+    fprintf(stderr, "Cannot change settings in batch mode\n");
+    return EX_USAGE;
+  }
 
   if (FLAGS_direct_i2c || !printInfo) {
     try {
@@ -543,6 +609,15 @@ int main(int argc, char* argv[]) {
         idx.push_back(i-1);
       }
       auto rawDOMData = fetchDataFromQsfpService(idx);
+      if (FLAGS_batch) {
+        folly::dynamic result = folly::dynamic::object;
+        for (auto& kv : rawDOMData) {
+          result[folly::to<std::string>(kv.first + 1)] =
+              rawDOMDataToJson(kv.second);
+        }
+        printBatch(result);
+        return EX_OK;
+      }
       for (auto& kv : rawDOMData) {
         printPortDetail(kv.second, kv.first+1);
       }
@@ -553,6 +628,10 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (FLAGS_batch) {
+    return batchScanLocalI2CBus(bus.get(), std::move(ports));
+  }
+
   if (ports.empty()) {
     try {
       printPortSummary(bus.get());